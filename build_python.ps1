@@ -22,28 +22,13 @@ Write-Host "   Working from: $originalDir" -ForegroundColor Gray
 Write-Host "2. Cleaning..." -ForegroundColor Yellow
 Remove-Item dist, build, $BUILD_DIR -Recurse -Force -ErrorAction SilentlyContinue
 
-# 3. Copy shaders from root to python_module BEFORE building
-Write-Host "3. Copying shaders..." -ForegroundColor Yellow
+# 3. Shaders are embedded into the module by CMake (cmake/embed_shaders.cmake)
+Write-Host "3. Checking shaders..." -ForegroundColor Yellow
 $rootShaders = "shaders"
-$cmakeShaders = "python_module\shaders"
 
 if (Test-Path $rootShaders) {
-    # Clean CMake shader directory first
-    Remove-Item $cmakeShaders -Recurse -Force -ErrorAction SilentlyContinue
-    
-    # Copy all shader files
-    mkdir $cmakeShaders -Force
-    Copy-Item "$rootShaders\*" $cmakeShaders -Recurse -Force
-    
-    # Verify copy
-    $rootCount = (Get-ChildItem $rootShaders -File -Recurse).Count
-    $cmakeCount = (Get-ChildItem $cmakeShaders -File -Recurse).Count
-    
-    if ($rootCount -eq $cmakeCount) {
-        Write-Host "   ✓ Copied $rootCount shader files to python_module/shaders" -ForegroundColor Green
-    } else {
-        Write-Host "   WARNING: File count mismatch (root: $rootCount, cmake: $cmakeCount)" -ForegroundColor Yellow
-    }
+    $rootCount = (Get-ChildItem $rootShaders -File).Count
+    Write-Host "   ✓ $rootCount shader files will be embedded" -ForegroundColor Green
 } else {
     Write-Host "   ERROR: Shaders not found in $rootShaders" -ForegroundColor Red
     exit 1
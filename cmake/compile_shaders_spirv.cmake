@@ -0,0 +1,61 @@
+# Compiles every shader in SHADER_DIR to OpenGL SPIR-V in OUTPUT_DIR with glslangValidator, along
+# with the variants the runtime builds by prepending #define lines: each tuned work-group size of
+# math.comp, constraints.comp and collide.comp, and math.comp with each feature switched off. A
+# shader that does not compile fails the build instead of failing on first use at runtime.
+#
+#   cmake -DGLSLANG=<glslangValidator> -DSHADER_DIR=<dir> -DOUTPUT_DIR=<dir> -P compile_shaders_spirv.cmake
+#
+# Uniform locations and bindings are assigned automatically (--aml --amb): the .spv files check
+# the sources, they are not loaded, as the passes look their uniforms up by name.
+
+# MUST MATCH LOCAL_SIZE_CANDIDATES in workgroup_tuner.h and the defines of ComputeFeatureDefines in objects.cpp
+set(local_sizes 32 64 128 256)
+set(tuned_shaders math.comp constraints.comp collide.comp)
+set(math_features HAS_COLOR_EQ=0 HAS_DERIVATIVES=0 HAS_COMPLEX=0 SAFE_MATH=0 HAS_SENSITIVITIES=0 RPN_STACK_ENTRIES=16)
+
+file(GLOB shader_files
+    "${SHADER_DIR}/*.comp"
+    "${SHADER_DIR}/*.vert"
+    "${SHADER_DIR}/*.geom"
+    "${SHADER_DIR}/*.frag"
+)
+list(SORT shader_files)
+file(MAKE_DIRECTORY "${OUTPUT_DIR}")
+
+set(failures "")
+function(compile_variant shader_file output_name)
+    execute_process(
+        COMMAND "${GLSLANG}" -G --aml --amb ${ARGN} -o "${OUTPUT_DIR}/${output_name}.spv" "${shader_file}"
+        RESULT_VARIABLE result
+        OUTPUT_VARIABLE log
+        ERROR_VARIABLE log
+    )
+    if(NOT result EQUAL 0)
+        message("${output_name}:\n${log}")
+        set(failures "${failures} ${output_name}" PARENT_SCOPE)
+    endif()
+endfunction()
+
+foreach(shader_file ${shader_files})
+    get_filename_component(name "${shader_file}" NAME)
+    compile_variant("${shader_file}" "${name}")
+
+    list(FIND tuned_shaders "${name}" tuned)
+    if(NOT tuned EQUAL -1)
+        foreach(size ${local_sizes})
+            compile_variant("${shader_file}" "${name}.local${size}" -DLOCAL_SIZE_X=${size})
+        endforeach()
+    endif()
+
+    if(name STREQUAL "math.comp")
+        foreach(feature ${math_features})
+            string(REGEX REPLACE "=.*" "" feature_name "${feature}")
+            string(TOLOWER "${feature_name}" feature_name)
+            compile_variant("${shader_file}" "${name}.${feature_name}" -D${feature})
+        endforeach()
+    endif()
+endforeach()
+
+if(failures)
+    message(FATAL_ERROR "Shaders failed to compile to SPIR-V:${failures}")
+endif()
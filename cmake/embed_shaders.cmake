@@ -0,0 +1,47 @@
+# Writes every shader in SHADER_DIR into OUTPUT, a C++ source holding the bytes of each file and
+# its SHA-1 as the table FindEmbeddedShader() (include/embedded_shaders.h) searches.
+#
+#   cmake -DSHADER_DIR=<dir> -DOUTPUT=<file.cpp> -P embed_shaders.cmake
+#
+# OUTPUT is only rewritten when its contents change, so shader edits rebuild one file.
+
+file(GLOB shader_files
+    "${SHADER_DIR}/*.comp"
+    "${SHADER_DIR}/*.vert"
+    "${SHADER_DIR}/*.geom"
+    "${SHADER_DIR}/*.frag"
+)
+list(SORT shader_files)
+
+# 16 bytes per line
+set(byte_pattern "")
+foreach(i RANGE 15)
+    string(APPEND byte_pattern "0x[0-9a-f][0-9a-f],")
+endforeach()
+
+set(arrays "")
+set(table "")
+set(index 0)
+foreach(shader_file ${shader_files})
+    get_filename_component(name "${shader_file}" NAME)
+    file(READ "${shader_file}" hex HEX)
+    file(SHA1 "${shader_file}" hash)
+    string(LENGTH "${hex}" hex_length)
+    math(EXPR size "${hex_length} / 2")
+
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+    string(REGEX REPLACE "(${byte_pattern})" "\\1\n    " bytes "${bytes}")
+    string(APPEND arrays "// ${name}\nstatic const unsigned char s_shader${index}[] = {\n    ${bytes}0x00\n};\n\n")
+    string(APPEND table "    { \"${name}\", s_shader${index}, ${size}u, \"${hash}\" },\n")
+    math(EXPR index "${index} + 1")
+endforeach()
+
+set(content "// Generated by cmake/embed_shaders.cmake from ${SHADER_DIR} - do not edit\n\n")
+string(APPEND content "#include \"embedded_shaders.h\"\n\n")
+string(APPEND content "${arrays}")
+string(APPEND content "const EmbeddedShader g_embeddedShaders[] = {\n${table}    { nullptr, nullptr, 0u, nullptr }\n};\n\n")
+string(APPEND content "const int g_embeddedShaderCount = ${index};\n")
+
+file(WRITE "${OUTPUT}.tmp" "${content}")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different "${OUTPUT}.tmp" "${OUTPUT}")
+file(REMOVE "${OUTPUT}.tmp")
@@ -13,6 +13,7 @@ while sim.object_count() > 0:
 
 TARGET_ID, OBSTACLE_COUNT, BOID_COUNT = 0, 4, 7
 OBSTACLE_START_ID = 1
+SEPARATION_RADIUS = 1.5
 BOID_START_ID = OBSTACLE_START_ID + OBSTACLE_COUNT
 
 sim.add_object(0, 0, 0, 0, 1.0, 0, 0, 0, se.SkinType.CIRCLE, 0.15, 0, 0, 1.0, 0.2, 0.2, 1.0)
@@ -38,7 +39,10 @@ for i, (ox, oy) in enumerate(obs_data):
     )
     obstacles.append(oid)
     sim.set_equation(oid, "0, 0")
+    sim.set_object_static(oid)  # Never integrated; boids still read p[oid]
 
+# Boids carry charge 1 and the target and obstacles none: nothing here reads charge as a
+# force, so it tags who the separation sum counts
 boids = []
 for i in range(BOID_COUNT):
     start_x = -6.0 + (i % 3) * 0.5
@@ -47,7 +51,7 @@ for i in range(BOID_COUNT):
 
     bid = sim.add_object(
         start_x, start_y, 
-        0.5, rand_vy, 1.0, 0.0, 0, 0,
+        0.5, rand_vy, 1.0, 1.0, 0, 0,
         se.SkinType.POLYGON, 0.25, 0, 0,
         0.2, 0.8, 1.0, 1.0, 3
     )
@@ -67,14 +71,12 @@ for i in range(BOID_COUNT):
     
     fx_avoid_obs, fy_avoid_obs = " + ".join(fx_obs), " + ".join(fy_obs)
 
-    fx_sep, fy_sep = [], []
-    for other in boids:
-        if other == me: continue
-        d2 = f"((x - p[{other}].x)*(x - p[{other}].x) + (y - p[{other}].y)*(y - p[{other}].y) + 0.05)"
-        fx_sep.append(f"3.0 * (x - p[{other}].x) / {d2}")
-        fy_sep.append(f"3.0 * (y - p[{other}].y) / {d2}")
-
-    fx_separation, fy_separation = " + ".join(fx_sep), " + ".join(fy_sep)
+    # Separation only looks at neighbours within SEPARATION_RADIUS, so the equation
+    # stays the same size however many boids there are; pj.charge leaves out the
+    # target and the obstacles, which the seek and avoid terms already handle
+    d2 = "((x - pj.x)*(x - pj.x) + (y - pj.y)*(y - pj.y) + 0.05)"
+    fx_separation = f"nsum({SEPARATION_RADIUS}, pj.charge * 3.0 * (x - pj.x) / {d2})"
+    fy_separation = f"nsum({SEPARATION_RADIUS}, pj.charge * 3.0 * (y - pj.y) / {d2})"
 
     fx_drag, fy_drag = "-2.0 * vx", "-2.0 * vy"
 
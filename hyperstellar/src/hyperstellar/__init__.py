@@ -71,6 +71,8 @@ try:
     # Also copy __all__ if it exists
     if hasattr(_stellar_module, '__all__'):
         __all__ = _stellar_module.__all__
+
+    from .batch_scheduler import run_batch_parallel
     
     print(f"✓ hyperstellar loaded: {system} {arch}")
     
@@ -1,6 +1,7 @@
 ﻿# Type stubs for hyperstellar package
 import typing
 from typing import Any, List, Dict, Optional, Union, Callable, ClassVar, Tuple
+from . import expr as expr
 
 class SkinType:
     """Visual representation type for objects."""
@@ -15,6 +16,12 @@ class PyCollisionShape:
     AABB: int       # Axis-aligned bounding box
     POLYGON: int    # Polygon collision shape
 
+class BroadphaseMode:
+    """Collision candidate search used by the GPU solver."""
+    ALL_PAIRS: int      # Every object tests every other object
+    UNIFORM_GRID: int   # Spatial hash (similar object sizes)
+    LBVH: int           # Linear BVH (widely varying object sizes)
+
 class ConstraintType:
     """Type of physics constraint."""
     DISTANCE: int   # Distance constraint between objects
@@ -49,6 +56,9 @@ class CollisionConfig:
     shape: PyCollisionShape     # Collision shape type
     restitution: float          # Bounciness (0.0-1.0)
     friction: float             # Friction coefficient (0.0-1.0)
+    category: int               # Category bits this object belongs to
+    mask: int                   # Categories this object collides with
+    continuous: bool            # Whether swept collision tests are on
     
     def __init__(self) -> None: ...
     def __repr__(self) -> str: ...
@@ -83,7 +93,7 @@ class ConstraintConfig:
     type: ConstraintType    # Type of constraint
     target: int             # Target object index (for distance constraints)
     param1: float           # Parameter 1 (distance, min_x, etc.)
-    param2: float           # Parameter 2 (max_x, etc.)
+    param2: float           # Parameter 2 (break length of a distance constraint, max_x, etc.)
     param3: float           # Parameter 3 (min_y, etc.)
     param4: float           # Parameter 4 (max_y, etc.)
     
@@ -95,9 +105,40 @@ class BatchConfig:
     duration: float                # Simulation duration (seconds)
     dt: float                      # Time step (seconds)
     output_file: str               # Optional output file path
+    # Optional early end, checked on the GPU every stop_check_interval steps:
+    # "any(expr < c)", "all(expr >= c)" or "sum|mean|min|max(expr) > c" over
+    # the configuration's objects, with < <= > >=; p[i] is its i-th object, e.g.
+    # "sum(0.5 * mass * (vx^2 + vy^2)) < 0.01". Not supported by run_batch_cpu().
+    stop_condition: str
+    stop_check_interval: int       # Steps between checks (default 10)
     
     def __init__(self) -> None: ...
 
+class BatchObserver:
+    """
+    Per-step observer for run_batch(): the chosen fields of the chosen objects
+    every every_n_steps steps, recorded on the GPU and passed to the callback
+    in chunks.
+    """
+    fields: List[str]              # Empty = every readback field
+    every_n_steps: int             # Steps between frames
+    objects: List[int]             # Indices within the configuration, empty = all
+    
+    def __init__(
+        self,
+        callback: Callable[[int, Dict[str, Any]], None],
+        fields: List[str] = [],
+        every_n_steps: int = 1,
+        objects: List[int] = []
+    ) -> None:
+        """
+        Args:
+            callback: Called as callback(batch_index, frames), frames being a
+                dict like download_recording() returns, object indices local
+                to the configuration
+        """
+        ...
+
 # Batch data structures
 class BatchGetData:
     """Batch get data structure for fetching multiple objects at once."""
@@ -141,13 +182,242 @@ class BatchUpdateData:
     
     def __init__(self) -> None: ...
 
+class ReadbackFuture:
+    """Pending copy of the object state, returned by Simulation.fetch_async()."""
+    
+    def ready(self) -> bool:
+        """True once the copy has landed and result() will not block."""
+        ...
+    
+    def result(self) -> Dict[str, List[float]]:
+        """
+        Field values of every object at the time of fetch_async().
+        
+        Waits only if the copy is still in flight; later calls return the
+        same values.
+        
+        Raises:
+            RuntimeError: If the simulation was cleaned up first
+        """
+        ...
+
+class StepHandle:
+    """
+    Steps submitted by Simulation.step_async(), done once the GPU passes them.
+    
+    Awaitable: ``await handle`` yields to the event loop until the steps are
+    done and returns how many ran.
+    """
+    
+    steps: int  # Steps the call submitted
+    
+    def ready(self) -> bool:
+        """True once the GPU has finished the steps."""
+        ...
+    
+    def wait(self, timeout: float = -1.0) -> bool:
+        """Block until the steps are done; False if timeout seconds passed first (< 0 waits until done)."""
+        ...
+    
+    def __await__(self) -> typing.Generator[None, None, int]: ...
+
+class CommandFuture:
+    """A command submitted to Simulation.commands, done once the stepping thread has run it."""
+    
+    def ready(self) -> bool:
+        """True once the command has run and result() will not block."""
+        ...
+    
+    def wait(self, timeout: float = -1.0) -> bool:
+        """Block until the command has run; False if timeout seconds passed first."""
+        ...
+    
+    def result(self) -> Any:
+        """
+        None for mutations, the value for queries; waits until the command has run.
+        
+        Raises:
+            RuntimeError: What the command raised, or that the simulation was
+                cleaned up before it ran
+        """
+        ...
+
+class CommandQueue:
+    """
+    Commands any Python thread can submit without a lock, from Simulation.commands.
+    
+    update(), step(), step_async() and process_commands() run everything
+    queued so far first, in submission order.
+    """
+    
+    pending: int
+    
+    def set_equation(self, object_index: int, equation_string: Any, derivative_method: str = "symbolic") -> CommandFuture: ...
+    def batch_update(self, updates: List[BatchUpdateData]) -> CommandFuture: ...
+    def add_object(self, x: float = 0.0, y: float = 0.0, vx: float = 0.0, vy: float = 0.0,
+                   mass: float = 1.0, charge: float = 0.0, rotation: float = 0.0,
+                   angular_velocity: float = 0.0, skin: Any = ..., size: float = 0.3,
+                   width: float = 0.5, height: float = 0.3, r: float = 1.0, g: float = 1.0,
+                   b: float = 1.0, a: float = 1.0, polygon_sides: int = 6) -> CommandFuture: ...
+    def remove_object(self, index: int) -> CommandFuture: ...
+    def remove_objects(self, indices: List[int]) -> CommandFuture: ...
+    def get_object(self, index: int) -> CommandFuture: ...
+    def batch_get(self, indices: List[int]) -> CommandFuture: ...
+    def object_count(self) -> CommandFuture: ...
+
+class SharedFrames:
+    """
+    Reader of a ring Simulation.start_shared_frames() publishes, from any process.
+    
+    Needs no Simulation and no GL context: the ring is mapped read-only and
+    frames are NumPy views into it. A slot is reused every `slots` frames, so
+    a view stays the frame it was taken for only until then; valid() after
+    reading tells whether it still was. read() copies under the slot's
+    seqlock instead.
+    
+    Example:
+        >>> ring = SharedFrames("sim_frames")
+        >>> frame = ring.latest()
+        >>> xs = ring.view(frame)[:, ring.fields.index("x")]
+        >>> if not ring.valid(frame): ...   # overwritten while reading
+    """
+    
+    fields: List[str]   # Recorded fields, the columns of each frame
+    objects: List[int]  # Recorded object indices, the rows
+    slots: int          # Frames the ring holds
+    
+    def __init__(self, name: str) -> None:
+        """Open the ring published under the name given to start_shared_frames()."""
+        ...
+    
+    def latest(self) -> int:
+        """Number of the newest frame, -1 before the first."""
+        ...
+    
+    def valid(self, frame: int) -> bool:
+        """True while the frame is complete and its slot not yet reused."""
+        ...
+    
+    def view(self, frame: int) -> Any:
+        """
+        Values of a frame in place, without a copy.
+        
+        Returns:
+            Read-only float32 numpy.ndarray of shape (objects, fields); it
+            keeps the mapping alive
+        
+        Raises:
+            RuntimeError: If the frame is not in the ring
+        """
+        ...
+    
+    def info(self, frame: int) -> Tuple[int, float]:
+        """(step, time) of a frame; raises RuntimeError if it is not in the ring."""
+        ...
+    
+    def read(self, frame: int = -1) -> Optional[Tuple[int, int, float, Any]]:
+        """
+        Copy of a frame that is consistent even while the writer goes on.
+        
+        Args:
+            frame: Frame number, -1 (default) for the newest
+        
+        Returns:
+            (frame, step, time, values of shape (objects, fields)), or None
+            when there is no such frame any more
+        """
+        ...
+
+class Trajectory:
+    """
+    Reader of a directory Simulation.record(output_dir=...) wrote.
+    
+    Each <field>.npy is memory-mapped, never read whole: indexing returns
+    read-only NumPy views into the mapping, and the OS pages in only what a
+    view touches. Read-ahead is off, so a single object's series over many
+    frames faults just the pages holding its column. chunk() walks the
+    frames in blocks and asks for each block's pages ahead of use. Frames
+    are counted from the file sizes, so a directory still being written
+    opens as the frames flushed so far; open it again for more.
+    
+    Example:
+        >>> traj = Trajectory("run")
+        >>> x = traj.series("x", 12)            # object 12, every frame
+        >>> for c in range(traj.num_chunks()):
+        ...     block = traj.chunk(c, fields=["vx", "vy"])
+        ...     energy += (block["vx"] ** 2 + block["vy"] ** 2).sum()
+    """
+    
+    steps: Any          # Simulation step of every frame, a read-only view
+    times: Any          # Simulation time of every frame, a read-only view
+    frames: int         # Complete frames on disk
+    fields: List[str]   # Recorded fields, sorted by name
+    objects: List[int]  # Recorded object indices, the columns
+    path: str           # The trajectory directory
+    
+    def __init__(self, path: str) -> None:
+        """Open the output_dir given to record()."""
+        ...
+    
+    def __len__(self) -> int: ...
+    def __contains__(self, field: str) -> bool: ...
+    
+    def __getitem__(self, field: str) -> Any:
+        """Every frame of a field: read-only float32 view of shape (frames, objects)."""
+        ...
+    
+    def series(self, field: str, object: int) -> Any:
+        """
+        One object's values over every frame, without a copy.
+        
+        Args:
+            field: Recorded field
+            object: Simulation index of the object, one of `objects`
+        
+        Returns:
+            Read-only strided float32 numpy.ndarray of shape (frames,)
+        
+        Raises:
+            KeyError: If the object or field was not recorded
+        """
+        ...
+    
+    def num_chunks(self, frames_per_chunk: int = 65536) -> int:
+        """Chunks of frames_per_chunk frames chunk() splits the frames into."""
+        ...
+    
+    def chunk(self, index: int, frames_per_chunk: int = 65536, fields: Optional[List[str]] = None) -> Dict[str, Any]:
+        """
+        Frames [index * frames_per_chunk, (index + 1) * frames_per_chunk).
+        
+        Args:
+            index: Chunk number, below num_chunks(frames_per_chunk)
+            frames_per_chunk: Frames per chunk (the last may be shorter)
+            fields: Fields to include (default: all)
+        
+        Returns:
+            Read-only views, field -> (frames, objects), plus "step" and
+            "time" of shape (frames,)
+        
+        Raises:
+            IndexError: If the chunk is past the last frame
+        """
+        ...
+
 class DistanceConstraint:
-    """Maintain distance between two objects."""
+    """Maintain distance between two objects.
+
+    A constraint with a break_length is dropped on the GPU once the objects are
+    further apart than it (tearing cloth, breaking joints). Breakable constraints
+    are solved by the per-object pass even with XPBD, and run_batch_cpu does not
+    break them.
+    """
     target_object: int      # Index of target object
     rest_length: float      # Desired distance between objects
+    break_length: float     # Distance it breaks at, 0 = never
     stiffness: float        # Constraint stiffness
     
-    def __init__(self, target_object: int = 0, rest_length: float = 5.0, stiffness: float = 100.0) -> None: ...
+    def __init__(self, target_object: int = 0, rest_length: float = 5.0, break_length: float = 0.0) -> None: ...
     def __repr__(self) -> str: ...
 
 class BoundaryConstraint:
@@ -161,7 +431,20 @@ class BoundaryConstraint:
     def __repr__(self) -> str: ...
 
 class Simulation:
-    """Main physics simulation class."""
+    """
+    Main physics simulation class.
+    
+    Threading: the OpenGL context is current on the thread that created the
+    simulation, so call every method from that thread and never from two
+    threads at once. update(), run_batch(), save_to_file() and
+    load_from_file() release the GIL while they run, so other Python
+    threads keep going while the GPU steps.
+    
+    One simulation per process: the engine's GPU state is shared by the
+    process, so a second Simulation raises until the first one's cleanup().
+    Independent systems run as worlds of one simulation (run_batch with
+    ensemble=True) or one process each (run_batch_parallel).
+    """
     
     def __init__(self, 
                  headless: bool = True, 
@@ -173,11 +456,19 @@ class Simulation:
         Initialize physics simulation.
         
         Args:
-            headless: Run without graphics window (for batch processing)
+            headless: Run without graphics window (for batch processing).
+                On Linux the context comes from EGL, so no X/Wayland server
+                is needed; STELLAR_EGL_DEVICE picks the GPU (default 0) and
+                STELLAR_HEADLESS=glfw forces the hidden-window path used
+                elsewhere
             width: Window width in pixels (ignored in headless mode)
             height: Window height in pixels (ignored in headless mode)
             title: Window title (ignored in headless mode)
             enable_grid: Enable coordinate grid display
+            
+        Raises:
+            RuntimeError: If the context cannot be created, or another
+                Simulation of this process has not been cleaned up
         """
         ...
     
@@ -186,7 +477,44 @@ class Simulation:
     # ========================================================================
     
     def render(self) -> None:
-        """Render the current simulation state to screen (non-headless only)."""
+        """Render the current simulation state to screen, and to the video while capturing."""
+        ...
+    
+    def start_capture(self, path: str, fps: int = 30, resolution: Tuple[int, int] = (0, 0)) -> None:
+        """
+        Record what render() draws to a video file, also when headless.
+        
+        Every render() call adds one frame, drawn offscreen at the capture
+        resolution. Frames come back through a ring of pixel buffers that
+        is only read once the GPU has finished with it, and are encoded by
+        an ffmpeg process on a background thread, so render() rarely waits.
+        ffmpeg must be on PATH, or STELLAR_FFMPEG must name it. Replaces
+        a capture in progress.
+        
+        Args:
+            path: Output file; the extension picks the container (.mp4, .mkv, ...)
+            fps: Playback frame rate (default 30)
+            resolution: Even (width, height), (0, 0) = window size
+        
+        Raises:
+            RuntimeError: If fps < 1, the resolution is odd, or ffmpeg cannot start
+        """
+        ...
+    
+    def stop_capture(self) -> int:
+        """
+        Encode the frames still in flight and finish the video.
+        
+        Returns:
+            Frames written
+        
+        Raises:
+            RuntimeError: If the encoder failed or could not be started
+        """
+        ...
+    
+    def is_capturing(self) -> bool:
+        """True between start_capture() and stop_capture()."""
         ...
     
     def process_input(self) -> None:
@@ -224,363 +552,2863 @@ class Simulation:
         """
         ...
     
-    # ========================================================================
-    # CORE SIMULATION
-    # ========================================================================
-    
-    def update(self, dt: float = 0.016) -> None:
+    def set_trails(self, object_count: int, length: int = 64) -> None:
         """
-        Update simulation physics.
+        Draw position trails behind the first object_count objects.
+        
+        The last length positions of each are kept in a ring on the GPU,
+        one per update(), and render() draws them as fading lines. Nothing
+        is read back. Changing the settings clears the trails.
         
         Args:
-            dt: Time step in seconds (default: 1/60th = 0.016)
+            object_count: Objects with a trail, 0 = no trails (the default)
+            length: Positions per trail, 2 to 1024 (default 64)
+        
+        Raises:
+            RuntimeError: If object_count < 0 or length is out of range
         """
         ...
     
-    # ========================================================================
-    # OBJECT MANAGEMENT
-    # ========================================================================
+    def get_trails(self) -> Tuple[int, int]:
+        """Trail settings as (object_count, length)."""
+        ...
     
-    def add_object(
-        self,
-        x: float = 0.0,
-        y: float = 0.0,
-        vx: float = 0.0,
-        vy: float = 0.0,
-        mass: float = 1.0,
-        charge: float = 0.0,
-        rotation: float = 0.0,
-        angular_velocity: float = 0.0,
-        skin: SkinType = SkinType.CIRCLE,
-        size: float = 0.3,
-        width: float = 0.5,
-        height: float = 0.3,
-        r: float = 1.0,
-        g: float = 1.0,
-        b: float = 1.0,
-        a: float = 1.0,
-        polygon_sides: int = 6
-    ) -> int:
+    def set_force_field(self, ax: str, ay: str,
+                        bounds: Tuple[float, float, float, float] = (-10.0, 10.0, -10.0, 10.0),
+                        resolution: Tuple[int, int] = (64, 64), scale: float = 0.1) -> None:
         """
-        Add a new physics object to the simulation.
+        Draw arrows of an acceleration field behind the objects.
+        
+        ax and ay are written like equations and evaluated on the GPU at
+        every render() on a grid of sample points, each a probe at rest
+        with unit mass and charge, so p[i].x and friends see the live
+        objects. The arrows never leave the GPU. sum_j, nsum and other
+        step-only inputs are not available. Replaces any field set before.
         
         Args:
-            x, y: Initial position
-            vx, vy: Initial velocity
-            mass: Object mass
-            charge: Electrical charge
-            rotation: Initial rotation angle (radians)
-            angular_velocity: Initial angular velocity (radians/second)
-            skin: Visual appearance type
-            size: Radius for circles/polygons (ignored for rectangles)
-            width: Width for rectangles, diameter for circles/polygons
-            height: Height for rectangles (ignored for circles/polygons)
-            r, g, b, a: Color components (0.0-1.0)
-            polygon_sides: Number of sides for polygons (3-12)
-            
-        Returns:
-            Index of the newly created object
-            
-        Note:
-            Collision shape is automatically assigned based on skin type:
-            - CIRCLE → PyCollisionShape.CIRCLE
-            - RECTANGLE → PyCollisionShape.AABB
-            - POLYGON → PyCollisionShape.POLYGON
-            Default collision properties: restitution=0.7, friction=0.3
+            ax: Horizontal acceleration, e.g. "-k*x"
+            ay: Vertical acceleration
+            bounds: (x_min, x_max, y_min, y_max) sampled
+            resolution: Sample (columns, rows), default (64, 64)
+            scale: Arrow length per unit of acceleration, capped at a cell
+        
+        Raises:
+            RuntimeError: If an expression does not compile or the grid is invalid
         """
         ...
     
-    def update_object(
-        self,
-        index: int,
-        x: float, y: float,
-        vx: float, vy: float,
-        mass: float, charge: float,
-        rotation: float, angular_velocity: float,
-        width: float, height: float,
-        r: float, g: float, b: float, a: float
-    ) -> None:
+    def clear_force_field(self) -> None:
+        """Stop drawing the force field."""
+        ...
+    
+    def set_render_interpolation(self, enabled: bool) -> None:
         """
-        Update properties of an existing object.
+        Draw objects between the last two physics steps.
+        
+        render() blends position and rotation from the state before the
+        newest step, by the time update() has left over, so motion stays
+        smooth with fewer steps per frame. The display runs up to one step
+        behind. Host edits since the last step, pipelined frames and
+        adaptive steps draw the newest state as it is.
         
         Args:
-            index: Object index to update
-            x, y: New position
-            vx, vy: New velocity
-            mass: New mass
-            charge: New charge
-            rotation: New rotation angle
-            angular_velocity: New angular velocity
-            width: New width/radius (interpretation depends on skin type)
-            height: New height (for rectangles only)
-            r, g, b, a: New color components
+            enabled: Interpolate, off by default
         """
         ...
     
-    # ========================================================================
-    # BATCH OPERATIONS
-    # ========================================================================
+    def get_render_interpolation(self) -> bool:
+        """True if render() interpolates between steps."""
+        ...
     
-    def batch_get(self, indices: List[int]) -> List[BatchGetData]:
+    def get_interpolation_fraction(self) -> float:
         """
-        Efficiently fetch multiple objects' states at once.
+        How far into the newest step the next render() draws, from 0 to 1.
         
-        Args:
-            indices: List of object indices to fetch
-            
-        Returns:
-            List of BatchGetData objects containing object states
-            
-        Raises:
-            RuntimeError: If any index is invalid
+        update() sets it from the time it has left over when render
+        interpolation is on. 1.0 draws the newest state as it is.
         """
         ...
     
-    def batch_update(self, updates: List[BatchUpdateData]) -> None:
+    def set_density_rendering(self, enabled: bool, exposure: float = 8.0) -> None:
         """
-        Efficiently update multiple objects at once.
+        Draw objects as additive point splats instead of their skins.
+        
+        Every object adds its colour to the pixel under its centre in a
+        float target, which is tone-mapped to the mean colour per pixel,
+        brighter where more objects land. The cost is one point per object
+        whatever the skin, for scenes of a million objects and more.
+        View culling and render interpolation do not apply.
         
         Args:
-            updates: List of BatchUpdateData objects with update information
-            
+            enabled: Splat points, off by default
+            exposure: Objects per pixel at which brightness is ~63% up
+        
         Raises:
-            RuntimeError: If any object index is invalid
+            RuntimeError: If exposure is not positive
         """
         ...
     
-    def remove_object(self, index: int) -> None:
+    def get_density_rendering(self) -> Tuple[bool, float]:
+        """(enabled, exposure) of density rendering."""
+        ...
+    
+    def set_constraint_rendering(self, enabled: bool, strain_scale: float = 0.1) -> None:
         """
-        Remove an object from the simulation.
+        Draw every distance constraint as a line between its two objects.
+        
+        One draw call reads the constraint and object buffers on the GPU,
+        so constraints that break and objects that move show at the next
+        render() without a readback. Lines are white at rest length, red
+        when stretched and blue when compressed.
         
         Args:
-            index: Index of object to remove
-            
+            enabled: Draw the lines, off by default
+            strain_scale: Relative stretch drawn at full colour (default 0.1)
+        
         Raises:
-            RuntimeError: If index is invalid
+            RuntimeError: If strain_scale is not positive
         """
         ...
     
-    def object_count(self) -> int:
+    def get_constraint_rendering(self) -> Tuple[bool, float]:
+        """(enabled, strain_scale) of constraint rendering."""
+        ...
+    
+    def set_profiling(self, enabled: bool) -> None:
         """
-        Get current number of objects in simulation.
+        Turn the GPU pass timers on or off and clear the collected timings.
         
-        Returns:
-            Number of active objects
+        Args:
+            enabled: Time passes, on by default
         """
         ...
     
-    def get_object(self, index: int) -> ObjectState:
+    def get_profile(self) -> Dict[str, Dict[str, float]]:
         """
-        Get complete state of a specific object.
+        Rolling per-pass timings in milliseconds.
+        
+        "gpu" maps each timed pass (integrate, constraints, collisions,
+        post_step, draw, axis) to its mean GPU time over the last 32
+        samples, from timer queries collected a few frames late without
+        waiting. "cpu" holds host timings, such as update().
+        Passes that have not run yet are missing.
         
-        Args:
-            index: Object index
-            
         Returns:
-            ObjectState containing all object properties
-            
-        Raises:
-            RuntimeError: If index is invalid
+            {"gpu": {...}, "cpu": {...}}
         """
         ...
     
-    # ========================================================================
-    # CONVENIENCE METHODS
-    # ========================================================================
-    
-    def set_rotation(self, index: int, rotation: float) -> None:
+    def set_step_budget(self, budget_ms: float = 0.0, max_steps: int = 20, max_lag: float = 0.0) -> None:
         """
-        Set rotation angle of an object.
+        Limit the steps update() runs to a wall-clock budget.
+        
+        update() owes one step per "timestep" (set_parameter) of the time it
+        is given. The steps are timed with GPU timer queries, read a few
+        updates late without waiting, and each update runs as many of the
+        owed steps as fit the budget at the measured time per step (at least
+        one, at most max_steps). Steps that do not fit carry over as lag; lag
+        beyond max_lag is dropped and counted (see get_step_stats).
         
         Args:
-            index: Object index
-            rotation: New rotation angle in radians
+            budget_ms: Milliseconds of stepping per update, 0 = no budget
+            max_steps: Steps per update at most, default 20
+            max_lag: Simulated seconds the scene may fall behind before the
+                rest is dropped, 0 = never drop
+        
+        Raises:
+            RuntimeError: If budget_ms or max_lag is negative or max_steps is below 1
         """
         ...
     
-    def set_angular_velocity(self, index: int, angular_velocity: float) -> None:
+    def get_step_stats(self) -> Dict[str, float]:
         """
-        Set angular velocity of an object.
+        How update() keeps up with real time.
+        
+        "steps" is what the last update ran, "step_ms" the smoothed time of
+        one step (0 until measured), "budget_ms" and "max_steps" the settings
+        of set_step_budget, "lag" the simulated seconds still owed in whole
+        steps and "dropped" the simulated seconds given up to max_lag so far.
+        A lag that keeps growing means the scene cannot run in real time.
+        
+        Returns:
+            {"steps", "step_ms", "budget_ms", "max_steps", "lag", "dropped"}
+        """
+        ...
+    
+    def set_counters(self, enabled: bool, interval: int = 16) -> None:
+        """
+        Count the work of the simulation passes on the GPU.
+        
+        math.comp, constraints.comp and collide.comp add up what they did;
+        every `interval` steps the counts are copied off the GPU and
+        cleared, and get_counters() returns the last copy that has arrived,
+        without waiting for the GPU. Off by default.
         
         Args:
-            index: Object index
-            angular_velocity: New angular velocity in radians/second
+            enabled: Count work
+            interval: Steps per read, default 16
+        
+        Raises:
+            RuntimeError: If interval is below 1
         """
         ...
     
-    def set_dimensions(self, index: int, width: float, height: float) -> None:
+    def get_counters(self) -> Tuple[Dict[str, float], List[float]]:
         """
-        Set dimensions of an object.
+        Work counts of the last read interval.
+        
+        The totals are "steps" (the steps they cover, 0 before the first
+        read), "interval" (the read interval set_counters set, which later
+        reads will cover), "tokens" (equation tokens or register instructions run, pair
+        reduction bodies included), "equations" (evaluations, one per
+        object per integrator stage), "pair_tests" and "contacts"
+        (narrowphase), "constraint_solves" (per-object constraint pass,
+        iterations included) and "sanitized" (NaN/Inf values replaced by
+        the safe-math guards). Compiled equations run no tokens.
+        
+        Returns:
+            (totals, evaluations per equation ID)
+        """
+        ...
+    
+    def set_collision_events(self, enabled: bool, category_mask: int = 0xFFFFFFFF,
+                             capacity: int = 16384) -> None:
+        """
+        Stream the touching pairs of every step off the GPU.
+        
+        The narrowphase (or the contact solver, when it resolves the pairs)
+        appends each touching pair once per step; after each step the events
+        are copied off the GPU without waiting for it, and collision_events()
+        hands over what has arrived. Off by default.
         
         Args:
-            index: Object index
-            width: New width (radius for circles/polygons, width for rectangles)
-            height: New height (for rectangles only, ignored for circles/polygons)
+            enabled: Record events; turning it on drops any pending ones
+            category_mask: Only pairs with an object in one of these collision
+                categories, default all
+            capacity: Events the GPU buffer holds between copies, default 16384;
+                further ones are counted as dropped
+        
+        Raises:
+            RuntimeError: If capacity is below 1
         """
         ...
     
-    def set_radius(self, index: int, radius: float) -> None:
+    def collision_events(self) -> Any:
         """
-        Set radius of an object.
+        Collision events that have arrived since the last call, oldest first.
+        
+        Events reach the host a step or two after they happen. Fields are
+        "a" and "b" (object IDs), "normal" (from a to b), "impulse" (normal
+        impulse of the response, 0 for a separating pair) and "penetration".
+        Object IDs are those of the step that produced the event.
+        
+        Returns:
+            numpy.ndarray structured array, one record per event
+        """
+        ...
+    
+    def get_dropped_collision_events(self) -> int:
+        """Collision events that did not fit the buffer since the stream was turned on"""
+        ...
+    
+    def memory_report(self) -> List[Tuple[str, str, int, int]]:
+        """
+        Bytes held by the simulation's buffers and host structures.
+        
+        One row per object, equation, constraint and readback buffer on the
+        GPU and per host-side mirror. Per-object buffers count the live
+        objects' share of their capacity as used; staging copies and
+        fixed-size buffers count all of it. Buffers of the broadphase,
+        trails and other helper passes are not listed.
+        
+        Returns:
+            (name, "gpu" or "host", capacity bytes, used bytes) per row
+        """
+        ...
+    
+    def start_trace(self) -> None:
+        """
+        Start capturing trace zones, dropping any earlier capture.
+        
+        Zones cover update(), the simulation passes, readbacks and shader
+        loading; timed GPU passes appear on their own track. Only builds
+        with STELLAR_TRACING record zones.
+        
+        Raises:
+            RuntimeError: If tracing is not compiled in
+        """
+        ...
+    
+    def stop_trace(self, path: str) -> None:
+        """
+        Stop the capture and write it as Chrome trace JSON.
+        
+        Open the file in chrome://tracing or ui.perfetto.dev.
         
         Args:
-            index: Object index
-            radius: New radius (for circles/polygons, converts rectangles to squares)
+            path: Output file
+        
+        Raises:
+            RuntimeError: If no capture is running or the file cannot be written
         """
         ...
     
-    def get_rotation(self, index: int) -> float:
+    # ========================================================================
+    # CORE SIMULATION
+    # ========================================================================
+    
+    def update(self, dt: float = 0.016) -> None:
         """
-        Get current rotation angle of an object.
+        Update simulation physics.
+        
+        Releases the GIL for the whole sub-stepping loop; other Python
+        threads run meanwhile but must not use this simulation; they submit
+        to commands instead, which this runs first.
         
         Args:
-            index: Object index
+            dt: Time step in seconds (default: 1/60th = 0.016)
+        """
+        ...
+    
+    def step(self, n_steps: int = 1) -> int:
+        """
+        Run exactly n_steps fixed steps of the current timestep.
+        
+        Unlike update() there is no accumulator and no step budget: the time
+        update() is owed is left as it is. Releases the GIL while it runs.
+        
+        Args:
+            n_steps: Steps to run (default: 1)
+        
+        Returns:
+            Steps run (0 while paused)
+        """
+        ...
+    
+    def step_async(self, n_steps: int = 1) -> StepHandle:
+        """
+        Submit n_steps fixed steps and return without waiting for the GPU.
+        
+        The steps are those step() runs, without the error check at the end;
+        prepare the next inputs while the handle is pending.
+        
+        Args:
+            n_steps: Steps to submit (default: 1)
+        
+        Returns:
+            StepHandle to poll with ready(), block on with wait(), or await
+        
+        Example:
+            >>> handle = sim.step_async(100)
+            >>> forces = compute_next_forces()  # Overlaps the GPU work
+            >>> await handle                    # Or handle.wait()
+        """
+        ...
+    
+    @property
+    def commands(self) -> CommandQueue:
+        """CommandQueue other Python threads submit mutations and queries to."""
+        ...
+    
+    def process_commands(self) -> int:
+        """Run the submitted commands without stepping; returns how many ran."""
+        ...
+    
+    def step_streamed(self, x: Any, y: Any, vx: Any, vy: Any, n_steps: int, group: int,
+                      mass: Any = None, charge: Any = None, ax: Any = None, ay: Any = None,
+                      chunk: int = 1048576) -> int:
+        """
+        Advance independent particles that do not fit on the GPU by n_steps steps.
+        
+        The particles live in the arrays (numpy.memmap views of files work),
+        cut into chunks of chunk particles; each chunk goes up through a
+        mapped staging buffer, is stepped in one fused dispatch and comes back,
+        with three chunks in flight so the host packs and unpacks while the
+        GPU steps. Every chunk runs the same steps from the same clock, which
+        then advances as step(n_steps) would. The particles run behaviour
+        group group's equation; rand() draws differ per chunk.
+        
+        The scene must hold no objects, and nothing may couple particles
+        (constraints, collisions, p[i], sum_j, aggregates, grid fields,
+        sleeping, emitters, worlds, recording, trails, state registers, the
+        adaptive timestep).
+        
+        Args:
+            x, y, vx, vy: float32 C-contiguous writeable arrays, advanced in place
+            n_steps: Steps every particle advances
+            group: Behaviour group whose equation the particles run
+            mass, charge: One value for all, one per particle, or None (1)
+            ax, ay: Optional float32 arrays of the previous accelerations,
+                carried between calls in place
+            chunk: Particles per chunk (default 1048576)
+        
+        Returns:
+            Steps taken
+        
+        Raises:
+            RuntimeError: If an array is not float32, contiguous and writeable
+                or sizes differ, the group has no equation, the scene holds
+                objects or anything would couple the particles
+        """
+        ...
+    
+    # ========================================================================
+    # OBJECT MANAGEMENT
+    # ========================================================================
+    
+    def add_object(
+        self,
+        x: float = 0.0,
+        y: float = 0.0,
+        vx: float = 0.0,
+        vy: float = 0.0,
+        mass: float = 1.0,
+        charge: float = 0.0,
+        rotation: float = 0.0,
+        angular_velocity: float = 0.0,
+        skin: SkinType = SkinType.CIRCLE,
+        size: float = 0.3,
+        width: float = 0.5,
+        height: float = 0.3,
+        r: float = 1.0,
+        g: float = 1.0,
+        b: float = 1.0,
+        a: float = 1.0,
+        polygon_sides: int = 6
+    ) -> int:
+        """
+        Add a new physics object to the simulation.
+        
+        Args:
+            x, y: Initial position
+            vx, vy: Initial velocity
+            mass: Object mass
+            charge: Electrical charge
+            rotation: Initial rotation angle (radians)
+            angular_velocity: Initial angular velocity (radians/second)
+            skin: Visual appearance type
+            size: Radius for circles/polygons (ignored for rectangles)
+            width: Width for rectangles, diameter for circles/polygons
+            height: Height for rectangles (ignored for circles/polygons)
+            r, g, b, a: Color components (0.0-1.0)
+            polygon_sides: Number of sides for polygons (3-12)
             
         Returns:
-            Current rotation angle in radians
+            Index of the newly created object
+            
+        Note:
+            Collision shape is automatically assigned based on skin type:
+            - CIRCLE → PyCollisionShape.CIRCLE
+            - RECTANGLE → PyCollisionShape.AABB
+            - POLYGON → PyCollisionShape.POLYGON
+            Default collision properties: restitution=0.7, friction=0.3
         """
         ...
     
-    def get_angular_velocity(self, index: int) -> float:
+    def add_objects(
+        self,
+        x: Any,
+        y: Any,
+        vx: Any = None,
+        vy: Any = None,
+        mass: Any = None,
+        charge: Any = None,
+        rotation: Any = None,
+        angular_velocity: Any = None,
+        skin: SkinType = SkinType.CIRCLE,
+        size: Any = None,
+        width: Any = None,
+        height: Any = None,
+        r: Any = None,
+        g: Any = None,
+        b: Any = None,
+        a: Any = None,
+        polygon_sides: int = 6
+    ) -> int:
         """
-        Get current angular velocity of an object.
+        Add many objects at once from NumPy arrays.
+        
+        The length of x is the number of new objects. Every other column
+        takes one value per object, a single value for all of them, or None
+        for the add_object default. All objects go up in one upload, with
+        collision shapes assigned from the skin as in add_object.
         
         Args:
-            index: Object index
+            x, y: Positions (arrays of floats)
+            vx, vy, mass, charge, rotation, angular_velocity, size, width,
+            height, r, g, b, a: Per-object values, see add_object
+            skin: Visual appearance type of every new object
+            polygon_sides: Number of sides for polygons (3-12)
             
         Returns:
-            Current angular velocity in radians/second
+            Index of the first new object; the others follow consecutively
+            
+        Raises:
+            RuntimeError: If column lengths disagree or the object limit is reached
+        """
+        ...
+    
+    def spawn(
+        self,
+        n: int,
+        distribution: str = "uniform_disk",
+        center: Tuple[float, float] = (0.0, 0.0),
+        extent: float = 1.0,
+        velocity: str = "",
+        equation: str = "",
+        derivative_method: str = "symbolic",
+        skin: SkinType = SkinType.CIRCLE,
+        size: float = 0.3,
+        width: float = 0.5,
+        height: float = 0.3,
+        mass: float = 1.0,
+        charge: float = 0.0,
+        r: float = 1.0,
+        g: float = 1.0,
+        b: float = 1.0,
+        a: float = 1.0,
+        polygon_sides: int = 6,
+        columns: int = 0,
+        seed: int = 0
+    ) -> int:
+        """
+        Generate many objects on the GPU, straight into the object buffers.
+        
+        Expressions use the equation syntax: t runs over (0, 1) across the new
+        objects and rand()/randn() draw per object. A position expression
+        reads center as x, y; a velocity expression reads the object's
+        position as x, y. Other objects, $k, s0..s7, agg[], fld[], table()
+        and field() are not available. Only the template crosses the bus, so
+        a million objects take one dispatch per object buffer.
+        
+        Args:
+            n: Objects to add
+            distribution: "uniform_disk" (uniform over the disc of radius
+                extent about center), "gaussian" (normal about center,
+                standard deviation extent), "lattice" (square lattice of
+                spacing extent centred on center, `columns` wide, 0 = as
+                square as n allows), or an "x_expr, y_expr" position expression
+            center: Centre of the distribution (default (0, 0))
+            extent: Radius, standard deviation or spacing (default 1.0)
+            velocity: "vx_expr, vy_expr"; empty = at rest
+            equation: Equation of every new object; empty = the default
+            derivative_method: As for set_equation
+            skin, size, width, height, mass, charge, r, g, b, a, polygon_sides:
+                The same for every object, as for add_object
+            columns: Lattice width
+            seed: Generator seed; the same arguments give the same objects
+            
+        Returns:
+            Index of the first new object; the others follow consecutively
+            
+        Example:
+            >>> sim.spawn(1000000, "uniform_disk", extent=50, velocity="-y*0.1, x*0.1", size=0.02)
+            >>> sim.spawn(5000, "10*t*cos(60*t), 10*t*sin(60*t)")   # Spiral
+        """
+        ...
+    
+    def update_object(
+        self,
+        index: int,
+        x: float, y: float,
+        vx: float, vy: float,
+        mass: float, charge: float,
+        rotation: float, angular_velocity: float,
+        width: float, height: float,
+        r: float, g: float, b: float, a: float
+    ) -> None:
+        """
+        Update properties of an existing object.
+        
+        Args:
+            index: Object index to update
+            x, y: New position
+            vx, vy: New velocity
+            mass: New mass
+            charge: New charge
+            rotation: New rotation angle
+            angular_velocity: New angular velocity
+            width: New width/radius (interpretation depends on skin type)
+            height: New height (for rectangles only)
+            r, g, b, a: New color components
+        """
+        ...
+    
+    # ========================================================================
+    # BATCH OPERATIONS
+    # ========================================================================
+    
+    def batch_get(self, indices: List[int]) -> List[BatchGetData]:
+        """
+        Efficiently fetch multiple objects' states at once.
+        
+        Args:
+            indices: List of object indices to fetch
+            
+        Returns:
+            List of BatchGetData objects containing object states
+            
+        Raises:
+            RuntimeError: If any index is invalid
+        """
+        ...
+    
+    def batch_update(self, updates: List[BatchUpdateData]) -> None:
+        """
+        Efficiently update multiple objects at once.
+        
+        Args:
+            updates: List of BatchUpdateData objects with update information
+            
+        Raises:
+            RuntimeError: If any object index is invalid
+        """
+        ...
+    
+    def reduce(self, expression: str, op: str = "sum") -> float:
+        """
+        Reduce a per-object expression to one value on the GPU.
+        
+        Uses the equation syntax and variables; each distinct expression is
+        compiled once and only the result is read back, e.g. total kinetic
+        energy with reduce("0.5*mass*(vx^2 + vy^2)") or the left edge of
+        the bounding box with reduce("x", "min").
+        
+        Args:
+            expression: Per-object expression (no sum_j/nsum/ncount/nmean
+                or long-range accelerations)
+            op: 'sum' (default), 'min', 'max' or 'mean'
+            
+        Returns:
+            The reduced value
+            
+        Raises:
+            RuntimeError: On an unknown op, an expression that does not
+                parse or compile, or when there are no objects
+        """
+        ...
+    
+    @typing.overload
+    def histogram(self, expression: str, bins: int = 64, range: Tuple[float, float] = ...) -> Any:
+        """
+        Histogram of a per-object expression, binned on the GPU.
+        
+        The expression is compiled as for reduce(); each work group counts
+        its objects with shared-memory atomics, so only the bin counts are
+        read back. Bins follow numpy.histogram: half-open, the last one
+        closed, values outside the range not counted.
+        
+        Args:
+            expression: Per-object expression
+            bins: Number of bins (default: 64)
+            range: (min, max) of the bins (default: the expression's min and
+                max over the objects)
+            
+        Returns:
+            numpy.ndarray of uint32 counts, shape (bins,)
+            
+        Example:
+            >>> counts = sim.histogram("sqrt(vx^2 + vy^2)", 50, (0.0, 10.0))
+        """
+        ...
+    
+    @typing.overload
+    def histogram(self, expressions: Tuple[str, str], bins: Union[int, Tuple[int, int]] = 64,
+                  range: Tuple[Tuple[float, float], Tuple[float, float]] = ...) -> Any:
+        """
+        2D histogram of two per-object expressions, binned on the GPU.
+        
+        Args:
+            expressions: Expressions along x and y
+            bins: Bins along both, or (nx, ny) (default: 64)
+            range: ((x_min, x_max), (y_min, y_max)) (default: each
+                expression's min and max over the objects)
+            
+        Returns:
+            numpy.ndarray of uint32 counts, shape (nx, ny) as numpy.histogram2d
+            
+        Raises:
+            RuntimeError: If bins or range do not describe two axes
+            
+        Example:
+            >>> density = sim.histogram(("x", "y"), (128, 128), ((-10, 10), (-10, 10)))
+        """
+        ...
+    
+    def set_group(self, name: str, indices: List[int]) -> None:
+        """
+        Make the listed objects the members of a named group.
+        
+        Groups are tag sets: an object can be in several of them, and setting
+        a group again replaces its members. At most 32 groups. Removed objects
+        leave their groups; objects the GPU spawns join none.
+        
+        Args:
+            name: Group name
+            indices: Member objects
+        """
+        ...
+    
+    def get_group(self, name: str) -> List[int]:
+        """Indices of the objects in a group (empty for an unknown group)."""
+        ...
+    
+    def set_aggregate(self, name: str, expression: str, op: str = "mean", group: str = "") -> None:
+        """
+        Aggregate a per-object expression over a group once per step.
+        
+        Every aggregate is reduced on the GPU in one pass from the state at
+        the start of each step, before the equations run, which read it as
+        agg[name]. The expression follows the rules of reduce(). While
+        aggregates exist steps are not fused and do not run on the CPU
+        backend. An empty group reads 0.
+        
+        Args:
+            name: Name equations read as agg[name] (at most 16 names)
+            expression: Per-object expression
+            op: 'mean' (default), 'sum', 'min' or 'max'
+            group: Group to reduce over; '' (default) = every object
+            
+        Example:
+            >>> sim.set_group("flock", birds)
+            >>> sim.set_aggregate("flock_cx", "x", "mean", "flock")
+            >>> sim.set_equation(0, "ax = 0.5*(agg[flock_cx] - x)")
+        """
+        ...
+    
+    def remove_aggregate(self, name: str) -> None:
+        """Stop computing an aggregate; agg[name] reads 0 from then on."""
+        ...
+    
+    def get_aggregate(self, name: str) -> float:
+        """Value of an aggregate at the last step (waits for the GPU)."""
+        ...
+    
+    def evaluate(self, expression: str,
+                 x: Any = None, y: Any = None, vx: Any = None, vy: Any = None,
+                 ax: Any = None, ay: Any = None, theta: Any = None, omega: Any = None,
+                 r: Any = None, g: Any = None, b: Any = None, a: Any = None,
+                 mass: Any = None, charge: Any = None) -> Any:
+        """
+        Evaluate an expression on the GPU at arbitrary points.
+        
+        Uses the equation syntax, as for reduce(), over the points the inputs
+        describe instead of the objects: each point is a probe with that
+        state, and p[i].property still reads the real objects, e.g. a
+        potential on a dense grid with
+        evaluate("-1/sqrt((x - p[0].x)^2 + (y - p[0].y)^2 + 0.01)", x=X, y=Y).
+        Each distinct expression is compiled once; values come back as
+        computed, inf and NaN included.
+        
+        Args:
+            expression: Expression of the point's state
+            x, y, vx, vy, ax, ay, theta, omega, r, g, b, a, mass, charge:
+                One value per point, a single value for all, or None for the
+                default (1 for r, g, b, a, mass and charge, else 0). Arrays of
+                more than one value must have the same size.
+            
+        Returns:
+            numpy.ndarray float32 in the shape of the first array input (0-d
+            when every input is a single value)
+            
+        Raises:
+            RuntimeError: If the inputs differ in size, or the expression does
+                not parse or compile, or uses per-step inputs (sum_j, nsum,
+                long-range accelerations, rand(), ...)
+        """
+        ...
+    
+    def fetch_async(self, fields: List[str] = []) -> ReadbackFuture:
+        """
+        Start a non-blocking copy of the current object state.
+        
+        The live objects are copied to a staging buffer on the GPU behind a
+        fence and the call returns at once, so analysis of step N can
+        overlap the simulation of step N+1.
+        
+        Args:
+            fields: Any of 'x', 'y', 'vx', 'vy', 'mass', 'charge',
+                'rotation', 'angular_velocity', 'r', 'g', 'b', 'a'
+                (default: all of them)
+            
+        Returns:
+            A future; poll with ready(), collect with result()
+            
+        Raises:
+            RuntimeError: On an unknown field or with 64 readbacks in flight
+        """
+        ...
+    
+    def sync(self) -> int:
+        """
+        Copy the current object state into the buffer state_view() aliases.
+        
+        Arrays from state_view() change only here: they show the state of
+        the last sync(), which is overwritten in place. Once the simulation
+        has grown past the buffer, sync() starts a new one and older arrays
+        keep their last contents.
+        
+        Returns:
+            Number of objects copied
+        """
+        ...
+    
+    def state_view(self) -> Any:
+        """
+        Read-only NumPy view of the objects copied by the last sync().
+        
+        A structured array aliasing the synced records, without copies or
+        per-object Python objects. Fields: position (2,), velocity (2,),
+        mass, charge, skin, collision_shape, visual_data (4,) with rotation
+        and angular velocity at [:, 2] and [:, 3], collision_data (4,),
+        color (4,), equation_id. Its length is the object count of that
+        sync(), and it stays valid after the simulation is cleaned up.
+        Requires NumPy.
+        
+        Returns:
+            numpy.ndarray with one record per object
+            
+        Raises:
+            RuntimeError: If sync() was never called
+        """
+        ...
+    
+    def record(
+        self,
+        fields: List[str] = [],
+        every_n_steps: int = 1,
+        capacity: int = 1024,
+        object_indices: List[int] = [],
+        output_dir: str = "",
+        quantize_box: List[float] = []
+    ) -> None:
+        """
+        Record a trajectory into a GPU ring buffer while the simulation steps.
+        
+        Every every_n_steps steps the fields of the recorded objects are
+        appended on the GPU, with no readback; when the ring is full the
+        oldest frames are overwritten. Replaces any recording in progress.
+        
+        Args:
+            fields: As for fetch_async (default: all of them)
+            every_n_steps: Steps between frames (fused substeps record only
+                their final state)
+            capacity: Frames the ring holds
+            object_indices: Objects to record (default: all current objects);
+                frames are skipped while any of them has been removed
+            output_dir: Stream every frame to .npy files in this directory
+                from a background thread instead (<field>.npy of shape
+                (frames, objects), step.npy, time.npy, objects.npy);
+                stop_recording() finishes the files
+            quantize_box: (min_x, min_y, max_x, max_y) to pack positions into
+                16-bit fractions of this box and velocities into half floats
+                on the GPU; download dequantizes them (positions outside the
+                box clamp to its edges)
+        
+        Raises:
+            RuntimeError: If an argument is invalid or the buffer cannot be
+                allocated
+        """
+        ...
+    
+    def download_recording(self) -> Dict[str, Any]:
+        """
+        Collect the frames recorded since record() or the last download.
+        
+        Returns:
+            Dict with 'step' and 'time' per frame, 'objects' (the recorded
+            indices), 'dropped' (frames lost to the ring wrapping) and a
+            (frames, objects) numpy array per recorded field; a quantized
+            recording adds 'quantization' ('box', 'position_bits', 'velocity')
+        
+        Raises:
+            RuntimeError: If nothing is being recorded, or it streams to disk
+        """
+        ...
+    
+    def stop_recording(self) -> None:
+        """
+        Stop recording and free the ring buffer. Frames not downloaded are
+        lost, unless the recording streams to disk: then they are written
+        and the files finished.
+        """
+        ...
+    
+    def start_stream_server(
+        self,
+        port: int = 0,
+        rate_hz: float = 30.0,
+        host: str = "0.0.0.0",
+        quantize_box: List[float] = []
+    ) -> int:
+        """
+        Serve the recording to remote viewers over plain TCP.
+        
+        rate_hz times a second update() reads back only the newest recorded
+        frame and a background thread sends it to every viewer: positions as
+        16-bit fractions of the box, other fields as half floats, and only
+        zigzag varint differences to a viewer that has the previous frame.
+        download_recording() is unavailable while serving.
+        
+        Args:
+            port: TCP port, 0 picks a free one
+            rate_hz: Frames sent per second at most
+            host: IPv4 address to listen on
+            quantize_box: (min_x, min_y, max_x, max_y) for the positions
+                (default: record()'s box)
+        
+        Returns:
+            The port listened on
+        
+        Raises:
+            RuntimeError: If nothing is recorded in memory, positions have no
+                box, or the socket cannot be bound
+        """
+        ...
+    
+    def as_dlpack(self, field: str) -> Any:
+        """
+        Zero-copy CUDA view of one object field, as a DLPack capsule.
+        
+        The object buffer is mapped into CUDA with GL interop and the float32
+        tensor strides over the object records in place; writes through it
+        (e.g. actions into "velocity") are what the next step reads. Valid
+        until the next call into the simulation or release_dlpack().
+        
+        Args:
+            field: "position"/"velocity" (objects, 2), "color" (objects, 4),
+                or x, y, vx, vy, mass, charge, rotation, angular_velocity,
+                r, g, b, a (objects,)
+        
+        Returns:
+            A "dltensor" PyCapsule, e.g. for torch.utils.dlpack.from_dlpack
+        
+        Raises:
+            RuntimeError: If the field is unknown or CUDA interop is
+                unavailable
+        """
+        ...
+    
+    def release_dlpack(self) -> None:
+        """Hand the buffer mapped by as_dlpack() back to GL; its tensors become invalid."""
+        ...
+    
+    def stop_stream_server(self) -> None:
+        """Disconnect the viewers and stop serving; the recording goes on."""
+        ...
+    
+    def get_stream_server_stats(self) -> Dict[str, float]:
+        """
+        {"port", "clients", "frames", "bytes"} of the stream server, frames
+        and bytes since start_stream_server(); all 0 while not serving.
+        """
+        ...
+    
+    def start_metrics_server(self, port: int = 9464, interval: float = 1.0, host: str = "127.0.0.1") -> int:
+        """
+        Serve metrics for Prometheus over HTTP (GET /metrics).
+        
+        A background thread serves the page; every interval seconds the steps
+        render a new one: steps and steps per second, simulated time, lag,
+        per-pass GPU and host timings, work counters per step, object and
+        equation counts, buffer memory and readback bandwidth.
+        stellar_metrics_age_seconds tells how old the page is.
+        
+        Args:
+            port: TCP port, 0 picks a free one
+            interval: Seconds between pages
+            host: IPv4 address to listen on
+        
+        Returns:
+            The port listened on
+        
+        Raises:
+            RuntimeError: If the socket cannot be bound
+        """
+        ...
+    
+    def stop_metrics_server(self) -> None:
+        """Stop serving metrics."""
+        ...
+    
+    def get_metrics_scrapes(self) -> int:
+        """Pages the metrics server answered since start_metrics_server(), 0 while not serving."""
+        ...
+    
+    def start_shared_frames(self, name: str, slots: int = 8) -> None:
+        """
+        Publish the recording into shared memory for other processes.
+        
+        Every recorded frame update() reads back is written into a ring of
+        slots frames in a named POSIX / Windows shared-memory segment, each
+        slot guarded by a seqlock. Other processes open it with
+        SharedFrames(name) and read frames as NumPy views, with no copy, no
+        pickling and no GL context. Sharing ends with stop_shared_frames(),
+        stop_recording() or a new record(); download_recording() is not
+        available meanwhile.
+        
+        Args:
+            name: Segment name; it must not exist yet
+            slots: Frames the ring holds (default 8)
+        
+        Example:
+            >>> sim.record(["x", "y", "vx", "vy"], capacity=16)
+            >>> sim.start_shared_frames("sim_frames", slots=32)
+            >>> # in another process: SharedFrames("sim_frames").read()
+        """
+        ...
+    
+    def stop_shared_frames(self) -> None:
+        """Stop publishing and remove the segment's name; open readers keep their mappings."""
+        ...
+    
+    def get_shared_frame_count(self) -> int:
+        """Frames published since start_shared_frames()."""
+        ...
+    
+    def start_domain_decomposition(self, halo: float, x_range: Tuple[float, float] = (0.0, 0.0)) -> None:
+        """
+        Split the world across MPI ranks, one GPU each.
+        
+        Run the same script on every rank (mpirun -n 4 python run.py): every
+        rank adds the same equations in the same order and may add any
+        objects. x_range is cut into one slab per rank; a rank owns and
+        integrates the objects whose x lies in its slab. After every step the
+        objects that left it move to their new owner, and copies of the
+        objects within halo of a slab edge are sent to the neighbour as
+        ghosts, which collisions, p[i], sum_j() and nsum/ncount/nmean see but
+        only the owner moves. Choose halo as the largest interaction radius.
+        
+        Steps are not fused meanwhile, and object indices change with every
+        step like after remove_objects(). Only the object rows travel;
+        constraints, springs, parameters, state registers and groups stay on
+        the rank that set them. Needs a module built with STELLAR_MPI.
+        
+        Args:
+            halo: Ghost width on each side of a slab edge, under a slab width
+            x_range: (min_x, max_x); default the world box, periodic when the
+                world bounds are
+        
+        Example:
+            >>> sim.set_world_bounds("reflect", (0.0, 0.0, 1000.0, 200.0))
+            >>> sim.start_domain_decomposition(halo=5.0)
+            >>> sim.step(1000)
+            >>> sim.get_domain_stats()["local_objects"]
+        """
+        ...
+    
+    def stop_domain_decomposition(self) -> None:
+        """Drop the ghosts and stop exchanging; each rank keeps the objects it owns."""
+        ...
+    
+    def get_domain_stats(self) -> Dict[str, float]:
+        """
+        This rank's part of the split.
+        
+        Returns:
+            active, rank, ranks, slab_min, slab_max, local_objects,
+            ghost_objects, migrated_in / migrated_out at the last exchange,
+            and exchanges
+        """
+        ...
+    
+    def advance_event_driven(self, duration: float, collapse_time: float = 1e-6,
+                             max_events: int = 0) -> Dict[str, float]:
+        """
+        Advance hard disks from collision to collision instead of by steps.
+        
+        For dilute gases, where fixed steps spend nearly all their work
+        between collisions. Collision-enabled circles fly in straight lines
+        and only the events are computed: contacts predicted within a grid
+        one diameter wide and world-box walls (reflected with the global
+        restitution, or wrapped when periodic), processed in time order from
+        a priority queue. Each ensemble world runs its own queue on the CPU
+        thread pool. Equations, constraints and springs do not act during the
+        call; the state is read back once and uploaded once.
+        
+        Args:
+            duration: Simulated time to advance
+            collapse_time: Collisions of an object closer together than this
+                are elastic, which keeps restitution < 1 from collapsing into
+                endless collisions
+            max_events: Events per world before the rest of the interval is
+                free flight (0 = no limit)
+        
+        Returns:
+            collisions, wall_hits, cell_crossings, stale_events (queued
+            events a collision had invalidated), worlds, truncated (1 when
+            max_events was reached)
+        
+        Example:
+            >>> stats = sim.advance_event_driven(10.0)
+            >>> stats["collisions"]
+        """
+        ...
+    
+    def remove_object(self, index: int) -> None:
+        """
+        Remove an object from the simulation.
+        
+        Args:
+            index: Index of object to remove
+            
+        Raises:
+            RuntimeError: If index is invalid
+        """
+        ...
+    
+    def remove_objects(self, indices: List[int]) -> None:
+        """
+        Remove several objects in one pass.
+        
+        Each removal moves the last object into the freed slot, as
+        remove_object does; all indices refer to the state before the call.
+        
+        Args:
+            indices: Indices of the objects to remove
+            
+        Raises:
+            RuntimeError: If any index is invalid
+        """
+        ...
+    
+    def object_count(self) -> int:
+        """
+        Get current number of objects in simulation.
+        
+        Returns:
+            Number of active objects
+        """
+        ...
+    
+    def object_handle(self, index: int) -> int:
+        """
+        Stable handle of an object.
+        
+        p[i] in an equation reads the object with handle i. An object keeps
+        its handle while removals move it to other indices, and p[i] of a
+        removed object reads 0 rather than the object moved into its place.
+        Handles equal indices until the first removal, and start over from
+        0 once every object has been removed.
+        
+        Args:
+            index: Index of the object
+        
+        Returns:
+            Handle of the object
+        
+        Raises:
+            RuntimeError: If index is invalid or the object was spawned on the GPU
+        """
+        ...
+    
+    def object_index(self, handle: int) -> int:
+        """
+        Current index of the object with a handle.
+        
+        Args:
+            handle: Handle from object_handle()
+        
+        Returns:
+            Index of the object, or -1 if it has been removed
+        """
+        ...
+    
+    def query_radius(self, points: List[Tuple[float, float]], radius: float) -> List[List[int]]:
+        """
+        Find the objects within a radius of each of a list of points.
+        
+        Every point is answered by one GPU pass over a neighbour grid, so thousands of
+        queries cost a single readback of the hits instead of a fetch of every object.
+        
+        Args:
+            points: Query centres (x, y)
+            radius: Distance from a centre an object's centre may be at
+        
+        Returns:
+            Object IDs in ascending order, one list per point
+        
+        Raises:
+            RuntimeError: If radius is negative
+        """
+        ...
+    
+    def query_aabb(self, boxes: List[Tuple[float, float, float, float]]) -> List[List[int]]:
+        """
+        Find the objects inside each of a list of axis-aligned boxes.
+        
+        Args:
+            boxes: (min_x, min_y, max_x, max_y) per box, edges included
+        
+        Returns:
+            Object IDs whose centre is in the box, ascending, one list per box
+        
+        Raises:
+            RuntimeError: If a box has a minimum above its maximum
+        """
+        ...
+    
+    def raycast(self, origins: List[Tuple[float, float]], dirs: List[Tuple[float, float]],
+                max_dist: float) -> List[Tuple[int, float, float, float]]:
+        """
+        Cast rays against the objects' collision shapes and report the first hit of each.
+        
+        Every ray is answered by one GPU pass over a BVH of the collision shapes, with the
+        same circle, AABB and polygon geometry the collision pass uses. Objects with
+        collisions disabled are transparent, and a shape a ray starts inside is not hit,
+        so a ray cast from an object's own position sees past that object.
+        
+        Args:
+            origins: Ray starts (x, y)
+            dirs: Ray directions, one per origin (any length; a zero direction hits nothing)
+            max_dist: Furthest distance along a ray a hit is reported at
+        
+        Returns:
+            (object ID, distance, normal x, normal y) per ray; (-1, max_dist, 0, 0) when nothing is hit
+        
+        Raises:
+            RuntimeError: If origins and dirs differ in length or max_dist is negative or infinite
+        """
+        ...
+    
+    def get_object(self, index: int) -> ObjectState:
+        """
+        Get complete state of a specific object.
+        
+        Args:
+            index: Object index
+            
+        Returns:
+            ObjectState containing all object properties
+            
+        Raises:
+            RuntimeError: If index is invalid
+        """
+        ...
+    
+    # ========================================================================
+    # CONVENIENCE METHODS
+    # ========================================================================
+    
+    def set_rotation(self, index: int, rotation: float) -> None:
+        """
+        Set rotation angle of an object.
+        
+        Args:
+            index: Object index
+            rotation: New rotation angle in radians
+        """
+        ...
+    
+    def set_angular_velocity(self, index: int, angular_velocity: float) -> None:
+        """
+        Set angular velocity of an object.
+        
+        Args:
+            index: Object index
+            angular_velocity: New angular velocity in radians/second
+        """
+        ...
+    
+    def set_dimensions(self, index: int, width: float, height: float) -> None:
+        """
+        Set dimensions of an object.
+        
+        Args:
+            index: Object index
+            width: New width (radius for circles/polygons, width for rectangles)
+            height: New height (for rectangles only, ignored for circles/polygons)
+        """
+        ...
+    
+    def set_radius(self, index: int, radius: float) -> None:
+        """
+        Set radius of an object.
+        
+        Args:
+            index: Object index
+            radius: New radius (for circles/polygons, converts rectangles to squares)
+        """
+        ...
+    
+    def get_rotation(self, index: int) -> float:
+        """
+        Get current rotation angle of an object.
+        
+        Args:
+            index: Object index
+            
+        Returns:
+            Current rotation angle in radians
+        """
+        ...
+    
+    def get_angular_velocity(self, index: int) -> float:
+        """
+        Get current angular velocity of an object.
+        
+        Args:
+            index: Object index
+            
+        Returns:
+            Current angular velocity in radians/second
+        """
+        ...
+    
+    def set_parameters(self, index: int, values: List[float], first: int = 0) -> None:
+        """
+        Set per-object equation parameters read as $0..$7.
+        
+        Objects whose equations differ only in constants can share one
+        compiled equation by reading those constants from parameter slots.
+        
+        Args:
+            index: Object index
+            values: Values for slots first, first+1, ...
+            first: First slot to write (values must fit in the 8 slots)
+        """
+        ...
+    
+    def get_parameters(self, index: int) -> List[float]:
+        """
+        Get all 8 equation parameters of an object.
+        
+        Args:
+            index: Object index
+            
+        Returns:
+            Values of $0..$7
+        """
+        ...
+    
+    def set_state(self, index: int, values: List[float], first: int = 0) -> None:
+        """
+        Set per-object state registers read as s0..s7.
+        
+        Equations update the registers with "sK = expr" statements once per
+        step, on the GPU, so values such as integrals or timers persist
+        without a host round trip. New objects start with every register at 0.
+        
+        Args:
+            index: Object index
+            values: Values for registers first, first+1, ...
+            first: First register to write (values must fit in the 8 registers)
+        """
+        ...
+    
+    def get_state(self, index: int) -> List[float]:
+        """
+        Get all 8 state registers of an object; waits for the GPU.
+        
+        Args:
+            index: Object index
+            
+        Returns:
+            Values of s0..s7
+        """
+        ...
+    
+    def set_sensitivities(self, parameters: List[str]) -> None:
+        """
+        Carry forward sensitivities of every object's state with respect to parameters.
+        
+        Each step also integrates d(x, y, vx, vy)/d(parameter) per object by
+        evaluating the ax/ay equations with dual numbers along the tangent,
+        so one run gives the gradients finite differences need two runs per
+        parameter for. Other objects (p[i], sum_j, long-range fields),
+        collisions and constraints count as independent of the parameters.
+        Every tangent starts at 0.
+        
+        Args:
+            parameters: Up to 4 of '$0'..'$7', 'k', 'damping', 'gravity',
+                'coupling', 'freq', 'amp', 'mass', 'charge'; [] turns them off
+        """
+        ...
+    
+    def get_sensitivity_parameters(self) -> List[str]:
+        """Parameters set by set_sensitivities, in the order of get_sensitivities."""
+        ...
+    
+    def reset_sensitivities(self) -> None:
+        """Zero every tangent, e.g. after moving the objects back to their initial state."""
+        ...
+    
+    def get_sensitivities(self) -> Any:
+        """
+        Get the forward sensitivities of every object; waits for the GPU.
+        
+        Returns:
+            numpy.ndarray float32 of shape (objects, parameters, 4):
+            (dx, dy, dvx, dvy) / d(parameter), in set_sensitivities order
+        """
+        ...
+    
+    # ========================================================================
+    # COLLISION SYSTEM
+    # ========================================================================
+    
+    def set_collision_enabled(self, index: int, enabled: bool) -> None:
+        """
+        Enable or disable collisions for an object.
+        
+        Args:
+            index: Object index
+            enabled: True to enable collisions, False to disable
+            
+        Raises:
+            RuntimeError: If index is invalid
+        """
+        ...
+    
+    def set_collision_shape(self, index: int, shape: PyCollisionShape) -> None:
+        """
+        Set collision shape for an object.
+        
+        Args:
+            index: Object index
+            shape: Collision shape type (NONE, CIRCLE, AABB, or POLYGON)
+            
+        Raises:
+            RuntimeError: If index is invalid
+        """
+        ...
+    
+    def set_collision_properties(self, index: int, restitution: float, friction: float) -> None:
+        """
+        Set collision material properties.
+        
+        Args:
+            index: Object index
+            restitution: Bounciness coefficient (0.0-1.0)
+            friction: Friction coefficient (0.0-1.0)
+            
+        Raises:
+            RuntimeError: If index is invalid or parameters are out of range
+        """
+        ...
+    
+    def get_collision_config(self, index: int) -> CollisionConfig:
+        """
+        Get current collision configuration for an object.
+        
+        Args:
+            index: Object index
+            
+        Returns:
+            CollisionConfig with current collision settings
+            
+        Raises:
+            RuntimeError: If index is invalid
+        """
+        ...
+    
+    def enable_collision_between(self, obj1: int, obj2: int, enable: bool) -> None:
+        """
+        Enable or disable collisions between two specific objects.
+        
+        Args:
+            obj1: First object index
+            obj2: Second object index
+            enable: True to enable collisions between them, False to disable
+            
+        Raises:
+            RuntimeError: If either index is invalid
+        """
+        ...
+    
+    def set_collision_filter(self, index: int, category: int, mask: int) -> None:
+        """
+        Set collision category and mask bits for an object.
+        
+        Two objects collide only if each one's category overlaps the other's mask.
+        
+        Args:
+            index: Object index
+            category: Category bits the object belongs to (default 0x1)
+            mask: Categories the object collides with (default 0xFFFFFFFF)
+            
+        Raises:
+            RuntimeError: If index is invalid
+        """
+        ...
+    
+    def set_continuous_collision(self, index: int, enabled: bool = True) -> None:
+        """
+        Test an object's collisions over the whole step, not just at its end.
+        
+        Pairs the end-of-step test finds apart are swept as a ray against the
+        shapes' Minkowski sum (polygons as bounding circles); at a hit the object
+        stops where it touched for the rest of the step. The broadphase search
+        covers the path, so fast bodies no longer tunnel through thin shapes and
+        the timestep can be raised. The other object feels the hit when its own
+        search finds it: always when it is continuous too or the contact solver
+        is on. Off by default.
+        
+        Args:
+            index: Object index
+            enabled: True for swept tests (default), False for end-of-step tests only
+            
+        Raises:
+            RuntimeError: If index is invalid
+        """
+        ...
+    
+    def batch_set_collision_enabled(self, indices: List[int], enabled: bool) -> None:
+        """Enable or disable collisions for many objects with one upload."""
+        ...
+    
+    def batch_set_collision_shape(self, indices: List[int], shape: CollisionShape) -> None:
+        """Set the collision shape of many objects with one upload."""
+        ...
+    
+    def batch_set_collision_properties(self, indices: List[int], restitution: float = 0.7, friction: float = 0.3) -> None:
+        """Set restitution and friction (0.0-1.0) of many objects with one upload."""
+        ...
+    
+    def batch_set_collision_filter(self, indices: List[int], category: int, mask: int) -> None:
+        """Set collision category and mask bits of many objects with one upload."""
+        ...
+    
+    def batch_set_continuous_collision(self, indices: List[int], enabled: bool = True) -> None:
+        """Turn swept collision tests on or off for many objects with one upload."""
+        ...
+    
+    def is_collision_enabled(self, index: int) -> bool:
+        """
+        Check if collisions are enabled for an object.
+        
+        Args:
+            index: Object index
+            
+        Returns:
+            True if collisions are enabled, False otherwise
+            
+        Raises:
+            RuntimeError: If index is invalid
+        """
+        ...
+
+    def set_object_static(self, index: int, is_static: bool = True) -> None:
+        """
+        Make an object a static collider: it is never integrated and never moves in a
+        collision, and dynamic objects bounce off it as if it had infinite mass. Static
+        objects are kept in a grid of their own that is only rebuilt when one of them is
+        added, removed, moved or resized, so walls and terrain cost almost nothing per step.
+        They stay ordinary objects otherwise (p[i], rendering, picking, set_object).
+        While emitters are active every object is dynamic. The static grid does not wrap
+        across a periodic boundary.
+
+        Args:
+            index: Object index
+            is_static: True for a static collider, False for a dynamic object
+
+        Raises:
+            RuntimeError: If index is invalid
+        """
+        ...
+
+    def is_object_static(self, index: int) -> bool:
+        """
+        Check if an object is a static collider.
+
+        Args:
+            index: Object index
+
+        Returns:
+            True if the object is static
+
+        Raises:
+            RuntimeError: If index is invalid
+        """
+        ...
+
+    def get_static_object_count(self) -> int:
+        """Number of static colliders (see set_object_static)"""
+        ...
+
+    def set_object_kinematic(self, index: int, table_x: int, table_y: int, period: float = 0.0) -> None:
+        """
+        Make an object kinematic: instead of integrating its equation, every step puts it
+        where the tables say at the simulation time, x = table(table_x, t) and
+        y = table(table_y, t), with the velocity of that motion. Constraints and
+        collisions never move it, and the objects it hits bounce off it as if it had
+        infinite mass and its velocity (conveyors, moving platforms). A kinematic object
+        is no longer static. While any object is kinematic, objects do not sleep.
+
+        Args:
+            index: Object index
+            table_x: Table id of x (see set_table), -1 to keep x
+            table_y: Table id of y, -1 to keep y
+            period: Time the path repeats after, 0 = it does not
+
+        Raises:
+            RuntimeError: If index or a table id is invalid
+        """
+        ...
+
+    def set_object_keyframes(self, index: int, keyframes: List[Tuple[float, float, float]],
+                             table_x: int, table_y: int, loop: bool = False) -> None:
+        """
+        Make an object kinematic along keyframes, linear between them: the track is
+        resampled into tables table_x and table_y (replacing them), then used as in
+        set_object_kinematic. Before the first key and after the last the object holds.
+
+        Args:
+            index: Object index
+            keyframes: (time, x, y) keys, times increasing
+            table_x: Table id that receives x
+            table_y: Table id that receives y
+            loop: Repeat the track every time of the last key
+
+        Raises:
+            RuntimeError: If index is invalid or the keyframes or table ids are
+        """
+        ...
+
+    def clear_object_kinematic(self, index: int) -> None:
+        """Return a kinematic object to its equation, from where its path left it"""
+        ...
+
+    def is_object_kinematic(self, index: int) -> bool:
+        """
+        Check if an object is kinematic.
+
+        Args:
+            index: Object index
+
+        Returns:
+            True if the object follows a path
+
+        Raises:
+            RuntimeError: If index is invalid
+        """
+        ...
+
+    def get_kinematic_object_count(self) -> int:
+        """Number of kinematic objects (see set_object_kinematic)"""
+        ...
+
+    def set_sdf_collider(self, expression: str) -> None:
+        """
+        Set a static environment by its signed distance: expression is the distance
+        from (x, y) to the surface, negative inside the solid, and may use t. Every
+        collidable object that is neither static nor kinematic is pushed out along the
+        gradient after the narrowphase, with no broadphase entry. With a grid as well
+        (set_sdf_grid), the environment is the union of both.
+
+        Args:
+            expression: Signed distance of x, y
+
+        Raises:
+            RuntimeError: If the expression does not parse or compile, or uses
+                per-step inputs (sum_j, rand(), s0..s7, agg[], ...)
+
+        Example:
+            >>> sim.set_sdf_collider("10 - sqrt(x^2 + y^2)")  # Circular arena
+        """
+        ...
+
+    def clear_sdf_collider(self) -> None:
+        """Remove the SDF expression; a grid set with set_sdf_grid stays"""
+        ...
+
+    def set_sdf_grid(self, distances: List[List[float]], box: Tuple[float, float, float, float]) -> None:
+        """
+        Set a sampled signed distance, collided with as set_sdf_collider describes.
+        Rows start at the bottom of the box and span it edge to edge; outside the box
+        the distance grows with the distance to it.
+
+        Args:
+            distances: Rows of signed distances from min_y, at least 2 x 2
+            box: (min_x, min_y, width, height)
+
+        Raises:
+            RuntimeError: If the rows or the box are invalid, or a side exceeds 4096
+        """
+        ...
+
+    def clear_sdf_grid(self) -> None:
+        """Remove the SDF grid; an expression set with set_sdf_collider stays"""
+        ...
+
+    def set_sdf_surface(self, restitution: float = 0.5, friction: float = 0.3) -> None:
+        """
+        Set the surface of the SDF environment, combined with each object's as two
+        objects would be: the smaller restitution, the geometric mean of the frictions.
+
+        Raises:
+            RuntimeError: If restitution is outside [0, 1] or friction < 0
+        """
+        ...
+    
+    # ========================================================================
+    # NEW: COLLISION PARAMETERS
+    # ========================================================================
+    
+    def set_collision_parameters(self, enable_warm_start: bool, max_contact_iterations: int) -> None:
+        """
+        Set global collision solver parameters.
+        
+        The narrowphase emits every touching pair once and the contact
+        solver runs max_contact_iterations impulse iterations over them.
+        With warm starting, each pair starts from the impulses it ended the
+        previous step with.
+        
+        Args:
+            enable_warm_start: Enable warm starting for contact constraints (improves stability)
+            max_contact_iterations: Maximum number of contact resolution iterations (1-20)
+            
+        Raises:
+            RuntimeError: If parameters are out of valid range
+        """
+        ...
+    
+    def get_collision_parameters(self) -> Tuple[bool, int]:
+        """
+        Get current global collision solver parameters.
+        
+        Returns:
+            Tuple of (enable_warm_start, max_contact_iterations)
+        """
+        ...
+    
+    def get_contact_count(self) -> int:
+        """
+        Number of contact pairs the last step solved (-1 until the contact
+        solver has run).
+        
+        Reads the count back from the GPU, so call it for profiling
+        rather than every frame.
+        """
+        ...
+    
+    def set_broadphase_mode(self, mode: BroadphaseMode) -> None:
+        """
+        Select the collision broadphase.
+        
+        Args:
+            mode: ALL_PAIRS, UNIFORM_GRID (default) or LBVH
+        """
+        ...
+    
+    def get_broadphase_mode(self) -> BroadphaseMode:
+        """
+        Get the selected collision broadphase.
+        
+        Returns:
+            Current broadphase mode
+        """
+        ...
+    
+    def set_narrowphase_buckets(self, enabled: bool) -> None:
+        """
+        Split the narrowphase by collision shape in scenes that mix shapes.
+        
+        Each shape runs as its own dispatch, built for that shape's tests,
+        so circles do not wait on the polygon SAT of their neighbours.
+        Steps with sleeping objects or GPU-spawned objects use one dispatch.
+        
+        Args:
+            enabled: True to split (default), False for one dispatch
+        """
+        ...
+    
+    def get_narrowphase_buckets(self) -> bool:
+        """
+        Check whether the narrowphase is split by collision shape.
+        
+        Returns:
+            True if mixed scenes run one dispatch per shape
+        """
+        ...
+    
+    def set_neighbour_skin(self, skin: float) -> None:
+        """
+        Reuse the collision broadphase across steps within a skin margin.
+        
+        The grid or LBVH and a per-object candidate list are built with
+        the margin added, then reused until some collidable object has
+        moved (or grown) by more than half of it. A GPU pass decides each
+        step, so substeps that barely move objects skip the rebuild. The
+        all-pairs mode is unaffected.
+        
+        Args:
+            skin: Margin in world units, 0 to rebuild every step (default)
+        """
+        ...
+    
+    def get_neighbour_skin(self) -> float:
+        """
+        Get the skin margin the collision broadphase is reused within.
+        
+        Returns:
+            Margin in world units, 0 if rebuilt every step
+        """
+        ...
+    
+    def set_small_world_objects(self, objects: int) -> None:
+        """
+        Set the largest ensemble world that collides without a broadphase.
+        
+        A world's objects are contiguous, so a small world fills a few lanes
+        of a shared workgroup and its objects test each other directly. The
+        grid or LBVH is built only when some world is larger, and those
+        worlds keep using it.
+        
+        Args:
+            objects: Objects per world, 0 to use the broadphase for all (default 64)
+        """
+        ...
+    
+    def get_small_world_objects(self) -> int:
+        """Get the largest ensemble world, in objects, that collides without a broadphase."""
+        ...
+    
+    def get_broadphase_rebuilds(self) -> int:
+        """
+        Count the broadphase rebuilds the skin check has run.
+        
+        Waits for the GPU. Compare with the steps taken to see how well
+        the skin amortizes the build.
+        
+        Returns:
+            Rebuilds since the skin was first used
+        """
+        ...
+    
+    def set_equation_compile_mode(self, enabled: bool) -> None:
+        """
+        Compile registered equations into specialized shader code.
+        
+        The shader is rebuilt in the background whenever new equations are
+        registered; until it is ready they run on the RPN interpreter.
+        D() taken numerically or with dual numbers runs on the interpreter.
+        
+        Args:
+            enabled: True to compile equations, False to interpret them (default)
+        """
+        ...
+    
+    def get_equation_compile_mode(self) -> bool:
+        """
+        Check whether equations are compiled into specialized shader code.
+        
+        Returns:
+            True if equation compile mode is enabled
+        """
+        ...
+    
+    def set_equation_cache(self, directory: str) -> None:
+        """
+        Keep serialized equations in a directory across runs.
+        
+        set_equation, batch_set_equation and set_equations look an equation
+        up there before parsing it, and store what they had to parse. Entries
+        are tied to the shader build, so an upgraded module ignores old ones.
+        Off by default, unless STELLAR_EQUATION_CACHE names a directory.
+        
+        Args:
+            directory: Cache directory, created when needed; empty turns the cache off
+        """
+        ...
+    
+    def get_equation_cache(self) -> str:
+        """Directory of the equation cache, empty when it is off"""
+        ...
+    
+    def set_register_bytecode_enabled(self, enabled: bool) -> None:
+        """
+        Run interpreted equation components as register bytecode.
+        
+        Components that need run-time complex tracking, derivatives or
+        more than 16 live values stay on the RPN stack interpreter.
+        
+        Args:
+            enabled: True to use register bytecode (default), False for the stack interpreter only
+        """
+        ...
+    
+    def get_register_bytecode_enabled(self) -> bool:
+        """
+        Check whether interpreted equation components run as register bytecode.
+        
+        Returns:
+            True if register bytecode is enabled
+        """
+        ...
+    
+    def set_fast_math(self, enabled: bool, scan_interval: int = 60, rollback: bool = False) -> None:
+        """
+        Run equations without their per-operation NaN/Inf guards.
+        
+        Divisions by zero, logarithms of negative values and overflowing
+        exponentials are no longer clamped to 0 on the spot. Instead a scan
+        over all objects runs every scan_interval steps and reports the
+        objects whose state went NaN or infinite (see get_invalid_objects()).
+        With rollback, a scan that finds any puts back the state of the last
+        clean scan and the next scan_interval steps run with the guards on;
+        simulation time is not rewound.
+        
+        Args:
+            enabled: True for fast math, False for guarded math (default)
+            scan_interval: Steps between scans, 0 = never scan (default 60)
+            rollback: Roll back to the last clean scan on NaN/Inf (default False)
+        
+        Raises:
+            RuntimeError: If scan_interval < 0
+        """
+        ...
+    
+    def get_fast_math(self) -> Tuple[bool, int, bool]:
+        """
+        Get the fast math settings.
+        
+        Returns:
+            Tuple of (enabled, scan_interval, rollback)
+        """
+        ...
+    
+    def get_invalid_objects(self) -> Tuple[int, List[int]]:
+        """
+        Objects the last fast math scan found holding NaN or infinity.
+        
+        Returns:
+            Tuple of (count, indices); every invalid object is counted, the
+            first 64 are listed in ascending order
+        """
+        ...
+    
+    def get_nan_rollback_count(self) -> int:
+        """Number of fast math roll backs since the simulation started."""
+        ...
+    
+    def set_dispatch_reorder_interval(self, steps: int) -> None:
+        """
+        Group objects by equation on the GPU to reduce shader divergence.
+        
+        Every `steps` steps the physics pass re-sorts the order in which it
+        visits objects by (equation, spatial cell). Objects keep their
+        indices; only the processing order changes.
+        
+        Args:
+            steps: Re-sort interval in simulation steps, 0 to disable (default)
+        
+        Raises:
+            RuntimeError: If steps is negative
+        """
+        ...
+    
+    def get_dispatch_reorder_interval(self) -> int:
+        """
+        Get the dispatch re-sort interval.
+        
+        Returns:
+            Interval in simulation steps, 0 if reordering is disabled
+        """
+        ...
+    
+    def set_storage_reorder_interval(self, steps: int) -> None:
+        """
+        Keep objects that are close in space close in memory.
+        
+        Every `steps` steps the object storage is sorted by the Z-order
+        (Morton) code of each object's position. Indices change as after
+        remove_objects; handles keep naming the same objects. Sleeping
+        objects are woken and trails restart at each sort. Scenes with
+        worlds, springs or spawned objects are never re-sorted.
+        
+        Args:
+            steps: Re-sort interval in simulation steps, 0 to disable (default)
+        
+        Raises:
+            RuntimeError: If steps is negative
+        """
+        ...
+    
+    def get_storage_reorder_interval(self) -> int:
+        """
+        Get the storage re-sort interval.
+        
+        Returns:
+            Interval in simulation steps, 0 if reordering is disabled
+        """
+        ...
+    
+    def tune_workgroup_sizes(self, force: bool = False) -> None:
+        """
+        Find the fastest work-group size of each per-object pass on this GPU.
+        
+        Over the next steps the integrate, constraint and collision passes
+        are timed at 16, 32, 64, 128 and 256 threads per work group, and
+        each keeps the fastest. Passes the scene does not use keep the
+        default of 16; steps with sleeping objects stay at 16. The result
+        is stored per GPU and driver next to the shader cache and loaded
+        on start-up.
+        
+        Args:
+            force: Tune again even if sizes are stored for this GPU
+        """
+        ...
+    
+    def is_workgroup_tuning(self) -> bool:
+        """Whether tune_workgroup_sizes is still timing candidates."""
+        ...
+    
+    def get_workgroup_sizes(self) -> Tuple[int, int, int]:
+        """
+        Get the tuned work-group sizes.
+        
+        Returns:
+            Tuple of (integrate, constraints, collide) threads per work group
+        """
+        ...
+    
+    def set_soa_storage_enabled(self, enabled: bool, quantized: bool = False) -> None:
+        """
+        Read other objects from structure-of-arrays streams on the GPU.
+        
+        Before each pass that reads neighbours (p[i].x, sum_j, nsum and
+        collision candidates) the fields those reads use are copied into one
+        dense array per field. Costs one extra copy pass per step; pays off
+        when every object reads many others. Results are unchanged.
+        
+        The quantized layout packs the streams into 48 bytes per object instead
+        of 64: the colour as RGBA8, polygon height/sides, angular velocity and
+        last acceleration as half floats, and the skin and shape types as 16-bit
+        fields. Position, velocity, mass, charge, size and rotation keep full
+        precision. Only what other objects see is quantized.
+        
+        Args:
+            enabled: True to use the streams, False to read objects directly (default)
+            quantized: True for the quantized stream layout (default False)
+        """
+        ...
+    
+    def get_soa_storage_enabled(self) -> bool:
+        """
+        Check whether neighbour reads use structure-of-arrays streams.
+        
+        Returns:
+            True if structure-of-arrays storage is enabled
+        """
+        ...
+    
+    def get_soa_storage_quantized(self) -> bool:
+        """
+        Check whether the structure-of-arrays streams use the quantized layout.
+        
+        Returns:
+            True if the streams are quantized
+        """
+        ...
+    
+    def set_fused_substeps(self, enabled: bool) -> None:
+        """
+        Run all pending fixed steps of an update() in a single GPU dispatch.
+        
+        The physics kernel loops over the steps itself and keeps object state
+        in registers. Only applies while no equation references other objects
+        and there are no constraints or collidable objects; otherwise steps
+        are dispatched one at a time.
+        
+        Args:
+            enabled: True to fuse steps, False for one dispatch per step (default)
+        """
+        ...
+    
+    def get_fused_substeps(self) -> bool:
+        """
+        Check whether fixed steps are fused into a single dispatch.
+        
+        Returns:
+            True if fused substeps are enabled
+        """
+        ...
+    
+    def set_long_range_parameters(self, theta: float = 0.5, gravity_constant: float = 1.0,
+                                  coulomb_constant: float = 1.0, softening: float = 0.01) -> None:
+        """
+        Configure the Barnes-Hut solver behind grav_ax/grav_ay and coul_ax/coul_ay.
+        
+        When an equation reads these variables, a tree over all objects is
+        rebuilt on the GPU each step and distant groups are summed as single
+        points, costing O(N log N) instead of the O(N^2) of sum_j().
+        
+        Args:
+            theta: Opening angle; smaller is more accurate, 0 is exact (default 0.5)
+            gravity_constant: G in a = G*m_j*r/(r^2+eps^2)^1.5 (default 1.0)
+            coulomb_constant: k in a = -k*q*q_j*r/((r^2+eps^2)^1.5 * mass) (default 1.0)
+            softening: Softening length eps (default 0.01)
+        
+        Raises:
+            RuntimeError: If theta or softening is negative
+        """
+        ...
+    
+    def get_long_range_parameters(self) -> Tuple[float, float, float, float]:
+        """
+        Get the Barnes-Hut solver parameters.
+        
+        Returns:
+            Tuple of (theta, gravity_constant, coulomb_constant, softening)
+        """
+        ...
+    
+    def set_long_range_method(self, method: str = "barnes_hut", mesh_size: int = 256,
+                              periodic_box: Tuple[float, float, float, float] = (0.0, 0.0, 0.0, 0.0)) -> None:
+        """
+        Choose how grav_ax/grav_ay and coul_ax/coul_ay are evaluated.
+        
+        "particle_mesh" deposits mass and charge cloud-in-cell onto a mesh,
+        solves the softened potential with an FFT on the GPU and interpolates
+        its gradient back, costing O(N + M^2 log M) however objects cluster.
+        Without a periodic box the mesh follows the objects and has no image
+        forces; with one, the box's edges wrap (nearest image).
+        
+        Args:
+            method: "barnes_hut" (default) or "particle_mesh"
+            mesh_size: Cells per side, a power of two from 16 to 512, or 1024 when periodic (default 256)
+            periodic_box: (min_x, min_y, width, height) of a wrapping box; zero size for none (default)
+        
+        Raises:
+            RuntimeError: If method is unknown or the mesh size or box is invalid
+        """
+        ...
+    
+    def get_long_range_method(self) -> Tuple[str, int, Tuple[float, float, float, float]]:
+        """
+        Get the long-range method and its mesh settings.
+        
+        Returns:
+            Tuple of (method, mesh_size, periodic_box)
+        """
+        ...
+    
+    def set_world_bounds(self, mode: str = "reflect",
+                         box: Tuple[float, float, float, float] = (-1e6, -1e6, 2e6, 2e6)) -> None:
+        """
+        Choose what happens at the edges of the world.
+        
+        "reflect" bounces objects off walls at the box edges (the default, at
+        +-1e6), "periodic" wraps them back in at the other side, where
+        collisions, neighbour reductions, sum_j() and p[i] references see the
+        nearest image, and "open" has no walls. Long-range forces, springs and
+        constraints do not wrap.
+        
+        Args:
+            mode: "reflect" (default), "periodic" or "open"
+            box: (min_x, min_y, width, height) of the world (default +-1e6)
+        
+        Raises:
+            RuntimeError: If mode is unknown or the box has no area
+        """
+        ...
+    
+    def get_world_bounds(self) -> Tuple[str, Tuple[float, float, float, float]]:
+        """
+        Get the boundary mode and the world box.
+        
+        Returns:
+            Tuple of (mode, (min_x, min_y, width, height))
+        """
+        ...
+    
+    def set_random_seed(self, seed: int) -> None:
+        """
+        Set the seed of rand() and randn() in equations.
+        
+        Draws are a counter-based hash of the seed, step, object and call, so a
+        reset with the same seed replays the same noise. The seed is kept
+        across resets; equations with rand() or randn() always step on the GPU.
+        
+        Args:
+            seed: 32-bit seed (default 0)
+        """
+        ...
+    
+    def get_random_seed(self) -> int:
+        """Get the seed of rand() and randn()."""
+        ...
+    
+    def set_metropolis(self, enabled: bool, step_size: float = 0.1,
+                       histogram_box: Tuple[float, float, float, float] = (-1.0, -1.0, 2.0, 2.0),
+                       histogram_bins: Tuple[int, int] = (0, 0)) -> None:
+        """
+        Sample with Metropolis chains instead of integrating.
+        
+        While enabled every object is one MCMC chain over its position: each
+        step proposes a Gaussian move of step_size per axis and accepts it on
+        the GPU with probability min(1, exp(logp' - logp)), where logp is the
+        "logp" statement of the object's equation:
+        
+            sim.set_equation(0, "logp = -0.5*(x^2 + y^2)")
+        
+        Velocity, rotation and walls are left alone. NaN or Inf densities
+        read 0, so return a large negative value outside the support.
+        Changing the settings clears the statistics.
+        
+        Args:
+            enabled: Run the chains
+            step_size: Proposal standard deviation per axis, default 0.1
+            histogram_box: (min_x, min_y, width, height) of the histogram
+            histogram_bins: (bins_x, bins_y), default (0, 0) = no histogram
+        
+        Raises:
+            RuntimeError: If step_size is not positive or the histogram is invalid
+        """
+        ...
+    
+    def get_metropolis_stats(self) -> Tuple[int, List[int], List[List[int]]]:
+        """
+        Read the acceptance counts and the histogram of the chains (waits for the GPU).
+        
+        Returns:
+            (proposals per chain, accepted per object, histogram rows from min_y)
+        """
+        ...
+    
+    def clear_metropolis_stats(self) -> None:
+        """Zero the acceptance counts and the histogram (for example after burn-in)."""
+        ...
+    
+    def set_table(self, id: int, values: List[float], x_range: Tuple[float, float] = (0.0, 1.0),
+                  interpolation: str = "linear") -> None:
+        """
+        Set the 1D table that table(id, x) samples in the equations.
+        
+        The values are spaced evenly over x_range and interpolated linearly or
+        with a Catmull-Rom cubic; x outside the range reads the edge value.
+        New values take effect on the next step without recompiling, and
+        replacing a table with as many values uploads just its range.
+        A table that was never set reads 0.
+        
+        Args:
+            id: Table id, 0 to 63
+            values: Samples, at least one
+            x_range: (min_x, max_x) of the first and last sample, default (0, 1)
+            interpolation: "linear" (default) or "cubic"
+        
+        Raises:
+            RuntimeError: If the id, the values, the range or the interpolation is invalid
+        """
+        ...
+    
+    def set_field(self, id: int, values: List[List[float]],
+                  box: Tuple[float, float, float, float] = (-1.0, -1.0, 2.0, 2.0)) -> None:
+        """
+        Set the 2D grid that field(id, x, y) samples bilinearly in the equations.
+        
+        values is a list of equally long rows, the first at the bottom of the
+        box; points outside the box read the nearest edge. Same-sized updates
+        are an in-place upload and never recompile the equations.
+        
+        Args:
+            id: Field id, 0 to 63
+            values: Rows of samples from min_y
+            box: (min_x, min_y, width, height), default (-1, -1, 2, 2)
+        
+        Raises:
+            RuntimeError: If the id, the rows or the box is invalid
+        """
+        ...
+    
+    def clear_table(self, id: int) -> None:
+        """Unset a table; table(id, x) reads 0 again."""
+        ...
+    
+    def clear_field(self, id: int) -> None:
+        """Unset a field; field(id, x, y) reads 0 again."""
+        ...
+    
+    def set_grid(self, resolution: Tuple[int, int], box: Tuple[float, float, float, float] = (-1.0, -1.0, 2.0, 2.0),
+                 boundary: str = "clamp") -> None:
+        """
+        Lay out the grid of the grid PDE mode, dropping any fields on it.
+        
+        The nodes span the box edge to edge, as field() samples them, so node
+        spacing is width / (columns - 1). Stencils that reach past an edge
+        read the edge ("clamp", zero flux), wrap around ("periodic") or read
+        0 ("zero").
+        
+        Args:
+            resolution: (columns, rows) of nodes, at least 2 each
+            box: (min_x, min_y, width, height), default (-1, -1, 2, 2)
+            boundary: "clamp", "periodic" or "zero"
+        
+        Raises:
+            RuntimeError: If the resolution, box or boundary is invalid
+        """
+        ...
+    
+    def set_grid_field(self, name: str, expression: str, values: List[List[float]] = [],
+                       field_id: int = -1) -> None:
+        """
+        Add a scalar field to the grid, or replace one, with its rate of change.
+        
+        Every physics step adds dt * expression at each node (forward Euler)
+        in a GPU pass over 16x16 tiles with their neighbours in shared
+        memory. Expressions read neighbours as u[i+1,j] and u[i,j-2] (up to 4
+        nodes away), and have lap(u), dx(u) and dy(u), the functions of
+        equations, and x, y, t, dt, hx, hy (node spacing), k, b, g, pi and e.
+        Fields step in the order they were added and see the new values of
+        those before. With a field_id the values are copied into
+        field(field_id, x, y) after every step, so equations of objects
+        sample them; grid fields keep steps unfused and on the GPU. At most
+        4 fields.
+        
+        Args:
+            name: Identifier the expressions use
+            expression: du/dt, e.g. "0.1*lap(u) + u - u^3"
+            values: Rows from min_y of starting values, default all 0
+            field_id: field() id to copy into, -1 for none
+        
+        Raises:
+            RuntimeError: If there is no grid or the expression does not compile
+        
+        Example:
+            >>> sim.set_grid((128, 128), (-5.0, -5.0, 10.0, 10.0), "zero")
+            >>> sim.set_grid_field("v", "4*lap(u)")
+            >>> sim.set_grid_field("u", "v", bump, field_id=0)
+            >>> sim.set_equation(0, "ax = -field(0, x, y); ay = 0")
+        """
+        ...
+    
+    def get_grid_field(self, name: str) -> List[List[float]]:
+        """Current values of a grid field as rows from min_y."""
+        ...
+    
+    def show_grid_field(self, name: str, value_range: Tuple[float, float] = (-1.0, 1.0),
+                        opacity: float = 1.0) -> None:
+        """
+        Draw a grid field under the objects, blue through white to red.
+        
+        Args:
+            name: Field to show, "" to hide
+            value_range: Values at the blue and red ends
+            opacity: 0 to 1
+        """
+        ...
+    
+    def clear_grid(self) -> None:
+        """Drop the grid and its fields, and unset the field() ids they filled."""
+        ...
+    
+    def set_pipeline(self, passes: List[str]) -> None:
+        """
+        Compute named per-object fields in passes before the equations run.
+        
+        Each pass is "name = expr; name = expr" and runs as one GPU dispatch
+        over every object, with a barrier before the next, once per
+        integrator stage. Expressions follow the rules of reduce() and may
+        also use nsum(), ncount() and nmean(): a pass reads fields of the
+        passes before it as fld[name], and a neighbour's as pj.fld[name]
+        inside a neighbour reduction. Equations read the results as
+        fld[name], and pj.fld[name] inside nsum(). At most 8 passes, 8 field
+        names and 4 neighbour reductions per pass; the pipeline keeps steps
+        unfused and on the GPU.
+        
+        Args:
+            passes: The passes in order
+        
+        Raises:
+            RuntimeError: If a pass does not parse or compile; the old pipeline stays
+        
+        Example:
+            >>> sim.set_pipeline([
+            ...     "rho = nsum(0.1, pj.mass * (0.01 - (pj.x-x)^2 - (pj.y-y)^2)^3)",
+            ...     "p = max(fld[rho] - 1000, 0)"])
+            >>> sim.set_equation(0, "ax = nsum(0.1, (fld[p] + pj.fld[p]) * (pj.x - x)); ay = 0")
+        """
+        ...
+    
+    def get_pipeline_field(self, name: str) -> List[float]:
+        """Values of a pipeline field for every object, as of the last step."""
+        ...
+    
+    def clear_pipeline(self) -> None:
+        """Drop the pipeline; fld[] reads 0 again."""
+        ...
+    
+    def set_adaptive_timestep(self, enabled: bool, min_dt: float = 1e-5, max_dt: float = 0.01,
+                              courant: float = 0.1) -> None:
+        """
+        Choose every step's dt on the GPU from the state of the last step.
+        
+        After each step a reduction takes the smallest of
+        courant * size / |v| and courant * sqrt(size / |a|) over all objects,
+        clamps it to [min_dt, max_dt] and lets it at most double per step.
+        No step waits for a readback; update() paces itself with the dt it
+        saw a few frames earlier. Steps are not fused while this is enabled.
+        
+        Args:
+            enabled: True for adaptive steps, False for the fixed "timestep" parameter
+            min_dt: Smallest allowed dt (default 1e-5)
+            max_dt: Largest allowed dt (default 0.01)
+            courant: Fraction of its size an object may move per step (default 0.1)
+        
+        Raises:
+            RuntimeError: If the bounds are not 0 < min_dt <= max_dt or courant <= 0
+        """
+        ...
+    
+    def get_adaptive_timestep(self) -> Tuple[bool, float, float, float]:
+        """
+        Get the adaptive timestep settings.
+        
+        Returns:
+            Tuple of (enabled, min_dt, max_dt, courant)
+        """
+        ...
+    
+    def get_timestep_history(self) -> List[float]:
+        """
+        dt of the most recent adaptive steps (up to 1024), oldest first.
+        
+        Reads the history back from the GPU, so call it for profiling
+        rather than every frame.
+        """
+        ...
+    
+    def set_sleep_parameters(self, enabled: bool, velocity_threshold: float = 0.05,
+                             acceleration_threshold: float = 0.5, steps: int = 30) -> None:
+        """
+        Stop integrating and colliding objects that have come to rest.
+        
+        An object whose speed and angular speed stay below velocity_threshold
+        and whose velocity changes by less than acceleration_threshold per
+        second for `steps` consecutive steps is put to rest. The next steps
+        dispatch only the awake objects. A moving object that hits a sleeper
+        wakes it; writing objects or equations wakes everything. Objects stay
+        awake while there are constraints or a multi-stage integrator runs
+        its stages as separate passes.
+        
+        Args:
+            enabled: True to let objects sleep, False to keep all awake (default)
+            velocity_threshold: Largest speed of a resting object (default 0.05)
+            acceleration_threshold: Largest |dv/dt| of a resting object (default 0.5)
+            steps: Resting steps before an object sleeps (default 30)
+        
+        Raises:
+            RuntimeError: If a threshold is negative or steps < 1
+        """
+        ...
+    
+    def get_sleep_parameters(self) -> Tuple[bool, float, float, int]:
+        """
+        Get the sleep settings.
+        
+        Returns:
+            Tuple of (enabled, velocity_threshold, acceleration_threshold, steps)
+        """
+        ...
+    
+    def get_awake_object_count(self) -> int:
+        """
+        Number of objects the next step integrates (all while sleeping is off).
+        
+        Reads the count back from the GPU, so call it for profiling
+        rather than every frame.
+        """
+        ...
+    
+    def wake_all_objects(self) -> None:
+        """
+        Wake every sleeping object.
+        
+        Needed after changing something sleepers cannot notice on their
+        own, such as a time-dependent equation that starts pushing them.
+        """
+        ...
+    
+    def set_xpbd_constraints(self, enabled: bool, iterations: int = 4,
+                             compliance: float = 0.0) -> None:
+        """
+        Solve distance constraints with XPBD over a colored constraint graph.
+        
+        Every distance constraint moves both of its objects, each by its
+        inverse mass, so give anchors a large mass. Edges of one color share
+        no object and each iteration sweeps the colors in turn, so chains
+        converge in a few iterations. Boundary and angle constraints keep
+        the per-object pass. Off by default.
+        
+        Args:
+            enabled: True for XPBD distance constraints, False for the per-object pass (default)
+            iterations: Sweeps over all colors per step (default 4)
+            compliance: Inverse stiffness, 0 = rigid (default 0.0)
+        
+        Raises:
+            RuntimeError: If iterations < 1 or compliance < 0
+        """
+        ...
+    
+    def get_xpbd_constraints(self) -> Tuple[bool, int, float]:
+        """
+        Get the XPBD constraint settings.
+        
+        Returns:
+            Tuple of (enabled, iterations, compliance)
+        """
+        ...
+    
+    def get_xpbd_graph(self) -> Tuple[int, int]:
+        """
+        Get the size of the colored constraint graph XPBD solved last.
+        
+        Each color is one dispatch per iteration, so colors is what an
+        iteration costs. Breakable distance constraints stay in the
+        per-object pass and are not edges.
+        
+        Returns:
+            Tuple of (edges, colors), both 0 before the first XPBD step
+        """
+        ...
+    
+    def set_springs(self, edges: Any, stiffness: Any, damping: Any = None,
+                    rest_length: Any = None) -> None:
+        """
+        Replace the spring network with Hooke springs between pairs of objects.
+        
+        The edges go up in one upload as compressed sparse rows, and a
+        dedicated pass sums every object's spring forces after integration.
+        Springs are explicit, so stiff ones need a small enough timestep.
+        Removing objects clears the network.
+        
+        Args:
+            edges: (E, 2) object indices, one row per spring
+            stiffness: Hooke constant per spring, or one for all
+            damping: Damping along each spring per unit relative speed (default None = 0)
+            rest_length: Rest length per spring, or one for all; None or a negative
+                value = the distance at the next step (default None)
+        
+        Raises:
+            RuntimeError: If an index is out of range, an edge joins an object to
+                itself, or a column holds neither one value nor one per edge
+        """
+        ...
+    
+    def clear_springs(self) -> None:
+        """Remove every spring."""
+        ...
+    
+    def get_spring_count(self) -> int:
+        """
+        Get the number of springs in the network.
+        
+        Returns:
+            Springs set by the last set_springs call, 0 after clear_springs
+        """
+        ...
+    
+    def set_implicit_springs(self, enabled: bool, iterations: int = 20, tolerance: float = 1e-4) -> None:
+        """
+        Integrate springs with backward Euler instead of explicit impulses.
+        
+        Each step solves (M - dt*D - dt^2*K) dv = dt*f for the velocity
+        change, with the damping and stiffness Jacobians of the springs, by
+        Jacobi-preconditioned conjugate gradients on the GPU. Stiff cloth and
+        soft bodies stay stable at timesteps that make explicit springs blow
+        up; large steps damp the motion more. Off by default.
+        
+        Args:
+            enabled: True for implicit springs, False for explicit (default)
+            iterations: Most CG iterations per step (default 20)
+            tolerance: Stop once the preconditioned residual is this fraction
+                of the starting one (default 1e-4)
+        
+        Raises:
+            RuntimeError: If iterations < 1 or tolerance < 0
+        """
+        ...
+    
+    def get_implicit_springs(self) -> Tuple[bool, int, float]:
+        """Get the implicit spring settings as (enabled, iterations, tolerance)."""
+        ...
+    
+    def add_particle_emitter(self, template_index: int, rate: float,
+                             offset_x: float = 0.0, offset_y: float = 0.0,
+                             velocity_x: float = 0.0, velocity_y: float = 0.0,
+                             position_spread: float = 0.0, velocity_spread: float = 0.0,
+                             lifetime: float = 0.0,
+                             kill_when_transparent: bool = False, kill_outside: bool = False,
+                             bounds_min_x: float = 0.0, bounds_min_y: float = 0.0,
+                             bounds_max_x: float = 0.0, bounds_max_y: float = 0.0) -> int:
+        """
+        Spawn copies of an object on the GPU at a steady rate.
+        
+        Spawns copy the template to a random point within position_spread of
+        template + offset, moving at the template's velocity plus velocity
+        and a random part within velocity_spread. They die when their
+        lifetime runs out, outside the bounds (kill_outside) or when their
+        colour alpha reaches 0 (kill_when_transparent). The GPU keeps the
+        object count; get_num_objects() reports it a few steps late.
+        Adding, uploading or resetting objects discards spawned objects.
+        
+        Args:
+            template_index: Object copied on spawn
+            rate: Objects per second of simulated time
+            offset_x, offset_y: Spawn point relative to the template
+            velocity_x, velocity_y: Added to the template's velocity
+            position_spread: Radius of the random spawn disc
+            velocity_spread: Radius of the random velocity disc
+            lifetime: Seconds until a spawned object dies, 0 = no limit
+            kill_when_transparent: Kill when the colour alpha reaches 0
+            kill_outside: Kill outside [bounds_min, bounds_max]
+            bounds_min_x, bounds_min_y, bounds_max_x, bounds_max_y: Kill bounds
+        
+        Returns:
+            Emitter ID
+        
+        Raises:
+            RuntimeError: On negative rate or spreads, inverted bounds, an
+                invalid template or when all 64 emitters are in use
+        """
+        ...
+    
+    def remove_particle_emitter(self, emitter_id: int) -> None:
+        """
+        Stop an emitter. Objects it spawned live on under its kill conditions.
+        
+        Raises:
+            RuntimeError: If the ID is not an active emitter
         """
         ...
     
+    def clear_particle_emitters(self) -> None:
+        """Stop every emitter."""
+        ...
+    
+    def get_particle_emitter_count(self) -> int:
+        """Get the number of emitters added and not removed."""
+        ...
+    
     # ========================================================================
-    # COLLISION SYSTEM
+    # EQUATIONS
     # ========================================================================
     
-    def set_collision_enabled(self, index: int, enabled: bool) -> None:
+    @typing.overload
+    def set_equation(self, object_index: int, equation: expr.Equation) -> None:
+        """Set an equation built with stellar.expr for an object (see set_equation with a string)."""
+        ...
+    
+    @typing.overload
+    def set_equation(self, object_index: int, equation_string: str, derivative_method: str = "symbolic") -> None:
         """
-        Enable or disable collisions for an object.
+        Set physics equation for an object.
         
         Args:
-            index: Object index
-            enabled: True to enable collisions, False to disable
+            object_index: Index of object to apply equation to
+            equation_string: Mathematical equation defining object's physics
+            derivative_method: How D(expr, var, order) is computed: "symbolic"
+                (default) expands it into an ordinary expression, "dual" evaluates
+                expr once with dual numbers on the GPU (large expansions stay
+                small), "numerical" takes a central difference (first order only)
+        
+        sum_j(expr) adds up expr over every other object j, where expr reads
+        the other object as pj.x, pj.y, pj.mass, pj.charge, ... (up to 4
+        sum_j terms per equation). For example, N-body gravity:
+        
+            "sum_j(pj.mass*(pj.x-x)/((pj.x-x)^2+(pj.y-y)^2+0.01)^1.5), "
+            "sum_j(pj.mass*(pj.y-y)/((pj.x-x)^2+(pj.y-y)^2+0.01)^1.5)"
+        
+        nsum(radius, expr), ncount(radius) and nmean(radius, expr) reduce over
+        the objects within a fixed radius only, found through a spatial hash
+        grid, so local rules such as flocking or density coloring scale to
+        large N with one shared equation. radius must be a positive number;
+        these count towards the same limit of 4 terms per equation:
+        
+            "nsum(0.5, (x-pj.x)/((x-pj.x)^2+(y-pj.y)^2+0.01)), 0, 0, "
+            "ncount(0.5)/10, 0.2, 1"
+        
+        For large N the same gravity is available in O(N log N) as
+        "grav_ax, grav_ay" (and Coulomb forces as coul_ax, coul_ay), computed
+        by a GPU Barnes-Hut tree or particle mesh; see set_long_range_parameters()
+        and set_long_range_method().
+        
+        Objects whose equation reads sph_ax, sph_ay, sph_rho or sph_p form an
+        SPH fluid: each step the GPU sums their density (sph_rho), pressure
+        (sph_p) and pressure + viscosity accelerations (sph_ax, sph_ay) over
+        the neighbour grid, with the "sph_*" parameters of set_parameter():
+        
+            "sph_ax, sph_ay - gravity"
+        
+        rand() is uniform in (0, 1) and randn() standard normal. Each call in
+        the equation (up to 8) draws once per object and step from the seed of
+        set_random_seed(), so a let bound to rand() is one value:
+        
+            "let kick = randn(); a = vec2(kick, 0)"
+        
+        table(id, x) samples the 1D table of set_table() and field(id, x, y)
+        the 2D grid of set_field(); new values need no recompile:
+        
+            "ax = -field(0, x, y); ay = table(0, t)"
+        
+        s0..s7 are per-object state registers (see set_state). A statement
+        "sK = expr" updates one after each step, on the state the step ended
+        in; every update reads the values from before the step's updates:
+        
+            "ax = -x; s0 = s0 + 1; s1 = max(s1, abs(vx))"
+        
+        Instead of the comma separated list, the components can be assigned by
+        name in statements separated by ';' or newlines: a (the vec2 ax, ay),
+        ax, ay, angular, color.r, color.g, color.b and color.a. Statements may
+        use vec2 values (pos, vel, p[ID].pos, p[ID].vel, vec2(x, y)) with
+        len(), dot() and .x/.y, and "let name = expr" names a value for the
+        statements after it. Terms used more than once are computed once:
+        
+            "let d = p[1].pos - pos; a = $0*d/len(d)^3"
             
         Raises:
-            RuntimeError: If index is invalid
+            RuntimeError: If object index is invalid or equation parsing fails
         """
         ...
     
-    def set_collision_shape(self, index: int, shape: PyCollisionShape) -> None:
+    @typing.overload
+    def batch_set_equation(self, indices: List[int], equation_string: str, derivative_method: str = "symbolic") -> None:
         """
-        Set collision shape for an object.
+        Set one physics equation for many objects.
+        
+        The equation is parsed and registered once, and the objects pick it up
+        in a single write pass; see set_equation for the syntax.
         
-        Args:
-            index: Object index
-            shape: Collision shape type (NONE, CIRCLE, AABB, or POLYGON)
-            
         Raises:
-            RuntimeError: If index is invalid
+            RuntimeError: If an index is invalid or equation parsing fails
         """
         ...
     
-    def set_collision_properties(self, index: int, restitution: float, friction: float) -> None:
+    @typing.overload
+    def batch_set_equation(self, indices: List[int], equation: expr.Equation) -> None:
+        """Set one stellar.expr.Equation for many objects."""
+        ...
+    
+    @typing.overload
+    def set_equations(self, indices: List[int], equations: List[expr.Equation]) -> None:
         """
-        Set collision material properties.
+        Set a stellar.expr.Equation per object in one call.
         
-        Args:
-            index: Object index
-            restitution: Bounciness coefficient (0.0-1.0)
-            friction: Friction coefficient (0.0-1.0)
-            
-        Raises:
-            RuntimeError: If index is invalid or parameters are out of range
+        The equations are already parsed: only the distinct ones are
+        simplified and compiled, in parallel. Nothing changes if one of them
+        fails.
         """
         ...
     
-    def get_collision_config(self, index: int) -> CollisionConfig:
+    @typing.overload
+    def set_equations(self, indices: List[int], equation_strings: List[str], derivative_method: str = "symbolic") -> None:
         """
-        Get current collision configuration for an object.
+        Set a physics equation per object in one call.
+        
+        Each distinct string is parsed once, the new ones in parallel on the
+        CPU thread pool, and all of them reach the GPU in one upload. Objects
+        sharing a string share one registered equation.
         
         Args:
-            index: Object index
-            
-        Returns:
-            CollisionConfig with current collision settings
-            
+            indices: Object IDs
+            equation_strings: Equation for each object (see set_equation)
+            derivative_method: How D() is computed, for every equation
+        
         Raises:
-            RuntimeError: If index is invalid
+            RuntimeError: If the lists differ in length, an index is invalid or
+                an equation fails to parse; no equation is changed then
         """
         ...
     
-    def enable_collision_between(self, obj1: int, obj2: int, enable: bool) -> None:
+    def set_equation_group(self, indices: List[int], group: int) -> None:
         """
-        Enable or disable collisions between two specific objects.
+        Make objects members of a behaviour group.
+        
+        Members run whatever equation the group is set to with
+        set_group_equation, default physics while it has none. Setting an
+        equation on a member with set_equation takes it out of its group.
         
         Args:
-            obj1: First object index
-            obj2: Second object index
-            enable: True to enable collisions between them, False to disable
-            
+            indices: Object IDs
+            group: Group, 0 to 255
+        
         Raises:
-            RuntimeError: If either index is invalid
+            RuntimeError: If an index or the group is invalid
         """
         ...
     
-    def is_collision_enabled(self, index: int) -> bool:
+    def set_group_equation(self, group: int, equation_string: Any, derivative_method: str = "symbolic") -> None:
         """
-        Check if collisions are enabled for an object.
+        Switch the equation every member of a behaviour group runs.
+        
+        The group's equation is one entry of a small table on the GPU, so
+        this is a single 4-byte write however many objects are members;
+        the equation itself is parsed and registered once, as with
+        set_equation. Snapshots and cached scenes save the equation each
+        member runs, not its group.
         
         Args:
-            index: Object index
-            
-        Returns:
-            True if collisions are enabled, False otherwise
-            
+            group: Group, 0 to 255
+            equation_string: Physics equation (see set_equation), or a
+                stellar.expr.Equation
+            derivative_method: How D() is computed (see set_equation)
+        
         Raises:
-            RuntimeError: If index is invalid
+            RuntimeError: If the group is invalid or equation parsing fails
         """
         ...
     
-    # ========================================================================
-    # NEW: COLLISION PARAMETERS
-    # ========================================================================
+    def clear_group_equation(self, group: int) -> None:
+        """Members of the behaviour group fall back to default physics."""
+        ...
     
-    def set_collision_parameters(self, enable_warm_start: bool, max_contact_iterations: int) -> None:
+    def get_group_equation(self, group: int) -> str:
+        """Registration key of the behaviour group's equation, '' if it has none."""
+        ...
+    
+    def set_color_interval(self, object_index: int, interval: int) -> None:
         """
-        Set global collision solver parameters.
+        Set how often the color components of an object's equation run.
+        
+        Color only matters when a frame is shown or read, so it can skip
+        substeps: interval N evaluates it every Nth step, 0 only on the last
+        step of each update() (the state render() draws). The color holds in
+        between. The setting belongs to the equation and so applies to every
+        object running it; a new equation starts at 1 (every step).
         
         Args:
-            enable_warm_start: Enable warm starting for contact constraints (improves stability)
-            max_contact_iterations: Maximum number of contact resolution iterations (1-20)
-            
+            object_index: Index of an object running the equation
+            interval: Steps between evaluations, or 0
+        
         Raises:
-            RuntimeError: If parameters are out of valid range
+            RuntimeError: If the index is invalid, the object has no equation
+                or interval is negative
         """
         ...
     
-    def get_collision_parameters(self) -> Tuple[bool, int]:
+    def get_color_interval(self, object_index: int) -> int:
         """
-        Get current global collision solver parameters.
-        
-        Returns:
-            Tuple of (enable_warm_start, max_contact_iterations)
+        Get the color interval of an object's equation (see set_color_interval).
         """
         ...
     
-    # ========================================================================
-    # EQUATIONS
-    # ========================================================================
-    
-    def set_equation(self, object_index: int, equation_string: str) -> None:
+    def set_step_interval(self, object_index: int, interval: int) -> None:
         """
-        Set physics equation for an object.
+        Put an object's equation in a slower rate group.
+        
+        Objects in a group with interval N evaluate their equation on every
+        Nth step and kick their velocity for all N steps at once; on every
+        step they drift on their velocity, so objects in faster groups that
+        read them (p[i], sum_j, ...) see their positions move on in between.
+        Slow, massive bodies can use 4 or 8 while fast ones keep 1; powers
+        of two keep the groups in step. Every integrator runs such objects
+        as this kick-drift scheme. The setting belongs to the equation and
+        so applies to every object running it; a new equation starts at 1.
         
         Args:
-            object_index: Index of object to apply equation to
-            equation_string: Mathematical equation defining object's physics
-            
+            object_index: Index of an object running the equation
+            interval: Steps per evaluation, at least 1
+        
         Raises:
-            RuntimeError: If object index is invalid or equation parsing fails
+            RuntimeError: If the index is invalid, the object has no equation
+                or interval is below 1
+        """
+        ...
+    
+    def get_step_interval(self, object_index: int) -> int:
+        """
+        Get the step interval of an object's equation (see set_step_interval).
         """
         ...
     
@@ -601,6 +3429,28 @@ class Simulation:
         """
         ...
     
+    def add_distance_constraints(self, object_indices: List[int], targets: List[int],
+                                 rest_lengths: List[float],
+                                 break_lengths: List[float] = []) -> None:
+        """
+        Add many distance constraints at once, object_indices[i] -> targets[i].
+        
+        Much faster than calling add_distance_constraint in a loop: every
+        constraint is checked first, then all of them go to the GPU in one upload.
+        
+        Args:
+            object_indices: Owning object of each constraint
+            targets: Target object of each constraint
+            rest_lengths: Rest length of each constraint
+            break_lengths: Break length of each constraint (0 = never), or empty
+                for none breakable
+            
+        Raises:
+            RuntimeError: If the lists differ in length, or any index, rest length
+                or break length is invalid
+        """
+        ...
+    
     def add_boundary_constraint(self, object_index: int, constraint: BoundaryConstraint) -> None:
         """
         Add boundary constraint to keep object within a rectangular area.
@@ -637,34 +3487,218 @@ class Simulation:
     def run_batch(
         self,
         configs: List[BatchConfig],
-        callback: Optional[Callable[[int, List[ObjectState]], None]] = None
+        callback: Optional[Callable[[int, List[ObjectState]], None]] = None,
+        ensemble: bool = False,
+        observers: List[BatchObserver] = [],
+        max_worlds: int = 0
     ) -> None:
         """
         Run multiple simulations in batch mode (headless only).
+        A configuration whose stop_condition holds ends there; its results
+        are the state at that check.
+        
+        Args:
+            configs: List of BatchConfig objects defining simulations to run
+            callback: Optional function called after each simulation completes,
+                with the GIL held (the simulations run without it)
+            ensemble: Step every configuration together, each as its own world,
+                instead of one after another. Much faster for many small
+                configurations. Objects interact (p[i], sum_j, nsum, collisions)
+                only within their world, and object indices in equations and
+                constraints are local to it. All configs must share one dt.
+            observers: Fed with frames of each configuration while it runs,
+                from one GPU recording (an active record() is replaced)
+            max_worlds: Ensemble only: configurations loaded at once, 0 = all.
+                The next ones take over from the queue as soon as every world
+                of the current ones is done; stopped worlds sleep meanwhile.
+        
+        Raises:
+            RuntimeError: If not in headless mode, on an invalid stop_condition,
+                or in ensemble mode if the
+                configs differ in dt or an equation uses long-range forces
+        """
+        ...
+    
+    @staticmethod
+    def run_batch_cpu(
+        configs: List[BatchConfig],
+        callback: Optional[Callable[[int, List[ObjectState]], None]] = None,
+        threads: int = 0,
+        timestep: float = 0.001
+    ) -> None:
+        """
+        Run multiple simulations in batch mode on the CPU, no OpenGL needed.
         
         Args:
             configs: List of BatchConfig objects defining simulations to run
-            callback: Optional function called after each simulation completes
+            callback: Optional function called with each configuration's
+                final state once all of them have finished
+            threads: Worker threads including the caller, 0 = one per
+                hardware thread. Configurations run side by side when there
+                are at least as many as threads; otherwise each step of one
+                configuration is split between the threads.
+            timestep: Fixed step each configuration's dt is paced with
+        
+        Default parameters only; long-range forces (grav_ax, ...) read 0 and
+        polygons do not collide.
+        
+        Raises:
+            RuntimeError: If an equation does not parse or a constraint is invalid
+        """
+        ...
+    
+    def sweep(
+        self,
+        base_config: BatchConfig,
+        parameters: Dict[str, Any],
+        fields: List[str] = []
+    ) -> Any:
+        """
+        Run one scene across a grid of parameter values (headless only).
+        
+        base_config is replicated once per grid point and every copy steps
+        as its own ensemble world, reading its own k, b, g, uCoupling,
+        uDriveFreq and uDriveAmp in equations.
+        
+        Args:
+            base_config: Scene to replicate; output_file is ignored
+            parameters: Array of values per parameter name: 'stiffness' ('k'),
+                'damping' ('b'), 'gravity' ('g'), 'coupling', 'drive_freq',
+                'drive_amp'. Unlisted parameters keep their current values.
+            fields: Fields to return, as for fetch_async (default: all)
+        
+        Returns:
+            numpy.ndarray of shape (points, objects, fields); points are in
+            meshgrid 'ij' order, the last parameter varying fastest
+        
+        Raises:
+            RuntimeError: If not in headless mode, a parameter or field is
+                unknown, the grid exceeds the object limit, or an equation
+                uses long-range forces
+        """
+        ...
+    
+    def fork(self, n: int, perturbations: Dict[str, Any] = {}, steps: int = 0,
+             observables: List[str] = [], restore: bool = True) -> Any:
+        """
+        Branch the current state into n worlds and roll them out together.
+        
+        The objects are saved and replicated into n ensemble worlds on the
+        GPU, with their equations, constraints, collision properties,
+        parameters and state registers, so every world starts from exactly
+        the current state. World w reads value w of each perturbation (or its
+        single value) wherever equations use k, b, g, uCoupling, uDriveFreq
+        or uDriveAmp. The worlds step together, then each observable is
+        reduced per world on the GPU; only those values are read back. With
+        restore=True the scene is put back as it was, simulation time
+        included. Releases the GIL while the worlds step.
+        
+        Args:
+            n: Worlds to fork into
+            perturbations: Parameter name -> one value per world, or one for all
+            steps: Steps to roll out (default 0)
+            observables: "sum(expr)", "mean(expr)", "min(expr)" or "max(expr)"
+            restore: Put the scene back afterwards (default True); otherwise
+                the worlds keep running until end_fork()
+        
+        Returns:
+            numpy.ndarray of float32 values, shape (n, len(observables))
         
         Raises:
-            RuntimeError: If not in headless mode
+            RuntimeError: If the scene is already forked or an ensemble, has
+                springs or spawned objects, or a perturbation or observable
+                is invalid
+        
+        Example:
+            >>> gains = np.linspace(0.0, 2.0, 64)
+            >>> cost = sim.fork(64, {"drive_amp": gains}, steps=200,
+            ...                 observables=["mean(abs(x - 1.0))"])
+            >>> best = gains[np.argmin(cost[:, 0])]
+        """
+        ...
+    
+    def end_fork(self) -> None:
+        """Drop the forked worlds and put the scene back as fork() found it; does nothing when not forked."""
+        ...
+    
+    def is_forked(self) -> bool:
+        """Check whether fork(restore=False) worlds are running."""
+        ...
+    
+    def set_world_tiles(self, worlds: List[int] = [], columns: int = 0) -> None:
+        """
+        Render ensemble worlds side by side instead of on top of each other.
+        
+        Each shown world gets a cell of a grid over the view, left to right
+        and top to bottom, showing the camera's view of its own objects. All
+        cells are drawn by the one instanced object draw; trails, the force
+        field and the grid are left out while tiles are shown. The layout
+        applies whenever an ensemble exists.
+        
+        Args:
+            worlds: Worlds to show, in cell order (default: all)
+            columns: Grid columns (default 0: as square as fits)
         """
         ...
     
+    def clear_world_tiles(self) -> None:
+        """Back to drawing every world into one view."""
+        ...
+    
     # ========================================================================
     # PARAMETERS
     # ========================================================================
     
-    def set_parameter(self, name: str, value: float) -> None:
+    def set_parameter(self, name: str, value: Union[float, str]) -> None:
         """
         Set global physics parameter.
         
         Args:
-            name: Parameter name ("gravity", "damping", or "stiffness")
-            value: New parameter value
+            name: Parameter name ("gravity", "damping", "stiffness",
+                "restitution", "coupling", "drive_freq", "drive_amp",
+                "timestep", "integrator", "backend", "backend_crossover",
+                "frame_pipeline_depth", "instanced_rendering", "view_culling",
+                "sph_radius", "sph_rest_density", "sph_stiffness", "sph_gamma"
+                or "sph_viscosity")
+            value: New parameter value. "integrator" takes 0-3 or one of
+                "symplectic_euler" (default), "velocity_verlet", "yoshida4", "rk4".
+                "backend" takes "auto" (default), "gpu", "cpu" or "vulkan".
+            
+        Higher-order integrators evaluate the equations 2 (Verlet) or 4
+        (Yoshida, RK4) times per step, so they pay off with a larger
+        "timestep" (default 0.001).
+        
+        With the "auto" backend, scenes of fewer objects than
+        "backend_crossover" step on the CPU and skip the GPU's per-step
+        overhead. The crossover is measured on the first update() unless set
+        (-1 measures again). Scenes using long-range forces, polygon
+        collisions, sleeping, XPBD, worlds, emitters, recording or adaptive
+        steps always run on the GPU.
+
+        "vulkan" steps on a Vulkan compute queue apart from rendering, every
+        step of an update() in one submission, and needs a module built with
+        STELLAR_VULKAN. Beyond what "cpu" leaves out, scenes with collisions,
+        constraints, derivatives, pair sums, tables or fields, and multi-stage
+        integrators with equations reading p[i] stay on the GPU.
+
+        "frame_pipeline_depth" (0 by default, up to 4) draws each frame from
+        the newest of that many fenced copies of finished steps, so drawing
+        overlaps the next step instead of waiting for it. Frames lag the
+        state by one step.
+
+        "instanced_rendering" (1 by default) draws each object as an instance
+        of one quad; 0 expands points into quads in a geometry shader instead.
+        "view_culling" (1 by default) leaves objects outside the camera's view
+        out of the instanced draw.
+        
+        The "sph_*" parameters set the fluid of sph_ax/sph_ay: kernel radius
+        (default 0.1), rest density (1000), stiffness B and exponent gamma of
+        the Tait equation p = B*((rho/rho0)^gamma - 1) clamped at 0 (100, 7),
+        and viscosity (0.1).
             
         Raises:
-            RuntimeError: If parameter name is unknown
+            RuntimeError: If parameter name or integrator is unknown, or
+                "vulkan" is not available
         """
         ...
     
@@ -673,10 +3707,15 @@ class Simulation:
         Get current value of a global physics parameter.
         
         Args:
-            name: Parameter name ("gravity", "damping", or "stiffness")
+            name: Parameter name ("gravity", "damping", "stiffness",
+                "restitution", "coupling", "drive_freq", "drive_amp",
+                "timestep", "integrator", "backend", "backend_crossover",
+                "frame_pipeline_depth", "instanced_rendering", "view_culling"
+                or an "sph_*" parameter)
             
         Returns:
-            Current parameter value
+            Current parameter value; "backend" is 1.0 if the last update()
+            stepped on the CPU, 2.0 on Vulkan, 0.0 on the GPU
             
         Raises:
             RuntimeError: If parameter name is unknown
@@ -708,6 +3747,23 @@ class Simulation:
     def update_shader_loading(self) -> None:
         """Update shader loading status (for async shader compilation)."""
         ...
+
+    def wait_until_ready(self, timeout: float = -1.0) -> bool:
+        """
+        Block until every shader program is ready, replacing the
+        update_shader_loading() loop.
+        
+        Args:
+            timeout: Seconds to wait at most; negative (default) waits
+                as long as it takes
+        
+        Returns:
+            True when ready, False if the timeout ran out first
+        
+        Objects can be added before calling this; with a driver that
+        compiles in parallel, that setup overlaps with compilation.
+        """
+        ...
     
     def are_all_shaders_ready(self) -> bool:
         """
@@ -737,7 +3793,12 @@ class Simulation:
         ...
     
     def reset(self) -> None:
-        """Reset simulation to initial state."""
+        """Reset simulation to initial state.
+
+        The initial state is the one the first step after the last add or remove
+        started from, edits made before that step included. Objects keep the
+        equations assigned to them now. The state is restored with one GPU copy.
+        """
         ...
     
     def cleanup(self) -> None:
@@ -753,7 +3814,8 @@ class Simulation:
         filename: str,
         title: str = "",
         author: str = "",
-        description: str = ""
+        description: str = "",
+        binary: bool = False
     ) -> None:
         """
         Save simulation state to file.
@@ -763,18 +3825,148 @@ class Simulation:
             title: Optional simulation title
             author: Optional author name
             description: Optional description text
+            binary: Write a binary snapshot: raw, 64-byte aligned arrays that
+                load at close to disk speed and also restore equations,
+                constraints, collision properties and $0..$7 parameters
         """
         ...
     
     def load_from_file(self, filename: str) -> None:
         """
-        Load simulation state from file.
+        Load simulation state from file (text or binary snapshot, detected
+        from the file contents).
         
         Args:
             filename: Path to load file
         """
         ...
     
+    def checkpoint(self, path: str, full: bool = False) -> int:
+        """
+        Write an incremental checkpoint.
+        
+        The first checkpoint to a path writes a full binary snapshot; later
+        ones append only what changed since the previous checkpoint to
+        path + ".delta". The write runs in the background.
+        
+        Args:
+            path: Base snapshot path
+            full: Start a new base even if one exists
+        
+        Returns:
+            Delta sequence number, 0 for a new base
+        """
+        ...
+    
+    def restore_checkpoint(self, path: str) -> int:
+        """
+        Load the base snapshot at path and replay its deltas.
+        
+        Args:
+            path: Base snapshot path passed to checkpoint()
+        
+        Returns:
+            Number of deltas applied
+        """
+        ...
+    
+    def cache_scene(self, name: str) -> None:
+        """
+        Keep the current scene resident in VRAM under a name.
+        
+        The objects are copied into a GPU buffer of their own, and the
+        equations, constraints, collision properties, parameters and
+        simulation settings are kept with them, so activate_scene() can bring
+        the scene back without reloading or re-uploading it. Caching a name
+        again replaces its scene.
+        
+        Args:
+            name: Name to activate the scene by
+        
+        Example:
+            >>> sim.load_from_file("cloth.scene"); sim.cache_scene("cloth")
+            >>> sim.load_from_file("galaxy.scene"); sim.cache_scene("galaxy")
+            >>> sim.activate_scene("cloth")
+        """
+        ...
+    
+    def activate_scene(self, name: str) -> None:
+        """
+        Replace the current scene with a cached one.
+        
+        The objects are copied from the cache into the object buffers on the
+        GPU; only the small host tables (equations, constraints, collision
+        properties) are set again. The cached copy stays as it was cached, so
+        activating it again starts over.
+        
+        Args:
+            name: Name given to cache_scene()
+        
+        Raises:
+            RuntimeError: If no scene is cached under name
+        """
+        ...
+    
+    def remove_cached_scene(self, name: str) -> None:
+        """Free a cached scene's VRAM. Unknown names are ignored."""
+        ...
+    
+    def get_cached_scenes(self) -> List[str]:
+        """Get the names of the cached scenes, in sorted order."""
+        ...
+    
+    def get_scene_cache_bytes(self) -> int:
+        """Get the VRAM the cached scenes' objects hold, in bytes."""
+        ...
+    
+    def enable_history(self, n_snapshots: int, every_k_steps: int = 1) -> None:
+        """
+        Keep a GPU ring of recent states to rewind to.
+        
+        Every every_k_steps steps the objects are copied into the next slot
+        of a ring in VRAM, overwriting the oldest once n_snapshots are held;
+        one snapshot is also taken right away. Nothing is read back. Fused
+        substeps stop at every snapshot step. Host-side tables (constraints,
+        equations, collision properties) are not part of the history.
+        
+        Args:
+            n_snapshots: Ring size, 0 = off
+            every_k_steps: Steps between snapshots (default 1)
+        
+        Example:
+            >>> sim.enable_history(300, every_k_steps=2)   # the last 600 steps
+        """
+        ...
+    
+    def disable_history(self) -> None:
+        """Turn the history off and free its ring."""
+        ...
+    
+    def rewind(self, k: int = 1) -> float:
+        """
+        Restore a snapshot of the history.
+        
+        The snapshot is copied back into the object buffers in VRAM and the
+        simulation time goes back to when it was taken. Snapshots newer than
+        it are dropped; it stays the newest, so rewind(1) again returns to
+        the same state.
+        
+        Args:
+            k: Snapshot to restore, 1 = the newest (default 1)
+        
+        Returns:
+            Simulation time of the restored state
+        
+        Raises:
+            RuntimeError: If fewer than k snapshots are held, or objects were
+                added or removed since the snapshot
+        """
+        ...
+    
+    def get_history_times(self) -> List[float]:
+        """Simulation times of the held snapshots, oldest first; rewind(1) restores the last one."""
+        ...
+    
     # ========================================================================
     # PROPERTIES
     # ========================================================================
@@ -808,5 +4000,38 @@ class PyCollisionShape:
     AABB: ClassVar[int]    # Axis-aligned bounding box
     POLYGON: ClassVar[int] # Polygonal collision
 
+# Multi-GPU batches (hyperstellar.batch_scheduler)
+def run_batch_parallel(
+    configs: List[BatchConfig],
+    devices: Union[int, List[Dict[str, str]]],
+    callback: Optional[Callable[[int, List[ObjectState]], None]] = None,
+    ensemble: bool = False,
+    chunk_size: int = 1
+) -> List[List[ObjectState]]:
+    """
+    Run BatchConfigs across several GPUs, one headless worker process each.
+    
+    Workers pull configs from a shared queue, so faster devices take on
+    more of the work. Must be called from under `if __name__ == "__main__":`
+    since the workers are spawned.
+    
+    Args:
+        configs: Configurations to run
+        devices: Number of workers, or environment variables per worker,
+            applied before its GL context is created (e.g.
+            STELLAR_EGL_DEVICE per GPU on Linux, DISPLAY per X screen,
+            DRI_PRIME with Mesa)
+        callback: Called in config order in this process as results arrive
+        ensemble: Passed to each worker's run_batch
+        chunk_size: Configs per work item
+    
+    Returns:
+        Final object states per config, in config order
+    
+    Raises:
+        RuntimeError: If no worker starts or a config fails
+    """
+    ...
+
 # Version information
 __version__: str
\ No newline at end of file
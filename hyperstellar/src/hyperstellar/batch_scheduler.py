@@ -0,0 +1,141 @@
+# hyperstellar/src/hyperstellar/batch_scheduler.py
+"""
+Spread run_batch() work over several GPUs.
+
+All simulation state of the native module is per process (one GL context,
+file-static buffers), so a Simulation cannot share a process with another
+device. The scheduler starts one worker process per device instead; each
+creates its own headless context and pulls configs from a shared queue, so a
+worker that finishes early takes over work the others have not started.
+Results are merged back in config order.
+"""
+import multiprocessing
+import os
+import queue as _queue
+
+# Configs handed out per queue item; small keeps the tail balanced, large
+# amortises the queue round trips of many tiny configs
+DEFAULT_CHUNK_SIZE = 1
+
+
+def _worker(environment, ensemble, tasks, results):
+    # Applied before the context exists, so it decides which adapter the driver picks
+    os.environ.update(environment)
+
+    import hyperstellar
+
+    try:
+        sim = hyperstellar.Simulation(headless=True, enable_grid=False)
+    except Exception as error:
+        results.put(("error", None, repr(error)))
+        return
+
+    try:
+        while True:
+            item = tasks.get()
+            if item is None:
+                break
+            first, configs = item
+            states = [None] * len(configs)
+
+            def collect(index, objects):
+                states[index] = list(objects)
+
+            try:
+                sim.run_batch(configs, collect, ensemble)
+            except Exception as error:
+                results.put(("error", first, repr(error)))
+                continue
+            results.put(("done", first, states))
+    finally:
+        sim.cleanup()
+
+
+def _device_environments(devices):
+    if isinstance(devices, int):
+        if devices < 1:
+            raise ValueError("devices must be at least 1")
+        return [{} for _ in range(devices)]
+    environments = [dict(environment) for environment in devices]
+    if not environments:
+        raise ValueError("devices must not be empty")
+    return environments
+
+
+def run_batch_parallel(configs, devices, callback=None, ensemble=False, chunk_size=DEFAULT_CHUNK_SIZE):
+    """
+    Run BatchConfigs across several GPUs, one headless worker process each.
+
+    Args:
+        configs: List of BatchConfig
+        devices: Number of workers, or one mapping of environment variables
+            per worker, applied before its GL context is created. Which
+            variables select an adapter depends on the platform and driver,
+            e.g. {"STELLAR_EGL_DEVICE": "1"} for the second GPU on a
+            display-less Linux node, {"DISPLAY": ":0.1"} for one X screen
+            per GPU or {"DRI_PRIME": "1"} with Mesa.
+        callback: Optional callback(batch_index, results), called in the
+            parent process in config order as results arrive
+        ensemble: Passed to each worker's run_batch for its chunk of configs
+        chunk_size: Configs per work item
+
+    Returns:
+        List with the final ObjectState list of every config, in config order
+
+    Raises:
+        RuntimeError: If a worker fails to start or a config fails to run
+    """
+    configs = list(configs)
+    environments = _device_environments(devices)
+    chunk_size = max(1, int(chunk_size))
+
+    context = multiprocessing.get_context("spawn")
+    tasks = context.Queue()
+    results = context.Queue()
+
+    chunks = [(first, configs[first:first + chunk_size]) for first in range(0, len(configs), chunk_size)]
+    for chunk in chunks:
+        tasks.put(chunk)
+    for _ in environments:
+        tasks.put(None)
+
+    workers = [context.Process(target=_worker, args=(environment, ensemble, tasks, results), daemon=True)
+               for environment in environments[:max(1, len(chunks))]]
+    for worker in workers:
+        worker.start()
+
+    merged = [None] * len(configs)
+    ready = 0          # Configs [0, ready) were passed to callback
+    remaining = len(chunks)
+    startup_error = None
+    try:
+        while remaining > 0:
+            try:
+                status, first, payload = results.get(timeout=1.0)
+            except _queue.Empty:
+                if not any(worker.is_alive() for worker in workers):
+                    raise RuntimeError(startup_error or "All batch workers exited before finishing")
+                continue
+
+            if status == "error":
+                if first is None:
+                    # This worker never took a config; the others carry on
+                    startup_error = "Batch worker failed to start: " + payload
+                    continue
+                raise RuntimeError("Config %d failed: %s" % (first, payload))
+
+            remaining -= 1
+            for offset, states in enumerate(payload):
+                merged[first + offset] = states
+            while ready < len(configs) and merged[ready] is not None:
+                if callback is not None:
+                    callback(ready, merged[ready])
+                ready += 1
+    except BaseException:
+        for worker in workers:
+            worker.terminate()
+        raise
+
+    for worker in workers:
+        worker.join()
+    return merged
@@ -0,0 +1,130 @@
+# Type stubs for hyperstellar.expr (the stellar.expr submodule)
+"""
+Build equations from Python operators instead of strings.
+
+Every variable of the equation syntax is an attribute (expr.x, expr.vx,
+expr.s0), functions are functions (expr.sin, expr.if_ for if), and objects
+are expr.p(3).vx; numbers mix in freely. The expression goes to the engine
+already in parsed form: generating thousands of equations skips formatting
+and parsing them.
+
+Example:
+    >>> from stellar import expr as se
+    >>> spring = -se.k * (se.x - se.p(0).x) - se.damping * se.vx
+    >>> sim.set_equations(ids, [se.Equation(ax=spring * (1 + 0.1 * n), ay=-se.gravity) for n in ids])
+"""
+from typing import Dict, List, Optional, Union
+
+_Operand = Union["Expr", float]
+
+class Expr:
+    """
+    A scalar expression of the equation syntax.
+
+    Combine with +, -, *, /, ** and numbers. text is the same expression as
+    a string, which set_equation("ax = ...") would parse to the same
+    equation. An Expr has no truth value (bool() raises TypeError); use
+    if_() for conditions.
+    """
+
+    text: str  # The expression in the equation syntax
+
+    def __init__(self, value: float) -> None:
+        """A constant."""
+        ...
+
+    def __add__(self, other: _Operand) -> Expr: ...
+    def __radd__(self, other: _Operand) -> Expr: ...
+    def __sub__(self, other: _Operand) -> Expr: ...
+    def __rsub__(self, other: _Operand) -> Expr: ...
+    def __mul__(self, other: _Operand) -> Expr: ...
+    def __rmul__(self, other: _Operand) -> Expr: ...
+    def __truediv__(self, other: _Operand) -> Expr: ...
+    def __rtruediv__(self, other: _Operand) -> Expr: ...
+    def __pow__(self, other: _Operand) -> Expr: ...
+    def __rpow__(self, other: _Operand) -> Expr: ...
+    def __neg__(self) -> Expr: ...
+    def __pos__(self) -> Expr: ...
+    def __bool__(self) -> bool:
+        """Raises TypeError: an Expr has no truth value."""
+        ...
+
+class ObjectRef:
+    """
+    Properties of one object, as p[index] in equations: x, y, vx, vy, ax, ay,
+    mass, charge, data_x .. data_w, color_r .. color_a.
+    """
+
+    index: int
+
+    def __getattr__(self, property: str) -> Expr: ...
+
+class Equation:
+    """
+    The components of one equation, for Simulation.set_equation and set_equations.
+
+    Args:
+        ax, ay, angular: Accelerations; left out ones are as in an equation
+            without them
+        color: color.r, color.g, color.b and optionally color.a
+        state: Updates of state registers sK
+
+    Raises:
+        ValueError: If color has other than 3 or 4 expressions, a state
+            register is out of range, or no component is given
+    """
+
+    text: str  # The equation in statement form, its registration key
+
+    def __init__(self, ax: Optional[_Operand] = None, ay: Optional[_Operand] = None,
+                 angular: Optional[_Operand] = None, color: List[_Operand] = [],
+                 state: Dict[int, _Operand] = {}) -> None: ...
+
+def var(name: str) -> Expr:
+    """Variable name of the equation syntax, e.g. var("sph_rho")."""
+    ...
+
+def param(k: int) -> Expr:
+    """Per-object parameter $k (see Simulation.set_parameters)."""
+    ...
+
+def p(index: int) -> ObjectRef:
+    """Object index, as p[index] in equations."""
+    ...
+
+def sin(a: _Operand) -> Expr: ...
+def cos(a: _Operand) -> Expr: ...
+def tan(a: _Operand) -> Expr: ...
+def sqrt(a: _Operand) -> Expr: ...
+def log(a: _Operand) -> Expr: ...
+def exp(a: _Operand) -> Expr: ...
+def abs(a: _Operand) -> Expr: ...
+def floor(a: _Operand) -> Expr: ...
+def ceil(a: _Operand) -> Expr: ...
+def frac(a: _Operand) -> Expr: ...
+def sign(a: _Operand) -> Expr: ...
+def step(a: _Operand) -> Expr: ...
+def real(a: _Operand) -> Expr: ...
+def imag(a: _Operand) -> Expr: ...
+def conj(a: _Operand) -> Expr: ...
+def arg(a: _Operand) -> Expr: ...
+
+def min(a: _Operand, b: _Operand) -> Expr: ...
+def max(a: _Operand, b: _Operand) -> Expr: ...
+def mod(a: _Operand, b: _Operand) -> Expr: ...
+def atan2(a: _Operand, b: _Operand) -> Expr: ...
+def table(a: _Operand, b: _Operand) -> Expr: ...
+
+def clamp(a: _Operand, lo: _Operand, hi: _Operand) -> Expr: ...
+
+def field(id: _Operand, x: _Operand, y: _Operand) -> Expr:
+    """Bilinear sample of lookup field id (see Simulation.set_field)."""
+    ...
+
+def if_(condition: _Operand, a: _Operand, b: _Operand) -> Expr:
+    """if(condition, a, b) of the equation syntax."""
+    ...
+
+# Every other name is a variable of the equation syntax (x, vx, t, k, s0, ...),
+# resolved on first access; unknown names raise AttributeError
+def __getattr__(name: str) -> Expr: ...
@@ -0,0 +1,53 @@
+#ifndef ADAPTIVE_TIMESTEP_H
+#define ADAPTIVE_TIMESTEP_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// SSBO bindings of the GPU-side step state read by math.comp and its dt history
+const int TIMESTEP_STATE_BINDING = 25;
+const int TIMESTEP_HISTORY_BINDING = 26;
+
+// Steps kept in the dt history ring - MUST MATCH timestep.comp
+const int TIMESTEP_HISTORY_SIZE = 1024;
+
+// Adaptive global time step: after every step a reduction over all objects picks the
+// next dt from min(courant * size / |v|, courant * sqrt(size / |a|)), clamped to the
+// bounds. dt and the simulation time stay on the GPU, where math.comp reads them, so
+// choosing a step never waits for a readback; the host only sees them a few frames late.
+namespace AdaptiveTimestep
+{
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // Start adaptive stepping from the given dt (clamped to the bounds) and time
+    void Reset(float dt, float time);
+
+    // Reduce the post-step object buffer into the dt of the next step; false if the shader is not ready
+    bool Estimate(GLuint objectSSBO, int numObjects);
+
+    // Bind the step state for math.comp
+    void Bind();
+    void Unbind();
+
+    // Parameters
+    void SetParameters(float minDt, float maxDt, float courant);
+    float GetMinDt();
+    float GetMaxDt();
+    float GetCourant();
+
+    // Last dt and time the GPU reported, a few steps behind; never blocks
+    void GetLatest(float& dt, float& time);
+
+    // dt of the most recent steps, oldest first (reads the history back, for profiling)
+    std::vector<float> GetHistory();
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // ADAPTIVE_TIMESTEP_H
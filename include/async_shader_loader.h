@@ -9,14 +9,13 @@
 #include <cstdio>
 #include <iostream>
 #include <mutex>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
 #include <glad/glad.h>
-
-// Platform-specific includes for module path detection
-#ifdef _WIN32
-#include <windows.h>
-#else
-#include <dlfcn.h>
-#endif
+#include "embedded_shaders.h"
 
 enum class ShaderLoadState
 {
@@ -49,106 +48,57 @@ struct ShaderSources
     std::string geometry;
     std::string fragment;
     std::string compute;
+    std::string hash;  // Embedded hashes of the stages, empty when some stage has none or was rewritten
     bool isCompute = false;
     bool hasGeometry = false;
 };
 
-// Helper function to get shader path relative to module location
-static std::string GetShaderPath(const std::string& shaderName) {
-    static std::string shaderBasePath;
-
-    if (shaderBasePath.empty()) {
-#ifdef _WIN32
-        // Get path to this DLL/.pyd
-        char modulePath[1024];
-        HMODULE hm = NULL;
-
-        // Get the address of this function to locate our module
-        if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
-            GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
-            (LPCSTR)&GetShaderPath, &hm)) {
-            GetModuleFileNameA(hm, modulePath, sizeof(modulePath));
-
-            // Extract directory and add "shaders/"
-            std::string fullPath(modulePath);
-            size_t lastSlash = fullPath.find_last_of("\\/");
-            if (lastSlash != std::string::npos) {
-                shaderBasePath = fullPath.substr(0, lastSlash + 1) + "shaders\\";
-                std::cout << "[ShaderLoader] Module located at: " << fullPath << std::endl;
-                std::cout << "[ShaderLoader] Shader directory: " << shaderBasePath << std::endl;
-
-                // Debug: Check if directory exists
+// Linked programs are cached with glGetProgramBinary so warm starts skip compilation. Entries are
+// named by a hash of the sources and the driver strings, and hold the full key, which is compared
+// on load. STELLAR_SHADER_CACHE overrides the directory; set it empty or to 0 to disable the cache.
+static std::string GetProgramCacheDirectory() {
+    if (const char* overridePath = std::getenv("STELLAR_SHADER_CACHE"))
+        return (overridePath[0] == '\0' || std::string(overridePath) == "0") ? "" : overridePath;
 #ifdef _WIN32
-                DWORD attrib = GetFileAttributesA(shaderBasePath.c_str());
-                if (attrib == INVALID_FILE_ATTRIBUTES || !(attrib & FILE_ATTRIBUTE_DIRECTORY)) {
-                    std::cerr << "[ShaderLoader] WARNING: Shader directory not found: " << shaderBasePath << std::endl;
-                }
-                else {
-                    std::cout << "[ShaderLoader] ✓ Shader directory exists" << std::endl;
-                }
-#endif
-            }
-            else {
-                std::cerr << "[ShaderLoader] WARNING: Could not extract directory from: " << fullPath << std::endl;
-                shaderBasePath = "./shaders/";
-            }
-        }
-        else {
-            std::cerr << "[ShaderLoader] WARNING: Could not get module handle, using default path" << std::endl;
-            shaderBasePath = "./shaders/";
-        }
+    const char* base = std::getenv("LOCALAPPDATA");
+    return base ? std::string(base) + "\\hyperstellar\\shader_cache" : "";
 #else
-        // Linux/macOS: use dladdr to get module path
-        Dl_info info;
-        if (dladdr((void*)&GetShaderPath, &info)) {
-            std::string fullPath(info.dli_fname);
-            size_t lastSlash = fullPath.find_last_of("/");
-            if (lastSlash != std::string::npos) {
-                shaderBasePath = fullPath.substr(0, lastSlash + 1) + "shaders/";
-            }
-            else {
-                shaderBasePath = "./shaders/";
-            }
-        }
-        else {
-            shaderBasePath = "./shaders/";
-        }
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && xdg[0] != '\0') return std::string(xdg) + "/hyperstellar/shaders";
+    const char* home = std::getenv("HOME");
+    return home ? std::string(home) + "/.cache/hyperstellar/shaders" : "";
 #endif
-
-        std::cout << "[ShaderLoader] Using shader base path: " << shaderBasePath << std::endl;
-    }
-
-    return shaderBasePath + shaderName;
 }
 
-// Helper function to strip UTF-8 BOM from string
-static std::string StripUTF8BOM(const std::string& content) {
-    if (content.size() >= 3) {
-        // Check for UTF-8 BOM: EF BB BF
-        unsigned char bom[3] = {
-            (unsigned char)content[0],
-            (unsigned char)content[1],
-            (unsigned char)content[2]
-        };
-
-        if (bom[0] == 0xEF && bom[1] == 0xBB && bom[2] == 0xBF) {
-            std::cout << "[AsyncLoader] ✓ Stripped UTF-8 BOM (3 bytes)" << std::endl;
-            return content.substr(3);
-        }
-
-        // Also check for UTF-16 BOM patterns (though less likely for GLSL)
-        if (bom[0] == 0xFF && bom[1] == 0xFE) {
-            std::cout << "[AsyncLoader] ✓ Stripped UTF-16 LE BOM (2 bytes)" << std::endl;
-            return content.substr(2);
-        }
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1  // GL_KHR_parallel_shader_compile
+#endif
 
-        if (bom[0] == 0xFE && bom[1] == 0xFF) {
-            std::cout << "[AsyncLoader] ✓ Stripped UTF-16 BE BOM (2 bytes)" << std::endl;
-            return content.substr(2);
+// The driver's default compiler thread count (GL_MAX_SHADER_COMPILER_THREADS_KHR) is already
+// unlimited, so only the completion query is needed. Needs a current context on first call.
+static bool ParallelShaderCompileSupported() {
+    static int supported = -1;
+    if (supported < 0) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        supported = 0;
+        for (GLint i = 0; i < count && !supported; i++) {
+            const GLubyte* name = glGetStringi(GL_EXTENSIONS, i);
+            if (name && (std::string(reinterpret_cast<const char*>(name)) == "GL_KHR_parallel_shader_compile" ||
+                         std::string(reinterpret_cast<const char*>(name)) == "GL_ARB_parallel_shader_compile"))
+                supported = 1;
         }
+        std::cout << "[AsyncLoader] Parallel shader compile: " << (supported ? "yes" : "no") << std::endl;
     }
+    return supported == 1;
+}
 
-    return content;
+static uint64_t HashShaderText(const std::string& text, uint64_t hash = 14695981039346656037ull) {
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;  // FNV-1a
+    }
+    return hash;
 }
 
 class AsyncShaderLoader
@@ -162,6 +112,10 @@ public:
     ~AsyncShaderLoader()
     {
         // Clean up any OpenGL resources if shader was created
+        for (int i = 0; i < m_shaderCount; i++)
+            glDeleteShader(m_shaders[i].shader);
+        if (m_pendingProgram != 0)
+            glDeleteProgram(m_pendingProgram);
         if (m_program != 0)
         {
             glDeleteProgram(m_program);
@@ -175,8 +129,25 @@ public:
         std::function<void(const std::string&)> onError)
     {
         ShaderPaths paths;
-        paths.compute = computePath;  // Just filename, GetShaderPath will add directory
-        LoadShaderAsync(paths, onComplete, onError);
+        paths.compute = computePath;  // File name in shaders/, looked up in the embedded table
+        LoadShaderAsync(paths, nullptr, onComplete, onError);
+    }
+
+    // Load compute shader, rewriting its source before compilation (empty result = failure)
+    void LoadComputeShaderAsync(const std::string& computePath,
+        std::function<std::string(const std::string&)> transformSource,
+        std::function<void(GLuint)> onComplete,
+        std::function<void(const std::string&)> onError)
+    {
+        if (IsLoading())
+        {
+            std::cout << "[AsyncLoader] Already loading, ignoring request" << std::endl;
+            return;
+        }
+
+        ShaderPaths paths;
+        paths.compute = computePath;
+        LoadShaderAsync(paths, transformSource, onComplete, onError);
     }
 
     // Load graphics pipeline (vert + frag + optional geom)
@@ -190,7 +161,7 @@ public:
         paths.vertex = vertPath;      // Just filename
         paths.fragment = fragPath;    // Just filename
         paths.geometry = geomPath;    // Just filename
-        LoadShaderAsync(paths, onComplete, onError);
+        LoadShaderAsync(paths, nullptr, onComplete, onError);
     }
 
     // MUST be called from main thread (OpenGL context thread)
@@ -212,6 +183,10 @@ public:
 
             CompileShadersOnMainThread();
         }
+        else if (m_pendingProgram != 0 && !ProgramPending())
+        {
+            FinishProgram();
+        }
 
         // Check if we just completed AND haven't called callback yet
         if (m_state == ShaderLoadState::COMPLETE && m_onComplete)
@@ -286,7 +261,10 @@ public:
     }
 
 private:
+    // Reads the files; with parallel compile the build is queued right away, otherwise on the
+    // next Update()
     void LoadShaderAsync(const ShaderPaths& paths,
+        std::function<std::string(const std::string&)> transformSource,
         std::function<void(GLuint)> onComplete,
         std::function<void(const std::string&)> onError)
     {
@@ -306,8 +284,7 @@ private:
         m_onError = onError;
         m_program = 0;
 
-        // CRITICAL FIX: Read files on MAIN THREAD to avoid MinGW file I/O issues
-        std::cout << "[AsyncLoader] Reading shader files on main thread..." << std::endl;
+        std::cout << "[AsyncLoader] Looking up shader sources..." << std::endl;
         std::flush(std::cout);
 
         ShaderSources sources;
@@ -319,79 +296,34 @@ private:
         std::flush(std::cout);
 
         try {
-            // Read vertex shader
-            if (!paths.vertex.empty())
-            {
-                std::string fullPath = GetShaderPath(paths.vertex);
-                std::cout << "[AsyncLoader] Reading vertex: " << fullPath << std::endl;
-                std::flush(std::cout);
-                std::string rawContent = ReadTextFile(fullPath);
-                sources.vertex = StripUTF8BOM(rawContent);
-
-                if (sources.vertex.empty())
-                {
-                    SetError("Failed to read vertex shader: " + fullPath);
-                    return;
-                }
-                std::cout << "[AsyncLoader] ✓ Vertex shader loaded (" << sources.vertex.length() << " bytes)" << std::endl;
-                std::flush(std::cout);
-            }
-
-            // Read geometry shader (optional)
-            if (!paths.geometry.empty())
+            // Sources come from the table built into the binary (embedded_shaders.h)
+            bool allHashed = true;
+            auto readStage = [&](const std::string& name, const char* typeName, std::string& source, bool optional) -> bool
             {
-                std::string fullPath = GetShaderPath(paths.geometry);
-                std::cout << "[AsyncLoader] Reading geometry: " << fullPath << std::endl;
-                std::flush(std::cout);
-                std::string rawContent = ReadTextFile(fullPath);
-                sources.geometry = StripUTF8BOM(rawContent);
-
-                if (!sources.geometry.empty())
-                {
-                    std::cout << "[AsyncLoader] ✓ Geometry shader loaded (" << sources.geometry.length() << " bytes)" << std::endl;
-                }
-                else
+                if (name.empty()) return true;
+                std::string hash;
+                if (!LoadShaderSource(name, source, hash))
                 {
-                    std::cout << "[AsyncLoader] ⚠ Geometry shader empty (optional)" << std::endl;
+                    if (optional)
+                    {
+                        std::cout << "[AsyncLoader] ⚠ " << typeName << " shader " << name << " missing (optional)" << std::endl;
+                        return true;
+                    }
+                    SetError(std::string("Shader not found: ") + name + " (" + typeName + ")");
+                    return false;
                 }
-                std::flush(std::cout);
-            }
-
-            // Read fragment shader
-            if (!paths.fragment.empty())
-            {
-                std::string fullPath = GetShaderPath(paths.fragment);
-                std::cout << "[AsyncLoader] Reading fragment: " << fullPath << std::endl;
-                std::flush(std::cout);
-                std::string rawContent = ReadTextFile(fullPath);
-                sources.fragment = StripUTF8BOM(rawContent);
-
-                if (sources.fragment.empty())
-                {
-                    SetError("Failed to read fragment shader: " + fullPath);
-                    return;
-                }
-                std::cout << "[AsyncLoader] ✓ Fragment shader loaded (" << sources.fragment.length() << " bytes)" << std::endl;
-                std::flush(std::cout);
-            }
-
-            // Read compute shader
-            if (!paths.compute.empty())
-            {
-                std::string fullPath = GetShaderPath(paths.compute);
-                std::cout << "[AsyncLoader] Reading compute: " << fullPath << std::endl;
-                std::flush(std::cout);
-                std::string rawContent = ReadTextFile(fullPath);
-                sources.compute = StripUTF8BOM(rawContent);
-
-                if (sources.compute.empty())
-                {
-                    SetError("Failed to read compute shader: " + fullPath);
-                    return;
-                }
-                std::cout << "[AsyncLoader] ✓ Compute shader loaded (" << sources.compute.length() << " bytes)" << std::endl;
-                std::flush(std::cout);
-            }
+                std::cout << "[AsyncLoader] ✓ " << typeName << " shader " << name << " (" << source.length() << " bytes)" << std::endl;
+                if (hash.empty()) allHashed = false;
+                sources.hash += hash + ";";
+                return true;
+            };
+
+            if (!readStage(paths.vertex, "Vertex", sources.vertex, false) ||
+                !readStage(paths.geometry, "Geometry", sources.geometry, true) ||
+                !readStage(paths.fragment, "Fragment", sources.fragment, false) ||
+                !readStage(paths.compute, "Compute", sources.compute, false))
+                return;
+            if (!allHashed) sources.hash.clear();
 
             // Store sources
             m_sources = sources;
@@ -414,144 +346,139 @@ private:
             std::flush(std::cerr);
             SetError("Unknown exception during file loading");
         }
+        if (m_state != ShaderLoadState::FILES_READY) return;
+
+        if (transformSource)
+        {
+            m_sources.compute = transformSource(m_sources.compute);
+            m_sources.hash.clear();
+            if (m_sources.compute.empty())
+            {
+                SetError("Source transform failed for compute shader: " + paths.compute);
+                return;
+            }
+        }
+
+        if (ParallelShaderCompileSupported())
+            CompileShadersOnMainThread();
     }
 
-    // Main thread - OpenGL compilation
+    // Main thread - OpenGL compilation. With GL_KHR_parallel_shader_compile the compile and link
+    // calls only queue work on the driver's compiler threads; Update() polls
+    // GL_COMPLETION_STATUS_KHR and finishes the program once it has linked, so every loader's
+    // program builds at the same time. Without it the status queries block, as before.
     void CompileShadersOnMainThread()
     {
         ShaderSources sources = m_sources;
 
-        GLuint vertShader = 0, geomShader = 0, fragShader = 0, compShader = 0;
+        ProgramCacheEntry(sources, m_cacheKey, m_cacheFile);
+        if (!m_cacheFile.empty())
+        {
+            if (GLuint cached = LoadCachedProgram(m_cacheFile, m_cacheKey))
+            {
+                m_program = cached;
+                m_progress = 1.0f;
+                m_state = ShaderLoadState::COMPLETE;
+                std::cout << "[AsyncLoader] ✓ Program loaded from cache: " << m_cacheFile << std::endl;
+                std::flush(std::cout);
+                return;
+            }
+        }
 
+        m_shaderCount = 0;
         if (sources.isCompute)
         {
-            // Compute shader pipeline
             m_state = ShaderLoadState::COMPILING_COMPUTE;
             m_progress = 0.2f;
-
-            std::cout << "[AsyncLoader] Compiling compute shader..." << std::endl;
-            std::flush(std::cout);
-
-            compShader = CompileShader(GL_COMPUTE_SHADER, sources.compute, "compute");
-            if (compShader == 0)
-                return;
-
-            m_progress = 0.8f;
+            QueueShader(GL_COMPUTE_SHADER, sources.compute, "compute");
         }
         else
         {
-            // Graphics pipeline
-            float progressStep = sources.hasGeometry ? 0.2f : 0.3f;
-            float currentProgress = 0.1f;
-
-            // Vertex shader
             m_state = ShaderLoadState::COMPILING_VERTEX;
-            currentProgress += 0.05f;
-            m_progress = currentProgress;
-
-            std::cout << "[AsyncLoader] Compiling vertex shader..." << std::endl;
-            std::flush(std::cout);
-
-            vertShader = CompileShader(GL_VERTEX_SHADER, sources.vertex, "vertex");
-            if (vertShader == 0)
-                return;
-
-            currentProgress += progressStep;
-            m_progress = currentProgress;
-
-            // Geometry shader (optional)
+            m_progress = 0.2f;
+            QueueShader(GL_VERTEX_SHADER, sources.vertex, "vertex");
             if (sources.hasGeometry && !sources.geometry.empty())
             {
                 m_state = ShaderLoadState::COMPILING_GEOMETRY;
-                currentProgress += 0.05f;
-                m_progress = currentProgress;
-
-                std::cout << "[AsyncLoader] Compiling geometry shader..." << std::endl;
-                std::flush(std::cout);
-
-                geomShader = CompileShader(GL_GEOMETRY_SHADER, sources.geometry, "geometry");
-                if (geomShader == 0)
-                {
-                    glDeleteShader(vertShader);
-                    return;
-                }
-
-                currentProgress += progressStep;
-                m_progress = currentProgress;
+                QueueShader(GL_GEOMETRY_SHADER, sources.geometry, "geometry");
             }
-
-            // Fragment shader
             m_state = ShaderLoadState::COMPILING_FRAGMENT;
-            currentProgress += 0.05f;
-            m_progress = currentProgress;
-
-            std::cout << "[AsyncLoader] Compiling fragment shader..." << std::endl;
-            std::flush(std::cout);
-
-            fragShader = CompileShader(GL_FRAGMENT_SHADER, sources.fragment, "fragment");
-            if (fragShader == 0)
-            {
-                glDeleteShader(vertShader);
-                if (geomShader)
-                    glDeleteShader(geomShader);
-                return;
-            }
-
-            m_progress = 0.8f;
+            QueueShader(GL_FRAGMENT_SHADER, sources.fragment, "fragment");
         }
 
-        // Link program
+        // Linking right away is allowed: the link waits for the compiles on the driver's side
         m_state = ShaderLoadState::LINKING;
-        m_progress = 0.85f;
-
+        m_progress = 0.5f;
         std::cout << "[AsyncLoader] Linking shader program..." << std::endl;
         std::flush(std::cout);
 
-        GLuint program = glCreateProgram();
+        m_pendingProgram = glCreateProgram();
+        if (!m_cacheFile.empty())
+            glProgramParameteri(m_pendingProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        for (int i = 0; i < m_shaderCount; i++)
+            glAttachShader(m_pendingProgram, m_shaders[i].shader);
+        glLinkProgram(m_pendingProgram);
+
+        if (!ParallelShaderCompileSupported())
+            FinishProgram();
+    }
+
+    // Still building on the driver's compiler threads
+    bool ProgramPending() const
+    {
+        if (m_pendingProgram == 0) return false;
+        GLint done = GL_FALSE;
+        glGetProgramiv(m_pendingProgram, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_FALSE;
+    }
+
+    void FinishProgram()
+    {
+        GLuint program = m_pendingProgram;
+        m_pendingProgram = 0;
 
-        if (compShader)
+        std::string error;
+        for (int i = 0; i < m_shaderCount && error.empty(); i++)
         {
-            glAttachShader(program, compShader);
+            GLint success;
+            glGetShaderiv(m_shaders[i].shader, GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                char infoLog[1024];
+                glGetShaderInfoLog(m_shaders[i].shader, 1024, nullptr, infoLog);
+                error = std::string(m_shaders[i].typeName) + " shader compilation failed:\n" + infoLog;
+            }
+            else
+            {
+                std::cout << "[AsyncLoader] ✓ " << m_shaders[i].typeName << " shader compiled" << std::endl;
+            }
         }
-        else
+
+        GLint linked = GL_FALSE;
+        if (error.empty())
         {
-            glAttachShader(program, vertShader);
-            if (geomShader)
-                glAttachShader(program, geomShader);
-            glAttachShader(program, fragShader);
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            if (!linked)
+            {
+                char infoLog[1024];
+                glGetProgramInfoLog(program, 1024, nullptr, infoLog);
+                error = std::string("Program linking failed:\n") + infoLog;
+            }
         }
 
-        glLinkProgram(program);
+        for (int i = 0; i < m_shaderCount; i++)
+            glDeleteShader(m_shaders[i].shader);
+        m_shaderCount = 0;
 
-        GLint success;
-        glGetProgramiv(program, GL_LINK_STATUS, &success);
-        if (!success)
+        if (!error.empty())
         {
-            char infoLog[1024];
-            glGetProgramInfoLog(program, 1024, nullptr, infoLog);
-            SetError(std::string("Program linking failed:\n") + infoLog);
-
-            if (compShader)
-                glDeleteShader(compShader);
-            if (vertShader)
-                glDeleteShader(vertShader);
-            if (geomShader)
-                glDeleteShader(geomShader);
-            if (fragShader)
-                glDeleteShader(fragShader);
             glDeleteProgram(program);
+            SetError(error);
             return;
         }
 
-        // Cleanup shaders
-        if (compShader)
-            glDeleteShader(compShader);
-        if (vertShader)
-            glDeleteShader(vertShader);
-        if (geomShader)
-            glDeleteShader(geomShader);
-        if (fragShader)
-            glDeleteShader(fragShader);
+        if (!m_cacheFile.empty())
+            SaveCachedProgram(program, m_cacheFile, m_cacheKey);
 
         m_program = program;
         m_progress = 1.0f;
@@ -561,89 +488,135 @@ private:
         std::flush(std::cout);
     }
 
-    GLuint CompileShader(GLenum type, const std::string& source, const char* typeName)
+    void QueueShader(GLenum type, const std::string& source, const char* typeName)
     {
+        std::cout << "[AsyncLoader] Compiling " << typeName << " shader..." << std::endl;
+        std::flush(std::cout);
+
         GLuint shader = glCreateShader(type);
         const char* src = source.c_str();
         glShaderSource(shader, 1, &src, nullptr);
         glCompileShader(shader);
-
-        GLint success;
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-        if (!success)
-        {
-            char infoLog[1024];
-            glGetShaderInfoLog(shader, 1024, nullptr, infoLog);
-            SetError(std::string(typeName) + " shader compilation failed:\n" + infoLog);
-            glDeleteShader(shader);
-            return 0;
-        }
-
-        std::cout << "[AsyncLoader] ✓ " << typeName << " shader compiled" << std::endl;
-        std::flush(std::cout);
-        return shader;
-    }
-
-    void SetError(const std::string& error)
-    {
-        m_errorMessage = error;
-        m_state = ShaderLoadState::FAILED;
-        m_progress = 0.0f;
-        std::cerr << "[AsyncLoader] ERROR: " << error << std::endl;
-        std::flush(std::cerr);
+        m_shaders[m_shaderCount++] = { shader, typeName };
     }
 
-    std::string ReadTextFile(const std::string& fullPath)
+    // Cache key and file for a set of sources; the file is empty when the cache is off or the
+    // driver offers no binary formats
+    void ProgramCacheEntry(const ShaderSources& sources, std::string& key, std::string& file)
     {
-        std::cout << "[AsyncLoader] Opening file with C API: " << fullPath << std::endl;
-        std::flush(std::cout);
+        key.clear();
+        file.clear();
 
-        // Use C file I/O to avoid MinGW std::ifstream issues
-        FILE* file = fopen(fullPath.c_str(), "rb");
+        std::string directory = GetProgramCacheDirectory();
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if (directory.empty() || formats <= 0) return;
 
-        if (!file)
+        // Untouched embedded sources are identified by their build-time hashes; rewritten ones are hashed here
+        char hex[17];
+        if (!sources.hash.empty())
         {
-            std::cerr << "[AsyncLoader] fopen failed for: " << fullPath << std::endl;
-#ifdef _WIN32
-            DWORD error = GetLastError();
-            std::cerr << "[AsyncLoader] Windows error code: " << error << std::endl;
-#endif
-            std::flush(std::cerr);
-            return "";
+            key = sources.hash;
         }
-
-        // Get file size
-        fseek(file, 0, SEEK_END);
-        long size = ftell(file);
-        fseek(file, 0, SEEK_SET);
-
-        if (size <= 0)
+        else
         {
-            std::cerr << "[AsyncLoader] Invalid file size: " << fullPath << std::endl;
-            std::flush(std::cerr);
-            fclose(file);
-            return "";
+            uint64_t sourceHash = HashShaderText(sources.compute);
+            for (const std::string* stage : { &sources.vertex, &sources.geometry, &sources.fragment })
+                sourceHash = HashShaderText(*stage, HashShaderText("\x1f", sourceHash));
+            std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(sourceHash));
+            key = std::string(hex);
+        }
+        for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION })
+        {
+            const GLubyte* value = glGetString(name);
+            key += '\n';
+            if (value) key += reinterpret_cast<const char*>(value);
         }
 
-        // Read content
-        std::string content;
-        content.resize(size);
+        std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(HashShaderText(key)));
+        file = (std::filesystem::path(directory) / (std::string(hex) + ".bin")).string();
+    }
 
-        size_t bytesRead = fread(&content[0], 1, size, file);
-        fclose(file);
+    // Entry layout: "STLRPROG", key length, key, binary format, binary length, binary
+    GLuint LoadCachedProgram(const std::string& file, const std::string& key)
+    {
+        FILE* in = fopen(file.c_str(), "rb");
+        if (!in) return 0;
+
+        char magic[8];
+        uint32_t keyLength = 0, format = 0, binaryLength = 0;
+        std::string storedKey;
+        std::vector<char> binary;
+        bool valid = fread(magic, 1, 8, in) == 8 && std::string(magic, 8) == "STLRPROG" &&
+                     fread(&keyLength, sizeof(keyLength), 1, in) == 1 && keyLength == key.size();
+        if (valid)
+        {
+            storedKey.resize(keyLength);
+            valid = fread(&storedKey[0], 1, keyLength, in) == keyLength && storedKey == key &&
+                    fread(&format, sizeof(format), 1, in) == 1 &&
+                    fread(&binaryLength, sizeof(binaryLength), 1, in) == 1 && binaryLength > 0;
+        }
+        if (valid)
+        {
+            binary.resize(binaryLength);
+            valid = fread(binary.data(), 1, binaryLength, in) == binaryLength;
+        }
+        fclose(in);
+        if (!valid) return 0;
 
-        if (bytesRead != (size_t)size)
+        // A driver update can reject its own older binaries even under an unchanged version string
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binaryLength));
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
         {
-            std::cerr << "[AsyncLoader] Read size mismatch for: " << fullPath
-                << " (expected " << size << ", got " << bytesRead << ")" << std::endl;
-            std::flush(std::cerr);
-            return "";
+            std::cout << "[AsyncLoader] Cached program rejected by the driver, compiling" << std::endl;
+            glDeleteProgram(program);
+            return 0;
         }
+        return program;
+    }
 
-        std::cout << "[AsyncLoader] ✓ File read successfully: " << bytesRead << " bytes" << std::endl;
-        std::flush(std::cout);
+    void SaveCachedProgram(GLuint program, const std::string& file, const std::string& key)
+    {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(file).parent_path(), error);
+
+        // Written under a temporary name so a concurrent start never reads a partial entry
+        std::string staging = file + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+        FILE* out = fopen(staging.c_str(), "wb");
+        if (!out) return;
+
+        uint32_t keyLength = static_cast<uint32_t>(key.size());
+        uint32_t storedFormat = format, binaryLength = static_cast<uint32_t>(length);
+        bool written = fwrite("STLRPROG", 1, 8, out) == 8 &&
+                       fwrite(&keyLength, sizeof(keyLength), 1, out) == 1 &&
+                       fwrite(key.data(), 1, keyLength, out) == keyLength &&
+                       fwrite(&storedFormat, sizeof(storedFormat), 1, out) == 1 &&
+                       fwrite(&binaryLength, sizeof(binaryLength), 1, out) == 1 &&
+                       fwrite(binary.data(), 1, binaryLength, out) == binaryLength;
+        written = (fclose(out) == 0) && written;
+
+        if (written) std::filesystem::rename(staging, file, error);
+        if (!written || error) std::filesystem::remove(staging, error);
+    }
 
-        return content;
+    void SetError(const std::string& error)
+    {
+        m_errorMessage = error;
+        m_state = ShaderLoadState::FAILED;
+        m_progress = 0.0f;
+        std::cerr << "[AsyncLoader] ERROR: " << error << std::endl;
+        std::flush(std::cerr);
     }
 
     std::atomic<ShaderLoadState> m_state;
@@ -651,6 +624,14 @@ private:
     std::atomic<GLuint> m_program;
     std::atomic<bool> m_shouldStop;
     std::string m_errorMessage;
+    std::string m_cacheKey, m_cacheFile;  // Program cache entry of the build in flight
+
+    // Build in flight: shaders queued for compilation and the program linking them
+    struct QueuedShader { GLuint shader; const char* typeName; };
+    QueuedShader m_shaders[3] = {};
+    int m_shaderCount = 0;
+    GLuint m_pendingProgram = 0;
+
     std::function<void(GLuint)> m_onComplete;
     std::function<void(const std::string&)> m_onError;
 
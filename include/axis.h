@@ -49,7 +49,10 @@ public:
     // ============================================================================
     static void Init();
     static void Cleanup();
+    // Rebuilds the geometry only when the zoom, aspect or style changes or the view leaves the
+    // generated area; Invalidate() forces the next Update to rebuild
     static void Update(const Camera& camera, float viewportWidth, float viewportHeight);
+    static void Invalidate();
     static void Draw(GLuint program, const glm::mat4& projView);
 
     // Label rendering (optional)
@@ -107,6 +110,13 @@ private:
     static std::vector<GridLabel> labels;
     static Style style;
 
+    // What the current geometry was generated for
+    static bool cacheValid;
+    static float cachedZoom;
+    static float cachedAspect;
+    static glm::vec4 cachedBounds;  // left, right, bottom, top of the generated area
+    static Style cachedStyle;
+
     // ============================================================================
     // Private Helper Functions
     // ============================================================================
@@ -125,6 +135,10 @@ private:
     // Label formatting
     static std::string FormatLabel(float value, float spacing);
 
+    // Geometry cache
+    static bool SameStyle(const Style& a, const Style& b);
+    static void UploadGeometry();
+
     // Dynamic buffer calculation - THE KEY FIX
     static float CalculateDynamicBuffer(const Camera& camera,
         float halfWidth, float halfHeight);
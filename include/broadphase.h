@@ -0,0 +1,91 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <glad/glad.h>
+#include <string>
+
+// Collision candidate search used by the compute shader
+enum BroadphaseMode
+{
+    BROADPHASE_ALL_PAIRS = 0,    // Every object tests every other object
+    BROADPHASE_UNIFORM_GRID = 1, // Spatial hash, narrowphase visits the 3x3 neighbouring cells
+    BROADPHASE_LBVH = 2          // Morton-sorted linear BVH, suits widely varying object sizes
+};
+
+// SSBO binding points shared with math.comp and the broadphase_*.comp build shaders
+const int BROADPHASE_GRID_CELLS_BINDING = 9;
+const int BROADPHASE_GRID_OBJECTS_BINDING = 10;
+const int BROADPHASE_GRID_SORTED_BINDING = 11;
+const int BROADPHASE_GRID_BLOCK_SUMS_BINDING = 12;
+const int BROADPHASE_BVH_NODES_BINDING = 13;
+const int BROADPHASE_SORT_IN_BINDING = 14;
+const int BROADPHASE_SORT_OUT_BINDING = 15;
+const int BROADPHASE_RADIX_HISTOGRAM_BINDING = 16;
+const int BROADPHASE_SCENE_BOUNDS_BINDING = 17;
+
+// Verlet lists of the collision pass, and the skin check that gates the rebuilds (the reference
+// positions are also read by collide.comp's swept grid search) - MUST MATCH
+// collide.comp and broadphase_skin.comp
+const int BROADPHASE_NEIGHBOUR_LISTS_BINDING = 3;
+const int BROADPHASE_SKIN_CONTROL_BINDING = 4;
+const int BROADPHASE_SKIN_REFERENCE_BINDING = 5;
+const int NEIGHBOUR_LIST_CAPACITY = 30;  // Candidates per object; more falls back to the structure
+const int NEIGHBOUR_LIST_STRIDE = NEIGHBOUR_LIST_CAPACITY + 2;  // (generation, count, candidates)
+
+namespace Broadphase
+{
+    // Largest hash table the two-level scan can handle (256 blocks of 256 cells)
+    static const int MAX_GRID_CELLS = 256 * 256;
+
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the grid and BVH buffers for more objects
+    void Cleanup();
+
+    // Rebuild the acceleration structure for the given mode from the current object buffer.
+    // objectBounds reads the collision extents of object_bounds.h, which must be bound and
+    // current for objectSSBO, instead of working them out from the shapes.
+    bool Build(BroadphaseMode mode, GLuint objectSSBO, GLuint collisionPropsSSBO, int numObjects,
+               bool objectBounds = false);
+
+    // Build for the collision pass with a skin margin: the structure and the per-object Verlet
+    // lists collide.comp records from it cover every pair within skin of touching, so both are
+    // reused until some collidable object has moved (or grown) by more than skin / 2 since the
+    // last rebuild. A GPU max-displacement pass decides and gates the build passes indirectly,
+    // so the host never waits on it. rebuild forces one (shapes or indices changed); skin 0
+    // rebuilds every call like Build(). excludeStatic leaves the static colliders out (the
+    // mask of static_colliders.h must be bound); collide.comp finds them in their own grid.
+    // objectBounds is as in Build(), for the skin check too.
+    bool BuildForCollision(BroadphaseMode mode, GLuint objectSSBO, GLuint collisionPropsSSBO, int numObjects,
+                           float skin, bool rebuild, bool excludeStatic = false, bool objectBounds = false);
+    float GetCollisionSkin();  // Skin of the current collision structure, 0 when it was built without
+    GLuint GetSkinRebuilds();   // Rebuilds the skin check ran so far; waits for the GPU
+
+    // Periodic box (min, max corners) the collision grid and periodic neighbour grids wrap
+    // their cells in: a whole number of cells tiles it, so objects across the seam share
+    // neighbouring cells. An empty box (max <= min) turns wrapping off, the default.
+    void SetPeriodicBox(float minX, float minY, float maxX, float maxY);
+
+    // Bind the buffers the collision loop reads for the given mode
+    void BindForCollision(BroadphaseMode mode);
+    void UnbindForCollision();
+
+    // Grid over every object with a fixed cell size, for radius-limited neighbour
+    // reductions (nsum/ncount/nmean); shares the uniform grid buffers and shader.
+    // mergeWorlds puts objects of every ensemble world in the same cells; periodic wraps
+    // the cells in the SetPeriodicBox box (readers must compute cells the same way).
+    bool BuildNeighbourGrid(GLuint objectSSBO, GLuint collisionPropsSSBO, int numObjects, float cellSize,
+                            bool mergeWorlds = false, bool periodic = false);
+    void BindNeighbourGrid();
+    void UnbindNeighbourGrid();
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady(BroadphaseMode mode);
+    std::string GetShaderLoadStatusMessage();
+
+    // Accessors
+    GLuint GetGridTableSize();
+}
+
+#endif // BROADPHASE_H
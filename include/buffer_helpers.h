@@ -5,6 +5,7 @@
 #define BUFFER_HELPERS_H
 
 #include <glad/glad.h>
+#include <cstring>
 #include <iostream>
 #include <vector>
 
@@ -25,6 +26,38 @@ inline void SafeBufferData(GLenum target, const std::vector<T>& data, GLenum usa
     }
 }
 
+/**
+ * Create a shader storage buffer of at least size bytes, or grow an existing one:
+ * the contents move into a larger allocation with glCopyBufferSubData and the new
+ * tail is zeroed. Leaves the buffer bound to GL_SHADER_STORAGE_BUFFER.
+ * Returns true when buffer names a new buffer object.
+ */
+inline bool EnsureBufferCapacity(GLuint& buffer, GLsizeiptr size, GLenum usage = GL_DYNAMIC_COPY) {
+    GLint64 current = 0;
+    if (buffer != 0) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glGetBufferParameteri64v(GL_SHADER_STORAGE_BUFFER, GL_BUFFER_SIZE, &current);
+        if (current >= size) return false;
+    }
+
+    GLuint grown = 0;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, grown);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, usage);
+    GLuint zero = 0;
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, static_cast<GLintptr>(current), size - static_cast<GLsizeiptr>(current),
+                         GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    if (buffer != 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_SHADER_STORAGE_BUFFER, 0, 0, static_cast<GLsizeiptr>(current));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = grown;
+    return true;
+}
+
 /**
  * Check for OpenGL errors with context information
  */
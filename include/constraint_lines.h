@@ -0,0 +1,40 @@
+#ifndef CONSTRAINT_LINES_H
+#define CONSTRAINT_LINES_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+
+// SSBO bindings of constraint_lines.vert
+const int CONSTRAINT_LINES_CONSTRAINTS_BINDING = 48;
+const int CONSTRAINT_LINES_OBJECTS_BINDING = 49;
+const int CONSTRAINT_LINES_ROWS_BINDING = 50;
+
+const float CONSTRAINT_LINES_DEFAULT_STRAIN_SCALE = 0.1f;
+
+// Distance constraint networks drawn straight from the constraint buffers: one instanced
+// GL_LINES call, an instance per constraint row and a line per slot up to the longest row,
+// whose vertex shader pulls both endpoints from the object buffer and colours the edge by
+// its strain. Rows the constraint pass broke on the GPU are drawn as they are now; nothing
+// is read back.
+namespace ConstraintLines
+{
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // |strain| drawn at full colour, > 0
+    void SetStrainScale(float scale);
+    float GetStrainScale();
+
+    // Draw the constraints of rows [0, rows) with at most maxPerRow constraints each
+    void Draw(const glm::mat4& projView, GLuint objectSSBO, GLuint constraintsSSBO, GLuint rowsSSBO,
+              int numObjects, int rows, int maxPerRow);
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // CONSTRAINT_LINES_H
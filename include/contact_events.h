@@ -0,0 +1,50 @@
+#ifndef CONTACT_EVENTS_H
+#define CONTACT_EVENTS_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+
+// One touching pair of a step - MUST MATCH ContactEvent in collide.comp and contact_solver.comp
+struct ContactEvent
+{
+    int objectA;
+    int objectB;
+    float normal[2];    // From A to B
+    float impulse;      // Normal impulse the response applied, 0 for a separating pair
+    float penetration;
+    int _pad[2];
+};
+
+// Collision event stream. While enabled, the narrowphase (or the contact solver, when it
+// resolves the pairs) appends each touching pair once per step into an append buffer with
+// one atomic counter; pairs whose objects' categories both miss the mask are skipped. After
+// each step the host copies the buffer behind a fence, clears the counter and collects the
+// copy once it has landed, so events cost O(events) and never wait on the GPU. While a copy
+// is in flight the steps append on, so no event is lost unless the buffer fills.
+namespace ContactEvents
+{
+    const int CONTACT_EVENTS_BINDING = 60;             // MUST MATCH collide.comp, contact_solver.comp
+    const int CONTACT_EVENTS_DEFAULT_CAPACITY = 16384; // Events per copy
+
+    void SetEnabled(bool enabled);  // Off by default; turning it on drops what is pending
+    bool IsEnabled();
+    void SetCategoryMask(uint32_t mask);  // Pairs with an object in one of these categories
+    void SetCapacity(int events);
+
+    // Around the passes of a step, on the simulation's GL thread. Bind allocates the buffer on
+    // first use; ShaderMask is the uContactEvents value of the passes, 0 while disabled.
+    void Bind();
+    void Unbind();
+    GLuint ShaderMask();
+
+    // After each step: collects a landed copy and starts the next one
+    void EndStep();
+
+    // Events collected since the last call, oldest first; dropped counts those that did not fit
+    void Take(std::vector<ContactEvent>& events, uint64_t& dropped);
+
+    void Cleanup();
+}
+
+#endif // CONTACT_EVENTS_H
@@ -0,0 +1,63 @@
+#ifndef CONTACT_SOLVER_H
+#define CONTACT_SOLVER_H
+
+#include <glad/glad.h>
+#include <string>
+
+// SSBO bindings of the contact-pair solve - MUST MATCH contact_solver.comp and collide.comp
+const int CONTACT_PAIRS_BINDING = 30;       // Header + compacted pairs written by the narrowphase
+const int CONTACT_BODIES_BINDING = 31;      // Per-object contact count and impulse accumulators
+const int CONTACT_WARM_START_BINDING = 32;  // (A,B)-keyed impulses of the previous step
+
+// One contact pair emitted by collide.comp - MUST MATCH collide.comp and contact_solver.comp
+struct ContactPair
+{
+    int objectA;
+    int objectB;
+    float normal[2];           // From A to B
+    float penetration;
+    float restitution;
+    float friction;
+    float normalImpulse;       // Accumulated over the iterations, warm-started from the last step
+    float tangentImpulse;      // Along (-normal.y, normal.x)
+    float velocityBias;        // Separating speed restitution asks for
+    float _pad[2];
+};
+
+// Pair-list contact solver: the narrowphase appends every touching pair once into a compacted
+// buffer and this module runs sequential-impulse iterations over it. Contacts are solved in
+// parallel with per-object mass splitting, accumulated impulses are clamped (non-negative
+// normal, Coulomb cone for friction) and, with warm starting, the accumulated impulses of the
+// previous step are applied first, looked up by an (A,B) pair hash.
+namespace ContactSolver
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the pair and body buffers for more objects
+    void Cleanup();
+
+    // Reset the pair buffer and per-object accumulators before the narrowphase; false if not ready
+    bool BeginStep(int numObjects);
+    void BindForCollision();
+    void UnbindForCollision();
+    GLuint GetCapacity();  // Pairs the narrowphase may emit
+
+    // Iterate over the emitted pairs, in place on the collided state. useSleep treats sleeping
+    // objects as static (their counters must be bound by the caller's ObjectSleep state). A
+    // non-zero eventMask appends the solved pairs to the bound ContactEvents buffer.
+    void Solve(GLuint objectSSBO, int numObjects, int iterations, bool warmStart, bool useSleep,
+               GLuint eventMask = 0, GLuint collisionPropsSSBO = 0);
+
+    // Forget the stored impulses (object indices changed)
+    void ResetWarmStart();
+
+    // Pairs of the last step; reads the count back from the GPU, -1 before the first step
+    int GetContactCount();
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // CONTACT_SOLVER_H
@@ -0,0 +1,102 @@
+#ifndef CPU_BACKEND_H
+#define CPU_BACKEND_H
+
+#include "objects.h"
+#include "constraints.h"
+#include "parser.h"
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Simulation step on the CPU, for machines without an OpenGL 4.3 context. It runs the passes
+// Objects::Update() dispatches - pair reductions, equation evaluation and integration,
+// constraints, collisions - over the token buffers gpu_serializer.h produces, and follows the
+// semantics of math.comp, constraints.comp and collide.comp operation for operation.
+//
+// Object state is one array per field. Objects that run the same equation are evaluated in
+// blocks of CPU_LANES: the interpreter walks the token stream once per block and applies each
+// token to every lane in a loop the compiler vectorizes. A lane whose values would send it down
+// another path than the rest of the block (a complex operand where the stack layout diverges)
+// is evaluated again on its own by the scalar interpreter. Blocks are spread over a
+// work-stealing thread pool.
+//
+// Not covered: Barnes-Hut accelerations (grav_ax and friends read 0), polygon collisions, the
+// pair contact solver (collisions use collide.comp's per-object impulse response), XPBD
+// constraints, sleeping and ensemble worlds (a Scene is one world).
+namespace CpuBackend
+{
+    const int CPU_LANES = 16;  // Objects per evaluation block
+
+    // Serialized equations, laid out like the storage buffers math.comp reads
+    struct EquationSet
+    {
+        std::vector<int> tokens;
+        std::vector<float> constants;
+        std::vector<EquationMapping> mappings;
+        std::vector<PairSumExpression> pairSums;   // MAX_PAIR_SUMS_PER_EQUATION per equation
+        std::unordered_map<std::string, int> ids;  // Registration key -> equation ID
+        bool readsOtherObjects = false;            // p[i] or pair reductions: stages run as separate passes
+        bool usesPairSums = false;
+        float maxNeighbourRadius = 0.0f;
+    };
+
+    // A set holding the default equation Objects::Init() registers as ID 0
+    EquationSet CreateEquationSet();
+
+    // Register an equation unless the key is already there; returns its ID
+    int AddEquation(EquationSet& equations, const std::string& key, const ParsedEquation& equation);
+
+    // Fields of the objects of one scene, one array each
+    struct ObjectArrays
+    {
+        std::vector<float> x, y, vx, vy;
+        std::vector<float> ax, ay;                  // collisionData.xy, the previous step's acceleration
+        std::vector<float> rotation, angularVelocity;
+        std::vector<float> r, g, b, a;
+        std::vector<float> mass, charge;
+        std::vector<float> width, height;           // visualData.xy
+        std::vector<int> equation;
+
+        void Resize(size_t count);
+        size_t Size() const { return x.size(); }
+    };
+
+    struct Scene
+    {
+        ObjectArrays state;
+        std::vector<Object> objects;                       // Fields the step never changes
+        std::vector<CollisionProperties> collision;        // One per object
+        std::vector<std::vector<Constraint>> constraints;  // Per object
+        std::vector<float> objectParams;                   // OBJECT_PARAM_COUNT per object, empty = all 0
+        std::vector<int> handleSlots;                      // ObjectHandles::BuildSlotTable(), empty = p[i] is object i
+        SimParams params;                                  // dt and time are those of the next Step()
+        IntegratorMethod integrator = INTEGRATOR_SYMPLECTIC_EULER;
+
+        // Working buffers of Step()
+        ObjectArrays integrated;
+        ObjectArrays stages[2];
+        std::vector<float> pairSumValues;                  // MAX_PAIR_SUMS_PER_EQUATION per object
+        std::vector<float> integratorScratch;              // Staged passes: state kept between stages
+        std::vector<int> order;                            // Object indices grouped by equation
+        std::vector<int> blocks;                           // Start of each block in order, then order.size()
+    };
+
+    // Object layout in and out; Load() also gives every object default collision properties and no constraints
+    void Load(Scene& scene, const std::vector<Object>& objects);
+    std::vector<Object> Store(const Scene& scene);
+
+    // One fixed step of scene.params.dt; scene.params.time is the time equations read as t
+    void Step(Scene& scene, const EquationSet& equations);
+
+    // Run body over [0, count) in chunks of at most grain items, on the pool and the calling
+    // thread. Calls from inside a body run inline.
+    void ParallelFor(int count, int grain, const std::function<void(int, int)>& body);
+
+    // Threads including the caller, 0 = one per hardware thread; workers start on first use
+    void SetThreadCount(int threads);
+    int GetThreadCount();
+    void Cleanup();  // Joins the workers
+}
+
+#endif // CPU_BACKEND_H
@@ -0,0 +1,34 @@
+#ifndef DENSITY_SPLAT_H
+#define DENSITY_SPLAT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+
+// SSBO binding of density_splat.vert
+const int DENSITY_SPLAT_OBJECTS_BINDING = 54;
+
+// Point-splat rendering for very large scenes: every object adds its colour and a count of one
+// to the pixel under its centre in a float target with additive blending, whatever its skin,
+// and the sum is tone-mapped into the framebuffer bound when Draw() is called - the mean colour
+// of a pixel, brighter the more objects landed on it.
+namespace DensitySplat
+{
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    void SetExposure(float exposure);  // Objects per pixel at which brightness is ~63% up, > 0
+    float GetExposure();
+
+    // Splat objectSSBO's first numObjects objects through projView into the bound framebuffer's
+    // current viewport
+    void Draw(GLuint objectSSBO, int numObjects, const glm::mat4& projView);
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // DENSITY_SPLAT_H
@@ -0,0 +1,33 @@
+#ifndef DISPATCH_ORDER_H
+#define DISPATCH_ORDER_H
+
+#include <glad/glad.h>
+#include <string>
+
+// SSBO binding of the invocation -> object index table read by math.comp
+const int DISPATCH_ORDER_BINDING = 19;
+
+// Equation-coherent dispatch order: math.comp invocations visit objects sorted by
+// (equationID, spatial cell) so a subgroup mostly walks a single token stream.
+// Objects keep their buffer slots, so user-facing indices never change.
+namespace DispatchOrder
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the order and sort buffers for more objects
+    void Cleanup();
+
+    // Re-sort the order from the current object buffer; false if the build shader is not ready
+    bool Build(GLuint objectSSBO, int numObjects);
+
+    // Bind the order table for math.comp
+    void Bind();
+    void Unbind();
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // DISPATCH_ORDER_H
@@ -0,0 +1,46 @@
+#ifndef DOMAIN_DECOMPOSITION_H
+#define DOMAIN_DECOMPOSITION_H
+
+#include <string>
+
+// Distributed runs: one process per GPU (an MPI rank), the world split along x into one slab
+// per rank. A rank owns the objects whose centre lies in its slab and integrates only those;
+// after every step the owned objects that left the slab go to the rank that owns them now,
+// and the objects within the halo of a neighbouring slab are sent to it as ghosts. Ghosts are
+// static colliders appended after the owned objects, so collisions, p[i], sum_j() and the
+// neighbour reductions see local + ghost objects while only the owner moves them. Every rank
+// runs the same script: equation IDs have to agree, which each exchange checks.
+//
+// Objects travel as their Object rows; constraints, springs, parameters, state registers and
+// groups stay with the rank that set them. Needs a build with STELLAR_MPI.
+namespace DomainDecomposition
+{
+    struct Stats
+    {
+        int rank = 0;
+        int ranks = 1;
+        float slabMin = 0.0f;    // This rank's slab [slabMin, slabMax)
+        float slabMax = 0.0f;
+        int localObjects = 0;    // Owned: objects [0, localObjects)
+        int ghostObjects = 0;    // Received copies after them
+        int migratedIn = 0;      // At the last exchange
+        int migratedOut = 0;
+        long long exchanges = 0;
+    };
+
+    // Split [minX, maxX) evenly among the ranks, ghosts within halo of a slab edge (halo < slab
+    // width); initializes MPI unless the caller did. Collective. False with error when the build
+    // has no MPI or the scene cannot be split (ensemble worlds, emitters)
+    bool Start(float minX, float maxX, float halo, bool periodic, std::string& error);
+    void Stop();  // Drops the ghosts; each rank keeps the objects it owns
+    bool IsActive();
+    void Cleanup();  // Stop(), and finalize MPI if Start() initialized it
+
+    // After each step, on object buffer sourceIndex: collective, every rank calls it once per
+    // step. Object indices change like after RemoveObjects
+    bool Exchange(int sourceIndex, std::string& error);
+
+    Stats GetStats();
+}
+
+#endif // DOMAIN_DECOMPOSITION_H
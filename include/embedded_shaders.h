@@ -0,0 +1,28 @@
+#ifndef EMBEDDED_SHADERS_H
+#define EMBEDDED_SHADERS_H
+
+#include <string>
+
+// Shaders built into the binary: cmake/embed_shaders.cmake turns shaders/ into a generated
+// source holding each file's bytes and SHA-1, so loading a shader touches no files.
+struct EmbeddedShader
+{
+    const char* name;              // File name in shaders/, e.g. "math.comp"
+    const unsigned char* source;   // size bytes, then a terminating 0
+    unsigned int size;
+    const char* hash;              // SHA-1 of the file, hex
+};
+
+// The generated table, ended by an entry with a null name
+extern const EmbeddedShader g_embeddedShaders[];
+extern const int g_embeddedShaderCount;
+
+// nullptr when no shader of that name was embedded
+const EmbeddedShader* FindEmbeddedShader(const std::string& name);
+
+// Source of a shader by file name, without a UTF-8 BOM; hash is the embedded SHA-1. With
+// STELLAR_SHADER_DIR set the file is read from that directory instead and hash is left empty,
+// for editing shaders without a rebuild. False if the shader is not there.
+bool LoadShaderSource(const std::string& name, std::string& source, std::string& hash);
+
+#endif // EMBEDDED_SHADERS_H
@@ -0,0 +1,22 @@
+#ifndef EQUATION_CACHE_H
+#define EQUATION_CACHE_H
+
+#include <string>
+
+struct GPUSerializedEquation;
+
+// On-disk cache of serialized equations, so a scene set up again in a new process skips
+// parsing. Entries are named by a hash of the registration key and hold the full key, which
+// is compared on load. math.comp's hash is part of every key, so a build with another token
+// format never reads them. Off unless a directory is set, or STELLAR_EQUATION_CACHE names one.
+namespace EquationCache
+{
+    void SetDirectory(const std::string& directory);  // Empty = off
+    std::string GetDirectory();
+
+    // Safe to call from several threads at once
+    bool Load(const std::string& key, GPUSerializedEquation& equation);
+    void Store(const std::string& key, const GPUSerializedEquation& equation);
+}
+
+#endif // EQUATION_CACHE_H
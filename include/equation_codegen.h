@@ -0,0 +1,38 @@
+#ifndef EQUATION_CODEGEN_H
+#define EQUATION_CODEGEN_H
+
+#include "objects.h"
+#include <string>
+#include <vector>
+
+// Compiles serialized RPN equations into straight-line GLSL spliced into math.comp
+namespace EquationCodegen
+{
+    // Lines in math.comp delimiting the stub that the generated block replaces
+    extern const char* const BLOCK_BEGIN_MARKER;
+    extern const char* const BLOCK_END_MARKER;
+
+    // evaluateCompiledEquation() and one function per component for equations [0, numEquations).
+    // Components the generator cannot express (derivatives, malformed RPN) call the interpreter.
+    std::string GenerateEquationBlock(const std::vector<int>& tokens,
+                                      const std::vector<float>& constants,
+                                      const std::vector<EquationMapping>& mappings,
+                                      int numEquations);
+
+    // float name(<component parameters>) evaluating one serialized RPN expression whose constants
+    // start at 0; returns an empty string if the generator cannot express it
+    std::string GenerateExpressionFunction(const std::vector<int>& tokens,
+                                           const std::vector<float>& constants,
+                                           const std::string& name);
+
+    // The same for the body of a neighbour reduction, with the neighbour as `Object pj, int pjIndex`
+    // after the component parameters; pj.property reads pairProperty(pj, pjIndex, hash)
+    std::string GeneratePairBodyFunction(const std::vector<int>& tokens,
+                                         const std::vector<float>& constants,
+                                         const std::string& name);
+
+    // Replace the marker block of a shader source; returns an empty string if the markers are missing
+    std::string SpliceEquationBlock(const std::string& shaderSource, const std::string& block);
+}
+
+#endif // EQUATION_CODEGEN_H
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "parser.h"
+
+// ============================================================================
+// SYMBOLIC DERIVATIVES
+// ============================================================================
+// Replaces D(expr, var, order) tokens marked DERIV_METHOD_SYMBOLIC with the
+// RPN of the derivative itself, so the shader evaluates an ordinary expression
+// once instead of walking the body twice per central difference. Derivatives
+// are partial: other variables and p[i] references are held constant, like
+// the perturbation on the GPU does. Values may be complex, so every rule is
+// the one of the analytic continuation (|u|' = re(conj(u) u') / |u|).
+//
+// A derivative that would not fit the evaluator (MAX_SYMBOLIC_DERIVATIVE_TOKENS
+// tokens or MAX_SYMBOLIC_DERIVATIVE_DEPTH stack entries) keeps its token and
+// is taken on the GPU instead, like DERIV_METHOD_DUAL.
+//
+// DERIV_METHOD_DUAL and DERIV_METHOD_NUMERICAL tokens stay tokens. Both GPU
+// methods yield a first derivative, so the orders before the last are expanded
+// symbolically into the body. A dual body with operators evaluateDualDerivative()
+// lacks, or that needs more than MAX_DUAL_DERIVATIVE_DEPTH entries, is expanded
+// symbolically after all where that fits and taken numerically otherwise.
+// D() inside a D() body is always expanded first, the GPU cannot nest them.
+// Neither GPU method branches, so a body with if() is always expanded and
+// throws std::runtime_error when that does not fit.
+
+// Largest expanded derivative - MUST MATCH MAX_DERIV_EXPR_SIZE in math.comp
+const int MAX_SYMBOLIC_DERIVATIVE_TOKENS = 500;
+
+// Stack entries an expanded derivative may need; the rest of its component needs some too
+const int MAX_SYMBOLIC_DERIVATIVE_DEPTH = 32;
+
+// Dual numbers the GPU keeps per D() body - MUST MATCH MAX_DUAL_STACK_SIZE in math.comp
+const int MAX_DUAL_DERIVATIVE_DEPTH = 32;
+
+// Differentiate an RPN expression order times with respect to a variable.
+// False if the expression cannot be differentiated or the result is too large.
+bool DifferentiateRPN(const std::vector<Token>& rpn, SymbolId wrt, int order, std::vector<Token>& out);
+
+// Expand the symbolic D() tokens of all components and prepare the others, in place (nested ones first)
+void ExpandSymbolicDerivatives(ParsedEquation& equation);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "parser.h"
+
+// ============================================================================
+// EQUATION OPTIMIZER
+// ============================================================================
+// Rewrites the RPN of a parsed equation before it is serialized for the GPU:
+//   - subexpressions of literals (and pi, e) are folded into one number
+//   - x^1, x^0, x^2 and x^0.5 become x, 1, x*x and sqrt(x)
+//   - on operands that are provably real, a*a + b*b, a*c + b*d, sqrt(a*a + b*b),
+//     n / (a*a + b*b)^1.5, s^-0.5 and n / sqrt(s) become the fused intrinsics
+//     len2, dot2, hypot, n * invcube(a, b), rsqrt(s) and n * rsqrt(s), one real
+//     ALU sequence each instead of several tokens and a complex power
+//   - subtrees shared by the components (or repeated inside one) are evaluated
+//     once into a temporary (TOKEN_TEMP_STORE) and re-read with TOKEN_TEMP_LOAD
+//   - real subtrees of only t, k, damping, gravity, coupling, freq, amp and
+//     literals, such as amp*sin(freq*t), are the same for every object of a
+//     world; each is followed by TOKEN_HOIST and one of MAX_PRELUDE_SLOTS
+//     prelude slots, which math.comp's prelude pass fills once per step and
+//     stage. The body stays in place for evaluators without the prelude.
+//
+// Temporaries rely on math.comp evaluating the components of an equation in
+// the order ax, ay, angular, r, g, b, a. D() and pair reduction bodies and the
+// state register updates are evaluated on their own and only get folding,
+// strength reduction and fusion; D() bodies are not fused. Nothing is stored inside the branches of an if(), which
+// only run when taken; shared subtrees there are recomputed or loaded.
+
+// Temporaries per equation - MUST MATCH MAX_EQUATION_TEMPS in math.comp
+const int MAX_EQUATION_TEMPS = 16;
+
+// Hoisted subexpressions per equation (prelude slots)
+const int MAX_PRELUDE_SLOTS = 8;
+
+// Optimize all components in place. Components whose RPN is not a single
+// well-formed expression are left untouched.
+void OptimizeEquation(ParsedEquation& equation);
@@ -0,0 +1,48 @@
+#ifndef EVENT_DRIVEN_H
+#define EVENT_DRIVEN_H
+
+#include "objects.h"
+#include <vector>
+
+// Event-driven hard-disk dynamics, for dilute granular gases where fixed steps spend nearly all
+// their work between collisions. Objects fly in straight lines between events: the next contact
+// with a neighbour, a wall of the world box, or a crossing into the next cell of a grid one
+// diameter wide, so a prediction only looks at the 3x3 cells around an object. Events wait in a
+// priority queue; processing one moves just its objects to the event time and predicts them
+// again, and the events it invalidated are told apart by a per-object collision counter and
+// dropped when popped. Everything is brought to the end time once, at the end.
+//
+// Ensemble worlds never interact, so each world's queue runs as its own task on the CpuBackend
+// pool. Disks are the collision-enabled circles (radius visualData.x); other objects fly through
+// them. Equations, constraints and springs do not act: free flight is force-free.
+namespace EventDriven
+{
+    struct Settings
+    {
+        BoundaryMode boundary = BOUNDARY_REFLECT;
+        glm::vec2 worldMin = glm::vec2(0.0f);
+        glm::vec2 worldMax = glm::vec2(0.0f);
+        float wallRestitution = 1.0f;  // Walls reflect object centres, like math.comp
+        // An object that collides again within this time collides elastically: the TC model,
+        // which keeps e < 1 from collapsing into infinitely many collisions in finite time
+        float collapseTime = 1e-6f;
+        long long maxEvents = 0;  // Per world, 0 = no limit; the rest of the interval is then free flight
+    };
+
+    struct Stats
+    {
+        long long collisions = 0;
+        long long wallHits = 0;
+        long long cellCrossings = 0;
+        long long staleEvents = 0;  // Popped after a collision had invalidated them
+        int worlds = 0;
+        bool truncated = false;     // Some world reached maxEvents
+    };
+
+    // Advance the objects by duration. collisions[i] are object i's collision properties;
+    // immovable objects keep their place and have infinite mass
+    Stats Advance(std::vector<Object>& objects, const std::vector<CollisionProperties>& collisions,
+                  const std::vector<bool>& immovable, double duration, const Settings& settings);
+}
+
+#endif // EVENT_DRIVEN_H
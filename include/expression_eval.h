@@ -0,0 +1,65 @@
+#ifndef EXPRESSION_EVAL_H
+#define EXPRESSION_EVAL_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <string>
+
+// SSBO bindings of expression_eval.comp; the reduction passes use the same ones, never at once
+const int EXPRESSION_EVAL_INPUTS_BINDING = 37;
+const int EXPRESSION_EVAL_RESULTS_BINDING = 38;
+
+// Points evaluated per dispatch; larger inputs are streamed through the buffers in batches
+const int EXPRESSION_EVAL_BATCH_POINTS = 1 << 22;
+
+// Input columns, in the order of the expression's arguments - MUST MATCH expression_eval.comp
+enum EvalColumn
+{
+    EVAL_X = 0,
+    EVAL_Y,
+    EVAL_VX,
+    EVAL_VY,
+    EVAL_AX,
+    EVAL_AY,
+    EVAL_THETA,
+    EVAL_OMEGA,
+    EVAL_R,
+    EVAL_G,
+    EVAL_B,
+    EVAL_A,
+    EVAL_MASS,
+    EVAL_CHARGE,
+    EVAL_COLUMN_COUNT
+};
+
+// A column of numPoints values, one value for every point (count 1), or none (count 0) to
+// read the column's default: 1 for mass, charge and the colour, 0 for the rest
+struct EvalInput
+{
+    const float* data = nullptr;
+    size_t count = 0;
+};
+
+// Variable name of each column as the expression syntax spells it, and back; -1 if unknown
+const char* GetEvalColumnName(int column);
+int FindEvalColumn(const std::string& name);
+
+// The equation expression evaluator over arbitrary points instead of objects: each point is a
+// probe with the state the input columns give it, p[i] reads see the real objects, and one
+// value per point comes back. Each expression is generated into its own program and kept by
+// its key, like the reductions.
+namespace ExpressionEval
+{
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // Evaluate expressionFunction (a GLSL `float evalExpression(...)` from
+    // EquationCodegen::GenerateExpressionFunction) at numPoints points into results; system
+    // parameters come from the SimParams block bound by the caller, p[i] from the first
+    // numObjects objects of objectSSBO. Waits for the values; false with error set on failure.
+    bool Evaluate(const std::string& key, const std::string& expressionFunction, const EvalInput inputs[EVAL_COLUMN_COUNT],
+                  size_t numPoints, GLuint objectSSBO, int numObjects, float* results, std::string& error);
+}
+
+#endif // EXPRESSION_EVAL_H
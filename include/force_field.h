@@ -0,0 +1,43 @@
+#ifndef FORCE_FIELD_H
+#define FORCE_FIELD_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+
+// SSBO binding of the arrow instances force_field.comp writes - MUST MATCH force_field.comp
+const int FORCE_FIELD_ARROWS_BINDING = 52;
+
+// Live force field: a compute pass samples a user acceleration on a grid of points every frame
+// and writes one arrow instance per point into a vertex buffer, which is drawn from there with
+// one instanced call. Nothing goes through the CPU after the expressions are set.
+namespace ForceField
+{
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // ax and ay as GLSL `float fieldX(...)` and `float fieldY(...)` from
+    // EquationCodegen::GenerateExpressionFunction, compiled into one program. false with error
+    // set if it does not compile; the previous field stays.
+    bool SetExpressions(const std::string& functions, std::string& error);
+    void ClearExpressions();
+    bool IsActive();
+
+    // Sample grid of columns x rows cell centres over the world rectangle, and world length per
+    // unit of field; arrows never grow past 0.9 of a cell
+    bool SetGrid(float xMin, float xMax, float yMin, float yMax, int columns, int rows);
+    void SetArrowScale(float scale);
+
+    // Sample the field with the first numObjects objects of objectSSBO visible to p[i]; the
+    // caller binds SimParams and the object parameters. Draw() shows the last sample.
+    void Evaluate(GLuint objectSSBO, int numObjects);
+    void Draw(const glm::mat4& projView);
+
+    // Async shader loading (the arrow program; the sampling program follows SetExpressions)
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // FORCE_FIELD_H
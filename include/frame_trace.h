@@ -0,0 +1,65 @@
+#ifndef FRAME_TRACE_H
+#define FRAME_TRACE_H
+
+#include <glad/glad.h>
+#include <string>
+
+// Zone tracing for hunting hitches. Zones are compiled in only when the build defines
+// STELLAR_TRACING (Chrome trace JSON, open in chrome://tracing or ui.perfetto.dev) or
+// STELLAR_TRACY (zones go to a Tracy client linked by the build instead); otherwise the macros
+// are empty and nothing is recorded. GpuProfiler passes land in the Chrome trace as zones on a
+// "GPU" track, placed on the host clock through a GL_TIMESTAMP calibration.
+namespace FrameTrace
+{
+    const int MAX_TRACE_EVENTS = 1 << 20;  // Further events are dropped until the next Start
+
+    bool IsCompiledIn();  // STELLAR_TRACING builds only; Tracy builds stream instead
+
+    // Starts a new capture, dropping the last one. Returns false when tracing is not compiled in.
+    bool Start();
+    void Stop();
+    bool IsActive();
+
+    // Chrome trace JSON of the last capture; false if the file cannot be written
+    bool WriteChromeTrace(const std::string& path);
+
+    // Safe from any thread; `name` must outlive the capture (a string literal). BeginZone returns
+    // false when no capture is running, and only a zone that began is ended.
+    bool BeginZone(const char* name);
+    void EndZone();
+
+    // A GPU pass between two GL_TIMESTAMP results. The calling thread's context must own them.
+    void RecordGpuZone(const std::string& name, GLuint64 gpuStart, GLuint64 gpuEnd);
+
+    class Zone
+    {
+    public:
+        explicit Zone(const char* name) : m_began(BeginZone(name)) {}
+        ~Zone() { if (m_began) EndZone(); }
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        bool m_began;
+    };
+}
+
+#define FRAME_TRACE_CONCAT_(a, b) a##b
+#define FRAME_TRACE_CONCAT(a, b) FRAME_TRACE_CONCAT_(a, b)
+
+#if defined(STELLAR_TRACY)
+    #include <tracy/Tracy.hpp>
+    #define FRAME_TRACE_ZONE(name) ZoneScopedN(name)
+    #define FRAME_TRACE_FRAME() FrameMark
+    #define FRAME_TRACE_GPU(name, start, end) ((void)0)
+#elif defined(STELLAR_TRACING)
+    #define FRAME_TRACE_ZONE(name) FrameTrace::Zone FRAME_TRACE_CONCAT(frameTraceZone, __LINE__)(name)
+    #define FRAME_TRACE_FRAME() ((void)0)
+    #define FRAME_TRACE_GPU(name, start, end) FrameTrace::RecordGpuZone(name, start, end)
+#else
+    #define FRAME_TRACE_ZONE(name) ((void)0)
+    #define FRAME_TRACE_FRAME() ((void)0)
+    #define FRAME_TRACE_GPU(name, start, end) ((void)0)
+#endif
+
+#endif // FRAME_TRACE_H
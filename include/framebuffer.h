@@ -33,6 +33,8 @@ namespace Framebuffer
         }
         void Bind();
         void Unbind();
+        // Reallocate the attachments at a new size; nothing happens if the size is unchanged
+        void Resize(uint32_t width, uint32_t height);
 
     private:
         uint32_t mFbo = 0;
@@ -0,0 +1,18 @@
+#ifndef GL_DEBUG_H
+#define GL_DEBUG_H
+
+// OpenGL error reporting that never polls. Debug builds (no NDEBUG) ask for a debug context and
+// get the driver's errors and high-severity messages through a KHR_debug callback as they are
+// raised; release builds install nothing. Either way the step and draw paths make no
+// glGetError() calls, which on several drivers wait for the GPU to drain.
+namespace GLDebug
+{
+    // Whether this build wants a debug context - pass as GLFW_OPENGL_DEBUG_CONTEXT
+    bool WantsDebugContext();
+
+    // After the loader, on the thread that owns the context; false when nothing was installed
+    // (release build, or a context below 4.3 without KHR_debug)
+    bool Install();
+}
+
+#endif // GL_DEBUG_H
@@ -0,0 +1,59 @@
+#ifndef GPU_PRIMITIVES_H
+#define GPU_PRIMITIVES_H
+
+#include <glad/glad.h>
+#include <string>
+
+// SSBO bindings of gpu_primitives.comp - MUST MATCH gpu_primitives.comp (standalone passes,
+// never bound together with the simulation's buffers)
+const int PRIMITIVE_A_BINDING = 45;
+const int PRIMITIVE_B_BINDING = 49;
+const int PRIMITIVE_C_BINDING = 50;
+const int PRIMITIVE_D_BINDING = 51;
+const int PRIMITIVE_E_BINDING = 54;
+
+// Building blocks over uint / float SSBOs that other passes can share instead of growing their
+// own: exclusive prefix scan, stable key-value radix sort, stream compaction and segmented
+// reduction. Work stays on the GPU (totals are copied into a buffer, not read back); workgroup
+// scans use subgroup arithmetic when the driver has GL_KHR_shader_subgroup_arithmetic. Each
+// call issues its own barriers before and after, so inputs written by a shader can be passed in
+// directly and outputs read by the next pass.
+namespace GpuPrimitives
+{
+    // MUST MATCH REDUCE_* in gpu_primitives.comp
+    enum ReduceOp
+    {
+        REDUCE_SUM = 0,
+        REDUCE_MIN = 1,
+        REDUCE_MAX = 2
+    };
+
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // In-place exclusive scan of count uints; the sum of all of them is written to
+    // totalSSBO at totalOffset bytes when totalSSBO is not 0
+    void ExclusiveScan(GLuint buffer, GLuint count, GLuint totalSSBO = 0, GLintptr totalOffset = 0);
+
+    // In-place stable sort of count uint keys by their lowest keyBits bits (rounded up to
+    // 4-bit digits), carrying one uint of values per key along (0 = keys only)
+    void RadixSort(GLuint keys, GLuint values, GLuint count, int keyBits = 32);
+
+    // Packs the elements whose flag (one uint each, non-zero = keep) is set into output, in
+    // order: values[i] of each kept element, or its index i when values is 0. The number kept
+    // is written to countSSBO at countOffset bytes when countSSBO is not 0.
+    void Compact(GLuint flags, GLuint values, GLuint count, GLuint output,
+                 GLuint countSSBO = 0, GLintptr countOffset = 0);
+
+    // output[s] = op over the floats values[offsets[s] .. offsets[s + 1]) for s < numSegments
+    // (offsets holds numSegments + 1 uints); an empty segment gives 0, +inf or -inf
+    void SegmentedReduce(GLuint values, GLuint offsets, GLuint numSegments, GLuint output, ReduceOp op);
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // GPU_PRIMITIVES_H
@@ -0,0 +1,56 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// Per-pass GPU timings: Begin/End put a pair of GL_TIMESTAMP queries around a pass (timestamps,
+// unlike GL_TIME_ELAPSED, may nest), from a small ring per pass so results are only collected
+// once they have landed and nothing waits on the GPU. CPU timings of host work can be recorded
+// under a name as well. Each pass keeps the mean of its last PROFILE_WINDOW samples.
+namespace GpuProfiler
+{
+    const int PROFILE_WINDOW = 32;
+
+    struct PassStats
+    {
+        std::string name;
+        double milliseconds;  // Mean of the samples in the window
+        int samples;          // In the window, up to PROFILE_WINDOW
+    };
+
+    void SetEnabled(bool enabled);  // On by default
+    bool GetEnabled();
+
+    // Time a GPU pass. A pass belongs to the thread and context that first timed it; calls from
+    // anywhere else are skipped, since query objects are not shared between contexts.
+    void Begin(const char* pass);
+    void End(const char* pass);
+
+    // Times the enclosing block, so early returns still close the pass
+    class Scope
+    {
+    public:
+        explicit Scope(const char* pass) : m_pass(pass) { Begin(pass); }
+        ~Scope() { End(m_pass); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* m_pass;
+    };
+
+    // Host time of `name`, measured by the caller
+    void RecordCpu(const char* name, double milliseconds);
+
+    // Safe from any thread
+    std::vector<PassStats> GetGpuStats();
+    std::vector<PassStats> GetCpuStats();
+    void Reset();  // Drops the samples, keeps the query objects
+
+    // Deletes the query objects of the calling thread's passes
+    void Cleanup();
+}
+
+#endif // GPU_PROFILER_H
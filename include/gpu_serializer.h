@@ -1,5 +1,8 @@
 #pragma once
 #include "parser.h"
+#include "equation_optimizer.h"
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <vector>
 #include <unordered_map>
@@ -44,8 +47,53 @@ namespace GPUTokens {
     const int TOKEN_CLOSE_PAREN = 31;
     const int TOKEN_COMMA = 32;
     const int TOKEN_DERIVATIVE = 33;
+
+    // Real-only opcodes, emitted by inferRealOpcodes() when every operand is provably real
+    const int TOKEN_MUL_R = 34;
+    const int TOKEN_DIV_R = 35;
+    const int TOKEN_SIN_R = 36;
+    const int TOKEN_COS_R = 37;
+    const int TOKEN_TAN_R = 38;
+    const int TOKEN_EXP_R = 39;
+
+    // Pair reductions: [TOKEN_PAIR_SUM, slot, reduction, radiusConstIndex, bodyCount, body...],
+    // body tokens may use TOKEN_PAIR_REF; radiusConstIndex is -1 for sum_j() (every other object)
+    const int TOKEN_PAIR_REF = 40;
+    const int TOKEN_PAIR_SUM = 41;
+
+    // Common subexpressions from OptimizeEquation(): [TOKEN_TEMP_STORE, slot] keeps the top
+    // of the stack in a per-equation temporary, [TOKEN_TEMP_LOAD, slot] pushes it again
+    const int TOKEN_TEMP_STORE = 42;
+    const int TOKEN_TEMP_LOAD = 43;
+
+    // Lookups (lookup_tables.h): table(id, x) and field(id, x, y) take their operands from the stack
+    const int TOKEN_TABLE = 44;
+    const int TOKEN_FIELD = 45;
+
+    // if(cond, a, b) as cond [TOKEN_BRANCH, skip] a... [TOKEN_JUMP, skip] b...: BRANCH pops the
+    // condition and, unless it is > 0, skips its count of entries past the operand (a and the
+    // JUMP); JUMP skips b. Only the taken branch is evaluated.
+    const int TOKEN_BRANCH = 46;
+    const int TOKEN_JUMP = 47;
+
+    // Fused intrinsics from OptimizeEquation() on operands known to be real, each a single real
+    // ALU sequence: len2(a, b), dot2(ax, ay, bx, by), hypot(a, b), invcube(a, b) = len2^-1.5
+    // and rsqrt(x); operands on the stack, the result is real
+    const int TOKEN_LEN2 = 48;
+    const int TOKEN_DOT2 = 49;
+    const int TOKEN_HYPOT = 50;
+    const int TOKEN_INVCUBE = 51;
+    const int TOKEN_RSQRT = 52;
+
+    // A subexpression OptimizeEquation() hoisted (TOKEN_HOIST) as [TOKEN_PRELUDE, slot, bodyCount]
+    // body...: where math.comp's prelude pass has run, the slot's value is pushed and the body
+    // skipped; everywhere else the body right after the header is evaluated in place
+    const int TOKEN_PRELUDE = 53;
 }
 
+// Pair reduction terms per equation, each with its own precomputed slot - MUST MATCH math.comp
+const int MAX_PAIR_SUMS_PER_EQUATION = 4;
+
 // ============================================================================
 // VARIABLE NAME HASHING - MUST MATCH SHADER EXACTLY
 // ============================================================================
@@ -78,6 +126,26 @@ namespace VariableHashes {
     const int VAR_HASH_AMP = 26;
     const int VAR_HASH_OMEGA = 27;      // FIXED: Was 28, now matches shader
     const int VAR_HASH_ALPHA = 28;      // FIXED: Was 29, now matches shader
+    const int VAR_HASH_GRAV_AX = 29;    // Barnes-Hut gravity, see long_range.h
+    const int VAR_HASH_GRAV_AY = 30;
+    const int VAR_HASH_COUL_AX = 31;    // Barnes-Hut Coulomb
+    const int VAR_HASH_COUL_AY = 32;
+    const int VAR_HASH_PARAM_0 = 33;    // $0..$7 per-object parameters, see object_params.h
+    const int VAR_HASH_PARAM_7 = 40;
+    const int VAR_HASH_SPH_AX = 41;     // SPH fluid, see sph_fluid.h
+    const int VAR_HASH_SPH_AY = 42;
+    const int VAR_HASH_SPH_RHO = 43;
+    const int VAR_HASH_SPH_P = 44;
+    const int VAR_HASH_RAND_0 = 45;     // rand() call sites, see MAX_RANDOM_SITES in parser.h
+    const int VAR_HASH_RAND_7 = 52;
+    const int VAR_HASH_RANDN_0 = 53;    // randn() call sites
+    const int VAR_HASH_RANDN_7 = 60;
+    const int VAR_HASH_STATE_0 = 61;    // s0..s7 state registers, see state_registers.h
+    const int VAR_HASH_STATE_7 = 68;
+    const int VAR_HASH_AGG_0 = 69;      // agg[name] group aggregates by slot, see object_aggregates.h
+    const int VAR_HASH_AGG_15 = 84;
+    const int VAR_HASH_FIELD_0 = 85;    // fld[name] pipeline fields by slot, see object_pipeline.h
+    const int VAR_HASH_FIELD_7 = 92;
 }
 
 // ============================================================================
@@ -101,6 +169,17 @@ namespace PropertyHashes {
     const int PROP_HASH_COLOR_G = 14;
     const int PROP_HASH_COLOR_B = 15;
     const int PROP_HASH_COLOR_A = 16;
+    const int PROP_HASH_FIELD_0 = 17;    // pj.fld[name], the neighbour's pipeline fields
+    const int PROP_HASH_FIELD_7 = 24;
+}
+
+// ============================================================================
+// PAIR REDUCTION CONSTANTS - MUST MATCH SHADER EXACTLY
+// ============================================================================
+namespace PairReductions {
+    const int PAIR_REDUCE_SUM = 0;
+    const int PAIR_REDUCE_COUNT = 1;
+    const int PAIR_REDUCE_MEAN = 2;
 }
 
 // ============================================================================
@@ -109,6 +188,7 @@ namespace PropertyHashes {
 namespace DerivativeMethods {
     const int DERIV_METHOD_NUMERICAL = 0;
     const int DERIV_METHOD_SYMBOLIC = 1;
+    const int DERIV_METHOD_DUAL = 2;
 }
 
 // ============================================================================
@@ -142,7 +222,71 @@ static const std::unordered_map<std::string, int> s_variableHashMap = {
     {"charge", VariableHashes::VAR_HASH_CHARGE},
     {"coupling", VariableHashes::VAR_HASH_COUPLING},
     {"freq", VariableHashes::VAR_HASH_FREQ},
-    {"amp", VariableHashes::VAR_HASH_AMP}
+    {"amp", VariableHashes::VAR_HASH_AMP},
+    {"grav_ax", VariableHashes::VAR_HASH_GRAV_AX},
+    {"grav_ay", VariableHashes::VAR_HASH_GRAV_AY},
+    {"coul_ax", VariableHashes::VAR_HASH_COUL_AX},
+    {"coul_ay", VariableHashes::VAR_HASH_COUL_AY},
+    {"$0", VariableHashes::VAR_HASH_PARAM_0},
+    {"$1", VariableHashes::VAR_HASH_PARAM_0 + 1},
+    {"$2", VariableHashes::VAR_HASH_PARAM_0 + 2},
+    {"$3", VariableHashes::VAR_HASH_PARAM_0 + 3},
+    {"$4", VariableHashes::VAR_HASH_PARAM_0 + 4},
+    {"$5", VariableHashes::VAR_HASH_PARAM_0 + 5},
+    {"$6", VariableHashes::VAR_HASH_PARAM_0 + 6},
+    {"$7", VariableHashes::VAR_HASH_PARAM_0 + 7},
+    {"sph_ax", VariableHashes::VAR_HASH_SPH_AX},
+    {"sph_ay", VariableHashes::VAR_HASH_SPH_AY},
+    {"sph_rho", VariableHashes::VAR_HASH_SPH_RHO},
+    {"sph_p", VariableHashes::VAR_HASH_SPH_P},
+    {"rand#0", VariableHashes::VAR_HASH_RAND_0},
+    {"rand#1", VariableHashes::VAR_HASH_RAND_0 + 1},
+    {"rand#2", VariableHashes::VAR_HASH_RAND_0 + 2},
+    {"rand#3", VariableHashes::VAR_HASH_RAND_0 + 3},
+    {"rand#4", VariableHashes::VAR_HASH_RAND_0 + 4},
+    {"rand#5", VariableHashes::VAR_HASH_RAND_0 + 5},
+    {"rand#6", VariableHashes::VAR_HASH_RAND_0 + 6},
+    {"rand#7", VariableHashes::VAR_HASH_RAND_0 + 7},
+    {"randn#0", VariableHashes::VAR_HASH_RANDN_0},
+    {"randn#1", VariableHashes::VAR_HASH_RANDN_0 + 1},
+    {"randn#2", VariableHashes::VAR_HASH_RANDN_0 + 2},
+    {"randn#3", VariableHashes::VAR_HASH_RANDN_0 + 3},
+    {"randn#4", VariableHashes::VAR_HASH_RANDN_0 + 4},
+    {"randn#5", VariableHashes::VAR_HASH_RANDN_0 + 5},
+    {"randn#6", VariableHashes::VAR_HASH_RANDN_0 + 6},
+    {"randn#7", VariableHashes::VAR_HASH_RANDN_0 + 7},
+    {"s0", VariableHashes::VAR_HASH_STATE_0},
+    {"s1", VariableHashes::VAR_HASH_STATE_0 + 1},
+    {"s2", VariableHashes::VAR_HASH_STATE_0 + 2},
+    {"s3", VariableHashes::VAR_HASH_STATE_0 + 3},
+    {"s4", VariableHashes::VAR_HASH_STATE_0 + 4},
+    {"s5", VariableHashes::VAR_HASH_STATE_0 + 5},
+    {"s6", VariableHashes::VAR_HASH_STATE_0 + 6},
+    {"s7", VariableHashes::VAR_HASH_STATE_0 + 7},
+    {"agg[0]", VariableHashes::VAR_HASH_AGG_0},
+    {"agg[1]", VariableHashes::VAR_HASH_AGG_0 + 1},
+    {"agg[2]", VariableHashes::VAR_HASH_AGG_0 + 2},
+    {"agg[3]", VariableHashes::VAR_HASH_AGG_0 + 3},
+    {"agg[4]", VariableHashes::VAR_HASH_AGG_0 + 4},
+    {"agg[5]", VariableHashes::VAR_HASH_AGG_0 + 5},
+    {"agg[6]", VariableHashes::VAR_HASH_AGG_0 + 6},
+    {"agg[7]", VariableHashes::VAR_HASH_AGG_0 + 7},
+    {"agg[8]", VariableHashes::VAR_HASH_AGG_0 + 8},
+    {"agg[9]", VariableHashes::VAR_HASH_AGG_0 + 9},
+    {"agg[10]", VariableHashes::VAR_HASH_AGG_0 + 10},
+    {"agg[11]", VariableHashes::VAR_HASH_AGG_0 + 11},
+    {"agg[12]", VariableHashes::VAR_HASH_AGG_0 + 12},
+    {"agg[13]", VariableHashes::VAR_HASH_AGG_0 + 13},
+    {"agg[14]", VariableHashes::VAR_HASH_AGG_0 + 14},
+    {"agg[15]", VariableHashes::VAR_HASH_AGG_0 + 15},
+    {"fld[0]", VariableHashes::VAR_HASH_FIELD_0},
+    {"fld[1]", VariableHashes::VAR_HASH_FIELD_0 + 1},
+    {"fld[2]", VariableHashes::VAR_HASH_FIELD_0 + 2},
+    {"fld[3]", VariableHashes::VAR_HASH_FIELD_0 + 3},
+    {"fld[4]", VariableHashes::VAR_HASH_FIELD_0 + 4},
+    {"fld[5]", VariableHashes::VAR_HASH_FIELD_0 + 5},
+    {"fld[6]", VariableHashes::VAR_HASH_FIELD_0 + 6},
+    {"fld[7]", VariableHashes::VAR_HASH_FIELD_0 + 7}
 };
 
 static const std::unordered_map<std::string, int> s_propertyHashMap = {
@@ -162,7 +306,15 @@ static const std::unordered_map<std::string, int> s_propertyHashMap = {
     {"color.r", PropertyHashes::PROP_HASH_COLOR_R},
     {"color.g", PropertyHashes::PROP_HASH_COLOR_G},
     {"color.b", PropertyHashes::PROP_HASH_COLOR_B},
-    {"color.a", PropertyHashes::PROP_HASH_COLOR_A}
+    {"color.a", PropertyHashes::PROP_HASH_COLOR_A},
+    {"fld[0]", PropertyHashes::PROP_HASH_FIELD_0},
+    {"fld[1]", PropertyHashes::PROP_HASH_FIELD_0 + 1},
+    {"fld[2]", PropertyHashes::PROP_HASH_FIELD_0 + 2},
+    {"fld[3]", PropertyHashes::PROP_HASH_FIELD_0 + 3},
+    {"fld[4]", PropertyHashes::PROP_HASH_FIELD_0 + 4},
+    {"fld[5]", PropertyHashes::PROP_HASH_FIELD_0 + 5},
+    {"fld[6]", PropertyHashes::PROP_HASH_FIELD_0 + 6},
+    {"fld[7]", PropertyHashes::PROP_HASH_FIELD_0 + 7}
 };
 
 // Map new parser token types to GPU token types
@@ -188,6 +340,13 @@ static const std::unordered_map<TokenType, int> s_tokenTypeMap = {
     {TOKEN_FRAC, GPUTokens::TOKEN_FRAC},
     {TOKEN_MOD, GPUTokens::TOKEN_MOD},
     {TOKEN_ATAN2, GPUTokens::TOKEN_ATAN2},
+    {TOKEN_TABLE, GPUTokens::TOKEN_TABLE},
+    {TOKEN_FIELD, GPUTokens::TOKEN_FIELD},
+    {TOKEN_LEN2, GPUTokens::TOKEN_LEN2},
+    {TOKEN_DOT2, GPUTokens::TOKEN_DOT2},
+    {TOKEN_HYPOT, GPUTokens::TOKEN_HYPOT},
+    {TOKEN_INVCUBE, GPUTokens::TOKEN_INVCUBE},
+    {TOKEN_RSQRT, GPUTokens::TOKEN_RSQRT},
     {TOKEN_REAL, GPUTokens::TOKEN_REAL},
     {TOKEN_IMAG, GPUTokens::TOKEN_IMAG},
     {TOKEN_CONJ, GPUTokens::TOKEN_CONJ},
@@ -199,6 +358,30 @@ static const std::unordered_map<TokenType, int> s_tokenTypeMap = {
     {TOKEN_COMMA, GPUTokens::TOKEN_COMMA}
 };
 
+// Operands a parser token pops before it pushes one value: 0 for leaves, -1 for tokens that
+// leave the stack as it is (temporary stores, parentheses and commas)
+inline int rpnOperandCount(TokenType type) {
+    switch (type) {
+        case TOKEN_NUMBER: case TOKEN_VARIABLE: case TOKEN_OBJECT_REF: case TOKEN_PAIR_REF:
+        case TOKEN_PAIR_SUM: case TOKEN_DERIVATIVE: case TOKEN_TEMP_LOAD:
+            return 0;
+        case TOKEN_NEG: case TOKEN_SIN: case TOKEN_COS: case TOKEN_TAN: case TOKEN_SQRT: case TOKEN_LOG:
+        case TOKEN_EXP: case TOKEN_ABS: case TOKEN_FLOOR: case TOKEN_CEIL: case TOKEN_FRAC: case TOKEN_SIGN:
+        case TOKEN_STEP: case TOKEN_REAL: case TOKEN_IMAG: case TOKEN_CONJ: case TOKEN_ARG: case TOKEN_RSQRT:
+            return 1;
+        case TOKEN_ADD: case TOKEN_SUB: case TOKEN_MUL: case TOKEN_DIV: case TOKEN_POW: case TOKEN_MIN:
+        case TOKEN_MAX: case TOKEN_MOD: case TOKEN_ATAN2: case TOKEN_TABLE:
+        case TOKEN_LEN2: case TOKEN_HYPOT: case TOKEN_INVCUBE:
+            return 2;
+        case TOKEN_CLAMP: case TOKEN_FIELD: case TOKEN_IF:
+            return 3;
+        case TOKEN_DOT2:
+            return 4;
+        default:
+            return -1;
+    }
+}
+
 // ============================================================================
 // HELPER FUNCTIONS
 // ============================================================================
@@ -219,6 +402,25 @@ inline int hashPropertyName(const std::string& name) {
     throw std::runtime_error("Unknown property name: " + name);
 }
 
+// Symbol overloads: each symbol is looked up by name once per thread, then by index
+inline int hashSymbol(SymbolId id, int (*hashName)(const std::string&), std::vector<int>& cache) {
+    const int UNRESOLVED = -1;  // Real hashes are never negative
+    if (id < 0) return hashName(symbolName(id));
+    if (id >= static_cast<int>(cache.size())) cache.resize(id + 1, UNRESOLVED);
+    if (cache[id] == UNRESOLVED) cache[id] = hashName(symbolName(id));
+    return cache[id];
+}
+
+inline int hashVariableName(SymbolId id) {
+    static thread_local std::vector<int> s_cache;
+    return hashSymbol(id, hashVariableName, s_cache);
+}
+
+inline int hashPropertyName(SymbolId id) {
+    static thread_local std::vector<int> s_cache;
+    return hashSymbol(id, hashPropertyName, s_cache);
+}
+
 // ============================================================================
 // GPU SERIALIZED EQUATION STRUCTURE (EXTENDED)
 // ============================================================================
@@ -238,6 +440,25 @@ struct GPUSerializedEquation {
     std::vector<int> tokenBuffer_a;
     std::vector<float> constantBuffer_a;
     
+    // Register bytecode per component, empty where only the stack encoding can express it
+    std::vector<unsigned int> bytecode_ax;
+    std::vector<unsigned int> bytecode_ay;
+    std::vector<unsigned int> bytecode_angular;
+    std::vector<unsigned int> bytecode_r;
+    std::vector<unsigned int> bytecode_g;
+    std::vector<unsigned int> bytecode_b;
+    std::vector<unsigned int> bytecode_a;
+    
+    // sK = expr updates, stack encoding only; they share one constant buffer
+    std::vector<int> tokenBuffer_state[MAX_STATE_REGISTERS];
+    std::vector<float> constantBuffer_state;
+    
+    bool hasStateUpdates() const {
+        for (const auto& tokens : tokenBuffer_state)
+            if (!tokens.empty()) return true;
+        return false;
+    }
+    
     void clear() {
         tokenBuffer_ax.clear();
         constantBuffer_ax.clear();
@@ -253,6 +474,15 @@ struct GPUSerializedEquation {
         constantBuffer_b.clear();
         tokenBuffer_a.clear();
         constantBuffer_a.clear();
+        bytecode_ax.clear();
+        bytecode_ay.clear();
+        bytecode_angular.clear();
+        bytecode_r.clear();
+        bytecode_g.clear();
+        bytecode_b.clear();
+        bytecode_a.clear();
+        for (auto& tokens : tokenBuffer_state) tokens.clear();
+        constantBuffer_state.clear();
     }
 };
 
@@ -260,35 +490,665 @@ struct GPUSerializedEquation {
 // SERIALIZATION FUNCTIONS
 // ============================================================================
 
+// ============================================================================
+// REAL/COMPLEX TYPE INFERENCE
+// ============================================================================
+
+// Static type of an RPN stack entry, mirroring the shader's isComplex flag
+enum GPUValueType {
+    GPU_VALUE_REAL,     // Flag is always false
+    GPU_VALUE_COMPLEX,  // Flag is always true
+    GPU_VALUE_UNKNOWN   // Decided at run time (real power of a possibly negative base)
+};
+
+// Walk one serialized expression and switch MUL/DIV/SIN/COS/TAN/EXP to their
+// real-only opcodes where all operands are provably real. The stack effects
+// MUST MATCH evaluateRPNComponent() in math.comp, so the rewrite never changes
+// which entries the interpreter treats as complex. tempTypes carries the types
+// of stored temporaries from one component to the next. After an if() the value has the
+// type of its branches where they agree and is unknown where they do not.
+inline void inferRealOpcodes(std::vector<int>& tokenBuffer, std::vector<GPUValueType>* tempTypes = nullptr) {
+    std::vector<GPUValueType> stack;
+    auto pop = [&stack]() {
+        GPUValueType type = stack.back();
+        stack.pop_back();
+        return type;
+    };
+    auto combine = [](GPUValueType a, GPUValueType b) {
+        if (a == GPU_VALUE_COMPLEX || b == GPU_VALUE_COMPLEX) return GPU_VALUE_COMPLEX;
+        if (a == GPU_VALUE_UNKNOWN || b == GPU_VALUE_UNKNOWN) return GPU_VALUE_UNKNOWN;
+        return GPU_VALUE_REAL;
+    };
+
+    // Open if() else branches: where each ends and the type its then branch left
+    size_t i = 0;
+    std::vector<std::pair<size_t, GPUValueType>> merges;
+    auto mergeBranches = [&]() {
+        while (!merges.empty() && i >= merges.back().first) {
+            GPUValueType thenType = merges.back().second;
+            merges.pop_back();
+            if (stack.empty()) continue;
+            if (stack.back() != thenType) stack.back() = GPU_VALUE_UNKNOWN;
+        }
+    };
+
+    while (i < tokenBuffer.size()) {
+        mergeBranches();
+        int& token = tokenBuffer[i++];
+        switch (token) {
+            case GPUTokens::TOKEN_NUMBER:
+                i += 1;
+                stack.push_back(GPU_VALUE_REAL);
+                break;
+
+            case GPUTokens::TOKEN_BRANCH:
+                i += 1;
+                if (!stack.empty()) stack.pop_back();
+                break;
+
+            case GPUTokens::TOKEN_PRELUDE:
+                i += 2;  // The body pushes the value
+                break;
+
+            case GPUTokens::TOKEN_JUMP: {
+                // The else branch pushes its value in place of the then branch's
+                size_t skip = (i < tokenBuffer.size()) ? static_cast<size_t>(std::max(tokenBuffer[i], 0)) : 0;
+                i += 1;
+                if (stack.empty()) break;
+                merges.push_back({ i + skip, pop() });
+                break;
+            }
+
+            case GPUTokens::TOKEN_VARIABLE:
+                if (i < tokenBuffer.size() && tokenBuffer[i] == VariableHashes::VAR_HASH_I)
+                    stack.push_back(GPU_VALUE_COMPLEX);
+                else
+                    stack.push_back(GPU_VALUE_REAL);
+                i += 1;
+                break;
+
+            case GPUTokens::TOKEN_OBJECT_REF:
+                i += 2;
+                stack.push_back(GPU_VALUE_REAL);
+                break;
+
+            case GPUTokens::TOKEN_PAIR_REF:
+                i += 1;
+                stack.push_back(GPU_VALUE_REAL);
+                break;
+
+            case GPUTokens::TOKEN_PAIR_SUM:
+                // The body was already inferred on its own; the precomputed reduction is real
+                if (i + 3 < tokenBuffer.size()) i += 4 + tokenBuffer[i + 3];
+                else i = tokenBuffer.size();
+                stack.push_back(GPU_VALUE_REAL);
+                break;
+
+            case GPUTokens::TOKEN_DERIVATIVE:
+                // The derivative body was already inferred on its own; the result is pushed as complex
+                if (i + 3 < tokenBuffer.size()) i += 4 + tokenBuffer[i + 3];
+                else i = tokenBuffer.size();
+                stack.push_back(GPU_VALUE_COMPLEX);
+                break;
+
+            case GPUTokens::TOKEN_TEMP_STORE: {
+                int slot = (i < tokenBuffer.size()) ? tokenBuffer[i] : -1;
+                i += 1;
+                if (tempTypes && slot >= 0 && !stack.empty()) {
+                    if (slot >= static_cast<int>(tempTypes->size())) tempTypes->resize(slot + 1, GPU_VALUE_UNKNOWN);
+                    (*tempTypes)[slot] = stack.back();
+                }
+                break;
+            }
+
+            case GPUTokens::TOKEN_TEMP_LOAD: {
+                int slot = (i < tokenBuffer.size()) ? tokenBuffer[i] : -1;
+                i += 1;
+                bool known = tempTypes && slot >= 0 && slot < static_cast<int>(tempTypes->size());
+                stack.push_back(known ? (*tempTypes)[slot] : GPU_VALUE_UNKNOWN);
+                break;
+            }
+
+            case GPUTokens::TOKEN_ADD:
+            case GPUTokens::TOKEN_SUB:
+            case GPUTokens::TOKEN_MUL:
+            case GPUTokens::TOKEN_DIV:
+            case GPUTokens::TOKEN_POW: {
+                // Underflow resets the shader stack to a single real zero
+                if (stack.size() < 2) { stack.assign(1, GPU_VALUE_REAL); break; }
+                GPUValueType b = pop();
+                GPUValueType a = pop();
+                GPUValueType result = combine(a, b);
+                if (token == GPUTokens::TOKEN_MUL || token == GPUTokens::TOKEN_DIV) {
+                    if (result == GPU_VALUE_REAL)
+                        token = (token == GPUTokens::TOKEN_MUL) ? GPUTokens::TOKEN_MUL_R : GPUTokens::TOKEN_DIV_R;
+                    else
+                        result = GPU_VALUE_COMPLEX;
+                } else if (token == GPUTokens::TOKEN_POW && result == GPU_VALUE_REAL) {
+                    result = GPU_VALUE_UNKNOWN;  // Negative bases switch to complex power
+                }
+                stack.push_back(result);
+                break;
+            }
+
+            case GPUTokens::TOKEN_NEG:
+            case GPUTokens::TOKEN_SIN:
+            case GPUTokens::TOKEN_COS:
+            case GPUTokens::TOKEN_TAN:
+            case GPUTokens::TOKEN_EXP:
+            case GPUTokens::TOKEN_LOG:
+            case GPUTokens::TOKEN_SQRT:
+            case GPUTokens::TOKEN_ABS: {
+                if (stack.empty()) { stack.assign(1, GPU_VALUE_REAL); break; }
+                GPUValueType a = pop();
+                if (token == GPUTokens::TOKEN_NEG) {
+                    stack.push_back(a);
+                } else if (token == GPUTokens::TOKEN_ABS) {
+                    stack.push_back(GPU_VALUE_REAL);
+                } else if (token == GPUTokens::TOKEN_SQRT) {
+                    // Real for a non-negative real operand, like a real power
+                    stack.push_back(a == GPU_VALUE_COMPLEX ? GPU_VALUE_COMPLEX : GPU_VALUE_UNKNOWN);
+                } else if (a == GPU_VALUE_REAL && token != GPUTokens::TOKEN_LOG) {
+                    // log of a negative real is complex, so it always stays complex
+                    if (token == GPUTokens::TOKEN_SIN) token = GPUTokens::TOKEN_SIN_R;
+                    else if (token == GPUTokens::TOKEN_COS) token = GPUTokens::TOKEN_COS_R;
+                    else if (token == GPUTokens::TOKEN_TAN) token = GPUTokens::TOKEN_TAN_R;
+                    else token = GPUTokens::TOKEN_EXP_R;
+                    stack.push_back(GPU_VALUE_REAL);
+                } else {
+                    stack.push_back(GPU_VALUE_COMPLEX);
+                }
+                break;
+            }
+
+            case GPUTokens::TOKEN_MOD:
+            case GPUTokens::TOKEN_MIN:
+            case GPUTokens::TOKEN_MAX:
+            case GPUTokens::TOKEN_ATAN2:
+            case GPUTokens::TOKEN_TABLE:
+                if (stack.size() < 2) break;
+                stack.pop_back();
+                stack.back() = GPU_VALUE_REAL;
+                break;
+
+            case GPUTokens::TOKEN_CLAMP:
+            case GPUTokens::TOKEN_FIELD:
+                if (stack.size() < 3) break;
+                stack.pop_back();
+                stack.pop_back();
+                stack.back() = GPU_VALUE_REAL;
+                break;
+
+            case GPUTokens::TOKEN_LEN2:
+            case GPUTokens::TOKEN_DOT2:
+            case GPUTokens::TOKEN_HYPOT:
+            case GPUTokens::TOKEN_INVCUBE:
+            case GPUTokens::TOKEN_RSQRT: {
+                size_t operands = (token == GPUTokens::TOKEN_DOT2) ? 4 : (token == GPUTokens::TOKEN_RSQRT) ? 1 : 2;
+                if (stack.size() < operands) break;
+                stack.resize(stack.size() - operands + 1);
+                stack.back() = GPU_VALUE_REAL;
+                break;
+            }
+
+            case GPUTokens::TOKEN_REAL:
+            case GPUTokens::TOKEN_IMAG:
+            case GPUTokens::TOKEN_ARG:
+                if (!stack.empty()) stack.back() = GPU_VALUE_REAL;
+                break;
+
+            default:
+                // FLOOR/CEIL/FRAC/SIGN/STEP/CONJ keep the type; parentheses and commas are ignored
+                break;
+        }
+    }
+    mergeBranches();
+}
+
+// ============================================================================
+// REGISTER BYTECODE
+// ============================================================================
+
+// Three-address form of a serialized component, evaluated by evaluateRegisterComponent()
+// in math.comp without a stack pointer or isComplex flags. One uint per instruction:
+//   bits 0-7 opcode, 8-15 destination register, 16-23 source A, 24-31 source B
+// Loads take a 16-bit immediate in bits 16-31 instead of the sources. A program starts
+// with one header word holding its length in words. Opcodes MUST MATCH math.comp.
+namespace RegisterOps {
+    const unsigned int OP_LOAD_CONST = 0;     // d = constants[imm]
+    const unsigned int OP_LOAD_VAR = 1;       // d = variable with hash imm
+    const unsigned int OP_LOAD_OBJECT = 2;    // d = p[next word].(property a); two words
+    const unsigned int OP_LOAD_PAIR_SUM = 3;  // d = pair reduction slot imm
+    const unsigned int OP_LOAD_TEMP = 4;      // d = temporary imm
+    const unsigned int OP_STORE_TEMP = 5;     // temporary b = a; d is the isComplex flag, 2 = imaginary part != 0
+    const unsigned int OP_ADD = 6;
+    const unsigned int OP_SUB = 7;
+    const unsigned int OP_MUL = 8;
+    const unsigned int OP_DIV = 9;
+    const unsigned int OP_MUL_R = 10;
+    const unsigned int OP_DIV_R = 11;
+    const unsigned int OP_POW = 12;
+    const unsigned int OP_NEG = 13;
+    const unsigned int OP_SIN = 14;
+    const unsigned int OP_COS = 15;
+    const unsigned int OP_TAN = 16;
+    const unsigned int OP_EXP = 17;
+    const unsigned int OP_LOG = 18;
+    const unsigned int OP_SQRT = 19;
+    const unsigned int OP_ABS = 20;
+    const unsigned int OP_SIN_R = 21;
+    const unsigned int OP_COS_R = 22;
+    const unsigned int OP_TAN_R = 23;
+    const unsigned int OP_EXP_R = 24;
+    const unsigned int OP_FLOOR = 25;         // FLOOR..CLAMP and ARG_R take real operands only
+    const unsigned int OP_CEIL = 26;
+    const unsigned int OP_FRAC = 27;
+    const unsigned int OP_SIGN = 28;
+    const unsigned int OP_STEP = 29;
+    const unsigned int OP_MOD = 30;
+    const unsigned int OP_MIN = 31;
+    const unsigned int OP_MAX = 32;
+    const unsigned int OP_ATAN2 = 33;
+    const unsigned int OP_CLAMP = 34;         // d = clamp(d, a, b)
+    const unsigned int OP_REAL = 35;
+    const unsigned int OP_IMAG = 36;
+    const unsigned int OP_CONJ = 37;
+    const unsigned int OP_ARG_R = 38;
+    const unsigned int OP_ARG = 39;
+    const unsigned int OP_POW_C = 40;         // POW and SQRT of operands known to be complex
+    const unsigned int OP_SQRT_C = 41;
+    const unsigned int OP_TABLE = 42;         // d = table(a, b)
+    const unsigned int OP_FIELD = 43;         // d = field(d, a, b)
+    const unsigned int OP_LEN2 = 44;          // Fused intrinsics on the real parts: d = len2(a, b)
+    const unsigned int OP_DOT2 = 45;          // d = dot2(d, d + 1, d + 2, d + 3)
+    const unsigned int OP_HYPOT = 46;
+    const unsigned int OP_INVCUBE = 47;
+    const unsigned int OP_RSQRT = 48;         // d = rsqrt(a)
+    const unsigned int OP_LOAD_PRELUDE = 49;  // d = prelude slot imm, skipping the next word's count of words after it
+}
+
+// Registers per component program - MUST MATCH MAX_BYTECODE_REGISTERS in math.comp
+const int MAX_BYTECODE_REGISTERS = 16;
+
+inline unsigned int encodeRegisterInstruction(unsigned int op, int d, int a = 0, int b = 0) {
+    return op | (static_cast<unsigned int>(d) << 8) | (static_cast<unsigned int>(a) << 16) |
+           (static_cast<unsigned int>(b) << 24);
+}
+
+// Translate one serialized component (after inferRealOpcodes) into register bytecode.
+// RPN values die in stack order, so the value at stack depth k lives in register k and
+// every operator writes over its first operand. A hoisted body follows its OP_LOAD_PRELUDE,
+// which skips it where the prelude value is there. Returns false, leaving out empty, when the
+// component needs something only the stack interpreter has: D(), if() jumps, run-time
+// isComplex flags for FLOOR/MOD/MIN/ARG/..., or more than MAX_BYTECODE_REGISTERS live values.
+inline bool compileRegisterBytecode(const std::vector<int>& tokenBuffer,
+                                    const std::vector<GPUValueType>& tempTypes,
+                                    std::vector<unsigned int>& out) {
+    using namespace RegisterOps;
+    out.clear();
+    std::vector<unsigned int> code;
+    std::vector<GPUValueType> regs;  // Static type of each live register
+    size_t liveRegisters = 0;        // High-water mark of regs
+
+    auto operand = [&tokenBuffer](size_t index, int& value) {
+        if (index >= tokenBuffer.size()) return false;
+        value = tokenBuffer[index];
+        return true;
+    };
+    auto define = [&regs, &liveRegisters](GPUValueType type) {
+        regs.push_back(type);
+        liveRegisters = std::max(liveRegisters, regs.size());
+        return static_cast<int>(regs.size()) - 1;
+    };
+    auto combine = [](GPUValueType a, GPUValueType b) {
+        if (a == GPU_VALUE_COMPLEX || b == GPU_VALUE_COMPLEX) return GPU_VALUE_COMPLEX;
+        if (a == GPU_VALUE_UNKNOWN || b == GPU_VALUE_UNKNOWN) return GPU_VALUE_UNKNOWN;
+        return GPU_VALUE_REAL;
+    };
+
+    // Open hoisted bodies: where each ends in tokenBuffer and the code index of its skip word
+    std::vector<std::pair<size_t, size_t>> preludes;
+    auto closePreludes = [&](size_t at) {
+        while (!preludes.empty() && at >= preludes.back().first) {
+            code[preludes.back().second] = static_cast<unsigned int>(code.size() - preludes.back().second - 1);
+            preludes.pop_back();
+        }
+    };
+
+    size_t i = 0;
+    while (i < tokenBuffer.size()) {
+        closePreludes(i);
+        int token = tokenBuffer[i++];
+        int top = static_cast<int>(regs.size()) - 1;
+        int value = 0;
+
+        switch (token) {
+            case GPUTokens::TOKEN_NUMBER:
+                if (!operand(i++, value) || value < 0 || value > 0xFFFF) return false;
+                code.push_back(encodeRegisterInstruction(OP_LOAD_CONST, define(GPU_VALUE_REAL), value & 0xFF, value >> 8));
+                break;
+
+            case GPUTokens::TOKEN_VARIABLE:
+                if (!operand(i++, value) || value < 0 || value > 0xFFFF) return false;
+                code.push_back(encodeRegisterInstruction(OP_LOAD_VAR,
+                    define(value == VariableHashes::VAR_HASH_I ? GPU_VALUE_COMPLEX : GPU_VALUE_REAL), value & 0xFF, value >> 8));
+                break;
+
+            case GPUTokens::TOKEN_OBJECT_REF: {
+                int propHash = 0;
+                if (!operand(i++, value) || !operand(i++, propHash) || propHash < 0 || propHash > 0xFF) return false;
+                code.push_back(encodeRegisterInstruction(OP_LOAD_OBJECT, define(GPU_VALUE_REAL), propHash));
+                code.push_back(static_cast<unsigned int>(value));
+                break;
+            }
+
+            case GPUTokens::TOKEN_PAIR_SUM: {
+                int bodyCount = 0;
+                if (!operand(i, value) || !operand(i + 3, bodyCount)) return false;
+                i += 4 + bodyCount;
+                code.push_back(encodeRegisterInstruction(OP_LOAD_PAIR_SUM, define(GPU_VALUE_REAL), value & 0xFF, value >> 8));
+                break;
+            }
+
+            case GPUTokens::TOKEN_PRELUDE: {
+                // The body defines the next register either way
+                int bodyCount = 0;
+                if (!operand(i++, value) || !operand(i++, bodyCount) || value < 0 || value > 0xFF ||
+                    static_cast<int>(regs.size()) >= MAX_BYTECODE_REGISTERS) return false;
+                code.push_back(encodeRegisterInstruction(OP_LOAD_PRELUDE, static_cast<int>(regs.size()), value & 0xFF, value >> 8));
+                preludes.push_back({ i + static_cast<size_t>(std::max(bodyCount, 0)), code.size() });
+                code.push_back(0u);
+                break;
+            }
+
+            case GPUTokens::TOKEN_TEMP_LOAD: {
+                if (!operand(i++, value) || value < 0 || value > 0xFF) return false;
+                GPUValueType type = (value < static_cast<int>(tempTypes.size())) ? tempTypes[value] : GPU_VALUE_UNKNOWN;
+                code.push_back(encodeRegisterInstruction(OP_LOAD_TEMP, define(type), value));
+                break;
+            }
+
+            case GPUTokens::TOKEN_TEMP_STORE: {
+                if (!operand(i++, value) || value < 0 || value > 0xFF || regs.empty()) return false;
+                int flag = (regs[top] == GPU_VALUE_REAL) ? 0 : (regs[top] == GPU_VALUE_COMPLEX) ? 1 : 2;
+                code.push_back(encodeRegisterInstruction(OP_STORE_TEMP, flag, top, value));
+                break;
+            }
+
+            case GPUTokens::TOKEN_ADD:
+            case GPUTokens::TOKEN_SUB:
+            case GPUTokens::TOKEN_MUL:
+            case GPUTokens::TOKEN_DIV:
+            case GPUTokens::TOKEN_MUL_R:
+            case GPUTokens::TOKEN_DIV_R:
+            case GPUTokens::TOKEN_POW:
+            case GPUTokens::TOKEN_MOD:
+            case GPUTokens::TOKEN_MIN:
+            case GPUTokens::TOKEN_MAX:
+            case GPUTokens::TOKEN_ATAN2:
+            case GPUTokens::TOKEN_TABLE: {
+                // The interpreter recovers from underflow in ways not worth mirroring
+                if (regs.size() < 2) return false;
+                int a = top - 1;
+                GPUValueType typeA = regs[a];
+                GPUValueType typeB = regs[top];
+                GPUValueType result = combine(typeA, typeB);
+                unsigned int op;
+                switch (token) {
+                    case GPUTokens::TOKEN_ADD: op = OP_ADD; break;
+                    case GPUTokens::TOKEN_SUB: op = OP_SUB; break;
+                    case GPUTokens::TOKEN_MUL: op = OP_MUL; result = GPU_VALUE_COMPLEX; break;
+                    case GPUTokens::TOKEN_DIV: op = OP_DIV; result = GPU_VALUE_COMPLEX; break;
+                    case GPUTokens::TOKEN_MUL_R: op = OP_MUL_R; result = GPU_VALUE_REAL; break;
+                    case GPUTokens::TOKEN_DIV_R: op = OP_DIV_R; result = GPU_VALUE_REAL; break;
+                    case GPUTokens::TOKEN_POW:
+                        op = (result == GPU_VALUE_COMPLEX) ? OP_POW_C : OP_POW;
+                        if (result == GPU_VALUE_REAL) result = GPU_VALUE_UNKNOWN;
+                        break;
+                    default:
+                        // The interpreter reads raw stack floats here, which only matches for real operands
+                        if (result != GPU_VALUE_REAL) return false;
+                        op = token == GPUTokens::TOKEN_MOD ? OP_MOD : token == GPUTokens::TOKEN_MIN ? OP_MIN :
+                             token == GPUTokens::TOKEN_MAX ? OP_MAX : token == GPUTokens::TOKEN_TABLE ? OP_TABLE : OP_ATAN2;
+                        break;
+                }
+                code.push_back(encodeRegisterInstruction(op, a, a, top));
+                regs.pop_back();
+                regs[a] = result;
+                break;
+            }
+
+            case GPUTokens::TOKEN_LEN2:
+            case GPUTokens::TOKEN_HYPOT:
+            case GPUTokens::TOKEN_INVCUBE: {
+                // OptimizeEquation() fuses real operands only, whatever their static type here
+                if (regs.size() < 2) return false;
+                int a = top - 1;
+                unsigned int op = token == GPUTokens::TOKEN_LEN2 ? OP_LEN2 : token == GPUTokens::TOKEN_HYPOT ? OP_HYPOT : OP_INVCUBE;
+                code.push_back(encodeRegisterInstruction(op, a, a, top));
+                regs.pop_back();
+                regs[a] = GPU_VALUE_REAL;
+                break;
+            }
+
+            case GPUTokens::TOKEN_DOT2: {
+                if (regs.size() < 4) return false;
+                int v = top - 3;
+                code.push_back(encodeRegisterInstruction(OP_DOT2, v));
+                regs.resize(v + 1);
+                regs[v] = GPU_VALUE_REAL;
+                break;
+            }
+
+            case GPUTokens::TOKEN_RSQRT:
+                if (regs.empty()) return false;
+                code.push_back(encodeRegisterInstruction(OP_RSQRT, top, top));
+                regs[top] = GPU_VALUE_REAL;
+                break;
+
+            case GPUTokens::TOKEN_CLAMP:
+            case GPUTokens::TOKEN_FIELD: {
+                if (regs.size() < 3) return false;
+                int v = top - 2;
+                if (regs[v] != GPU_VALUE_REAL || regs[v + 1] != GPU_VALUE_REAL || regs[top] != GPU_VALUE_REAL) return false;
+                code.push_back(encodeRegisterInstruction(token == GPUTokens::TOKEN_CLAMP ? OP_CLAMP : OP_FIELD, v, v + 1, top));
+                regs.resize(v + 1);
+                break;
+            }
+
+            case GPUTokens::TOKEN_NEG:
+            case GPUTokens::TOKEN_SIN:
+            case GPUTokens::TOKEN_COS:
+            case GPUTokens::TOKEN_TAN:
+            case GPUTokens::TOKEN_EXP:
+            case GPUTokens::TOKEN_LOG:
+            case GPUTokens::TOKEN_SQRT:
+            case GPUTokens::TOKEN_ABS:
+            case GPUTokens::TOKEN_SIN_R:
+            case GPUTokens::TOKEN_COS_R:
+            case GPUTokens::TOKEN_TAN_R:
+            case GPUTokens::TOKEN_EXP_R:
+            case GPUTokens::TOKEN_REAL:
+            case GPUTokens::TOKEN_IMAG:
+            case GPUTokens::TOKEN_CONJ:
+            case GPUTokens::TOKEN_ARG: {
+                if (regs.empty()) return false;
+                GPUValueType type = regs[top];
+                unsigned int op;
+                switch (token) {
+                    case GPUTokens::TOKEN_NEG: op = OP_NEG; break;
+                    case GPUTokens::TOKEN_CONJ: op = OP_CONJ; break;
+                    case GPUTokens::TOKEN_SIN: op = OP_SIN; type = GPU_VALUE_COMPLEX; break;
+                    case GPUTokens::TOKEN_COS: op = OP_COS; type = GPU_VALUE_COMPLEX; break;
+                    case GPUTokens::TOKEN_TAN: op = OP_TAN; type = GPU_VALUE_COMPLEX; break;
+                    case GPUTokens::TOKEN_EXP: op = OP_EXP; type = GPU_VALUE_COMPLEX; break;
+                    case GPUTokens::TOKEN_LOG: op = OP_LOG; type = GPU_VALUE_COMPLEX; break;
+                    case GPUTokens::TOKEN_SQRT:
+                        op = (type == GPU_VALUE_COMPLEX) ? OP_SQRT_C : OP_SQRT;
+                        if (type != GPU_VALUE_COMPLEX) type = GPU_VALUE_UNKNOWN;
+                        break;
+                    case GPUTokens::TOKEN_ABS: op = OP_ABS; type = GPU_VALUE_REAL; break;
+                    case GPUTokens::TOKEN_SIN_R: op = OP_SIN_R; type = GPU_VALUE_REAL; break;
+                    case GPUTokens::TOKEN_COS_R: op = OP_COS_R; type = GPU_VALUE_REAL; break;
+                    case GPUTokens::TOKEN_TAN_R: op = OP_TAN_R; type = GPU_VALUE_REAL; break;
+                    case GPUTokens::TOKEN_EXP_R: op = OP_EXP_R; type = GPU_VALUE_REAL; break;
+                    case GPUTokens::TOKEN_REAL: op = OP_REAL; type = GPU_VALUE_REAL; break;
+                    case GPUTokens::TOKEN_IMAG: op = OP_IMAG; type = GPU_VALUE_REAL; break;
+                    default:
+                        if (type == GPU_VALUE_UNKNOWN) return false;
+                        op = (type == GPU_VALUE_REAL) ? OP_ARG_R : OP_ARG;
+                        type = GPU_VALUE_REAL;
+                        break;
+                }
+                code.push_back(encodeRegisterInstruction(op, top, top));
+                regs[top] = type;
+                break;
+            }
+
+            case GPUTokens::TOKEN_FLOOR:
+            case GPUTokens::TOKEN_CEIL:
+            case GPUTokens::TOKEN_FRAC:
+            case GPUTokens::TOKEN_SIGN:
+            case GPUTokens::TOKEN_STEP: {
+                // Applied to real values only, complex values pass through unchanged
+                if (regs.empty() || regs[top] == GPU_VALUE_UNKNOWN) return false;
+                if (regs[top] == GPU_VALUE_COMPLEX) break;
+                unsigned int op = token == GPUTokens::TOKEN_FLOOR ? OP_FLOOR : token == GPUTokens::TOKEN_CEIL ? OP_CEIL :
+                                  token == GPUTokens::TOKEN_FRAC ? OP_FRAC : token == GPUTokens::TOKEN_SIGN ? OP_SIGN : OP_STEP;
+                code.push_back(encodeRegisterInstruction(op, top, top));
+                break;
+            }
+
+            case GPUTokens::TOKEN_OPEN_PAREN:
+            case GPUTokens::TOKEN_CLOSE_PAREN:
+            case GPUTokens::TOKEN_COMMA:
+                break;
+
+            default:
+                // D() re-evaluates its body with perturbed variables and if() jumps; both stay on the interpreter
+                return false;
+        }
+    }
+
+    closePreludes(tokenBuffer.size());
+
+    // The result is the real part of register 0, like the bottom stack entry
+    if (regs.empty() || liveRegisters > static_cast<size_t>(MAX_BYTECODE_REGISTERS)) return false;
+    out.reserve(code.size() + 1);
+    out.push_back(static_cast<unsigned int>(code.size()));
+    out.insert(out.end(), code.begin(), code.end());
+    return true;
+}
+
+// ============================================================================
+// PACKED TOKEN BUFFER - MUST MATCH tokenAt() in math.comp
+// ============================================================================
+// The token stream serializeTokensToGPU() produces keeps one int per entry (opcode or operand)
+// on the host; on the GPU each entry is one 16-bit half of a uint, so offsets and counts stay
+// entry indices. Values in [-16384, 16383] are stored directly (15-bit two's complement);
+// larger ones set the top bit and name a slot of a deduplicated wide table, which holds the
+// few distinct object indices and other large operands live equations use.
+// Buffer words: [0] first packed word (0 = unpacked, entries are whole words from word 2),
+// [1] entry count, [2, 2 + wide capacity) wide table, then the packed halves, low half first.
+const int TOKEN_BUFFER_HEADER_WORDS = 2;
+const int TOKEN_PACK_ESCAPE = 0x8000;
+const int TOKEN_PACK_MAX_WIDE = 0x7FFF;  // Wide slots an escape can name
+
+struct PackedTokenTable {
+    std::vector<int> wide;
+    std::unordered_map<int, int> wideIndex;
+
+    // 16-bit encoding of one entry; false when its wide slot would not fit into an escape
+    bool encode(int value, uint16_t& half) {
+        if (value >= -16384 && value <= 16383) {
+            half = static_cast<uint16_t>(value & 0x7FFF);
+            return true;
+        }
+        auto it = wideIndex.find(value);
+        int slot;
+        if (it != wideIndex.end()) {
+            slot = it->second;
+        } else {
+            if (static_cast<int>(wide.size()) >= TOKEN_PACK_MAX_WIDE) return false;
+            slot = static_cast<int>(wide.size());
+            wideIndex[value] = slot;
+            wide.push_back(value);
+        }
+        half = static_cast<uint16_t>(TOKEN_PACK_ESCAPE | slot);
+        return true;
+    }
+
+    void clear() {
+        wide.clear();
+        wideIndex.clear();
+    }
+};
+
+// Index of value in a component's constant buffer, appending it the first time it is seen
+inline int findOrAddConstant(float value, std::vector<float>& outConstantBuffer, std::unordered_map<float, int>& constantMap) {
+    auto it = constantMap.find(value);
+    if (it != constantMap.end()) return it->second;
+
+    int constIndex = static_cast<int>(outConstantBuffer.size());
+    constantMap[value] = constIndex;
+    outConstantBuffer.push_back(value);
+    return constIndex;
+}
+
 // Forward declaration for recursive serialization
+// pairSumSlots numbers sum_j() terms and tempTypes tracks temporaries across all components of one equation
 inline void serializeTokensToGPU(
     const std::vector<Token>& tokens,
     std::vector<int>& outTokenBuffer,
     std::vector<float>& outConstantBuffer,
-    std::unordered_map<float, int>& constantMap
+    std::unordered_map<float, int>& constantMap,
+    int* pairSumSlots = nullptr,
+    std::vector<GPUValueType>* tempTypes = nullptr
 );
 
 inline void serializeTokensToGPU(
     const std::vector<Token>& tokens,
     std::vector<int>& outTokenBuffer,
     std::vector<float>& outConstantBuffer,
-    std::unordered_map<float, int>& constantMap
+    std::unordered_map<float, int>& constantMap,
+    int* pairSumSlots,
+    std::vector<GPUValueType>* tempTypes
 ) {
+    int localPairSumSlots = 0;
+    if (!pairSumSlots) pairSumSlots = &localPairSumSlots;
+
+    // Where each value on the stack starts in outTokenBuffer, so if() can put its jumps around its branches
+    std::vector<size_t> valueStarts;
+
     for (const auto& token : tokens) {
+        size_t tokenStart = outTokenBuffer.size();
+        if (token.type == TOKEN_HOIST) {
+            // The header goes in front of the body, where the hoisted value starts
+            if (valueStarts.empty()) throw std::runtime_error("Malformed hoisted subexpression");
+            size_t bodyStart = valueStarts.back();
+            int bodyCount = static_cast<int>(outTokenBuffer.size() - bodyStart);
+            outTokenBuffer.insert(outTokenBuffer.begin() + bodyStart, { GPUTokens::TOKEN_PRELUDE, token.temp_slot, bodyCount });
+            continue;
+        }
+        if (token.type == TOKEN_IF) {
+            if (valueStarts.size() < 3) throw std::runtime_error("Malformed if(): missing operand");
+            size_t elseStart = valueStarts.back();
+            valueStarts.pop_back();
+            size_t thenStart = valueStarts.back();
+            valueStarts.pop_back();
+
+            // The condition's start stays the start of the whole if()
+            int elseCount = static_cast<int>(outTokenBuffer.size() - elseStart);
+            int thenCount = static_cast<int>(elseStart - thenStart);
+            outTokenBuffer.insert(outTokenBuffer.begin() + elseStart, { GPUTokens::TOKEN_JUMP, elseCount });
+            outTokenBuffer.insert(outTokenBuffer.begin() + thenStart, { GPUTokens::TOKEN_BRANCH, thenCount + 2 });
+            continue;
+        }
+
         switch (token.type) {
             case TOKEN_NUMBER: {
                 // Find or add constant to constant buffer
-                float value = token.numeric_value;
-                int constIndex;
-                
-                auto it = constantMap.find(value);
-                if (it != constantMap.end()) {
-                    constIndex = it->second;
-                } else {
-                    constIndex = static_cast<int>(outConstantBuffer.size());
-                    constantMap[value] = constIndex;
-                    outConstantBuffer.push_back(value);
-                }
+                int constIndex = findOrAddConstant(token.numeric_value, outConstantBuffer, constantMap);
                 
                 outTokenBuffer.push_back(GPUTokens::TOKEN_NUMBER);
                 outTokenBuffer.push_back(constIndex);
@@ -296,7 +1156,7 @@ inline void serializeTokensToGPU(
             }
             
             case TOKEN_VARIABLE: {
-                int varHash = hashVariableName(token.variable_name);
+                int varHash = hashVariableName(token.variable);
                 outTokenBuffer.push_back(GPUTokens::TOKEN_VARIABLE);
                 outTokenBuffer.push_back(varHash);
                 break;
@@ -311,6 +1171,43 @@ inline void serializeTokensToGPU(
                 break;
             }
             
+            case TOKEN_PAIR_REF: {
+                // pj.property, read from the shared-memory tile
+                outTokenBuffer.push_back(GPUTokens::TOKEN_PAIR_REF);
+                outTokenBuffer.push_back(hashPropertyName(token.object_property));
+                break;
+            }
+            
+            case TOKEN_PAIR_SUM: {
+                int slot = (*pairSumSlots)++;
+                if (slot >= MAX_PAIR_SUMS_PER_EQUATION) {
+                    throw std::runtime_error("At most " + std::to_string(MAX_PAIR_SUMS_PER_EQUATION) +
+                                             " sum_j()/nsum()/ncount()/nmean() terms are supported per equation");
+                }
+                
+                // The body shares this component's constant buffer, so its indices need no remapping
+                std::vector<int> bodyTokenBuffer;
+                serializeTokensToGPU(token.pair_expr_tokens, bodyTokenBuffer, outConstantBuffer, constantMap);
+                int radiusIndex = token.pair_radius > 0.0f
+                    ? findOrAddConstant(token.pair_radius, outConstantBuffer, constantMap)
+                    : -1;
+                
+                outTokenBuffer.push_back(GPUTokens::TOKEN_PAIR_SUM);
+                outTokenBuffer.push_back(slot);
+                outTokenBuffer.push_back(static_cast<int>(token.pair_reduction));
+                outTokenBuffer.push_back(radiusIndex);
+                outTokenBuffer.push_back(static_cast<int>(bodyTokenBuffer.size()));
+                outTokenBuffer.insert(outTokenBuffer.end(), bodyTokenBuffer.begin(), bodyTokenBuffer.end());
+                break;
+            }
+            
+            case TOKEN_TEMP_STORE:
+            case TOKEN_TEMP_LOAD: {
+                outTokenBuffer.push_back(token.type == TOKEN_TEMP_STORE ? GPUTokens::TOKEN_TEMP_STORE : GPUTokens::TOKEN_TEMP_LOAD);
+                outTokenBuffer.push_back(token.temp_slot);
+                break;
+            }
+            
             case TOKEN_DERIVATIVE: {
                 // Serialize derivative token
                 int wrtVarHash = hashVariableName(token.derivative_wrt);
@@ -388,7 +1285,364 @@ inline void serializeTokensToGPU(
                 break;
             }
         }
+
+        // Malformed stacks are left to validateGPUTokens(); only if() needs the starts
+        int operandCount = rpnOperandCount(token.type);
+        if (operandCount < 0) continue;
+        if (static_cast<int>(valueStarts.size()) >= operandCount) {
+            if (operandCount > 0) tokenStart = valueStarts[valueStarts.size() - operandCount];
+            valueStarts.resize(valueStarts.size() - operandCount);
+        }
+        valueStarts.push_back(tokenStart);
     }
+
+    inferRealOpcodes(outTokenBuffer, tempTypes);
+}
+
+// ============================================================================
+// OFFLINE VALIDATION
+// ============================================================================
+// evaluateRPNComponent() in math.comp trusts its programs: it does no per-token stack, constant or
+// temporary checks. Every program is therefore checked here before it can reach the GPU, when it is
+// serialized, loaded from the equation cache and registered.
+
+// Stack entries of the stack evaluator - MUST MATCH RPN_STACK_ENTRIES in math.comp. Programs that
+// fit in SMALL_GPU_STACK_ENTRIES run on a math.comp build with the smaller stack.
+const int MAX_GPU_STACK_ENTRIES = 64;
+const int SMALL_GPU_STACK_ENTRIES = 16;
+
+// Variables the prelude pass sets as the per-object pass does, the only ones a hoisted body may read
+inline bool isPreludeVariable(int hash) {
+    using namespace VariableHashes;
+    return hash == VAR_HASH_T || hash == VAR_HASH_PI || hash == VAR_HASH_E || hash == VAR_HASH_K ||
+           hash == VAR_HASH_B_DAMP || hash == VAR_HASH_G_GRAV || hash == VAR_HASH_COUPLING ||
+           hash == VAR_HASH_FREQ || hash == VAR_HASH_AMP;
+}
+
+// A hoisted body is evaluated for no object: it may read literals and those variables only,
+// and no temporaries, which the prelude pass does not have
+inline std::string validatePreludeBody(const std::vector<int>& tokens, size_t begin, size_t end) {
+    size_t i = begin;
+    while (i < end) {
+        int token = tokens[i++];
+        switch (token) {
+            case GPUTokens::TOKEN_VARIABLE:
+                if (i >= end || !isPreludeVariable(tokens[i])) return "hoisted body reads a variable of the object";
+                i++;
+                break;
+            case GPUTokens::TOKEN_NUMBER:
+            case GPUTokens::TOKEN_BRANCH:
+            case GPUTokens::TOKEN_JUMP:
+                i++;
+                break;
+            case GPUTokens::TOKEN_OBJECT_REF:
+            case GPUTokens::TOKEN_PAIR_REF:
+            case GPUTokens::TOKEN_PAIR_SUM:
+            case GPUTokens::TOKEN_DERIVATIVE:
+                return "hoisted body reads other objects or D()";
+            case GPUTokens::TOKEN_TEMP_STORE:
+            case GPUTokens::TOKEN_TEMP_LOAD:
+            case GPUTokens::TOKEN_PRELUDE:
+                return "temporary or prelude inside a hoisted body";
+            default:
+                break;
+        }
+    }
+    return std::string();
+}
+
+// What a walk over the components of one equation keeps between them
+struct GPUProgramCheck {
+    int maxDepth = 0;                              // Deepest stack reached, in entries
+    std::vector<char> storedTemps = std::vector<char>(MAX_EQUATION_TEMPS, 0);
+};
+
+// Check tokens[begin, end) for one value. Pair reduction and D() bodies are checked recursively;
+// they may not use temporaries, and their depth is not counted since their evaluators have stacks
+// of their own. Each if() branch must leave one value and may not store temporaries, which a
+// later read could not rely on. Returns an empty string if the program is valid, else the problem.
+inline std::string validateGPUTokens(const std::vector<int>& tokens, size_t begin, size_t end, int constantCount,
+                                     bool pairBody, bool derivativeBody, GPUProgramCheck& check) {
+    bool nested = pairBody || derivativeBody;
+    int depth = 0;
+    size_t i = begin;
+    auto operands = [&](size_t count) { return end - i >= count; };
+    auto pop = [&](int count) { depth -= count; return depth >= 0; };
+    auto push = [&]() { check.maxDepth = std::max(check.maxDepth, ++depth); };
+
+    // Open if() statements: the depth before the condition, where its JUMP is and where its else branch ends
+    struct Branch { int depth; size_t jump; size_t merge; bool jumped; };
+    std::vector<Branch> branches;
+    auto mergeBranches = [&]() {
+        while (!branches.empty() && i == branches.back().merge) {
+            if (!branches.back().jumped || depth != branches.back().depth + 1) return false;
+            branches.pop_back();
+        }
+        return true;
+    };
+
+    while (i < end) {
+        if (!mergeBranches()) return "if() else branch does not leave one value";
+        int token = tokens[i++];
+        switch (token) {
+            case GPUTokens::TOKEN_NUMBER: {
+                if (!operands(1)) return "constant without an index";
+                int index = tokens[i++];
+                if (index < 0 || index >= constantCount) return "constant index " + std::to_string(index) + " out of range";
+                push();
+                break;
+            }
+            case GPUTokens::TOKEN_VARIABLE: {
+                if (!operands(1)) return "variable without a hash";
+                int hash = tokens[i++];
+                if (hash < VariableHashes::VAR_HASH_X || hash > VariableHashes::VAR_HASH_FIELD_7)
+                    return "unknown variable hash " + std::to_string(hash);
+                push();
+                break;
+            }
+            case GPUTokens::TOKEN_OBJECT_REF:
+            case GPUTokens::TOKEN_PAIR_REF: {
+                bool pair = token == GPUTokens::TOKEN_PAIR_REF;
+                if (pair && !pairBody) return "pj outside a pair reduction";
+                if (!operands(pair ? 1 : 2)) return "object reference without its operands";
+                if (!pair) i++;  // Object index, checked against the object count when evaluated
+                int hash = tokens[i++];
+                int lastHash = pair ? PropertyHashes::PROP_HASH_FIELD_7 : PropertyHashes::PROP_HASH_COLOR_A;  // Fields only of pj
+                if (hash < PropertyHashes::PROP_HASH_X || hash > lastHash) return "unknown property hash " + std::to_string(hash);
+                push();
+                break;
+            }
+            case GPUTokens::TOKEN_PAIR_SUM: {
+                if (nested) return "pair reduction inside a pair reduction or D()";
+                if (!operands(4)) return "pair reduction without its header";
+                int slot = tokens[i], reduction = tokens[i + 1], radius = tokens[i + 2], bodyCount = tokens[i + 3];
+                i += 4;
+                if (slot < 0 || slot >= MAX_PAIR_SUMS_PER_EQUATION) return "pair reduction slot " + std::to_string(slot) + " out of range";
+                if (reduction < 0 || reduction > 2) return "unknown pair reduction " + std::to_string(reduction);
+                if (radius != -1 && (radius < 0 || radius >= constantCount)) return "pair radius index out of range";
+                // ncount() has no body
+                if (bodyCount < (reduction == PAIR_REDUCE_COUNT ? 0 : 1) || !operands(static_cast<size_t>(bodyCount)))
+                    return "pair reduction body out of range";
+                if (bodyCount > 0) {
+                    GPUProgramCheck bodyCheck;
+                    std::string error = validateGPUTokens(tokens, i, i + bodyCount, constantCount, true, false, bodyCheck);
+                    if (!error.empty()) return "pair reduction body: " + error;
+                }
+                i += bodyCount;
+                push();
+                break;
+            }
+            case GPUTokens::TOKEN_DERIVATIVE: {
+                if (!operands(4)) return "D() without its header";
+                int hash = tokens[i], order = tokens[i + 1], method = tokens[i + 2], exprCount = tokens[i + 3];
+                i += 4;
+                if (hash < VariableHashes::VAR_HASH_X || hash > VariableHashes::VAR_HASH_SPH_P)
+                    return "D() with respect to unknown variable hash " + std::to_string(hash);
+                if (order < 1 || order > 4) return "D() order " + std::to_string(order) + " out of range";
+                if (method < 0 || method > 2) return "unknown D() method " + std::to_string(method);
+                if (exprCount <= 0 || !operands(static_cast<size_t>(exprCount))) return "D() body out of range";
+                GPUProgramCheck bodyCheck;
+                std::string error = validateGPUTokens(tokens, i, i + exprCount, constantCount, pairBody, true, bodyCheck);
+                if (!error.empty()) return "D() body: " + error;
+                i += exprCount;
+                push();
+                break;
+            }
+            case GPUTokens::TOKEN_PRELUDE: {
+                // The body that follows is checked in place as well, as it runs there without a prelude
+                if (nested) return "prelude inside a pair reduction or D()";
+                if (!operands(2)) return "prelude without its header";
+                int slot = tokens[i], bodyCount = tokens[i + 1];
+                i += 2;
+                if (slot < 0 || slot >= MAX_PRELUDE_SLOTS) return "prelude slot " + std::to_string(slot) + " out of range";
+                if (bodyCount < 1 || !operands(static_cast<size_t>(bodyCount))) return "prelude body out of range";
+                std::string error = validatePreludeBody(tokens, i, i + bodyCount);
+                GPUProgramCheck bodyCheck;
+                if (error.empty()) error = validateGPUTokens(tokens, i, i + bodyCount, constantCount, false, false, bodyCheck);
+                if (!error.empty()) return "prelude body: " + error;
+                break;
+            }
+            case GPUTokens::TOKEN_TEMP_STORE:
+            case GPUTokens::TOKEN_TEMP_LOAD: {
+                if (nested) return "temporary inside a pair reduction or D()";
+                if (!operands(1)) return "temporary without a slot";
+                int slot = tokens[i++];
+                if (slot < 0 || slot >= MAX_EQUATION_TEMPS) return "temporary slot " + std::to_string(slot) + " out of range";
+                if (token == GPUTokens::TOKEN_TEMP_STORE) {
+                    if (depth < 1) return "temporary stored from an empty stack";
+                    if (!branches.empty()) return "temporary stored inside an if() branch";
+                    check.storedTemps[slot] = 1;
+                } else {
+                    if (!check.storedTemps[slot]) return "temporary " + std::to_string(slot) + " read before it is stored";
+                    push();
+                }
+                break;
+            }
+            case GPUTokens::TOKEN_ADD:
+            case GPUTokens::TOKEN_SUB:
+            case GPUTokens::TOKEN_MUL:
+            case GPUTokens::TOKEN_DIV:
+            case GPUTokens::TOKEN_POW:
+            case GPUTokens::TOKEN_MIN:
+            case GPUTokens::TOKEN_MAX:
+            case GPUTokens::TOKEN_MOD:
+            case GPUTokens::TOKEN_ATAN2:
+            case GPUTokens::TOKEN_MUL_R:
+            case GPUTokens::TOKEN_DIV_R:
+            case GPUTokens::TOKEN_TABLE:
+                if (!pop(2)) return "operator without two operands";
+                push();
+                break;
+            case GPUTokens::TOKEN_CLAMP:
+            case GPUTokens::TOKEN_FIELD:
+                if (!pop(3)) return "clamp() or field() without three operands";
+                push();
+                break;
+            case GPUTokens::TOKEN_LEN2:
+            case GPUTokens::TOKEN_DOT2:
+            case GPUTokens::TOKEN_HYPOT:
+            case GPUTokens::TOKEN_INVCUBE:
+            case GPUTokens::TOKEN_RSQRT:
+                // The D() evaluators do not implement the fused intrinsics
+                if (derivativeBody) return "fused intrinsic inside D()";
+                if (!pop(token == GPUTokens::TOKEN_DOT2 ? 4 : token == GPUTokens::TOKEN_RSQRT ? 1 : 2))
+                    return "fused intrinsic without its operands";
+                push();
+                break;
+            case GPUTokens::TOKEN_NEG:
+            case GPUTokens::TOKEN_SIN:
+            case GPUTokens::TOKEN_COS:
+            case GPUTokens::TOKEN_TAN:
+            case GPUTokens::TOKEN_SQRT:
+            case GPUTokens::TOKEN_LOG:
+            case GPUTokens::TOKEN_EXP:
+            case GPUTokens::TOKEN_ABS:
+            case GPUTokens::TOKEN_FLOOR:
+            case GPUTokens::TOKEN_CEIL:
+            case GPUTokens::TOKEN_FRAC:
+            case GPUTokens::TOKEN_SIGN:
+            case GPUTokens::TOKEN_STEP:
+            case GPUTokens::TOKEN_REAL:
+            case GPUTokens::TOKEN_IMAG:
+            case GPUTokens::TOKEN_CONJ:
+            case GPUTokens::TOKEN_ARG:
+            case GPUTokens::TOKEN_SIN_R:
+            case GPUTokens::TOKEN_COS_R:
+            case GPUTokens::TOKEN_TAN_R:
+            case GPUTokens::TOKEN_EXP_R:
+                if (!pop(1)) return "function without an operand";
+                push();
+                break;
+            case GPUTokens::TOKEN_BRANCH: {
+                if (derivativeBody) return "if() inside D()";
+                if (!operands(1)) return "branch without a skip";
+                int skip = tokens[i++];
+                if (!pop(1)) return "if() without a condition";
+
+                // A nested if() ends inside the branch it is in
+                size_t limit = end;
+                if (!branches.empty()) limit = (i <= branches.back().jump) ? branches.back().jump : branches.back().merge;
+                if (skip < 3 || static_cast<size_t>(skip) > limit - i) return "branch skip out of range";
+                size_t jump = i + skip - 2;
+                if (tokens[jump] != GPUTokens::TOKEN_JUMP) return "branch without its jump";
+                int elseCount = tokens[jump + 1];
+                if (elseCount < 1 || static_cast<size_t>(elseCount) > limit - (jump + 2)) return "jump skip out of range";
+                branches.push_back({ depth, jump, jump + 2 + elseCount, false });
+                break;
+            }
+            case GPUTokens::TOKEN_JUMP:
+                if (branches.empty() || i - 1 != branches.back().jump) return "jump outside an if()";
+                i++;  // Checked by its branch
+                if (depth != branches.back().depth + 1) return "if() then branch does not leave one value";
+                depth--;  // The else branch pushes its value in its place
+                branches.back().jumped = true;
+                break;
+            default:
+                return "unexpected token " + std::to_string(token);
+        }
+    }
+    if (!mergeBranches() || !branches.empty()) return "if() else branch does not leave one value";
+    if (depth != 1) return "leaves " + std::to_string(depth) + " values on the stack instead of one";
+    return std::string();
+}
+
+// Check every component of eq in the order math.comp evaluates them. Returns an empty string if the
+// equation can run on the stack evaluator, else the problem; maxDepth receives the deepest stack.
+inline std::string validateGPUSerializedEquation(const GPUSerializedEquation& eq, int* maxDepth = nullptr) {
+    const std::pair<const char*, std::pair<const std::vector<int>*, const std::vector<float>*>> components[] = {
+        {"ax", {&eq.tokenBuffer_ax, &eq.constantBuffer_ax}},
+        {"ay", {&eq.tokenBuffer_ay, &eq.constantBuffer_ay}},
+        {"angular", {&eq.tokenBuffer_angular, &eq.constantBuffer_angular}},
+        {"r", {&eq.tokenBuffer_r, &eq.constantBuffer_r}},
+        {"g", {&eq.tokenBuffer_g, &eq.constantBuffer_g}},
+        {"b", {&eq.tokenBuffer_b, &eq.constantBuffer_b}},
+        {"a", {&eq.tokenBuffer_a, &eq.constantBuffer_a}},
+    };
+
+    GPUProgramCheck check;
+    for (const auto& component : components) {
+        const std::vector<int>& tokens = *component.second.first;
+        if (tokens.empty()) continue;
+        int constantCount = static_cast<int>(component.second.second->size());
+        std::string error = validateGPUTokens(tokens, 0, tokens.size(), constantCount, false, false, check);
+        if (error.empty() && check.maxDepth > MAX_GPU_STACK_ENTRIES) {
+            error = "needs " + std::to_string(check.maxDepth) + " stack entries, at most " +
+                    std::to_string(MAX_GPU_STACK_ENTRIES) + " are supported";
+        }
+        if (!error.empty()) return std::string("component ") + component.first + ": " + error;
+    }
+
+    // State updates are evaluated after the components and cannot read their temporaries
+    int constantCount = static_cast<int>(eq.constantBuffer_state.size());
+    for (int k = 0; k < MAX_STATE_REGISTERS; k++) {
+        const std::vector<int>& tokens = eq.tokenBuffer_state[k];
+        if (tokens.empty()) continue;
+        GPUProgramCheck updateCheck;
+        std::string error = validateGPUTokens(tokens, 0, tokens.size(), constantCount, false, false, updateCheck);
+        if (error.empty() && updateCheck.maxDepth > MAX_GPU_STACK_ENTRIES) {
+            error = "needs " + std::to_string(updateCheck.maxDepth) + " stack entries, at most " +
+                    std::to_string(MAX_GPU_STACK_ENTRIES) + " are supported";
+        }
+        if (!error.empty()) return "update of s" + std::to_string(k) + ": " + error;
+        check.maxDepth = std::max(check.maxDepth, updateCheck.maxDepth);
+    }
+    if (maxDepth) *maxDepth = check.maxDepth;
+    return std::string();
+}
+
+// p[i] an equation stages per workgroup - MUST MATCH MAX_SHARED_OBJECT_REFS in math.comp
+const int MAX_SHARED_OBJECT_REFS = 16;
+
+// Distinct object indices the p[i] of an equation name, in order of first use and at most
+// MAX_SHARED_OBJECT_REFS of them; math.comp loads these once per workgroup. Pair reduction
+// and D() bodies are scanned inline, as they read p[i] through the same lookup.
+inline std::vector<int> collectObjectRefs(const GPUSerializedEquation& eq) {
+    std::vector<const std::vector<int>*> streams = {
+        &eq.tokenBuffer_ax, &eq.tokenBuffer_ay, &eq.tokenBuffer_angular, &eq.tokenBuffer_r,
+        &eq.tokenBuffer_g, &eq.tokenBuffer_b, &eq.tokenBuffer_a };
+    for (const auto& tokens : eq.tokenBuffer_state) streams.push_back(&tokens);
+
+    std::vector<int> refs;
+    for (const std::vector<int>* tokens : streams) {
+        size_t i = 0;
+        while (i < tokens->size()) {
+            int token = (*tokens)[i++];
+            if (token == GPUTokens::TOKEN_OBJECT_REF) {
+                if (i + 2 > tokens->size()) break;
+                int index = (*tokens)[i];
+                if (refs.size() < static_cast<size_t>(MAX_SHARED_OBJECT_REFS) &&
+                    std::find(refs.begin(), refs.end(), index) == refs.end())
+                    refs.push_back(index);
+                i += 2;
+            }
+            else if (token == GPUTokens::TOKEN_NUMBER || token == GPUTokens::TOKEN_VARIABLE || token == GPUTokens::TOKEN_PAIR_REF ||
+                     token == GPUTokens::TOKEN_TEMP_STORE || token == GPUTokens::TOKEN_TEMP_LOAD ||
+                     token == GPUTokens::TOKEN_BRANCH || token == GPUTokens::TOKEN_JUMP) i += 1;
+            else if (token == GPUTokens::TOKEN_PRELUDE) i += 2;
+            else if (token == GPUTokens::TOKEN_PAIR_SUM || token == GPUTokens::TOKEN_DERIVATIVE) i += 4;
+        }
+    }
+    return refs;
 }
 
 // ============================================================================
@@ -407,14 +1661,18 @@ inline GPUSerializedEquation serializeEquationForGPU(const ParsedEquation& equat
     std::unordered_map<float, int> constantMap_b;
     std::unordered_map<float, int> constantMap_a;
     
+    // sum_j() slots and temporaries are shared by all components
+    int pairSumSlots = 0;
+    std::vector<GPUValueType> tempTypes;
+    
     // Helper lambda to serialize a component with default value
-    auto serializeComponent = [](const std::vector<Token>& tokens,
+    auto serializeComponent = [&pairSumSlots, &tempTypes](const std::vector<Token>& tokens,
                                 std::vector<int>& tokenBuffer,
                                 std::vector<float>& constantBuffer,
                                 std::unordered_map<float, int>& constantMap,
                                 float defaultValue = 0.0f) {
         if (!tokens.empty()) {
-            serializeTokensToGPU(tokens, tokenBuffer, constantBuffer, constantMap);
+            serializeTokensToGPU(tokens, tokenBuffer, constantBuffer, constantMap, &pairSumSlots, &tempTypes);
         } /*else {
             // Empty equation: push default value
             tokenBuffer.push_back(GPUTokens::TOKEN_NUMBER);
@@ -440,6 +1698,23 @@ inline GPUSerializedEquation serializeEquationForGPU(const ParsedEquation& equat
     serializeComponent(equation.tokens_b, result.tokenBuffer_b, result.constantBuffer_b, constantMap_b, 1.0f);
     serializeComponent(equation.tokens_a, result.tokenBuffer_a, result.constantBuffer_a, constantMap_a, 1.0f);
     
+    // State updates, all against one constant buffer
+    std::unordered_map<float, int> constantMap_state;
+    for (int k = 0; k < MAX_STATE_REGISTERS; k++)
+        serializeComponent(equation.tokens_state[k], result.tokenBuffer_state[k], result.constantBuffer_state, constantMap_state);
+    
+    // Register bytecode once the types of every temporary are known
+    compileRegisterBytecode(result.tokenBuffer_ax, tempTypes, result.bytecode_ax);
+    compileRegisterBytecode(result.tokenBuffer_ay, tempTypes, result.bytecode_ay);
+    compileRegisterBytecode(result.tokenBuffer_angular, tempTypes, result.bytecode_angular);
+    compileRegisterBytecode(result.tokenBuffer_r, tempTypes, result.bytecode_r);
+    compileRegisterBytecode(result.tokenBuffer_g, tempTypes, result.bytecode_g);
+    compileRegisterBytecode(result.tokenBuffer_b, tempTypes, result.bytecode_b);
+    compileRegisterBytecode(result.tokenBuffer_a, tempTypes, result.bytecode_a);
+    
+    std::string error = validateGPUSerializedEquation(result);
+    if (!error.empty()) throw std::runtime_error("Equation cannot run on the GPU, " + error);
+    
     return result;
 }
 
@@ -538,6 +1813,9 @@ inline GPUEquationBatch serializeEquationBatchForGPU(const std::vector<ParsedEqu
                        batch.globalTokenBuffer_a, batch.globalConstantBuffer_a,
                        mapping.tokenOffset_a, mapping.tokenCount_a, mapping.constantOffset_a);
         
+        // The batch has no shared bytecode buffer, so every component uses the stack encoding
+        mapping.bytecodeOffset_ax = mapping.bytecodeOffset_ay = mapping.bytecodeOffset_angular = -1;
+        mapping.bytecodeOffset_r = mapping.bytecodeOffset_g = mapping.bytecodeOffset_b = mapping.bytecodeOffset_a = -1;
         batch.mappings.push_back(mapping);
     }
     
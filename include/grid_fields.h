@@ -0,0 +1,62 @@
+#ifndef GRID_FIELDS_H
+#define GRID_FIELDS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// SSBO bindings of the grid passes - MUST MATCH grid_field.comp and grid_field.frag
+const int GRID_FIELDS_VALUES_BINDING = 53;  // Every field, one width * height block each
+const int GRID_FIELDS_NEXT_BINDING = 54;    // The new values of the field being stepped
+
+// Grid PDE mode: scalar fields on one grid of width x height nodes, each stepped once per
+// physics step by a stencil expression for its rate of change. Expressions read neighbours as
+// u[i+1,j] and have lap(u), dx(u) and dy(u); a compute pass per field evaluates them over
+// 16x16 tiles that first load the fields they read, with a halo as wide as the furthest
+// offset, into shared memory. Fields step in the order they were added and read the new values
+// of the fields before them, so a wave written as v then u is symplectic Euler. A field with a
+// lookup id is copied into that field() slot after each step, so equations sample it without a
+// trip through the host. Nodes sit on the box edges, as field() samples them.
+namespace GridFields
+{
+    const int MAX_GRID_FIELDS = 4;
+    const int MAX_STENCIL_OFFSET = 4;  // Halo width the shared tiles allow
+
+    enum Boundary
+    {
+        GRID_CLAMP = 0,     // Nodes past the edge read the edge: zero flux
+        GRID_PERIODIC = 1,  // Wraps every width and height nodes
+        GRID_ZERO = 2       // Nodes past the edge read 0
+    };
+
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // New grid over [min, max]; drops every field. false with error set for an empty box or too many nodes.
+    bool SetGrid(int width, int height, const glm::vec2& min, const glm::vec2& max, Boundary boundary, std::string& error);
+    // Add field name, or replace its values and expression; width * height values, rows from
+    // the minimum y. lookupId is the field() slot it is copied into, -1 for none. Every program
+    // is compiled again, and on error nothing changes.
+    bool SetField(const std::string& name, const std::vector<float>& values, const std::string& expression,
+                  int lookupId, std::string& error);
+    void Clear();  // Fields and grid
+    bool IsActive();
+    glm::ivec2 GetSize();
+
+    // One forward Euler step of every field with SimParams' dt; the caller has uploaded SimParams
+    void Step();
+    bool GetValues(const std::string& name, std::vector<float>& values);
+
+    // Colour-map field name over the box between valueMin and valueMax; an empty name hides it
+    bool SetDisplay(const std::string& name, float valueMin, float valueMax, float opacity);
+    void Draw(const glm::mat4& projView);
+
+    // Async shader loading (the display program; the step programs follow SetField)
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // GRID_FIELDS_H
@@ -0,0 +1,43 @@
+#ifndef KINEMATIC_PATHS_H
+#define KINEMATIC_PATHS_H
+
+#include <glad/glad.h>
+#include <vector>
+
+// Texture unit of the path buffer texture - MUST MATCH math.comp, collide.comp and constraints.comp
+const int KINEMATIC_PATHS_TEXTURE_UNIT = 7;
+
+// Kinematic objects follow a prescribed path instead of their equation: once per step math.comp
+// sets the position to the path at the end of the step and the velocity to the motion over it.
+// A path is two table() slots (lookup_tables.h) sampled at the simulation time, x and y; a
+// slot below 0 holds that coordinate. With a period the time wraps, for conveyors and loops.
+// Constraints and collision responses never move a kinematic object; the objects it hits
+// bounce off it as if it had infinite mass and its velocity. One RGBA32F texel per object
+// (x slot, y slot, period, 1 = kinematic); the host copy is authoritative.
+namespace KinematicPaths
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the buffer for more objects (rows are kept)
+    void Cleanup();
+
+    // Host edits
+    void Set(int index, int tableX, int tableY, float period);
+    bool IsKinematic(int index);
+    bool Get(int index, int& tableX, int& tableY, float& period);  // False when not kinematic
+    int GetCount();
+    void Clear(int index);
+    void Move(int to, int from);                  // Row of from to to; from is cleared
+    void Permute(const std::vector<int>& order);  // Row i becomes the old row order[i]
+
+    // Keyframes (times increasing) resampled evenly into tables tableX and tableY, linearly
+    // between keys, at four samples per shortest key interval (at most 4096 per table).
+    // False for fewer than two keys, times not increasing or a slot out of range.
+    bool SetKeyframes(int tableX, int tableY, const std::vector<float>& times,
+                      const std::vector<float>& xs, const std::vector<float>& ys);
+
+    // Upload pending edits and bind the buffer texture
+    void Bind();
+}
+
+#endif // KINEMATIC_PATHS_H
@@ -0,0 +1,54 @@
+#ifndef LONG_RANGE_H
+#define LONG_RANGE_H
+
+#include <glad/glad.h>
+#include <string>
+
+// SSBO binding of the per-object field buffer read by math.comp: (grav_ax, grav_ay, coul_ax, coul_ay)
+// then (sph_ax, sph_ay, sph_rho, sph_p), see sph_fluid.h - MUST MATCH FieldAccel in math.comp
+const int LONG_RANGE_ACCEL_BINDING = 22;
+
+// How the long-range accelerations are evaluated
+enum LongRangeMethod
+{
+    LONG_RANGE_BARNES_HUT = 0,     // Tree walk, adapts to clustered objects
+    LONG_RANGE_PARTICLE_MESH = 1   // FFT on a mesh (particle_mesh.h), optionally periodic
+};
+
+// Barnes-Hut long-range forces: a Morton-ordered radix tree (a compressed quadtree) is
+// rebuilt over object positions every step, each node carries its mass and charge
+// monopoles, and every object walks the tree with an opening-angle test. The particle-mesh
+// method fills the same acceleration buffer instead.
+namespace LongRange
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the tree and acceleration buffers for more objects
+    void Cleanup();
+
+    // Build the tree (or the mesh) from the current object buffer and evaluate every object's
+    // accelerations; false if the solver shader is not ready. The mesh falls back to the tree
+    // while its shader loads.
+    bool Compute(GLuint objectSSBO, int numObjects);
+
+    // Bind the acceleration buffer for math.comp
+    void Bind();
+    void Unbind();
+    GLuint GetFieldBuffer();  // For the SPH passes, which fill the fluid half
+
+    // Solver parameters
+    void SetParameters(float theta, float gravityConstant, float coulombConstant, float softening);
+    float GetTheta();
+    float GetGravityConstant();
+    float GetCoulombConstant();
+    float GetSoftening();
+    void SetMethod(LongRangeMethod method);
+    LongRangeMethod GetMethod();
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // LONG_RANGE_H
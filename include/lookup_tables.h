@@ -0,0 +1,54 @@
+#ifndef LOOKUP_TABLES_H
+#define LOOKUP_TABLES_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Texture units of the lookup buffers - MUST MATCH math.comp
+const int LOOKUP_DATA_TEXTURE_UNIT = 11;
+const int LOOKUP_HEADERS_TEXTURE_UNIT = 10;
+
+// Sampled inputs of the equations: table(id, x) interpolates a 1D table, field(id, x, y) a 2D
+// grid bilinearly. Every sample of every table and field lives in one R32F buffer texture and
+// each slot has two RGBA32F header texels (math.comp is out of SSBO blocks), so equations only
+// name a slot and new values never recompile anything. The host keeps the authoritative copy;
+// replacing a slot's values with as many new ones uploads just that range before the next
+// step, while a change of size repacks the buffer. Lookups clamp to the edges, and a slot
+// that was never set reads 0.
+namespace LookupTables
+{
+    const int MAX_LOOKUP_TABLES = 64;  // table() ids - MUST MATCH math.comp
+    const int MAX_LOOKUP_FIELDS = 64;  // field() ids
+
+    enum Interpolation
+    {
+        LOOKUP_LINEAR = 0,
+        LOOKUP_CUBIC = 1  // Catmull-Rom through the samples
+    };
+
+    // values sampled evenly over [xMin, xMax] (one value is a constant); false for an id
+    // out of range, no values or xMax <= xMin with more than one value
+    bool SetTable(int id, const std::vector<float>& values, float xMin, float xMax, Interpolation mode);
+    // width x height values, rows from the minimum y, sampled evenly over [min, max]
+    bool SetField(int id, const std::vector<float>& values, int width, int height,
+                  const glm::vec2& min, const glm::vec2& max);
+    void ClearTable(int id);
+    void ClearField(int id);
+
+    // Host copies of the shader lookups, for the CPU backend - MUST MATCH math.comp
+    float SampleTable(float id, float x);
+    float SampleField(float id, float x, float y);
+
+    // Overwrite field id on the GPU with the width * height floats at the start of buffer, for
+    // fields computed there; the host copy and SampleField keep the values set last. false if
+    // the field is unset or has another size
+    bool CopyField(int id, GLuint buffer, int width, int height);
+
+    // Upload pending edits and bind the buffer textures for math.comp
+    void Bind();
+
+    void Cleanup();
+}
+
+#endif // LOOKUP_TABLES_H
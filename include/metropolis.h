@@ -0,0 +1,56 @@
+#ifndef METROPOLIS_H
+#define METROPOLIS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// Metropolis sampling instead of time integration. While enabled, math.comp treats every
+// object as one chain over its position: each step proposes pos + stepSize * N(0, 1) per axis,
+// evaluates the object's log-density equation (the logp, i.e. ax, component) at the current and
+// the proposed position, and accepts with probability min(1, exp(logp' - logp)). Proposals and
+// the accept draw come from the counter-based generator of rand(), so nothing is stored per chain.
+// Velocity, rotation and the world walls are left alone. Per-chain acceptance counts and a 2D
+// histogram of the chain positions after each step are added up on the GPU in one buffer, seen
+// as an r32ui image since math.comp already binds every storage block it may, and only read
+// back on request.
+namespace Metropolis
+{
+    const GLuint METROPOLIS_STATS_IMAGE_UNIT = 1;       // MUST MATCH math.comp
+    const int METROPOLIS_MAX_HISTOGRAM_BINS = 1 << 22;  // binsX * binsY
+
+    struct Stats
+    {
+        std::vector<uint32_t> accepted;   // Accepted proposals by chain (object index)
+        std::vector<uint32_t> histogram;  // binsX * binsY counts, rows from the minimum y
+        uint64_t proposals = 0;           // Proposals each chain made since the stats were cleared
+    };
+
+    void SetEnabled(bool enabled);  // Off by default; turning it on clears the stats
+    bool IsEnabled();
+    void SetStepSize(float stepSize);  // Proposal standard deviation per axis
+    float GetStepSize();
+    // Histogram of the chain positions over [min, max); no bins turn it off. Clears the stats.
+    void SetHistogram(const glm::vec2& min, const glm::vec2& max, int binsX, int binsY);
+    void GetHistogram(glm::vec2& min, glm::vec2& max, int& binsX, int& binsY);
+    void ClearStats();
+
+    // Around the math.comp passes of a step, on the simulation's GL thread. Bind sizes the
+    // buffer for numChains; outgrowing it clears the stats. The shader's histogram uniform
+    // is (binsX, binsY, first histogram word).
+    void Bind(int numChains);
+    void Unbind();
+    glm::ivec3 ShaderHistogram();
+    glm::vec4 ShaderHistogramBox();  // (min x, min y, bins per unit x, bins per unit y)
+
+    // After each enabled step; substeps proposals were made
+    void EndStep(int substeps);
+
+    // Waits for the GPU; counts of the first numChains chains
+    void Read(int numChains, Stats& stats);
+
+    void Cleanup();
+}
+
+#endif // METROPOLIS_H
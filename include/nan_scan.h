@@ -0,0 +1,37 @@
+#ifndef NAN_SCAN_H
+#define NAN_SCAN_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// SSBO binding of the scan result - MUST MATCH nan_scan.comp
+const int NAN_SCAN_RESULT_BINDING = 44;
+
+// Invalid objects whose indices a scan reports; the count covers all of them
+const int NAN_SCAN_MAX_REPORTED = 64;
+
+// NaN/Inf detection for fast-math stepping: a pass over the object buffer counts the objects
+// with a NaN or an infinity in their state and lists the first few, and only that small result
+// is read back. A copy of the last state that passed a scan can be kept to roll back to.
+namespace NanScan
+{
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // Scan objectSSBO's first numObjects objects; waits for the result. false if the shader is not ready.
+    bool Scan(GLuint objectSSBO, int numObjects, int& invalidCount, std::vector<int>& invalidIndices);
+
+    // Keep a copy of objectSSBO as the state to roll back to, and put it back
+    void SaveCheckpoint(GLuint objectSSBO, int numObjects);
+    bool RestoreCheckpoint(GLuint objectSSBO, int numObjects);  // false without a copy of numObjects objects
+    void DropCheckpoint();
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // NAN_SCAN_H
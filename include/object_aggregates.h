@@ -0,0 +1,54 @@
+#ifndef OBJECT_AGGREGATES_H
+#define OBJECT_AGGREGATES_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Texture unit of the group bits - MUST MATCH object_reduction.comp
+const int OBJECT_GROUPS_TEXTURE_UNIT = 6;
+
+// Uniform buffer binding of the aggregate values - MUST MATCH GroupAggregates in math.comp
+const int GROUP_AGGREGATES_BINDING = 2;
+
+const int MAX_OBJECT_GROUPS = 32;     // One bit per group
+const int MAX_GROUP_AGGREGATES = 16;  // MUST MATCH MAX_AGGREGATE_NAMES in parser.h
+
+// Named groups of objects and aggregates over them that equations read as agg[name]. A group
+// is a bit in a per-object uint (the host copy is authoritative); an aggregate is the sum, mean,
+// min or max of a per-object expression over a group's objects, or over all of them. Once per
+// step, before the equations run, every aggregate is reduced from the state at the start of
+// the step in a single ObjectReduction pass, into a uniform block math.comp reads, so an
+// equation that would reference every member reads one value instead. The expressions follow
+// the rules of reduce(); they cannot read agg[] themselves. Objects the GPU spawns are in no group.
+namespace ObjectAggregates
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the group buffer for more objects (rows are kept)
+    void Cleanup();
+
+    // Groups: members replaces the group's objects; false when MAX_OBJECT_GROUPS groups exist
+    bool SetGroup(const std::string& name, const std::vector<int>& members);
+    bool HasGroup(const std::string& name);
+    std::vector<int> GetGroup(const std::string& name, int numObjects);
+    void Clear(int index);                        // Out of every group
+    void Move(int to, int from);                  // Groups of from to to; from is cleared
+    void Permute(const std::vector<int>& order);  // Row i becomes the old row order[i]
+
+    // Aggregate in agg[] slot `slot` (aggregateSlot() in parser.h): expressionFunction is a GLSL
+    // `float aggregate<slot>(...)` from EquationCodegen::GenerateExpressionFunction, op a
+    // ReductionOp, group "" = every object. False for a group that does not exist.
+    bool Set(int slot, const std::string& group, const std::string& expression,
+             const std::string& expressionFunction, int op);
+    void Remove(int slot);
+    int GetCount();
+    float Get(int slot);  // The value of the last step; waits for the GPU
+
+    // Reduce every aggregate from objectSSBO, then bind the values for math.comp
+    void Compute(GLuint objectSSBO, int numObjects);
+    void Bind();
+}
+
+#endif // OBJECT_AGGREGATES_H
@@ -0,0 +1,35 @@
+#ifndef OBJECT_BOUNDS_H
+#define OBJECT_BOUNDS_H
+
+#include <glad/glad.h>
+
+// Image unit math.comp stores the bounds through - MUST MATCH math.comp
+const GLuint OBJECT_BOUNDS_IMAGE_UNIT = 4;
+// Texture unit the passes reading them sample - MUST MATCH broadphase_*.comp, object_cull.comp
+const int OBJECT_BOUNDS_TEXTURE_UNIT = 5;
+
+// Bounds of every object, stored by the integration pass with the state it writes, so the passes
+// after it (the broadphase builds and their skin check, view culling) read one texel per object
+// instead of working them out from the collision properties and the skin. One RGBA32F texel
+// per object: the collision half extents, then the half extents of the drawn shape, rotation
+// included, both about the object's position. Being relative they stay right while the
+// constraint and collision passes move objects later in the step. They describe the state of
+// the last step that stored them until the host edits anything (Objects::GetSceneRevision()).
+namespace ObjectBounds
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the buffer for more objects; the bounds are stale after
+    void Cleanup();
+
+    // The image for math.comp, and the buffer texture for the passes that read it
+    void BindForWrite();
+    void UnbindForWrite();
+    void Bind();
+
+    // The buffer holds the bounds of the state at scene revision `revision`
+    void MarkCurrent(unsigned long long revision);
+    bool IsCurrent(unsigned long long revision);
+}
+
+#endif // OBJECT_BOUNDS_H
@@ -0,0 +1,37 @@
+#ifndef OBJECT_CHECKPOINT_H
+#define OBJECT_CHECKPOINT_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+struct Object;
+
+// SSBO bindings of object_checkpoint.comp
+const int CHECKPOINT_BASE_BINDING = 42;
+const int CHECKPOINT_CHANGED_BINDING = 43;
+
+// Delta checkpoints: a GPU copy of the object buffer as of the last checkpoint, and a pass
+// that marks the objects differing from it in a bitmap. Only the bitmap and the changed
+// objects cross the bus; the copy then moves on to the current state.
+namespace ObjectCheckpoint
+{
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // Take objectSSBO's first numObjects objects as the new base
+    bool SetBase(GLuint objectSSBO, int numObjects);
+    bool HasBase();
+
+    // Objects changed since the base (ascending indices, objects past the base count included),
+    // then make the current state the base; false without a base
+    bool TakeDelta(GLuint objectSSBO, int numObjects, std::vector<int>& indices, std::vector<Object>& objects);
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // OBJECT_CHECKPOINT_H
@@ -0,0 +1,45 @@
+#ifndef OBJECT_CULLING_H
+#define OBJECT_CULLING_H
+
+#include <glad/glad.h>
+#include <string>
+
+// SSBO bindings of object_cull.comp - the visible list MUST MATCH quad_instanced.vert
+const int CULL_COMMAND_BINDING = 46;
+const int CULL_VISIBLE_BINDING = 47;
+
+// Matches GL's DrawArraysIndirectCommand
+struct DrawArraysIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint first;
+    GLuint baseInstance;
+};
+
+// View culling for the instanced object draw: a pass over the object buffer appends the indices
+// of objects whose bounds overlap the visible world rectangle to a list and counts them into an
+// indirect draw command, so drawing costs what is on screen rather than the whole scene.
+namespace ObjectCulling
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the visible list for more objects
+    void Cleanup();
+
+    // Cull objectSSBO's first numObjects objects against [minX, maxX] x [minY, maxY]; the draw
+    // command (four strip vertices per visible object) and the list are ready for the draw that
+    // follows. false if the shader is not ready. objectBounds tests the drawn boxes of
+    // object_bounds.h, which must be bound and current for objectSSBO, instead of a circle each.
+    bool Cull(GLuint objectSSBO, int numObjects, float minX, float minY, float maxX, float maxY,
+              bool objectBounds = false);
+    GLuint GetCommandBuffer();  // For GL_DRAW_INDIRECT_BUFFER
+    GLuint GetVisibleBuffer();  // For CULL_VISIBLE_BINDING
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // OBJECT_CULLING_H
@@ -0,0 +1,36 @@
+#ifndef OBJECT_FORK_H
+#define OBJECT_FORK_H
+
+#include <glad/glad.h>
+#include <string>
+
+// SSBO binding of object_fork.comp (the checkpoint base binding point; the passes never overlap)
+const int FORK_SOURCE_BINDING = 42;
+
+// Forked ensembles: the objects of a live scene are saved to a GPU buffer and replicated
+// into every ensemble world by one pass per object buffer, each copy carrying its world in
+// Object::worldID, so a scene branches into many rollouts without the objects leaving VRAM.
+// The saved copy then puts the scene back as it was when the fork started.
+namespace ObjectFork
+{
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // Save objectSSBO's first numObjects objects; false if the copy cannot be allocated
+    bool Save(GLuint objectSSBO, int numObjects);
+    int GetSavedCount();  // -1 without a saved scene
+
+    // Fill every target buffer with worlds copies of the saved objects
+    bool Replicate(const GLuint* targets, int targetCount, int worlds);
+
+    // Copy the saved objects back to the start of every target buffer and drop them
+    bool Restore(const GLuint* targets, int targetCount);
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // OBJECT_FORK_H
@@ -0,0 +1,69 @@
+#ifndef OBJECT_GATHER_H
+#define OBJECT_GATHER_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// SSBO bindings of object_gather.comp
+const int GATHER_INDICES_BINDING = 39;
+const int GATHER_OUTPUT_BINDING = 40;
+
+// Fields a gather returns, packed per object in bit order - MUST MATCH object_gather.comp
+enum ObjectField : unsigned int
+{
+    OBJECT_FIELD_POSITION = 1u << 0,          // x, y
+    OBJECT_FIELD_VELOCITY = 1u << 1,          // vx, vy
+    OBJECT_FIELD_MASS = 1u << 2,
+    OBJECT_FIELD_CHARGE = 1u << 3,
+    OBJECT_FIELD_ROTATION = 1u << 4,          // visualData.z
+    OBJECT_FIELD_ANGULAR_VELOCITY = 1u << 5,  // visualData.w
+    OBJECT_FIELD_SIZE = 1u << 6,              // visualData.xy
+    OBJECT_FIELD_COLOR = 1u << 7,             // r, g, b, a
+    OBJECT_FIELD_SKIN = 1u << 8,              // visualSkinType, as a float
+    OBJECT_FIELD_ALL = (1u << 9) - 1u,
+
+    // Modifier, not a field: position packs into one word as two 16-bit fractions of the
+    // GatherQuantization box (x in the low half), velocity into one word as half2
+    OBJECT_FIELD_QUANTIZED = 1u << 31
+};
+
+// Box of a quantized gather: x = minX + q / 65535 * (maxX - minX), same for y;
+// positions outside it are clamped to its edges
+struct GatherQuantization
+{
+    float minX = 0.0f;
+    float minY = 0.0f;
+    float maxX = 1.0f;
+    float maxY = 1.0f;
+};
+
+// Field-projected readback: a compute pass copies the selected fields of the listed objects
+// into a tight staging buffer, so reading a few positions moves 8 bytes per object
+// instead of the 96-byte Object.
+namespace ObjectGather
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the staging buffers for more objects
+    void Cleanup();
+
+    // 32-bit words (floats, or packed words with OBJECT_FIELD_QUANTIZED) per object for a field mask
+    int FloatsPerObject(unsigned int fieldMask);
+
+    // Gather the fields of the objects at indices (all < the buffer's object count) into out,
+    // FloatsPerObject(fieldMask) floats per index; false if the shader is not ready
+    bool Gather(GLuint objectSSBO, const std::vector<int>& indices, unsigned int fieldMask, std::vector<float>& out);
+
+    // Same, GPU to GPU: count indices from indicesSSBO, written to outputSSBO from word
+    // outputOffset on, with no readback. quantization is read when the mask quantizes.
+    bool GatherToBuffer(GLuint objectSSBO, GLuint indicesSSBO, GLuint count, unsigned int fieldMask,
+                        GLuint outputSSBO, GLuint outputOffset, const GatherQuantization* quantization = nullptr);
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // OBJECT_GATHER_H
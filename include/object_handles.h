@@ -0,0 +1,56 @@
+#ifndef OBJECT_HANDLES_H
+#define OBJECT_HANDLES_H
+
+#include <glad/glad.h>
+#include <vector>
+
+// Texture unit of the handle table - MUST MATCH math.comp, object_reduction.comp and force_field.comp
+const int OBJECT_HANDLES_TEXTURE_UNIT = 12;
+
+// A handle is a table slot in the low bits and the slot's reuse count above them, so a handle
+// stays a non-negative int and one that outlived its object does not name the slot's next one
+// (until the slot has been reused OBJECT_HANDLE_GENERATIONS times)
+const int OBJECT_HANDLE_SLOT_BITS = 22;  // Objects::MAX_OBJECTS slots
+const int OBJECT_HANDLE_SLOT_MASK = (1 << OBJECT_HANDLE_SLOT_BITS) - 1;
+const int OBJECT_HANDLE_GENERATIONS = 1 << (31 - OBJECT_HANDLE_SLOT_BITS);
+
+// Stable object handles. Removal swap-moves the last object into the hole, so indices change;
+// a handle keeps naming its object until the object is removed. p[i] in an equation reads the
+// object with handle i: the table maps each slot to the object's current index and the handle
+// it was issued, so a removal rewrites two table entries and no equation. Handles are issued
+// in index order while nothing has been removed, so until then handle i is object i, and they
+// start over once the last host object is gone. Objects the GPU spawns have no handle.
+// The table is an RG32I buffer texture (index, handle) per slot, math.comp being out of SSBO blocks.
+namespace ObjectHandles
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the table for more objects (entries are kept)
+    void Cleanup();
+
+    // The first numObjects objects get handles 0..numObjects-1; every other handle is dropped
+    void Reset(int numObjects);
+
+    // Host object list edits, in the order they happen
+    int Append(int index);         // Handle of a new object at index
+    void Release(int index);       // The object at index is removed
+    void Move(int to, int from);   // The object at from now lives at to
+    void Permute(const std::vector<int>& order);  // The object at order[i] now lives at i
+
+    int HandleOf(int index);       // -1 for spawned objects and indices past the last object
+    int IndexOf(int handle);       // -1 once the object is gone
+
+    // One handle per object, for snapshots; Restore issues exactly these and returns false
+    // (keeping the current table) if they repeat or do not fit
+    void GetHandles(int numObjects, std::vector<int>& handles);
+    bool Restore(const std::vector<int>& handles);
+
+    // (index, handle) per slot for a list of per-object handles, the layout the shaders read;
+    // empty when every handle equals its index
+    std::vector<int> BuildSlotTable(const std::vector<int>& handles);
+
+    // Upload pending edits and bind the buffer texture for math.comp / object_reduction.comp / force_field.comp
+    void Bind();
+}
+
+#endif // OBJECT_HANDLES_H
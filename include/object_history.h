@@ -0,0 +1,31 @@
+#ifndef OBJECT_HISTORY_H
+#define OBJECT_HISTORY_H
+
+#include <glad/glad.h>
+#include <string>
+
+// Rollback history: a ring of copies of the object buffer kept in one GPU buffer, each slot
+// filled by glCopyBufferSubData, so taking a snapshot and rewinding to one never moves the
+// objects through host memory. Slots hold as many objects as the first snapshot; a scene that
+// outgrows them starts the ring over.
+namespace ObjectHistory
+{
+    void Cleanup();
+
+    // capacity slots, 0 = off (frees the ring)
+    void SetCapacity(int capacity);
+    void Clear();  // Drop every snapshot, keep the ring
+
+    // Copy objectSSBO's first numObjects objects into the next slot, the oldest one once full
+    bool Push(GLuint objectSSBO, int numObjects, double time);
+
+    int GetCount();  // Snapshots held, at most the capacity
+    // back = 0 is the newest snapshot; -1 objects for one not held
+    int GetObjects(int back);
+    double GetTime(int back);
+
+    // Copy snapshot back into every target buffer; the newer snapshots are dropped
+    bool Restore(int back, const GLuint* targets, int targetCount);
+}
+
+#endif // OBJECT_HISTORY_H
@@ -0,0 +1,81 @@
+#ifndef OBJECT_LIFECYCLE_H
+#define OBJECT_LIFECYCLE_H
+
+#include <glad/glad.h>
+#include <string>
+
+// SSBO bindings of the lifecycle passes - MUST MATCH object_lifecycle.comp
+const int LIFECYCLE_COUNTERS_BINDING = 33;  // Object count, dead count, compaction counters
+const int LIFECYCLE_STATE_BINDING = 34;     // Age, emitter and kill flag per object
+const int LIFECYCLE_EMITTERS_BINDING = 35;  // ParticleEmitter array
+const int LIFECYCLE_MOVES_BINDING = 36;     // (hole, mover) index pairs of the compaction
+
+const int MAX_PARTICLE_EMITTERS = 64;
+
+// Kill conditions of an emitter's objects (lifetime applies whenever it is > 0) - MUST MATCH object_lifecycle.comp
+enum ParticleKillFlags
+{
+    KILL_OUTSIDE_BOUNDS = 1,  // Position leaves [boundsMin, boundsMax]
+    KILL_TRANSPARENT = 2      // Alpha (the colour equation's a component) falls to 0
+};
+
+// One emitter - MUST MATCH object_lifecycle.comp
+struct ParticleEmitter
+{
+    float offset[2];          // Spawn point relative to the template object
+    float velocity[2];        // Added to the template's velocity
+    float positionSpread;     // Radius of the random spawn disc
+    float velocitySpread;     // Radius of the random velocity disc
+    float lifetime;           // Seconds, <= 0 = no age limit
+    int templateObject;       // Object copied on spawn (shape, colour, mass, equation, collision)
+    int killFlags;            // ParticleKillFlags
+    int spawnOffset;          // First spawn index of this emitter in the current step
+    int spawnCount;           // Objects it spawns in the current step
+    int _pad;
+    float boundsMin[2];
+    float boundsMax[2];
+};
+
+// GPU-resident object lifecycle: emitters append copies of a template object with an atomic
+// counter and kill conditions mark objects dead; a compaction pass refills the holes from the
+// tail. The object count lives on the GPU; the host learns it through a fenced copy a few
+// steps later, and until then the slots it still dispatches past the end hold inert objects.
+// Spawned objects live after every host-managed object, from GetBase() on.
+namespace ObjectLifecycle
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the per-object lifecycle state, keeping it
+    void Cleanup();
+
+    // Emitters; rate is objects per second. AddEmitter returns the emitter ID or -1 when full.
+    int AddEmitter(const ParticleEmitter& emitter, float rate);
+    bool RemoveEmitter(int emitterID);
+    void ClearEmitters();
+    int GetEmitterCount();
+
+    // Kill, compact and spawn after a step, on the state the step produced (also written to
+    // the other object buffer); false if nothing ran
+    bool Step(GLuint currentSSBO, GLuint otherSSBO, GLuint collisionPropsSSBO, int numObjects,
+              float stepDt, bool adaptiveTimestep);
+
+    // Object count the GPU reported, whenever a new one arrived; never waits
+    bool PollObjectCount(int& numObjects);
+
+    // Spawned objects may exist (objects from GetBase() on are GPU-managed)
+    bool IsActive();
+    int GetBase();
+
+    // Mark a spawned object dead; it is compacted away in the next step
+    void KillObject(int index);
+
+    // Drop every spawned object (before the host edits the object list)
+    void DiscardSpawned();
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // OBJECT_LIFECYCLE_H
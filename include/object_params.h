@@ -0,0 +1,35 @@
+#ifndef OBJECT_PARAMS_H
+#define OBJECT_PARAMS_H
+
+#include <glad/glad.h>
+#include <vector>
+
+// Per-object equation parameters $0..$7 - MUST MATCH VAR_HASH_PARAM_* and math.comp
+const int OBJECT_PARAM_COUNT = 8;
+
+// Texture unit the parameter buffer texture is bound to - MUST MATCH math.comp and object_reduction.comp
+const int OBJECT_PARAMS_TEXTURE_UNIT = 15;
+
+// Values an equation reads as $0..$7, one row per object, so objects that differ only in
+// their constants share one equation ID and one token stream. math.comp is out of SSBO
+// blocks, so the buffer is sampled as an RGBA32F buffer texture (two texels per object).
+// The host keeps the authoritative copy; edits are uploaded as one range before the next use.
+namespace ObjectParams
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the buffer for more objects (rows are kept)
+    void Cleanup();
+
+    // values[0..count) go to $first..$first+count-1 of one object
+    void Set(int index, int first, const float* values, int count);
+    void Get(int index, float* out);  // OBJECT_PARAM_COUNT values
+    void Clear(int index);
+    void Move(int to, int from);      // Row of from to to; from is cleared
+    void Permute(const std::vector<int>& order);  // Row i becomes the old row order[i]
+
+    // Upload pending edits and bind the buffer texture for math.comp / object_reduction.comp
+    void Bind();
+}
+
+#endif // OBJECT_PARAMS_H
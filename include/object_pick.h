@@ -0,0 +1,33 @@
+#ifndef OBJECT_PICK_H
+#define OBJECT_PICK_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+
+// SSBO binding of the pick result - MUST MATCH object_pick.comp
+const int OBJECT_PICK_RESULT_BINDING = 53;
+
+// Mouse picking on the GPU: one pass finds the smallest squared distance from a world point to
+// an object centre within that object's pick radius, a second pass the lowest index at that
+// distance, and only those two words are read back.
+namespace ObjectPick
+{
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // Object of objectSSBO's first numObjects objects under worldPos, -1 if none; waits for the
+    // result. false if the shader is not ready.
+    bool Pick(GLuint objectSSBO, int numObjects, const glm::vec2& worldPos, int& index);
+
+    // Pick radius of an object, shared with the CPU fallback - MUST MATCH object_pick.comp
+    float PickRadius(int skinType, const glm::vec4& visualData);
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // OBJECT_PICK_H
@@ -0,0 +1,44 @@
+#ifndef OBJECT_PIPELINE_H
+#define OBJECT_PIPELINE_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// Texture unit math.comp samples the fields through - MUST MATCH math.comp
+const int OBJECT_PIPELINE_TEXTURE_UNIT = 4;
+
+const int PIPELINE_FIELD_COUNT = 8;  // MUST MATCH MAX_PIPELINE_FIELDS in parser.h, object_pipeline.comp
+const int MAX_PIPELINE_PASSES = 8;
+
+// Multi-pass pipelines of named per-object fields, run once per integration stage before the
+// equations. Each pass is a list of "name = expr" statements separated by ';'; it is compiled
+// to its own program from object_pipeline.comp and dispatched over every object, with a barrier
+// before the next pass. Statements follow the rules of reduce(), and may also use nsum(),
+// ncount() and nmean() over the neighbour grid: a pass reads the fields of the passes before it,
+// its own as fld[name] and a neighbour's as pj.fld[name] inside a neighbour reduction, and a
+// statement the fields of the statements before it in its pass. Density then pressure then
+// force is three passes, all user code. Equations read the results as fld[name] and
+// pj.fld[name]; every field is 0 until the first step that runs the pipeline.
+namespace ObjectPipeline
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the field buffer for more objects (rows are kept)
+    void Cleanup();
+
+    // Replace the pipeline; every pass is compiled, and on error nothing changes
+    bool Set(const std::vector<std::string>& passes, std::string& error);
+    void Clear();
+    bool IsActive();
+
+    // Run every pass over objectSSBO; false if the pipeline is empty or the grid could not be built
+    bool Run(GLuint objectSSBO, GLuint collisionPropsSSBO, int numObjects);
+    void Bind();  // The fields for math.comp
+
+    // Field name of every object as of the last run; false for a name the pipeline does not
+    // write. Waits for the GPU.
+    bool GetValues(const std::string& name, int numObjects, std::vector<float>& values);
+}
+
+#endif // OBJECT_PIPELINE_H
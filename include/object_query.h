@@ -0,0 +1,49 @@
+#ifndef OBJECT_QUERY_H
+#define OBJECT_QUERY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// SSBO bindings of the query shader - MUST MATCH object_query.comp
+const int OBJECT_QUERY_SHAPES_BINDING = 55;
+const int OBJECT_QUERY_RANGES_BINDING = 56;
+const int OBJECT_QUERY_HITS_BINDING = 57;
+
+// Batched spatial queries on the GPU: which objects have their centre inside each of a list of
+// circles or rectangles. One invocation per query walks the grid cells its shape overlaps in a
+// neighbour grid (Broadphase::BuildNeighbourGrid with GridCellSize() cells, worlds merged), or
+// every object when no grid is bound, counts its hits, claims that many entries of one shared
+// hit list with a single atomic and writes them there, so every query runs in one dispatch.
+namespace ObjectQuery
+{
+    enum QueryShape
+    {
+        QUERY_RADIUS = 0,  // (centre x, centre y, radius, unused)
+        QUERY_AABB = 1     // (min x, min y, max x, max y)
+    };
+
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // Grid cell size at which each shape overlaps at most 3x3 cells, 0 if no grid can serve them
+    float GridCellSize(QueryShape shape, const std::vector<glm::vec4>& shapes);
+
+    // Objects of objectSSBO's first numObjects objects inside each shape, ascending, one list
+    // per shape; waits for the result. cellSize is that of the bound neighbour grid and
+    // gridTableSize its hash size, 0 = test every object. false if the shader is not ready.
+    bool Query(GLuint objectSSBO, int numObjects, QueryShape shape, const std::vector<glm::vec4>& shapes,
+               float cellSize, GLuint gridTableSize, std::vector<std::vector<int>>& results);
+
+    // Membership test shared with the CPU fallback - MUST MATCH object_query.comp
+    bool Contains(QueryShape shape, const glm::vec4& query, const glm::vec2& position);
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // OBJECT_QUERY_H
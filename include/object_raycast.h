@@ -0,0 +1,50 @@
+#ifndef OBJECT_RAYCAST_H
+#define OBJECT_RAYCAST_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// SSBO bindings of the raycast shader - MUST MATCH object_raycast.comp
+const int OBJECT_RAYCAST_RAYS_BINDING = 58;
+const int OBJECT_RAYCAST_HITS_BINDING = 59;
+
+// First collision shape along a ray - MUST MATCH object_raycast.comp
+struct RayHit
+{
+    int index;          // Object hit, -1 = nothing within the distance
+    float distance;     // Along the ray; the maximum distance when nothing was hit
+    glm::vec2 normal;   // Surface normal at the hit, facing the ray; 0 when nothing was hit
+};
+
+// Batched raycasts against the collision shapes (circle, AABB, regular polygon) on the GPU.
+// One invocation per ray walks the collision LBVH (Broadphase::Build with BROADPHASE_LBVH,
+// bound with BindForCollision) nearest child first, or every object when no BVH is bound,
+// and writes one RayHit; only the hits are read back. Objects with collisions disabled are
+// transparent, and a shape the ray starts inside is not hit, so a sensor cast from an
+// object's centre sees past that object.
+namespace ObjectRaycast
+{
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // One hit per (origin x, origin y, dir x, dir y) ray against objectSSBO's first numObjects
+    // objects; waits for the result. Directions need not be unit length; a zero one hits nothing.
+    // useBVH says an LBVH of these objects is bound. false if the shader is not ready.
+    bool Cast(GLuint objectSSBO, GLuint collisionPropsSSBO, int numObjects, const std::vector<glm::vec4>& rays,
+              float maxDistance, bool useBVH, std::vector<RayHit>& hits);
+
+    // Ray against one collision shape, for the CPU fallback - MUST MATCH object_raycast.comp.
+    // dir is unit length; true with the entry distance in [0, maxDistance] and the normal there.
+    bool Intersect(const glm::vec2& origin, const glm::vec2& dir, float maxDistance, int shapeType,
+                   const glm::vec2& position, const glm::vec4& visualData, float& t, glm::vec2& normal);
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // OBJECT_RAYCAST_H
@@ -0,0 +1,48 @@
+#ifndef OBJECT_RECORDER_H
+#define OBJECT_RECORDER_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+#include "object_gather.h"
+
+// Frames a recording kept, oldest first: words holds wordsPerObject 32-bit words per object
+// (ObjectGather packing of fieldMask: floats, or packed words where it quantizes) of every
+// recorded object, one frame after another
+struct RecordedFrames
+{
+    std::vector<uint32_t> words;
+    std::vector<int> steps;      // Steps since Start() at each frame
+    std::vector<float> times;    // Simulation time after each frame's step
+    int frames = 0;
+    int objects = 0;
+    int wordsPerObject = 0;
+    unsigned int fieldMask = 0;
+    GatherQuantization quantization;  // Dequantization box when fieldMask quantizes
+    int dropped = 0;             // Frames overwritten before a Download() got to them
+};
+
+// On-GPU trajectory recording: every n steps the gather shader appends the selected fields
+// of the recorded objects to a ring buffer of `capacity` frames, and Download() moves all
+// pending frames to the host in one transfer. With OBJECT_FIELD_QUANTIZED in the mask the
+// gather packs positions and velocities to one word each, halving what streams to the host.
+namespace ObjectRecorder
+{
+    // Core functions
+    bool Start(const std::vector<int>& indices, unsigned int fieldMask, int everyNSteps, int capacity,
+               const GatherQuantization& quantization = GatherQuantization());
+    void Stop();  // Frees the ring buffer; frames not downloaded are lost
+    void Cleanup();
+    bool IsRecording();
+
+    // After a step: steps is how many fixed steps it took, time the simulation time after it.
+    // numObjects guards against recorded objects that were removed since Start().
+    void Capture(GLuint objectSSBO, int numObjects, int steps, float time);
+
+    // Frames captured since the last Download(); false if nothing is being recorded. With
+    // newest > 0 only that many of the latest are read and the rest count as dropped.
+    bool Download(RecordedFrames& out, int newest = 0);
+    int PendingFrames();  // What the next Download() would return, at most the capacity
+}
+
+#endif // OBJECT_RECORDER_H
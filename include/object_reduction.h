@@ -0,0 +1,69 @@
+#ifndef OBJECT_REDUCTION_H
+#define OBJECT_REDUCTION_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// SSBO bindings of the reduction passes - MUST MATCH object_reduction.comp
+const int REDUCTION_PARTIALS_BINDING = 37;  // One value per work group of the object pass
+const int REDUCTION_RESULT_BINDING = 38;    // The reduced value, or one per world; histogram bin counts
+const int HISTOGRAM_SHARED_BINS = 2048;     // Histograms up to this many bins count in shared memory first
+const int MAX_REDUCED_AGGREGATES = 16;      // Expressions of one ReduceAggregates() block
+
+// MUST MATCH OP_* in object_reduction.comp (mean is a sum divided on the host)
+enum ReductionOp
+{
+    REDUCE_SUM = 0,
+    REDUCE_MIN = 1,
+    REDUCE_MAX = 2,
+    REDUCE_MEAN = 3
+};
+
+// GPU reduction of one per-object expression to a single value: a work-group tree reduction
+// writes one partial per group and a single group reduces the partials, so only the result
+// is read back. Each expression is generated into its own program and kept by its key.
+namespace ObjectReduction
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the partials buffer for more objects
+    void Cleanup();
+
+    // Evaluate expressionFunction (a GLSL `float reduceExpression(...)` from
+    // EquationCodegen::GenerateExpressionFunction) over [0, numObjects). System parameters
+    // come from the SimParams block bound by the caller. Waits for the result; false with
+    // error set on failure.
+    bool Reduce(const std::string& key, const std::string& expressionFunction, ReductionOp op,
+                GLuint objectSSBO, int numObjects, float& result, std::string& error);
+
+    // Reduce the same kind of expression over each ensemble world on its own, one work group
+    // per world reading the world table (object_worlds.h) the caller bound; numWorlds 0 treats
+    // all objects as one world. p[i] is the i-th object of the world, the reader included.
+    // results gets one value per world (one without worlds); waits for them.
+    bool ReduceWorlds(const std::string& key, const std::string& expressionFunction, ReductionOp op,
+                      GLuint objectSSBO, int numObjects, int numWorlds, std::vector<float>& results,
+                      std::string& error);
+
+    // Count the objects per bin of the same kind of expression: binsX bins over
+    // [range[0], range[1]], and for a 2D histogram (binsY > 1, expressionFunctions also holding
+    // `float histogramY(...)` after `#define HISTOGRAM_2D`) binsY over [range[2], range[3]].
+    // Bins are half-open except the last, which holds its upper edge too; values outside the
+    // range, inf and NaN are not counted. counts gets binsX * binsY values, x major; waits for them.
+    bool Histogram(const std::string& key, const std::string& expressionFunctions, GLuint objectSSBO,
+                   int numObjects, int binsX, int binsY, const float range[4], std::vector<uint32_t>& counts,
+                   std::string& error);
+
+    // Several expressions, each over the objects whose group bits (the texture the caller bound
+    // at OBJECT_GROUPS_TEXTURE_UNIT) share one with groups[k] (0 = every object), in one pass
+    // over the objects. expressionFunctions holds `#define AGGREGATE_COUNT count` and
+    // `float aggregateExpression(int k, int i)`; result k is written to float slots[k] of
+    // resultBuffer and nothing is read back. Expression k reduces with ops[k]; a group without
+    // objects gives 0.
+    bool ReduceAggregates(const std::string& key, const std::string& expressionFunctions, int count,
+                          const int* ops, const uint32_t* groups, const int* slots, GLuint objectSSBO,
+                          int numObjects, GLuint resultBuffer, std::string& error);
+}
+
+#endif // OBJECT_REDUCTION_H
@@ -0,0 +1,38 @@
+#ifndef OBJECT_REORDER_H
+#define OBJECT_REORDER_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// SSBO bindings of object_reorder.comp, shared with object_gather.comp (never bound together)
+const int REORDER_ORDER_BINDING = 39;
+const int REORDER_DESTINATION_BINDING = 40;
+
+// Spatial storage order: objects are sorted by the Z-order (Morton) code of their position
+// so neighbours in space sit next to each other in every per-object buffer, which is what
+// the collision loop, neighbour reductions and p[i] reads fetch together. The order is
+// worked out on the host from a position-only gather; each buffer is then permuted on the
+// GPU. Indices change like after a removal - object handles keep naming the same objects.
+namespace ObjectReorder
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the order buffer for more objects
+    void Cleanup();
+
+    // Z-order of the first numObjects objects of objectSSBO: order[new index] = old index,
+    // uploaded for Permute(). False (order untouched) when they are already in that order or
+    // a shader is not ready. Reads the positions back, so it waits for the GPU.
+    bool BuildSpatialOrder(GLuint objectSSBO, int numObjects, std::vector<int>& order);
+
+    // Rows [0, count) of buffer, rowBytes each (a multiple of 4), into the uploaded order
+    void Permute(GLuint buffer, GLsizeiptr rowBytes, int count);
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // OBJECT_REORDER_H
@@ -0,0 +1,47 @@
+#ifndef OBJECT_SCATTER_H
+#define OBJECT_SCATTER_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include "objects.h"
+
+// SSBO binding of object_scatter.comp
+const int SCATTER_WRITES_BINDING = 41;
+
+// fieldMask bit of a write that replaces the whole object rather than the ObjectField bits
+const unsigned int OBJECT_WRITE_WHOLE = 1u << 31;
+// fieldMask bit of a write that sets equationID (host-side only, not an ObjectField readers can select)
+const unsigned int OBJECT_WRITE_EQUATION = 1u << 30;
+
+// One queued host write - MUST MATCH object_scatter.comp (std430, 112 bytes).
+// The fields selected by fieldMask are taken from values at their place in the Object.
+struct ObjectWrite
+{
+    GLuint index;
+    GLuint fieldMask;   // ObjectField bits, or OBJECT_WRITE_WHOLE
+    GLuint _pad[2];
+    Object values;
+};
+static_assert(sizeof(ObjectWrite) == 16 + sizeof(Object), "ObjectWrite must match the std430 layout of object_scatter.comp");
+
+// Coalesced host writes: every queued edit goes up in one buffer upload and a compute pass
+// applies them to both object buffers, instead of two glBufferSubData calls per edit.
+namespace ObjectScatter
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the write staging buffer for more objects
+    void Cleanup();
+
+    // Apply writes (distinct indices, all < the object count): the merged fields are read from
+    // currentSSBO and the result is written to currentSSBO and otherSSBO; false if the shader is not ready
+    bool Scatter(GLuint currentSSBO, GLuint otherSSBO, const std::vector<ObjectWrite>& writes);
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // OBJECT_SCATTER_H
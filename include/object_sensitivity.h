@@ -0,0 +1,50 @@
+#ifndef OBJECT_SENSITIVITY_H
+#define OBJECT_SENSITIVITY_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// Parameters differentiated at once - MUST MATCH MAX_SENSITIVITIES in math.comp
+const int MAX_SENSITIVITY_PARAMETERS = 4;
+
+// Texels per (object, parameter): tangent, RK4 start-of-step tangent, RK4 rate sum - MUST MATCH math.comp
+const int SENSITIVITY_TEXELS = 3;
+
+// Image unit of the tangent buffer - MUST MATCH math.comp
+const GLuint SENSITIVITY_IMAGE_UNIT = 3;
+
+// Forward-mode sensitivities of each object's state with respect to up to four equation
+// parameters ($0..$7, k, damping, gravity, coupling, freq, amp, mass, charge). math.comp walks an
+// object's ax/ay programs once more per parameter with dual numbers seeded by the object's own
+// tangent (x, y, vx, vy) and the parameter, and carries the tangent through the integrator and
+// the world bounds, so one run gives d(x, y, vx, vy)/d(parameter) for every object. Other objects
+// (p[i], sum_j, long-range fields), contacts and constraints are held constant. The tangents are
+// an rgba32f image (math.comp is out of SSBO blocks) and stay on the GPU until read.
+namespace ObjectSensitivity
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the buffer for more objects (rows are kept)
+    void Cleanup();
+
+    // Variable hash of a parameter name, -1 when it cannot be differentiated
+    int ParameterHash(const std::string& name);
+
+    // Parameters to differentiate, as variable hashes; an empty list turns the pass off
+    void SetParameters(const std::vector<int>& varHashes);
+    const std::vector<int>& GetParameters();
+    int GetCount();
+
+    // Tangents of [0, count) objects: (dx, dy, dvx, dvy) per parameter, object-major; waits for the GPU
+    void Get(int count, std::vector<float>& out);
+    void Clear(int first, int count = 1);     // Zero the rows of [first, first + count)
+    void Move(int to, int from);              // Row of from to to; from is cleared
+    void Permute(int count);                  // Rows [0, count) into the order ObjectReorder uploaded
+
+    // Around the math.comp passes of a step, on the simulation's GL thread
+    void Bind();
+    void Unbind();
+}
+
+#endif // OBJECT_SENSITIVITY_H
@@ -0,0 +1,63 @@
+#ifndef OBJECT_SLEEP_H
+#define OBJECT_SLEEP_H
+
+#include <glad/glad.h>
+#include <string>
+
+// SSBO bindings of the awake-object list and the per-object still-step counters
+const int ACTIVE_SET_BINDING = 28;
+const int SLEEP_COUNTERS_BINDING = 29;
+
+// Sleeping objects: an object whose speed, angular speed and change of velocity stay
+// below the thresholds for a number of consecutive steps is put to rest and no longer
+// integrated or collided. After every step object_sleep.comp compacts the awake objects
+// into an active set whose dispatch arguments the next step's passes read with
+// glDispatchComputeIndirect. A moving object that touches a sleeper wakes it.
+// Sleepers are written at rest into every object buffer once, when they fall asleep,
+// so later steps can leave them alone.
+namespace ObjectSleep
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the sleep counters and active set for more objects
+    void Cleanup();
+
+    // Thresholds in units per second and per second squared; steps >= 1
+    void SetParameters(float velocityThreshold, float accelerationThreshold, int steps);
+    float GetVelocityThreshold();
+    float GetAccelerationThreshold();
+    int GetSleepSteps();
+
+    // Wake every object; the next step dispatches all of them again
+    void WakeAll();
+
+    // Put [first, first + count) to sleep as they are, for good: no still step or contact wakes
+    // them, only WakeAll(). They leave the active set the next Update() builds.
+    void Freeze(int first, int count);
+
+    // An active set was built for this object count since the last WakeAll()
+    bool HasActiveSet(int numObjects);
+
+    // Count still steps from the state a step produced and the one it started from, put the
+    // objects that fell asleep to rest in all buffers and rebuild the active set.
+    // scratchSSBO may be 0 when the step had no collision pass.
+    bool Update(GLuint currentSSBO, GLuint previousSSBO, GLuint scratchSSBO, int numObjects,
+                float stepDt, bool useDispatchOrder, int dispatchLocalSize);
+
+    // One invocation per awake object, from the arguments Update() left on the GPU
+    void DispatchActive();
+
+    // Bind the active set and the counters for math.comp and collide.comp
+    void Bind();
+    void Unbind();
+
+    // Awake objects in the last active set (reads the GPU count back)
+    int GetActiveCount();
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // OBJECT_SLEEP_H
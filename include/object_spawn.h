@@ -0,0 +1,50 @@
+#ifndef OBJECT_SPAWN_H
+#define OBJECT_SPAWN_H
+
+#include <glad/glad.h>
+#include <string>
+
+struct Object;
+
+// Where spawned objects are placed - MUST MATCH DIST_* in object_spawn.comp
+enum SpawnDistribution
+{
+    SPAWN_UNIFORM_DISK = 0,  // Uniform over the disc of radius extent about center
+    SPAWN_GAUSSIAN = 1,      // Normal about center, standard deviation extent per axis
+    SPAWN_LATTICE = 2,       // Square lattice of spacing extent centred on center, row by row
+    SPAWN_EXPRESSION = 3     // positionExpression
+};
+
+struct SpawnSettings
+{
+    SpawnDistribution distribution = SPAWN_UNIFORM_DISK;
+    float center[2] = { 0.0f, 0.0f };
+    float extent = 1.0f;
+    int columns = 0;          // Lattice columns, 0 = as square as the count allows
+    unsigned int seed = 0;    // Keys the generator: the same settings give the same objects
+
+    // "x_expr, y_expr" in the equation syntax. t runs over (0, 1) across the spawned objects
+    // and rand()/randn() draw per object. The position expression is the position, reading
+    // center as x, y; the velocity expression reads the spawned position. Empty = unused
+    // (velocity then stays the template's).
+    std::string positionExpression;
+    std::string velocityExpression;
+};
+
+// Procedural scene generation: a compute pass writes copies of a template object straight
+// into the object buffers, each placed by a distribution drawn from the counter-based
+// generator math.comp uses, so a million-object scene is built without the objects crossing
+// the bus. Expressions are generated into the pass like reductions, one program per pair.
+namespace ObjectSpawn
+{
+    // Release the template buffer and programs
+    void Cleanup();
+
+    // Write count copies of templateObject to [first, first + count) of every target buffer
+    // (large enough already), placed and launched per settings. The caller binds SimParams.
+    // false with error set when an expression does not compile; nothing is written then.
+    bool Spawn(const GLuint* targets, int targetCount, int first, int count, const Object& templateObject,
+               const SpawnSettings& settings, std::string& error);
+}
+
+#endif // OBJECT_SPAWN_H
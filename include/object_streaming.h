@@ -0,0 +1,52 @@
+#ifndef OBJECT_STREAMING_H
+#define OBJECT_STREAMING_H
+
+#include <glad/glad.h>
+#include <cstddef>
+
+struct Object;
+
+const int STREAM_SLOTS = 3;                     // Chunks in flight: one filled, one stepped, one read
+const int STREAM_DEFAULT_CHUNK = 1 << 20;       // Objects per chunk
+
+// Independent particles kept in host memory (or memory-mapped files) and advanced in chunks;
+// see Objects::StepStreamed. Columns are advanced in place; only position and velocity are
+// written back, plus the accelerations when given.
+struct StreamedParticles
+{
+    size_t count = 0;
+    float* x = nullptr;
+    float* y = nullptr;
+    float* vx = nullptr;
+    float* vy = nullptr;
+    float* ax = nullptr;  // Optional: the previous accelerations integrators read, carried between calls
+    float* ay = nullptr;
+    const float* mass = nullptr;  // Optional per particle, else massValue
+    const float* charge = nullptr;
+    float massValue = 1.0f;
+    float chargeValue = 1.0f;
+    int equationID = -1;  // What every particle runs, a behaviour group included
+};
+
+// Staging ring of the streaming mode: each slot is one persistently mapped, coherent buffer a
+// chunk is packed into, copied from into the object buffer, and copied back into behind a
+// fence, so the host packs and unpacks chunks while the GPU steps the ones queued before them
+// and the transfers are plain buffer copies. Without GL 4.4 buffer storage the slots are host
+// arrays moved with glBufferSubData and glGetBufferSubData, and nothing overlaps.
+namespace ObjectStreaming
+{
+    // Slots for chunks of up to chunkObjects objects (grows, never shrinks)
+    bool Reserve(int chunkObjects);
+    void Cleanup();
+
+    // Memory for the slot's next chunk, once the GPU is done with what the slot held before
+    Object* BeginFill(int slot);
+    // Queue the filled chunk into objectSSBO [0, count)
+    void Upload(int slot, GLuint objectSSBO, int count);
+    // Queue objectSSBO [0, count) back into the slot, behind a fence
+    void Download(int slot, GLuint objectSSBO, int count);
+    // The downloaded chunk, waiting for its fence if the copy has not landed yet
+    const Object* Finish(int slot);
+}
+
+#endif // OBJECT_STREAMING_H
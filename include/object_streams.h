@@ -0,0 +1,59 @@
+#ifndef OBJECT_STREAMS_H
+#define OBJECT_STREAMS_H
+
+#include <glad/glad.h>
+#include <string>
+
+// SSBO binding of the per-field object streams read by math.comp and collide.comp
+const int OBJECT_STREAMS_BINDING = 27;
+
+// Streams in the buffer, each one vec4 per object - MUST MATCH object_streams.comp, math.comp and collide.comp
+enum ObjectStream
+{
+    OBJECT_STREAM_KINEMATICS = 0,  // position.xy, velocity.xy
+    OBJECT_STREAM_DYNAMICS = 1,    // mass, charge, last acceleration (collisionData.xy)
+    OBJECT_STREAM_VISUAL = 2,      // visualData
+    OBJECT_STREAM_COLOR = 3,       // color
+    OBJECT_STREAM_COUNT = 4,
+    OBJECT_STREAM_QUANTIZED_COUNT = 3  // Colour folded into the other streams
+};
+
+// Structure-of-arrays object storage: the fields other objects read are scattered out of
+// the Object buffer into one dense array per field before the passes that loop over
+// neighbours, so those loops touch 16-byte elements instead of 96-byte Objects. The
+// streams share one buffer (stream s of object i is element s * capacity + i) to keep the
+// storage block count of math.comp within what drivers allow. Object stays the layout the
+// passes write and the CPU, renderer and Python exchange.
+//
+// The quantized layout packs the fields neighbours rarely need exactly: the dynamics stream
+// carries the last acceleration as half2 and the skin and shape types in 16 bits each, and the
+// visual stream keeps size and rotation as floats but height/sides and angular velocity as
+// halves and the colour as RGBA8 (clamped to [0, 1]). Three streams instead of four, and
+// neighbour reads no longer touch the Object buffer for the types. Lossy only for what other
+// objects see; every object's own state stays full precision.
+namespace ObjectStreams
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the streams for more objects (rewritten every step)
+    void Cleanup();
+
+    // Layout of the streams; changing it reallocates the buffer
+    void SetQuantized(bool quantized);
+    bool IsQuantized();
+    int ShaderMode();  // uObjectStreams while the streams are bound: 1 full, 2 quantized
+
+    // Scatter the fields of an Object buffer into the streams; false if the shader is not ready
+    bool Scatter(GLuint objectSSBO, int numObjects);
+
+    // Bind the streams for math.comp and collide.comp
+    void Bind();
+    void Unbind();
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // OBJECT_STREAMS_H
@@ -0,0 +1,47 @@
+#ifndef OBJECT_TRAILS_H
+#define OBJECT_TRAILS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+
+// SSBO bindings of object_trail_record.comp and trail.vert
+const int TRAIL_HISTORY_BINDING = 48;
+const int TRAIL_OBJECTS_BINDING = 49;
+
+// Longest trail, in recorded positions
+const int TRAIL_MAX_LENGTH = 1024;
+
+// What the editor tracks (PhysicsSystem::showTrails switches drawing)
+const int TRAIL_DEFAULT_OBJECTS = 10000;
+const int TRAIL_DEFAULT_LENGTH = 64;
+
+// Position trails kept on the GPU: the first `objects` objects each own a ring of `length`
+// positions, one small pass writes the newest position of each after every Update, and the
+// trails are drawn as line strips straight from the ring, fading out towards their oldest end.
+// Nothing is read back.
+namespace ObjectTrails
+{
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // Track the first `objects` objects with `length` positions each (2..TRAIL_MAX_LENGTH);
+    // 0 objects turns trails off. Drops the recorded history.
+    bool Configure(int objects, int length);
+    int GetObjects();
+    int GetLength();
+    void Reset();  // Forget the recorded positions, e.g. after objects were moved by hand
+
+    // Append the positions of objectSSBO's tracked objects (of numObjects live ones)
+    void Record(GLuint objectSSBO, int numObjects);
+    // Draw the trails; colours come from objectSSBO
+    void Draw(const glm::mat4& projView, GLuint objectSSBO, int numObjects);
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // OBJECT_TRAILS_H
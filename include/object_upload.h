@@ -0,0 +1,23 @@
+#ifndef OBJECT_UPLOAD_H
+#define OBJECT_UPLOAD_H
+
+#include <glad/glad.h>
+
+// Staged uploads of large host arrays into GPU buffers: a background thread copies chunks into
+// a ring of persistently mapped, coherent staging buffers while the calling thread queues a
+// glCopyBufferSubData of each finished chunk into every destination. A fence behind each
+// chunk's copies guards its reuse, so the caller never waits on the driver for a buffer the
+// queued steps are still using, and one host copy feeds both object buffers. Needs GL 4.4
+// buffer storage; the ring and the thread are created by the first staged upload.
+namespace ObjectUpload
+{
+    // bytes of data into [offset, offset + bytes) of each of the bufferCount buffers. The copies
+    // are queued (not finished) on return, so data may be freed. False, with nothing queued, for
+    // uploads small enough for glBufferSubData or when staging is unavailable.
+    bool Upload(const void* data, GLsizeiptr bytes, const GLuint* buffers, int bufferCount, GLintptr offset);
+
+    // Stop the thread and release the ring (waits for its copies)
+    void Cleanup();
+}
+
+#endif // OBJECT_UPLOAD_H
@@ -0,0 +1,56 @@
+#ifndef OBJECT_WORLDS_H
+#define OBJECT_WORLDS_H
+
+#include <glad/glad.h>
+#include <vector>
+
+// Texture units of the world table and the per-world parameters - MUST MATCH math.comp
+const int OBJECT_WORLDS_TEXTURE_UNIT = 14;
+const int OBJECT_WORLD_PARAMS_TEXTURE_UNIT = 13;
+
+// Ensemble worlds: independent simulations that share the object buffers and step in the
+// same dispatches. World w owns the contiguous objects [first, first + count), and each
+// object carries w in Object::worldID. p[i] then names the i-th object of the reader's
+// world, sum_j and the neighbour reductions stay inside it, and objects of different worlds
+// never collide. The table is an RG32I buffer texture (math.comp is out of SSBO blocks).
+namespace ObjectWorlds
+{
+    struct WorldRange
+    {
+        int first;  // First object of the world
+        int count;  // Objects in the world
+    };
+
+    // Values a world's equations read in place of the SimParams ones (RGBA32F, two texels)
+    // - MUST MATCH loadWorldParameters() in math.comp
+    struct WorldParameters
+    {
+        float stiffness;  // k
+        float damping;    // b
+        float gravity;    // g
+        float coupling;
+        float driveFreq;
+        float driveAmp;
+        float _pad[2];
+    };
+
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // Replace the table; the objects' worldIDs are the caller's to set. An empty table
+    // turns ensembles off, and every object is in one world again.
+    void Set(const std::vector<WorldRange>& worlds);
+    void Clear();
+    int Count();
+    int LargestCount();  // Objects in the largest world, 0 without worlds
+
+    // One row per world, after Set; without rows every world reads the SimParams values
+    void SetParameters(const std::vector<WorldParameters>& parameters);
+    bool HasParameters();
+
+    // Bind the tables for math.comp
+    void Bind();
+}
+
+#endif // OBJECT_WORLDS_H
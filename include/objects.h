@@ -8,6 +8,21 @@
 #include "common_definitions.h"
 #include "parser.h"
 #include "constraints.h"
+#include "broadphase.h"
+#include "object_reduction.h"
+#include "expression_eval.h"
+#include "object_streaming.h"
+#include "object_gather.h"
+#include "object_recorder.h"
+#include "object_checkpoint.h"
+#include "object_worlds.h"
+#include "object_query.h"
+#include "object_raycast.h"
+#include "object_spawn.h"
+#include "long_range.h"
+#include "sph_fluid.h"
+
+struct GPUSerializedEquation;  // gpu_serializer.h
 
 // CRITICAL FIX: Ensure struct packing matches GPU (std430 layout)
 // Use explicit padding to avoid alignment issues
@@ -27,53 +42,97 @@ struct Object
     glm::vec4 color;         // NEW: offset 64, size 16 - (r, g, b, a)
 
     int equationID; // offset 80, size 4
-    int _pad1;      // offset 84, size 4
+    int worldID;    // offset 84, size 4 - Ensemble world (object_worlds.h), 0 outside one
     int _padEnd[2]; // offset 88, size 8
     // Total: 96 bytes (was 80 bytes)
 };
 static_assert(sizeof(Object) == 96, "Object struct size must be 96 bytes!");
 
-// Extended Equation mapping structure for rotation and color
+// Extended Equation mapping structure for rotation and color.
+// bytecodeOffset_* index the register bytecode buffer, -1 = stack encoding only.
 struct EquationMapping
 {
     // AX components
     int tokenOffset_ax;
     int tokenCount_ax;
     int constantOffset_ax;
-    int _pad1;
+    int bytecodeOffset_ax;
 
     // AY components
     int tokenOffset_ay;
     int tokenCount_ay;
     int constantOffset_ay;
-    int _pad2;
+    int bytecodeOffset_ay;
 
     // NEW: Angular acceleration
     int tokenOffset_angular;
     int tokenCount_angular;
     int constantOffset_angular;
-    int _pad3;
+    int bytecodeOffset_angular;
 
     // NEW: Color components
     int tokenOffset_r;
     int tokenCount_r;
     int constantOffset_r;
-    int _pad4;
+    int bytecodeOffset_r;
 
     int tokenOffset_g;
     int tokenCount_g;
     int constantOffset_g;
-    int _pad5;
+    int bytecodeOffset_g;
 
     int tokenOffset_b;
     int tokenCount_b;
     int constantOffset_b;
-    int _pad6;
+    int bytecodeOffset_b;
 
     int tokenOffset_a;
     int tokenCount_a;
     int constantOffset_a;
-    int _pad7;
+    int bytecodeOffset_a;
+
+    // Steps between evaluations of the colour components (1 = every step), 0 = only the last
+    // step before a frame (see SetFrameStepsLeft); the colour holds in between
+    int colorInterval = 1;
+
+    // "sK = expr" updates: MAX_STATE_REGISTERS token counts, then the expressions back to back
+    // (constants from constantOffset_state); tokenCount_state = 0 when the equation has none
+    int tokenOffset_state = 0;
+    int tokenCount_state = 0;
+    int constantOffset_state = 0;
+
+    // Rate group: steps per evaluation of the equation (1 = every step). In between, the objects
+    // drift on their velocity; each evaluation kicks the velocity for all of its steps.
+    int stepInterval = 1;
+
+    // Distinct p[i] indices of the equation (collectObjectRefs), staged per workgroup by math.comp
+    int tokenOffset_refs = 0;
+    int tokenCount_refs = 0;
+
+    // Hoisted subexpressions (TOKEN_PRELUDE): slot s reads prelude value preludeOffset + s, -1 = none
+    int preludeOffset = -1;
+};
+
+// One sum_j()/nsum()/ncount()/nmean() term; its body lives in the shared token/constant buffers
+struct PairSumExpression
+{
+    int tokenOffset;
+    int tokenCount;      // 0 for ncount()
+    int constantOffset;
+    int reduction;       // PairReductions::PAIR_REDUCE_*
+    float radius;        // Neighbour radius, 0 = every other object (sum_j)
+    int used;            // 0 = unused slot; slots are assigned in order
+    int _pad0;
+    int _pad1;
+};
+
+// One hoisted subexpression, evaluated by math.comp's prelude pass once per world, step and stage
+struct PreludeExpression
+{
+    int tokenOffset;     // Body, without its TOKEN_PRELUDE header
+    int tokenCount;
+    int constantOffset;
+    int used;            // 0 = unused slot
 };
 
 enum CollisionShape
@@ -85,6 +144,52 @@ enum CollisionShape
 };
 const int MAX_CONTACTS_PER_OBJECT = 4;
 
+// Time integration scheme of math.comp - MUST MATCH INTEGRATOR_* in math.comp
+enum IntegratorMethod
+{
+    INTEGRATOR_SYMPLECTIC_EULER = 0, // One equation evaluation per step, first order
+    INTEGRATOR_VELOCITY_VERLET = 1,  // Two evaluations, second order, symplectic
+    INTEGRATOR_YOSHIDA4 = 2,         // Four evaluations, fourth order, symplectic
+    INTEGRATOR_RK4 = 3               // Four evaluations, fourth order, not symplectic
+};
+
+// What happens at SimParams::worldMin / worldMax - MUST MATCH BOUNDARY_* in math.comp, collide.comp
+enum BoundaryMode
+{
+    BOUNDARY_REFLECT = 0,  // Walls bounce objects back with the global restitution
+    BOUNDARY_PERIODIC = 1, // Objects leaving one side come back at the other; pairs see minimum images
+    BOUNDARY_OPEN = 2      // No walls
+};
+
+// Simulation parameters every physics pass reads, uploaded as one std140 uniform block whenever
+// they change - MUST MATCH SimParams in math.comp, collide.comp and object_reduction.comp
+const int SIM_PARAMS_BINDING = 0;  // Uniform buffer binding point
+// Equation constants as a uniform block while they all fit - MUST MATCH EquationConstants in math.comp
+const int EQUATION_CONSTANTS_BINDING = 1;  // Uniform buffer binding point
+const int MAX_CONSTANT_BLOCK_VEC4S = 4096;  // 64 KB, less where GL_MAX_UNIFORM_BLOCK_SIZE is smaller
+struct SimParams
+{
+    float dt = 0.016f;                              // uDt, offset 0
+    float time = 0.0f;                              // uTime (first step of a dispatch)
+    float stiffness = 1.0f;                         // k
+    float damping = 0.1f;                           // b
+    float gravity = 9.81f;                          // g, offset 16
+    float restitution = 0.7f;                       // uRestitution
+    float coupling = 1.0f;                          // uCoupling
+    float driveFreq = 1.0f;                         // uDriveFreq
+    glm::vec2 gravityDir = glm::vec2(0.0f, -1.0f);  // uGravityDir, offset 32
+    glm::vec2 externalForce = glm::vec2(0.0f);      // uExternalForce, offset 40
+    float driveAmp = 0.0f;                          // uDriveAmp, offset 48
+    int equationMode = 0;                           // uEquationMode
+    int enableWarmStart = 0;                        // uEnableWarmStart
+    int maxContactIterations = 3;                   // uMaxContactIterations
+    glm::vec2 worldMin = glm::vec2(-1000000.0f);    // uWorldMin, offset 64
+    glm::vec2 worldMax = glm::vec2(1000000.0f);     // uWorldMax, offset 72
+    int boundaryMode = 0;                           // uBoundaryMode (BoundaryMode), offset 80
+    int _pad[3] = { 0, 0, 0 };
+};
+static_assert(sizeof(SimParams) == 96, "SimParams must be 96 bytes!");
+
 // Collision properties per object
 struct CollisionProperties
 {
@@ -93,61 +198,397 @@ struct CollisionProperties
     float restitution;     // Bounciness (0-1)
     float friction;        // Surface friction (0-1)
     float mass_factor;     // Mass multiplier for collision response
-    int _pad1, _pad2, _pad3;
+    unsigned int category; // Category bits this object belongs to
+    unsigned int mask;     // Categories this object collides with
+    int continuous;        // 1 = swept against its candidates over the step (fast bodies)
 };
 
-static_assert(sizeof(EquationMapping) == 112, "EquationMapping must be 112 bytes!");
+// Collision filtering defaults: every object sits in category 1 and collides with everything
+const unsigned int COLLISION_CATEGORY_DEFAULT = 0x00000001u;
+const unsigned int COLLISION_MASK_ALL = 0xFFFFFFFFu;
+
+static_assert(sizeof(EquationMapping) == 144, "EquationMapping must be 144 bytes!");
+static_assert(sizeof(PairSumExpression) == 32, "PairSumExpression must be 32 bytes!");
 
 namespace Objects
 {
-    static const int MAX_OBJECTS = 100000;
-    static const int MAX_EQUATIONS = 256;
+    static const int MAX_OBJECTS = 1 << 22;            // Hard ceiling; buffers grow towards it on demand
+    static const int INITIAL_OBJECT_CAPACITY = 1024;   // Objects every per-object buffer holds after Init
+    static const int MAX_EQUATIONS = 256;              // Equation slots (8 bits of the dispatch sort key)
+    static const int MAX_EQUATION_GROUPS = 256;        // Behaviour groups, equationID -2 - group
 
     // Core functions
     bool Init(void* glfwWindow = nullptr);
-    void Update(int inputIndex, int outputIndex);
+    // Runs up to `substeps` fixed steps in one dispatch; returns the steps simulated (0 if not ready)
+    int Update(int inputIndex, int outputIndex, int substeps = 1);
+    bool CanFuseSubsteps();
+    bool CanStepOnCpu();                     // The scene uses nothing cpu_backend.h leaves out
+    unsigned long long GetSceneRevision();   // Changes with every step and every host edit a step reads
     void Draw(int sourceIndex);
+    // Draw from a ring of `depth` fenced copies of the stepped state (frame K-1 while K is being
+    // computed); 0 or 1 draws the object buffers directly
+    void SetFramePipelineDepth(int depth);
+    int GetFramePipelineDepth();
+    // Draw one instanced quad per object (quad_instanced.vert, the default) or expand points in
+    // quad.geom; the geometry shader path is also used until the instanced program has linked
+    void SetInstancedRendering(bool enabled);
+    bool GetInstancedRendering();
+    // The instanced draw shows the state `fraction` of a step past the one before the newest,
+    // blended from the buffer the last Update read; 1 draws the newest state as it is
+    void SetInterpolationFraction(float fraction);
+    float GetInterpolationFraction();
+    // The instanced draw skips objects outside the world rectangle projView shows (object_culling.h);
+    // renderers pass their camera matrices before every Draw()
+    void SetViewBounds(const glm::mat4& projView);
+    void SetViewCulling(bool enabled);
+    bool GetViewCulling();
+    // Draw() splats every object as a point into a float target and tone-maps it with the object
+    // colours instead of drawing skins (density_splat.h); it uses the projView of SetViewBounds()
+    void SetDensityRendering(bool enabled);
+    bool GetDensityRendering();
+    void SetDensityExposure(float exposure);  // Objects per pixel at which brightness is ~63% up
+    float GetDensityExposure();
+    // Position trails of the first `objects` objects, `length` positions each, recorded after every
+    // Update (object_trails.h); 0 objects turns them off. DrawTrails() goes before Draw().
+    bool SetTrails(int objects, int length);
+    void GetTrails(int& objects, int& length);
+    void DrawTrails(const glm::mat4& projView, int sourceIndex);
+    // Every distance constraint as a line coloured by its strain, read straight from the constraint
+    // and object buffers (constraint_lines.h); goes before Draw() like the trails
+    void SetConstraintRendering(bool enabled);
+    bool GetConstraintRendering();
+    void SetConstraintStrainScale(float scale);  // |strain| drawn at full colour, > 0
+    float GetConstraintStrainScale();
+    void DrawConstraints(const glm::mat4& projView, int sourceIndex);
+    // Phase-space density of every object into the bound framebuffer (phase_space.h)
+    void DrawPhaseSpace(int sourceIndex, int width, int height);
+    // Arrows of an acceleration (ax, ay), resampled on the GPU at every draw (force_field.h).
+    // The expressions read like equations, as a probe at rest with unit mass and charge.
+    bool SetForceField(const std::string& axExpression, const std::string& ayExpression, std::string& error);
+    void ClearForceField();
+    bool SetForceFieldGrid(float xMin, float xMax, float yMin, float yMax, int columns, int rows, float arrowScale);
+    void DrawForceField(const glm::mat4& projView, int sourceIndex);
     void Cleanup();
 
-    // Equation management
+    // Equation management. The serialized forms are only read for keys not registered yet (see
+    // HasEquation); keys whose serialized programs are identical share one equation ID.
     void SetEquation(const std::string &equationString, const ParsedEquation &eq, int objectIndex);
+    void SetEquation(const std::string &equationString, const ParsedEquation &eq, const std::vector<int> &objectIndices);
+    void SetEquation(const std::string &equationString, const GPUSerializedEquation &eq, int objectIndex);
+    void SetEquation(const std::string &equationString, const GPUSerializedEquation &eq, const std::vector<int> &objectIndices);
+    // Equations are reference counted by the host objects running them; one no object runs is
+    // freed (slot and storage) at the next registration, so assign a returned ID before registering more
     int AddOrGetEquation(const std::string &equationString, const ParsedEquation &eq);
+    int AddOrGetEquation(const std::string &equationString, const GPUSerializedEquation &eq);
+    bool HasEquation(const std::string &equationString);
+    // Many at once, uploaded with one write per buffer; IDs in input order
+    std::vector<int> AddOrGetEquations(const std::vector<std::string> &equationStrings,
+                                       const std::vector<GPUSerializedEquation> &equations);
+    // objectIndices[k] runs equations[objectEquations[k]]
+    void SetEquations(const std::vector<std::string> &equationStrings, const std::vector<GPUSerializedEquation> &equations,
+                      const std::vector<int> &objectIndices, const std::vector<int> &objectEquations);
+    std::vector<std::string> GetEquationKeys();  // Registration key per equation ID, empty = free slot
+    // Behaviour groups: a member holds EquationGroupID(group) as its equationID and runs whatever
+    // equation the group is set to, looked up in a table of MAX_EQUATION_GROUPS IDs on the GPU, so
+    // switching the equation of a group is one 4-byte write whatever its size. SetEquation() on a
+    // member takes it out of its group. False for a group out of range
+    inline int EquationGroupID(int group) { return -2 - group; }
+    bool SetEquationGroup(int group, const std::vector<int> &objectIndices);
+    bool SetGroupEquation(const std::string &equationString, const GPUSerializedEquation &eq, int group);
+    bool ClearGroupEquation(int group);  // Members fall back to default physics
+    int GetGroupEquation(int group);     // -1 = none
+    int ResolveEquationID(int equationID);  // The group's equation for a group member's ID, else equationID
+    // Colour evaluation rate (EquationMapping::colorInterval) of the equation an object runs, and
+    // so of every object sharing it; false if the object has no equation or interval < 0
+    bool SetEquationColorInterval(int objectIndex, int interval);
+    int GetEquationColorInterval(int objectIndex);  // -1 if the object has no equation
+    // Rate group (EquationMapping::stepInterval) of the equation an object runs, and so of every
+    // object sharing it; false if the object has no equation or interval < 1
+    bool SetEquationStepInterval(int objectIndex, int interval);
+    int GetEquationStepInterval(int objectIndex);  // -1 if the object has no equation
+    // Steps the caller will run before the state is next shown or read, counted from the next
+    // Update() (colorInterval 0 evaluates on the last of them); 0 = unknown, every step counts
+    void SetFrameStepsLeft(int steps);
 
     // Data management
     void FetchToCPU(int sourceIndex, std::vector<Object> &out);
+    int FetchToCPU(int sourceIndex, Object *out);  // GetNumObjects() objects into out; returns the count
+    void FetchToCPU(int sourceIndex, int first, int count, std::vector<Object> &out);  // Objects [first, first + count)
+    // Nearest object whose pick radius covers worldPos, -1 if none; a GPU pass (object_pick.h)
+    // that reads back one index, or a whole fetch while the shader is still loading
+    int PickObject(int sourceIndex, const glm::vec2 &worldPos);
+    // Objects whose centre lies inside each circle or rectangle (object_query.h), one ascending
+    // list per shape; a GPU pass over a neighbour grid, or a whole fetch while the shader is still loading
+    void QueryObjects(int sourceIndex, ObjectQuery::QueryShape shape, const std::vector<glm::vec4> &shapes,
+                      std::vector<std::vector<int>> &results);
+    // First collision shape along each (origin x, origin y, dir x, dir y) ray within maxDistance
+    // (object_raycast.h); a GPU pass over a collision LBVH, or a whole fetch while the shader is still loading
+    void RaycastObjects(int sourceIndex, const std::vector<glm::vec4> &rays, float maxDistance, std::vector<RayHit> &hits);
+    // Selected fields (ObjectField mask) of the listed objects, packed per index in bit order;
+    // false if an index is out of range
+    bool FetchFields(int sourceIndex, const std::vector<int> &indices, unsigned int fieldMask, std::vector<float> &out);
+    bool ReduceObjects(int sourceIndex, const std::string &expression, ReductionOp op, float &result, std::string &error);
+    // One value per ensemble world (one for the whole scene without worlds); p[i] is world-local
+    bool ReduceWorlds(int sourceIndex, const std::string &expression, ReductionOp op, std::vector<float> &results, std::string &error);
+    // Objects per bin of expressionX (1D) or of (expressionX, expressionY) when binsY > 1, over
+    // range (x min, x max, y min, y max); see ObjectReduction::Histogram
+    bool HistogramObjects(int sourceIndex, const std::string &expressionX, const std::string &expressionY,
+                          int binsX, int binsY, const float range[4], std::vector<uint32_t> &counts, std::string &error);
+    // expression at numPoints probe points given column by column (expression_eval.h), one
+    // value each into results; p[i] reads the objects of buffer sourceIndex
+    bool EvaluateExpression(int sourceIndex, const std::string &expression, const EvalInput inputs[EVAL_COLUMN_COUNT],
+                            size_t numPoints, float *results, std::string &error);
+    // Host writes are queued, one record per object, and applied by a single scatter pass at the
+    // next Update() or read; later writes to the same object merge into its record
     void UpdateObjectCPU(int index, const Object &newData);
+    void UpdateObjectFields(int index, unsigned int fieldMask, const Object &values);  // ObjectField bits of values
+    void FlushObjectWrites();
     void UploadCpuDataToGpu();
+    // Object buffer sourceIndex, GetObjectCapacity() records, for access outside GL (CUDA interop);
+    // MarkObjectsWritten() after such an access so readback copies and mirrors stop trusting theirs
+    GLuint GetObjectBuffer(int sourceIndex);
+    void MarkObjectsWritten();
 
     void UploadBulkObjects(const std::vector<Object> &objects, int startIndex = 0);
-    const Object *GetObjectDataDirect(int sourceIndex);
-    Object *GetObjectDataDirectMutable(int sourceIndex);
+    int AddObjects(const std::vector<Object> &objects);  // Appends them; returns the first index, -1 on failure
+    // Append count copies of templateObject placed by a GPU pass (object_spawn.h), running its
+    // equationID; returns the first index, -1 with error set on failure
+    int SpawnObjects(int count, const Object &templateObject, const SpawnSettings &settings, std::string &error);
+    const Object *GetObjectDataDirect(int sourceIndex);  // Newest finished readback copy, valid for two more copies (steps or repeated reads)
+
+    // Non-blocking readback: BeginReadback queues a copy of the live objects behind a fence and
+    // returns its handle (-1 on failure); ResolveReadback returns false while the copy is in
+    // flight unless wait is set, and frees the handle once it has delivered the objects
+    int BeginReadback(int sourceIndex);
+    bool IsReadbackReady(int handle);
+    bool ResolveReadback(int handle, std::vector<Object> &out, bool wait);
+    void ReleaseReadback(int handle);
+
+    // Trajectory recording on the GPU (object_recorder.h): every everyNSteps steps Update()
+    // appends the fieldMask fields of the listed objects to a ring of capacity frames
+    bool StartRecording(const std::vector<int> &indices, unsigned int fieldMask, int everyNSteps, int capacity,
+                        const GatherQuantization &quantization = GatherQuantization());
+    void StopRecording();
+    bool IsRecording();
+    bool DownloadRecording(RecordedFrames &out, int newest = 0);  // Frames since the last download, in one transfer
+    int GetPendingRecordedFrames();
+    // Bytes of object state copied toward the host since startup: whole-state copies (readback
+    // ring, direct reads, non-blocking readbacks), gathered fields and recording downloads
+    uint64_t GetReadbackBytes();
+
+    // Delta checkpoints (object_checkpoint.h): SetCheckpointBase keeps a GPU copy of the objects,
+    // TakeCheckpointDelta returns the objects changed since then and moves the copy forward
+    bool SetCheckpointBase(int sourceIndex);
+    bool TakeCheckpointDelta(int sourceIndex, std::vector<int> &indices, std::vector<Object> &objects);
+
+    // Scene cache (scene_cache.h): CacheObjects keeps a GPU copy of the objects under a name,
+    // AddCachedObjects appends them again by a copy in VRAM (first index, -1 on failure). The
+    // rows keep their equation IDs of when they were cached until SetEquation reassigns them.
+    bool CacheObjects(const std::string &name, int sourceIndex);
+    int AddCachedObjects(const std::string &name);
+
+    // Rollback history (object_history.h) of the host objects: capacity 0 turns it off;
+    // RewindHistory(back) copies the snapshot back steps older than the newest into both
+    // object buffers and drops the newer ones; false when it is not held or the object
+    // count has changed since
+    void SetHistoryCapacity(int capacity);
+    void ClearHistory();
+    bool PushHistory(int sourceIndex, double time);
+    int GetHistoryCount();
+    double GetHistoryTime(int back);
+    bool RewindHistory(int back);
+    Object *GetObjectDataDirectMutable(int sourceIndex); // Always nullptr, the object buffers are GPU-only
 
     // Constraint management 
     void CompactConstraintArray();
     void AddConstraint(int objectIndex, const Constraint &constraint);
+    void AddConstraints(const std::vector<std::pair<int, Constraint>> &constraints);  // (owner, constraint), one upload
     void RemoveConstraint(int objectIndex, int constraintLocalIndex);
     void UpdateConstraint(int objectIndex, int constraintLocalIndex, const Constraint &newConstraint);
     void ClearConstraints(int objectIndex);
     void ClearAllConstraints();
     std::vector<Constraint> GetConstraints(int objectIndex);
+    std::vector<std::pair<int, Constraint>> GetAllConstraints();  // (owner, constraint), in AddConstraints form
+
+    // Per-object equation parameters $0..$7 (object_params.h); count values from $first on
+    void SetObjectParameters(int objectIndex, const float *values, int count, int first = 0);
+    void GetObjectParameters(int objectIndex, float *out);  // OBJECT_PARAM_COUNT values
+
+    // Static colliders (static_colliders.h): never integrated, collided with as immovable
+    void SetObjectStatic(int objectIndex, bool isStatic);
+    bool IsObjectStatic(int objectIndex);
+    int GetStaticObjectCount();
+
+    // Kinematic objects (kinematic_paths.h): moved along table() slots tableX/tableY (-1 = that
+    // coordinate holds) at the simulation time, wrapped by period when > 0; no longer static
+    void SetObjectKinematic(int objectIndex, int tableX, int tableY, float period = 0.0f);
+    // The same from keyframes, resampled into tableX and tableY; a loop repeats every times.back()
+    bool SetObjectKeyframes(int objectIndex, int tableX, int tableY, const std::vector<float> &times,
+                            const std::vector<float> &xs, const std::vector<float> &ys, bool loop);
+    void ClearObjectKinematic(int objectIndex);  // Back to its equation
+    bool IsObjectKinematic(int objectIndex);
+    int GetKinematicObjectCount();
+
+    // SDF colliders (sdf_colliders.h): a static environment given by its signed distance, an
+    // expression of x, y (and t) and/or a grid of columns x rows samples from the bottom row
+    // over [xMin, xMax] x [yMin, yMax]; collidable objects are pushed out along its gradient
+    bool SetSdfCollider(const std::string &expression, std::string &error);
+    void ClearSdfCollider();
+    bool SetSdfGrid(const std::vector<float> &distances, int columns, int rows,
+                    float xMin, float xMax, float yMin, float yMax);
+    void ClearSdfGrid();
+    void SetSdfSurface(float restitution, float friction);  // Combined as two objects' would be
+
+    // Streaming mode (object_streaming.h): advance the particles, held in host memory, by steps
+    // steps in chunks of chunkObjects, each chunk uploaded into the empty scene's object buffers,
+    // stepped in one fused dispatch and read back while the next ones are packed and stepped.
+    // Every chunk starts from the same clock; rand() draws differ per chunk. false with error
+    // set if the scene holds objects or anything would couple the chunks.
+    bool StepStreamed(const StreamedParticles &particles, int steps, int chunkObjects, std::string &error);
+
+    // Group aggregates (object_aggregates.h): a named group replaces its members; an aggregate
+    // reduces expression over a group ("" = every object) once per step, read as agg[name]
+    bool SetObjectGroup(const std::string &name, const std::vector<int> &objectIndices);
+    std::vector<int> GetObjectGroup(const std::string &name);
+    bool SetAggregate(const std::string &name, const std::string &expression, ReductionOp op,
+                      const std::string &group, std::string &error);
+    void RemoveAggregate(const std::string &name);
+    bool GetAggregate(const std::string &name, float &value);  // Value of the last step; false if never set
+
+    // State registers s0..s7 (state_registers.h); count values from s<first> on
+    void SetStateRegisters(int objectIndex, const float *values, int count, int first = 0);
+    void GetStateRegisters(int objectIndex, float *out);  // STATE_REGISTER_COUNT values
+
+    // Forward parameter sensitivities (object_sensitivity.h), by variable hash; at most
+    // MAX_SENSITIVITY_PARAMETERS, an empty list stops them. Either way every tangent restarts at 0.
+    void SetSensitivityParameters(const std::vector<int> &varHashes);
+    void ResetSensitivities();
+    void GetSensitivities(std::vector<float> &out);  // (dx, dy, dvx, dvy) per parameter, object-major
+
+    // Stable object handles, the i of p[i] (object_handles.h); -1 = no such object
+    int GetObjectHandle(int objectIndex);
+    int FindObjectByHandle(int handle);
+    void GetObjectHandles(std::vector<int>& handles);   // One per host object
+    bool RestoreObjectHandles(const std::vector<int>& handles);
+
+    // Ensemble worlds (object_worlds.h): the objects must already carry their worldID.
+    // Removing objects ends the ensemble, since the world ranges move with them.
+    bool SetObjectWorlds(const std::vector<ObjectWorlds::WorldRange> &worlds);
+    bool SetObjectWorldParameters(const std::vector<ObjectWorlds::WorldParameters> &parameters);  // One row per world
+    int GetNumObjectWorlds();
+    // Fork (object_fork.h): replicate the host objects into worlds ensemble worlds on the GPU,
+    // with their collision properties, parameters, constraints, equations and state registers;
+    // EndFork drops the copies and puts the objects back as the fork found them. False while
+    // forked, with ensemble worlds or spawned objects, or with a spring network.
+    bool ForkWorlds(int sourceIndex, int worlds);
+    bool EndFork();
+    bool IsForked();
+    bool EquationsUseLongRange();  // Barnes-Hut forces span every object, worlds or not
 
     void SetCollisionEnabled(int objectIndex, bool enabled);
     void SetCollisionShape(int objectIndex, CollisionShape shape);
     void SetCollisionProperties(int objectIndex, float restitution, float friction);
     CollisionProperties GetCollisionProperties(int objectIndex);
+    // Objects [first, first + properties.size()) as they are, uploaded as one range (snapshots)
+    void SetCollisionProperties(int first, const std::vector<CollisionProperties> &properties);
     void EnableCollisionBetween(int obj1, int obj2, bool enable);
+    void SetCollisionFilter(int objectIndex, unsigned int category, unsigned int mask);
+    void SetContinuousCollision(int objectIndex, bool enabled);
+    // The same settings for many objects, uploaded as one range
+    void SetCollisionEnabled(const std::vector<int> &objectIndices, bool enabled);
+    void SetCollisionShape(const std::vector<int> &objectIndices, CollisionShape shape);
+    void SetCollisionProperties(const std::vector<int> &objectIndices, float restitution, float friction);
+    void SetCollisionFilter(const std::vector<int> &objectIndices, unsigned int category, unsigned int mask);
+    void SetContinuousCollision(const std::vector<int> &objectIndices, bool enabled);
     bool IsCollisionEnabled(int objectIndex);
     void SetCollisionParameters(bool enableWarmStart, int maxContactIterations);
     void GetCollisionParameters(bool& enableWarmStart, int& maxContactIterations);
+    int GetContactCount();  // Reads the count back from the GPU
+    void SetBroadphaseMode(BroadphaseMode mode);
+    BroadphaseMode GetBroadphaseMode();
+    // One narrowphase dispatch per collision shape in scenes that mix shapes (on by default)
+    void SetNarrowphaseBuckets(bool enabled);
+    bool GetNarrowphaseBuckets();
+    // Verlet skin: the grid/LBVH and per-object candidate lists are built with this margin and
+    // reused until an object has moved more than half of it (0 = rebuild every step, the default)
+    void SetNeighbourSkin(float skin);
+    float GetNeighbourSkin();
+    // Ensemble worlds of at most this many objects (64 by default) collide by walking their own
+    // contiguous range; the broadphase is built only when some world is larger
+    void SetSmallWorldObjects(int objects);
+    int GetSmallWorldObjects();
+    int GetBroadphaseRebuilds();  // Skin-checked rebuilds so far; waits for the GPU
+    void SetEquationCompileMode(bool enabled);
+    bool GetEquationCompileMode();
+    void SetRegisterBytecodeEnabled(bool enabled);
+    bool GetRegisterBytecodeEnabled();
+    void SetFastMath(bool enabled, int scanInterval, bool rollback);
+    void GetFastMath(bool& enabled, int& scanInterval, bool& rollback);
+    int GetInvalidObjects(std::vector<int>& indices);  // Invalid objects the last fast-math scan found
+    int GetNanRollbackCount();
+    void SetIntegrator(IntegratorMethod method);
+    IntegratorMethod GetIntegrator();
+    void SetAdaptiveTimestep(bool enabled, float minDt, float maxDt, float courant, float startDt, float startTime);
+    void GetAdaptiveTimestep(bool& enabled, float& minDt, float& maxDt, float& courant);
+    bool IsAdaptiveTimestepActive();
+    void GetAdaptiveTimestepState(float& dt, float& time);  // Lags the GPU by a few steps
+    std::vector<float> GetTimestepHistory();
+    void SetDispatchReorderInterval(int steps);
+    int GetDispatchReorderInterval();
+    void SetStorageReorderInterval(int steps);  // Indices change like after RemoveObjects; handles do not
+    int GetStorageReorderInterval();
+    void StartWorkgroupTuning(bool force);  // Times the running scene; sizes already stored are kept unless force
+    bool IsWorkgroupTuning();
+    void GetWorkgroupSizes(int& integrate, int& constraints, int& collide);
+    void SetLongRangeParameters(float theta, float gravityConstant, float coulombConstant, float softening);
+    void GetLongRangeParameters(float& theta, float& gravityConstant, float& coulombConstant, float& softening);
+    bool SetLongRangeMethod(LongRangeMethod method, int meshSize, const glm::vec4& periodicBox);
+    void GetLongRangeMethod(LongRangeMethod& method, int& meshSize, glm::vec4& periodicBox);
+    void SetFluidParameters(const SphParameters& params);
+    SphParameters GetFluidParameters();
+    void SetStructOfArraysStorage(bool enabled, bool quantized = false);  // quantized: object_streams.h
+    bool GetStructOfArraysStorage();
+    bool GetStructOfArraysQuantized();
+    void SetSleepParameters(bool enabled, float velocityThreshold, float accelerationThreshold, int steps);
+    void GetSleepParameters(bool& enabled, float& velocityThreshold, float& accelerationThreshold, int& steps);
+    int GetAwakeObjectCount();  // Reads the count back from the GPU
+    void WakeAllObjects();
+    void FreezeObjects(int first, int count);  // Asleep until WakeAllObjects(); needs sleep enabled to save work
+    void SetConstraintSolver(bool xpbd, int iterations, float compliance);
+    void GetConstraintSolver(bool& xpbd, int& iterations, float& compliance);
+    void GetConstraintGraph(int& edges, int& colors);  // Of the last XPBD graph, 0 before the first solve
+    void SetSprings(const std::vector<int>& endpoints, const std::vector<float>& stiffness,
+                    const std::vector<float>& damping, const std::vector<float>& restLength);
+    void ClearSprings();
+    int GetSpringCount();
+    void SetSpringIntegration(bool implicit, int iterations, float tolerance);
+    void GetSpringIntegration(bool& implicit, int& iterations, float& tolerance);
+    int AddParticleEmitter(int templateIndex, float rate, float offsetX, float offsetY, float velocityX, float velocityY,
+                           float positionSpread, float velocitySpread, float lifetime, int killFlags,
+                           float boundsMinX, float boundsMinY, float boundsMaxX, float boundsMaxY);  // -1 when full
+    bool RemoveParticleEmitter(int emitterID);
+    void ClearParticleEmitters();
+    int GetParticleEmitterCount();
 
     // Object management
     void AddObject();
     void RemoveObject(int index = -1);
-    void ResetToInitialConditions();
+    void RemoveObjects(const std::vector<int>& indices);  // Swap-removes all of them in one pass
+    void ResetToInitialConditions();  // Back to the state captured by the first step after an add or remove
 
     // System parameters
     void SetDefaultObjectType(int type);
     void SetSystemParameters(float gravity, float damping, float stiffness);
+    void SetSimParams(const SimParams& params);  // Uploaded before the next step if anything changed
+    SimParams GetSimParams();
+    // What the world does at its bounds; false (nothing changes) unless max > min on both
+    // axes. A periodic box wraps positions and pairs see each other's nearest image.
+    bool SetWorldBounds(BoundaryMode mode, const glm::vec2& worldMin, const glm::vec2& worldMax);
+    void GetWorldBounds(BoundaryMode& mode, glm::vec2& worldMin, glm::vec2& worldMax);
+    // Key of the rand()/randn() draws; with the step counter and object index it fixes every
+    // value, so a reset replays the same noise. 0 by default.
+    void SetRandomSeed(uint32_t seed);
+    uint32_t GetRandomSeed();
 
     // Async shader loading
     void UpdateShaderLoadingStatus();
@@ -161,6 +602,21 @@ namespace Objects
     GLuint GetQuadProgram();
     GLuint GetComputeProgram();
     int GetNumObjects();
+    int GetObjectCapacity();
+
+    // One buffer or host structure of the simulation, in bytes. Per-object buffers count the live
+    // objects' share of their capacity as used; buffers without a host count use all of it.
+    struct MemoryEntry
+    {
+        std::string name;
+        bool gpu;
+        size_t capacityBytes;
+        size_t usedBytes;
+    };
+    // Buffers and host structures this module owns; those of other modules are not listed
+    void GetMemoryReport(std::vector<MemoryEntry>& entries);
+    // Grows every per-object buffer (doubling) to hold at least count objects; contents are kept
+    bool ReserveObjects(int count);
 }
 
 #endif // OBJECTS_H
\ No newline at end of file
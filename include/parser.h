@@ -1,9 +1,22 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 
+// ============================================================================
+// SYMBOLS
+// ============================================================================
+// Variable, object type and property names are interned once and tokens carry
+// their id, so tokens stay small and names compare as integers. Ids are stable
+// for the lifetime of the process; the table only grows.
+enum SymbolId : int { NO_SYMBOL = -1 };
+
+SymbolId internSymbol(std::string_view name);           // Id of name, added if new
+SymbolId findSymbol(std::string_view name);             // NO_SYMBOL if name was never interned
+const std::string& symbolName(SymbolId id);              // Empty for NO_SYMBOL
+
 // ============================================================================
 // TOKEN TYPES
 // ============================================================================
@@ -41,15 +54,85 @@ enum TokenType {
     TOKEN_OPEN_PAREN,
     TOKEN_CLOSE_PAREN,
     TOKEN_COMMA,
-    TOKEN_DERIVATIVE
+    TOKEN_DERIVATIVE,
+    TOKEN_PAIR_REF,     // pj.property inside sum_j(), nsum() and nmean()
+    TOKEN_PAIR_SUM,     // sum_j(expr) / nsum / ncount / nmean: reduction over other objects j
+    TOKEN_TEMP_STORE,   // Emitted by OptimizeEquation(): keep the top value in a temporary
+    TOKEN_TEMP_LOAD,    // Emitted by OptimizeEquation(): push a stored temporary
+    TOKEN_TABLE,        // table(id, x): interpolated 1D lookup table (lookup_tables.h)
+    TOKEN_FIELD,        // field(id, x, y): bilinear 2D lookup field
+    TOKEN_IF,           // if(cond, a, b): a where cond > 0, else b; only the taken branch is evaluated
+    TOKEN_LEN2,         // Emitted by OptimizeEquation() on real operands: a*a + b*b
+    TOKEN_DOT2,         // Emitted by OptimizeEquation(): ax*bx + ay*by
+    TOKEN_HYPOT,        // Emitted by OptimizeEquation(): sqrt(a*a + b*b)
+    TOKEN_INVCUBE,      // Emitted by OptimizeEquation(): (a*a + b*b)^-1.5, 0 where that is 0
+    TOKEN_RSQRT,        // Emitted by OptimizeEquation(): 1/sqrt(x) of x >= 0, 0 where x is 0
+    TOKEN_HOIST,        // Emitted by OptimizeEquation(): the value before it is the same for every object; prelude slot temp_slot
+    
+    // Statement form only; replaced by scalar tokens before ParseEquation() returns
+    TOKEN_BINDING,      // let name (variable), or one component of it (object_index 0 = .x, 1 = .y)
+    TOKEN_VEC2,         // vec2(x, y)
+    TOKEN_LEN,          // len(v)
+    TOKEN_DOT           // dot(u, v)
 };
 
 // ============================================================================
 // DERIVATIVE METHODS
 // ============================================================================
 enum DerivativeMethod {
-    DERIV_METHOD_NUMERICAL = 0,
-    DERIV_METHOD_SYMBOLIC = 1
+    DERIV_METHOD_NUMERICAL = 0,     // Central difference on the GPU (first order only)
+    DERIV_METHOD_SYMBOLIC = 1,      // Expanded into an ordinary expression on the CPU
+    DERIV_METHOD_DUAL = 2           // One dual-number walk of the body on the GPU
+};
+
+// ============================================================================
+// RANDOM NUMBERS
+// ============================================================================
+// Each rand() / randn() call of an equation reads the variable "rand#k" / "randn#k", k
+// numbering the calls in order over all of its components, so two calls draw independently
+// while a let binding read twice is one draw. math.comp keys a counter-based generator on
+// the object, the step and k.
+const int MAX_RANDOM_SITES = 8;
+
+// ============================================================================
+// STATE REGISTERS
+// ============================================================================
+// s0..s7 read the object's state registers (state_registers.h) and "sK = expr" statements update
+// them once per step, after integration. Every update of a step reads the values from before
+// it, whatever order the statements come in. MUST MATCH STATE_REGISTER_COUNT in state_registers.h.
+const int MAX_STATE_REGISTERS = 8;
+
+// ============================================================================
+// GROUP AGGREGATES
+// ============================================================================
+// agg[name] reads an aggregate of a group of objects (object_aggregates.h) computed once per
+// step before the equations run; it reads the variable "agg[k]", k the slot the name was given
+// the first time it was seen. Like symbols, names keep their slot for the lifetime of the process.
+// MUST MATCH MAX_GROUP_AGGREGATES in object_aggregates.h.
+const int MAX_AGGREGATE_NAMES = 16;
+
+int aggregateSlot(std::string_view name);   // Slot of name, assigned if new; -1 once every slot is taken
+int findAggregateSlot(std::string_view name);  // -1 if name was never seen
+
+// ============================================================================
+// PIPELINE FIELDS
+// ============================================================================
+// fld[name] reads a per-object field the passes of the object pipeline (object_pipeline.h)
+// computed this step before the equations ran, and pj.fld[name] the field of the neighbour in
+// an nsum() body; they read the variable / pair property "fld[k]", slots assigned like agg[].
+// MUST MATCH PIPELINE_FIELD_COUNT in object_pipeline.h.
+const int MAX_PIPELINE_FIELDS = 8;
+
+int pipelineFieldSlot(std::string_view name);     // Slot of name, assigned if new; -1 once every slot is taken
+int findPipelineFieldSlot(std::string_view name);  // -1 if name was never seen
+
+// ============================================================================
+// PAIR REDUCTIONS
+// ============================================================================
+enum PairReduction {
+    PAIR_REDUCE_SUM = 0,    // sum_j(expr), nsum(radius, expr)
+    PAIR_REDUCE_COUNT = 1,  // ncount(radius)
+    PAIR_REDUCE_MEAN = 2    // nmean(radius, expr)
 };
 
 // ============================================================================
@@ -62,19 +145,27 @@ struct Token {
     float numeric_value = 0.0f;
     
     // For TOKEN_VARIABLE
-    std::string variable_name;
+    SymbolId variable = NO_SYMBOL;
     
     // For TOKEN_OBJECT_REF (e.g., p[0].x)
-    std::string object_type;
+    SymbolId object_type = NO_SYMBOL;
     int object_index = -1;
-    std::string object_property;
+    SymbolId object_property = NO_SYMBOL;
     
     // For TOKEN_DERIVATIVE
-    std::string derivative_wrt;
+    SymbolId derivative_wrt = NO_SYMBOL;
     int derivative_order = 1;
     DerivativeMethod derivative_method = DERIV_METHOD_NUMERICAL;
     std::vector<Token> derivative_expr_tokens;  // ADDED: Expression to differentiate
     
+    // For TOKEN_PAIR_SUM (TOKEN_PAIR_REF keeps its property in object_property)
+    std::vector<Token> pair_expr_tokens;        // Per-pair expression in RPN (empty for ncount)
+    PairReduction pair_reduction = PAIR_REDUCE_SUM;
+    float pair_radius = 0.0f;                   // Neighbour radius, 0 = every other object
+    
+    // For TOKEN_TEMP_STORE / TOKEN_TEMP_LOAD / TOKEN_HOIST
+    int temp_slot = -1;
+    
     // Constructors
     Token() : type(TOKEN_NUMBER), numeric_value(0.0f) {}
     
@@ -82,8 +173,8 @@ struct Token {
     
     Token(TokenType t, float value) : type(t), numeric_value(value) {}
     
-    Token(TokenType t, const std::string& var) 
-        : type(t), numeric_value(0.0f), variable_name(var) {}
+    Token(TokenType t, SymbolId var) 
+        : type(t), numeric_value(0.0f), variable(var) {}
 };
 
 // ============================================================================
@@ -101,11 +192,11 @@ public:
     };
     
     struct VariableDef {
-        std::string name;
+        SymbolId name;
         VariableDomain domain;
         bool differentiable;
         
-        VariableDef(const std::string& n = "", 
+        VariableDef(SymbolId n = NO_SYMBOL, 
                    VariableDomain d = DOMAIN_SCALAR, 
                    bool diff = true)
             : name(n), domain(d), differentiable(diff) {}
@@ -120,13 +211,27 @@ public:
     void registerObjectType(const std::string& type, 
                            const std::vector<std::string>& properties);
     
-    bool isValidVariable(const std::string& name) const;
-    bool isValidDerivativeWRT(const std::string& varName) const;
-    VariableDomain getVariableDomain(const std::string& varName) const;
+    bool isValidVariable(SymbolId name) const;
+    bool isValidDerivativeWRT(SymbolId varName) const;
+    bool isValidObjectProperty(SymbolId type, SymbolId property) const;
+    VariableDomain getVariableDomain(SymbolId varName) const;
+    
+    // Method of the D() calls parsed with this context
+    void setDerivativeMethod(DerivativeMethod method) { m_derivativeMethod = method; }
+    DerivativeMethod getDerivativeMethod() const { return m_derivativeMethod; }
+    
+    // Statement form: vec2 values (pos, vel, p[i].pos, vec2(), len(), dot()) and let names
+    void setVectorsEnabled(bool enabled) { m_vectorsEnabled = enabled; }
+    bool vectorsEnabled() const { return m_vectorsEnabled; }
+    void registerBinding(SymbolId name);
+    bool isBinding(SymbolId name) const;
     
 private:
-    std::unordered_map<std::string, VariableDef> m_variables;
-    std::unordered_map<std::string, std::vector<std::string>> m_objectTypes;
+    std::unordered_map<SymbolId, VariableDef> m_variables;
+    std::unordered_map<SymbolId, std::vector<SymbolId>> m_objectTypes;
+    std::vector<SymbolId> m_bindings;
+    DerivativeMethod m_derivativeMethod = DERIV_METHOD_SYMBOLIC;
+    bool m_vectorsEnabled = false;
 };
 
 // ============================================================================
@@ -140,6 +245,7 @@ struct ParsedEquation {
     std::vector<Token> tokens_g;         // NEW: Green color component in RPN
     std::vector<Token> tokens_b;         // NEW: Blue color component in RPN
     std::vector<Token> tokens_a;         // NEW: Alpha color component in RPN
+    std::vector<Token> tokens_state[MAX_STATE_REGISTERS];  // "sK = expr" updates, empty = kept
     std::vector<float> constants;        // Numeric constants from all components
     
     // Helper methods to check what's present
@@ -148,6 +254,11 @@ struct ParsedEquation {
         return !tokens_r.empty() || !tokens_g.empty() || 
                !tokens_b.empty() || !tokens_a.empty(); 
     }
+    bool hasStateUpdates() const {
+        for (const auto& tokens : tokens_state)
+            if (!tokens.empty()) return true;
+        return false;
+    }
     
     ParsedEquation() = default;
 };
@@ -158,15 +269,25 @@ struct ParsedEquation {
 
 // Parse derivative call: D(expr, var, order)
 std::vector<Token> parseDerivativeCall(
-    const std::string& expression, 
+    std::string_view expression, 
     size_t start_pos, 
     size_t& end_pos, 
     const ParserContext& context
 );
 
+// Parse pair reduction call: sum_j(expr), nsum(radius, expr), ncount(radius) or
+// nmean(radius, expr), with start_pos on the opening parenthesis
+Token parsePairSumCall(
+    std::string_view expression,
+    size_t start_pos,
+    size_t& end_pos,
+    const ParserContext& context,
+    const std::string& function = "sum_j"
+);
+
 // Tokenize expression string
 std::vector<Token> tokenizeExpression(
-    const std::string& expression, 
+    std::string_view expression, 
     const ParserContext& context
 );
 
@@ -177,7 +298,25 @@ std::vector<Token> infixToRPN(
 
 // Main entry point - now supports extended format:
 // "ax, ay, angular_accel, r, g, b, a"
+// or statements separated by ';' or newlines, with let bindings and vec2 values:
+// "let d = p[1].pos - pos; a = G*d/len(d)^3; color.r = len(vel)"
+// Targets are a (vec2: ax, ay), ax, ay, angular, color.r, color.g, color.b, color.a and the
+// state registers s0..s7; bindings are substituted where used, and shared terms become
+// temporaries as usual.
 ParsedEquation ParseEquation(
     const std::string& equation_string, 
     const ParserContext& context
+);
+
+// The passes ParseEquation() runs on the components once they are RPN: pair references
+// checked, symbolic D() expanded, the optimizer, and the constants collected. For equations
+// assembled as RPN without text (the Python expression builder).
+void FinalizeEquation(ParsedEquation& equation);
+
+// "expr, expr, ..." as RPN, one entry per comma separated expression (empty for an empty
+// one), rand()/randn() numbered over all of them as in one equation. Only the parse: no D()
+// expansion or optimizer, for one-off passes whose t is not the step time (object_spawn.h).
+std::vector<std::vector<Token>> ParseExpressionList(
+    const std::string& text,
+    const ParserContext& context
 );
\ No newline at end of file
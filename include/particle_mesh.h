@@ -0,0 +1,42 @@
+#ifndef PARTICLE_MESH_H
+#define PARTICLE_MESH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+
+const int PARTICLE_MESH_MAX_FFT_SIZE = 1024;  // MUST MATCH MAX_FFT_SIZE in particle_mesh.comp
+
+// Particle-mesh long-range forces: mass and charge are deposited cloud-in-cell onto a
+// square mesh, the softened 1/r potential of both is solved by one complex FFT
+// convolution, and the potential gradient is interpolated back with the same weights.
+// The cost is O(N + M^2 log M) for an M x M mesh, independent of how the objects cluster,
+// and forces are smooth below one cell. A bounded mesh is refitted to the objects every
+// step and zero-padded so there are no image forces; a periodic mesh covers a fixed box
+// whose edges wrap, with the nearest image of each source.
+namespace ParticleMesh
+{
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // Evaluate every object's (grav_ax, grav_ay, coul_ax, coul_ay) into accelSSBO with the
+    // same constants and softening as the tree; false if the solver shader is not ready
+    bool Compute(GLuint objectSSBO, GLuint accelSSBO, int numObjects,
+                 float gravityConstant, float coulombConstant, float softening);
+
+    // Mesh cells per side, a power of two from 16 up to 512 (bounded) or 1024 (periodic).
+    // periodicBox is (min x, min y, width, height); a zero size selects a bounded mesh.
+    // false, leaving the settings, for a size or box the solver cannot use.
+    bool SetMesh(int meshSize, const glm::vec4& periodicBox);
+    int GetMeshSize();
+    glm::vec4 GetPeriodicBox();
+    bool IsPeriodic();
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // PARTICLE_MESH_H
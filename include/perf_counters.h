@@ -0,0 +1,57 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+
+// Work counters of the simulation passes. While enabled, math.comp, constraints.comp and
+// collide.comp add what they did to a buffer (one atomic per subgroup where the driver has
+// subgroup arithmetic); every read interval the host copies it behind a fence, clears it, and
+// reads the copy once it has landed, so counting never waits on the GPU. The shaders see the
+// buffer as an r32ui image, since math.comp already binds every storage block it may.
+namespace PerfCounters
+{
+    const GLuint PERF_COUNTERS_IMAGE_UNIT = 0;  // MUST MATCH math.comp, constraints.comp, collide.comp
+
+    // Counter slots - MUST MATCH PERF_* in the shaders
+    enum Counter
+    {
+        PERF_TOKENS,             // Equation tokens (or register instructions) run, pair bodies included
+        PERF_EQUATIONS,          // Equation evaluations, one per object per integrator stage
+        PERF_PAIR_TESTS,         // Narrowphase pair tests
+        PERF_CONTACTS,           // Tests that found a contact
+        PERF_CONSTRAINT_SOLVES,  // Constraint solves, iterations included
+        PERF_SANITIZED,          // NaN/Inf values the safe-math guards replaced
+        PERF_COUNTER_COUNT
+    };
+    const int PERF_EQUATION_BASE = 8;          // First per-equation-ID slot
+    const int PERF_MAX_EQUATION_IDS = 1024;    // IDs at or above this are only in PERF_EQUATIONS
+    const int PERF_DEFAULT_READ_INTERVAL = 16; // Steps per read
+
+    struct Counts
+    {
+        uint64_t totals[PERF_COUNTER_COUNT] = { 0 };
+        std::vector<uint64_t> perEquation;  // Evaluations by equation ID, up to the highest one counted
+        int steps = 0;                      // Steps the counts cover, 0 = nothing read yet
+    };
+
+    void SetEnabled(bool enabled);  // Off by default; turning it on starts a new interval
+    bool IsEnabled();
+    void SetReadInterval(int steps);
+    int GetReadInterval();
+
+    // Around the passes of a step, on the simulation's GL thread. Bind allocates the buffer on first use.
+    void Bind();
+    void Unbind();
+
+    // After each step: collects a landed copy and starts the next one once the interval is up
+    void EndStep();
+
+    // Counts of the last interval that has been read
+    const Counts& GetLatest();
+
+    void Cleanup();
+}
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,53 @@
+#ifndef PHASE_SPACE_H
+#define PHASE_SPACE_H
+
+#include <glad/glad.h>
+#include <string>
+
+// SSBO binding of phase_points.vert
+const int PHASE_OBJECTS_BINDING = 50;
+
+// Phase-space density plot: every object adds one point at (q, p) of two chosen variables to a
+// float density texture with additive blending, read straight from the object buffer, and the
+// texture fades by a constant factor each frame so the plot shows recent motion. The density is
+// tone-mapped into the framebuffer bound when Draw() is called. Nothing goes through the CPU.
+namespace PhaseSpace
+{
+    // Variables a plot axis can show - MUST MATCH phase_points.vert
+    enum Variable
+    {
+        PHASE_X = 0,
+        PHASE_Y = 1,
+        PHASE_VX = 2,
+        PHASE_VY = 3,
+        PHASE_THETA = 4,   // Rotation
+        PHASE_OMEGA = 5,   // Angular velocity
+        PHASE_VARIABLE_COUNT
+    };
+
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // Plot settings; changing the variables or the window clears the density
+    bool SetVariables(int q, int p);  // false for an unknown Variable
+    void GetVariables(int& q, int& p);
+    bool SetWindow(float qMin, float qMax, float pMin, float pMax);  // false for an empty window
+    void GetWindow(float& qMin, float& qMax, float& pMin, float& pMax);
+    void SetDecay(float keep);        // Share of the density kept per frame, [0, 1], default 0.95
+    float GetDecay();
+    void SetExposure(float exposure); // Density at which the colour ramp is ~63% up, > 0
+    float GetExposure();
+    void Clear();
+
+    // Fade the density, add objectSSBO's first numObjects objects and draw the plot into the
+    // bound framebuffer's width x height viewport
+    void Draw(GLuint objectSSBO, int numObjects, int width, int height);
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // PHASE_SPACE_H
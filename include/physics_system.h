@@ -16,6 +16,7 @@ struct PhysicsSystem {
     bool showTrails = true;
     bool showPhaseSpace = true;
     bool simulationPaused = false;
+    bool threadedSimulation = false;  // Step on SimulationThread instead of once per frame
     float globalTime = 0.0f;
 
     void UpdateSystemParameters();
@@ -0,0 +1,33 @@
+#ifndef RESOLUTION_SCALER_H
+#define RESOLUTION_SCALER_H
+
+#include <glad/glad.h>
+
+// Dynamic resolution for the world view: the pass is timed with GPU timer queries, read back a
+// few frames late so nothing waits, and the render scale drops while the smoothed time is over
+// budget and creeps back up once there is headroom. The view is drawn at scale x the viewport
+// size and stretched back up when the texture is shown.
+namespace ResolutionScaler
+{
+    const float DEFAULT_BUDGET_MS = 12.0f;  // GPU time of the world pass
+    const float DEFAULT_MIN_SCALE = 0.5f;
+
+    bool Init();
+    void Cleanup();
+
+    // Bracket the timed pass; the scale for the next frame changes in EndFrame()
+    void BeginFrame();
+    void EndFrame();
+
+    void SetEnabled(bool enabled);  // Off returns to full resolution
+    bool GetEnabled();
+    void SetBudget(float milliseconds);
+    float GetBudget();
+    void SetMinScale(float scale);  // (0, 1]
+    float GetMinScale();
+
+    float GetScale();               // Of each axis, in [GetMinScale(), 1]
+    float GetPassTime();            // Smoothed GPU milliseconds, 0 until measured
+}
+
+#endif // RESOLUTION_SCALER_H
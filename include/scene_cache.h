@@ -0,0 +1,29 @@
+#ifndef SCENE_CACHE_H
+#define SCENE_CACHE_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// Scenes kept resident in VRAM under a name: each holds a GPU copy of the object rows and the
+// equation ID every row ran when it was stored. Bringing a scene back is one buffer-to-buffer
+// copy per object buffer instead of an upload from the host; the host tables that go with it
+// (equations, constraints, collision properties) are small and kept by the caller.
+namespace SceneCache
+{
+    void Cleanup();
+
+    // Copy objectSSBO's first numObjects objects under name, replacing a scene stored before
+    bool Store(const std::string& name, GLuint objectSSBO, int numObjects, const std::vector<int>& equationIDs);
+    bool Has(const std::string& name);
+    void Remove(const std::string& name);
+    std::vector<std::string> GetNames();
+    int GetObjectCount(const std::string& name);  // -1 for a name not stored
+    const std::vector<int>* GetEquationIDs(const std::string& name);
+    long long GetBytes();  // VRAM the stored scenes hold
+
+    // Copy the scene's objects into every target buffer at object offset first
+    bool Restore(const std::string& name, const GLuint* targets, int targetCount, int first);
+}
+
+#endif // SCENE_CACHE_H
@@ -0,0 +1,48 @@
+#ifndef SDF_COLLIDERS_H
+#define SDF_COLLIDERS_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// Texture unit of the sampled distance grid - MUST MATCH sdf_collide.comp
+const int SDF_GRID_TEXTURE_UNIT = 3;
+
+const int MAX_SDF_GRID_SIZE = 4096;  // Samples per axis
+
+// Static environment described by a signed distance instead of objects: a DSL expression of
+// (x, y), a sampled grid, or both (their union, the smaller distance). After the narrowphase
+// one pass tests every dynamic collidable object against it directly: the distance and the
+// central-difference gradient at the object's centre give the penetration and the normal, and
+// the object is pushed out along the gradient with the usual restitution and Coulomb friction.
+// The environment never enters the broadphase, so one field replaces any number of walls.
+namespace SdfColliders
+{
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // The distance as GLSL `float sdfExpression(...)` from EquationCodegen::GenerateExpressionFunction.
+    // false with error set if it does not compile; the previous expression stays.
+    bool SetExpression(const std::string& function, std::string& error);
+    void ClearExpression();
+
+    // columns x rows distances, row by row from the bottom, spanning the world rectangle edge to
+    // edge; outside it the distance grows with the distance to the rectangle. false if the
+    // sizes do not match or the rectangle is empty.
+    bool SetGrid(const std::vector<float>& distances, int columns, int rows,
+                 float xMin, float xMax, float yMin, float yMax);
+    void ClearGrid();
+
+    // Surface of the environment, combined with each object's as a pair of objects would be
+    void SetSurface(float restitution, float friction);
+
+    bool IsActive();
+
+    // Resolve the first numObjects objects of objectSSBO in place against the environment. The
+    // caller binds SimParams, the object parameters and, when set, the static and kinematic
+    // tables, which keep their objects where they are.
+    void Resolve(GLuint objectSSBO, GLuint collisionPropsSSBO, int numObjects, bool staticColliders, bool kinematicObjects);
+}
+
+#endif // SDF_COLLIDERS_H
@@ -0,0 +1,31 @@
+#pragma once
+
+// Forward declaration
+struct GLFWwindow;
+
+// Physics stepping on a worker thread that owns a hidden window whose context shares objects
+// with the main one, so the step rate is not tied to vsync or UI cost.
+//
+// The two threads hand the Objects state back and forth under one lock: the worker holds it
+// while it submits a step, the render thread from BeginFrame() to EndFrame() - input, UI edits
+// and drawing - and releases it before glfwSwapBuffers(), which is where most of a frame's
+// wall time goes. Each side fences the commands it issued, and the other side waits on that
+// fence in its own context (glWaitSync) before it reads or overwrites the buffers, because the
+// two contexts' command streams are not ordered against each other. While the thread runs it
+// swaps the object buffers after every step, so inside a frame the input buffer is the latest
+// finished one.
+class SimulationThread {
+public:
+    static bool Start(GLFWwindow* mainWindow);  // Main thread only (creates the shared context)
+    static void Stop();                         // Joins the worker and destroys its context
+    static bool IsRunning();
+
+    // Render thread; no-ops while the thread is not running
+    static void BeginFrame();
+    static void EndFrame();
+
+    static float GetStepsPerSecond();  // Measured over the last second
+
+private:
+    static void Run();
+};
@@ -0,0 +1,48 @@
+#ifndef SPH_FLUID_H
+#define SPH_FLUID_H
+
+#include <glad/glad.h>
+#include <string>
+
+const int SPH_FLUID_EQUATIONS_BINDING = 61;  // MUST MATCH sph_fluid.comp
+
+// Weakly compressible SPH - MUST MATCH the uniforms of sph_fluid.comp
+struct SphParameters
+{
+    float radius = 0.1f;          // Kernel support h; also the neighbour grid cell size
+    float restDensity = 1000.0f;  // rho0
+    float stiffness = 100.0f;     // B in p = B * ((rho / rho0)^gamma - 1)
+    float gamma = 7.0f;           // Tait exponent, 1 = linear equation of state
+    float viscosity = 0.1f;       // Dynamic viscosity mu
+};
+
+// SPH fluid forces over the neighbour grid. The fluid is every object whose equation reads
+// sph_ax/sph_ay/sph_rho/sph_p; each stage two passes visit the 3x3 cells of radius h around
+// every fluid object, the first summing density (poly6) and the pressure of the equation of
+// state, the second the pressure (spiky gradient) and viscosity (laplacian) accelerations.
+// Results go to the fluid half of the long-range field buffer bound at LONG_RANGE_ACCEL_BINDING,
+// so equations add them to their own forces, e.g. "sph_ax, sph_ay - gravity".
+namespace SphFluid
+{
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // Which equation slots describe fluid objects; the next Compute uploads the change
+    void SetFluidEquation(int equationID, bool fluid);
+    void ClearFluidEquations();
+
+    // Rebuild the neighbour grid at the kernel radius and write every fluid object's
+    // (sph_ax, sph_ay, sph_rho, sph_p) into fieldSSBO; false if the shader is not ready
+    bool Compute(GLuint objectSSBO, GLuint collisionPropsSSBO, GLuint fieldSSBO, int numObjects);
+
+    void SetParameters(const SphParameters& params);
+    SphParameters GetParameters();
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // SPH_FLUID_H
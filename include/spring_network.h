@@ -0,0 +1,60 @@
+#ifndef SPRING_NETWORK_H
+#define SPRING_NETWORK_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// SSBO bindings of the spring pass (reuses the constraint pass binding points, which are rebound after it)
+const int SPRING_OFFSETS_BINDING = 5;
+const int SPRING_ENTRIES_BINDING = 6;
+const int SPRING_SNAPSHOT_BINDING = 7;
+
+// One end of a spring, stored in the row of the object it pulls - MUST MATCH spring_network.comp
+struct SpringEntry
+{
+    int other;          // Object at the other end
+    float restLength;   // < 0 = the distance when the first step runs
+    float stiffness;    // Hooke constant
+    float damping;      // Along the spring, per unit relative speed
+};
+
+// Spring networks for soft bodies and cloth, apart from the per-object constraint lists. The
+// edges are stored in compressed sparse rows: every edge appears in the rows of both of its
+// objects, so one invocation per object sums its own spring forces with no atomics, reading a
+// snapshot of the integrated state. The net force is applied as an impulse to the integrated
+// state (velocity, and position by the same step), which matches the symplectic Euler step.
+// Explicit springs need a small enough timestep when stiff; the implicit mode instead solves
+// backward Euler for the impulses, (M - dt D - dt^2 K) dv = dt f with the damping and stiffness
+// Jacobians of the snapshot, by Jacobi-preconditioned conjugate gradients over the same rows.
+// It stays stable at any stiffness, at the cost of a few passes per iteration.
+namespace SpringNetwork
+{
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // Replace the network: edge e joins endpoints[2e] and endpoints[2e + 1], both below
+    // numObjects. stiffness, damping and restLength hold one value per edge or a single value
+    // for all (damping may be empty for 0, restLength empty for the current distances).
+    void SetSprings(int numObjects, const std::vector<int>& endpoints, const std::vector<float>& stiffness,
+                    const std::vector<float>& damping, const std::vector<float>& restLength);
+    void Clear();
+    int GetSpringCount();
+
+    // Backward Euler instead of explicit impulses: at most iterations CG iterations, stopping
+    // once the preconditioned residual is tolerance times the starting one
+    void SetImplicit(bool enabled, int iterations, float tolerance);
+    void GetImplicit(bool& enabled, int& iterations, float& tolerance);
+
+    // Spring impulses on the integrated state; adaptiveTimestep reads dt from the bound
+    // TimestepState. False if the shader is not ready or there are no springs.
+    bool Apply(GLuint objectSSBO, int numObjects, float dt, bool adaptiveTimestep);
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // SPRING_NETWORK_H
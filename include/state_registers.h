@@ -0,0 +1,37 @@
+#ifndef STATE_REGISTERS_H
+#define STATE_REGISTERS_H
+
+#include <glad/glad.h>
+
+// Per-object state registers s0..s7 - MUST MATCH MAX_STATE_REGISTERS in parser.h and math.comp
+const int STATE_REGISTER_COUNT = 8;
+
+// Image unit of the register buffer - MUST MATCH math.comp
+const GLuint STATE_REGISTERS_IMAGE_UNIT = 2;
+
+// Values an equation keeps across steps (integrators, timers, counters): it reads them as
+// s0..s7 and updates them with "sK = expr" statements. Unlike $0..$7 the GPU owns them: math.comp
+// loads an object's row once per dispatch, evaluates the updates after each completed step and
+// stores the row back, so they never round-trip through the host. The buffer is an r32f image
+// because math.comp is out of SSBO blocks. Host edits and reads go straight to the buffer.
+namespace StateRegisters
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the buffer for more objects (rows are kept)
+    void Cleanup();
+
+    // values[0..count) go to s<first>..s<first+count-1> of one object
+    void Set(int index, int first, const float* values, int count);
+    void Get(int index, float* out);          // STATE_REGISTER_COUNT values; waits for the GPU
+    void Clear(int first, int count = 1);     // Zero the rows of [first, first + count)
+    void Move(int to, int from);              // Row of from to to; from is cleared
+    void Copy(int to, int from, int count);   // Rows [from, from + count) to to; the ranges must not overlap
+    void Permute(int count);                  // Rows [0, count) into the order ObjectReorder uploaded
+
+    // Around the math.comp passes of a step, on the simulation's GL thread
+    void Bind();
+    void Unbind();
+}
+
+#endif // STATE_REGISTERS_H
@@ -0,0 +1,51 @@
+#ifndef STATIC_COLLIDERS_H
+#define STATIC_COLLIDERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+struct CollisionProperties;
+
+// Texture units of the static mask and grid - MUST MATCH math.comp, collide.comp,
+// broadphase_grid.comp and broadphase_lbvh.comp
+const int STATIC_GRID_TEXTURE_UNIT = 8;
+const int STATIC_MASK_TEXTURE_UNIT = 9;
+
+// Static colliders: objects that keep their state (never integrated, never the querying side
+// of a collision) and that dynamic objects collide with as if they had infinite mass. They
+// stay objects, so p[i], rendering and picking see them as before. A bit per object marks them
+// (R32UI buffer texture, 32 objects per texel); their boxes are binned on the host into a
+// uniform grid that is only rebuilt when a static object is added, removed, moved or resized.
+// Grid texture: cell offsets [0, cells], then the object indices of each cell.
+namespace StaticColliders
+{
+    // Core functions
+    bool Init(int maxObjects);
+    bool Reserve(int maxObjects);  // Grow the mask for more objects (bits are kept)
+    void Cleanup();
+
+    // Host edits
+    void Set(int index, bool isStatic);
+    bool IsStatic(int index);
+    int GetCount();
+    void Clear(int index);
+    void Move(int to, int from);                  // Bit of from to to; from is cleared
+    void Permute(const std::vector<int>& order);  // Bit i becomes the old bit order[i]
+
+    // A static object changed shape, place or collision properties: rebuild before the next use
+    void Invalidate();
+
+    // Rebuild the grid from the first numObjects objects when invalidated (reads the static
+    // positions back, so it waits for the GPU); false while there is no grid
+    bool Update(GLuint objectSSBO, const CollisionProperties* props, int numObjects);
+
+    // Upload pending edits and bind the mask and grid textures
+    void Bind();
+
+    // collide.comp uniforms: origin xy, cell size (0 = no grid), entry offset; cells per axis
+    glm::vec4 GetGridUniform();
+    glm::ivec2 GetGridCells();
+}
+
+#endif // STATIC_COLLIDERS_H
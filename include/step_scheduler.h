@@ -0,0 +1,36 @@
+#ifndef STEP_SCHEDULER_H
+#define STEP_SCHEDULER_H
+
+#include <glad/glad.h>
+
+// Wall-clock budget for the steps of one update(): the steps are timed with a GPU timer query,
+// read back a few updates late so nothing waits, and the smoothed time per step decides how
+// many of the pending steps the next update may run. Steps that do not fit stay owed as lag
+// for the next update; the caller drops lag beyond GetMaxLag(), so a scene that cannot keep
+// real time runs slower instead of falling further behind every frame.
+namespace StepScheduler
+{
+    const int DEFAULT_MAX_STEPS = 20;  // Per update, with or without a budget
+
+    void Cleanup();
+
+    // Bracket the GPU steps of one update; the query is created on first use
+    void BeginSteps();
+    void EndSteps(int steps);
+    void AddHostSample(double milliseconds, int steps);  // Steps the CPU backend ran
+
+    // Steps of pending an update may run: all of them up to the max steps without a budget or
+    // before the first measurement, else as many as fit the budget, and at least one
+    int StepsAllowed(int pending);
+
+    void SetBudget(float milliseconds);  // 0 = no budget
+    float GetBudget();
+    void SetMaxSteps(int steps);         // At least 1
+    int GetMaxSteps();
+    void SetMaxLag(float seconds);       // Simulated time owed before the rest is dropped, 0 = never drop
+    float GetMaxLag();
+
+    float GetStepTime();                 // Smoothed milliseconds per step, 0 until measured
+}
+
+#endif // STEP_SCHEDULER_H
@@ -3,39 +3,59 @@
 #include <glm/glm.hpp>
 #include <map>
 #include <string>
+#include <vector>
 
-// Python module doesn't need FreeType text rendering
-#define NO_TEXT_RENDERING
-
+// Where a glyph sits in the atlas and how it is laid out, in font pixels
 struct Character {
-    GLuint textureID;
+    glm::vec2 uvMin;
+    glm::vec2 uvMax;
     glm::ivec2 size;
     glm::ivec2 bearing;
     unsigned int advance;
 };
 
+// Text drawn from one glyph atlas texture, built once at construction. AddText() only appends
+// quads to a vertex batch; Flush() uploads the batch and draws every queued string in one call.
+// Glyphs come from a built-in bitmap font covering the characters axis labels use; a character
+// outside it advances like a space.
 class TextRenderer {
 public:
-    TextRenderer(const std::string& fontPath, unsigned int fontSize) {
-        // Empty - Python module doesn't need text rendering
-    }
+    explicit TextRenderer(unsigned int fontSize);  // Pixel height of a line at scale 1
+    ~TextRenderer();
+
+    TextRenderer(const TextRenderer&) = delete;
+    TextRenderer& operator=(const TextRenderer&) = delete;
 
-    ~TextRenderer() {
-        // Empty destructor
-    }
+    // Queue text with its top left corner at (x, y) pixels, y down
+    void AddText(const std::string& text, float x, float y,
+        float scale, glm::vec3 color, float alpha);
+    void Flush(float windowWidth, float windowHeight);
 
+    // AddText and Flush of one string
     void RenderText(const std::string& text, float x, float y,
         float scale, glm::vec3 color, float alpha,
-        float windowWidth = 800.0f, float windowHeight = 600.0f) {
-        // Do nothing - Python module
-    }
+        float windowWidth = 800.0f, float windowHeight = 600.0f);
+
+    // Size of text at scale in pixels
+    glm::vec2 MeasureText(const std::string& text, float scale) const;
 
 private:
+    struct Vertex {
+        glm::vec2 position;
+        glm::vec2 uv;
+        glm::vec4 color;
+    };
+
     std::map<char, Character> Characters;
-    GLuint VAO, VBO;
-    GLuint shaderProgram;
+    std::vector<Vertex> batch;
+    GLuint VAO = 0, VBO = 0;
+    GLuint atlasTexture = 0;
+    GLuint shaderProgram = 0;
+    GLint viewportLoc = -1;
+    GLint atlasLoc = -1;
+    size_t capacity = 0;       // Vertices VBO has room for
+    float pixelSize = 1.0f;    // Screen pixels per font pixel at scale 1
 
-    void InitShaders() {
-        // Empty
-    }
-};
\ No newline at end of file
+    void BuildAtlas();
+    void InitShaders();
+};
@@ -0,0 +1,41 @@
+#ifndef VULKAN_BACKEND_H
+#define VULKAN_BACKEND_H
+
+#include "cpu_backend.h"
+#include <string>
+
+// Simulation step on a Vulkan compute queue, for drivers whose OpenGL compute falls short
+// (no queue of its own, no explicit memory management). It steps the same CpuBackend::Scene
+// mirror of the GPU scene the CPU backend does, with shaders/vulkan/step.comp compiled to
+// SPIR-V at build time, and hands the result back the same way.
+//
+// The device is the first with Vulkan 1.2 timeline semaphores, a discrete GPU before others.
+// Steps go to a compute-only queue family when the device has one, so they run beside the
+// OpenGL context's rendering instead of behind it. Objects and equations live in device-local
+// buffers the host reaches through persistent staging buffers; a batch of steps is one
+// submission - upload, one dispatch per step, readback - that the host waits for on a
+// timeline semaphore.
+//
+// Covered: math.comp's equation pass for one world - evaluation, every integrator, reflecting
+// bounds. Left to the OpenGL pipeline (CanStep() says no): collisions, constraints,
+// derivatives, pair reductions, lookup tables and fields, and multi-stage integrators when
+// equations read other objects. Needs a build with STELLAR_VULKAN.
+namespace VulkanBackend
+{
+    // Instance, device and pipeline, created on the first call; later calls return the first
+    // result. False with error when the build has no Vulkan or no device qualifies
+    bool Init(std::string& error);
+    void Cleanup();
+    bool IsAvailable();  // Init() succeeded
+    std::string GetDeviceName();
+    bool HasComputeQueue();  // A queue family without graphics, apart from rendering
+
+    // Whether Step() runs scene as CpuBackend::Step() would; reason names what it leaves out
+    bool CanStep(const CpuBackend::Scene& scene, const CpuBackend::EquationSet& equations, std::string& reason);
+
+    // steps fixed steps of scene.params.dt in one submission into scene.state. Step k reads
+    // t = scene.params.time + k * dt; scene.params.time is left at the last step's
+    bool Step(CpuBackend::Scene& scene, const CpuBackend::EquationSet& equations, int steps, std::string& error);
+}
+
+#endif // VULKAN_BACKEND_H
@@ -0,0 +1,47 @@
+#ifndef WORKGROUP_TUNER_H
+#define WORKGROUP_TUNER_H
+
+#include <glad/glad.h>
+
+// Per-object passes whose work-group size is tuned; their builds take it as LOCAL_SIZE_X
+enum TunedPass
+{
+    TUNED_PASS_INTEGRATE,    // math.comp (every build: variants, compiled equations, the pair pass)
+    TUNED_PASS_CONSTRAINTS,  // constraints.comp
+    TUNED_PASS_COLLIDE,      // collide.comp (and its per-shape builds)
+    TUNED_PASS_COUNT
+};
+
+// local_size_x of the passes without LOCAL_SIZE_X - MUST MATCH math.comp, constraints.comp and collide.comp
+const int DEFAULT_LOCAL_SIZE = 16;
+
+// Sizes tried, the default first; none is below it, as math.comp stages 16 objects per workgroup
+const int LOCAL_SIZE_CANDIDATE_COUNT = 5;
+const int LOCAL_SIZE_CANDIDATES[LOCAL_SIZE_CANDIDATE_COUNT] = { 16, 32, 64, 128, 256 };
+
+// Work-group size per pass for the current device. Tuning times the scene being simulated: every
+// candidate of every pass runs for a few steps under GL_TIMESTAMP queries (collected once they have
+// landed, nothing waits on the GPU) and the fastest is kept. Results are stored per device and
+// driver next to the program binary cache and loaded on Init, so a machine tunes once.
+namespace WorkgroupTuner
+{
+    void Init();  // Load the sizes stored for this device; needs a current context
+    void Cleanup();
+
+    // Start tuning; with sizes stored for this device only when force is set
+    void Start(bool force);
+    bool IsTuning();
+
+    int GetLocalSize(TunedPass pass);  // Size to build and run this step: the candidate being timed while tuning
+    int GetTunedSize(TunedPass pass);  // Result, DEFAULT_LOCAL_SIZE until the pass is tuned
+
+    // Around the dispatches of a pass in one step, with the size they actually ran at
+    void BeginPass(TunedPass pass, int localSize);
+    void EndPass(TunedPass pass);
+    void CandidateFailed(TunedPass pass, int localSize);  // The build did not link, skip it
+
+    // Once per step: collect landed timings, move to the next candidate, store the results when done
+    void Update();
+}
+
+#endif // WORKGROUP_TUNER_H
@@ -0,0 +1,33 @@
+#ifndef WORLD_TILES_H
+#define WORLD_TILES_H
+
+#include <glad/glad.h>
+#include <vector>
+
+// SSBO binding of the per-world tiles - MUST MATCH quad_instanced.vert
+const int WORLD_TILES_BINDING = 52;
+
+// Tiled view of ensemble worlds (object_worlds.h): every shown world is drawn into a cell of a
+// grid over the framebuffer, all of them in the one instanced object draw. Each object looks its
+// cell up by worldID in a vec4 per world (clip-space centre, half size; 0 = not shown) and is
+// clipped to it, so the camera is the same in every cell. The renderers set up the camera for
+// one cell (GetCellSize) while tiles are active.
+namespace WorldTiles
+{
+    // Core functions
+    void Cleanup();
+
+    // Worlds to show, in cell order left to right and top to bottom (empty = every world), on
+    // columns columns (0 = as square a grid as fits)
+    void Set(const std::vector<int>& worlds, int columns);
+    void Clear();
+    bool IsActive();  // Set and an ensemble exists
+    void GetGrid(int& columns, int& rows);
+    void GetCellSize(int width, int height, int& cellWidth, int& cellHeight);
+
+    // Upload the tiles for the current worlds and bind them for the draw
+    void Bind();
+    void Unbind();
+}
+
+#endif // WORLD_TILES_H
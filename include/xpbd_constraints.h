@@ -0,0 +1,53 @@
+#ifndef XPBD_CONSTRAINTS_H
+#define XPBD_CONSTRAINTS_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// SSBO bindings of the solve (reuses the constraint pass binding points, which are rebound after it)
+const int XPBD_EDGES_BINDING = 5;
+const int XPBD_LAMBDAS_BINDING = 6;
+const int XPBD_PREDICTED_BINDING = 7;
+
+// One distance constraint between two objects - MUST MATCH xpbd_constraints.comp
+struct XpbdEdge
+{
+    int objectA;       // Object that owns the constraint
+    int objectB;       // Its target
+    float restLength;
+    float _pad;
+};
+
+// XPBD distance constraints: every edge of the constraint graph moves both of its objects
+// by their inverse masses, with the compliance turning the correction into a spring of
+// stiffness 1 / compliance. The graph is colored on the CPU when it changes so that no two
+// edges of a color share an object; each color is one dispatch, and later colors already
+// see the corrections of earlier ones (Gauss-Seidel), so chains converge in a few sweeps.
+namespace XpbdConstraints
+{
+    // Core functions
+    bool Init();
+    void Cleanup();
+
+    // Replace the graph; edges are colored and uploaded here
+    void SetEdges(const std::vector<XpbdEdge>& edges);
+    int GetEdgeCount();
+    int GetColorCount();
+
+    // Sweeps over all colors per step, and compliance (0 = rigid)
+    void SetParameters(int iterations, float compliance);
+    int GetIterations();
+    float GetCompliance();
+
+    // Solve in place on the integrated state and turn the corrections into velocity;
+    // adaptiveTimestep reads dt from the bound TimestepState. False if not ready.
+    bool Solve(GLuint objectSSBO, int numObjects, float dt, bool adaptiveTimestep);
+
+    // Async shader loading
+    void UpdateShaderLoadingStatus();
+    bool IsReady();
+    std::string GetShaderLoadStatusMessage();
+}
+
+#endif // XPBD_CONSTRAINTS_H
@@ -2,11 +2,284 @@
 #include <pybind11/stl.h>
 #include <pybind11/functional.h>
 #include <pybind11/gil.h>
+#include <pybind11/numpy.h>
+#include <cstring>
+#include <optional>
 #include <string>
 #include "simulation_wrapper.h"
+#include "shared_frames.h"
+#include "trajectory_reader.h"
+#include "expression_builder.h"
+#include "command_queue.h"
 
 namespace py = pybind11;
 
+// Structured dtype of one object record - MUST MATCH Object in objects.h
+static py::dtype ObjectRecordDtype()
+{
+    py::list names, formats, offsets;
+    auto field = [&](const char* name, const char* format, int offset)
+    {
+        names.append(name);
+        formats.append(format);
+        offsets.append(offset);
+    };
+    field("position", "(2,)f4", 0);
+    field("velocity", "(2,)f4", 8);
+    field("mass", "f4", 16);
+    field("charge", "f4", 20);
+    field("skin", "i4", 24);
+    field("collision_shape", "i4", 28);
+    field("visual_data", "(4,)f4", 32);
+    field("collision_data", "(4,)f4", 48);
+    field("color", "(4,)f4", 64);
+    field("equation_id", "i4", 80);
+    return py::dtype(names, formats, offsets, static_cast<py::ssize_t>(OBJECT_RECORD_BYTES));
+}
+
+// Structured dtype of one collision event - MUST MATCH ContactEvent in contact_events.h
+static py::dtype ContactEventDtype()
+{
+    py::list names, formats, offsets;
+    auto field = [&](const char* name, const char* format, int offset)
+    {
+        names.append(name);
+        formats.append(format);
+        offsets.append(offset);
+    };
+    field("a", "i4", 0);
+    field("b", "i4", 4);
+    field("normal", "(2,)f4", 8);
+    field("impulse", "f4", 16);
+    field("penetration", "f4", 20);
+    return py::dtype(names, formats, offsets, static_cast<py::ssize_t>(sizeof(ContactEvent)));
+}
+
+// Read-only array over the records of the last sync(); the capsule keeps them alive
+static py::array StateViewArray(const SimulationWrapper& self)
+{
+    std::shared_ptr<const StateView> view = self.state_view();
+    if (!view) throw std::runtime_error("No state to view; call sync() first");
+
+    auto* owner = new std::shared_ptr<const StateView>(view);
+    py::capsule base(owner, [](void* p) { delete static_cast<std::shared_ptr<const StateView>*>(p); });
+    py::array records(ObjectRecordDtype(), { static_cast<py::ssize_t>(view->count) },
+                      { static_cast<py::ssize_t>(OBJECT_RECORD_BYTES) }, view->records.data(), base);
+    records.attr("setflags")(py::arg("write") = false);
+    return records;
+}
+
+// Read-only view of frames [first, first + frames) of a mapped trajectory field; the view keeps
+// the reader, and so the mapping, alive. One object's column is a strided (frames,) view.
+static py::array TrajectoryFieldView(py::object self, int field, long long first, long long frames, int column)
+{
+    const TrajectoryReader& reader = self.cast<const TrajectoryReader&>();
+    py::ssize_t objects = static_cast<py::ssize_t>(reader.GetObjectIndices().size());
+    const float* values = reader.Field(field) + static_cast<size_t>(first) * static_cast<size_t>(objects);
+    py::array_t<float> view = column < 0
+        ? py::array_t<float>({ static_cast<py::ssize_t>(frames), objects },
+                             { objects * static_cast<py::ssize_t>(sizeof(float)), static_cast<py::ssize_t>(sizeof(float)) },
+                             values, self)
+        : py::array_t<float>({ static_cast<py::ssize_t>(frames) }, { objects * static_cast<py::ssize_t>(sizeof(float)) },
+                             values + column, self);
+    view.attr("flags").attr("writeable") = false;
+    return view;
+}
+
+static int TrajectoryField(const TrajectoryReader& reader, const std::string& field)
+{
+    int index = reader.FieldIndex(field);
+    if (index < 0) throw py::key_error("No field '" + field + "' in " + reader.GetDirectory());
+    return index;
+}
+
+// DLPack tensor ABI (dlpack.h, version 0.x), declared here so the module needs no DLPack headers
+struct DLDevice { int32_t device_type; int32_t device_id; };
+struct DLDataType { uint8_t code; uint8_t bits; uint16_t lanes; };
+struct DLTensor
+{
+    void* data;
+    DLDevice device;
+    int32_t ndim;
+    DLDataType dtype;
+    int64_t* shape;
+    int64_t* strides;  // In elements
+    uint64_t byte_offset;
+};
+struct DLManagedTensor
+{
+    DLTensor dl_tensor;
+    void* manager_ctx;
+    void (*deleter)(DLManagedTensor*);
+};
+static const int32_t DL_CUDA = 2;
+static const uint8_t DL_FLOAT = 2;
+
+// The tensor with its shape and strides in one allocation
+struct ExportedTensor
+{
+    DLManagedTensor managed;
+    int64_t shape[2];
+    int64_t strides[2];
+};
+
+// A consumer renames the capsule to "used_dltensor" and calls the deleter itself
+static void DeleteUnusedTensorCapsule(PyObject* capsule)
+{
+    if (!PyCapsule_IsValid(capsule, "dltensor")) return;
+    auto* tensor = static_cast<DLManagedTensor*>(PyCapsule_GetPointer(capsule, "dltensor"));
+    if (tensor && tensor->deleter) tensor->deleter(tensor);
+}
+
+// "dltensor" capsule over one object field in device memory, strided over the records
+static py::capsule DeviceFieldCapsule(SimulationWrapper& self, const std::string& field)
+{
+    DeviceFieldView view = self.map_device_field(field);
+    auto* exported = new ExportedTensor();
+    exported->shape[0] = view.count;
+    exported->shape[1] = view.components;
+    exported->strides[0] = view.stride;
+    exported->strides[1] = 1;
+    DLTensor& tensor = exported->managed.dl_tensor;
+    tensor.data = view.data;  // Offset folded in; not every consumer honours byte_offset
+    tensor.device = { DL_CUDA, view.device };
+    tensor.ndim = view.components > 1 ? 2 : 1;
+    tensor.dtype = { DL_FLOAT, 32, 1 };
+    tensor.shape = exported->shape;
+    tensor.strides = exported->strides;
+    tensor.byte_offset = 0;
+    exported->managed.manager_ctx = exported;
+    exported->managed.deleter = [](DLManagedTensor* t) { delete static_cast<ExportedTensor*>(t->manager_ctx); };
+    return py::capsule(&exported->managed, "dltensor", &DeleteUnusedTensorCapsule);
+}
+
+// One bulk column: None = the default, else any array or scalar convertible to float32
+static std::vector<float> BulkColumn(const py::object& value, const char* name, const char* function = "add_objects")
+{
+    if (value.is_none()) return {};
+    auto column = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(value);
+    if (!column) throw std::runtime_error(std::string(function) + ": " + name + " must be numeric");
+    return std::vector<float>(column.data(), column.data() + column.size());
+}
+
+// One input of evaluate(): like BulkColumn, and the first array of more than one value sets
+// the shape the results come back in
+static std::vector<float> EvaluateColumn(const py::object& value, const char* name, std::vector<py::ssize_t>& shape,
+                                         bool& shaped)
+{
+    if (value.is_none()) return {};
+    auto column = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(value);
+    if (!column) throw std::runtime_error(std::string("evaluate: ") + name + " must be numeric");
+    if (column.size() > 1 && !shaped)
+    {
+        shape.assign(column.shape(), column.shape() + column.ndim());
+        shaped = true;
+    }
+    return std::vector<float>(column.data(), column.data() + column.size());
+}
+
+// One in-place column of step_streamed(): float32, C-contiguous and writeable, else the
+// results would land in a converted copy
+static float* StreamColumn(py::array column, const char* name, size_t& count)
+{
+    if (!column.dtype().is(py::dtype::of<float>()) || !(column.flags() & py::array::c_style))
+        throw std::runtime_error(std::string("step_streamed: ") + name + " must be a C-contiguous float32 array");
+    if (!column.writeable()) throw std::runtime_error(std::string("step_streamed: ") + name + " must be writeable");
+    if (count != SIZE_MAX && static_cast<size_t>(column.size()) != count)
+        throw std::runtime_error(std::string("step_streamed: ") + name + " must have as many values as x");
+    count = static_cast<size_t>(column.size());
+    return static_cast<float*>(column.mutable_data());
+}
+
+// Recorded frames as download_recording() returns them; the caller holds the GIL
+static py::dict RecordingToDict(const TrajectoryRecording& recording)
+{
+    py::ssize_t frames = recording.frames;
+    py::ssize_t objects = static_cast<py::ssize_t>(recording.objects.size());
+    size_t numFields = recording.fields.size();
+    py::dict result;
+    result["step"] = py::array_t<int>(frames, recording.steps.data());
+    result["time"] = py::array_t<float>(frames, recording.times.data());
+    result["objects"] = py::array_t<int>(objects, recording.objects.data());
+    result["dropped"] = recording.dropped;
+    if (!recording.quantizationBox.empty()) {
+        py::dict quantization;
+        quantization["box"] = py::make_tuple(recording.quantizationBox[0], recording.quantizationBox[1],
+                                             recording.quantizationBox[2], recording.quantizationBox[3]);
+        quantization["position_bits"] = 16;
+        quantization["velocity"] = "float16";
+        result["quantization"] = quantization;
+    }
+    for (size_t f = 0; f < numFields; ++f) {
+        py::array_t<float> column({ frames, objects });
+        float* out = column.mutable_data();
+        for (py::ssize_t r = 0; r < frames * objects; ++r) out[r] = recording.values[r * numFields + f];
+        result[py::str(recording.fields[f])] = column;
+    }
+    return result;
+}
+
+// Pickle support for the batch types, so configs and results can cross process boundaries
+// (hyperstellar.batch_scheduler runs one simulation per worker process)
+static py::tuple PickleConstraintConfig(const ConstraintConfig& c)
+{
+    return py::make_tuple(c.type, c.target, c.param1, c.param2, c.param3, c.param4);
+}
+
+static ConstraintConfig UnpickleConstraintConfig(const py::tuple& t)
+{
+    if (t.size() != 6) throw std::runtime_error("Invalid ConstraintConfig state");
+    ConstraintConfig c;
+    c.type = t[0].cast<int>();
+    c.target = t[1].cast<int>();
+    c.param1 = t[2].cast<float>();
+    c.param2 = t[3].cast<float>();
+    c.param3 = t[4].cast<float>();
+    c.param4 = t[5].cast<float>();
+    return c;
+}
+
+static py::tuple PickleObjectConfig(const ObjectConfig& o)
+{
+    py::list constraints;
+    for (const ConstraintConfig& c : o.constraints) constraints.append(PickleConstraintConfig(c));
+    return py::make_tuple(o.x, o.y, o.vx, o.vy, o.mass, o.charge, o.rotation, o.angular_velocity,
+                          static_cast<int>(o.skin), o.size, o.width, o.height, o.r, o.g, o.b, o.a,
+                          o.polygon_sides, o.equation, constraints);
+}
+
+static ObjectConfig UnpickleObjectConfig(const py::tuple& t)
+{
+    if (t.size() != 19) throw std::runtime_error("Invalid ObjectConfig state");
+    ObjectConfig o;
+    o.x = t[0].cast<float>();
+    o.y = t[1].cast<float>();
+    o.vx = t[2].cast<float>();
+    o.vy = t[3].cast<float>();
+    o.mass = t[4].cast<float>();
+    o.charge = t[5].cast<float>();
+    o.rotation = t[6].cast<float>();
+    o.angular_velocity = t[7].cast<float>();
+    o.skin = static_cast<PySkinType>(t[8].cast<int>());
+    o.size = t[9].cast<float>();
+    o.width = t[10].cast<float>();
+    o.height = t[11].cast<float>();
+    o.r = t[12].cast<float>();
+    o.g = t[13].cast<float>();
+    o.b = t[14].cast<float>();
+    o.a = t[15].cast<float>();
+    o.polygon_sides = t[16].cast<int>();
+    o.equation = t[17].cast<std::string>();
+    for (auto c : t[18].cast<py::list>()) o.constraints.push_back(UnpickleConstraintConfig(c.cast<py::tuple>()));
+    return o;
+}
+
+// p(index) of stellar.expr: its attributes are the properties of that object
+struct ExprObjectRef
+{
+    int index;
+};
+
 PYBIND11_MODULE(stellar, m)
 {
     m.doc() = R"pbdoc(
@@ -71,6 +344,19 @@ PYBIND11_MODULE(stellar, m)
         .value("POLYGON", PyCollisionShape::POLYGON, "Polygon SAT collision")
         .export_values();
 
+    py::enum_<PyBroadphaseMode>(m, "BroadphaseMode", R"pbdoc(
+        Collision candidate search used by the GPU solver.
+        
+        Attributes:
+            ALL_PAIRS: Test every object against every other object (O(N^2))
+            UNIFORM_GRID: Spatial hash; best when object sizes are similar
+            LBVH: Linear BVH; best when object sizes span orders of magnitude
+        )pbdoc")
+        .value("ALL_PAIRS", PyBroadphaseMode::ALL_PAIRS, "All-pairs collision search")
+        .value("UNIFORM_GRID", PyBroadphaseMode::UNIFORM_GRID, "Uniform grid broadphase")
+        .value("LBVH", PyBroadphaseMode::LBVH, "Linear BVH broadphase")
+        .export_values();
+
     // =========================================================================
     // OBJECT STATE
     // =========================================================================
@@ -111,6 +397,25 @@ PYBIND11_MODULE(stellar, m)
         .def_readwrite("g", &ObjectState::g, "Green color component (0.0-1.0)")
         .def_readwrite("b", &ObjectState::b, "Blue color component (0.0-1.0)")
         .def_readwrite("a", &ObjectState::a, "Alpha/opacity (0.0-1.0)")
+        .def(py::pickle(
+            [](const ObjectState& p) {
+                return py::make_tuple(p.x, p.y, p.vx, p.vy, p.mass, p.charge, p.rotation, p.angular_velocity,
+                                      p.width, p.height, p.radius, p.polygon_sides, p.skin_type, p.r, p.g, p.b, p.a);
+            },
+            [](const py::tuple& t) {
+                if (t.size() != 17) throw std::runtime_error("Invalid ObjectState state");
+                ObjectState p;
+                float* floats[] = { &p.x, &p.y, &p.vx, &p.vy, &p.mass, &p.charge, &p.rotation, &p.angular_velocity,
+                                    &p.width, &p.height, &p.radius };
+                for (size_t i = 0; i < 11; ++i) *floats[i] = t[i].cast<float>();
+                p.polygon_sides = t[11].cast<int>();
+                p.skin_type = t[12].cast<int>();
+                p.r = t[13].cast<float>();
+                p.g = t[14].cast<float>();
+                p.b = t[15].cast<float>();
+                p.a = t[16].cast<float>();
+                return p;
+            }))
         .def("__repr__", [](const ObjectState& p) {
         return "<ObjectState pos=(" + std::to_string(p.x) + ", " +
             std::to_string(p.y) + ") vel=(" + std::to_string(p.vx) +
@@ -151,6 +456,7 @@ PYBIND11_MODULE(stellar, m)
         .def_readwrite("a", &ObjectConfig::a, "Alpha/opacity")
         .def_readwrite("polygon_sides", &ObjectConfig::polygon_sides, "Polygon sides")
         .def_readwrite("equation", &ObjectConfig::equation, "Physics equation")
+        .def(py::pickle(&PickleObjectConfig, &UnpickleObjectConfig))
         .def("__repr__", [](const ObjectConfig& p) {
         return "<ObjectConfig pos=(" + std::to_string(p.x) + ", " +
             std::to_string(p.y) + ") mass=" + std::to_string(p.mass) + ">";
@@ -163,7 +469,7 @@ PYBIND11_MODULE(stellar, m)
             type (int): Constraint type (0=DISTANCE, 1=BOUNDARY)
             target (int): Target object ID
             param1 (float): Distance: rest_length, Boundary: min_x, Angle: min_angle
-            param2 (float): Boundary: max_x, Angle: max_angle
+            param2 (float): Distance: break_length (0 = never), Boundary: max_x, Angle: max_angle
             param3 (float): Boundary: min_y
             param4 (float): Boundary: max_y
         )pbdoc")
@@ -171,9 +477,10 @@ PYBIND11_MODULE(stellar, m)
         .def_readwrite("type", &ConstraintConfig::type, "Constraint type")
         .def_readwrite("target", &ConstraintConfig::target, "Target object ID")
         .def_readwrite("param1", &ConstraintConfig::param1, "Distance: rest_length, Boundary: min_x, Angle: min_angle")
-        .def_readwrite("param2", &ConstraintConfig::param2, "Boundary: max_x, Angle: max_angle")
+        .def_readwrite("param2", &ConstraintConfig::param2, "Distance: break_length (0 = never), Boundary: max_x, Angle: max_angle")
         .def_readwrite("param3", &ConstraintConfig::param3, "Boundary: min_y")
-        .def_readwrite("param4", &ConstraintConfig::param4, "Boundary: max_y");
+        .def_readwrite("param4", &ConstraintConfig::param4, "Boundary: max_y")
+        .def(py::pickle(&PickleConstraintConfig, &UnpickleConstraintConfig));
 
     py::class_<BatchConfig>(m, "BatchConfig", R"pbdoc(
         Configuration for batch simulations.
@@ -183,12 +490,80 @@ PYBIND11_MODULE(stellar, m)
             duration (float): Simulation duration in seconds
             dt (float): Time step per update
             output_file (str): Optional output file path
+            stop_condition (str): Optional early end, e.g.
+                "any(sqrt((p[0].x - p[1].x)^2 + (p[0].y - p[1].y)^2) < 0.1)"
+                or "sum(0.5 * mass * (vx^2 + vy^2)) < 0.01"
+            stop_check_interval (int): Steps between stop condition checks
         )pbdoc")
         .def(py::init<>(), "Create default batch config")
         .def_readwrite("objects", &BatchConfig::objects, "List of object configurations")
         .def_readwrite("duration", &BatchConfig::duration, "Simulation duration (seconds)")
         .def_readwrite("dt", &BatchConfig::dt, "Time step per update")
-        .def_readwrite("output_file", &BatchConfig::output_file, "Output file path (optional)");
+        .def_readwrite("output_file", &BatchConfig::output_file, "Output file path (optional)")
+        .def_readwrite("stop_condition", &BatchConfig::stop_condition,
+                       "End the run early once this holds: any(expr < c), all(expr >= c) or "
+                       "sum|mean|min|max(expr) > c over the configuration's objects (< <= > >=); "
+                       "p[i] is its i-th object. Empty = run for duration")
+        .def_readwrite("stop_check_interval", &BatchConfig::stop_check_interval,
+                       "Steps between GPU checks of stop_condition")
+        .def(py::pickle(
+            [](const BatchConfig& c) {
+                py::list objects;
+                for (const ObjectConfig& o : c.objects) objects.append(PickleObjectConfig(o));
+                return py::make_tuple(objects, c.duration, c.dt, c.output_file, c.stop_condition, c.stop_check_interval);
+            },
+            [](const py::tuple& t) {
+                if (t.size() != 6) throw std::runtime_error("Invalid BatchConfig state");
+                BatchConfig c;
+                for (auto o : t[0].cast<py::list>()) c.objects.push_back(UnpickleObjectConfig(o.cast<py::tuple>()));
+                c.duration = t[1].cast<float>();
+                c.dt = t[2].cast<float>();
+                c.output_file = t[3].cast<std::string>();
+                c.stop_condition = t[4].cast<std::string>();
+                c.stop_check_interval = t[5].cast<int>();
+                return c;
+            }));
+
+    py::class_<BatchObserver>(m, "BatchObserver", R"pbdoc(
+        Per-step observer for run_batch().
+        
+        Every every_n_steps steps of each configuration, the chosen fields of
+        the chosen objects are recorded on the GPU and handed to the callback
+        in chunks, so convergence can be watched without reading the whole
+        state back each step.
+        
+        Attributes:
+            fields (list[str]): Fields to record, empty = every readback field
+            every_n_steps (int): Steps between frames
+            objects (list[int]): Object indices within the configuration,
+                empty = all
+        )pbdoc")
+        .def(py::init([](py::function callback, const std::vector<std::string>& fields, int every_n_steps,
+                         const std::vector<int>& objects) {
+                BatchObserver o;
+                o.fields = fields;
+                o.every_n_steps = every_n_steps;
+                o.objects = objects;
+                o.callback = [callback](int batch_idx, const TrajectoryRecording& frames) {
+                    py::gil_scoped_acquire acquire;
+                    callback(batch_idx, RecordingToDict(frames));
+                };
+                return o;
+            }),
+            py::arg("callback"), py::arg("fields") = std::vector<std::string>(), py::arg("every_n_steps") = 1,
+            py::arg("objects") = std::vector<int>(),
+            R"pbdoc(
+             Create an observer.
+             
+             Args:
+                 callback (callable): Called as callback(batch_index, frames)
+                     with the GIL held; frames is a dict like the one
+                     download_recording() returns, object indices local to
+                     the configuration
+             )pbdoc")
+        .def_readwrite("fields", &BatchObserver::fields, "Fields to record, empty = all")
+        .def_readwrite("every_n_steps", &BatchObserver::every_n_steps, "Steps between frames")
+        .def_readwrite("objects", &BatchObserver::objects, "Object indices within the configuration, empty = all");
 
     // =========================================================================
     // BATCH DATA STRUCTURES
@@ -231,6 +606,488 @@ PYBIND11_MODULE(stellar, m)
         .def_readwrite("b", &BatchUpdateData::b)
         .def_readwrite("a", &BatchUpdateData::a);
 
+    py::class_<ReadbackFuture>(m, "ReadbackFuture", R"pbdoc(
+        Pending copy of the object state, returned by Simulation.fetch_async().
+        
+        The copy was queued on the GPU behind the steps already submitted;
+        later update() calls do not wait for it.
+        )pbdoc")
+        .def("ready", &ReadbackFuture::ready,
+            "True once the copy has landed and result() will not block")
+        .def("result", &ReadbackFuture::result,
+            R"pbdoc(
+             Field values of every object at the time of fetch_async().
+             
+             Waits only if the copy is still in flight. Later calls return
+             the same values.
+             
+             Returns:
+                 dict[str, list[float]]: One list per requested field, indexed by object
+             )pbdoc");
+
+    py::class_<StepHandle>(m, "StepHandle", R"pbdoc(
+        Steps submitted by Simulation.step_async(), done once the GPU passes them.
+        
+        Awaitable: ``await handle`` yields to the event loop until the steps
+        are done and returns how many ran.
+        )pbdoc")
+        .def("ready", &StepHandle::ready,
+            "True once the GPU has finished the steps")
+        .def("wait", &StepHandle::wait,
+            py::arg("timeout") = -1.0f,
+            py::call_guard<py::gil_scoped_release>(),
+            R"pbdoc(
+             Block until the steps are done.
+             
+             Args:
+                 timeout (float): Seconds to wait at most, < 0 (default) waits until done
+                 
+             Returns:
+                 bool: False if the timeout passed first
+             )pbdoc")
+        .def_property_readonly("steps", &StepHandle::steps, "Steps the call submitted")
+        .def("__await__", [](py::object self) { return self; })
+        .def("__iter__", [](py::object self) { return self; })
+        .def("__next__", [](StepHandle& handle) {
+            // None hands control back to the event loop; StopIteration carries the result
+            if (!handle.ready()) return;
+            PyErr_SetObject(PyExc_StopIteration, py::int_(handle.steps()).ptr());
+            throw py::error_already_set();
+        });
+
+    py::class_<CommandFuture, std::shared_ptr<CommandFuture>>(m, "CommandFuture", R"pbdoc(
+        A command submitted to Simulation.commands, done once the thread
+        stepping the simulation has run it.
+        )pbdoc")
+        .def("ready", &CommandFuture::ready,
+            "True once the command has run and result() will not block")
+        .def("wait", &CommandFuture::wait,
+            py::arg("timeout") = -1.0f,
+            py::call_guard<py::gil_scoped_release>(),
+            R"pbdoc(
+             Block until the command has run.
+             
+             Args:
+                 timeout (float): Seconds to wait at most, < 0 (default) waits until done
+                 
+             Returns:
+                 bool: False if the timeout passed first
+             )pbdoc")
+        .def("result", [](CommandFuture& future) {
+                {
+                    py::gil_scoped_release release;
+                    future.wait(-1.0f);
+                }
+                return future.result();
+            },
+            R"pbdoc(
+             What the command returned: None for mutations, the value for
+             queries. Waits until the command has run.
+             
+             Raises:
+                 RuntimeError: What the command raised, or that the simulation
+                     was cleaned up before it ran
+             )pbdoc");
+
+    py::class_<CommandQueue, std::shared_ptr<CommandQueue>>(m, "CommandQueue", R"pbdoc(
+        Commands any Python thread can submit to a simulation another thread
+        steps, from Simulation.commands.
+        
+        Submitting never takes a lock or waits on the simulation: each call
+        pushes the command onto a lock-free queue and returns a CommandFuture.
+        The thread calling update(), step(), step_async() or
+        process_commands() runs everything queued so far first, in
+        submission order; errors are raised by the future's result().
+        
+        Example:
+            >>> queue = sim.commands
+            >>> def controller():
+            ...     queue.set_equation(0, "vx, vy, -k*x, -k*y")
+            ...     state = queue.get_object(0).result()  # After the next update()
+            >>> threading.Thread(target=controller).start()
+            >>> while running:
+            ...     sim.update(0.016)
+        )pbdoc")
+        .def("set_equation",
+            [](CommandQueue& queue, int index, const std::string& equation, const std::string& method) {
+                return queue.Submit([=](SimulationWrapper& sim) {
+                    sim.set_equation(index, equation, method);
+                    return CommandResult();
+                });
+            },
+            py::arg("object_index"), py::arg("equation_string"), py::arg("derivative_method") = "symbolic",
+            "Queue Simulation.set_equation; the future's result is None")
+        .def("set_equation",
+            [](CommandQueue& queue, int index, const BuiltEquation& equation) {
+                return queue.Submit([=](SimulationWrapper& sim) {
+                    sim.set_equation(index, equation);
+                    return CommandResult();
+                });
+            },
+            py::arg("object_index"), py::arg("equation"),
+            "Queue Simulation.set_equation with an equation built with stellar.expr")
+        .def("batch_update",
+            [](CommandQueue& queue, const std::vector<BatchUpdateData>& updates) {
+                return queue.Submit([=](SimulationWrapper& sim) {
+                    sim.batch_update(updates);
+                    return CommandResult();
+                });
+            },
+            py::arg("updates"),
+            "Queue Simulation.batch_update; the future's result is None")
+        .def("add_object",
+            [](CommandQueue& queue, float x, float y, float vx, float vy, float mass, float charge,
+               float rotation, float angular_velocity, PySkinType skin, float size, float width, float height,
+               float r, float g, float b, float a, int polygon_sides) {
+                return queue.Submit([=](SimulationWrapper& sim) {
+                    return CommandResult(sim.add_object(x, y, vx, vy, mass, charge, rotation, angular_velocity,
+                                                        skin, size, width, height, r, g, b, a, polygon_sides));
+                });
+            },
+            py::arg("x") = 0.0f, py::arg("y") = 0.0f,
+            py::arg("vx") = 0.0f, py::arg("vy") = 0.0f,
+            py::arg("mass") = 1.0f, py::arg("charge") = 0.0f,
+            py::arg("rotation") = 0.0f, py::arg("angular_velocity") = 0.0f,
+            py::arg("skin") = PySkinType::PY_SKIN_CIRCLE,
+            py::arg("size") = 0.3f,
+            py::arg("width") = 0.5f, py::arg("height") = 0.3f,
+            py::arg("r") = 1.0f, py::arg("g") = 1.0f,
+            py::arg("b") = 1.0f, py::arg("a") = 1.0f,
+            py::arg("polygon_sides") = 6,
+            "Queue Simulation.add_object; the future's result is the new object's index")
+        .def("remove_object",
+            [](CommandQueue& queue, int index) {
+                return queue.Submit([=](SimulationWrapper& sim) {
+                    sim.remove_object(index);
+                    return CommandResult();
+                });
+            },
+            py::arg("index"),
+            "Queue Simulation.remove_object; the future's result is None")
+        .def("remove_objects",
+            [](CommandQueue& queue, const std::vector<int>& indices) {
+                return queue.Submit([=](SimulationWrapper& sim) {
+                    sim.remove_objects(indices);
+                    return CommandResult();
+                });
+            },
+            py::arg("indices"),
+            "Queue Simulation.remove_objects; the future's result is None")
+        .def("get_object",
+            [](CommandQueue& queue, int index) {
+                return queue.Submit([=](SimulationWrapper& sim) { return CommandResult(sim.get_object(index)); });
+            },
+            py::arg("index"),
+            "Queue Simulation.get_object; the future's result is the ObjectState")
+        .def("batch_get",
+            [](CommandQueue& queue, const std::vector<int>& indices) {
+                return queue.Submit([=](SimulationWrapper& sim) { return CommandResult(sim.batch_get(indices)); });
+            },
+            py::arg("indices"),
+            "Queue Simulation.batch_get; the future's result is the list of BatchGetData")
+        .def("object_count",
+            [](CommandQueue& queue) {
+                return queue.Submit([](SimulationWrapper& sim) { return CommandResult(sim.object_count()); });
+            },
+            "Queue Simulation.object_count; the future's result is the count")
+        .def_property_readonly("pending", &CommandQueue::GetPending, "Commands submitted and not run yet");
+
+    py::class_<SharedFrameReader>(m, "SharedFrames", R"pbdoc(
+        Reader of a ring Simulation.start_shared_frames() publishes, from any process.
+        
+        Needs no Simulation and no GL context: the ring is mapped read-only and
+        frames are NumPy views into it. A slot is reused every `slots` frames,
+        so a view stays the frame it was taken for only until then; valid()
+        after reading tells whether it still was. read() copies under the
+        slot's seqlock instead.
+        
+        Args:
+            name (str): The name given to start_shared_frames()
+            
+        Example:
+            >>> ring = SharedFrames("sim_frames")
+            >>> frame = ring.latest()
+            >>> xs = ring.view(frame)[:, ring.fields.index("x")]
+            >>> mean_x = xs.mean()
+            >>> if not ring.valid(frame): ...   # overwritten while reading
+        )pbdoc")
+        .def(py::init<const std::string&>(), py::arg("name"))
+        .def("latest", &SharedFrameReader::Latest, "Number of the newest frame, -1 before the first")
+        .def("valid", &SharedFrameReader::IsValid, py::arg("frame"),
+            "True while the frame is complete and its slot not yet reused")
+        .def("view", [](py::object self, long long frame) {
+                const SharedFrameReader& reader = self.cast<const SharedFrameReader&>();
+                if (!reader.IsValid(frame)) throw std::runtime_error("Frame " + std::to_string(frame) + " is not in the ring");
+                py::array_t<float> values({ static_cast<py::ssize_t>(reader.GetObjects()),
+                                            static_cast<py::ssize_t>(reader.GetFields().size()) },
+                                          const_cast<float*>(reader.Values(frame)), self);
+                values.attr("flags").attr("writeable") = false;
+                return values;
+            },
+            py::arg("frame"),
+            R"pbdoc(
+             Values of a frame in place, without a copy.
+             
+             Returns:
+                 numpy.ndarray: Read-only float32, shape (objects, fields); it
+                     keeps the mapping alive
+             )pbdoc")
+        .def("info", [](const SharedFrameReader& reader, long long frame) {
+                int step = 0;
+                float time = 0.0f;
+                if (!reader.Info(frame, step, time)) throw std::runtime_error("Frame " + std::to_string(frame) + " is not in the ring");
+                return std::make_tuple(step, time);
+            },
+            py::arg("frame"), "(step, time) of a frame")
+        .def("read", [](const SharedFrameReader& reader, long long frame) -> py::object {
+                std::vector<float> copy;
+                int step = 0;
+                float time = 0.0f;
+                long long read = -1;
+                if (!reader.Read(frame, copy, step, time, read)) return py::none();
+                py::array_t<float> values({ static_cast<py::ssize_t>(reader.GetObjects()),
+                                            static_cast<py::ssize_t>(reader.GetFields().size()) });
+                std::copy(copy.begin(), copy.end(), values.mutable_data());
+                return py::make_tuple(read, step, time, values);
+            },
+            py::arg("frame") = -1,
+            R"pbdoc(
+             Copy of a frame that is consistent even while the writer goes on.
+             
+             Args:
+                 frame (int): Frame number, -1 (default) for the newest
+             
+             Returns:
+                 tuple | None: (frame, step, time, values of shape (objects, fields)),
+                     or None when there is no such frame any more
+             )pbdoc")
+        .def_property_readonly("fields", &SharedFrameReader::GetFields, "Recorded fields, the columns of each frame")
+        .def_property_readonly("objects", &SharedFrameReader::GetObjectIndices, "Recorded object indices, the rows")
+        .def_property_readonly("slots", &SharedFrameReader::GetSlots, "Frames the ring holds");
+
+    py::class_<TrajectoryReader>(m, "Trajectory", R"pbdoc(
+        Reader of a directory Simulation.record(output_dir=...) wrote.
+        
+        Each <field>.npy is memory-mapped, never read whole: indexing returns
+        read-only NumPy views into the mapping, and the OS pages in only what
+        a view touches. Read-ahead is off, so a single object's series over
+        many frames faults just the pages holding its column. chunk() walks
+        the frames in blocks and asks for each block's pages ahead of use.
+        Frames are counted from the file sizes, so a directory still being
+        written opens as the frames flushed so far; open it again for more.
+        
+        Args:
+            path (str): The output_dir given to record()
+            
+        Example:
+            >>> traj = Trajectory("run")
+            >>> x = traj.series("x", 12)            # object 12, every frame
+            >>> for c in range(traj.num_chunks()):
+            ...     block = traj.chunk(c, fields=["vx", "vy"])
+            ...     energy += (block["vx"] ** 2 + block["vy"] ** 2).sum()
+        )pbdoc")
+        .def(py::init<const std::string&>(), py::arg("path"))
+        .def("__len__", &TrajectoryReader::GetFrames)
+        .def("__contains__", [](const TrajectoryReader& reader, const std::string& field) {
+                return reader.FieldIndex(field) >= 0;
+            })
+        .def("__getitem__", [](py::object self, const std::string& field) {
+                const TrajectoryReader& reader = self.cast<const TrajectoryReader&>();
+                return TrajectoryFieldView(self, TrajectoryField(reader, field), 0, reader.GetFrames(), -1);
+            },
+            py::arg("field"), "Every frame of a field: read-only float32 view of shape (frames, objects)")
+        .def("series", [](py::object self, const std::string& field, int object) {
+                const TrajectoryReader& reader = self.cast<const TrajectoryReader&>();
+                int column = reader.ObjectColumn(object);
+                if (column < 0) throw py::key_error("Object " + std::to_string(object) + " was not recorded");
+                return TrajectoryFieldView(self, TrajectoryField(reader, field), 0, reader.GetFrames(), column);
+            },
+            py::arg("field"), py::arg("object"),
+            R"pbdoc(
+             One object's values over every frame, without a copy.
+             
+             Args:
+                 field (str): Recorded field
+                 object (int): Simulation index of the object, one of `objects`
+             
+             Returns:
+                 numpy.ndarray: Read-only strided float32 view of shape (frames,)
+             )pbdoc")
+        .def("num_chunks", [](const TrajectoryReader& reader, long long framesPerChunk) {
+                if (framesPerChunk <= 0) throw std::runtime_error("frames_per_chunk must be > 0");
+                return (reader.GetFrames() + framesPerChunk - 1) / framesPerChunk;
+            },
+            py::arg("frames_per_chunk") = 65536, "Chunks of frames_per_chunk frames chunk() splits the frames into")
+        .def("chunk", [](py::object self, long long index, long long framesPerChunk,
+                         std::optional<std::vector<std::string>> fields) {
+                const TrajectoryReader& reader = self.cast<const TrajectoryReader&>();
+                if (framesPerChunk <= 0) throw std::runtime_error("frames_per_chunk must be > 0");
+                long long first = index * framesPerChunk;
+                if (index < 0 || first >= reader.GetFrames())
+                    throw py::index_error("Chunk " + std::to_string(index) + " is past the last frame");
+                long long frames = std::min(framesPerChunk, reader.GetFrames() - first);
+
+                std::vector<int> indices;
+                for (const std::string& field : fields ? *fields : reader.GetFields())
+                    indices.push_back(TrajectoryField(reader, field));
+                reader.Prefetch(first, frames, indices);
+
+                py::dict block;
+                for (int f : indices) block[py::str(reader.GetFields()[f])] = TrajectoryFieldView(self, f, first, frames, -1);
+                py::array_t<int> steps({ static_cast<py::ssize_t>(frames) }, reader.Steps() + first, self);
+                py::array_t<float> times({ static_cast<py::ssize_t>(frames) }, reader.Times() + first, self);
+                steps.attr("flags").attr("writeable") = false;
+                times.attr("flags").attr("writeable") = false;
+                block["step"] = steps;
+                block["time"] = times;
+                return block;
+            },
+            py::arg("index"), py::arg("frames_per_chunk") = 65536, py::arg("fields") = py::none(),
+            R"pbdoc(
+             Frames [index * frames_per_chunk, (index + 1) * frames_per_chunk).
+             
+             Args:
+                 index (int): Chunk number, below num_chunks(frames_per_chunk)
+                 frames_per_chunk (int): Frames per chunk (the last may be shorter)
+                 fields (list[str]): Fields to include (default: all)
+             
+             Returns:
+                 dict: Read-only views, field -> (frames, objects), plus "step"
+                     and "time" of shape (frames,)
+             )pbdoc")
+        .def_property_readonly("steps", [](py::object self) {
+                const TrajectoryReader& reader = self.cast<const TrajectoryReader&>();
+                py::array_t<int> steps({ static_cast<py::ssize_t>(reader.GetFrames()) }, reader.Steps(), self);
+                steps.attr("flags").attr("writeable") = false;
+                return steps;
+            }, "Simulation step of every frame, a read-only view")
+        .def_property_readonly("times", [](py::object self) {
+                const TrajectoryReader& reader = self.cast<const TrajectoryReader&>();
+                py::array_t<float> times({ static_cast<py::ssize_t>(reader.GetFrames()) }, reader.Times(), self);
+                times.attr("flags").attr("writeable") = false;
+                return times;
+            }, "Simulation time of every frame, a read-only view")
+        .def_property_readonly("frames", &TrajectoryReader::GetFrames, "Complete frames on disk")
+        .def_property_readonly("fields", &TrajectoryReader::GetFields, "Recorded fields, sorted by name")
+        .def_property_readonly("objects", &TrajectoryReader::GetObjectIndices, "Recorded object indices, the columns")
+        .def_property_readonly("path", &TrajectoryReader::GetDirectory, "The trajectory directory");
+
+    // =========================================================================
+    // EXPRESSION BUILDER
+    // =========================================================================
+    py::module_ expr = m.def_submodule("expr", R"pbdoc(
+        Build equations from Python operators instead of strings.
+        
+        Every variable of the equation syntax is an attribute (expr.x, expr.vx, expr.s0),
+        functions are functions (expr.sin, expr.if_ for if), and objects are expr.p(3).vx;
+        numbers mix in freely. The expression goes to the engine already in parsed form:
+        generating thousands of equations skips formatting and parsing them.
+        
+        Example:
+            >>> from stellar import expr as se
+            >>> spring = -se.k * (se.x - se.p(0).x) - se.damping * se.vx
+            >>> sim.set_equations(ids, [se.Equation(ax=spring * (1 + 0.1 * n), ay=-se.gravity) for n in ids])
+        )pbdoc");
+
+    py::class_<BuiltExpression>(expr, "Expr", R"pbdoc(
+        A scalar expression of the equation syntax.
+        
+        Combine with +, -, *, /, ** and numbers. text is the same expression as a string,
+        which set_equation("ax = ...") would parse to the same equation.
+        )pbdoc")
+        .def(py::init<double>(), py::arg("value"), "A constant")
+        .def_readonly("text", &BuiltExpression::text, "The expression in the equation syntax")
+        .def("__add__", [](const BuiltExpression& a, const BuiltExpression& b) { return BuiltExpression::Binary(TOKEN_ADD, a, b); }, py::is_operator())
+        .def("__radd__", [](const BuiltExpression& a, const BuiltExpression& b) { return BuiltExpression::Binary(TOKEN_ADD, b, a); }, py::is_operator())
+        .def("__sub__", [](const BuiltExpression& a, const BuiltExpression& b) { return BuiltExpression::Binary(TOKEN_SUB, a, b); }, py::is_operator())
+        .def("__rsub__", [](const BuiltExpression& a, const BuiltExpression& b) { return BuiltExpression::Binary(TOKEN_SUB, b, a); }, py::is_operator())
+        .def("__mul__", [](const BuiltExpression& a, const BuiltExpression& b) { return BuiltExpression::Binary(TOKEN_MUL, a, b); }, py::is_operator())
+        .def("__rmul__", [](const BuiltExpression& a, const BuiltExpression& b) { return BuiltExpression::Binary(TOKEN_MUL, b, a); }, py::is_operator())
+        .def("__truediv__", [](const BuiltExpression& a, const BuiltExpression& b) { return BuiltExpression::Binary(TOKEN_DIV, a, b); }, py::is_operator())
+        .def("__rtruediv__", [](const BuiltExpression& a, const BuiltExpression& b) { return BuiltExpression::Binary(TOKEN_DIV, b, a); }, py::is_operator())
+        .def("__pow__", [](const BuiltExpression& a, const BuiltExpression& b) { return BuiltExpression::Binary(TOKEN_POW, a, b); }, py::is_operator())
+        .def("__rpow__", [](const BuiltExpression& a, const BuiltExpression& b) { return BuiltExpression::Binary(TOKEN_POW, b, a); }, py::is_operator())
+        .def("__neg__", &BuiltExpression::Negate)
+        .def("__pos__", [](const BuiltExpression& a) { return a; })
+        .def("__bool__", [](const BuiltExpression&) -> bool {
+                throw py::type_error("An Expr has no truth value; use expr.if_(condition, a, b)");
+            })
+        .def("__repr__", [](const BuiltExpression& e) { return "Expr(" + e.text + ")"; });
+    py::implicitly_convertible<double, BuiltExpression>();
+
+    py::class_<ExprObjectRef>(expr, "ObjectRef", "Properties of one object: x, y, vx, vy, ax, ay, mass, charge, data_x .. data_w, color_r .. color_a")
+        .def_readonly("index", &ExprObjectRef::index)
+        .def("__getattr__", [](const ExprObjectRef& ref, std::string property) {
+                // data.x and color.r read as data_x and color_r
+                size_t underscore = property.find('_');
+                if (underscore != std::string::npos) property[underscore] = '.';
+                try { return BuiltExpression::ObjectProperty(ref.index, property); }
+                catch (const std::invalid_argument& e) { throw py::attribute_error(e.what()); }
+            })
+        .def("__repr__", [](const ExprObjectRef& ref) { return "p[" + std::to_string(ref.index) + "]"; });
+
+    expr.def("var", &BuiltExpression::Variable, py::arg("name"), "Variable name of the equation syntax, e.g. var(\"sph_rho\")");
+    expr.def("param", [](int k) { return BuiltExpression::Variable("$" + std::to_string(k)); }, py::arg("k"),
+             "Per-object parameter $k (see Simulation.set_parameters)");
+    expr.def("p", [](int index) {
+            if (index < 0) throw std::invalid_argument("Object references need an index >= 0");
+            return ExprObjectRef{ index };
+        }, py::arg("index"), "Object index, as p[index] in equations");
+
+    for (const char* name : { "sin", "cos", "tan", "sqrt", "log", "exp", "abs", "floor", "ceil", "frac", "sign", "step",
+                              "real", "imag", "conj", "arg" })
+        expr.def(name, [name](const BuiltExpression& a) { return BuiltExpression::Call(name, { a }); }, py::arg("a"));
+    for (const char* name : { "min", "max", "mod", "atan2", "table" })
+        expr.def(name, [name](const BuiltExpression& a, const BuiltExpression& b) {
+                return BuiltExpression::Call(name, { a, b });
+            }, py::arg("a"), py::arg("b"));
+    expr.def("clamp", [](const BuiltExpression& a, const BuiltExpression& lo, const BuiltExpression& hi) {
+            return BuiltExpression::Call("clamp", { a, lo, hi });
+        }, py::arg("a"), py::arg("lo"), py::arg("hi"));
+    expr.def("field", [](const BuiltExpression& id, const BuiltExpression& x, const BuiltExpression& y) {
+            return BuiltExpression::Call("field", { id, x, y });
+        }, py::arg("id"), py::arg("x"), py::arg("y"), "Bilinear sample of lookup field id (see Simulation.set_field)");
+    expr.def("if_", [](const BuiltExpression& condition, const BuiltExpression& a, const BuiltExpression& b) {
+            return BuiltExpression::Call("if", { condition, a, b });
+        }, py::arg("condition"), py::arg("a"), py::arg("b"), "if(condition, a, b) of the equation syntax");
+    // Variables resolve on first access, so the module follows the parser's list (set last: def() looks names up)
+    expr.attr("__getattr__") = py::cpp_function([](const std::string& name) {
+            try { return BuiltExpression::Variable(name); }
+            catch (const std::invalid_argument& e) { throw py::attribute_error(e.what()); }
+        }, py::arg("name"));
+
+    py::class_<BuiltEquation>(expr, "Equation", R"pbdoc(
+        The components of one equation, for Simulation.set_equation and set_equations.
+        
+        Args:
+            ax, ay, angular (Expr): Accelerations; left out ones are as in an equation without them
+            color (tuple[Expr]): color.r, color.g, color.b and optionally color.a
+            state (dict[int, Expr]): Updates of state registers sK
+        )pbdoc")
+        .def(py::init([](std::optional<BuiltExpression> ax, std::optional<BuiltExpression> ay,
+                         std::optional<BuiltExpression> angular, const std::vector<BuiltExpression>& color,
+                         const std::map<int, BuiltExpression>& state) {
+                BuiltEquation eq;
+                if (ax) eq.ax = *ax;
+                if (ay) eq.ay = *ay;
+                if (angular) eq.angular = *angular;
+                if (!color.empty() && color.size() != 3 && color.size() != 4)
+                    throw std::invalid_argument("color takes 3 or 4 expressions");
+                BuiltExpression* channels[] = { &eq.r, &eq.g, &eq.b, &eq.a };
+                for (size_t c = 0; c < color.size(); c++) *channels[c] = color[c];
+                for (const auto& entry : state)
+                {
+                    if (entry.first < 0 || entry.first >= MAX_STATE_REGISTERS)
+                        throw std::invalid_argument("State registers are s0 .. s" + std::to_string(MAX_STATE_REGISTERS - 1));
+                    eq.state[entry.first] = entry.second;
+                }
+                if (eq.Key().empty()) throw std::invalid_argument("An equation needs at least one component");
+                return eq;
+            }), py::arg("ax") = py::none(), py::arg("ay") = py::none(), py::arg("angular") = py::none(),
+            py::arg("color") = std::vector<BuiltExpression>(), py::arg("state") = std::map<int, BuiltExpression>())
+        .def_property_readonly("text", &BuiltEquation::Key, "The equation in statement form, its registration key")
+        .def("__repr__", [](const BuiltEquation& eq) { return "Equation(" + eq.Key() + ")"; });
+
     // =========================================================================
     // CONSTRAINT TYPES
     // =========================================================================
@@ -240,13 +1097,19 @@ PYBIND11_MODULE(stellar, m)
         Args:
             target_object (int): ID of target object to maintain distance with
             rest_length (float): Desired distance between objects
+            break_length (float): The constraint is dropped once the objects are
+                further apart than this, for tearing cloth and breaking joints;
+                0 (default) never breaks. Breakable constraints are solved by the
+                per-object pass even with XPBD, and are not supported by run_batch_cpu.
         )pbdoc")
-        .def(py::init<int, float>(),
+        .def(py::init<int, float, float>(),
             py::arg("target_object") = 0,
             py::arg("rest_length") = 5.0f,
+            py::arg("break_length") = 0.0f,
             "Create distance constraint")
         .def_readwrite("target_object", &DistanceConstraint::target_object, "Target object ID")
         .def_readwrite("rest_length", &DistanceConstraint::rest_length, "Desired distance")
+        .def_readwrite("break_length", &DistanceConstraint::break_length, "Distance it breaks at, 0 = never")
         .def("__repr__", [](const DistanceConstraint& c) {
         return "<DistanceConstraint target=" + std::to_string(c.target_object) +
             " length=" + std::to_string(c.rest_length) + ">";
@@ -288,12 +1151,18 @@ PYBIND11_MODULE(stellar, m)
             shape (CollisionShape): Collision shape type
             restitution (float): Bounciness (0.0 = no bounce, 1.0 = perfect bounce)
             friction (float): Surface friction (0.0 = frictionless, 1.0 = maximum friction)
+            category (int): Category bits this object belongs to
+            mask (int): Categories this object collides with
+            continuous (bool): Whether swept collision tests are on (see set_continuous_collision)
         )pbdoc")
         .def(py::init<>(), "Create default collision config")
         .def_readwrite("enabled", &CollisionConfig::enabled, "Collision enabled")
         .def_readwrite("shape", &CollisionConfig::shape, "Collision shape type")
         .def_readwrite("restitution", &CollisionConfig::restitution, "Bounciness (0.0-1.0)")
         .def_readwrite("friction", &CollisionConfig::friction, "Surface friction (0.0-1.0)")
+        .def_readwrite("category", &CollisionConfig::category, "Collision category bits")
+        .def_readwrite("mask", &CollisionConfig::mask, "Categories this object collides with")
+        .def_readwrite("continuous", &CollisionConfig::continuous, "Swept collision tests enabled")
         .def("__repr__", [](const CollisionConfig& c) {
         std::string shapeStr;
         switch (c.shape) {
@@ -315,6 +1184,18 @@ PYBIND11_MODULE(stellar, m)
         
         Provides real-time physics simulation with GPU acceleration.
         Can run in headless mode (no window) or with OpenGL visualization.
+        
+        Threading: the OpenGL context is current on the thread that created
+        the simulation, so call every method from that thread and never
+        from two threads at once. update(), run_batch(), save_to_file()
+        and load_from_file() release the GIL while they run, so other
+        Python threads keep going while the GPU steps.
+        
+        One simulation per process: the engine's GPU state is shared by
+        the process, so a second Simulation raises until the first one's
+        cleanup(). Independent systems run as worlds of one simulation
+        (run_batch with ensemble=True) or one process each
+        (run_batch_parallel).
         )pbdoc")
         .def(py::init<bool, int, int, std::string, bool>(),
             py::arg("headless") = true,
@@ -327,6 +1208,9 @@ PYBIND11_MODULE(stellar, m)
              
              Args:
                  headless (bool): Run without graphical window. Default: True.
+                     On Linux the context comes from EGL and needs no X or
+                     Wayland server; STELLAR_EGL_DEVICE selects the GPU and
+                     STELLAR_HEADLESS=glfw forces a hidden GLFW window.
                  width (int): Window width in pixels. Default: 1280.
                  height (int): Window height in pixels. Default: 720.
                  title (str): Window title. Default: "Physics Simulation".
@@ -339,12 +1223,45 @@ PYBIND11_MODULE(stellar, m)
 
         // Window management
         .def("render", &SimulationWrapper::render,
-            "Render the current frame to the window (visual mode only)")
+            "Render the current frame to the window, and to the video while capturing")
         .def("process_input", &SimulationWrapper::process_input,
             "Process window input and camera controls (visual mode only)")
         .def("should_close", &SimulationWrapper::should_close,
             "Check if window should close (visual mode only)")
 
+        .def("start_capture", &SimulationWrapper::start_capture,
+            py::arg("path"), py::arg("fps") = 30, py::arg("resolution") = std::make_tuple(0, 0),
+            R"pbdoc(
+             Record what render() draws to a video file, also when headless.
+             
+             Every render() call adds one frame, drawn offscreen at the capture
+             resolution. Frames come back through a ring of pixel buffers that
+             is only read once the GPU has finished with it, and are encoded by
+             an ffmpeg process on a background thread, so render() rarely waits.
+             ffmpeg must be on PATH, or STELLAR_FFMPEG must name it. Replaces
+             a capture in progress.
+             
+             Args:
+                 path (str): Output file; the extension picks the container (.mp4, .mkv, ...)
+                 fps (int): Playback frame rate (default 30)
+                 resolution (tuple[int, int]): Even (width, height), (0, 0) = window size
+             )pbdoc")
+
+        .def("stop_capture", &SimulationWrapper::stop_capture,
+            py::call_guard<py::gil_scoped_release>(),
+            R"pbdoc(
+             Encode the frames still in flight and finish the video.
+             
+             Returns:
+                 int: Frames written
+             
+             Raises:
+                 RuntimeError: If the encoder failed or could not be started
+             )pbdoc")
+
+        .def("is_capturing", &SimulationWrapper::is_capturing,
+            "True between start_capture() and stop_capture()")
+
         // Grid control
         .def("set_grid_enabled", &SimulationWrapper::set_grid_enabled,
             py::arg("enabled"),
@@ -363,82 +1280,642 @@ PYBIND11_MODULE(stellar, m)
                  bool: True if grid is enabled, False otherwise
              )pbdoc")
 
-        // Core simulation
-        .def("update", &SimulationWrapper::update,
-            py::arg("dt") = 0.016f,
+        .def("set_trails", &SimulationWrapper::set_trails,
+            py::arg("object_count"), py::arg("length") = 64,
             R"pbdoc(
-             Update physics simulation by dt seconds.
+             Draw position trails behind the first object_count objects.
+             
+             The last length positions of each are kept in a ring on the GPU,
+             one per update(), and render() draws them as fading lines. Nothing
+             is read back. Changing the settings clears the trails.
              
              Args:
-                 dt (float): Time step in seconds. Default: 0.016 (approx 60 FPS).
-                 
-             Example:
-                 >>> sim.update(dt=0.01)  # Update with 10ms time step
+                 object_count (int): Objects with a trail, 0 = no trails (the default)
+                 length (int): Positions per trail, 2 to 1024 (default 64)
              )pbdoc")
 
-        // Object management
-        .def("add_object", &SimulationWrapper::add_object,
-            py::arg("x") = 0.0f, py::arg("y") = 0.0f,
-            py::arg("vx") = 0.0f, py::arg("vy") = 0.0f,
-            py::arg("mass") = 1.0f, py::arg("charge") = 0.0f,
-            py::arg("rotation") = 0.0f, py::arg("angular_velocity") = 0.0f,
-            py::arg("skin") = PySkinType::PY_SKIN_CIRCLE,
-            py::arg("size") = 0.3f,
-            py::arg("width") = 0.5f, py::arg("height") = 0.3f,
-            py::arg("r") = 1.0f, py::arg("g") = 1.0f,
-            py::arg("b") = 1.0f, py::arg("a") = 1.0f,
-            py::arg("polygon_sides") = 6,
+        .def("get_trails", &SimulationWrapper::get_trails,
+            "Trail settings as (object_count, length)")
+
+        .def("set_force_field", &SimulationWrapper::set_force_field,
+            py::arg("ax"), py::arg("ay"), py::arg("bounds") = std::make_tuple(-10.0f, 10.0f, -10.0f, 10.0f),
+            py::arg("resolution") = std::make_tuple(64, 64), py::arg("scale") = 0.1f,
             R"pbdoc(
-             Add an object with full property control.
+             Draw arrows of an acceleration field behind the objects.
+             
+             ax and ay are written like equations and evaluated on the GPU at
+             every render() on a grid of sample points, each a probe at rest
+             with unit mass and charge, so p[i].x and friends see the live
+             objects. The arrows never leave the GPU. sum_j, nsum and other
+             step-only inputs are not available. Replaces any field set before.
              
              Args:
-                 x,y (float): Initial position
-                 vx,vy (float): Initial velocity
-                 mass (float): Object mass. Default: 1.0
-                 charge (float): Electric charge. Default: 0.0
-                 rotation (float): Initial rotation in radians. Default: 0.0
-                 angular_velocity (float): Angular velocity in rad/s. Default: 0.0
-                 skin (SkinType): Visual type. Default: CIRCLE
-                 size (float): General size. Default: 0.3
-                 width,height (float): Dimensions for rectangles. Default: 0.5, 0.3
-                 r,g,b,a (float): Color (0.0-1.0). Default: white (1,1,1,1)
-                 polygon_sides (int): Polygon sides. Default: 6
-                 
-             Returns:
-                 int: Object ID for future reference
-                 
-             Example:
-                 >>> obj_id = sim.add_object(x=10, y=5, mass=50, skin=SkinType.CIRCLE)
+                 ax (str): Horizontal acceleration, e.g. "-k*x"
+                 ay (str): Vertical acceleration
+                 bounds (tuple[float, float, float, float]): (x_min, x_max, y_min, y_max) sampled
+                 resolution (tuple[int, int]): Sample (columns, rows), default (64, 64)
+                 scale (float): Arrow length per unit of acceleration, capped at a cell
              )pbdoc")
 
-        .def("update_object", &SimulationWrapper::update_object,
-            py::arg("index"),
-            py::arg("x"), py::arg("y"),
-            py::arg("vx"), py::arg("vy"),
-            py::arg("mass"), py::arg("charge"),
-            py::arg("rotation"), py::arg("angular_velocity"),
-            py::arg("width"), py::arg("height"),
-            py::arg("r"), py::arg("g"), py::arg("b"), py::arg("a"),
+        .def("clear_force_field", &SimulationWrapper::clear_force_field,
+            "Stop drawing the force field")
+
+        .def("set_render_interpolation", &SimulationWrapper::set_render_interpolation,
+            py::arg("enabled"),
             R"pbdoc(
-             Update all properties of an existing object.
+             Draw objects between the last two physics steps.
+             
+             render() blends position and rotation from the state before the
+             newest step, by the time update() has left over, so motion stays
+             smooth with fewer steps per frame. The display runs up to one step
+             behind. Host edits since the last step, pipelined frames and
+             adaptive steps draw the newest state as it is.
              
              Args:
-                 index (int): Object ID
-                 x,y,vx,vy,mass,charge,rotation,angular_velocity: Updated properties
-                 width,height: Updated dimensions
-                 r,g,b,a: Updated color
+                 enabled (bool): Interpolate, off by default
              )pbdoc")
 
-        // Batch operations
-        .def("batch_get", &SimulationWrapper::batch_get,
-            py::arg("indices"),
+        .def("get_render_interpolation", &SimulationWrapper::get_render_interpolation,
+            "True if render() interpolates between steps")
+
+        .def("get_interpolation_fraction", &SimulationWrapper::get_interpolation_fraction,
             R"pbdoc(
-             Get properties for multiple objects at once.
+             How far into the newest step the next render() draws, from 0 to 1.
+             
+             update() sets it from the time it has left over when render
+             interpolation is on. 1.0 draws the newest state as it is.
+             )pbdoc")
+
+        .def("set_density_rendering", &SimulationWrapper::set_density_rendering,
+            py::arg("enabled"), py::arg("exposure") = 8.0f,
+            R"pbdoc(
+             Draw objects as additive point splats instead of their skins.
+             
+             Every object adds its colour to the pixel under its centre in a
+             float target, which is tone-mapped to the mean colour per pixel,
+             brighter where more objects land. The cost is one point per object
+             whatever the skin, for scenes of a million objects and more.
+             View culling and render interpolation do not apply.
              
              Args:
-                 indices (list[int]): List of object indices to fetch
-                 
-             Returns:
+                 enabled (bool): Splat points, off by default
+                 exposure (float): Objects per pixel at which brightness is ~63% up
+             
+             Raises:
+                 RuntimeError: If exposure is not positive
+             )pbdoc")
+
+        .def("get_density_rendering", &SimulationWrapper::get_density_rendering,
+            "(enabled, exposure) of density rendering")
+
+        .def("set_constraint_rendering", &SimulationWrapper::set_constraint_rendering,
+            py::arg("enabled"), py::arg("strain_scale") = 0.1f,
+            R"pbdoc(
+             Draw every distance constraint as a line between its two objects.
+             
+             One draw call reads the constraint and object buffers on the GPU,
+             so constraints that break and objects that move show at the next
+             render() without a readback. Lines are white at rest length, red
+             when stretched and blue when compressed.
+             
+             Args:
+                 enabled (bool): Draw the lines, off by default
+                 strain_scale (float): Relative stretch drawn at full colour (default 0.1)
+             
+             Raises:
+                 RuntimeError: If strain_scale is not positive
+             )pbdoc")
+
+        .def("get_constraint_rendering", &SimulationWrapper::get_constraint_rendering,
+            "(enabled, strain_scale) of constraint rendering")
+
+        .def("set_profiling", &SimulationWrapper::set_profiling,
+            py::arg("enabled"),
+            R"pbdoc(
+             Turn the GPU pass timers on or off and clear the collected timings.
+             
+             Args:
+                 enabled (bool): Time passes, on by default
+             )pbdoc")
+
+        .def("get_profile", &SimulationWrapper::get_profile,
+            R"pbdoc(
+             Rolling per-pass timings in milliseconds.
+             
+             "gpu" maps each timed pass (integrate, constraints, collisions,
+             post_step, draw, axis) to its mean GPU time over the last 32
+             samples, from timer queries collected a few frames late without
+             waiting. "cpu" holds host timings, such as update().
+             Passes that have not run yet are missing.
+             
+             Returns:
+                 dict[str, dict[str, float]]: {"gpu": {...}, "cpu": {...}}
+             )pbdoc")
+
+        .def("set_step_budget", &SimulationWrapper::set_step_budget,
+            py::arg("budget_ms") = 0.0f, py::arg("max_steps") = 20, py::arg("max_lag") = 0.0f,
+            R"pbdoc(
+             Limit the steps update() runs to a wall-clock budget.
+             
+             update() owes one step per "timestep" (set_parameter) of the time
+             it is given. The steps are timed with GPU timer queries, read a
+             few updates late without waiting, and each update runs as many
+             of the owed steps as fit the budget at the measured time per
+             step (at least one, at most max_steps). Steps that do not fit
+             carry over as lag; lag beyond max_lag is dropped and counted
+             (see get_step_stats).
+             
+             Args:
+                 budget_ms (float): Milliseconds of stepping per update, 0 = no budget
+                 max_steps (int): Steps per update at most, default 20
+                 max_lag (float): Simulated seconds the scene may fall behind
+                     before the rest is dropped, 0 = never drop
+             
+             Raises:
+                 RuntimeError: If budget_ms or max_lag is negative or max_steps is below 1
+             )pbdoc")
+
+        .def("get_step_stats", &SimulationWrapper::get_step_stats,
+            R"pbdoc(
+             How update() keeps up with real time.
+             
+             "steps" is what the last update ran, "step_ms" the smoothed
+             time of one step (0 until measured), "budget_ms" and
+             "max_steps" the settings of set_step_budget, "lag" the
+             simulated seconds still owed in whole steps and "dropped" the
+             simulated seconds given up to max_lag so far. A lag that keeps
+             growing means the scene cannot run in real time.
+             
+             Returns:
+                 dict[str, float]: {"steps", "step_ms", "budget_ms", "max_steps", "lag", "dropped"}
+             )pbdoc")
+
+        .def("set_counters", &SimulationWrapper::set_counters,
+            py::arg("enabled"), py::arg("interval") = 16,
+            R"pbdoc(
+             Count the work of the simulation passes on the GPU.
+             
+             math.comp, constraints.comp and collide.comp add up what they
+             did; every `interval` steps the counts are copied off the GPU
+             and cleared, and get_counters() returns the last copy that has
+             arrived, without waiting for the GPU. Off by default.
+             
+             Args:
+                 enabled (bool): Count work
+                 interval (int): Steps per read, default 16
+             
+             Raises:
+                 RuntimeError: If interval is below 1
+             )pbdoc")
+
+        .def("get_counters", &SimulationWrapper::get_counters,
+            R"pbdoc(
+             Work counts of the last read interval.
+             
+             The totals are "steps" (the steps they cover, 0 before the
+             first read), "interval" (the read interval set_counters set,
+             which later reads will cover), "tokens" (equation tokens or register
+             instructions run, pair reduction bodies included), "equations"
+             (evaluations, one per object per integrator stage), "pair_tests"
+             and "contacts" (narrowphase), "constraint_solves" (per-object
+             constraint pass, iterations included) and "sanitized" (NaN/Inf
+             values replaced by the safe-math guards). Compiled equations
+             run no tokens.
+             
+             Returns:
+                 tuple[dict[str, float], list[float]]: Totals, and evaluations per equation ID
+             )pbdoc")
+
+        .def("set_collision_events", &SimulationWrapper::set_collision_events,
+            py::arg("enabled"), py::arg("category_mask") = 0xFFFFFFFFu,
+            py::arg("capacity") = ContactEvents::CONTACT_EVENTS_DEFAULT_CAPACITY,
+            R"pbdoc(
+             Stream the touching pairs of every step off the GPU.
+             
+             The narrowphase (or the contact solver, when it resolves the
+             pairs) appends each touching pair once per step; after each
+             step the events are copied off the GPU without waiting for it,
+             and collision_events() hands over what has arrived. Off by default.
+             
+             Args:
+                 enabled (bool): Record events; turning it on drops any pending ones
+                 category_mask (int): Only pairs with an object in one of these
+                     collision categories, default all
+                 capacity (int): Events the GPU buffer holds between copies,
+                     default 16384; further ones are counted as dropped
+             
+             Raises:
+                 RuntimeError: If capacity is below 1
+             )pbdoc")
+
+        .def("collision_events", [](SimulationWrapper& self)
+            {
+                std::vector<ContactEvent> events = self.take_collision_events();
+                py::array records(ContactEventDtype(), std::vector<py::ssize_t>{ static_cast<py::ssize_t>(events.size()) });
+                if (!events.empty()) std::memcpy(records.mutable_data(), events.data(), events.size() * sizeof(ContactEvent));
+                return records;
+            },
+            R"pbdoc(
+             Collision events that have arrived since the last call, oldest first.
+             
+             Events reach the host a step or two after they happen. Fields are
+             "a" and "b" (object IDs), "normal" (from a to b), "impulse" (normal
+             impulse of the response, 0 for a separating pair) and "penetration".
+             Object IDs are those of the step that produced the event.
+             
+             Returns:
+                 numpy.ndarray: Structured array, one record per event
+             )pbdoc")
+
+        .def("get_dropped_collision_events", &SimulationWrapper::get_dropped_collision_events,
+            "Collision events that did not fit the buffer since the stream was turned on")
+
+        .def("memory_report", &SimulationWrapper::memory_report,
+            R"pbdoc(
+             Bytes held by the simulation's buffers and host structures.
+             
+             One row per object, equation, constraint and readback buffer
+             on the GPU and per host-side mirror. Per-object buffers count
+             the live objects' share of their capacity as used; staging
+             copies and fixed-size buffers count all of it. Buffers of the
+             broadphase, trails and other helper passes are not listed.
+             
+             Returns:
+                 list[tuple[str, str, int, int]]: (name, "gpu" or "host", capacity bytes, used bytes)
+             )pbdoc")
+
+        .def("start_trace", &SimulationWrapper::start_trace,
+            R"pbdoc(
+             Start capturing trace zones, dropping any earlier capture.
+             
+             Zones cover update(), the simulation passes, readbacks and
+             shader loading; timed GPU passes appear on their own track.
+             Only builds with STELLAR_TRACING record zones.
+             
+             Raises:
+                 RuntimeError: If tracing is not compiled in
+             )pbdoc")
+
+        .def("stop_trace", &SimulationWrapper::stop_trace,
+            py::arg("path"),
+            R"pbdoc(
+             Stop the capture and write it as Chrome trace JSON.
+             
+             Open the file in chrome://tracing or ui.perfetto.dev.
+             
+             Args:
+                 path (str): Output file
+             
+             Raises:
+                 RuntimeError: If no capture is running or the file cannot be written
+             )pbdoc")
+
+        // Core simulation
+        .def("update", &SimulationWrapper::update,
+            py::arg("dt") = 0.016f,
+            py::call_guard<py::gil_scoped_release>(),
+            R"pbdoc(
+             Update physics simulation by dt seconds.
+             
+             Releases the GIL for the whole sub-stepping loop; other Python
+             threads run meanwhile but must not use this simulation; they submit
+             to sim.commands instead, which this runs first.
+             
+             Args:
+                 dt (float): Time step in seconds. Default: 0.016 (approx 60 FPS).
+                 
+             Example:
+                 >>> sim.update(dt=0.01)  # Update with 10ms time step
+             )pbdoc")
+        .def("step", &SimulationWrapper::step,
+            py::arg("n_steps") = 1,
+            py::call_guard<py::gil_scoped_release>(),
+            R"pbdoc(
+             Run exactly n_steps fixed steps of the current timestep.
+             
+             Unlike update() there is no accumulator and no step budget: the
+             time update() is owed is left as it is.
+             
+             Args:
+                 n_steps (int): Steps to run. Default: 1.
+                 
+             Returns:
+                 int: Steps run (0 while paused)
+             )pbdoc")
+        .def_property_readonly("commands", &SimulationWrapper::commands,
+            "CommandQueue other Python threads submit mutations and queries to")
+        .def("process_commands", &SimulationWrapper::process_commands,
+            py::call_guard<py::gil_scoped_release>(),
+            R"pbdoc(
+             Run the commands other threads submitted to Simulation.commands
+             without stepping; update(), step() and step_async() run them
+             first anyway.
+             
+             Returns:
+                 int: Commands run
+             )pbdoc")
+        .def("step_async", &SimulationWrapper::step_async,
+            py::arg("n_steps") = 1,
+            py::call_guard<py::gil_scoped_release>(),
+            R"pbdoc(
+             Submit n_steps fixed steps and return without waiting for the GPU.
+             
+             The steps are those step() runs, without the error check at the
+             end; prepare the next inputs while the handle is pending.
+             
+             Args:
+                 n_steps (int): Steps to submit. Default: 1.
+                 
+             Returns:
+                 StepHandle: ready(), wait(), or await it in asyncio
+                 
+             Example:
+                 >>> handle = sim.step_async(100)
+                 >>> forces = compute_next_forces()  # Overlaps the GPU work
+                 >>> await handle                    # Or handle.wait()
+             )pbdoc")
+
+        .def("step_streamed",
+            [](SimulationWrapper& self, const py::array& x, const py::array& y, const py::array& vx, const py::array& vy,
+               int n_steps, int group, const py::object& mass, const py::object& charge,
+               const py::object& ax, const py::object& ay, int chunk)
+            {
+                StreamedParticles particles;
+                size_t count = SIZE_MAX;  // Set by x
+                particles.x = StreamColumn(x, "x", count);
+                particles.y = StreamColumn(y, "y", count);
+                particles.vx = StreamColumn(vx, "vx", count);
+                particles.vy = StreamColumn(vy, "vy", count);
+                if (!ax.is_none()) particles.ax = StreamColumn(ax.cast<py::array>(), "ax", count);
+                if (!ay.is_none()) particles.ay = StreamColumn(ay.cast<py::array>(), "ay", count);
+                particles.count = count;
+
+                // Read-only columns may be converted; a converted copy is kept alive until the call returns
+                py::array_t<float, py::array::c_style | py::array::forcecast> masses, charges;
+                auto readColumn = [count](const py::object& value, const char* name, float& single,
+                                          py::array_t<float, py::array::c_style | py::array::forcecast>& held) -> const float*
+                {
+                    if (value.is_none()) return nullptr;
+                    held = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(value);
+                    if (!held) throw std::runtime_error(std::string("step_streamed: ") + name + " must be numeric");
+                    if (held.size() == 1)
+                    {
+                        single = held.data()[0];
+                        return nullptr;
+                    }
+                    if (static_cast<size_t>(held.size()) != count)
+                        throw std::runtime_error(std::string("step_streamed: ") + name + " must be one value or one per particle");
+                    return held.data();
+                };
+                particles.mass = readColumn(mass, "mass", particles.massValue, masses);
+                particles.charge = readColumn(charge, "charge", particles.chargeValue, charges);
+
+                py::gil_scoped_release release;
+                return self.step_streamed(particles, n_steps, group, chunk);
+            },
+            py::arg("x"), py::arg("y"), py::arg("vx"), py::arg("vy"), py::arg("n_steps"), py::arg("group"),
+            py::arg("mass") = py::none(), py::arg("charge") = py::none(),
+            py::arg("ax") = py::none(), py::arg("ay") = py::none(),
+            py::arg("chunk") = STREAM_DEFAULT_CHUNK,
+            R"pbdoc(
+             Advance independent particles that do not fit on the GPU by n_steps steps.
+             
+             The particles live in the arrays, which may be numpy.memmap views of
+             files. They are cut into chunks of chunk particles; each chunk is
+             packed into a mapped staging buffer, copied into the object buffers,
+             stepped in one fused dispatch and copied back, with three chunks in
+             flight so packing and unpacking on the host overlap the GPU. Every
+             chunk runs the same steps from the same clock, which then advances as
+             step(n_steps) would. Every particle runs the equation of behaviour
+             group group (see set_group_equation); rand()/randn() draw differently
+             per chunk, so the draws depend on the chunk size.
+             
+             The scene must hold no objects, and nothing may couple particles:
+             constraints, collisions, p[i] reads, sum_j, aggregates, grid fields,
+             sleeping, emitters, ensemble worlds, recording, trails, state
+             registers and the adaptive timestep are refused.
+             
+             Args:
+                 x,y,vx,vy (numpy.ndarray): float32 C-contiguous writeable arrays,
+                     one value per particle, advanced in place
+                 n_steps (int): Steps every particle advances
+                 group (int): Behaviour group whose equation the particles run
+                 mass,charge: One value for all, one per particle, or None (1)
+                 ax,ay (numpy.ndarray): Optional float32 arrays of the previous
+                     accelerations integrators read, carried between calls in place
+                 chunk (int): Particles per chunk. Default: 1048576
+                 
+             Returns:
+                 int: Steps taken
+                 
+             Raises:
+                 RuntimeError: If an array is not float32, contiguous and writeable
+                     or sizes differ, the group has no equation, the scene holds
+                     objects or anything would couple the particles
+                 
+             Example:
+                 >>> n = 50_000_000
+                 >>> x = np.memmap("x.f32", np.float32, "w+", shape=n)  # Likewise y, vx, vy
+                 >>> sim.set_group_equation(0, "vx, vy, -x, -y")
+                 >>> sim.step_streamed(x, y, vx, vy, 1000, group=0)
+             )pbdoc")
+
+        // Object management
+        .def("add_object", &SimulationWrapper::add_object,
+            py::arg("x") = 0.0f, py::arg("y") = 0.0f,
+            py::arg("vx") = 0.0f, py::arg("vy") = 0.0f,
+            py::arg("mass") = 1.0f, py::arg("charge") = 0.0f,
+            py::arg("rotation") = 0.0f, py::arg("angular_velocity") = 0.0f,
+            py::arg("skin") = PySkinType::PY_SKIN_CIRCLE,
+            py::arg("size") = 0.3f,
+            py::arg("width") = 0.5f, py::arg("height") = 0.3f,
+            py::arg("r") = 1.0f, py::arg("g") = 1.0f,
+            py::arg("b") = 1.0f, py::arg("a") = 1.0f,
+            py::arg("polygon_sides") = 6,
+            R"pbdoc(
+             Add an object with full property control.
+             
+             Args:
+                 x,y (float): Initial position
+                 vx,vy (float): Initial velocity
+                 mass (float): Object mass. Default: 1.0
+                 charge (float): Electric charge. Default: 0.0
+                 rotation (float): Initial rotation in radians. Default: 0.0
+                 angular_velocity (float): Angular velocity in rad/s. Default: 0.0
+                 skin (SkinType): Visual type. Default: CIRCLE
+                 size (float): General size. Default: 0.3
+                 width,height (float): Dimensions for rectangles. Default: 0.5, 0.3
+                 r,g,b,a (float): Color (0.0-1.0). Default: white (1,1,1,1)
+                 polygon_sides (int): Polygon sides. Default: 6
+                 
+             Returns:
+                 int: Object ID for future reference
+                 
+             Example:
+                 >>> obj_id = sim.add_object(x=10, y=5, mass=50, skin=SkinType.CIRCLE)
+             )pbdoc")
+
+        .def("add_objects",
+            [](SimulationWrapper& self, const py::object& x, const py::object& y,
+               const py::object& vx, const py::object& vy, const py::object& mass, const py::object& charge,
+               const py::object& rotation, const py::object& angular_velocity, PySkinType skin,
+               const py::object& size, const py::object& width, const py::object& height,
+               const py::object& r, const py::object& g, const py::object& b, const py::object& a,
+               int polygon_sides)
+            {
+                BulkObjectData data;
+                data.x = BulkColumn(x, "x");
+                data.y = BulkColumn(y, "y");
+                data.vx = BulkColumn(vx, "vx");
+                data.vy = BulkColumn(vy, "vy");
+                data.mass = BulkColumn(mass, "mass");
+                data.charge = BulkColumn(charge, "charge");
+                data.rotation = BulkColumn(rotation, "rotation");
+                data.angular_velocity = BulkColumn(angular_velocity, "angular_velocity");
+                data.size = BulkColumn(size, "size");
+                data.width = BulkColumn(width, "width");
+                data.height = BulkColumn(height, "height");
+                data.r = BulkColumn(r, "r");
+                data.g = BulkColumn(g, "g");
+                data.b = BulkColumn(b, "b");
+                data.a = BulkColumn(a, "a");
+                data.skin = skin;
+                data.polygon_sides = polygon_sides;
+                return self.add_objects(data);
+            },
+            py::arg("x"), py::arg("y"),
+            py::arg("vx") = py::none(), py::arg("vy") = py::none(),
+            py::arg("mass") = py::none(), py::arg("charge") = py::none(),
+            py::arg("rotation") = py::none(), py::arg("angular_velocity") = py::none(),
+            py::arg("skin") = PySkinType::PY_SKIN_CIRCLE,
+            py::arg("size") = py::none(),
+            py::arg("width") = py::none(), py::arg("height") = py::none(),
+            py::arg("r") = py::none(), py::arg("g") = py::none(),
+            py::arg("b") = py::none(), py::arg("a") = py::none(),
+            py::arg("polygon_sides") = 6,
+            R"pbdoc(
+             Add many objects at once from NumPy arrays.
+             
+             Args:
+                 x,y (array): Positions, one value per object (their length is the object count)
+                 vx,vy,mass,charge,rotation,angular_velocity,size,width,height,r,g,b,a:
+                     One value per object, a single value for all, or None for the
+                     add_object default
+                 skin (SkinType): Visual type of every new object. Default: CIRCLE
+                 polygon_sides (int): Polygon sides. Default: 6
+                 
+             Returns:
+                 int: ID of the first new object; the others follow consecutively
+                 
+             The objects go up in one upload per buffer, with collision shapes assigned
+             from the skin as add_object does.
+                 
+             Example:
+                 >>> first = sim.add_objects(x=np.random.rand(100000), y=np.random.rand(100000), size=0.01)
+             )pbdoc")
+
+        .def("spawn",
+            [](SimulationWrapper& self, int n, const std::string& distribution, std::pair<float, float> center,
+               float extent, const std::string& velocity, const std::string& equation,
+               const std::string& derivative_method, PySkinType skin, float size, float width, float height,
+               float mass, float charge, float r, float g, float b, float a, int polygon_sides,
+               int columns, unsigned int seed)
+            {
+                SpawnRequest request;
+                request.count = n;
+                request.distribution = distribution;
+                request.center[0] = center.first;
+                request.center[1] = center.second;
+                request.extent = extent;
+                request.columns = columns;
+                request.seed = seed;
+                request.velocity = velocity;
+                request.equation = equation;
+                request.derivative_method = derivative_method;
+                request.skin = skin;
+                request.size = size;
+                request.width = width;
+                request.height = height;
+                request.mass = mass;
+                request.charge = charge;
+                request.r = r;
+                request.g = g;
+                request.b = b;
+                request.a = a;
+                request.polygon_sides = polygon_sides;
+                return self.spawn(request);
+            },
+            py::arg("n"), py::arg("distribution") = "uniform_disk",
+            py::arg("center") = std::make_pair(0.0f, 0.0f), py::arg("extent") = 1.0f,
+            py::arg("velocity") = "", py::arg("equation") = "", py::arg("derivative_method") = "symbolic",
+            py::arg("skin") = PySkinType::PY_SKIN_CIRCLE,
+            py::arg("size") = 0.3f, py::arg("width") = 0.5f, py::arg("height") = 0.3f,
+            py::arg("mass") = 1.0f, py::arg("charge") = 0.0f,
+            py::arg("r") = 1.0f, py::arg("g") = 1.0f, py::arg("b") = 1.0f, py::arg("a") = 1.0f,
+            py::arg("polygon_sides") = 6, py::arg("columns") = 0, py::arg("seed") = 0u,
+            R"pbdoc(
+             Generate many objects on the GPU, straight into the object buffers.
+             
+             Args:
+                 n (int): Objects to add
+                 distribution (str): Where they go:
+                     "uniform_disk" - uniform over the disc of radius extent about center
+                     "gaussian"     - normal about center, standard deviation extent
+                     "lattice"      - square lattice of spacing extent centred on center,
+                                      `columns` wide (0 = as square as n allows)
+                     anything else  - an "x_expr, y_expr" position expression
+                 center ((float, float)): Centre of the distribution. Default: (0, 0)
+                 extent (float): Radius, standard deviation or spacing. Default: 1.0
+                 velocity (str): "vx_expr, vy_expr"; empty = at rest
+                 equation (str): Equation of every new object; empty = the default
+                 derivative_method (str): As for set_equation
+                 skin, size, width, height, mass, charge, r, g, b, a, polygon_sides:
+                     The same for every object, as for add_object
+                 seed (int): Generator seed; the same arguments give the same objects
+                 
+             Returns:
+                 int: ID of the first new object; the others follow consecutively
+                 
+             Expressions use the equation syntax: t runs over (0, 1) across the new
+             objects and rand()/randn() draw per object. A position expression reads
+             center as x, y; a velocity expression reads the object's position as x, y.
+             Other objects, $k, s0..s7, agg[], fld[], table() and field() are not
+             available. Only the template crosses the bus, so a million objects take
+             one dispatch per object buffer.
+                 
+             Example:
+                 >>> sim.spawn(1000000, "uniform_disk", extent=50, velocity="-y*0.1, x*0.1", size=0.02)
+                 >>> sim.spawn(5000, "10*t*cos(60*t), 10*t*sin(60*t)")   # Spiral
+             )pbdoc")
+
+        .def("update_object", &SimulationWrapper::update_object,
+            py::arg("index"),
+            py::arg("x"), py::arg("y"),
+            py::arg("vx"), py::arg("vy"),
+            py::arg("mass"), py::arg("charge"),
+            py::arg("rotation"), py::arg("angular_velocity"),
+            py::arg("width"), py::arg("height"),
+            py::arg("r"), py::arg("g"), py::arg("b"), py::arg("a"),
+            R"pbdoc(
+             Update all properties of an existing object.
+             
+             Args:
+                 index (int): Object ID
+                 x,y,vx,vy,mass,charge,rotation,angular_velocity: Updated properties
+                 width,height: Updated dimensions
+                 r,g,b,a: Updated color
+             )pbdoc")
+
+        // Batch operations
+        .def("batch_get", &SimulationWrapper::batch_get,
+            py::arg("indices"),
+            R"pbdoc(
+             Get properties for multiple objects at once.
+             
+             Args:
+                 indices (list[int]): List of object indices to fetch
+                 
+             Returns:
                  list: List of BatchGetData objects for each index
                  
              Example:
@@ -463,28 +1940,705 @@ PYBIND11_MODULE(stellar, m)
                  >>> sim.batch_update(updates)
              )pbdoc")
 
-        .def("remove_object", &SimulationWrapper::remove_object,
-            py::arg("index"),
-            "Remove an object by ID")
+        .def("reduce", &SimulationWrapper::reduce,
+            py::arg("expression"), py::arg("op") = "sum",
+            R"pbdoc(
+             Reduce a per-object expression to one value on the GPU.
+             
+             The expression uses the equation syntax and variables (x, y,
+             vx, vy, ax, ay, theta, omega, r, g, b, a, mass, charge, t,
+             p[i].property). It is compiled to GLSL once per distinct string
+             and reduced by work groups, so only one float is read back
+             instead of every object. sum_j/nsum/ncount/nmean and the
+             long-range accelerations are not available.
+             
+             Args:
+                 expression (str): Per-object expression
+                 op (str): 'sum' (default), 'min', 'max' or 'mean'
+                 
+             Returns:
+                 float: The reduced value
+                 
+             Example:
+                 >>> kinetic = sim.reduce("0.5*mass*(vx^2 + vy^2)")
+                 >>> total_mass = sim.reduce("mass")
+                 >>> cx = sim.reduce("mass*x") / total_mass
+                 >>> left = sim.reduce("x", "min")
+             )pbdoc")
 
-        .def("object_count", &SimulationWrapper::object_count,
-            "Get number of objects in simulation")
+        .def("evaluate",
+            [](const SimulationWrapper& self, const std::string& expression,
+               const py::object& x, const py::object& y, const py::object& vx, const py::object& vy,
+               const py::object& ax, const py::object& ay, const py::object& theta, const py::object& omega,
+               const py::object& r, const py::object& g, const py::object& b, const py::object& a,
+               const py::object& mass, const py::object& charge)
+            {
+                std::vector<py::ssize_t> shape;
+                bool shaped = false;
+                std::vector<std::vector<float>> columns;
+                const std::pair<const py::object*, const char*> inputs[] = {
+                    { &x, "x" }, { &y, "y" }, { &vx, "vx" }, { &vy, "vy" }, { &ax, "ax" }, { &ay, "ay" },
+                    { &theta, "theta" }, { &omega, "omega" }, { &r, "r" }, { &g, "g" }, { &b, "b" }, { &a, "a" },
+                    { &mass, "mass" }, { &charge, "charge" }
+                };
+                for (const auto& input : inputs)
+                    columns.push_back(EvaluateColumn(*input.first, input.second, shape, shaped));
 
-        .def("get_object", &SimulationWrapper::get_object,
-            py::arg("index"),
+                std::vector<float> values = self.evaluate(expression, columns);
+                py::array_t<float> result(shape);
+                std::copy(values.begin(), values.end(), result.mutable_data());
+                return result;
+            },
+            py::arg("expression"),
+            py::arg("x") = py::none(), py::arg("y") = py::none(),
+            py::arg("vx") = py::none(), py::arg("vy") = py::none(),
+            py::arg("ax") = py::none(), py::arg("ay") = py::none(),
+            py::arg("theta") = py::none(), py::arg("omega") = py::none(),
+            py::arg("r") = py::none(), py::arg("g") = py::none(),
+            py::arg("b") = py::none(), py::arg("a") = py::none(),
+            py::arg("mass") = py::none(), py::arg("charge") = py::none(),
             R"pbdoc(
-             Get complete object state.
+             Evaluate an expression on the GPU at arbitrary points.
+             
+             The expression uses the equation syntax, as for reduce(), but runs
+             over the points the inputs describe instead of the objects: each
+             point is a probe with that state, and p[i].property still reads the
+             real objects, so potentials and force fields can be sampled on
+             dense grids. Inputs go up in batches of 4M points, one dispatch
+             each, and one float per point comes back. Each distinct expression
+             is compiled once. Values are returned as computed, inf and NaN
+             included.
              
              Args:
-                 index (int): Object ID
+                 expression (str): Expression of the point's state
+                 x,y,vx,vy,ax,ay,theta,omega,r,g,b,a,mass,charge (array):
+                     One value per point, a single value for all, or None for
+                     the default (1 for r, g, b, a, mass and charge, else 0).
+                     Arrays of more than one value must have the same size.
                  
              Returns:
-                 ObjectState: Complete object state
+                 numpy.ndarray: float32 values, in the shape of the first array
+                     input (0-d when every input is a single value)
+                 
+             Raises:
+                 RuntimeError: If the inputs differ in size, or the expression
+                     does not parse or compile, or uses sum_j/nsum/ncount/nmean,
+                     long-range accelerations or other per-step inputs
+                 
+             Example:
+                 >>> X, Y = np.meshgrid(np.linspace(-5, 5, 1000), np.linspace(-5, 5, 1000))
+                 >>> V = sim.evaluate("-1/sqrt((x - p[0].x)^2 + (y - p[0].y)^2 + 0.01)", x=X, y=Y)
+                 >>> V.shape                                   # (1000, 1000)
              )pbdoc")
 
-        // Convenience methods
-        .def("set_rotation", &SimulationWrapper::set_rotation,
-            py::arg("index"), py::arg("rotation"),
+        .def("histogram", [](const SimulationWrapper& self, const std::string& expression, int bins,
+                             const std::vector<float>& range)
+            {
+                std::vector<uint32_t> counts = self.histogram({ expression }, { bins }, range);
+                return py::array_t<uint32_t>(static_cast<py::ssize_t>(counts.size()), counts.data());
+            },
+            py::arg("expression"), py::arg("bins") = 64, py::arg("range") = std::vector<float>(),
+            R"pbdoc(
+             Histogram of a per-object expression, binned on the GPU.
+             
+             The expression is compiled as for reduce(); each work group
+             counts its objects with shared-memory atomics, so only the bin
+             counts are read back. Bins follow numpy.histogram: half-open,
+             the last one closed, values outside the range not counted.
+             Also takes two expressions for a 2D histogram, see below.
+             
+             Args:
+                 expression (str): Per-object expression
+                 bins (int): Number of bins. Default: 64.
+                 range (tuple[float, float]): (min, max) of the bins
+                     (default: the expression's min and max over the objects)
+                 
+             Returns:
+                 numpy.ndarray: uint32 counts, shape (bins,)
+                 
+             Example:
+                 >>> counts = sim.histogram("sqrt(vx^2 + vy^2)", 50, (0.0, 10.0))
+             )pbdoc")
+        .def("histogram", [](const SimulationWrapper& self, const std::tuple<std::string, std::string>& expressions,
+                             py::object bins, const std::vector<std::vector<float>>& range)
+            {
+                std::vector<int> binCounts;
+                if (py::isinstance<py::int_>(bins)) binCounts.assign(2, bins.cast<int>());
+                else binCounts = bins.cast<std::vector<int>>();
+                std::vector<float> bounds;
+                for (const std::vector<float>& pair : range) bounds.insert(bounds.end(), pair.begin(), pair.end());
+                if (binCounts.size() != 2 || (!range.empty() && (range.size() != 2 || bounds.size() != 4)))
+                    throw std::runtime_error("A 2D histogram takes bins (nx, ny) and range ((x_min, x_max), (y_min, y_max))");
+                std::vector<uint32_t> counts = self.histogram({ std::get<0>(expressions), std::get<1>(expressions) },
+                                                              binCounts, bounds);
+                py::array_t<uint32_t> result({ static_cast<py::ssize_t>(binCounts[0]), static_cast<py::ssize_t>(binCounts[1]) });
+                std::copy(counts.begin(), counts.end(), result.mutable_data());
+                return result;
+            },
+            py::arg("expressions"), py::arg("bins") = 64, py::arg("range") = std::vector<std::vector<float>>(),
+            R"pbdoc(
+             2D histogram of two per-object expressions, binned on the GPU.
+             
+             Args:
+                 expressions (tuple[str, str]): Expressions along x and y
+                 bins (int or tuple[int, int]): Bins along both, or (nx, ny). Default: 64.
+                 range: ((x_min, x_max), (y_min, y_max)) (default: each
+                     expression's min and max over the objects)
+                 
+             Returns:
+                 numpy.ndarray: uint32 counts, shape (nx, ny) as numpy.histogram2d
+                 
+             Example:
+                 >>> density = sim.histogram(("x", "y"), (128, 128), ((-10, 10), (-10, 10)))
+             )pbdoc")
+
+        .def("set_group", &SimulationWrapper::set_group,
+            py::arg("name"), py::arg("indices"),
+            R"pbdoc(
+             Make the listed objects the members of a named group.
+             
+             Groups are tag sets: an object can be in several of them, and
+             setting a group again replaces its members. At most 32 groups.
+             Removed objects leave their groups; objects the GPU spawns join
+             none.
+             
+             Args:
+                 name (str): Group name
+                 indices (list[int]): Member objects
+             )pbdoc")
+
+        .def("get_group", &SimulationWrapper::get_group, py::arg("name"),
+            "Indices of the objects in a group (empty for an unknown group)")
+
+        .def("set_aggregate", &SimulationWrapper::set_aggregate,
+            py::arg("name"), py::arg("expression"), py::arg("op") = "mean", py::arg("group") = "",
+            R"pbdoc(
+             Aggregate a per-object expression over a group once per step.
+             
+             Every aggregate is reduced on the GPU in one pass from the state
+             at the start of each step, before the equations run, which read
+             it as agg[name]. An equation that needs the centre of a flock
+             then reads one value instead of summing over every member.
+             The expression follows the rules of reduce(). While aggregates
+             exist steps are not fused and do not run on the CPU backend.
+             An empty group reads 0.
+             
+             Args:
+                 name (str): Name equations read as agg[name] (at most 16 names)
+                 expression (str): Per-object expression
+                 op (str): 'mean' (default), 'sum', 'min' or 'max'
+                 group (str): Group to reduce over; '' (default) = every object
+                 
+             Example:
+                 >>> sim.set_group("flock", birds)
+                 >>> sim.set_aggregate("flock_cx", "x", "mean", "flock")
+                 >>> sim.set_equation(0, "ax = 0.5*(agg[flock_cx] - x)")
+             )pbdoc")
+
+        .def("remove_aggregate", &SimulationWrapper::remove_aggregate, py::arg("name"),
+            "Stop computing an aggregate; agg[name] reads 0 from then on")
+
+        .def("get_aggregate", &SimulationWrapper::get_aggregate, py::arg("name"),
+            "Value of an aggregate at the last step (waits for the GPU)")
+
+        .def("fetch_async", &SimulationWrapper::fetch_async,
+            py::arg("fields") = std::vector<std::string>(),
+            R"pbdoc(
+             Start a non-blocking copy of the current object state.
+             
+             The live objects are copied to a staging buffer on the GPU and
+             fenced; the call returns at once. Analyse step N from the
+             returned future while step N+1 is simulating.
+             
+             Args:
+                 fields (list[str]): Any of 'x', 'y', 'vx', 'vy', 'mass',
+                     'charge', 'rotation', 'angular_velocity', 'r', 'g', 'b',
+                     'a' (default: all of them)
+                 
+             Returns:
+                 ReadbackFuture: Call ready() to poll and result() to collect
+                 
+             Example:
+                 >>> pending = sim.fetch_async(["x", "y"])
+                 >>> sim.update(0.016)              # Runs while the copy lands
+                 >>> xs = pending.result()["x"]     # State from before update()
+             )pbdoc")
+
+        .def("sync", &SimulationWrapper::sync,
+            R"pbdoc(
+             Copy the current object state into the buffer state_view() aliases.
+             
+             Arrays from state_view() change only here: they show the state
+             of the last sync(), which is overwritten in place. Once the
+             simulation has grown past the buffer, sync() starts a new one
+             and older arrays keep their last contents.
+             
+             Returns:
+                 int: Number of objects copied
+             )pbdoc")
+
+        .def("as_dlpack", &DeviceFieldCapsule,
+            py::arg("field"),
+            R"pbdoc(
+             Zero-copy CUDA view of one object field, as a DLPack capsule.
+             
+             The current object buffer is mapped into CUDA with GL interop
+             and the capsule points into it, strided over the object
+             records: no host round trip. Writing through the tensor edits
+             the objects in place, so actions can go into velocities on the
+             GPU and the next step reads them. The tensor is valid until the
+             next call into the simulation (update(), any other method, or
+             release_dlpack()), which hands the buffer back to GL; map again
+             after stepping. Several fields may be mapped together as long
+             as no other call comes in between. GL and CUDA must run on the
+             same GPU; the CUDA runtime is loaded at run time (STELLAR_CUDART
+             names it).
+             
+             Args:
+                 field (str): "position" or "velocity" (objects, 2), "color"
+                     (objects, 4), or one of x, y, vx, vy, mass, charge,
+                     rotation, angular_velocity, r, g, b, a (objects,)
+             
+             Returns:
+                 PyCapsule: float32 "dltensor" on the CUDA device
+             
+             Raises:
+                 RuntimeError: If the field is unknown or CUDA interop is
+                     unavailable
+             
+             Example:
+                 >>> from torch.utils.dlpack import from_dlpack
+                 >>> vel = from_dlpack(sim.as_dlpack("velocity"))
+                 >>> vel += policy(from_dlpack(sim.as_dlpack("position")))
+                 >>> sim.update(0.01)            # Reads the new velocities
+             )pbdoc")
+
+        .def("release_dlpack", &SimulationWrapper::release_device_mapping,
+            "Hand the object buffer mapped by as_dlpack() back to GL; tensors from it become invalid")
+
+        .def("state_view", &StateViewArray,
+            R"pbdoc(
+             Read-only NumPy view of the objects copied by the last sync().
+             
+             A structured array aliasing the synced records, no per-object
+             Python objects and no copy. Fields: position (2,), velocity (2,),
+             mass, charge, skin, collision_shape, visual_data (4,), where
+             rotation is visual_data[:, 2] and angular velocity
+             visual_data[:, 3], collision_data (4,), color (4,), equation_id.
+             Its length is the object count of that sync(); it stays valid
+             after the simulation is cleaned up. Requires NumPy.
+             
+             Returns:
+                 numpy.ndarray: One record per object
+                 
+             Raises:
+                 RuntimeError: If sync() was never called
+                 
+             Example:
+                 >>> view = sim.state_view()     # After a first sim.sync()
+                 >>> pos = view["position"]      # (N, 2) float32, no copy
+                 >>> sim.update(0.016)
+                 >>> sim.sync()                  # pos now shows the new state
+             )pbdoc")
+
+        .def("record", &SimulationWrapper::record,
+            py::arg("fields") = std::vector<std::string>(), py::arg("every_n_steps") = 1,
+            py::arg("capacity") = 1024, py::arg("object_indices") = std::vector<int>(),
+            py::arg("output_dir") = "", py::arg("quantize_box") = std::vector<float>(),
+            R"pbdoc(
+             Record a trajectory on the GPU while the simulation steps.
+             
+             Every every_n_steps steps the selected fields of the recorded
+             objects are appended to a ring buffer of capacity frames, with
+             no readback. download_recording() collects them in one transfer;
+             once the ring is full the oldest frames are overwritten.
+             Replaces any recording in progress.
+             
+             Args:
+                 fields (list[str]): As for fetch_async (default: all of them)
+                 every_n_steps (int): Steps between frames. Substeps fused
+                     into one dispatch record only their final state.
+                 capacity (int): Frames the ring holds
+                 object_indices (list[int]): Objects to record (default: all
+                     current objects). Frames are skipped while any of them
+                     has been removed.
+                 output_dir (str): Stream every frame to this directory
+                     instead: update() hands full half-rings to a background
+                     writer, which appends them to <field>.npy (frames,
+                     objects), step.npy and time.npy next to objects.npy.
+                     stop_recording() writes the rest and finishes the files;
+                     numpy.load(path, mmap_mode="r") reads them, or
+                     Trajectory(output_dir) maps the whole directory.
+                 quantize_box (list[float]): (min_x, min_y, max_x, max_y) to
+                     pack positions into 16-bit fractions of this box and
+                     velocities into half floats on the GPU, halving their
+                     transfer. Frames are dequantized to float32 on download;
+                     positions outside the box clamp to its edges.
+                 
+             Example:
+                 >>> sim.record(["x", "y"], every_n_steps=10, capacity=5000)
+                 >>> for _ in range(50000): sim.update(0.001)
+                 >>> traj = sim.download_recording()
+                 >>> traj["x"].shape                    # (5000, num_objects)
+             )pbdoc")
+
+        .def("download_recording", [](SimulationWrapper& self)
+            {
+                TrajectoryRecording recording;
+                {
+                    py::gil_scoped_release release;
+                    recording = self.download_recording();
+                }
+                return RecordingToDict(recording);
+            },
+            R"pbdoc(
+             Collect the frames recorded since record() or the last download.
+             
+             Returns:
+                 dict: 'step' (frames,) steps since record(), 'time' (frames,)
+                     simulation time, 'objects' the recorded indices,
+                     'dropped' frames lost to the ring wrapping, and one
+                     (frames, objects) float32 array per recorded field.
+                     A quantized recording adds 'quantization': its 'box',
+                     'position_bits' (16) and 'velocity' ('float16').
+                     
+             Raises:
+                 RuntimeError: If nothing is being recorded, or the recording
+                     streams to disk
+             )pbdoc")
+
+        .def("stop_recording", &SimulationWrapper::stop_recording,
+            py::call_guard<py::gil_scoped_release>(),
+            "Stop recording and free the ring buffer. Frames not downloaded are lost, "
+            "unless the recording streams to disk: then they are written and the files finished")
+
+        .def("start_stream_server", &SimulationWrapper::start_stream_server,
+            py::arg("port") = 0, py::arg("rate_hz") = 30.0f, py::arg("host") = "0.0.0.0",
+            py::arg("quantize_box") = std::vector<float>(),
+            R"pbdoc(
+             Serve the recording to remote viewers over plain TCP.
+             
+             rate_hz times a second update() reads back only the newest
+             recorded frame, once however many viewers are connected, and a
+             background thread sends it to each of them: positions as 16-bit
+             fractions of the quantization box, the other fields as half
+             floats, and to a viewer that has the previous frame only the
+             zigzag varint differences to it. Viewers that fall behind skip
+             frames and resume with a keyframe. The wire format is described
+             in state_stream.h. Serving ends with stop_stream_server(),
+             stop_recording() or a new record(); download_recording() is not
+             available meanwhile.
+             
+             Args:
+                 port (int): TCP port, 0 picks a free one
+                 rate_hz (float): Frames sent per second at most
+                 host (str): IPv4 address to listen on
+                 quantize_box (list[float]): (min_x, min_y, max_x, max_y) the
+                     positions are quantized in (default: record()'s box)
+             
+             Returns:
+                 int: The port listened on
+             
+             Raises:
+                 RuntimeError: If nothing is recorded in memory, positions have
+                     no box, or the socket cannot be bound
+             
+             Example:
+                 >>> sim.record(["x", "y", "vx", "vy"], capacity=4)
+                 >>> port = sim.start_stream_server(9000, rate_hz=20,
+                 ...                                quantize_box=[-50, -50, 50, 50])
+             )pbdoc")
+
+        .def("stop_stream_server", &SimulationWrapper::stop_stream_server,
+            py::call_guard<py::gil_scoped_release>(),
+            "Disconnect the viewers and stop serving; the recording goes on")
+
+        .def("get_stream_server_stats", &SimulationWrapper::get_stream_server_stats,
+            R"pbdoc(
+             How the stream server is doing.
+             
+             Returns:
+                 dict[str, float]: {"port", "clients", "frames", "bytes"}, with
+                     frames and bytes sent since start_stream_server(); all 0
+                     while not serving
+             )pbdoc")
+
+        .def("start_metrics_server", &SimulationWrapper::start_metrics_server,
+            py::arg("port") = 9464, py::arg("interval") = 1.0f, py::arg("host") = "127.0.0.1",
+            R"pbdoc(
+             Serve metrics for Prometheus over HTTP.
+             
+             A background thread answers GET /metrics in the Prometheus text
+             format; it never touches GL, so a scrape costs the simulation
+             nothing. Every interval seconds the steps render a new page:
+             steps and steps per second, simulated time, lag and dropped
+             time, per-pass GPU and host timings (set_profiling()), work
+             counters per step (while set_counters() has them on), object,
+             capacity and equation counts, buffer memory (memory_report())
+             and readback bytes and bandwidth. stellar_metrics_age_seconds
+             tells how old the page is, so a stalled simulation shows up.
+             Serving ends with stop_metrics_server().
+             
+             Args:
+                 port (int): TCP port, 0 picks a free one (default 9464)
+                 interval (float): Seconds between pages (default 1)
+                 host (str): IPv4 address to listen on ("0.0.0.0" for
+                     every interface)
+             
+             Returns:
+                 int: The port listened on
+             
+             Raises:
+                 RuntimeError: If the socket cannot be bound
+             
+             Example:
+                 >>> sim.start_metrics_server(9464, host="0.0.0.0")
+                 >>> while True:
+                 ...     sim.step(1000)
+             )pbdoc")
+
+        .def("stop_metrics_server", &SimulationWrapper::stop_metrics_server,
+            py::call_guard<py::gil_scoped_release>(),
+            "Stop serving metrics")
+
+        .def("get_metrics_scrapes", &SimulationWrapper::get_metrics_scrapes,
+            "Pages the metrics server answered since start_metrics_server(), 0 while not serving")
+
+        .def("start_shared_frames", &SimulationWrapper::start_shared_frames,
+            py::arg("name"), py::arg("slots") = 8,
+            R"pbdoc(
+             Publish the recording into shared memory for other processes.
+             
+             Every recorded frame update() reads back is written into a ring of
+             slots frames in a named POSIX / Windows shared-memory segment, each
+             slot guarded by a seqlock. Other processes open it with
+             SharedFrames(name) and read frames as NumPy views, with no copy,
+             no pickling and no GL context; the layout is described in
+             shared_frames.h. Sharing ends with stop_shared_frames(),
+             stop_recording() or a new record(); download_recording() is not
+             available meanwhile.
+             
+             Args:
+                 name (str): Segment name; it must not exist yet
+                 slots (int): Frames the ring holds (default 8)
+             
+             Example:
+                 >>> sim.record(["x", "y", "vx", "vy"], capacity=16)
+                 >>> sim.start_shared_frames("sim_frames", slots=32)
+                 >>> # in another process: SharedFrames("sim_frames").read()
+             )pbdoc")
+
+        .def("stop_shared_frames", &SimulationWrapper::stop_shared_frames,
+            "Stop publishing and remove the segment's name; open readers keep their mappings")
+
+        .def("get_shared_frame_count", &SimulationWrapper::get_shared_frame_count,
+            "Frames published since start_shared_frames()")
+
+        .def("start_domain_decomposition", &SimulationWrapper::start_domain_decomposition,
+            py::arg("halo"), py::arg("x_range") = std::make_tuple(0.0f, 0.0f),
+            R"pbdoc(
+             Split the world across MPI ranks, one GPU each.
+             
+             Run the same script on every rank (mpirun -n 4 python run.py): every
+             rank adds the same equations in the same order and may add any
+             objects. x_range is cut into one slab per rank; a rank owns and
+             integrates the objects whose x lies in its slab. After every step the
+             objects that left it move to their new owner, and copies of the
+             objects within halo of a slab edge are sent to the neighbour as
+             ghosts: static objects after the owned ones, which collisions, p[i],
+             sum_j() and nsum/ncount/nmean see but only the owner moves. Choose
+             halo as the largest interaction radius.
+             
+             Steps are not fused meanwhile, and object indices change with every
+             step like after remove_objects(). Only the object rows travel;
+             constraints, springs, parameters, state registers and groups stay
+             on the rank that set them. Needs a module built with STELLAR_MPI.
+             
+             Args:
+                 halo (float): Ghost width on each side of a slab edge, under a slab width
+                 x_range (tuple): (min_x, max_x); default the world box, periodic
+                     when the world bounds are
+             
+             Example:
+                 >>> sim.set_world_bounds("reflect", (0.0, 0.0, 1000.0, 200.0))
+                 >>> sim.start_domain_decomposition(halo=5.0)
+                 >>> sim.step(1000)
+                 >>> sim.get_domain_stats()["local_objects"]
+             )pbdoc")
+
+        .def("stop_domain_decomposition", &SimulationWrapper::stop_domain_decomposition,
+            "Drop the ghosts and stop exchanging; each rank keeps the objects it owns")
+
+        .def("get_domain_stats", &SimulationWrapper::get_domain_stats,
+            R"pbdoc(
+             This rank's part of the split.
+             
+             Returns:
+                 dict: active, rank, ranks, slab_min, slab_max, local_objects,
+                     ghost_objects, and migrated_in / migrated_out at the last
+                     exchange, exchanges
+             )pbdoc")
+
+        .def("advance_event_driven", &SimulationWrapper::advance_event_driven,
+            py::arg("duration"), py::arg("collapse_time") = 1e-6f, py::arg("max_events") = 0,
+            R"pbdoc(
+             Advance hard disks from collision to collision instead of by steps.
+             
+             For dilute gases, where fixed steps spend nearly all their work
+             between collisions. Collision-enabled circles fly in straight lines
+             and only the events are computed: contacts predicted within a grid
+             one diameter wide, world-box walls (reflected with the global
+             restitution, or wrapped when periodic), processed in time order
+             from a priority queue. Each ensemble world runs its own queue on
+             the CPU thread pool. Equations, constraints and springs do not act
+             during the call; the state is read back once and uploaded once.
+             
+             Args:
+                 duration (float): Simulated time to advance
+                 collapse_time (float): Collisions of an object closer together
+                     than this are elastic, which keeps restitution < 1 from
+                     collapsing into endless collisions
+                 max_events (int): Events per world before the rest of the
+                     interval is free flight (0 = no limit)
+             
+             Returns:
+                 dict: collisions, wall_hits, cell_crossings, stale_events
+                     (queued events a collision had invalidated), worlds,
+                     truncated (1 when max_events was reached)
+             
+             Example:
+                 >>> stats = sim.advance_event_driven(10.0)
+                 >>> stats["collisions"]
+             )pbdoc")
+
+        .def("remove_object", &SimulationWrapper::remove_object,
+            py::arg("index"),
+            "Remove an object by ID")
+
+        .def("remove_objects", &SimulationWrapper::remove_objects,
+            py::arg("indices"),
+            R"pbdoc(
+             Remove several objects in one pass.
+             
+             Args:
+                 indices (list[int]): Object IDs, all referring to the state before the call
+                 
+             Like remove_object, each removal moves the last object into the freed slot;
+             constraints to removed objects are dropped and those to moved objects follow them.
+             Much faster than calling remove_object in a loop. p[i] in equations names
+             objects by handle, so no equation has to change.
+             )pbdoc")
+
+        .def("object_count", &SimulationWrapper::object_count,
+            "Get number of objects in simulation")
+
+        .def("object_handle", &SimulationWrapper::object_handle,
+            py::arg("index"),
+            R"pbdoc(
+             Stable handle of an object.
+             
+             p[i] in an equation reads the object with handle i. An object
+             keeps its handle while removals move it to other indices, and
+             p[i] of a removed object reads 0 rather than the object moved
+             into its place. Handles equal indices until the first removal,
+             and start over from 0 once every object has been removed.
+             
+             Args:
+                 index (int): Object ID
+             
+             Returns:
+                 int: Handle of the object
+             
+             Raises:
+                 RuntimeError: If index is invalid or the object was spawned on the GPU
+             )pbdoc")
+
+        .def("object_index", &SimulationWrapper::object_index,
+            py::arg("handle"),
+            R"pbdoc(
+             Current index of the object with a handle.
+             
+             Args:
+                 handle (int): Handle from object_handle()
+             
+             Returns:
+                 int: Object ID, or -1 if the object has been removed
+             )pbdoc")
+
+        .def("query_radius", &SimulationWrapper::query_radius,
+            py::arg("points"), py::arg("radius"),
+            R"pbdoc(
+             Find the objects within a radius of each of a list of points.
+             
+             Every point is answered by one GPU pass over a neighbour grid, so thousands of
+             queries cost a single readback of the hits instead of a fetch of every object.
+             
+             Args:
+                 points (list[tuple[float, float]]): Query centres (x, y)
+                 radius (float): Distance from a centre an object's centre may be at
+             
+             Returns:
+                 list[list[int]]: Object IDs in ascending order, one list per point
+             
+             Raises:
+                 RuntimeError: If radius is negative
+             )pbdoc")
+
+        .def("query_aabb", &SimulationWrapper::query_aabb,
+            py::arg("boxes"),
+            R"pbdoc(
+             Find the objects inside each of a list of axis-aligned boxes.
+             
+             Args:
+                 boxes (list[tuple[float, float, float, float]]): (min_x, min_y, max_x, max_y) per box,
+                     edges included
+             
+             Returns:
+                 list[list[int]]: Object IDs whose centre is in the box, ascending, one list per box
+             
+             Raises:
+                 RuntimeError: If a box has a minimum above its maximum
+             )pbdoc")
+
+        .def("raycast", &SimulationWrapper::raycast,
+            py::arg("origins"), py::arg("dirs"), py::arg("max_dist"),
+            R"pbdoc(
+             Cast rays against the objects' collision shapes and report the first hit of each.
+             
+             Every ray is answered by one GPU pass over a BVH of the collision shapes, with the
+             same circle, AABB and polygon geometry the collision pass uses. Objects with
+             collisions disabled are transparent, and a shape a ray starts inside is not hit,
+             so a ray cast from an object's own position sees past that object.
+             
+             Args:
+                 origins (list[tuple[float, float]]): Ray starts (x, y)
+                 dirs (list[tuple[float, float]]): Ray directions, one per origin (any length;
+                     a zero direction hits nothing)
+                 max_dist (float): Furthest distance along a ray a hit is reported at
+             
+             Returns:
+                 list[tuple[int, float, float, float]]: (object ID, distance, normal x, normal y)
+                     per ray; (-1, max_dist, 0, 0) when nothing is hit
+             
+             Raises:
+                 RuntimeError: If origins and dirs differ in length or max_dist is negative or infinite
+             )pbdoc")
+
+        .def("get_object", &SimulationWrapper::get_object,
+            py::arg("index"),
+            R"pbdoc(
+             Get complete object state.
+             
+             Args:
+                 index (int): Object ID
+                 
+             Returns:
+                 ObjectState: Complete object state
+             )pbdoc")
+
+        // Convenience methods
+        .def("set_rotation", &SimulationWrapper::set_rotation,
+            py::arg("index"), py::arg("rotation"),
             "Set rotation angle in radians")
 
         .def("set_angular_velocity", &SimulationWrapper::set_angular_velocity,
@@ -507,185 +2661,1797 @@ PYBIND11_MODULE(stellar, m)
             py::arg("index"),
             "Get angular velocity in rad/s")
 
-        // Equations
-        .def("set_equation", &SimulationWrapper::set_equation,
-            py::arg("object_index"), py::arg("equation_string"),
+        .def("set_parameters", &SimulationWrapper::set_parameters,
+            py::arg("index"), py::arg("values"), py::arg("first") = 0,
             R"pbdoc(
-             Set physics equation for object.
+             Set per-object equation parameters.
              
              Args:
-                 object_index (int): Object ID
-                 equation_string (str): Physics equation
+                 index (int): Object ID
+                 values (list[float]): Values for $first, $first+1, ... (at most 8 slots in total)
+                 first (int): First parameter slot to write
                  
-             Equation syntax supports:
-             - Variables: x, y, vx, vy, mass, charge, time
-             - Object references: p[ID].x, p[ID].y, p[ID].mass
-             - Functions: sin, cos, tan, sqrt, exp, log
-             - Operators: +, -, *, /, ^ (power)
+             Objects whose equations differ only in constants can share one compiled
+             equation by reading those constants from $0..$7 instead.
                  
              Example:
-                 >>> sim.set_equation(0, "0.1*mass*(p[1].x - x)/distance^3")
+                 >>> sim.set_equation(i, "ax = -$0 * x; ay = -$0 * y")
+                 >>> sim.set_parameters(i, [stiffness])
+             )pbdoc")
+
+        .def("get_parameters", &SimulationWrapper::get_parameters,
+            py::arg("index"),
+            "Get all 8 equation parameters $0..$7 of an object")
+
+        .def("set_state", &SimulationWrapper::set_state,
+            py::arg("index"), py::arg("values"), py::arg("first") = 0,
+            R"pbdoc(
+             Set per-object state registers.
+             
+             Args:
+                 index (int): Object ID
+                 values (list[float]): Values for s<first>, s<first+1>, ... (at most 8 registers in total)
+                 first (int): First register to write
+                 
+             Equations read the registers as s0..s7 and update them with "sK = expr"
+             statements once per step, on the GPU; new objects start at 0.
+                 
+             Example:
+                 >>> sim.set_equation(i, "ax = -x; s0 = max(s0, abs(vx))")
+                 >>> sim.set_state(i, [0.0])
              )pbdoc")
 
-        // Constraints
-        .def("add_distance_constraint", &SimulationWrapper::add_distance_constraint,
-            py::arg("object_index"), py::arg("constraint"),
-            "Add distance constraint between objects")
+        .def("get_state", &SimulationWrapper::get_state,
+            py::arg("index"),
+            "Get all 8 state registers s0..s7 of an object (waits for the GPU)")
+
+        .def("set_sensitivities", &SimulationWrapper::set_sensitivities,
+            py::arg("parameters"),
+            R"pbdoc(
+             Carry forward sensitivities of every object's state with respect to parameters.
+             
+             Args:
+                 parameters (list[str]): Up to 4 of '$0'..'$7', 'k', 'damping', 'gravity',
+                     'coupling', 'freq', 'amp', 'mass', 'charge'; [] turns them off
+                 
+             Each step also integrates d(x, y, vx, vy)/d(parameter) per object,
+             evaluating the ax/ay equations with dual numbers along the tangent,
+             so one run gives what finite differences need two runs per
+             parameter for. Other objects (p[i], sum_j, long-range fields),
+             collisions and constraints count as independent of the parameters.
+             Every tangent starts at 0 (see reset_sensitivities).
+                 
+             Example:
+                 >>> sim.set_equation(i, "ax = -k * x - damping * vx; ay = -gravity")
+                 >>> sim.set_sensitivities(["k", "damping"])
+                 >>> sim.update(1.0)
+                 >>> dx_dk = sim.get_sensitivities()[i, 0, 0]
+             )pbdoc")
+
+        .def("get_sensitivity_parameters", &SimulationWrapper::get_sensitivity_parameters,
+            "Parameters set by set_sensitivities, in the order of get_sensitivities")
+
+        .def("reset_sensitivities", &SimulationWrapper::reset_sensitivities,
+            "Zero every tangent, e.g. after moving the objects back to their initial state")
+
+        .def("get_sensitivities", [](const SimulationWrapper& self)
+            {
+                std::vector<float> values = self.get_sensitivities();
+                py::ssize_t parameters = static_cast<py::ssize_t>(self.get_sensitivity_parameters().size());
+                py::ssize_t objects = parameters > 0 ? static_cast<py::ssize_t>(values.size()) / (parameters * 4) : 0;
+                py::array_t<float> result({ objects, parameters, static_cast<py::ssize_t>(4) });
+                std::copy(values.begin(), values.begin() + objects * parameters * 4, result.mutable_data());
+                return result;
+            },
+            R"pbdoc(
+             Get the forward sensitivities of every object (waits for the GPU).
+             
+             Returns:
+                 numpy.ndarray: float32 (objects, parameters, 4) array of
+                 (dx, dy, dvx, dvy) / d(parameter), in set_sensitivities order
+             )pbdoc")
+
+        // Equations
+        .def("batch_set_equation",
+            py::overload_cast<const std::vector<int>&, const std::string&, const std::string&>(&SimulationWrapper::batch_set_equation),
+            py::arg("indices"), py::arg("equation_string"), py::arg("derivative_method") = "symbolic",
+            "Set one physics equation for many objects; parsed and registered once (see set_equation)")
+
+        .def("batch_set_equation",
+            py::overload_cast<const std::vector<int>&, const BuiltEquation&>(&SimulationWrapper::batch_set_equation),
+            py::arg("indices"), py::arg("equation"),
+            "Set one stellar.expr.Equation for many objects")
+
+        .def("set_equations",
+            py::overload_cast<const std::vector<int>&, const std::vector<BuiltEquation>&>(&SimulationWrapper::set_equations),
+            py::arg("indices"), py::arg("equations"),
+            R"pbdoc(
+             Set a stellar.expr.Equation per object in one call.
+             
+             The equations are already parsed: only the distinct ones are simplified and
+             compiled, in parallel. Nothing changes if one of them fails.
+             )pbdoc")
+
+        .def("set_equations",
+            py::overload_cast<const std::vector<int>&, const std::vector<std::string>&, const std::string&>(&SimulationWrapper::set_equations),
+            py::arg("indices"), py::arg("equation_strings"), py::arg("derivative_method") = "symbolic",
+            R"pbdoc(
+             Set a physics equation per object in one call.
+             
+             Args:
+                 indices (list[int]): Object IDs
+                 equation_strings (list[str]): Equation for each object (see set_equation)
+                 derivative_method (str): How D() is computed, for every equation
+                 
+             Each distinct string is parsed once, the new ones in parallel, and all of
+             them are uploaded together. Nothing changes if one of them fails to parse.
+             )pbdoc")
+
+        .def("set_equation_group", &SimulationWrapper::set_equation_group,
+            py::arg("indices"), py::arg("group"),
+            R"pbdoc(
+             Make objects members of a behaviour group.
+             
+             Members run whatever equation the group is set to with
+             set_group_equation, default physics while it has none. Setting an
+             equation on a member with set_equation takes it out of its group.
+             
+             Args:
+                 indices (list[int]): Object IDs
+                 group (int): Group, 0 to 255
+             
+             Raises:
+                 RuntimeError: If an index or the group is invalid
+             )pbdoc")
+
+        .def("set_group_equation",
+            py::overload_cast<int, const BuiltEquation&>(&SimulationWrapper::set_group_equation),
+            py::arg("group"), py::arg("equation"),
+            "Set the equation of a behaviour group to one built with stellar.expr")
+
+        .def("set_group_equation",
+            py::overload_cast<int, const std::string&, const std::string&>(&SimulationWrapper::set_group_equation),
+            py::arg("group"), py::arg("equation_string"), py::arg("derivative_method") = "symbolic",
+            R"pbdoc(
+             Switch the equation every member of a behaviour group runs.
+             
+             The group's equation is one entry of a small table on the GPU, so
+             this is a single 4-byte write however many objects are members;
+             the equation itself is parsed and registered once, as with
+             set_equation. Snapshots and cached scenes save the equation each
+             member runs, not its group.
+             
+             Args:
+                 group (int): Group, 0 to 255
+                 equation_string (str): Physics equation (see set_equation)
+                 derivative_method (str): How D() is computed (see set_equation)
+             
+             Example:
+                 >>> sim.set_equation_group(range(50000), 3)
+                 >>> sim.set_group_equation(3, "vx, vy, -x, -y")
+                 >>> sim.set_group_equation(3, "vx, vy, 0, -9.8")  # Every member at once
+             )pbdoc")
+
+        .def("clear_group_equation", &SimulationWrapper::clear_group_equation,
+            py::arg("group"),
+            "Members of the behaviour group fall back to default physics")
+
+        .def("get_group_equation", &SimulationWrapper::get_group_equation,
+            py::arg("group"),
+            "Registration key of the behaviour group's equation, '' if it has none")
+
+        .def("set_color_interval", &SimulationWrapper::set_color_interval,
+            py::arg("object_index"), py::arg("interval"),
+            R"pbdoc(
+             Set how often the color components of an object's equation are evaluated.
+             
+             Args:
+                 object_index (int): Object ID
+                 interval (int): Evaluate color every interval-th step (1 = every step, the default),
+                     or 0 to evaluate it only on the last step of each update(), the one render() shows
+                 
+             The color holds between evaluations. The setting belongs to the equation, so it
+             applies to every object running it; a newly registered equation starts at 1.
+             )pbdoc")
+
+        .def("get_color_interval", &SimulationWrapper::get_color_interval,
+            py::arg("object_index"),
+            "Steps between color evaluations of an object's equation (0 = last step of each update)")
+
+        .def("set_step_interval", &SimulationWrapper::set_step_interval,
+            py::arg("object_index"), py::arg("interval"),
+            R"pbdoc(
+             Put an object's equation in a slower rate group.
+             
+             Args:
+                 object_index (int): Object ID
+                 interval (int): Evaluate the equation every interval-th step (1 = every step, the default)
+                 
+             Objects in a group with interval N evaluate their equation on every Nth step and
+             kick their velocity for all N steps at once; on every step they drift on their
+             velocity, so objects in faster groups that read them (p[i], sum_j, ...) see their
+             positions move on in between. Slow, massive bodies can use 4 or 8 while fast ones
+             keep 1; powers of two keep the groups in step. Every integrator runs such objects
+             as this kick-drift scheme. The setting belongs to the equation, so it applies to
+             every object running it; a newly registered equation starts at 1.
+             )pbdoc")
+
+        .def("get_step_interval", &SimulationWrapper::get_step_interval,
+            py::arg("object_index"),
+            "Steps between evaluations of an object's equation (see set_step_interval)")
+
+        .def("set_equation",
+            py::overload_cast<int, const BuiltEquation&>(&SimulationWrapper::set_equation),
+            py::arg("object_index"), py::arg("equation"),
+            "Set an equation built with stellar.expr for an object (see set_equation with a string)")
+
+        .def("set_equation",
+            py::overload_cast<int, const std::string&, const std::string&>(&SimulationWrapper::set_equation),
+            py::arg("object_index"), py::arg("equation_string"), py::arg("derivative_method") = "symbolic",
+            R"pbdoc(
+             Set physics equation for object.
+             
+             Args:
+                 object_index (int): Object ID
+                 equation_string (str): Physics equation
+                 derivative_method (str): How D(expr, var, order) is computed:
+                     "symbolic" (default) expands it into an ordinary expression,
+                     "dual" evaluates expr once with dual numbers on the GPU,
+                     "numerical" takes a central difference (first order only)
+                 
+             Equation syntax supports:
+             - Variables: x, y, vx, vy, mass, charge, time
+             - Object references: p[ID].x, p[ID].y, p[ID].mass
+             - All-pairs sums: sum_j(expr) over every other object, with pj.x, pj.mass, ... in expr
+             - Neighbour reductions: nsum(radius, expr), ncount(radius), nmean(radius, expr)
+               over the objects within a fixed radius, found through a spatial hash grid
+             - Long-range accelerations: grav_ax, grav_ay, coul_ax, coul_ay (see set_long_range_parameters, set_long_range_method)
+             - SPH fluid: sph_ax, sph_ay, sph_rho, sph_p; objects whose equation reads them are fluid
+               (see the "sph_*" parameters of set_parameter)
+             - Random numbers: rand() uniform in (0, 1), randn() standard normal; each call
+               draws once per object and step from the seed of set_random_seed (up to 8 calls)
+             - Per-object parameters: $0 .. $7 (see set_parameters)
+             - State registers: s0 .. s7, updated by "sK = expr" statements once per step
+               from the values the step started with (see set_state)
+             - Lookups: table(id, x) over a 1D table, field(id, x, y) bilinear over a 2D grid
+               (see set_table, set_field)
+             - Functions: sin, cos, tan, sqrt, exp, log
+             - Operators: +, -, *, /, ^ (power)
+             - Statements: "target = expr" separated by ';' or newlines, for the targets
+               a (vec2), ax, ay, angular, color.r .. color.a, logp (set_metropolis), with "let name = expr",
+               vec2 values (pos, vel, p[ID].pos, vec2(x, y)), len(), dot() and .x/.y
+                 
+             Example:
+                 >>> sim.set_equation(0, "0.1*mass*(p[1].x - x)/distance^3")
+                 >>> sim.set_equation(0, "let d = p[1].pos - pos; a = $0*d/len(d)^3")
+             )pbdoc")
+
+        // Constraints
+        .def("add_distance_constraint", &SimulationWrapper::add_distance_constraint,
+            py::arg("object_index"), py::arg("constraint"),
+            "Add distance constraint between objects")
+
+        .def("add_distance_constraints", &SimulationWrapper::add_distance_constraints,
+            py::arg("object_indices"), py::arg("targets"), py::arg("rest_lengths"),
+            py::arg("break_lengths") = std::vector<float>(),
+            "Add many distance constraints (object_indices[i] -> targets[i]) with one upload; "
+            "break_lengths (optional, 0 = never) drops each one once stretched past it")
+
+        .def("add_boundary_constraint", &SimulationWrapper::add_boundary_constraint,
+            py::arg("object_index"), py::arg("constraint"),
+            "Add boundary constraint to object")
+
+        .def("clear_constraints", &SimulationWrapper::clear_constraints,
+            py::arg("object_index"),
+            "Clear all constraints from object")
+
+        .def("clear_all_constraints", &SimulationWrapper::clear_all_constraints,
+            "Clear all constraints from all objects")
+
+        // Collision management
+        .def("set_collision_enabled", &SimulationWrapper::set_collision_enabled,
+            py::arg("index"), py::arg("enabled"),
+            R"pbdoc(
+             Enable or disable collision detection for an object.
+             
+             Args:
+                 index (int): Object ID
+                 enabled (bool): True to enable collisions, False to disable
+                 
+             Example:
+                 >>> sim.set_collision_enabled(0, False)  # Disable collisions for object 0
+             )pbdoc")
+
+        .def("set_collision_shape", &SimulationWrapper::set_collision_shape,
+            py::arg("index"), py::arg("shape"),
+            R"pbdoc(
+             Set collision shape for an object.
+             
+             Args:
+                 index (int): Object ID
+                 shape (CollisionShape): Collision shape type
+                 
+             Note: Shape is automatically set based on visual skin when adding objects.
+             
+             Example:
+                 >>> sim.set_collision_shape(0, CollisionShape.CIRCLE)
+             )pbdoc")
+
+        .def("set_collision_properties", &SimulationWrapper::set_collision_properties,
+            py::arg("index"), py::arg("restitution"), py::arg("friction"),
+            R"pbdoc(
+             Set collision physical properties.
+             
+             Args:
+                 index (int): Object ID
+                 restitution (float): Bounciness (0.0-1.0)
+                     0.0 = no bounce (inelastic collision)
+                     1.0 = perfect bounce (elastic collision)
+                 friction (float): Surface friction (0.0-1.0)
+                     0.0 = frictionless (ice)
+                     1.0 = maximum friction (rubber)
+                 
+             Example:
+                 >>> sim.set_collision_properties(0, restitution=0.9, friction=0.1)
+                 >>> # Makes object 0 very bouncy with low friction
+             )pbdoc")
+
+        .def("get_collision_config", &SimulationWrapper::get_collision_config,
+            py::arg("index"),
+            R"pbdoc(
+             Get collision configuration for an object.
+             
+             Args:
+                 index (int): Object ID
+                 
+             Returns:
+                 CollisionConfig: Current collision settings
+                 
+             Example:
+                 >>> config = sim.get_collision_config(0)
+                 >>> print(f"Restitution: {config.restitution}")
+             )pbdoc")
+
+        .def("enable_collision_between", &SimulationWrapper::enable_collision_between,
+            py::arg("obj1"), py::arg("obj2"), py::arg("enable"),
+            R"pbdoc(
+             Enable or disable collision detection between two specific objects.
+             
+             Args:
+                 obj1 (int): First object ID
+                 obj2 (int): Second object ID
+                 enable (bool): True to enable, False to disable
+                 
+             Useful for creating collision layers or groups.
+             
+             Example:
+                 >>> sim.enable_collision_between(0, 1, False)
+                 >>> # Objects 0 and 1 will pass through each other
+             )pbdoc")
+
+        .def("set_collision_filter", &SimulationWrapper::set_collision_filter,
+            py::arg("index"), py::arg("category"), py::arg("mask"),
+            R"pbdoc(
+             Set collision category and mask bits for an object.
+             
+             Two objects collide only if each one's category overlaps the other's mask.
+             
+             Args:
+                 index (int): Object ID
+                 category (int): Category bits the object belongs to (default 0x1)
+                 mask (int): Categories the object collides with (default 0xFFFFFFFF)
+                 
+             Example:
+                 >>> sim.set_collision_filter(0, 0x2, 0xFFFFFFFF & ~0x2)
+                 >>> # Object 0 ignores everything else in category 0x2
+             )pbdoc")
+
+        .def("set_continuous_collision", &SimulationWrapper::set_continuous_collision,
+            py::arg("index"), py::arg("enabled") = true,
+            R"pbdoc(
+             Test an object's collisions over the whole step, not just at its end.
+             
+             A pair with a continuous object that the end-of-step test finds apart is
+             swept as a ray against the two shapes' Minkowski sum (polygons as their
+             bounding circles); at a hit the object stops where it touched for the
+             rest of the step and the usual response applies. Its broadphase search
+             covers the path (velocity * dt), so fast bodies no longer tunnel through
+             thin shapes and the timestep can be raised. The pair is resolved for
+             the other object too when its own search finds the hit, which is
+             always the case when it is continuous as well or the contact solver
+             is on. Off by default.
+             
+             Args:
+                 index (int): Object ID
+                 enabled (bool): True for swept tests (default), False for end-of-step tests only
+                 
+             Example:
+                 >>> sim.set_continuous_collision(bullet)
+             )pbdoc")
+
+        // Batch collision settings: one upload for all listed objects
+        .def("batch_set_collision_enabled", &SimulationWrapper::batch_set_collision_enabled,
+            py::arg("indices"), py::arg("enabled"),
+            "Enable or disable collisions for many objects")
+
+        .def("batch_set_collision_shape", &SimulationWrapper::batch_set_collision_shape,
+            py::arg("indices"), py::arg("shape"),
+            "Set the collision shape of many objects")
+
+        .def("batch_set_collision_properties", &SimulationWrapper::batch_set_collision_properties,
+            py::arg("indices"), py::arg("restitution") = 0.7f, py::arg("friction") = 0.3f,
+            "Set restitution and friction (0.0-1.0) of many objects")
+
+        .def("batch_set_collision_filter", &SimulationWrapper::batch_set_collision_filter,
+            py::arg("indices"), py::arg("category"), py::arg("mask"),
+            "Set collision category and mask bits of many objects (see set_collision_filter)")
+
+        .def("batch_set_continuous_collision", &SimulationWrapper::batch_set_continuous_collision,
+            py::arg("indices"), py::arg("enabled") = true,
+            "Turn swept collision tests on or off for many objects (see set_continuous_collision)")
+
+        .def("is_collision_enabled", &SimulationWrapper::is_collision_enabled,
+            py::arg("index"),
+            R"pbdoc(
+             Check if collision detection is enabled for an object.
+             
+             Args:
+                 index (int): Object ID
+                 
+             Returns:
+                 bool: True if collisions are enabled
+             )pbdoc")
+
+        .def("set_object_static", &SimulationWrapper::set_object_static,
+            py::arg("index"), py::arg("is_static") = true,
+            R"pbdoc(
+             Make an object a static collider: it is never integrated and never moves in a
+             collision, and dynamic objects bounce off it as if it had infinite mass. Static
+             objects are kept in a grid of their own that is only rebuilt when one of them is
+             added, removed, moved or resized, so walls and terrain cost almost nothing per step.
+             They stay ordinary objects otherwise (p[i], rendering, picking, set_object).
+             While emitters are active every object is dynamic. The static grid does not wrap
+             across a periodic boundary.
+
+             Args:
+                 index (int): Object ID
+                 is_static (bool): True for a static collider, False for a dynamic object
+             )pbdoc")
+
+        .def("is_object_static", &SimulationWrapper::is_object_static,
+            py::arg("index"),
+            R"pbdoc(
+             Check if an object is a static collider.
+
+             Args:
+                 index (int): Object ID
+
+             Returns:
+                 bool: True if the object is static
+             )pbdoc")
+
+        .def("get_static_object_count", &SimulationWrapper::get_static_object_count,
+            "Number of static colliders (see set_object_static)")
+
+        .def("set_object_kinematic", &SimulationWrapper::set_object_kinematic,
+            py::arg("index"), py::arg("table_x"), py::arg("table_y"), py::arg("period") = 0.0f,
+            R"pbdoc(
+             Make an object kinematic: instead of integrating its equation, every step puts it
+             where the tables say at the simulation time, x = table(table_x, t) and
+             y = table(table_y, t), with the velocity of that motion. Constraints and
+             collisions never move it, and the objects it hits bounce off it as if it had
+             infinite mass and its velocity (conveyors, moving platforms). A kinematic object
+             is no longer static. While any object is kinematic, objects do not sleep.
+
+             Args:
+                 index (int): Object ID
+                 table_x (int): Table id of x (see set_table), -1 to keep x
+                 table_y (int): Table id of y, -1 to keep y
+                 period (float): Time the path repeats after, 0 = it does not
+             )pbdoc")
+
+        .def("set_object_keyframes", &SimulationWrapper::set_object_keyframes,
+            py::arg("index"), py::arg("keyframes"), py::arg("table_x"), py::arg("table_y"),
+            py::arg("loop") = false,
+            R"pbdoc(
+             Make an object kinematic along keyframes, linear between them: the track is
+             resampled into tables table_x and table_y (replacing them), then used as in
+             set_object_kinematic. Before the first key and after the last the object holds.
+
+             Args:
+                 index (int): Object ID
+                 keyframes (list): (time, x, y) keys, times increasing
+                 table_x (int): Table id that receives x
+                 table_y (int): Table id that receives y
+                 loop (bool): Repeat the track every time of the last key
+             )pbdoc")
+
+        .def("clear_object_kinematic", &SimulationWrapper::clear_object_kinematic,
+            py::arg("index"),
+            "Return a kinematic object to its equation, from where its path left it")
+
+        .def("is_object_kinematic", &SimulationWrapper::is_object_kinematic,
+            py::arg("index"),
+            R"pbdoc(
+             Check if an object is kinematic.
+
+             Args:
+                 index (int): Object ID
+
+             Returns:
+                 bool: True if the object follows a path
+             )pbdoc")
+
+        .def("get_kinematic_object_count", &SimulationWrapper::get_kinematic_object_count,
+            "Number of kinematic objects (see set_object_kinematic)")
+
+        .def("set_sdf_collider", &SimulationWrapper::set_sdf_collider,
+            py::arg("expression"),
+            R"pbdoc(
+             Set a static environment by its signed distance: expression is the distance
+             from (x, y) to the surface, negative inside the solid, and may use t and the
+             constants of any equation. After the narrowphase every collidable object that
+             is neither static nor kinematic is tested against it directly, with no
+             broadphase entry: the distance and its gradient at the object's centre give the
+             penetration and the normal, and the object is pushed out along the gradient with
+             the surface's restitution and friction (see set_sdf_surface). One expression
+             replaces any number of wall objects. With a grid as well (set_sdf_grid), the
+             environment is the union of both.
+
+             Args:
+                 expression (str): Signed distance of x, y
+
+             Raises:
+                 RuntimeError: If the expression does not parse or compile, or uses
+                     per-step inputs (sum_j, rand(), s0..s7, agg[], ...)
+
+             Example:
+                 >>> # Inside a circular arena of radius 10
+                 >>> sim.set_sdf_collider("10 - sqrt(x^2 + y^2)")
+             )pbdoc")
+
+        .def("clear_sdf_collider", &SimulationWrapper::clear_sdf_collider,
+            "Remove the SDF expression; a grid set with set_sdf_grid stays")
+
+        .def("set_sdf_grid", &SimulationWrapper::set_sdf_grid,
+            py::arg("distances"), py::arg("box"),
+            R"pbdoc(
+             Set a sampled signed distance, such as terrain baked from an image, collided
+             with as set_sdf_collider describes. distances is a list of equally long rows,
+             the first at the bottom of the box, spanning it edge to edge; it is read
+             bilinearly, and outside the box the distance grows with the distance to the box.
+             Same-sized updates are an in-place upload.
+
+             Args:
+                 distances (list): Rows of signed distances from min_y, at least 2 x 2
+                 box (tuple): (min_x, min_y, width, height)
+
+             Raises:
+                 RuntimeError: If the rows or the box are invalid, or a side exceeds 4096
+             )pbdoc")
+
+        .def("clear_sdf_grid", &SimulationWrapper::clear_sdf_grid,
+            "Remove the SDF grid; an expression set with set_sdf_collider stays")
+
+        .def("set_sdf_surface", &SimulationWrapper::set_sdf_surface,
+            py::arg("restitution") = 0.5f, py::arg("friction") = 0.3f,
+            R"pbdoc(
+             Set the surface of the SDF environment. It combines with each object's as two
+             objects would: the smaller restitution, the geometric mean of the frictions.
+
+             Args:
+                 restitution (float): 0 to 1, default 0.5
+                 friction (float): >= 0, default 0.3
+
+             Raises:
+                 RuntimeError: If either is out of range
+             )pbdoc")
+
+            // For set_collision_parameters (void return)
+            .def("set_collision_parameters", &SimulationWrapper::set_collision_parameters,
+                py::arg("enable_warm_start"), py::arg("max_contact_iterations"),
+                R"pbdoc(
+     Set global collision parameters.
+     
+     The narrowphase emits every touching pair once and the contact solver
+     runs max_contact_iterations impulse iterations over them. With warm
+     starting, each pair starts from the impulses it ended the previous
+     step with, so stacks settle with fewer iterations.
+     
+     Args:
+         enable_warm_start (bool): Enable warm starting for contacts
+         max_contact_iterations (int): Maximum iterations for contact resolution (1-20)
+     )pbdoc")
+
+            // For get_collision_parameters
+            .def("get_collision_parameters", &SimulationWrapper::get_collision_parameters,
+                R"pbdoc(
+     Get global collision parameters.
+     
+     Returns:
+         tuple: (enable_warm_start, max_contact_iterations)
+     )pbdoc")
+
+            .def("get_contact_count", &SimulationWrapper::get_contact_count,
+                R"pbdoc(
+     Number of contact pairs the last step solved.
+     
+     Reads the count back from the GPU, so call it for profiling rather
+     than every frame.
+     
+     Returns:
+         int: Contact pairs (-1 until the contact solver has run)
+     )pbdoc")
+
+            .def("set_broadphase_mode", &SimulationWrapper::set_broadphase_mode,
+                py::arg("mode"),
+                R"pbdoc(
+     Select the collision broadphase.
+     
+     Args:
+         mode (BroadphaseMode): ALL_PAIRS, UNIFORM_GRID (default) or LBVH
+     )pbdoc")
+
+            .def("get_broadphase_mode", &SimulationWrapper::get_broadphase_mode,
+                R"pbdoc(
+     Get the selected collision broadphase.
+     
+     Returns:
+         BroadphaseMode: Current broadphase mode
+     )pbdoc")
+
+            .def("set_narrowphase_buckets", &SimulationWrapper::set_narrowphase_buckets,
+                py::arg("enabled"),
+                R"pbdoc(
+     Split the narrowphase by collision shape in scenes that mix shapes.
+     
+     Each shape runs as its own dispatch, built for that shape's tests,
+     so circles do not wait on the polygon SAT of their neighbours.
+     Steps with sleeping objects or GPU-spawned objects use one dispatch.
+     
+     Args:
+         enabled (bool): True to split (default), False for one dispatch
+     )pbdoc")
+
+            .def("get_narrowphase_buckets", &SimulationWrapper::get_narrowphase_buckets,
+                R"pbdoc(
+     Check whether the narrowphase is split by collision shape.
+     
+     Returns:
+         bool: True if mixed scenes run one dispatch per shape
+     )pbdoc")
+
+            .def("set_neighbour_skin", &SimulationWrapper::set_neighbour_skin,
+                py::arg("skin"),
+                R"pbdoc(
+     Reuse the collision broadphase across steps within a skin margin.
+     
+     The grid or LBVH and a per-object candidate list are built with
+     the margin added, then reused until some collidable object has
+     moved (or grown) by more than half of it. A GPU pass decides each
+     step, so substeps that barely move objects skip the rebuild. The
+     all-pairs mode is unaffected.
+     
+     Args:
+         skin (float): Margin in world units, 0 to rebuild every step (default)
+     )pbdoc")
+
+            .def("get_neighbour_skin", &SimulationWrapper::get_neighbour_skin,
+                R"pbdoc(
+     Get the skin margin the collision broadphase is reused within.
+     
+     Returns:
+         float: Margin in world units, 0 if rebuilt every step
+     )pbdoc")
+
+            .def("set_small_world_objects", &SimulationWrapper::set_small_world_objects,
+                py::arg("objects"),
+                R"pbdoc(
+     Set the largest ensemble world that collides without a broadphase.
+     
+     A world's objects are contiguous, so a small world fills a few
+     lanes of a shared workgroup and its objects test each other
+     directly. The grid or LBVH is built only when some world is
+     larger, and those worlds keep using it.
+     
+     Args:
+         objects (int): Objects per world, 0 to use the broadphase for all (default 64)
+     )pbdoc")
+
+            .def("get_small_world_objects", &SimulationWrapper::get_small_world_objects,
+                R"pbdoc(
+     Get the largest ensemble world that collides without a broadphase.
+     
+     Returns:
+         int: Objects per world
+     )pbdoc")
+
+            .def("get_broadphase_rebuilds", &SimulationWrapper::get_broadphase_rebuilds,
+                R"pbdoc(
+     Count the broadphase rebuilds the skin check has run.
+     
+     Waits for the GPU. Compare with the steps taken to see how well
+     the skin amortizes the build.
+     
+     Returns:
+         int: Rebuilds since the skin was first used
+     )pbdoc")
+
+            .def("set_equation_compile_mode", &SimulationWrapper::set_equation_compile_mode,
+                py::arg("enabled"),
+                R"pbdoc(
+     Compile registered equations into specialized shader code.
+     
+     The shader is rebuilt in the background whenever new equations are
+     registered; until it is ready they run on the RPN interpreter.
+     D() taken numerically or with dual numbers runs on the interpreter.
+     
+     Args:
+         enabled (bool): True to compile equations, False to interpret them (default)
+     )pbdoc")
+
+            .def("get_equation_compile_mode", &SimulationWrapper::get_equation_compile_mode,
+                R"pbdoc(
+     Check whether equations are compiled into specialized shader code.
+     
+     Returns:
+         bool: True if equation compile mode is enabled
+     )pbdoc")
+
+            .def("set_equation_cache", &SimulationWrapper::set_equation_cache,
+                py::arg("directory"),
+                R"pbdoc(
+     Keep serialized equations in a directory across runs.
+     
+     set_equation, batch_set_equation and set_equations look an equation up there
+     before parsing it, and store what they had to parse. Entries are tied to the
+     shader build, so an upgraded module ignores old ones. Off by default, unless the
+     STELLAR_EQUATION_CACHE environment variable names a directory.
+     
+     Args:
+         directory (str): Cache directory, created when needed; empty to turn the cache off
+     )pbdoc")
+
+            .def("get_equation_cache", &SimulationWrapper::get_equation_cache,
+                "Directory of the equation cache, empty when it is off")
+
+            .def("set_register_bytecode_enabled", &SimulationWrapper::set_register_bytecode_enabled,
+                py::arg("enabled"),
+                R"pbdoc(
+     Run interpreted equation components as register bytecode.
+     
+     Components that need run-time complex tracking, derivatives or
+     more than 16 live values stay on the RPN stack interpreter.
+     
+     Args:
+         enabled (bool): True to use register bytecode (default), False for the stack interpreter only
+     )pbdoc")
+
+            .def("get_register_bytecode_enabled", &SimulationWrapper::get_register_bytecode_enabled,
+                R"pbdoc(
+     Check whether interpreted equation components run as register bytecode.
+     
+     Returns:
+         bool: True if register bytecode is enabled
+     )pbdoc")
+
+            .def("set_fast_math", &SimulationWrapper::set_fast_math,
+                py::arg("enabled"), py::arg("scan_interval") = 60, py::arg("rollback") = false,
+                R"pbdoc(
+     Run equations without their per-operation NaN/Inf guards.
+     
+     Divisions by zero, logarithms of negative values and overflowing
+     exponentials are no longer clamped to 0 on the spot. Instead a scan
+     over all objects runs every scan_interval steps and reports the
+     objects whose state went NaN or infinite (see get_invalid_objects()).
+     With rollback, a scan that finds any puts back the state of the last
+     clean scan and the next scan_interval steps run with the guards on;
+     simulation time is not rewound. The guard-free shader builds in the
+     background; until it is ready the guarded one runs.
+     
+     Args:
+         enabled (bool): True for fast math, False for guarded math (default)
+         scan_interval (int): Steps between scans, 0 = never scan (default 60)
+         rollback (bool): Roll back to the last clean scan on NaN/Inf (default False)
+     )pbdoc")
+
+            .def("get_fast_math", &SimulationWrapper::get_fast_math,
+                R"pbdoc(
+     Get the fast math settings.
+     
+     Returns:
+         tuple: (enabled, scan_interval, rollback)
+     )pbdoc")
+
+            .def("get_invalid_objects", &SimulationWrapper::get_invalid_objects,
+                R"pbdoc(
+     Objects the last fast math scan found holding NaN or infinity.
+     
+     Returns:
+         tuple: (count, indices) - every invalid object is counted, the
+         first 64 are listed in ascending order
+     )pbdoc")
+
+            .def("get_nan_rollback_count", &SimulationWrapper::get_nan_rollback_count,
+                R"pbdoc(
+     Number of fast math roll backs since the simulation started.
+     
+     Returns:
+         int: Roll backs
+     )pbdoc")
+
+            .def("set_dispatch_reorder_interval", &SimulationWrapper::set_dispatch_reorder_interval,
+                py::arg("steps"),
+                R"pbdoc(
+     Group objects by equation on the GPU to reduce shader divergence.
+     
+     Every `steps` steps the physics pass re-sorts the order in which it
+     visits objects by (equation, spatial cell). Objects keep their
+     indices; only the processing order changes. Useful when many
+     different equations are interleaved across thousands of objects.
+     
+     Args:
+         steps (int): Re-sort interval in simulation steps, 0 to disable (default)
+     )pbdoc")
+
+            .def("get_dispatch_reorder_interval", &SimulationWrapper::get_dispatch_reorder_interval,
+                R"pbdoc(
+     Get the dispatch re-sort interval.
+     
+     Returns:
+         int: Interval in simulation steps, 0 if reordering is disabled
+     )pbdoc")
+
+            .def("set_storage_reorder_interval", &SimulationWrapper::set_storage_reorder_interval,
+                py::arg("steps"),
+                R"pbdoc(
+     Keep objects that are close in space close in memory.
+     
+     Every `steps` steps the object storage is sorted by the Z-order
+     (Morton) code of each object's position, so collision cells,
+     neighbour sums and p[i] reads fetch neighbouring rows. Indices change
+     as after remove_objects; handles keep naming the same objects, so
+     track objects by handle while this is on. Sleeping objects are woken
+     and trails restart at each sort. Scenes with worlds, springs or
+     spawned objects are never re-sorted.
+     
+     Args:
+         steps (int): Re-sort interval in simulation steps, 0 to disable (default)
+     )pbdoc")
+
+            .def("get_storage_reorder_interval", &SimulationWrapper::get_storage_reorder_interval,
+                R"pbdoc(
+     Get the storage re-sort interval.
+     
+     Returns:
+         int: Interval in simulation steps, 0 if reordering is disabled
+     )pbdoc")
+
+            .def("tune_workgroup_sizes", &SimulationWrapper::tune_workgroup_sizes,
+                py::arg("force") = false,
+                R"pbdoc(
+     Find the fastest work-group size of each per-object pass on this GPU.
+     
+     Over the next steps the integrate, constraint and collision passes
+     are timed at 16, 32, 64, 128 and 256 threads per work group, and
+     each keeps the fastest. Keep stepping the scene to tune while it
+     runs; passes the scene does not use keep the default of 16. Steps
+     with sleeping objects stay at 16. The result is stored per GPU and
+     driver next to the shader cache and loaded on start-up, so a
+     machine tunes once.
+     
+     Args:
+         force (bool): Tune again even if sizes are stored for this GPU
+     )pbdoc")
+
+            .def("is_workgroup_tuning", &SimulationWrapper::is_workgroup_tuning,
+                R"pbdoc(
+     Whether tune_workgroup_sizes is still timing candidates.
+     
+     Returns:
+         bool: True while tuning
+     )pbdoc")
+
+            .def("get_workgroup_sizes", &SimulationWrapper::get_workgroup_sizes,
+                R"pbdoc(
+     Get the tuned work-group sizes.
+     
+     Returns:
+         tuple: (integrate, constraints, collide) threads per work group
+     )pbdoc")
+
+            .def("set_soa_storage_enabled", &SimulationWrapper::set_soa_storage_enabled,
+                py::arg("enabled"), py::arg("quantized") = false,
+                R"pbdoc(
+     Read other objects from structure-of-arrays streams on the GPU.
+     
+     Before each pass that reads neighbours (p[i].x, sum_j, nsum and
+     collision candidates) the fields those reads use are copied into one
+     dense array per field, so the neighbour loops load 16 bytes per field
+     instead of whole objects. Costs one extra copy pass per step; pays off
+     when every object reads many others. Results are unchanged.
+     
+     The quantized layout packs the streams into 48 bytes per object instead
+     of 64: the colour as RGBA8, polygon height/sides, angular velocity and
+     last acceleration as half floats, and the skin and shape types as 16-bit
+     fields, so neighbour reads never touch the full objects. Position,
+     velocity, mass, charge, size and rotation keep full precision. Only what
+     other objects see is quantized, so results can differ slightly where
+     equations read those fields of other objects.
+     
+     Args:
+         enabled (bool): True to use the streams, False to read objects directly (default)
+         quantized (bool): True for the quantized stream layout (default False)
+     )pbdoc")
+
+            .def("get_soa_storage_enabled", &SimulationWrapper::get_soa_storage_enabled,
+                R"pbdoc(
+     Check whether neighbour reads use structure-of-arrays streams.
+     
+     Returns:
+         bool: True if structure-of-arrays storage is enabled
+     )pbdoc")
+
+            .def("get_soa_storage_quantized", &SimulationWrapper::get_soa_storage_quantized,
+                R"pbdoc(
+     Check whether the structure-of-arrays streams use the quantized layout.
+     
+     Returns:
+         bool: True if the streams are quantized
+     )pbdoc")
+
+            .def("set_fused_substeps", &SimulationWrapper::set_fused_substeps,
+                py::arg("enabled"),
+                R"pbdoc(
+     Run all pending fixed steps of an update() in a single GPU dispatch.
+     
+     The physics kernel loops over the steps itself and keeps object state
+     in registers, reading and writing object memory once per update().
+     Only applies while no equation references other objects (p[i].x, sum_j)
+     and there are no constraints or collidable objects; otherwise steps
+     are dispatched one at a time as usual.
+     
+     Args:
+         enabled (bool): True to fuse steps, False for one dispatch per step (default)
+     )pbdoc")
+
+            .def("get_fused_substeps", &SimulationWrapper::get_fused_substeps,
+                R"pbdoc(
+     Check whether fixed steps are fused into a single dispatch.
+     
+     Returns:
+         bool: True if fused substeps are enabled
+     )pbdoc")
+
+            .def("set_long_range_parameters", &SimulationWrapper::set_long_range_parameters,
+                py::arg("theta") = 0.5f, py::arg("gravity_constant") = 1.0f,
+                py::arg("coulomb_constant") = 1.0f, py::arg("softening") = 0.01f,
+                R"pbdoc(
+     Configure the Barnes-Hut solver behind grav_ax/grav_ay and coul_ax/coul_ay.
+     
+     When an equation reads these variables, a tree over all objects is
+     rebuilt on the GPU each step and every object sums the mass and charge
+     of distant groups as single points, costing O(N log N) instead of the
+     O(N^2) of sum_j(). Accelerations use the state at the start of the step.
+     
+     Args:
+         theta (float): Opening angle; smaller is more accurate, 0 is exact (default 0.5)
+         gravity_constant (float): G in a = G*m_j*r/(r^2+eps^2)^1.5 (default 1.0)
+         coulomb_constant (float): k in a = -k*q*q_j*r/((r^2+eps^2)^1.5 * mass) (default 1.0)
+         softening (float): Softening length eps (default 0.01)
+     
+     Example:
+         >>> sim.set_long_range_parameters(theta=0.7, gravity_constant=0.5)
+         >>> sim.set_equation(i, "grav_ax, grav_ay")
+     )pbdoc")
+
+            .def("get_long_range_parameters", &SimulationWrapper::get_long_range_parameters,
+                R"pbdoc(
+     Get the Barnes-Hut solver parameters.
+     
+     Returns:
+         tuple: (theta, gravity_constant, coulomb_constant, softening)
+     )pbdoc")
+
+            .def("set_long_range_method", &SimulationWrapper::set_long_range_method,
+                py::arg("method") = "barnes_hut", py::arg("mesh_size") = 256,
+                py::arg("periodic_box") = std::make_tuple(0.0f, 0.0f, 0.0f, 0.0f),
+                R"pbdoc(
+     Choose how grav_ax/grav_ay and coul_ax/coul_ay are evaluated.
+     
+     "particle_mesh" deposits mass and charge cloud-in-cell onto a
+     mesh_size x mesh_size grid, solves the softened potential with an FFT on
+     the GPU and interpolates its gradient back to the objects, costing
+     O(N + M^2 log M) however the objects cluster. Forces use the constants
+     and softening of set_long_range_parameters(), smoothed below one cell.
+     Without a periodic box the mesh is refitted to the objects every step
+     and zero-padded, so there are no image forces; with one, the box's
+     edges wrap and each pair interacts through its nearest image. theta
+     only applies to "barnes_hut".
+     
+     Args:
+         method (str): "barnes_hut" (default) or "particle_mesh"
+         mesh_size (int): Cells per side, a power of two from 16 to 512, or 1024 when periodic (default 256)
+         periodic_box (tuple): (min_x, min_y, width, height) of a wrapping box; zero size for none (default)
+     
+     Raises:
+         RuntimeError: If method is unknown or the mesh size or box is invalid
+     
+     Example:
+         >>> sim.set_long_range_method("particle_mesh", mesh_size=512)
+         >>> sim.set_equation(i, "grav_ax, grav_ay")
+     )pbdoc")
+
+            .def("get_long_range_method", &SimulationWrapper::get_long_range_method,
+                R"pbdoc(
+     Get the long-range method and its mesh settings.
+     
+     Returns:
+         tuple: (method, mesh_size, periodic_box)
+     )pbdoc")
+
+            .def("set_world_bounds", &SimulationWrapper::set_world_bounds,
+                py::arg("mode") = "reflect",
+                py::arg("box") = std::make_tuple(-1000000.0f, -1000000.0f, 2000000.0f, 2000000.0f),
+                R"pbdoc(
+     Choose what happens at the edges of the world.
+     
+     "reflect" bounces objects off walls at the box edges with the global
+     restitution (the default, with walls at +-1e6). "periodic" wraps an
+     object leaving one side back in at the other: collisions, nsum/ncount/
+     nmean and p[i] references all see the nearest image of the other
+     object, and the uniform grid and LBVH search across the seams. "open"
+     has no walls. sum_j() sums also use nearest images in a periodic box;
+     long-range forces, springs and constraints do not (see the periodic_box
+     of set_long_range_method). Periodic boxes always step on the GPU.
+     
+     Args:
+         mode (str): "reflect" (default), "periodic" or "open"
+         box (tuple): (min_x, min_y, width, height) of the world (default +-1e6)
+     
+     Raises:
+         RuntimeError: If mode is unknown or the box has no area
+     
+     Example:
+         >>> sim.set_world_bounds("periodic", (0.0, 0.0, 100.0, 100.0))
+     )pbdoc")
+
+            .def("get_world_bounds", &SimulationWrapper::get_world_bounds,
+                R"pbdoc(
+     Get the boundary mode and the world box.
+     
+     Returns:
+         tuple: (mode, (min_x, min_y, width, height))
+     )pbdoc")
+
+            .def("set_random_seed", &SimulationWrapper::set_random_seed,
+                py::arg("seed"),
+                R"pbdoc(
+     Set the seed of rand() and randn() in equations.
+     
+     Every draw is a counter-based Philox hash of the seed, the step number,
+     the object index and the call, so nothing is stored per object and a
+     reset with the same seed replays the same noise. The seed is kept across
+     resets; equations with rand() or randn() always step on the GPU.
+     
+     Args:
+         seed (int): 32-bit seed (default 0)
+     
+     Example:
+         >>> sim.set_equation(0, "ax = 0.5*randn(); ay = 0.5*randn()")
+         >>> sim.set_random_seed(42)
+     )pbdoc")
+
+            .def("get_random_seed", &SimulationWrapper::get_random_seed,
+                "Get the seed of rand() and randn()")
+
+            .def("set_metropolis", &SimulationWrapper::set_metropolis,
+                py::arg("enabled"), py::arg("step_size") = 0.1f,
+                py::arg("histogram_box") = std::make_tuple(-1.0f, -1.0f, 2.0f, 2.0f),
+                py::arg("histogram_bins") = std::make_tuple(0, 0),
+                R"pbdoc(
+     Sample with Metropolis chains instead of integrating.
+     
+     While enabled every object is one MCMC chain over its position. Each
+     step proposes a Gaussian move of step_size per axis, evaluates the
+     object's equation at the current and the proposed position and accepts
+     with probability min(1, exp(logp' - logp)), all on the GPU. The
+     log-density is the "logp" statement (the ax component):
+     
+         sim.set_equation(0, "logp = -0.5*(x^2 + y^2)")
+     
+     Draws use the seed of set_random_seed. Velocity, rotation and the world
+     walls are left alone; a periodic world wraps the proposals. NaN or Inf
+     densities read 0, so return a large negative value outside the support.
+     Acceptance counts and a histogram of the positions after each step are
+     added up on the GPU; changing the settings clears them.
+     
+     Args:
+         enabled (bool): Run the chains
+         step_size (float): Proposal standard deviation per axis, default 0.1
+         histogram_box (tuple): (min_x, min_y, width, height) of the histogram
+         histogram_bins (tuple): (bins_x, bins_y), default (0, 0) = no histogram
+     
+     Raises:
+         RuntimeError: If step_size is not positive or the histogram is invalid
+     
+     Example:
+         >>> sim.set_metropolis(True, 0.5, (-4.0, -4.0, 8.0, 8.0), (64, 64))
+     )pbdoc")
+
+            .def("get_metropolis_stats", &SimulationWrapper::get_metropolis_stats,
+                R"pbdoc(
+     Read the acceptance counts and the histogram of the chains.
+     
+     Waits for the GPU. The acceptance rate of chain i is accepted[i] /
+     proposals.
+     
+     Returns:
+         tuple: (proposals per chain, accepted per object, histogram rows from min_y)
+     )pbdoc")
+
+            .def("clear_metropolis_stats", &SimulationWrapper::clear_metropolis_stats,
+                "Zero the acceptance counts and the histogram (for example after burn-in)")
+
+            .def("set_table", &SimulationWrapper::set_table,
+                py::arg("id"), py::arg("values"), py::arg("x_range") = std::make_tuple(0.0f, 1.0f),
+                py::arg("interpolation") = "linear",
+                R"pbdoc(
+     Set the 1D table that table(id, x) samples in the equations.
+     
+     The values are spaced evenly over x_range and interpolated linearly or
+     with a Catmull-Rom cubic through them; x outside the range reads the
+     edge value. Equations only name the id, so new values take effect on
+     the next step without recompiling. Replacing a table with as many
+     values uploads just its range; a new length repacks the lookup buffer.
+     A table that was never set reads 0.
+     
+     Args:
+         id (int): Table id, 0 to 63
+         values (list): Samples, at least one
+         x_range (tuple): (min_x, max_x) of the first and last sample, default (0, 1)
+         interpolation (str): "linear" (default) or "cubic"
+     
+     Raises:
+         RuntimeError: If the id, the values, the range or the interpolation is invalid
+     
+     Example:
+         >>> sim.set_table(0, [0.0, 1.0, 0.5, 0.0], (0.0, 10.0), "cubic")
+         >>> sim.set_equation(0, "ax = table(0, t); ay = 0")
+     )pbdoc")
+
+            .def("set_field", &SimulationWrapper::set_field,
+                py::arg("id"), py::arg("values"), py::arg("box") = std::make_tuple(-1.0f, -1.0f, 2.0f, 2.0f),
+                R"pbdoc(
+     Set the 2D grid that field(id, x, y) samples bilinearly in the equations.
+     
+     values is a list of equally long rows, the first at the bottom of the
+     box; the samples span the box edge to edge and points outside it read
+     the nearest edge. As with set_table, same-sized updates are an in-place
+     upload and never recompile the equations.
+     
+     Args:
+         id (int): Field id, 0 to 63
+         values (list): Rows of samples from min_y
+         box (tuple): (min_x, min_y, width, height), default (-1, -1, 2, 2)
+     
+     Raises:
+         RuntimeError: If the id, the rows or the box is invalid
+     
+     Example:
+         >>> sim.set_field(0, [[0.0, 1.0], [1.0, 2.0]], (-5.0, -5.0, 10.0, 10.0))
+         >>> sim.set_equation(0, "ax = -field(0, x, y); ay = 0")
+     )pbdoc")
+
+            .def("clear_table", &SimulationWrapper::clear_table, py::arg("id"),
+                "Unset a table; table(id, x) reads 0 again")
+
+            .def("clear_field", &SimulationWrapper::clear_field, py::arg("id"),
+                "Unset a field; field(id, x, y) reads 0 again")
+
+            .def("set_grid", &SimulationWrapper::set_grid,
+                py::arg("resolution"), py::arg("box") = std::make_tuple(-1.0f, -1.0f, 2.0f, 2.0f),
+                py::arg("boundary") = "clamp",
+                R"pbdoc(
+     Lay out the grid of the grid PDE mode, dropping any fields on it.
+     
+     The nodes span the box edge to edge, as field() samples them, so node
+     spacing is width / (columns - 1). Stencils that reach past an edge read
+     the edge ("clamp", zero flux), wrap around ("periodic") or read 0
+     ("zero").
+     
+     Args:
+         resolution (tuple[int, int]): (columns, rows) of nodes, at least 2 each
+         box (tuple): (min_x, min_y, width, height), default (-1, -1, 2, 2)
+         boundary (str): "clamp", "periodic" or "zero"
+     
+     Raises:
+         RuntimeError: If the resolution, box or boundary is invalid
+     )pbdoc")
+
+            .def("set_grid_field", &SimulationWrapper::set_grid_field,
+                py::arg("name"), py::arg("expression"), py::arg("values") = std::vector<std::vector<float>>(),
+                py::arg("field_id") = -1,
+                R"pbdoc(
+     Add a scalar field to the grid, or replace one, with its rate of change.
+     
+     Every physics step adds dt * expression at each node (forward Euler)
+     in a GPU pass over 16x16 tiles with their neighbours in shared memory.
+     Expressions read neighbours as u[i+1,j] and u[i,j-2] (up to 4 nodes
+     away), and have lap(u), dx(u) and dy(u), the functions of equations,
+     and x, y, t, dt, hx, hy (node spacing), k, b, g, pi and e. Fields step
+     in the order they were added and see the new values of those before,
+     so a wave added as v then u is stable up to c*dt < h. With a field_id
+     the values are copied into field(field_id, x, y) after every step, so
+     equations of objects sample them; grid fields keep steps unfused and
+     on the GPU. At most 4 fields.
+     
+     Args:
+         name (str): Identifier the expressions use
+         expression (str): du/dt, e.g. "0.1*lap(u) + u - u^3"
+         values (list): Rows from min_y of starting values, default all 0
+         field_id (int): field() id to copy into, -1 for none
+     
+     Raises:
+         RuntimeError: If there is no grid or the expression does not compile
+     
+     Example:
+         >>> sim.set_grid((128, 128), (-5.0, -5.0, 10.0, 10.0), "zero")
+         >>> sim.set_grid_field("v", "4*lap(u)")
+         >>> sim.set_grid_field("u", "v", bump, field_id=0)
+         >>> sim.set_equation(0, "ax = -field(0, x, y); ay = 0")
+     )pbdoc")
+
+            .def("get_grid_field", &SimulationWrapper::get_grid_field, py::arg("name"),
+                "Current values of a grid field as rows from min_y")
+
+            .def("show_grid_field", &SimulationWrapper::show_grid_field,
+                py::arg("name"), py::arg("value_range") = std::make_tuple(-1.0f, 1.0f), py::arg("opacity") = 1.0f,
+                R"pbdoc(
+     Draw a grid field under the objects, blue through white to red.
+     
+     Args:
+         name (str): Field to show, "" to hide
+         value_range (tuple[float, float]): Values at the blue and red ends
+         opacity (float): 0 to 1
+     )pbdoc")
+
+            .def("clear_grid", &SimulationWrapper::clear_grid,
+                "Drop the grid and its fields, and unset the field() ids they filled")
+
+            .def("set_pipeline", &SimulationWrapper::set_pipeline, py::arg("passes"),
+                R"pbdoc(
+     Compute named per-object fields in passes before the equations run.
+     
+     Each pass is "name = expr; name = expr" and runs as one GPU dispatch
+     over every object, with a barrier before the next, once per
+     integrator stage. Expressions follow the rules of reduce() and may
+     also use nsum(), ncount() and nmean(): a pass reads fields of the
+     passes before it as fld[name], and a neighbour's as pj.fld[name]
+     inside a neighbour reduction; a statement also reads the fields of
+     the statements before it in its pass. Equations read the results as
+     fld[name], and pj.fld[name] inside nsum(). At most 8 passes, 8 field
+     names and 4 neighbour reductions per pass; the pipeline keeps steps
+     unfused and on the GPU.
+     
+     Args:
+         passes (list[str]): The passes in order
+     
+     Raises:
+         RuntimeError: If a pass does not parse or compile; the old pipeline stays
+     
+     Example:
+         >>> sim.set_pipeline([
+         ...     "rho = nsum(0.1, pj.mass * (0.01 - (pj.x-x)^2 - (pj.y-y)^2)^3)",
+         ...     "p = max(fld[rho] - 1000, 0)"])
+         >>> sim.set_equation(0, "ax = nsum(0.1, (fld[p] + pj.fld[p]) * (pj.x - x)); ay = 0")
+     )pbdoc")
+
+            .def("get_pipeline_field", &SimulationWrapper::get_pipeline_field, py::arg("name"),
+                "Values of a pipeline field for every object, as of the last step")
+
+            .def("clear_pipeline", &SimulationWrapper::clear_pipeline,
+                "Drop the pipeline; fld[] reads 0 again")
+
+            .def("set_adaptive_timestep", &SimulationWrapper::set_adaptive_timestep,
+                py::arg("enabled"), py::arg("min_dt") = 1.0e-5f, py::arg("max_dt") = 0.01f,
+                py::arg("courant") = 0.1f,
+                R"pbdoc(
+     Choose every step's dt on the GPU from the state of the last step.
+     
+     After each step a reduction takes the smallest of
+     courant * size / |v| and courant * sqrt(size / |a|) over all objects
+     (size = radius or width), clamps it to [min_dt, max_dt] and lets it
+     at most double per step. math.comp reads the result directly, so no
+     step waits for a readback; update() paces itself with the dt it saw
+     a few frames earlier. Steps are not fused while this is enabled.
+     
+     Args:
+         enabled (bool): True for adaptive steps, False for the fixed "timestep" parameter
+         min_dt (float): Smallest allowed dt (default 1e-5)
+         max_dt (float): Largest allowed dt (default 0.01)
+         courant (float): Fraction of its size an object may move per step (default 0.1)
+     )pbdoc")
+
+            .def("get_adaptive_timestep", &SimulationWrapper::get_adaptive_timestep,
+                R"pbdoc(
+     Get the adaptive timestep settings.
+     
+     Returns:
+         tuple: (enabled, min_dt, max_dt, courant)
+     )pbdoc")
+
+            .def("get_timestep_history", &SimulationWrapper::get_timestep_history,
+                R"pbdoc(
+     dt of the most recent adaptive steps (up to 1024), oldest first.
+     
+     Reads the history back from the GPU, so call it for profiling rather
+     than every frame.
+     
+     Returns:
+         list[float]: Step sizes
+     )pbdoc")
+
+            .def("set_sleep_parameters", &SimulationWrapper::set_sleep_parameters,
+                py::arg("enabled"), py::arg("velocity_threshold") = 0.05f,
+                py::arg("acceleration_threshold") = 0.5f, py::arg("steps") = 30,
+                R"pbdoc(
+     Stop integrating and colliding objects that have come to rest.
+     
+     An object whose speed and angular speed stay below velocity_threshold
+     and whose velocity changes by less than acceleration_threshold per
+     second for `steps` consecutive steps is put to rest. After every step
+     the awake objects are compacted into a list on the GPU and the next
+     step's physics and collision passes cover only those. A moving object
+     that hits a sleeper wakes it; writing objects or equations from Python
+     wakes everything. Objects stay awake while there are constraints or
+     a multi-stage integrator runs its stages as separate passes.
+     
+     Args:
+         enabled (bool): True to let objects sleep, False to keep all awake (default)
+         velocity_threshold (float): Largest speed of a resting object (default 0.05)
+         acceleration_threshold (float): Largest |dv/dt| of a resting object (default 0.5)
+         steps (int): Resting steps before an object sleeps (default 30)
+     )pbdoc")
+
+            .def("get_sleep_parameters", &SimulationWrapper::get_sleep_parameters,
+                R"pbdoc(
+     Get the sleep settings.
+     
+     Returns:
+         tuple: (enabled, velocity_threshold, acceleration_threshold, steps)
+     )pbdoc")
+
+            .def("get_awake_object_count", &SimulationWrapper::get_awake_object_count,
+                R"pbdoc(
+     Number of objects the next step integrates.
+     
+     Reads the count back from the GPU, so call it for profiling rather
+     than every frame.
+     
+     Returns:
+         int: Awake objects (all objects while sleeping is off)
+     )pbdoc")
+
+            .def("wake_all_objects", &SimulationWrapper::wake_all_objects,
+                R"pbdoc(
+     Wake every sleeping object.
+     
+     Needed after changing something sleepers cannot notice on their own,
+     such as a global force or a time-dependent equation that starts
+     pushing them.
+     )pbdoc")
+
+            .def("set_xpbd_constraints", &SimulationWrapper::set_xpbd_constraints,
+                py::arg("enabled"), py::arg("iterations") = 4, py::arg("compliance") = 0.0f,
+                R"pbdoc(
+     Solve distance constraints with XPBD over a colored constraint graph.
+     
+     Every distance constraint becomes an edge that moves both of its
+     objects, each by its inverse mass, so give anchors a large mass. The
+     graph is colored so that edges of one color share no object; each
+     iteration sweeps the colors in turn, and later colors see the
+     corrections of earlier ones, so chains and ropes converge in a few
+     iterations. Boundary and angle constraints keep the per-object pass,
+     which runs after this one. Off by default.
+     
+     Args:
+         enabled (bool): True for XPBD distance constraints, False for the per-object pass (default)
+         iterations (int): Sweeps over all colors per step (default 4)
+         compliance (float): Inverse stiffness, 0 = rigid (default 0.0)
+     )pbdoc")
+
+            .def("get_xpbd_constraints", &SimulationWrapper::get_xpbd_constraints,
+                R"pbdoc(
+     Get the XPBD constraint settings.
+     
+     Returns:
+         tuple: (enabled, iterations, compliance)
+     )pbdoc")
+
+            .def("get_xpbd_graph", &SimulationWrapper::get_xpbd_graph,
+                R"pbdoc(
+     Get the size of the colored constraint graph XPBD solved last.
+     
+     Each color is one dispatch per iteration, so colors is what an
+     iteration costs. Breakable distance constraints stay in the
+     per-object pass and are not edges.
+     
+     Returns:
+         tuple: (edges, colors), both 0 before the first XPBD step
+     )pbdoc")
+
+            .def("set_springs",
+                [](SimulationWrapper& self, const py::object& edges, const py::object& stiffness,
+                   const py::object& damping, const py::object& rest_length)
+                {
+                    auto pairs = py::array_t<int, py::array::c_style | py::array::forcecast>::ensure(edges);
+                    if (!pairs || (pairs.size() > 0 && (pairs.ndim() != 2 || pairs.shape(1) != 2)))
+                        throw std::runtime_error("set_springs: edges must be an (E, 2) integer array");
+                    std::vector<int> endpoints(pairs.data(), pairs.data() + pairs.size());
+                    self.set_springs(endpoints, BulkColumn(stiffness, "stiffness", "set_springs"),
+                                     BulkColumn(damping, "damping", "set_springs"),
+                                     BulkColumn(rest_length, "rest_length", "set_springs"));
+                },
+                py::arg("edges"), py::arg("stiffness"), py::arg("damping") = py::none(),
+                py::arg("rest_length") = py::none(),
+                R"pbdoc(
+     Replace the spring network with Hooke springs between pairs of objects.
+     
+     The edges go up in one upload as compressed sparse rows, so cloth
+     and soft bodies with hundreds of thousands of springs load in one
+     call. Each step a dedicated pass sums every object's spring forces
+     after integration, before the constraints and collisions. Springs
+     are explicit unless set_implicit_springs is on, so stiff ones need a
+     small enough timestep. Removing objects clears the network, since
+     the indices move.
+     
+     Args:
+         edges (array): (E, 2) object indices, one row per spring
+         stiffness (array or float): Hooke constant per spring, or one for all
+         damping (array or float): Damping along each spring per unit relative speed (default None = 0)
+         rest_length (array or float): Rest length per spring, or one for all; None or a
+             negative value = the distance at the next step (default None)
+     
+     Raises:
+         RuntimeError: If an index is out of range, an edge joins an object to itself,
+             or a column holds neither one value nor one per edge
+     
+     Example:
+         >>> sim.set_springs(np.column_stack([a, b]), stiffness=500.0, damping=2.0)
+     )pbdoc")
+
+            .def("clear_springs", &SimulationWrapper::clear_springs,
+                R"pbdoc(
+     Remove every spring.
+     )pbdoc")
+
+            .def("get_spring_count", &SimulationWrapper::get_spring_count,
+                R"pbdoc(
+     Get the number of springs in the network.
+     
+     Returns:
+         int: Springs set by the last set_springs call, 0 after clear_springs
+     )pbdoc")
+
+            .def("set_implicit_springs", &SimulationWrapper::set_implicit_springs,
+                py::arg("enabled"), py::arg("iterations") = 20, py::arg("tolerance") = 1e-4f,
+                R"pbdoc(
+     Integrate springs with backward Euler instead of explicit impulses.
+     
+     Each step solves (M - dt*D - dt^2*K) dv = dt*f for the velocity
+     change, with the damping and stiffness Jacobians of the springs, by
+     Jacobi-preconditioned conjugate gradients on the GPU. Stiff cloth and
+     soft bodies stay stable at timesteps that make explicit springs blow
+     up, at the cost of a few passes per iteration; large steps damp the
+     motion more. Nothing is read back: the solve runs the given number of
+     iterations and skips the work of those after it has converged.
+     Constraints are position based and already stable. Off by default.
+     
+     Args:
+         enabled (bool): True for implicit springs, False for explicit (default)
+         iterations (int): Most CG iterations per step (default 20)
+         tolerance (float): Stop once the preconditioned residual is this
+             fraction of the starting one (default 1e-4)
+     
+     Raises:
+         RuntimeError: If iterations < 1 or tolerance < 0
+     )pbdoc")
+
+            .def("get_implicit_springs", &SimulationWrapper::get_implicit_springs,
+                R"pbdoc(
+     Get the implicit spring settings.
+     
+     Returns:
+         tuple: (enabled, iterations, tolerance)
+     )pbdoc")
+
+            .def("add_particle_emitter", &SimulationWrapper::add_particle_emitter,
+                py::arg("template_index"), py::arg("rate"),
+                py::arg("offset_x") = 0.0f, py::arg("offset_y") = 0.0f,
+                py::arg("velocity_x") = 0.0f, py::arg("velocity_y") = 0.0f,
+                py::arg("position_spread") = 0.0f, py::arg("velocity_spread") = 0.0f,
+                py::arg("lifetime") = 0.0f,
+                py::arg("kill_when_transparent") = false, py::arg("kill_outside") = false,
+                py::arg("bounds_min_x") = 0.0f, py::arg("bounds_min_y") = 0.0f,
+                py::arg("bounds_max_x") = 0.0f, py::arg("bounds_max_y") = 0.0f,
+                R"pbdoc(
+     Spawn copies of an object on the GPU at a steady rate.
+     
+     Each spawn copies the template (shape, colour, mass, equation and
+     collision properties) to a random point within position_spread of
+     template + offset, with the template's velocity plus velocity and a
+     random part within velocity_spread. Spawned objects die when their
+     lifetime runs out, when they leave the bounds (kill_outside) or when
+     their colour equation fades alpha to 0 (kill_when_transparent); the
+     GPU refills the holes and keeps the object count, which
+     get_num_objects() reports a few steps late. Spawned objects come
+     after every other object; adding, uploading or resetting objects
+     discards them, and objects do not sleep while they exist.
+     
+     Args:
+         template_index (int): Object copied on spawn (not itself a spawned object)
+         rate (float): Objects per second of simulated time
+         offset_x, offset_y (float): Spawn point relative to the template (default 0)
+         velocity_x, velocity_y (float): Added to the template's velocity (default 0)
+         position_spread (float): Radius of the random spawn disc (default 0)
+         velocity_spread (float): Radius of the random velocity disc (default 0)
+         lifetime (float): Seconds until a spawned object dies, 0 = no limit (default)
+         kill_when_transparent (bool): Kill when the colour alpha reaches 0 (default False)
+         kill_outside (bool): Kill outside [bounds_min, bounds_max] (default False)
+         bounds_min_x, bounds_min_y, bounds_max_x, bounds_max_y (float): Kill bounds
+     
+     Returns:
+         int: Emitter ID
+     )pbdoc")
+
+            .def("remove_particle_emitter", &SimulationWrapper::remove_particle_emitter,
+                py::arg("emitter_id"),
+                R"pbdoc(
+     Stop an emitter. Objects it spawned live on under its kill conditions.
+     
+     Args:
+         emitter_id (int): ID returned by add_particle_emitter
+     )pbdoc")
 
-        .def("add_boundary_constraint", &SimulationWrapper::add_boundary_constraint,
-            py::arg("object_index"), py::arg("constraint"),
-            "Add boundary constraint to object")
+            .def("clear_particle_emitters", &SimulationWrapper::clear_particle_emitters,
+                R"pbdoc(
+     Stop every emitter.
+     )pbdoc")
 
-        .def("clear_constraints", &SimulationWrapper::clear_constraints,
-            py::arg("object_index"),
-            "Clear all constraints from object")
+            .def("get_particle_emitter_count", &SimulationWrapper::get_particle_emitter_count,
+                R"pbdoc(
+     Get the number of emitters.
+     
+     Returns:
+         int: Emitters added and not removed
+     )pbdoc")
 
-        .def("clear_all_constraints", &SimulationWrapper::clear_all_constraints,
-            "Clear all constraints from all objects")
+        // Batch processing
+        .def("run_batch", [](SimulationWrapper& self, const std::vector<BatchConfig>& configs, py::object callback,
+                             bool ensemble, const std::vector<BatchObserver>& observers, int max_worlds)
+            {
+                // Holds the callback by reference, so nothing touches its refcount without the GIL
+                std::function<void(int, const std::vector<ObjectState>&)> forward;
+                if (!callback.is_none()) {
+                    forward = [&callback](int batch_idx, const std::vector<ObjectState>& results) {
+                        py::gil_scoped_acquire acquire;
+                        callback(batch_idx, results);
+                    };
+                }
 
-        // Collision management
-        .def("set_collision_enabled", &SimulationWrapper::set_collision_enabled,
-            py::arg("index"), py::arg("enabled"),
+                py::gil_scoped_release release;
+                self.run_batch(configs, forward, ensemble, observers, max_worlds);
+            },
+            py::arg("configs"), py::arg("callback") = py::none(), py::arg("ensemble") = false,
+            py::arg("observers") = std::vector<BatchObserver>(), py::arg("max_worlds") = 0,
             R"pbdoc(
-             Enable or disable collision detection for an object.
+             Run multiple simulations in batch mode.
              
              Args:
-                 index (int): Object ID
-                 enabled (bool): True to enable collisions, False to disable
-                 
-             Example:
-                 >>> sim.set_collision_enabled(0, False)  # Disable collisions for object 0
+                 configs (list[BatchConfig]): List of simulation configurations
+                 callback (callable): Optional callback for progress/results
+                     Called as: callback(batch_index, results), with the GIL
+                     held; the simulations themselves run without it
+                 ensemble (bool): Run every configuration at once as its own
+                     world instead of one after another. Objects only see
+                     (p[i], sum_j, nsum) and collide with objects of their own
+                     world, and indices in equations and constraints count from
+                     the world's first object. All configurations must share
+                     one dt; long-range forces are not supported.
+                 observers (list[BatchObserver]): Called with frames of every
+                     configuration while it runs, fed from one GPU recording
+                     (an active record() is replaced)
+                 max_worlds (int): Ensemble only: configurations loaded at
+                     once, 0 = all. The next ones take over as soon as every
+                     world is done, by duration or stop condition; stopped
+                     worlds sleep meanwhile.
+                     
+             Note: Only works in headless mode.
              )pbdoc")
 
-        .def("set_collision_shape", &SimulationWrapper::set_collision_shape,
-            py::arg("index"), py::arg("shape"),
-            R"pbdoc(
-             Set collision shape for an object.
-             
-             Args:
-                 index (int): Object ID
-                 shape (CollisionShape): Collision shape type
-                 
-             Note: Shape is automatically set based on visual skin when adding objects.
-             
-             Example:
-                 >>> sim.set_collision_shape(0, CollisionShape.CIRCLE)
-             )pbdoc")
+        .def_static("run_batch_cpu", [](const std::vector<BatchConfig>& configs, py::object callback,
+                                        int threads, float timestep)
+            {
+                std::function<void(int, const std::vector<ObjectState>&)> forward;
+                if (!callback.is_none()) {
+                    forward = [&callback](int batch_idx, const std::vector<ObjectState>& results) {
+                        py::gil_scoped_acquire acquire;
+                        callback(batch_idx, results);
+                    };
+                }
 
-        .def("set_collision_properties", &SimulationWrapper::set_collision_properties,
-            py::arg("index"), py::arg("restitution"), py::arg("friction"),
+                py::gil_scoped_release release;
+                SimulationWrapper::run_batch_cpu(configs, forward, threads, timestep);
+            },
+            py::arg("configs"), py::arg("callback") = py::none(), py::arg("threads") = 0,
+            py::arg("timestep") = 0.001f,
             R"pbdoc(
-             Set collision physical properties.
-             
+             Run multiple simulations in batch mode on the CPU, without an
+             OpenGL context.
+
              Args:
-                 index (int): Object ID
-                 restitution (float): Bounciness (0.0-1.0)
-                     0.0 = no bounce (inelastic collision)
-                     1.0 = perfect bounce (elastic collision)
-                 friction (float): Surface friction (0.0-1.0)
-                     0.0 = frictionless (ice)
-                     1.0 = maximum friction (rubber)
-                 
-             Example:
-                 >>> sim.set_collision_properties(0, restitution=0.9, friction=0.1)
-                 >>> # Makes object 0 very bouncy with low friction
+                 configs (list[BatchConfig]): List of simulation configurations
+                 callback (callable): Optional callback, called as
+                     callback(batch_index, results) with the GIL held once
+                     every configuration has finished
+                 threads (int): Worker threads including the caller, 0 = one
+                     per hardware thread. With at least as many configurations
+                     as threads each runs on its own thread, otherwise the
+                     objects of each step are split between them.
+                 timestep (float): Fixed step each configuration's dt is paced
+                     with, like set_timestep() for run_batch()
+
+             Runs with default parameters. Long-range forces read 0 and
+             polygons do not collide.
              )pbdoc")
 
-        .def("get_collision_config", &SimulationWrapper::get_collision_config,
-            py::arg("index"),
+        .def("sweep", [](SimulationWrapper& self, const BatchConfig& base, const py::dict& parameters,
+                         const std::vector<std::string>& fields)
+            {
+                std::vector<std::pair<std::string, std::vector<float>>> grid;
+                for (auto item : parameters) {
+                    auto values = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(item.second);
+                    std::string name = py::str(item.first);
+                    if (!values) throw std::runtime_error("sweep: values of " + name + " must be numeric");
+                    grid.emplace_back(name, std::vector<float>(values.data(), values.data() + values.size()));
+                }
+
+                SweepResult result;
+                {
+                    py::gil_scoped_release release;
+                    result = self.sweep(base, grid, fields);
+                }
+
+                py::array_t<float> values({ static_cast<py::ssize_t>(result.points),
+                                            static_cast<py::ssize_t>(result.objects),
+                                            static_cast<py::ssize_t>(result.fields.size()) });
+                std::copy(result.values.begin(), result.values.end(), values.mutable_data());
+                return values;
+            },
+            py::arg("base_config"), py::arg("parameters"), py::arg("fields") = std::vector<std::string>(),
             R"pbdoc(
-             Get collision configuration for an object.
+             Run one scene across a grid of parameter values in a single ensemble.
+             
+             base_config is replicated once per point of the grid the value
+             lists span; every copy runs as its own world (see run_batch
+             ensemble=True) and reads its own values wherever equations use
+             k, b, g, uCoupling, uDriveFreq or uDriveAmp.
              
              Args:
-                 index (int): Object ID
+                 base_config (BatchConfig): The scene; output_file is ignored
+                 parameters (dict[str, array]): Values per parameter: 'stiffness'
+                     ('k'), 'damping' ('b'), 'gravity' ('g'), 'coupling',
+                     'drive_freq', 'drive_amp'. Unlisted ones keep their
+                     current values.
+                 fields (list[str]): Fields to return, as for fetch_async
+                     (default: all of them)
                  
              Returns:
-                 CollisionConfig: Current collision settings
-                 
+                 numpy.ndarray: Final states, shape (points, objects, fields).
+                     Points are in meshgrid 'ij' order: the last parameter
+                     varies fastest.
+                     
              Example:
-                 >>> config = sim.get_collision_config(0)
-                 >>> print(f"Restitution: {config.restitution}")
+                 >>> out = sim.sweep(cfg, {"k": np.linspace(1, 10, 8), "b": [0.0, 0.1]})
+                 >>> out.shape                          # (16, len(cfg.objects), 12)
+                 >>> x = out[:, 0, 0].reshape(8, 2)     # Object 0's x per (k, b)
+                 
+             Note: Only works in headless mode.
              )pbdoc")
 
-        .def("enable_collision_between", &SimulationWrapper::enable_collision_between,
-            py::arg("obj1"), py::arg("obj2"), py::arg("enable"),
+        .def("fork", [](SimulationWrapper& self, int n, const py::dict& perturbations, int steps,
+                        const std::vector<std::string>& observables, bool restore)
+            {
+                std::vector<std::pair<std::string, std::vector<float>>> lists;
+                for (auto item : perturbations) {
+                    auto values = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(item.second);
+                    std::string name = py::str(item.first);
+                    if (!values) throw std::runtime_error("fork: values of " + name + " must be numeric");
+                    lists.emplace_back(name, std::vector<float>(values.data(), values.data() + values.size()));
+                }
+
+                std::vector<float> result;
+                {
+                    py::gil_scoped_release release;
+                    result = self.fork(n, lists, steps, observables, restore);
+                }
+
+                py::ssize_t worlds = result.empty() ? 0 : n;
+                py::array_t<float> values({ worlds, static_cast<py::ssize_t>(observables.size()) });
+                std::copy(result.begin(), result.end(), values.mutable_data());
+                return values;
+            },
+            py::arg("n"), py::arg("perturbations") = py::dict(), py::arg("steps") = 0,
+            py::arg("observables") = std::vector<std::string>(), py::arg("restore") = true,
             R"pbdoc(
-             Enable or disable collision detection between two specific objects.
+             Branch the current state into n worlds and roll them out together.
+             
+             The objects are saved and replicated into n ensemble worlds on the
+             GPU, with their equations, constraints, collision properties,
+             parameters and state registers, so every world starts from exactly
+             the current state. World w reads value w of each perturbation
+             (or its single value) wherever equations use k, b, g, uCoupling,
+             uDriveFreq or uDriveAmp. The worlds step together, then each
+             observable is reduced per world on the GPU; only those values are
+             read back. With restore=True the scene is put back as it was,
+             simulation time included.
              
              Args:
-                 obj1 (int): First object ID
-                 obj2 (int): Second object ID
-                 enable (bool): True to enable, False to disable
-                 
-             Useful for creating collision layers or groups.
+                 n (int): Worlds to fork into
+                 perturbations (dict): Parameter name -> one value per world, or one for all
+                 steps (int): Steps to roll out (default 0)
+                 observables (list[str]): "sum(expr)", "mean(expr)", "min(expr)" or "max(expr)"
+                 restore (bool): Put the scene back afterwards (default True); otherwise
+                     the worlds keep running until end_fork()
+             
+             Returns:
+                 ndarray: (n, len(observables)) float32 values
+             
+             Raises:
+                 RuntimeError: If the scene is already forked or an ensemble, has springs
+                     or spawned objects, or a perturbation or observable is invalid
              
              Example:
-                 >>> sim.enable_collision_between(0, 1, False)
-                 >>> # Objects 0 and 1 will pass through each other
+                 >>> gains = np.linspace(0.0, 2.0, 64)
+                 >>> cost = sim.fork(64, {"drive_amp": gains}, steps=200,
+                 ...                 observables=["mean(abs(x - 1.0))"])
+                 >>> best = gains[np.argmin(cost[:, 0])]
              )pbdoc")
 
-        .def("is_collision_enabled", &SimulationWrapper::is_collision_enabled,
-            py::arg("index"),
+        .def("end_fork", &SimulationWrapper::end_fork,
+            py::call_guard<py::gil_scoped_release>(),
             R"pbdoc(
-             Check if collision detection is enabled for an object.
-             
-             Args:
-                 index (int): Object ID
-                 
-             Returns:
-                 bool: True if collisions are enabled
+             Drop the forked worlds and put the scene back as fork() found it.
+             Does nothing when the scene is not forked.
              )pbdoc")
 
-            // For set_collision_parameters (void return)
-            .def("set_collision_parameters", &SimulationWrapper::set_collision_parameters,
-                py::arg("enable_warm_start"), py::arg("max_contact_iterations"),
-                R"pbdoc(
-     Set global collision parameters.
-     
-     Args:
-         enable_warm_start (bool): Enable warm starting for contacts
-         max_contact_iterations (int): Maximum iterations for contact resolution (1-20)
-     )pbdoc")
-
-            // For get_collision_parameters
-            .def("get_collision_parameters", &SimulationWrapper::get_collision_parameters,
-                R"pbdoc(
-     Get global collision parameters.
-     
-     Returns:
-         tuple: (enable_warm_start, max_contact_iterations)
-     )pbdoc")
-
-        // Batch processing
-        .def("run_batch", [](SimulationWrapper& self, const std::vector<BatchConfig>& configs, py::object callback)
-            {
-                py::gil_scoped_release release;
+        .def("is_forked", &SimulationWrapper::is_forked,
+            R"pbdoc(
+             Check whether fork(restore=False) worlds are running.
+             )pbdoc")
 
-                if (callback.is_none()) {
-                    self.run_batch(configs, nullptr);
-                }
-                else {
-                    self.run_batch(configs,
-                        [callback](int batch_idx, const std::vector<ObjectState>& results) {
-                            py::gil_scoped_acquire acquire;
-                            callback(batch_idx, results);
-                        });
-                }
-            },
-            py::arg("configs"), py::arg("callback") = py::none(),
+        .def("set_world_tiles", &SimulationWrapper::set_world_tiles,
+            py::arg("worlds") = std::vector<int>(), py::arg("columns") = 0,
             R"pbdoc(
-             Run multiple simulations in batch mode.
+             Render ensemble worlds side by side instead of on top of each other.
+             
+             Each shown world gets a cell of a grid over the view, left to right
+             and top to bottom, and shows the camera's view of its own objects.
+             All cells are drawn by the one instanced object draw; trails, the
+             force field and the grid are left out while tiles are shown. The
+             layout applies whenever an ensemble exists.
              
              Args:
-                 configs (list[BatchConfig]): List of simulation configurations
-                 callback (callable): Optional callback for progress/results
-                     Called as: callback(batch_index, results)
-                     
-             Note: Only works in headless mode.
+                 worlds (list[int]): Worlds to show, in cell order (default: all)
+                 columns (int): Grid columns (default 0: as square as fits)
              )pbdoc")
 
+        .def("clear_world_tiles", &SimulationWrapper::clear_world_tiles,
+            "Back to drawing every world into one view")
+
         // Parameters
-        .def("set_parameter", &SimulationWrapper::set_parameter,
+        .def("set_parameter", py::overload_cast<const std::string&, float>(&SimulationWrapper::set_parameter),
             py::arg("name"), py::arg("value"),
             R"pbdoc(
              Set global simulation parameter.
@@ -695,14 +4461,65 @@ PYBIND11_MODULE(stellar, m)
                  value (float): Parameter value
                  
              Available parameters:
-             - "gravity": Global gravity strength
-             - "damping": Velocity damping (0-1)
-             - "stiffness": Default constraint stiffness
+             - "gravity": Global gravity strength (g)
+             - "damping": Velocity damping (b)
+             - "stiffness": Spring constant (k)
+             - "restitution": Bounciness of the boundary walls
+             - "coupling", "drive_freq", "drive_amp": Coupling and driving
+               force terms equations can read
+             - "timestep": Fixed step update() advances by, in seconds (default 0.001)
+             - "integrator": 0 = symplectic Euler (default), 1 = velocity Verlet,
+               2 = Yoshida 4th order, 3 = RK4
+             - "backend_crossover": Object count from which the "auto" backend
+               steps on the GPU; -1 (default) measures it on the first update()
+             - "frame_pipeline_depth": Fenced copies render() draws from, up to 4;
+               with 2 or more a frame shows the last finished step while the
+               next one is computed. 0 (default) draws the live state
+             - "instanced_rendering": 1 (default) draws objects as instanced quads,
+               0 expands points in the geometry shader
+             - "view_culling": 1 (default) leaves objects outside the view out of
+               the instanced draw, 0 draws all of them
+             - "sph_radius": SPH kernel support h and neighbour grid cell (default 0.1)
+             - "sph_rest_density": Rest density rho0 (default 1000)
+             - "sph_stiffness": B of the Tait equation p = B*((rho/rho0)^gamma - 1),
+               clamped at 0 (default 100)
+             - "sph_gamma": Tait exponent, 1 = linear (default 7)
+             - "sph_viscosity": Dynamic viscosity mu (default 0.1)
+             )pbdoc")
+
+        .def("set_parameter", py::overload_cast<const std::string&, const std::string&>(&SimulationWrapper::set_parameter),
+            py::arg("name"), py::arg("value"),
+            R"pbdoc(
+             Set a parameter that takes a name.
+             
+             Args:
+                 name (str): "integrator" or "backend"
+                 value (str): "symplectic_euler", "velocity_verlet", "yoshida4" or "rk4";
+                     "auto" (default), "gpu", "cpu" or "vulkan" for "backend"
+                 
+             Higher-order integrators evaluate the equations 2 (Verlet) or 4
+             (Yoshida, RK4) times per step, so they pay off with a larger
+             "timestep". When equations read other objects (p[i], sum_j,
+             grav_ax, ...) each stage runs as its own pass.
+
+             "backend" picks where update() steps. "auto" steps scenes smaller
+             than "backend_crossover" on the CPU, where they skip the dispatch
+             and sync overhead, and reloads the CPU copy whenever the scene is
+             edited. Scenes using long-range forces, polygon collisions,
+             sleeping, XPBD constraints, worlds, emitters, recording or
+             adaptive steps always run on the GPU, "cpu" included.
+
+             "vulkan" steps on a Vulkan compute queue apart from rendering, all
+             steps of an update() in one submission; it needs a module built
+             with STELLAR_VULKAN (RuntimeError otherwise). On top of what
+             "cpu" leaves to the GPU, scenes with collisions, constraints,
+             derivatives, sum_j and friends, tables or fields, and multi-stage
+             integrators with equations that read p[i] keep stepping there.
              )pbdoc")
 
         .def("get_parameter", &SimulationWrapper::get_parameter,
             py::arg("name"),
-            "Get global parameter value by name")
+            "Get global parameter value by name; \"backend\" is 1 if the last update() stepped on the CPU, 2 on Vulkan")
 
         // Simulation control
         .def("set_paused", &SimulationWrapper::set_paused,
@@ -719,6 +4536,26 @@ PYBIND11_MODULE(stellar, m)
             },
             "Update shader loading status")
 
+        .def("wait_until_ready", [](SimulationWrapper& self, float timeout)
+            {
+                py::gil_scoped_release release;
+                return self.wait_until_ready(timeout);
+            },
+            py::arg("timeout") = -1.0f,
+            R"pbdoc(
+             Block until every shader program is ready.
+
+             Args:
+                 timeout (float): Seconds to wait at most; negative (default) waits
+                     as long as it takes
+
+             Returns:
+                 bool: True when ready, False if the timeout ran out first
+
+             Objects can be added before calling this; with a driver that
+             compiles in parallel, that setup overlaps with compilation.
+             )pbdoc")
+
         .def("are_all_shaders_ready", [](const SimulationWrapper& self)
             {
                 py::gil_scoped_release release;
@@ -741,7 +4578,8 @@ PYBIND11_MODULE(stellar, m)
             "Get current shader loading status message")
 
         .def("reset", &SimulationWrapper::reset,
-            "Reset simulation to initial state (keeps objects)")
+            "Reset simulation to initial state (keeps objects): the state the first step after the last\n"
+            "add or remove started from, with the equations assigned now. Restored with one GPU copy.")
 
         .def("cleanup", &SimulationWrapper::cleanup,
             "Explicitly cleanup resources")
@@ -752,25 +4590,187 @@ PYBIND11_MODULE(stellar, m)
             py::arg("title") = "",
             py::arg("author") = "",
             py::arg("description") = "",
+            py::arg("binary") = false,
+            py::call_guard<py::gil_scoped_release>(),
             R"pbdoc(
-             Save simulation state to .stellar file.
+             Save simulation state to .stellar file (releases the GIL).
              
              Args:
                  filename (str): Output file path
                  title (str): Simulation title
                  author (str): Author name
                  description (str): Simulation description
+                 binary (bool): Write a binary snapshot instead of text: raw
+                     object, collision, constraint and parameter arrays plus
+                     the equations, each section 64-byte aligned so it can
+                     be memory-mapped. Much faster for large scenes, and
+                     unlike text it restores equations, constraints and
+                     collision properties.
              )pbdoc")
 
         .def("load_from_file", &SimulationWrapper::load_from_file,
             py::arg("filename"),
+            py::call_guard<py::gil_scoped_release>(),
             R"pbdoc(
-             Load simulation state from .stellar file.
+             Load simulation state from .stellar file (releases the GIL).
+             
+             Text files and binary snapshots are both recognised.
              
              Args:
                  filename (str): Input file path
              )pbdoc")
 
+        .def("checkpoint", &SimulationWrapper::checkpoint,
+            py::arg("path"),
+            py::arg("full") = false,
+            py::call_guard<py::gil_scoped_release>(),
+            R"pbdoc(
+             Write an incremental checkpoint (releases the GIL).
+             
+             The first checkpoint to a path writes a full binary snapshot there;
+             each later one appends only the objects, collision properties,
+             object parameters, constraints and equations that changed since the
+             previous checkpoint to path + ".delta". Changed objects are found on
+             the GPU, so only they and a one-bit-per-object map are read back.
+             The file is written in the background; the next checkpoint waits
+             for it.
+             
+             Args:
+                 path (str): Base snapshot path
+                 full (bool): Start a new base even if one exists
+             
+             Returns:
+                 int: Delta sequence number, 0 for a new base
+             )pbdoc")
+
+        .def("restore_checkpoint", &SimulationWrapper::restore_checkpoint,
+            py::arg("path"),
+            py::call_guard<py::gil_scoped_release>(),
+            R"pbdoc(
+             Load a checkpoint: the base snapshot, then every delta in order
+             (releases the GIL). A delta cut short by a crash is ignored.
+             
+             Args:
+                 path (str): Base snapshot path passed to checkpoint()
+             
+             Returns:
+                 int: Number of deltas applied
+             )pbdoc")
+
+        .def("cache_scene", &SimulationWrapper::cache_scene,
+            py::arg("name"),
+            R"pbdoc(
+             Keep the current scene resident in VRAM under a name.
+             
+             The objects are copied into a GPU buffer of their own, and the
+             equations, constraints, collision properties, parameters and
+             simulation settings are kept with them, so activate_scene() can
+             bring the scene back without reloading or re-uploading it.
+             Caching a name again replaces its scene.
+             
+             Args:
+                 name (str): Name to activate the scene by
+             
+             Example:
+                 >>> sim.load_from_file("cloth.scene"); sim.cache_scene("cloth")
+                 >>> sim.load_from_file("galaxy.scene"); sim.cache_scene("galaxy")
+                 >>> sim.activate_scene("cloth")
+             )pbdoc")
+
+        .def("activate_scene", &SimulationWrapper::activate_scene,
+            py::arg("name"),
+            R"pbdoc(
+             Replace the current scene with a cached one.
+             
+             The objects are copied from the cache into the object buffers on
+             the GPU; only the small host tables (equations, constraints,
+             collision properties) are set again. The cached copy stays as it
+             was cached, so activating it again starts over.
+             
+             Args:
+                 name (str): Name given to cache_scene()
+             
+             Raises:
+                 RuntimeError: If no scene is cached under name
+             )pbdoc")
+
+        .def("remove_cached_scene", &SimulationWrapper::remove_cached_scene,
+            py::arg("name"),
+            R"pbdoc(
+             Free a cached scene's VRAM. Unknown names are ignored.
+             )pbdoc")
+
+        .def("get_cached_scenes", &SimulationWrapper::get_cached_scenes,
+            R"pbdoc(
+             Get the names of the cached scenes.
+             
+             Returns:
+                 list[str]: Names in sorted order
+             )pbdoc")
+
+        .def("get_scene_cache_bytes", &SimulationWrapper::get_scene_cache_bytes,
+            R"pbdoc(
+             Get the VRAM the cached scenes' objects hold.
+             
+             Returns:
+                 int: Bytes
+             )pbdoc")
+
+        .def("enable_history", &SimulationWrapper::enable_history,
+            py::arg("n_snapshots"), py::arg("every_k_steps") = 1,
+            R"pbdoc(
+             Keep a GPU ring of recent states to rewind to.
+             
+             Every every_k_steps steps the objects are copied into the next slot
+             of a ring in VRAM with glCopyBufferSubData, overwriting the oldest
+             once n_snapshots are held; one snapshot is also taken right away.
+             Nothing is read back, so the cost is one buffer copy per snapshot.
+             Fused substeps stop at every snapshot step. Host-side tables
+             (constraints, equations, collision properties) are not part of
+             the history.
+             
+             Args:
+                 n_snapshots (int): Ring size, 0 = off
+                 every_k_steps (int): Steps between snapshots (default 1)
+             
+             Example:
+                 >>> sim.enable_history(300, every_k_steps=2)   # the last 600 steps
+             )pbdoc")
+
+        .def("disable_history", &SimulationWrapper::disable_history,
+            R"pbdoc(
+             Turn the history off and free its ring.
+             )pbdoc")
+
+        .def("rewind", &SimulationWrapper::rewind,
+            py::arg("k") = 1,
+            R"pbdoc(
+             Restore a snapshot of the history.
+             
+             The snapshot is copied back into the object buffers in VRAM and
+             the simulation time goes back to when it was taken. Snapshots
+             newer than it are dropped; it stays the newest, so rewind(1)
+             again returns to the same state.
+             
+             Args:
+                 k (int): Snapshot to restore, 1 = the newest (default 1)
+             
+             Returns:
+                 float: Simulation time of the restored state
+             
+             Raises:
+                 RuntimeError: If fewer than k snapshots are held, or objects
+                     were added or removed since the snapshot
+             )pbdoc")
+
+        .def("get_history_times", &SimulationWrapper::get_history_times,
+            R"pbdoc(
+             Get the simulation times of the held snapshots.
+             
+             Returns:
+                 list[float]: Oldest first; rewind(1) restores the last one
+             )pbdoc")
+
         // Properties
         .def_property_readonly("is_headless", &SimulationWrapper::is_headless,
             "Check if simulation is running in headless mode")
@@ -0,0 +1,134 @@
+#include "command_queue.h"
+#include <chrono>
+#include <stdexcept>
+
+// ============================================================================
+// Futures
+// ============================================================================
+bool CommandFuture::ready() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_ready;
+}
+
+bool CommandFuture::wait(float timeout)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (timeout < 0.0f)
+    {
+        m_done.wait(lock, [this] { return m_ready; });
+        return true;
+    }
+    return m_done.wait_for(lock, std::chrono::duration<float>(timeout), [this] { return m_ready; });
+}
+
+CommandResult CommandFuture::result()
+{
+    wait(-1.0f);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_error) std::rethrow_exception(m_error);
+    return m_value;
+}
+
+void CommandFuture::Complete(CommandResult value, std::exception_ptr error)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_value = std::move(value);
+        m_error = error;
+        m_ready = true;
+    }
+    m_done.notify_all();
+}
+
+// ============================================================================
+// Queue
+// ============================================================================
+CommandQueue::~CommandQueue()
+{
+    Close("The simulation is gone");
+}
+
+std::shared_ptr<CommandFuture> CommandQueue::Submit(Operation operation)
+{
+    auto future = std::make_shared<CommandFuture>();
+    if (m_closed.load(std::memory_order_acquire))
+    {
+        future->Complete({}, std::make_exception_ptr(std::runtime_error(m_closeReason)));
+        return future;
+    }
+
+    Node* node = new Node;
+    node->operation = std::move(operation);
+    node->future = future;
+    m_pending.fetch_add(1);
+    node->next = m_head.load(std::memory_order_relaxed);
+    while (!m_head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {}
+
+    // Closed between the check and the push: nobody drains any more, so fail it here
+    if (m_closed.load(std::memory_order_acquire)) Fail(TakeAll());
+    return future;
+}
+
+// The consumer takes the whole stack at once, so there is no pop to race and no ABA
+CommandQueue::Node* CommandQueue::TakeAll()
+{
+    Node* stack = m_head.exchange(nullptr, std::memory_order_acquire);
+    Node* ordered = nullptr;
+    while (stack)
+    {
+        Node* next = stack->next;
+        stack->next = ordered;
+        ordered = stack;
+        stack = next;
+    }
+    return ordered;
+}
+
+int CommandQueue::Drain(SimulationWrapper& simulation)
+{
+    int ran = 0;
+    for (Node* node = TakeAll(); node;)
+    {
+        CommandResult value;
+        std::exception_ptr error;
+        try
+        {
+            value = node->operation(simulation);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        m_pending.fetch_sub(1);
+        node->future->Complete(std::move(value), error);
+
+        Node* next = node->next;
+        delete node;
+        node = next;
+        ran++;
+    }
+    return ran;
+}
+
+void CommandQueue::Fail(Node* list)
+{
+    while (list)
+    {
+        m_pending.fetch_sub(1);
+        list->future->Complete({}, std::make_exception_ptr(std::runtime_error(m_closeReason)));
+        Node* next = list->next;
+        delete list;
+        list = next;
+    }
+}
+
+void CommandQueue::Close(const std::string& reason)
+{
+    if (!m_closed.load())
+    {
+        m_closeReason = reason;
+        m_closed.store(true, std::memory_order_release);
+    }
+    Fail(TakeAll());
+}
@@ -0,0 +1,79 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include "simulation_wrapper.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <variant>
+#include <vector>
+
+// What a queued command produced: nothing for mutations, else the query's value
+typedef std::variant<std::monostate, int, ObjectState, std::vector<BatchGetData>> CommandResult;
+
+// Completion of one queued command, shared by the submitting thread and the GL thread
+class CommandFuture
+{
+public:
+    bool ready() const;
+    bool wait(float timeout);  // Seconds, < 0 = until done; false if it timed out
+    CommandResult result();    // Waits until done; rethrows what the command threw
+
+    void Complete(CommandResult value, std::exception_ptr error);  // GL thread, once
+
+private:
+    mutable std::mutex m_mutex;
+    std::condition_variable m_done;
+    bool m_ready = false;
+    CommandResult m_value;
+    std::exception_ptr m_error;
+};
+
+// Mutations and queries any thread may submit without touching GL: Submit() pushes onto a
+// lock-free intrusive stack with one compare-and-swap, and the thread owning the context takes
+// the whole stack with one exchange at the start of update() / step() and runs the commands
+// in submission order. A submitter never waits on the simulation; it waits on its future, if
+// it wants the result. Commands submitted while a drain runs wait for the next one.
+class CommandQueue
+{
+public:
+    typedef std::function<CommandResult(SimulationWrapper&)> Operation;
+
+    CommandQueue() = default;
+    ~CommandQueue();
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    // Any thread; after Close() the future fails right away
+    std::shared_ptr<CommandFuture> Submit(Operation operation);
+
+    // GL thread: run every command submitted so far, oldest first; returns how many ran
+    int Drain(SimulationWrapper& simulation);
+
+    // Fail every pending command and every later submission with reason
+    void Close(const std::string& reason);
+    bool IsClosed() const { return m_closed.load(); }
+    int GetPending() const { return m_pending.load(); }  // Submitted and not yet run
+
+private:
+    struct Node
+    {
+        Operation operation;
+        std::shared_ptr<CommandFuture> future;
+        Node* next = nullptr;
+    };
+
+    Node* TakeAll();  // The stack in submission order
+    void Fail(Node* list);
+
+    std::atomic<Node*> m_head{ nullptr };
+    std::atomic<int> m_pending{ 0 };
+    std::atomic<bool> m_closed{ false };
+    std::string m_closeReason;  // Written once, before m_closed is set
+};
+
+#endif // COMMAND_QUEUE_H
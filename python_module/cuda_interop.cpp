@@ -0,0 +1,171 @@
+#include "cuda_interop.h"
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <windows.h>
+static void* OpenLibrary(const char* name) { return reinterpret_cast<void*>(LoadLibraryA(name)); }
+static void* Symbol(void* library, const char* name)
+{
+    return reinterpret_cast<void*>(GetProcAddress(reinterpret_cast<HMODULE>(library), name));
+}
+static const char* const RUNTIME_NAMES[] = { "cudart64_12.dll", "cudart64_110.dll", "cudart64_101.dll" };
+#else
+#include <dlfcn.h>
+static void* OpenLibrary(const char* name) { return dlopen(name, RTLD_NOW | RTLD_LOCAL); }
+static void* Symbol(void* library, const char* name) { return dlsym(library, name); }
+static const char* const RUNTIME_NAMES[] = { "libcudart.so", "libcudart.so.12", "libcudart.so.11.0" };
+#endif
+
+// The few CUDA runtime types used here, so no CUDA headers are needed to build
+typedef int cudaError_t;
+typedef struct cudaGraphicsResource* cudaGraphicsResource_t;
+typedef void* cudaStream_t;
+static const unsigned int cudaGraphicsRegisterFlagsNone = 0;  // Read and write
+
+typedef cudaError_t (*PFN_cudaGraphicsGLRegisterBuffer)(cudaGraphicsResource_t*, unsigned int, unsigned int);
+typedef cudaError_t (*PFN_cudaGraphicsUnregisterResource)(cudaGraphicsResource_t);
+typedef cudaError_t (*PFN_cudaGraphicsMapResources)(int, cudaGraphicsResource_t*, cudaStream_t);
+typedef cudaError_t (*PFN_cudaGraphicsUnmapResources)(int, cudaGraphicsResource_t*, cudaStream_t);
+typedef cudaError_t (*PFN_cudaGraphicsResourceGetMappedPointer)(void**, size_t*, cudaGraphicsResource_t);
+typedef cudaError_t (*PFN_cudaGetDevice)(int*);
+typedef const char* (*PFN_cudaGetErrorString)(cudaError_t);
+
+// Entry points, resolved once per process
+static struct
+{
+    void* library = nullptr;
+    bool failed = false;
+    std::string error;
+    PFN_cudaGraphicsGLRegisterBuffer registerBuffer = nullptr;
+    PFN_cudaGraphicsUnregisterResource unregisterResource = nullptr;
+    PFN_cudaGraphicsMapResources mapResources = nullptr;
+    PFN_cudaGraphicsUnmapResources unmapResources = nullptr;
+    PFN_cudaGraphicsResourceGetMappedPointer getMappedPointer = nullptr;
+    PFN_cudaGetDevice getDevice = nullptr;
+    PFN_cudaGetErrorString getErrorString = nullptr;
+} s_cuda;
+
+// The registered buffer; GL reallocating a buffer invalidates its registration
+static cudaGraphicsResource_t s_resource = nullptr;
+static unsigned int s_buffer = 0;
+static size_t s_bytes = 0;
+static bool s_mapped = false;
+
+template <typename T>
+static bool Resolve(T& fn, const char* name)
+{
+    fn = reinterpret_cast<T>(Symbol(s_cuda.library, name));
+    return fn != nullptr;
+}
+
+static std::string Describe(const char* call, cudaError_t status)
+{
+    return std::string(call) + " failed: " + (s_cuda.getErrorString ? s_cuda.getErrorString(status) : std::to_string(status));
+}
+
+bool CudaInterop::Available(std::string& error)
+{
+    if (s_cuda.library) return true;
+    if (s_cuda.failed)
+    {
+        error = s_cuda.error;
+        return false;
+    }
+
+    const char* named = std::getenv("STELLAR_CUDART");
+    if (named && *named) s_cuda.library = OpenLibrary(named);
+    for (const char* name : RUNTIME_NAMES)
+    {
+        if (s_cuda.library) break;
+        s_cuda.library = OpenLibrary(name);
+    }
+
+    bool ok = s_cuda.library &&
+              Resolve(s_cuda.registerBuffer, "cudaGraphicsGLRegisterBuffer") &&
+              Resolve(s_cuda.unregisterResource, "cudaGraphicsUnregisterResource") &&
+              Resolve(s_cuda.mapResources, "cudaGraphicsMapResources") &&
+              Resolve(s_cuda.unmapResources, "cudaGraphicsUnmapResources") &&
+              Resolve(s_cuda.getMappedPointer, "cudaGraphicsResourceGetMappedPointer") &&
+              Resolve(s_cuda.getDevice, "cudaGetDevice") &&
+              Resolve(s_cuda.getErrorString, "cudaGetErrorString");
+    if (!ok)
+    {
+        // Not retried: the library does not appear during a run
+        s_cuda.error = s_cuda.library ? "The CUDA runtime is missing GL interop entry points"
+                                      : "CUDA runtime (cudart) not found; STELLAR_CUDART can name it";
+        s_cuda.library = nullptr;
+        s_cuda.failed = true;
+        error = s_cuda.error;
+        return false;
+    }
+    return true;
+}
+
+void* CudaInterop::Map(unsigned int buffer, size_t bytes, int& device, std::string& error)
+{
+    if (!Available(error)) return nullptr;
+
+    if (s_mapped && (buffer != s_buffer || bytes != s_bytes)) Unmap();
+    if (s_resource && (buffer != s_buffer || bytes != s_bytes))
+    {
+        s_cuda.unregisterResource(s_resource);
+        s_resource = nullptr;
+    }
+    if (!s_resource)
+    {
+        cudaError_t status = s_cuda.registerBuffer(&s_resource, buffer, cudaGraphicsRegisterFlagsNone);
+        if (status != 0)
+        {
+            s_resource = nullptr;
+            error = Describe("cudaGraphicsGLRegisterBuffer", status) + " (is GL running on a CUDA device?)";
+            return nullptr;
+        }
+        s_buffer = buffer;
+        s_bytes = bytes;
+    }
+
+    if (!s_mapped)
+    {
+        // Mapping orders the GL work issued so far before any CUDA work that uses the pointer
+        cudaError_t status = s_cuda.mapResources(1, &s_resource, nullptr);
+        if (status != 0)
+        {
+            error = Describe("cudaGraphicsMapResources", status);
+            return nullptr;
+        }
+        s_mapped = true;
+    }
+
+    void* pointer = nullptr;
+    size_t mappedBytes = 0;
+    cudaError_t status = s_cuda.getMappedPointer(&pointer, &mappedBytes, s_resource);
+    if (status == 0) status = s_cuda.getDevice(&device);
+    if (status != 0)
+    {
+        error = Describe("cudaGraphicsResourceGetMappedPointer", status);
+        Unmap();
+        return nullptr;
+    }
+    return pointer;
+}
+
+void CudaInterop::Unmap()
+{
+    if (!s_mapped) return;
+    s_cuda.unmapResources(1, &s_resource, nullptr);  // Orders the CUDA work before later GL use
+    s_mapped = false;
+}
+
+bool CudaInterop::IsMapped()
+{
+    return s_mapped;
+}
+
+void CudaInterop::Cleanup()
+{
+    Unmap();
+    if (s_resource) s_cuda.unregisterResource(s_resource);
+    s_resource = nullptr;
+    s_buffer = 0;
+    s_bytes = 0;
+}
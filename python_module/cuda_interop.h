@@ -0,0 +1,25 @@
+#ifndef CUDA_INTEROP_H
+#define CUDA_INTEROP_H
+
+#include <cstddef>
+#include <string>
+
+// CUDA-GL interop for zero-copy tensor export. The CUDA runtime is loaded at run time
+// (STELLAR_CUDART names the library, else the usual cudart names are tried), so the module
+// builds and imports without CUDA. A GL buffer is registered once and mapped on demand; while
+// mapped it belongs to CUDA and GL must not touch it, so every mapping ends with Unmap()
+// before the next GL use. All calls on the simulation's GL thread, with its context current.
+namespace CudaInterop
+{
+    bool Available(std::string& error);  // Loads the runtime on first use
+
+    // Device pointer to bytes of buffer, registering it if new or resized since the last map.
+    // Returns nullptr with the reason in error. device is the CUDA ordinal the pointer lives on.
+    void* Map(unsigned int buffer, size_t bytes, int& device, std::string& error);
+    void Unmap();
+    bool IsMapped();
+
+    void Cleanup();  // Unmaps and unregisters; on context teardown
+}
+
+#endif // CUDA_INTEROP_H
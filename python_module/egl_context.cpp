@@ -0,0 +1,214 @@
+#include "egl_context.h"
+
+#if defined(__linux__)
+
+#include <dlfcn.h>
+#include <cstdint>
+#include <vector>
+
+// The few EGL types and enums used here, so no EGL headers are needed to build
+typedef void* EGLDisplay;
+typedef void* EGLContext_;
+typedef void* EGLConfig;
+typedef void* EGLDeviceEXT;
+typedef unsigned int EGLBoolean;
+typedef int32_t EGLint;
+typedef unsigned int EGLenum;
+
+static const EGLint EGL_NONE_ = 0x3038;
+static const EGLint EGL_SURFACE_TYPE_ = 0x3033;
+static const EGLint EGL_PBUFFER_BIT_ = 0x0001;
+static const EGLint EGL_RENDERABLE_TYPE_ = 0x3040;
+static const EGLint EGL_OPENGL_BIT_ = 0x0008;
+static const EGLint EGL_CONTEXT_MAJOR_VERSION_ = 0x3098;
+static const EGLint EGL_CONTEXT_MINOR_VERSION_ = 0x30FB;
+static const EGLint EGL_CONTEXT_OPENGL_PROFILE_MASK_ = 0x30FD;
+static const EGLint EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_ = 0x0001;
+static const EGLenum EGL_OPENGL_API_ = 0x30A2;
+static const EGLenum EGL_PLATFORM_DEVICE_EXT_ = 0x313F;
+static const EGLenum EGL_PLATFORM_SURFACELESS_MESA_ = 0x31DD;
+
+typedef void* (*PFN_eglGetProcAddress)(const char*);
+typedef EGLDisplay (*PFN_eglGetDisplay)(void*);
+typedef EGLBoolean (*PFN_eglInitialize)(EGLDisplay, EGLint*, EGLint*);
+typedef EGLBoolean (*PFN_eglTerminate)(EGLDisplay);
+typedef EGLBoolean (*PFN_eglBindAPI)(EGLenum);
+typedef EGLBoolean (*PFN_eglChooseConfig)(EGLDisplay, const EGLint*, EGLConfig*, EGLint, EGLint*);
+typedef EGLContext_ (*PFN_eglCreateContext)(EGLDisplay, EGLConfig, EGLContext_, const EGLint*);
+typedef EGLBoolean (*PFN_eglDestroyContext)(EGLDisplay, EGLContext_);
+typedef EGLBoolean (*PFN_eglMakeCurrent)(EGLDisplay, void*, void*, EGLContext_);
+typedef EGLBoolean (*PFN_eglQueryDevicesEXT)(EGLint, EGLDeviceEXT*, EGLint*);
+typedef EGLDisplay (*PFN_eglGetPlatformDisplayEXT)(EGLenum, void*, const EGLint*);
+
+// Entry points, resolved once per process
+static struct
+{
+    void* library = nullptr;
+    void* gl = nullptr;  // libOpenGL, for GL functions eglGetProcAddress does not return
+    PFN_eglGetProcAddress getProcAddress = nullptr;
+    PFN_eglGetDisplay getDisplay = nullptr;
+    PFN_eglInitialize initialize = nullptr;
+    PFN_eglTerminate terminate = nullptr;
+    PFN_eglBindAPI bindAPI = nullptr;
+    PFN_eglChooseConfig chooseConfig = nullptr;
+    PFN_eglCreateContext createContext = nullptr;
+    PFN_eglDestroyContext destroyContext = nullptr;
+    PFN_eglMakeCurrent makeCurrent = nullptr;
+    PFN_eglQueryDevicesEXT queryDevices = nullptr;
+    PFN_eglGetPlatformDisplayEXT getPlatformDisplay = nullptr;
+} s_egl;
+
+template <typename T>
+static bool Resolve(T& fn, const char* name)
+{
+    fn = reinterpret_cast<T>(dlsym(s_egl.library, name));
+    return fn != nullptr;
+}
+
+static bool LoadEgl(std::string& error)
+{
+    if (s_egl.library) return true;
+
+    void* library = dlopen("libEGL.so.1", RTLD_NOW | RTLD_LOCAL);
+    if (!library) library = dlopen("libEGL.so", RTLD_NOW | RTLD_LOCAL);
+    if (!library)
+    {
+        error = "libEGL not found";
+        return false;
+    }
+    s_egl.library = library;
+
+    bool ok = Resolve(s_egl.getProcAddress, "eglGetProcAddress") && Resolve(s_egl.getDisplay, "eglGetDisplay") &&
+              Resolve(s_egl.initialize, "eglInitialize") && Resolve(s_egl.terminate, "eglTerminate") &&
+              Resolve(s_egl.bindAPI, "eglBindAPI") && Resolve(s_egl.chooseConfig, "eglChooseConfig") &&
+              Resolve(s_egl.createContext, "eglCreateContext") && Resolve(s_egl.destroyContext, "eglDestroyContext") &&
+              Resolve(s_egl.makeCurrent, "eglMakeCurrent");
+    if (!ok)
+    {
+        error = "libEGL is missing core entry points";
+        dlclose(library);
+        s_egl.library = nullptr;
+        return false;
+    }
+
+    // Extensions; either may be absent
+    s_egl.queryDevices = reinterpret_cast<PFN_eglQueryDevicesEXT>(s_egl.getProcAddress("eglQueryDevicesEXT"));
+    s_egl.getPlatformDisplay = reinterpret_cast<PFN_eglGetPlatformDisplayEXT>(s_egl.getProcAddress("eglGetPlatformDisplayEXT"));
+
+    s_egl.gl = dlopen("libOpenGL.so.0", RTLD_NOW | RTLD_LOCAL);
+    if (!s_egl.gl) s_egl.gl = dlopen("libGL.so.1", RTLD_NOW | RTLD_LOCAL);
+    return true;
+}
+
+// A 4.3 core context on display, made current without a surface
+static EGLContext_ CreateCoreContext(EGLDisplay display)
+{
+    if (!display || !s_egl.initialize(display, nullptr, nullptr)) return nullptr;
+    if (!s_egl.bindAPI(EGL_OPENGL_API_))
+    {
+        s_egl.terminate(display);
+        return nullptr;
+    }
+
+    // A config is optional with EGL_KHR_no_config_context, which surfaceless drivers offer
+    const EGLint configAttribs[] = { EGL_SURFACE_TYPE_, EGL_PBUFFER_BIT_, EGL_RENDERABLE_TYPE_, EGL_OPENGL_BIT_, EGL_NONE_ };
+    EGLConfig config = nullptr;
+    EGLint configs = 0;
+    if (!s_egl.chooseConfig(display, configAttribs, &config, 1, &configs) || configs < 1) config = nullptr;
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION_, 4,
+        EGL_CONTEXT_MINOR_VERSION_, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_,
+        EGL_NONE_
+    };
+    EGLContext_ context = s_egl.createContext(display, config, nullptr, contextAttribs);
+    if (context && s_egl.makeCurrent(display, nullptr, nullptr, context)) return context;
+
+    if (context) s_egl.destroyContext(display, context);
+    s_egl.terminate(display);
+    return nullptr;
+}
+
+std::unique_ptr<EglContext> EglContext::Create(int device, std::string& error)
+{
+    if (!LoadEgl(error)) return nullptr;
+
+    std::unique_ptr<EglContext> result(new EglContext());
+    auto attempt = [&](EGLDisplay display, const std::string& description)
+    {
+        if (result->m_context) return;
+        EGLContext_ context = CreateCoreContext(display);
+        if (!context) return;
+        result->m_display = display;
+        result->m_context = context;
+        result->m_description = description;
+    };
+
+    // A GPU by index, without any window system
+    if (s_egl.queryDevices && s_egl.getPlatformDisplay)
+    {
+        EGLint count = 0;
+        if (s_egl.queryDevices(0, nullptr, &count) && count > 0)
+        {
+            std::vector<EGLDeviceEXT> devices(count);
+            s_egl.queryDevices(count, devices.data(), &count);
+            if (device >= 0 && device < count)
+                attempt(s_egl.getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT_, devices[device], nullptr),
+                        "EGL device " + std::to_string(device) + " of " + std::to_string(count));
+        }
+    }
+    if (s_egl.getPlatformDisplay)
+        attempt(s_egl.getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA_, nullptr, nullptr), "EGL surfaceless");
+    attempt(s_egl.getDisplay(nullptr), "EGL default display");
+
+    if (!result->m_context)
+    {
+        error = "no EGL display provides an OpenGL 4.3 core context";
+        return nullptr;
+    }
+    return result;
+}
+
+void* EglContext::GetProcAddress(const char* name)
+{
+    void* fn = s_egl.gl ? dlsym(s_egl.gl, name) : nullptr;
+    if (!fn && s_egl.getProcAddress) fn = s_egl.getProcAddress(name);
+    return fn;
+}
+
+EglContext::~EglContext()
+{
+    if (!m_display) return;
+    s_egl.makeCurrent(m_display, nullptr, nullptr, nullptr);
+    if (m_context) s_egl.destroyContext(m_display, m_context);
+    s_egl.terminate(m_display);
+}
+
+bool EglContext::MakeCurrent()
+{
+    return m_display && s_egl.makeCurrent(m_display, nullptr, nullptr, m_context);
+}
+
+#else
+
+// Windows and macOS headless runs use a hidden GLFW window
+std::unique_ptr<EglContext> EglContext::Create(int, std::string& error)
+{
+    error = "EGL headless contexts are only supported on Linux";
+    return nullptr;
+}
+
+void* EglContext::GetProcAddress(const char*)
+{
+    return nullptr;
+}
+
+EglContext::~EglContext() = default;
+
+bool EglContext::MakeCurrent()
+{
+    return false;
+}
+
+#endif
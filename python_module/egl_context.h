@@ -0,0 +1,34 @@
+#ifndef EGL_CONTEXT_H
+#define EGL_CONTEXT_H
+
+#include <memory>
+#include <string>
+
+// OpenGL 4.3 core context without a window system, for headless runs on display-less Linux
+// nodes. libEGL is loaded at run time, so the module still imports where it is missing.
+// Displays are tried in order: the GPU device (EGL_EXT_platform_device, chosen by
+// STELLAR_EGL_DEVICE, default 0), Mesa's surfaceless platform, then the default display.
+// The context renders to no surface (EGL_KHR_surfaceless_context); compute needs none.
+class EglContext
+{
+public:
+    // nullptr with the reason in error if no display gives a 4.3 core context
+    static std::unique_ptr<EglContext> Create(int device, std::string& error);
+    static void* GetProcAddress(const char* name);  // GL entry points, for glad
+
+    ~EglContext();
+    EglContext(const EglContext&) = delete;
+    EglContext& operator=(const EglContext&) = delete;
+
+    bool MakeCurrent();
+    const std::string& Description() const { return m_description; }  // Which display was used
+
+private:
+    EglContext() = default;
+
+    void* m_display = nullptr;
+    void* m_context = nullptr;
+    std::string m_description;
+};
+
+#endif // EGL_CONTEXT_H
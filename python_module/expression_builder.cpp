@@ -0,0 +1,152 @@
+#include "expression_builder.h"
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+
+// Names are checked against the parser's own tables, and are interned as it is built: look
+// them up only after calling this
+static const ParserContext& BuilderContext()
+{
+    static const ParserContext context;
+    return context;
+}
+
+// ============================================================================
+// Leaves
+// ============================================================================
+BuiltExpression::BuiltExpression(double value)
+{
+    float constant = static_cast<float>(value);
+    if (!std::isfinite(constant)) throw std::invalid_argument("Equation constants have to be finite floats");
+    rpn.push_back(Token(TOKEN_NUMBER, constant));
+
+    // Fixed notation: the tokenizer would split an exponent at its sign
+    char buffer[64];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), std::fabs(constant), std::chars_format::fixed);
+    std::string digits(buffer, result.ptr);
+    text = constant < 0.0f ? "(-" + digits + ")" : digits;
+}
+
+BuiltExpression BuiltExpression::Variable(const std::string& name)
+{
+    const ParserContext& context = BuilderContext();
+    SymbolId symbol = findSymbol(name);
+    if (!context.isValidVariable(symbol)) throw std::invalid_argument("Unknown equation variable '" + name + "'");
+    BuiltExpression e;
+    e.rpn.push_back(Token(TOKEN_VARIABLE, symbol));
+    e.text = name;
+    return e;
+}
+
+BuiltExpression BuiltExpression::ObjectProperty(int objectIndex, const std::string& property)
+{
+    if (objectIndex < 0) throw std::invalid_argument("Object references need an index >= 0");
+    const ParserContext& context = BuilderContext();
+    SymbolId type = internSymbol("p");
+    SymbolId symbol = findSymbol(property);
+    if (!context.isValidObjectProperty(type, symbol))
+        throw std::invalid_argument("Unknown object property '" + property + "'");
+
+    Token token(TOKEN_OBJECT_REF);
+    token.object_type = type;
+    token.object_index = objectIndex;
+    token.object_property = symbol;
+    BuiltExpression e;
+    e.rpn.push_back(std::move(token));
+    e.text = "p[" + std::to_string(objectIndex) + "]." + property;
+    return e;
+}
+
+// ============================================================================
+// Operators and calls: operands in order, then the operator, as infixToRPN emits them
+// ============================================================================
+BuiltExpression BuiltExpression::Binary(TokenType op, const BuiltExpression& a, const BuiltExpression& b)
+{
+    const char* symbol = op == TOKEN_ADD ? " + " : op == TOKEN_SUB ? " - " : op == TOKEN_MUL ? " * " :
+                         op == TOKEN_DIV ? " / " : op == TOKEN_POW ? "^" : nullptr;
+    if (!symbol) throw std::invalid_argument("Not a binary operator");
+
+    BuiltExpression e;
+    e.rpn.reserve(a.rpn.size() + b.rpn.size() + 1);
+    e.rpn = a.rpn;
+    e.rpn.insert(e.rpn.end(), b.rpn.begin(), b.rpn.end());
+    e.rpn.push_back(Token(op));
+    e.text = "(" + a.text + symbol + b.text + ")";
+    return e;
+}
+
+BuiltExpression BuiltExpression::Negate(const BuiltExpression& a)
+{
+    BuiltExpression e;
+    e.rpn = a.rpn;
+    e.rpn.push_back(Token(TOKEN_NEG));
+    e.text = "(-" + a.text + ")";
+    return e;
+}
+
+BuiltExpression BuiltExpression::Call(const std::string& name, const std::vector<BuiltExpression>& arguments)
+{
+    struct Function { const char* name; TokenType type; size_t arity; };
+    static const Function functions[] = {
+        { "sin", TOKEN_SIN, 1 }, { "cos", TOKEN_COS, 1 }, { "tan", TOKEN_TAN, 1 }, { "sqrt", TOKEN_SQRT, 1 },
+        { "log", TOKEN_LOG, 1 }, { "exp", TOKEN_EXP, 1 }, { "abs", TOKEN_ABS, 1 }, { "floor", TOKEN_FLOOR, 1 },
+        { "ceil", TOKEN_CEIL, 1 }, { "frac", TOKEN_FRAC, 1 }, { "sign", TOKEN_SIGN, 1 }, { "step", TOKEN_STEP, 1 },
+        { "real", TOKEN_REAL, 1 }, { "imag", TOKEN_IMAG, 1 }, { "conj", TOKEN_CONJ, 1 }, { "arg", TOKEN_ARG, 1 },
+        { "min", TOKEN_MIN, 2 }, { "max", TOKEN_MAX, 2 }, { "mod", TOKEN_MOD, 2 }, { "atan2", TOKEN_ATAN2, 2 },
+        { "table", TOKEN_TABLE, 2 }, { "clamp", TOKEN_CLAMP, 3 }, { "field", TOKEN_FIELD, 3 }, { "if", TOKEN_IF, 3 }
+    };
+    const Function* function = nullptr;
+    for (const Function& f : functions)
+        if (name == f.name) function = &f;
+    if (!function) throw std::invalid_argument("Unknown equation function '" + name + "'");
+    if (arguments.size() != function->arity)
+        throw std::invalid_argument(name + "() takes " + std::to_string(function->arity) + " arguments");
+
+    BuiltExpression e;
+    e.text = name + "(";
+    for (size_t k = 0; k < arguments.size(); k++)
+    {
+        e.rpn.insert(e.rpn.end(), arguments[k].rpn.begin(), arguments[k].rpn.end());
+        e.text += (k ? ", " : "") + arguments[k].text;
+    }
+    e.rpn.push_back(Token(function->type));
+    e.text += ")";
+    return e;
+}
+
+// ============================================================================
+// Equations
+// ============================================================================
+std::string BuiltEquation::Key() const
+{
+    std::string key;
+    auto component = [&key](const char* target, const BuiltExpression& e)
+    {
+        if (e.Empty()) return;
+        key += (key.empty() ? "" : "; ") + std::string(target) + " = " + e.text;
+    };
+    component("ax", ax);
+    component("ay", ay);
+    component("angular", angular);
+    component("color.r", r);
+    component("color.g", g);
+    component("color.b", b);
+    component("color.a", a);
+    for (int k = 0; k < MAX_STATE_REGISTERS; k++) component(("s" + std::to_string(k)).c_str(), state[k]);
+    return key;
+}
+
+ParsedEquation BuiltEquation::Parse() const
+{
+    ParsedEquation eq;
+    eq.tokens_ax = ax.rpn;
+    eq.tokens_ay = ay.rpn;
+    eq.tokens_angular = angular.rpn;
+    eq.tokens_r = r.rpn;
+    eq.tokens_g = g.rpn;
+    eq.tokens_b = b.rpn;
+    eq.tokens_a = a.rpn;
+    for (int k = 0; k < MAX_STATE_REGISTERS; k++) eq.tokens_state[k] = state[k].rpn;
+    FinalizeEquation(eq);
+    return eq;
+}
@@ -0,0 +1,46 @@
+#ifndef EXPRESSION_BUILDER_H
+#define EXPRESSION_BUILDER_H
+
+#include "../include/parser.h"
+#include <string>
+#include <vector>
+
+// A scalar equation expression assembled from Python operators straight into RPN: combining
+// two is appending the second's tokens and the operator to the first's, so thousands of
+// generated equations skip formatting and tokenizeExpression() altogether. text renders the
+// same expression fully parenthesised in the equation syntax; it is the registration key of
+// the equation, so one set as text and saved scenes read it back like any other.
+struct BuiltExpression
+{
+    std::vector<Token> rpn;
+    std::string text;
+
+    BuiltExpression() = default;
+    BuiltExpression(double value);  // A constant
+
+    bool Empty() const { return rpn.empty(); }
+
+    // Throw std::invalid_argument for names the parser would not accept
+    static BuiltExpression Variable(const std::string& name);
+    static BuiltExpression ObjectProperty(int objectIndex, const std::string& property);  // p[i].property
+
+    static BuiltExpression Binary(TokenType op, const BuiltExpression& a, const BuiltExpression& b);
+    static BuiltExpression Negate(const BuiltExpression& a);
+    // name(arguments...) of a function of the equation syntax; throws for unknown names or arities
+    static BuiltExpression Call(const std::string& name, const std::vector<BuiltExpression>& arguments);
+};
+
+// The components of one equation; empty expressions are left out, as in the text form
+struct BuiltEquation
+{
+    BuiltExpression ax, ay, angular;
+    BuiltExpression r, g, b, a;
+    BuiltExpression state[MAX_STATE_REGISTERS];
+
+    // "ax = ...; ay = ...": parses to the same equation, and names it in the registry
+    std::string Key() const;
+    // The parsed form, after the passes ParseEquation() runs past tokenizing
+    ParsedEquation Parse() const;
+};
+
+#endif // EXPRESSION_BUILDER_H
@@ -0,0 +1,293 @@
+#include "metrics_exporter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketHandle;
+typedef int SocketLength;
+static const SocketHandle NO_SOCKET = INVALID_SOCKET;
+static void CloseSocket(SocketHandle s) { closesocket(s); }
+static bool WouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+static void SetNonBlocking(SocketHandle s)
+{
+    u_long on = 1;
+    ioctlsocket(s, FIONBIO, &on);
+}
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int SocketHandle;
+typedef socklen_t SocketLength;
+static const SocketHandle NO_SOCKET = -1;
+static void CloseSocket(SocketHandle s) { close(s); }
+static bool WouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+static void SetNonBlocking(SocketHandle s) { fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK); }
+#endif
+
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;  // A scraper hanging up must not raise SIGPIPE
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+static const int POLL_MILLISECONDS = 50;
+static const double CONNECTION_TIMEOUT_SECONDS = 5.0;  // A scraper that stops mid-request is dropped
+
+static SocketHandle Handle(intptr_t socket) { return static_cast<SocketHandle>(socket); }
+
+// ============================================================================
+// Text format
+// ============================================================================
+static void AppendValue(std::string& out, double value)
+{
+    if (std::isnan(value)) out += "NaN";
+    else if (std::isinf(value)) out += value > 0.0 ? "+Inf" : "-Inf";
+    else
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+        out += buffer;
+    }
+}
+
+void MetricsPage::Family(const char* name, const char* type, const char* help)
+{
+    m_text += std::string("# HELP ") + name + " " + help + "\n";
+    m_text += std::string("# TYPE ") + name + " " + type + "\n";
+}
+
+void MetricsPage::Sample(const char* name, double value, const Labels& labels)
+{
+    m_text += name;
+    if (!labels.empty())
+    {
+        m_text += '{';
+        for (size_t i = 0; i < labels.size(); i++)
+        {
+            if (i > 0) m_text += ',';
+            m_text += labels[i].first + "=\"";
+            for (char c : labels[i].second)
+            {
+                if (c == '\\' || c == '"') m_text += '\\';
+                if (c == '\n') m_text += "\\n";
+                else m_text += c;
+            }
+            m_text += '"';
+        }
+        m_text += '}';
+    }
+    m_text += ' ';
+    AppendValue(m_text, value);
+    m_text += '\n';
+}
+
+// ============================================================================
+// Server lifetime
+// ============================================================================
+MetricsExporter::MetricsExporter(const std::string& host, int port)
+    : m_published(std::chrono::steady_clock::now())
+{
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) throw std::runtime_error("Failed to initialize Winsock");
+#endif
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    SocketHandle listener = NO_SOCKET;
+    std::string error;
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1)
+        error = "Invalid metrics host (expected an IPv4 address): " + host;
+    else if ((listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) == NO_SOCKET)
+        error = "Failed to create the metrics socket";
+    else
+    {
+        int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+        SocketLength length = sizeof(address);
+        if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 16) != 0)
+            error = "Failed to listen on " + host + ":" + std::to_string(port);
+        else if (getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) == 0)
+            m_port = ntohs(address.sin_port);
+    }
+    if (!error.empty())
+    {
+        if (listener != NO_SOCKET) CloseSocket(listener);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        throw std::runtime_error(error);
+    }
+    SetNonBlocking(listener);
+    m_listener = static_cast<intptr_t>(listener);
+
+    m_thread = std::thread(&MetricsExporter::Run, this);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    Close();
+}
+
+void MetricsExporter::Publish(std::string page)
+{
+    if (m_closed) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_page.swap(page);
+    m_published = std::chrono::steady_clock::now();
+}
+
+void MetricsExporter::Close()
+{
+    if (m_closed) return;
+    m_closed = true;
+    m_closing.store(true);
+    if (m_thread.joinable()) m_thread.join();
+
+    for (Connection& connection : m_connections) CloseSocket(Handle(connection.socket));
+    m_connections.clear();
+    CloseSocket(Handle(m_listener));
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+// ============================================================================
+// Server thread: accept scrapers, read one request each, answer and hang up
+// ============================================================================
+void MetricsExporter::Run()
+{
+    while (!m_closing.load())
+    {
+        fd_set readable, writable;
+        FD_ZERO(&readable);
+        FD_ZERO(&writable);
+        FD_SET(Handle(m_listener), &readable);
+        SocketHandle highest = Handle(m_listener);
+        for (const Connection& connection : m_connections)
+        {
+            FD_SET(Handle(connection.socket), connection.response.empty() ? &readable : &writable);
+            highest = std::max(highest, Handle(connection.socket));
+        }
+        timeval timeout = { 0, POLL_MILLISECONDS * 1000 };
+        select(static_cast<int>(highest + 1), &readable, &writable, nullptr, &timeout);
+
+        if (FD_ISSET(Handle(m_listener), &readable)) Accept();
+
+        auto now = std::chrono::steady_clock::now();
+        size_t kept = 0;
+        for (size_t c = 0; c < m_connections.size(); c++)
+        {
+            Connection& connection = m_connections[c];
+            bool open = std::chrono::duration<double>(now - connection.opened).count() < CONNECTION_TIMEOUT_SECONDS;
+            if (open) open = connection.response.empty() ? Read(connection) : Flush(connection);
+            if (open) m_connections[kept++] = std::move(connection);
+            else CloseSocket(Handle(connection.socket));
+        }
+        m_connections.resize(kept);
+    }
+}
+
+void MetricsExporter::Accept()
+{
+    for (;;)
+    {
+        SocketHandle s = accept(Handle(m_listener), nullptr, nullptr);
+        if (s == NO_SOCKET) return;
+        SetNonBlocking(s);
+        Connection connection;
+        connection.socket = static_cast<intptr_t>(s);
+        connection.opened = std::chrono::steady_clock::now();
+        m_connections.push_back(std::move(connection));
+    }
+}
+
+// Gather the request head; once it is complete the response is queued behind it
+bool MetricsExporter::Read(Connection& connection)
+{
+    char buffer[1024];
+    for (;;)
+    {
+        auto received = recv(Handle(connection.socket), buffer, sizeof(buffer), 0);
+        if (received < 0) break;
+        if (received == 0) return false;
+        connection.request.append(buffer, static_cast<size_t>(received));
+        if (connection.request.size() > MAX_REQUEST_BYTES) return false;
+    }
+    if (!WouldBlock()) return false;
+    if (connection.request.find("\r\n\r\n") == std::string::npos &&
+        connection.request.find("\n\n") == std::string::npos)
+        return true;
+
+    connection.response = Respond(connection.request);
+    return Flush(connection);
+}
+
+// False once the response is out (or the scraper is gone), which closes the connection
+bool MetricsExporter::Flush(Connection& connection)
+{
+    while (connection.sent < connection.response.size())
+    {
+        size_t remaining = connection.response.size() - connection.sent;
+        int chunk = static_cast<int>(std::min<size_t>(remaining, 1u << 20));
+        auto written = send(Handle(connection.socket), connection.response.data() + connection.sent, chunk, SEND_FLAGS);
+        if (written < 0) return WouldBlock();
+        if (written == 0) return false;
+        connection.sent += static_cast<size_t>(written);
+    }
+    return false;
+}
+
+std::string MetricsExporter::Respond(const std::string& request)
+{
+    size_t methodEnd = request.find(' ');
+    size_t pathEnd = methodEnd == std::string::npos ? std::string::npos : request.find_first_of(" ?\r\n", methodEnd + 1);
+    std::string method = request.substr(0, methodEnd);
+    std::string path = pathEnd == std::string::npos ? "" : request.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+
+    std::string status, type, body;
+    if ((method == "GET" || method == "HEAD") && (path == "/metrics" || path == "/"))
+    {
+        MetricsPage age;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            body = m_page;
+            age.Family("stellar_metrics_age_seconds", "gauge", "Seconds since the simulation last published these metrics");
+            age.Sample("stellar_metrics_age_seconds",
+                       std::chrono::duration<double>(std::chrono::steady_clock::now() - m_published).count());
+        }
+        body += age.Text();
+        status = "200 OK";
+        type = "text/plain; version=0.0.4; charset=utf-8";
+        m_scrapes++;
+    }
+    else if (method != "GET" && method != "HEAD")
+    {
+        status = "405 Method Not Allowed";
+        type = "text/plain; charset=utf-8";
+        body = "Only GET is served\n";
+    }
+    else
+    {
+        status = "404 Not Found";
+        type = "text/plain; charset=utf-8";
+        body = "Metrics are served at /metrics\n";
+    }
+
+    std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: " + type +
+                           "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+    if (method != "HEAD") response += body;
+    return response;
+}
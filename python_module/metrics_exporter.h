@@ -0,0 +1,79 @@
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// One scrape in the Prometheus text exposition format (version 0.0.4): each family gets its
+// HELP and TYPE lines once, then its samples
+class MetricsPage
+{
+public:
+    typedef std::vector<std::pair<std::string, std::string>> Labels;
+
+    void Family(const char* name, const char* type, const char* help);  // type: "gauge" or "counter"
+    void Sample(const char* name, double value, const Labels& labels = {});
+    const std::string& Text() const { return m_text; }
+
+private:
+    std::string m_text;
+};
+
+// Serves the newest page Publish() was given over HTTP from its own thread, so a scraper of a
+// long-running headless simulation never touches GL or the simulation's state: the simulation
+// thread renders the page every interval and swaps it in. GET /metrics (or /) answers with the
+// page plus stellar_metrics_age_seconds, the time since it was published, which keeps growing
+// while the simulation is stalled; any other path is a 404.
+class MetricsExporter
+{
+public:
+    // Listens on host:port (port 0 picks a free one); throws if the socket cannot be bound
+    MetricsExporter(const std::string& host, int port);
+    ~MetricsExporter();
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    void Publish(std::string page);  // Simulation thread; replaces the page being served
+    void Close();                    // Drop the scrapers and join
+    int GetPort() const { return m_port; }
+    long long ScrapesServed() const { return m_scrapes.load(); }
+
+private:
+    static const size_t MAX_REQUEST_BYTES = 8192;  // Longer request heads are dropped
+
+    struct Connection
+    {
+        intptr_t socket;
+        std::string request;
+        std::string response;
+        size_t sent = 0;
+        std::chrono::steady_clock::time_point opened;
+    };
+
+    void Run();
+    void Accept();
+    bool Read(Connection& connection);   // False once the connection is done with
+    bool Flush(Connection& connection);
+    std::string Respond(const std::string& request);
+
+    intptr_t m_listener;
+    int m_port = 0;
+    std::vector<Connection> m_connections;  // Server thread only
+
+    std::mutex m_mutex;
+    std::string m_page;
+    std::chrono::steady_clock::time_point m_published;
+
+    std::atomic<bool> m_closing{ false };
+    std::atomic<long long> m_scrapes{ 0 };
+    std::thread m_thread;
+    bool m_closed = false;
+};
+
+#endif // METRICS_EXPORTER_H
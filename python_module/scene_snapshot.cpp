@@ -0,0 +1,281 @@
+#include "scene_snapshot.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+static const uint64_t SNAPSHOT_ALIGNMENT = 64;
+
+static uint64_t AlignUp(uint64_t offset)
+{
+    return (offset + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+}
+
+// uint32 length + bytes per string
+static std::vector<char> PackStrings(const std::vector<std::string>& strings)
+{
+    std::vector<char> packed;
+    for (const std::string& s : strings)
+    {
+        uint32_t length = static_cast<uint32_t>(s.size());
+        const char* bytes = reinterpret_cast<const char*>(&length);
+        packed.insert(packed.end(), bytes, bytes + sizeof(length));
+        packed.insert(packed.end(), s.begin(), s.end());
+    }
+    return packed;
+}
+
+static std::vector<std::string> UnpackStrings(const std::vector<char>& packed)
+{
+    std::vector<std::string> strings;
+    size_t pos = 0;
+    while (pos + sizeof(uint32_t) <= packed.size())
+    {
+        uint32_t length = 0;
+        std::memcpy(&length, packed.data() + pos, sizeof(length));
+        pos += sizeof(length);
+        if (length > packed.size() - pos) throw std::runtime_error("Corrupt string table in snapshot");
+        strings.emplace_back(packed.data() + pos, length);
+        pos += length;
+    }
+    return strings;
+}
+
+bool SceneSnapshotIO::IsSnapshotFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    char magic[sizeof(SNAPSHOT_MAGIC)] = {};
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+}
+
+// ============================================================================
+// Header, section table, then every array with one write each
+// ============================================================================
+void SceneSnapshotIO::Write(const std::string& filename, const SceneSnapshot& snapshot)
+{
+    struct Payload { uint32_t kind; uint32_t elementBytes; const void* data; uint64_t count; };
+    std::vector<char> equations = PackStrings(snapshot.equations);
+    std::vector<char> metadata = PackStrings(snapshot.metadata);
+    const Payload payloads[] = {
+        { SNAPSHOT_SECTION_OBJECTS, sizeof(Object), snapshot.objects.data(), snapshot.objects.size() },
+        { SNAPSHOT_SECTION_COLLISION, sizeof(CollisionProperties), snapshot.collision.data(), snapshot.collision.size() },
+        { SNAPSHOT_SECTION_CONSTRAINTS, sizeof(SnapshotConstraint), snapshot.constraints.data(), snapshot.constraints.size() },
+        { SNAPSHOT_SECTION_OBJECT_PARAMS, sizeof(float), snapshot.objectParams.data(), snapshot.objectParams.size() },
+        { SNAPSHOT_SECTION_EQUATIONS, 1, equations.data(), equations.size() },
+        { SNAPSHOT_SECTION_METADATA, 1, metadata.data(), metadata.size() },
+        { SNAPSHOT_SECTION_HANDLES, sizeof(int32_t), snapshot.handles.data(), snapshot.handles.size() },
+    };
+    const uint32_t sectionCount = sizeof(payloads) / sizeof(payloads[0]);
+
+    SnapshotHeader header = snapshot.header;
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.sectionCount = sectionCount;
+    header.objectBytes = sizeof(Object);
+
+    std::vector<SnapshotSection> sections(sectionCount);
+    uint64_t offset = AlignUp(sizeof(SnapshotHeader) + sectionCount * sizeof(SnapshotSection));
+    for (uint32_t i = 0; i < sectionCount; i++)
+    {
+        sections[i] = { payloads[i].kind, payloads[i].elementBytes, offset, payloads[i].count };
+        offset = AlignUp(offset + payloads[i].count * payloads[i].elementBytes);
+    }
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error("Failed to open file: " + filename);
+
+    static const char zeros[SNAPSHOT_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(sections.data()), sections.size() * sizeof(SnapshotSection));
+    uint64_t written = sizeof(header) + sections.size() * sizeof(SnapshotSection);
+    for (uint32_t i = 0; i < sectionCount; i++)
+    {
+        file.write(zeros, static_cast<std::streamsize>(sections[i].offset - written));
+        uint64_t bytes = payloads[i].count * payloads[i].elementBytes;
+        if (bytes) file.write(static_cast<const char*>(payloads[i].data), static_cast<std::streamsize>(bytes));
+        written = sections[i].offset + bytes;
+    }
+    if (!file) throw std::runtime_error("Failed to write file: " + filename);
+}
+
+// ============================================================================
+// Validate the header and read every known section straight into its array
+// ============================================================================
+template <typename T>
+static void ReadSection(std::ifstream& file, const SnapshotSection& section, std::vector<T>& out,
+                        uint64_t fileSize, const std::string& filename)
+{
+    if (section.elementBytes != sizeof(T))
+        throw std::runtime_error("Snapshot " + filename + " was written with a different data layout");
+    if (section.offset > fileSize || section.count > (fileSize - section.offset) / sizeof(T))
+        throw std::runtime_error("Snapshot " + filename + " is truncated");
+
+    out.resize(static_cast<size_t>(section.count));
+    file.seekg(static_cast<std::streamoff>(section.offset));
+    if (!out.empty()) file.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(out.size() * sizeof(T)));
+    if (!file) throw std::runtime_error("Failed to read snapshot: " + filename);
+}
+
+SceneSnapshot SceneSnapshotIO::Read(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file) throw std::runtime_error("Failed to open file: " + filename);
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    SceneSnapshot snapshot;
+    SnapshotHeader& header = snapshot.header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+        throw std::runtime_error("Not a snapshot file: " + filename);
+    if (header.version != SNAPSHOT_VERSION)
+        throw std::runtime_error("Unsupported snapshot version " + std::to_string(header.version) + ": " + filename);
+    if (header.objectBytes != sizeof(Object))
+        throw std::runtime_error("Snapshot " + filename + " was written with a different data layout");
+
+    std::vector<SnapshotSection> sections(header.sectionCount);
+    if (!file.read(reinterpret_cast<char*>(sections.data()), sections.size() * sizeof(SnapshotSection)))
+        throw std::runtime_error("Snapshot " + filename + " is truncated");
+
+    for (const SnapshotSection& section : sections)
+    {
+        std::vector<char> strings;
+        switch (section.kind)
+        {
+        case SNAPSHOT_SECTION_OBJECTS: ReadSection(file, section, snapshot.objects, fileSize, filename); break;
+        case SNAPSHOT_SECTION_COLLISION: ReadSection(file, section, snapshot.collision, fileSize, filename); break;
+        case SNAPSHOT_SECTION_CONSTRAINTS: ReadSection(file, section, snapshot.constraints, fileSize, filename); break;
+        case SNAPSHOT_SECTION_OBJECT_PARAMS: ReadSection(file, section, snapshot.objectParams, fileSize, filename); break;
+        case SNAPSHOT_SECTION_EQUATIONS:
+            ReadSection(file, section, strings, fileSize, filename);
+            snapshot.equations = UnpackStrings(strings);
+            break;
+        case SNAPSHOT_SECTION_METADATA:
+            ReadSection(file, section, strings, fileSize, filename);
+            snapshot.metadata = UnpackStrings(strings);
+            break;
+        case SNAPSHOT_SECTION_HANDLES: ReadSection(file, section, snapshot.handles, fileSize, filename); break;
+        default:
+            break;  // Sections of newer writers are skipped
+        }
+    }
+    return snapshot;
+}
+
+// ============================================================================
+// Delta log: one record per checkpoint, flushed before returning
+// ============================================================================
+template <typename T>
+static void WriteArray(std::ofstream& file, const std::vector<T>& values)
+{
+    if (!values.empty()) file.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+void SceneSnapshotIO::AppendDelta(const std::string& filename, const SnapshotDelta& delta)
+{
+    std::vector<char> equations = PackStrings(delta.equations);
+
+    SnapshotDeltaHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_DELTA_MAGIC, sizeof(SNAPSHOT_DELTA_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.sequence = delta.sequence;
+    header.objectBytes = sizeof(Object);
+    header.numObjects = delta.numObjects;
+    header.changedObjects = static_cast<uint32_t>(delta.objectIndices.size());
+    header.changedCollision = static_cast<uint32_t>(delta.collisionIndices.size());
+    header.changedParams = static_cast<uint32_t>(delta.paramIndices.size());
+    header.constraintCount = delta.constraintsChanged ? static_cast<int32_t>(delta.constraints.size()) : -1;
+    header.equationBytes = delta.equationsChanged ? static_cast<int32_t>(equations.size()) : -1;
+    header.scene = delta.scene;
+
+    std::ofstream file(filename, std::ios::binary | std::ios::app);
+    if (!file) throw std::runtime_error("Failed to open file: " + filename);
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    WriteArray(file, delta.objectIndices);
+    WriteArray(file, delta.objects);
+    WriteArray(file, delta.collisionIndices);
+    WriteArray(file, delta.collision);
+    WriteArray(file, delta.paramIndices);
+    WriteArray(file, delta.objectParams);
+    if (delta.constraintsChanged) WriteArray(file, delta.constraints);
+    if (delta.equationsChanged) WriteArray(file, equations);
+    file.flush();
+    if (!file) throw std::runtime_error("Failed to write file: " + filename);
+}
+
+// ============================================================================
+// Replay every complete record over the base, in file order
+// ============================================================================
+template <typename T>
+static bool ReadArray(std::ifstream& file, std::vector<T>& out, size_t count)
+{
+    out.resize(count);
+    return count == 0 || file.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(count * sizeof(T)));
+}
+
+template <typename T>
+static void Scatter(std::vector<T>& target, const std::vector<int32_t>& indices, const T* values, size_t width,
+                    const std::string& filename)
+{
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        size_t at = static_cast<size_t>(indices[i]) * width;
+        if (indices[i] < 0 || at + width > target.size())
+            throw std::runtime_error("Delta log " + filename + " writes past the object count");
+        std::copy(values + i * width, values + (i + 1) * width, target.begin() + at);
+    }
+}
+
+int SceneSnapshotIO::ApplyDeltas(const std::string& filename, SceneSnapshot& snapshot)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) return 0;
+
+    int applied = 0;
+    for (;;)
+    {
+        SnapshotDeltaHeader header{};
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) break;
+        if (std::memcmp(header.magic, SNAPSHOT_DELTA_MAGIC, sizeof(SNAPSHOT_DELTA_MAGIC)) != 0)
+            throw std::runtime_error("Not a delta log: " + filename);
+        if (header.version != SNAPSHOT_VERSION || header.objectBytes != sizeof(Object))
+            throw std::runtime_error("Delta log " + filename + " was written with a different data layout");
+
+        // The whole record is read before any of it is applied
+        SnapshotDelta delta;
+        std::vector<char> equations;
+        bool complete =
+            ReadArray(file, delta.objectIndices, header.changedObjects) &&
+            ReadArray(file, delta.objects, header.changedObjects) &&
+            ReadArray(file, delta.collisionIndices, header.changedCollision) &&
+            ReadArray(file, delta.collision, header.changedCollision) &&
+            ReadArray(file, delta.paramIndices, header.changedParams) &&
+            ReadArray(file, delta.objectParams, static_cast<size_t>(header.changedParams) * OBJECT_PARAM_COUNT) &&
+            (header.constraintCount < 0 || ReadArray(file, delta.constraints, static_cast<size_t>(header.constraintCount))) &&
+            (header.equationBytes < 0 || ReadArray(file, equations, static_cast<size_t>(header.equationBytes)));
+        if (!complete) break;
+
+        SnapshotHeader& scene = snapshot.header;
+        scene.params = header.scene.params;
+        scene.timestep = header.scene.timestep;
+        scene.integrator = header.scene.integrator;
+        scene.cameraX = header.scene.cameraX;
+        scene.cameraY = header.scene.cameraY;
+        scene.cameraZoom = header.scene.cameraZoom;
+        scene.simulationTime = header.scene.simulationTime;
+
+        size_t numObjects = header.numObjects;
+        if (numObjects != snapshot.objects.size()) snapshot.handles.clear();  // Deltas do not record handles
+        snapshot.objects.resize(numObjects);
+        snapshot.collision.resize(numObjects);
+        snapshot.objectParams.resize(numObjects * OBJECT_PARAM_COUNT, 0.0f);
+        Scatter(snapshot.objects, delta.objectIndices, delta.objects.data(), 1, filename);
+        Scatter(snapshot.collision, delta.collisionIndices, delta.collision.data(), 1, filename);
+        Scatter(snapshot.objectParams, delta.paramIndices, delta.objectParams.data(), OBJECT_PARAM_COUNT, filename);
+        if (header.constraintCount >= 0) snapshot.constraints = std::move(delta.constraints);
+        if (header.equationBytes >= 0) snapshot.equations = UnpackStrings(equations);
+        ++applied;
+    }
+    return applied;
+}
@@ -0,0 +1,122 @@
+#ifndef SCENE_SNAPSHOT_H
+#define SCENE_SNAPSHOT_H
+
+#include "../include/objects.h"
+#include "../include/object_params.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Binary scene file written by save_to_file(..., binary=True): a fixed header, a section table
+// and raw arrays, each section 64-byte aligned so a reader can map it in place
+// (numpy.memmap with the section's offset). Little-endian, native struct layouts.
+const char SNAPSHOT_MAGIC[8] = { 'S', 'T', 'L', 'R', 'S', 'N', 'A', 'P' };
+const uint32_t SNAPSHOT_VERSION = 2;  // 2: SimParams carries the world bounds
+
+enum SnapshotSectionKind : uint32_t
+{
+    SNAPSHOT_SECTION_OBJECTS = 1,        // Object, equationID indexing the equation keys
+    SNAPSHOT_SECTION_COLLISION = 2,      // CollisionProperties, one per object
+    SNAPSHOT_SECTION_CONSTRAINTS = 3,    // SnapshotConstraint
+    SNAPSHOT_SECTION_OBJECT_PARAMS = 4,  // OBJECT_PARAM_COUNT floats per object
+    SNAPSHOT_SECTION_EQUATIONS = 5,      // String table: registration key per equation ID
+    SNAPSHOT_SECTION_METADATA = 6,       // String table: title, author, description
+    SNAPSHOT_SECTION_HANDLES = 7         // int32 object handle per object; missing = handle i is object i
+};
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t sectionCount;
+    uint32_t objectBytes;       // sizeof(Object) of the writer, checked on load
+    uint32_t _pad0;
+    SimParams params;
+    float timestep;
+    int32_t integrator;
+    float cameraX, cameraY, cameraZoom;
+    float simulationTime;
+};
+static_assert(sizeof(SnapshotHeader) == 144, "SnapshotHeader layout is part of the file format");
+
+struct SnapshotSection
+{
+    uint32_t kind;
+    uint32_t elementBytes;
+    uint64_t offset;            // From the start of the file, 64-byte aligned
+    uint64_t count;             // Elements
+};
+static_assert(sizeof(SnapshotSection) == 24, "SnapshotSection layout is part of the file format");
+
+struct SnapshotConstraint
+{
+    int32_t owner;
+    Constraint constraint;
+};
+static_assert(sizeof(SnapshotConstraint) == 36, "SnapshotConstraint layout is part of the file format");
+
+// Everything a snapshot holds, in host memory
+struct SceneSnapshot
+{
+    SnapshotHeader header{};
+    std::vector<Object> objects;
+    std::vector<CollisionProperties> collision;
+    std::vector<SnapshotConstraint> constraints;
+    std::vector<float> objectParams;
+    std::vector<std::string> equations;
+    std::vector<std::string> metadata;
+    std::vector<int32_t> handles;
+};
+
+// Delta log written by checkpoint(): records appended to "<base>.delta", each a header followed
+// by its arrays in field order, unaligned. A record holds what changed since the previous
+// checkpoint; replaying them in order over the base snapshot gives the latest state.
+const char SNAPSHOT_DELTA_MAGIC[8] = { 'S', 'T', 'L', 'R', 'D', 'L', 'T', 'A' };
+
+struct SnapshotDeltaHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t sequence;          // 1 for the first delta after the base
+    uint32_t objectBytes;
+    uint32_t numObjects;        // Object count after the delta
+    uint32_t changedObjects;    // int32 index + Object each
+    uint32_t changedCollision;  // int32 index + CollisionProperties each
+    uint32_t changedParams;     // int32 index + OBJECT_PARAM_COUNT floats each
+    int32_t constraintCount;    // Full constraint list, -1 = unchanged
+    int32_t equationBytes;      // Full equation key table, -1 = unchanged
+    uint32_t _pad0;
+    SnapshotHeader scene;       // Parameters, camera and time; magic and sectionCount unused
+};
+static_assert(sizeof(SnapshotDeltaHeader) == 192, "SnapshotDeltaHeader layout is part of the file format");
+
+struct SnapshotDelta
+{
+    SnapshotHeader scene{};
+    uint32_t sequence = 0;
+    uint32_t numObjects = 0;
+    std::vector<int32_t> objectIndices;
+    std::vector<Object> objects;
+    std::vector<int32_t> collisionIndices;
+    std::vector<CollisionProperties> collision;
+    std::vector<int32_t> paramIndices;
+    std::vector<float> objectParams;             // OBJECT_PARAM_COUNT per index
+    bool constraintsChanged = false;
+    std::vector<SnapshotConstraint> constraints;
+    bool equationsChanged = false;
+    std::vector<std::string> equations;
+};
+
+namespace SceneSnapshotIO
+{
+    bool IsSnapshotFile(const std::string& filename);  // Starts with SNAPSHOT_MAGIC
+    void Write(const std::string& filename, const SceneSnapshot& snapshot);  // Throws std::runtime_error
+    SceneSnapshot Read(const std::string& filename);                         // Throws std::runtime_error
+
+    // Throw std::runtime_error; ApplyDeltas returns the records replayed (0 without a log) and
+    // stops at a record cut short by a crash mid-write
+    void AppendDelta(const std::string& filename, const SnapshotDelta& delta);
+    int ApplyDeltas(const std::string& filename, SceneSnapshot& snapshot);
+}
+
+#endif // SCENE_SNAPSHOT_H
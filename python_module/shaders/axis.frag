@@ -1,8 +0,0 @@
-#version 430 core
-in vec3 color;
-
-out vec4 FragColor;
-
-void main() {
-    FragColor = vec4(color, 1.0); // Use the vertex color directly
-}
\ No newline at end of file
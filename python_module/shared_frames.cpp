@@ -0,0 +1,319 @@
+#include "shared_frames.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Header fields - MUST MATCH the layout in shared_frames.h
+static const size_t OFFSET_MAGIC = 0;
+static const size_t OFFSET_VERSION = 4;
+static const size_t OFFSET_SLOTS = 8;
+static const size_t OFFSET_OBJECTS = 12;
+static const size_t OFFSET_FIELDS = 16;
+static const size_t OFFSET_NAMES = 20;
+static const size_t OFFSET_OBJECT_INDICES = 24;
+static const size_t OFFSET_SLOT_START = 28;
+static const size_t OFFSET_SLOT_BYTES = 32;
+static const size_t OFFSET_FRAMES = 40;
+
+// Slot fields
+static const size_t SLOT_SEQUENCE = 0;
+static const size_t SLOT_STEP = 8;
+static const size_t SLOT_TIME = 12;
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "The header counters are plain uint64 words");
+
+// Counters other processes read concurrently; both are 8-byte aligned in the mapping
+static std::atomic<uint64_t>* Counter(const unsigned char* base, size_t offset)
+{
+    return reinterpret_cast<std::atomic<uint64_t>*>(const_cast<unsigned char*>(base + offset));
+}
+
+static uint32_t GetU32(const unsigned char* base, size_t offset)
+{
+    uint32_t value;
+    std::memcpy(&value, base + offset, sizeof(value));
+    return value;
+}
+
+static void PutU32(unsigned char* base, size_t offset, uint32_t value)
+{
+    std::memcpy(base + offset, &value, sizeof(value));
+}
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+#ifndef _WIN32
+// shm_open wants one leading slash, as multiprocessing.shared_memory adds it
+static std::string PosixName(const std::string& name)
+{
+    return name.empty() || name[0] == '/' ? name : "/" + name;
+}
+#endif
+
+// ============================================================================
+// Segment
+// ============================================================================
+SharedFrameSegment::~SharedFrameSegment()
+{
+    Close();
+}
+
+void SharedFrameSegment::Create(const std::string& name, size_t bytes)
+{
+    Close();
+    if (name.empty()) throw std::runtime_error("A shared memory name is required");
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                        static_cast<DWORD>(static_cast<uint64_t>(bytes) >> 32),
+                                        static_cast<DWORD>(bytes & 0xFFFFFFFFu), name.c_str());
+    if (!mapping) throw std::runtime_error("Cannot create shared memory " + name);
+    if (GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        CloseHandle(mapping);
+        throw std::runtime_error("Shared memory " + name + " already exists");
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        throw std::runtime_error("Cannot map shared memory " + name);
+    }
+    m_handle = mapping;
+#else
+    std::string posixName = PosixName(name);
+    int fd = shm_open(posixName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+        throw std::runtime_error("Cannot create shared memory " + name + ": " + std::strerror(errno));
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+    {
+        close(fd);
+        shm_unlink(posixName.c_str());
+        throw std::runtime_error("Cannot size shared memory " + name);
+    }
+    void* data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        shm_unlink(posixName.c_str());
+        throw std::runtime_error("Cannot map shared memory " + name);
+    }
+#endif
+    m_name = name;
+    m_data = static_cast<unsigned char*>(data);
+    m_size = bytes;
+    m_owner = true;
+}
+
+void SharedFrameSegment::Open(const std::string& name)
+{
+    Close();
+#ifdef _WIN32
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+    if (!mapping) throw std::runtime_error("No shared memory named " + name);
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info = {};
+    if (!data || !VirtualQuery(data, &info, sizeof(info)))
+    {
+        if (data) UnmapViewOfFile(data);
+        CloseHandle(mapping);
+        throw std::runtime_error("Cannot map shared memory " + name);
+    }
+    size_t bytes = info.RegionSize;
+    m_handle = mapping;
+#else
+    int fd = shm_open(PosixName(name).c_str(), O_RDONLY, 0);
+    if (fd < 0) throw std::runtime_error("No shared memory named " + name);
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("Cannot read shared memory " + name);
+    }
+    size_t bytes = static_cast<size_t>(status.st_size);
+    void* data = bytes > 0 ? mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (data == MAP_FAILED) throw std::runtime_error("Cannot map shared memory " + name);
+#endif
+    m_name = name;
+    m_data = static_cast<unsigned char*>(data);
+    m_size = bytes;
+    m_owner = false;
+}
+
+void SharedFrameSegment::Close()
+{
+    if (!m_data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(static_cast<HANDLE>(m_handle));
+    m_handle = nullptr;
+#else
+    munmap(m_data, m_size);
+    if (m_owner) shm_unlink(PosixName(m_name).c_str());
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_owner = false;
+    m_name.clear();
+}
+
+// ============================================================================
+// Writer
+// ============================================================================
+SharedFrameWriter::SharedFrameWriter(const std::string& name, int slots, const std::vector<std::string>& fields,
+                                     const std::vector<int>& objects)
+    : m_slots(slots), m_values(fields.size() * objects.size())
+{
+    if (slots < 1) throw std::runtime_error("slots must be at least 1");
+    for (const std::string& field : fields)
+        if (field.size() >= SharedFrameLayout::NAME_BYTES) throw std::runtime_error("Field name too long: " + field);
+
+    size_t namesOffset = SharedFrameLayout::HEADER_BYTES;
+    size_t indicesOffset = namesOffset + fields.size() * SharedFrameLayout::NAME_BYTES;
+    m_slotOffset = AlignUp(indicesOffset + objects.size() * sizeof(int32_t), SharedFrameLayout::SLOT_ALIGNMENT);
+    m_slotBytes = AlignUp(SharedFrameLayout::SLOT_HEADER_BYTES + m_values * sizeof(float), SharedFrameLayout::SLOT_ALIGNMENT);
+    if (m_slotOffset > UINT32_MAX) throw std::runtime_error("Too many objects for a shared frame ring");
+    m_segment.Create(name, m_slotOffset + m_slotBytes * static_cast<size_t>(slots));
+
+    // A fresh mapping is zeroed: every sequence and the frame count start at 0
+    unsigned char* base = m_segment.Data();
+    PutU32(base, OFFSET_VERSION, SharedFrameLayout::VERSION);
+    PutU32(base, OFFSET_SLOTS, static_cast<uint32_t>(slots));
+    PutU32(base, OFFSET_OBJECTS, static_cast<uint32_t>(objects.size()));
+    PutU32(base, OFFSET_FIELDS, static_cast<uint32_t>(fields.size()));
+    PutU32(base, OFFSET_NAMES, static_cast<uint32_t>(namesOffset));
+    PutU32(base, OFFSET_OBJECT_INDICES, static_cast<uint32_t>(indicesOffset));
+    PutU32(base, OFFSET_SLOT_START, static_cast<uint32_t>(m_slotOffset));
+    uint64_t slotBytes = m_slotBytes;
+    std::memcpy(base + OFFSET_SLOT_BYTES, &slotBytes, sizeof(slotBytes));
+    for (size_t f = 0; f < fields.size(); f++)
+        std::memcpy(base + namesOffset + f * SharedFrameLayout::NAME_BYTES, fields[f].data(), fields[f].size());
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        int32_t index = objects[i];
+        std::memcpy(base + indicesOffset + i * sizeof(int32_t), &index, sizeof(index));
+    }
+
+    // Readers check the magic last, so a half-written header is never taken for a ring
+    std::atomic_thread_fence(std::memory_order_release);
+    PutU32(base, OFFSET_MAGIC, SharedFrameLayout::MAGIC);
+}
+
+void SharedFrameWriter::Publish(const float* values, int step, float time)
+{
+    unsigned char* slot = m_segment.Data() + m_slotOffset + static_cast<size_t>(m_frames % m_slots) * m_slotBytes;
+    std::atomic<uint64_t>* sequence = Counter(slot, SLOT_SEQUENCE);
+    uint64_t frame = static_cast<uint64_t>(m_frames);
+
+    sequence->store(2 * frame + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(slot + SLOT_STEP, &step, sizeof(step));
+    std::memcpy(slot + SLOT_TIME, &time, sizeof(time));
+    std::memcpy(slot + SharedFrameLayout::SLOT_HEADER_BYTES, values, m_values * sizeof(float));
+    sequence->store(2 * frame + 2, std::memory_order_release);
+
+    m_frames++;
+    Counter(m_segment.Data(), OFFSET_FRAMES)->store(static_cast<uint64_t>(m_frames), std::memory_order_release);
+}
+
+// ============================================================================
+// Reader
+// ============================================================================
+SharedFrameReader::SharedFrameReader(const std::string& name)
+{
+    m_segment.Open(name);
+    const unsigned char* base = m_segment.Data();
+    if (m_segment.Size() < SharedFrameLayout::HEADER_BYTES || GetU32(base, OFFSET_MAGIC) != SharedFrameLayout::MAGIC)
+        throw std::runtime_error(name + " is not a shared frame ring (or is still being created)");
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (GetU32(base, OFFSET_VERSION) != SharedFrameLayout::VERSION)
+        throw std::runtime_error(name + " has an unsupported shared frame version");
+
+    m_slots = static_cast<int>(GetU32(base, OFFSET_SLOTS));
+    m_objects = static_cast<int>(GetU32(base, OFFSET_OBJECTS));
+    size_t fields = GetU32(base, OFFSET_FIELDS);
+    size_t namesOffset = GetU32(base, OFFSET_NAMES);
+    size_t indicesOffset = GetU32(base, OFFSET_OBJECT_INDICES);
+    m_slotOffset = GetU32(base, OFFSET_SLOT_START);
+    uint64_t slotBytes;
+    std::memcpy(&slotBytes, base + OFFSET_SLOT_BYTES, sizeof(slotBytes));
+    m_slotBytes = static_cast<size_t>(slotBytes);
+    if (m_slots < 1 || m_slotOffset + m_slotBytes * static_cast<size_t>(m_slots) > m_segment.Size())
+        throw std::runtime_error(name + " is truncated");
+
+    for (size_t f = 0; f < fields; f++)
+    {
+        const char* entry = reinterpret_cast<const char*>(base + namesOffset + f * SharedFrameLayout::NAME_BYTES);
+        m_fields.emplace_back(entry, strnlen(entry, SharedFrameLayout::NAME_BYTES));
+    }
+    m_objectIndices.resize(static_cast<size_t>(m_objects));
+    if (m_objects > 0) std::memcpy(m_objectIndices.data(), base + indicesOffset, m_objectIndices.size() * sizeof(int32_t));
+}
+
+long long SharedFrameReader::Latest() const
+{
+    return static_cast<long long>(Counter(m_segment.Data(), OFFSET_FRAMES)->load(std::memory_order_acquire)) - 1;
+}
+
+const unsigned char* SharedFrameReader::Slot(long long frame) const
+{
+    return m_segment.Data() + m_slotOffset + static_cast<size_t>(frame % m_slots) * m_slotBytes;
+}
+
+bool SharedFrameReader::IsValid(long long frame) const
+{
+    if (frame < 0) return false;
+    std::atomic_thread_fence(std::memory_order_acquire);  // Reads of the slot come before the check
+    return Counter(Slot(frame), SLOT_SEQUENCE)->load(std::memory_order_acquire) == 2 * static_cast<uint64_t>(frame) + 2;
+}
+
+const float* SharedFrameReader::Values(long long frame) const
+{
+    return reinterpret_cast<const float*>(Slot(frame) + SharedFrameLayout::SLOT_HEADER_BYTES);
+}
+
+bool SharedFrameReader::Info(long long frame, int& step, float& time) const
+{
+    if (!IsValid(frame)) return false;
+    std::memcpy(&step, Slot(frame) + SLOT_STEP, sizeof(step));
+    std::memcpy(&time, Slot(frame) + SLOT_TIME, sizeof(time));
+    return IsValid(frame);
+}
+
+bool SharedFrameReader::Read(long long frame, std::vector<float>& values, int& step, float& time, long long& read) const
+{
+    // The newest frame is retried while the writer laps it; an older one is gone once overwritten
+    size_t count = static_cast<size_t>(m_objects) * m_fields.size();
+    for (int attempt = 0; attempt < 64; attempt++)
+    {
+        read = frame < 0 ? Latest() : frame;
+        if (!IsValid(read))
+        {
+            if (frame >= 0 || read < 0) return false;
+            continue;
+        }
+        values.resize(count);
+        std::memcpy(&step, Slot(read) + SLOT_STEP, sizeof(step));
+        std::memcpy(&time, Slot(read) + SLOT_TIME, sizeof(time));
+        std::memcpy(values.data(), Values(read), count * sizeof(float));
+        if (IsValid(read)) return true;
+        if (frame >= 0) return false;
+    }
+    return false;
+}
@@ -0,0 +1,108 @@
+#ifndef SHARED_FRAMES_H
+#define SHARED_FRAMES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Recorded frames published into a named shared-memory ring (POSIX shm_open / a Windows file
+// mapping) that other processes map and read in place, without a GL context or any copy.
+// The same name opens it from Python's multiprocessing.shared_memory.SharedMemory too.
+//
+// Layout, native byte order; offsets in bytes:
+//   header (HEADER_BYTES): uint32 magic "HSFR", uint32 version, uint32 slots, uint32 objects,
+//       uint32 fields, uint32 names offset, uint32 object indices offset, uint32 slot offset,
+//       uint64 slot bytes, uint64 frames published (atomic; frame n is in slot n % slots)
+//   names: NAME_BYTES per field, zero padded; object indices: int32 per object
+//   slots, SLOT_ALIGNMENT aligned: uint64 sequence, int32 step, float time, then
+//       float values[object * fields + field] at SLOT_HEADER_BYTES
+// Each slot is a seqlock: its sequence is odd while frame n is being written and 2n + 2 once
+// it is complete, so a reader that sees the same even sequence before and after reading a
+// slot read frame n whole.
+struct SharedFrameLayout
+{
+    static const uint32_t MAGIC = 0x52465348;  // "HSFR"
+    static const uint32_t VERSION = 1;
+    static const size_t HEADER_BYTES = 64;
+    static const size_t NAME_BYTES = 16;
+    static const size_t SLOT_ALIGNMENT = 64;
+    static const size_t SLOT_HEADER_BYTES = 64;
+};
+
+// A mapping of the segment, created by the writer and opened by the readers
+class SharedFrameSegment
+{
+public:
+    SharedFrameSegment() = default;
+    ~SharedFrameSegment();
+    SharedFrameSegment(const SharedFrameSegment&) = delete;
+    SharedFrameSegment& operator=(const SharedFrameSegment&) = delete;
+
+    // Throw std::runtime_error when the segment cannot be made or mapped
+    void Create(const std::string& name, size_t bytes);
+    void Open(const std::string& name);
+    void Close();  // The writer's close removes the name; readers keep their mappings
+
+    unsigned char* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+    std::string m_name;
+    unsigned char* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_owner = false;
+    void* m_handle = nullptr;  // Windows file mapping
+};
+
+// Simulation side: one Publish() per recorded frame
+class SharedFrameWriter
+{
+public:
+    SharedFrameWriter(const std::string& name, int slots, const std::vector<std::string>& fields,
+                      const std::vector<int>& objects);
+
+    void Publish(const float* values, int step, float time);
+    long long FramesPublished() const { return m_frames; }
+    int GetSlots() const { return m_slots; }
+
+private:
+    SharedFrameSegment m_segment;
+    int m_slots;
+    size_t m_values;  // Floats per frame
+    size_t m_slotOffset;
+    size_t m_slotBytes;
+    long long m_frames = 0;
+};
+
+// Consumer side, any process: frames are read by number, newest = Latest()
+class SharedFrameReader
+{
+public:
+    explicit SharedFrameReader(const std::string& name);
+
+    long long Latest() const;  // -1 before the first frame
+    bool IsValid(long long frame) const;  // Complete and not yet overwritten
+    const float* Values(long long frame) const;  // Points into the ring; check IsValid() after reading
+    bool Info(long long frame, int& step, float& time) const;
+    // Copy frame (the newest for -1) under the seqlock; false when it was overwritten first
+    bool Read(long long frame, std::vector<float>& values, int& step, float& time, long long& read) const;
+
+    int GetSlots() const { return m_slots; }
+    int GetObjects() const { return m_objects; }
+    const std::vector<std::string>& GetFields() const { return m_fields; }
+    const std::vector<int>& GetObjectIndices() const { return m_objectIndices; }
+
+private:
+    const unsigned char* Slot(long long frame) const;
+
+    SharedFrameSegment m_segment;
+    int m_slots = 0;
+    int m_objects = 0;
+    std::vector<std::string> m_fields;
+    std::vector<int> m_objectIndices;
+    size_t m_slotOffset = 0;
+    size_t m_slotBytes = 0;
+};
+
+#endif // SHARED_FRAMES_H
@@ -1,25 +1,74 @@
 #include "simulation_wrapper.h"
 #include "../include/objects.h"
+#include "../include/gl_debug.h"
+#include "../include/event_driven.h"
 #include "../include/parser.h"
 #include "../include/constraints.h"
+#include "../include/object_lifecycle.h"
+#include "../include/object_params.h"
+#include "../include/state_registers.h"
+#include "../include/object_sensitivity.h"
+#include "../include/object_handles.h"
+#include "../include/object_aggregates.h"
+#include "../include/world_tiles.h"
+#include "../include/scene_cache.h"
+#include "../include/object_trails.h"
 #include "../include/async_shader_loader.h"
 #include "../include/axis.h"
+#include "../include/cpu_backend.h"
+#include "../include/vulkan_backend.h"
+#include "../include/gpu_serializer.h"
+#include "../include/equation_cache.h"
 #include "../include/camera.h"
 #include "../include/globals.h"
+#include "../include/gpu_profiler.h"
+#include "../include/frame_trace.h"
+#include "../include/perf_counters.h"
+#include "../include/metropolis.h"
+#include "../include/lookup_tables.h"
+#include "../include/grid_fields.h"
+#include "../include/object_pipeline.h"
+#include "../include/step_scheduler.h"
+#include "trajectory_writer.h"
+#include "state_stream.h"
+#include "metrics_exporter.h"
+#include "command_queue.h"
+#include "shared_frames.h"
+#include "domain_decomposition.h"
+#include "cuda_interop.h"
+#include "video_capture.h"
+#include "scene_snapshot.h"
+#include "egl_context.h"
+#include "expression_builder.h"
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 #include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <set>
 #include <sstream>
-#include <utility> 
+#include <utility>
+#include <unordered_map>
 
 namespace
 {
     bool g_axisInitialized = false;   // Tracks axis system initialization
     GLuint g_axisShaderProgram = 0;   // Shader program for rendering axes/grid
+
+    // The engine (objects.h and the modules under it) is one per process; the simulation
+    // initialized on it, until its cleanup()
+    const SimulationWrapper* g_engineOwner = nullptr;
 }
 
 // Create shader program for rendering coordinate axes and grid
@@ -105,15 +154,31 @@ GLuint CreateAxisShader()
     return shaderProgram;
 }
 
+// The scene as cpu_backend.h steps it; current while Objects::GetSceneRevision() is still revision
+struct CpuSceneMirror
+{
+    CpuBackend::EquationSet equations;
+    std::vector<std::string> equationKeys;  // Objects::GetEquationKeys() equations was built from
+    CpuBackend::Scene scene;
+    unsigned long long revision = 0;
+    bool valid = false;
+};
+
 // Constructor: Initialize simulation with optional graphics
 SimulationWrapper::SimulationWrapper(bool headless, int width, int height, std::string title, bool enable_grid)
     : m_headless(headless), m_initialized(false), m_paused(false),
     m_window(nullptr), m_currentBuffer(0), m_title(title),
     m_width(width), m_height(height), m_simulationTime(0.0f),
-    m_enable_grid(enable_grid)
+    m_enable_grid(enable_grid), m_commands(std::make_shared<CommandQueue>())
 {
     try
     {
+        // A second live simulation would step, upload and release the first one's buffers
+        if (g_engineOwner)
+            throw std::runtime_error("Another Simulation is using the engine of this process; call its cleanup() first, "
+                                     "run independent systems as worlds of one simulation (run_batch(ensemble=True)) "
+                                     "or in separate processes (run_batch_parallel)");
+
         // Initialize global settings
         g_width = width;
         g_height = height;
@@ -130,6 +195,7 @@ SimulationWrapper::SimulationWrapper(bool headless, int width, int height, std::
             if (!init_windowed(width, height, title))
                 throw std::runtime_error("Failed to initialize windowed context");
         }
+        g_engineOwner = this;
     }
     catch (const std::exception& e)
     {
@@ -148,6 +214,12 @@ SimulationWrapper::~SimulationWrapper()
 // Initialize headless mode (no window, for batch processing)
 bool SimulationWrapper::init_headless()
 {
+    // STELLAR_HEADLESS=glfw skips EGL, =egl makes it the only option
+    const char* backend = std::getenv("STELLAR_HEADLESS");
+    std::string headlessBackend = backend ? backend : "";
+    if (headlessBackend != "glfw" && init_egl()) return true;
+    if (headlessBackend == "egl") return false;
+
     // Initialize GLFW
     if (!glfwInit())
     {
@@ -159,6 +231,7 @@ bool SimulationWrapper::init_headless()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLDebug::WantsDebugContext() ? GLFW_TRUE : GLFW_FALSE);
     glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     // Create hidden window
@@ -206,6 +279,46 @@ bool SimulationWrapper::init_headless()
     return true;
 }
 
+// Headless context straight from the GPU driver: no X/Wayland server, no GLFW
+bool SimulationWrapper::init_egl()
+{
+    const char* deviceVar = std::getenv("STELLAR_EGL_DEVICE");
+    int device = deviceVar ? std::atoi(deviceVar) : 0;
+
+    std::string error;
+    std::unique_ptr<EglContext> context = EglContext::Create(device, error);
+    if (!context)
+    {
+        std::cerr << "EGL headless context unavailable (" << error << ")" << std::endl;
+        return false;
+    }
+
+    if (!gladLoadGL(reinterpret_cast<GLADloadfunc>(&EglContext::GetProcAddress)))
+    {
+        std::cerr << "Failed to initialize GLAD" << std::endl;
+        return false;
+    }
+    while (glGetError() != GL_NO_ERROR);
+
+    if (!Objects::Init(nullptr))
+    {
+        std::cerr << "Failed to initialize object system" << std::endl;
+        return false;
+    }
+
+    m_eglContext = std::move(context);
+    m_initialized = true;
+    return true;
+}
+
+void SimulationWrapper::make_context_current()
+{
+    if (m_window)
+        glfwMakeContextCurrent(static_cast<GLFWwindow*>(m_window));
+    else if (m_eglContext)
+        m_eglContext->MakeCurrent();
+}
+
 // Window resize callback
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
@@ -234,6 +347,7 @@ bool SimulationWrapper::init_windowed(int width, int height, const std::string&
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLDebug::WantsDebugContext() ? GLFW_TRUE : GLFW_FALSE);
     glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
     glfwWindowHint(GLFW_FOCUSED, GLFW_TRUE);
     glfwWindowHint(GLFW_FOCUS_ON_SHOW, GLFW_TRUE);
@@ -339,10 +453,19 @@ bool SimulationWrapper::init_windowed(int width, int height, const std::string&
 }
 
 // Throw exception if simulation is not initialized
+// Hand a CUDA-mapped object buffer back to GL; what CUDA wrote is new object state
+static void EndDeviceMapping()
+{
+    if (!CudaInterop::IsMapped()) return;
+    CudaInterop::Unmap();
+    Objects::MarkObjectsWritten();
+}
+
 void SimulationWrapper::ensure_initialized() const
 {
     if (!m_initialized)
         throw std::runtime_error("Simulation not initialized");
+    EndDeviceMapping();  // Whatever is called next may touch the object buffer
 }
 
 // Process user input (keyboard, mouse)
@@ -354,12 +477,11 @@ void SimulationWrapper::process_input()
         glfwMakeContextCurrent(glfwWindow);
 
         // Handle ESC key to close window
-        static bool escWasPressed = false;
         bool escIsPressed = (glfwGetKey(glfwWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS);
 
-        if (escIsPressed && !escWasPressed)
+        if (escIsPressed && !m_escWasPressed)
             glfwSetWindowShouldClose(glfwWindow, GLFW_TRUE);
-        escWasPressed = escIsPressed;
+        m_escWasPressed = escIsPressed;
 
         // Process camera controls
         g_camera.ProcessInput(glfwWindow, 0.016f);
@@ -399,600 +521,2956 @@ std::pair<bool, int> SimulationWrapper::get_collision_parameters() const
     return std::make_pair(enable_warm_start, max_contact_iterations);
 }
 
-// ============================================================================
-// Update simulation physics
-// ============================================================================
-void SimulationWrapper::update(float dt)
+int SimulationWrapper::get_contact_count() const
 {
     ensure_initialized();
-    if (m_paused) return;
+    return Objects::GetContactCount();
+}
 
-    if (m_window)
-        glfwMakeContextCurrent(static_cast<GLFWwindow*>(m_window));
+void SimulationWrapper::set_broadphase_mode(PyBroadphaseMode mode)
+{
+    ensure_initialized();
+    Objects::SetBroadphaseMode(static_cast<BroadphaseMode>(mode));
+}
 
-    const float FIXED_STEP = 0.001f;
-    static float accumulator = 0.0f;
-    accumulator += dt;
+PyBroadphaseMode SimulationWrapper::get_broadphase_mode() const
+{
+    ensure_initialized();
+    return static_cast<PyBroadphaseMode>(Objects::GetBroadphaseMode());
+}
 
-    int stepCount = 0;
-    const int MAX_STEPS_PER_FRAME = 20;
+void SimulationWrapper::set_narrowphase_buckets(bool enabled)
+{
+    ensure_initialized();
+    Objects::SetNarrowphaseBuckets(enabled);
+}
 
-    while (accumulator >= FIXED_STEP && stepCount < MAX_STEPS_PER_FRAME)
-    {
-        m_simulationTime += FIXED_STEP;
+bool SimulationWrapper::get_narrowphase_buckets() const
+{
+    ensure_initialized();
+    return Objects::GetNarrowphaseBuckets();
+}
 
-        while (glGetError() != GL_NO_ERROR);
+void SimulationWrapper::set_neighbour_skin(float skin)
+{
+    ensure_initialized();
+    if (!(skin >= 0.0f)) throw std::runtime_error("Neighbour skin must be >= 0");
+    Objects::SetNeighbourSkin(skin);
+}
 
-        GLuint computeProgram = Objects::GetComputeProgram();
-        if (computeProgram && Objects::IsComputeShaderReady())
-        {
-            glUseProgram(computeProgram);
-
-            // Fetch uniform locations
-            GLint dtLoc = glGetUniformLocation(computeProgram, "uDt");
-            GLint timeLoc = glGetUniformLocation(computeProgram, "uTime");
-            GLint kLoc = glGetUniformLocation(computeProgram, "k");
-            GLint bLoc = glGetUniformLocation(computeProgram, "b");
-            GLint gLoc = glGetUniformLocation(computeProgram, "g");
-            GLint gravityDirLoc = glGetUniformLocation(computeProgram, "uGravityDir");
-            GLint restitutionLoc = glGetUniformLocation(computeProgram, "uRestitution");
-            GLint couplingLoc = glGetUniformLocation(computeProgram, "uCoupling");
-            GLint externalForceLoc = glGetUniformLocation(computeProgram, "uExternalForce");
-            GLint driveFreqLoc = glGetUniformLocation(computeProgram, "uDriveFreq");
-            GLint driveAmpLoc = glGetUniformLocation(computeProgram, "uDriveAmp");
-            GLint equationModeLoc = glGetUniformLocation(computeProgram, "uEquationMode");
-            GLint numObjectsLoc = glGetUniformLocation(computeProgram, "uNumObjects");
-
-            // NEW: Get collision parameter uniforms
-            GLint enableWarmStartLoc = glGetUniformLocation(computeProgram, "uEnableWarmStart");
-            GLint maxContactIterationsLoc = glGetUniformLocation(computeProgram, "uMaxContactIterations");
-
-            // Apply Uniforms
-            if (dtLoc != -1) glUniform1f(dtLoc, FIXED_STEP);
-            if (timeLoc != -1) glUniform1f(timeLoc, m_simulationTime);
-            if (kLoc != -1) glUniform1f(kLoc, 1.0f);
-            if (bLoc != -1) glUniform1f(bLoc, 0.1f);
-            if (gLoc != -1) glUniform1f(gLoc, 9.81f);
-            if (gravityDirLoc != -1) glUniform2f(gravityDirLoc, 0.0f, -1.0f);
-            if (restitutionLoc != -1) glUniform1f(restitutionLoc, 0.7f);
-            if (couplingLoc != -1) glUniform1f(couplingLoc, 1.0f);
-            if (externalForceLoc != -1) glUniform2f(externalForceLoc, 0.0f, 0.0f);
-            if (driveFreqLoc != -1) glUniform1f(driveFreqLoc, 1.0f);
-            if (driveAmpLoc != -1) glUniform1f(driveAmpLoc, 0.0f);
-            if (equationModeLoc != -1) glUniform1i(equationModeLoc, 0);
-            if (numObjectsLoc != -1) glUniform1i(numObjectsLoc, Objects::GetNumObjects());
-
-            // NEW: Apply collision parameters
-            auto collision_params = get_collision_parameters();
-            if (enableWarmStartLoc != -1) glUniform1i(enableWarmStartLoc, collision_params.first ? 1 : 0);
-            if (maxContactIterationsLoc != -1) glUniform1i(maxContactIterationsLoc, collision_params.second);
-
-            // Run Compute Shader
-            Objects::Update(m_currentBuffer, 1 - m_currentBuffer);
-            m_currentBuffer = 1 - m_currentBuffer;
+float SimulationWrapper::get_neighbour_skin() const
+{
+    ensure_initialized();
+    return Objects::GetNeighbourSkin();
+}
 
-            glUseProgram(0);
-        }
+void SimulationWrapper::set_small_world_objects(int objects)
+{
+    ensure_initialized();
+    if (objects < 0) throw std::runtime_error("Small world size must be >= 0");
+    Objects::SetSmallWorldObjects(objects);
+}
 
-        accumulator -= FIXED_STEP;
-        stepCount++;
-    }
+int SimulationWrapper::get_small_world_objects() const
+{
+    ensure_initialized();
+    return Objects::GetSmallWorldObjects();
+}
 
-    // Error checking
-    GLenum err = glGetError();
-    if (err != GL_NO_ERROR)
-        std::cerr << "OpenGL error in sub-stepping loop: " << err << std::endl;
+int SimulationWrapper::get_broadphase_rebuilds() const
+{
+    ensure_initialized();
+    return Objects::GetBroadphaseRebuilds();
 }
 
-// ============================================================================
-// Render simulation to screen
-// ============================================================================
-void SimulationWrapper::render()
+void SimulationWrapper::set_equation_compile_mode(bool enabled)
 {
-    if (m_headless || !m_window) return;
+    ensure_initialized();
+    Objects::SetEquationCompileMode(enabled);
+}
 
-    glfwMakeContextCurrent(static_cast<GLFWwindow*>(m_window));
+bool SimulationWrapper::get_equation_compile_mode() const
+{
+    ensure_initialized();
+    return Objects::GetEquationCompileMode();
+}
 
-    int w, h;
-    glfwGetFramebufferSize(static_cast<GLFWwindow*>(m_window), &w, &h);
+void SimulationWrapper::set_equation_cache(const std::string& directory)
+{
+    EquationCache::SetDirectory(directory);
+}
 
-    if (w <= 0 || h <= 0) return;
+std::string SimulationWrapper::get_equation_cache() const
+{
+    return EquationCache::GetDirectory();
+}
 
-    // Set up viewport and clear screen
-    glViewport(0, 0, w, h);
-    glClearColor(0.05f, 0.05f, 0.08f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+void SimulationWrapper::set_register_bytecode_enabled(bool enabled)
+{
+    ensure_initialized();
+    Objects::SetRegisterBytecodeEnabled(enabled);
+}
 
-    // Calculate camera matrices
-    glm::mat4 projection = g_camera.GetProjectionMatrix(w, h);
-    glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(-g_camera.position, 0.0f));
-    glm::mat4 projView = projection * view;
+bool SimulationWrapper::get_register_bytecode_enabled() const
+{
+    ensure_initialized();
+    return Objects::GetRegisterBytecodeEnabled();
+}
 
-    while (glGetError() != GL_NO_ERROR);
+void SimulationWrapper::set_fast_math(bool enabled, int scan_interval, bool rollback)
+{
+    ensure_initialized();
+    if (scan_interval < 0) throw std::runtime_error("Scan interval must be >= 0");
+    Objects::SetFastMath(enabled, scan_interval, rollback);
+}
 
-    // Only render axis if grid is enabled
-    if (m_enable_grid && g_axisInitialized && g_axisShaderProgram)
-    {
-        glUseProgram(g_axisShaderProgram);
-        GLenum err = glGetError();
-        if (err != GL_NO_ERROR) return;
+void SimulationWrapper::set_trails(int object_count, int length)
+{
+    ensure_initialized();
+    if (object_count < 0) throw std::runtime_error("Trail object count must be >= 0");
+    if (length < 2 || length > TRAIL_MAX_LENGTH)
+        throw std::runtime_error("Trail length must be between 2 and " + std::to_string(TRAIL_MAX_LENGTH));
+    if (!Objects::SetTrails(object_count, length)) throw std::runtime_error("Failed to allocate the trail buffer");
+}
 
-        Axis::Update(g_camera, w, h);
-        Axis::Draw(g_axisShaderProgram, projView);
-        glUseProgram(0);
-    }
+std::tuple<int, int> SimulationWrapper::get_trails() const
+{
+    ensure_initialized();
 
-    // Render physics objects
-    GLuint objectProgram = Objects::GetQuadProgram();
-    if (objectProgram && Objects::IsQuadShaderReady())
-    {
-        glUseProgram(objectProgram);
-        GLenum err = glGetError();
-        if (err != GL_NO_ERROR)
-        {
-            glUseProgram(0);
-            return;
-        }
+    int object_count, length;
+    Objects::GetTrails(object_count, length);
+    return std::make_tuple(object_count, length);
+}
 
-        // Pass camera matrices to shader
-        GLint projLoc = glGetUniformLocation(objectProgram, "uProjection");
-        GLint viewLoc = glGetUniformLocation(objectProgram, "uView");
+void SimulationWrapper::set_force_field(const std::string& ax, const std::string& ay,
+                                        std::tuple<float, float, float, float> bounds,
+                                        std::tuple<int, int> resolution, float scale)
+{
+    ensure_initialized();
+    if (scale <= 0.0f) throw std::runtime_error("Arrow scale must be > 0");
+    if (!Objects::SetForceFieldGrid(std::get<0>(bounds), std::get<1>(bounds), std::get<2>(bounds), std::get<3>(bounds),
+                                    std::get<0>(resolution), std::get<1>(resolution), scale))
+        throw std::runtime_error("Invalid force field bounds or resolution");
 
-        if (projLoc != -1) glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-        if (viewLoc != -1) glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+    std::string error;
+    if (!Objects::SetForceField(ax, ay, error)) throw std::runtime_error(error);
+}
 
-        Objects::Draw(m_currentBuffer);
-        glUseProgram(0);
-    }
+void SimulationWrapper::clear_force_field()
+{
+    ensure_initialized();
+    Objects::ClearForceField();
+}
 
-    // Swap buffers and poll events
-    glfwSwapBuffers(static_cast<GLFWwindow*>(m_window));
-    glfwPollEvents();
+void SimulationWrapper::set_render_interpolation(bool enabled)
+{
+    ensure_initialized();
+    m_renderInterpolation = enabled;
+    if (!enabled) Objects::SetInterpolationFraction(1.0f);
 }
 
-// ============================================================================
-// COLLISION MANAGEMENT FUNCTIONS
-// ============================================================================
+float SimulationWrapper::get_interpolation_fraction() const
+{
+    ensure_initialized();
+    return Objects::GetInterpolationFraction();
+}
 
-// Enable or disable collisions for a specific object
-void SimulationWrapper::set_collision_enabled(int index, bool enabled)
+void SimulationWrapper::set_density_rendering(bool enabled, float exposure)
 {
     ensure_initialized();
+    if (!(exposure > 0.0f) || !std::isfinite(exposure))
+        throw std::runtime_error("Density exposure must be positive");
+    Objects::SetDensityExposure(exposure);
+    Objects::SetDensityRendering(enabled);
+}
 
-    if (index < 0 || index >= Objects::GetNumObjects())
-        throw std::runtime_error("Invalid object index");
+std::tuple<bool, float> SimulationWrapper::get_density_rendering() const
+{
+    ensure_initialized();
+    return { Objects::GetDensityRendering(), Objects::GetDensityExposure() };
+}
 
-    Objects::SetCollisionEnabled(index, enabled);
+void SimulationWrapper::set_constraint_rendering(bool enabled, float strain_scale)
+{
+    ensure_initialized();
+    if (!(strain_scale > 0.0f) || !std::isfinite(strain_scale))
+        throw std::runtime_error("Constraint strain scale must be positive");
+    Objects::SetConstraintStrainScale(strain_scale);
+    Objects::SetConstraintRendering(enabled);
 }
 
-// Set collision shape for an object
-void SimulationWrapper::set_collision_shape(int index, PyCollisionShape shape)
+std::tuple<bool, float> SimulationWrapper::get_constraint_rendering() const
 {
     ensure_initialized();
+    return { Objects::GetConstraintRendering(), Objects::GetConstraintStrainScale() };
+}
 
-    if (index < 0 || index >= Objects::GetNumObjects())
-        throw std::runtime_error("Invalid object index");
+void SimulationWrapper::set_profiling(bool enabled)
+{
+    GpuProfiler::SetEnabled(enabled);
+    GpuProfiler::Reset();
+}
 
-    // Convert Python shape enum to C++ shape type
-    CollisionShape cppShape;
-    switch (shape)
-    {
-    case PyCollisionShape::NONE:
-        cppShape = static_cast<CollisionShape>(0);  // COLLISION_NONE
-        break;
-    case PyCollisionShape::CIRCLE:
-        cppShape = static_cast<CollisionShape>(1);  // COLLISION_CIRCLE
-        break;
-    case PyCollisionShape::AABB:
-        cppShape = static_cast<CollisionShape>(2);  // COLLISION_AABB
-        break;
-    case PyCollisionShape::POLYGON:
-        cppShape = static_cast<CollisionShape>(3);  // COLLISION_POLYGON
-        break;
-    default:
-        cppShape = static_cast<CollisionShape>(0);  // COLLISION_NONE
-    }
+std::map<std::string, std::map<std::string, double>> SimulationWrapper::get_profile() const
+{
+    std::map<std::string, std::map<std::string, double>> profile = { { "gpu", {} }, { "cpu", {} } };
+    for (const GpuProfiler::PassStats& pass : GpuProfiler::GetGpuStats())
+        profile["gpu"][pass.name] = pass.milliseconds;
+    for (const GpuProfiler::PassStats& time : GpuProfiler::GetCpuStats())
+        profile["cpu"][time.name] = time.milliseconds;
+    return profile;
+}
 
-    Objects::SetCollisionShape(index, cppShape);
+void SimulationWrapper::set_step_budget(float budget_ms, int max_steps, float max_lag)
+{
+    if (!(budget_ms >= 0.0f) || !std::isfinite(budget_ms))
+        throw std::runtime_error("Step budget must be 0 or a positive number of milliseconds");
+    if (max_steps < 1)
+        throw std::runtime_error("max_steps must be at least 1");
+    if (!(max_lag >= 0.0f) || !std::isfinite(max_lag))
+        throw std::runtime_error("max_lag must be 0 or a positive number of seconds");
+    StepScheduler::SetBudget(budget_ms);
+    StepScheduler::SetMaxSteps(max_steps);
+    StepScheduler::SetMaxLag(max_lag);
 }
 
-// Set collision material properties (restitution and friction)
-void SimulationWrapper::set_collision_properties(int index, float restitution, float friction)
+std::map<std::string, double> SimulationWrapper::get_step_stats() const
 {
-    ensure_initialized();
+    // Whole steps still owed; the fraction of a step left over is not lag
+    float step = std::max(m_timestep, 1e-9f);
+    double lag = std::floor(m_stepAccumulator / step) * step;
+    return {
+        { "steps", m_lastUpdateSteps },
+        { "step_ms", StepScheduler::GetStepTime() },
+        { "budget_ms", StepScheduler::GetBudget() },
+        { "max_steps", StepScheduler::GetMaxSteps() },
+        { "lag", lag },
+        { "dropped", m_droppedSimulationTime },
+    };
+}
 
-    if (index < 0 || index >= Objects::GetNumObjects())
-        throw std::runtime_error("Invalid object index");
+void SimulationWrapper::set_counters(bool enabled, int interval)
+{
+    if (interval < 1)
+        throw std::runtime_error("Counter read interval must be at least 1 step");
+    PerfCounters::SetReadInterval(interval);
+    PerfCounters::SetEnabled(enabled);
+}
 
-    // Validate input ranges
-    if (restitution < 0.0f || restitution > 1.0f)
-        throw std::runtime_error("Restitution must be between 0.0 and 1.0");
+std::tuple<std::map<std::string, double>, std::vector<double>> SimulationWrapper::get_counters() const
+{
+    const PerfCounters::Counts& counts = PerfCounters::GetLatest();
+    static const char* const names[PerfCounters::PERF_COUNTER_COUNT] = {
+        "tokens", "equations", "pair_tests", "contacts", "constraint_solves", "sanitized"
+    };
+
+    std::map<std::string, double> totals = {
+        { "steps", static_cast<double>(counts.steps) },
+        { "interval", static_cast<double>(PerfCounters::GetReadInterval()) },
+    };
+    for (int i = 0; i < PerfCounters::PERF_COUNTER_COUNT; i++)
+        totals[names[i]] = static_cast<double>(counts.totals[i]);
+    std::vector<double> perEquation(counts.perEquation.begin(), counts.perEquation.end());
+    return { totals, perEquation };
+}
 
-    if (friction < 0.0f || friction > 1.0f)
-        throw std::runtime_error("Friction must be between 0.0 and 1.0");
+void SimulationWrapper::set_collision_events(bool enabled, uint32_t category_mask, int capacity)
+{
+    if (capacity < 1)
+        throw std::runtime_error("Collision event capacity must be at least 1");
+    if (enabled && !ContactEvents::IsEnabled()) m_droppedCollisionEvents = 0;
+    ContactEvents::SetCapacity(capacity);
+    ContactEvents::SetCategoryMask(category_mask);
+    ContactEvents::SetEnabled(enabled);
+}
 
-    Objects::SetCollisionProperties(index, restitution, friction);
+std::vector<ContactEvent> SimulationWrapper::take_collision_events()
+{
+    std::vector<ContactEvent> events;
+    uint64_t dropped = 0;
+    ContactEvents::Take(events, dropped);
+    m_droppedCollisionEvents += dropped;
+    return events;
 }
 
-// Get current collision configuration for an object
-CollisionConfig SimulationWrapper::get_collision_config(int index)
+std::vector<std::tuple<std::string, std::string, size_t, size_t>> SimulationWrapper::memory_report() const
 {
     ensure_initialized();
+    std::vector<Objects::MemoryEntry> entries;
+    Objects::GetMemoryReport(entries);
 
-    if (index < 0 || index >= Objects::GetNumObjects())
-        throw std::runtime_error("Invalid object index");
-
-    // Retrieve collision properties from object system
-    CollisionProperties props = Objects::GetCollisionProperties(index);
-
-    // Convert to Python-friendly configuration
-    CollisionConfig config;
-    config.enabled = (props.enabled == 1);
-    config.restitution = props.restitution;
-    config.friction = props.friction;
+    std::vector<std::tuple<std::string, std::string, size_t, size_t>> report;
+    for (const Objects::MemoryEntry& entry : entries)
+        report.emplace_back(entry.name, entry.gpu ? "gpu" : "host", entry.capacityBytes, entry.usedBytes);
+    return report;
+}
 
-    // Convert shape type to Python enum
-    switch (props.shapeType)
-    {
-    case COLLISION_NONE:
-        config.shape = PyCollisionShape::NONE;
-        break;
-    case COLLISION_CIRCLE:
-        config.shape = PyCollisionShape::CIRCLE;
-        break;
-    case COLLISION_AABB:
-        config.shape = PyCollisionShape::AABB;
-        break;
-    case COLLISION_POLYGON:
-        config.shape = PyCollisionShape::POLYGON;
-        break;
-    default:
-        config.shape = PyCollisionShape::NONE;
-    }
+void SimulationWrapper::start_trace()
+{
+    if (!FrameTrace::Start())
+        throw std::runtime_error("Tracing is not compiled in; rebuild with STELLAR_TRACING");
+}
 
-    return config;
+void SimulationWrapper::stop_trace(const std::string& path)
+{
+    if (!FrameTrace::IsActive())
+        throw std::runtime_error("No trace is being captured; call start_trace() first");
+    FrameTrace::Stop();
+    if (!FrameTrace::WriteChromeTrace(path))
+        throw std::runtime_error("Could not write trace to " + path);
 }
 
-// Enable or disable collisions between two specific objects
-void SimulationWrapper::enable_collision_between(int obj1, int obj2, bool enable)
+std::tuple<bool, int, bool> SimulationWrapper::get_fast_math() const
 {
     ensure_initialized();
 
-    if (obj1 < 0 || obj1 >= Objects::GetNumObjects())
-        throw std::runtime_error("Invalid object1 index");
-
-    if (obj2 < 0 || obj2 >= Objects::GetNumObjects())
-        throw std::runtime_error("Invalid object2 index");
+    bool enabled, rollback;
+    int scan_interval;
+    Objects::GetFastMath(enabled, scan_interval, rollback);
 
-    Objects::EnableCollisionBetween(obj1, obj2, enable);
+    return std::make_tuple(enabled, scan_interval, rollback);
 }
 
-// Check if collisions are enabled for an object
-bool SimulationWrapper::is_collision_enabled(int index)
+std::tuple<int, std::vector<int>> SimulationWrapper::get_invalid_objects() const
 {
     ensure_initialized();
 
-    if (index < 0 || index >= Objects::GetNumObjects())
-        throw std::runtime_error("Invalid object index");
+    std::vector<int> indices;
+    int count = Objects::GetInvalidObjects(indices);
+    return std::make_tuple(count, indices);
+}
+
+int SimulationWrapper::get_nan_rollback_count() const
+{
+    ensure_initialized();
+    return Objects::GetNanRollbackCount();
+}
+
+void SimulationWrapper::set_dispatch_reorder_interval(int steps)
+{
+    ensure_initialized();
+    if (steps < 0) throw std::runtime_error("Reorder interval must be >= 0");
+    Objects::SetDispatchReorderInterval(steps);
+}
+
+int SimulationWrapper::get_dispatch_reorder_interval() const
+{
+    ensure_initialized();
+    return Objects::GetDispatchReorderInterval();
+}
+
+void SimulationWrapper::set_storage_reorder_interval(int steps)
+{
+    ensure_initialized();
+    if (steps < 0) throw std::runtime_error("Reorder interval must be >= 0");
+    Objects::SetStorageReorderInterval(steps);
+}
+
+int SimulationWrapper::get_storage_reorder_interval() const
+{
+    ensure_initialized();
+    return Objects::GetStorageReorderInterval();
+}
+
+void SimulationWrapper::tune_workgroup_sizes(bool force)
+{
+    ensure_initialized();
+    Objects::StartWorkgroupTuning(force);
+}
+
+bool SimulationWrapper::is_workgroup_tuning() const
+{
+    ensure_initialized();
+    return Objects::IsWorkgroupTuning();
+}
+
+std::tuple<int, int, int> SimulationWrapper::get_workgroup_sizes() const
+{
+    ensure_initialized();
+
+    int integrate, constraints, collide;
+    Objects::GetWorkgroupSizes(integrate, constraints, collide);
+
+    return std::make_tuple(integrate, constraints, collide);
+}
+
+void SimulationWrapper::set_soa_storage_enabled(bool enabled, bool quantized)
+{
+    ensure_initialized();
+    Objects::SetStructOfArraysStorage(enabled, quantized);
+}
+
+bool SimulationWrapper::get_soa_storage_enabled() const
+{
+    ensure_initialized();
+    return Objects::GetStructOfArraysStorage();
+}
+
+bool SimulationWrapper::get_soa_storage_quantized() const
+{
+    ensure_initialized();
+    return Objects::GetStructOfArraysQuantized();
+}
+
+void SimulationWrapper::set_fused_substeps(bool enabled)
+{
+    m_fuseSubsteps = enabled;
+}
+
+bool SimulationWrapper::get_fused_substeps() const
+{
+    return m_fuseSubsteps;
+}
+
+void SimulationWrapper::set_long_range_parameters(float theta, float gravity_constant, float coulomb_constant, float softening)
+{
+    ensure_initialized();
+    if (theta < 0.0f) throw std::runtime_error("Opening angle theta must be >= 0");
+    if (softening < 0.0f) throw std::runtime_error("Softening length must be >= 0");
+    Objects::SetLongRangeParameters(theta, gravity_constant, coulomb_constant, softening);
+}
+
+std::tuple<float, float, float, float> SimulationWrapper::get_long_range_parameters() const
+{
+    ensure_initialized();
+
+    float theta, gravity_constant, coulomb_constant, softening;
+    Objects::GetLongRangeParameters(theta, gravity_constant, coulomb_constant, softening);
+
+    return std::make_tuple(theta, gravity_constant, coulomb_constant, softening);
+}
+
+void SimulationWrapper::set_long_range_method(const std::string& method, int mesh_size,
+                                              std::tuple<float, float, float, float> periodic_box)
+{
+    ensure_initialized();
+
+    LongRangeMethod selected;
+    if (method == "barnes_hut") selected = LONG_RANGE_BARNES_HUT;
+    else if (method == "particle_mesh") selected = LONG_RANGE_PARTICLE_MESH;
+    else throw std::runtime_error("Unknown long-range method: " + method + " (use barnes_hut or particle_mesh)");
+
+    glm::vec4 box(std::get<0>(periodic_box), std::get<1>(periodic_box),
+                  std::get<2>(periodic_box), std::get<3>(periodic_box));
+    if (!Objects::SetLongRangeMethod(selected, mesh_size, box))
+        throw std::runtime_error("Particle mesh needs a power-of-two mesh_size from 16 to 512 (1024 when periodic) "
+                                 "and a periodic box with positive width and height, or none");
+}
+
+std::tuple<std::string, int, std::tuple<float, float, float, float>> SimulationWrapper::get_long_range_method() const
+{
+    ensure_initialized();
+
+    LongRangeMethod method;
+    int mesh_size;
+    glm::vec4 box;
+    Objects::GetLongRangeMethod(method, mesh_size, box);
+
+    return std::make_tuple(std::string(method == LONG_RANGE_PARTICLE_MESH ? "particle_mesh" : "barnes_hut"),
+                           mesh_size, std::make_tuple(box.x, box.y, box.z, box.w));
+}
+
+void SimulationWrapper::set_world_bounds(const std::string& mode, std::tuple<float, float, float, float> box)
+{
+    ensure_initialized();
+
+    BoundaryMode selected;
+    if (mode == "reflect") selected = BOUNDARY_REFLECT;
+    else if (mode == "periodic") selected = BOUNDARY_PERIODIC;
+    else if (mode == "open") selected = BOUNDARY_OPEN;
+    else throw std::runtime_error("Unknown boundary mode: " + mode + " (use reflect, periodic or open)");
+
+    glm::vec2 worldMin(std::get<0>(box), std::get<1>(box));
+    glm::vec2 worldMax = worldMin + glm::vec2(std::get<2>(box), std::get<3>(box));
+    if (!Objects::SetWorldBounds(selected, worldMin, worldMax))
+        throw std::runtime_error("World bounds need a positive width and height");
+}
+
+std::tuple<std::string, std::tuple<float, float, float, float>> SimulationWrapper::get_world_bounds() const
+{
+    ensure_initialized();
+
+    BoundaryMode mode;
+    glm::vec2 worldMin, worldMax;
+    Objects::GetWorldBounds(mode, worldMin, worldMax);
+
+    const char* name = mode == BOUNDARY_PERIODIC ? "periodic" : (mode == BOUNDARY_OPEN ? "open" : "reflect");
+    glm::vec2 size = worldMax - worldMin;
+    return std::make_tuple(std::string(name), std::make_tuple(worldMin.x, worldMin.y, size.x, size.y));
+}
+
+void SimulationWrapper::set_random_seed(uint32_t seed)
+{
+    ensure_initialized();
+    Objects::SetRandomSeed(seed);
+}
+
+uint32_t SimulationWrapper::get_random_seed() const
+{
+    ensure_initialized();
+    return Objects::GetRandomSeed();
+}
+
+void SimulationWrapper::set_metropolis(bool enabled, float step_size, std::tuple<float, float, float, float> histogram_box,
+                                       std::tuple<int, int> histogram_bins)
+{
+    ensure_initialized();
+
+    int binsX = std::get<0>(histogram_bins), binsY = std::get<1>(histogram_bins);
+    if (!(step_size > 0.0f))
+        throw std::runtime_error("Metropolis step size must be positive");
+    if (binsX < 0 || binsY < 0 || static_cast<int64_t>(binsX) * binsY > Metropolis::METROPOLIS_MAX_HISTOGRAM_BINS)
+        throw std::runtime_error("Metropolis histogram needs 0 to " +
+                                 std::to_string(Metropolis::METROPOLIS_MAX_HISTOGRAM_BINS) + " bins");
+    glm::vec2 histogramMin(std::get<0>(histogram_box), std::get<1>(histogram_box));
+    glm::vec2 histogramSize(std::get<2>(histogram_box), std::get<3>(histogram_box));
+    if (binsX * binsY > 0 && !(histogramSize.x > 0.0f && histogramSize.y > 0.0f))
+        throw std::runtime_error("Metropolis histogram box needs a positive width and height");
+
+    Metropolis::SetStepSize(step_size);
+    Metropolis::SetHistogram(histogramMin, histogramMin + histogramSize, binsX, binsY);
+    Metropolis::SetEnabled(enabled);
+}
+
+std::tuple<uint64_t, std::vector<uint32_t>, std::vector<std::vector<uint32_t>>> SimulationWrapper::get_metropolis_stats() const
+{
+    ensure_initialized();
+
+    Metropolis::Stats stats;
+    Metropolis::Read(Objects::GetNumObjects(), stats);
+
+    glm::vec2 histogramMin, histogramMax;
+    int binsX = 0, binsY = 0;
+    Metropolis::GetHistogram(histogramMin, histogramMax, binsX, binsY);
+    std::vector<std::vector<uint32_t>> rows;
+    if (stats.histogram.size() == static_cast<size_t>(binsX) * binsY)
+    {
+        for (int y = 0; y < binsY; y++)
+            rows.emplace_back(stats.histogram.begin() + static_cast<size_t>(y) * binsX,
+                              stats.histogram.begin() + static_cast<size_t>(y + 1) * binsX);
+    }
+    return { stats.proposals, stats.accepted, rows };
+}
+
+void SimulationWrapper::clear_metropolis_stats()
+{
+    ensure_initialized();
+    Metropolis::ClearStats();
+}
+
+void SimulationWrapper::set_table(int id, const std::vector<float>& values, std::tuple<float, float> x_range,
+                                  const std::string& interpolation)
+{
+    ensure_initialized();
+
+    LookupTables::Interpolation mode;
+    if (interpolation == "linear") mode = LookupTables::LOOKUP_LINEAR;
+    else if (interpolation == "cubic") mode = LookupTables::LOOKUP_CUBIC;
+    else throw std::runtime_error("Unknown table interpolation '" + interpolation + "' (linear or cubic)");
+    if (id < 0 || id >= LookupTables::MAX_LOOKUP_TABLES)
+        throw std::runtime_error("Table id must be in [0, " + std::to_string(LookupTables::MAX_LOOKUP_TABLES) + ")");
+    if (values.empty()) throw std::runtime_error("Table needs at least one value");
+    if (!LookupTables::SetTable(id, values, std::get<0>(x_range), std::get<1>(x_range), mode))
+        throw std::runtime_error("Table x range needs min < max");
+}
+
+void SimulationWrapper::set_field(int id, const std::vector<std::vector<float>>& values,
+                                  std::tuple<float, float, float, float> box)
+{
+    ensure_initialized();
+
+    if (id < 0 || id >= LookupTables::MAX_LOOKUP_FIELDS)
+        throw std::runtime_error("Field id must be in [0, " + std::to_string(LookupTables::MAX_LOOKUP_FIELDS) + ")");
+    if (values.empty() || values[0].empty()) throw std::runtime_error("Field needs at least one value");
+    int width = static_cast<int>(values[0].size()), height = static_cast<int>(values.size());
+    std::vector<float> samples;
+    samples.reserve(static_cast<size_t>(width) * height);
+    for (const std::vector<float>& row : values)
+    {
+        if (static_cast<int>(row.size()) != width) throw std::runtime_error("Field rows must all have the same length");
+        samples.insert(samples.end(), row.begin(), row.end());
+    }
+    glm::vec2 fieldMin(std::get<0>(box), std::get<1>(box));
+    glm::vec2 fieldSize(std::get<2>(box), std::get<3>(box));
+    if (!LookupTables::SetField(id, samples, width, height, fieldMin, fieldMin + fieldSize))
+        throw std::runtime_error("Field box needs a positive width and height");
+}
+
+void SimulationWrapper::clear_table(int id)
+{
+    ensure_initialized();
+    LookupTables::ClearTable(id);
+}
+
+void SimulationWrapper::clear_field(int id)
+{
+    ensure_initialized();
+    LookupTables::ClearField(id);
+}
+
+void SimulationWrapper::set_grid(std::tuple<int, int> resolution, std::tuple<float, float, float, float> box,
+                                 const std::string& boundary)
+{
+    ensure_initialized();
+
+    GridFields::Boundary mode;
+    if (boundary == "clamp") mode = GridFields::GRID_CLAMP;
+    else if (boundary == "periodic") mode = GridFields::GRID_PERIODIC;
+    else if (boundary == "zero") mode = GridFields::GRID_ZERO;
+    else throw std::runtime_error("Unknown grid boundary '" + boundary + "' (clamp, periodic or zero)");
+
+    glm::vec2 gridMin(std::get<0>(box), std::get<1>(box));
+    glm::vec2 gridSize(std::get<2>(box), std::get<3>(box));
+    std::string error;
+    if (!GridFields::SetGrid(std::get<0>(resolution), std::get<1>(resolution), gridMin, gridMin + gridSize, mode, error))
+        throw std::runtime_error(error);
+}
+
+void SimulationWrapper::set_grid_field(const std::string& name, const std::string& expression,
+                                       const std::vector<std::vector<float>>& values, int field_id)
+{
+    ensure_initialized();
+
+    glm::ivec2 size = GridFields::GetSize();
+    if (size.x == 0) throw std::runtime_error("Call set_grid() before adding grid fields");
+    std::vector<float> samples;
+    if (values.empty()) samples.assign(static_cast<size_t>(size.x) * size.y, 0.0f);
+    else
+    {
+        if (static_cast<int>(values.size()) != size.y)
+            throw std::runtime_error("Grid field values need " + std::to_string(size.y) + " rows");
+        samples.reserve(static_cast<size_t>(size.x) * size.y);
+        for (const std::vector<float>& row : values)
+        {
+            if (static_cast<int>(row.size()) != size.x)
+                throw std::runtime_error("Grid field rows need " + std::to_string(size.x) + " values");
+            samples.insert(samples.end(), row.begin(), row.end());
+        }
+    }
+
+    std::string error;
+    if (!GridFields::SetField(name, samples, expression, field_id, error)) throw std::runtime_error(error);
+}
+
+std::vector<std::vector<float>> SimulationWrapper::get_grid_field(const std::string& name)
+{
+    ensure_initialized();
+
+    std::vector<float> samples;
+    if (!GridFields::GetValues(name, samples)) throw std::runtime_error("No grid field '" + name + "'");
+    glm::ivec2 size = GridFields::GetSize();
+    std::vector<std::vector<float>> rows(size.y);
+    for (int j = 0; j < size.y; j++)
+        rows[j].assign(samples.begin() + static_cast<size_t>(j) * size.x, samples.begin() + static_cast<size_t>(j + 1) * size.x);
+    return rows;
+}
+
+void SimulationWrapper::show_grid_field(const std::string& name, std::tuple<float, float> value_range, float opacity)
+{
+    ensure_initialized();
+    if (!GridFields::SetDisplay(name, std::get<0>(value_range), std::get<1>(value_range), opacity))
+        throw std::runtime_error("No grid field '" + name + "', or the value range is empty");
+}
+
+void SimulationWrapper::clear_grid()
+{
+    ensure_initialized();
+    GridFields::Clear();
+}
+
+void SimulationWrapper::set_pipeline(const std::vector<std::string>& passes)
+{
+    ensure_initialized();
+    std::string error;
+    if (!ObjectPipeline::Set(passes, error)) throw std::runtime_error(error);
+}
+
+std::vector<float> SimulationWrapper::get_pipeline_field(const std::string& name)
+{
+    ensure_initialized();
+
+    std::vector<float> values;
+    if (!ObjectPipeline::GetValues(name, Objects::GetNumObjects(), values))
+        throw std::runtime_error("No pipeline pass writes field '" + name + "'");
+    return values;
+}
+
+void SimulationWrapper::clear_pipeline()
+{
+    ensure_initialized();
+    ObjectPipeline::Clear();
+}
+
+void SimulationWrapper::set_adaptive_timestep(bool enabled, float min_dt, float max_dt, float courant)
+{
+    ensure_initialized();
+    if (!(min_dt > 0.0f) || max_dt < min_dt) throw std::runtime_error("Need 0 < min_dt <= max_dt");
+    if (!(courant > 0.0f)) throw std::runtime_error("Courant factor must be positive");
+
+    // Hand the simulation time back and forth between the host and the GPU
+    if (!enabled && Objects::IsAdaptiveTimestepActive())
+    {
+        float last_dt;
+        Objects::GetAdaptiveTimestepState(last_dt, m_simulationTime);
+    }
+    Objects::SetAdaptiveTimestep(enabled, min_dt, max_dt, courant, m_timestep, m_simulationTime);
+}
+
+std::tuple<bool, float, float, float> SimulationWrapper::get_adaptive_timestep() const
+{
+    ensure_initialized();
+
+    bool enabled;
+    float min_dt, max_dt, courant;
+    Objects::GetAdaptiveTimestep(enabled, min_dt, max_dt, courant);
+
+    return std::make_tuple(enabled, min_dt, max_dt, courant);
+}
+
+std::vector<float> SimulationWrapper::get_timestep_history() const
+{
+    ensure_initialized();
+    return Objects::GetTimestepHistory();
+}
+
+void SimulationWrapper::set_sleep_parameters(bool enabled, float velocity_threshold, float acceleration_threshold, int steps)
+{
+    ensure_initialized();
+    if (velocity_threshold < 0.0f || acceleration_threshold < 0.0f) throw std::runtime_error("Sleep thresholds must be >= 0");
+    if (steps < 1) throw std::runtime_error("Sleep steps must be >= 1");
+    Objects::SetSleepParameters(enabled, velocity_threshold, acceleration_threshold, steps);
+}
+
+std::tuple<bool, float, float, int> SimulationWrapper::get_sleep_parameters() const
+{
+    ensure_initialized();
+
+    bool enabled;
+    float velocity_threshold, acceleration_threshold;
+    int steps;
+    Objects::GetSleepParameters(enabled, velocity_threshold, acceleration_threshold, steps);
+
+    return std::make_tuple(enabled, velocity_threshold, acceleration_threshold, steps);
+}
+
+int SimulationWrapper::get_awake_object_count() const
+{
+    ensure_initialized();
+    return Objects::GetAwakeObjectCount();
+}
+
+void SimulationWrapper::wake_all_objects()
+{
+    ensure_initialized();
+    Objects::WakeAllObjects();
+}
+
+void SimulationWrapper::set_xpbd_constraints(bool enabled, int iterations, float compliance)
+{
+    ensure_initialized();
+    if (iterations < 1) throw std::runtime_error("XPBD iterations must be >= 1");
+    if (compliance < 0.0f) throw std::runtime_error("XPBD compliance must be >= 0");
+    Objects::SetConstraintSolver(enabled, iterations, compliance);
+}
+
+std::tuple<bool, int, float> SimulationWrapper::get_xpbd_constraints() const
+{
+    ensure_initialized();
+
+    bool enabled;
+    int iterations;
+    float compliance;
+    Objects::GetConstraintSolver(enabled, iterations, compliance);
+
+    return std::make_tuple(enabled, iterations, compliance);
+}
+
+std::tuple<int, int> SimulationWrapper::get_xpbd_graph() const
+{
+    ensure_initialized();
+
+    int edges, colors;
+    Objects::GetConstraintGraph(edges, colors);
+
+    return std::make_tuple(edges, colors);
+}
+
+// Edge list (two indices per spring) and per-spring columns of 1 or E values
+void SimulationWrapper::set_springs(const std::vector<int>& endpoints, const std::vector<float>& stiffness,
+                                    const std::vector<float>& damping, const std::vector<float>& rest_length)
+{
+    ensure_initialized();
+    if (endpoints.size() % 2 != 0) throw std::runtime_error("Spring edges must come in pairs");
+
+    size_t numEdges = endpoints.size() / 2;
+    int numObjects = object_count();
+    for (size_t e = 0; e < numEdges; e++)
+    {
+        int a = endpoints[2 * e], b = endpoints[2 * e + 1];
+        if (a < 0 || a >= numObjects || b < 0 || b >= numObjects)
+            throw std::runtime_error("Spring " + std::to_string(e) + " refers to an object out of range");
+        if (a == b) throw std::runtime_error("Spring " + std::to_string(e) + " joins an object to itself");
+    }
+
+    auto checkColumn = [numEdges](const std::vector<float>& column, const char* name, bool optional)
+    {
+        if (column.empty() && optional) return;
+        if (column.size() != 1 && column.size() != numEdges)
+            throw std::runtime_error(std::string("Spring ") + name + " must hold one value or one per edge");
+    };
+    checkColumn(stiffness, "stiffness", false);
+    checkColumn(damping, "damping", true);
+    checkColumn(rest_length, "rest_length", true);
+
+    Objects::SetSprings(endpoints, stiffness, damping, rest_length);
+}
+
+void SimulationWrapper::clear_springs()
+{
+    ensure_initialized();
+    Objects::ClearSprings();
+}
+
+int SimulationWrapper::get_spring_count() const
+{
+    ensure_initialized();
+    return Objects::GetSpringCount();
+}
+
+void SimulationWrapper::set_implicit_springs(bool enabled, int iterations, float tolerance)
+{
+    ensure_initialized();
+    if (iterations < 1) throw std::runtime_error("Implicit spring iterations must be >= 1");
+    if (tolerance < 0.0f) throw std::runtime_error("Implicit spring tolerance must be >= 0");
+    Objects::SetSpringIntegration(enabled, iterations, tolerance);
+}
+
+std::tuple<bool, int, float> SimulationWrapper::get_implicit_springs() const
+{
+    ensure_initialized();
+
+    bool enabled;
+    int iterations;
+    float tolerance;
+    Objects::GetSpringIntegration(enabled, iterations, tolerance);
+
+    return std::make_tuple(enabled, iterations, tolerance);
+}
+
+int SimulationWrapper::add_particle_emitter(int template_index, float rate, float offset_x, float offset_y,
+                                            float velocity_x, float velocity_y, float position_spread, float velocity_spread,
+                                            float lifetime, bool kill_when_transparent, bool kill_outside,
+                                            float bounds_min_x, float bounds_min_y, float bounds_max_x, float bounds_max_y)
+{
+    ensure_initialized();
+
+    if (rate < 0.0f) throw std::runtime_error("Emitter rate must be >= 0");
+    if (position_spread < 0.0f || velocity_spread < 0.0f) throw std::runtime_error("Emitter spreads must be >= 0");
+    if (kill_outside && (bounds_max_x < bounds_min_x || bounds_max_y < bounds_min_y))
+        throw std::runtime_error("Emitter bounds must have max >= min");
+
+    int kill_flags = (kill_outside ? KILL_OUTSIDE_BOUNDS : 0) | (kill_when_transparent ? KILL_TRANSPARENT : 0);
+    int emitter_id = Objects::AddParticleEmitter(template_index, rate, offset_x, offset_y, velocity_x, velocity_y,
+                                                 position_spread, velocity_spread, lifetime, kill_flags,
+                                                 bounds_min_x, bounds_min_y, bounds_max_x, bounds_max_y);
+    if (emitter_id < 0)
+        throw std::runtime_error("Invalid template object or too many emitters (max " +
+                                 std::to_string(MAX_PARTICLE_EMITTERS) + ")");
+    return emitter_id;
+}
+
+void SimulationWrapper::remove_particle_emitter(int emitter_id)
+{
+    ensure_initialized();
+    if (!Objects::RemoveParticleEmitter(emitter_id)) throw std::runtime_error("Invalid emitter ID");
+}
+
+void SimulationWrapper::clear_particle_emitters()
+{
+    ensure_initialized();
+    Objects::ClearParticleEmitters();
+}
+
+int SimulationWrapper::get_particle_emitter_count() const
+{
+    ensure_initialized();
+    return Objects::GetParticleEmitterCount();
+}
+
+// ============================================================================
+// Update simulation physics
+// ============================================================================
+void SimulationWrapper::update(float dt)
+{
+    ensure_initialized();
+    process_commands();
+    if (m_paused) return;
+
+    make_context_current();
+    FRAME_TRACE_ZONE("SimulationWrapper::update");
+    auto updateStart = std::chrono::steady_clock::now();
+
+    // Adaptive steps are sized on the GPU; the host paces them with the last dt it has seen
+    bool adaptive = Objects::IsAdaptiveTimestepActive();
+    float adaptiveDt = m_timestep;
+    float adaptiveTime = m_simulationTime;
+    if (adaptive) Objects::GetAdaptiveTimestepState(adaptiveDt, adaptiveTime);
+
+    const float FIXED_STEP = adaptive ? adaptiveDt : m_timestep;
+    m_stepAccumulator += dt;
+
+    // As many of the owed steps as fit the budget (set_step_budget); the rest carry over as lag
+    int owed = static_cast<int>(std::min(m_stepAccumulator / FIXED_STEP, 1e6f));
+    int stepCount = run_steps(std::min(owed, StepScheduler::StepsAllowed(owed)), FIXED_STEP, adaptive);
+    m_stepAccumulator -= stepCount * FIXED_STEP;
+
+    // Owed time past the lag limit is dropped, so the scene slows down instead of falling further behind
+    float maxLag = StepScheduler::GetMaxLag();
+    if (maxLag > 0.0f && m_stepAccumulator > maxLag)
+    {
+        m_droppedSimulationTime += m_stepAccumulator - maxLag;
+        m_stepAccumulator = maxLag;
+    }
+
+    // What is left of the accumulator is how far the display should be into the next step;
+    // adaptive steps are not known ahead, so they are drawn as they come
+    if (m_renderInterpolation)
+        Objects::SetInterpolationFraction(adaptive ? 1.0f : std::min(m_stepAccumulator / FIXED_STEP, 1.0f));
+
+    // The GPU owns the clock in adaptive mode
+    if (adaptive) Objects::GetAdaptiveTimestepState(adaptiveDt, m_simulationTime);
+
+    finish_steps();
+
+    GpuProfiler::RecordCpu("update",
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - updateStart).count());
+}
+
+// Commands from other threads run on this one, which owns the context
+int SimulationWrapper::process_commands()
+{
+    ensure_initialized();
+    if (m_commands->GetPending() == 0) return 0;
+    make_context_current();
+    FRAME_TRACE_ZONE("SimulationWrapper::process_commands");
+    return m_commands->Drain(*this);
+}
+
+// ============================================================================
+// Fixed steps without the accumulator
+// ============================================================================
+
+// The time update() is owed is left alone, and so is the step budget: exactly n_steps run
+int SimulationWrapper::step(int n_steps)
+{
+    ensure_initialized();
+    if (n_steps < 0) throw std::runtime_error("n_steps must not be negative");
+    process_commands();
+    if (m_paused || n_steps == 0) return 0;
+
+    make_context_current();
+    FRAME_TRACE_ZONE("SimulationWrapper::step");
+    auto stepStart = std::chrono::steady_clock::now();
+
+    bool adaptive = Objects::IsAdaptiveTimestepActive();
+    float adaptiveDt = m_timestep;
+    float adaptiveTime = m_simulationTime;
+    if (adaptive) Objects::GetAdaptiveTimestepState(adaptiveDt, adaptiveTime);
+
+    int stepCount = run_steps(n_steps, adaptive ? adaptiveDt : m_timestep, adaptive);
+    if (m_renderInterpolation) Objects::SetInterpolationFraction(1.0f);
+    if (adaptive) Objects::GetAdaptiveTimestepState(adaptiveDt, m_simulationTime);
+
+    finish_steps();
+
+    GpuProfiler::RecordCpu("step",
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stepStart).count());
+    return stepCount;
+}
+
+// GL objects behind a StepHandle; null once signalled or once the simulation is cleaned up
+struct StepFence
+{
+    GLsync sync = nullptr;
+};
+
+StepHandle::StepHandle(std::shared_ptr<StepFence> fence, int steps)
+    : m_fence(std::move(fence)), m_steps(steps)
+{
+}
+
+StepHandle::~StepHandle()
+{
+    if (m_fence->sync) glDeleteSync(m_fence->sync);
+    m_fence->sync = nullptr;
+}
+
+bool StepHandle::ready()
+{
+    return wait(0.0f);
+}
+
+bool StepHandle::wait(float timeout)
+{
+    if (!m_fence->sync) return true;
+
+    // Flushed once so the fence is sure to signal, then waited on in slices of at most a second
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(std::max(timeout, 0.0f));
+    for (;;)
+    {
+        GLuint64 slice = 0;
+        if (timeout < 0.0f) slice = 1000000000ull;
+        else
+        {
+            auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now()).count();
+            slice = static_cast<GLuint64>(std::min<long long>(std::max<long long>(left, 0), 1000000000ll));
+        }
+        GLenum status = glClientWaitSync(m_fence->sync, flags, slice);
+        flags = 0;
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED) break;
+        if (timeout >= 0.0f && std::chrono::steady_clock::now() >= deadline) return false;
+    }
+    glDeleteSync(m_fence->sync);
+    m_fence->sync = nullptr;
+    return true;
+}
+
+// Same steps as step(), without the error check that waits on the GPU; the handle signals when they are done
+std::unique_ptr<StepHandle> SimulationWrapper::step_async(int n_steps)
+{
+    ensure_initialized();
+    if (n_steps < 0) throw std::runtime_error("n_steps must not be negative");
+    process_commands();
+
+    int stepCount = 0;
+    if (!m_paused && n_steps > 0)
+    {
+        make_context_current();
+        FRAME_TRACE_ZONE("SimulationWrapper::step_async");
+        bool adaptive = Objects::IsAdaptiveTimestepActive();
+        float adaptiveDt = m_timestep;
+        float adaptiveTime = m_simulationTime;
+        if (adaptive) Objects::GetAdaptiveTimestepState(adaptiveDt, adaptiveTime);
+
+        stepCount = run_steps(n_steps, adaptive ? adaptiveDt : m_timestep, adaptive);
+        if (m_renderInterpolation) Objects::SetInterpolationFraction(1.0f);
+        if (adaptive) Objects::GetAdaptiveTimestepState(adaptiveDt, m_simulationTime);
+        finish_steps();
+    }
+
+    auto fence = std::make_shared<StepFence>();
+    fence->sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();  // Start the steps while Python goes on
+
+    m_stepFences.erase(std::remove_if(m_stepFences.begin(), m_stepFences.end(),
+                                      [](const std::weak_ptr<StepFence>& f) { return f.expired(); }),
+                       m_stepFences.end());
+    m_stepFences.push_back(fence);
+    return std::unique_ptr<StepHandle>(new StepHandle(std::move(fence), stepCount));
+}
+
+// ============================================================================
+// The step loop shared by update(), step() and step_async()
+// ============================================================================
+int SimulationWrapper::run_steps(int count, float fixedStep, bool adaptive)
+{
+    // Small scenes step on the CPU, "vulkan" scenes on a Vulkan queue; the GPU buffers get the result after the loop
+    bool hosted = !adaptive && count > 0 && !DomainDecomposition::IsActive();
+    bool vulkan = hosted && use_vulkan_backend();
+    bool cpu = hosted && !vulkan && use_cpu_backend();
+    if (cpu || vulkan)
+    {
+        sync_cpu_mirror();
+        m_cpuMirror->scene.params = Objects::GetSimParams();
+        m_cpuMirror->scene.integrator = Objects::GetIntegrator();
+    }
+    auto stepsStart = std::chrono::steady_clock::now();
+    if (!cpu && !vulkan && count > 0) StepScheduler::BeginSteps();
+
+    int stepCount = 0;
+    while (stepCount < count)
+    {
+        m_simulationTime += fixedStep;
+
+        if (cpu)
+        {
+            m_cpuMirror->scene.params.dt = fixedStep;
+            m_cpuMirror->scene.params.time = m_simulationTime;
+            CpuBackend::Step(m_cpuMirror->scene, m_cpuMirror->equations);
+            stepCount++;
+            continue;
+        }
+
+        if (vulkan)
+        {
+            // Every step in one submission
+            m_cpuMirror->scene.params.dt = fixedStep;
+            m_cpuMirror->scene.params.time = m_simulationTime;
+            std::string error;
+            if (!VulkanBackend::Step(m_cpuMirror->scene, m_cpuMirror->equations, count, error))
+            {
+                m_simulationTime -= fixedStep;
+                throw std::runtime_error(error);
+            }
+            m_simulationTime += (count - 1) * fixedStep;
+            stepCount = count;
+            continue;
+        }
+
+        // Independent objects can integrate every pending step in a single dispatch
+        int pending = count - stepCount;
+        int batch = (m_fuseSubsteps && Objects::CanFuseSubsteps()) ? pending : 1;
+        if (m_historyInterval > 0) batch = std::min(batch, m_historyInterval - m_historySteps);  // Land on every snapshot
+        if (DomainDecomposition::IsActive()) batch = 1;  // The ranks exchange objects after every step
+        int taken = 1;
+
+        if (Objects::GetComputeProgram() && Objects::IsComputeShaderReady())
+        {
+            // Only the clock changes per step; the rest of the block is uploaded when set_parameter changes it
+            SimParams params = Objects::GetSimParams();
+            params.dt = fixedStep;
+            params.time = m_simulationTime;
+            Objects::SetSimParams(params);
+
+            // The steps this call still runs end with the one the next render shows
+            Objects::SetFrameStepsLeft(pending);
+
+            // Run Compute Shader (uTime is the time of the first fused step)
+            taken = std::max(1, Objects::Update(m_currentBuffer, 1 - m_currentBuffer, batch));
+            m_currentBuffer = 1 - m_currentBuffer;
+
+            // Objects that left this rank's slab go to their owner, and the ghosts are refreshed
+            std::string error;
+            if (!DomainDecomposition::Exchange(m_currentBuffer, error)) throw std::runtime_error(error);
+        }
+
+        m_simulationTime += (taken - 1) * fixedStep;
+        stepCount += taken;
+        push_history(taken);
+    }
+
+    if (cpu || vulkan)
+        StepScheduler::AddHostSample(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stepsStart).count(), stepCount);
+    else
+        StepScheduler::EndSteps(stepCount);
+    m_lastUpdateSteps = stepCount;
+
+    if (cpu || vulkan)
+    {
+        Objects::UploadBulkObjects(CpuBackend::Store(m_cpuMirror->scene), 0);
+        m_cpuMirror->revision = Objects::GetSceneRevision();
+        push_history(stepCount);  // Only the state after the loop is on the GPU
+    }
+    if (stepCount > 0) m_steppedBackend = vulkan ? 2 : cpu ? 1 : 0;
+    m_stepsTaken += static_cast<uint64_t>(stepCount);
+    return stepCount;
+}
+
+// A snapshot once every m_historyInterval steps
+void SimulationWrapper::push_history(int steps)
+{
+    if (m_historyInterval <= 0) return;
+    m_historySteps += steps;
+    if (m_historySteps < m_historyInterval) return;
+    m_historySteps = 0;
+    Objects::PushHistory(m_currentBuffer, m_simulationTime);
+}
+
+void SimulationWrapper::finish_steps()
+{
+    if (m_trajectoryWriter) stream_recording(false);
+    if (m_streamServer) broadcast_recording();
+    if (m_sharedFrames) publish_recording();
+    if (m_metricsExporter) publish_metrics(false);
+}
+
+// ============================================================================
+// Render simulation to screen
+// ============================================================================
+void SimulationWrapper::render()
+{
+    if (!m_capture && (m_headless || !m_window)) return;
+
+    make_context_current();
+    EndDeviceMapping();
+
+    // The capture frame is drawn at its own size, then the window gets its own draw
+    if (m_capture)
+    {
+        m_capture->BeginFrame();
+        draw_scene(m_capture->GetWidth(), m_capture->GetHeight());
+        m_capture->EndFrame();
+    }
+    if (m_headless || !m_window) return;
+
+    int w, h;
+    glfwGetFramebufferSize(static_cast<GLFWwindow*>(m_window), &w, &h);
+
+    if (w <= 0 || h <= 0) return;
+
+    draw_scene(w, h);
+
+    // Swap buffers and poll events
+    glfwSwapBuffers(static_cast<GLFWwindow*>(m_window));
+    glfwPollEvents();
+}
+
+void SimulationWrapper::draw_scene(int w, int h)
+{
+    // Set up viewport and clear screen
+    glViewport(0, 0, w, h);
+    glClearColor(0.05f, 0.05f, 0.08f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Calculate camera matrices; a tiled ensemble shows the camera's view in every cell
+    bool tiled = WorldTiles::IsActive();
+    int viewWidth = w, viewHeight = h;
+    if (tiled) WorldTiles::GetCellSize(w, h, viewWidth, viewHeight);
+    glm::mat4 projection = g_camera.GetProjectionMatrix(viewWidth, viewHeight);
+    glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(-g_camera.position, 0.0f));
+    glm::mat4 projView = projection * view;
+
+    // Grid fields lie under everything else
+    if (!tiled) GridFields::Draw(projView);
+
+    // Only render axis if grid is enabled
+    if (m_enable_grid && g_axisInitialized && g_axisShaderProgram && !tiled)
+    {
+        glUseProgram(g_axisShaderProgram);
+        Axis::Update(g_camera, w, h);
+        Axis::Draw(g_axisShaderProgram, projView);
+        glUseProgram(0);
+    }
+
+    // Render physics objects
+    GLuint objectProgram = Objects::GetQuadProgram();
+    if (objectProgram && Objects::IsQuadShaderReady())
+    {
+        glUseProgram(objectProgram);
+
+        // Pass camera matrices to shader
+        GLint projLoc = glGetUniformLocation(objectProgram, "uProjection");
+        GLint viewLoc = glGetUniformLocation(objectProgram, "uView");
+
+        if (projLoc != -1) glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
+        if (viewLoc != -1) glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+
+        if (!tiled) Objects::DrawTrails(projView, m_currentBuffer);
+        if (!tiled) Objects::DrawConstraints(projView, m_currentBuffer);
+        Objects::SetViewBounds(projView);
+        Objects::Draw(m_currentBuffer);
+        glUseProgram(0);
+    }
+    if (!tiled) Objects::DrawForceField(projView, m_currentBuffer);
+}
+
+void SimulationWrapper::start_capture(const std::string& path, int fps, std::tuple<int, int> resolution)
+{
+    ensure_initialized();
+    if (m_capture) stop_capture();
+
+    int width = std::get<0>(resolution), height = std::get<1>(resolution);
+    if (width == 0 && height == 0)
+    {
+        width = m_width;
+        height = m_height;
+    }
+    if (fps < 1) throw std::runtime_error("fps must be at least 1");
+    if (width < 2 || height < 2 || width % 2 || height % 2)
+        throw std::runtime_error("Capture resolution must be even and at least 2x2");
+
+    make_context_current();
+    m_capture.reset(new VideoCapture(path, fps, width, height));
+}
+
+long long SimulationWrapper::stop_capture()
+{
+    ensure_initialized();
+    if (!m_capture) return 0;
+
+    make_context_current();
+    std::unique_ptr<VideoCapture> capture = std::move(m_capture);
+    capture->Close();
+    return capture->FramesWritten();
+}
+
+// ============================================================================
+// COLLISION MANAGEMENT FUNCTIONS
+// ============================================================================
+
+// Throws unless every index names an object
+static void ValidateObjectIndices(const std::vector<int>& indices)
+{
+    int count = Objects::GetNumObjects();
+    for (int index : indices)
+        if (index < 0 || index >= count)
+            throw std::runtime_error("Invalid object index");
+}
+
+// Convert Python shape enum to C++ shape type
+static CollisionShape ToCollisionShape(PyCollisionShape shape)
+{
+    switch (shape)
+    {
+    case PyCollisionShape::NONE:
+        return static_cast<CollisionShape>(0);  // COLLISION_NONE
+    case PyCollisionShape::CIRCLE:
+        return static_cast<CollisionShape>(1);  // COLLISION_CIRCLE
+    case PyCollisionShape::AABB:
+        return static_cast<CollisionShape>(2);  // COLLISION_AABB
+    case PyCollisionShape::POLYGON:
+        return static_cast<CollisionShape>(3);  // COLLISION_POLYGON
+    default:
+        return static_cast<CollisionShape>(0);  // COLLISION_NONE
+    }
+}
+
+static void ValidateCollisionMaterial(float restitution, float friction)
+{
+    if (restitution < 0.0f || restitution > 1.0f)
+        throw std::runtime_error("Restitution must be between 0.0 and 1.0");
+
+    if (friction < 0.0f || friction > 1.0f)
+        throw std::runtime_error("Friction must be between 0.0 and 1.0");
+}
+
+// Enable or disable collisions for a specific object
+void SimulationWrapper::set_collision_enabled(int index, bool enabled)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    Objects::SetCollisionEnabled(index, enabled);
+}
+
+// Set collision shape for an object
+void SimulationWrapper::set_collision_shape(int index, PyCollisionShape shape)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    Objects::SetCollisionShape(index, ToCollisionShape(shape));
+}
+
+// Set collision material properties (restitution and friction)
+void SimulationWrapper::set_collision_properties(int index, float restitution, float friction)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    ValidateCollisionMaterial(restitution, friction);
+    Objects::SetCollisionProperties(index, restitution, friction);
+}
+
+// Batch variants: one validation pass, one collision-property upload
+void SimulationWrapper::batch_set_collision_enabled(const std::vector<int>& indices, bool enabled)
+{
+    ensure_initialized();
+    ValidateObjectIndices(indices);
+    Objects::SetCollisionEnabled(indices, enabled);
+}
+
+void SimulationWrapper::batch_set_collision_shape(const std::vector<int>& indices, PyCollisionShape shape)
+{
+    ensure_initialized();
+    ValidateObjectIndices(indices);
+    Objects::SetCollisionShape(indices, ToCollisionShape(shape));
+}
+
+void SimulationWrapper::batch_set_collision_properties(const std::vector<int>& indices, float restitution, float friction)
+{
+    ensure_initialized();
+    ValidateObjectIndices(indices);
+    ValidateCollisionMaterial(restitution, friction);
+    Objects::SetCollisionProperties(indices, restitution, friction);
+}
+
+void SimulationWrapper::batch_set_collision_filter(const std::vector<int>& indices, unsigned int category, unsigned int mask)
+{
+    ensure_initialized();
+    ValidateObjectIndices(indices);
+    Objects::SetCollisionFilter(indices, category, mask);
+}
+
+void SimulationWrapper::batch_set_continuous_collision(const std::vector<int>& indices, bool enabled)
+{
+    ensure_initialized();
+    ValidateObjectIndices(indices);
+    Objects::SetContinuousCollision(indices, enabled);
+}
+
+// Get current collision configuration for an object
+CollisionConfig SimulationWrapper::get_collision_config(int index)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    // Retrieve collision properties from object system
+    CollisionProperties props = Objects::GetCollisionProperties(index);
+
+    // Convert to Python-friendly configuration
+    CollisionConfig config;
+    config.enabled = (props.enabled == 1);
+    config.restitution = props.restitution;
+    config.friction = props.friction;
+    config.category = props.category;
+    config.mask = props.mask;
+    config.continuous = (props.continuous != 0);
+
+    // Convert shape type to Python enum
+    switch (props.shapeType)
+    {
+    case COLLISION_NONE:
+        config.shape = PyCollisionShape::NONE;
+        break;
+    case COLLISION_CIRCLE:
+        config.shape = PyCollisionShape::CIRCLE;
+        break;
+    case COLLISION_AABB:
+        config.shape = PyCollisionShape::AABB;
+        break;
+    case COLLISION_POLYGON:
+        config.shape = PyCollisionShape::POLYGON;
+        break;
+    default:
+        config.shape = PyCollisionShape::NONE;
+    }
+
+    return config;
+}
+
+// Enable or disable collisions between two specific objects
+void SimulationWrapper::enable_collision_between(int obj1, int obj2, bool enable)
+{
+    ensure_initialized();
+
+    if (obj1 < 0 || obj1 >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object1 index");
+
+    if (obj2 < 0 || obj2 >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object2 index");
+
+    Objects::EnableCollisionBetween(obj1, obj2, enable);
+}
+
+// Set collision category bits and the mask of categories an object collides with
+void SimulationWrapper::set_collision_filter(int index, unsigned int category, unsigned int mask)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    Objects::SetCollisionFilter(index, category, mask);
+}
+
+// Swept collision tests for a fast object, so it cannot pass through thin shapes within a step
+void SimulationWrapper::set_continuous_collision(int index, bool enabled)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    Objects::SetContinuousCollision(index, enabled);
+}
+
+// Check if collisions are enabled for an object
+bool SimulationWrapper::is_collision_enabled(int index)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
 
     return Objects::IsCollisionEnabled(index);
 }
 
+// Static colliders keep their state; dynamic objects collide with them as immovable
+void SimulationWrapper::set_object_static(int index, bool is_static)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    Objects::SetObjectStatic(index, is_static);
+}
+
+bool SimulationWrapper::is_object_static(int index)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    return Objects::IsObjectStatic(index);
+}
+
+int SimulationWrapper::get_static_object_count() const
+{
+    ensure_initialized();
+    return Objects::GetStaticObjectCount();
+}
+
+// Kinematic objects follow table() slots instead of their equation
+void SimulationWrapper::set_object_kinematic(int index, int table_x, int table_y, float period)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+    if (table_x >= LookupTables::MAX_LOOKUP_TABLES || table_y >= LookupTables::MAX_LOOKUP_TABLES)
+        throw std::runtime_error("Table id out of range");
+    if (period < 0.0f)
+        throw std::runtime_error("Period must not be negative");
+
+    Objects::SetObjectKinematic(index, std::max(table_x, -1), std::max(table_y, -1), period);
+}
+
+void SimulationWrapper::set_object_keyframes(int index, const std::vector<std::tuple<float, float, float>>& keyframes,
+                                             int table_x, int table_y, bool loop)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    std::vector<float> times, xs, ys;
+    for (const auto& key : keyframes)
+    {
+        times.push_back(std::get<0>(key));
+        xs.push_back(std::get<1>(key));
+        ys.push_back(std::get<2>(key));
+    }
+    if (loop && (times.empty() || times.front() < 0.0f))
+        throw std::runtime_error("A looped track starts at time 0 or later");
+    if (!Objects::SetObjectKeyframes(index, table_x, table_y, times, xs, ys, loop))
+        throw std::runtime_error("Invalid keyframes: need two or more with increasing times, and table ids in range");
+}
+
+void SimulationWrapper::clear_object_kinematic(int index)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    Objects::ClearObjectKinematic(index);
+}
+
+bool SimulationWrapper::is_object_kinematic(int index)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    return Objects::IsObjectKinematic(index);
+}
+
+int SimulationWrapper::get_kinematic_object_count() const
+{
+    ensure_initialized();
+    return Objects::GetKinematicObjectCount();
+}
+
+void SimulationWrapper::set_sdf_collider(const std::string& expression)
+{
+    ensure_initialized();
+    std::string error;
+    if (!Objects::SetSdfCollider(expression, error)) throw std::runtime_error(error);
+}
+
+void SimulationWrapper::clear_sdf_collider()
+{
+    ensure_initialized();
+    Objects::ClearSdfCollider();
+}
+
+void SimulationWrapper::set_sdf_grid(const std::vector<std::vector<float>>& distances,
+                                     std::tuple<float, float, float, float> box)
+{
+    ensure_initialized();
+
+    if (distances.size() < 2 || distances[0].size() < 2) throw std::runtime_error("SDF grid needs at least 2 x 2 samples");
+    int columns = static_cast<int>(distances[0].size()), rows = static_cast<int>(distances.size());
+    std::vector<float> samples;
+    samples.reserve(static_cast<size_t>(columns) * rows);
+    for (const std::vector<float>& row : distances)
+    {
+        if (static_cast<int>(row.size()) != columns) throw std::runtime_error("SDF grid rows must all have the same length");
+        samples.insert(samples.end(), row.begin(), row.end());
+    }
+    float xMin = std::get<0>(box), yMin = std::get<1>(box);
+    if (!Objects::SetSdfGrid(samples, columns, rows, xMin, xMin + std::get<2>(box), yMin, yMin + std::get<3>(box)))
+        throw std::runtime_error("SDF grid needs a positive box and at most 4096 samples per axis");
+}
+
+void SimulationWrapper::clear_sdf_grid()
+{
+    ensure_initialized();
+    Objects::ClearSdfGrid();
+}
+
+void SimulationWrapper::set_sdf_surface(float restitution, float friction)
+{
+    ensure_initialized();
+    if (restitution < 0.0f || restitution > 1.0f) throw std::runtime_error("Restitution must be in [0, 1]");
+    if (friction < 0.0f) throw std::runtime_error("Friction must be >= 0");
+    Objects::SetSdfSurface(restitution, friction);
+}
+
+// ============================================================================
+// OBJECT MANAGEMENT FUNCTIONS
+// ============================================================================
+
+// The object add_object creates, before it is given a slot
+static Object BuildObject(
+    float x, float y, float vx, float vy,
+    float mass, float charge,
+    float rotation, float angular_velocity,
+    PySkinType skin,
+    float size,
+    float width, float height,
+    float r, float g, float b, float a,
+    int polygon_sides)
+{
+    Object newObject;
+    newObject.position = glm::vec2(x, y);
+    newObject.velocity = glm::vec2(vx, vy);
+    newObject.mass = mass;
+    newObject.charge = charge;
+    newObject.visualSkinType = static_cast<int>(skin);
+    newObject.collisionShapeType = 0; // COLLISION_NONE (will be auto-assigned)
+    newObject.equationID = 0; // Default equation
+    newObject.worldID = 0;
+    newObject.color = glm::vec4(r, g, b, a);
+    newObject.collisionData = glm::vec4(0.0f);
+
+    // Set visualData based on skin type - WITH INTELLIGENT DEFAULTS
+    switch (skin)
+    {
+    case PySkinType::PY_SKIN_CIRCLE:
+        // For circles: size = radius, ignore width/height
+        newObject.visualData = glm::vec4(size, static_cast<float>(polygon_sides), rotation, angular_velocity);
+        break;
+    case PySkinType::PY_SKIN_RECTANGLE:
+        // For rectangles: use width/height directly, ignore size
+        newObject.visualData = glm::vec4(width, height, rotation, angular_velocity);
+        break;
+    case PySkinType::PY_SKIN_POLYGON:
+        // Clamp polygon sides to valid range
+        int minPolySides = 3;
+        int maxPolySides = 12;
+        polygon_sides = (polygon_sides < minPolySides) ? minPolySides :
+            ((polygon_sides > maxPolySides) ? maxPolySides : polygon_sides);
+        // For polygons: size = radius, polygon_sides = number of sides, ignore width/height
+        newObject.visualData = glm::vec4(size, static_cast<float>(polygon_sides), rotation, angular_velocity);
+        break;
+    }
+    return newObject;
+}
+
+// Collision shape auto-assigned from the visual skin
+static PyCollisionShape CollisionShapeForSkin(PySkinType skin)
+{
+    switch (skin)
+    {
+    case PySkinType::PY_SKIN_CIRCLE:
+        return PyCollisionShape::CIRCLE;
+    case PySkinType::PY_SKIN_RECTANGLE:
+        return PyCollisionShape::AABB;
+    case PySkinType::PY_SKIN_POLYGON:
+        return PyCollisionShape::POLYGON;
+    default:
+        return PyCollisionShape::NONE;
+    }
+}
+
+// Add a new physics object to the simulation
+int SimulationWrapper::add_object(
+    float x, float y, float vx, float vy,
+    float mass, float charge,
+    float rotation, float angular_velocity,
+    PySkinType skin,
+    float size,
+    float width, float height,
+    float r, float g, float b, float a,
+    int polygon_sides)
+{
+    ensure_initialized();
+
+    if (Objects::GetNumObjects() >= Objects::MAX_OBJECTS)
+        throw std::runtime_error("Maximum object limit reached");
+
+    // Step 1: Create the object with CORRECT values in local memory FIRST
+    Object newObject = BuildObject(x, y, vx, vy, mass, charge, rotation, angular_velocity, skin,
+                                   size, width, height, r, g, b, a, polygon_sides);
+
+    // Step 2: Allocate slot in Objects system
+    Objects::AddObject();
+    int objectID = Objects::GetNumObjects() - 1;
+
+    // Step 3: IMMEDIATELY overwrite with correct values
+    Objects::UpdateObjectCPU(objectID, newObject);
+
+    // Step 4: Auto-assign collision shape based on visual skin
+    set_collision_shape(objectID, CollisionShapeForSkin(skin));
+    set_collision_enabled(objectID, true);
+    set_collision_properties(objectID, 0.7f, 0.3f); // Default values
+
+    // Step 5: CRITICAL - Force GPU to finish all pending operations
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    glFlush();
+
+    return objectID;
+}
+
+// Add many objects from column arrays with one upload, instead of an add_object call each
+int SimulationWrapper::add_objects(const BulkObjectData& data)
+{
+    ensure_initialized();
+
+    size_t count = data.x.size();
+    const std::vector<float>* columns[] = { &data.x, &data.y, &data.vx, &data.vy, &data.mass, &data.charge,
+                                            &data.rotation, &data.angular_velocity, &data.size, &data.width,
+                                            &data.height, &data.r, &data.g, &data.b, &data.a };
+    for (const std::vector<float>* column : columns)
+    {
+        if (column->size() > 1 && column->size() != count)
+            throw std::runtime_error("add_objects columns must have one value per object or a single value");
+    }
+    if (data.y.empty() && count > 0)
+        throw std::runtime_error("add_objects needs y for every object");
+    if (count == 0) return Objects::GetNumObjects();
+    if (Objects::GetNumObjects() + count > static_cast<size_t>(Objects::MAX_OBJECTS))
+        throw std::runtime_error("Maximum object limit reached");
+
+    auto value = [](const std::vector<float>& column, size_t i, float fallback)
+    {
+        if (column.empty()) return fallback;
+        return column.size() == 1 ? column[0] : column[i];
+    };
+
+    std::vector<Object> objects(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        objects[i] = BuildObject(
+            data.x[i], value(data.y, i, 0.0f), value(data.vx, i, 0.0f), value(data.vy, i, 0.0f),
+            value(data.mass, i, 1.0f), value(data.charge, i, 0.0f),
+            value(data.rotation, i, 0.0f), value(data.angular_velocity, i, 0.0f),
+            data.skin, value(data.size, i, 0.3f), value(data.width, i, 0.5f), value(data.height, i, 0.3f),
+            value(data.r, i, 1.0f), value(data.g, i, 1.0f), value(data.b, i, 1.0f), value(data.a, i, 1.0f),
+            data.polygon_sides);
+    }
+
+    int first = Objects::AddObjects(objects);
+    if (first < 0)
+        throw std::runtime_error("Failed to allocate object buffers");
+
+    std::vector<int> indices(count);
+    std::iota(indices.begin(), indices.end(), first);
+    Objects::SetCollisionShape(indices, ToCollisionShape(CollisionShapeForSkin(data.skin)));
+    Objects::SetCollisionEnabled(indices, true);
+    Objects::SetCollisionProperties(indices, 0.7f, 0.3f); // Default values
+    return first;
+}
+
+static GPUSerializedEquation CompileEquation(const std::string& equation_string, const std::string& derivative_method,
+                                             std::string& key);  // With the equation functions below
+
+// Objects generated on the GPU: one template object, placed and launched by the spawn pass,
+// with the collision defaults of add_objects
+int SimulationWrapper::spawn(const SpawnRequest& request)
+{
+    ensure_initialized();
+
+    if (request.count < 0)
+        throw std::runtime_error("spawn needs a non-negative count");
+    if (Objects::GetNumObjects() + static_cast<long long>(request.count) > Objects::MAX_OBJECTS)
+        throw std::runtime_error("Maximum object limit reached");
+
+    SpawnSettings settings;
+    if (request.distribution == "uniform_disk") settings.distribution = SPAWN_UNIFORM_DISK;
+    else if (request.distribution == "gaussian") settings.distribution = SPAWN_GAUSSIAN;
+    else if (request.distribution == "lattice") settings.distribution = SPAWN_LATTICE;
+    else
+    {
+        settings.distribution = SPAWN_EXPRESSION;
+        settings.positionExpression = request.distribution;
+    }
+    settings.center[0] = request.center[0];
+    settings.center[1] = request.center[1];
+    settings.extent = request.extent;
+    settings.columns = request.columns;
+    settings.seed = request.seed;
+    settings.velocityExpression = request.velocity;
+
+    Object templateObject = BuildObject(
+        0.0f, 0.0f, 0.0f, 0.0f, request.mass, request.charge, 0.0f, 0.0f,
+        request.skin, request.size, request.width, request.height,
+        request.r, request.g, request.b, request.a, request.polygon_sides);
+    if (!request.equation.empty())
+    {
+        std::string key;
+        GPUSerializedEquation eq = CompileEquation(request.equation, request.derivative_method, key);
+        templateObject.equationID = Objects::AddOrGetEquation(key, eq);
+    }
+
+    std::string error;
+    int first = Objects::SpawnObjects(request.count, templateObject, settings, error);
+    if (first < 0)
+        throw std::runtime_error(error);
+
+    std::vector<int> indices(request.count);
+    std::iota(indices.begin(), indices.end(), first);
+    Objects::SetCollisionShape(indices, ToCollisionShape(CollisionShapeForSkin(request.skin)));
+    Objects::SetCollisionEnabled(indices, true);
+    Objects::SetCollisionProperties(indices, 0.7f, 0.3f); // Default values
+    return first;
+}
+
+// Queue an update_object/batch_update write; skin and size are the object's current visualSkinType
+// and visualData.xy, since the size fields it replaces depend on the skin
+static void QueueObjectUpdate(const BatchUpdateData& update, float skin, float sizeY)
+{
+    Object p{};
+    p.position = glm::vec2(update.x, update.y);
+    p.velocity = glm::vec2(update.vx, update.vy);
+    p.mass = update.mass;
+    p.charge = update.charge;
+    p.color = glm::vec4(update.r, update.g, update.b, update.a);
+    unsigned int fields = OBJECT_FIELD_POSITION | OBJECT_FIELD_VELOCITY | OBJECT_FIELD_MASS |
+                          OBJECT_FIELD_CHARGE | OBJECT_FIELD_COLOR;
+
+    int skinType = static_cast<int>(skin);
+    if (skinType == 0 || skinType == 1 || skinType == 2)  // CIRCLE, RECTANGLE, POLYGON
+    {
+        // Circles and polygons: width is the radius; polygons keep their sides (visualData.y)
+        p.visualData = glm::vec4(update.width, (skinType == 1) ? update.height : sizeY,
+                                 update.rotation, update.angular_velocity);
+        fields |= OBJECT_FIELD_SIZE | OBJECT_FIELD_ROTATION | OBJECT_FIELD_ANGULAR_VELOCITY;
+    }
+    Objects::UpdateObjectFields(update.index, fields, p);
+}
+
+// Update properties of an existing object
+void SimulationWrapper::update_object(
+    int index,
+    float x, float y,
+    float vx, float vy,
+    float mass, float charge,
+    float rotation, float angular_velocity,
+    float width, float height,
+    float r, float g, float b, float a)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    // Skin and size, then a queued write of the rest
+    std::vector<float> current;
+    if (!Objects::FetchFields(m_currentBuffer, { index }, OBJECT_FIELD_SIZE | OBJECT_FIELD_SKIN, current))
+        throw std::runtime_error("Invalid object index");
+
+    BatchUpdateData update{ index, x, y, vx, vy, mass, charge, rotation, angular_velocity, width, height, r, g, b, a };
+    QueueObjectUpdate(update, current[2], current[1]);
+}
+
+// Remove an object from the simulation
+void SimulationWrapper::remove_object(int index)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    Objects::RemoveObject(index);
+}
+
+// Remove several objects at once (each index refers to the state before the call)
+void SimulationWrapper::remove_objects(const std::vector<int>& indices)
+{
+    ensure_initialized();
+
+    int count = Objects::GetNumObjects();
+    for (int index : indices)
+        if (index < 0 || index >= count)
+            throw std::runtime_error("Invalid object index");
+
+    Objects::RemoveObjects(indices);
+}
+
+// Get current number of objects in simulation
+int SimulationWrapper::object_count() const
+{
+    ensure_initialized();
+    return Objects::GetNumObjects();
+}
+
+// Stable handle of an object, the i equations name it by in p[i]
+int SimulationWrapper::object_handle(int index) const
+{
+    ensure_initialized();
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+    int handle = Objects::GetObjectHandle(index);
+    if (handle < 0)
+        throw std::runtime_error("Object " + std::to_string(index) + " was spawned on the GPU and has no handle");
+    return handle;
+}
+
+// Current index of the object with a handle, -1 once it has been removed
+int SimulationWrapper::object_index(int handle) const
+{
+    ensure_initialized();
+    return Objects::FindObjectByHandle(handle);
+}
+
+// Objects within radius of each point, one batched GPU query
+std::vector<std::vector<int>> SimulationWrapper::query_radius(const std::vector<std::tuple<float, float>>& points,
+                                                              float radius) const
+{
+    ensure_initialized();
+    if (!(radius >= 0.0f))
+        throw std::runtime_error("Query radius must be non-negative");
+
+    std::vector<glm::vec4> shapes;
+    shapes.reserve(points.size());
+    for (const auto& point : points)
+        shapes.emplace_back(std::get<0>(point), std::get<1>(point), radius, 0.0f);
+
+    std::vector<std::vector<int>> results;
+    Objects::QueryObjects(m_currentBuffer, ObjectQuery::QUERY_RADIUS, shapes, results);
+    return results;
+}
+
+// Objects inside each (min_x, min_y, max_x, max_y) box, one batched GPU query
+std::vector<std::vector<int>> SimulationWrapper::query_aabb(
+    const std::vector<std::tuple<float, float, float, float>>& boxes) const
+{
+    ensure_initialized();
+    std::vector<glm::vec4> shapes;
+    shapes.reserve(boxes.size());
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+        glm::vec4 box(std::get<0>(boxes[i]), std::get<1>(boxes[i]), std::get<2>(boxes[i]), std::get<3>(boxes[i]));
+        if (!(box.x <= box.z && box.y <= box.w))
+            throw std::runtime_error("Box " + std::to_string(i) + " has its minimum above its maximum");
+        shapes.push_back(box);
+    }
+
+    std::vector<std::vector<int>> results;
+    Objects::QueryObjects(m_currentBuffer, ObjectQuery::QUERY_AABB, shapes, results);
+    return results;
+}
+
+// First collision shape along each ray, one batched GPU cast
+std::vector<std::tuple<int, float, float, float>> SimulationWrapper::raycast(
+    const std::vector<std::tuple<float, float>>& origins, const std::vector<std::tuple<float, float>>& dirs,
+    float max_dist) const
+{
+    ensure_initialized();
+    if (origins.size() != dirs.size())
+        throw std::runtime_error("raycast needs one direction per origin");
+    if (!(max_dist >= 0.0f) || std::isinf(max_dist))
+        throw std::runtime_error("Ray distance must be finite and non-negative");
+
+    std::vector<glm::vec4> rays;
+    rays.reserve(origins.size());
+    for (size_t i = 0; i < origins.size(); i++)
+        rays.emplace_back(std::get<0>(origins[i]), std::get<1>(origins[i]), std::get<0>(dirs[i]), std::get<1>(dirs[i]));
+
+    std::vector<RayHit> hits;
+    Objects::RaycastObjects(m_currentBuffer, rays, max_dist, hits);
+
+    std::vector<std::tuple<int, float, float, float>> result;
+    result.reserve(hits.size());
+    for (const RayHit& hit : hits)
+        result.emplace_back(hit.index, hit.distance, hit.normal.x, hit.normal.y);
+    return result;
+}
+
+// Python view of one GPU object record
+static ObjectState ToObjectState(const Object& p)
+{
+    ObjectState state;
+
+    // Extract object properties
+    state.x = p.position.x;
+    state.y = p.position.y;
+    state.vx = p.velocity.x;
+    state.vy = p.velocity.y;
+    state.mass = p.mass;
+    state.charge = p.charge;
+    state.rotation = p.visualData.z;
+    state.angular_velocity = p.visualData.w;
+    state.skin_type = p.visualSkinType;
+
+    // Extract visual properties based on skin type
+    if (p.visualSkinType == 0)  // CIRCLE
+    {
+        state.radius = p.visualData.x;
+        state.width = p.visualData.x * 2.0f;  // diameter
+        state.height = p.visualData.x * 2.0f; // diameter
+        state.polygon_sides = 0;
+    }
+    else if (p.visualSkinType == 1)  // RECTANGLE
+    {
+        state.width = p.visualData.x;
+        state.height = p.visualData.y;
+        state.radius = 0.0f;
+        state.polygon_sides = 0;
+    }
+    else if (p.visualSkinType == 2)  // POLYGON
+    {
+        state.radius = p.visualData.x;
+        state.width = p.visualData.x * 2.0f;  // diameter
+        state.height = p.visualData.x * 2.0f; // diameter
+        state.polygon_sides = static_cast<int>(p.visualData.y);
+    }
+
+    // Extract color
+    state.r = p.color.r;
+    state.g = p.color.g;
+    state.b = p.color.b;
+    state.a = p.color.a;
+
+    return state;
+}
+
+// Get complete state of a specific object
+ObjectState SimulationWrapper::get_object(int index) const
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    std::vector<Object> objects;
+    Objects::FetchToCPU(m_currentBuffer, index, 1, objects);
+
+    if (objects.empty())
+        throw std::runtime_error("Object data corrupted");
+
+    return ToObjectState(objects[0]);
+}
+
+// Set rotation angle of an object
+void SimulationWrapper::set_rotation(int index, float rotation)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    Object p{};
+    p.visualData.z = rotation;
+    Objects::UpdateObjectFields(index, OBJECT_FIELD_ROTATION, p);
+}
+
+// Batch retrieval of multiple objects' states
+std::vector<BatchGetData> SimulationWrapper::batch_get(const std::vector<int>& indices) const {
+    ensure_initialized();
+
+    std::vector<BatchGetData> results;
+    results.reserve(indices.size());
+
+    if (indices.empty()) {
+        return results;
+    }
+
+    for (int index : indices) {
+        if (index < 0 || index >= Objects::GetNumObjects()) {
+            throw std::runtime_error("Invalid object index in batch_get: " + std::to_string(index));
+        }
+    }
+
+    // Only the listed objects cross the bus, gathered field by field
+    std::vector<float> packed;
+    if (!Objects::FetchFields(m_currentBuffer, indices, OBJECT_FIELD_ALL, packed)) {
+        throw std::runtime_error("Invalid object index in batch_get");
+    }
+    const size_t stride = ObjectGather::FloatsPerObject(OBJECT_FIELD_ALL);
+
+    for (size_t k = 0; k < indices.size(); k++) {
+        // Fields in ObjectField bit order
+        const float* f = &packed[k * stride];
+        Object p{};
+        p.position = glm::vec2(f[0], f[1]);
+        p.velocity = glm::vec2(f[2], f[3]);
+        p.mass = f[4];
+        p.charge = f[5];
+        p.visualData = glm::vec4(f[8], f[9], f[6], f[7]);
+        p.color = glm::vec4(f[10], f[11], f[12], f[13]);
+        p.visualSkinType = static_cast<int>(f[14]);
+        BatchGetData data;
+
+        // Extract object properties
+        data.x = p.position.x;
+        data.y = p.position.y;
+        data.vx = p.velocity.x;
+        data.vy = p.velocity.y;
+        data.mass = p.mass;
+        data.charge = p.charge;
+        data.rotation = p.visualData.z;
+        data.angular_velocity = p.visualData.w;
+        data.skin_type = p.visualSkinType;
+
+        // Extract visual properties based on skin type
+        if (p.visualSkinType == 0) { // CIRCLE
+            data.radius = p.visualData.x;
+            data.width = p.visualData.x * 2.0f;
+            data.height = p.visualData.x * 2.0f;
+            data.polygon_sides = 0;
+        }
+        else if (p.visualSkinType == 1) { // RECTANGLE
+            data.width = p.visualData.x;
+            data.height = p.visualData.y;
+            data.radius = 0.0f;
+            data.polygon_sides = 0;
+        }
+        else if (p.visualSkinType == 2) { // POLYGON
+            data.radius = p.visualData.x;
+            data.width = p.visualData.x * 2.0f;
+            data.height = p.visualData.x * 2.0f;
+            data.polygon_sides = static_cast<int>(p.visualData.y);
+        }
+
+        // Extract color
+        data.r = p.color.r;
+        data.g = p.color.g;
+        data.b = p.color.b;
+        data.a = p.color.a;
+
+        results.push_back(data);
+    }
+
+    return results;
+}
+
+// One value over all objects, reduced on the GPU
+float SimulationWrapper::reduce(const std::string& expression, const std::string& op) const
+{
+    ensure_initialized();
+
+    ReductionOp reduction;
+    if (op == "sum") reduction = REDUCE_SUM;
+    else if (op == "min") reduction = REDUCE_MIN;
+    else if (op == "max") reduction = REDUCE_MAX;
+    else if (op == "mean") reduction = REDUCE_MEAN;
+    else throw std::runtime_error("Unknown reduction: " + op + " (use sum, min, max or mean)");
+
+    float result = 0.0f;
+    std::string error;
+    if (!Objects::ReduceObjects(m_currentBuffer, expression, reduction, result, error))
+        throw std::runtime_error("Reduction failed: " + error);
+    return result;
+}
+
+std::vector<float> SimulationWrapper::evaluate(const std::string& expression, const std::vector<std::vector<float>>& columns) const
+{
+    ensure_initialized();
+
+    if (columns.size() != EVAL_COLUMN_COUNT) throw std::runtime_error("evaluate takes " + std::to_string(EVAL_COLUMN_COUNT) + " columns");
+    size_t points = 1;
+    int lengthColumn = -1;
+    for (int c = 0; c < EVAL_COLUMN_COUNT; c++)
+    {
+        size_t size = columns[c].size();
+        if (size <= 1) continue;
+        if (lengthColumn >= 0 && size != points)
+            throw std::runtime_error(std::string("evaluate: ") + GetEvalColumnName(c) + " has " + std::to_string(size) +
+                                     " values but " + GetEvalColumnName(lengthColumn) + " has " + std::to_string(points));
+        points = size;
+        lengthColumn = c;
+    }
+
+    EvalInput inputs[EVAL_COLUMN_COUNT];
+    for (int c = 0; c < EVAL_COLUMN_COUNT; c++)
+    {
+        inputs[c].data = columns[c].data();
+        inputs[c].count = columns[c].size();
+    }
+
+    std::vector<float> results(points);
+    std::string error;
+    if (!Objects::EvaluateExpression(m_currentBuffer, expression, inputs, points, results.data(), error))
+        throw std::runtime_error("Evaluation failed: " + error);
+    return results;
+}
+
+void SimulationWrapper::set_group(const std::string& name, const std::vector<int>& indices)
+{
+    ensure_initialized();
+
+    if (name.empty()) throw std::runtime_error("Group name must not be empty");
+    if (!Objects::SetObjectGroup(name, indices))
+        throw std::runtime_error("Invalid object index, or more than " + std::to_string(MAX_OBJECT_GROUPS) + " groups");
+}
+
+std::vector<int> SimulationWrapper::get_group(const std::string& name) const
+{
+    ensure_initialized();
+    return Objects::GetObjectGroup(name);
+}
+
+void SimulationWrapper::set_aggregate(const std::string& name, const std::string& expression, const std::string& op,
+                                      const std::string& group)
+{
+    ensure_initialized();
+
+    ReductionOp reduction;
+    if (op == "sum") reduction = REDUCE_SUM;
+    else if (op == "min") reduction = REDUCE_MIN;
+    else if (op == "max") reduction = REDUCE_MAX;
+    else if (op == "mean") reduction = REDUCE_MEAN;
+    else throw std::runtime_error("Unknown reduction: " + op + " (use sum, min, max or mean)");
+
+    std::string error;
+    if (!Objects::SetAggregate(name, expression, reduction, group, error))
+        throw std::runtime_error("Aggregate failed: " + error);
+}
+
+void SimulationWrapper::remove_aggregate(const std::string& name)
+{
+    ensure_initialized();
+    Objects::RemoveAggregate(name);
+}
+
+float SimulationWrapper::get_aggregate(const std::string& name) const
+{
+    ensure_initialized();
+
+    float value = 0.0f;
+    if (!Objects::GetAggregate(name, value)) throw std::runtime_error("No aggregate named " + name);
+    return value;
+}
+
+std::vector<uint32_t> SimulationWrapper::histogram(const std::vector<std::string>& expressions,
+                                                   const std::vector<int>& bins, const std::vector<float>& range) const
+{
+    ensure_initialized();
+
+    size_t dims = expressions.size();
+    if (dims < 1 || dims > 2 || bins.size() != dims)
+        throw std::runtime_error("histogram takes one or two expressions with one bin count each");
+    if (!range.empty() && range.size() != 2 * dims)
+        throw std::runtime_error("range must be (min, max) for each expression");
+    for (int b : bins)
+        if (b < 1) throw std::runtime_error("bins must be at least 1");
+    if (static_cast<int64_t>(bins[0]) * bins.back() > (1 << 24)) throw std::runtime_error("At most 2^24 bins");
+
+    // Without a range, each expression's extent as NumPy takes it
+    float bounds[4] = { 0.0f, 1.0f, 0.0f, 1.0f };
+    for (size_t d = 0; d < dims; d++)
+    {
+        float lo = 0.0f, hi = 0.0f;
+        if (range.empty())
+        {
+            if (object_count() > 0)
+            {
+                lo = reduce(expressions[d], "min");
+                hi = reduce(expressions[d], "max");
+            }
+            if (!(hi > lo))
+            {
+                lo -= 0.5f;
+                hi += 0.5f;
+            }
+        }
+        else
+        {
+            lo = range[2 * d];
+            hi = range[2 * d + 1];
+            if (!(hi > lo)) throw std::runtime_error("range max must be greater than min");
+        }
+        bounds[2 * d] = lo;
+        bounds[2 * d + 1] = hi;
+    }
+
+    std::vector<uint32_t> counts;
+    std::string error;
+    if (!Objects::HistogramObjects(m_currentBuffer, expressions[0], dims == 2 ? expressions[1] : std::string(),
+                                   bins[0], dims == 2 ? bins[1] : 1, bounds, counts, error))
+        throw std::runtime_error("Histogram failed: " + error);
+    return counts;
+}
+
 // ============================================================================
-// OBJECT MANAGEMENT FUNCTIONS
+// ASYNC READBACK
 // ============================================================================
 
-// Add a new physics object to the simulation
-int SimulationWrapper::add_object(
-    float x, float y, float vx, float vy,
-    float mass, float charge,
-    float rotation, float angular_velocity,
-    PySkinType skin,
-    float size,
-    float width, float height,
-    float r, float g, float b, float a,
-    int polygon_sides)
+// Per-object fields fetch_async() can return, in the order an empty field list returns them
+static const char* const s_readbackFields[] = {
+    "x", "y", "vx", "vy", "mass", "charge", "rotation", "angular_velocity", "r", "g", "b", "a"
+};
+
+static float ReadbackField(const Object& p, const std::string& field)
 {
-    ensure_initialized();
+    if (field == "x") return p.position.x;
+    if (field == "y") return p.position.y;
+    if (field == "vx") return p.velocity.x;
+    if (field == "vy") return p.velocity.y;
+    if (field == "mass") return p.mass;
+    if (field == "charge") return p.charge;
+    if (field == "rotation") return p.visualData.z;
+    if (field == "angular_velocity") return p.visualData.w;
+    if (field == "r") return p.color.r;
+    if (field == "g") return p.color.g;
+    if (field == "b") return p.color.b;
+    if (field == "a") return p.color.a;
+    return 0.0f;
+}
 
-    if (Objects::GetNumObjects() >= Objects::MAX_OBJECTS)
-        throw std::runtime_error("Maximum object limit reached");
+ReadbackFuture::ReadbackFuture(int handle, std::vector<std::string> fields)
+    : m_handle(handle), m_fields(std::move(fields))
+{
+}
+
+ReadbackFuture::~ReadbackFuture()
+{
+    if (!m_resolved) Objects::ReleaseReadback(m_handle);
+}
+
+bool ReadbackFuture::ready() const
+{
+    return m_resolved || Objects::IsReadbackReady(m_handle);
+}
+
+std::map<std::string, std::vector<float>> ReadbackFuture::result()
+{
+    if (m_resolved) return m_result;
 
-    // Step 1: Create the object with CORRECT values in local memory FIRST
-    Object newObject;
-    newObject.position = glm::vec2(x, y);
-    newObject.velocity = glm::vec2(vx, vy);
-    newObject.mass = mass;
-    newObject.charge = charge;
-    newObject.visualSkinType = static_cast<int>(skin);
-    newObject.collisionShapeType = 0; // COLLISION_NONE (will be auto-assigned)
-    newObject.equationID = 0; // Default equation
-    newObject._pad1 = 0;
-    newObject.color = glm::vec4(r, g, b, a);
-    newObject.collisionData = glm::vec4(0.0f);
+    std::vector<Object> objects;
+    if (!Objects::ResolveReadback(m_handle, objects, true))
+        throw std::runtime_error("Readback is no longer valid (the simulation was cleaned up)");
+    m_resolved = true;
 
-    // Set visualData based on skin type - WITH INTELLIGENT DEFAULTS
-    switch (skin)
+    for (const std::string& field : m_fields)
     {
-    case PySkinType::PY_SKIN_CIRCLE:
-        // For circles: size = radius, ignore width/height
-        newObject.visualData = glm::vec4(size, static_cast<float>(polygon_sides), rotation, angular_velocity);
-        newObject.color = glm::vec4(r, g, b, a);
-        break;
-    case PySkinType::PY_SKIN_RECTANGLE:
-        // For rectangles: use width/height directly, ignore size
-        newObject.visualData = glm::vec4(width, height, rotation, angular_velocity);
-        newObject.color = glm::vec4(r, g, b, a);
-        break;
-    case PySkinType::PY_SKIN_POLYGON:
-        // Clamp polygon sides to valid range
-        int minPolySides = 3;
-        int maxPolySides = 12;
-        polygon_sides = (polygon_sides < minPolySides) ? minPolySides :
-            ((polygon_sides > maxPolySides) ? maxPolySides : polygon_sides);
-        // For polygons: size = radius, polygon_sides = number of sides, ignore width/height
-        newObject.visualData = glm::vec4(size, static_cast<float>(polygon_sides), rotation, angular_velocity);
-        newObject.color = glm::vec4(r, g, b, a);
-        break;
+        std::vector<float>& column = m_result[field];
+        column.reserve(objects.size());
+        for (const Object& p : objects) column.push_back(ReadbackField(p, field));
     }
+    return m_result;
+}
 
-    // Step 2: Allocate slot in Objects system
-    Objects::AddObject();
-    int objectID = Objects::GetNumObjects() - 1;
-
-    // Step 3: IMMEDIATELY overwrite with correct values
-    Objects::UpdateObjectCPU(objectID, newObject);
+// Queue a copy of the current state; the next update() does not wait for it
+std::unique_ptr<ReadbackFuture> SimulationWrapper::fetch_async(const std::vector<std::string>& fields) const
+{
+    ensure_initialized();
 
-    // Step 4: Auto-assign collision shape based on visual skin
-    PyCollisionShape collisionShape;
-    switch (skin)
+    std::vector<std::string> selected = fields;
+    if (selected.empty()) selected.assign(std::begin(s_readbackFields), std::end(s_readbackFields));
+    for (const std::string& field : selected)
     {
-    case PySkinType::PY_SKIN_CIRCLE:
-        collisionShape = PyCollisionShape::CIRCLE;
-        break;
-    case PySkinType::PY_SKIN_RECTANGLE:
-        collisionShape = PyCollisionShape::AABB;
-        break;
-    case PySkinType::PY_SKIN_POLYGON:
-        collisionShape = PyCollisionShape::POLYGON;
-        break;
-    default:
-        collisionShape = PyCollisionShape::NONE;
+        if (std::find(std::begin(s_readbackFields), std::end(s_readbackFields), field) == std::end(s_readbackFields))
+            throw std::runtime_error("Unknown field: " + field);
     }
 
-    // Apply collision configuration
-    set_collision_shape(objectID, collisionShape);
-    set_collision_enabled(objectID, true);
-    set_collision_properties(objectID, 0.7f, 0.3f); // Default values
-
-    // Step 5: CRITICAL - Force GPU to finish all pending operations
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    glFlush();
+    int handle = Objects::BeginReadback(m_currentBuffer);
+    if (handle < 0) throw std::runtime_error("Too many readbacks in flight; resolve some with result() first");
+    return std::unique_ptr<ReadbackFuture>(new ReadbackFuture(handle, std::move(selected)));
+}
 
-    return objectID;
+// ObjectField group of a readback field and its float within the group
+static bool RecordedFieldSlot(const std::string& field, unsigned int& bit, int& component)
+{
+    static const struct { const char* name; unsigned int bit; int component; } slots[] = {
+        { "x", OBJECT_FIELD_POSITION, 0 }, { "y", OBJECT_FIELD_POSITION, 1 },
+        { "vx", OBJECT_FIELD_VELOCITY, 0 }, { "vy", OBJECT_FIELD_VELOCITY, 1 },
+        { "mass", OBJECT_FIELD_MASS, 0 }, { "charge", OBJECT_FIELD_CHARGE, 0 },
+        { "rotation", OBJECT_FIELD_ROTATION, 0 }, { "angular_velocity", OBJECT_FIELD_ANGULAR_VELOCITY, 0 },
+        { "r", OBJECT_FIELD_COLOR, 0 }, { "g", OBJECT_FIELD_COLOR, 1 },
+        { "b", OBJECT_FIELD_COLOR, 2 }, { "a", OBJECT_FIELD_COLOR, 3 },
+    };
+    for (const auto& slot : slots)
+    {
+        if (field != slot.name) continue;
+        bit = slot.bit;
+        component = slot.component;
+        return true;
+    }
+    return false;
 }
 
-// Update properties of an existing object
-void SimulationWrapper::update_object(
-    int index,
-    float x, float y,
-    float vx, float vy,
-    float mass, float charge,
-    float rotation, float angular_velocity,
-    float width, float height,
-    float r, float g, float b, float a)
+void SimulationWrapper::record(const std::vector<std::string>& fields, int every_n_steps, int capacity,
+                               const std::vector<int>& object_indices, const std::string& output_dir,
+                               const std::vector<float>& quantize_box)
 {
     ensure_initialized();
+    if (m_trajectoryWriter) stop_recording();
+    m_streamServer.reset();  // Its viewers were told the old fields and objects
+    m_sharedFrames.reset();  // Its readers were too
+
+    if (every_n_steps < 1) throw std::runtime_error("every_n_steps must be at least 1");
+    if (capacity < 1) throw std::runtime_error("capacity must be at least 1");
+    GatherQuantization quantization;
+    if (!quantize_box.empty())
+    {
+        if (quantize_box.size() != 4 || !(quantize_box[2] > quantize_box[0]) || !(quantize_box[3] > quantize_box[1]))
+            throw std::runtime_error("quantize_box must be (min_x, min_y, max_x, max_y) with max > min");
+        quantization.minX = quantize_box[0];
+        quantization.minY = quantize_box[1];
+        quantization.maxX = quantize_box[2];
+        quantization.maxY = quantize_box[3];
+    }
 
-    if (index < 0 || index >= Objects::GetNumObjects())
-        throw std::runtime_error("Invalid object index");
-
-    std::vector<Object> objects;
-    Objects::FetchToCPU(m_currentBuffer, objects);
-
-    if (index < static_cast<int>(objects.size()))
+    std::vector<std::string> selected = fields;
+    if (selected.empty()) selected.assign(std::begin(s_readbackFields), std::end(s_readbackFields));
+    unsigned int fieldMask = 0;
+    for (const std::string& field : selected)
     {
-        Object& p = objects[index];
-        int skinType = p.visualSkinType;
+        unsigned int bit = 0;
+        int component = 0;
+        if (!RecordedFieldSlot(field, bit, component)) throw std::runtime_error("Unknown field: " + field);
+        fieldMask |= bit;
+    }
+    if (!quantize_box.empty()) fieldMask |= OBJECT_FIELD_QUANTIZED;
 
-        // Update basic properties
-        p.position = glm::vec2(x, y);
-        p.velocity = glm::vec2(vx, vy);
-        p.mass = mass;
-        p.charge = charge;
-        p.color = glm::vec4(r, g, b, a);
+    std::vector<int> objects = object_indices;
+    if (objects.empty())
+    {
+        objects.resize(Objects::GetNumObjects());
+        for (size_t i = 0; i < objects.size(); ++i) objects[i] = static_cast<int>(i);
+    }
+    if (objects.empty()) throw std::runtime_error("No objects to record");
+    for (int index : objects)
+    {
+        if (index < 0 || index >= Objects::GetNumObjects())
+            throw std::runtime_error("Invalid object index");
+    }
 
-        // Update visualData based on current skin type
-        if (skinType == 0)  // CIRCLE
-        {
-            // For circles: width parameter is radius
-            p.visualData.x = width;  // radius
-            p.visualData.z = rotation;
-            p.visualData.w = angular_velocity;
-        }
-        else if (skinType == 1)  // RECTANGLE
+    if (!Objects::StartRecording(objects, fieldMask, every_n_steps, capacity, quantization))
+        throw std::runtime_error("Failed to allocate the recording buffer");
+    if (!output_dir.empty())
+    {
+        try
         {
-            p.visualData.x = width;
-            p.visualData.y = height;
-            p.visualData.z = rotation;
-            p.visualData.w = angular_velocity;
+            m_trajectoryWriter.reset(new TrajectoryWriter(output_dir, selected, objects));
         }
-        else if (skinType == 2)  // POLYGON
+        catch (...)
         {
-            // For polygons: width parameter is radius, preserve sides
-            p.visualData.x = width;  // radius
-            // Keep existing polygon sides (visualData.y)
-            p.visualData.z = rotation;
-            p.visualData.w = angular_velocity;
+            Objects::StopRecording();
+            throw;
         }
-
-        Objects::UpdateObjectCPU(index, p);
     }
+    m_recordFields = std::move(selected);
+    m_recordObjects = std::move(objects);
+    m_recordFieldMask = fieldMask;
+    m_recordCapacity = capacity;
+    m_recordQuantizationBox = quantize_box;
 }
 
-// Remove an object from the simulation
-void SimulationWrapper::remove_object(int index)
+// Frames recorded since record() or the previous download, oldest first
+TrajectoryRecording SimulationWrapper::download_recording()
 {
     ensure_initialized();
+    if (m_trajectoryWriter)
+        throw std::runtime_error("The recording streams to disk; stop_recording() finishes the files");
+    if (m_streamServer)
+        throw std::runtime_error("The recording is being served; stop_stream_server() hands it back");
+    if (m_sharedFrames)
+        throw std::runtime_error("The recording is being shared; stop_shared_frames() hands it back");
+    return collect_recording();
+}
 
-    if (index < 0 || index >= Objects::GetNumObjects())
-        throw std::runtime_error("Invalid object index");
+// Streaming downloads at half a ring, so the GPU never laps the writer between update() calls
+// that take fewer than capacity / 2 frames
+void SimulationWrapper::stream_recording(bool all)
+{
+    int pending = Objects::GetPendingRecordedFrames();
+    if (pending == 0 || (!all && pending * 2 < m_recordCapacity)) return;
+
+    TrajectoryRecording recording = collect_recording();
+    TrajectoryChunk chunk;
+    chunk.values = std::move(recording.values);
+    chunk.steps = std::move(recording.steps);
+    chunk.times = std::move(recording.times);
+    chunk.frames = recording.frames;
+    m_trajectoryWriter->Push(std::move(chunk));
+}
 
-    Objects::RemoveObject(index);
+TrajectoryRecording SimulationWrapper::collect_recording(int newest)
+{
+    RecordedFrames frames;
+    if (!Objects::DownloadRecording(frames, newest)) throw std::runtime_error("Nothing is being recorded; call record() first");
+
+    TrajectoryRecording result;
+    result.fields = m_recordFields;
+    result.objects = m_recordObjects;
+    result.frames = frames.frames;
+    result.dropped = frames.dropped;
+    result.steps = std::move(frames.steps);
+    result.times = std::move(frames.times);
+    result.quantizationBox = m_recordQuantizationBox;
+
+    // Where each requested field sits in the gather packing; quantized positions and
+    // velocities hold both components in one word
+    bool quantized = (frames.fieldMask & OBJECT_FIELD_QUANTIZED) != 0;
+    struct FieldSlot { int word; int component; unsigned int bit; };
+    std::vector<FieldSlot> slots;
+    for (const std::string& field : result.fields)
+    {
+        unsigned int bit = 0;
+        int component = 0;
+        RecordedFieldSlot(field, bit, component);
+        bool packedField = quantized && (bit == OBJECT_FIELD_POSITION || bit == OBJECT_FIELD_VELOCITY);
+        int word = ObjectGather::FloatsPerObject(frames.fieldMask & ((bit - 1) | OBJECT_FIELD_QUANTIZED));
+        slots.push_back({ packedField ? word : word + component, component, packedField ? bit : 0u });
+    }
+
+    const GatherQuantization& box = frames.quantization;
+    const float scale[2] = { (box.maxX - box.minX) / 65535.0f, (box.maxY - box.minY) / 65535.0f };
+    const float origin[2] = { box.minX, box.minY };
+    size_t numFields = slots.size();
+    size_t records = static_cast<size_t>(frames.frames) * frames.objects;
+    result.values.resize(records * numFields);
+    for (size_t r = 0; r < records; ++r)
+    {
+        const uint32_t* packed = frames.words.data() + r * frames.wordsPerObject;
+        for (size_t f = 0; f < numFields; ++f)
+        {
+            const FieldSlot& slot = slots[f];
+            uint32_t word = packed[slot.word];
+            float value;
+            if (slot.bit == OBJECT_FIELD_POSITION)
+                value = origin[slot.component] + static_cast<float>((word >> (16 * slot.component)) & 0xFFFFu) * scale[slot.component];
+            else if (slot.bit == OBJECT_FIELD_VELOCITY)
+                value = glm::unpackHalf2x16(word)[slot.component];
+            else
+                std::memcpy(&value, &word, sizeof(value));
+            result.values[r * numFields + f] = value;
+        }
+    }
+    return result;
 }
 
-// Get current number of objects in simulation
-int SimulationWrapper::object_count() const
+void SimulationWrapper::stop_recording()
 {
     ensure_initialized();
-    return Objects::GetNumObjects();
+
+    // The writer is finished even if the last download fails, so its files get their headers
+    std::unique_ptr<TrajectoryWriter> writer = std::move(m_trajectoryWriter);
+    if (writer && Objects::IsRecording())
+    {
+        m_trajectoryWriter = std::move(writer);
+        try
+        {
+            stream_recording(true);
+        }
+        catch (...)
+        {
+            writer = std::move(m_trajectoryWriter);
+            Objects::StopRecording();
+            writer->Close();
+            throw;
+        }
+        writer = std::move(m_trajectoryWriter);
+    }
+
+    m_streamServer.reset();
+    m_sharedFrames.reset();
+    Objects::StopRecording();
+    m_recordFields.clear();
+    m_recordObjects.clear();
+    m_recordFieldMask = 0;
+    m_recordCapacity = 0;
+    m_recordQuantizationBox.clear();
+    if (writer) writer->Close();
 }
 
-// Get complete state of a specific object
-ObjectState SimulationWrapper::get_object(int index) const
+// ============================================================================
+// Remote viewers
+// ============================================================================
+int SimulationWrapper::start_stream_server(int port, float rate_hz, const std::string& host,
+                                           const std::vector<float>& quantize_box)
 {
     ensure_initialized();
+    if (!Objects::IsRecording()) throw std::runtime_error("Nothing is being recorded; call record() first");
+    if (m_trajectoryWriter) throw std::runtime_error("The recording streams to disk and cannot be served too");
+    if (m_sharedFrames) throw std::runtime_error("The recording is being shared and cannot be served too");
+    if (port < 0 || port > 65535) throw std::runtime_error("port must be in [0, 65535]");
+    if (!(rate_hz > 0.0f)) throw std::runtime_error("rate_hz must be positive");
+
+    // Positions go out as 16-bit fractions of a box: the given one, else the recording's
+    std::vector<float> box = quantize_box.empty() ? m_recordQuantizationBox : quantize_box;
+    bool hasPosition = std::find(m_recordFields.begin(), m_recordFields.end(), "x") != m_recordFields.end() ||
+                       std::find(m_recordFields.begin(), m_recordFields.end(), "y") != m_recordFields.end();
+    if (box.empty() && !hasPosition) box = { 0.0f, 0.0f, 1.0f, 1.0f };
+    if (box.empty()) throw std::runtime_error("Positions need a quantize_box, here or in record()");
+    if (box.size() != 4 || !(box[2] > box[0]) || !(box[3] > box[1]))
+        throw std::runtime_error("quantize_box must be (min_x, min_y, max_x, max_y) with max > min");
+
+    m_streamServer.reset();
+    m_streamServer.reset(new StateStreamServer(host, port, m_recordFields, m_recordObjects, box.data()));
+    m_streamInterval = 1.0 / rate_hz;
+    m_streamLastFrame = std::chrono::steady_clock::now() - std::chrono::hours(1);
+    return m_streamServer->GetPort();
+}
 
-    if (index < 0 || index >= Objects::GetNumObjects())
-        throw std::runtime_error("Invalid object index");
+void SimulationWrapper::stop_stream_server()
+{
+    m_streamServer.reset();
+}
 
-    std::vector<Object> objects;
-    Objects::FetchToCPU(m_currentBuffer, objects);
+std::map<std::string, double> SimulationWrapper::get_stream_server_stats() const
+{
+    if (!m_streamServer) return { { "port", 0 }, { "clients", 0 }, { "frames", 0 }, { "bytes", 0 } };
+    return {
+        { "port", m_streamServer->GetPort() },
+        { "clients", m_streamServer->GetClientCount() },
+        { "frames", static_cast<double>(m_streamServer->FramesSent()) },
+        { "bytes", static_cast<double>(m_streamServer->BytesSent()) },
+    };
+}
 
-    if (index >= static_cast<int>(objects.size()))
-        throw std::runtime_error("Object data corrupted");
+// ============================================================================
+// Metrics for scrapers
+// ============================================================================
+int SimulationWrapper::start_metrics_server(int port, float interval, const std::string& host)
+{
+    ensure_initialized();
+    if (port < 0 || port > 65535) throw std::runtime_error("port must be in [0, 65535]");
+    if (!(interval > 0.0f) || !std::isfinite(interval)) throw std::runtime_error("interval must be a positive number of seconds");
+
+    m_metricsExporter.reset();
+    m_metricsExporter.reset(new MetricsExporter(host, port));
+    m_metricsInterval = interval;
+    m_metricsLastPublish = std::chrono::steady_clock::now();
+    m_metricsLastSteps = m_stepsTaken;
+    m_metricsLastReadback = Objects::GetReadbackBytes();
+    m_metricsLastTime = m_simulationTime;
+
+    // A first page right away; the rates start with the next one
+    make_context_current();
+    publish_metrics(true);
+    return m_metricsExporter->GetPort();
+}
 
-    const Object& p = objects[index];
-    ObjectState state;
+void SimulationWrapper::stop_metrics_server()
+{
+    m_metricsExporter.reset();
+}
 
-    // Extract object properties
-    state.x = p.position.x;
-    state.y = p.position.y;
-    state.vx = p.velocity.x;
-    state.vy = p.velocity.y;
-    state.mass = p.mass;
-    state.charge = p.charge;
-    state.rotation = p.visualData.z;
-    state.angular_velocity = p.visualData.w;
-    state.skin_type = p.visualSkinType;
+long long SimulationWrapper::get_metrics_scrapes() const
+{
+    return m_metricsExporter ? m_metricsExporter->ScrapesServed() : 0;
+}
 
-    // Extract visual properties based on skin type
-    if (p.visualSkinType == 0)  // CIRCLE
-    {
-        state.radius = p.visualData.x;
-        state.width = p.visualData.x * 2.0f;  // diameter
-        state.height = p.visualData.x * 2.0f; // diameter
-        state.polygon_sides = 0;
-    }
-    else if (p.visualSkinType == 1)  // RECTANGLE
+// Rates cover the time since the last page (0 on a forced one); everything else is read as it is now
+void SimulationWrapper::publish_metrics(bool force)
+{
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - m_metricsLastPublish).count();
+    if (!force && elapsed < m_metricsInterval) return;
+
+    uint64_t readbackBytes = Objects::GetReadbackBytes();
+    double rateScale = force ? 0.0 : 1.0 / elapsed;
+    double stepsPerSecond = static_cast<double>(m_stepsTaken - m_metricsLastSteps) * rateScale;
+    double simulatedPerSecond = (m_simulationTime - m_metricsLastTime) * rateScale;
+    double readbackPerSecond = static_cast<double>(readbackBytes - m_metricsLastReadback) * rateScale;
+    if (!force)
     {
-        state.width = p.visualData.x;
-        state.height = p.visualData.y;
-        state.radius = 0.0f;
-        state.polygon_sides = 0;
+        m_metricsLastPublish = now;
+        m_metricsLastSteps = m_stepsTaken;
+        m_metricsLastReadback = readbackBytes;
+        m_metricsLastTime = m_simulationTime;
     }
-    else if (p.visualSkinType == 2)  // POLYGON
+
+    std::map<std::string, double> stepStats = get_step_stats();
+    MetricsPage page;
+    page.Family("stellar_steps_total", "counter", "Simulation steps run");
+    page.Sample("stellar_steps_total", static_cast<double>(m_stepsTaken));
+    page.Family("stellar_steps_per_second", "gauge", "Steps per wall-clock second over the last interval");
+    page.Sample("stellar_steps_per_second", stepsPerSecond);
+    page.Family("stellar_step_milliseconds", "gauge", "Smoothed wall-clock milliseconds per step");
+    page.Sample("stellar_step_milliseconds", StepScheduler::GetStepTime());
+    page.Family("stellar_simulation_time_seconds", "gauge", "Simulated time");
+    page.Sample("stellar_simulation_time_seconds", m_simulationTime);
+    page.Family("stellar_simulated_seconds_per_second", "gauge", "Simulated seconds per wall-clock second over the last interval");
+    page.Sample("stellar_simulated_seconds_per_second", simulatedPerSecond);
+    page.Family("stellar_simulation_lag_seconds", "gauge", "Simulated time update() has been given but not stepped yet");
+    page.Sample("stellar_simulation_lag_seconds", stepStats["lag"]);
+    page.Family("stellar_simulation_dropped_seconds_total", "counter", "Simulated time dropped past the step budget's max_lag");
+    page.Sample("stellar_simulation_dropped_seconds_total", m_droppedSimulationTime);
+
+    page.Family("stellar_gpu_pass_milliseconds", "gauge", "Mean GPU time per pass over the profiler window");
+    for (const GpuProfiler::PassStats& pass : GpuProfiler::GetGpuStats())
+        page.Sample("stellar_gpu_pass_milliseconds", pass.milliseconds, { { "pass", pass.name } });
+    page.Family("stellar_cpu_milliseconds", "gauge", "Mean host time per timed section over the profiler window");
+    for (const GpuProfiler::PassStats& time : GpuProfiler::GetCpuStats())
+        page.Sample("stellar_cpu_milliseconds", time.milliseconds, { { "section", time.name } });
+
+    // Work counters, per step of the last interval read, while set_counters() has them on
+    const PerfCounters::Counts& counts = PerfCounters::GetLatest();
+    if (PerfCounters::IsEnabled() && counts.steps > 0)
     {
-        state.radius = p.visualData.x;
-        state.width = p.visualData.x * 2.0f;  // diameter
-        state.height = p.visualData.x * 2.0f; // diameter
-        state.polygon_sides = static_cast<int>(p.visualData.y);
+        static const char* const names[PerfCounters::PERF_COUNTER_COUNT] = {
+            "tokens", "equations", "pair_tests", "contacts", "constraint_solves", "sanitized"
+        };
+        page.Family("stellar_work_per_step", "gauge", "Work counted by the simulation passes, per step");
+        for (int i = 0; i < PerfCounters::PERF_COUNTER_COUNT; i++)
+            page.Sample("stellar_work_per_step", static_cast<double>(counts.totals[i]) / counts.steps, { { "counter", names[i] } });
     }
 
-    // Extract color
-    state.r = p.color.r;
-    state.g = p.color.g;
-    state.b = p.color.b;
-    state.a = p.color.a;
-
-    return state;
+    int equations = 0;
+    for (const std::string& key : Objects::GetEquationKeys())
+        if (!key.empty()) equations++;
+    page.Family("stellar_objects", "gauge", "Live objects");
+    page.Sample("stellar_objects", Objects::GetNumObjects());
+    page.Family("stellar_object_capacity", "gauge", "Objects the buffers hold before they grow");
+    page.Sample("stellar_object_capacity", Objects::GetObjectCapacity());
+    page.Family("stellar_equations", "gauge", "Registered equations");
+    page.Sample("stellar_equations", equations);
+
+    std::vector<Objects::MemoryEntry> entries;
+    Objects::GetMemoryReport(entries);
+    page.Family("stellar_memory_capacity_bytes", "gauge", "Bytes allocated per buffer or host structure");
+    for (const Objects::MemoryEntry& entry : entries)
+        page.Sample("stellar_memory_capacity_bytes", static_cast<double>(entry.capacityBytes),
+                    { { "buffer", entry.name }, { "location", entry.gpu ? "gpu" : "host" } });
+    page.Family("stellar_memory_used_bytes", "gauge", "Bytes in use per buffer or host structure");
+    for (const Objects::MemoryEntry& entry : entries)
+        page.Sample("stellar_memory_used_bytes", static_cast<double>(entry.usedBytes),
+                    { { "buffer", entry.name }, { "location", entry.gpu ? "gpu" : "host" } });
+
+    page.Family("stellar_readback_bytes_total", "counter", "Bytes of object state copied toward the host");
+    page.Sample("stellar_readback_bytes_total", static_cast<double>(readbackBytes));
+    page.Family("stellar_readback_bytes_per_second", "gauge", "Readback bandwidth over the last interval");
+    page.Sample("stellar_readback_bytes_per_second", readbackPerSecond);
+
+    m_metricsExporter->Publish(page.Text());
 }
 
-// Set rotation angle of an object
-void SimulationWrapper::set_rotation(int index, float rotation)
+// ============================================================================
+// Shared-memory frames for other processes
+// ============================================================================
+void SimulationWrapper::start_shared_frames(const std::string& name, int slots)
 {
     ensure_initialized();
+    if (!Objects::IsRecording()) throw std::runtime_error("Nothing is being recorded; call record() first");
+    if (m_trajectoryWriter) throw std::runtime_error("The recording streams to disk and cannot be shared too");
+    if (m_streamServer) throw std::runtime_error("The recording is being served and cannot be shared too");
+
+    // Frames recorded before the readers could see the ring are not published
+    m_sharedFrames.reset();
+    if (Objects::GetPendingRecordedFrames() > 0) collect_recording();
+    m_sharedFrames.reset(new SharedFrameWriter(name, slots, m_recordFields, m_recordObjects));
+}
 
-    if (index < 0 || index >= Objects::GetNumObjects())
-        throw std::runtime_error("Invalid object index");
+void SimulationWrapper::stop_shared_frames()
+{
+    m_sharedFrames.reset();
+}
 
-    std::vector<Object> objects;
-    Objects::FetchToCPU(m_currentBuffer, objects);
+long long SimulationWrapper::get_shared_frame_count() const
+{
+    return m_sharedFrames ? m_sharedFrames->FramesPublished() : 0;
+}
 
-    if (index < static_cast<int>(objects.size()))
+// ============================================================================
+// Domain decomposition across MPI ranks
+// ============================================================================
+void SimulationWrapper::start_domain_decomposition(float halo, std::tuple<float, float> x_range)
+{
+    ensure_initialized();
+    make_context_current();
+
+    // No range: the world box, wrapped like the box is
+    BoundaryMode mode;
+    glm::vec2 worldMin, worldMax;
+    Objects::GetWorldBounds(mode, worldMin, worldMax);
+    float minX = std::get<0>(x_range);
+    float maxX = std::get<1>(x_range);
+    if (!(maxX > minX))
     {
-        Object& p = objects[index];
-        p.visualData.z = rotation;
-        Objects::UpdateObjectCPU(index, p);
+        minX = worldMin.x;
+        maxX = worldMax.x;
     }
+
+    std::string error;
+    if (!DomainDecomposition::Start(minX, maxX, halo, mode == BOUNDARY_PERIODIC, error))
+        throw std::runtime_error(error);
 }
 
-// Batch retrieval of multiple objects' states
-std::vector<BatchGetData> SimulationWrapper::batch_get(const std::vector<int>& indices) const {
+void SimulationWrapper::stop_domain_decomposition()
+{
     ensure_initialized();
+    make_context_current();
+    DomainDecomposition::Stop();
+}
 
-    std::vector<BatchGetData> results;
-    results.reserve(indices.size());
+std::map<std::string, double> SimulationWrapper::get_domain_stats() const
+{
+    DomainDecomposition::Stats stats = DomainDecomposition::GetStats();
+    return {
+        { "active", DomainDecomposition::IsActive() ? 1.0 : 0.0 },
+        { "rank", static_cast<double>(stats.rank) },
+        { "ranks", static_cast<double>(stats.ranks) },
+        { "slab_min", static_cast<double>(stats.slabMin) },
+        { "slab_max", static_cast<double>(stats.slabMax) },
+        { "local_objects", static_cast<double>(stats.localObjects) },
+        { "ghost_objects", static_cast<double>(stats.ghostObjects) },
+        { "migrated_in", static_cast<double>(stats.migratedIn) },
+        { "migrated_out", static_cast<double>(stats.migratedOut) },
+        { "exchanges", static_cast<double>(stats.exchanges) },
+    };
+}
 
-    if (indices.empty()) {
-        return results;
-    }
+// Hard disks from event to event on the host, then the state goes back to both buffers
+std::map<std::string, double> SimulationWrapper::advance_event_driven(float duration, float collapse_time,
+                                                                      long long max_events)
+{
+    ensure_initialized();
+    if (!(duration >= 0.0f)) throw std::runtime_error("Duration must be >= 0");
+    if (!(collapse_time >= 0.0f)) throw std::runtime_error("collapse_time must be >= 0");
+    if (DomainDecomposition::IsActive())
+        throw std::runtime_error("Event-driven steps cannot run while the world is split into domains");
+    make_context_current();
 
-    // Fetch ALL objects at once (more efficient than per-object fetches)
-    std::vector<Object> allObjects;
-    Objects::FetchToCPU(m_currentBuffer, allObjects);
+    int numObjects = Objects::GetNumObjects();
+    std::vector<Object> objects;
+    Objects::FetchToCPU(m_currentBuffer, 0, numObjects, objects);
+    std::vector<CollisionProperties> collisions(objects.size());
+    std::vector<bool> immovable(objects.size());
+    for (int i = 0; i < static_cast<int>(objects.size()); i++)
+    {
+        collisions[i] = Objects::GetCollisionProperties(i);
+        immovable[i] = Objects::IsObjectStatic(i);
+    }
 
-    for (int index : indices) {
-        if (index < 0 || index >= static_cast<int>(allObjects.size())) {
-            throw std::runtime_error("Invalid object index in batch_get: " + std::to_string(index));
-        }
+    EventDriven::Settings settings;
+    Objects::GetWorldBounds(settings.boundary, settings.worldMin, settings.worldMax);
+    settings.wallRestitution = Objects::GetSimParams().restitution;
+    settings.collapseTime = collapse_time;
+    settings.maxEvents = std::max(0LL, max_events);
+
+    EventDriven::Stats stats = EventDriven::Advance(objects, collisions, immovable, duration, settings);
+    if (!objects.empty()) Objects::UploadBulkObjects(objects, 0);
+    m_simulationTime += duration;
+
+    return {
+        { "collisions", static_cast<double>(stats.collisions) },
+        { "wall_hits", static_cast<double>(stats.wallHits) },
+        { "cell_crossings", static_cast<double>(stats.cellCrossings) },
+        { "stale_events", static_cast<double>(stats.staleEvents) },
+        { "worlds", static_cast<double>(stats.worlds) },
+        { "truncated", stats.truncated ? 1.0 : 0.0 },
+    };
+}
 
-        const Object& p = allObjects[index];
-        BatchGetData data;
+// Every frame goes out, oldest first, so readers that keep up see each one
+void SimulationWrapper::publish_recording()
+{
+    if (Objects::GetPendingRecordedFrames() == 0) return;
 
-        // Extract object properties
-        data.x = p.position.x;
-        data.y = p.position.y;
-        data.vx = p.velocity.x;
-        data.vy = p.velocity.y;
-        data.mass = p.mass;
-        data.charge = p.charge;
-        data.rotation = p.visualData.z;
-        data.angular_velocity = p.visualData.w;
-        data.skin_type = p.visualSkinType;
+    TrajectoryRecording recording = collect_recording();
+    size_t frameValues = recording.frames > 0 ? recording.values.size() / recording.frames : 0;
+    for (int f = 0; f < recording.frames; f++)
+        m_sharedFrames->Publish(recording.values.data() + f * frameValues, recording.steps[f], recording.times[f]);
+}
 
-        // Extract visual properties based on skin type
-        if (p.visualSkinType == 0) { // CIRCLE
-            data.radius = p.visualData.x;
-            data.width = p.visualData.x * 2.0f;
-            data.height = p.visualData.x * 2.0f;
-            data.polygon_sides = 0;
-        }
-        else if (p.visualSkinType == 1) { // RECTANGLE
-            data.width = p.visualData.x;
-            data.height = p.visualData.y;
-            data.radius = 0.0f;
-            data.polygon_sides = 0;
-        }
-        else if (p.visualSkinType == 2) { // POLYGON
-            data.radius = p.visualData.x;
-            data.width = p.visualData.x * 2.0f;
-            data.height = p.visualData.x * 2.0f;
-            data.polygon_sides = static_cast<int>(p.visualData.y);
-        }
+// ============================================================================
+// Zero-copy device access
+// ============================================================================
+static bool DeviceFieldLayout(const std::string& field, size_t& offset, int& components)
+{
+    static const struct { const char* name; size_t offset; int components; } layouts[] = {
+        { "position", offsetof(Object, position), 2 }, { "velocity", offsetof(Object, velocity), 2 },
+        { "x", offsetof(Object, position), 1 }, { "y", offsetof(Object, position) + 4, 1 },
+        { "vx", offsetof(Object, velocity), 1 }, { "vy", offsetof(Object, velocity) + 4, 1 },
+        { "mass", offsetof(Object, mass), 1 }, { "charge", offsetof(Object, charge), 1 },
+        { "rotation", offsetof(Object, visualData) + 8, 1 }, { "angular_velocity", offsetof(Object, visualData) + 12, 1 },
+        { "color", offsetof(Object, color), 4 },
+        { "r", offsetof(Object, color), 1 }, { "g", offsetof(Object, color) + 4, 1 },
+        { "b", offsetof(Object, color) + 8, 1 }, { "a", offsetof(Object, color) + 12, 1 },
+    };
+    for (const auto& layout : layouts)
+    {
+        if (field != layout.name) continue;
+        offset = layout.offset;
+        components = layout.components;
+        return true;
+    }
+    return false;
+}
 
-        // Extract color
-        data.r = p.color.r;
-        data.g = p.color.g;
-        data.b = p.color.b;
-        data.a = p.color.a;
+DeviceFieldView SimulationWrapper::map_device_field(const std::string& field)
+{
+    // Not ensure_initialized(): fields mapped earlier stay valid alongside this one
+    if (!m_initialized) throw std::runtime_error("Simulation not initialized");
+
+    size_t offset = 0;
+    DeviceFieldView view;
+    if (!DeviceFieldLayout(field, offset, view.components)) throw std::runtime_error("Unknown field: " + field);
+
+    make_context_current();
+    if (!CudaInterop::IsMapped()) Objects::FlushObjectWrites();
+    std::string error;
+    size_t bytes = static_cast<size_t>(Objects::GetObjectCapacity()) * sizeof(Object);
+    void* base = CudaInterop::Map(Objects::GetObjectBuffer(m_currentBuffer), bytes, view.device, error);
+    if (!base) throw std::runtime_error(error);
+
+    view.data = static_cast<char*>(base) + offset;
+    view.count = Objects::GetNumObjects();
+    view.stride = static_cast<int>(sizeof(Object) / sizeof(float));
+    return view;
+}
 
-        results.push_back(data);
-    }
+void SimulationWrapper::release_device_mapping()
+{
+    if (!m_initialized) return;
+    make_context_current();
+    EndDeviceMapping();
+}
 
-    return results;
+// Only the newest frame is read back, once per interval however many viewers there are
+void SimulationWrapper::broadcast_recording()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<double>(now - m_streamLastFrame).count() < m_streamInterval) return;
+    if (Objects::GetPendingRecordedFrames() == 0) return;
+    m_streamLastFrame = now;
+
+    TrajectoryRecording recording = collect_recording(1);
+    StreamFrame frame;
+    frame.values = std::move(recording.values);
+    frame.step = recording.steps.back();
+    frame.time = recording.times.back();
+    m_streamServer->Push(std::move(frame));
+}
+
+static_assert(sizeof(Object) == OBJECT_RECORD_BYTES, "OBJECT_RECORD_BYTES must match Object");
+
+// Copy the current state into the buffer the state_view() arrays alias
+int SimulationWrapper::sync()
+{
+    ensure_initialized();
+
+    // A grown simulation gets a new buffer; arrays over the old one keep its last contents
+    size_t capacityBytes = static_cast<size_t>(Objects::GetObjectCapacity()) * sizeof(Object);
+    if (!m_stateView || m_stateView->records.size() < capacityBytes)
+    {
+        m_stateView = std::make_shared<StateView>();
+        m_stateView->records.resize(capacityBytes);
+    }
+    m_stateView->count = Objects::FetchToCPU(m_currentBuffer, reinterpret_cast<Object*>(m_stateView->records.data()));
+    return m_stateView->count;
 }
 
 // Batch update of multiple objects' properties
@@ -1003,54 +3481,23 @@ void SimulationWrapper::batch_update(const std::vector<BatchUpdateData>& updates
         return;
     }
 
-    // Fetch current objects
-    std::vector<Object> objects;
-    Objects::FetchToCPU(m_currentBuffer, objects);
-
-    // Apply all updates
-    for (const auto& update : updates) {
-        int index = update.index;
+    // Skin and size of every updated object in one gather
+    std::vector<int> indices;
+    indices.reserve(updates.size());
+    for (const auto& update : updates) indices.push_back(update.index);
 
-        if (index < 0 || index >= static_cast<int>(objects.size())) {
-            throw std::runtime_error("Invalid object index in batch_update: " + std::to_string(index));
+    std::vector<float> current;
+    if (!Objects::FetchFields(m_currentBuffer, indices, OBJECT_FIELD_SIZE | OBJECT_FIELD_SKIN, current)) {
+        for (int index : indices) {
+            if (index < 0 || index >= Objects::GetNumObjects())
+                throw std::runtime_error("Invalid object index in batch_update: " + std::to_string(index));
         }
-
-        Object& p = objects[index];
-        int skinType = p.visualSkinType;
-
-        // Update basic properties
-        p.position = glm::vec2(update.x, update.y);
-        p.velocity = glm::vec2(update.vx, update.vy);
-        p.mass = update.mass;
-        p.charge = update.charge;
-        p.color = glm::vec4(update.r, update.g, update.b, update.a);
-
-        // Update visualData based on current skin type
-        if (skinType == 0) { // CIRCLE
-            p.visualData.x = update.width;  // radius
-            p.visualData.z = update.rotation;
-            p.visualData.w = update.angular_velocity;
-        }
-        else if (skinType == 1) { // RECTANGLE
-            p.visualData.x = update.width;
-            p.visualData.y = update.height;
-            p.visualData.z = update.rotation;
-            p.visualData.w = update.angular_velocity;
-        }
-        else if (skinType == 2) { // POLYGON
-            p.visualData.x = update.width;  // radius
-            // Keep existing polygon sides (don't update from BatchUpdateData)
-            p.visualData.z = update.rotation;
-            p.visualData.w = update.angular_velocity;
-        }
-
-        // Update the object in GPU memory
-        Objects::UpdateObjectCPU(index, p);
     }
 
-    // Ensure GPU synchronization
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    glFlush();
+    // Queued writes; the next update() applies them all in one upload
+    for (size_t i = 0; i < updates.size(); i++) {
+        QueueObjectUpdate(updates[i], current[i * 3 + 2], current[i * 3 + 1]);
+    }
 }
 
 // Set angular velocity of an object
@@ -1061,15 +3508,9 @@ void SimulationWrapper::set_angular_velocity(int index, float angular_velocity)
     if (index < 0 || index >= Objects::GetNumObjects())
         throw std::runtime_error("Invalid object index");
 
-    std::vector<Object> objects;
-    Objects::FetchToCPU(m_currentBuffer, objects);
-
-    if (index < static_cast<int>(objects.size()))
-    {
-        Object& p = objects[index];
-        p.visualData.w = angular_velocity;
-        Objects::UpdateObjectCPU(index, p);
-    }
+    Object p{};
+    p.visualData.w = angular_velocity;
+    Objects::UpdateObjectFields(index, OBJECT_FIELD_ANGULAR_VELOCITY, p);
 }
 
 // Set dimensions of an object (width/height for rectangles, radius for circles/polygons)
@@ -1081,11 +3522,11 @@ void SimulationWrapper::set_dimensions(int index, float width, float height)
         throw std::runtime_error("Invalid object index");
 
     std::vector<Object> objects;
-    Objects::FetchToCPU(m_currentBuffer, objects);
+    Objects::FetchToCPU(m_currentBuffer, index, 1, objects);
 
-    if (index < static_cast<int>(objects.size()))
+    if (!objects.empty())
     {
-        Object& p = objects[index];
+        Object& p = objects[0];
         int skinType = p.visualSkinType;
 
         if (skinType == 1)  // RECTANGLE
@@ -1116,11 +3557,11 @@ void SimulationWrapper::set_radius(int index, float radius)
         throw std::runtime_error("Invalid object index");
 
     std::vector<Object> objects;
-    Objects::FetchToCPU(m_currentBuffer, objects);
+    Objects::FetchToCPU(m_currentBuffer, index, 1, objects);
 
-    if (index < static_cast<int>(objects.size()))
+    if (!objects.empty())
     {
-        Object& p = objects[index];
+        Object& p = objects[0];
         int skinType = p.visualSkinType;
 
         if (skinType == 0 || skinType == 2)  // CIRCLE or POLYGON
@@ -1150,11 +3591,9 @@ float SimulationWrapper::get_rotation(int index) const
     if (index < 0 || index >= Objects::GetNumObjects())
         throw std::runtime_error("Invalid object index");
 
-    std::vector<Object> objects;
-    Objects::FetchToCPU(m_currentBuffer, objects);
-
-    if (index < static_cast<int>(objects.size()))
-        return objects[index].visualData.z;
+    std::vector<float> value;
+    if (Objects::FetchFields(m_currentBuffer, { index }, OBJECT_FIELD_ROTATION, value) && !value.empty())
+        return value[0];
 
     return 0.0f;
 }
@@ -1167,33 +3606,136 @@ float SimulationWrapper::get_angular_velocity(int index) const
     if (index < 0 || index >= Objects::GetNumObjects())
         throw std::runtime_error("Invalid object index");
 
-    std::vector<Object> objects;
-    Objects::FetchToCPU(m_currentBuffer, objects);
-
-    if (index < static_cast<int>(objects.size()))
-        return objects[index].visualData.w;
+    std::vector<float> value;
+    if (Objects::FetchFields(m_currentBuffer, { index }, OBJECT_FIELD_ANGULAR_VELOCITY, value) && !value.empty())
+        return value[0];
 
     return 0.0f;
 }
 
+// Set equation parameters $first.. of an object
+void SimulationWrapper::set_parameters(int index, const std::vector<float>& values, int first)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+    if (first < 0 || first + static_cast<int>(values.size()) > OBJECT_PARAM_COUNT)
+        throw std::runtime_error("Parameters must fit in $0..$" + std::to_string(OBJECT_PARAM_COUNT - 1));
+
+    Objects::SetObjectParameters(index, values.data(), static_cast<int>(values.size()), first);
+}
+
+// All equation parameters of an object
+std::vector<float> SimulationWrapper::get_parameters(int index) const
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    std::vector<float> values(OBJECT_PARAM_COUNT, 0.0f);
+    Objects::GetObjectParameters(index, values.data());
+    return values;
+}
+
+// Set state registers s<first>.. of an object
+void SimulationWrapper::set_state(int index, const std::vector<float>& values, int first)
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+    if (first < 0 || first + static_cast<int>(values.size()) > STATE_REGISTER_COUNT)
+        throw std::runtime_error("State must fit in s0..s" + std::to_string(STATE_REGISTER_COUNT - 1));
+
+    Objects::SetStateRegisters(index, values.data(), static_cast<int>(values.size()), first);
+}
+
+// All state registers of an object
+std::vector<float> SimulationWrapper::get_state(int index) const
+{
+    ensure_initialized();
+
+    if (index < 0 || index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    std::vector<float> values(STATE_REGISTER_COUNT, 0.0f);
+    Objects::GetStateRegisters(index, values.data());
+    return values;
+}
+
+// Parameters whose forward sensitivities the integration carries; tangents restart at 0
+void SimulationWrapper::set_sensitivities(const std::vector<std::string>& parameters)
+{
+    ensure_initialized();
+
+    if (parameters.size() > static_cast<size_t>(MAX_SENSITIVITY_PARAMETERS))
+        throw std::runtime_error("At most " + std::to_string(MAX_SENSITIVITY_PARAMETERS) + " sensitivity parameters");
+
+    std::vector<int> hashes;
+    for (const std::string& name : parameters)
+    {
+        int hash = ObjectSensitivity::ParameterHash(name);
+        if (hash < 0)
+            throw std::runtime_error("Cannot differentiate with respect to '" + name +
+                                     "' (use $0..$7, k, damping, gravity, coupling, freq, amp, mass or charge)");
+        if (std::find(hashes.begin(), hashes.end(), hash) != hashes.end())
+            throw std::runtime_error("Sensitivity parameter '" + name + "' is listed twice");
+        hashes.push_back(hash);
+    }
+
+    Objects::SetSensitivityParameters(hashes);
+    m_sensitivityParameters = parameters;
+}
+
+void SimulationWrapper::reset_sensitivities()
+{
+    ensure_initialized();
+    Objects::ResetSensitivities();
+}
+
+// (dx, dy, dvx, dvy) per object and parameter, object-major
+std::vector<float> SimulationWrapper::get_sensitivities() const
+{
+    ensure_initialized();
+
+    std::vector<float> values;
+    Objects::GetSensitivities(values);
+    return values;
+}
+
 // ============================================================================
 // EQUATION AND CONSTRAINT FUNCTIONS
 // ============================================================================
 
-// Set physics equation for an object
-void SimulationWrapper::set_equation(int object_index, const std::string& equation_string)
+static DerivativeMethod ParseDerivativeMethod(const std::string& derivative_method)
 {
-    ensure_initialized();
+    if (derivative_method == "symbolic") return DERIV_METHOD_SYMBOLIC;
+    if (derivative_method == "dual") return DERIV_METHOD_DUAL;
+    if (derivative_method == "numerical") return DERIV_METHOD_NUMERICAL;
+    throw std::runtime_error("Unknown derivative method: " + derivative_method);
+}
 
-    if (object_index < 0 || object_index >= Objects::GetNumObjects())
-        throw std::runtime_error("Invalid object index");
+// Key an equation is registered under: the same string parsed with another method is a different program
+static std::string EquationKey(const std::string& equation_string, const std::string& derivative_method)
+{
+    return (ParseDerivativeMethod(derivative_method) == DERIV_METHOD_SYMBOLIC)
+        ? equation_string : "[" + derivative_method + "] " + equation_string;
+}
 
+// Parse an equation for set_equation; key is what it is registered under
+static ParsedEquation ParseEquationWithMethod(const std::string& equation_string, const std::string& derivative_method,
+                                              std::string& key)
+{
+    DerivativeMethod method = ParseDerivativeMethod(derivative_method);
     try
     {
-        // Parse and apply equation
         ParserContext context;
+        context.setDerivativeMethod(method);
         ParsedEquation eq = ParseEquation(equation_string, context);
-        Objects::SetEquation(equation_string, eq, object_index);
+        key = EquationKey(equation_string, derivative_method);
+        return eq;
     }
     catch (const std::exception& e)
     {
@@ -1201,6 +3743,290 @@ void SimulationWrapper::set_equation(int object_index, const std::string& equati
     }
 }
 
+// Serialized form of an equation for set_equation: nothing for a key registered already, else
+// from the equation cache or parsed (and then cached). Safe on several threads at once.
+static GPUSerializedEquation CompileEquation(const std::string& equation_string, const std::string& derivative_method,
+                                             std::string& key)
+{
+    key = EquationKey(equation_string, derivative_method);
+    GPUSerializedEquation serialized;
+    if (Objects::HasEquation(key) || EquationCache::Load(key, serialized)) return serialized;
+
+    std::string parsedKey;
+    serialized = serializeEquationForGPU(ParseEquationWithMethod(equation_string, derivative_method, parsedKey));
+    EquationCache::Store(key, serialized);
+    return serialized;
+}
+
+// Set physics equation for an object
+void SimulationWrapper::set_equation(int object_index, const std::string& equation_string,
+                                     const std::string& derivative_method)
+{
+    ensure_initialized();
+
+    if (object_index < 0 || object_index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    std::string key;
+    GPUSerializedEquation eq = CompileEquation(equation_string, derivative_method, key);
+    Objects::SetEquation(key, eq, object_index);
+}
+
+// One equation for many objects, parsed and registered once
+void SimulationWrapper::batch_set_equation(const std::vector<int>& indices, const std::string& equation_string,
+                                           const std::string& derivative_method)
+{
+    ensure_initialized();
+    ValidateObjectIndices(indices);
+
+    std::string key;
+    GPUSerializedEquation eq = CompileEquation(equation_string, derivative_method, key);
+    Objects::SetEquation(key, eq, indices);
+}
+
+// A different equation per object: each distinct string is compiled once, on the CPU pool,
+// and the new ones reach the GPU in one upload per buffer
+void SimulationWrapper::set_equations(const std::vector<int>& indices, const std::vector<std::string>& equation_strings,
+                                      const std::string& derivative_method)
+{
+    ensure_initialized();
+    if (indices.size() != equation_strings.size())
+        throw std::runtime_error("set_equations needs one equation string per index");
+    ValidateObjectIndices(indices);
+
+    std::vector<std::string> distinct;
+    std::vector<int> objectEquations(indices.size());
+    std::unordered_map<std::string, int> distinctIndex;
+    for (size_t k = 0; k < equation_strings.size(); ++k)
+    {
+        auto inserted = distinctIndex.emplace(equation_strings[k], static_cast<int>(distinct.size()));
+        if (inserted.second) distinct.push_back(equation_strings[k]);
+        objectEquations[k] = inserted.first->second;
+    }
+
+    std::vector<GPUSerializedEquation> compiled(distinct.size());
+    std::vector<std::string> keys(distinct.size());
+    std::vector<std::string> errors(distinct.size());
+    CpuBackend::ParallelFor(static_cast<int>(distinct.size()), 4, [&](int begin, int end)
+    {
+        for (int d = begin; d < end; ++d)
+        {
+            try { compiled[d] = CompileEquation(distinct[d], derivative_method, keys[d]); }
+            catch (const std::exception& e) { errors[d] = e.what(); }
+        }
+    });
+    for (size_t d = 0; d < distinct.size(); ++d)
+    {
+        if (!errors[d].empty()) throw std::runtime_error(errors[d] + " (in '" + distinct[d] + "')");
+    }
+
+    Objects::SetEquations(keys, compiled, indices, objectEquations);
+}
+
+// CompileEquation() for a built equation: its tokens skip the tokenizer, and its text is the key
+static GPUSerializedEquation CompileBuiltEquation(const BuiltEquation& equation, const std::string& key)
+{
+    GPUSerializedEquation serialized;
+    if (Objects::HasEquation(key) || EquationCache::Load(key, serialized)) return serialized;
+
+    try { serialized = serializeEquationForGPU(equation.Parse()); }
+    catch (const std::exception& e) { throw std::runtime_error("Equation parsing failed: " + std::string(e.what())); }
+    EquationCache::Store(key, serialized);
+    return serialized;
+}
+
+void SimulationWrapper::set_equation(int object_index, const BuiltEquation& equation)
+{
+    ensure_initialized();
+
+    if (object_index < 0 || object_index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+
+    std::string key = equation.Key();
+    GPUSerializedEquation eq = CompileBuiltEquation(equation, key);
+    Objects::SetEquation(key, eq, object_index);
+}
+
+void SimulationWrapper::batch_set_equation(const std::vector<int>& indices, const BuiltEquation& equation)
+{
+    ensure_initialized();
+    ValidateObjectIndices(indices);
+
+    std::string key = equation.Key();
+    GPUSerializedEquation eq = CompileBuiltEquation(equation, key);
+    Objects::SetEquation(key, eq, indices);
+}
+
+void SimulationWrapper::set_equations(const std::vector<int>& indices, const std::vector<BuiltEquation>& equations)
+{
+    ensure_initialized();
+    if (indices.size() != equations.size())
+        throw std::runtime_error("set_equations needs one equation per index");
+    ValidateObjectIndices(indices);
+
+    std::vector<std::string> keys;
+    std::vector<const BuiltEquation*> distinct;
+    std::vector<int> objectEquations(indices.size());
+    std::unordered_map<std::string, int> distinctIndex;
+    for (size_t k = 0; k < equations.size(); ++k)
+    {
+        std::string key = equations[k].Key();
+        auto inserted = distinctIndex.emplace(key, static_cast<int>(distinct.size()));
+        if (inserted.second)
+        {
+            keys.push_back(std::move(key));
+            distinct.push_back(&equations[k]);
+        }
+        objectEquations[k] = inserted.first->second;
+    }
+
+    std::vector<GPUSerializedEquation> compiled(distinct.size());
+    std::vector<std::string> errors(distinct.size());
+    CpuBackend::ParallelFor(static_cast<int>(distinct.size()), 4, [&](int begin, int end)
+    {
+        for (int d = begin; d < end; ++d)
+        {
+            try { compiled[d] = CompileBuiltEquation(*distinct[d], keys[d]); }
+            catch (const std::exception& e) { errors[d] = e.what(); }
+        }
+    });
+    for (size_t d = 0; d < distinct.size(); ++d)
+    {
+        if (!errors[d].empty()) throw std::runtime_error(errors[d] + " (in '" + keys[d] + "')");
+    }
+
+    Objects::SetEquations(keys, compiled, indices, objectEquations);
+}
+
+// ============================================================================
+// Behaviour groups: members run the group's equation through one table entry
+// ============================================================================
+static void ValidateEquationGroup(int group)
+{
+    if (group < 0 || group >= Objects::MAX_EQUATION_GROUPS)
+        throw std::runtime_error("Behaviour group must be between 0 and " + std::to_string(Objects::MAX_EQUATION_GROUPS - 1));
+}
+
+void SimulationWrapper::set_equation_group(const std::vector<int>& indices, int group)
+{
+    ensure_initialized();
+    ValidateEquationGroup(group);
+    ValidateObjectIndices(indices);
+    Objects::SetEquationGroup(group, indices);
+}
+
+void SimulationWrapper::set_group_equation(int group, const std::string& equation_string,
+                                           const std::string& derivative_method)
+{
+    ensure_initialized();
+    ValidateEquationGroup(group);
+
+    std::string key;
+    GPUSerializedEquation eq = CompileEquation(equation_string, derivative_method, key);
+    Objects::SetGroupEquation(key, eq, group);
+}
+
+void SimulationWrapper::set_group_equation(int group, const BuiltEquation& equation)
+{
+    ensure_initialized();
+    ValidateEquationGroup(group);
+
+    std::string key = equation.Key();
+    GPUSerializedEquation eq = CompileBuiltEquation(equation, key);
+    Objects::SetGroupEquation(key, eq, group);
+}
+
+void SimulationWrapper::clear_group_equation(int group)
+{
+    ensure_initialized();
+    ValidateEquationGroup(group);
+    Objects::ClearGroupEquation(group);
+}
+
+std::string SimulationWrapper::get_group_equation(int group) const
+{
+    ensure_initialized();
+    ValidateEquationGroup(group);
+    int id = Objects::GetGroupEquation(group);
+    return id >= 0 ? Objects::GetEquationKeys()[id] : std::string();
+}
+
+int SimulationWrapper::step_streamed(StreamedParticles particles, int n_steps, int group, int chunk)
+{
+    ensure_initialized();
+    if (n_steps < 0) throw std::runtime_error("n_steps must not be negative");
+    if (chunk < 1) throw std::runtime_error("chunk must be at least 1");
+    ValidateEquationGroup(group);
+    if (Objects::GetGroupEquation(group) < 0)
+        throw std::runtime_error("Behaviour group " + std::to_string(group) + " has no equation (see set_group_equation)");
+    if (DomainDecomposition::IsActive()) throw std::runtime_error("Streaming does not run under domain decomposition");
+    process_commands();
+    if (n_steps == 0 || particles.count == 0) return 0;
+
+    make_context_current();
+    FRAME_TRACE_ZONE("SimulationWrapper::step_streamed");
+    particles.equationID = Objects::EquationGroupID(group);
+
+    // The clock as run_steps() sets it for the first step; every chunk starts from it
+    SimParams params = Objects::GetSimParams();
+    params.dt = m_timestep;
+    params.time = m_simulationTime + m_timestep;
+    Objects::SetSimParams(params);
+
+    std::string error;
+    if (!Objects::StepStreamed(particles, n_steps, chunk, error)) throw std::runtime_error(error);
+    m_simulationTime += n_steps * m_timestep;
+    m_stepsTaken += static_cast<uint64_t>(n_steps);
+    m_lastUpdateSteps = n_steps;
+    return n_steps;
+}
+
+// Steps between colour evaluations of an object's equation
+void SimulationWrapper::set_color_interval(int object_index, int interval)
+{
+    ensure_initialized();
+
+    if (object_index < 0 || object_index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+    if (interval < 0)
+        throw std::runtime_error("Color interval must be 0 (last step of each update) or a step count");
+    if (!Objects::SetEquationColorInterval(object_index, interval))
+        throw std::runtime_error("Object " + std::to_string(object_index) + " has no equation");
+}
+
+int SimulationWrapper::get_color_interval(int object_index) const
+{
+    ensure_initialized();
+
+    if (object_index < 0 || object_index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+    int interval = Objects::GetEquationColorInterval(object_index);
+    return interval < 0 ? 1 : interval;
+}
+
+// Rate group of an object's equation: steps per evaluation
+void SimulationWrapper::set_step_interval(int object_index, int interval)
+{
+    ensure_initialized();
+
+    if (object_index < 0 || object_index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+    if (interval < 1)
+        throw std::runtime_error("Step interval must be at least 1");
+    if (!Objects::SetEquationStepInterval(object_index, interval))
+        throw std::runtime_error("Object " + std::to_string(object_index) + " has no equation");
+}
+
+int SimulationWrapper::get_step_interval(int object_index) const
+{
+    ensure_initialized();
+
+    if (object_index < 0 || object_index >= Objects::GetNumObjects())
+        throw std::runtime_error("Invalid object index");
+    int interval = Objects::GetEquationStepInterval(object_index);
+    return interval < 0 ? 1 : interval;
+}
+
 // Add distance constraint between two objects
 void SimulationWrapper::add_distance_constraint(int object_index, const DistanceConstraint& constraint)
 {
@@ -1218,17 +4044,63 @@ void SimulationWrapper::add_distance_constraint(int object_index, const Distance
     if (constraint.rest_length <= 0.0f)
         throw std::runtime_error("Distance constraint must have positive rest length");
 
+    if (constraint.break_length < 0.0f || (constraint.break_length > 0.0f && constraint.break_length <= constraint.rest_length))
+        throw std::runtime_error("Break length must be 0 or greater than the rest length");
+
     Constraint c;
     c.type = CONSTRAINT_DISTANCE;
     c.targetObjectID = constraint.target_object;
-    c.param1 = constraint.rest_length;      // Only distance parameter
-    c.param2 = 0.0f;                        // Unused
+    c.param1 = constraint.rest_length;
+    c.param2 = constraint.break_length;     // 0 = never breaks
     c.param3 = 0.0f;                        // Unused
     c.param4 = 0.0f;                        // Unused
 
     Objects::AddConstraint(object_index, c);
 }
 
+// Add many distance constraints with one constraint upload; all are checked before any is added
+void SimulationWrapper::add_distance_constraints(const std::vector<int>& object_indices,
+                                                 const std::vector<int>& targets,
+                                                 const std::vector<float>& rest_lengths,
+                                                 const std::vector<float>& break_lengths)
+{
+    ensure_initialized();
+
+    if (object_indices.size() != targets.size() || object_indices.size() != rest_lengths.size())
+        throw std::runtime_error("object_indices, targets and rest_lengths must have the same length");
+    if (!break_lengths.empty() && break_lengths.size() != rest_lengths.size())
+        throw std::runtime_error("break_lengths must be empty or as long as rest_lengths");
+
+    int numObjects = Objects::GetNumObjects();
+    std::vector<std::pair<int, Constraint>> constraints;
+    constraints.reserve(object_indices.size());
+    for (size_t i = 0; i < object_indices.size(); i++)
+    {
+        if (object_indices[i] < 0 || object_indices[i] >= numObjects)
+            throw std::runtime_error("Invalid object index");
+        if (targets[i] < 0 || targets[i] >= numObjects)
+            throw std::runtime_error("Invalid target object");
+        if (object_indices[i] == targets[i])
+            throw std::runtime_error("Cannot create distance constraint to self");
+        if (rest_lengths[i] <= 0.0f)
+            throw std::runtime_error("Distance constraint must have positive rest length");
+        float breakLength = break_lengths.empty() ? 0.0f : break_lengths[i];
+        if (breakLength < 0.0f || (breakLength > 0.0f && breakLength <= rest_lengths[i]))
+            throw std::runtime_error("Break length must be 0 or greater than the rest length");
+
+        Constraint c;
+        c.type = CONSTRAINT_DISTANCE;
+        c.targetObjectID = targets[i];
+        c.param1 = rest_lengths[i];
+        c.param2 = breakLength;
+        c.param3 = 0.0f;
+        c.param4 = 0.0f;
+        constraints.emplace_back(object_indices[i], c);
+    }
+
+    Objects::AddConstraints(constraints);
+}
+
 // Add boundary (box) constraint to an object
 void SimulationWrapper::add_boundary_constraint(int object_index, const BoundaryConstraint& constraint)
 {
@@ -1273,19 +4145,104 @@ void SimulationWrapper::clear_all_constraints()
 // SYSTEM PARAMETER FUNCTIONS
 // ============================================================================
 
-// Set global physics parameters
-void SimulationWrapper::set_parameter(const std::string& name, float value)
+// Scalar of the simulation parameter block a parameter name refers to, nullptr if none
+static float* SimParamField(SimParams& params, const std::string& name)
+{
+    if (name == "gravity" || name == "g") return &params.gravity;
+    if (name == "damping" || name == "b") return &params.damping;
+    if (name == "stiffness" || name == "k") return &params.stiffness;
+    if (name == "restitution") return &params.restitution;
+    if (name == "coupling") return &params.coupling;
+    if (name == "drive_freq") return &params.driveFreq;
+    if (name == "drive_amp") return &params.driveAmp;
+    return nullptr;
+}
+
+// SPH setting a parameter name refers to, nullptr if none
+static float* SphParamField(SphParameters& params, const std::string& name)
+{
+    if (name == "sph_radius") return &params.radius;
+    if (name == "sph_rest_density") return &params.restDensity;
+    if (name == "sph_stiffness") return &params.stiffness;
+    if (name == "sph_gamma") return &params.gamma;
+    if (name == "sph_viscosity") return &params.viscosity;
+    return nullptr;
+}
+
+// Set global physics parameters
+void SimulationWrapper::set_parameter(const std::string& name, float value)
+{
+    ensure_initialized();
+
+    SimParams params = Objects::GetSimParams();
+    SphParameters fluid = Objects::GetFluidParameters();
+    if (float* field = SimParamField(params, name))
+    {
+        *field = value;
+        Objects::SetSimParams(params);
+    }
+    else if (float* field = SphParamField(fluid, name))
+    {
+        bool nonNegative = (name == "sph_stiffness" || name == "sph_viscosity");
+        if (nonNegative ? !(value >= 0.0f) : !(value > 0.0f))
+            throw std::runtime_error(name + (nonNegative ? " must be >= 0" : " must be positive"));
+        *field = value;
+        Objects::SetFluidParameters(fluid);
+    }
+    else if (name == "timestep" || name == "dt")
+    {
+        if (!(value > 0.0f)) throw std::runtime_error("timestep must be positive");
+        m_timestep = value;
+    }
+    else if (name == "backend_crossover")
+    {
+        if (value != -1.0f && !(value >= 0.0f))
+            throw std::runtime_error("backend_crossover must be an object count, or -1 to measure it again");
+        m_backendCrossover = static_cast<int>(value);
+    }
+    else if (name == "frame_pipeline_depth")
+    {
+        if (!(value >= 0.0f) || value != std::floor(value))
+            throw std::runtime_error("frame_pipeline_depth must be a whole number of frames");
+        Objects::SetFramePipelineDepth(static_cast<int>(value));
+    }
+    else if (name == "instanced_rendering")
+        Objects::SetInstancedRendering(value != 0.0f);
+    else if (name == "view_culling")
+        Objects::SetViewCulling(value != 0.0f);
+    else if (name == "integrator")
+    {
+        int method = static_cast<int>(value);
+        if (method < INTEGRATOR_SYMPLECTIC_EULER || method > INTEGRATOR_RK4 || method != value)
+            throw std::runtime_error("Unknown integrator: " + std::to_string(value));
+        Objects::SetIntegrator(static_cast<IntegratorMethod>(method));
+    }
+    else
+        throw std::runtime_error("Unknown parameter: " + name);
+}
+
+// Set a parameter given by name, e.g. set_parameter("integrator", "rk4")
+void SimulationWrapper::set_parameter(const std::string& name, const std::string& value)
 {
     ensure_initialized();
 
-    if (name == "gravity" || name == "g")
-        Objects::SetSystemParameters(value, 0.1f, 1.0f);
-    else if (name == "damping" || name == "b")
-        Objects::SetSystemParameters(9.81f, value, 1.0f);
-    else if (name == "stiffness" || name == "k")
-        Objects::SetSystemParameters(9.81f, 0.1f, value);
-    else
-        throw std::runtime_error("Unknown parameter: " + name);
+    if (name == "backend")
+    {
+        if (value != "gpu" && value != "cpu" && value != "vulkan" && value != "auto")
+            throw std::runtime_error("Unknown backend: " + value + " (gpu, cpu, vulkan or auto)");
+        std::string error;
+        if (value == "vulkan" && !VulkanBackend::Init(error)) throw std::runtime_error(error);
+        m_backend = value;
+        return;
+    }
+    if (name != "integrator")
+        throw std::runtime_error("Parameter " + name + " takes a number");
+
+    if (value == "symplectic_euler" || value == "euler") Objects::SetIntegrator(INTEGRATOR_SYMPLECTIC_EULER);
+    else if (value == "velocity_verlet" || value == "verlet") Objects::SetIntegrator(INTEGRATOR_VELOCITY_VERLET);
+    else if (value == "yoshida4" || value == "yoshida") Objects::SetIntegrator(INTEGRATOR_YOSHIDA4);
+    else if (value == "rk4") Objects::SetIntegrator(INTEGRATOR_RK4);
+    else throw std::runtime_error("Unknown integrator: " + value);
 }
 
 // Get current value of a global physics parameter
@@ -1293,9 +4250,17 @@ float SimulationWrapper::get_parameter(const std::string& name) const
 {
     ensure_initialized();
 
-    if (name == "gravity" || name == "g") return 9.81f;
-    if (name == "damping" || name == "b") return 0.1f;
-    if (name == "stiffness" || name == "k") return 1.0f;
+    SimParams params = Objects::GetSimParams();
+    if (const float* field = SimParamField(params, name)) return *field;
+    SphParameters fluid = Objects::GetFluidParameters();
+    if (const float* field = SphParamField(fluid, name)) return *field;
+    if (name == "timestep" || name == "dt") return m_timestep;
+    if (name == "integrator") return static_cast<float>(Objects::GetIntegrator());
+    if (name == "backend") return static_cast<float>(m_steppedBackend);
+    if (name == "backend_crossover") return static_cast<float>(m_backendCrossover);
+    if (name == "frame_pipeline_depth") return static_cast<float>(Objects::GetFramePipelineDepth());
+    if (name == "instanced_rendering") return Objects::GetInstancedRendering() ? 1.0f : 0.0f;
+    if (name == "view_culling") return Objects::GetViewCulling() ? 1.0f : 0.0f;
 
     throw std::runtime_error("Unknown parameter: " + name);
 }
@@ -1309,12 +4274,18 @@ void SimulationWrapper::save_to_file(
     const std::string& filename,
     const std::string& title,
     const std::string& author,
-    const std::string& description)
+    const std::string& description,
+    bool binary)
 {
     ensure_initialized();
 
-    if (m_window)
-        glfwMakeContextCurrent(static_cast<GLFWwindow*>(m_window));
+    make_context_current();
+
+    if (binary)
+    {
+        save_snapshot(filename, { title, author, description });
+        return;
+    }
 
     // Open file for writing
     FILE* file = fopen(filename.c_str(), "w");
@@ -1333,7 +4304,9 @@ void SimulationWrapper::save_to_file(
     fprintf(file, "[SYSTEM_PARAMETERS]\n");
     fprintf(file, "gravity = %.6f\n", get_parameter("gravity"));
     fprintf(file, "damping = %.6f\n", get_parameter("damping"));
-    fprintf(file, "stiffness = %.6f\n\n", get_parameter("stiffness"));
+    fprintf(file, "stiffness = %.6f\n", get_parameter("stiffness"));
+    fprintf(file, "timestep = %.6f\n", get_parameter("timestep"));
+    fprintf(file, "integrator = %d\n\n", static_cast<int>(Objects::GetIntegrator()));
 
     // Save camera state
     fprintf(file, "[CAMERA]\n");
@@ -1389,11 +4362,454 @@ void SimulationWrapper::save_to_file(
     fclose(file);
 }
 
+// Raw arrays of everything the scene holds; the object state comes back in one readback
+// (without objects, only the host tables are taken, sized for the current object count)
+SceneSnapshot SimulationWrapper::capture_snapshot(const std::vector<std::string>& metadata, bool objects)
+{
+    SceneSnapshot snapshot;
+    SnapshotHeader& header = snapshot.header;
+    header.params = Objects::GetSimParams();
+    header.timestep = m_timestep;
+    header.integrator = static_cast<int32_t>(Objects::GetIntegrator());
+    header.cameraX = g_camera.position.x;
+    header.cameraY = g_camera.position.y;
+    header.cameraZoom = g_camera.zoom;
+    header.simulationTime = m_simulationTime;
+
+    if (objects) Objects::FetchToCPU(m_currentBuffer, snapshot.objects);
+    for (Object& object : snapshot.objects) object.equationID = Objects::ResolveEquationID(object.equationID);  // Groups are not saved
+    int numObjects = objects ? static_cast<int>(snapshot.objects.size()) : Objects::GetNumObjects();
+
+    snapshot.collision.resize(numObjects);
+    snapshot.objectParams.resize(static_cast<size_t>(numObjects) * OBJECT_PARAM_COUNT);
+    for (int i = 0; i < numObjects; ++i)
+    {
+        snapshot.collision[i] = Objects::GetCollisionProperties(i);
+        Objects::GetObjectParameters(i, &snapshot.objectParams[static_cast<size_t>(i) * OBJECT_PARAM_COUNT]);
+    }
+    for (const auto& entry : Objects::GetAllConstraints())
+        snapshot.constraints.push_back({ entry.first, entry.second });
+
+    snapshot.equations = Objects::GetEquationKeys();
+    snapshot.metadata = metadata;
+    std::vector<int> handles;
+    Objects::GetObjectHandles(handles);
+    if (static_cast<int>(handles.size()) == numObjects) snapshot.handles.assign(handles.begin(), handles.end());
+    return snapshot;
+}
+
+// ============================================================================
+// Scene cache: objects in VRAM, the host tables here
+// ============================================================================
+void SimulationWrapper::cache_scene(const std::string& name)
+{
+    ensure_initialized();
+    if (name.empty()) throw std::runtime_error("cache_scene() needs a name");
+    auto scene = std::make_unique<SceneSnapshot>(capture_snapshot({}, false));
+    if (!Objects::CacheObjects(name, m_currentBuffer))
+        throw std::runtime_error("Failed to keep scene '" + name + "' on the GPU");
+    m_cachedScenes[name] = std::move(scene);
+}
+
+void SimulationWrapper::activate_scene(const std::string& name)
+{
+    ensure_initialized();
+    auto it = m_cachedScenes.find(name);
+    if (it == m_cachedScenes.end() || !SceneCache::Has(name))
+        throw std::runtime_error("No cached scene named '" + name + "'");
+
+    // The copy keeps the cached tables for the next activation
+    SceneSnapshot scene = *it->second;
+    apply_snapshot(scene, "cache '" + name + "'", name);
+}
+
+void SimulationWrapper::remove_cached_scene(const std::string& name)
+{
+    ensure_initialized();
+    m_cachedScenes.erase(name);
+    SceneCache::Remove(name);
+}
+
+// ============================================================================
+// Rollback history
+// ============================================================================
+void SimulationWrapper::enable_history(int n_snapshots, int every_k_steps)
+{
+    ensure_initialized();
+    if (n_snapshots < 0) throw std::runtime_error("n_snapshots must not be negative");
+    if (every_k_steps < 1) throw std::runtime_error("every_k_steps must be >= 1");
+
+    Objects::SetHistoryCapacity(n_snapshots);
+    m_historyInterval = n_snapshots > 0 ? every_k_steps : 0;
+    m_historySteps = 0;
+    if (n_snapshots > 0 && !Objects::PushHistory(m_currentBuffer, m_simulationTime) && object_count() > 0)
+        throw std::runtime_error("Failed to allocate the history ring");
+}
+
+void SimulationWrapper::disable_history()
+{
+    enable_history(0, 1);
+}
+
+double SimulationWrapper::rewind(int k)
+{
+    ensure_initialized();
+    if (k < 1) throw std::runtime_error("rewind() needs k >= 1");
+    int back = k - 1;
+    if (back >= Objects::GetHistoryCount())
+        throw std::runtime_error("Only " + std::to_string(Objects::GetHistoryCount()) + " snapshots are held");
+
+    double time = Objects::GetHistoryTime(back);
+    if (!Objects::RewindHistory(back))
+        throw std::runtime_error("The object count changed since that snapshot");
+
+    m_simulationTime = static_cast<float>(time);
+    SimParams params = Objects::GetSimParams();
+    params.time = m_simulationTime;
+    Objects::SetSimParams(params);
+    m_historySteps = 0;
+    if (m_cpuMirror) m_cpuMirror->valid = false;  // Its objects are of the state rewound from
+    return time;
+}
+
+std::vector<double> SimulationWrapper::get_history_times() const
+{
+    ensure_initialized();
+    std::vector<double> times;
+    for (int back = Objects::GetHistoryCount() - 1; back >= 0; back--) times.push_back(Objects::GetHistoryTime(back));
+    return times;
+}
+
+std::vector<std::string> SimulationWrapper::get_cached_scenes() const
+{
+    ensure_initialized();
+    return SceneCache::GetNames();
+}
+
+long long SimulationWrapper::get_scene_cache_bytes() const
+{
+    ensure_initialized();
+    return SceneCache::GetBytes();
+}
+
+void SimulationWrapper::save_snapshot(const std::string& filename, const std::vector<std::string>& metadata)
+{
+    SceneSnapshotIO::Write(filename, capture_snapshot(metadata));
+}
+
+// Equation registration keys carry the derivative method as a "[method] " prefix
+static ParsedEquation ParseEquationKey(const std::string& key, std::string& registeredKey)
+{
+    std::string method = "symbolic", equation = key;
+    size_t close = key.find("] ");
+    if (!key.empty() && key[0] == '[' && close != std::string::npos)
+    {
+        method = key.substr(1, close - 1);
+        equation = key.substr(close + 2);
+    }
+    return ParseEquationWithMethod(equation, method, registeredKey);
+}
+
+// ============================================================================
+// CPU BACKEND SELECTION
+// ============================================================================
+
+bool SimulationWrapper::use_cpu_backend()
+{
+    int numObjects = Objects::GetNumObjects();
+    if (m_backend == "gpu" || m_backend == "vulkan" || numObjects == 0 || !Objects::CanStepOnCpu()) return false;
+    if (m_backend == "cpu") return true;
+
+    // Measured once the GPU can step this scene at all
+    if (m_backendCrossover < 0)
+    {
+        if (!Objects::GetComputeProgram() || !Objects::IsComputeShaderReady()) return false;
+        calibrate_backend();
+    }
+    return numObjects < m_backendCrossover;
+}
+
+// The scenes CpuBackend can mirror, less what the Vulkan step leaves to the OpenGL pipeline
+bool SimulationWrapper::use_vulkan_backend()
+{
+    if (m_backend != "vulkan" || Objects::GetNumObjects() == 0 || !Objects::CanStepOnCpu()) return false;
+    sync_cpu_mirror();
+    m_cpuMirror->scene.integrator = Objects::GetIntegrator();
+    std::string reason;
+    return VulkanBackend::CanStep(m_cpuMirror->scene, m_cpuMirror->equations, reason);
+}
+
+void SimulationWrapper::sync_cpu_mirror()
+{
+    if (!m_cpuMirror) m_cpuMirror.reset(new CpuSceneMirror());
+    CpuSceneMirror& mirror = *m_cpuMirror;
+    if (mirror.valid && mirror.revision == Objects::GetSceneRevision()) return;
+
+    // The step runs the resolved equations, but the objects that go back up keep their group
+    // links, so a CPU-stepped member still follows set_group_equation()
+    SceneSnapshot snapshot = capture_snapshot({}, false);
+    std::vector<Object> linked;
+    Objects::FetchToCPU(m_currentBuffer, linked);
+    snapshot.objects = linked;
+    for (Object& object : snapshot.objects) object.equationID = Objects::ResolveEquationID(object.equationID);
+
+    // Equation IDs must match the GPU's, free slots included; ID 0 is the default equation
+    if (!mirror.valid || snapshot.equations != mirror.equationKeys)
+    {
+        mirror.equations = CpuBackend::CreateEquationSet();
+        size_t used = snapshot.equations.size();
+        while (used > 1 && snapshot.equations[used - 1].empty()) used--;
+        for (size_t id = 1; id < used; id++)
+        {
+            const std::string& key = snapshot.equations[id];
+            if (key.empty())
+            {
+                CpuBackend::AddEquation(mirror.equations, "[free] " + std::to_string(id), ParsedEquation());
+                continue;
+            }
+            std::string registeredKey;
+            CpuBackend::AddEquation(mirror.equations, key, ParseEquationKey(key, registeredKey));
+        }
+        mirror.equationKeys = snapshot.equations;
+    }
+
+    CpuBackend::Load(mirror.scene, snapshot.objects);
+    for (size_t i = 0; i < linked.size(); i++) mirror.scene.objects[i].equationID = linked[i].equationID;
+    mirror.scene.collision = snapshot.collision;
+    mirror.scene.objectParams = snapshot.objectParams;
+    mirror.scene.handleSlots = ObjectHandles::BuildSlotTable(std::vector<int>(snapshot.handles.begin(), snapshot.handles.end()));
+    for (const SnapshotConstraint& c : snapshot.constraints)
+    {
+        if (c.owner >= 0 && c.owner < static_cast<int>(snapshot.objects.size()))
+            mirror.scene.constraints[c.owner].push_back(c.constraint);
+    }
+    mirror.revision = Objects::GetSceneRevision();
+    mirror.valid = true;
+}
+
+// Times a few steps of the current scene on both backends and puts the state back. At the
+// sizes where the choice matters the GPU costs the same per step whatever the count, while
+// the CPU cost grows with it, so the crossover is where the two lines meet.
+void SimulationWrapper::calibrate_backend()
+{
+    using Clock = std::chrono::steady_clock;
+    const int CALIBRATION_STEPS = 8;
+    const int numObjects = Objects::GetNumObjects();
+
+    sync_cpu_mirror();
+    SimParams params = Objects::GetSimParams();
+    SimParams stepParams = params;
+    stepParams.dt = m_timestep;
+    stepParams.time = m_simulationTime;
+
+    CpuBackend::Scene scene = m_cpuMirror->scene;
+    scene.params = stepParams;
+    scene.integrator = Objects::GetIntegrator();
+    Clock::time_point start = Clock::now();
+    for (int k = 0; k < CALIBRATION_STEPS; k++)
+        CpuBackend::Step(scene, m_cpuMirror->equations);
+    double cpuMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::vector<Object> saved = CpuBackend::Store(m_cpuMirror->scene);
+    Objects::SetSimParams(stepParams);
+    glFinish();
+    start = Clock::now();
+    int buffer = m_currentBuffer;
+    for (int k = 0; k < CALIBRATION_STEPS; k++)
+    {
+        Objects::Update(buffer, 1 - buffer, 1);
+        buffer = 1 - buffer;
+    }
+    glFinish();
+    double gpuMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    Objects::SetSimParams(params);
+    Objects::UploadBulkObjects(saved, 0);
+    m_cpuMirror->revision = Objects::GetSceneRevision();
+
+    double crossover = (cpuMs > 0.0) ? numObjects * gpuMs / cpuMs : static_cast<double>(Objects::MAX_OBJECTS);
+    m_backendCrossover = static_cast<int>(std::min(crossover, static_cast<double>(Objects::MAX_OBJECTS)));
+}
+
+void SimulationWrapper::load_snapshot(const std::string& filename)
+{
+    SceneSnapshot snapshot = SceneSnapshotIO::Read(filename);
+    apply_snapshot(snapshot, filename);
+}
+
+void SimulationWrapper::apply_snapshot(SceneSnapshot& snapshot, const std::string& filename, const std::string& cachedObjects)
+{
+    // Everything is checked before the current scene is touched
+    const std::vector<int>* cachedEquations = cachedObjects.empty() ? nullptr : SceneCache::GetEquationIDs(cachedObjects);
+    if (!cachedObjects.empty() && !cachedEquations) throw std::runtime_error("No cached scene named '" + cachedObjects + "'");
+    const int numObjects = cachedEquations ? static_cast<int>(cachedEquations->size()) : static_cast<int>(snapshot.objects.size());
+    if (numObjects > Objects::MAX_OBJECTS) throw std::runtime_error("Maximum object limit reached");
+    if (!snapshot.collision.empty() && snapshot.collision.size() != static_cast<size_t>(numObjects))
+        throw std::runtime_error("Snapshot " + filename + " has collision properties for a different object count");
+    if (!snapshot.objectParams.empty() &&
+        snapshot.objectParams.size() != static_cast<size_t>(numObjects) * OBJECT_PARAM_COUNT)
+        throw std::runtime_error("Snapshot " + filename + " has object parameters for a different object count");
+    for (const SnapshotConstraint& c : snapshot.constraints)
+    {
+        if (c.owner < 0 || c.owner >= numObjects || c.constraint.targetObjectID >= numObjects)
+            throw std::runtime_error("Snapshot " + filename + " has a constraint on a missing object");
+    }
+
+    // Objects grouped by equation, parsed once per equation
+    std::map<int, std::vector<int>> equationObjects;
+    for (int i = 0; i < numObjects; ++i)
+    {
+        int id = cachedEquations ? (*cachedEquations)[i] : snapshot.objects[i].equationID;
+        if (id >= 0 && id < static_cast<int>(snapshot.equations.size()) && !snapshot.equations[id].empty())
+            equationObjects[id].push_back(i);
+        if (!cachedEquations) snapshot.objects[i].equationID = -1;
+    }
+    std::vector<std::pair<std::string, ParsedEquation>> equations;
+    for (const auto& entry : equationObjects)
+    {
+        std::string key;
+        ParsedEquation eq = ParseEquationKey(snapshot.equations[entry.first], key);
+        equations.emplace_back(key, std::move(eq));
+    }
+
+    reset();
+    clear_all_constraints();
+    std::vector<int> existing(object_count());
+    std::iota(existing.begin(), existing.end(), 0);
+    remove_objects(existing);
+    Objects::ClearHistory();  // Snapshots of the scene being replaced
+
+    const SnapshotHeader& header = snapshot.header;
+    Objects::SetSimParams(header.params);
+    set_parameter("timestep", header.timestep);
+    set_parameter("integrator", static_cast<float>(header.integrator));
+    g_camera.position.x = header.cameraX;
+    g_camera.position.y = header.cameraY;
+    g_camera.zoom = header.cameraZoom;
+    m_simulationTime = header.simulationTime;
+
+    if (numObjects == 0) return;
+    int first = cachedEquations ? Objects::AddCachedObjects(cachedObjects) : Objects::AddObjects(snapshot.objects);
+    if (first != 0) throw std::runtime_error("Failed to upload the snapshot objects");
+    if (snapshot.handles.size() == static_cast<size_t>(numObjects) &&
+        !Objects::RestoreObjectHandles(std::vector<int>(snapshot.handles.begin(), snapshot.handles.end())))
+        std::cerr << "[SimulationWrapper] Snapshot " << filename << " has invalid object handles; p[i] uses indices" << std::endl;
+
+    size_t e = 0;
+    for (const auto& entry : equationObjects)
+    {
+        Objects::SetEquation(equations[e].first, equations[e].second, entry.second);
+        ++e;
+    }
+    if (!snapshot.collision.empty()) Objects::SetCollisionProperties(0, snapshot.collision);
+    for (int i = 0; i < numObjects && !snapshot.objectParams.empty(); ++i)
+        Objects::SetObjectParameters(i, &snapshot.objectParams[static_cast<size_t>(i) * OBJECT_PARAM_COUNT], OBJECT_PARAM_COUNT);
+
+    std::vector<std::pair<int, Constraint>> constraints;
+    constraints.reserve(snapshot.constraints.size());
+    for (const SnapshotConstraint& c : snapshot.constraints) constraints.emplace_back(c.owner, c.constraint);
+    if (!constraints.empty()) Objects::AddConstraints(constraints);
+}
+
+// ============================================================================
+// Delta checkpoints
+// ============================================================================
+void SimulationWrapper::wait_for_checkpoint()
+{
+    if (m_checkpointWrite.valid()) m_checkpointWrite.get();
+}
+
+int SimulationWrapper::checkpoint(const std::string& path, bool full)
+{
+    ensure_initialized();
+    if (path.empty()) throw std::runtime_error("checkpoint() needs a path");
+    wait_for_checkpoint();
+
+    // Base: the full snapshot, with an empty delta log next to it
+    if (full || path != m_checkpointPath || !m_checkpointState || !ObjectCheckpoint::HasBase())
+    {
+        auto base = std::make_shared<SceneSnapshot>(capture_snapshot({}));
+        if (!Objects::SetCheckpointBase(m_currentBuffer))
+            throw std::runtime_error("Failed to keep the checkpoint base on the GPU");
+
+        m_checkpointState = std::make_unique<SceneSnapshot>(*base);
+        m_checkpointState->objects.clear();
+        m_checkpointPath = path;
+        m_checkpointSequence = 0;
+        m_checkpointWrite = std::async(std::launch::async, [base, path]()
+        {
+            SceneSnapshotIO::Write(path, *base);
+            std::ofstream log(path + ".delta", std::ios::binary | std::ios::trunc);
+            if (!log) throw std::runtime_error("Failed to open file: " + path + ".delta");
+        });
+        return 0;
+    }
+
+    auto delta = std::make_shared<SnapshotDelta>();
+    SceneSnapshot current = capture_snapshot({});  // Objects are taken from the GPU diff instead
+    if (!Objects::TakeCheckpointDelta(m_currentBuffer, delta->objectIndices, delta->objects))
+        throw std::runtime_error("Failed to diff the objects against the last checkpoint");
+
+    SceneSnapshot& last = *m_checkpointState;
+    const size_t numObjects = static_cast<size_t>(object_count());
+    delta->scene = current.header;
+    delta->sequence = ++m_checkpointSequence;
+    delta->numObjects = static_cast<uint32_t>(numObjects);
+    for (size_t i = 0; i < numObjects; ++i)
+    {
+        if (i >= last.collision.size() ||
+            std::memcmp(&current.collision[i], &last.collision[i], sizeof(CollisionProperties)) != 0)
+        {
+            delta->collisionIndices.push_back(static_cast<int32_t>(i));
+            delta->collision.push_back(current.collision[i]);
+        }
+        const float* params = &current.objectParams[i * OBJECT_PARAM_COUNT];
+        if (i >= last.objectParams.size() / OBJECT_PARAM_COUNT ||
+            std::memcmp(params, &last.objectParams[i * OBJECT_PARAM_COUNT], OBJECT_PARAM_COUNT * sizeof(float)) != 0)
+        {
+            delta->paramIndices.push_back(static_cast<int32_t>(i));
+            delta->objectParams.insert(delta->objectParams.end(), params, params + OBJECT_PARAM_COUNT);
+        }
+    }
+    delta->constraintsChanged = current.constraints.size() != last.constraints.size() ||
+        (!current.constraints.empty() && std::memcmp(current.constraints.data(), last.constraints.data(),
+                                                     current.constraints.size() * sizeof(SnapshotConstraint)) != 0);
+    if (delta->constraintsChanged) delta->constraints = current.constraints;
+    delta->equationsChanged = current.equations != last.equations;
+    if (delta->equationsChanged) delta->equations = current.equations;
+
+    current.objects.clear();
+    last = std::move(current);
+    std::string log = path + ".delta";
+    m_checkpointWrite = std::async(std::launch::async, [delta, log]() { SceneSnapshotIO::AppendDelta(log, *delta); });
+    return static_cast<int>(m_checkpointSequence);
+}
+
+int SimulationWrapper::restore_checkpoint(const std::string& path)
+{
+    ensure_initialized();
+    if (path == m_checkpointPath) wait_for_checkpoint();
+
+    SceneSnapshot snapshot = SceneSnapshotIO::Read(path);
+    int applied = SceneSnapshotIO::ApplyDeltas(path + ".delta", snapshot);
+    apply_snapshot(snapshot, path);
+
+    // The next checkpoint starts a new base
+    m_checkpointState.reset();
+    m_checkpointPath.clear();
+    return applied;
+}
+
 // Load simulation state from file
 void SimulationWrapper::load_from_file(const std::string& filename)
 {
     ensure_initialized();
 
+    if (SceneSnapshotIO::IsSnapshotFile(filename))
+    {
+        load_snapshot(filename);
+        return;
+    }
+
     std::ifstream file(filename);
     if (!file)
         throw std::runtime_error("Failed to open file: " + filename);
@@ -1401,8 +4817,10 @@ void SimulationWrapper::load_from_file(const std::string& filename)
     // Clear existing simulation
     reset();
     clear_all_constraints();
-    while (object_count() > 0)
-        remove_object(0);
+    std::vector<int> existing(object_count());
+    std::iota(existing.begin(), existing.end(), 0);
+    remove_objects(existing);
+    Objects::ClearHistory();
 
     std::string line;
     std::string current_section;
@@ -1441,6 +4859,8 @@ void SimulationWrapper::load_from_file(const std::string& filename)
                     if (key == "gravity") set_parameter("gravity", std::stof(value));
                     else if (key == "damping") set_parameter("damping", std::stof(value));
                     else if (key == "stiffness") set_parameter("stiffness", std::stof(value));
+                    else if (key == "timestep") set_parameter("timestep", std::stof(value));
+                    else if (key == "integrator") set_parameter("integrator", std::stof(value));
                 }
             }
             // Parse camera state
@@ -1607,35 +5027,349 @@ void SimulationWrapper::load_from_file(const std::string& filename)
 // SIMULATION CONTROL FUNCTIONS
 // ============================================================================
 
-// Pause or resume simulation
-void SimulationWrapper::set_paused(bool paused)
-{
-    m_paused = paused;
-}
+// Pause or resume simulation
+void SimulationWrapper::set_paused(bool paused)
+{
+    m_paused = paused;
+}
+
+// Check if simulation is paused
+bool SimulationWrapper::is_paused() const
+{
+    return m_paused;
+}
+
+// Reset simulation to initial state
+void SimulationWrapper::reset()
+{
+    ensure_initialized();
+    Objects::ResetToInitialConditions();
+    m_currentBuffer = 0;
+}
+
+// ============================================================================
+// BATCH STOP CONDITIONS
+// ============================================================================
+
+// BatchConfig::stop_condition as one reduction over a world's objects and a comparison
+struct StopCondition
+{
+    std::string expression;
+    ReductionOp op = REDUCE_MAX;
+    std::string comparison;  // <, <=, > or >=
+    float threshold = 0.0f;
+};
+
+static std::string Trimmed(const std::string& text)
+{
+    size_t begin = text.find_first_not_of(" \t\n");
+    if (begin == std::string::npos) return "";
+    return text.substr(begin, text.find_last_not_of(" \t\n") - begin + 1);
+}
+
+// Split "lhs < rhs" at its comparison outside parentheses; false without one
+static bool SplitComparison(const std::string& text, std::string& lhs, std::string& comparison, std::string& rhs)
+{
+    int depth = 0;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        char c = text[i];
+        if (c == '(') depth++;
+        else if (c == ')') depth--;
+        else if (depth == 0 && (c == '<' || c == '>'))
+        {
+            size_t length = (i + 1 < text.size() && text[i + 1] == '=') ? 2 : 1;
+            lhs = Trimmed(text.substr(0, i));
+            comparison = text.substr(i, length);
+            rhs = Trimmed(text.substr(i + length));
+            return true;
+        }
+    }
+    return false;
+}
+
+// False for an empty condition; throws on one that does not parse
+static bool ParseStopCondition(const std::string& text, StopCondition& condition)
+{
+    std::string source = Trimmed(text);
+    if (source.empty()) return false;
+    auto fail = [&](const std::string& reason) -> bool
+    {
+        throw std::runtime_error("Invalid stop condition '" + text + "': " + reason);
+    };
+
+    size_t open = source.find('(');
+    if (open == std::string::npos) fail("expected any(), all(), sum(), mean(), min() or max()");
+    std::string name = Trimmed(source.substr(0, open));
+    size_t close = open;
+    for (int depth = 0; close < source.size(); ++close)
+    {
+        if (source[close] == '(') depth++;
+        else if (source[close] == ')' && --depth == 0) break;
+    }
+    if (close == source.size()) fail("unbalanced parentheses");
+    std::string inner = source.substr(open + 1, close - open - 1);
+    std::string rest = Trimmed(source.substr(close + 1));
+
+    // any()/all() compare per object: the extreme object decides
+    std::string lhs, rhs;
+    if (name == "any" || name == "all")
+    {
+        if (!rest.empty()) fail("nothing may follow " + name + "()");
+        if (!SplitComparison(inner, lhs, condition.comparison, rhs)) fail(name + "() needs a comparison");
+        bool below = condition.comparison[0] == '<';
+        condition.op = (name == "any") == below ? REDUCE_MIN : REDUCE_MAX;
+        condition.expression = lhs;
+    }
+    else
+    {
+        if (name == "sum") condition.op = REDUCE_SUM;
+        else if (name == "mean") condition.op = REDUCE_MEAN;
+        else if (name == "min") condition.op = REDUCE_MIN;
+        else if (name == "max") condition.op = REDUCE_MAX;
+        else fail("unknown reduction '" + name + "'");
+        if (!SplitComparison(rest, lhs, condition.comparison, rhs) || !lhs.empty())
+            fail(name + "() must be followed by a comparison");
+        condition.expression = Trimmed(inner);
+    }
+    if (condition.expression.empty()) fail("empty expression");
+
+    try
+    {
+        size_t used = 0;
+        condition.threshold = std::stof(rhs, &used);
+        if (used != rhs.size()) fail("the threshold must be a number");
+    }
+    catch (const std::logic_error&)
+    {
+        fail("the threshold must be a number");
+    }
+    return true;
+}
+
+static bool StopConditionHolds(const StopCondition& condition, float value)
+{
+    if (condition.comparison == "<") return value < condition.threshold;
+    if (condition.comparison == "<=") return value <= condition.threshold;
+    if (condition.comparison == ">") return value > condition.threshold;
+    return value >= condition.threshold;
+}
+
+// The reduced value of each world (one without worlds), read back from the GPU
+static std::vector<float> ReduceStopCondition(int sourceIndex, const StopCondition& condition)
+{
+    std::vector<float> values;
+    std::string error;
+    if (!Objects::ReduceWorlds(sourceIndex, condition.expression, condition.op, values, error))
+        throw std::runtime_error("Stop condition '" + condition.expression + "' failed: " + error);
+    return values;
+}
+
+static void CheckStopInterval(const BatchConfig& config)
+{
+    if (config.stop_check_interval < 1)
+        throw std::runtime_error("stop_check_interval must be at least 1");
+}
+
+// run_batch() observers share one recording: the union of their fields and objects at the
+// gcd of their strides, drained at half a ring and split back per observer and world
+class BatchObservation
+{
+public:
+    BatchObservation(SimulationWrapper& sim, const std::vector<BatchObserver>& observers,
+                     const std::vector<ObjectWorlds::WorldRange>& worlds, const std::vector<int>& worldSteps,
+                     int firstBatch)
+        : m_sim(sim), m_observers(observers), m_worlds(worlds), m_worldSteps(worldSteps),
+          m_firstBatch(firstBatch), m_lastSteps(observers.size(), 0)
+    {
+        if (observers.empty()) return;
+
+        int stride = 0;
+        std::vector<std::string> fields;
+        std::set<int> objects;
+        for (const BatchObserver& observer : observers)
+        {
+            if (!observer.callback) throw std::runtime_error("Batch observer needs a callback");
+            if (observer.every_n_steps < 1) throw std::runtime_error("Observer every_n_steps must be at least 1");
+            stride = std::gcd(stride, observer.every_n_steps);
+
+            for (const std::string& field : FieldsOf(observer))
+                if (std::find(fields.begin(), fields.end(), field) == fields.end()) fields.push_back(field);
+            for (const ObjectWorlds::WorldRange& world : worlds)
+            {
+                for (int index : ObjectsOf(observer, world))
+                {
+                    if (index < 0 || index >= world.count) throw std::runtime_error("Invalid observer object index");
+                    objects.insert(world.first + index);
+                }
+            }
+        }
+        if (objects.empty()) return;
+
+        m_sim.record(fields, stride, RING_FRAMES, std::vector<int>(objects.begin(), objects.end()), "");
+        m_active = true;
+    }
+
+    ~BatchObservation()
+    {
+        // Unwinding from a failed run: the ring is released, the frames in it are not delivered
+        if (!m_active) return;
+        try
+        {
+            m_sim.stop_recording();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    // After every step; all = the run is over
+    void Poll(bool all)
+    {
+        if (!m_active) return;
+        int pending = Objects::GetPendingRecordedFrames();
+        if (pending == 0 || (!all && pending * 2 < RING_FRAMES)) return;
+        Deliver(m_sim.download_recording());
+    }
+
+    // A world stopped early: frames past step are not its run
+    void EndWorld(size_t world, int step)
+    {
+        m_worldSteps[world] = std::min(m_worldSteps[world], step);
+    }
+
+    void Finish()
+    {
+        if (!m_active) return;
+        Poll(true);
+        m_active = false;
+        m_sim.stop_recording();
+    }
+
+private:
+    static const int RING_FRAMES = 64;
+
+    static std::vector<std::string> FieldsOf(const BatchObserver& observer)
+    {
+        if (!observer.fields.empty()) return observer.fields;
+        return std::vector<std::string>(std::begin(s_readbackFields), std::end(s_readbackFields));
+    }
+
+    static std::vector<int> ObjectsOf(const BatchObserver& observer, const ObjectWorlds::WorldRange& world)
+    {
+        if (!observer.objects.empty()) return observer.objects;
+        std::vector<int> all(world.count);
+        std::iota(all.begin(), all.end(), 0);
+        return all;
+    }
+
+    void Deliver(const TrajectoryRecording& recording)
+    {
+        size_t recordedFields = recording.fields.size();
+        for (size_t o = 0; o < m_observers.size(); ++o)
+        {
+            const BatchObserver& observer = m_observers[o];
+
+            // The first frame at or past each multiple of the observer's stride
+            std::vector<int> frames;
+            for (int f = 0; f < recording.frames; ++f)
+            {
+                int step = recording.steps[f];
+                if (step / observer.every_n_steps <= m_lastSteps[o] / observer.every_n_steps) continue;
+                frames.push_back(f);
+                m_lastSteps[o] = step;
+            }
+            if (frames.empty()) continue;
+
+            std::vector<std::string> fields = FieldsOf(observer);
+            std::vector<size_t> fieldColumns;
+            for (const std::string& field : fields)
+                fieldColumns.push_back(std::find(recording.fields.begin(), recording.fields.end(), field) - recording.fields.begin());
 
-// Check if simulation is paused
-bool SimulationWrapper::is_paused() const
-{
-    return m_paused;
-}
+            for (size_t w = 0; w < m_worlds.size(); ++w)
+            {
+                TrajectoryRecording view;
+                view.fields = fields;
+                view.objects = ObjectsOf(observer, m_worlds[w]);
+                view.dropped = recording.dropped;
+                std::vector<size_t> objectColumns;
+                for (int index : view.objects)
+                    objectColumns.push_back(std::lower_bound(recording.objects.begin(), recording.objects.end(),
+                                                             m_worlds[w].first + index) - recording.objects.begin());
+
+                size_t recordedObjects = recording.objects.size();
+                for (int f : frames)
+                {
+                    if (recording.steps[f] > m_worldSteps[w]) break;  // This world's run is over
+                    view.steps.push_back(recording.steps[f]);
+                    view.times.push_back(recording.times[f]);
+                    for (size_t object : objectColumns)
+                    {
+                        const float* record = &recording.values[(f * recordedObjects + object) * recordedFields];
+                        for (size_t column : fieldColumns) view.values.push_back(record[column]);
+                    }
+                    view.frames++;
+                }
+                if (view.frames > 0) observer.callback(m_firstBatch + static_cast<int>(w), view);
+            }
+        }
+    }
 
-// Reset simulation to initial state
-void SimulationWrapper::reset()
-{
-    ensure_initialized();
-    Objects::ResetToInitialConditions();
-    m_currentBuffer = 0;
-}
+    SimulationWrapper& m_sim;
+    const std::vector<BatchObserver>& m_observers;
+    std::vector<ObjectWorlds::WorldRange> m_worlds;
+    std::vector<int> m_worldSteps;
+    int m_firstBatch;
+    std::vector<int> m_lastSteps;   // Step of the last frame each observer got
+    bool m_active = false;
+};
 
 // Run batch simulations (for parameter studies, optimization, etc.)
 void SimulationWrapper::run_batch(
     const std::vector<BatchConfig>& configs,
-    std::function<void(int, const std::vector<ObjectState>&)> callback)
+    std::function<void(int, const std::vector<ObjectState>&)> callback,
+    bool ensemble,
+    const std::vector<BatchObserver>& observers,
+    int max_worlds)
 {
     ensure_initialized();
 
     if (!m_headless)
         throw std::runtime_error("Batch mode only available in headless mode");
+    if (max_worlds < 0)
+        throw std::runtime_error("max_worlds must be 0 or more");
+
+    // Stop conditions fail here rather than part way through the batch
+    for (const auto& config : configs)
+    {
+        StopCondition condition;
+        ParseStopCondition(config.stop_condition, condition);
+        CheckStopInterval(config);
+    }
+
+    if (ensemble)
+    {
+        // The queue in windows of max_worlds; each window starts from t = 0 like a run of its own
+        size_t window = max_worlds > 0 ? static_cast<size_t>(max_worlds) : std::max<size_t>(configs.size(), 1);
+        for (size_t first = 0; first < configs.size(); first += window)
+        {
+            std::vector<BatchConfig> slice(configs.begin() + first, configs.begin() + std::min(configs.size(), first + window));
+            run_ensemble(slice, {}, [&](int world, const std::vector<Object>& state)
+            {
+                int batch = static_cast<int>(first) + world;
+                std::vector<ObjectState> results;
+                results.reserve(state.size());
+                for (const Object& p : state)
+                    results.push_back(ToObjectState(p));
+
+                if (callback)
+                    callback(batch, results);
+                if (!configs[batch].output_file.empty())
+                    save_results(configs[batch].output_file, results);
+            }, observers, static_cast<int>(first));
+        }
+        return;
+    }
 
     // Run each configuration
     for (size_t i = 0; i < configs.size(); ++i)
@@ -1647,8 +5381,9 @@ void SimulationWrapper::run_batch(
         clear_all_constraints();
 
         // Remove any existing objects
-        while (object_count() > 0)
-            remove_object(0);
+        std::vector<int> existing(object_count());
+        std::iota(existing.begin(), existing.end(), 0);
+        remove_objects(existing);
 
         // Create objects from configuration
         for (const auto& pconfig : config.objects)
@@ -1675,6 +5410,7 @@ void SimulationWrapper::run_batch(
                     DistanceConstraint dc;
                     dc.target_object = constraint.target;
                     dc.rest_length = constraint.param1;
+                    dc.break_length = constraint.param2;
                     add_distance_constraint(pid, dc);
                 }
                 else if (constraint.type == 1)
@@ -1689,26 +5425,41 @@ void SimulationWrapper::run_batch(
             }
         }
 
-        // Run simulation for specified duration
+        // Run simulation for specified duration, or until the stop condition holds
         int steps = static_cast<int>(config.duration / config.dt);
+        StopCondition condition;
+        bool stoppable = ParseStopCondition(config.stop_condition, condition);
         std::vector<ObjectState> results;
+        BatchObservation observation(*this, observers, { { 0, object_count() } }, { steps }, static_cast<int>(i));
 
         for (int step = 0; step < steps; ++step)
         {
             update(config.dt);
+            observation.Poll(false);
+
+            bool stopped = stoppable && step < steps - 1 && (step + 1) % config.stop_check_interval == 0 &&
+                           object_count() > 0 && StopConditionHolds(condition, ReduceStopCondition(m_currentBuffer, condition)[0]);
 
-            // Capture final state
-            if (step == steps - 1)
+            // Capture final state, all objects in one readback
+            if (step == steps - 1 || stopped)
             {
+                observation.EndWorld(0, step + 1);
+                observation.Finish();
+
+                std::vector<Object> state;
+                Objects::FetchToCPU(m_currentBuffer, state);
                 results.clear();
-                for (int p = 0; p < object_count(); ++p)
-                    results.push_back(get_object(p));
+                results.reserve(state.size());
+                for (const Object& p : state)
+                    results.push_back(ToObjectState(p));
 
                 // Call callback with results
                 if (callback)
                     callback(static_cast<int>(i), results);
+                break;
             }
         }
+        observation.Finish();
 
         // Save results to file if specified
         if (!config.output_file.empty())
@@ -1716,6 +5467,573 @@ void SimulationWrapper::run_batch(
     }
 }
 
+// The objects, equations, collision shapes and constraints run_batch() would set up for config
+static void BuildCpuScene(const BatchConfig& config, CpuBackend::EquationSet& equations, CpuBackend::Scene& scene)
+{
+    const int numObjects = static_cast<int>(config.objects.size());
+    std::vector<Object> objects;
+    objects.reserve(numObjects);
+    for (const auto& pconfig : config.objects)
+    {
+        Object object = BuildObject(
+            pconfig.x, pconfig.y,
+            pconfig.vx, pconfig.vy,
+            pconfig.mass, pconfig.charge,
+            pconfig.rotation, pconfig.angular_velocity,
+            pconfig.skin,
+            pconfig.size,
+            pconfig.width, pconfig.height,
+            pconfig.r, pconfig.g, pconfig.b, pconfig.a,
+            pconfig.polygon_sides);
+
+        if (!pconfig.equation.empty())
+        {
+            std::string key;
+            ParsedEquation eq = ParseEquationWithMethod(pconfig.equation, "symbolic", key);
+            object.equationID = CpuBackend::AddEquation(equations, key, eq);
+        }
+        objects.push_back(object);
+    }
+
+    CpuBackend::Load(scene, objects);
+    for (int i = 0; i < numObjects; i++)
+    {
+        const ObjectConfig& pconfig = config.objects[i];
+        scene.collision[i].shapeType = static_cast<int>(CollisionShapeForSkin(pconfig.skin));
+
+        for (const auto& constraint : pconfig.constraints)
+        {
+            Constraint c{};
+            c.targetObjectID = -1;
+            if (constraint.type == 0)
+            {
+                if (constraint.target < 0 || constraint.target >= numObjects)
+                    throw std::runtime_error("Invalid target object");
+                if (constraint.target == i)
+                    throw std::runtime_error("Cannot create distance constraint to self");
+                if (constraint.param1 <= 0.0f)
+                    throw std::runtime_error("Distance constraint must have positive rest length");
+                c.type = CONSTRAINT_DISTANCE;
+                c.targetObjectID = constraint.target;
+                c.param1 = constraint.param1;
+            }
+            else if (constraint.type == 1)
+            {
+                c.type = CONSTRAINT_BOUNDARY;
+                c.param1 = constraint.param1;
+                c.param2 = constraint.param2;
+                c.param3 = constraint.param3;
+                c.param4 = constraint.param4;
+            }
+            else
+            {
+                continue;
+            }
+            scene.constraints[i].push_back(c);
+        }
+    }
+}
+
+void SimulationWrapper::run_batch_cpu(
+    const std::vector<BatchConfig>& configs,
+    std::function<void(int, const std::vector<ObjectState>&)> callback,
+    int threads,
+    float timestep)
+{
+    if (!(timestep > 0.0f))
+        throw std::runtime_error("timestep must be positive");
+    if (threads < 0)
+        throw std::runtime_error("threads must be 0 or more");
+    for (const auto& config : configs)
+        if (!Trimmed(config.stop_condition).empty())
+            throw std::runtime_error("Stop conditions are GPU reductions; run_batch_cpu() cannot check them");
+
+    CpuBackend::SetThreadCount(threads);
+
+    // Parsing throws on bad input, so every scene is built before anything runs
+    const int numConfigs = static_cast<int>(configs.size());
+    std::vector<CpuBackend::EquationSet> equations(numConfigs);
+    std::vector<CpuBackend::Scene> scenes(numConfigs);
+    for (int i = 0; i < numConfigs; i++)
+    {
+        equations[i] = CpuBackend::CreateEquationSet();
+        BuildCpuScene(configs[i], equations[i], scenes[i]);
+        scenes[i].params.dt = timestep;
+    }
+
+    // update(config.dt) once per step of config.dt, each taking at most 20 fixed steps
+    auto runConfig = [&](int i)
+    {
+        const BatchConfig& config = configs[i];
+        CpuBackend::Scene& scene = scenes[i];
+        const int MAX_STEPS_PER_FRAME = 20;
+        int updates = static_cast<int>(config.duration / config.dt);
+        float accumulator = 0.0f;
+        float simulationTime = 0.0f;
+        for (int update = 0; update < updates; ++update)
+        {
+            accumulator += config.dt;
+            for (int step = 0; accumulator >= timestep && step < MAX_STEPS_PER_FRAME; ++step)
+            {
+                simulationTime += timestep;
+                scene.params.time = simulationTime;
+                CpuBackend::Step(scene, equations[i]);
+                accumulator -= timestep;
+            }
+        }
+    };
+
+    if (numConfigs >= CpuBackend::GetThreadCount())
+    {
+        CpuBackend::ParallelFor(numConfigs, 1, [&](int begin, int end)
+        {
+            for (int i = begin; i < end; i++) runConfig(i);
+        });
+    }
+    else
+    {
+        for (int i = 0; i < numConfigs; i++) runConfig(i);
+    }
+
+    // Results are handed out on the calling thread, in configuration order
+    for (int i = 0; i < numConfigs; i++)
+    {
+        std::vector<ObjectState> results;
+        if (static_cast<int>(configs[i].duration / configs[i].dt) > 0)
+        {
+            std::vector<Object> state = CpuBackend::Store(scenes[i]);
+            results.reserve(state.size());
+            for (const Object& p : state)
+                results.push_back(ToObjectState(p));
+
+            if (callback)
+                callback(i, results);
+        }
+        if (!configs[i].output_file.empty())
+            save_results(configs[i].output_file, results);
+    }
+}
+
+// Every configuration becomes one ensemble world (object_worlds.h): the worlds are loaded
+// with one object upload and step together, each in its own dispatch-wide slice of the
+// object buffers. Object indices in equations and constraints are local to their world.
+// parameters, if not empty, holds one row per config; capture gets each world's final state.
+// A world whose stop condition holds is captured then and put to sleep for the rest of the
+// run, and the run ends once every world is done. firstBatch numbers the worlds for observers.
+void SimulationWrapper::run_ensemble(
+    const std::vector<BatchConfig>& configs,
+    const std::vector<ObjectWorlds::WorldParameters>& parameters,
+    std::function<void(int, const std::vector<Object>&)> capture,
+    const std::vector<BatchObserver>& observers,
+    int firstBatch)
+{
+    if (configs.empty()) return;
+
+    float dt = configs[0].dt;
+    size_t total = 0;
+    for (const auto& config : configs)
+    {
+        if (config.dt != dt)
+            throw std::runtime_error("Ensemble configurations must share one dt");
+        total += config.objects.size();
+    }
+    if (total > static_cast<size_t>(Objects::MAX_OBJECTS))
+        throw std::runtime_error("Maximum object limit reached");
+
+    reset();
+    clear_all_constraints();
+    std::vector<int> existing(object_count());
+    std::iota(existing.begin(), existing.end(), 0);
+    remove_objects(existing);
+
+    // All worlds in one upload, world w holding objects [worlds[w].first, + count)
+    std::vector<Object> objects;
+    std::vector<ObjectWorlds::WorldRange> worlds;
+    objects.reserve(total);
+    for (size_t w = 0; w < configs.size(); ++w)
+    {
+        worlds.push_back({ static_cast<int>(objects.size()), static_cast<int>(configs[w].objects.size()) });
+        for (const auto& pconfig : configs[w].objects)
+        {
+            Object o = BuildObject(pconfig.x, pconfig.y, pconfig.vx, pconfig.vy, pconfig.mass, pconfig.charge,
+                                   pconfig.rotation, pconfig.angular_velocity, pconfig.skin, pconfig.size,
+                                   pconfig.width, pconfig.height, pconfig.r, pconfig.g, pconfig.b, pconfig.a,
+                                   pconfig.polygon_sides);
+            o.worldID = static_cast<int>(w);
+            objects.push_back(o);
+        }
+    }
+    if (objects.empty()) return;
+    if (Objects::AddObjects(objects) != 0)
+        throw std::runtime_error("Failed to allocate object buffers");
+    if (!Objects::SetObjectWorlds(worlds) ||
+        (!parameters.empty() && !Objects::SetObjectWorldParameters(parameters)))
+        throw std::runtime_error("Failed to set up the ensemble worlds");
+
+    // Collision defaults per skin, equations per distinct string, constraints in bulk
+    std::map<PySkinType, std::vector<int>> bySkin;
+    std::map<std::string, std::vector<int>> byEquation;
+    std::vector<int> owners, targets;
+    std::vector<float> restLengths;
+    std::vector<float> breakLengths;
+    for (size_t w = 0; w < configs.size(); ++w)
+    {
+        int first = worlds[w].first;
+        for (size_t k = 0; k < configs[w].objects.size(); ++k)
+        {
+            const auto& pconfig = configs[w].objects[k];
+            int pid = first + static_cast<int>(k);
+            bySkin[pconfig.skin].push_back(pid);
+            if (!pconfig.equation.empty()) byEquation[pconfig.equation].push_back(pid);
+
+            for (const auto& constraint : pconfig.constraints)
+            {
+                if (constraint.type == 0)
+                {
+                    if (constraint.target < 0 || constraint.target >= worlds[w].count)
+                        throw std::runtime_error("Invalid target object");
+                    owners.push_back(pid);
+                    targets.push_back(first + constraint.target);
+                    restLengths.push_back(constraint.param1);
+                    breakLengths.push_back(constraint.param2);
+                }
+                else if (constraint.type == 1)
+                {
+                    BoundaryConstraint bc;
+                    bc.min_x = constraint.param1;
+                    bc.max_x = constraint.param2;
+                    bc.min_y = constraint.param3;
+                    bc.max_y = constraint.param4;
+                    add_boundary_constraint(pid, bc);
+                }
+            }
+        }
+    }
+    for (const auto& entry : bySkin)
+    {
+        Objects::SetCollisionShape(entry.second, ToCollisionShape(CollisionShapeForSkin(entry.first)));
+        Objects::SetCollisionEnabled(entry.second, true);
+        Objects::SetCollisionProperties(entry.second, 0.7f, 0.3f); // Default values
+    }
+    for (const auto& entry : byEquation)
+        batch_set_equation(entry.second, entry.first);
+    if (!owners.empty())
+        add_distance_constraints(owners, targets, restLengths, breakLengths);
+
+    if (Objects::EquationsUseLongRange())
+    {
+        std::vector<int> added(objects.size());
+        std::iota(added.begin(), added.end(), 0);
+        remove_objects(added);
+        throw std::runtime_error("Ensemble mode does not support long-range (Barnes-Hut) forces");
+    }
+
+    // Worlds sharing a stop condition are checked by one per-world reduction
+    std::map<std::string, std::pair<StopCondition, std::vector<int>>> stopGroups;
+    for (size_t w = 0; w < configs.size(); ++w)
+    {
+        StopCondition condition;
+        CheckStopInterval(configs[w]);
+        if (!ParseStopCondition(configs[w].stop_condition, condition)) continue;
+        auto& group = stopGroups[Trimmed(configs[w].stop_condition)];
+        group.first = condition;
+        group.second.push_back(static_cast<int>(w));
+    }
+
+    // Stopped worlds sleep until the run is over (object_sleep.h); plain sleep never sets in on its own
+    bool sleepEnabled = false;
+    float sleepVelocity = 0.0f, sleepAcceleration = 0.0f;
+    int sleepSteps = 0;
+    Objects::GetSleepParameters(sleepEnabled, sleepVelocity, sleepAcceleration, sleepSteps);
+    bool freezeDone = !stopGroups.empty();
+    if (freezeDone && !sleepEnabled) Objects::SetSleepParameters(true, 0.0f, 0.0f, std::numeric_limits<int>::max());
+    struct SleepRestore
+    {
+        bool restore, enabled;
+        float velocity, acceleration;
+        int steps;
+        ~SleepRestore()
+        {
+            if (!restore) return;
+            Objects::SetSleepParameters(enabled, velocity, acceleration, steps);
+            Objects::WakeAllObjects();
+        }
+    } sleepRestore{ freezeDone, sleepEnabled, sleepVelocity, sleepAcceleration, sleepSteps };
+
+    // Step every world together; a world's results are captured once its own duration is up
+    // or its stop condition holds
+    std::vector<int> worldSteps(configs.size());
+    std::vector<char> done(configs.size(), 0);
+    int maxSteps = 0;
+    size_t remaining = configs.size();
+    for (size_t w = 0; w < configs.size(); ++w)
+    {
+        worldSteps[w] = static_cast<int>(configs[w].duration / dt);
+        maxSteps = std::max(maxSteps, worldSteps[w]);
+        if (worldSteps[w] <= 0)
+        {
+            capture(static_cast<int>(w), {});  // As run_batch does for a run without steps
+            done[w] = 1;
+            remaining--;
+        }
+    }
+
+    BatchObservation observation(*this, observers, worlds, worldSteps, firstBatch);
+    for (int step = 0; step < maxSteps && remaining > 0; ++step)
+    {
+        update(dt);
+        observation.Poll(false);
+
+        std::vector<int> finished;
+        for (size_t w = 0; w < configs.size(); ++w)
+            if (!done[w] && worldSteps[w] == step + 1) finished.push_back(static_cast<int>(w));
+
+        for (const auto& entry : stopGroups)
+        {
+            const StopCondition& condition = entry.second.first;
+            const std::vector<int>& members = entry.second.second;
+            bool due = std::any_of(members.begin(), members.end(), [&](int w)
+            {
+                return !done[w] && worldSteps[w] > step + 1 && (step + 1) % configs[w].stop_check_interval == 0;
+            });
+            if (!due) continue;
+
+            std::vector<float> values = ReduceStopCondition(m_currentBuffer, condition);
+            for (int w : members)
+            {
+                if (done[w] || worldSteps[w] <= step + 1 || (step + 1) % configs[w].stop_check_interval != 0) continue;
+                if (worlds[w].count > 0 && StopConditionHolds(condition, values[w])) finished.push_back(w);
+            }
+        }
+        if (finished.empty()) continue;
+
+        for (int w : finished) observation.EndWorld(w, step + 1);
+        remaining -= finished.size();
+        if (remaining == 0) observation.Finish();
+
+        for (int w : finished)
+        {
+            std::vector<Object> state;
+            if (worlds[w].count > 0)
+                Objects::FetchToCPU(m_currentBuffer, worlds[w].first, worlds[w].count, state);
+            capture(w, state);
+            done[w] = 1;
+            if (freezeDone && remaining > 0) Objects::FreezeObjects(worlds[w].first, worlds[w].count);
+        }
+    }
+    observation.Finish();
+}
+
+// Per-world value a sweep parameter name refers to, nullptr if it cannot be swept
+static float* WorldParamField(ObjectWorlds::WorldParameters& row, const std::string& name)
+{
+    if (name == "gravity" || name == "g") return &row.gravity;
+    if (name == "damping" || name == "b") return &row.damping;
+    if (name == "stiffness" || name == "k") return &row.stiffness;
+    if (name == "coupling") return &row.coupling;
+    if (name == "drive_freq") return &row.driveFreq;
+    if (name == "drive_amp") return &row.driveAmp;
+    return nullptr;
+}
+
+// ============================================================================
+// Fork the live scene into ensemble worlds
+// ============================================================================
+
+// "sum(expr)", "mean(expr)", "min(expr)" or "max(expr)" of a fork() observable
+static void ParseObservable(const std::string& text, std::string& expression, ReductionOp& op)
+{
+    std::string source = Trimmed(text);
+    size_t open = source.find('(');
+    if (open == std::string::npos || source.back() != ')')
+        throw std::runtime_error("Invalid observable '" + text + "': expected sum(), mean(), min() or max()");
+    std::string name = Trimmed(source.substr(0, open));
+    if (name == "sum") op = REDUCE_SUM;
+    else if (name == "mean") op = REDUCE_MEAN;
+    else if (name == "min") op = REDUCE_MIN;
+    else if (name == "max") op = REDUCE_MAX;
+    else throw std::runtime_error("Invalid observable '" + text + "': unknown reduction '" + name + "'");
+    expression = Trimmed(source.substr(open + 1, source.size() - open - 2));
+    if (expression.empty()) throw std::runtime_error("Invalid observable '" + text + "': empty expression");
+}
+
+std::vector<float> SimulationWrapper::fork(int n,
+                                           const std::vector<std::pair<std::string, std::vector<float>>>& perturbations,
+                                           int steps, const std::vector<std::string>& observables, bool restore)
+{
+    ensure_initialized();
+    if (n < 1) throw std::runtime_error("fork() needs n >= 1");
+    if (steps < 0) throw std::runtime_error("steps must not be negative");
+    if (Objects::IsForked()) throw std::runtime_error("The scene is already forked; call end_fork() first");
+    if (Objects::GetNumObjectWorlds() > 0) throw std::runtime_error("Cannot fork an ensemble");
+    if (Objects::GetSpringCount() > 0) throw std::runtime_error("Cannot fork a scene with springs");
+    if (static_cast<long long>(object_count()) * (n + 1) > Objects::MAX_OBJECTS)
+        throw std::runtime_error("Maximum object limit reached");
+
+    std::vector<std::pair<std::string, ReductionOp>> reductions(observables.size());
+    for (size_t k = 0; k < observables.size(); ++k)
+        ParseObservable(observables[k], reductions[k].first, reductions[k].second);
+
+    // World w reads value w of each list (or its single value); the rest keep the current values
+    SimParams params = Objects::GetSimParams();
+    ObjectWorlds::WorldParameters defaults{};
+    defaults.stiffness = params.stiffness;
+    defaults.damping = params.damping;
+    defaults.gravity = params.gravity;
+    defaults.coupling = params.coupling;
+    defaults.driveFreq = params.driveFreq;
+    defaults.driveAmp = params.driveAmp;
+    std::vector<ObjectWorlds::WorldParameters> rows(static_cast<size_t>(n), defaults);
+    for (const auto& perturbation : perturbations)
+    {
+        if (!WorldParamField(defaults, perturbation.first))
+            throw std::runtime_error("Cannot perturb parameter: " + perturbation.first);
+        const std::vector<float>& values = perturbation.second;
+        if (values.size() != 1 && values.size() != static_cast<size_t>(n))
+            throw std::runtime_error("Perturbation " + perturbation.first + " must hold one value or n");
+        for (int w = 0; w < n; ++w)
+            *WorldParamField(rows[w], perturbation.first) = values.size() == 1 ? values[0] : values[w];
+    }
+
+    make_context_current();
+    if (object_count() == 0) return {};
+    if (!Objects::ForkWorlds(m_currentBuffer, n))
+        throw std::runtime_error("Failed to fork the scene (shader not ready, spawned objects or out of memory)");
+    m_forkTime = m_simulationTime;
+    m_forkParams = std::make_unique<SimParams>(params);
+    if (m_cpuMirror) m_cpuMirror->valid = false;
+    if (!Objects::SetObjectWorldParameters(rows))
+    {
+        end_fork();
+        throw std::runtime_error("Failed to set the parameters of the forked worlds");
+    }
+
+    // Only the reduced values come back: one float per world and observable
+    std::vector<float> values(static_cast<size_t>(n) * reductions.size(), 0.0f);
+    try
+    {
+        if (steps > 0) step(steps);
+        for (size_t k = 0; k < reductions.size(); ++k)
+        {
+            std::vector<float> perWorld;
+            std::string error;
+            if (!Objects::ReduceWorlds(m_currentBuffer, reductions[k].first, reductions[k].second, perWorld, error))
+                throw std::runtime_error("Observable '" + observables[k] + "' failed: " + error);
+            for (int w = 0; w < n && w < static_cast<int>(perWorld.size()); ++w)
+                values[static_cast<size_t>(w) * reductions.size() + k] = perWorld[w];
+        }
+    }
+    catch (...)
+    {
+        end_fork();
+        throw;
+    }
+    if (restore) end_fork();
+    return values;
+}
+
+void SimulationWrapper::end_fork()
+{
+    ensure_initialized();
+    if (!Objects::IsForked()) return;
+    make_context_current();
+    Objects::EndFork();
+    m_simulationTime = m_forkTime;
+    if (m_forkParams) Objects::SetSimParams(*m_forkParams);
+    m_forkParams.reset();
+    if (m_cpuMirror) m_cpuMirror->valid = false;
+}
+
+bool SimulationWrapper::is_forked() const
+{
+    ensure_initialized();
+    return Objects::IsForked();
+}
+
+void SimulationWrapper::set_world_tiles(const std::vector<int>& worlds, int columns)
+{
+    ensure_initialized();
+
+    if (columns < 0) throw std::runtime_error("columns must not be negative");
+    for (int world : worlds)
+        if (world < 0) throw std::runtime_error("Invalid world index");
+    WorldTiles::Set(worlds, columns);
+}
+
+void SimulationWrapper::clear_world_tiles()
+{
+    ensure_initialized();
+    WorldTiles::Clear();
+}
+
+SweepResult SimulationWrapper::sweep(
+    const BatchConfig& base,
+    const std::vector<std::pair<std::string, std::vector<float>>>& parameters,
+    const std::vector<std::string>& fields)
+{
+    ensure_initialized();
+
+    if (!m_headless)
+        throw std::runtime_error("Batch mode only available in headless mode");
+
+    SweepResult result;
+    result.fields = fields;
+    if (result.fields.empty()) result.fields.assign(std::begin(s_readbackFields), std::end(s_readbackFields));
+    for (const std::string& field : result.fields)
+    {
+        if (std::find(std::begin(s_readbackFields), std::end(s_readbackFields), field) == std::end(s_readbackFields))
+            throw std::runtime_error("Unknown field: " + field);
+    }
+
+    // Unswept parameters keep their current values
+    SimParams params = Objects::GetSimParams();
+    ObjectWorlds::WorldParameters defaults{};
+    defaults.stiffness = params.stiffness;
+    defaults.damping = params.damping;
+    defaults.gravity = params.gravity;
+    defaults.coupling = params.coupling;
+    defaults.driveFreq = params.driveFreq;
+    defaults.driveAmp = params.driveAmp;
+
+    result.points = 1;
+    for (const auto& parameter : parameters)
+    {
+        if (!WorldParamField(defaults, parameter.first))
+            throw std::runtime_error("Cannot sweep parameter: " + parameter.first);
+        if (parameter.second.empty())
+            throw std::runtime_error("Sweep parameter " + parameter.first + " has no values");
+        result.points *= parameter.second.size();
+    }
+    result.objects = base.objects.size();
+    if (result.points * result.objects > static_cast<size_t>(Objects::MAX_OBJECTS))
+        throw std::runtime_error("Maximum object limit reached");
+
+    // Point p takes value (p / stride) % size of each list, the last list with stride 1
+    std::vector<ObjectWorlds::WorldParameters> rows(result.points, defaults);
+    size_t stride = result.points;
+    for (const auto& parameter : parameters)
+    {
+        stride /= parameter.second.size();
+        for (size_t p = 0; p < result.points; ++p)
+            *WorldParamField(rows[p], parameter.first) = parameter.second[(p / stride) % parameter.second.size()];
+    }
+
+    BatchConfig point = base;
+    point.output_file.clear();
+    std::vector<BatchConfig> configs(result.points, point);
+
+    size_t numFields = result.fields.size();
+    result.values.assign(result.points * result.objects * numFields, 0.0f);
+    run_ensemble(configs, rows, [&](int world, const std::vector<Object>& state)
+    {
+        float* out = result.values.data() + static_cast<size_t>(world) * result.objects * numFields;
+        for (size_t o = 0; o < state.size() && o < result.objects; ++o)
+            for (size_t f = 0; f < numFields; ++f)
+                out[o * numFields + f] = ReadbackField(state[o], result.fields[f]);
+    });
+    return result;
+}
+
 // Save simulation results to CSV file
 void SimulationWrapper::save_results(
     const std::string& filename,
@@ -1754,16 +6072,38 @@ void SimulationWrapper::update_shader_loading()
 {
     ensure_initialized();
 
-    if (m_window)
-        glfwMakeContextCurrent(static_cast<GLFWwindow*>(m_window));
+    make_context_current();
 
     Objects::UpdateShaderLoadingStatus();
 
     if (!m_headless && m_window)
         glfwPollEvents();
 
+    // Hand queued work to the driver; waiting for it here would stall every caller's loop
     glFlush();
-    glFinish();
+}
+
+// Drive shader loading until every program is ready. Builds run on the driver's compiler threads
+// when it has parallel compile, so objects added before this call overlap with compilation.
+bool SimulationWrapper::wait_until_ready(float timeout)
+{
+    ensure_initialized();
+
+    auto start = std::chrono::steady_clock::now();
+    while (true)
+    {
+        make_context_current();
+        Objects::UpdateShaderLoadingStatus();
+        if (!m_headless && m_window)
+            glfwPollEvents();
+        if (Objects::AreAllShadersReady())
+            return true;
+
+        float waited = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+        if (timeout >= 0.0f && waited >= timeout)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
 }
 
 // Check if all shaders are loaded and ready
@@ -1794,6 +6134,7 @@ std::string SimulationWrapper::get_shader_load_status() const
 // Clean up all simulation resources
 void SimulationWrapper::cleanup()
 {
+    m_commands->Close("The simulation was cleaned up");
     if (!m_initialized) return;
 
     // Clean up axis system if initialized
@@ -1810,8 +6151,69 @@ void SimulationWrapper::cleanup()
         g_axisShaderProgram = 0;
     }
 
+    // Frames still being read back are encoded while the context is still there
+    if (m_capture)
+    {
+        try
+        {
+            stop_capture();
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to finish the video capture: " << e.what() << std::endl;
+        }
+    }
+
+    m_streamServer.reset();  // Disconnects the viewers
+    m_metricsExporter.reset();
+    m_sharedFrames.reset();  // Readers keep their mappings, the name goes
+    DomainDecomposition::Cleanup();
+    VulkanBackend::Cleanup();
+    CudaInterop::Cleanup();
+    m_sensitivityParameters.clear();
+
+    // Frames still on the GPU go to disk before the recorder's buffers are released
+    if (m_trajectoryWriter)
+    {
+        try
+        {
+            stop_recording();
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to finish the trajectory files: " << e.what() << std::endl;
+        }
+    }
+
+    // A checkpoint still being written finishes before the process can exit
+    try
+    {
+        wait_for_checkpoint();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to write the last checkpoint: " << e.what() << std::endl;
+    }
+    m_checkpointState.reset();
+    m_checkpointPath.clear();
+    m_cachedScenes.clear();
+
+    // Handles from step_async() still out report done from now on
+    for (const std::weak_ptr<StepFence>& weak : m_stepFences)
+    {
+        std::shared_ptr<StepFence> fence = weak.lock();
+        if (!fence || !fence->sync) continue;
+        glDeleteSync(fence->sync);
+        fence->sync = nullptr;
+    }
+    m_stepFences.clear();
+
     // Clean up object system
+    m_cpuMirror.reset();
     Objects::Cleanup();
+    GpuProfiler::Cleanup();
+    StepScheduler::Cleanup();
+    m_eglContext.reset();
 
     // Destroy window and terminate GLFW
     if (m_window)
@@ -1822,4 +6224,5 @@ void SimulationWrapper::cleanup()
 
     glfwTerminate();
     m_initialized = false;
+    if (g_engineOwner == this) g_engineOwner = nullptr;
 }
\ No newline at end of file
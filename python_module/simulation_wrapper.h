@@ -6,11 +6,32 @@
 #include <functional>
 #include <fstream>
 #include <vector>
+#include <tuple>
+#include <map>
+#include <memory>
+#include <future>
+#include <chrono>
+#include "../include/contact_events.h"
+#include "../include/object_streaming.h"
 
 // Forward declarations to avoid including all headers
 struct ObjectState;
 struct DistanceConstraint;
 struct BoundaryConstraint;
+struct Object;
+class TrajectoryWriter;
+class StateStreamServer;
+class MetricsExporter;
+class CommandQueue;
+class SharedFrameWriter;
+class VideoCapture;
+class EglContext;
+struct SceneSnapshot;
+struct SimParams;
+struct CpuSceneMirror;
+struct StepFence;
+struct BuiltEquation;
+namespace ObjectWorlds { struct WorldParameters; }
 
 // Python-friendly enums
 enum class PySkinType
@@ -60,6 +81,33 @@ struct BatchUpdateData {
     float a;
 };
 
+// Columns of add_objects: each holds one value per object, a single value for all of them,
+// or nothing (the add_object default)
+struct BulkObjectData {
+    std::vector<float> x, y, vx, vy, mass, charge, rotation, angular_velocity;
+    std::vector<float> size, width, height, r, g, b, a;
+    PySkinType skin = PySkinType::PY_SKIN_CIRCLE;
+    int polygon_sides = 6;
+};
+
+// Arguments of spawn: count objects placed on the GPU, all alike but for position and velocity
+struct SpawnRequest {
+    int count = 0;
+    std::string distribution = "uniform_disk";  // Or an "x_expr, y_expr" position expression
+    float center[2] = { 0.0f, 0.0f };
+    float extent = 1.0f;
+    int columns = 0;
+    unsigned int seed = 0;
+    std::string velocity;                       // "vx_expr, vy_expr", empty = at rest
+    std::string equation;                       // Empty = the default equation
+    std::string derivative_method = "symbolic";
+    PySkinType skin = PySkinType::PY_SKIN_CIRCLE;
+    float size = 0.3f, width = 0.5f, height = 0.3f;
+    float mass = 1.0f, charge = 0.0f;
+    float r = 1.0f, g = 1.0f, b = 1.0f, a = 1.0f;
+    int polygon_sides = 6;
+};
+
 struct BatchGetData {
     float x;
     float y;
@@ -84,9 +132,10 @@ struct BatchGetData {
 struct DistanceConstraint {
     int target_object;
     float rest_length;   // Desired distance between objects
+    float break_length;  // Dropped once stretched past this distance, 0 = never
 
-    DistanceConstraint(int target = 0, float length = 5.0f)
-        : target_object(target), rest_length(length) {
+    DistanceConstraint(int target = 0, float length = 5.0f, float breakLength = 0.0f)
+        : target_object(target), rest_length(length), break_length(breakLength) {
     }
 };
 
@@ -115,12 +164,21 @@ enum class PyCollisionShape {
     POLYGON = 3
 };
 
+enum class PyBroadphaseMode {
+    ALL_PAIRS = 0,
+    UNIFORM_GRID = 1,
+    LBVH = 2
+};
+
 // collision property struct
 struct CollisionConfig {
     bool enabled = true;
     PyCollisionShape shape = PyCollisionShape::NONE;
     float restitution = 0.7f;
     float friction = 0.3f;
+    unsigned int category = 0x00000001u;
+    unsigned int mask = 0xFFFFFFFFu;
+    bool continuous = false;
 };
 
 struct ObjectConfig
@@ -147,6 +205,105 @@ struct BatchConfig
     float duration = 10.0f;
     float dt = 0.016f;
     std::string output_file = "";
+    // Ends the run before duration once it holds: "any(expr < c)", "all(expr >= c)" or
+    // "sum|mean|min|max(expr) > c" over the configuration's objects, with < <= > >=. Checked
+    // as a GPU reduction every stop_check_interval steps; p[i] is the configuration's i-th object.
+    std::string stop_condition = "";
+    int stop_check_interval = 10;
+};
+
+// Final states of a sweep(): values[(point * objects + object) * fields.size() + field]
+struct SweepResult
+{
+    std::vector<float> values;
+    size_t points = 0;
+    size_t objects = 0;
+    std::vector<std::string> fields;
+};
+
+// Pending copy of the object state from Simulation::fetch_async(); the GPU keeps simulating
+// while it is in flight and result() only waits if the copy has not landed yet
+class ReadbackFuture
+{
+public:
+    ReadbackFuture(int handle, std::vector<std::string> fields);
+    ~ReadbackFuture();
+    ReadbackFuture(const ReadbackFuture&) = delete;
+    ReadbackFuture& operator=(const ReadbackFuture&) = delete;
+
+    bool ready() const;
+    std::map<std::string, std::vector<float>> result();
+
+private:
+    int m_handle;
+    std::vector<std::string> m_fields;
+    bool m_resolved = false;
+    std::map<std::string, std::vector<float>> m_result;
+};
+
+// Steps submitted by Simulation::step_async(); the fence behind them is only polled, so Python
+// runs on while the GPU works. The simulation's cleanup() resolves every handle still out.
+class StepHandle
+{
+public:
+    StepHandle(std::shared_ptr<StepFence> fence, int steps);
+    ~StepHandle();
+    StepHandle(const StepHandle&) = delete;
+    StepHandle& operator=(const StepHandle&) = delete;
+
+    bool ready();
+    bool wait(float timeout);  // Seconds, < 0 = until done; false if it timed out
+    int steps() const { return m_steps; }
+
+private:
+    std::shared_ptr<StepFence> m_fence;
+    int m_steps;
+};
+
+// One field of every object on the device, from map_device_field(): element (object, component)
+// is the float at data + object * stride + component
+struct DeviceFieldView
+{
+    void* data = nullptr;
+    int device = 0;      // CUDA ordinal
+    int count = 0;       // Objects
+    int components = 1;  // 1 for a scalar field, else the vector length
+    int stride = 0;      // Floats between consecutive objects
+};
+
+// Frames from download_recording(): values[(frame * objects + object) * fields.size() + field]
+struct TrajectoryRecording
+{
+    std::vector<float> values;
+    std::vector<int> steps;       // Steps since record() at each frame
+    std::vector<float> times;     // Simulation time of each frame
+    std::vector<int> objects;     // Recorded object indices
+    std::vector<std::string> fields;
+    std::vector<float> quantizationBox;  // min_x, min_y, max_x, max_y of a quantized recording, else empty
+    int frames = 0;
+    int dropped = 0;              // Frames the ring overwrote before this download
+};
+
+// Per-step observer of run_batch(): the fields of the listed objects (indices local to the
+// configuration, empty = all) every every_n_steps steps, handed to callback(batch_index,
+// frames) in chunks as the recording ring fills. Object indices in the frames are local too.
+struct BatchObserver
+{
+    std::vector<std::string> fields;   // Empty = every readback field
+    int every_n_steps = 1;
+    std::vector<int> objects;
+    std::function<void(int, const TrajectoryRecording &)> callback;
+};
+
+// Bytes of one object record in a StateView - MUST MATCH sizeof(Object) in objects.h
+const size_t OBJECT_RECORD_BYTES = 96;
+
+// Host copy of every object that NumPy arrays alias without copying. sync() overwrites it in
+// place until the object capacity grows past it, and arrays keep it alive after the simulation is gone.
+struct StateView
+{
+    std::vector<unsigned char> records;  // OBJECT_RECORD_BYTES per object, room for the object capacity
+    int count = 0;                       // Objects copied by the last sync()
 };
 
 class SimulationWrapper
@@ -157,17 +314,87 @@ private:
     bool m_paused;
     void *m_window;
     int m_currentBuffer;
+    uint64_t m_droppedCollisionEvents = 0;  // Since set_collision_events() turned the stream on
     std::string m_title;
     int m_width, m_height;
     float m_simulationTime = 0.0f;
+    float m_stepAccumulator = 0.0f;  // Time update() has been given but not stepped yet
+    int m_lastUpdateSteps = 0;
+    double m_droppedSimulationTime = 0.0;  // Lag past the max_lag of set_step_budget
+    bool m_escWasPressed = false;
     bool m_enable_grid;
+    bool m_fuseSubsteps = false;
+    bool m_renderInterpolation = false;  // render() blends between the last two steps
+    float m_timestep = 0.001f;  // Fixed step update() advances by
+    std::shared_ptr<StateView> m_stateView;  // Filled by sync(), aliased by state_view() arrays
+    std::vector<std::string> m_recordFields;  // What record() asked for
+    std::vector<int> m_recordObjects;
+    unsigned int m_recordFieldMask = 0;
+    int m_recordCapacity = 0;
+    std::vector<float> m_recordQuantizationBox;  // Empty unless record() quantizes
+    std::vector<std::string> m_sensitivityParameters;  // Names given to set_sensitivities()
+    std::unique_ptr<TrajectoryWriter> m_trajectoryWriter;  // Set when record() streams to disk
+    std::unique_ptr<StateStreamServer> m_streamServer;     // Set between start_stream_server() and stop_stream_server()
+    std::unique_ptr<SharedFrameWriter> m_sharedFrames;     // Set between start_shared_frames() and stop_shared_frames()
+    double m_streamInterval = 0.0;                         // Seconds between broadcast frames
+    std::chrono::steady_clock::time_point m_streamLastFrame;
+    std::unique_ptr<VideoCapture> m_capture;               // Set between start_capture() and stop_capture()
+    std::unique_ptr<MetricsExporter> m_metricsExporter;    // Set between start_metrics_server() and stop_metrics_server()
+    double m_metricsInterval = 1.0;                        // Seconds between published pages
+    std::chrono::steady_clock::time_point m_metricsLastPublish;
+    uint64_t m_metricsLastSteps = 0;                       // m_stepsTaken and readback bytes at the last page
+    uint64_t m_metricsLastReadback = 0;
+    float m_metricsLastTime = 0.0f;                        // m_simulationTime at the last page
+    uint64_t m_stepsTaken = 0;                             // Every step run_steps() has run
+    std::unique_ptr<EglContext> m_eglContext;        // Headless context when m_window is null
+    std::string m_checkpointPath;                    // Base snapshot the delta log belongs to
+    unsigned int m_checkpointSequence = 0;           // Deltas written since the base
+    std::unique_ptr<SceneSnapshot> m_checkpointState;  // Host-side state as of the last checkpoint, objects excluded
+    std::future<void> m_checkpointWrite;             // File write of the last checkpoint
+    float m_forkTime = 0.0f;                         // Simulation time when the fork started
+    std::unique_ptr<SimParams> m_forkParams;         // Parameters end_fork() puts back
+    int m_historyInterval = 0;                       // Steps between history snapshots, 0 = off
+    int m_historySteps = 0;                          // Steps since the last one
+    std::map<std::string, std::unique_ptr<SceneSnapshot>> m_cachedScenes;  // Host tables of the scenes in SceneCache, objects excluded
+    std::string m_backend = "auto";                  // "gpu", "cpu", "vulkan" or "auto": where update() steps
+    int m_backendCrossover = -1;                     // Auto: objects from which the GPU is faster, -1 = not measured
+    int m_steppedBackend = 0;                        // Backend of the last update(): 0 GPU, 1 CPU, 2 Vulkan
+    std::unique_ptr<CpuSceneMirror> m_cpuMirror;     // The scene as cpu_backend.h and vulkan_backend.h step it
+    std::vector<std::weak_ptr<StepFence>> m_stepFences;  // Of the StepHandles step_async() returned
+    std::shared_ptr<CommandQueue> m_commands;        // Drained at the start of update() and step()
 
     bool init_headless();
+    bool init_egl();  // Windowless headless context; false falls back to a hidden GLFW window
+    void make_context_current();
     bool init_windowed(int width, int height, const std::string &title);
     void ensure_initialized() const;
 
-    // Helper for batch mode
-    void save_results(const std::string &filename, const std::vector<ObjectState> &states);
+    // Helpers for batch mode
+    static void save_results(const std::string &filename, const std::vector<ObjectState> &states);
+    TrajectoryRecording collect_recording(int newest = 0);
+    SceneSnapshot capture_snapshot(const std::vector<std::string> &metadata, bool objects = true);
+    void save_snapshot(const std::string &filename, const std::vector<std::string> &metadata);
+    void load_snapshot(const std::string &filename);
+    // cachedObjects names a SceneCache scene whose objects replace snapshot.objects
+    void apply_snapshot(SceneSnapshot &snapshot, const std::string &source, const std::string &cachedObjects = "");
+    void wait_for_checkpoint();  // Rethrows an error of the last checkpoint write
+    void stream_recording(bool all);  // Hand pending frames to m_trajectoryWriter
+    void broadcast_recording();       // Hand the newest frame to m_streamServer when one is due
+    void publish_recording();         // Hand every pending frame to m_sharedFrames
+    void publish_metrics(bool force); // Render the page m_metricsExporter serves, once per interval unless forced
+    void draw_scene(int width, int height);  // Grid, trails and objects into the bound framebuffer
+    bool use_cpu_backend();           // Where the next steps of update() run
+    bool use_vulkan_backend();        // "vulkan" and VulkanBackend::CanStep() the mirrored scene
+    int run_steps(int count, float fixedStep, bool adaptive);  // Exactly count steps, returns them
+    void push_history(int steps);     // Snapshot when the history interval is reached
+    void finish_steps();  // Recording and streaming after the steps
+    void sync_cpu_mirror();           // Rebuild m_cpuMirror if the scene changed since it was built
+    void calibrate_backend();         // Time both backends on the current scene, set m_backendCrossover
+    void run_ensemble(const std::vector<BatchConfig> &configs,
+                      const std::vector<ObjectWorlds::WorldParameters> &parameters,
+                      std::function<void(int, const std::vector<Object> &)> capture,
+                      const std::vector<BatchObserver> &observers = {},
+                      int firstBatch = 0);
 
 public:
     SimulationWrapper(bool headless = true, int width = 1280, int height = 720,
@@ -176,9 +403,44 @@ public:
 
     void set_grid_enabled(bool enabled) { m_enable_grid = enabled; }
     bool get_grid_enabled() const { return m_enable_grid; }
+    void set_trails(int object_count, int length);
+    std::tuple<int, int> get_trails() const;
+    void set_force_field(const std::string& ax, const std::string& ay,
+                         std::tuple<float, float, float, float> bounds = { -10.0f, 10.0f, -10.0f, 10.0f },
+                         std::tuple<int, int> resolution = { 64, 64 }, float scale = 0.1f);
+    void clear_force_field();
+    void set_render_interpolation(bool enabled);
+    bool get_render_interpolation() const { return m_renderInterpolation; }
+    float get_interpolation_fraction() const;
+    void set_density_rendering(bool enabled, float exposure = 8.0f);
+    std::tuple<bool, float> get_density_rendering() const;
+    void set_constraint_rendering(bool enabled, float strain_scale = 0.1f);
+    std::tuple<bool, float> get_constraint_rendering() const;
+    void set_profiling(bool enabled);
+    std::map<std::string, std::map<std::string, double>> get_profile() const;
+    void set_step_budget(float budget_ms = 0.0f, int max_steps = 20, float max_lag = 0.0f);
+    std::map<std::string, double> get_step_stats() const;
+    void start_trace();
+    void set_counters(bool enabled, int interval = 16);
+    std::tuple<std::map<std::string, double>, std::vector<double>> get_counters() const;
+    void set_collision_events(bool enabled, uint32_t category_mask = 0xFFFFFFFFu,
+                              int capacity = ContactEvents::CONTACT_EVENTS_DEFAULT_CAPACITY);
+    std::vector<ContactEvent> take_collision_events();
+    uint64_t get_dropped_collision_events() const { return m_droppedCollisionEvents; }
+    std::vector<std::tuple<std::string, std::string, size_t, size_t>> memory_report() const;
+    void stop_trace(const std::string& path);
 
     // Core simulation
     void update(float dt);
+    int step(int n_steps);
+    std::unique_ptr<StepHandle> step_async(int n_steps);
+    // Particles far beyond the object buffers, advanced in place chunk by chunk; the scene must
+    // be empty and every particle runs behaviour group group's equation
+    int step_streamed(StreamedParticles particles, int n_steps, int group, int chunk);
+    // Commands other threads submitted (command_queue.h); update(), step() and step_async()
+    // run them first, this runs them without stepping. Returns how many ran.
+    std::shared_ptr<CommandQueue> commands() const { return m_commands; }
+    int process_commands();
 
     // ENHANCED object creation with FULL property control including rotation and dimensions
     int add_object(
@@ -192,8 +454,18 @@ public:
         float r = 1.0f, float g = 1.0f, float b = 1.0f, float a = 1.0f,
         int polygon_sides = 6);
 
+    int add_objects(const BulkObjectData& data);  // Returns the first new index
+    int spawn(const SpawnRequest& request);         // Returns the first new index
     void remove_object(int index);
+    void remove_objects(const std::vector<int>& indices);
     int object_count() const;
+    int object_handle(int index) const;
+    int object_index(int handle) const;
+    std::vector<std::vector<int>> query_radius(const std::vector<std::tuple<float, float>>& points, float radius) const;
+    std::vector<std::vector<int>> query_aabb(const std::vector<std::tuple<float, float, float, float>>& boxes) const;
+    std::vector<std::tuple<int, float, float, float>> raycast(const std::vector<std::tuple<float, float>>& origins,
+                                                              const std::vector<std::tuple<float, float>>& dirs,
+                                                              float max_dist) const;
     ObjectState get_object(int index) const;
 
     // ENHANCED update with rotation and dimensions
@@ -209,6 +481,70 @@ public:
     //batch get and update
     std::vector<BatchGetData> batch_get(const std::vector<int>& indices) const;
     void batch_update(const std::vector<BatchUpdateData>& updates);
+    float reduce(const std::string& expression, const std::string& op) const;
+    // expression at caller-given points: columns x, y, vx, vy, ax, ay, theta, omega, r, g, b,
+    // a, mass, charge, each one value per point, a single value for all, or empty (its default)
+    std::vector<float> evaluate(const std::string& expression, const std::vector<std::vector<float>>& columns) const;
+    // Bin counts of one expression (bins[0]) or two (both bins); range is (min, max) per
+    // expression, empty = each expression's min and max over the objects
+    std::vector<uint32_t> histogram(const std::vector<std::string>& expressions, const std::vector<int>& bins,
+                                    const std::vector<float>& range) const;
+    // Named object groups and the per-step aggregates equations read as agg[name]
+    void set_group(const std::string& name, const std::vector<int>& indices);
+    std::vector<int> get_group(const std::string& name) const;
+    void set_aggregate(const std::string& name, const std::string& expression, const std::string& op,
+                       const std::string& group);
+    void remove_aggregate(const std::string& name);
+    float get_aggregate(const std::string& name) const;
+    std::unique_ptr<ReadbackFuture> fetch_async(const std::vector<std::string>& fields) const;
+    int sync();
+    std::shared_ptr<const StateView> state_view() const { return m_stateView; }
+
+    // Append fields of the objects (all of them if empty) to a GPU ring of capacity frames
+    // every every_n_steps steps; download_recording() collects the frames in one transfer.
+    // With an output_dir, update() instead streams every frame to .npy files there from a
+    // background thread, finished by stop_recording().
+    // A quantize_box (min_x, min_y, max_x, max_y) packs positions to 16 bits in it and
+    // velocities to half floats on the GPU; the frames come back dequantized.
+    void record(const std::vector<std::string>& fields, int every_n_steps, int capacity,
+                const std::vector<int>& object_indices = {}, const std::string& output_dir = "",
+                const std::vector<float>& quantize_box = {});
+    TrajectoryRecording download_recording();
+    void stop_recording();
+
+    // Serve the recording to remote viewers over TCP (state_stream.h): rate_hz times a second
+    // update() reads back only the newest recorded frame and hands it to a background thread
+    // that sends every client quantized deltas. Returns the port listened on.
+    int start_stream_server(int port, float rate_hz, const std::string& host, const std::vector<float>& quantize_box);
+
+    // Map the current object buffer into CUDA (cuda_interop.h) and point at one field of it;
+    // writes through the pointer are what the next step reads. The mapping lasts until the
+    // next call into the simulation, which hands the buffer back to GL.
+    DeviceFieldView map_device_field(const std::string& field);
+    void release_device_mapping();
+    void stop_stream_server();
+    std::map<std::string, double> get_stream_server_stats() const;
+
+    // Serve Prometheus metrics over HTTP from a background thread (metrics_exporter.h): steps
+    // every interval seconds render throughput, lag, pass timings, object and equation counts,
+    // buffer memory and readback traffic into the page it serves. Returns the port listened on.
+    int start_metrics_server(int port, float interval, const std::string& host);
+    void stop_metrics_server();
+    long long get_metrics_scrapes() const;  // Pages served since start_metrics_server()
+
+    // Publish every recorded frame into a shared-memory ring of slots frames (shared_frames.h)
+    // that other processes map and read in place; update() reads back the pending frames.
+    void start_shared_frames(const std::string& name, int slots);
+    void stop_shared_frames();
+    long long get_shared_frame_count() const;  // Frames published since start_shared_frames()
+
+    // Split the world along x across the MPI ranks (domain_decomposition.h): each step hands
+    // objects that left this rank's slab to their owner and refreshes the ghosts within halo.
+    // x_range (min, max) defaults to the world box
+    void start_domain_decomposition(float halo, std::tuple<float, float> x_range);
+    void stop_domain_decomposition();
+    std::map<std::string, double> get_domain_stats() const;
+    std::map<std::string, double> advance_event_driven(float duration, float collapse_time, long long max_events);
 
     // NEW: Convenience methods for specific properties
     void set_rotation(int index, float rotation);
@@ -217,12 +553,48 @@ public:
     void set_radius(int index, float radius);
     float get_rotation(int index) const;
     float get_angular_velocity(int index) const;
+    void set_parameters(int index, const std::vector<float>& values, int first = 0);
+    std::vector<float> get_parameters(int index) const;
+    void set_state(int index, const std::vector<float>& values, int first = 0);
+    std::vector<float> get_state(int index) const;
+
+    // Forward parameter sensitivities (object_sensitivity.h)
+    void set_sensitivities(const std::vector<std::string>& parameters);
+    const std::vector<std::string>& get_sensitivity_parameters() const { return m_sensitivityParameters; }
+    void reset_sensitivities();
+    std::vector<float> get_sensitivities() const;
 
     // Equations
-    void set_equation(int object_index, const std::string &equation_string);
+    void set_equation(int object_index, const std::string &equation_string,
+                      const std::string &derivative_method = "symbolic");
+    void batch_set_equation(const std::vector<int> &indices, const std::string &equation_string,
+                            const std::string &derivative_method = "symbolic");
+    void set_equations(const std::vector<int> &indices, const std::vector<std::string> &equation_strings,
+                       const std::string &derivative_method = "symbolic");
+    // The same for equations built with stellar.expr, registered under their text form
+    void set_equation(int object_index, const BuiltEquation &equation);
+    void batch_set_equation(const std::vector<int> &indices, const BuiltEquation &equation);
+    void set_equations(const std::vector<int> &indices, const std::vector<BuiltEquation> &equations);
+    // Behaviour groups (Objects::SetEquationGroup): members run the group's equation, so switching
+    // it costs one table write whatever the membership
+    void set_equation_group(const std::vector<int> &indices, int group);
+    void set_group_equation(int group, const std::string &equation_string,
+                            const std::string &derivative_method = "symbolic");
+    void set_group_equation(int group, const BuiltEquation &equation);
+    void clear_group_equation(int group);
+    std::string get_group_equation(int group) const;  // Registration key, "" = none
+    // Colour components of the object's equation (shared by every object running it) are
+    // evaluated every interval-th step; 0 = only on the last step of each update()
+    void set_color_interval(int object_index, int interval);
+    int get_color_interval(int object_index) const;
+    void set_step_interval(int object_index, int interval);
+    int get_step_interval(int object_index) const;
 
     // Constraints
     void add_distance_constraint(int object_index, const DistanceConstraint &constraint);
+    void add_distance_constraints(const std::vector<int> &object_indices, const std::vector<int> &targets,
+                                  const std::vector<float> &rest_lengths,
+                                  const std::vector<float> &break_lengths = {});
     void add_boundary_constraint(int object_index, const BoundaryConstraint &constraint);
     void clear_constraints(int object_index);
     void clear_all_constraints();
@@ -233,12 +605,116 @@ public:
     void set_collision_properties(int index, float restitution, float friction);
     CollisionConfig get_collision_config(int index);
     void enable_collision_between(int obj1, int obj2, bool enable);
+    void set_collision_filter(int index, unsigned int category, unsigned int mask);
+    void set_continuous_collision(int index, bool enabled);
+    void batch_set_collision_enabled(const std::vector<int>& indices, bool enabled);
+    void batch_set_collision_shape(const std::vector<int>& indices, PyCollisionShape shape);
+    void batch_set_collision_properties(const std::vector<int>& indices, float restitution, float friction);
+    void batch_set_collision_filter(const std::vector<int>& indices, unsigned int category, unsigned int mask);
+    void batch_set_continuous_collision(const std::vector<int>& indices, bool enabled);
     bool is_collision_enabled(int index);
+    void set_object_static(int index, bool is_static);
+    bool is_object_static(int index);
+    int get_static_object_count() const;
+    void set_object_kinematic(int index, int table_x, int table_y, float period);
+    void set_object_keyframes(int index, const std::vector<std::tuple<float, float, float>>& keyframes,
+                              int table_x, int table_y, bool loop);
+    void clear_object_kinematic(int index);
+    bool is_object_kinematic(int index);
+    int get_kinematic_object_count() const;
+    void set_sdf_collider(const std::string& expression);
+    void clear_sdf_collider();
+    void set_sdf_grid(const std::vector<std::vector<float>>& distances, std::tuple<float, float, float, float> box);
+    void clear_sdf_grid();
+    void set_sdf_surface(float restitution, float friction);
     void set_collision_parameters(bool enable_warm_start, int max_contact_iterations);
     std::pair<bool, int> get_collision_parameters() const;
+    int get_contact_count() const;
+    void set_broadphase_mode(PyBroadphaseMode mode);
+    PyBroadphaseMode get_broadphase_mode() const;
+    void set_narrowphase_buckets(bool enabled);
+    bool get_narrowphase_buckets() const;
+    void set_neighbour_skin(float skin);
+    float get_neighbour_skin() const;
+    void set_small_world_objects(int objects);
+    int get_small_world_objects() const;
+    int get_broadphase_rebuilds() const;
+    void set_equation_compile_mode(bool enabled);
+    bool get_equation_compile_mode() const;
+    void set_equation_cache(const std::string &directory);
+    std::string get_equation_cache() const;
+    void set_register_bytecode_enabled(bool enabled);
+    bool get_register_bytecode_enabled() const;
+    void set_fast_math(bool enabled, int scan_interval, bool rollback);
+    std::tuple<bool, int, bool> get_fast_math() const;
+    std::tuple<int, std::vector<int>> get_invalid_objects() const;
+    int get_nan_rollback_count() const;
+    void set_dispatch_reorder_interval(int steps);
+    int get_dispatch_reorder_interval() const;
+    void set_storage_reorder_interval(int steps);
+    int get_storage_reorder_interval() const;
+    void tune_workgroup_sizes(bool force = false);
+    bool is_workgroup_tuning() const;
+    std::tuple<int, int, int> get_workgroup_sizes() const;
+    void set_soa_storage_enabled(bool enabled, bool quantized = false);
+    bool get_soa_storage_enabled() const;
+    bool get_soa_storage_quantized() const;
+    void set_fused_substeps(bool enabled);
+    bool get_fused_substeps() const;
+    void set_long_range_parameters(float theta, float gravity_constant, float coulomb_constant, float softening);
+    std::tuple<float, float, float, float> get_long_range_parameters() const;
+    void set_long_range_method(const std::string& method, int mesh_size,
+                               std::tuple<float, float, float, float> periodic_box);
+    std::tuple<std::string, int, std::tuple<float, float, float, float>> get_long_range_method() const;
+    void set_world_bounds(const std::string& mode, std::tuple<float, float, float, float> box);
+    std::tuple<std::string, std::tuple<float, float, float, float>> get_world_bounds() const;
+    void set_random_seed(uint32_t seed);
+    uint32_t get_random_seed() const;
+    void set_metropolis(bool enabled, float step_size, std::tuple<float, float, float, float> histogram_box,
+                        std::tuple<int, int> histogram_bins);
+    std::tuple<uint64_t, std::vector<uint32_t>, std::vector<std::vector<uint32_t>>> get_metropolis_stats() const;
+    void clear_metropolis_stats();
+    void set_table(int id, const std::vector<float>& values, std::tuple<float, float> x_range,
+                   const std::string& interpolation);
+    void set_field(int id, const std::vector<std::vector<float>>& values, std::tuple<float, float, float, float> box);
+    void clear_table(int id);
+    void clear_field(int id);
+    void set_grid(std::tuple<int, int> resolution, std::tuple<float, float, float, float> box, const std::string& boundary);
+    void set_grid_field(const std::string& name, const std::string& expression,
+                        const std::vector<std::vector<float>>& values, int field_id);
+    std::vector<std::vector<float>> get_grid_field(const std::string& name);
+    void show_grid_field(const std::string& name, std::tuple<float, float> value_range, float opacity);
+    void clear_grid();
+    void set_pipeline(const std::vector<std::string>& passes);
+    std::vector<float> get_pipeline_field(const std::string& name);
+    void clear_pipeline();
+    void set_adaptive_timestep(bool enabled, float min_dt, float max_dt, float courant);
+    std::tuple<bool, float, float, float> get_adaptive_timestep() const;
+    std::vector<float> get_timestep_history() const;
+    void set_sleep_parameters(bool enabled, float velocity_threshold, float acceleration_threshold, int steps);
+    std::tuple<bool, float, float, int> get_sleep_parameters() const;
+    int get_awake_object_count() const;
+    void wake_all_objects();
+    void set_xpbd_constraints(bool enabled, int iterations, float compliance);
+    std::tuple<bool, int, float> get_xpbd_constraints() const;
+    std::tuple<int, int> get_xpbd_graph() const;
+    void set_springs(const std::vector<int>& endpoints, const std::vector<float>& stiffness,
+                     const std::vector<float>& damping, const std::vector<float>& rest_length);
+    void clear_springs();
+    int get_spring_count() const;
+    void set_implicit_springs(bool enabled, int iterations, float tolerance);
+    std::tuple<bool, int, float> get_implicit_springs() const;
+    int add_particle_emitter(int template_index, float rate, float offset_x, float offset_y,
+                             float velocity_x, float velocity_y, float position_spread, float velocity_spread,
+                             float lifetime, bool kill_when_transparent, bool kill_outside,
+                             float bounds_min_x, float bounds_min_y, float bounds_max_x, float bounds_max_y);
+    void remove_particle_emitter(int emitter_id);
+    void clear_particle_emitters();
+    int get_particle_emitter_count() const;
 
     // System parameters
     void set_parameter(const std::string &name, float value);
+    void set_parameter(const std::string &name, const std::string &value);
     float get_parameter(const std::string &name) const;
 
     // Simulation control
@@ -250,22 +726,93 @@ public:
     bool should_close() const;
     void render();
 
-    // Batch processing
+    // Video of what render() draws, one frame per call, encoded to path at fps by ffmpeg on a
+    // background thread; works headless. resolution (0, 0) is the window size.
+    void start_capture(const std::string& path, int fps = 30, std::tuple<int, int> resolution = { 0, 0 });
+    long long stop_capture();  // Frames written
+    bool is_capturing() const { return m_capture != nullptr; }
+
+    // Batch processing. An ensemble holds at most max_worlds configurations at once (0 = all):
+    // the next ones are loaded from the queue as soon as every world of the current ones is done.
     void run_batch(
         const std::vector<BatchConfig> &configs,
-        std::function<void(int, const std::vector<ObjectState> &)> callback = nullptr);
+        std::function<void(int, const std::vector<ObjectState> &)> callback = nullptr,
+        bool ensemble = false,
+        const std::vector<BatchObserver> &observers = {},
+        int max_worlds = 0);
+
+    // run_batch() on the CPU (cpu_backend.h), no OpenGL context needed. Configurations run in
+    // parallel when there are at least as many as threads (0 = one per hardware thread),
+    // otherwise one after another with each step spread over the threads. timestep is the
+    // fixed step every dt of a configuration is paced with, as update() does.
+    static void run_batch_cpu(
+        const std::vector<BatchConfig> &configs,
+        std::function<void(int, const std::vector<ObjectState> &)> callback = nullptr,
+        int threads = 0,
+        float timestep = 0.001f);
+
+    // Replicate base once per point of the grid spanned by the parameter value lists (the
+    // last list varies fastest) and run all points as one ensemble
+    SweepResult sweep(const BatchConfig &base,
+                      const std::vector<std::pair<std::string, std::vector<float>>> &parameters,
+                      const std::vector<std::string> &fields = {});
+
+    // Branch the live scene into n ensemble worlds on the GPU (object_fork.h), world w reading
+    // value w (or the single value) of each perturbation list in place of k, b, g, coupling,
+    // drive_freq or drive_amp; step them steps steps together and reduce every observable
+    // ("sum|mean|min|max(expr)") per world: values[w * observables + k]. restore puts the scene
+    // back as it was; otherwise the worlds keep running until end_fork().
+    std::vector<float> fork(int n, const std::vector<std::pair<std::string, std::vector<float>>> &perturbations,
+                            int steps, const std::vector<std::string> &observables, bool restore = true);
+    void end_fork();
+    bool is_forked() const;
+
+    // Draw ensemble worlds side by side, each in a cell of a grid (world_tiles.h)
+    void set_world_tiles(const std::vector<int> &worlds, int columns);
+    void clear_world_tiles();
 
     // Save/Load simulation state
+    // binary writes a scene_snapshot.h file (equations, constraints and collision properties
+    // included); load_from_file() tells the formats apart by the snapshot magic
     void save_to_file(const std::string &filename, const std::string &title = "",
-                      const std::string &author = "", const std::string &description = "");
+                      const std::string &author = "", const std::string &description = "",
+                      bool binary = false);
     void load_from_file(const std::string &filename);
 
+    // Checkpoints for long runs: the first call (or full=true, or a new path) writes a binary
+    // base snapshot to path, later calls append only what changed since the previous
+    // checkpoint to path + ".delta". Objects are diffed on the GPU; the file write runs in
+    // the background and the next checkpoint waits for it. Returns the delta sequence number
+    // (0 for a base). restore_checkpoint() loads the base and replays the deltas, returning
+    // how many it applied.
+    int checkpoint(const std::string &path, bool full = false);
+    int restore_checkpoint(const std::string &path);
+
+    // Scenes resident in VRAM (scene_cache.h): cache_scene() keeps a GPU copy of the objects
+    // under name together with the equations, constraints and collision properties, and
+    // activate_scene() replaces the current scene with it by a copy in VRAM, with no upload
+    // of the objects. Caching the same name again replaces the scene.
+    void cache_scene(const std::string &name);
+    void activate_scene(const std::string &name);
+    void remove_cached_scene(const std::string &name);
+    std::vector<std::string> get_cached_scenes() const;
+    long long get_scene_cache_bytes() const;
+
+    // Rollback history (object_history.h): a GPU ring of n_snapshots copies of the objects,
+    // one taken every every_k_steps steps and one when it is enabled. rewind(k) restores the
+    // k-th newest (1 = newest) by a copy in VRAM, drops the newer ones and returns its time.
+    void enable_history(int n_snapshots, int every_k_steps = 1);
+    void disable_history();
+    double rewind(int k = 1);
+    std::vector<double> get_history_times() const;  // Oldest first
+
     // Properties
     bool is_headless() const { return m_headless; }
     bool is_initialized() const { return m_initialized; }
 
     // Shader loading status
     void update_shader_loading();
+    bool wait_until_ready(float timeout = -1.0f);  // Seconds, negative = no limit; false on timeout
     bool are_all_shaders_ready() const;
     float get_shader_load_progress() const;
     std::string get_shader_load_status() const;
@@ -0,0 +1,329 @@
+#include "state_stream.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketHandle;
+typedef int SocketLength;
+static const SocketHandle NO_SOCKET = INVALID_SOCKET;
+static void CloseSocket(SocketHandle s) { closesocket(s); }
+static bool WouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+static void SetNonBlocking(SocketHandle s)
+{
+    u_long on = 1;
+    ioctlsocket(s, FIONBIO, &on);
+}
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int SocketHandle;
+typedef socklen_t SocketLength;
+static const SocketHandle NO_SOCKET = -1;
+static void CloseSocket(SocketHandle s) { close(s); }
+static bool WouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+static void SetNonBlocking(SocketHandle s) { fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK); }
+#endif
+
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;  // A viewer hanging up must not raise SIGPIPE
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+static const int POLL_MILLISECONDS = 5;
+
+static SocketHandle Handle(intptr_t socket) { return static_cast<SocketHandle>(socket); }
+
+static void PutU32(std::vector<uint8_t>& out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+static void PutFloat(std::vector<uint8_t>& out, float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    PutU32(out, bits);
+}
+
+// Length and type first; FinishMessage fills in the length once the payload is written
+static size_t BeginMessage(std::vector<uint8_t>& out, uint8_t type)
+{
+    size_t start = out.size();
+    PutU32(out, 0);
+    out.push_back(type);
+    return start;
+}
+
+static void FinishMessage(std::vector<uint8_t>& out, size_t start)
+{
+    uint32_t payload = static_cast<uint32_t>(out.size() - start - 5);
+    for (int i = 0; i < 4; i++) out[start + i] = static_cast<uint8_t>(payload >> (8 * i));
+}
+
+StateStreamServer::StateStreamServer(const std::string& host, int port, const std::vector<std::string>& fields,
+                                     const std::vector<int>& objects, const float box[4])
+    : m_numObjects(objects.size())
+{
+    std::copy(box, box + 4, m_box);
+    for (const std::string& field : fields)
+        m_encodings.push_back(field == "x" ? ENCODING_BOX_X : field == "y" ? ENCODING_BOX_Y : ENCODING_FLOAT16);
+
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) throw std::runtime_error("Failed to initialize Winsock");
+#endif
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    SocketHandle listener = NO_SOCKET;
+    std::string error;
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1)
+        error = "Invalid stream host (expected an IPv4 address): " + host;
+    else if ((listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) == NO_SOCKET)
+        error = "Failed to create the stream socket";
+    else
+    {
+        int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+        SocketLength length = sizeof(address);
+        if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 16) != 0)
+            error = "Failed to listen on " + host + ":" + std::to_string(port);
+        else if (getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) == 0)
+            m_port = ntohs(address.sin_port);
+    }
+    if (!error.empty())
+    {
+        if (listener != NO_SOCKET) CloseSocket(listener);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        throw std::runtime_error(error);
+    }
+    SetNonBlocking(listener);
+    m_listener = static_cast<intptr_t>(listener);
+
+    size_t start = BeginMessage(m_hello, MESSAGE_HELLO);
+    PutU32(m_hello, PROTOCOL_VERSION);
+    PutU32(m_hello, static_cast<uint32_t>(objects.size()));
+    PutU32(m_hello, static_cast<uint32_t>(fields.size()));
+    for (float bound : m_box) PutFloat(m_hello, bound);
+    for (size_t f = 0; f < fields.size(); f++)
+    {
+        size_t length = std::min<size_t>(fields[f].size(), 255);
+        m_hello.push_back(static_cast<uint8_t>(length));
+        m_hello.insert(m_hello.end(), fields[f].begin(), fields[f].begin() + length);
+        m_hello.push_back(m_encodings[f]);
+    }
+    for (int index : objects) PutU32(m_hello, static_cast<uint32_t>(index));
+    FinishMessage(m_hello, start);
+
+    m_thread = std::thread(&StateStreamServer::Run, this);
+}
+
+StateStreamServer::~StateStreamServer()
+{
+    Close();
+}
+
+// ============================================================================
+// Simulation thread: replace the frame waiting to go out
+// ============================================================================
+void StateStreamServer::Push(StreamFrame&& frame)
+{
+    if (m_closed || frame.values.size() != m_numObjects * m_encodings.size()) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_mailbox = std::move(frame);
+    m_hasFrame = true;
+}
+
+void StateStreamServer::Close()
+{
+    if (m_closed) return;
+    m_closed = true;
+    m_closing.store(true);
+    if (m_thread.joinable()) m_thread.join();
+
+    for (Client& client : m_clients) CloseSocket(Handle(client.socket));
+    m_clients.clear();
+    m_clientCount.store(0);
+    CloseSocket(Handle(m_listener));
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+// ============================================================================
+// Server thread: accept viewers, encode the newest frame, write what the sockets take
+// ============================================================================
+void StateStreamServer::Run()
+{
+    StreamFrame frame;
+    while (!m_closing.load())
+    {
+        fd_set readable, writable;
+        FD_ZERO(&readable);
+        FD_ZERO(&writable);
+        FD_SET(Handle(m_listener), &readable);
+        SocketHandle highest = Handle(m_listener);
+        for (const Client& client : m_clients)
+        {
+            if (client.sent < client.outgoing.size()) FD_SET(Handle(client.socket), &writable);
+            highest = std::max(highest, Handle(client.socket));
+        }
+        timeval timeout = { 0, POLL_MILLISECONDS * 1000 };
+        select(static_cast<int>(highest + 1), &readable, &writable, nullptr, &timeout);
+
+        if (FD_ISSET(Handle(m_listener), &readable)) Accept();
+
+        bool hasFrame = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_hasFrame)
+            {
+                std::swap(frame, m_mailbox);
+                m_hasFrame = false;
+                hasFrame = true;
+            }
+        }
+        if (hasFrame) Broadcast(frame);
+
+        size_t kept = 0;
+        for (size_t c = 0; c < m_clients.size(); c++)
+        {
+            if (Flush(m_clients[c])) m_clients[kept++] = std::move(m_clients[c]);
+            else CloseSocket(Handle(m_clients[c].socket));
+        }
+        m_clients.resize(kept);
+        m_clientCount.store(static_cast<int>(kept));
+    }
+}
+
+void StateStreamServer::Accept()
+{
+    for (;;)
+    {
+        SocketHandle s = accept(Handle(m_listener), nullptr, nullptr);
+        if (s == NO_SOCKET) return;
+        SetNonBlocking(s);
+        int noDelay = 1;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+        Client client;
+        client.socket = static_cast<intptr_t>(s);
+        client.outgoing = m_hello;
+        m_clients.push_back(std::move(client));
+    }
+}
+
+// Quantize once, then encode a keyframe and a delta to the previous frame; each viewer
+// gets whichever its view can take
+void StateStreamServer::Broadcast(const StreamFrame& frame)
+{
+    size_t numFields = m_encodings.size();
+    m_quantized.resize(frame.values.size());
+    for (size_t f = 0; f < numFields; f++)
+    {
+        Encoding encoding = m_encodings[f];
+        float low = encoding == ENCODING_BOX_Y ? m_box[1] : m_box[0];
+        float extent = encoding == ENCODING_BOX_Y ? m_box[3] - m_box[1] : m_box[2] - m_box[0];
+        for (size_t o = 0; o < m_numObjects; o++)
+        {
+            float value = frame.values[o * numFields + f];
+            uint16_t q;
+            if (encoding == ENCODING_FLOAT16)
+                q = static_cast<uint16_t>(glm::packHalf1x16(value));
+            else
+            {
+                float fraction = std::isfinite(value) ? (value - low) / extent : 0.0f;
+                q = static_cast<uint16_t>(std::lround(std::min(std::max(fraction, 0.0f), 1.0f) * 65535.0f));
+            }
+            m_quantized[f * m_numObjects + o] = q;
+        }
+    }
+
+    m_sequence++;
+    bool haveDelta = m_previous.size() == m_quantized.size();
+    auto writeFrameHeader = [&](std::vector<uint8_t>& out, uint8_t type)
+    {
+        out.clear();
+        size_t start = BeginMessage(out, type);
+        PutU32(out, static_cast<uint32_t>(m_sequence));
+        PutU32(out, static_cast<uint32_t>(frame.step));
+        PutFloat(out, frame.time);
+        return start;
+    };
+
+    size_t start = writeFrameHeader(m_keyframe, MESSAGE_KEYFRAME);
+    for (uint16_t q : m_quantized)
+    {
+        m_keyframe.push_back(static_cast<uint8_t>(q));
+        m_keyframe.push_back(static_cast<uint8_t>(q >> 8));
+    }
+    FinishMessage(m_keyframe, start);
+
+    if (haveDelta)
+    {
+        start = writeFrameHeader(m_delta, MESSAGE_DELTA);
+        for (size_t i = 0; i < m_quantized.size(); i++)
+        {
+            int16_t difference = static_cast<int16_t>(static_cast<uint16_t>(m_quantized[i] - m_previous[i]));
+            uint32_t zigzag = (static_cast<uint32_t>(difference) << 1) ^ static_cast<uint32_t>(difference >> 15);
+            zigzag &= 0xFFFFu;
+            while (zigzag >= 0x80)
+            {
+                m_delta.push_back(static_cast<uint8_t>(zigzag | 0x80));
+                zigzag >>= 7;
+            }
+            m_delta.push_back(static_cast<uint8_t>(zigzag));
+        }
+        FinishMessage(m_delta, start);
+    }
+    m_previous.swap(m_quantized);
+
+    for (Client& client : m_clients)
+    {
+        size_t backlog = client.outgoing.size() - client.sent;
+        if (backlog > MAX_CLIENT_BACKLOG) continue;  // Skipped; its next frame is a keyframe
+        if (client.sent > 0)
+        {
+            client.outgoing.erase(client.outgoing.begin(), client.outgoing.begin() + client.sent);
+            client.sent = 0;
+        }
+        const std::vector<uint8_t>& message =
+            (haveDelta && client.lastSequence == m_sequence - 1) ? m_delta : m_keyframe;
+        client.outgoing.insert(client.outgoing.end(), message.begin(), message.end());
+        client.lastSequence = m_sequence;
+    }
+    m_framesSent++;
+}
+
+bool StateStreamServer::Flush(Client& client)
+{
+    while (client.sent < client.outgoing.size())
+    {
+        size_t remaining = client.outgoing.size() - client.sent;
+        int chunk = static_cast<int>(std::min<size_t>(remaining, 1u << 20));
+        auto written = send(Handle(client.socket), reinterpret_cast<const char*>(client.outgoing.data() + client.sent),
+                            chunk, SEND_FLAGS);
+        if (written < 0) return WouldBlock();
+        if (written == 0) return false;
+        client.sent += static_cast<size_t>(written);
+        m_bytesSent += static_cast<long long>(written);
+    }
+    client.outgoing.clear();
+    client.sent = 0;
+    return true;
+}
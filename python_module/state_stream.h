@@ -0,0 +1,100 @@
+#ifndef STATE_STREAM_H
+#define STATE_STREAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One recorded frame handed to the server, laid out like TrajectoryRecording:
+// values[object * fields + field]
+struct StreamFrame
+{
+    std::vector<float> values;
+    int step = 0;
+    float time = 0.0f;
+};
+
+// Broadcasts recorded frames to remote viewers over plain TCP from its own thread. Every
+// value goes out as 16 bits: "x" and "y" as fractions of the quantization box, the other
+// fields as half floats. A client that received the previous frame gets the difference
+// to it as zigzag varints, so objects at rest cost one byte; a new client, or one whose
+// backlog made it miss a frame, gets a keyframe. Push() only swaps the newest frame into a
+// mailbox, so a slow viewer never holds up the simulation.
+//
+// Wire format, little-endian; every message is uint32 payload bytes, uint8 type, payload:
+//   HELLO (0), once per connection: uint32 version, uint32 objects, uint32 fields,
+//       float box[4] (min_x, min_y, max_x, max_y), then per field uint8 name length, the
+//       name and uint8 encoding (0 box x, 1 box y, 2 float16), then int32 object indices
+//   KEYFRAME (1): uint32 sequence, int32 step, float time, uint16 per value, field-major
+//   DELTA (2): as KEYFRAME, but each value is the zigzag LEB128 varint of its int16
+//       difference to the frame of sequence - 1
+class StateStreamServer
+{
+public:
+    static const uint32_t PROTOCOL_VERSION = 1;
+    enum Message : uint8_t { MESSAGE_HELLO = 0, MESSAGE_KEYFRAME = 1, MESSAGE_DELTA = 2 };
+    enum Encoding : uint8_t { ENCODING_BOX_X = 0, ENCODING_BOX_Y = 1, ENCODING_FLOAT16 = 2 };
+
+    // Listens on host:port (port 0 picks a free one); throws if the socket cannot be bound
+    StateStreamServer(const std::string& host, int port, const std::vector<std::string>& fields,
+                      const std::vector<int>& objects, const float box[4]);
+    ~StateStreamServer();
+    StateStreamServer(const StateStreamServer&) = delete;
+    StateStreamServer& operator=(const StateStreamServer&) = delete;
+
+    void Push(StreamFrame&& frame);  // Simulation thread; replaces a frame not yet sent
+    void Close();                    // Disconnect the viewers and join
+    int GetPort() const { return m_port; }
+    int GetClientCount() const { return m_clientCount.load(); }
+    long long FramesSent() const { return m_framesSent.load(); }
+    long long BytesSent() const { return m_bytesSent.load(); }
+
+private:
+    static const size_t MAX_CLIENT_BACKLOG = 8u << 20;  // Unsent bytes before a client skips frames
+
+    struct Client
+    {
+        intptr_t socket;
+        std::vector<uint8_t> outgoing;
+        size_t sent = 0;               // Bytes of outgoing already written
+        long long lastSequence = -1;   // Frame the client's view is at
+    };
+
+    void Run();
+    void Accept();
+    void Broadcast(const StreamFrame& frame);
+    bool Flush(Client& client);  // False once the connection is gone
+
+    std::vector<uint8_t> m_hello;
+    std::vector<Encoding> m_encodings;
+    size_t m_numObjects;
+    float m_box[4];
+
+    intptr_t m_listener;
+    int m_port = 0;
+    std::vector<Client> m_clients;  // Server thread only
+
+    // Newest frame behind a mutex: the viewers want the latest state, not every state
+    std::mutex m_mutex;
+    StreamFrame m_mailbox;
+    bool m_hasFrame = false;
+
+    // Encoding state, server thread only
+    std::vector<uint16_t> m_quantized;
+    std::vector<uint16_t> m_previous;
+    long long m_sequence = -1;
+    std::vector<uint8_t> m_keyframe;
+    std::vector<uint8_t> m_delta;
+
+    std::atomic<bool> m_closing{ false };
+    std::atomic<int> m_clientCount{ 0 };
+    std::atomic<long long> m_framesSent{ 0 };
+    std::atomic<long long> m_bytesSent{ 0 };
+    std::thread m_thread;
+    bool m_closed = false;
+};
+
+#endif // STATE_STREAM_H
@@ -0,0 +1,273 @@
+#include "trajectory_reader.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// ============================================================================
+// Mapped file
+// ============================================================================
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+void MappedFile::Open(const std::string& path)
+{
+    Close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Cannot open " + path);
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        throw std::runtime_error("Cannot map the empty or unreadable file " + path);
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!data)
+    {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Cannot map " + path);
+    }
+    m_file = file;
+    m_mapping = mapping;
+    size_t bytes = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size == 0)
+    {
+        close(fd);
+        throw std::runtime_error("Cannot map the empty or unreadable file " + path);
+    }
+    size_t bytes = static_cast<size_t>(status.st_size);
+    void* data = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) throw std::runtime_error("Cannot map " + path);
+#endif
+    m_data = static_cast<unsigned char*>(data);
+    m_size = bytes;
+}
+
+void MappedFile::Close()
+{
+    if (!m_data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(static_cast<HANDLE>(m_mapping));
+    CloseHandle(static_cast<HANDLE>(m_file));
+    m_mapping = m_file = nullptr;
+#else
+    munmap(m_data, m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+void MappedFile::AdviseRandom()
+{
+#ifndef _WIN32
+    if (m_data) madvise(m_data, m_size, MADV_RANDOM);
+#endif
+}
+
+void MappedFile::WillNeed(size_t offset, size_t bytes) const
+{
+#ifdef _WIN32
+    (void)offset; (void)bytes;  // Windows reads the pages on first touch
+#else
+    if (!m_data || offset >= m_size) return;
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t begin = offset / page * page;
+    size_t end = std::min(m_size, offset + bytes);
+    if (end > begin) madvise(m_data + begin, end - begin, MADV_WILLNEED);
+#endif
+}
+
+// ============================================================================
+// .npy preamble: magic, version, header length, then the header dict
+// ============================================================================
+struct NpyHeader
+{
+    std::string descr;
+    bool fortranOrder = false;
+    std::vector<long long> shape;
+    size_t dataOffset = 0;
+};
+
+static NpyHeader ParseNpyHeader(const MappedFile& file, const std::string& path)
+{
+    const unsigned char* data = file.Data();
+    size_t size = file.Size();
+    if (size < 10 || std::memcmp(data, "\x93NUMPY", 6) != 0) throw std::runtime_error(path + " is not a .npy file");
+
+    size_t length = 0, start = 0;
+    if (data[6] == 1)
+    {
+        length = static_cast<size_t>(data[8]) | (static_cast<size_t>(data[9]) << 8);
+        start = 10;
+    }
+    else
+    {
+        if (size < 12) throw std::runtime_error(path + " is truncated");
+        length = static_cast<size_t>(data[8]) | (static_cast<size_t>(data[9]) << 8) |
+                 (static_cast<size_t>(data[10]) << 16) | (static_cast<size_t>(data[11]) << 24);
+        start = 12;
+    }
+    if (start + length > size) throw std::runtime_error(path + " is truncated");
+    std::string dict(reinterpret_cast<const char*>(data + start), length);
+
+    NpyHeader header;
+    header.dataOffset = start + length;
+    size_t descr = dict.find("'descr':");
+    size_t open = descr == std::string::npos ? descr : dict.find('\'', descr + 8);
+    size_t close = open == std::string::npos ? open : dict.find('\'', open + 1);
+    if (close == std::string::npos) throw std::runtime_error(path + " has no dtype");
+    header.descr = dict.substr(open + 1, close - open - 1);
+    header.fortranOrder = dict.find("'fortran_order': True") != std::string::npos;
+
+    size_t shape = dict.find("'shape':");
+    size_t begin = shape == std::string::npos ? shape : dict.find('(', shape);
+    size_t end = begin == std::string::npos ? begin : dict.find(')', begin);
+    if (end == std::string::npos) throw std::runtime_error(path + " has no shape");
+    std::string dims = dict.substr(begin + 1, end - begin - 1);
+    for (size_t at = 0; at < dims.size();)
+    {
+        size_t comma = dims.find(',', at);
+        std::string dim = dims.substr(at, comma == std::string::npos ? std::string::npos : comma - at);
+        if (dim.find_first_of("0123456789") != std::string::npos) header.shape.push_back(std::stoll(dim));
+        if (comma == std::string::npos) break;
+        at = comma + 1;
+    }
+    return header;
+}
+
+// ============================================================================
+// Reader
+// ============================================================================
+TrajectoryReader::TrajectoryReader(const std::string& directory)
+    : m_directory(directory)
+{
+    fs::path root(directory);
+    std::error_code ec;
+    if (!fs::is_directory(root, ec)) throw std::runtime_error("No trajectory directory " + directory);
+
+    // objects.npy is small and complete: read it whole
+    {
+        std::string path = (root / "objects.npy").string();
+        MappedFile indexFile;
+        indexFile.Open(path);
+        NpyHeader header = ParseNpyHeader(indexFile, path);
+        if (header.descr != "<i4" || header.shape.size() != 1)
+            throw std::runtime_error(path + " is not an int32 vector");
+        size_t count = static_cast<size_t>(header.shape[0]);
+        if (header.dataOffset + count * sizeof(int) > indexFile.Size()) throw std::runtime_error(path + " is truncated");
+        m_objectIndices.resize(count);
+        std::memcpy(m_objectIndices.data(), indexFile.Data() + header.dataOffset, count * sizeof(int));
+    }
+
+    // Every other .npy but step and time is a field; the writer keeps no order, so they are sorted
+    for (const fs::directory_entry& entry : fs::directory_iterator(root, ec))
+    {
+        if (entry.path().extension() != ".npy") continue;
+        std::string name = entry.path().stem().string();
+        if (name != "objects" && name != "step" && name != "time") m_fields.push_back(name);
+    }
+    std::sort(m_fields.begin(), m_fields.end());
+
+    m_columns = std::vector<Column>(m_fields.size() + 2);
+    m_frames = -1;
+    for (size_t f = 0; f < m_fields.size(); f++) OpenColumn(m_columns[f], m_fields[f], "<f4", true);
+    OpenColumn(m_columns[m_fields.size()], "step", "<i4", false);
+    OpenColumn(m_columns[m_fields.size() + 1], "time", "<f4", false);
+}
+
+void TrajectoryReader::OpenColumn(Column& column, const std::string& name, const char* descr, bool perObject)
+{
+    std::string path = (fs::path(m_directory) / (name + ".npy")).string();
+    column.file.Open(path);
+    NpyHeader header = ParseNpyHeader(column.file, path);
+    size_t rowValues = perObject ? m_objectIndices.size() : 1;
+    if (header.descr != descr || header.fortranOrder || header.shape.size() != (perObject ? 2u : 1u) ||
+        (perObject && header.shape[1] != static_cast<long long>(rowValues)))
+        throw std::runtime_error(path + " does not match the trajectory layout");
+
+    column.dataOffset = header.dataOffset;
+    column.rowBytes = rowValues * 4;
+    column.file.AdviseRandom();
+
+    // The header holds 0 frames until the writer closes; the rows on disk are the truth
+    long long frames = column.rowBytes == 0 ? header.shape[0]
+        : static_cast<long long>((column.file.Size() - column.dataOffset) / column.rowBytes);
+    if (header.shape[0] > 0) frames = std::min(frames, header.shape[0]);
+    m_frames = m_frames < 0 ? frames : std::min(m_frames, frames);
+}
+
+int TrajectoryReader::FieldIndex(const std::string& field) const
+{
+    auto it = std::find(m_fields.begin(), m_fields.end(), field);
+    return it == m_fields.end() ? -1 : static_cast<int>(it - m_fields.begin());
+}
+
+int TrajectoryReader::ObjectColumn(int objectIndex) const
+{
+    auto it = std::find(m_objectIndices.begin(), m_objectIndices.end(), objectIndex);
+    return it == m_objectIndices.end() ? -1 : static_cast<int>(it - m_objectIndices.begin());
+}
+
+const float* TrajectoryReader::Field(int field) const
+{
+    const Column& column = m_columns[field];
+    return reinterpret_cast<const float*>(column.file.Data() + column.dataOffset);
+}
+
+const int* TrajectoryReader::Steps() const
+{
+    const Column& column = m_columns[m_fields.size()];
+    return reinterpret_cast<const int*>(column.file.Data() + column.dataOffset);
+}
+
+const float* TrajectoryReader::Times() const
+{
+    const Column& column = m_columns[m_fields.size() + 1];
+    return reinterpret_cast<const float*>(column.file.Data() + column.dataOffset);
+}
+
+void TrajectoryReader::Prefetch(long long first, long long count, const std::vector<int>& fields) const
+{
+    first = std::max(0LL, first);
+    count = std::min(count, m_frames - first);
+    if (count <= 0) return;
+
+    auto prefetch = [&](const Column& column)
+    {
+        column.file.WillNeed(column.dataOffset + static_cast<size_t>(first) * column.rowBytes,
+                             static_cast<size_t>(count) * column.rowBytes);
+    };
+    if (fields.empty())
+        for (size_t f = 0; f < m_fields.size(); f++) prefetch(m_columns[f]);
+    for (int f : fields)
+        if (f >= 0 && f < static_cast<int>(m_fields.size())) prefetch(m_columns[f]);
+    prefetch(m_columns[m_fields.size()]);
+    prefetch(m_columns[m_fields.size() + 1]);
+}
@@ -0,0 +1,76 @@
+#ifndef TRAJECTORY_READER_H
+#define TRAJECTORY_READER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// A read-only mapping of one file; throws std::runtime_error when it cannot be opened or mapped
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    void Open(const std::string& path);
+    void Close();
+    // Page-aligned hints for [offset, offset + bytes): random access reads ahead nothing, so a
+    // strided column faults only the pages it lands on; WillNeed starts reading a range early
+    void AdviseRandom();
+    void WillNeed(size_t offset, size_t bytes) const;
+
+    const unsigned char* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+    unsigned char* m_data = nullptr;
+    size_t m_size = 0;
+    void* m_file = nullptr;     // Windows file and mapping handles
+    void* m_mapping = nullptr;
+};
+
+// The .npy directory TrajectoryWriter streams (trajectory_writer.h), mapped column by column:
+// a field is a (frames, objects) float32 array on disk and nothing is read until a slice of it
+// is touched. Frames are counted from the file sizes, so a directory still being written reads
+// as the whole frames flushed so far.
+class TrajectoryReader
+{
+public:
+    explicit TrajectoryReader(const std::string& directory);
+    TrajectoryReader(const TrajectoryReader&) = delete;
+    TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+    long long GetFrames() const { return m_frames; }
+    const std::vector<std::string>& GetFields() const { return m_fields; }
+    const std::vector<int>& GetObjectIndices() const { return m_objectIndices; }
+    const std::string& GetDirectory() const { return m_directory; }
+
+    int FieldIndex(const std::string& field) const;     // -1 when not recorded
+    int ObjectColumn(int objectIndex) const;            // Column of a simulation object, -1 if not recorded
+    const float* Field(int field) const;                // values[frame * objects + column]
+    const int* Steps() const;
+    const float* Times() const;
+
+    // Ask for frames [first, first + count) of the given fields (all for an empty list) ahead of use
+    void Prefetch(long long first, long long count, const std::vector<int>& fields) const;
+
+private:
+    struct Column
+    {
+        MappedFile file;
+        size_t dataOffset = 0;  // Bytes of the .npy preamble
+        size_t rowBytes = 0;    // One frame
+    };
+
+    void OpenColumn(Column& column, const std::string& name, const char* descr, bool perObject);
+
+    std::string m_directory;
+    std::vector<std::string> m_fields;
+    std::vector<int> m_objectIndices;
+    std::vector<Column> m_columns;  // Fields, then step and time
+    long long m_frames = 0;
+};
+
+#endif // TRAJECTORY_READER_H
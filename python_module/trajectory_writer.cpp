@@ -0,0 +1,181 @@
+#include "trajectory_writer.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+// Preamble of every .npy file: magic, version 1.0, header length, header padded with spaces.
+// A fixed size lets Close() rewrite the shape in place once the frame count is known.
+static const size_t NPY_PREAMBLE_BYTES = 128;
+
+static std::string NpyHeader(const std::string& descr, const std::string& shape)
+{
+    std::string dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': " + shape + ", }";
+    std::string header = "\x93NUMPY";
+    header += '\x01';
+    header += '\x00';
+    size_t length = NPY_PREAMBLE_BYTES - 10;
+    header += static_cast<char>(length & 0xFF);
+    header += static_cast<char>((length >> 8) & 0xFF);
+    header += dict;
+    header.resize(NPY_PREAMBLE_BYTES - 1, ' ');
+    header += '\n';
+    return header;
+}
+
+static std::FILE* OpenColumn(const fs::path& path)
+{
+    std::FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (!file) throw std::runtime_error("Failed to open output file: " + path.string());
+    return file;
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::string& directory, const std::vector<std::string>& fields,
+                                   const std::vector<int>& objects)
+    : m_fields(fields), m_numObjects(objects.size())
+{
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    if (ec) throw std::runtime_error("Failed to create output directory: " + directory);
+
+    // objects.npy is complete up front
+    fs::path root(directory);
+    std::FILE* indexFile = OpenColumn(root / "objects.npy");
+    std::string header = NpyHeader("<i4", "(" + std::to_string(objects.size()) + ",)");
+    bool ok = std::fwrite(header.data(), 1, header.size(), indexFile) == header.size() &&
+              std::fwrite(objects.data(), sizeof(int), objects.size(), indexFile) == objects.size();
+    std::fclose(indexFile);
+    if (!ok) throw std::runtime_error("Failed to write " + (root / "objects.npy").string());
+
+    auto addColumn = [&](const std::string& name, const char* descr, bool perObject)
+    {
+        Column column;
+        column.descr = descr;
+        column.perObject = perObject;
+        column.file = OpenColumn(root / (name + ".npy"));
+        m_columns.push_back(column);
+        if (!WriteHeader(m_columns.back(), 0)) throw std::runtime_error("Failed to write " + name + ".npy");
+    };
+
+    try
+    {
+        for (const std::string& field : fields) addColumn(field, "<f4", true);
+        addColumn("step", "<i4", false);
+        addColumn("time", "<f4", false);
+    }
+    catch (...)
+    {
+        for (Column& column : m_columns) std::fclose(column.file);
+        throw;
+    }
+
+    m_thread = std::thread(&TrajectoryWriter::Run, this);
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    try
+    {
+        Close();
+    }
+    catch (...)
+    {
+        // Close() reports errors to callers that ask; a destructor has nobody to tell
+    }
+}
+
+bool TrajectoryWriter::WriteHeader(Column& column, long long frames)
+{
+    std::string shape = column.perObject
+        ? "(" + std::to_string(frames) + ", " + std::to_string(m_numObjects) + ")"
+        : "(" + std::to_string(frames) + ",)";
+    std::string header = NpyHeader(column.descr, shape);
+    return std::fwrite(header.data(), 1, header.size(), column.file) == header.size();
+}
+
+// ============================================================================
+// Simulation thread: hand a chunk over, waiting only while the ring is full
+// ============================================================================
+void TrajectoryWriter::Push(TrajectoryChunk&& chunk)
+{
+    if (m_closed || chunk.frames <= 0) return;
+
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    while (tail - m_head.load(std::memory_order_acquire) >= QUEUE_SLOTS)
+    {
+        if (m_failed.load()) return;  // The writer has stopped; Close() reports why
+        std::this_thread::yield();
+    }
+
+    m_slots[tail % QUEUE_SLOTS] = std::move(chunk);
+    m_tail.store(tail + 1, std::memory_order_release);
+}
+
+// ============================================================================
+// Writer thread: drain the ring until Close() and the ring is empty
+// ============================================================================
+void TrajectoryWriter::Run()
+{
+    for (;;)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+        {
+            if (m_closing.load()) return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        TrajectoryChunk& chunk = m_slots[head % QUEUE_SLOTS];
+        if (!m_failed.load()) WriteChunk(chunk);
+        chunk = TrajectoryChunk();
+        m_head.store(head + 1, std::memory_order_release);
+    }
+}
+
+// Every column gets one write per chunk; fields are de-interleaved into m_scratch first
+void TrajectoryWriter::WriteChunk(const TrajectoryChunk& chunk)
+{
+    size_t numFields = m_fields.size();
+    size_t records = static_cast<size_t>(chunk.frames) * m_numObjects;
+    if (chunk.values.size() < records * numFields) return;
+
+    bool ok = true;
+    m_scratch.resize(records);
+    for (size_t f = 0; f < numFields && ok; ++f)
+    {
+        for (size_t r = 0; r < records; ++r) m_scratch[r] = chunk.values[r * numFields + f];
+        ok = std::fwrite(m_scratch.data(), sizeof(float), records, m_columns[f].file) == records;
+    }
+
+    size_t frames = static_cast<size_t>(chunk.frames);
+    ok = ok && std::fwrite(chunk.steps.data(), sizeof(int), frames, m_columns[numFields].file) == frames;
+    ok = ok && std::fwrite(chunk.times.data(), sizeof(float), frames, m_columns[numFields + 1].file) == frames;
+
+    if (!ok) m_failed.store(true);
+    else m_framesWritten.fetch_add(chunk.frames);
+}
+
+// ============================================================================
+// Finish: drain, join, then put the final frame count into every header
+// ============================================================================
+void TrajectoryWriter::Close()
+{
+    if (m_closed) return;
+    m_closed = true;
+
+    m_closing.store(true);
+    if (m_thread.joinable()) m_thread.join();
+
+    bool ok = !m_failed.load();
+    long long frames = m_framesWritten.load();
+    for (Column& column : m_columns)
+    {
+        ok = ok && std::fseek(column.file, 0, SEEK_SET) == 0 && WriteHeader(column, frames);
+        ok = (std::fclose(column.file) == 0) && ok;
+        column.file = nullptr;
+    }
+    if (!ok) throw std::runtime_error("Failed to write the trajectory files");
+}
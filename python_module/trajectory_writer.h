@@ -0,0 +1,67 @@
+#ifndef TRAJECTORY_WRITER_H
+#define TRAJECTORY_WRITER_H
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Frames handed from the simulation thread to the writer, laid out like TrajectoryRecording:
+// values[(frame * objects + object) * fields + field]
+struct TrajectoryChunk
+{
+    std::vector<float> values;
+    std::vector<int> steps;
+    std::vector<float> times;
+    int frames = 0;
+};
+
+// Streams recorded frames to a directory of .npy files on its own I/O thread: one
+// (frames, objects) float32 array per field, plus step.npy, time.npy and objects.npy,
+// each loadable with numpy.load(..., mmap_mode="r"). Push() hands a chunk over through a
+// single-producer single-consumer ring and only waits when the disk falls behind.
+class TrajectoryWriter
+{
+public:
+    TrajectoryWriter(const std::string& directory, const std::vector<std::string>& fields,
+                     const std::vector<int>& objects);
+    ~TrajectoryWriter();
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+    void Push(TrajectoryChunk&& chunk);  // Simulation thread only
+    void Close();                        // Write what is queued, finish the headers, join; throws on I/O errors
+    long long FramesWritten() const { return m_framesWritten.load(); }
+
+private:
+    static const size_t QUEUE_SLOTS = 8;
+
+    struct Column
+    {
+        std::FILE* file = nullptr;
+        std::string descr;           // NumPy dtype string
+        bool perObject = false;      // (frames, objects) instead of (frames,)
+    };
+
+    void Run();
+    void WriteChunk(const TrajectoryChunk& chunk);
+    bool WriteHeader(Column& column, long long frames);
+
+    std::vector<std::string> m_fields;
+    size_t m_numObjects;
+    std::vector<Column> m_columns;   // Fields, then step and time
+    std::vector<float> m_scratch;    // One field of a chunk, made contiguous
+
+    // SPSC ring: the producer advances m_tail, the writer thread m_head
+    TrajectoryChunk m_slots[QUEUE_SLOTS];
+    std::atomic<size_t> m_head{ 0 };
+    std::atomic<size_t> m_tail{ 0 };
+    std::atomic<bool> m_closing{ false };
+    std::atomic<bool> m_failed{ false };
+    std::atomic<long long> m_framesWritten{ 0 };
+    std::thread m_thread;
+    bool m_closed = false;
+};
+
+#endif // TRAJECTORY_WRITER_H
@@ -0,0 +1,206 @@
+#include "video_capture.h"
+#include "framebuffer.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+static const char* PIPE_MODE = "wb";
+#else
+static const char* PIPE_MODE = "w";
+#endif
+
+// Raw RGBA in, bottom row first as glReadPixels leaves it; yuv420p plays almost everywhere
+static std::string EncoderCommand(const std::string& path, int fps, int width, int height)
+{
+    const char* ffmpeg = std::getenv("STELLAR_FFMPEG");
+    std::string command = "\"" + std::string(ffmpeg && *ffmpeg ? ffmpeg : "ffmpeg") + "\"";
+    command += " -loglevel error -y -f rawvideo -pixel_format rgba";
+    command += " -video_size " + std::to_string(width) + "x" + std::to_string(height);
+    command += " -framerate " + std::to_string(fps);
+    command += " -i - -vf vflip -pix_fmt yuv420p \"" + path + "\"";
+    return command;
+}
+
+VideoCapture::VideoCapture(const std::string& path, int fps, int width, int height)
+    : m_width(width), m_height(height), m_frameBytes(static_cast<size_t>(width) * height * 4)
+{
+    if (path.find('"') != std::string::npos) throw std::runtime_error("Capture path cannot contain quotes");
+
+    m_pipe = popen(EncoderCommand(path, fps, width, height).c_str(), PIPE_MODE);
+    if (!m_pipe) throw std::runtime_error("Failed to start the video encoder (ffmpeg)");
+
+    m_framebuffer.reset(new Framebuffer::Framebuffer(width, height));
+    for (ReadbackSlot& slot : m_readback)
+    {
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, m_frameBytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        for (ReadbackSlot& slot : m_readback)
+            if (slot.pbo) glDeleteBuffers(1, &slot.pbo);
+        m_framebuffer.reset();
+        pclose(m_pipe);
+        throw std::runtime_error("Failed to allocate the capture buffers (GL error " + std::to_string(err) + ")");
+    }
+
+    m_thread = std::thread(&VideoCapture::Run, this);
+}
+
+VideoCapture::~VideoCapture()
+{
+    try
+    {
+        Close();
+    }
+    catch (...)
+    {
+        // Close() reports errors to callers that ask; a destructor has nobody to tell
+    }
+}
+
+// ============================================================================
+// GL thread: draw into the capture framebuffer, then start its copy
+// ============================================================================
+void VideoCapture::BeginFrame()
+{
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_previousFramebuffer);
+    m_framebuffer->Bind();
+}
+
+void VideoCapture::EndFrame()
+{
+    if (m_closed) return;
+
+    // A full ring waits for its oldest copy; with READBACK_SLOTS frames of slack that copy is done
+    ReadbackSlot& slot = m_readback[m_readbackNext];
+    if (slot.fence)
+    {
+        Collect(slot);
+        m_readbackPending--;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer->GetFBO());
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();  // Headless contexts never swap, so the fence has to be sent on its own
+    m_readbackNext = (m_readbackNext + 1) % READBACK_SLOTS;
+    m_readbackPending++;
+
+    // Hand over every older copy that has already finished
+    while (m_readbackPending > 1)
+    {
+        ReadbackSlot& oldest = m_readback[(m_readbackNext - m_readbackPending + READBACK_SLOTS) % READBACK_SLOTS];
+        GLenum state = glClientWaitSync(oldest.fence, 0, 0);
+        if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED) break;
+        Collect(oldest);
+        m_readbackPending--;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(m_previousFramebuffer));
+}
+
+void VideoCapture::Collect(ReadbackSlot& slot)
+{
+    glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    std::vector<uint8_t> frame(m_frameBytes);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, m_frameBytes, GL_MAP_READ_BIT);
+    if (pixels)
+    {
+        std::memcpy(frame.data(), pixels, m_frameBytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!pixels)
+    {
+        m_failed.store(true);
+        return;
+    }
+    Push(std::move(frame));
+}
+
+// Waits only while the encoder is QUEUE_SLOTS frames behind
+void VideoCapture::Push(std::vector<uint8_t>&& frame)
+{
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    while (tail - m_head.load(std::memory_order_acquire) >= QUEUE_SLOTS)
+    {
+        if (m_failed.load()) return;  // The encoder has stopped; Close() reports why
+        std::this_thread::yield();
+    }
+
+    m_slots[tail % QUEUE_SLOTS] = std::move(frame);
+    m_tail.store(tail + 1, std::memory_order_release);
+}
+
+// ============================================================================
+// Encoder thread: feed the pipe until Close() and the ring is empty
+// ============================================================================
+void VideoCapture::Run()
+{
+    for (;;)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+        {
+            if (m_closing.load()) return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        std::vector<uint8_t>& frame = m_slots[head % QUEUE_SLOTS];
+        if (!m_failed.load())
+        {
+            if (std::fwrite(frame.data(), 1, frame.size(), m_pipe) == frame.size()) m_framesWritten.fetch_add(1);
+            else m_failed.store(true);
+        }
+        frame = std::vector<uint8_t>();
+        m_head.store(head + 1, std::memory_order_release);
+    }
+}
+
+// ============================================================================
+// Finish: the copies still in flight, then the encoder
+// ============================================================================
+void VideoCapture::Close()
+{
+    if (m_closed) return;
+    m_closed = true;
+
+    while (m_readbackPending > 0)
+    {
+        Collect(m_readback[(m_readbackNext - m_readbackPending + READBACK_SLOTS) % READBACK_SLOTS]);
+        m_readbackPending--;
+    }
+    for (ReadbackSlot& slot : m_readback)
+    {
+        if (slot.pbo) glDeleteBuffers(1, &slot.pbo);
+        slot = ReadbackSlot{};
+    }
+    m_framebuffer.reset();
+
+    m_closing.store(true);
+    if (m_thread.joinable()) m_thread.join();
+
+    int status = pclose(m_pipe);
+    m_pipe = nullptr;
+    if (m_failed.load() || status != 0)
+        throw std::runtime_error("The video encoder failed (exit status " + std::to_string(status) +
+                                 "); is ffmpeg installed, or STELLAR_FFMPEG set?");
+}
@@ -0,0 +1,71 @@
+#ifndef VIDEO_CAPTURE_H
+#define VIDEO_CAPTURE_H
+
+#include <glad/glad.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Framebuffer { class Framebuffer; }
+
+// Offscreen video capture: frames are drawn into a framebuffer of the capture size, copied into
+// a ring of pixel buffer objects with a fence each and only mapped once the fence has passed, so
+// the GPU copy overlaps the next frames instead of stalling glReadPixels. Mapped frames go to an
+// encoder thread through a single-producer single-consumer ring; the encoder is an ffmpeg
+// process (STELLAR_FFMPEG names another executable) reading raw RGBA from a pipe.
+class VideoCapture
+{
+public:
+    VideoCapture(const std::string& path, int fps, int width, int height);  // Throws if ffmpeg cannot start
+    ~VideoCapture();
+    VideoCapture(const VideoCapture&) = delete;
+    VideoCapture& operator=(const VideoCapture&) = delete;
+
+    // GL thread: bind and clear the capture framebuffer, then queue what was drawn into it
+    void BeginFrame();
+    void EndFrame();
+
+    void Close();  // Read back and encode what is queued, wait for the encoder; throws on errors
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    long long FramesWritten() const { return m_framesWritten.load(); }
+
+private:
+    static const int READBACK_SLOTS = 3;   // Frames the GPU copy may run behind
+    static const size_t QUEUE_SLOTS = 8;   // Frames the encoder may run behind
+
+    struct ReadbackSlot
+    {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+    };
+
+    void Collect(ReadbackSlot& slot);  // Map a slot whose copy has finished and hand it over
+    void Push(std::vector<uint8_t>&& frame);
+    void Run();
+
+    int m_width, m_height;
+    size_t m_frameBytes;
+    std::unique_ptr<Framebuffer::Framebuffer> m_framebuffer;
+    ReadbackSlot m_readback[READBACK_SLOTS];
+    int m_readbackNext = 0;      // Slot the next frame is copied into
+    int m_readbackPending = 0;   // Copies in flight, oldest at m_readbackNext - m_readbackPending
+    GLint m_previousFramebuffer = 0;
+
+    // SPSC ring: the GL thread advances m_tail, the encoder thread m_head
+    std::vector<uint8_t> m_slots[QUEUE_SLOTS];
+    std::atomic<size_t> m_head{ 0 };
+    std::atomic<size_t> m_tail{ 0 };
+    std::atomic<bool> m_closing{ false };
+    std::atomic<bool> m_failed{ false };
+    std::atomic<long long> m_framesWritten{ 0 };
+    std::FILE* m_pipe = nullptr;
+    std::thread m_thread;
+    bool m_closed = false;
+};
+
+#endif // VIDEO_CAPTURE_H
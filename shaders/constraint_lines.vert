@@ -0,0 +1,90 @@
+#version 430 core
+
+/*
+ * ============================================================================
+ * CONSTRAINT NETWORK DRAWING
+ * One instance per constraint row (objectConstraints[gl_InstanceID], the row
+ * of object gl_InstanceID) and one line, vertices 2k and 2k + 1, per slot k up
+ * to the longest row. Slots past the row's count, and constraints that are not
+ * distance constraints, collapse outside the clip volume. Endpoints are pulled
+ * from the object buffer, so breaks and motion on the GPU show without reading
+ * anything back. Colour is the strain (length - rest) / rest: blue compressed,
+ * white at rest, red stretched, saturating at uStrainScale.
+ * ============================================================================
+ */
+
+// ============================================================================
+// DATA STRUCTURES (std430 layout) - MUST MATCH constraints.comp
+// ============================================================================
+
+struct Object {
+    vec2 position;
+    vec2 velocity;
+    float mass;
+    float charge;
+    int visualSkinType;
+    int collisionShapeType;
+    vec4 visualData;
+    vec4 collisionData;
+    vec4 color;
+    int equationID;
+    int worldID;
+    int _padEnd[2];
+};
+
+struct Constraint {
+    int type;
+    int targetObjectID;
+    float param1;  // Distance: rest length
+    float param2;  // Distance: break length, 0 = never breaks
+    float param3;
+    float param4;
+    int _pad1;
+    int _pad2;
+};
+
+struct ObjectConstraints {
+    int objectID;
+    int numConstraints;
+    int constraintOffset;
+    int _pad;
+};
+
+// MUST MATCH CONSTRAINT_LINES_*_BINDING in constraint_lines.h
+layout(std430, binding = 48) readonly buffer Constraints { Constraint constraints[]; };
+layout(std430, binding = 49) readonly buffer ObjectsIn { Object objects[]; };
+layout(std430, binding = 50) readonly buffer ObjectConstraintRows { ObjectConstraints objectConstraints[]; };
+
+uniform mat4 uProjView;
+uniform int uNumObjects;
+uniform float uStrainScale;  // |strain| drawn at full colour
+uniform float uAlpha;
+
+out vec4 fragColor;
+
+const int CONSTRAINT_DISTANCE = 0;  // MUST MATCH ConstraintType in constraints.h
+const vec4 CULLED = vec4(2.0, 2.0, 2.0, 1.0);  // Outside the clip volume, so the line is dropped
+
+void main() {
+    fragColor = vec4(0.0);
+    gl_Position = CULLED;
+
+    int owner = gl_InstanceID;
+    int slot = gl_VertexID >> 1;
+    if (owner >= uNumObjects) return;
+    ObjectConstraints row = objectConstraints[owner];
+    if (slot >= row.numConstraints) return;
+
+    Constraint c = constraints[row.constraintOffset + slot];
+    if (c.type != CONSTRAINT_DISTANCE || c.targetObjectID < 0 || c.targetObjectID >= uNumObjects ||
+        c.targetObjectID == owner) return;
+
+    vec2 a = objects[owner].position;
+    vec2 b = objects[c.targetObjectID].position;
+    float strain = c.param1 > 0.0 ? (distance(a, b) - c.param1) / c.param1 : 0.0;
+    float t = clamp(strain / uStrainScale, -1.0, 1.0);
+    vec3 color = t < 0.0 ? mix(vec3(1.0), vec3(0.2, 0.4, 1.0), -t) : mix(vec3(1.0), vec3(1.0, 0.2, 0.15), t);
+
+    fragColor = vec4(color, uAlpha);
+    gl_Position = uProjView * vec4((gl_VertexID & 1) == 0 ? a : b, 0.0, 1.0);
+}
@@ -0,0 +1,26 @@
+#version 430 core
+
+/*
+ * ============================================================================
+ * DENSITY SPLAT DISPLAY
+ * Tone-maps the summed splats: the mean colour of the objects in a pixel,
+ * with brightness and coverage rising with their count; empty pixels stay
+ * transparent so the view's clear colour shows.
+ * ============================================================================
+ */
+
+in vec2 fragUV;
+
+uniform sampler2D uAccum;
+uniform float uExposure;  // Count at which brightness is ~63% up
+
+out vec4 FragColor;
+
+void main() {
+    vec4 accum = texture(uAccum, fragUV);
+    if (accum.a <= 0.0) discard;
+
+    vec3 mean = accum.rgb / accum.a;
+    float t = 1.0 - exp(-accum.a / uExposure);
+    FragColor = vec4(mean * mix(0.35, 1.0, t), mix(0.35, 1.0, t));
+}
@@ -0,0 +1,10 @@
+#version 430 core
+
+in vec3 splatColor;
+
+out vec4 FragColor;
+
+void main() {
+    // Summed with GL_ONE, GL_ONE: rgb is the colour total, a the object count
+    FragColor = vec4(splatColor, 1.0);
+}
@@ -0,0 +1,47 @@
+#version 430 core
+
+/*
+ * ============================================================================
+ * DENSITY SPLAT POINTS
+ * One point per object (gl_VertexID) at its centre, whatever its skin.
+ * density_splat.cpp adds them into a float target, colour in rgb and a
+ * count of one in alpha.
+ * ============================================================================
+ */
+
+// ============================================================================
+// DATA STRUCTURES (std430 layout) - MUST MATCH math.comp
+// ============================================================================
+
+struct Object {
+    vec2 position;
+    vec2 velocity;
+    float mass;
+    float charge;
+    int visualSkinType;
+    int collisionShapeType;
+    vec4 visualData;
+    vec4 collisionData;
+    vec4 color;
+    int equationID;
+    int worldID;
+    int _padEnd[2];
+};
+
+// MUST MATCH DENSITY_SPLAT_OBJECTS_BINDING in density_splat.h
+layout(std430, binding = 54) readonly buffer ObjectsIn { Object objects[]; };
+
+uniform mat4 uProjView;
+
+out vec3 splatColor;
+
+void main() {
+    Object obj = objects[gl_VertexID];
+    vec4 clip = uProjView * vec4(obj.position, 0.0, 1.0);
+
+    // NaN states are dropped outside the clip volume
+    if (any(isnan(clip)) || any(isinf(clip))) clip = vec4(4.0, 4.0, 0.0, 1.0);
+    gl_Position = clip;
+    gl_PointSize = 1.0;
+    splatColor = clamp(obj.color.rgb, 0.0, 1.0);
+}
@@ -0,0 +1,22 @@
+#version 430 core
+
+in float magnitude;
+
+out vec4 FragColor;
+
+// Blue through yellow to orange with the field strength - MUST MATCH fragShader.frag
+void main() {
+    vec3 lowMagnitudeColor = vec3(0.0, 0.5, 1.0);
+    vec3 midMagnitudeColor = vec3(1.0, 1.0, 0.0);
+    vec3 highMagnitudeColor = vec3(1.0, 0.5, 0.0);
+
+    float normalizedMagnitude = clamp(pow(magnitude, 0.9) * 0.1, 0.0, 1.0);
+
+    vec3 finalColor;
+    if (normalizedMagnitude <= 0.5)
+        finalColor = mix(lowMagnitudeColor, midMagnitudeColor, normalizedMagnitude * 2.0);
+    else
+        finalColor = mix(midMagnitudeColor, highMagnitudeColor, (normalizedMagnitude - 0.5) * 2.0);
+
+    FragColor = vec4(finalColor, 1.0);
+}
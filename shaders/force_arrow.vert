@@ -0,0 +1,39 @@
+#version 430 core
+
+/*
+ * ============================================================================
+ * FORCE FIELD ARROWS
+ * One instance per sample of force_field.comp, six vertices each drawn as
+ * GL_LINES: the shaft, then the two strokes of the head. Arrows grow with
+ * the field up to uMaxLength, so neighbours never overlap.
+ * ============================================================================
+ */
+
+layout(location = 0) in vec2 aBase;    // Per instance - MUST MATCH ForceArrow in force_field.comp
+layout(location = 1) in vec2 aField;
+
+uniform mat4 uProjView;
+uniform float uScale;       // World length per unit of field
+uniform float uMaxLength;
+
+out float magnitude;
+
+void main() {
+    magnitude = length(aField);
+    vec2 dir = (magnitude > 0.0) ? aField / magnitude : vec2(0.0);
+    float arrowLength = min(magnitude * uScale, uMaxLength);
+
+    vec2 tip = aBase + dir * arrowLength;
+    vec2 perp = vec2(-dir.y, dir.x);
+    vec2 headBack = tip - dir * (arrowLength / 3.0);
+    vec2 head[2] = vec2[2](headBack + perp * (arrowLength / 6.0), headBack - perp * (arrowLength / 6.0));
+
+    // 0-1 shaft, 2-3 and 4-5 head strokes from the tip
+    vec2 p;
+    if (gl_VertexID == 0) p = aBase;
+    else if ((gl_VertexID & 1) == 0) p = tip;
+    else if (gl_VertexID == 1) p = tip;
+    else p = head[(gl_VertexID - 3) / 2];
+
+    gl_Position = uProjView * vec4(p, 0.0, 1.0);
+}
@@ -0,0 +1,43 @@
+#version 430 core
+
+/*
+ * ============================================================================
+ * GRID FIELD COLOUR MAP
+ * Interpolates the displayed field bilinearly between its nodes, as field()
+ * does, and maps [uValueMin, uValueMax] from blue through white to red so the
+ * sign of a wave or a deviation reads at a glance.
+ * ============================================================================
+ */
+
+in vec2 gridUV;
+
+// MUST MATCH GRID_FIELDS_VALUES_BINDING
+layout(std430, binding = 53) readonly buffer GridValues { float values[]; };
+
+uniform ivec2 uGridSize;
+uniform int uField;
+uniform float uValueMin;
+uniform float uValueMax;
+uniform float uOpacity;
+
+out vec4 FragColor;
+
+float nodeValue(int i, int j) {
+    i = clamp(i, 0, uGridSize.x - 1);
+    j = clamp(j, 0, uGridSize.y - 1);
+    return values[uField * uGridSize.x * uGridSize.y + j * uGridSize.x + i];
+}
+
+void main() {
+    vec2 u = clamp(gridUV, 0.0, 1.0) * vec2(uGridSize - 1);
+    ivec2 c = ivec2(floor(u));
+    vec2 f = u - vec2(c);
+    float bottom = mix(nodeValue(c.x, c.y), nodeValue(c.x + 1, c.y), f.x);
+    float top = mix(nodeValue(c.x, c.y + 1), nodeValue(c.x + 1, c.y + 1), f.x);
+    float value = mix(bottom, top, f.y);
+
+    float t = clamp((value - uValueMin) / max(uValueMax - uValueMin, 1e-12), 0.0, 1.0);
+    vec3 color = (t < 0.5) ? mix(vec3(0.1, 0.25, 0.8), vec3(0.95), t * 2.0)
+                           : mix(vec3(0.95), vec3(0.8, 0.15, 0.1), t * 2.0 - 1.0);
+    FragColor = vec4(color, uOpacity);
+}
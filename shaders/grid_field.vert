@@ -0,0 +1,21 @@
+#version 430 core
+
+/*
+ * ============================================================================
+ * GRID FIELD DISPLAY
+ * The grid box as one triangle strip from gl_VertexID; grid_field.frag looks
+ * the field up at each fragment. gridUV is 0 at the first node and 1 at the
+ * last, as the nodes sit on the box edges.
+ * ============================================================================
+ */
+
+uniform mat4 uProjView;
+uniform vec2 uGridMin;
+uniform vec2 uGridMax;
+
+out vec2 gridUV;
+
+void main() {
+    gridUV = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    gl_Position = uProjView * vec4(mix(uGridMin, uGridMax, gridUV), 0.0, 1.0);
+}
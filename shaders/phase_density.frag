@@ -0,0 +1,25 @@
+#version 430 core
+
+/*
+ * ============================================================================
+ * PHASE-SPACE DENSITY DISPLAY
+ * Tone-maps the accumulated density (objects per pixel) onto a dark-to-hot
+ * colour ramp; empty pixels stay transparent so the view's clear colour shows.
+ * ============================================================================
+ */
+
+in vec2 fragUV;
+
+uniform sampler2D uDensity;
+uniform float uExposure;  // Density at which the ramp is ~63% up
+
+out vec4 FragColor;
+
+void main() {
+    float density = texture(uDensity, fragUV).r;
+    float t = 1.0 - exp(-density / uExposure);
+
+    vec3 color = mix(vec3(0.1, 0.1, 0.5), vec3(0.9, 0.3, 0.1), smoothstep(0.0, 0.6, t));
+    color = mix(color, vec3(1.0, 0.95, 0.7), smoothstep(0.6, 1.0, t));
+    FragColor = vec4(color, smoothstep(0.0, 0.05, t));
+}
@@ -0,0 +1,10 @@
+#version 430 core
+
+// Drawn with glBlendFunc(GL_ZERO, GL_CONSTANT_COLOR): the density is scaled by the blend colour
+in vec2 fragUV;
+
+out vec4 FragColor;
+
+void main() {
+    FragColor = vec4(0.0);
+}
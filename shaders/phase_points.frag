@@ -0,0 +1,7 @@
+#version 430 core
+
+out vec4 FragColor;
+
+void main() {
+    FragColor = vec4(1.0);  // One object's worth of density
+}
@@ -0,0 +1,57 @@
+#version 430 core
+
+/*
+ * ============================================================================
+ * PHASE-SPACE POINTS
+ * One point per object (gl_VertexID) at (q, p) of the chosen variables,
+ * mapped from the plot window to clip space. phase_space.cpp draws them
+ * with additive blending into the density texture.
+ * ============================================================================
+ */
+
+// ============================================================================
+// DATA STRUCTURES (std430 layout) - MUST MATCH math.comp
+// ============================================================================
+
+struct Object {
+    vec2 position;
+    vec2 velocity;
+    float mass;
+    float charge;
+    int visualSkinType;
+    int collisionShapeType;
+    vec4 visualData;     // z=rotation, w=angular_vel
+    vec4 collisionData;
+    vec4 color;
+    int equationID;
+    int worldID;
+    int _padEnd[2];
+};
+
+// MUST MATCH PHASE_OBJECTS_BINDING in phase_space.h
+layout(std430, binding = 50) readonly buffer ObjectsIn { Object objects[]; };
+
+uniform int uQ;            // PhaseSpace::Variable of the horizontal axis
+uniform int uP;            // and of the vertical axis
+uniform vec4 uWindow;      // qMin, qMax, pMin, pMax
+
+// PhaseSpace::Variable - MUST MATCH phase_space.h
+float phaseVariable(Object obj, int variable) {
+    if (variable == 0) return obj.position.x;
+    if (variable == 1) return obj.position.y;
+    if (variable == 2) return obj.velocity.x;
+    if (variable == 3) return obj.velocity.y;
+    if (variable == 4) return obj.visualData.z;
+    return obj.visualData.w;
+}
+
+void main() {
+    Object obj = objects[gl_VertexID];
+    vec2 qp = vec2(phaseVariable(obj, uQ), phaseVariable(obj, uP));
+    vec2 clip = (qp - uWindow.xz) / (uWindow.yw - uWindow.xz) * 2.0 - 1.0;
+
+    // NaN states are dropped outside the clip volume
+    if (any(isnan(clip)) || any(isinf(clip))) clip = vec2(4.0);
+    gl_Position = vec4(clip, 0.0, 1.0);
+    gl_PointSize = 1.0;
+}
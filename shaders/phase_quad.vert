@@ -0,0 +1,10 @@
+#version 430 core
+
+// Full-screen triangle from gl_VertexID, for phase_fade.frag, phase_density.frag and density_resolve.frag
+out vec2 fragUV;
+
+void main() {
+    vec2 corner = vec2((gl_VertexID == 1) ? 3.0 : -1.0, (gl_VertexID == 2) ? 3.0 : -1.0);
+    fragUV = corner * 0.5 + 0.5;
+    gl_Position = vec4(corner, 0.0, 1.0);
+}
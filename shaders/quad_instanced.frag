@@ -0,0 +1,29 @@
+#version 430 core
+
+in vec2 fragLocal;
+flat in int fragShape;
+flat in float fragSides;
+flat in vec4 fragColor;
+
+out vec4 FragColor;
+
+const int SKIN_CIRCLE = 0;
+const int SKIN_POLYGON = 2;
+const float PI = 3.14159265359;
+
+void main() {
+    if (fragShape == SKIN_CIRCLE) {
+        // HARD EDGE: Discard everything outside the exact circle boundary
+        if (dot(fragLocal, fragLocal) > 1.0) discard;
+    }
+    else if (fragShape == SKIN_POLYGON) {
+        // Regular polygon with a vertex on the local +x axis: inside when the point lies within
+        // the apothem along the normal of the edge of its sector
+        float sector = 2.0 * PI / fragSides;
+        float angle = atan(fragLocal.y, fragLocal.x);
+        float normalAngle = (floor(angle / sector) + 0.5) * sector;
+        if (dot(fragLocal, vec2(cos(normalAngle), sin(normalAngle))) > cos(0.5 * sector)) discard;
+    }
+
+    FragColor = fragColor;
+}
@@ -0,0 +1,119 @@
+#version 430 core
+
+/*
+ * ============================================================================
+ * INSTANCED OBJECT QUADS
+ * One instance per object, four vertices each (a triangle strip). The object
+ * is read straight from the object buffer, through the list of visible
+ * objects when object_cull.comp ran first; circles and polygons are cut out
+ * of their bounding quad in quad_instanced.frag, so no geometry shader runs
+ * and polygons are not limited in their number of sides. With uBlend below 1
+ * the position and rotation are blended from the previous step's buffer, so
+ * the display moves smoothly between physics steps. In a tiled view each
+ * object is moved into the cell of its ensemble world and clipped to it.
+ * ============================================================================
+ */
+
+// ============================================================================
+// DATA STRUCTURES (std430 layout) - MUST MATCH math.comp
+// ============================================================================
+
+struct Object {
+    vec2 position;
+    vec2 velocity;
+    float mass;
+    float charge;
+    int visualSkinType;
+    int collisionShapeType;
+    vec4 visualData;     // x=width/radius, y=height/sides, z=rotation, w=angular_vel
+    vec4 collisionData;
+    vec4 color;
+    int equationID;
+    int worldID;
+    int _padEnd[2];
+};
+
+// Object buffer being drawn - MUST MATCH QUAD_OBJECT_BINDING in objects.cpp
+layout(std430, binding = 45) readonly buffer ObjectsIn { Object objects[]; };
+
+// State the newest step started from, bound only while uBlend < 1 - MUST MATCH QUAD_PREVIOUS_BINDING in objects.cpp
+layout(std430, binding = 51) readonly buffer ObjectsPrevious { Object previousObjects[]; };
+
+// Indices of the objects that survived view culling - MUST MATCH CULL_VISIBLE_BINDING in object_culling.h
+layout(std430, binding = 47) readonly buffer VisibleList { uint visibleIndices[]; };
+
+// Cell of each world in clip space, (centre, half size; 0 = not shown), bound while uTiled - MUST MATCH world_tiles.h
+layout(std430, binding = 52) readonly buffer WorldTiles { vec4 worldTiles[]; };
+
+uniform mat4 uProjection;
+uniform mat4 uView;
+uniform bool uVisibleList;  // Instances are visibleIndices entries rather than object indices
+uniform float uBlend;       // 0 = previous step, 1 = newest step
+uniform bool uTiled;        // Each world into its cell of worldTiles
+
+const int SKIN_CIRCLE = 0;
+const int SKIN_RECTANGLE = 1;
+const int SKIN_POLYGON = 2;
+
+out vec2 fragLocal;          // Position in the quad, [-1, 1] on both axes
+flat out int fragShape;      // SKIN_* the fragment shader cuts out
+flat out float fragSides;    // Polygon sides
+flat out vec4 fragColor;
+out float gl_ClipDistance[4];  // Cell edges, enabled only for a tiled view
+
+void main() {
+    int index = uVisibleList ? int(visibleIndices[gl_InstanceID]) : gl_InstanceID;
+    Object obj = objects[index];
+    if (uBlend < 1.0) {
+        Object previous = previousObjects[index];
+        obj.position = mix(previous.position, obj.position, uBlend);
+        obj.visualData.z = mix(previous.visualData.z, obj.visualData.z, uBlend);
+    }
+    vec2 corner = vec2((gl_VertexID & 1) != 0 ? 1.0 : -1.0, (gl_VertexID & 2) != 0 ? 1.0 : -1.0);
+
+    float param_x = obj.visualData.x;
+    float param_y = obj.visualData.y;
+    float rotation = obj.visualData.z;
+
+    // Half extents of the quad, and defaults for unset sizes - MUST MATCH quad.geom
+    vec2 halfSize;
+    float sides = 0.0;
+    if (obj.visualSkinType == SKIN_RECTANGLE) {
+        halfSize = 0.5 * vec2((param_x < 0.01) ? 0.5 : param_x, (param_y < 0.01) ? 0.3 : param_y);
+    } else {
+        halfSize = vec2((param_x < 0.01) ? 0.3 : param_x);
+        if (obj.visualSkinType == SKIN_POLYGON) sides = (int(param_y) < 3) ? 6.0 : float(int(param_y));
+    }
+
+    // Circles are drawn unrotated, like quad.geom does
+    vec2 offset = corner * halfSize;
+    if (obj.visualSkinType != SKIN_CIRCLE) {
+        float c = cos(rotation), s = sin(rotation);
+        offset = vec2(offset.x * c - offset.y * s, offset.x * s + offset.y * c);
+    }
+
+    // Fallback to charge-based color if white
+    vec4 color = obj.color;
+    if (length(color.rgb - vec3(1.0)) < 0.01) {
+        if (obj.charge > 0.0) color = vec4(1.0, 0.2, 0.2, 1.0);
+        else if (obj.charge < 0.0) color = vec4(0.2, 0.2, 1.0, 1.0);
+        else color = vec4(0.8, 0.4, 0.1, 1.0);
+    }
+
+    fragLocal = corner;
+    fragShape = obj.visualSkinType;
+    fragSides = sides;
+    fragColor = color;
+    vec4 clip = uProjection * uView * vec4(obj.position + offset, 0.0, 1.0);
+    if (uTiled) {
+        // The camera's view is mapped into the cell, and what falls outside it is clipped
+        vec4 tile = worldTiles[clamp(obj.worldID, 0, worldTiles.length() - 1)];
+        bool shown = tile.z > 0.0;
+        gl_ClipDistance[0] = shown ? clip.w + clip.x : -1.0;
+        gl_ClipDistance[1] = shown ? clip.w - clip.x : -1.0;
+        gl_ClipDistance[2] = shown ? clip.w + clip.y : -1.0;
+        gl_ClipDistance[3] = shown ? clip.w - clip.y : -1.0;
+        clip.xy = clip.xy * tile.zw + tile.xy * clip.w;
+    }
+    gl_Position = clip;
+}
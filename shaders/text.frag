@@ -0,0 +1,13 @@
+#version 430 core
+in vec2 uv;
+in vec4 color;
+
+uniform sampler2D uAtlas;   // One channel coverage
+
+out vec4 FragColor;
+
+void main() {
+    float coverage = texture(uAtlas, uv).r;
+    if (coverage <= 0.0) discard;
+    FragColor = vec4(color.rgb, color.a * coverage);
+}
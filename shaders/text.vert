@@ -0,0 +1,16 @@
+#version 430 core
+layout (location = 0) in vec2 aPos;     // Pixels, origin at the top left
+layout (location = 1) in vec2 aUV;      // Glyph atlas coordinates
+layout (location = 2) in vec4 aColor;
+
+uniform vec2 uViewport;
+
+out vec2 uv;
+out vec4 color;
+
+void main() {
+    vec2 ndc = vec2(aPos.x / uViewport.x * 2.0 - 1.0, 1.0 - aPos.y / uViewport.y * 2.0);
+    gl_Position = vec4(ndc, 0.0, 1.0);
+    uv = aUV;
+    color = aColor;
+}
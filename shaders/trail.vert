@@ -0,0 +1,58 @@
+#version 430 core
+
+/*
+ * ============================================================================
+ * TRAIL DRAWING
+ * One line strip per tracked object (gl_InstanceID), one vertex per recorded
+ * position (gl_VertexID, oldest first), read from the trail ring written by
+ * object_trail_record.comp. Alpha fades towards the oldest position.
+ * ============================================================================
+ */
+
+// ============================================================================
+// DATA STRUCTURES (std430 layout) - MUST MATCH math.comp
+// ============================================================================
+
+struct Object {
+    vec2 position;
+    vec2 velocity;
+    float mass;
+    float charge;
+    int visualSkinType;
+    int collisionShapeType;
+    vec4 visualData;
+    vec4 collisionData;
+    vec4 color;
+    int equationID;
+    int worldID;
+    int _padEnd[2];
+};
+
+// MUST MATCH TRAIL_HISTORY_BINDING and TRAIL_OBJECTS_BINDING in object_trails.h
+layout(std430, binding = 48) readonly buffer TrailHistory { vec2 history[]; };
+layout(std430, binding = 49) readonly buffer ObjectsIn { Object objects[]; };
+
+uniform mat4 uProjView;
+uniform int uLength;  // Positions per trail
+uniform int uHead;    // Slot of the newest position
+uniform int uFilled;  // Recorded positions, the vertices of each strip
+
+out vec4 fragColor;
+
+void main() {
+    int slot = (uHead - (uFilled - 1) + gl_VertexID + uLength) % uLength;
+    vec2 position = history[gl_InstanceID * uLength + slot];
+
+    // Same charge colours as quad_instanced.vert for objects left white
+    vec4 color = objects[gl_InstanceID].color;
+    if (length(color.rgb - vec3(1.0)) < 0.01) {
+        float charge = objects[gl_InstanceID].charge;
+        if (charge > 0.0) color = vec4(1.0, 0.2, 0.2, 1.0);
+        else if (charge < 0.0) color = vec4(0.2, 0.2, 1.0, 1.0);
+        else color = vec4(0.8, 0.4, 0.1, 1.0);
+    }
+
+    float fade = float(gl_VertexID + 1) / float(uFilled);  // 1 at the newest position
+    fragColor = vec4(color.rgb, color.a * fade * 0.8);
+    gl_Position = uProjView * vec4(position, 0.0, 1.0);
+}
@@ -0,0 +1,269 @@
+#include "adaptive_timestep.h"
+#include "async_shader_loader.h"
+#include <iostream>
+#include <algorithm>
+
+// Passes - MUST MATCH timestep.comp
+enum AdaptiveTimestepPass
+{
+    TIMESTEP_PASS_REDUCE = 0,
+    TIMESTEP_PASS_FINALIZE = 1
+};
+
+static const GLuint TIMESTEP_WORK_GROUP_SIZE = 256;
+
+// TimestepState in timestep.comp and math.comp
+struct TimestepState
+{
+    float dt;
+    float time;
+    GLuint minCandidate;
+    GLuint historyCount;
+};
+
+// Buffers
+static GLuint g_stateSSBO = 0;     // TimestepState
+static GLuint g_historySSBO = 0;   // dt of the last TIMESTEP_HISTORY_SIZE steps
+static GLuint g_readbackSSBO = 0;  // Copy of the state the host reads once its fence has passed
+static GLsync g_readbackFence = nullptr;
+
+// Parameters
+static float g_minDt = 1.0e-5f;
+static float g_maxDt = 0.01f;
+static float g_courant = 0.1f;
+
+// Last state the GPU reported
+static float g_latestDt = 0.001f;
+static float g_latestTime = 0.0f;
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_passLoc = -1;
+static GLint g_numObjectsLoc = -1;
+static GLint g_minDtLoc = -1;
+static GLint g_maxDtLoc = -1;
+static GLint g_courantLoc = -1;
+
+// Create an SSBO of the given size if it does not exist yet
+static void EnsureBuffer(GLuint& buffer, GLsizeiptr size)
+{
+    if (buffer != 0) return;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_COPY);
+}
+
+// Pick up the copied state if the GPU has written it; never waits
+static void PollReadback()
+{
+    if (!g_readbackFence) return;
+
+    GLenum status = glClientWaitSync(g_readbackFence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+
+    glDeleteSync(g_readbackFence);
+    g_readbackFence = nullptr;
+
+    TimestepState state;
+    glBindBuffer(GL_COPY_READ_BUFFER, g_readbackSSBO);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(TimestepState), &state);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    g_latestDt = state.dt;
+    g_latestTime = state.time;
+}
+
+// ============================================================================
+// Initialize buffers and start loading the shader
+// ============================================================================
+bool AdaptiveTimestep::Init()
+{
+    EnsureBuffer(g_stateSSBO, sizeof(TimestepState));
+    EnsureBuffer(g_historySSBO, TIMESTEP_HISTORY_SIZE * sizeof(float));
+    EnsureBuffer(g_readbackSSBO, sizeof(TimestepState));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[AdaptiveTimestep] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "timestep.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_passLoc = glGetUniformLocation(program, "uPass");
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_minDtLoc = glGetUniformLocation(program, "uMinDt");
+                g_maxDtLoc = glGetUniformLocation(program, "uMaxDt");
+                g_courantLoc = glGetUniformLocation(program, "uCourant");
+                g_ready = (g_passLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[AdaptiveTimestep] timestep.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+void AdaptiveTimestep::Reset(float dt, float time)
+{
+    if (g_stateSSBO == 0) return;
+
+    if (g_readbackFence)
+    {
+        glDeleteSync(g_readbackFence);
+        g_readbackFence = nullptr;
+    }
+
+    TimestepState state = { std::clamp(dt, g_minDt, g_maxDt), time, 0xFFFFFFFFu, 0u };
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_stateSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(TimestepState), &state);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    g_latestDt = state.dt;
+    g_latestTime = state.time;
+}
+
+// ============================================================================
+// Reduce -> finalize, then queue a copy of the state for the host
+// ============================================================================
+bool AdaptiveTimestep::Estimate(GLuint objectSSBO, int numObjects)
+{
+    if (!g_ready || g_stateSSBO == 0) return false;
+
+    glUseProgram(g_program);
+    if (g_numObjectsLoc != -1) glUniform1i(g_numObjectsLoc, numObjects);
+    if (g_minDtLoc != -1) glUniform1f(g_minDtLoc, g_minDt);
+    if (g_maxDtLoc != -1) glUniform1f(g_maxDtLoc, g_maxDt);
+    if (g_courantLoc != -1) glUniform1f(g_courantLoc, g_courant);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TIMESTEP_STATE_BINDING, g_stateSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TIMESTEP_HISTORY_BINDING, g_historySSBO);
+
+    GLuint groups = (static_cast<GLuint>(std::max(numObjects, 1)) + TIMESTEP_WORK_GROUP_SIZE - 1) / TIMESTEP_WORK_GROUP_SIZE;
+    glUniform1i(g_passLoc, TIMESTEP_PASS_REDUCE);
+    glDispatchCompute(groups, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUniform1i(g_passLoc, TIMESTEP_PASS_FINALIZE);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TIMESTEP_STATE_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TIMESTEP_HISTORY_BINDING, 0);
+    glUseProgram(0);
+
+    // One copy in flight at a time; the host reads it once the fence has passed
+    PollReadback();
+    if (!g_readbackFence)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, g_stateSSBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, g_readbackSSBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(TimestepState));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        g_readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    return true;
+}
+
+void AdaptiveTimestep::Bind()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TIMESTEP_STATE_BINDING, g_stateSSBO);
+}
+
+void AdaptiveTimestep::Unbind()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TIMESTEP_STATE_BINDING, 0);
+}
+
+// ============================================================================
+// Parameters and reporting
+// ============================================================================
+void AdaptiveTimestep::SetParameters(float minDt, float maxDt, float courant)
+{
+    g_minDt = std::max(minDt, 1.0e-9f);
+    g_maxDt = std::max(maxDt, g_minDt);
+    g_courant = std::max(courant, 1.0e-6f);
+}
+
+float AdaptiveTimestep::GetMinDt() { return g_minDt; }
+float AdaptiveTimestep::GetMaxDt() { return g_maxDt; }
+float AdaptiveTimestep::GetCourant() { return g_courant; }
+
+void AdaptiveTimestep::GetLatest(float& dt, float& time)
+{
+    PollReadback();
+    dt = g_latestDt;
+    time = g_latestTime;
+}
+
+std::vector<float> AdaptiveTimestep::GetHistory()
+{
+    std::vector<float> history;
+    if (g_stateSSBO == 0) return history;
+
+    TimestepState state;
+    std::vector<float> ring(TIMESTEP_HISTORY_SIZE);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_stateSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(TimestepState), &state);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_historySSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, TIMESTEP_HISTORY_SIZE * sizeof(float), ring.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLuint count = std::min(state.historyCount, static_cast<GLuint>(TIMESTEP_HISTORY_SIZE));
+    history.reserve(count);
+    for (GLuint i = state.historyCount - count; i != state.historyCount; i++)
+        history.push_back(ring[i % TIMESTEP_HISTORY_SIZE]);
+    return history;
+}
+
+// ============================================================================
+// Release buffers and the program
+// ============================================================================
+void AdaptiveTimestep::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    if (g_readbackFence) glDeleteSync(g_readbackFence);
+    g_readbackFence = nullptr;
+
+    GLuint* buffers[] = { &g_stateSSBO, &g_historySSBO, &g_readbackSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void AdaptiveTimestep::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool AdaptiveTimestep::IsReady()
+{
+    return g_ready;
+}
+
+std::string AdaptiveTimestep::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[adaptive timestep] " + g_loader.GetStatusMessage();
+    return "Adaptive timestep shader ready";
+}
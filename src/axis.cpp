@@ -1,8 +1,8 @@
-#define NO_TEXT_RENDERING
 #include "axis.h"
 #include "camera.h"
 #include "text_renderer.h"
 #include "buffer_helpers.h"
+#include "gpu_profiler.h"
 #include <glm/gtc/type_ptr.hpp>
 #include <cmath>
 #include <sstream>
@@ -31,6 +31,12 @@ std::vector<float> Axis::axisWidths;
 std::vector<Axis::GridLabel> Axis::labels;
 Axis::Style Axis::style;
 
+bool Axis::cacheValid = false;
+float Axis::cachedZoom = 0.0f;
+float Axis::cachedAspect = 0.0f;
+glm::vec4 Axis::cachedBounds(0.0f);
+Axis::Style Axis::cachedStyle;
+
 // ============================================================================
 // Init / Cleanup
 // ============================================================================
@@ -103,6 +109,7 @@ void Axis::Cleanup() {
     axisColors.clear();
     axisWidths.clear();
     labels.clear();
+    cacheValid = false;
 
     std::cout << "[Axis::Cleanup] Cleanup completed" << std::endl;
 }
@@ -396,7 +403,37 @@ void Axis::GenerateLabels(const Camera& camera, float viewportWidth, float viewp
 // ============================================================================
 // Main Update
 // ============================================================================
+bool Axis::SameStyle(const Style& a, const Style& b) {
+    return a.majorGridColor == b.majorGridColor && a.minorGridColor == b.minorGridColor &&
+        a.subMinorGridColor == b.subMinorGridColor && a.axisColor == b.axisColor &&
+        a.majorGridWidth == b.majorGridWidth && a.minorGridWidth == b.minorGridWidth &&
+        a.subMinorGridWidth == b.subMinorGridWidth && a.axisWidth == b.axisWidth &&
+        a.showMajorGrid == b.showMajorGrid && a.showMinorGrid == b.showMinorGrid &&
+        a.showSubMinorGrid == b.showSubMinorGrid && a.smoothZoom == b.smoothZoom &&
+        a.fadeLines == b.fadeLines && a.minorDivisions == b.minorDivisions &&
+        a.subMinorDivisions == b.subMinorDivisions;
+}
+
+void Axis::Invalidate() {
+    cacheValid = false;
+}
+
 void Axis::Update(const Camera& camera, float viewportWidth, float viewportHeight) {
+    float aspect = viewportWidth / viewportHeight;
+    float halfHeight = camera.zoom;
+    float halfWidth = halfHeight * aspect;
+
+    // The generated area reaches well past the view (CalculateDynamicBuffer), so panning
+    // reuses it until the visible rectangle leaves it
+    bool inside = camera.position.x - halfWidth >= cachedBounds.x &&
+        camera.position.x + halfWidth <= cachedBounds.y &&
+        camera.position.y - halfHeight >= cachedBounds.z &&
+        camera.position.y + halfHeight <= cachedBounds.w;
+    if (cacheValid && inside && camera.zoom == cachedZoom && aspect == cachedAspect &&
+        SameStyle(style, cachedStyle)) {
+        return;
+    }
+
     // Clear all buffers
     vertices.clear();
     colors.clear();
@@ -410,7 +447,19 @@ void Axis::Update(const Camera& camera, float viewportWidth, float viewportHeigh
     GenerateGridLines(camera, viewportWidth, viewportHeight);
     GenerateAxes(camera, viewportWidth, viewportHeight);
     GenerateLabels(camera, viewportWidth, viewportHeight);
+    UploadGeometry();
 
+    float buffer = CalculateDynamicBuffer(camera, halfWidth, halfHeight);
+    cachedBounds = glm::vec4(
+        camera.position.x - halfWidth * buffer, camera.position.x + halfWidth * buffer,
+        camera.position.y - halfHeight * buffer, camera.position.y + halfHeight * buffer);
+    cachedZoom = camera.zoom;
+    cachedAspect = aspect;
+    cachedStyle = style;
+    cacheValid = true;
+}
+
+void Axis::UploadGeometry() {
     // Upload grid to GPU (only if we have data)
     glBindVertexArray(VAO);
 
@@ -484,6 +533,7 @@ void Axis::Update(const Camera& camera, float viewportWidth, float viewportHeigh
 // Drawing
 // ============================================================================
 void Axis::Draw(GLuint program, const glm::mat4& projView) {
+    GpuProfiler::Scope profile("axis");
     glUseProgram(program);
 
     // Set projection matrix
@@ -555,16 +605,39 @@ bool Axis::IsNearXAxis(float yWorld, const Camera& cam, float vw, float vh, floa
 // ============================================================================
 void Axis::DrawLabels(TextRenderer& textRenderer, const Camera& camera,
     float viewportWidth, float viewportHeight) {
-
 #ifdef NO_TEXT_RENDERING
-    return;
-#endif
-
-    // Mark parameters as used to avoid warnings
+    // The Python module builds without text_renderer.cpp
     (void)textRenderer;
     (void)camera;
     (void)viewportWidth;
     (void)viewportHeight;
+#else
+    const float margin = 4.0f;   // Pixels between a label and its axis
+    const float scale = 0.6f;
+    const glm::vec3 labelColor(0.8f, 0.8f, 0.9f);
+
+    // Axes off screen keep their labels along the nearest edge
+    float xAxisY = glm::clamp(WorldToScreenY(0.0f, camera, viewportHeight),
+        0.0f, viewportHeight - textRenderer.MeasureText("0", scale).y - margin);
+    float yAxisX = glm::clamp(WorldToScreenX(0.0f, camera, viewportWidth, viewportHeight),
+        0.0f, viewportWidth);
+
+    // Every label goes into one batch, drawn by the single Flush below
+    for (const GridLabel& label : labels) {
+        glm::vec2 size = textRenderer.MeasureText(label.text, scale);
+        float x, y;
+        if (label.isXAxis) {
+            x = WorldToScreenX(label.position.x, camera, viewportWidth, viewportHeight) - size.x * 0.5f;
+            y = xAxisY + margin;
+        }
+        else {
+            x = std::max(yAxisX - margin - size.x, margin);
+            y = WorldToScreenY(label.position.y, camera, viewportHeight) - size.y * 0.5f;
+        }
+        if (x + size.x < 0.0f || x > viewportWidth || y + size.y < 0.0f || y > viewportHeight) continue;
 
-    return;
+        textRenderer.AddText(label.text, x, y, scale, labelColor, label.opacity);
+    }
+    textRenderer.Flush(viewportWidth, viewportHeight);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,560 @@
+#include "broadphase.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+#include <utility>
+
+// Grid build passes - MUST MATCH broadphase_grid.comp
+enum GridPass
+{
+    GRID_PASS_CLEAR = 0,
+    GRID_PASS_EXTENT = 1,
+    GRID_PASS_COUNT = 2,
+    GRID_PASS_SCAN_LOCAL = 3,
+    GRID_PASS_SCAN_BLOCKS = 4,
+    GRID_PASS_SCAN_ADD = 5,
+    GRID_PASS_SCATTER = 6
+};
+
+// LBVH build passes - MUST MATCH broadphase_lbvh.comp
+enum LBVHPass
+{
+    LBVH_PASS_CLEAR_BOUNDS = 0,
+    LBVH_PASS_BOUNDS = 1,
+    LBVH_PASS_MORTON = 2,
+    LBVH_PASS_RADIX_HISTOGRAM = 3,
+    LBVH_PASS_RADIX_SCAN = 4,
+    LBVH_PASS_RADIX_SCATTER = 5,
+    LBVH_PASS_BUILD = 6,
+    LBVH_PASS_REFIT = 7
+};
+
+// Skin check passes - MUST MATCH broadphase_skin.comp
+enum SkinPass
+{
+    SKIN_PASS_DISPLACEMENT = 0,
+    SKIN_PASS_DECIDE = 1,
+    SKIN_PASS_REFERENCE = 2
+};
+
+static const GLuint BROADPHASE_WORK_GROUP_SIZE = 256;
+static const GLsizeiptr GRID_CELLS_HEADER_SIZE = 4 * sizeof(GLuint);
+static const GLsizeiptr BVH_NODE_SIZE = 32;      // std430 BVHNode
+static const int RADIX_BITS_PER_PASS = 4;
+static const int RADIX_DIGITS = 1 << RADIX_BITS_PER_PASS;
+static const GLsizeiptr SKIN_CONTROL_HEADER_SIZE = 4 * sizeof(GLuint);
+static const int SKIN_GATED_SLOTS = 3;  // Distinct group counts of a build: objects, cells, one
+
+// Grid buffers
+static GLuint g_gridCellsSSBO = 0;      // Header + (count, start) per cell
+static GLuint g_gridObjectsSSBO = 0;    // (cell key, rank) per object
+static GLuint g_gridSortedSSBO = 0;     // Object indices sorted by cell
+static GLuint g_gridBlockSumsSSBO = 0;  // Per-block totals for the two-level scan
+static GLuint g_gridTableSize = 256;
+static int g_maxObjects = 0;
+static float g_periodicBox[4] = { 0.0f, 0.0f, 0.0f, 0.0f };  // (min x, min y, size x, size y), size 0 = off
+
+// LBVH buffers
+static GLuint g_bvhNodesSSBO = 0;        // 2N-1 nodes, internal first then leaves
+static GLuint g_sortSSBO[2] = { 0, 0 };  // Radix sort ping-pong (morton code, object index)
+static GLuint g_radixHistogramSSBO = 0;  // Digit-major per-block histogram
+static GLuint g_sceneBoundsSSBO = 0;     // Scene AABB of collidable centres
+
+// Skin reuse: header + indirect arguments, reference state, Verlet lists
+static GLuint g_skinControlSSBO = 0;
+static GLuint g_skinReferenceSSBO = 0;
+static GLuint g_neighbourListsSSBO = 0;
+static bool g_skinValid = false;          // The buffers hold a collision build of the state below
+static BroadphaseMode g_skinMode = BROADPHASE_ALL_PAIRS;
+static int g_skinObjects = 0;
+static float g_collisionSkin = 0.0f;
+static bool g_gatedBuild = false;         // Build passes take their group counts from the skin check
+static bool g_excludeStatic = false;      // Build passes leave out static colliders (collision builds)
+static bool g_objectBounds = false;       // Build passes read the extents of object_bounds.h
+static GLuint g_gatedGroups[SKIN_GATED_SLOTS] = { 0, 0, 0 };
+
+// Async shader loading
+struct BroadphaseProgram
+{
+    GLuint program = 0;
+    AsyncShaderLoader loader;
+    bool ready = false;
+    GLint passLoc = -1;
+    GLint numObjectsLoc = -1;
+    GLint tableSizeLoc = -1;
+    GLint neighbourCellSizeLoc = -1;
+    GLint mergeWorldsLoc = -1;
+    GLint periodicBoxLoc = -1;
+    GLint radixShiftLoc = -1;
+    GLint numBlocksLoc = -1;
+    GLint skinLoc = -1;
+    GLint forceLoc = -1;
+    GLint groupCountsLoc = -1;
+    GLint staticCollidersLoc = -1;
+    GLint objectBoundsLoc = -1;
+};
+
+static BroadphaseProgram g_gridProgram;
+static BroadphaseProgram g_lbvhProgram;
+static BroadphaseProgram g_skinProgram;
+
+// Create an SSBO of the given size if it does not exist yet
+static void EnsureBuffer(GLuint& buffer, GLsizeiptr size)
+{
+    BufferHelpers::EnsureBufferCapacity(buffer, size);
+}
+
+static GLuint NumBlocks(GLuint numItems)
+{
+    return (std::max(numItems, 1u) + BROADPHASE_WORK_GROUP_SIZE - 1) / BROADPHASE_WORK_GROUP_SIZE;
+}
+
+// Smallest power of two with roughly two cells per object
+static GLuint ComputeTableSize(int numObjects)
+{
+    GLuint wanted = static_cast<GLuint>(std::max(numObjects, 1)) * 2;
+    GLuint size = BROADPHASE_WORK_GROUP_SIZE;
+    while (size < wanted && size < static_cast<GLuint>(Broadphase::MAX_GRID_CELLS))
+        size <<= 1;
+    return size;
+}
+
+// Run a single build pass over the given number of items
+static void DispatchPass(const BroadphaseProgram& prog, int pass, GLuint numItems)
+{
+    glUniform1i(prog.passLoc, pass);
+
+    // A gated build reads the same group count from the slot the skin check wrote for it
+    GLuint groups = NumBlocks(numItems);
+    const GLuint* slot = g_gatedBuild ? std::find(g_gatedGroups, g_gatedGroups + SKIN_GATED_SLOTS, groups)
+                                      : g_gatedGroups + SKIN_GATED_SLOTS;
+    if (slot != g_gatedGroups + SKIN_GATED_SLOTS)
+        glDispatchComputeIndirect(SKIN_CONTROL_HEADER_SIZE + (slot - g_gatedGroups) * 4 * sizeof(GLuint));
+    else
+        glDispatchCompute(groups, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// Start the async load of a build shader and cache its uniforms on completion
+static void LoadBroadphaseProgram(BroadphaseProgram& prog, const std::string& file)
+{
+    if (prog.program != 0) return;
+
+    BroadphaseProgram* target = &prog;
+    prog.loader.LoadComputeShaderAsync(
+        file,
+        [target](GLuint program)
+        {
+            target->program = program;
+            target->passLoc = glGetUniformLocation(program, "uPass");
+            target->numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+            target->tableSizeLoc = glGetUniformLocation(program, "uGridTableSize");
+            target->neighbourCellSizeLoc = glGetUniformLocation(program, "uNeighbourCellSize");
+            target->mergeWorldsLoc = glGetUniformLocation(program, "uMergeWorlds");
+            target->periodicBoxLoc = glGetUniformLocation(program, "uPeriodicBox");
+            target->radixShiftLoc = glGetUniformLocation(program, "uRadixShift");
+            target->numBlocksLoc = glGetUniformLocation(program, "uNumBlocks");
+            target->skinLoc = glGetUniformLocation(program, "uSkin");
+            target->forceLoc = glGetUniformLocation(program, "uForce");
+            target->groupCountsLoc = glGetUniformLocation(program, "uGroupCounts");
+            target->staticCollidersLoc = glGetUniformLocation(program, "uStaticColliders");
+            target->objectBoundsLoc = glGetUniformLocation(program, "uObjectBounds");
+            target->ready = (target->passLoc != -1);
+        },
+        [target, file](const std::string& error)
+        {
+            std::cerr << "\n[Broadphase] " << file << " FAILED: " << error << std::endl;
+            target->ready = false;
+        });
+}
+
+static void ReleaseBroadphaseProgram(BroadphaseProgram& prog)
+{
+    if (prog.program) glDeleteProgram(prog.program);
+    prog.program = 0;
+    prog.ready = false;
+}
+
+// ============================================================================
+// Uniform grid: extent -> count -> prefix sum -> scatter
+// A positive neighbourCellSize indexes every object at that fixed cell size instead
+// of only collidable objects at twice the largest collision radius; mergeWorlds hashes
+// every object as world 0. A collision grid built with a skin widens its cells by it.
+// ============================================================================
+static bool BuildGrid(GLuint objectSSBO, GLuint collisionPropsSSBO, int numObjects, float neighbourCellSize = 0.0f,
+                      bool mergeWorlds = false, bool periodic = false, float skin = 0.0f)
+{
+    static const float NOT_PERIODIC[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const BroadphaseProgram& prog = g_gridProgram;
+    g_gridTableSize = ComputeTableSize(numObjects);
+    GLuint objectCount = static_cast<GLuint>(numObjects);
+
+    glUseProgram(prog.program);
+    if (prog.numObjectsLoc != -1) glUniform1i(prog.numObjectsLoc, numObjects);
+    if (prog.tableSizeLoc != -1) glUniform1ui(prog.tableSizeLoc, g_gridTableSize);
+    if (prog.neighbourCellSizeLoc != -1) glUniform1f(prog.neighbourCellSizeLoc, neighbourCellSize);
+    if (prog.mergeWorldsLoc != -1) glUniform1i(prog.mergeWorldsLoc, mergeWorlds ? 1 : 0);
+    if (prog.periodicBoxLoc != -1) glUniform4fv(prog.periodicBoxLoc, 1, periodic ? g_periodicBox : NOT_PERIODIC);
+    if (prog.skinLoc != -1) glUniform1f(prog.skinLoc, skin);
+    if (prog.staticCollidersLoc != -1) glUniform1i(prog.staticCollidersLoc, g_excludeStatic ? 1 : 0);
+    if (prog.objectBoundsLoc != -1) glUniform1i(prog.objectBoundsLoc, g_objectBounds ? 1 : 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, collisionPropsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_GRID_CELLS_BINDING, g_gridCellsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_GRID_OBJECTS_BINDING, g_gridObjectsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_GRID_SORTED_BINDING, g_gridSortedSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_GRID_BLOCK_SUMS_BINDING, g_gridBlockSumsSSBO);
+
+    DispatchPass(prog, GRID_PASS_CLEAR, g_gridTableSize);
+    if (neighbourCellSize <= 0.0f) DispatchPass(prog, GRID_PASS_EXTENT, objectCount);
+    DispatchPass(prog, GRID_PASS_COUNT, objectCount);
+    DispatchPass(prog, GRID_PASS_SCAN_LOCAL, g_gridTableSize);
+    DispatchPass(prog, GRID_PASS_SCAN_BLOCKS, 1);
+    DispatchPass(prog, GRID_PASS_SCAN_ADD, g_gridTableSize);
+    DispatchPass(prog, GRID_PASS_SCATTER, objectCount);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_GRID_OBJECTS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_GRID_BLOCK_SUMS_BINDING, 0);
+    glUseProgram(0);
+    return true;
+}
+
+// ============================================================================
+// LBVH: bounds -> morton -> radix sort -> hierarchy -> refit
+// ============================================================================
+static bool BuildLBVH(GLuint objectSSBO, GLuint collisionPropsSSBO, int numObjects)
+{
+    // A single object has nothing to collide with
+    if (numObjects < 2) return false;
+
+    const BroadphaseProgram& prog = g_lbvhProgram;
+    GLuint objectCount = static_cast<GLuint>(numObjects);
+
+    glUseProgram(prog.program);
+    if (prog.numObjectsLoc != -1) glUniform1i(prog.numObjectsLoc, numObjects);
+    if (prog.numBlocksLoc != -1) glUniform1ui(prog.numBlocksLoc, NumBlocks(objectCount));
+    if (prog.staticCollidersLoc != -1) glUniform1i(prog.staticCollidersLoc, g_excludeStatic ? 1 : 0);
+    if (prog.objectBoundsLoc != -1) glUniform1i(prog.objectBoundsLoc, g_objectBounds ? 1 : 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, collisionPropsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_BVH_NODES_BINDING, g_bvhNodesSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_RADIX_HISTOGRAM_BINDING, g_radixHistogramSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SCENE_BOUNDS_BINDING, g_sceneBoundsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_IN_BINDING, g_sortSSBO[0]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_OUT_BINDING, g_sortSSBO[1]);
+
+    DispatchPass(prog, LBVH_PASS_CLEAR_BOUNDS, 1);
+    DispatchPass(prog, LBVH_PASS_BOUNDS, objectCount);
+    DispatchPass(prog, LBVH_PASS_MORTON, objectCount);
+
+    // LSD radix sort of 32-bit codes; an even pass count leaves the result in g_sortSSBO[0]
+    int src = 0;
+    for (int shift = 0; shift < 32; shift += RADIX_BITS_PER_PASS)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_IN_BINDING, g_sortSSBO[src]);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_OUT_BINDING, g_sortSSBO[1 - src]);
+        if (prog.radixShiftLoc != -1) glUniform1ui(prog.radixShiftLoc, static_cast<GLuint>(shift));
+
+        DispatchPass(prog, LBVH_PASS_RADIX_HISTOGRAM, objectCount);
+        DispatchPass(prog, LBVH_PASS_RADIX_SCAN, 1);
+        DispatchPass(prog, LBVH_PASS_RADIX_SCATTER, objectCount);
+        src = 1 - src;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_IN_BINDING, g_sortSSBO[src]);
+    DispatchPass(prog, LBVH_PASS_BUILD, objectCount);
+    DispatchPass(prog, LBVH_PASS_REFIT, objectCount);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_IN_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_OUT_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_RADIX_HISTOGRAM_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SCENE_BOUNDS_BINDING, 0);
+    glUseProgram(0);
+    return true;
+}
+
+// ============================================================================
+// Initialize broadphase buffers and start loading the build shaders
+// ============================================================================
+bool Broadphase::Init(int maxObjects)
+{
+    if (!Reserve(maxObjects)) return false;
+
+    LoadBroadphaseProgram(g_gridProgram, "broadphase_grid.comp");
+    LoadBroadphaseProgram(g_lbvhProgram, "broadphase_lbvh.comp");
+    LoadBroadphaseProgram(g_skinProgram, "broadphase_skin.comp");
+    return true;
+}
+
+bool Broadphase::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+    GLsizeiptr objects = static_cast<GLsizeiptr>(maxObjects);
+
+    EnsureBuffer(g_gridCellsSSBO, GRID_CELLS_HEADER_SIZE + MAX_GRID_CELLS * 2 * sizeof(GLuint));
+    EnsureBuffer(g_gridObjectsSSBO, objects * 2 * sizeof(GLuint));
+    EnsureBuffer(g_gridSortedSSBO, objects * sizeof(GLuint));
+    EnsureBuffer(g_gridBlockSumsSSBO, (MAX_GRID_CELLS / BROADPHASE_WORK_GROUP_SIZE) * sizeof(GLuint));
+
+    EnsureBuffer(g_bvhNodesSSBO, std::max<GLsizeiptr>(2 * objects - 1, 1) * BVH_NODE_SIZE);
+    EnsureBuffer(g_sortSSBO[0], objects * 2 * sizeof(GLuint));
+    EnsureBuffer(g_sortSSBO[1], objects * 2 * sizeof(GLuint));
+    EnsureBuffer(g_radixHistogramSSBO, RADIX_DIGITS * NumBlocks(static_cast<GLuint>(maxObjects)) * sizeof(GLuint));
+    EnsureBuffer(g_sceneBoundsSSBO, 4 * sizeof(GLuint));
+
+    // Skin reuse; more objects force the next collision build, which starts a new list generation
+    EnsureBuffer(g_skinControlSSBO, SKIN_CONTROL_HEADER_SIZE + SKIN_GATED_SLOTS * 4 * sizeof(GLuint));
+    EnsureBuffer(g_skinReferenceSSBO, objects * 4 * sizeof(float));
+    EnsureBuffer(g_neighbourListsSSBO, objects * NEIGHBOUR_LIST_STRIDE * sizeof(GLuint));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[Broadphase] Failed to allocate broadphase buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Rebuild the structure for the requested mode
+// ============================================================================
+bool Broadphase::Build(BroadphaseMode mode, GLuint objectSSBO, GLuint collisionPropsSSBO, int numObjects,
+                       bool objectBounds)
+{
+    if (!IsReady(mode)) return false;
+    if (numObjects <= 0 || numObjects > g_maxObjects) return false;
+    g_skinValid = false;
+    g_collisionSkin = 0.0f;
+
+    g_objectBounds = objectBounds;
+    bool built = false;
+    switch (mode)
+    {
+    case BROADPHASE_UNIFORM_GRID: built = BuildGrid(objectSSBO, collisionPropsSSBO, numObjects, 0.0f, false, true); break;
+    case BROADPHASE_LBVH:         built = BuildLBVH(objectSSBO, collisionPropsSSBO, numObjects); break;
+    default:                      break;
+    }
+    g_objectBounds = false;
+    return built;
+}
+
+// ============================================================================
+// Collision build reused while every object stays within half the skin of where it was
+// ============================================================================
+bool Broadphase::BuildForCollision(BroadphaseMode mode, GLuint objectSSBO, GLuint collisionPropsSSBO, int numObjects,
+                                   float skin, bool rebuild, bool excludeStatic, bool objectBounds)
+{
+    if (skin <= 0.0f || !g_skinProgram.ready)
+    {
+        g_excludeStatic = excludeStatic;
+        bool built = Build(mode, objectSSBO, collisionPropsSSBO, numObjects, objectBounds);
+        g_excludeStatic = false;
+        return built;
+    }
+    if (!IsReady(mode)) return false;
+    if (numObjects <= 0 || numObjects > g_maxObjects) return false;
+    if (mode == BROADPHASE_LBVH && numObjects < 2) return false;  // BuildLBVH has nothing to build
+
+    bool force = rebuild || !g_skinValid || mode != g_skinMode || numObjects != g_skinObjects || skin != g_collisionSkin;
+    GLuint objectCount = static_cast<GLuint>(numObjects);
+    GLuint cellCount = mode == BROADPHASE_UNIFORM_GRID ? ComputeTableSize(numObjects) : objectCount;
+    g_gatedGroups[0] = NumBlocks(objectCount);
+    g_gatedGroups[1] = NumBlocks(cellCount);
+    g_gatedGroups[2] = 1;
+
+    // Largest displacement since the last rebuild, then the decision and the dispatch arguments
+    const BroadphaseProgram& prog = g_skinProgram;
+    glUseProgram(prog.program);
+    if (prog.numObjectsLoc != -1) glUniform1i(prog.numObjectsLoc, numObjects);
+    if (prog.skinLoc != -1) glUniform1f(prog.skinLoc, skin);
+    if (prog.forceLoc != -1) glUniform1i(prog.forceLoc, force ? 1 : 0);
+    if (prog.groupCountsLoc != -1) glUniform1uiv(prog.groupCountsLoc, SKIN_GATED_SLOTS, g_gatedGroups);
+    if (prog.objectBoundsLoc != -1) glUniform1i(prog.objectBoundsLoc, objectBounds ? 1 : 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, collisionPropsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SKIN_CONTROL_BINDING, g_skinControlSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SKIN_REFERENCE_BINDING, g_skinReferenceSSBO);
+    if (!force) DispatchPass(prog, SKIN_PASS_DISPLACEMENT, objectCount);
+    DispatchPass(prog, SKIN_PASS_DECIDE, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, g_skinControlSSBO);
+    g_gatedBuild = true;
+    g_excludeStatic = excludeStatic;
+    g_objectBounds = objectBounds;
+    bool built = (mode == BROADPHASE_UNIFORM_GRID)
+        ? BuildGrid(objectSSBO, collisionPropsSSBO, numObjects, 0.0f, false, true, skin)
+        : BuildLBVH(objectSSBO, collisionPropsSSBO, numObjects);
+    g_excludeStatic = false;
+    g_objectBounds = false;
+
+    // The state the next checks measure from, on rebuilds only
+    glUseProgram(prog.program);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, collisionPropsSSBO);
+    DispatchPass(prog, SKIN_PASS_REFERENCE, objectCount);
+    g_gatedBuild = false;
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SKIN_CONTROL_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SKIN_REFERENCE_BINDING, 0);
+    glUseProgram(0);
+
+    g_skinValid = built;
+    g_skinMode = mode;
+    g_skinObjects = numObjects;
+    g_collisionSkin = built ? skin : 0.0f;
+    return built;
+}
+
+float Broadphase::GetCollisionSkin()
+{
+    return g_collisionSkin;
+}
+
+GLuint Broadphase::GetSkinRebuilds()
+{
+    if (g_skinControlSSBO == 0) return 0;
+    GLuint generation = 0;
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_skinControlSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), sizeof(GLuint), &generation);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return generation;
+}
+
+// ============================================================================
+// Neighbour grid over every object, read by nsum/ncount/nmean in math.comp
+// ============================================================================
+bool Broadphase::BuildNeighbourGrid(GLuint objectSSBO, GLuint collisionPropsSSBO, int numObjects, float cellSize,
+                                    bool mergeWorlds, bool periodic)
+{
+    if (!g_gridProgram.ready || cellSize <= 0.0f) return false;
+    if (numObjects <= 0 || numObjects > g_maxObjects) return false;
+    if (g_skinMode == BROADPHASE_UNIFORM_GRID) g_skinValid = false;  // Same buffers as the collision grid
+    return BuildGrid(objectSSBO, collisionPropsSSBO, numObjects, cellSize, mergeWorlds, periodic);
+}
+
+// ============================================================================
+// Periodic box the grids wrap their cells in
+// ============================================================================
+void Broadphase::SetPeriodicBox(float minX, float minY, float maxX, float maxY)
+{
+    bool periodic = maxX > minX && maxY > minY;
+    float box[4] = { periodic ? minX : 0.0f, periodic ? minY : 0.0f,
+                     periodic ? maxX - minX : 0.0f, periodic ? maxY - minY : 0.0f };
+    if (!std::equal(box, box + 4, g_periodicBox)) g_skinValid = false;  // The cells moved
+    std::copy(box, box + 4, g_periodicBox);
+}
+
+void Broadphase::BindNeighbourGrid()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_GRID_CELLS_BINDING, g_gridCellsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_GRID_SORTED_BINDING, g_gridSortedSSBO);
+}
+
+void Broadphase::UnbindNeighbourGrid()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_GRID_CELLS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_GRID_SORTED_BINDING, 0);
+}
+
+// ============================================================================
+// Bind/unbind the buffers read by the collision loop in math.comp
+// ============================================================================
+void Broadphase::BindForCollision(BroadphaseMode mode)
+{
+    if (mode == BROADPHASE_UNIFORM_GRID)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_GRID_CELLS_BINDING, g_gridCellsSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_GRID_SORTED_BINDING, g_gridSortedSSBO);
+    }
+    else if (mode == BROADPHASE_LBVH)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_BVH_NODES_BINDING, g_bvhNodesSSBO);
+    }
+
+    // Verlet lists, read and written by collide.comp while the structure carries a skin
+    if (g_collisionSkin > 0.0f)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_NEIGHBOUR_LISTS_BINDING, g_neighbourListsSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SKIN_CONTROL_BINDING, g_skinControlSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SKIN_REFERENCE_BINDING, g_skinReferenceSSBO);
+    }
+}
+
+void Broadphase::UnbindForCollision()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_GRID_CELLS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_GRID_SORTED_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_BVH_NODES_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_NEIGHBOUR_LISTS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SKIN_CONTROL_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SKIN_REFERENCE_BINDING, 0);
+}
+
+// ============================================================================
+// Release broadphase buffers and build programs
+// ============================================================================
+void Broadphase::Cleanup()
+{
+    ReleaseBroadphaseProgram(g_gridProgram);
+    ReleaseBroadphaseProgram(g_lbvhProgram);
+    ReleaseBroadphaseProgram(g_skinProgram);
+
+    GLuint* buffers[] = {
+        &g_gridCellsSSBO, &g_gridObjectsSSBO, &g_gridSortedSSBO, &g_gridBlockSumsSSBO,
+        &g_bvhNodesSSBO, &g_sortSSBO[0], &g_sortSSBO[1], &g_radixHistogramSSBO, &g_sceneBoundsSSBO,
+        &g_skinControlSSBO, &g_skinReferenceSSBO, &g_neighbourListsSSBO
+    };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+
+    g_gridTableSize = BROADPHASE_WORK_GROUP_SIZE;
+    g_maxObjects = 0;
+    g_skinValid = false;
+    g_skinObjects = 0;
+    g_collisionSkin = 0.0f;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void Broadphase::UpdateShaderLoadingStatus()
+{
+    g_gridProgram.loader.Update();
+    g_lbvhProgram.loader.Update();
+    g_skinProgram.loader.Update();
+}
+
+bool Broadphase::IsReady(BroadphaseMode mode)
+{
+    switch (mode)
+    {
+    case BROADPHASE_UNIFORM_GRID: return g_gridProgram.ready;
+    case BROADPHASE_LBVH:         return g_lbvhProgram.ready;
+    default:                      return false;
+    }
+}
+
+std::string Broadphase::GetShaderLoadStatusMessage()
+{
+    if (!g_gridProgram.ready) return "[grid] " + g_gridProgram.loader.GetStatusMessage();
+    if (!g_lbvhProgram.ready) return "[lbvh] " + g_lbvhProgram.loader.GetStatusMessage();
+    if (!g_skinProgram.ready) return "[skin] " + g_skinProgram.loader.GetStatusMessage();
+    return "Broadphase shaders ready";
+}
+
+GLuint Broadphase::GetGridTableSize()
+{
+    return g_gridTableSize;
+}
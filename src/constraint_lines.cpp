@@ -0,0 +1,123 @@
+#include "constraint_lines.h"
+#include "async_shader_loader.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <iostream>
+
+static const float CONSTRAINT_LINES_ALPHA = 0.8f;
+
+static GLuint g_vao = 0;  // No attributes, constraint_lines.vert pulls from the SSBOs
+static float g_strainScale = CONSTRAINT_LINES_DEFAULT_STRAIN_SCALE;
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_projViewLoc = -1, g_numObjectsLoc = -1, g_strainScaleLoc = -1, g_alphaLoc = -1;
+
+// ============================================================================
+// Start loading the shader
+// ============================================================================
+bool ConstraintLines::Init()
+{
+    if (g_vao == 0) glGenVertexArrays(1, &g_vao);
+
+    if (g_program == 0)
+    {
+        g_loader.LoadGraphicsShaderAsync(
+            "constraint_lines.vert",
+            "trail.frag",
+            "",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_projViewLoc = glGetUniformLocation(program, "uProjView");
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_strainScaleLoc = glGetUniformLocation(program, "uStrainScale");
+                g_alphaLoc = glGetUniformLocation(program, "uAlpha");
+                g_ready = (g_projViewLoc != -1 && g_numObjectsLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ConstraintLines] constraint line shaders FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ConstraintLines] Failed to create the vertex array (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ConstraintLines::SetStrainScale(float scale)
+{
+    if (scale > 0.0f) g_strainScale = scale;
+}
+
+float ConstraintLines::GetStrainScale()
+{
+    return g_strainScale;
+}
+
+// ============================================================================
+// Every constraint edge in one instanced call
+// ============================================================================
+void ConstraintLines::Draw(const glm::mat4& projView, GLuint objectSSBO, GLuint constraintsSSBO, GLuint rowsSSBO,
+                           int numObjects, int rows, int maxPerRow)
+{
+    if (!g_ready || objectSSBO == 0 || constraintsSSBO == 0 || rowsSSBO == 0) return;
+    if (numObjects <= 0 || rows <= 0 || maxPerRow <= 0) return;
+
+    glUseProgram(g_program);
+    glUniformMatrix4fv(g_projViewLoc, 1, GL_FALSE, glm::value_ptr(projView));
+    glUniform1i(g_numObjectsLoc, numObjects);
+    if (g_strainScaleLoc != -1) glUniform1f(g_strainScaleLoc, g_strainScale);
+    if (g_alphaLoc != -1) glUniform1f(g_alphaLoc, CONSTRAINT_LINES_ALPHA);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONSTRAINT_LINES_CONSTRAINTS_BINDING, constraintsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONSTRAINT_LINES_OBJECTS_BINDING, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONSTRAINT_LINES_ROWS_BINDING, rowsSSBO);
+
+    glBindVertexArray(g_vao);
+    glDrawArraysInstanced(GL_LINES, 0, 2 * maxPerRow, std::min(rows, numObjects));
+    glBindVertexArray(0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONSTRAINT_LINES_CONSTRAINTS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONSTRAINT_LINES_OBJECTS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONSTRAINT_LINES_ROWS_BINDING, 0);
+    glUseProgram(0);
+}
+
+// ============================================================================
+// Release the program
+// ============================================================================
+void ConstraintLines::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    if (g_vao) glDeleteVertexArrays(1, &g_vao);
+    g_program = 0;
+    g_vao = 0;
+    g_ready = false;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ConstraintLines::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool ConstraintLines::IsReady()
+{
+    return g_ready;
+}
+
+std::string ConstraintLines::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[constraint lines] " + g_loader.GetStatusMessage();
+    return "Constraint line shaders ready";
+}
@@ -0,0 +1,165 @@
+#include "contact_events.h"
+#include <algorithm>
+
+static const GLsizeiptr EVENTS_HEADER_SIZE = 4 * sizeof(GLuint);  // Event count, padded to 16 bytes
+static const size_t MAX_PENDING_EVENTS = 1 << 20;                 // Host backlog when Take() is not called
+
+static GLuint g_eventsSSBO = 0;
+static GLuint g_stagingBuffer = 0;  // Last copy, read once g_stagingFence has signalled
+static GLsync g_stagingFence = nullptr;
+static GLsizeiptr g_bufferSize = 0;
+
+static bool g_enabled = false;
+static bool g_clearPending = false;  // Enabled since the last step; stale events are dropped
+static uint32_t g_categoryMask = 0xFFFFFFFFu;
+static int g_capacity = ContactEvents::CONTACT_EVENTS_DEFAULT_CAPACITY;
+
+static std::vector<ContactEvent> g_pending;
+static uint64_t g_dropped = 0;
+
+static void ClearCount()
+{
+    GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_eventsSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+static void ReleaseBuffers()
+{
+    if (g_stagingFence) glDeleteSync(g_stagingFence);
+    g_stagingFence = nullptr;
+    GLuint* buffers[] = { &g_eventsSSBO, &g_stagingBuffer };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_bufferSize = 0;
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+void ContactEvents::SetEnabled(bool enabled)
+{
+    if (enabled && !g_enabled) g_clearPending = true;
+    g_enabled = enabled;
+}
+
+bool ContactEvents::IsEnabled()
+{
+    return g_enabled;
+}
+
+void ContactEvents::SetCategoryMask(uint32_t mask)
+{
+    g_categoryMask = mask;
+}
+
+void ContactEvents::SetCapacity(int events)
+{
+    events = std::max(events, 1);
+    if (events != g_capacity) g_clearPending = true;  // Bind() reallocates
+    g_capacity = events;
+}
+
+// ============================================================================
+// Per step
+// ============================================================================
+void ContactEvents::Bind()
+{
+    if (!g_enabled) return;
+    GLsizeiptr size = EVENTS_HEADER_SIZE + static_cast<GLsizeiptr>(g_capacity) * sizeof(ContactEvent);
+    if (g_eventsSSBO == 0 || g_bufferSize != size)
+    {
+        ReleaseBuffers();
+        glGenBuffers(1, &g_eventsSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_eventsSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glGenBuffers(1, &g_stagingBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, g_stagingBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_READ);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        g_bufferSize = size;
+        g_clearPending = true;
+    }
+    if (g_clearPending)
+    {
+        if (g_stagingFence) glDeleteSync(g_stagingFence);
+        g_stagingFence = nullptr;
+        ClearCount();
+        g_pending.clear();
+        g_dropped = 0;
+        g_clearPending = false;
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONTACT_EVENTS_BINDING, g_eventsSSBO);
+}
+
+void ContactEvents::Unbind()
+{
+    if (!g_enabled) return;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONTACT_EVENTS_BINDING, 0);
+}
+
+GLuint ContactEvents::ShaderMask()
+{
+    return (g_enabled && g_eventsSSBO) ? g_categoryMask : 0u;
+}
+
+void ContactEvents::EndStep()
+{
+    if (!g_enabled || g_eventsSSBO == 0) return;
+
+    // Collect an earlier copy once it has landed
+    if (g_stagingFence && glClientWaitSync(g_stagingFence, 0, 0) != GL_TIMEOUT_EXPIRED)
+    {
+        GLuint count = 0;
+        glBindBuffer(GL_COPY_READ_BUFFER, g_stagingBuffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(count), &count);
+        GLuint stored = std::min<GLuint>(count, static_cast<GLuint>(g_capacity));
+        size_t kept = std::min<size_t>(stored, MAX_PENDING_EVENTS - std::min(g_pending.size(), MAX_PENDING_EVENTS));
+        if (kept > 0)
+        {
+            size_t first = g_pending.size();
+            g_pending.resize(first + kept);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, EVENTS_HEADER_SIZE, kept * sizeof(ContactEvent), g_pending.data() + first);
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        g_dropped += count - kept;
+        glDeleteSync(g_stagingFence);
+        g_stagingFence = nullptr;
+    }
+
+    // While a copy is in flight the steps keep appending
+    if (g_stagingFence) return;
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, g_eventsSSBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, g_stagingBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, g_bufferSize);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    g_stagingFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();  // So the fence reaches the GPU even if nothing else is submitted before the poll
+    ClearCount();
+}
+
+void ContactEvents::Take(std::vector<ContactEvent>& events, uint64_t& dropped)
+{
+    events.swap(g_pending);
+    g_pending.clear();
+    dropped = g_dropped;
+    g_dropped = 0;
+}
+
+// ============================================================================
+// Release the buffers
+// ============================================================================
+void ContactEvents::Cleanup()
+{
+    ReleaseBuffers();
+    g_pending.clear();
+    g_dropped = 0;
+}
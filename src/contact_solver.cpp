@@ -0,0 +1,276 @@
+#include "contact_solver.h"
+#include "object_sleep.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+
+// Solver passes - MUST MATCH contact_solver.comp
+enum ContactPass
+{
+    CONTACT_PASS_CLEAR = 0,
+    CONTACT_PASS_ARGS = 1,
+    CONTACT_PASS_PREPARE = 2,
+    CONTACT_PASS_SOLVE = 3,
+    CONTACT_PASS_APPLY_VELOCITY = 4,
+    CONTACT_PASS_POSITION = 5,
+    CONTACT_PASS_APPLY_POSITION = 6,
+    CONTACT_PASS_STORE = 7,
+    CONTACT_PASS_EVENTS = 8
+};
+
+static const GLuint CONTACT_WORK_GROUP_SIZE = 64;
+static const int CONTACTS_PER_OBJECT = 4;                        // Pair capacity per object
+static const GLuint WARM_START_TABLE_SIZE = 1u << 20;            // Power of two, > pair capacity
+static const GLsizeiptr CONTACT_HEADER_SIZE = 4 * sizeof(GLuint);  // Dispatch groups xyz, pair count
+static const GLsizeiptr CONTACT_BODY_SIZE = 8 * sizeof(GLint);     // MUST MATCH ContactBody
+static const GLsizeiptr WARM_START_ENTRY_SIZE = 6 * sizeof(GLuint);  // MUST MATCH WarmStartEntry
+
+// Buffers (allocated on the first step that uses them)
+static GLuint g_pairsSSBO = 0;      // Dispatch arguments, pair count, pairs
+static GLuint g_bodiesSSBO = 0;     // Per-object counts and fixed-point accumulators
+static GLuint g_warmStartSSBO = 0;  // Open-addressing impulse table, one generation per step
+static int g_maxObjects = 0;
+static GLuint g_capacity = 0;
+static GLuint g_stepStamp = 2;      // Generation this step stores; the previous one is looked up
+static bool g_hasPairs = false;     // A step has filled the pair buffer
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_passLoc = -1;
+static GLint g_numObjectsLoc = -1;
+static GLint g_capacityLoc = -1;
+static GLint g_stepStampLoc = -1;
+static GLint g_tableSizeLoc = -1;
+static GLint g_warmStartLoc = -1;
+static GLint g_sleepStepsLoc = -1;
+static GLint g_contactEventsLoc = -1;
+
+// Create an SSBO of the given size, zero-filled, if it does not exist yet
+static void EnsureBuffer(GLuint& buffer, GLsizeiptr size)
+{
+    BufferHelpers::EnsureBufferCapacity(buffer, size);  // New space is zeroed
+}
+
+static GLuint NumBlocks(GLuint numItems)
+{
+    return (std::max(numItems, 1u) + CONTACT_WORK_GROUP_SIZE - 1) / CONTACT_WORK_GROUP_SIZE;
+}
+
+// Run a pass over the given number of objects
+static void DispatchObjectPass(int pass, GLuint numObjects)
+{
+    glUniform1i(g_passLoc, pass);
+    glDispatchCompute(NumBlocks(numObjects), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// Run a pass over the emitted pairs, sized on the GPU by the arguments pass
+static void DispatchContactPass(int pass)
+{
+    glUniform1i(g_passLoc, pass);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, g_pairsSSBO);
+    glDispatchComputeIndirect(0);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// ============================================================================
+// Start loading the solver shader (buffers follow on the first step)
+// ============================================================================
+bool ContactSolver::Init(int maxObjects)
+{
+    Reserve(maxObjects);
+
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "contact_solver.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_passLoc = glGetUniformLocation(program, "uPass");
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_capacityLoc = glGetUniformLocation(program, "uContactCapacity");
+                g_stepStampLoc = glGetUniformLocation(program, "uStepStamp");
+                g_tableSizeLoc = glGetUniformLocation(program, "uWarmStartTableSize");
+                g_warmStartLoc = glGetUniformLocation(program, "uWarmStart");
+                g_sleepStepsLoc = glGetUniformLocation(program, "uSleepSteps");
+                g_contactEventsLoc = glGetUniformLocation(program, "uContactEvents");
+                g_ready = (g_passLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ContactSolver] contact_solver.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+// The buffers grow to the new capacity on the next BeginStep
+bool ContactSolver::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+    g_capacity = static_cast<GLuint>(maxObjects * CONTACTS_PER_OBJECT);
+    return true;
+}
+
+// ============================================================================
+// Empty pair buffer -> narrowphase (collide.comp) appends
+// ============================================================================
+bool ContactSolver::BeginStep(int numObjects)
+{
+    if (!g_ready || numObjects <= 0 || numObjects > g_maxObjects) return false;
+
+    GLsizeiptr objects = static_cast<GLsizeiptr>(g_maxObjects);
+    EnsureBuffer(g_pairsSSBO, CONTACT_HEADER_SIZE + static_cast<GLsizeiptr>(g_capacity) * sizeof(ContactPair));
+    EnsureBuffer(g_bodiesSSBO, objects * CONTACT_BODY_SIZE);
+    EnsureBuffer(g_warmStartSSBO, static_cast<GLsizeiptr>(WARM_START_TABLE_SIZE) * WARM_START_ENTRY_SIZE);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glUseProgram(g_program);
+    if (g_numObjectsLoc != -1) glUniform1i(g_numObjectsLoc, numObjects);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONTACT_PAIRS_BINDING, g_pairsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONTACT_BODIES_BINDING, g_bodiesSSBO);
+
+    DispatchObjectPass(CONTACT_PASS_CLEAR, static_cast<GLuint>(numObjects));
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONTACT_PAIRS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONTACT_BODIES_BINDING, 0);
+    glUseProgram(0);
+    return true;
+}
+
+void ContactSolver::BindForCollision()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONTACT_PAIRS_BINDING, g_pairsSSBO);
+}
+
+void ContactSolver::UnbindForCollision()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONTACT_PAIRS_BINDING, 0);
+}
+
+GLuint ContactSolver::GetCapacity()
+{
+    return g_capacity;
+}
+
+// ============================================================================
+// Warm start -> iterations x (solve, apply) -> position split -> store impulses -> events
+// ============================================================================
+void ContactSolver::Solve(GLuint objectSSBO, int numObjects, int iterations, bool warmStart, bool useSleep,
+                          GLuint eventMask, GLuint collisionPropsSSBO)
+{
+    if (!g_ready || g_pairsSSBO == 0) return;
+
+    GLuint objectCount = static_cast<GLuint>(numObjects);
+
+    glUseProgram(g_program);
+    if (g_numObjectsLoc != -1) glUniform1i(g_numObjectsLoc, numObjects);
+    if (g_capacityLoc != -1) glUniform1ui(g_capacityLoc, g_capacity);
+    if (g_stepStampLoc != -1) glUniform1ui(g_stepStampLoc, g_stepStamp);
+    if (g_tableSizeLoc != -1) glUniform1ui(g_tableSizeLoc, WARM_START_TABLE_SIZE);
+    if (g_warmStartLoc != -1) glUniform1i(g_warmStartLoc, warmStart ? 1 : 0);
+    if (g_sleepStepsLoc != -1) glUniform1ui(g_sleepStepsLoc, useSleep ? static_cast<GLuint>(ObjectSleep::GetSleepSteps()) : 0u);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONTACT_PAIRS_BINDING, g_pairsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONTACT_BODIES_BINDING, g_bodiesSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONTACT_WARM_START_BINDING, g_warmStartSSBO);
+    if (useSleep) ObjectSleep::Bind();
+
+    DispatchObjectPass(CONTACT_PASS_ARGS, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+    DispatchContactPass(CONTACT_PASS_PREPARE);
+    DispatchObjectPass(CONTACT_PASS_APPLY_VELOCITY, objectCount);
+    for (int iter = 0; iter < std::max(1, iterations); iter++)
+    {
+        DispatchContactPass(CONTACT_PASS_SOLVE);
+        DispatchObjectPass(CONTACT_PASS_APPLY_VELOCITY, objectCount);
+    }
+    DispatchContactPass(CONTACT_PASS_POSITION);
+    DispatchObjectPass(CONTACT_PASS_APPLY_POSITION, objectCount);
+    if (warmStart) DispatchContactPass(CONTACT_PASS_STORE);
+
+    // Solved pairs with their accumulated impulses, into the buffer ContactEvents bound
+    if (eventMask != 0 && g_contactEventsLoc != -1)
+    {
+        glUniform1ui(g_contactEventsLoc, eventMask);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, collisionPropsSSBO);
+        DispatchContactPass(CONTACT_PASS_EVENTS);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, 0);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONTACT_PAIRS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONTACT_BODIES_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONTACT_WARM_START_BINDING, 0);
+    if (useSleep) ObjectSleep::Unbind();
+    glUseProgram(0);
+
+    // Without warm starting nothing is stored, so the next lookup must not see an old generation
+    g_stepStamp += warmStart ? 1u : 2u;
+    g_hasPairs = true;
+}
+
+void ContactSolver::ResetWarmStart()
+{
+    g_stepStamp += 2u;  // Entries of the last generation stop matching the next lookup
+}
+
+int ContactSolver::GetContactCount()
+{
+    if (!g_hasPairs || g_pairsSSBO == 0) return -1;
+
+    GLuint count = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_pairsSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 3 * sizeof(GLuint), sizeof(GLuint), &count);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return static_cast<int>(std::min(count, g_capacity));
+}
+
+// ============================================================================
+// Release buffers and the solver program
+// ============================================================================
+void ContactSolver::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    GLuint* buffers[] = { &g_pairsSSBO, &g_bodiesSSBO, &g_warmStartSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_maxObjects = 0;
+    g_capacity = 0;
+    g_stepStamp = 2;
+    g_hasPairs = false;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ContactSolver::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool ContactSolver::IsReady()
+{
+    return g_ready;
+}
+
+std::string ContactSolver::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[contact solver] " + g_loader.GetStatusMessage();
+    return "Contact solver shader ready";
+}
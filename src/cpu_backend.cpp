@@ -0,0 +1,2864 @@
+#include "cpu_backend.h"
+#include "gpu_serializer.h"
+#include "equation_optimizer.h"
+#include "object_params.h"
+#include "lookup_tables.h"
+#include "object_handles.h"
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+using CpuBackend::CPU_LANES;
+using CpuBackend::EquationSet;
+using CpuBackend::ObjectArrays;
+using CpuBackend::Scene;
+using namespace VariableHashes;
+using namespace PropertyHashes;
+
+// ============================================================================
+// CONSTANTS - MUST MATCH math.comp, constraints.comp and collide.comp
+// ============================================================================
+static const float SHADER_PI = 3.14159265359f;
+static const float SHADER_E = 2.71828182846f;
+static const float EPSILON = 1e-6f;
+static const float SAFE_MIN_VALUE = 1e-6f;
+static const float SAFE_MAX_EXP = 50.0f;
+static const float DERIVATIVE_H = 1e-4f;
+static const int MAX_DERIV_EXPR_SIZE = 500;
+static const int MAX_DUAL_STACK_SIZE = 32;
+static const int MAX_RPN_STACK_SIZE = 64;        // Pair reduction bodies
+static const float MAX_SPEED = 1000.0f;
+static const float BOUNDARY_FRICTION = 0.95f;
+static const int VAR_HASH_VIS_X = 100;           // p[i].width / p[i].height, shader-only hashes
+static const int VAR_HASH_VIS_Y = 101;
+static const float YOSHIDA_W1 = 1.3512071919596578f;
+static const float YOSHIDA_W0 = -1.7024143839193153f;
+static const float CONSTRAINT_STIFFNESS = 0.8f;
+static const int MAX_CONSTRAINT_ITERATIONS = 3;
+
+static const int BLOCK_STACK_DEPTH = 40;         // Deeper expressions run on the scalar interpreter
+static const int SCRATCH_FLOATS = 18;            // IntegratorScratch: base, rates, angular, firstAccel.xy, firstColor
+
+// ============================================================================
+// MATH HELPERS (the GLSL built-ins and math.comp helpers they stand for)
+// ============================================================================
+struct Complex
+{
+    float x, y;
+};
+
+static inline Complex operator+(Complex a, Complex b) { return { a.x + b.x, a.y + b.y }; }
+static inline Complex operator-(Complex a, Complex b) { return { a.x - b.x, a.y - b.y }; }
+static inline Complex operator-(Complex a) { return { -a.x, -a.y }; }
+static inline Complex operator*(float s, Complex a) { return { s * a.x, s * a.y }; }
+static inline bool operator!=(Complex a, Complex b) { return a.x != b.x || a.y != b.y; }
+
+static inline bool IsInvalid(float v) { return !std::isfinite(v); }
+static inline float Sanitize(float v) { return IsInvalid(v) ? 0.0f : v; }
+static inline float Length(float x, float y) { return std::sqrt(x * x + y * y); }
+static inline float Clamp(float v, float lo, float hi) { return std::min(std::max(v, lo), hi); }
+static inline float GlslMod(float a, float b) { return a - b * std::floor(a / b); }
+static inline float Fract(float v) { return v - std::floor(v); }
+static inline float SignFunc(float v) { return (v > 0.0f) ? 1.0f : ((v < 0.0f) ? -1.0f : 0.0f); }
+static inline float StepFunc(float v) { return (v >= 0.0f) ? 1.0f : 0.0f; }
+static inline float SafePow(float base, float exponent) { return std::pow(std::max(0.0f, base), exponent); }
+static inline float SafeLog(float v) { return std::log(std::max(SAFE_MIN_VALUE, v)); }
+static inline float SafeExp(float v) { return std::exp(Clamp(v, -SAFE_MAX_EXP, SAFE_MAX_EXP)); }
+static inline float RealDivide(float a, float b) { return (b * b < EPSILON) ? 0.0f : a / b; }
+
+static inline float ApplyRealBinary(int token, float a, float b)
+{
+    return (token == GPUTokens::TOKEN_MUL_R) ? a * b : RealDivide(a, b);
+}
+
+static inline float ApplyRealUnary(int token, float a)
+{
+    if (token == GPUTokens::TOKEN_SIN_R) return std::sin(a);
+    if (token == GPUTokens::TOKEN_COS_R) return std::cos(a);
+    if (token == GPUTokens::TOKEN_TAN_R) return RealDivide(std::sin(a), std::cos(a));
+    return SafeExp(a);
+}
+
+// Fused intrinsics on the operands v[0..FusedOperandCount) - MUST MATCH applyFused() in math.comp
+static inline int FusedOperandCount(int token)
+{
+    return (token == GPUTokens::TOKEN_DOT2) ? 4 : (token == GPUTokens::TOKEN_RSQRT) ? 1 : 2;
+}
+
+static inline bool IsFused(int token) { return token >= GPUTokens::TOKEN_LEN2 && token <= GPUTokens::TOKEN_RSQRT; }
+
+static inline float ApplyFused(int token, const float* v)
+{
+    float s = v[0] * v[0] + v[1] * v[1];
+    if (token == GPUTokens::TOKEN_LEN2) return s;
+    if (token == GPUTokens::TOKEN_DOT2) return v[0] * v[2] + v[1] * v[3];
+    if (token == GPUTokens::TOKEN_HYPOT) return std::sqrt(s);
+    if (token == GPUTokens::TOKEN_INVCUBE) return RealDivide(1.0f, s * std::sqrt(s));
+    return RealDivide(1.0f, std::sqrt(std::max(v[0], 0.0f)));
+}
+
+static inline Complex CMul(Complex a, Complex b) { return { a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x }; }
+
+static inline Complex CDiv(Complex a, Complex b)
+{
+    float denom = b.x * b.x + b.y * b.y;
+    if (std::fabs(denom) < EPSILON) return { 0.0f, 0.0f };
+    return { (a.x * b.x + a.y * b.y) / denom, (a.y * b.x - a.x * b.y) / denom };
+}
+
+static inline Complex CLog(Complex z) { return { SafeLog(Length(z.x, z.y)), std::atan2(z.y, z.x) }; }
+
+static inline Complex CExp(Complex z)
+{
+    float ea = SafeExp(z.x);
+    return { ea * std::cos(z.y), ea * std::sin(z.y) };
+}
+
+static inline Complex CPow(Complex base, Complex exponent)
+{
+    if (Length(base.x, base.y) < EPSILON) return { 0.0f, 0.0f };
+    return CExp(CMul(exponent, CLog(base)));
+}
+
+static inline Complex CSin(Complex z) { return { std::sin(z.x) * std::cosh(z.y), std::cos(z.x) * std::sinh(z.y) }; }
+static inline Complex CCos(Complex z) { return { std::cos(z.x) * std::cosh(z.y), -std::sin(z.x) * std::sinh(z.y) }; }
+
+static inline void ClampSpeed(float& vx, float& vy)
+{
+    float speed = Length(vx, vy);
+    if (speed > MAX_SPEED)
+    {
+        vx = vx / speed * MAX_SPEED;
+        vy = vy / speed * MAX_SPEED;
+    }
+}
+
+// Buffer reads past the end return 0, like robust buffer access on the GPU
+static inline int TokenAt(const std::vector<int>& tokens, int index)
+{
+    return (index >= 0 && index < static_cast<int>(tokens.size())) ? tokens[index] : 0;
+}
+
+static inline float ConstantAt(const std::vector<float>& constants, int index)
+{
+    return (index >= 0 && index < static_cast<int>(constants.size())) ? constants[index] : 0.0f;
+}
+
+// ============================================================================
+// EVALUATION STATE
+// ============================================================================
+
+// What one integration pass reads besides the evaluated object itself
+struct PassContext
+{
+    const EquationSet* equations;
+    const ObjectArrays* input;              // State at the start of the pass, read by p[i] and sum_j()
+    const std::vector<float>* objectParams;
+    const std::vector<int>* handleSlots;
+    const std::vector<float>* pairSums;
+    const SimParams* params;
+    int numObjects;
+};
+
+// The arguments evaluateRPNComponent() receives
+struct ObjectFrame
+{
+    float x, y, vx, vy, axPrev, ayPrev, rotation, angularVel;
+    float color[4];
+    float mass, charge;
+    int index;
+};
+
+// equationTemps of math.comp: one object's common subexpressions across its components
+struct EquationTemps
+{
+    Complex value[MAX_EQUATION_TEMPS];
+    bool complex[MAX_EQUATION_TEMPS];
+};
+
+static float ParamValue(const PassContext& ctx, int index, int varHash)
+{
+    if (varHash < VAR_HASH_PARAM_0 || varHash > VAR_HASH_PARAM_7) return 0.0f;
+    if (index < 0 || index >= ctx.numObjects) return 0.0f;
+    size_t offset = static_cast<size_t>(index) * OBJECT_PARAM_COUNT + (varHash - VAR_HASH_PARAM_0);
+    return (offset < ctx.objectParams->size()) ? (*ctx.objectParams)[offset] : 0.0f;
+}
+
+// equationVariable(); Barnes-Hut, SPH fluid, rand()/randn(), s0..s7 and agg[] values are GPU-only and read 0
+static float EquationVariable(const PassContext& ctx, const ObjectFrame& o, int varHash, float stepTime)
+{
+    const SimParams& params = *ctx.params;
+    switch (varHash)
+    {
+    case VAR_HASH_X: return o.x;
+    case VAR_HASH_Y: return o.y;
+    case VAR_HASH_VX: return o.vx;
+    case VAR_HASH_VY: return o.vy;
+    case VAR_HASH_AX: return o.axPrev;
+    case VAR_HASH_AY: return o.ayPrev;
+    case VAR_HASH_T: return stepTime;
+    case VAR_HASH_THETA: return o.rotation;
+    case VAR_HASH_OMEGA: return o.angularVel;
+    case VAR_HASH_R: return o.color[0];
+    case VAR_HASH_G: return o.color[1];
+    case VAR_HASH_B: return o.color[2];
+    case VAR_HASH_A: return o.color[3];
+    case VAR_HASH_PI: return SHADER_PI;
+    case VAR_HASH_E: return SHADER_E;
+    case VAR_HASH_K: return params.stiffness;
+    case VAR_HASH_B_DAMP: return params.damping;
+    case VAR_HASH_G_GRAV: return params.gravity;
+    case VAR_HASH_MASS: return o.mass;
+    case VAR_HASH_CHARGE: return o.charge;
+    case VAR_HASH_COUPLING: return params.coupling;
+    case VAR_HASH_FREQ: return params.driveFreq;
+    case VAR_HASH_AMP: return params.driveAmp;
+    case VAR_HASH_GRAV_AX:
+    case VAR_HASH_GRAV_AY:
+    case VAR_HASH_COUL_AX:
+    case VAR_HASH_COUL_AY:
+    case VAR_HASH_SPH_AX:
+    case VAR_HASH_SPH_AY:
+    case VAR_HASH_SPH_RHO:
+    case VAR_HASH_SPH_P: return 0.0f;
+    default: return ParamValue(ctx, o.index, varHash);
+    }
+}
+
+// getObjectProperty(): switches on variable hashes, whatever the serializer wrote
+static float ObjectProperty(const PassContext& ctx, int target, int propHash, int current)
+{
+    // p[i] names the object with handle i, as resolveHandle() in math.comp
+    const std::vector<int>& slots = *ctx.handleSlots;
+    if (!slots.empty())
+    {
+        int slot = target & OBJECT_HANDLE_SLOT_MASK;
+        if (target < 0 || 2 * static_cast<size_t>(slot) >= slots.size() || slots[2 * slot + 1] != target) return 0.0f;
+        target = slots[2 * slot];
+    }
+    if (target < 0 || target >= ctx.numObjects || target == current) return 0.0f;
+    const ObjectArrays& s = *ctx.input;
+    switch (propHash)
+    {
+    case VAR_HASH_X: return s.x[target];
+    case VAR_HASH_Y: return s.y[target];
+    case VAR_HASH_VX: return s.vx[target];
+    case VAR_HASH_VY: return s.vy[target];
+    case VAR_HASH_AX: return s.ax[target];
+    case VAR_HASH_AY: return s.ay[target];
+    case VAR_HASH_MASS: return s.mass[target];
+    case VAR_HASH_CHARGE: return s.charge[target];
+    case VAR_HASH_THETA: return s.rotation[target];
+    case VAR_HASH_OMEGA: return s.angularVelocity[target];
+    case VAR_HASH_R: return s.r[target];
+    case VAR_HASH_G: return s.g[target];
+    case VAR_HASH_B: return s.b[target];
+    case VAR_HASH_A: return s.a[target];
+    case VAR_HASH_VIS_X: return s.width[target];
+    case VAR_HASH_VIS_Y: return s.height[target];
+    }
+    return 0.0f;
+}
+
+static float PairSumValue(const PassContext& ctx, int index, int slot)
+{
+    if (slot < 0 || slot >= MAX_PAIR_SUMS_PER_EQUATION || index < 0 || index >= ctx.numObjects) return 0.0f;
+    size_t offset = static_cast<size_t>(index) * MAX_PAIR_SUMS_PER_EQUATION + slot;
+    return (offset < ctx.pairSums->size()) ? (*ctx.pairSums)[offset] : 0.0f;
+}
+
+// ============================================================================
+// DERIVATIVES (evaluateDerivativeExpression / evaluateDualDerivative)
+// ============================================================================
+
+// The inline evaluator of numerical derivatives, with its subset of operators. Like the shader
+// it counts operators rather than words against exprCount.
+static Complex EvaluateDerivativeExpression(const PassContext& ctx, const ObjectFrame& o, float stepTime,
+                                            int exprOffset, int exprCount, int constantOffset)
+{
+    if (exprCount <= 0 || exprCount > MAX_DERIV_EXPR_SIZE) return { 0.0f, 0.0f };
+
+    const std::vector<int>& tokens = ctx.equations->tokens;
+    const std::vector<float>& constants = ctx.equations->constants;
+    float stack[128];
+    bool isComplex[128];
+    int sp = 0;
+    int csp = 0;
+    int idx = exprOffset;
+
+    for (int di = 0; di < exprCount; ++di)
+    {
+        if (idx >= static_cast<int>(tokens.size())) break;
+        if (sp >= 126) return { 0.0f, 0.0f };
+
+        int token = tokens[idx++];
+        if (token == GPUTokens::TOKEN_NUMBER)
+        {
+            stack[sp++] = Sanitize(ConstantAt(constants, constantOffset + TokenAt(tokens, idx++)));
+            isComplex[csp++] = false;
+        }
+        else if (token == GPUTokens::TOKEN_VARIABLE)
+        {
+            int varHash = TokenAt(tokens, idx++);
+            if (varHash == VAR_HASH_I)
+            {
+                stack[sp++] = 0.0f;
+                stack[sp++] = 1.0f;
+                isComplex[csp++] = true;
+                continue;
+            }
+            stack[sp++] = EquationVariable(ctx, o, varHash, stepTime);
+            isComplex[csp++] = false;
+        }
+        else if (token == GPUTokens::TOKEN_OBJECT_REF)
+        {
+            int objIndex = TokenAt(tokens, idx++);
+            int propHash = TokenAt(tokens, idx++);
+            stack[sp++] = Sanitize(ObjectProperty(ctx, objIndex, propHash, o.index));
+            isComplex[csp++] = false;
+        }
+        else if (token == GPUTokens::TOKEN_MUL_R || token == GPUTokens::TOKEN_DIV_R)
+        {
+            if (csp < 2) { stack[0] = 0.0f; sp = 1; csp = 1; continue; }
+            csp--;
+            float b = stack[--sp];
+            stack[sp - 1] = ApplyRealBinary(token, stack[sp - 1], b);
+        }
+        else if (token == GPUTokens::TOKEN_SIN_R || token == GPUTokens::TOKEN_COS_R || token == GPUTokens::TOKEN_EXP_R)
+        {
+            if (csp < 1) { stack[0] = 0.0f; sp = 1; csp = 1; continue; }
+            stack[sp - 1] = ApplyRealUnary(token, stack[sp - 1]);
+        }
+        else if (token == GPUTokens::TOKEN_ADD || token == GPUTokens::TOKEN_SUB || token == GPUTokens::TOKEN_MUL || token == GPUTokens::TOKEN_DIV || token == GPUTokens::TOKEN_POW)
+        {
+            if (csp < 2) { stack[0] = 0.0f; sp = 1; csp = 1; continue; }
+            bool bc = isComplex[--csp];
+            bool ac = isComplex[csp - 1];
+            Complex b = bc ? Complex{ stack[sp - 2], stack[sp - 1] } : Complex{ stack[sp - 1], 0.0f };
+            sp -= bc ? 2 : 1;
+            Complex a = ac ? Complex{ stack[sp - 2], stack[sp - 1] } : Complex{ stack[sp - 1], 0.0f };
+            sp -= ac ? 2 : 1;
+
+            Complex res = { 0.0f, 0.0f };
+            bool rc = ac || bc;
+            if (token == GPUTokens::TOKEN_ADD) res = a + b;
+            else if (token == GPUTokens::TOKEN_SUB) res = a - b;
+            else if (token == GPUTokens::TOKEN_MUL) { res = CMul(a, b); rc = true; }
+            else if (token == GPUTokens::TOKEN_DIV) { res = CDiv(a, b); rc = true; }
+            else if (ac || bc || a.x < 0.0f) { res = CPow(a, b); rc = true; }
+            else { res = { SafePow(a.x, b.x), 0.0f }; rc = false; }
+
+            stack[sp++] = res.x;
+            if (rc) stack[sp++] = res.y;
+            isComplex[csp - 1] = rc;
+        }
+        else if (token == GPUTokens::TOKEN_SIN || token == GPUTokens::TOKEN_COS || token == GPUTokens::TOKEN_EXP || token == GPUTokens::TOKEN_NEG)
+        {
+            if (csp < 1) { stack[0] = 0.0f; sp = 1; csp = 1; continue; }
+            bool ac = isComplex[csp - 1];
+            Complex a = ac ? Complex{ stack[sp - 2], stack[sp - 1] } : Complex{ stack[sp - 1], 0.0f };
+            sp -= ac ? 2 : 1;
+
+            Complex res = -a;
+            bool rc = ac;
+            if (token == GPUTokens::TOKEN_SIN) { res = CSin(a); rc = true; }
+            else if (token == GPUTokens::TOKEN_COS) { res = CCos(a); rc = true; }
+            else if (token == GPUTokens::TOKEN_EXP) { res = CExp(a); rc = true; }
+
+            stack[sp++] = res.x;
+            if (rc) stack[sp++] = res.y;
+            isComplex[csp - 1] = rc;
+        }
+        else if (token == GPUTokens::TOKEN_DERIVATIVE)
+        {
+            // Nested derivatives read 0
+            if (idx + 3 < static_cast<int>(tokens.size()))
+            {
+                idx += 3;
+                int nestedCount = tokens[idx++];
+                idx += nestedCount;
+                di += nestedCount + 3;
+            }
+            stack[sp++] = 0.0f;
+            isComplex[csp++] = false;
+        }
+    }
+
+    if (sp <= 0) return { 0.0f, 0.0f };
+    if (isComplex[0]) return { stack[0], stack[1] };
+    return { stack[0], 0.0f };
+}
+
+// Value (v) and derivative (d) of a dual number, both complex
+struct Dual
+{
+    Complex v, d;
+};
+
+static Complex EvaluateDualDerivative(const PassContext& ctx, const ObjectFrame& o, float stepTime, int wrtVarHash,
+                                      int exprOffset, int exprCount, int constantOffset)
+{
+    if (exprCount <= 0 || exprCount > MAX_DERIV_EXPR_SIZE) return { 0.0f, 0.0f };
+
+    const std::vector<int>& tokens = ctx.equations->tokens;
+    const std::vector<float>& constants = ctx.equations->constants;
+    const Complex zero = { 0.0f, 0.0f };
+    Dual dual[MAX_DUAL_STACK_SIZE];
+    int sp = 0;
+    int idx = exprOffset;
+
+    for (int di = 0; di < exprCount; ++di)
+    {
+        if (idx >= exprOffset + exprCount || idx >= static_cast<int>(tokens.size())) break;
+        int token = tokens[idx++];
+
+        if (token == GPUTokens::TOKEN_NUMBER || token == GPUTokens::TOKEN_VARIABLE || token == GPUTokens::TOKEN_OBJECT_REF)
+        {
+            if (sp >= MAX_DUAL_STACK_SIZE) return zero;
+            Dual leaf = { zero, zero };
+            if (token == GPUTokens::TOKEN_NUMBER)
+            {
+                leaf.v.x = Sanitize(ConstantAt(constants, constantOffset + TokenAt(tokens, idx++)));
+            }
+            else if (token == GPUTokens::TOKEN_OBJECT_REF)
+            {
+                int objIndex = TokenAt(tokens, idx++);
+                int propHash = TokenAt(tokens, idx++);
+                leaf.v.x = Sanitize(ObjectProperty(ctx, objIndex, propHash, o.index));
+            }
+            else
+            {
+                int varHash = TokenAt(tokens, idx++);
+                if (varHash == VAR_HASH_I) leaf.v.y = 1.0f;
+                else leaf.v.x = EquationVariable(ctx, o, varHash, stepTime);
+                if (varHash == wrtVarHash) leaf.d.x = 1.0f;  // Seed
+            }
+            dual[sp++] = leaf;
+        }
+        else if (token == GPUTokens::TOKEN_ADD || token == GPUTokens::TOKEN_SUB || token == GPUTokens::TOKEN_MUL || token == GPUTokens::TOKEN_MUL_R ||
+                 token == GPUTokens::TOKEN_DIV || token == GPUTokens::TOKEN_DIV_R || token == GPUTokens::TOKEN_POW)
+        {
+            if (sp < 2) return zero;
+            Dual bd = dual[--sp];
+            Dual ad = dual[sp - 1];
+            Complex a = ad.v, da = ad.d, b = bd.v, db = bd.d;
+            Dual res;
+
+            if (token == GPUTokens::TOKEN_ADD) res = { a + b, da + db };
+            else if (token == GPUTokens::TOKEN_SUB) res = { a - b, da - db };
+            else if (token == GPUTokens::TOKEN_MUL || token == GPUTokens::TOKEN_MUL_R) res = { CMul(a, b), CMul(da, b) + CMul(a, db) };
+            else if (token == GPUTokens::TOKEN_DIV || token == GPUTokens::TOKEN_DIV_R)
+            {
+                Complex q = CDiv(a, b);
+                res = { q, CDiv(da - CMul(q, db), b) };
+            }
+            else
+            {
+                bool complexPow = (a.y != 0.0f || b.y != 0.0f || a.x < 0.0f);
+                Complex bm1 = b - Complex{ 1.0f, 0.0f };
+                Complex p = complexPow ? CPow(a, b) : Complex{ SafePow(a.x, b.x), 0.0f };
+                Complex pm1 = complexPow ? CPow(a, bm1) : Complex{ SafePow(a.x, bm1.x), 0.0f };
+                Complex d = CMul(CMul(b, pm1), da);
+                if (db != zero) d = d + CMul(CMul(p, CLog(a)), db);
+                res = { p, d };
+            }
+            dual[sp - 1] = res;
+        }
+        else if (token == GPUTokens::TOKEN_NEG || token == GPUTokens::TOKEN_SIN || token == GPUTokens::TOKEN_SIN_R ||
+                 token == GPUTokens::TOKEN_COS || token == GPUTokens::TOKEN_COS_R || token == GPUTokens::TOKEN_TAN || token == GPUTokens::TOKEN_TAN_R ||
+                 token == GPUTokens::TOKEN_EXP || token == GPUTokens::TOKEN_EXP_R || token == GPUTokens::TOKEN_LOG ||
+                 token == GPUTokens::TOKEN_SQRT || token == GPUTokens::TOKEN_ABS)
+        {
+            if (sp < 1) return zero;
+            Complex a = dual[sp - 1].v, da = dual[sp - 1].d;
+            Dual res;
+
+            if (token == GPUTokens::TOKEN_NEG) res = { -a, -da };
+            else if (token == GPUTokens::TOKEN_SIN || token == GPUTokens::TOKEN_SIN_R) res = { CSin(a), CMul(CCos(a), da) };
+            else if (token == GPUTokens::TOKEN_COS || token == GPUTokens::TOKEN_COS_R) res = { CCos(a), -CMul(CSin(a), da) };
+            else if (token == GPUTokens::TOKEN_TAN || token == GPUTokens::TOKEN_TAN_R)
+            {
+                Complex t = CDiv(CSin(a), CCos(a));
+                res = { t, CMul(Complex{ 1.0f, 0.0f } + CMul(t, t), da) };
+            }
+            else if (token == GPUTokens::TOKEN_EXP || token == GPUTokens::TOKEN_EXP_R)
+            {
+                Complex e = CExp(a);
+                res = { e, CMul(e, da) };
+            }
+            else if (token == GPUTokens::TOKEN_LOG) res = { CLog(a), CDiv(da, a) };
+            else if (token == GPUTokens::TOKEN_SQRT)
+            {
+                Complex r = (a.y != 0.0f || a.x < 0.0f) ? CPow(a, Complex{ 0.5f, 0.0f }) : Complex{ std::sqrt(a.x), 0.0f };
+                res = { r, CDiv(0.5f * da, r) };
+            }
+            else
+            {
+                float m = Length(a.x, a.y);
+                res = { { m, 0.0f }, { RealDivide(a.x * da.x + a.y * da.y, m), 0.0f } };
+            }
+            dual[sp - 1] = res;
+        }
+        else
+        {
+            return zero;
+        }
+    }
+
+    if (sp <= 0) return zero;
+    return { Sanitize(dual[0].d.x), Sanitize(dual[0].d.y) };
+}
+
+// The GPUTokens::TOKEN_DERIVATIVE branch of evaluateRPNComponent()
+static Complex DerivativeValue(const PassContext& ctx, const ObjectFrame& o, float stepTime, int wrtVarHash, int order,
+                               int method, int exprOffset, int exprCount, int constantOffset)
+{
+    if (method == DerivativeMethods::DERIV_METHOD_DUAL && order == 1)
+        return EvaluateDualDerivative(ctx, o, stepTime, wrtVarHash, exprOffset, exprCount, constantOffset);
+    if (order != 1 || exprCount <= 0 || exprCount > MAX_DERIV_EXPR_SIZE) return { 0.0f, 0.0f };
+
+    auto perturb = [wrtVarHash](ObjectFrame& f, const ObjectFrame& orig, float delta)
+    {
+        if (wrtVarHash == VAR_HASH_X) f.x = orig.x + delta;
+        else if (wrtVarHash == VAR_HASH_Y) f.y = orig.y + delta;
+        else if (wrtVarHash == VAR_HASH_VX) f.vx = orig.vx + delta;
+        else if (wrtVarHash == VAR_HASH_VY) f.vy = orig.vy + delta;
+        else if (wrtVarHash == VAR_HASH_AX) f.axPrev = orig.axPrev + delta;
+        else if (wrtVarHash == VAR_HASH_AY) f.ayPrev = orig.ayPrev + delta;
+        else if (wrtVarHash == VAR_HASH_THETA) f.rotation = orig.rotation + delta;
+        else if (wrtVarHash == VAR_HASH_OMEGA) f.angularVel = orig.angularVel + delta;
+        else if (wrtVarHash == VAR_HASH_R) f.color[0] = orig.color[0] + delta;
+        else if (wrtVarHash == VAR_HASH_G) f.color[1] = orig.color[1] + delta;
+        else if (wrtVarHash == VAR_HASH_B) f.color[2] = orig.color[2] + delta;
+        else if (wrtVarHash == VAR_HASH_A) f.color[3] = orig.color[3] + delta;
+    };
+
+    const float h = DERIVATIVE_H;
+    ObjectFrame f = o;
+    perturb(f, o, h);
+    Complex plus = EvaluateDerivativeExpression(ctx, f, stepTime, exprOffset, exprCount, constantOffset);
+    perturb(f, o, -h);
+    Complex minus = EvaluateDerivativeExpression(ctx, f, stepTime, exprOffset, exprCount, constantOffset);
+    return { (plus.x - minus.x) / (2.0f * h), (plus.y - minus.y) / (2.0f * h) };
+}
+
+// ============================================================================
+// SCALAR INTERPRETER (evaluateRPNComponent, one object)
+// ============================================================================
+static float EvaluateComponentScalar(const PassContext& ctx, const ObjectFrame& o, EquationTemps& temps, float stepTime,
+                                     int componentType, int tokenOffset, int tokenCount, int constantOffset)
+{
+    const std::vector<int>& tokens = ctx.equations->tokens;
+    const std::vector<float>& constants = ctx.equations->constants;
+    const bool isColor = componentType >= 3 && componentType <= 6;
+    if (tokenCount <= 0 || tokenOffset < 0 || tokenOffset + tokenCount > static_cast<int>(tokens.size()))
+        return isColor ? 1.0f : 0.0f;
+
+    float stack[128];
+    bool isComplex[128];
+    int sp = 0;
+    int csp = 0;
+    int idx = tokenOffset;
+    const int end = tokenOffset + tokenCount;
+
+    auto popValue = [&](bool c)
+    {
+        Complex v = c ? Complex{ stack[sp - 2], stack[sp - 1] } : Complex{ stack[sp - 1], 0.0f };
+        sp -= c ? 2 : 1;
+        return v;
+    };
+    auto pushResult = [&](Complex v, bool c)
+    {
+        stack[sp++] = v.x;
+        if (c) stack[sp++] = v.y;
+        isComplex[csp - 1] = c;
+    };
+
+    while (idx < end)
+    {
+        if (sp >= 126) return 0.0f;
+        int token = tokens[idx++];
+
+        switch (token)
+        {
+        case GPUTokens::TOKEN_NUMBER:
+            stack[sp++] = Sanitize(ConstantAt(constants, constantOffset + TokenAt(tokens, idx++)));
+            isComplex[csp++] = false;
+            break;
+
+        case GPUTokens::TOKEN_VARIABLE:
+        {
+            int varHash = TokenAt(tokens, idx++);
+            if (varHash == VAR_HASH_I)
+            {
+                stack[sp++] = 0.0f;
+                stack[sp++] = 1.0f;
+                isComplex[csp++] = true;
+                break;
+            }
+            stack[sp++] = EquationVariable(ctx, o, varHash, stepTime);
+            isComplex[csp++] = false;
+            break;
+        }
+
+        case GPUTokens::TOKEN_OBJECT_REF:
+        {
+            int objIndex = TokenAt(tokens, idx++);
+            int propHash = TokenAt(tokens, idx++);
+            stack[sp++] = Sanitize(ObjectProperty(ctx, objIndex, propHash, o.index));
+            isComplex[csp++] = false;
+            break;
+        }
+
+        case GPUTokens::TOKEN_PAIR_SUM:
+            stack[sp++] = PairSumValue(ctx, o.index, TokenAt(tokens, idx));
+            isComplex[csp++] = false;
+            idx += 4 + TokenAt(tokens, idx + 3);
+            break;
+
+        case GPUTokens::TOKEN_TEMP_STORE:
+        {
+            int slot = TokenAt(tokens, idx++);
+            if (csp < 1 || slot < 0 || slot >= MAX_EQUATION_TEMPS) break;
+            bool c = isComplex[csp - 1];
+            temps.value[slot] = c ? Complex{ stack[sp - 2], stack[sp - 1] } : Complex{ stack[sp - 1], 0.0f };
+            temps.complex[slot] = c;
+            break;
+        }
+
+        case GPUTokens::TOKEN_TEMP_LOAD:
+        {
+            int slot = TokenAt(tokens, idx++);
+            Complex v = { 0.0f, 0.0f };
+            bool c = false;
+            if (slot >= 0 && slot < MAX_EQUATION_TEMPS)
+            {
+                v = temps.value[slot];
+                c = temps.complex[slot];
+            }
+            stack[sp++] = v.x;
+            if (c) stack[sp++] = v.y;
+            isComplex[csp++] = c;
+            break;
+        }
+
+        case GPUTokens::TOKEN_BRANCH:
+        {
+            int skip = TokenAt(tokens, idx++);
+            if (csp < 1) break;
+            float condition = popValue(isComplex[--csp]).x;
+            if (!(condition > 0.0f)) idx += skip;
+            break;
+        }
+
+        case GPUTokens::TOKEN_JUMP:
+            idx += TokenAt(tokens, idx) + 1;
+            break;
+
+        case GPUTokens::TOKEN_PRELUDE:
+            idx += 2;  // No prelude pass on the CPU: hoisted bodies run in place
+            break;
+
+        case GPUTokens::TOKEN_MUL_R:
+        case GPUTokens::TOKEN_DIV_R:
+        {
+            if (csp < 2) { stack[0] = 0.0f; sp = 1; csp = 1; break; }
+            csp--;
+            float b = stack[--sp];
+            stack[sp - 1] = ApplyRealBinary(token, stack[sp - 1], b);
+            break;
+        }
+
+        case GPUTokens::TOKEN_SIN_R:
+        case GPUTokens::TOKEN_COS_R:
+        case GPUTokens::TOKEN_TAN_R:
+        case GPUTokens::TOKEN_EXP_R:
+            if (csp < 1) { stack[0] = 0.0f; sp = 1; csp = 1; break; }
+            stack[sp - 1] = ApplyRealUnary(token, stack[sp - 1]);
+            break;
+
+        case GPUTokens::TOKEN_LEN2:
+        case GPUTokens::TOKEN_DOT2:
+        case GPUTokens::TOKEN_HYPOT:
+        case GPUTokens::TOKEN_INVCUBE:
+        case GPUTokens::TOKEN_RSQRT:
+        {
+            int count = FusedOperandCount(token);
+            if (csp < count) { stack[0] = 0.0f; sp = 1; csp = 1; break; }
+            float v[4] = {};
+            for (int k = count - 1; k >= 0; k--) v[k] = popValue(isComplex[--csp]).x;
+            stack[sp++] = ApplyFused(token, v);
+            isComplex[csp++] = false;
+            break;
+        }
+
+        case GPUTokens::TOKEN_DERIVATIVE:
+        {
+            int wrtVarHash = TokenAt(tokens, idx++);
+            int order = TokenAt(tokens, idx++);
+            int method = TokenAt(tokens, idx++);
+            int exprCount = TokenAt(tokens, idx++);
+            Complex d = DerivativeValue(ctx, o, stepTime, wrtVarHash, order, method, idx, exprCount, constantOffset);
+            stack[sp++] = d.x;
+            stack[sp++] = d.y;
+            isComplex[csp++] = true;
+            idx += exprCount;
+            break;
+        }
+
+        case GPUTokens::TOKEN_ADD:
+        case GPUTokens::TOKEN_SUB:
+        case GPUTokens::TOKEN_MUL:
+        case GPUTokens::TOKEN_DIV:
+        case GPUTokens::TOKEN_POW:
+        {
+            if (csp < 2) { stack[0] = 0.0f; sp = 1; csp = 1; break; }
+            bool bc = isComplex[--csp];
+            bool ac = isComplex[csp - 1];
+            Complex b = popValue(bc);
+            Complex a = popValue(ac);
+
+            Complex res = { 0.0f, 0.0f };
+            bool rc = ac || bc;
+            if (token == GPUTokens::TOKEN_ADD) res = a + b;
+            else if (token == GPUTokens::TOKEN_SUB) res = a - b;
+            else if (token == GPUTokens::TOKEN_MUL) { res = CMul(a, b); rc = true; }
+            else if (token == GPUTokens::TOKEN_DIV) { res = CDiv(a, b); rc = true; }
+            else if (ac || bc || a.x < 0.0f) { res = CPow(a, b); rc = true; }
+            else { res = { SafePow(a.x, b.x), 0.0f }; rc = false; }
+            pushResult(res, rc);
+            break;
+        }
+
+        case GPUTokens::TOKEN_NEG:
+        case GPUTokens::TOKEN_SIN:
+        case GPUTokens::TOKEN_COS:
+        case GPUTokens::TOKEN_TAN:
+        case GPUTokens::TOKEN_EXP:
+        case GPUTokens::TOKEN_LOG:
+        case GPUTokens::TOKEN_SQRT:
+        case GPUTokens::TOKEN_ABS:
+        {
+            if (csp < 1) { stack[0] = 0.0f; sp = 1; csp = 1; break; }
+            bool ac = isComplex[csp - 1];
+            Complex a = popValue(ac);
+
+            Complex res = { 0.0f, 0.0f };
+            bool rc = ac;
+            if (token == GPUTokens::TOKEN_NEG) res = -a;
+            else if (token == GPUTokens::TOKEN_SIN) { res = CSin(a); rc = true; }
+            else if (token == GPUTokens::TOKEN_COS) { res = CCos(a); rc = true; }
+            else if (token == GPUTokens::TOKEN_EXP) { res = CExp(a); rc = true; }
+            else if (token == GPUTokens::TOKEN_LOG) { res = CLog(a); rc = true; }
+            else if (token == GPUTokens::TOKEN_SQRT)
+            {
+                if (!ac && a.x >= 0.0f) res = { std::sqrt(a.x), 0.0f };
+                else { res = CPow(a, Complex{ 0.5f, 0.0f }); rc = true; }
+            }
+            else if (token == GPUTokens::TOKEN_TAN) { res = CDiv(CSin(a), CCos(a)); rc = true; }
+            else { res = { Length(a.x, a.y), 0.0f }; rc = false; }
+            pushResult(res, rc);
+            break;
+        }
+
+        case GPUTokens::TOKEN_FLOOR:
+        case GPUTokens::TOKEN_CEIL:
+        case GPUTokens::TOKEN_FRAC:
+        case GPUTokens::TOKEN_SIGN:
+        case GPUTokens::TOKEN_STEP:
+        {
+            if (csp < 1 || isComplex[csp - 1]) break;
+            float& v = stack[sp - 1];
+            if (token == GPUTokens::TOKEN_FLOOR) v = std::floor(v);
+            else if (token == GPUTokens::TOKEN_CEIL) v = std::ceil(v);
+            else if (token == GPUTokens::TOKEN_FRAC) v = Fract(v);
+            else if (token == GPUTokens::TOKEN_SIGN) v = SignFunc(v);
+            else v = StepFunc(v);
+            break;
+        }
+
+        case GPUTokens::TOKEN_MOD:
+        case GPUTokens::TOKEN_MIN:
+        case GPUTokens::TOKEN_MAX:
+        case GPUTokens::TOKEN_ATAN2:
+        {
+            // Raw floats: a complex operand misaligns the stack exactly as on the GPU
+            if (csp < 2) break;
+            csp--;
+            float b = stack[--sp];
+            float a = stack[--sp];
+            float res;
+            if (token == GPUTokens::TOKEN_MOD) res = (std::fabs(b) < EPSILON) ? 0.0f : GlslMod(a, b);
+            else if (token == GPUTokens::TOKEN_MIN) res = std::min(a, b);
+            else if (token == GPUTokens::TOKEN_MAX) res = std::max(a, b);
+            else res = std::atan2(a, b);
+            stack[sp++] = res;
+            isComplex[csp - 1] = false;
+            break;
+        }
+
+        case GPUTokens::TOKEN_CLAMP:
+        {
+            if (csp < 3) break;
+            csp -= 2;
+            float hi = stack[--sp];
+            float lo = stack[--sp];
+            float v = stack[--sp];
+            stack[sp++] = Clamp(v, lo, hi);
+            isComplex[csp - 1] = false;
+            break;
+        }
+
+        case GPUTokens::TOKEN_TABLE:
+        {
+            if (csp < 2) break;
+            csp--;
+            float x = stack[--sp];
+            float id = stack[--sp];
+            stack[sp++] = LookupTables::SampleTable(id, x);
+            isComplex[csp - 1] = false;
+            break;
+        }
+
+        case GPUTokens::TOKEN_FIELD:
+        {
+            if (csp < 3) break;
+            csp -= 2;
+            float y = stack[--sp];
+            float x = stack[--sp];
+            float id = stack[--sp];
+            stack[sp++] = LookupTables::SampleField(id, x, y);
+            isComplex[csp - 1] = false;
+            break;
+        }
+
+        case GPUTokens::TOKEN_REAL:
+            if (csp < 1) break;
+            if (isComplex[csp - 1])
+            {
+                sp--;
+                isComplex[--csp] = false;
+            }
+            break;
+
+        case GPUTokens::TOKEN_IMAG:
+            if (csp < 1) break;
+            if (isComplex[csp - 1])
+            {
+                float imag = stack[sp - 1];
+                sp--;
+                stack[sp - 1] = imag;
+                isComplex[--csp] = false;
+            }
+            else
+            {
+                stack[sp - 1] = 0.0f;
+            }
+            break;
+
+        case GPUTokens::TOKEN_CONJ:
+            if (csp < 1) break;
+            if (isComplex[csp - 1]) stack[sp - 1] = -stack[sp - 1];
+            break;
+
+        case GPUTokens::TOKEN_ARG:
+            if (csp < 1) break;
+            if (isComplex[csp - 1])
+            {
+                float imag = stack[--sp];
+                stack[sp - 1] = std::atan2(imag, stack[sp - 1]);
+                isComplex[--csp] = false;
+            }
+            else
+            {
+                stack[sp - 1] = (stack[sp - 1] >= 0.0f) ? 0.0f : SHADER_PI;
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    float result = (sp > 0) ? stack[0] : 0.0f;
+    if (IsInvalid(result)) return isColor ? 1.0f : 0.0f;
+    if (isColor) result = Clamp(result, 0.0f, 1.0f);
+    return result;
+}
+
+// ============================================================================
+// BLOCK INTERPRETER (evaluateRPNComponent for CPU_LANES objects of one equation)
+// ============================================================================
+
+// Objects of one equation evaluated together; lane l is object index[l]
+struct ObjectBlock
+{
+    int count;
+    int index[CPU_LANES];
+    float x[CPU_LANES], y[CPU_LANES], vx[CPU_LANES], vy[CPU_LANES];
+    float axPrev[CPU_LANES], ayPrev[CPU_LANES];
+    float rotation[CPU_LANES], angularVel[CPU_LANES];
+    float color[4][CPU_LANES];
+    float mass[CPU_LANES], charge[CPU_LANES];
+    EquationTemps temps[CPU_LANES];
+};
+
+// One stack entry per lane; im is 0 for real entries
+struct BlockEntry
+{
+    float re[CPU_LANES];
+    float im[CPU_LANES];
+    bool complex[CPU_LANES];
+};
+
+static ObjectFrame LaneFrame(const ObjectBlock& block, int l)
+{
+    ObjectFrame o;
+    o.x = block.x[l];
+    o.y = block.y[l];
+    o.vx = block.vx[l];
+    o.vy = block.vy[l];
+    o.axPrev = block.axPrev[l];
+    o.ayPrev = block.ayPrev[l];
+    o.rotation = block.rotation[l];
+    o.angularVel = block.angularVel[l];
+    for (int c = 0; c < 4; c++) o.color[c] = block.color[c][l];
+    o.mass = block.mass[l];
+    o.charge = block.charge[l];
+    o.index = block.index[l];
+    return o;
+}
+
+// EquationVariable() for every lane
+static void BlockVariable(const PassContext& ctx, const ObjectBlock& block, int varHash, float stepTime, float* out)
+{
+    const SimParams& params = *ctx.params;
+    const int n = block.count;
+    const float* lane = nullptr;
+    float value = 0.0f;
+    switch (varHash)
+    {
+    case VAR_HASH_X: lane = block.x; break;
+    case VAR_HASH_Y: lane = block.y; break;
+    case VAR_HASH_VX: lane = block.vx; break;
+    case VAR_HASH_VY: lane = block.vy; break;
+    case VAR_HASH_AX: lane = block.axPrev; break;
+    case VAR_HASH_AY: lane = block.ayPrev; break;
+    case VAR_HASH_T: value = stepTime; break;
+    case VAR_HASH_THETA: lane = block.rotation; break;
+    case VAR_HASH_OMEGA: lane = block.angularVel; break;
+    case VAR_HASH_R: lane = block.color[0]; break;
+    case VAR_HASH_G: lane = block.color[1]; break;
+    case VAR_HASH_B: lane = block.color[2]; break;
+    case VAR_HASH_A: lane = block.color[3]; break;
+    case VAR_HASH_PI: value = SHADER_PI; break;
+    case VAR_HASH_E: value = SHADER_E; break;
+    case VAR_HASH_K: value = params.stiffness; break;
+    case VAR_HASH_B_DAMP: value = params.damping; break;
+    case VAR_HASH_G_GRAV: value = params.gravity; break;
+    case VAR_HASH_MASS: lane = block.mass; break;
+    case VAR_HASH_CHARGE: lane = block.charge; break;
+    case VAR_HASH_COUPLING: value = params.coupling; break;
+    case VAR_HASH_FREQ: value = params.driveFreq; break;
+    case VAR_HASH_AMP: value = params.driveAmp; break;
+    case VAR_HASH_GRAV_AX:
+    case VAR_HASH_GRAV_AY:
+    case VAR_HASH_COUL_AX:
+    case VAR_HASH_COUL_AY:
+    case VAR_HASH_SPH_AX:
+    case VAR_HASH_SPH_AY:
+    case VAR_HASH_SPH_RHO:
+    case VAR_HASH_SPH_P: value = 0.0f; break;
+    default:
+        for (int l = 0; l < n; l++) out[l] = ParamValue(ctx, block.index[l], varHash);
+        return;
+    }
+    if (lane) std::copy(lane, lane + n, out);
+    else std::fill(out, out + n, value);
+}
+
+// Walks the component once for the whole block, one lane loop per token. Lanes whose operands
+// would change the stack layout differently from the others (raw-float ops on complex values)
+// are marked and evaluated again on their own, as are lanes that take the other branch of an
+// if() than most, and the whole block on stack underflow or expressions deeper than BLOCK_STACK_DEPTH.
+static void EvaluateComponentBlock(const PassContext& ctx, ObjectBlock& block, float stepTime, int componentType,
+                                   int tokenOffset, int tokenCount, int constantOffset, float* out)
+{
+    const std::vector<int>& tokens = ctx.equations->tokens;
+    const std::vector<float>& constants = ctx.equations->constants;
+    const int n = block.count;
+    const bool isColor = componentType >= 3 && componentType <= 6;
+    if (tokenCount <= 0 || tokenOffset < 0 || tokenOffset + tokenCount > static_cast<int>(tokens.size()))
+    {
+        std::fill(out, out + n, isColor ? 1.0f : 0.0f);
+        return;
+    }
+
+    BlockEntry stack[BLOCK_STACK_DEPTH];
+    int depth = 0;
+    bool scalarLane[CPU_LANES] = {};
+    bool scalarBlock = false;
+    int idx = tokenOffset;
+    const int end = tokenOffset + tokenCount;
+
+    auto pushUniform = [&](float value)
+    {
+        BlockEntry& e = stack[depth++];
+        for (int l = 0; l < n; l++) { e.re[l] = value; e.im[l] = 0.0f; e.complex[l] = false; }
+    };
+
+    while (idx < end && !scalarBlock)
+    {
+        if (depth >= BLOCK_STACK_DEPTH) { scalarBlock = true; break; }
+        int token = tokens[idx++];
+
+        switch (token)
+        {
+        case GPUTokens::TOKEN_NUMBER:
+            pushUniform(Sanitize(ConstantAt(constants, constantOffset + TokenAt(tokens, idx++))));
+            break;
+
+        case GPUTokens::TOKEN_VARIABLE:
+        {
+            int varHash = TokenAt(tokens, idx++);
+            BlockEntry& e = stack[depth++];
+            if (varHash == VAR_HASH_I)
+            {
+                for (int l = 0; l < n; l++) { e.re[l] = 0.0f; e.im[l] = 1.0f; e.complex[l] = true; }
+                break;
+            }
+            BlockVariable(ctx, block, varHash, stepTime, e.re);
+            for (int l = 0; l < n; l++) { e.im[l] = 0.0f; e.complex[l] = false; }
+            break;
+        }
+
+        case GPUTokens::TOKEN_OBJECT_REF:
+        {
+            int objIndex = TokenAt(tokens, idx++);
+            int propHash = TokenAt(tokens, idx++);
+            BlockEntry& e = stack[depth++];
+            for (int l = 0; l < n; l++)
+            {
+                e.re[l] = Sanitize(ObjectProperty(ctx, objIndex, propHash, block.index[l]));
+                e.im[l] = 0.0f;
+                e.complex[l] = false;
+            }
+            break;
+        }
+
+        case GPUTokens::TOKEN_PAIR_SUM:
+        {
+            int slot = TokenAt(tokens, idx);
+            BlockEntry& e = stack[depth++];
+            for (int l = 0; l < n; l++)
+            {
+                e.re[l] = PairSumValue(ctx, block.index[l], slot);
+                e.im[l] = 0.0f;
+                e.complex[l] = false;
+            }
+            idx += 4 + TokenAt(tokens, idx + 3);
+            break;
+        }
+
+        case GPUTokens::TOKEN_TEMP_STORE:
+        {
+            int slot = TokenAt(tokens, idx++);
+            if (depth < 1 || slot < 0 || slot >= MAX_EQUATION_TEMPS) break;
+            const BlockEntry& e = stack[depth - 1];
+            for (int l = 0; l < n; l++)
+            {
+                block.temps[l].value[slot] = { e.re[l], e.im[l] };
+                block.temps[l].complex[slot] = e.complex[l];
+            }
+            break;
+        }
+
+        case GPUTokens::TOKEN_TEMP_LOAD:
+        {
+            int slot = TokenAt(tokens, idx++);
+            if (slot < 0 || slot >= MAX_EQUATION_TEMPS) { pushUniform(0.0f); break; }
+            BlockEntry& e = stack[depth++];
+            for (int l = 0; l < n; l++)
+            {
+                bool c = block.temps[l].complex[slot];
+                e.re[l] = block.temps[l].value[slot].x;
+                e.im[l] = c ? block.temps[l].value[slot].y : 0.0f;
+                e.complex[l] = c;
+            }
+            break;
+        }
+
+        case GPUTokens::TOKEN_BRANCH:
+        {
+            // The block takes the branch most lanes take; the others run on their own
+            int skip = TokenAt(tokens, idx++);
+            if (depth < 1) { scalarBlock = true; break; }
+            const BlockEntry& condition = stack[--depth];
+            int taken = 0;
+            for (int l = 0; l < n; l++) taken += condition.re[l] > 0.0f ? 1 : 0;
+            bool follow = 2 * taken >= n;
+            for (int l = 0; l < n; l++) scalarLane[l] = scalarLane[l] || (condition.re[l] > 0.0f) != follow;
+            if (!follow) idx += skip;
+            break;
+        }
+
+        case GPUTokens::TOKEN_JUMP:
+            idx += TokenAt(tokens, idx) + 1;
+            break;
+
+        case GPUTokens::TOKEN_PRELUDE:
+            idx += 2;
+            break;
+
+        case GPUTokens::TOKEN_MUL_R:
+        case GPUTokens::TOKEN_DIV_R:
+        {
+            if (depth < 2) { scalarBlock = true; break; }
+            BlockEntry& a = stack[depth - 2];
+            const BlockEntry& b = stack[depth - 1];
+            depth--;
+            if (token == GPUTokens::TOKEN_MUL_R)
+                for (int l = 0; l < n; l++) a.re[l] = a.re[l] * b.re[l];
+            else
+                for (int l = 0; l < n; l++) a.re[l] = RealDivide(a.re[l], b.re[l]);
+            for (int l = 0; l < n; l++) scalarLane[l] = scalarLane[l] || a.complex[l] || b.complex[l];
+            break;
+        }
+
+        case GPUTokens::TOKEN_SIN_R:
+        case GPUTokens::TOKEN_COS_R:
+        case GPUTokens::TOKEN_TAN_R:
+        case GPUTokens::TOKEN_EXP_R:
+        {
+            if (depth < 1) { scalarBlock = true; break; }
+            BlockEntry& a = stack[depth - 1];
+            if (token == GPUTokens::TOKEN_SIN_R) for (int l = 0; l < n; l++) a.re[l] = std::sin(a.re[l]);
+            else if (token == GPUTokens::TOKEN_COS_R) for (int l = 0; l < n; l++) a.re[l] = std::cos(a.re[l]);
+            else if (token == GPUTokens::TOKEN_TAN_R) for (int l = 0; l < n; l++) a.re[l] = RealDivide(std::sin(a.re[l]), std::cos(a.re[l]));
+            else for (int l = 0; l < n; l++) a.re[l] = SafeExp(a.re[l]);
+            for (int l = 0; l < n; l++) scalarLane[l] = scalarLane[l] || a.complex[l];
+            break;
+        }
+
+        case GPUTokens::TOKEN_LEN2:
+        case GPUTokens::TOKEN_DOT2:
+        case GPUTokens::TOKEN_HYPOT:
+        case GPUTokens::TOKEN_INVCUBE:
+        case GPUTokens::TOKEN_RSQRT:
+        {
+            // Real parts only, as the interpreter reads them, so complex-flagged lanes need no scalar pass
+            int count = FusedOperandCount(token);
+            if (depth < count) { scalarBlock = true; break; }
+            depth -= count;
+            BlockEntry& e = stack[depth];
+            for (int l = 0; l < n; l++)
+            {
+                float v[4] = {};
+                for (int k = 0; k < count; k++) v[k] = stack[depth + k].re[l];
+                e.re[l] = ApplyFused(token, v);
+                e.im[l] = 0.0f;
+                e.complex[l] = false;
+            }
+            depth++;
+            break;
+        }
+
+        case GPUTokens::TOKEN_DERIVATIVE:
+        {
+            int wrtVarHash = TokenAt(tokens, idx++);
+            int order = TokenAt(tokens, idx++);
+            int method = TokenAt(tokens, idx++);
+            int exprCount = TokenAt(tokens, idx++);
+            BlockEntry& e = stack[depth++];
+            for (int l = 0; l < n; l++)
+            {
+                Complex d = DerivativeValue(ctx, LaneFrame(block, l), stepTime, wrtVarHash, order, method,
+                                            idx, exprCount, constantOffset);
+                e.re[l] = d.x;
+                e.im[l] = d.y;
+                e.complex[l] = true;
+            }
+            idx += exprCount;
+            break;
+        }
+
+        case GPUTokens::TOKEN_ADD:
+        case GPUTokens::TOKEN_SUB:
+        {
+            if (depth < 2) { scalarBlock = true; break; }
+            BlockEntry& a = stack[depth - 2];
+            const BlockEntry& b = stack[depth - 1];
+            depth--;
+            float s = (token == GPUTokens::TOKEN_ADD) ? 1.0f : -1.0f;
+            for (int l = 0; l < n; l++)
+            {
+                a.re[l] = a.re[l] + s * b.re[l];
+                a.im[l] = a.im[l] + s * b.im[l];
+                a.complex[l] = a.complex[l] || b.complex[l];
+            }
+            break;
+        }
+
+        case GPUTokens::TOKEN_MUL:
+        {
+            if (depth < 2) { scalarBlock = true; break; }
+            BlockEntry& a = stack[depth - 2];
+            const BlockEntry& b = stack[depth - 1];
+            depth--;
+            for (int l = 0; l < n; l++)
+            {
+                float re = a.re[l] * b.re[l] - a.im[l] * b.im[l];
+                float im = a.re[l] * b.im[l] + a.im[l] * b.re[l];
+                a.re[l] = re;
+                a.im[l] = im;
+                a.complex[l] = true;
+            }
+            break;
+        }
+
+        case GPUTokens::TOKEN_DIV:
+        {
+            if (depth < 2) { scalarBlock = true; break; }
+            BlockEntry& a = stack[depth - 2];
+            const BlockEntry& b = stack[depth - 1];
+            depth--;
+            for (int l = 0; l < n; l++)
+            {
+                Complex q = CDiv({ a.re[l], a.im[l] }, { b.re[l], b.im[l] });
+                a.re[l] = q.x;
+                a.im[l] = q.y;
+                a.complex[l] = true;
+            }
+            break;
+        }
+
+        case GPUTokens::TOKEN_POW:
+        {
+            if (depth < 2) { scalarBlock = true; break; }
+            BlockEntry& a = stack[depth - 2];
+            const BlockEntry& b = stack[depth - 1];
+            depth--;
+            for (int l = 0; l < n; l++)
+            {
+                if (a.complex[l] || b.complex[l] || a.re[l] < 0.0f)
+                {
+                    Complex p = CPow({ a.re[l], a.im[l] }, { b.re[l], b.im[l] });
+                    a.re[l] = p.x;
+                    a.im[l] = p.y;
+                    a.complex[l] = true;
+                }
+                else
+                {
+                    a.re[l] = SafePow(a.re[l], b.re[l]);
+                    a.im[l] = 0.0f;
+                }
+            }
+            break;
+        }
+
+        case GPUTokens::TOKEN_NEG:
+        case GPUTokens::TOKEN_SIN:
+        case GPUTokens::TOKEN_COS:
+        case GPUTokens::TOKEN_TAN:
+        case GPUTokens::TOKEN_EXP:
+        case GPUTokens::TOKEN_LOG:
+        case GPUTokens::TOKEN_SQRT:
+        case GPUTokens::TOKEN_ABS:
+        {
+            if (depth < 1) { scalarBlock = true; break; }
+            BlockEntry& a = stack[depth - 1];
+            for (int l = 0; l < n; l++)
+            {
+                Complex v = { a.re[l], a.im[l] };
+                Complex res;
+                bool rc = true;
+                if (token == GPUTokens::TOKEN_NEG) { res = -v; rc = a.complex[l]; }
+                else if (token == GPUTokens::TOKEN_SIN) res = CSin(v);
+                else if (token == GPUTokens::TOKEN_COS) res = CCos(v);
+                else if (token == GPUTokens::TOKEN_EXP) res = CExp(v);
+                else if (token == GPUTokens::TOKEN_LOG) res = CLog(v);
+                else if (token == GPUTokens::TOKEN_TAN) res = CDiv(CSin(v), CCos(v));
+                else if (token == GPUTokens::TOKEN_SQRT)
+                {
+                    if (!a.complex[l] && v.x >= 0.0f) { res = { std::sqrt(v.x), 0.0f }; rc = false; }
+                    else res = CPow(v, Complex{ 0.5f, 0.0f });
+                }
+                else { res = { Length(v.x, v.y), 0.0f }; rc = false; }
+                a.re[l] = res.x;
+                a.im[l] = rc ? res.y : 0.0f;
+                a.complex[l] = rc;
+            }
+            break;
+        }
+
+        case GPUTokens::TOKEN_FLOOR:
+        case GPUTokens::TOKEN_CEIL:
+        case GPUTokens::TOKEN_FRAC:
+        case GPUTokens::TOKEN_SIGN:
+        case GPUTokens::TOKEN_STEP:
+        {
+            if (depth < 1) break;
+            BlockEntry& a = stack[depth - 1];
+            for (int l = 0; l < n; l++)
+            {
+                if (a.complex[l]) continue;
+                float v = a.re[l];
+                if (token == GPUTokens::TOKEN_FLOOR) v = std::floor(v);
+                else if (token == GPUTokens::TOKEN_CEIL) v = std::ceil(v);
+                else if (token == GPUTokens::TOKEN_FRAC) v = Fract(v);
+                else if (token == GPUTokens::TOKEN_SIGN) v = SignFunc(v);
+                else v = StepFunc(v);
+                a.re[l] = v;
+            }
+            break;
+        }
+
+        case GPUTokens::TOKEN_MOD:
+        case GPUTokens::TOKEN_MIN:
+        case GPUTokens::TOKEN_MAX:
+        case GPUTokens::TOKEN_ATAN2:
+        {
+            if (depth < 2) break;
+            BlockEntry& a = stack[depth - 2];
+            const BlockEntry& b = stack[depth - 1];
+            depth--;
+            for (int l = 0; l < n; l++)
+            {
+                scalarLane[l] = scalarLane[l] || a.complex[l] || b.complex[l];
+                float av = a.re[l], bv = b.re[l];
+                float res;
+                if (token == GPUTokens::TOKEN_MOD) res = (std::fabs(bv) < EPSILON) ? 0.0f : GlslMod(av, bv);
+                else if (token == GPUTokens::TOKEN_MIN) res = std::min(av, bv);
+                else if (token == GPUTokens::TOKEN_MAX) res = std::max(av, bv);
+                else res = std::atan2(av, bv);
+                a.re[l] = res;
+                a.im[l] = 0.0f;
+                a.complex[l] = false;
+            }
+            break;
+        }
+
+        case GPUTokens::TOKEN_CLAMP:
+        {
+            if (depth < 3) break;
+            BlockEntry& v = stack[depth - 3];
+            const BlockEntry& lo = stack[depth - 2];
+            const BlockEntry& hi = stack[depth - 1];
+            depth -= 2;
+            for (int l = 0; l < n; l++)
+            {
+                scalarLane[l] = scalarLane[l] || v.complex[l] || lo.complex[l] || hi.complex[l];
+                v.re[l] = Clamp(v.re[l], lo.re[l], hi.re[l]);
+                v.im[l] = 0.0f;
+                v.complex[l] = false;
+            }
+            break;
+        }
+
+        case GPUTokens::TOKEN_TABLE:
+        {
+            if (depth < 2) break;
+            BlockEntry& id = stack[depth - 2];
+            const BlockEntry& x = stack[depth - 1];
+            depth--;
+            for (int l = 0; l < n; l++)
+            {
+                scalarLane[l] = scalarLane[l] || id.complex[l] || x.complex[l];
+                id.re[l] = LookupTables::SampleTable(id.re[l], x.re[l]);
+                id.im[l] = 0.0f;
+                id.complex[l] = false;
+            }
+            break;
+        }
+
+        case GPUTokens::TOKEN_FIELD:
+        {
+            if (depth < 3) break;
+            BlockEntry& id = stack[depth - 3];
+            const BlockEntry& x = stack[depth - 2];
+            const BlockEntry& y = stack[depth - 1];
+            depth -= 2;
+            for (int l = 0; l < n; l++)
+            {
+                scalarLane[l] = scalarLane[l] || id.complex[l] || x.complex[l] || y.complex[l];
+                id.re[l] = LookupTables::SampleField(id.re[l], x.re[l], y.re[l]);
+                id.im[l] = 0.0f;
+                id.complex[l] = false;
+            }
+            break;
+        }
+
+        case GPUTokens::TOKEN_REAL:
+        case GPUTokens::TOKEN_IMAG:
+        case GPUTokens::TOKEN_ARG:
+        {
+            // On complex values these pop a stack entry but keep a float, see evaluateRPNComponent()
+            if (depth < 1) break;
+            BlockEntry& a = stack[depth - 1];
+            for (int l = 0; l < n; l++)
+            {
+                if (a.complex[l]) { scalarLane[l] = true; continue; }
+                if (token == GPUTokens::TOKEN_IMAG) a.re[l] = 0.0f;
+                else if (token == GPUTokens::TOKEN_ARG) a.re[l] = (a.re[l] >= 0.0f) ? 0.0f : SHADER_PI;
+            }
+            break;
+        }
+
+        case GPUTokens::TOKEN_CONJ:
+        {
+            if (depth < 1) break;
+            BlockEntry& a = stack[depth - 1];
+            for (int l = 0; l < n; l++) a.im[l] = -a.im[l];
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    for (int l = 0; l < n; l++)
+    {
+        if (scalarBlock || scalarLane[l])
+        {
+            out[l] = EvaluateComponentScalar(ctx, LaneFrame(block, l), block.temps[l], stepTime, componentType,
+                                             tokenOffset, tokenCount, constantOffset);
+            continue;
+        }
+        float result = (depth > 0) ? stack[0].re[l] : 0.0f;
+        if (IsInvalid(result)) result = isColor ? 1.0f : 0.0f;
+        else if (isColor) result = Clamp(result, 0.0f, 1.0f);
+        out[l] = result;
+    }
+}
+
+// evaluateObjectRates() for a block
+struct BlockRates
+{
+    float ax[CPU_LANES], ay[CPU_LANES];
+    float angular[CPU_LANES];
+    float color[4][CPU_LANES];
+};
+
+static void EvaluateBlockRates(const PassContext& ctx, ObjectBlock& block, int eqID, float stepTime, BlockRates& rates)
+{
+    const SimParams& params = *ctx.params;
+    const EquationSet& equations = *ctx.equations;
+    const int n = block.count;
+    for (int l = 0; l < n; l++)
+    {
+        rates.ax[l] = 0.0f;
+        rates.ay[l] = 0.0f;
+        rates.angular[l] = 0.0f;
+        for (int c = 0; c < 4; c++) rates.color[c][l] = block.color[c][l];
+    }
+
+    const int* fields = nullptr;
+    bool valid = false;
+    if (params.equationMode == 0 && eqID >= 0 && eqID < static_cast<int>(equations.mappings.size()))
+    {
+        fields = &equations.mappings[eqID].tokenOffset_ax;
+        for (int c = 0; c < 7; c++) valid = valid || fields[c * 4 + 1] > 0;
+    }
+
+    if (!valid)
+    {
+        // calculateDefaultPhysics()
+        for (int l = 0; l < n; l++)
+        {
+            rates.ax[l] = Sanitize(params.gravityDir.x * params.gravity - block.vx[l] * params.damping);
+            rates.ay[l] = Sanitize(params.gravityDir.y * params.gravity - block.vy[l] * params.damping);
+        }
+        return;
+    }
+
+    float* targets[7] = { rates.ax, rates.ay, rates.angular, rates.color[0], rates.color[1], rates.color[2], rates.color[3] };
+    for (int c = 0; c < 7; c++)
+    {
+        if (fields[c * 4 + 1] <= 0) continue;
+        EvaluateComponentBlock(ctx, block, stepTime, c, fields[c * 4], fields[c * 4 + 1], fields[c * 4 + 2], targets[c]);
+    }
+    for (int l = 0; l < n; l++)
+    {
+        rates.ax[l] = Sanitize(rates.ax[l]);
+        rates.ay[l] = Sanitize(rates.ay[l]);
+        rates.angular[l] = Sanitize(rates.angular[l]);
+        for (int c = 0; c < 4; c++) rates.color[c][l] = Sanitize(rates.color[c][l]);
+    }
+}
+
+// ============================================================================
+// INTEGRATION (main() of math.comp)
+// ============================================================================
+static int IntegratorStageCount(int method)
+{
+    if (method == INTEGRATOR_VELOCITY_VERLET) return 2;
+    if (method == INTEGRATOR_YOSHIDA4 || method == INTEGRATOR_RK4) return 4;
+    return 1;
+}
+
+static void IntegratorKickDrift(int method, int stage, float& kick, float& drift)
+{
+    kick = 1.0f;
+    drift = 1.0f;
+    if (method == INTEGRATOR_VELOCITY_VERLET)
+    {
+        kick = 0.5f;
+        drift = (stage == 0) ? 1.0f : 0.0f;
+    }
+    else if (method == INTEGRATOR_YOSHIDA4)
+    {
+        if (stage == 0) { kick = 0.5f * YOSHIDA_W1; drift = YOSHIDA_W1; }
+        else if (stage == 1) { kick = 0.5f * (YOSHIDA_W1 + YOSHIDA_W0); drift = YOSHIDA_W0; }
+        else if (stage == 2) { kick = 0.5f * (YOSHIDA_W0 + YOSHIDA_W1); drift = YOSHIDA_W1; }
+        else { kick = 0.5f * YOSHIDA_W1; drift = 0.0f; }
+    }
+}
+
+static float IntegratorStageTime(int method, int stage)
+{
+    if (method == INTEGRATOR_RK4) return (stage == 0) ? 0.0f : (stage == 3) ? 1.0f : 0.5f;
+    float t = 0.0f;
+    for (int s = 0; s < stage; s++)
+    {
+        float kick, drift;
+        IntegratorKickDrift(method, s, kick, drift);
+        t += drift;
+    }
+    return t;
+}
+
+static void LoadBlock(ObjectBlock& block, const ObjectArrays& in, const int* indices, int count)
+{
+    block.count = count;
+    for (int l = 0; l < count; l++)
+    {
+        int i = indices[l];
+        block.index[l] = i;
+        block.x[l] = in.x[i];
+        block.y[l] = in.y[i];
+        block.vx[l] = in.vx[i];
+        block.vy[l] = in.vy[i];
+        block.axPrev[l] = in.ax[i];
+        block.ayPrev[l] = in.ay[i];
+        block.rotation[l] = in.rotation[i];
+        block.angularVel[l] = in.angularVelocity[i];
+        block.color[0][l] = in.r[i];
+        block.color[1][l] = in.g[i];
+        block.color[2][l] = in.b[i];
+        block.color[3][l] = in.a[i];
+        block.mass[l] = std::max(EPSILON, in.mass[i]);
+        block.charge[l] = in.charge[i];
+    }
+}
+
+// All stages of one step, or the stage of a staged pass, for one block
+static void IntegrateBlock(Scene& scene, const PassContext& ctx, ObjectBlock& block, ObjectArrays& out, int stagedStage)
+{
+    const int n = block.count;
+    const ObjectArrays& in = *ctx.input;
+    const float dt = ctx.params->dt;
+    const int method = scene.integrator;
+    const int stageCount = IntegratorStageCount(method);
+    const bool stagedPass = stagedStage >= 0;
+    const int firstStage = stagedPass ? std::min(stagedStage, stageCount - 1) : 0;
+    const int lastStage = stagedPass ? firstStage : stageCount - 1;
+    const int eqID = in.equation[block.index[0]];
+
+    float baseX[CPU_LANES], baseY[CPU_LANES], baseVx[CPU_LANES], baseVy[CPU_LANES];
+    float baseRot[CPU_LANES], baseAng[CPU_LANES];
+    float sumPx[CPU_LANES], sumPy[CPU_LANES], sumVx[CPU_LANES], sumVy[CPU_LANES];
+    float sumRot[CPU_LANES], sumAng[CPU_LANES];
+    float firstAx[CPU_LANES], firstAy[CPU_LANES], firstColor[4][CPU_LANES];
+    for (int l = 0; l < n; l++)
+    {
+        baseX[l] = block.x[l];
+        baseY[l] = block.y[l];
+        baseVx[l] = block.vx[l];
+        baseVy[l] = block.vy[l];
+        baseRot[l] = block.rotation[l];
+        baseAng[l] = block.angularVel[l];
+        sumPx[l] = sumPy[l] = sumVx[l] = sumVy[l] = sumRot[l] = sumAng[l] = 0.0f;
+        firstAx[l] = block.axPrev[l];
+        firstAy[l] = block.ayPrev[l];
+        for (int c = 0; c < 4; c++) firstColor[c][l] = block.color[c][l];
+    }
+    if (stagedPass && firstStage > 0)
+    {
+        for (int l = 0; l < n; l++)
+        {
+            const float* s = &scene.integratorScratch[static_cast<size_t>(block.index[l]) * SCRATCH_FLOATS];
+            baseX[l] = s[0]; baseY[l] = s[1]; baseVx[l] = s[2]; baseVy[l] = s[3];
+            sumPx[l] = s[4]; sumPy[l] = s[5]; sumVx[l] = s[6]; sumVy[l] = s[7];
+            baseRot[l] = s[8]; baseAng[l] = s[9]; sumRot[l] = s[10]; sumAng[l] = s[11];
+            firstAx[l] = s[12]; firstAy[l] = s[13];
+            for (int c = 0; c < 4; c++) firstColor[c][l] = s[14 + c];
+        }
+    }
+
+    BlockRates rates;
+    for (int stage = firstStage; stage <= lastStage; stage++)
+    {
+        float stepTime = ctx.params->time + IntegratorStageTime(method, stage) * dt;
+        EvaluateBlockRates(ctx, block, eqID, stepTime, rates);
+
+        if (stage == 0)
+        {
+            for (int l = 0; l < n; l++)
+            {
+                baseX[l] = block.x[l];
+                baseY[l] = block.y[l];
+                baseVx[l] = block.vx[l];
+                baseVy[l] = block.vy[l];
+                baseRot[l] = block.rotation[l];
+                baseAng[l] = block.angularVel[l];
+                sumPx[l] = sumPy[l] = sumVx[l] = sumVy[l] = sumRot[l] = sumAng[l] = 0.0f;
+                firstAx[l] = rates.ax[l];
+                firstAy[l] = rates.ay[l];
+                for (int c = 0; c < 4; c++) firstColor[c][l] = rates.color[c][l];
+            }
+        }
+
+        if (method == INTEGRATOR_RK4)
+        {
+            float weight = (stage == 0 || stage == 3) ? 1.0f : 2.0f;
+            float h = (stage == 3) ? dt / 6.0f : (stage == 2) ? dt : 0.5f * dt;
+            bool last = stage == 3;
+            for (int l = 0; l < n; l++)
+            {
+                sumPx[l] += weight * block.vx[l];
+                sumPy[l] += weight * block.vy[l];
+                sumVx[l] += weight * rates.ax[l];
+                sumVy[l] += weight * rates.ay[l];
+                sumRot[l] += weight * block.angularVel[l];
+                sumAng[l] += weight * rates.angular[l];
+                float px = last ? sumPx[l] : block.vx[l];
+                float py = last ? sumPy[l] : block.vy[l];
+                float vx = last ? sumVx[l] : rates.ax[l];
+                float vy = last ? sumVy[l] : rates.ay[l];
+                float rot = last ? sumRot[l] : block.angularVel[l];
+                float ang = last ? sumAng[l] : rates.angular[l];
+                block.x[l] = baseX[l] + px * h;
+                block.y[l] = baseY[l] + py * h;
+                block.vx[l] = baseVx[l] + vx * h;
+                block.vy[l] = baseVy[l] + vy * h;
+                block.rotation[l] = baseRot[l] + rot * h;
+                block.angularVel[l] = baseAng[l] + ang * h;
+            }
+        }
+        else
+        {
+            float kick, drift;
+            IntegratorKickDrift(method, stage, kick, drift);
+            float kickDt = kick * dt;
+            float driftDt = drift * dt;
+            for (int l = 0; l < n; l++)
+            {
+                block.vx[l] += rates.ax[l] * kickDt;
+                block.vy[l] += rates.ay[l] * kickDt;
+                block.x[l] += block.vx[l] * driftDt;
+                block.y[l] += block.vy[l] * driftDt;
+                block.angularVel[l] += rates.angular[l] * kickDt;
+                block.rotation[l] += block.angularVel[l] * driftDt;
+            }
+        }
+        for (int l = 0; l < n; l++)
+        {
+            block.x[l] = Sanitize(block.x[l]);
+            block.y[l] = Sanitize(block.y[l]);
+            block.vx[l] = Sanitize(block.vx[l]);
+            block.vy[l] = Sanitize(block.vy[l]);
+        }
+    }
+
+    const bool unfinished = lastStage < stageCount - 1;
+    for (int l = 0; l < n; l++)
+    {
+        const int o = block.index[l];
+        float x = block.x[l], y = block.y[l], vx = block.vx[l], vy = block.vy[l];
+        float rotation = block.rotation[l];
+        float ax = block.axPrev[l], ay = block.ayPrev[l];
+        float color[4] = { block.color[0][l], block.color[1][l], block.color[2][l], block.color[3][l] };
+
+        if (unfinished)
+        {
+            // The next staged pass picks the step up from here
+            float* s = &scene.integratorScratch[static_cast<size_t>(o) * SCRATCH_FLOATS];
+            s[0] = baseX[l]; s[1] = baseY[l]; s[2] = baseVx[l]; s[3] = baseVy[l];
+            s[4] = sumPx[l]; s[5] = sumPy[l]; s[6] = sumVx[l]; s[7] = sumVy[l];
+            s[8] = baseRot[l]; s[9] = baseAng[l]; s[10] = sumRot[l]; s[11] = sumAng[l];
+            s[12] = firstAx[l]; s[13] = firstAy[l];
+            for (int c = 0; c < 4; c++) s[14 + c] = firstColor[c][l];
+        }
+        else
+        {
+            rotation = GlslMod(rotation, 2.0f * SHADER_PI);
+
+            // Periodic boxes stay on the GPU (Objects::CanStepOnCpu)
+            if (ctx.params->boundaryMode == BOUNDARY_REFLECT)
+            {
+                const float restitution = ctx.params->restitution;
+                const glm::vec2 lo = ctx.params->worldMin, hi = ctx.params->worldMax;
+                if (x < lo.x) { x = lo.x; vx = std::fabs(vx) * restitution; vy *= BOUNDARY_FRICTION; }
+                else if (x > hi.x) { x = hi.x; vx = -std::fabs(vx) * restitution; vy *= BOUNDARY_FRICTION; }
+                if (y < lo.y) { y = lo.y; vy = std::fabs(vy) * restitution; vx *= BOUNDARY_FRICTION; }
+                else if (y > hi.y) { y = hi.y; vy = -std::fabs(vy) * restitution; vx *= BOUNDARY_FRICTION; }
+            }
+
+            x = Sanitize(x);
+            y = Sanitize(y);
+            vx = Sanitize(vx);
+            vy = Sanitize(vy);
+            ClampSpeed(vx, vy);
+
+            ax = firstAx[l];
+            ay = firstAy[l];
+            for (int c = 0; c < 4; c++) color[c] = firstColor[c][l];
+        }
+
+        out.x[o] = x;
+        out.y[o] = y;
+        out.vx[o] = vx;
+        out.vy[o] = vy;
+        out.ax[o] = ax;
+        out.ay[o] = ay;
+        out.rotation[o] = rotation;
+        out.angularVelocity[o] = block.angularVel[l];
+        out.r[o] = color[0];
+        out.g[o] = color[1];
+        out.b[o] = color[2];
+        out.a[o] = color[3];
+        out.mass[o] = block.mass[l];
+        out.charge[o] = block.charge[l];
+        out.width[o] = in.width[o];
+        out.height[o] = in.height[o];
+        out.equation[o] = in.equation[o];
+    }
+}
+
+static void IntegratePass(Scene& scene, const PassContext& ctx, ObjectArrays& out, int stagedStage)
+{
+    int numBlocks = static_cast<int>(scene.blocks.size()) - 1;
+    CpuBackend::ParallelFor(numBlocks, 4, [&](int begin, int end)
+    {
+        ObjectBlock block;
+        for (int b = begin; b < end; b++)
+        {
+            int first = scene.blocks[b];
+            LoadBlock(block, *ctx.input, &scene.order[first], scene.blocks[b + 1] - first);
+            IntegrateBlock(scene, ctx, block, out, stagedStage);
+        }
+    });
+}
+
+// ============================================================================
+// HASHED GRID (neighbour reductions and the collision broadphase)
+// ============================================================================
+struct HashGrid
+{
+    float cellSize = 0.0f;
+    uint32_t mask = 0;
+    std::vector<uint32_t> cellStart;  // mask + 2 entries: objects of cell k are [cellStart[k], cellStart[k + 1])
+    std::vector<int> objects;         // Sorted by cell, by index within a cell
+    std::vector<uint32_t> keys;
+};
+
+// MUST MATCH neighbourCellKey() / gridCellKey(); every object of a Scene is in world 0
+static inline uint32_t GridCellKey(int cx, int cy, uint32_t mask)
+{
+    return ((static_cast<uint32_t>(cx) * 73856093u) ^ (static_cast<uint32_t>(cy) * 19349663u)) & mask;
+}
+
+static inline int GridCoord(float v, float cellSize)
+{
+    return static_cast<int>(Clamp(std::floor(v / cellSize), -2.0e9f, 2.0e9f));
+}
+
+static void BuildGrid(HashGrid& grid, const ObjectArrays& state, const std::vector<char>* included, float cellSize)
+{
+    const int n = static_cast<int>(state.Size());
+    uint32_t tableSize = 64;
+    while (tableSize < static_cast<uint32_t>(2 * n)) tableSize <<= 1;
+
+    grid.cellSize = cellSize;
+    grid.mask = tableSize - 1;
+    grid.cellStart.assign(tableSize + 1, 0);
+    grid.keys.resize(n);
+    for (int i = 0; i < n; i++)
+    {
+        if (included && !(*included)[i])
+        {
+            grid.keys[i] = tableSize;
+            continue;
+        }
+        grid.keys[i] = GridCellKey(GridCoord(state.x[i], cellSize), GridCoord(state.y[i], cellSize), grid.mask);
+        grid.cellStart[grid.keys[i] + 1]++;
+    }
+    for (uint32_t k = 0; k < tableSize; k++) grid.cellStart[k + 1] += grid.cellStart[k];
+
+    grid.objects.resize(grid.cellStart[tableSize]);
+    std::vector<uint32_t> cursor(grid.cellStart.begin(), grid.cellStart.end() - 1);
+    for (int i = 0; i < n; i++)
+        if (grid.keys[i] < tableSize) grid.objects[cursor[grid.keys[i]]++] = i;
+}
+
+// Objects in the 3x3 cells around (x, y), each hashed bucket once
+template <typename Visit>
+static void VisitNeighbourCells(const HashGrid& grid, float x, float y, Visit visit)
+{
+    int cx = GridCoord(x, grid.cellSize);
+    int cy = GridCoord(y, grid.cellSize);
+    uint32_t visited[9];
+    int numVisited = 0;
+    for (int dy = -1; dy <= 1; dy++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            uint32_t key = GridCellKey(cx + dx, cy + dy, grid.mask);
+            bool seen = false;
+            for (int v = 0; v < numVisited; v++) seen = seen || visited[v] == key;
+            if (seen) continue;
+            visited[numVisited++] = key;
+            for (uint32_t k = grid.cellStart[key]; k < grid.cellStart[key + 1]; k++) visit(grid.objects[k]);
+        }
+    }
+}
+
+// ============================================================================
+// PAIR REDUCTIONS (computePairSums)
+// ============================================================================
+static float PairSelfVariable(const PassContext& ctx, int self, int varHash)
+{
+    const ObjectArrays& s = *ctx.input;
+    const SimParams& params = *ctx.params;
+    switch (varHash)
+    {
+    case VAR_HASH_X: return s.x[self];
+    case VAR_HASH_Y: return s.y[self];
+    case VAR_HASH_VX: return s.vx[self];
+    case VAR_HASH_VY: return s.vy[self];
+    case VAR_HASH_AX: return s.ax[self];
+    case VAR_HASH_AY: return s.ay[self];
+    case VAR_HASH_T: return params.time;
+    case VAR_HASH_THETA: return s.rotation[self];
+    case VAR_HASH_OMEGA: return s.angularVelocity[self];
+    case VAR_HASH_R: return s.r[self];
+    case VAR_HASH_G: return s.g[self];
+    case VAR_HASH_B: return s.b[self];
+    case VAR_HASH_A: return s.a[self];
+    case VAR_HASH_PI: return SHADER_PI;
+    case VAR_HASH_E: return SHADER_E;
+    case VAR_HASH_K: return params.stiffness;
+    case VAR_HASH_B_DAMP: return params.damping;
+    case VAR_HASH_G_GRAV: return params.gravity;
+    case VAR_HASH_MASS: return std::max(EPSILON, s.mass[self]);
+    case VAR_HASH_CHARGE: return s.charge[self];
+    case VAR_HASH_COUPLING: return params.coupling;
+    case VAR_HASH_FREQ: return params.driveFreq;
+    case VAR_HASH_AMP: return params.driveAmp;
+    case VAR_HASH_GRAV_AX:
+    case VAR_HASH_GRAV_AY:
+    case VAR_HASH_COUL_AX:
+    case VAR_HASH_COUL_AY:
+    case VAR_HASH_SPH_AX:
+    case VAR_HASH_SPH_AY:
+    case VAR_HASH_SPH_RHO:
+    case VAR_HASH_SPH_P: return 0.0f;
+    default: return ParamValue(ctx, self, varHash);
+    }
+}
+
+static float PairProperty(const ObjectArrays& s, int j, int propHash)
+{
+    switch (propHash)
+    {
+    case PROP_HASH_X: return s.x[j];
+    case PROP_HASH_Y: return s.y[j];
+    case PROP_HASH_VX: return s.vx[j];
+    case PROP_HASH_VY: return s.vy[j];
+    case PROP_HASH_AX: return s.ax[j];
+    case PROP_HASH_AY: return s.ay[j];
+    case PROP_HASH_MASS: return s.mass[j];
+    case PROP_HASH_CHARGE: return s.charge[j];
+    case PROP_HASH_DATA_X: return s.width[j];
+    case PROP_HASH_DATA_Y: return s.height[j];
+    case PROP_HASH_DATA_Z: return s.rotation[j];
+    case PROP_HASH_DATA_W: return s.angularVelocity[j];
+    case PROP_HASH_COLOR_R: return s.r[j];
+    case PROP_HASH_COLOR_G: return s.g[j];
+    case PROP_HASH_COLOR_B: return s.b[j];
+    case PROP_HASH_COLOR_A: return s.a[j];
+    }
+    return 0.0f;
+}
+
+// evaluatePairExpression() of self against up to CPU_LANES others. Bodies are real, so every lane
+// takes the same path through the tokens until an if() the lanes disagree on; the block is then
+// evaluated again one other at a time.
+static void EvaluatePairBlock(const PassContext& ctx, int self, const PairSumExpression& expr,
+                              const int* others, int count, float* out)
+{
+    const std::vector<int>& tokens = ctx.equations->tokens;
+    const std::vector<float>& constants = ctx.equations->constants;
+    float stack[MAX_RPN_STACK_SIZE][CPU_LANES];
+    int sp = 0;
+    int idx = expr.tokenOffset;
+    const int end = std::min(expr.tokenOffset + expr.tokenCount, static_cast<int>(tokens.size()));
+
+    while (idx < end)
+    {
+        if (sp >= MAX_RPN_STACK_SIZE - 1)
+        {
+            std::fill(out, out + count, 0.0f);
+            return;
+        }
+        int token = tokens[idx++];
+
+        if (token == GPUTokens::TOKEN_NUMBER || token == GPUTokens::TOKEN_VARIABLE)
+        {
+            int operand = TokenAt(tokens, idx++);
+            float value = (token == GPUTokens::TOKEN_NUMBER) ? Sanitize(ConstantAt(constants, expr.constantOffset + operand))
+                                                  : PairSelfVariable(ctx, self, operand);
+            std::fill(stack[sp], stack[sp] + count, value);
+            sp++;
+        }
+        else if (token == GPUTokens::TOKEN_PAIR_REF)
+        {
+            int propHash = TokenAt(tokens, idx++);
+            for (int l = 0; l < count; l++) stack[sp][l] = Sanitize(PairProperty(*ctx.input, others[l], propHash));
+            sp++;
+        }
+        else if (token == GPUTokens::TOKEN_BRANCH)
+        {
+            int skip = TokenAt(tokens, idx++);
+            if (sp < 1) continue;
+            sp--;
+            int taken = 0;
+            for (int l = 0; l < count; l++) taken += stack[sp][l] > 0.0f ? 1 : 0;
+            if (taken != 0 && taken != count)
+            {
+                for (int l = 0; l < count; l++) EvaluatePairBlock(ctx, self, expr, others + l, 1, out + l);
+                return;
+            }
+            if (taken == 0) idx += skip;
+        }
+        else if (token == GPUTokens::TOKEN_JUMP)
+        {
+            idx += TokenAt(tokens, idx) + 1;
+        }
+        else if (token == GPUTokens::TOKEN_CLAMP)
+        {
+            if (sp < 3) continue;
+            sp -= 2;
+            for (int l = 0; l < count; l++) stack[sp - 1][l] = Clamp(stack[sp - 1][l], stack[sp][l], stack[sp + 1][l]);
+        }
+        else if (token == GPUTokens::TOKEN_ADD || token == GPUTokens::TOKEN_SUB || token == GPUTokens::TOKEN_MUL || token == GPUTokens::TOKEN_DIV ||
+                 token == GPUTokens::TOKEN_MUL_R || token == GPUTokens::TOKEN_DIV_R || token == GPUTokens::TOKEN_POW || token == GPUTokens::TOKEN_MOD ||
+                 token == GPUTokens::TOKEN_MIN || token == GPUTokens::TOKEN_MAX || token == GPUTokens::TOKEN_ATAN2)
+        {
+            if (sp < 2) { std::fill(stack[0], stack[0] + count, 0.0f); sp = 1; continue; }
+            sp--;
+            float* a = stack[sp - 1];
+            const float* b = stack[sp];
+            switch (token)
+            {
+            case GPUTokens::TOKEN_ADD: for (int l = 0; l < count; l++) a[l] = a[l] + b[l]; break;
+            case GPUTokens::TOKEN_SUB: for (int l = 0; l < count; l++) a[l] = a[l] - b[l]; break;
+            case GPUTokens::TOKEN_MUL:
+            case GPUTokens::TOKEN_MUL_R: for (int l = 0; l < count; l++) a[l] = a[l] * b[l]; break;
+            case GPUTokens::TOKEN_DIV:
+            case GPUTokens::TOKEN_DIV_R: for (int l = 0; l < count; l++) a[l] = RealDivide(a[l], b[l]); break;
+            case GPUTokens::TOKEN_POW:
+                for (int l = 0; l < count; l++)
+                    a[l] = (a[l] < 0.0f) ? CPow({ a[l], 0.0f }, { b[l], 0.0f }).x : SafePow(a[l], b[l]);
+                break;
+            case GPUTokens::TOKEN_MOD:
+                for (int l = 0; l < count; l++) a[l] = (std::fabs(b[l]) < EPSILON) ? 0.0f : GlslMod(a[l], b[l]);
+                break;
+            case GPUTokens::TOKEN_MIN: for (int l = 0; l < count; l++) a[l] = std::min(a[l], b[l]); break;
+            case GPUTokens::TOKEN_MAX: for (int l = 0; l < count; l++) a[l] = std::max(a[l], b[l]); break;
+            default: for (int l = 0; l < count; l++) a[l] = std::atan2(a[l], b[l]); break;
+            }
+        }
+        else if (IsFused(token))
+        {
+            // Same float operations as ApplyFused(), as lane loops
+            int operands = FusedOperandCount(token);
+            if (sp < operands) { std::fill(stack[0], stack[0] + count, 0.0f); sp = 1; continue; }
+            sp -= operands - 1;
+            float* a = stack[sp - 1];
+            const float* b = stack[sp];
+            switch (token)
+            {
+            case GPUTokens::TOKEN_LEN2: for (int l = 0; l < count; l++) a[l] = a[l] * a[l] + b[l] * b[l]; break;
+            case GPUTokens::TOKEN_DOT2:
+                for (int l = 0; l < count; l++) a[l] = a[l] * stack[sp + 1][l] + b[l] * stack[sp + 2][l];
+                break;
+            case GPUTokens::TOKEN_HYPOT: for (int l = 0; l < count; l++) a[l] = std::sqrt(a[l] * a[l] + b[l] * b[l]); break;
+            case GPUTokens::TOKEN_INVCUBE:
+                for (int l = 0; l < count; l++)
+                {
+                    float s = a[l] * a[l] + b[l] * b[l];
+                    a[l] = RealDivide(1.0f, s * std::sqrt(s));
+                }
+                break;
+            default: for (int l = 0; l < count; l++) a[l] = RealDivide(1.0f, std::sqrt(std::max(a[l], 0.0f))); break;
+            }
+        }
+        else if (token == GPUTokens::TOKEN_REAL || token == GPUTokens::TOKEN_CONJ ||
+                 token == GPUTokens::TOKEN_OPEN_PAREN || token == GPUTokens::TOKEN_CLOSE_PAREN || token == GPUTokens::TOKEN_COMMA)
+        {
+            // No-ops on real values
+        }
+        else
+        {
+            if (sp < 1) { std::fill(stack[0], stack[0] + count, 0.0f); sp = 1; continue; }
+            float* a = stack[sp - 1];
+            switch (token)
+            {
+            case GPUTokens::TOKEN_NEG: for (int l = 0; l < count; l++) a[l] = -a[l]; break;
+            case GPUTokens::TOKEN_SIN:
+            case GPUTokens::TOKEN_SIN_R: for (int l = 0; l < count; l++) a[l] = std::sin(a[l]); break;
+            case GPUTokens::TOKEN_COS:
+            case GPUTokens::TOKEN_COS_R: for (int l = 0; l < count; l++) a[l] = std::cos(a[l]); break;
+            case GPUTokens::TOKEN_TAN:
+            case GPUTokens::TOKEN_TAN_R: for (int l = 0; l < count; l++) a[l] = RealDivide(std::sin(a[l]), std::cos(a[l])); break;
+            case GPUTokens::TOKEN_EXP:
+            case GPUTokens::TOKEN_EXP_R: for (int l = 0; l < count; l++) a[l] = SafeExp(a[l]); break;
+            case GPUTokens::TOKEN_LOG: for (int l = 0; l < count; l++) a[l] = SafeLog(std::fabs(a[l])); break;
+            case GPUTokens::TOKEN_SQRT: for (int l = 0; l < count; l++) a[l] = (a[l] > 0.0f) ? std::sqrt(a[l]) : 0.0f; break;
+            case GPUTokens::TOKEN_ABS: for (int l = 0; l < count; l++) a[l] = std::fabs(a[l]); break;
+            case GPUTokens::TOKEN_FLOOR: for (int l = 0; l < count; l++) a[l] = std::floor(a[l]); break;
+            case GPUTokens::TOKEN_CEIL: for (int l = 0; l < count; l++) a[l] = std::ceil(a[l]); break;
+            case GPUTokens::TOKEN_FRAC: for (int l = 0; l < count; l++) a[l] = Fract(a[l]); break;
+            case GPUTokens::TOKEN_SIGN: for (int l = 0; l < count; l++) a[l] = SignFunc(a[l]); break;
+            case GPUTokens::TOKEN_STEP: for (int l = 0; l < count; l++) a[l] = StepFunc(a[l]); break;
+            case GPUTokens::TOKEN_IMAG: for (int l = 0; l < count; l++) a[l] = 0.0f; break;
+            case GPUTokens::TOKEN_ARG: for (int l = 0; l < count; l++) a[l] = (a[l] >= 0.0f) ? 0.0f : SHADER_PI; break;
+            default: break;
+            }
+        }
+    }
+
+    for (int l = 0; l < count; l++) out[l] = (sp > 0) ? Sanitize(stack[0][l]) : 0.0f;
+}
+
+// Sum of the body over the listed others, in list order
+static float SumPairBlocks(const PassContext& ctx, int self, const PairSumExpression& expr, const int* others, int count)
+{
+    float sum = 0.0f;
+    float values[CPU_LANES];
+    for (int first = 0; first < count; first += CPU_LANES)
+    {
+        int lanes = std::min(CPU_LANES, count - first);
+        EvaluatePairBlock(ctx, self, expr, others + first, lanes, values);
+        for (int l = 0; l < lanes; l++) sum += values[l];
+    }
+    return sum;
+}
+
+static void ComputePairSums(Scene& scene, const PassContext& ctx, const HashGrid* neighbourGrid)
+{
+    const EquationSet& equations = *ctx.equations;
+    const ObjectArrays& in = *ctx.input;
+    const int n = ctx.numObjects;
+    scene.pairSumValues.assign(static_cast<size_t>(n) * MAX_PAIR_SUMS_PER_EQUATION, 0.0f);
+
+    CpuBackend::ParallelFor(n, 32, [&](int begin, int end)
+    {
+        std::vector<int> others;
+        std::vector<int> candidates;
+        std::vector<float> distances;
+        for (int i = begin; i < end; i++)
+        {
+            int eqID = in.equation[i];
+            bool hasSums = eqID >= 0 && eqID < static_cast<int>(equations.mappings.size()) &&
+                           equations.pairSums[eqID * MAX_PAIR_SUMS_PER_EQUATION].used != 0;
+            if (!hasSums) continue;  // Every slot reads 0
+            const PairSumExpression* exprs = &equations.pairSums[eqID * MAX_PAIR_SUMS_PER_EQUATION];
+
+            float sums[MAX_PAIR_SUMS_PER_EQUATION] = {};
+            float counts[MAX_PAIR_SUMS_PER_EQUATION] = {};
+
+            // sum_j(): every other object in index order
+            for (int s = 0; s < MAX_PAIR_SUMS_PER_EQUATION && exprs[s].used != 0; s++)
+            {
+                if (exprs[s].radius > 0.0f) continue;
+                others.clear();
+                for (int j = 0; j < n; j++)
+                    if (j != i) others.push_back(j);
+                sums[s] += SumPairBlocks(ctx, i, exprs[s], others.data(), static_cast<int>(others.size()));
+            }
+
+            // nsum/ncount/nmean: objects of the 3x3 cells around this one, in the order the cells are visited
+            if (neighbourGrid)
+            {
+                candidates.clear();
+                distances.clear();
+                VisitNeighbourCells(*neighbourGrid, in.x[i], in.y[i], [&](int j)
+                {
+                    if (j == i) return;
+                    float dx = in.x[j] - in.x[i];
+                    float dy = in.y[j] - in.y[i];
+                    candidates.push_back(j);
+                    distances.push_back(dx * dx + dy * dy);
+                });
+                for (int s = 0; s < MAX_PAIR_SUMS_PER_EQUATION && exprs[s].used != 0; s++)
+                {
+                    float radius = exprs[s].radius;
+                    if (radius <= 0.0f) continue;
+                    others.clear();
+                    for (size_t c = 0; c < candidates.size(); c++)
+                        if (distances[c] <= radius * radius) others.push_back(candidates[c]);
+                    counts[s] += static_cast<float>(others.size());
+                    if (exprs[s].reduction != PairReductions::PAIR_REDUCE_COUNT)
+                        sums[s] += SumPairBlocks(ctx, i, exprs[s], others.data(), static_cast<int>(others.size()));
+                }
+            }
+
+            for (int s = 0; s < MAX_PAIR_SUMS_PER_EQUATION; s++)
+            {
+                int reduction = exprs[s].reduction;
+                float value = sums[s];
+                if (reduction == PairReductions::PAIR_REDUCE_COUNT) value = counts[s];
+                else if (reduction == PairReductions::PAIR_REDUCE_MEAN) value = counts[s] > 0.0f ? sums[s] / counts[s] : 0.0f;
+                scene.pairSumValues[static_cast<size_t>(i) * MAX_PAIR_SUMS_PER_EQUATION + s] = Sanitize(value);
+            }
+        }
+    });
+}
+
+// ============================================================================
+// CONSTRAINTS (constraints.comp), in place on the integrated state
+// ============================================================================
+static void SolveDistanceConstraint(float& px, float& py, float& vx, float& vy, const Constraint& c,
+                                    int self, const ObjectArrays& source)
+{
+    int target = c.targetObjectID;
+    if (target < 0 || target >= static_cast<int>(source.Size()) || target == self) return;
+
+    float ox = source.x[target] - px;
+    float oy = source.y[target] - py;
+    float dist = Length(ox, oy);
+    if (dist < EPSILON) return;
+
+    float ex = ox - ox / dist * c.param1;
+    float ey = oy - oy / dist * c.param1;
+    px -= ex * CONSTRAINT_STIFFNESS;
+    py -= ey * CONSTRAINT_STIFFNESS;
+
+    float rvx = vx - source.vx[target];
+    float rvy = vy - source.vy[target];
+    float nx = ex + EPSILON, ny = ey + EPSILON;
+    float len = Length(nx, ny);
+    nx /= len;
+    ny /= len;
+    float along = rvx * nx + rvy * ny;
+    const float damping = 0.8f;
+    vx -= along * nx * damping;
+    vy -= along * ny * damping;
+}
+
+static void SolveBoundaryConstraint(float& px, float& py, float& vx, float& vy, const Constraint& c)
+{
+    float minX = std::min(c.param1, c.param2), maxX = std::max(c.param1, c.param2);
+    float minY = std::min(c.param3, c.param4), maxY = std::max(c.param3, c.param4);
+    const float elasticity = 0.7f;
+    const float friction = 0.95f;
+
+    if (px < minX) { px = minX; vx = std::fabs(vx) * elasticity; vy *= friction; }
+    else if (px > maxX) { px = maxX; vx = -std::fabs(vx) * elasticity; vy *= friction; }
+    if (py < minY) { py = minY; vy = std::fabs(vy) * elasticity; vx *= friction; }
+    else if (py > maxY) { py = maxY; vy = -std::fabs(vy) * elasticity; vx *= friction; }
+}
+
+static void SolveAngleConstraint(float& px, float& py, float& vx, float& vy, const Constraint& c, float originX, float originY)
+{
+    float dx = px - originX, dy = py - originY;
+    float radius = Length(dx, dy);
+    if (radius < EPSILON) return;
+
+    const float twoPi = 2.0f * SHADER_PI;
+    float current = GlslMod(std::atan2(dy, dx) + twoPi, twoPi);
+    float lo = GlslMod(c.param1 + twoPi, twoPi);
+    float hi = GlslMod(c.param2 + twoPi, twoPi);
+
+    bool outside = (lo <= hi) ? (current < lo || current > hi) : (current < lo && current > hi);
+    if (!outside) return;
+
+    float corrected = (std::fabs(current - lo) < std::fabs(current - hi)) ? lo : hi;
+    px = originX + std::cos(corrected) * radius;
+    py = originY + std::sin(corrected) * radius;
+
+    float rx = px - originX, ry = py - originY;
+    float len = Length(rx, ry);
+    rx /= len;
+    ry /= len;
+    float tx = -ry, ty = rx;
+    float along = vx * tx + vy * ty;
+    vx = tx * along * 0.9f;
+    vy = ty * along * 0.9f;
+}
+
+static void SolveConstraints(const Scene& scene, const ObjectArrays& source, ObjectArrays& state)
+{
+    const int n = static_cast<int>(state.Size());
+    CpuBackend::ParallelFor(n, 256, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            const std::vector<Constraint>& constraints = scene.constraints[i];
+            if (constraints.empty()) continue;
+
+            float px = state.x[i], py = state.y[i], vx = state.vx[i], vy = state.vy[i];
+            for (int iter = 0; iter < MAX_CONSTRAINT_ITERATIONS; iter++)
+            {
+                for (const Constraint& c : constraints)
+                {
+                    if (c.type == CONSTRAINT_DISTANCE) SolveDistanceConstraint(px, py, vx, vy, c, i, source);
+                    else if (c.type == CONSTRAINT_BOUNDARY) SolveBoundaryConstraint(px, py, vx, vy, c);
+                    else if (c.type == CONSTRAINT_ANGLE) SolveAngleConstraint(px, py, vx, vy, c, source.x[i], source.y[i]);
+                }
+            }
+
+            vx = Sanitize(vx);
+            vy = Sanitize(vy);
+            ClampSpeed(vx, vy);
+            state.x[i] = Sanitize(px);
+            state.y[i] = Sanitize(py);
+            state.vx[i] = vx;
+            state.vy[i] = vy;
+        }
+    });
+}
+
+// ============================================================================
+// COLLISIONS (collide.comp with the uniform grid broadphase)
+// ============================================================================
+struct ContactInfo
+{
+    float nx, ny;
+    float penetration;
+};
+
+static bool DetectCircleCircle(float ax, float ay, float ra, float bx, float by, float rb, ContactInfo& info)
+{
+    float dx = bx - ax, dy = by - ay;
+    float distSq = dx * dx + dy * dy;
+    float radiusSum = ra + rb;
+    if (!(distSq < radiusSum * radiusSum && distSq > EPSILON)) return false;
+    float dist = std::sqrt(distSq);
+    info = { dx / dist, dy / dist, radiusSum - dist };
+    return true;
+}
+
+static bool DetectAABBAABB(float ax, float ay, float hax, float hay, float bx, float by, float hbx, float hby, ContactInfo& info)
+{
+    float dx = bx - ax, dy = by - ay;
+    float ox = hax + hbx - std::fabs(dx);
+    float oy = hay + hby - std::fabs(dy);
+    if (!(ox > 0.0f && oy > 0.0f)) return false;
+    if (ox < oy) info = { SignFunc(dx), 0.0f, ox };
+    else info = { 0.0f, SignFunc(dy), oy };
+    return true;
+}
+
+static bool DetectCircleAABB(float cx, float cy, float radius, float bx, float by, float hx, float hy, ContactInfo& info)
+{
+    float closestX = Clamp(cx, bx - hx, bx + hx);
+    float closestY = Clamp(cy, by - hy, by + hy);
+    float dx = cx - closestX, dy = cy - closestY;
+    float distSq = dx * dx + dy * dy;
+    if (!(distSq < radius * radius)) return false;
+
+    float dist = std::sqrt(distSq);
+    if (dist > EPSILON)
+    {
+        info = { dx / dist, dy / dist, radius - dist };
+        return true;
+    }
+    float tx = bx - cx, ty = by - cy;
+    float edgeX = hx - std::fabs(tx), edgeY = hy - std::fabs(ty);
+    if (edgeX < edgeY) info = { SignFunc(tx), 0.0f, radius + edgeX };
+    else info = { 0.0f, SignFunc(ty), radius + edgeY };
+    return true;
+}
+
+// detectCollision() for the circle and box shapes; polygons do not collide on the CPU
+static bool DetectCollision(const Scene& scene, const ObjectArrays& s, int a, int b, ContactInfo& info)
+{
+    const CollisionProperties& pa = scene.collision[a];
+    const CollisionProperties& pb = scene.collision[b];
+    if (pa.enabled == 0 || pb.enabled == 0) return false;
+    if ((pa.category & pb.mask) == 0u || (pb.category & pa.mask) == 0u) return false;
+    if (pa.shapeType == COLLISION_NONE || pb.shapeType == COLLISION_NONE) return false;
+
+    if (pa.shapeType == COLLISION_CIRCLE && pb.shapeType == COLLISION_CIRCLE)
+        return DetectCircleCircle(s.x[a], s.y[a], s.width[a], s.x[b], s.y[b], s.width[b], info);
+    if (pa.shapeType == COLLISION_AABB && pb.shapeType == COLLISION_AABB)
+        return DetectAABBAABB(s.x[a], s.y[a], s.width[a] * 0.5f, s.height[a] * 0.5f,
+                              s.x[b], s.y[b], s.width[b] * 0.5f, s.height[b] * 0.5f, info);
+    if (pa.shapeType == COLLISION_CIRCLE && pb.shapeType == COLLISION_AABB)
+        return DetectCircleAABB(s.x[a], s.y[a], s.width[a], s.x[b], s.y[b], s.width[b] * 0.5f, s.height[b] * 0.5f, info);
+    if (pa.shapeType == COLLISION_AABB && pb.shapeType == COLLISION_CIRCLE)
+    {
+        if (!DetectCircleAABB(s.x[b], s.y[b], s.width[b], s.x[a], s.y[a], s.width[a] * 0.5f, s.height[a] * 0.5f, info))
+            return false;
+        info.nx = -info.nx;
+        info.ny = -info.ny;
+        return true;
+    }
+    return false;
+}
+
+// collideWithObject(): impulse and position correction of object i against j, i only
+static void CollideWithObject(const Scene& scene, const ObjectArrays& s, int i, int j, float massA,
+                              float& cvx, float& cvy, float& newX, float& newY, bool& hadCollision)
+{
+    ContactInfo contact;
+    if (!DetectCollision(scene, s, i, j, contact)) return;
+    hadCollision = true;
+
+    const CollisionProperties& pa = scene.collision[i];
+    const CollisionProperties& pb = scene.collision[j];
+    float restitution = std::min(pa.restitution, pb.restitution);
+    float friction = std::sqrt(pa.friction * pb.friction);
+    float massB = std::max(EPSILON, s.mass[j]);
+
+    float rvx = s.vx[j] - cvx;
+    float rvy = s.vy[j] - cvy;
+    float vn = rvx * contact.nx + rvy * contact.ny;
+    if (vn < 0.0f)
+    {
+        float e = Clamp(restitution, 0.0f, 1.0f);
+        float impulse = -(1.0f + e) * vn / (1.0f / massA + 1.0f / massB);
+        cvx -= impulse * contact.nx / massA;
+        cvy -= impulse * contact.ny / massA;
+
+        if (friction > 0.0f)
+        {
+            float tx = rvx - contact.nx * vn;
+            float ty = rvy - contact.ny * vn;
+            float tangentLength = Length(tx, ty);
+            if (tangentLength > EPSILON)
+            {
+                tx /= tangentLength;
+                ty /= tangentLength;
+                float vt = rvx * tx + rvy * ty;
+                float jt = -vt * friction / (1.0f / massA + 1.0f / massB);
+                float maxFriction = std::fabs(impulse) * friction;
+                jt = Clamp(jt, -maxFriction, maxFriction);
+                cvx -= jt * tx / massA;
+                cvy -= jt * ty / massA;
+            }
+        }
+    }
+
+    const float slop = 0.01f;
+    const float percent = 0.4f;
+    if (contact.penetration > slop)
+    {
+        float weight = massB / (massA + massB);
+        newX -= contact.nx * (contact.penetration - slop) * percent * weight;
+        newY -= contact.ny * (contact.penetration - slop) * percent * weight;
+    }
+}
+
+static void Collide(const Scene& scene, const ObjectArrays& in, ObjectArrays& out)
+{
+    const int n = static_cast<int>(in.Size());
+    std::vector<char> collidable(n);
+    float maxRadius = 0.0f;
+    for (int i = 0; i < n; i++)
+    {
+        const CollisionProperties& props = scene.collision[i];
+        collidable[i] = props.enabled != 0 && props.shapeType != COLLISION_NONE;
+        if (!collidable[i]) continue;
+        float radius = (props.shapeType == COLLISION_AABB) ? 0.5f * Length(in.width[i], in.height[i]) : std::fabs(in.width[i]);
+        maxRadius = std::max(maxRadius, radius);
+    }
+
+    HashGrid grid;
+    BuildGrid(grid, in, &collidable, std::max(2.0f * maxRadius, 1e-3f));
+    out = in;
+
+    CpuBackend::ParallelFor(n, 128, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            float newX = in.x[i], newY = in.y[i];
+            float vx = in.vx[i], vy = in.vy[i];
+            if (collidable[i])
+            {
+                float mass = std::max(EPSILON, in.mass[i]);
+                float cvx = vx, cvy = vy;
+                bool hadCollision = false;
+                VisitNeighbourCells(grid, in.x[i], in.y[i], [&](int j)
+                {
+                    if (j != i) CollideWithObject(scene, in, i, j, mass, cvx, cvy, newX, newY, hadCollision);
+                });
+                if (hadCollision)
+                {
+                    vx = Sanitize(cvx);
+                    vy = Sanitize(cvy);
+                }
+            }
+            vx = Sanitize(vx);
+            vy = Sanitize(vy);
+            ClampSpeed(vx, vy);
+            out.x[i] = Sanitize(newX);
+            out.y[i] = Sanitize(newY);
+            out.vx[i] = vx;
+            out.vy[i] = vy;
+        }
+    });
+}
+
+// ============================================================================
+// EQUATIONS
+// ============================================================================
+
+// MUST MATCH ReadsOtherObjects() / ReadsLongRangeAccel() / ReadsFluidState() in objects.cpp: either one makes the
+// GPU run integrator stages as separate passes
+static bool ComponentReadsOtherObjects(const std::vector<int>& tokens)
+{
+    size_t i = 0;
+    while (i < tokens.size())
+    {
+        int token = tokens[i++];
+        if (token == GPUTokens::TOKEN_OBJECT_REF || token == GPUTokens::TOKEN_PAIR_SUM) return true;
+        if (token == GPUTokens::TOKEN_VARIABLE && i < tokens.size() &&
+            ((tokens[i] >= VAR_HASH_GRAV_AX && tokens[i] <= VAR_HASH_COUL_AY) ||
+             (tokens[i] >= VAR_HASH_SPH_AX && tokens[i] <= VAR_HASH_SPH_P))) return true;
+        if (token == GPUTokens::TOKEN_NUMBER || token == GPUTokens::TOKEN_VARIABLE ||
+            token == GPUTokens::TOKEN_TEMP_STORE || token == GPUTokens::TOKEN_TEMP_LOAD ||
+            token == GPUTokens::TOKEN_BRANCH || token == GPUTokens::TOKEN_JUMP) i += 1;
+        else if (token == GPUTokens::TOKEN_PRELUDE) i += 2;
+        else if (token == GPUTokens::TOKEN_DERIVATIVE) i += 4;  // Header only; the body is scanned inline
+    }
+    return false;
+}
+
+// RegisterPairSums() of objects.cpp against the set's own tables
+static void RegisterPairSums(EquationSet& equations, int eqID, const std::vector<int>& tokens,
+                             const std::vector<float>& constants, int tokenOffset, int constantOffset)
+{
+    size_t i = 0;
+    while (i < tokens.size())
+    {
+        int token = tokens[i++];
+        if (token == GPUTokens::TOKEN_NUMBER || token == GPUTokens::TOKEN_VARIABLE ||
+            token == GPUTokens::TOKEN_TEMP_STORE || token == GPUTokens::TOKEN_TEMP_LOAD ||
+            token == GPUTokens::TOKEN_BRANCH || token == GPUTokens::TOKEN_JUMP) i += 1;
+        else if (token == GPUTokens::TOKEN_OBJECT_REF || token == GPUTokens::TOKEN_PRELUDE) i += 2;
+        else if (token == GPUTokens::TOKEN_DERIVATIVE)
+            i += (i + 3 < tokens.size()) ? 4 + tokens[i + 3] : tokens.size();
+        else if (token == GPUTokens::TOKEN_PAIR_SUM && i + 3 < tokens.size())
+        {
+            int slot = tokens[i];
+            int radiusIndex = tokens[i + 2];
+            int bodyCount = tokens[i + 3];
+            if (slot >= 0 && slot < MAX_PAIR_SUMS_PER_EQUATION)
+            {
+                PairSumExpression& expr = equations.pairSums[eqID * MAX_PAIR_SUMS_PER_EQUATION + slot];
+                expr.tokenOffset = tokenOffset + static_cast<int>(i) + 4;
+                expr.tokenCount = bodyCount;
+                expr.constantOffset = constantOffset;
+                expr.reduction = tokens[i + 1];
+                expr.radius = 0.0f;
+                expr.used = 1;
+                if (radiusIndex >= 0 && radiusIndex < static_cast<int>(constants.size()))
+                {
+                    expr.radius = constants[radiusIndex];
+                    equations.maxNeighbourRadius = std::max(equations.maxNeighbourRadius, expr.radius);
+                }
+                equations.usesPairSums = true;
+            }
+            i += 4 + bodyCount;
+        }
+    }
+}
+
+int CpuBackend::AddEquation(EquationSet& equations, const std::string& key, const ParsedEquation& equation)
+{
+    auto it = equations.ids.find(key);
+    if (it != equations.ids.end()) return it->second;
+
+    GPUSerializedEquation gpu = serializeEquationForGPU(equation);
+    const std::vector<int>* tokenBuffers[] = {
+        &gpu.tokenBuffer_ax, &gpu.tokenBuffer_ay, &gpu.tokenBuffer_angular, &gpu.tokenBuffer_r,
+        &gpu.tokenBuffer_g, &gpu.tokenBuffer_b, &gpu.tokenBuffer_a };
+    const std::vector<float>* constantBuffers[] = {
+        &gpu.constantBuffer_ax, &gpu.constantBuffer_ay, &gpu.constantBuffer_angular, &gpu.constantBuffer_r,
+        &gpu.constantBuffer_g, &gpu.constantBuffer_b, &gpu.constantBuffer_a };
+
+    int id = static_cast<int>(equations.mappings.size());
+    equations.pairSums.resize(static_cast<size_t>(id + 1) * MAX_PAIR_SUMS_PER_EQUATION, PairSumExpression{});
+
+    // Components back to back, like AddOrGetEquation() lays out an equation's range
+    EquationMapping mapping{};
+    int* fields = &mapping.tokenOffset_ax;
+    for (int c = 0; c < 7; c++)
+    {
+        int tokenOffset = static_cast<int>(equations.tokens.size());
+        int constantOffset = static_cast<int>(equations.constants.size());
+        fields[c * 4] = tokenOffset;
+        fields[c * 4 + 1] = static_cast<int>(tokenBuffers[c]->size());
+        fields[c * 4 + 2] = constantOffset;
+        fields[c * 4 + 3] = -1;
+
+        RegisterPairSums(equations, id, *tokenBuffers[c], *constantBuffers[c], tokenOffset, constantOffset);
+        equations.readsOtherObjects = equations.readsOtherObjects || ComponentReadsOtherObjects(*tokenBuffers[c]);
+        equations.tokens.insert(equations.tokens.end(), tokenBuffers[c]->begin(), tokenBuffers[c]->end());
+        equations.constants.insert(equations.constants.end(), constantBuffers[c]->begin(), constantBuffers[c]->end());
+    }
+
+    equations.mappings.push_back(mapping);
+    equations.ids[key] = id;
+    return id;
+}
+
+EquationSet CpuBackend::CreateEquationSet()
+{
+    EquationSet equations;
+    ParserContext context;
+    ParsedEquation defaultEq = ParseEquation("vx, vy, -k*x/mass, -k*y/mass, 0, 1, 0, 0, 1", context);
+    AddEquation(equations, "default_zero", defaultEq);
+    return equations;
+}
+
+// ============================================================================
+// SCENES
+// ============================================================================
+void CpuBackend::ObjectArrays::Resize(size_t count)
+{
+    std::vector<float>* fields[] = { &x, &y, &vx, &vy, &ax, &ay, &rotation, &angularVelocity,
+                                     &r, &g, &b, &a, &mass, &charge, &width, &height };
+    for (std::vector<float>* field : fields) field->resize(count, 0.0f);
+    equation.resize(count, 0);
+}
+
+void CpuBackend::Load(Scene& scene, const std::vector<Object>& objects)
+{
+    const size_t n = objects.size();
+    scene.objects = objects;
+    scene.state.Resize(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        const Object& o = objects[i];
+        ObjectArrays& s = scene.state;
+        s.x[i] = o.position.x;
+        s.y[i] = o.position.y;
+        s.vx[i] = o.velocity.x;
+        s.vy[i] = o.velocity.y;
+        s.ax[i] = o.collisionData.x;
+        s.ay[i] = o.collisionData.y;
+        s.rotation[i] = o.visualData.z;
+        s.angularVelocity[i] = o.visualData.w;
+        s.r[i] = o.color.r;
+        s.g[i] = o.color.g;
+        s.b[i] = o.color.b;
+        s.a[i] = o.color.a;
+        s.mass[i] = o.mass;
+        s.charge[i] = o.charge;
+        s.width[i] = o.visualData.x;
+        s.height[i] = o.visualData.y;
+        s.equation[i] = o.equationID;
+    }
+
+    CollisionProperties defaults{};
+    defaults.enabled = 1;
+    defaults.shapeType = COLLISION_NONE;
+    defaults.restitution = 0.7f;
+    defaults.friction = 0.3f;
+    defaults.mass_factor = 1.0f;
+    defaults.category = COLLISION_CATEGORY_DEFAULT;
+    defaults.mask = COLLISION_MASK_ALL;
+    scene.collision.assign(n, defaults);
+    scene.constraints.assign(n, std::vector<Constraint>());
+    scene.objectParams.clear();
+    scene.handleSlots.clear();
+    scene.pairSumValues.clear();
+    scene.integratorScratch.clear();
+
+    // Blocks of at most CPU_LANES objects running the same equation
+    scene.order.resize(n);
+    std::iota(scene.order.begin(), scene.order.end(), 0);
+    std::stable_sort(scene.order.begin(), scene.order.end(),
+                     [&](int a, int b) { return scene.state.equation[a] < scene.state.equation[b]; });
+    scene.blocks.clear();
+    for (size_t k = 0; k < n; k++)
+    {
+        bool newEquation = k == 0 || scene.state.equation[scene.order[k]] != scene.state.equation[scene.order[k - 1]];
+        if (newEquation || static_cast<int>(k) - scene.blocks.back() == CPU_LANES)
+            scene.blocks.push_back(static_cast<int>(k));
+    }
+    scene.blocks.push_back(static_cast<int>(n));
+}
+
+std::vector<Object> CpuBackend::Store(const Scene& scene)
+{
+    std::vector<Object> objects = scene.objects;
+    const ObjectArrays& s = scene.state;
+    for (size_t i = 0; i < objects.size() && i < s.Size(); i++)
+    {
+        Object& o = objects[i];
+        o.position = glm::vec2(s.x[i], s.y[i]);
+        o.velocity = glm::vec2(s.vx[i], s.vy[i]);
+        o.mass = s.mass[i];
+        o.charge = s.charge[i];
+        o.visualData.z = s.rotation[i];
+        o.visualData.w = s.angularVelocity[i];
+        o.collisionData.x = s.ax[i];
+        o.collisionData.y = s.ay[i];
+        o.color = glm::vec4(s.r[i], s.g[i], s.b[i], s.a[i]);
+    }
+    return objects;
+}
+
+// ============================================================================
+// STEP: the passes of Objects::Update() for one fixed step
+// ============================================================================
+void CpuBackend::Step(Scene& scene, const EquationSet& equations)
+{
+    const int n = static_cast<int>(scene.state.Size());
+    if (n == 0) return;
+
+    const int stageCount = IntegratorStageCount(scene.integrator);
+    const bool staged = stageCount > 1 && equations.readsOtherObjects;
+    const int passes = staged ? stageCount : 1;
+    if (staged) scene.integratorScratch.resize(static_cast<size_t>(n) * SCRATCH_FLOATS);
+
+    bool anyConstraints = false;
+    bool anyCollidable = false;
+    for (int i = 0; i < n; i++)
+    {
+        anyConstraints = anyConstraints || !scene.constraints[i].empty();
+        anyCollidable = anyCollidable || (scene.collision[i].enabled != 0 && scene.collision[i].shapeType != COLLISION_NONE);
+    }
+
+    // Stages ping-pong through stages[]; the last pass writes integrated
+    const ObjectArrays* input = &scene.state;
+    HashGrid neighbourGrid;
+    for (int pass = 0; pass < passes; pass++)
+    {
+        input = (pass == 0) ? &scene.state : &scene.stages[(pass - 1) % 2];
+        ObjectArrays& output = (pass == passes - 1) ? scene.integrated : scene.stages[pass % 2];
+        output.Resize(n);
+
+        PassContext ctx = { &equations, input, &scene.objectParams, &scene.handleSlots, &scene.pairSumValues, &scene.params, n };
+        if (equations.usesPairSums)
+        {
+            bool useGrid = equations.maxNeighbourRadius > 0.0f;
+            if (useGrid) BuildGrid(neighbourGrid, *input, nullptr, equations.maxNeighbourRadius);
+            ComputePairSums(scene, ctx, useGrid ? &neighbourGrid : nullptr);
+        }
+        IntegratePass(scene, ctx, output, staged ? pass : -1);
+    }
+
+    if (anyConstraints) SolveConstraints(scene, *input, scene.integrated);
+    if (anyCollidable) Collide(scene, scene.integrated, scene.state);
+    else std::swap(scene.state, scene.integrated);
+}
+
+// ============================================================================
+// WORK-STEALING THREAD POOL
+// ============================================================================
+
+// Items a participant has yet to run: the owner takes chunks from the front, thieves the back half
+struct alignas(64) WorkRange
+{
+    std::mutex lock;
+    int begin = 0;
+    int end = 0;
+};
+
+static int g_threadCount = 0;                 // Requested, 0 = one per hardware thread
+static int g_participants = 1;                // Workers plus the calling thread
+static std::vector<std::thread> g_workers;
+static std::unique_ptr<WorkRange[]> g_ranges; // One per worker, the caller's last
+static std::mutex g_submitMutex;              // One ParallelFor() on the pool at a time
+static std::mutex g_poolMutex;
+static std::condition_variable g_poolWake;
+static std::condition_variable g_poolDone;
+static const std::function<void(int, int)>* g_job = nullptr;
+static int g_jobGrain = 1;
+static unsigned long long g_jobGeneration = 0;
+static int g_busyWorkers = 0;
+static bool g_stopping = false;
+static thread_local bool t_insidePool = false;
+
+static bool TakeChunk(WorkRange& range, int grain, int& begin, int& end)
+{
+    std::lock_guard<std::mutex> guard(range.lock);
+    if (range.begin >= range.end) return false;
+    begin = range.begin;
+    end = std::min(range.end, begin + grain);
+    range.begin = end;
+    return true;
+}
+
+// Move the back half of the fullest other range into self's
+static bool StealWork(int self)
+{
+    for (;;)
+    {
+        int victim = -1;
+        int most = 0;
+        for (int p = 0; p < g_participants; p++)
+        {
+            if (p == self) continue;
+            std::lock_guard<std::mutex> guard(g_ranges[p].lock);
+            int remaining = g_ranges[p].end - g_ranges[p].begin;
+            if (remaining > most)
+            {
+                most = remaining;
+                victim = p;
+            }
+        }
+        if (victim < 0) return false;
+
+        int begin, end;
+        {
+            std::lock_guard<std::mutex> guard(g_ranges[victim].lock);
+            int remaining = g_ranges[victim].end - g_ranges[victim].begin;
+            if (remaining <= 0) continue;  // Drained since the scan
+            end = g_ranges[victim].end;
+            begin = end - (remaining + 1) / 2;
+            g_ranges[victim].end = begin;
+        }
+        std::lock_guard<std::mutex> guard(g_ranges[self].lock);
+        g_ranges[self].begin = begin;
+        g_ranges[self].end = end;
+        return true;
+    }
+}
+
+static void RunParticipant(int self, const std::function<void(int, int)>& body, int grain)
+{
+    int begin, end;
+    for (;;)
+    {
+        if (TakeChunk(g_ranges[self], grain, begin, end)) body(begin, end);
+        else if (!StealWork(self)) return;
+    }
+}
+
+static void WorkerMain(int self)
+{
+    t_insidePool = true;
+    unsigned long long seen = 0;
+    for (;;)
+    {
+        const std::function<void(int, int)>* job;
+        int grain;
+        {
+            std::unique_lock<std::mutex> lock(g_poolMutex);
+            g_poolWake.wait(lock, [&] { return g_stopping || g_jobGeneration != seen; });
+            if (g_stopping) return;
+            seen = g_jobGeneration;
+            job = g_job;
+            grain = g_jobGrain;
+        }
+
+        RunParticipant(self, *job, grain);
+
+        std::lock_guard<std::mutex> lock(g_poolMutex);
+        if (--g_busyWorkers == 0) g_poolDone.notify_all();
+    }
+}
+
+static void StartWorkers()
+{
+    g_participants = CpuBackend::GetThreadCount();
+    g_ranges.reset(new WorkRange[g_participants]);
+    for (int i = 0; i < g_participants - 1; i++) g_workers.emplace_back(WorkerMain, i);
+}
+
+static void StopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(g_poolMutex);
+        g_stopping = true;
+    }
+    g_poolWake.notify_all();
+    for (std::thread& worker : g_workers) worker.join();
+    g_workers.clear();
+    g_participants = 1;
+    std::lock_guard<std::mutex> lock(g_poolMutex);
+    g_stopping = false;
+}
+
+// Workers still running at exit are joined before the statics they use go away
+static struct PoolShutdown
+{
+    ~PoolShutdown() { StopWorkers(); }
+} g_poolShutdown;
+
+void CpuBackend::ParallelFor(int count, int grain, const std::function<void(int, int)>& body)
+{
+    if (count <= 0) return;
+    grain = std::max(grain, 1);
+    if (t_insidePool || count <= grain)
+    {
+        body(0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit(g_submitMutex);
+    if (g_workers.empty() && GetThreadCount() > 1) StartWorkers();
+    if (g_workers.empty())
+    {
+        body(0, count);
+        return;
+    }
+
+    for (int p = 0; p < g_participants; p++)
+    {
+        std::lock_guard<std::mutex> guard(g_ranges[p].lock);
+        g_ranges[p].begin = static_cast<int>(static_cast<long long>(count) * p / g_participants);
+        g_ranges[p].end = static_cast<int>(static_cast<long long>(count) * (p + 1) / g_participants);
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_poolMutex);
+        g_job = &body;
+        g_jobGrain = grain;
+        g_busyWorkers = static_cast<int>(g_workers.size());
+        g_jobGeneration++;
+    }
+    g_poolWake.notify_all();
+
+    t_insidePool = true;
+    RunParticipant(g_participants - 1, body, grain);
+    t_insidePool = false;
+
+    std::unique_lock<std::mutex> lock(g_poolMutex);
+    g_poolDone.wait(lock, [] { return g_busyWorkers == 0; });
+    g_job = nullptr;
+}
+
+void CpuBackend::SetThreadCount(int threads)
+{
+    std::lock_guard<std::mutex> submit(g_submitMutex);
+    threads = std::max(threads, 0);
+    if (threads == g_threadCount) return;
+    StopWorkers();
+    g_threadCount = threads;
+}
+
+int CpuBackend::GetThreadCount()
+{
+    if (g_threadCount > 0) return g_threadCount;
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+void CpuBackend::Cleanup()
+{
+    std::lock_guard<std::mutex> submit(g_submitMutex);
+    StopWorkers();
+}
@@ -87,6 +87,21 @@ const char* GetTokenTypeName(TokenType type) {
         case TOKEN_CLOSE_PAREN: return "CLOSE_PAREN";
         case TOKEN_COMMA: return "COMMA";
         case TOKEN_DERIVATIVE: return "DERIVATIVE";
+        case TOKEN_TEMP_STORE: return "TEMP_STORE";
+        case TOKEN_TEMP_LOAD: return "TEMP_LOAD";
+        case TOKEN_TABLE: return "TABLE";
+        case TOKEN_FIELD: return "FIELD";
+        case TOKEN_IF: return "IF";
+        case TOKEN_LEN2: return "LEN2";
+        case TOKEN_DOT2: return "DOT2";
+        case TOKEN_HYPOT: return "HYPOT";
+        case TOKEN_INVCUBE: return "INVCUBE";
+        case TOKEN_RSQRT: return "RSQRT";
+        case TOKEN_HOIST: return "HOIST";
+        case TOKEN_BINDING: return "BINDING";
+        case TOKEN_VEC2: return "VEC2";
+        case TOKEN_LEN: return "LEN";
+        case TOKEN_DOT: return "DOT";
         default: return "UNKNOWN_TYPE";
     }
 }
@@ -108,15 +123,24 @@ void DebugPrintParsedEquation(const std::string& name,
                 break;
                 
             case TOKEN_VARIABLE:
-                std::cout << " '" << token.variable_name << "'";
+                std::cout << " '" << symbolName(token.variable) << "'";
                 break;
                 
             case TOKEN_OBJECT_REF:
-                std::cout << " p[" << token.object_index << "]." << token.object_property;
+                std::cout << " p[" << token.object_index << "]." << symbolName(token.object_property);
                 break;
                 
             case TOKEN_DERIVATIVE:
-                std::cout << " D(expr, " << token.derivative_wrt << ", " << token.derivative_order << ")";
+                std::cout << " D(expr, " << symbolName(token.derivative_wrt) << ", " << token.derivative_order << ")";
+                break;
+                
+            case TOKEN_TEMP_STORE:
+            case TOKEN_TEMP_LOAD:
+                std::cout << " t" << token.temp_slot;
+                break;
+
+            case TOKEN_HOIST:
+                std::cout << " prelude" << token.temp_slot;
                 break;
                 
             default:
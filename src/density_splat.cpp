@@ -0,0 +1,209 @@
+#include "density_splat.h"
+#include "async_shader_loader.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+
+// Accumulation target, recreated when the viewport changes size
+static GLuint g_accumTexture = 0;
+static GLuint g_accumFBO = 0;
+static GLuint g_vao = 0;  // No attributes, the shaders work from gl_VertexID
+static int g_width = 0, g_height = 0;
+
+static float g_exposure = 8.0f;
+
+// Async shader loading: points into the target, target onto the screen
+static GLuint g_splatProgram = 0, g_resolveProgram = 0;
+static AsyncShaderLoader g_splatLoader, g_resolveLoader;
+static bool g_splatReady = false, g_resolveReady = false;
+static GLint g_projViewLoc = -1;
+static GLint g_accumTextureLoc = -1, g_exposureLoc = -1;
+
+// ============================================================================
+// Start loading the shaders; the target follows the viewport size
+// ============================================================================
+bool DensitySplat::Init()
+{
+    if (g_vao == 0) glGenVertexArrays(1, &g_vao);
+
+    if (g_splatProgram == 0)
+    {
+        g_splatLoader.LoadGraphicsShaderAsync(
+            "density_splat.vert",
+            "density_splat.frag",
+            "",
+            [](GLuint program)
+            {
+                g_splatProgram = program;
+                g_projViewLoc = glGetUniformLocation(program, "uProjView");
+                g_splatReady = (g_projViewLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[DensitySplat] density_splat shaders FAILED: " << error << std::endl;
+                g_splatReady = false;
+            });
+    }
+    if (g_resolveProgram == 0)
+    {
+        g_resolveLoader.LoadGraphicsShaderAsync(
+            "phase_quad.vert",
+            "density_resolve.frag",
+            "",
+            [](GLuint program)
+            {
+                g_resolveProgram = program;
+                g_accumTextureLoc = glGetUniformLocation(program, "uAccum");
+                g_exposureLoc = glGetUniformLocation(program, "uExposure");
+                g_resolveReady = (g_exposureLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[DensitySplat] density_resolve shaders FAILED: " << error << std::endl;
+                g_resolveReady = false;
+            });
+    }
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[DensitySplat] Failed to create the vertex array (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// RGBA32F target of width x height; false if it cannot be made
+static bool EnsureAccumTarget(int width, int height)
+{
+    if (g_accumTexture != 0 && width == g_width && height == g_height) return true;
+
+    if (g_accumTexture == 0) glGenTextures(1, &g_accumTexture);
+    glBindTexture(GL_TEXTURE_2D, g_accumTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (g_accumFBO == 0) glGenFramebuffers(1, &g_accumFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, g_accumFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, g_accumTexture, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    g_width = width;
+    g_height = height;
+    if (!complete) std::cerr << "[DensitySplat] Accumulation framebuffer incomplete" << std::endl;
+    return complete;
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+void DensitySplat::SetExposure(float exposure)
+{
+    if (exposure > 0.0f) g_exposure = exposure;
+}
+
+float DensitySplat::GetExposure()
+{
+    return g_exposure;
+}
+
+// ============================================================================
+// Accumulate, display
+// ============================================================================
+void DensitySplat::Draw(GLuint objectSSBO, int numObjects, const glm::mat4& projView)
+{
+    if (!IsReady() || numObjects <= 0) return;
+
+    GLint target = 0, viewport[4] = { 0, 0, 0, 0 };
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &target);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    int width = viewport[2], height = viewport[3];
+    if (width <= 0 || height <= 0) return;
+
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLint blendSrc = 0, blendDst = 0;
+    glGetIntegerv(GL_BLEND_SRC_RGB, &blendSrc);
+    glGetIntegerv(GL_BLEND_DST_RGB, &blendDst);
+    if (!EnsureAccumTarget(width, height))
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(target));
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, g_accumFBO);
+    glViewport(0, 0, width, height);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBindVertexArray(g_vao);
+    glEnable(GL_BLEND);
+
+    glUseProgram(g_splatProgram);
+    glUniformMatrix4fv(g_projViewLoc, 1, GL_FALSE, glm::value_ptr(projView));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DENSITY_SPLAT_OBJECTS_BINDING, objectSSBO);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glDrawArrays(GL_POINTS, 0, numObjects);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DENSITY_SPLAT_OBJECTS_BINDING, 0);
+
+    // Back into the caller's framebuffer, blended over what is already there
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(target));
+    glViewport(viewport[0], viewport[1], width, height);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUseProgram(g_resolveProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, g_accumTexture);
+    if (g_accumTextureLoc != -1) glUniform1i(g_accumTextureLoc, 0);
+    glUniform1f(g_exposureLoc, g_exposure);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glBlendFunc(static_cast<GLenum>(blendSrc), static_cast<GLenum>(blendDst));
+    if (!blend) glDisable(GL_BLEND);
+}
+
+// ============================================================================
+// Release the target and programs
+// ============================================================================
+void DensitySplat::Cleanup()
+{
+    GLuint* programs[] = { &g_splatProgram, &g_resolveProgram };
+    for (GLuint* program : programs)
+    {
+        if (*program) glDeleteProgram(*program);
+        *program = 0;
+    }
+    g_splatReady = g_resolveReady = false;
+
+    if (g_accumFBO) glDeleteFramebuffers(1, &g_accumFBO);
+    if (g_accumTexture) glDeleteTextures(1, &g_accumTexture);
+    if (g_vao) glDeleteVertexArrays(1, &g_vao);
+    g_accumFBO = 0;
+    g_accumTexture = 0;
+    g_vao = 0;
+    g_width = g_height = 0;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void DensitySplat::UpdateShaderLoadingStatus()
+{
+    g_splatLoader.Update();
+    g_resolveLoader.Update();
+}
+
+bool DensitySplat::IsReady()
+{
+    return g_splatReady && g_resolveReady;
+}
+
+std::string DensitySplat::GetShaderLoadStatusMessage()
+{
+    if (!g_splatReady) return "[density splat] " + g_splatLoader.GetStatusMessage();
+    if (!g_resolveReady) return "[density splat] " + g_resolveLoader.GetStatusMessage();
+    return "Density splat shaders ready";
+}
@@ -0,0 +1,207 @@
+#include "dispatch_order.h"
+#include "broadphase.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+
+// Build passes - MUST MATCH dispatch_order.comp
+enum DispatchOrderPass
+{
+    ORDER_PASS_CLEAR_BOUNDS = 0,
+    ORDER_PASS_BOUNDS = 1,
+    ORDER_PASS_KEYS = 2,
+    ORDER_PASS_RADIX_HISTOGRAM = 3,
+    ORDER_PASS_RADIX_SCAN = 4,
+    ORDER_PASS_RADIX_SCATTER = 5,
+    ORDER_PASS_WRITE_ORDER = 6
+};
+
+static const GLuint ORDER_WORK_GROUP_SIZE = 256;
+static const int RADIX_BITS_PER_PASS = 4;
+static const int RADIX_DIGITS = 1 << RADIX_BITS_PER_PASS;
+
+// Buffers (the sort scratch uses the broadphase sort binding points)
+static GLuint g_orderSSBO = 0;           // Object index per math.comp invocation
+static GLuint g_sortSSBO[2] = { 0, 0 };  // Radix sort ping-pong (sort key, object index)
+static GLuint g_radixHistogramSSBO = 0;  // Digit-major per-block histogram
+static GLuint g_sceneBoundsSSBO = 0;     // Scene AABB of object positions
+static int g_maxObjects = 0;
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_passLoc = -1;
+static GLint g_numObjectsLoc = -1;
+static GLint g_radixShiftLoc = -1;
+static GLint g_numBlocksLoc = -1;
+
+// Create an SSBO of the given size if it does not exist yet
+static void EnsureBuffer(GLuint& buffer, GLsizeiptr size)
+{
+    BufferHelpers::EnsureBufferCapacity(buffer, size);
+}
+
+static GLuint NumBlocks(GLuint numItems)
+{
+    return (std::max(numItems, 1u) + ORDER_WORK_GROUP_SIZE - 1) / ORDER_WORK_GROUP_SIZE;
+}
+
+// Run a single build pass over the given number of items
+static void DispatchPass(int pass, GLuint numItems)
+{
+    glUniform1i(g_passLoc, pass);
+    glDispatchCompute(NumBlocks(numItems), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// ============================================================================
+// Initialize buffers and start loading the build shader
+// ============================================================================
+bool DispatchOrder::Init(int maxObjects)
+{
+    if (!Reserve(maxObjects)) return false;
+
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "dispatch_order.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_passLoc = glGetUniformLocation(program, "uPass");
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_radixShiftLoc = glGetUniformLocation(program, "uRadixShift");
+                g_numBlocksLoc = glGetUniformLocation(program, "uNumBlocks");
+                g_ready = (g_passLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[DispatchOrder] dispatch_order.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+bool DispatchOrder::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+    GLsizeiptr objects = static_cast<GLsizeiptr>(maxObjects);
+
+    EnsureBuffer(g_orderSSBO, objects * sizeof(GLuint));
+    EnsureBuffer(g_sortSSBO[0], objects * 2 * sizeof(GLuint));
+    EnsureBuffer(g_sortSSBO[1], objects * 2 * sizeof(GLuint));
+    EnsureBuffer(g_radixHistogramSSBO, RADIX_DIGITS * NumBlocks(static_cast<GLuint>(maxObjects)) * sizeof(GLuint));
+    EnsureBuffer(g_sceneBoundsSSBO, 4 * sizeof(GLuint));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[DispatchOrder] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Keys -> radix sort -> order table
+// ============================================================================
+bool DispatchOrder::Build(GLuint objectSSBO, int numObjects)
+{
+    if (!g_ready) return false;
+    if (numObjects <= 0 || numObjects > g_maxObjects) return false;
+
+    GLuint objectCount = static_cast<GLuint>(numObjects);
+
+    glUseProgram(g_program);
+    if (g_numObjectsLoc != -1) glUniform1i(g_numObjectsLoc, numObjects);
+    if (g_numBlocksLoc != -1) glUniform1ui(g_numBlocksLoc, NumBlocks(objectCount));
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_RADIX_HISTOGRAM_BINDING, g_radixHistogramSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SCENE_BOUNDS_BINDING, g_sceneBoundsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_IN_BINDING, g_sortSSBO[0]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_OUT_BINDING, g_sortSSBO[1]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DISPATCH_ORDER_BINDING, g_orderSSBO);
+
+    DispatchPass(ORDER_PASS_CLEAR_BOUNDS, 1);
+    DispatchPass(ORDER_PASS_BOUNDS, objectCount);
+    DispatchPass(ORDER_PASS_KEYS, objectCount);
+
+    // LSD radix sort of 32-bit keys; an even pass count leaves the result in g_sortSSBO[0]
+    int src = 0;
+    for (int shift = 0; shift < 32; shift += RADIX_BITS_PER_PASS)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_IN_BINDING, g_sortSSBO[src]);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_OUT_BINDING, g_sortSSBO[1 - src]);
+        if (g_radixShiftLoc != -1) glUniform1ui(g_radixShiftLoc, static_cast<GLuint>(shift));
+
+        DispatchPass(ORDER_PASS_RADIX_HISTOGRAM, objectCount);
+        DispatchPass(ORDER_PASS_RADIX_SCAN, 1);
+        DispatchPass(ORDER_PASS_RADIX_SCATTER, objectCount);
+        src = 1 - src;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_IN_BINDING, g_sortSSBO[src]);
+    DispatchPass(ORDER_PASS_WRITE_ORDER, objectCount);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_IN_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_OUT_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_RADIX_HISTOGRAM_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SCENE_BOUNDS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DISPATCH_ORDER_BINDING, 0);
+    glUseProgram(0);
+    return true;
+}
+
+void DispatchOrder::Bind()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DISPATCH_ORDER_BINDING, g_orderSSBO);
+}
+
+void DispatchOrder::Unbind()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DISPATCH_ORDER_BINDING, 0);
+}
+
+// ============================================================================
+// Release buffers and the build program
+// ============================================================================
+void DispatchOrder::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    GLuint* buffers[] = { &g_orderSSBO, &g_sortSSBO[0], &g_sortSSBO[1], &g_radixHistogramSSBO, &g_sceneBoundsSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_maxObjects = 0;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void DispatchOrder::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool DispatchOrder::IsReady()
+{
+    return g_ready;
+}
+
+std::string DispatchOrder::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[dispatch order] " + g_loader.GetStatusMessage();
+    return "Dispatch order shader ready";
+}
@@ -0,0 +1,270 @@
+#include "domain_decomposition.h"
+#include "objects.h"
+#include "object_lifecycle.h"
+#include "object_worlds.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#ifdef STELLAR_MPI
+#include <mpi.h>
+#endif
+
+static bool g_active = false;
+static bool g_initializedMpi = false;  // Start() called MPI_Init, so Cleanup() finalizes
+static int g_rank = 0;
+static int g_ranks = 1;
+static float g_minX = 0.0f;
+static float g_slabWidth = 0.0f;
+static float g_halo = 0.0f;
+static bool g_periodic = false;
+static int g_localObjects = 0;  // Objects [g_localObjects, GetNumObjects()) are ghosts
+static DomainDecomposition::Stats g_stats;
+
+// Slab that owns x; the end slabs own everything beyond the outer edges
+static int OwnerOf(float x)
+{
+    if (!std::isfinite(x)) return g_rank;  // Never sent anywhere
+    int slab = static_cast<int>(std::floor((x - g_minX) / g_slabWidth));
+    if (g_periodic) return ((slab % g_ranks) + g_ranks) % g_ranks;
+    return std::min(std::max(slab, 0), g_ranks - 1);
+}
+
+// Ranks other than the owner whose slab lies within the halo of x
+static void GhostRanks(float x, int owner, std::vector<int>& out)
+{
+    out.clear();
+    if (!std::isfinite(x)) return;
+    int low = OwnerOf(x - g_halo);
+    int high = OwnerOf(x + g_halo);
+    if (low != owner) out.push_back(low);
+    if (high != owner && high != low) out.push_back(high);
+}
+
+// Registration keys of every equation slot, so ranks that disagree on an ID are caught
+static uint64_t EquationKeysHash()
+{
+    uint64_t hash = 1469598103934665603ull;  // FNV-1a
+    for (const std::string& key : Objects::GetEquationKeys())
+    {
+        for (unsigned char c : key) hash = (hash ^ c) * 1099511628211ull;
+        hash = (hash ^ 0xFFu) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static void RemoveGhosts()
+{
+    int numObjects = Objects::GetNumObjects();
+    if (g_localObjects >= numObjects) return;
+    std::vector<int> ghosts;
+    for (int i = g_localObjects; i < numObjects; i++) ghosts.push_back(i);
+    Objects::RemoveObjects(ghosts);  // The tail: nothing owned moves
+}
+
+#ifdef STELLAR_MPI
+// One Object row per element; counts and the rows in rank order, as MPI_Alltoallv takes them
+static bool ExchangeRows(const std::vector<std::vector<Object>>& outgoing, std::vector<Object>& incoming)
+{
+    std::vector<int> sendCounts(g_ranks), sendOffsets(g_ranks), receiveCounts(g_ranks), receiveOffsets(g_ranks);
+    std::vector<Object> sendRows;
+    for (int r = 0; r < g_ranks; r++)
+    {
+        sendOffsets[r] = static_cast<int>(sendRows.size() * sizeof(Object));
+        sendCounts[r] = static_cast<int>(outgoing[r].size() * sizeof(Object));
+        sendRows.insert(sendRows.end(), outgoing[r].begin(), outgoing[r].end());
+    }
+    if (MPI_Alltoall(sendCounts.data(), 1, MPI_INT, receiveCounts.data(), 1, MPI_INT, MPI_COMM_WORLD) != MPI_SUCCESS)
+        return false;
+
+    int receiveBytes = 0;
+    for (int r = 0; r < g_ranks; r++)
+    {
+        receiveOffsets[r] = receiveBytes;
+        receiveBytes += receiveCounts[r];
+    }
+    incoming.resize(receiveBytes / sizeof(Object));
+    return MPI_Alltoallv(sendRows.data(), sendCounts.data(), sendOffsets.data(), MPI_BYTE,
+                         incoming.data(), receiveCounts.data(), receiveOffsets.data(), MPI_BYTE,
+                         MPI_COMM_WORLD) == MPI_SUCCESS;
+}
+#endif
+
+// ============================================================================
+// Start and stop
+// ============================================================================
+bool DomainDecomposition::Start(float minX, float maxX, float halo, bool periodic, std::string& error)
+{
+#ifndef STELLAR_MPI
+    (void)minX; (void)maxX; (void)halo; (void)periodic;
+    error = "Domain decomposition needs a build with STELLAR_MPI";
+    return false;
+#else
+    if (!(maxX > minX) || !(halo >= 0.0f))
+    {
+        error = "Domain decomposition needs max_x > min_x and a halo >= 0";
+        return false;
+    }
+    if (ObjectWorlds::Count() > 0 || ObjectLifecycle::IsActive() || ObjectLifecycle::GetEmitterCount() > 0)
+    {
+        error = "Ensemble worlds and emitters cannot be split into domains";
+        return false;
+    }
+
+    int initialized = 0;
+    MPI_Initialized(&initialized);
+    if (!initialized)
+    {
+        if (MPI_Init(nullptr, nullptr) != MPI_SUCCESS)
+        {
+            error = "MPI_Init failed";
+            return false;
+        }
+        g_initializedMpi = true;
+    }
+    MPI_Comm_rank(MPI_COMM_WORLD, &g_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &g_ranks);
+
+    float slabWidth = (maxX - minX) / static_cast<float>(g_ranks);
+    if (g_ranks > 1 && halo >= slabWidth)
+    {
+        error = "The halo has to be narrower than a slab (" + std::to_string(slabWidth) + ")";
+        return false;
+    }
+
+    if (g_active) RemoveGhosts();
+    g_minX = minX;
+    g_slabWidth = slabWidth;
+    g_halo = halo;
+    g_periodic = periodic;
+    g_active = true;
+    g_stats = Stats();
+    g_stats.rank = g_rank;
+    g_stats.ranks = g_ranks;
+    g_stats.slabMin = minX + slabWidth * static_cast<float>(g_rank);
+    g_stats.slabMax = g_stats.slabMin + slabWidth;
+
+    // Every rank may start with any objects: the first exchange hands them to their owners
+    g_localObjects = Objects::GetNumObjects();
+    return true;
+#endif
+}
+
+void DomainDecomposition::Stop()
+{
+    if (!g_active) return;
+    RemoveGhosts();
+    g_active = false;
+    g_localObjects = 0;
+}
+
+bool DomainDecomposition::IsActive()
+{
+    return g_active;
+}
+
+void DomainDecomposition::Cleanup()
+{
+    g_active = false;
+    g_localObjects = 0;
+    g_stats = Stats();
+#ifdef STELLAR_MPI
+    int finalized = 0;
+    MPI_Finalized(&finalized);
+    if (g_initializedMpi && !finalized) MPI_Finalize();
+#endif
+    g_initializedMpi = false;
+}
+
+// ============================================================================
+// One exchange: ghosts out, migrants to their owners, fresh ghosts in
+// ============================================================================
+bool DomainDecomposition::Exchange(int sourceIndex, std::string& error)
+{
+    if (!g_active) return true;
+#ifndef STELLAR_MPI
+    (void)sourceIndex;
+    error = "Domain decomposition needs a build with STELLAR_MPI";
+    return false;
+#else
+    uint64_t hash = EquationKeysHash();
+    uint64_t hashes[2] = { hash, ~hash };
+    MPI_Allreduce(MPI_IN_PLACE, hashes, 2, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+    if (hashes[0] != hash || hashes[1] != ~hash)
+    {
+        error = "Ranks registered different equations; every rank has to set the same ones in the same order";
+        return false;
+    }
+
+    std::vector<Object> owned;
+    Objects::FetchToCPU(sourceIndex, 0, g_localObjects, owned);
+
+    // Rows that move and the copies each rank gets as ghosts; an object that just left is this
+    // rank's ghost when it is still within the halo, since its new owner sends none until the next step
+    std::vector<std::vector<Object>> migrants(g_ranks), ghosts(g_ranks);
+    std::vector<Object> ownGhosts;
+    std::vector<int> removals;
+    std::vector<int> ghostRanks;
+    for (int i = 0; i < static_cast<int>(owned.size()); i++)
+    {
+        const Object& object = owned[i];
+        int owner = OwnerOf(object.position.x);
+        if (owner != g_rank)
+        {
+            migrants[owner].push_back(object);
+            removals.push_back(i);
+        }
+        GhostRanks(object.position.x, owner, ghostRanks);
+        for (int r : ghostRanks)
+        {
+            if (r == g_rank) ownGhosts.push_back(object);
+            else ghosts[r].push_back(object);
+        }
+    }
+
+    std::vector<Object> arrived, ghostRows;
+    if (!ExchangeRows(migrants, arrived) || !ExchangeRows(ghosts, ghostRows))
+    {
+        error = "MPI exchange of objects failed";
+        return false;
+    }
+    ghostRows.insert(ghostRows.end(), ownGhosts.begin(), ownGhosts.end());
+
+    // Ghosts of the last step and the migrants leave in one pass; arrivals join the owned objects
+    int migratedOut = static_cast<int>(removals.size());
+    for (int i = g_localObjects; i < Objects::GetNumObjects(); i++) removals.push_back(i);
+    Objects::RemoveObjects(removals);
+    if (!arrived.empty() && Objects::AddObjects(arrived) < 0)
+    {
+        error = "No room for " + std::to_string(arrived.size()) + " arriving objects";
+        return false;
+    }
+    g_localObjects = Objects::GetNumObjects();
+
+    int firstGhost = ghostRows.empty() ? g_localObjects : Objects::AddObjects(ghostRows);
+    if (firstGhost < 0)
+    {
+        error = "No room for " + std::to_string(ghostRows.size()) + " ghost objects";
+        return false;
+    }
+    for (int i = firstGhost; i < Objects::GetNumObjects(); i++) Objects::SetObjectStatic(i, true);
+
+    g_stats.localObjects = g_localObjects;
+    g_stats.ghostObjects = Objects::GetNumObjects() - g_localObjects;
+    g_stats.migratedIn = static_cast<int>(arrived.size());
+    g_stats.migratedOut = migratedOut;
+    g_stats.exchanges++;
+    return true;
+#endif
+}
+
+DomainDecomposition::Stats DomainDecomposition::GetStats()
+{
+    Stats stats = g_stats;
+    if (g_active)
+    {
+        stats.localObjects = std::min(g_localObjects, Objects::GetNumObjects());
+        stats.ghostObjects = Objects::GetNumObjects() - stats.localObjects;
+    }
+    return stats;
+}
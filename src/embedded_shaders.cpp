@@ -0,0 +1,62 @@
+#include "embedded_shaders.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+const EmbeddedShader* FindEmbeddedShader(const std::string& name)
+{
+    for (int i = 0; i < g_embeddedShaderCount; i++)
+    {
+        if (name == g_embeddedShaders[i].name) return &g_embeddedShaders[i];
+    }
+    return nullptr;
+}
+
+// C file I/O, as the loader has always used (MinGW's std::ifstream had trouble here)
+static bool ReadShaderFile(const std::string& path, std::string& content)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size <= 0)
+    {
+        fclose(file);
+        return false;
+    }
+
+    content.resize(static_cast<size_t>(size));
+    size_t bytesRead = fread(&content[0], 1, content.size(), file);
+    fclose(file);
+    return bytesRead == content.size();
+}
+
+bool LoadShaderSource(const std::string& name, std::string& source, std::string& hash)
+{
+    source.clear();
+    hash.clear();
+
+    const char* overrideDir = std::getenv("STELLAR_SHADER_DIR");
+    if (overrideDir && overrideDir[0] != '\0')
+    {
+        std::string path = std::string(overrideDir) + "/" + name;
+        if (!ReadShaderFile(path, source))
+        {
+            std::cerr << "[Shaders] Could not read " << path << " (STELLAR_SHADER_DIR)" << std::endl;
+            return false;
+        }
+    }
+    else
+    {
+        const EmbeddedShader* shader = FindEmbeddedShader(name);
+        if (!shader) return false;
+        source.assign(reinterpret_cast<const char*>(shader->source), shader->size);
+        hash = shader->hash;
+    }
+
+    if (source.compare(0, 3, "\xEF\xBB\xBF") == 0) source.erase(0, 3);
+    return !source.empty();
+}
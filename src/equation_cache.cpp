@@ -0,0 +1,161 @@
+#include "equation_cache.h"
+#include "objects.h"
+#include "gpu_serializer.h"
+#include "embedded_shaders.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+// Bump when the parser or serializer output changes without math.comp changing
+static const uint32_t EQUATION_CACHE_FORMAT = 1;
+
+static std::mutex g_directoryMutex;
+static bool g_directoryChosen = false;
+static std::string g_directory;
+
+static uint64_t HashText(const std::string& text, uint64_t hash = 14695981039346656037ull)
+{
+    for (unsigned char c : text)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;  // FNV-1a
+    }
+    return hash;
+}
+
+// Format version and math.comp, which defines what the serialized tokens mean
+static const std::string& BuildFingerprint()
+{
+    static const std::string fingerprint = []()
+    {
+        std::string source, hash;
+        LoadShaderSource("math.comp", source, hash);
+        if (hash.empty())
+        {
+            char hex[17];
+            std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(HashText(source)));
+            hash = hex;
+        }
+        return std::to_string(EQUATION_CACHE_FORMAT) + ":" + hash;
+    }();
+    return fingerprint;
+}
+
+// The vectors of an equation in a fixed order
+template<typename Equation, typename Visit>
+static bool VisitBuffers(Equation& eq, Visit visit)
+{
+    return visit(eq.tokenBuffer_ax) && visit(eq.tokenBuffer_ay) && visit(eq.tokenBuffer_angular) &&
+           visit(eq.tokenBuffer_r) && visit(eq.tokenBuffer_g) && visit(eq.tokenBuffer_b) && visit(eq.tokenBuffer_a) &&
+           visit(eq.constantBuffer_ax) && visit(eq.constantBuffer_ay) && visit(eq.constantBuffer_angular) &&
+           visit(eq.constantBuffer_r) && visit(eq.constantBuffer_g) && visit(eq.constantBuffer_b) && visit(eq.constantBuffer_a) &&
+           visit(eq.bytecode_ax) && visit(eq.bytecode_ay) && visit(eq.bytecode_angular) &&
+           visit(eq.bytecode_r) && visit(eq.bytecode_g) && visit(eq.bytecode_b) && visit(eq.bytecode_a) &&
+           std::all_of(std::begin(eq.tokenBuffer_state), std::end(eq.tokenBuffer_state), visit) &&
+           visit(eq.constantBuffer_state);
+}
+
+static std::string EntryFile(const std::string& directory, const std::string& fullKey)
+{
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(HashText(fullKey)));
+    return (std::filesystem::path(directory) / (std::string(hex) + ".eqn")).string();
+}
+
+void EquationCache::SetDirectory(const std::string& directory)
+{
+    std::lock_guard<std::mutex> lock(g_directoryMutex);
+    g_directory = directory;
+    g_directoryChosen = true;
+}
+
+std::string EquationCache::GetDirectory()
+{
+    std::lock_guard<std::mutex> lock(g_directoryMutex);
+    if (!g_directoryChosen)
+    {
+        const char* path = std::getenv("STELLAR_EQUATION_CACHE");
+        g_directory = (path && std::string(path) != "0") ? path : "";
+        g_directoryChosen = true;
+    }
+    return g_directory;
+}
+
+// Entry layout: "STLREQTN", key length, key, then per buffer an element count and the elements
+bool EquationCache::Load(const std::string& key, GPUSerializedEquation& equation)
+{
+    std::string directory = GetDirectory();
+    if (directory.empty()) return false;
+
+    std::string fullKey = BuildFingerprint() + "\n" + key;
+    FILE* in = fopen(EntryFile(directory, fullKey).c_str(), "rb");
+    if (!in) return false;
+
+    char magic[8];
+    uint32_t keyLength = 0;
+    std::string storedKey;
+    bool valid = fread(magic, 1, 8, in) == 8 && std::string(magic, 8) == "STLREQTN" &&
+                 fread(&keyLength, sizeof(keyLength), 1, in) == 1 && keyLength == fullKey.size();
+    if (valid)
+    {
+        storedKey.resize(keyLength);
+        valid = fread(&storedKey[0], 1, keyLength, in) == keyLength && storedKey == fullKey;
+    }
+
+    GPUSerializedEquation loaded;
+    if (valid)
+    {
+        valid = VisitBuffers(loaded, [in](auto& buffer)
+        {
+            uint32_t count = 0;
+            if (fread(&count, sizeof(count), 1, in) != 1 || count > (1u << 24)) return false;
+            buffer.resize(count);
+            return count == 0 || fread(buffer.data(), sizeof(buffer[0]), count, in) == count;
+        });
+    }
+    fclose(in);
+
+    // A damaged entry could hand math.comp's unchecked evaluator a bad program; it is a miss
+    if (!valid || !validateGPUSerializedEquation(loaded).empty()) return false;
+
+    equation = std::move(loaded);
+    return true;
+}
+
+void EquationCache::Store(const std::string& key, const GPUSerializedEquation& equation)
+{
+    std::string directory = GetDirectory();
+    if (directory.empty()) return;
+
+    std::string fullKey = BuildFingerprint() + "\n" + key;
+    std::string file = EntryFile(directory, fullKey);
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    // Written under a temporary name so a concurrent reader never sees a partial entry
+    std::string staging = file + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) +
+                          std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    FILE* out = fopen(staging.c_str(), "wb");
+    if (!out) return;
+
+    uint32_t keyLength = static_cast<uint32_t>(fullKey.size());
+    bool written = fwrite("STLREQTN", 1, 8, out) == 8 &&
+                   fwrite(&keyLength, sizeof(keyLength), 1, out) == 1 &&
+                   fwrite(fullKey.data(), 1, keyLength, out) == keyLength;
+    written = written && VisitBuffers(equation, [out](const auto& buffer)
+    {
+        uint32_t count = static_cast<uint32_t>(buffer.size());
+        return fwrite(&count, sizeof(count), 1, out) == 1 &&
+               (count == 0 || fwrite(buffer.data(), sizeof(buffer[0]), count, out) == count);
+    });
+    written = (fclose(out) == 0) && written;
+
+    if (written) std::filesystem::rename(staging, file, error);
+    if (!written || error) std::filesystem::remove(staging, error);
+}
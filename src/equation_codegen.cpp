@@ -0,0 +1,689 @@
+#include "equation_codegen.h"
+#include "equation_optimizer.h"
+#include "gpu_serializer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+const char* const EquationCodegen::BLOCK_BEGIN_MARKER = "// @COMPILED_EQUATIONS_BEGIN";
+const char* const EquationCodegen::BLOCK_END_MARKER = "// @COMPILED_EQUATIONS_END";
+
+// Interpreter limit - MUST MATCH evaluateRPNComponent() in math.comp
+static const int MAX_STACK_FLOATS = 126;
+
+// Shared parameter list of the generated component functions and evaluateRPNComponent()
+static const char* const COMPONENT_PARAMS =
+    "float x, float y, float vx, float vy, float ax_prev, float ay_prev, "
+    "float rotation, float angular_vel, vec4 color, float mass, float charge, int objectIndex";
+static const char* const COMPONENT_ARGS =
+    "x, y, vx, vy, ax_prev, ay_prev, rotation, angular_vel, color, mass, charge, objectIndex";
+
+// What the interpreter's isComplex flag would be for a stack entry.
+// Values are always vec2 with .y == 0 for reals, so only ops that read the flag care;
+// those fall back to the interpreter when the flag is only known at run time.
+enum ValueKind
+{
+    VALUE_REAL,     // Flag is false
+    VALUE_COMPLEX,  // Flag is true
+    VALUE_EITHER    // Decided at run time (real power of a possibly negative base)
+};
+
+struct StackValue
+{
+    std::string name;
+    ValueKind kind;
+};
+
+struct ComponentSlot
+{
+    const char* suffix;
+    int componentType;  // Matches the interpreter's componentType argument
+    int EquationMapping::* tokenOffset;
+    int EquationMapping::* tokenCount;
+    int EquationMapping::* constantOffset;
+    int EquationMapping::* bytecodeOffset;
+};
+
+static const ComponentSlot s_components[] = {
+    { "ax", 0, &EquationMapping::tokenOffset_ax, &EquationMapping::tokenCount_ax, &EquationMapping::constantOffset_ax,
+      &EquationMapping::bytecodeOffset_ax },
+    { "ay", 1, &EquationMapping::tokenOffset_ay, &EquationMapping::tokenCount_ay, &EquationMapping::constantOffset_ay,
+      &EquationMapping::bytecodeOffset_ay },
+    { "angular", 2, &EquationMapping::tokenOffset_angular, &EquationMapping::tokenCount_angular, &EquationMapping::constantOffset_angular,
+      &EquationMapping::bytecodeOffset_angular },
+    { "r", 3, &EquationMapping::tokenOffset_r, &EquationMapping::tokenCount_r, &EquationMapping::constantOffset_r,
+      &EquationMapping::bytecodeOffset_r },
+    { "g", 4, &EquationMapping::tokenOffset_g, &EquationMapping::tokenCount_g, &EquationMapping::constantOffset_g,
+      &EquationMapping::bytecodeOffset_g },
+    { "b", 5, &EquationMapping::tokenOffset_b, &EquationMapping::tokenCount_b, &EquationMapping::constantOffset_b,
+      &EquationMapping::bytecodeOffset_b },
+    { "a", 6, &EquationMapping::tokenOffset_a, &EquationMapping::tokenCount_a, &EquationMapping::constantOffset_a,
+      &EquationMapping::bytecodeOffset_a },
+};
+
+// Where each component's result lands in evaluateCompiledEquation()
+static const char* const s_componentTargets[] = {
+    "ax", "ay", "angular_accel", "new_color.r", "new_color.g", "new_color.b", "new_color.a"
+};
+
+// GLSL float literal; invalid constants read as 0 like in the interpreter
+static std::string FormatFloat(float value)
+{
+    if (!std::isfinite(value)) return "0.0";
+
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    std::string literal(buffer);
+    if (literal.find_first_of(".e") == std::string::npos) literal += ".0";
+    return literal;
+}
+
+// GLSL expression for a variable hash - MUST MATCH the GPUTokens::TOKEN_VARIABLE switch in math.comp
+static std::string VariableExpression(int varHash)
+{
+    using namespace VariableHashes;
+    switch (varHash)
+    {
+    case VAR_HASH_X: return "x";
+    case VAR_HASH_Y: return "y";
+    case VAR_HASH_VX: return "vx";
+    case VAR_HASH_VY: return "vy";
+    case VAR_HASH_AX: return "ax_prev";
+    case VAR_HASH_AY: return "ay_prev";
+    case VAR_HASH_T: return "stepTime";
+    case VAR_HASH_THETA: return "rotation";
+    case VAR_HASH_OMEGA: return "angular_vel";
+    case VAR_HASH_R: return "color.r";
+    case VAR_HASH_G: return "color.g";
+    case VAR_HASH_B: return "color.b";
+    case VAR_HASH_A: return "color.a";
+    case VAR_HASH_PI: return "PI";
+    case VAR_HASH_E: return "E";
+    case VAR_HASH_K: return "k";
+    case VAR_HASH_B_DAMP: return "b";
+    case VAR_HASH_G_GRAV: return "g";
+    case VAR_HASH_MASS: return "mass";
+    case VAR_HASH_CHARGE: return "charge";
+    case VAR_HASH_COUPLING: return "uCoupling";
+    case VAR_HASH_FREQ: return "uDriveFreq";
+    case VAR_HASH_AMP: return "uDriveAmp";
+    case VAR_HASH_GRAV_AX: return "longRangeValue(objectIndex).x";
+    case VAR_HASH_GRAV_AY: return "longRangeValue(objectIndex).y";
+    case VAR_HASH_COUL_AX: return "longRangeValue(objectIndex).z";
+    case VAR_HASH_COUL_AY: return "longRangeValue(objectIndex).w";
+    case VAR_HASH_SPH_AX: return "fluidValue(objectIndex).x";
+    case VAR_HASH_SPH_AY: return "fluidValue(objectIndex).y";
+    case VAR_HASH_SPH_RHO: return "fluidValue(objectIndex).z";
+    case VAR_HASH_SPH_P: return "fluidValue(objectIndex).w";
+    default:
+        if (varHash >= VAR_HASH_PARAM_0 && varHash <= VAR_HASH_PARAM_7)
+            return "objectParam(objectIndex, " + std::to_string(varHash - VAR_HASH_PARAM_0) + ")";
+        if (varHash >= VAR_HASH_RAND_0 && varHash <= VAR_HASH_RANDN_7)
+            return "randomValue(objectIndex, " + std::to_string(varHash) + ")";
+        if (varHash >= VAR_HASH_STATE_0 && varHash <= VAR_HASH_STATE_7)
+            return "stateRegisters[" + std::to_string(varHash - VAR_HASH_STATE_0) + "]";
+        if (varHash >= VAR_HASH_AGG_0 && varHash <= VAR_HASH_AGG_15)
+            return "aggregateValue(" + std::to_string(varHash - VAR_HASH_AGG_0) + ")";
+        if (varHash >= VAR_HASH_FIELD_0 && varHash <= VAR_HASH_FIELD_7)
+            return "pipelineField(objectIndex, " + std::to_string(varHash - VAR_HASH_FIELD_0) + ")";
+        return "0.0";
+    }
+}
+
+static ValueKind CombineKinds(ValueKind a, ValueKind b)
+{
+    if (a == VALUE_COMPLEX || b == VALUE_COMPLEX) return VALUE_COMPLEX;
+    if (a == VALUE_EITHER || b == VALUE_EITHER) return VALUE_EITHER;
+    return VALUE_REAL;
+}
+
+// Floats the interpreter stack would hold (assume the worst for run-time kinds)
+static int StackFloats(const std::vector<StackValue>& stack)
+{
+    int floats = 0;
+    for (const StackValue& value : stack)
+        floats += (value.kind == VALUE_REAL) ? 1 : 2;
+    return floats;
+}
+
+// ============================================================================
+// Symbolically execute one component's RPN and emit straight-line GLSL, with
+// an if/else block per if(). Returns false when the component has to stay on the interpreter.
+// tempKinds holds what earlier components of the equation stored in each temporary. With
+// preludes, a hoisted body reads preludeValues where math.comp has them, in a block like an
+// if()'s; without (shaders that have no prelude pass) it is emitted in place.
+// ============================================================================
+static bool GenerateComponentBody(const std::vector<int>& tokens, const std::vector<float>& constants,
+                                  int tokenOffset, int tokenCount, int constantOffset,
+                                  std::vector<ValueKind>& tempKinds, bool preludes,
+                                  std::ostringstream& body, std::string& result)
+{
+    if (tokenCount <= 0) return false;
+    if (tokenOffset < 0 || tokenOffset + tokenCount > static_cast<int>(tokens.size())) return false;
+
+    std::vector<StackValue> stack;
+    int nextTemp = 0;
+    std::string indent = "    ";
+    auto push = [&](const std::string& expression, ValueKind kind)
+    {
+        std::string name = "t" + std::to_string(nextTemp++);
+        body << indent << "vec2 " << name << " = " << expression << ";\n";
+        stack.push_back({ name, kind });
+    };
+    auto pop = [&]()
+    {
+        StackValue value = stack.back();
+        stack.pop_back();
+        return value;
+    };
+
+    // Temporaries stored by this component are read from their local directly
+    std::vector<ValueKind> kinds = tempKinds;
+    std::vector<std::string> storedNames(kinds.size());
+
+    // Open if() and prelude blocks: the local they assign, the stack depth below it, and where the
+    // then and else branches end (a prelude block has no jump)
+    struct Branch
+    {
+        std::string name;
+        size_t depth;
+        int jump;
+        int merge;
+        ValueKind thenKind;
+    };
+    std::vector<Branch> branches;
+    auto closeBranches = [&](int at)
+    {
+        while (!branches.empty() && at == branches.back().merge)
+        {
+            const Branch& branch = branches.back();
+            if (stack.size() != branch.depth + 1) return false;
+            StackValue value = pop();
+            body << indent << branch.name << " = " << value.name << ";\n";
+            indent.resize(indent.size() - 4);
+            body << indent << "}\n";
+            stack.push_back({ branch.name, value.kind == branch.thenKind ? value.kind : VALUE_EITHER });
+            branches.pop_back();
+        }
+        return true;
+    };
+
+    const int end = tokenOffset + tokenCount;
+    int idx = tokenOffset;
+    while (idx < end)
+    {
+        if (!closeBranches(idx)) return false;
+        if (StackFloats(stack) >= MAX_STACK_FLOATS) return false;
+
+        int token = tokens[idx++];
+        switch (token)
+        {
+        case GPUTokens::TOKEN_NUMBER:
+        {
+            if (idx >= end) return false;
+            int constIdx = constantOffset + tokens[idx++];
+            float value = (constIdx >= 0 && constIdx < static_cast<int>(constants.size())) ? constants[constIdx] : 0.0f;
+            push("vec2(" + FormatFloat(value) + ", 0.0)", VALUE_REAL);
+            break;
+        }
+        case GPUTokens::TOKEN_VARIABLE:
+        {
+            if (idx >= end) return false;
+            int varHash = tokens[idx++];
+            if (varHash == VariableHashes::VAR_HASH_I)
+                push("vec2(0.0, 1.0)", VALUE_COMPLEX);
+            else
+                push("vec2(" + VariableExpression(varHash) + ", 0.0)", VALUE_REAL);
+            break;
+        }
+        case GPUTokens::TOKEN_OBJECT_REF:
+        {
+            if (idx + 1 >= end) return false;
+            int objIndex = tokens[idx++];
+            int propHash = tokens[idx++];
+            push("vec2(sanitizeFloat(getObjectProperty(" + std::to_string(objIndex) + ", " +
+                 std::to_string(propHash) + ", objectIndex)), 0.0)", VALUE_REAL);
+            break;
+        }
+        case GPUTokens::TOKEN_PAIR_REF:
+        {
+            // Only pair body functions have the neighbour pj in scope
+            if (idx >= end) return false;
+            int propHash = tokens[idx++];
+            push("vec2(sanitizeFloat(pairProperty(pj, pjIndex, " + std::to_string(propHash) + ")), 0.0)", VALUE_REAL);
+            break;
+        }
+        case GPUTokens::TOKEN_PAIR_SUM:
+        {
+            // The pair pass already reduced the body; only its result is read here
+            if (idx + 3 >= end) return false;
+            int pairSlot = tokens[idx];
+            int bodyCount = tokens[idx + 3];
+            idx += 4 + bodyCount;
+            push("vec2(pairSumValue(objectIndex, " + std::to_string(pairSlot) + "), 0.0)", VALUE_REAL);
+            break;
+        }
+        case GPUTokens::TOKEN_DERIVATIVE:
+            // Central differences and dual walks re-read the sub-expression; leave those to the interpreter
+            return false;
+
+        case GPUTokens::TOKEN_BRANCH:
+        {
+            // The condition picks a branch by its real part, like the interpreter
+            if (idx >= end || stack.empty()) return false;
+            int skip = tokens[idx++];
+            int jump = idx + skip - 2;
+            if (skip < 3 || jump + 1 >= end || tokens[jump] != GPUTokens::TOKEN_JUMP) return false;
+            int merge = jump + 2 + tokens[jump + 1];
+            if (merge > end) return false;
+            StackValue condition = pop();
+            std::string name = "t" + std::to_string(nextTemp++);
+            body << indent << "vec2 " << name << ";\n"
+                 << indent << "if (" << condition.name << ".x > 0.0) {\n";
+            branches.push_back({ name, stack.size(), jump, merge, VALUE_REAL });
+            indent += "    ";
+            break;
+        }
+        case GPUTokens::TOKEN_PRELUDE:
+        {
+            if (idx + 1 >= end) return false;
+            int preludeSlot = tokens[idx];
+            int bodyCount = tokens[idx + 1];
+            idx += 2;
+            if (!preludes) break;
+            if (bodyCount < 1 || idx + bodyCount > end) return false;
+            std::string name = "t" + std::to_string(nextTemp++);
+            body << indent << "vec2 " << name << ";\n"
+                 << indent << "if (preludeBase >= 0) {\n"
+                 << indent << "    " << name << " = vec2(preludeValues[preludeBase + " << preludeSlot << "], 0.0);\n"
+                 << indent << "} else {\n";
+            branches.push_back({ name, stack.size(), -1, idx + bodyCount, VALUE_REAL });
+            indent += "    ";
+            break;
+        }
+        case GPUTokens::TOKEN_JUMP:
+        {
+            if (branches.empty() || idx - 1 != branches.back().jump) return false;
+            if (stack.size() != branches.back().depth + 1) return false;
+            idx++;
+            StackValue value = pop();
+            body << indent << branches.back().name << " = " << value.name << ";\n";
+            branches.back().thenKind = value.kind;
+            body << indent.substr(4) << "} else {\n";
+            break;
+        }
+
+        case GPUTokens::TOKEN_TEMP_STORE:
+        {
+            // A store inside a branch would not reach the components after it
+            if (idx >= end || stack.empty() || !branches.empty()) return false;
+            int slot = tokens[idx++];
+            const StackValue& top = stack.back();
+            if (slot < 0 || slot >= static_cast<int>(kinds.size())) return false;
+            // Flag for interpreted loads; run-time kinds use the same test as the power operators
+            std::string flag = top.kind == VALUE_REAL ? "false" : top.kind == VALUE_COMPLEX ? "true" : "(" + top.name + ".y != 0.0)";
+            body << "    equationTemps[" << slot << "] = " << top.name << ";\n"
+                 << "    equationTempComplex[" << slot << "] = " << flag << ";\n";
+            kinds[slot] = top.kind;
+            storedNames[slot] = top.name;
+            break;
+        }
+        case GPUTokens::TOKEN_TEMP_LOAD:
+        {
+            if (idx >= end) return false;
+            int slot = tokens[idx++];
+            if (slot < 0 || slot >= static_cast<int>(kinds.size())) return false;
+            if (!storedNames[slot].empty()) stack.push_back({ storedNames[slot], kinds[slot] });
+            else push("equationTemps[" + std::to_string(slot) + "]", kinds[slot]);
+            break;
+        }
+
+        case GPUTokens::TOKEN_ADD:
+        case GPUTokens::TOKEN_SUB:
+        case GPUTokens::TOKEN_MUL:
+        case GPUTokens::TOKEN_DIV:
+        case GPUTokens::TOKEN_POW:
+        {
+            if (stack.size() < 2) return false;
+            StackValue b = pop();
+            StackValue a = pop();
+            const std::string args = "(" + a.name + ", " + b.name + ")";
+
+            if (token == GPUTokens::TOKEN_ADD) push("cAdd" + args, CombineKinds(a.kind, b.kind));
+            else if (token == GPUTokens::TOKEN_SUB) push("cSub" + args, CombineKinds(a.kind, b.kind));
+            else if (token == GPUTokens::TOKEN_MUL) push("cMul" + args, VALUE_COMPLEX);
+            else if (token == GPUTokens::TOKEN_DIV) push("cDiv" + args, VALUE_COMPLEX);
+            else if (CombineKinds(a.kind, b.kind) == VALUE_COMPLEX) push("cPow" + args, VALUE_COMPLEX);
+            else
+            {
+                // Complex power only for negative (or run-time complex) bases
+                std::string complexTest = a.name + ".x < 0.0";
+                if (a.kind == VALUE_EITHER) complexTest += " || " + a.name + ".y != 0.0";
+                if (b.kind == VALUE_EITHER) complexTest += " || " + b.name + ".y != 0.0";
+                push("(" + complexTest + ") ? cPow" + args + " : vec2(safePow(" + a.name + ".x, " + b.name + ".x), 0.0)",
+                     VALUE_EITHER);
+            }
+            break;
+        }
+
+        case GPUTokens::TOKEN_SQRT:
+        {
+            if (stack.empty()) return false;
+            StackValue a = pop();
+            if (a.kind == VALUE_COMPLEX)
+            {
+                push("cPow(" + a.name + ", vec2(0.5, 0.0))", VALUE_COMPLEX);
+                break;
+            }
+            // Real root for non-negative real operands, like the interpreter
+            std::string complexTest = a.name + ".x < 0.0";
+            if (a.kind == VALUE_EITHER) complexTest += " || " + a.name + ".y != 0.0";
+            push("(" + complexTest + ") ? cPow(" + a.name + ", vec2(0.5, 0.0)) : vec2(sqrt(" + a.name + ".x), 0.0)",
+                 VALUE_EITHER);
+            break;
+        }
+
+        case GPUTokens::TOKEN_NEG:
+        case GPUTokens::TOKEN_SIN:
+        case GPUTokens::TOKEN_COS:
+        case GPUTokens::TOKEN_TAN:
+        case GPUTokens::TOKEN_EXP:
+        case GPUTokens::TOKEN_LOG:
+        case GPUTokens::TOKEN_ABS:
+        {
+            if (stack.empty()) return false;
+            StackValue a = pop();
+            if (token == GPUTokens::TOKEN_NEG) push("-" + a.name, a.kind);
+            else if (token == GPUTokens::TOKEN_SIN) push("cSin(" + a.name + ")", VALUE_COMPLEX);
+            else if (token == GPUTokens::TOKEN_COS) push("cCos(" + a.name + ")", VALUE_COMPLEX);
+            else if (token == GPUTokens::TOKEN_TAN) push("cDiv(cSin(" + a.name + "), cCos(" + a.name + "))", VALUE_COMPLEX);
+            else if (token == GPUTokens::TOKEN_EXP) push("cExp(" + a.name + ")", VALUE_COMPLEX);
+            else if (token == GPUTokens::TOKEN_LOG) push("cLog(" + a.name + ")", VALUE_COMPLEX);
+            else push("vec2(length(" + a.name + "), 0.0)", VALUE_REAL);
+            break;
+        }
+
+        case GPUTokens::TOKEN_MUL_R:
+        case GPUTokens::TOKEN_DIV_R:
+        {
+            if (stack.size() < 2) return false;
+            StackValue b = pop();
+            StackValue a = pop();
+            if (token == GPUTokens::TOKEN_MUL_R) push("vec2(" + a.name + ".x * " + b.name + ".x, 0.0)", VALUE_REAL);
+            else push("vec2(realDivide(" + a.name + ".x, " + b.name + ".x), 0.0)", VALUE_REAL);
+            break;
+        }
+        case GPUTokens::TOKEN_SIN_R:
+        case GPUTokens::TOKEN_COS_R:
+        case GPUTokens::TOKEN_TAN_R:
+        case GPUTokens::TOKEN_EXP_R:
+        {
+            if (stack.empty()) return false;
+            StackValue a = pop();
+            const char* fn = token == GPUTokens::TOKEN_SIN_R ? "sin(" : token == GPUTokens::TOKEN_COS_R ? "cos(" :
+                             token == GPUTokens::TOKEN_EXP_R ? "safeExp(" : nullptr;
+            if (fn) push(std::string("vec2(") + fn + a.name + ".x), 0.0)", VALUE_REAL);
+            else push("vec2(realDivide(sin(" + a.name + ".x), cos(" + a.name + ".x)), 0.0)", VALUE_REAL);
+            break;
+        }
+
+        case GPUTokens::TOKEN_LEN2:
+        case GPUTokens::TOKEN_DOT2:
+        case GPUTokens::TOKEN_HYPOT:
+        case GPUTokens::TOKEN_INVCUBE:
+        case GPUTokens::TOKEN_RSQRT:
+        {
+            // OptimizeEquation() fuses real operands only, so their real parts are the operands
+            size_t count = token == GPUTokens::TOKEN_DOT2 ? 4 : token == GPUTokens::TOKEN_RSQRT ? 1 : 2;
+            if (stack.size() < count) return false;
+            std::vector<std::string> v(count);
+            for (size_t k = count; k-- > 0;) v[k] = pop().name + ".x";
+            std::string expr;
+            if (token == GPUTokens::TOKEN_DOT2) expr = v[0] + " * " + v[2] + " + " + v[1] + " * " + v[3];
+            else if (token == GPUTokens::TOKEN_RSQRT) expr = "realDivide(1.0, sqrt(max(" + v[0] + ", 0.0)))";
+            else
+            {
+                std::string s = v[0] + " * " + v[0] + " + " + v[1] + " * " + v[1];
+                if (token == GPUTokens::TOKEN_LEN2) expr = s;
+                else if (token == GPUTokens::TOKEN_HYPOT) expr = "sqrt(" + s + ")";
+                else
+                {
+                    push("vec2(" + s + ", 0.0)", VALUE_REAL);
+                    std::string len2 = pop().name + ".x";
+                    expr = "realDivide(1.0, " + len2 + " * sqrt(" + len2 + "))";
+                }
+            }
+            push("vec2(" + expr + ", 0.0)", VALUE_REAL);
+            break;
+        }
+
+        case GPUTokens::TOKEN_FLOOR:
+        case GPUTokens::TOKEN_CEIL:
+        case GPUTokens::TOKEN_FRAC:
+        case GPUTokens::TOKEN_SIGN:
+        case GPUTokens::TOKEN_STEP:
+        {
+            // Applied to real values only, complex values pass through
+            if (stack.empty()) return false;
+            StackValue a = pop();
+            const char* fn = token == GPUTokens::TOKEN_FLOOR ? "floor" : token == GPUTokens::TOKEN_CEIL ? "ceil" :
+                             token == GPUTokens::TOKEN_FRAC ? "fract" : token == GPUTokens::TOKEN_SIGN ? "signFunc" : "stepFunc";
+            if (a.kind == VALUE_EITHER) return false;
+            if (a.kind == VALUE_COMPLEX) stack.push_back(a);
+            else push(std::string("vec2(") + fn + "(" + a.name + ".x), 0.0)", VALUE_REAL);
+            break;
+        }
+
+        case GPUTokens::TOKEN_MOD:
+        case GPUTokens::TOKEN_MIN:
+        case GPUTokens::TOKEN_MAX:
+        case GPUTokens::TOKEN_ATAN2:
+        {
+            if (stack.size() < 2) return false;
+            StackValue b = pop();
+            StackValue a = pop();
+            // The interpreter reads raw stack floats here, which only matches for real operands
+            if (a.kind != VALUE_REAL || b.kind != VALUE_REAL) return false;
+            std::string expr;
+            if (token == GPUTokens::TOKEN_MOD)
+                expr = "(abs(" + b.name + ".x) < EPSILON) ? 0.0 : mod(" + a.name + ".x, " + b.name + ".x)";
+            else if (token == GPUTokens::TOKEN_MIN) expr = "min(" + a.name + ".x, " + b.name + ".x)";
+            else if (token == GPUTokens::TOKEN_MAX) expr = "max(" + a.name + ".x, " + b.name + ".x)";
+            else expr = "atan(" + a.name + ".x, " + b.name + ".x)";
+            push("vec2(" + expr + ", 0.0)", VALUE_REAL);
+            break;
+        }
+        case GPUTokens::TOKEN_CLAMP:
+        {
+            if (stack.size() < 3) return false;
+            StackValue maxVal = pop();
+            StackValue minVal = pop();
+            StackValue val = pop();
+            if (val.kind != VALUE_REAL || minVal.kind != VALUE_REAL || maxVal.kind != VALUE_REAL) return false;
+            push("vec2(clamp(" + val.name + ".x, " + minVal.name + ".x, " + maxVal.name + ".x), 0.0)", VALUE_REAL);
+            break;
+        }
+        case GPUTokens::TOKEN_TABLE:
+        {
+            if (stack.size() < 2) return false;
+            StackValue x = pop();
+            StackValue id = pop();
+            if (id.kind != VALUE_REAL || x.kind != VALUE_REAL) return false;
+            push("vec2(sampleTable(" + id.name + ".x, " + x.name + ".x), 0.0)", VALUE_REAL);
+            break;
+        }
+        case GPUTokens::TOKEN_FIELD:
+        {
+            if (stack.size() < 3) return false;
+            StackValue y = pop();
+            StackValue x = pop();
+            StackValue id = pop();
+            if (id.kind != VALUE_REAL || x.kind != VALUE_REAL || y.kind != VALUE_REAL) return false;
+            push("vec2(sampleField(" + id.name + ".x, " + x.name + ".x, " + y.name + ".x), 0.0)", VALUE_REAL);
+            break;
+        }
+
+        case GPUTokens::TOKEN_REAL:
+        {
+            if (stack.empty()) return false;
+            StackValue a = pop();
+            push("vec2(" + a.name + ".x, 0.0)", VALUE_REAL);
+            break;
+        }
+        case GPUTokens::TOKEN_IMAG:
+        {
+            if (stack.empty()) return false;
+            StackValue a = pop();
+            push("vec2(" + a.name + ".y, 0.0)", VALUE_REAL);
+            break;
+        }
+        case GPUTokens::TOKEN_CONJ:
+        {
+            if (stack.empty()) return false;
+            StackValue a = pop();
+            push("vec2(" + a.name + ".x, -" + a.name + ".y)", a.kind);
+            break;
+        }
+        case GPUTokens::TOKEN_ARG:
+        {
+            if (stack.empty()) return false;
+            StackValue a = pop();
+            if (a.kind == VALUE_EITHER) return false;
+            if (a.kind == VALUE_REAL) push("vec2((" + a.name + ".x >= 0.0) ? 0.0 : PI, 0.0)", VALUE_REAL);
+            else push("vec2(atan(" + a.name + ".y, " + a.name + ".x), 0.0)", VALUE_REAL);
+            break;
+        }
+
+        default:
+            // Parentheses, commas and unknown tokens are ignored by the interpreter as well
+            break;
+        }
+    }
+
+    if (!closeBranches(idx) || !branches.empty()) return false;
+
+    // The interpreter returns the real part of the bottom stack entry
+    result = stack.empty() ? "0.0" : stack.front().name + ".x";
+    tempKinds = kinds;
+    return true;
+}
+
+// ============================================================================
+// Generate the full block that replaces the stub in math.comp
+// ============================================================================
+std::string EquationCodegen::GenerateEquationBlock(const std::vector<int>& tokens,
+                                                   const std::vector<float>& constants,
+                                                   const std::vector<EquationMapping>& mappings,
+                                                   int numEquations)
+{
+    std::ostringstream functions;
+    std::ostringstream dispatch;
+    int compiledComponents = 0;
+    int interpretedComponents = 0;
+
+    numEquations = std::min(numEquations, static_cast<int>(mappings.size()));
+    for (int eqID = 0; eqID < numEquations; eqID++)
+    {
+        const EquationMapping& mapping = mappings[eqID];
+        bool any = false;
+        std::ostringstream cases;
+
+        // Kinds of the temporaries stored so far; interpreted components leave theirs unknown
+        std::vector<ValueKind> tempKinds(MAX_EQUATION_TEMPS, VALUE_EITHER);
+
+        for (int c = 0; c < 7; c++)
+        {
+            const ComponentSlot& slot = s_components[c];
+            int tokenOffset = mapping.*slot.tokenOffset;
+            int tokenCount = mapping.*slot.tokenCount;
+            int constantOffset = mapping.*slot.constantOffset;
+            if (tokenCount <= 0) continue;
+            any = true;
+
+            std::ostringstream body;
+            std::string result;
+            if (GenerateComponentBody(tokens, constants, tokenOffset, tokenCount, constantOffset, tempKinds, true, body, result))
+            {
+                std::string fn = "compiledEq" + std::to_string(eqID) + "_" + slot.suffix;
+                functions << "float " << fn << "(" << COMPONENT_PARAMS << ") {\n"
+                          << body.str()
+                          << "    return finishCompiledComponent(" << result << ", " << slot.componentType << ");\n"
+                          << "}\n\n";
+                cases << "        " << s_componentTargets[c] << " = " << fn << "(" << COMPONENT_ARGS << ");\n";
+                compiledComponents++;
+            }
+            else
+            {
+                cases << "        " << s_componentTargets[c] << " = evaluateEquationComponent(" << COMPONENT_ARGS << ", "
+                      << slot.componentType << ", " << tokenOffset << ", " << tokenCount << ", " << constantOffset
+                      << ", " << mapping.*slot.bytecodeOffset << ");  // interpreted\n";
+                interpretedComponents++;
+            }
+        }
+
+        if (any)
+            dispatch << "    case " << eqID << ":\n" << cases.str() << "        return true;\n";
+    }
+
+    std::ostringstream block;
+    block << BLOCK_BEGIN_MARKER << "\n"
+          << "// Generated: " << compiledComponents << " compiled component(s), "
+          << interpretedComponents << " interpreted\n\n"
+          << functions.str()
+          << "bool evaluateCompiledEquation(int eqID, " << COMPONENT_PARAMS << ",\n"
+          << "                              inout float ax, inout float ay, inout float angular_accel, inout vec4 new_color)\n"
+          << "{\n";
+    if (!dispatch.str().empty())
+        block << "    switch (eqID) {\n" << dispatch.str() << "    }\n";
+    block << "    return false;\n"
+          << "}\n"
+          << BLOCK_END_MARKER;
+    return block.str();
+}
+
+// ============================================================================
+// Generate a standalone function for one expression (object_reduction.comp, object_pipeline.comp)
+// ============================================================================
+static std::string GenerateFunction(const std::vector<int>& tokens, const std::vector<float>& constants,
+                                   const std::string& name, const std::string& params)
+{
+    std::vector<ValueKind> tempKinds(MAX_EQUATION_TEMPS, VALUE_EITHER);
+    std::ostringstream body;
+    std::string result;
+    if (!GenerateComponentBody(tokens, constants, 0, static_cast<int>(tokens.size()), 0, tempKinds, false, body, result))
+        return "";
+
+    std::ostringstream function;
+    function << "float " << name << "(" << params << ") {\n"
+             << body.str()
+             << "    return " << result << ";\n"
+             << "}\n";
+    return function.str();
+}
+
+std::string EquationCodegen::GenerateExpressionFunction(const std::vector<int>& tokens,
+                                                        const std::vector<float>& constants,
+                                                        const std::string& name)
+{
+    return GenerateFunction(tokens, constants, name, COMPONENT_PARAMS);
+}
+
+std::string EquationCodegen::GeneratePairBodyFunction(const std::vector<int>& tokens,
+                                                      const std::vector<float>& constants,
+                                                      const std::string& name)
+{
+    return GenerateFunction(tokens, constants, name, std::string(COMPONENT_PARAMS) + ", Object pj, int pjIndex");
+}
+
+std::string EquationCodegen::SpliceEquationBlock(const std::string& shaderSource, const std::string& block)
+{
+    size_t begin = shaderSource.find(BLOCK_BEGIN_MARKER);
+    if (begin == std::string::npos) return "";
+
+    const std::string endMarker(BLOCK_END_MARKER);
+    size_t end = shaderSource.find(endMarker, begin);
+    if (end == std::string::npos) return "";
+
+    return shaderSource.substr(0, begin) + block + shaderSource.substr(end + endMarker.size());
+}
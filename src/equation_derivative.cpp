@@ -0,0 +1,418 @@
+#include "equation_derivative.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+    // Operand count of every operator that may appear in a D() body
+    const std::unordered_map<TokenType, int> s_operatorArity = {
+        {TOKEN_ADD, 2}, {TOKEN_SUB, 2}, {TOKEN_MUL, 2}, {TOKEN_DIV, 2}, {TOKEN_POW, 2},
+        {TOKEN_MIN, 2}, {TOKEN_MAX, 2}, {TOKEN_MOD, 2}, {TOKEN_ATAN2, 2},
+        {TOKEN_CLAMP, 3}, {TOKEN_IF, 3},
+        {TOKEN_NEG, 1}, {TOKEN_SIN, 1}, {TOKEN_COS, 1}, {TOKEN_TAN, 1}, {TOKEN_SQRT, 1},
+        {TOKEN_LOG, 1}, {TOKEN_EXP, 1}, {TOKEN_ABS, 1}, {TOKEN_FLOOR, 1}, {TOKEN_CEIL, 1},
+        {TOKEN_FRAC, 1}, {TOKEN_SIGN, 1}, {TOKEN_STEP, 1}, {TOKEN_REAL, 1}, {TOKEN_IMAG, 1},
+        {TOKEN_CONJ, 1}, {TOKEN_ARG, 1}
+    };
+
+    // Operators evaluateDualDerivative() implements - MUST MATCH math.comp
+    const std::unordered_map<TokenType, int> s_dualOperators = {
+        {TOKEN_ADD, 2}, {TOKEN_SUB, 2}, {TOKEN_MUL, 2}, {TOKEN_DIV, 2}, {TOKEN_POW, 2},
+        {TOKEN_NEG, 1}, {TOKEN_SIN, 1}, {TOKEN_COS, 1}, {TOKEN_TAN, 1}, {TOKEN_SQRT, 1},
+        {TOKEN_LOG, 1}, {TOKEN_EXP, 1}, {TOKEN_ABS, 1}
+    };
+
+    // The dual evaluator takes the body as serialized: leaves carry their operands
+    bool fitsDualEvaluator(const std::vector<Token>& rpn)
+    {
+        int serializedSize = 0;
+        int depth = 0;
+        int maxDepth = 0;
+        for (const Token& token : rpn)
+        {
+            if (token.type == TOKEN_NUMBER || token.type == TOKEN_VARIABLE)
+            {
+                serializedSize += 2;
+                depth++;
+            }
+            else if (token.type == TOKEN_OBJECT_REF)
+            {
+                serializedSize += 3;
+                depth++;
+            }
+            else
+            {
+                auto arity = s_dualOperators.find(token.type);
+                if (arity == s_dualOperators.end() || depth < arity->second) return false;
+                serializedSize += 1;
+                depth -= arity->second - 1;
+            }
+            maxDepth = std::max(maxDepth, depth);
+        }
+        return depth == 1 && serializedSize <= MAX_SYMBOLIC_DERIVATIVE_TOKENS && maxDepth <= MAX_DUAL_DERIVATIVE_DEPTH;
+    }
+
+    struct DerivNode
+    {
+        Token token;
+        std::vector<int> children;
+    };
+
+    // Hash-consed expression DAG with simplifying constructors; derivatives are
+    // memoized per node, so a shared subtree is differentiated once
+    class DerivativeGraph
+    {
+    public:
+        explicit DerivativeGraph(SymbolId wrt) : m_wrt(wrt) {}
+
+        // Root node of an RPN expression, or -1 if it cannot be differentiated
+        int Build(const std::vector<Token>& rpn)
+        {
+            std::vector<int> stack;
+            for (const Token& token : rpn)
+            {
+                if (token.type == TOKEN_NUMBER || token.type == TOKEN_VARIABLE || token.type == TOKEN_OBJECT_REF)
+                {
+                    stack.push_back(Leaf(token));
+                    continue;
+                }
+
+                // Nested D() has been expanded already; numerical ones, pair terms and temporaries stay opaque
+                auto arity = s_operatorArity.find(token.type);
+                if (arity == s_operatorArity.end() || static_cast<int>(stack.size()) < arity->second) return -1;
+
+                std::vector<int> children(stack.end() - arity->second, stack.end());
+                stack.resize(stack.size() - arity->second);
+                stack.push_back(Op(token.type, children));
+            }
+            return (stack.size() == 1) ? stack.back() : -1;
+        }
+
+        int Derive(int id)
+        {
+            auto memo = m_derivatives.find(id);
+            if (memo != m_derivatives.end()) return memo->second;
+
+            int result = DeriveNode(id);
+            m_derivatives[id] = result;
+            return result;
+        }
+
+        // Append the RPN of a node; false once the limits are exceeded
+        bool Emit(int id, std::vector<Token>& out, int depth, int& maxDepth)
+        {
+            const DerivNode& node = m_nodes[id];
+            for (size_t c = 0; c < node.children.size(); c++)
+            {
+                if (!Emit(node.children[c], out, depth + static_cast<int>(c), maxDepth)) return false;
+            }
+            out.push_back(node.token);
+            maxDepth = std::max(maxDepth, depth + 1);
+            return static_cast<int>(out.size()) <= MAX_SYMBOLIC_DERIVATIVE_TOKENS &&
+                   maxDepth <= MAX_SYMBOLIC_DERIVATIVE_DEPTH;
+        }
+
+    private:
+        int Intern(const Token& token, const std::vector<int>& children)
+        {
+            std::string key = std::to_string(static_cast<int>(token.type)) + ":";
+            if (token.type == TOKEN_NUMBER)
+            {
+                uint32_t bits;
+                std::memcpy(&bits, &token.numeric_value, sizeof(bits));
+                key += std::to_string(bits);
+            }
+            else if (token.type == TOKEN_VARIABLE)
+            {
+                key += std::to_string(token.variable);
+            }
+            else if (token.type == TOKEN_OBJECT_REF)
+            {
+                key += std::to_string(token.object_type) + "[" + std::to_string(token.object_index) + "]." +
+                       std::to_string(token.object_property);
+            }
+            for (int child : children) key += "," + std::to_string(child);
+
+            auto it = m_index.find(key);
+            if (it != m_index.end()) return it->second;
+
+            m_nodes.push_back({ token, children });
+            int id = static_cast<int>(m_nodes.size()) - 1;
+            m_index[key] = id;
+            return id;
+        }
+
+        int Leaf(const Token& token) { return Intern(token, {}); }
+        int Num(float value) { return Intern(Token(TOKEN_NUMBER, value), {}); }
+
+        bool IsNumber(int id, float value) const
+        {
+            return m_nodes[id].token.type == TOKEN_NUMBER && m_nodes[id].token.numeric_value == value;
+        }
+
+        bool NumberValue(int id, float& value) const
+        {
+            if (m_nodes[id].token.type != TOKEN_NUMBER) return false;
+            value = m_nodes[id].token.numeric_value;
+            return true;
+        }
+
+        // Arithmetic constructors drop the zeros and ones derivative rules produce
+        int Add(int a, int b)
+        {
+            float va, vb;
+            if (NumberValue(a, va) && NumberValue(b, vb)) return Num(va + vb);
+            if (IsNumber(a, 0.0f)) return b;
+            if (IsNumber(b, 0.0f)) return a;
+            return Intern(Token(TOKEN_ADD), { a, b });
+        }
+
+        int Sub(int a, int b)
+        {
+            float va, vb;
+            if (NumberValue(a, va) && NumberValue(b, vb)) return Num(va - vb);
+            if (IsNumber(b, 0.0f)) return a;
+            if (IsNumber(a, 0.0f)) return Neg(b);
+            if (a == b) return Num(0.0f);
+            return Intern(Token(TOKEN_SUB), { a, b });
+        }
+
+        int Mul(int a, int b)
+        {
+            float va, vb;
+            if (NumberValue(a, va) && NumberValue(b, vb)) return Num(va * vb);
+            if (IsNumber(a, 0.0f) || IsNumber(b, 0.0f)) return Num(0.0f);
+            if (IsNumber(a, 1.0f)) return b;
+            if (IsNumber(b, 1.0f)) return a;
+            if (IsNumber(a, -1.0f)) return Neg(b);
+            if (IsNumber(b, -1.0f)) return Neg(a);
+            return Intern(Token(TOKEN_MUL), { a, b });
+        }
+
+        int Div(int a, int b)
+        {
+            if (IsNumber(a, 0.0f)) return Num(0.0f);
+            if (IsNumber(b, 1.0f)) return a;
+            return Intern(Token(TOKEN_DIV), { a, b });
+        }
+
+        int Neg(int a)
+        {
+            float va;
+            if (NumberValue(a, va)) return Num(-va);
+            if (m_nodes[a].token.type == TOKEN_NEG) return m_nodes[a].children[0];
+            return Intern(Token(TOKEN_NEG), { a });
+        }
+
+        int Op(TokenType type, const std::vector<int>& children)
+        {
+            switch (type)
+            {
+            case TOKEN_ADD: return Add(children[0], children[1]);
+            case TOKEN_SUB: return Sub(children[0], children[1]);
+            case TOKEN_MUL: return Mul(children[0], children[1]);
+            case TOKEN_DIV: return Div(children[0], children[1]);
+            case TOKEN_NEG: return Neg(children[0]);
+            default:        return Intern(Token(type), children);
+            }
+        }
+
+        int Fn(TokenType type, int a) { return Op(type, { a }); }
+
+        // b' + step(b - a) * (a' - b'): a' where the selector picks a
+        int Select(int chooseA, int da, int db)
+        {
+            if (da == db) return da;
+            return Add(db, Mul(Fn(TOKEN_STEP, chooseA), Sub(da, db)));
+        }
+
+        int DeriveNode(int id)
+        {
+            // Copy: the constructors below may grow m_nodes
+            const Token token = m_nodes[id].token;
+            const std::vector<int> c = m_nodes[id].children;
+
+            switch (token.type)
+            {
+            case TOKEN_NUMBER:
+            case TOKEN_OBJECT_REF:
+                return Num(0.0f);
+            case TOKEN_VARIABLE:
+                return Num(token.variable == m_wrt ? 1.0f : 0.0f);
+            case TOKEN_IF:
+            {
+                // if(c, a, b)' = if(c, a', b'); the condition is piecewise constant
+                int da = Derive(c[1]);
+                int db = Derive(c[2]);
+                if (da < 0 || db < 0) return -1;
+                if (da == db) return da;
+                return Intern(Token(TOKEN_IF), { c[0], da, db });
+            }
+            default:
+                break;
+            }
+
+            std::vector<int> d;
+            for (int child : c)
+            {
+                d.push_back(Derive(child));
+                if (d.back() < 0) return -1;
+            }
+
+            switch (token.type)
+            {
+            case TOKEN_ADD: return Add(d[0], d[1]);
+            case TOKEN_SUB: return Sub(d[0], d[1]);
+            case TOKEN_NEG: return Neg(d[0]);
+            case TOKEN_MUL: return Add(Mul(d[0], c[1]), Mul(c[0], d[1]));
+            case TOKEN_DIV:
+                // (a' - (a/b) b') / b keeps the divisor guard of a/b itself
+                return Div(Sub(d[0], Mul(id, d[1])), c[1]);
+            case TOKEN_POW:
+                if (IsNumber(d[1], 0.0f))
+                    return Mul(Mul(c[1], Op(TOKEN_POW, { c[0], Sub(c[1], Num(1.0f)) })), d[0]);
+                return Mul(id, Add(Mul(d[1], Fn(TOKEN_LOG, c[0])), Div(Mul(c[1], d[0]), c[0])));
+            case TOKEN_SIN:  return Mul(Fn(TOKEN_COS, c[0]), d[0]);
+            case TOKEN_COS:  return Neg(Mul(Fn(TOKEN_SIN, c[0]), d[0]));
+            case TOKEN_TAN:  return Mul(Add(Num(1.0f), Mul(id, id)), d[0]);
+            case TOKEN_SQRT: return Div(Mul(Num(0.5f), d[0]), id);
+            case TOKEN_LOG:  return Div(d[0], c[0]);
+            case TOKEN_EXP:  return Mul(id, d[0]);
+            case TOKEN_ABS:
+                if (IsNumber(d[0], 0.0f)) return d[0];
+                return Div(Fn(TOKEN_REAL, Mul(Fn(TOKEN_CONJ, c[0]), d[0])), id);
+            case TOKEN_FLOOR:
+            case TOKEN_CEIL:
+            case TOKEN_SIGN:
+            case TOKEN_STEP:
+                return Num(0.0f);
+            case TOKEN_FRAC: return d[0];
+            case TOKEN_REAL: return Fn(TOKEN_REAL, d[0]);
+            case TOKEN_IMAG: return Fn(TOKEN_IMAG, d[0]);
+            case TOKEN_CONJ: return Fn(TOKEN_CONJ, d[0]);
+            case TOKEN_ARG:
+                if (IsNumber(d[0], 0.0f)) return d[0];
+                return Fn(TOKEN_IMAG, Div(d[0], c[0]));
+            case TOKEN_MOD:
+                // a - b floor(a/b)
+                return Sub(d[0], Mul(d[1], Fn(TOKEN_FLOOR, Div(c[0], c[1]))));
+            case TOKEN_ATAN2:
+                // atan2(y, x)' = (x y' - y x') / (x^2 + y^2)
+                if (IsNumber(d[0], 0.0f) && IsNumber(d[1], 0.0f)) return d[0];
+                return Div(Sub(Mul(c[1], d[0]), Mul(c[0], d[1])), Add(Mul(c[0], c[0]), Mul(c[1], c[1])));
+            case TOKEN_MIN: return Select(Sub(c[1], c[0]), d[0], d[1]);
+            case TOKEN_MAX: return Select(Sub(c[0], c[1]), d[0], d[1]);
+            case TOKEN_CLAMP:
+            {
+                // min(max(x, lo), hi)
+                int lower = Op(TOKEN_MAX, { c[0], c[1] });
+                int dLower = Select(Sub(c[0], c[1]), d[0], d[1]);
+                return Select(Sub(c[2], lower), dLower, d[2]);
+            }
+            default:
+                return -1;
+            }
+        }
+
+        SymbolId m_wrt;
+        std::vector<DerivNode> m_nodes;
+        std::unordered_map<std::string, int> m_index;
+        std::unordered_map<int, int> m_derivatives;
+    };
+
+    // nested: the tokens are a D() body; the GPU evaluators do not nest, so D() in
+    // there is expanded whatever method it asked for
+    void expandTokens(std::vector<Token>& tokens, bool nested)
+    {
+        std::vector<Token> expanded;
+        expanded.reserve(tokens.size());
+        for (Token& token : tokens)
+        {
+            if (token.type != TOKEN_DERIVATIVE)
+            {
+                expanded.push_back(token);
+                continue;
+            }
+
+            expandTokens(token.derivative_expr_tokens, true);
+
+            // The GPU D() evaluators do not branch, so a body with if() is always expanded
+            bool branches = std::any_of(token.derivative_expr_tokens.begin(), token.derivative_expr_tokens.end(),
+                                        [](const Token& t) { return t.type == TOKEN_IF; });
+
+            DerivativeMethod method = token.derivative_method;
+            std::vector<Token> derivative;
+            if (nested || method == DERIV_METHOD_SYMBOLIC || branches)
+            {
+                if (DifferentiateRPN(token.derivative_expr_tokens, token.derivative_wrt, token.derivative_order, derivative))
+                {
+                    expanded.insert(expanded.end(), derivative.begin(), derivative.end());
+                    continue;
+                }
+                if (branches)
+                    throw std::runtime_error("D() of an expression with if() must expand symbolically, and this one "
+                                             "is too large or uses an operator without a derivative rule");
+                method = DERIV_METHOD_DUAL;  // Too large to expand, but the body itself may be walked
+            }
+
+            // The GPU takes the last derivative; the ones before it go into the body
+            Token walked = token;
+            if (walked.derivative_order > 1 &&
+                DifferentiateRPN(token.derivative_expr_tokens, token.derivative_wrt, token.derivative_order - 1,
+                                 walked.derivative_expr_tokens))
+            {
+                walked.derivative_order = 1;
+            }
+
+            if (method == DERIV_METHOD_DUAL && !fitsDualEvaluator(walked.derivative_expr_tokens))
+            {
+                // Operators the dual walk lacks: expand it after all, or leave it to central differences
+                if (token.derivative_method == DERIV_METHOD_DUAL &&
+                    DifferentiateRPN(token.derivative_expr_tokens, token.derivative_wrt, token.derivative_order, derivative))
+                {
+                    expanded.insert(expanded.end(), derivative.begin(), derivative.end());
+                    continue;
+                }
+                method = DERIV_METHOD_NUMERICAL;
+            }
+            walked.derivative_method = method;
+            expanded.push_back(walked);
+        }
+        tokens.swap(expanded);
+    }
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+bool DifferentiateRPN(const std::vector<Token>& rpn, SymbolId wrt, int order, std::vector<Token>& out)
+{
+    std::vector<Token> body = rpn;
+    expandTokens(body, true);
+
+    DerivativeGraph graph(wrt);
+    int root = graph.Build(body);
+    for (int o = 0; o < order && root >= 0; o++) root = graph.Derive(root);
+    if (root < 0) return false;
+
+    std::vector<Token> tokens;
+    int maxDepth = 0;
+    if (!graph.Emit(root, tokens, 0, maxDepth)) return false;
+
+    out.swap(tokens);
+    return true;
+}
+
+void ExpandSymbolicDerivatives(ParsedEquation& equation)
+{
+    for (auto* tokens : { &equation.tokens_ax, &equation.tokens_ay, &equation.tokens_angular,
+                          &equation.tokens_r, &equation.tokens_g, &equation.tokens_b, &equation.tokens_a })
+    {
+        expandTokens(*tokens, false);
+    }
+    for (auto& tokens : equation.tokens_state) expandTokens(tokens, false);
+}
@@ -0,0 +1,531 @@
+#include "equation_optimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    // Shader constants the folded values have to agree with - MUST MATCH math.comp
+    const float SHADER_PI = 3.14159265359f;
+    const float SHADER_E = 2.71828182846f;
+    const float SHADER_EPSILON = 1e-6f;
+    const float SHADER_SAFE_MAX_EXP = 50.0f;
+
+    // Operand count of every operator; anything else that may appear in RPN is a leaf
+    const std::unordered_map<TokenType, int> s_operatorArity = {
+        {TOKEN_ADD, 2}, {TOKEN_SUB, 2}, {TOKEN_MUL, 2}, {TOKEN_DIV, 2}, {TOKEN_POW, 2},
+        {TOKEN_MIN, 2}, {TOKEN_MAX, 2}, {TOKEN_MOD, 2}, {TOKEN_ATAN2, 2}, {TOKEN_TABLE, 2},
+        {TOKEN_CLAMP, 3}, {TOKEN_FIELD, 3}, {TOKEN_IF, 3},
+        {TOKEN_NEG, 1}, {TOKEN_SIN, 1}, {TOKEN_COS, 1}, {TOKEN_TAN, 1}, {TOKEN_SQRT, 1},
+        {TOKEN_LOG, 1}, {TOKEN_EXP, 1}, {TOKEN_ABS, 1}, {TOKEN_FLOOR, 1}, {TOKEN_CEIL, 1},
+        {TOKEN_FRAC, 1}, {TOKEN_SIGN, 1}, {TOKEN_STEP, 1}, {TOKEN_REAL, 1}, {TOKEN_IMAG, 1},
+        {TOKEN_CONJ, 1}, {TOKEN_ARG, 1},
+        {TOKEN_LEN2, 2}, {TOKEN_DOT2, 4}, {TOKEN_HYPOT, 2}, {TOKEN_INVCUBE, 2}, {TOKEN_RSQRT, 1}
+    };
+
+    bool isLeafType(TokenType type)
+    {
+        return type == TOKEN_NUMBER || type == TOKEN_VARIABLE || type == TOKEN_OBJECT_REF ||
+               type == TOKEN_PAIR_REF || type == TOKEN_DERIVATIVE || type == TOKEN_PAIR_SUM;
+    }
+
+    // Leaves that are a single buffer or uniform read; D() and pair reductions are not
+    bool isCheapLeaf(const Token& token)
+    {
+        return token.type == TOKEN_NUMBER || token.type == TOKEN_VARIABLE ||
+               token.type == TOKEN_OBJECT_REF || token.type == TOKEN_PAIR_REF;
+    }
+
+    std::string floatKey(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        char buffer[16];
+        std::snprintf(buffer, sizeof(buffer), "%08x", bits);
+        return buffer;
+    }
+
+    // Structural identity of a token, including the bodies of D() and pair reductions
+    std::string tokenKey(const Token& token)
+    {
+        std::string key = std::to_string(static_cast<int>(token.type)) + ":";
+        switch (token.type)
+        {
+        case TOKEN_NUMBER:
+            return key + floatKey(token.numeric_value);
+        case TOKEN_VARIABLE:
+            return key + std::to_string(token.variable);
+        case TOKEN_OBJECT_REF:
+            return key + std::to_string(token.object_type) + "[" + std::to_string(token.object_index) + "]." +
+                   std::to_string(token.object_property);
+        case TOKEN_PAIR_REF:
+            return key + std::to_string(token.object_property);
+        case TOKEN_DERIVATIVE:
+            key += std::to_string(token.derivative_wrt) + "," + std::to_string(token.derivative_order) + "," +
+                   std::to_string(static_cast<int>(token.derivative_method)) + "{";
+            for (const Token& body : token.derivative_expr_tokens) key += tokenKey(body) + " ";
+            return key + "}";
+        case TOKEN_PAIR_SUM:
+            key += std::to_string(static_cast<int>(token.pair_reduction)) + "," + floatKey(token.pair_radius) + "{";
+            for (const Token& body : token.pair_expr_tokens) key += tokenKey(body) + " ";
+            return key + "}";
+        default:
+            return key;
+        }
+    }
+
+    // Evaluate an operator on literal operands the way the shader does for real values.
+    // Returns false where the shader result would be complex, or is not finite.
+    bool foldOperator(TokenType type, const float* v, float& result)
+    {
+        auto realDivide = [](float a, float b) { return (b * b < SHADER_EPSILON) ? 0.0f : a / b; };
+
+        switch (type)
+        {
+        case TOKEN_ADD:   result = v[0] + v[1]; break;
+        case TOKEN_SUB:   result = v[0] - v[1]; break;
+        case TOKEN_MUL:   result = v[0] * v[1]; break;
+        case TOKEN_DIV:   result = realDivide(v[0], v[1]); break;
+        case TOKEN_NEG:   result = -v[0]; break;
+        case TOKEN_POW:
+            // Non-positive bases go through the complex power on the GPU
+            if (v[0] <= 0.0f) return false;
+            result = std::pow(v[0], v[1]);
+            break;
+        case TOKEN_SIN:   result = std::sin(v[0]); break;
+        case TOKEN_COS:   result = std::cos(v[0]); break;
+        case TOKEN_TAN:   result = realDivide(std::sin(v[0]), std::cos(v[0])); break;
+        case TOKEN_EXP:   result = std::exp(std::min(std::max(v[0], -SHADER_SAFE_MAX_EXP), SHADER_SAFE_MAX_EXP)); break;
+        case TOKEN_LOG:
+            if (v[0] <= 0.0f) return false;
+            result = std::log(v[0]);
+            break;
+        case TOKEN_SQRT:
+            if (v[0] < 0.0f) return false;
+            result = std::sqrt(v[0]);
+            break;
+        case TOKEN_ABS:   result = std::fabs(v[0]); break;
+        case TOKEN_FLOOR: result = std::floor(v[0]); break;
+        case TOKEN_CEIL:  result = std::ceil(v[0]); break;
+        case TOKEN_FRAC:  result = v[0] - std::floor(v[0]); break;
+        case TOKEN_SIGN:  result = (v[0] > 0.0f) ? 1.0f : ((v[0] < 0.0f) ? -1.0f : 0.0f); break;
+        case TOKEN_STEP:  result = (v[0] >= 0.0f) ? 1.0f : 0.0f; break;
+        case TOKEN_REAL:
+        case TOKEN_CONJ:  result = v[0]; break;
+        case TOKEN_IMAG:  result = 0.0f; break;
+        case TOKEN_ARG:   result = (v[0] >= 0.0f) ? 0.0f : SHADER_PI; break;
+        case TOKEN_MIN:   result = (v[1] < v[0]) ? v[1] : v[0]; break;
+        case TOKEN_MAX:   result = (v[0] < v[1]) ? v[1] : v[0]; break;
+        case TOKEN_MOD:
+            result = (std::fabs(v[1]) < SHADER_EPSILON) ? 0.0f : v[0] - v[1] * std::floor(v[0] / v[1]);
+            break;
+        case TOKEN_ATAN2: result = std::atan2(v[0], v[1]); break;
+        case TOKEN_CLAMP: result = std::min(std::max(v[0], v[1]), v[2]); break;
+        default:
+            return false;
+        }
+        return std::isfinite(result);
+    }
+
+    struct ExprNode
+    {
+        Token token;                // Operator, or leaf with its body already optimized
+        std::vector<int> children;
+        int uses = 0;               // References from parent nodes and component roots
+        int tempSlot = -1;          // Assigned when the first occurrence is emitted
+        bool real = false;          // Provably no imaginary part, for every operand value
+        bool nonNegative = false;   // Real and provably >= 0
+        bool invariant = false;     // Reads no object, only literals and per-world uniforms
+        int preludeSlot = -1;       // Assigned when the first hoisted occurrence is emitted
+    };
+
+    // Hash-consed expression DAG: structurally equal subtrees share one node
+    class ExpressionGraph
+    {
+    public:
+        // shareSubtrees: emit repeated subtrees through temporaries (top-level components only)
+        // fullInterpreter: the expression runs on the interpreters that implement TOKEN_SQRT and
+        // the fused intrinsics; D() bodies run on the dual-number evaluators, which do not
+        ExpressionGraph(bool shareSubtrees, bool fullInterpreter)
+            : m_shareSubtrees(shareSubtrees), m_fullInterpreter(fullInterpreter) {}
+
+        // Root node of an RPN expression, or -1 if it is not a single well-formed expression
+        int Build(const std::vector<Token>& rpn)
+        {
+            std::vector<int> stack;
+            for (const Token& token : rpn)
+            {
+                if (isLeafType(token.type))
+                {
+                    stack.push_back(MakeLeaf(token));
+                    continue;
+                }
+
+                auto arity = s_operatorArity.find(token.type);
+                if (arity == s_operatorArity.end() || static_cast<int>(stack.size()) < arity->second) return -1;
+
+                std::vector<int> children(stack.end() - arity->second, stack.end());
+                stack.resize(stack.size() - arity->second);
+                stack.push_back(MakeOperator(token, children));
+            }
+            return (stack.size() == 1) ? stack.back() : -1;
+        }
+
+        void CountUses(int id)
+        {
+            // Children are counted once per distinct parent, so a shared parent evaluates them once
+            if (m_nodes[id].uses++ > 0) return;
+            for (int child : m_nodes[id].children) CountUses(child);
+        }
+
+        // conditional: inside an if() branch, which may not run, so nothing is stored there.
+        // prelude: inside a hoisted body, which the prelude pass evaluates on its own, without
+        // the temporaries of the components
+        void Emit(int id, std::vector<Token>& out, int& nextTempSlot, bool conditional = false, bool prelude = false)
+        {
+            ExprNode& node = m_nodes[id];
+            if (!prelude && (node.preludeSlot >= 0 || (Hoistable(node) && m_nextPreludeSlot < MAX_PRELUDE_SLOTS)))
+            {
+                // Every occurrence keeps its body, read from the slot where the prelude ran
+                if (node.preludeSlot < 0) node.preludeSlot = m_nextPreludeSlot++;
+                int slot = node.preludeSlot;
+                for (size_t c = 0; c < node.children.size(); c++) Emit(node.children[c], out, nextTempSlot, true, true);
+                out.push_back(node.token);
+                Token hoist(TOKEN_HOIST);
+                hoist.temp_slot = slot;
+                out.push_back(hoist);
+                return;
+            }
+            if (!prelude && node.tempSlot >= 0)
+            {
+                Token load(TOKEN_TEMP_LOAD);
+                load.temp_slot = node.tempSlot;
+                out.push_back(load);
+                return;
+            }
+
+            // The condition of an if() always runs, its branches only when taken
+            for (size_t c = 0; c < node.children.size(); c++)
+                Emit(node.children[c], out, nextTempSlot, conditional || (node.token.type == TOKEN_IF && c > 0), prelude);
+            out.push_back(node.token);
+
+            bool worthSharing = !node.children.empty() || !isCheapLeaf(node.token);
+            if (m_shareSubtrees && !conditional && !prelude && node.uses > 1 && worthSharing && nextTempSlot < MAX_EQUATION_TEMPS)
+            {
+                // Leaves the value on the stack, so the first occurrence still consumes it
+                m_nodes[id].tempSlot = nextTempSlot++;
+                Token store(TOKEN_TEMP_STORE);
+                store.temp_slot = m_nodes[id].tempSlot;
+                out.push_back(store);
+            }
+        }
+
+    private:
+        // Invariant real subtrees of top-level components, except a single add, subtract,
+        // multiply or negation of leaves, which costs about as much as the prelude read
+        bool Hoistable(const ExprNode& node) const
+        {
+            if (!m_shareSubtrees || !node.invariant || !node.real || node.children.empty()) return false;
+            TokenType type = node.token.type;
+            if (type != TOKEN_ADD && type != TOKEN_SUB && type != TOKEN_MUL && type != TOKEN_NEG) return true;
+            for (int child : node.children)
+                if (!m_nodes[child].children.empty()) return true;
+            return false;
+        }
+
+        int Intern(const Token& token, const std::vector<int>& children, const std::string& key)
+        {
+            auto it = m_index.find(key);
+            if (it != m_index.end()) return it->second;
+
+            ExprNode node;
+            node.token = token;
+            node.children = children;
+            Classify(node);
+            m_nodes.push_back(node);
+            int id = static_cast<int>(m_nodes.size()) - 1;
+            m_index[key] = id;
+            return id;
+        }
+
+        int MakeNumber(float value)
+        {
+            Token token(TOKEN_NUMBER, value);
+            return Intern(token, {}, tokenKey(token));
+        }
+
+        int MakeLeaf(const Token& source)
+        {
+            Token token = source;
+            if (token.type == TOKEN_DERIVATIVE)
+                token.derivative_expr_tokens = OptimizeBody(token.derivative_expr_tokens, false);
+            else if (token.type == TOKEN_PAIR_SUM)
+                token.pair_expr_tokens = OptimizeBody(token.pair_expr_tokens, true);
+            return Intern(token, {}, tokenKey(token));
+        }
+
+        int MakeOperator(const Token& token, std::vector<int> children)
+        {
+            // Constant folding
+            float values[3];
+            bool allConstant = true;
+            for (size_t c = 0; c < children.size(); c++)
+                allConstant = allConstant && ConstantValue(children[c], values[c]);
+            float folded;
+            if (allConstant && foldOperator(token.type, values, folded)) return MakeNumber(folded);
+
+            // An if() on a literal condition, or with equal branches, is the branch itself
+            float condition;
+            if (token.type == TOKEN_IF && ConstantValue(children[0], condition))
+                return condition > 0.0f ? children[1] : children[2];
+            if (token.type == TOKEN_IF && children[1] == children[2]) return children[1];
+
+            // Strength reduction of literal powers
+            float exponent;
+            if (token.type == TOKEN_POW && ConstantValue(children[1], exponent))
+            {
+                int base = children[0];
+                if (exponent == 1.0f) return base;
+                if (exponent == 0.0f) return MakeNumber(1.0f);
+                // x*x re-reads x; without temporaries only a cheap leaf can be read twice
+                if (exponent == 2.0f && (m_shareSubtrees || isCheapLeaf(m_nodes[base].token)))
+                    return MakeOperator(Token(TOKEN_MUL), { base, base });
+                if (exponent == 0.5f && m_fullInterpreter)
+                    return MakeOperator(Token(TOKEN_SQRT), { base });
+            }
+
+            // Addition and multiplication commute exactly, so order operands canonically
+            if (token.type == TOKEN_ADD || token.type == TOKEN_MUL || token.type == TOKEN_LEN2 ||
+                token.type == TOKEN_HYPOT || token.type == TOKEN_INVCUBE)
+                std::sort(children.begin(), children.end());
+
+            if (m_fullInterpreter)
+            {
+                int fused = FuseIntrinsic(token.type, children);
+                if (fused >= 0) return fused;
+            }
+
+            std::string key = std::to_string(static_cast<int>(token.type)) + "(";
+            for (int child : children) key += std::to_string(child) + ",";
+            return Intern(Token(token.type), children, key + ")");
+        }
+
+        // Whether every value of the node is real (and >= 0), from its operator and operands. The
+        // interpreters keep real operands of ADD/SUB/MUL/DIV/NEG/trig/exp real, take a power or
+        // square root of a non-negative real as a real, and read only the real parts elsewhere.
+        void Classify(ExprNode& node) const
+        {
+            static const SymbolId imaginary = internSymbol("i");
+            auto real = [&](size_t c) { return m_nodes[node.children[c]].real; };
+            auto nonNegative = [&](size_t c) { return m_nodes[node.children[c]].nonNegative; };
+            bool allReal = true;
+            for (size_t c = 0; c < node.children.size(); c++) allReal = allReal && real(c);
+
+            // Variables the prelude pass sets the way the per-object pass does
+            static const SymbolId uniforms[] = {
+                internSymbol("t"), internSymbol("pi"), internSymbol("e"), internSymbol("k"), internSymbol("damping"),
+                internSymbol("gravity"), internSymbol("coupling"), internSymbol("freq"), internSymbol("amp")
+            };
+            if (node.token.type == TOKEN_NUMBER)
+                node.invariant = true;
+            else if (node.token.type == TOKEN_VARIABLE)
+                node.invariant = std::find(std::begin(uniforms), std::end(uniforms), node.token.variable) != std::end(uniforms);
+            else if (!isLeafType(node.token.type))
+            {
+                node.invariant = true;
+                for (int child : node.children) node.invariant = node.invariant && m_nodes[child].invariant;
+            }
+
+            switch (node.token.type)
+            {
+            case TOKEN_NUMBER:
+                node.real = true;
+                node.nonNegative = node.token.numeric_value >= 0.0f;
+                break;
+            case TOKEN_VARIABLE:
+                node.real = node.token.variable != imaginary;
+                break;
+            case TOKEN_OBJECT_REF: case TOKEN_PAIR_REF: case TOKEN_PAIR_SUM:
+            case TOKEN_MIN: case TOKEN_MAX: case TOKEN_MOD: case TOKEN_ATAN2: case TOKEN_CLAMP:
+            case TOKEN_TABLE: case TOKEN_FIELD: case TOKEN_REAL: case TOKEN_IMAG: case TOKEN_ARG:
+            case TOKEN_DOT2:
+                node.real = true;
+                break;
+            case TOKEN_ABS: case TOKEN_LEN2: case TOKEN_HYPOT: case TOKEN_INVCUBE: case TOKEN_RSQRT:
+                node.real = node.nonNegative = true;
+                break;
+            case TOKEN_SUB: case TOKEN_DIV: case TOKEN_NEG: case TOKEN_SIN: case TOKEN_COS: case TOKEN_TAN:
+            case TOKEN_FLOOR: case TOKEN_CEIL: case TOKEN_FRAC: case TOKEN_SIGN: case TOKEN_STEP: case TOKEN_CONJ:
+                node.real = allReal;
+                break;
+            case TOKEN_ADD:
+                node.real = allReal;
+                node.nonNegative = nonNegative(0) && nonNegative(1);
+                break;
+            case TOKEN_MUL:
+                node.real = allReal;
+                node.nonNegative = allReal && (node.children[0] == node.children[1] || (nonNegative(0) && nonNegative(1)));
+                break;
+            case TOKEN_EXP:
+                node.real = node.nonNegative = allReal;
+                break;
+            case TOKEN_POW:
+                node.real = node.nonNegative = nonNegative(0) && real(1);
+                break;
+            case TOKEN_SQRT:
+                node.real = node.nonNegative = nonNegative(0);
+                break;
+            case TOKEN_IF:
+                node.real = real(1) && real(2);
+                node.nonNegative = nonNegative(1) && nonNegative(2);
+                break;
+            default:
+                break;  // D() and log() may be complex
+            }
+        }
+
+        // a for a real a*a, or for a^2 left as a power of a real a
+        int SquaredOperand(int id) const
+        {
+            const ExprNode& node = m_nodes[id];
+            float exponent;
+            if (node.token.type == TOKEN_MUL && node.children[0] == node.children[1] && node.real)
+                return node.children[0];
+            if (node.token.type == TOKEN_POW && m_nodes[node.children[0]].real &&
+                ConstantValue(node.children[1], exponent) && exponent == 2.0f)
+                return node.children[0];
+            return -1;
+        }
+
+        // Fused intrinsic equal to the operator on these operands, or -1. Each replaces several
+        // interpreted tokens, and the complex power of (dx*dx + dy*dy)^1.5, with one real ALU
+        // sequence; the zero guards are those of the division or power it replaces.
+        int FuseIntrinsic(TokenType type, const std::vector<int>& children)
+        {
+            auto is = [&](int id, TokenType t) { return m_nodes[id].token.type == t; };
+            float exponent;
+
+            switch (type)
+            {
+            case TOKEN_ADD:
+            {
+                // a*a + b*b, a*c + b*d
+                int a = SquaredOperand(children[0]), b = SquaredOperand(children[1]);
+                if (a >= 0 && b >= 0) return MakeOperator(Token(TOKEN_LEN2), { a, b });
+                const ExprNode& p = m_nodes[children[0]];
+                const ExprNode& q = m_nodes[children[1]];
+                if (is(children[0], TOKEN_MUL) && is(children[1], TOKEN_MUL) && p.real && q.real)
+                    return MakeOperator(Token(TOKEN_DOT2), { p.children[0], q.children[0], p.children[1], q.children[1] });
+                break;
+            }
+            case TOKEN_SQRT:
+                if (is(children[0], TOKEN_LEN2)) return MakeOperator(Token(TOKEN_HYPOT), m_nodes[children[0]].children);
+                break;
+            case TOKEN_POW:
+                // s^-0.5 and len2^-1.5 of a non-negative real s
+                if (!ConstantValue(children[1], exponent) || !m_nodes[children[0]].nonNegative) break;
+                if (exponent == -0.5f) return MakeOperator(Token(TOKEN_RSQRT), { children[0] });
+                if (exponent == -1.5f && is(children[0], TOKEN_LEN2))
+                    return MakeOperator(Token(TOKEN_INVCUBE), m_nodes[children[0]].children);
+                break;
+            case TOKEN_DIV:
+            {
+                // n / len2^1.5, n / sqrt(s), n / hypot as n times the reciprocal
+                int d = children[1];
+                int reciprocal = -1;
+                if (is(d, TOKEN_POW) && is(m_nodes[d].children[0], TOKEN_LEN2) &&
+                    ConstantValue(m_nodes[d].children[1], exponent) && exponent == 1.5f)
+                    reciprocal = MakeOperator(Token(TOKEN_INVCUBE), m_nodes[m_nodes[d].children[0]].children);
+                else if (is(d, TOKEN_SQRT) && m_nodes[m_nodes[d].children[0]].nonNegative)
+                    reciprocal = MakeOperator(Token(TOKEN_RSQRT), { m_nodes[d].children[0] });
+                else if (is(d, TOKEN_HYPOT))
+                    reciprocal = MakeOperator(Token(TOKEN_RSQRT), { MakeOperator(Token(TOKEN_LEN2), m_nodes[d].children) });
+                if (reciprocal < 0) break;
+                float numerator;
+                if (ConstantValue(children[0], numerator) && numerator == 1.0f) return reciprocal;
+                return MakeOperator(Token(TOKEN_MUL), { children[0], reciprocal });
+            }
+            default:
+                break;
+            }
+            return -1;
+        }
+
+        bool ConstantValue(int id, float& value) const
+        {
+            static const SymbolId pi = internSymbol("pi");
+            static const SymbolId e = internSymbol("e");
+            const Token& token = m_nodes[id].token;
+            if (token.type == TOKEN_NUMBER) { value = token.numeric_value; return true; }
+            if (token.type == TOKEN_VARIABLE && token.variable == pi) { value = SHADER_PI; return true; }
+            if (token.type == TOKEN_VARIABLE && token.variable == e) { value = SHADER_E; return true; }
+            return false;
+        }
+
+        // D() and pair reduction bodies are evaluated separately, without temporaries
+        static std::vector<Token> OptimizeBody(const std::vector<Token>& body, bool fullInterpreter)
+        {
+            ExpressionGraph graph(false, fullInterpreter);
+            int root = graph.Build(body);
+            if (root < 0) return body;
+
+            std::vector<Token> optimized;
+            int unusedSlots = 0;
+            graph.Emit(root, optimized, unusedSlots);
+            return optimized;
+        }
+
+        bool m_shareSubtrees;
+        bool m_fullInterpreter;
+        int m_nextPreludeSlot = 0;
+        std::vector<ExprNode> m_nodes;
+        std::unordered_map<std::string, int> m_index;
+    };
+}
+
+// ============================================================================
+// MAIN OPTIMIZER ENTRY POINT
+// ============================================================================
+
+void OptimizeEquation(ParsedEquation& equation)
+{
+    // Evaluation order of the components - MUST MATCH main() in math.comp
+    std::vector<Token>* components[] = {
+        &equation.tokens_ax, &equation.tokens_ay, &equation.tokens_angular,
+        &equation.tokens_r, &equation.tokens_g, &equation.tokens_b, &equation.tokens_a
+    };
+
+    ExpressionGraph graph(true, true);
+    int roots[7];
+    for (int c = 0; c < 7; c++)
+        roots[c] = components[c]->empty() ? -1 : graph.Build(*components[c]);
+    for (int c = 0; c < 7; c++)
+        if (roots[c] >= 0) graph.CountUses(roots[c]);
+
+    // The first occurrence in evaluation order stores, every later one loads
+    int nextTempSlot = 0;
+    for (int c = 0; c < 7; c++)
+    {
+        if (roots[c] < 0) continue;
+        std::vector<Token> optimized;
+        graph.Emit(roots[c], optimized, nextTempSlot);
+        *components[c] = optimized;
+    }
+
+    // State updates are evaluated after the step, apart from the components, without temporaries
+    for (auto& tokens : equation.tokens_state)
+    {
+        if (tokens.empty()) continue;
+        ExpressionGraph updateGraph(false, true);
+        int root = updateGraph.Build(tokens);
+        if (root < 0) continue;
+
+        std::vector<Token> optimized;
+        int unusedSlots = 0;
+        updateGraph.Emit(root, optimized, unusedSlots);
+        tokens = optimized;
+    }
+}
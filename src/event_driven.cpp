@@ -0,0 +1,472 @@
+#include "event_driven.h"
+#include "cpu_backend.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <queue>
+#include <unordered_map>
+
+static const double NEVER = std::numeric_limits<double>::infinity();
+
+enum EventKind
+{
+    EVENT_PAIR = 0,
+    EVENT_WALL_X,
+    EVENT_WALL_Y,
+    EVENT_CELL_X,
+    EVENT_CELL_Y
+};
+
+// One object of a world, in double precision between events
+struct Disk
+{
+    double x, y, vx, vy;
+    double time;           // The state above is the object's at this time
+    double radius;
+    double invMass;        // 0 = immovable
+    double restitution;
+    double lastCollision;
+    unsigned category, mask;
+    unsigned count;        // Collisions so far; an event holding an older count is stale
+    long long cx, cy;      // Grid cell, wrapped in a periodic box
+    bool collides;         // A disk, listed in the grid
+    int object;            // Index in the objects
+};
+
+struct Event
+{
+    double time;
+    int a, b;              // b = -1 unless a pair
+    unsigned countA, countB;
+    int kind;
+};
+
+struct Later
+{
+    bool operator()(const Event& lhs, const Event& rhs) const { return lhs.time > rhs.time; }
+};
+
+// The queue, grid and disks of one world
+class WorldRun
+{
+public:
+    WorldRun(const EventDriven::Settings& settings, double end) : m_settings(settings), m_end(end) {}
+
+    void Load(const std::vector<Object>& objects, const std::vector<CollisionProperties>& collisions,
+              const std::vector<bool>& immovable, const std::vector<int>& members);
+    void Run();
+    void Store(std::vector<Object>& objects) const;
+
+    EventDriven::Stats stats;
+
+private:
+    static long long CellKey(long long cx, long long cy)
+    {
+        return static_cast<long long>((static_cast<uint64_t>(cx) << 32) ^ (static_cast<uint64_t>(cy) & 0xFFFFFFFFull));
+    }
+
+    long long CellCoord(double value, int axis) const;
+    void Insert(int i);
+    void Remove(int i);
+    void Move(Disk& disk, double t) const;
+    void MinimumImage(double& dx, double& dy) const;
+    double PairTime(int i, int j, double t) const;
+    void Push(double time, int a, int b, int kind);
+    void PredictCell(int i, int axis);
+    void PredictPairs(int i, int skip);
+    void Predict(int i, int skip);
+    void Collide(int i, int j, double t);
+    void HitWall(int i, int axis, double t);
+    void CrossCell(int i, int axis);
+
+    EventDriven::Settings m_settings;
+    double m_end;
+    bool m_periodic = false;
+    double m_origin[2] = { 0.0, 0.0 };
+    double m_size[2] = { 0.0, 0.0 };     // Periodic box
+    double m_cellSize[2] = { 1.0, 1.0 };
+    long long m_cells[2] = { 0, 0 };     // Cells per axis of a periodic box
+    std::vector<Disk> m_disks;
+    std::unordered_map<long long, std::vector<int>> m_grid;
+    std::priority_queue<Event, std::vector<Event>, Later> m_queue;
+};
+
+void WorldRun::Load(const std::vector<Object>& objects, const std::vector<CollisionProperties>& collisions,
+                    const std::vector<bool>& immovable, const std::vector<int>& members)
+{
+    m_periodic = m_settings.boundary == BOUNDARY_PERIODIC;
+    double largest = 0.0;
+    for (int index : members)
+    {
+        const Object& object = objects[index];
+        const CollisionProperties& props = collisions[index];
+        bool fixed = index < static_cast<int>(immovable.size()) && immovable[index];
+        Disk disk = {};
+        disk.x = object.position.x;
+        disk.y = object.position.y;
+        disk.vx = fixed ? 0.0 : object.velocity.x;
+        disk.vy = fixed ? 0.0 : object.velocity.y;
+        disk.radius = std::abs(object.visualData.x);
+        disk.invMass = fixed || !(object.mass > 0.0f) ? 0.0 : 1.0 / object.mass;
+        disk.restitution = std::min(std::max(props.restitution, 0.0f), 1.0f);
+        disk.lastCollision = -NEVER;
+        disk.category = props.category;
+        disk.mask = props.mask;
+        disk.collides = props.enabled != 0 && props.shapeType == COLLISION_CIRCLE && disk.radius > 0.0;
+        disk.object = index;
+        if (disk.collides) largest = std::max(largest, disk.radius);
+        m_disks.push_back(disk);
+    }
+
+    // Cells one diameter wide; a periodic box is split into whole cells along each axis
+    double cellSize = std::max(2.0 * largest, 1e-6);
+    for (int axis = 0; axis < 2; axis++)
+    {
+        m_cellSize[axis] = cellSize;
+        m_origin[axis] = 0.0;
+        if (!m_periodic) continue;
+        m_origin[axis] = axis == 0 ? m_settings.worldMin.x : m_settings.worldMin.y;
+        m_size[axis] = (axis == 0 ? m_settings.worldMax.x : m_settings.worldMax.y) - m_origin[axis];
+        m_cells[axis] = std::max(1LL, static_cast<long long>(std::floor(m_size[axis] / cellSize)));
+        m_cellSize[axis] = m_size[axis] / static_cast<double>(m_cells[axis]);
+    }
+
+    for (int i = 0; i < static_cast<int>(m_disks.size()); i++)
+    {
+        Disk& disk = m_disks[i];
+        if (m_periodic)
+        {
+            disk.x -= m_size[0] * std::floor((disk.x - m_origin[0]) / m_size[0]);
+            disk.y -= m_size[1] * std::floor((disk.y - m_origin[1]) / m_size[1]);
+        }
+        else if (m_settings.boundary == BOUNDARY_REFLECT)
+        {
+            disk.x = std::min(std::max(disk.x, static_cast<double>(m_settings.worldMin.x)), static_cast<double>(m_settings.worldMax.x));
+            disk.y = std::min(std::max(disk.y, static_cast<double>(m_settings.worldMin.y)), static_cast<double>(m_settings.worldMax.y));
+        }
+        disk.cx = CellCoord(disk.x, 0);
+        disk.cy = CellCoord(disk.y, 1);
+        if (disk.collides) Insert(i);
+    }
+    for (int i = 0; i < static_cast<int>(m_disks.size()); i++) Predict(i, -1);
+}
+
+long long WorldRun::CellCoord(double value, int axis) const
+{
+    long long cell = static_cast<long long>(std::floor((value - m_origin[axis]) / m_cellSize[axis]));
+    if (m_periodic) cell = std::min(std::max(cell, 0LL), m_cells[axis] - 1);
+    return cell;
+}
+
+void WorldRun::Insert(int i)
+{
+    m_grid[CellKey(m_disks[i].cx, m_disks[i].cy)].push_back(i);
+}
+
+void WorldRun::Remove(int i)
+{
+    std::vector<int>& cell = m_grid[CellKey(m_disks[i].cx, m_disks[i].cy)];
+    auto it = std::find(cell.begin(), cell.end(), i);
+    if (it == cell.end()) return;
+    *it = cell.back();
+    cell.pop_back();
+}
+
+void WorldRun::Move(Disk& disk, double t) const
+{
+    disk.x += disk.vx * (t - disk.time);
+    disk.y += disk.vy * (t - disk.time);
+    disk.time = t;
+}
+
+void WorldRun::MinimumImage(double& dx, double& dy) const
+{
+    if (!m_periodic) return;
+    dx -= m_size[0] * std::round(dx / m_size[0]);
+    dy -= m_size[1] * std::round(dy / m_size[1]);
+}
+
+// When disk i (at time t) and disk j first touch, NEVER if they do not
+double WorldRun::PairTime(int i, int j, double t) const
+{
+    const Disk& a = m_disks[i];
+    const Disk& b = m_disks[j];
+    if (a.invMass == 0.0 && b.invMass == 0.0) return NEVER;
+    if (!(a.category & b.mask) || !(b.category & a.mask)) return NEVER;
+
+    double dx = b.x + b.vx * (t - b.time) - a.x;
+    double dy = b.y + b.vy * (t - b.time) - a.y;
+    MinimumImage(dx, dy);
+    double dvx = b.vx - a.vx;
+    double dvy = b.vy - a.vy;
+    double approach = dx * dvx + dy * dvy;
+    if (approach >= 0.0) return NEVER;
+
+    double contact = a.radius + b.radius;
+    double gap = dx * dx + dy * dy - contact * contact;
+    if (gap <= 0.0) return t;  // Overlapping and closing in: now
+    double speed2 = dvx * dvx + dvy * dvy;
+    double discriminant = approach * approach - speed2 * gap;
+    if (discriminant < 0.0) return NEVER;
+    return t + gap / (-approach + std::sqrt(discriminant));  // The smaller root, without cancellation
+}
+
+void WorldRun::Push(double time, int a, int b, int kind)
+{
+    if (!(time <= m_end)) return;
+    Event event;
+    event.time = time;
+    event.a = a;
+    event.b = b;
+    event.countA = m_disks[a].count;
+    event.countB = b >= 0 ? m_disks[b].count : 0u;
+    event.kind = kind;
+    m_queue.push(event);
+}
+
+// Leaving the current cell along axis
+void WorldRun::PredictCell(int i, int axis)
+{
+    const Disk& disk = m_disks[i];
+    double position = axis == 0 ? disk.x : disk.y;
+    double velocity = axis == 0 ? disk.vx : disk.vy;
+    if (velocity == 0.0) return;
+    long long cell = (axis == 0 ? disk.cx : disk.cy) + (velocity > 0.0 ? 1 : 0);
+    double edge = m_origin[axis] + static_cast<double>(cell) * m_cellSize[axis];
+    Push(disk.time + std::max(0.0, (edge - position) / velocity), i, -1, axis == 0 ? EVENT_CELL_X : EVENT_CELL_Y);
+}
+
+// Contacts with the disks of the 3x3 cells around disk i; skip is a partner already predicted
+// with it. In a box of fewer than three cells some of those cells are the same.
+void WorldRun::PredictPairs(int i, int skip)
+{
+    const Disk& disk = m_disks[i];
+    double t = disk.time;
+    long long visited[9];
+    int visitedCount = 0;
+    for (long long oy = -1; oy <= 1; oy++)
+    {
+        for (long long ox = -1; ox <= 1; ox++)
+        {
+            long long cx = disk.cx + ox, cy = disk.cy + oy;
+            if (m_periodic)
+            {
+                cx = ((cx % m_cells[0]) + m_cells[0]) % m_cells[0];
+                cy = ((cy % m_cells[1]) + m_cells[1]) % m_cells[1];
+            }
+            long long key = CellKey(cx, cy);
+            if (std::find(visited, visited + visitedCount, key) != visited + visitedCount) continue;
+            visited[visitedCount++] = key;
+
+            auto cell = m_grid.find(key);
+            if (cell == m_grid.end()) continue;
+            for (int j : cell->second)
+            {
+                if (j == i || j == skip) continue;
+                double time = PairTime(i, j, t);
+                if (time != NEVER) Push(time, i, j, EVENT_PAIR);
+            }
+        }
+    }
+}
+
+// Every event of disk i from its current time on, after its velocity changed
+void WorldRun::Predict(int i, int skip)
+{
+    const Disk& disk = m_disks[i];
+    double t = disk.time;
+    if (m_settings.boundary == BOUNDARY_REFLECT)
+    {
+        if (disk.vx < 0.0) Push(t + (m_settings.worldMin.x - disk.x) / disk.vx, i, -1, EVENT_WALL_X);
+        if (disk.vx > 0.0) Push(t + (m_settings.worldMax.x - disk.x) / disk.vx, i, -1, EVENT_WALL_X);
+        if (disk.vy < 0.0) Push(t + (m_settings.worldMin.y - disk.y) / disk.vy, i, -1, EVENT_WALL_Y);
+        if (disk.vy > 0.0) Push(t + (m_settings.worldMax.y - disk.y) / disk.vy, i, -1, EVENT_WALL_Y);
+    }
+    if (!disk.collides) return;
+    PredictCell(i, 0);
+    PredictCell(i, 1);
+    PredictPairs(i, skip);
+}
+
+void WorldRun::Collide(int i, int j, double t)
+{
+    Disk& a = m_disks[i];
+    Disk& b = m_disks[j];
+    Move(a, t);
+    Move(b, t);
+
+    double nx = b.x - a.x, ny = b.y - a.y;
+    MinimumImage(nx, ny);
+    double length = std::sqrt(nx * nx + ny * ny);
+    if (length > 0.0)
+    {
+        nx /= length;
+        ny /= length;
+        double closing = (a.vx - b.vx) * nx + (a.vy - b.vy) * ny;
+        if (closing > 0.0)
+        {
+            bool collapsing = t - a.lastCollision < m_settings.collapseTime || t - b.lastCollision < m_settings.collapseTime;
+            double e = collapsing ? 1.0 : std::min(a.restitution, b.restitution);
+            double impulse = (1.0 + e) * closing / (a.invMass + b.invMass);
+            a.vx -= impulse * a.invMass * nx;
+            a.vy -= impulse * a.invMass * ny;
+            b.vx += impulse * b.invMass * nx;
+            b.vy += impulse * b.invMass * ny;
+            a.lastCollision = b.lastCollision = t;
+            stats.collisions++;
+        }
+    }
+    a.count++;
+    b.count++;
+    Predict(i, -1);
+    Predict(j, i);
+}
+
+void WorldRun::HitWall(int i, int axis, double t)
+{
+    Disk& disk = m_disks[i];
+    Move(disk, t);
+    double e = std::min(std::max(static_cast<double>(m_settings.wallRestitution), 0.0), 1.0);
+    if (axis == 0)
+    {
+        disk.x = disk.vx < 0.0 ? m_settings.worldMin.x : m_settings.worldMax.x;
+        disk.vx = -disk.vx * e;
+    }
+    else
+    {
+        disk.y = disk.vy < 0.0 ? m_settings.worldMin.y : m_settings.worldMax.y;
+        disk.vy = -disk.vy * e;
+    }
+    disk.count++;
+    stats.wallHits++;
+
+    // The cell follows the clamped position; a wall between cell edges leaves it where it was
+    if (disk.collides)
+    {
+        Remove(i);
+        disk.cx = CellCoord(disk.x, 0);
+        disk.cy = CellCoord(disk.y, 1);
+        Insert(i);
+    }
+    Predict(i, -1);
+}
+
+// Into the next cell along axis. The velocity is unchanged, so the events already queued stay
+// valid: only the next edge along this axis and the new neighbours are predicted
+void WorldRun::CrossCell(int i, int axis)
+{
+    Disk& disk = m_disks[i];
+    Remove(i);
+    long long& cell = axis == 0 ? disk.cx : disk.cy;
+    double velocity = axis == 0 ? disk.vx : disk.vy;
+    cell += velocity > 0.0 ? 1 : -1;
+    if (m_periodic && (cell < 0 || cell >= m_cells[axis]))
+    {
+        double shift = cell < 0 ? m_size[axis] : -m_size[axis];
+        (axis == 0 ? disk.x : disk.y) += shift;
+        cell = cell < 0 ? m_cells[axis] - 1 : 0;
+    }
+    Insert(i);
+    stats.cellCrossings++;
+    PredictCell(i, axis);
+    PredictPairs(i, -1);
+}
+
+void WorldRun::Run()
+{
+    long long processed = 0;
+    while (!m_queue.empty())
+    {
+        Event event = m_queue.top();
+        m_queue.pop();
+        Disk& a = m_disks[event.a];
+        if (event.countA != a.count || (event.b >= 0 && event.countB != m_disks[event.b].count))
+        {
+            stats.staleEvents++;
+            continue;
+        }
+        if (m_settings.maxEvents > 0 && processed >= m_settings.maxEvents)
+        {
+            stats.truncated = true;
+            break;
+        }
+        processed++;
+
+        switch (event.kind)
+        {
+        case EVENT_PAIR:
+            Collide(event.a, event.b, event.time);
+            break;
+        case EVENT_WALL_X:
+        case EVENT_WALL_Y:
+            HitWall(event.a, event.kind == EVENT_WALL_X ? 0 : 1, event.time);
+            break;
+        default:
+            Move(a, event.time);
+            CrossCell(event.a, event.kind == EVENT_CELL_X ? 0 : 1);
+            break;
+        }
+    }
+}
+
+void WorldRun::Store(std::vector<Object>& objects) const
+{
+    for (Disk disk : m_disks)
+    {
+        Move(disk, m_end);
+        if (m_periodic)
+        {
+            disk.x -= m_size[0] * std::floor((disk.x - m_origin[0]) / m_size[0]);
+            disk.y -= m_size[1] * std::floor((disk.y - m_origin[1]) / m_size[1]);
+        }
+        else if (m_settings.boundary == BOUNDARY_REFLECT)
+        {
+            disk.x = std::min(std::max(disk.x, static_cast<double>(m_settings.worldMin.x)), static_cast<double>(m_settings.worldMax.x));
+            disk.y = std::min(std::max(disk.y, static_cast<double>(m_settings.worldMin.y)), static_cast<double>(m_settings.worldMax.y));
+        }
+        Object& object = objects[disk.object];
+        object.position = glm::vec2(static_cast<float>(disk.x), static_cast<float>(disk.y));
+        object.velocity = glm::vec2(static_cast<float>(disk.vx), static_cast<float>(disk.vy));
+    }
+}
+
+// ============================================================================
+// Every world on its own queue
+// ============================================================================
+EventDriven::Stats EventDriven::Advance(std::vector<Object>& objects, const std::vector<CollisionProperties>& collisions,
+                                        const std::vector<bool>& immovable, double duration, const Settings& settings)
+{
+    Stats total;
+    if (objects.empty() || !(duration > 0.0) || collisions.size() < objects.size()) return total;
+
+    std::map<int, std::vector<int>> worlds;
+    for (int i = 0; i < static_cast<int>(objects.size()); i++) worlds[objects[i].worldID].push_back(i);
+    std::vector<const std::vector<int>*> members;
+    for (const auto& world : worlds) members.push_back(&world.second);
+
+    std::vector<Stats> stats(members.size());
+    CpuBackend::ParallelFor(static_cast<int>(members.size()), 1, [&](int begin, int end)
+    {
+        for (int w = begin; w < end; w++)
+        {
+            WorldRun run(settings, duration);
+            run.Load(objects, collisions, immovable, *members[w]);
+            run.Run();
+            run.Store(objects);  // Each world writes only its own objects
+            stats[w] = run.stats;
+        }
+    });
+
+    for (const Stats& world : stats)
+    {
+        total.collisions += world.collisions;
+        total.wallHits += world.wallHits;
+        total.cellCrossings += world.cellCrossings;
+        total.staleEvents += world.staleEvents;
+        total.truncated = total.truncated || world.truncated;
+    }
+    total.worlds = static_cast<int>(members.size());
+    return total;
+}
@@ -0,0 +1,192 @@
+#include "expression_eval.h"
+#include "equation_codegen.h"
+#include "embedded_shaders.h"
+#include "buffer_helpers.h"
+#include "shader_utils.h"
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+static const GLuint EXPRESSION_EVAL_WORK_GROUP_SIZE = 256;
+static const size_t MAX_CACHED_PROGRAMS = 32;  // Distinct expressions kept compiled
+
+static const char* const COLUMN_NAMES[EVAL_COLUMN_COUNT] = {
+    "x", "y", "vx", "vy", "ax", "ay", "theta", "omega", "r", "g", "b", "a", "mass", "charge"
+};
+static const float COLUMN_DEFAULTS[EVAL_COLUMN_COUNT] = {
+    0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f
+};
+
+// Buffers, grown to the largest batch evaluated so far
+static GLuint g_inputsSSBO = 0;
+static GLuint g_resultsSSBO = 0;
+
+// Shader template and one program per expression (0 = failed to compile)
+static std::string g_templateSource;
+static std::unordered_map<std::string, GLuint> g_programs;
+
+const char* GetEvalColumnName(int column)
+{
+    return (column >= 0 && column < EVAL_COLUMN_COUNT) ? COLUMN_NAMES[column] : "";
+}
+
+int FindEvalColumn(const std::string& name)
+{
+    for (int column = 0; column < EVAL_COLUMN_COUNT; column++)
+        if (name == COLUMN_NAMES[column]) return column;
+    return -1;
+}
+
+static void DeletePrograms()
+{
+    for (auto& entry : g_programs)
+        if (entry.second) glDeleteProgram(entry.second);
+    g_programs.clear();
+}
+
+// Program for an expression, compiled on first use
+static GLuint GetProgram(const std::string& key, const std::string& expressionFunction, std::string& error)
+{
+    auto it = g_programs.find(key);
+    if (it != g_programs.end())
+    {
+        if (it->second == 0) error = "Evaluation shader failed to compile for this expression";
+        return it->second;
+    }
+
+    if (g_templateSource.empty())
+    {
+        std::string hash;
+        if (!LoadShaderSource("expression_eval.comp", g_templateSource, hash))
+        {
+            error = "expression_eval.comp not found";
+            return 0;
+        }
+    }
+
+    std::string block = std::string(EquationCodegen::BLOCK_BEGIN_MARKER) + "\n" + expressionFunction +
+                        EquationCodegen::BLOCK_END_MARKER;
+    std::string source = EquationCodegen::SpliceEquationBlock(g_templateSource, block);
+    if (source.empty())
+    {
+        error = "expression_eval.comp has no expression block";
+        return 0;
+    }
+
+    if (g_programs.size() >= MAX_CACHED_PROGRAMS) DeletePrograms();
+
+    GLuint program = CreateComputeProgram(source.c_str());
+    if (program == 0)
+    {
+        std::cerr << "[ExpressionEval] Failed to compile evaluation for: " << key << std::endl;
+        error = "Evaluation shader failed to compile for this expression";
+    }
+    g_programs[key] = program;
+    return program;
+}
+
+// ============================================================================
+// Buffers follow the first evaluation, programs the first of each expression
+// ============================================================================
+bool ExpressionEval::Init()
+{
+    return true;
+}
+
+// ============================================================================
+// Upload a batch of columns -> one dispatch -> read the batch's values back
+// ============================================================================
+bool ExpressionEval::Evaluate(const std::string& key, const std::string& expressionFunction, const EvalInput inputs[EVAL_COLUMN_COUNT],
+                              size_t numPoints, GLuint objectSSBO, int numObjects, float* results, std::string& error)
+{
+    if (numPoints == 0) return true;
+    for (int c = 0; c < EVAL_COLUMN_COUNT; c++)
+    {
+        if (inputs[c].count > 1 && inputs[c].count != numPoints)
+        {
+            error = std::string("Column ") + COLUMN_NAMES[c] + " has " + std::to_string(inputs[c].count) +
+                    " values for " + std::to_string(numPoints) + " points";
+            return false;
+        }
+    }
+
+    GLuint program = GetProgram(key, expressionFunction, error);
+    if (program == 0) return false;
+
+    // Full columns share the input buffer, one batch-long slice each
+    size_t batchPoints = std::min(numPoints, static_cast<size_t>(EXPRESSION_EVAL_BATCH_POINTS));
+    GLint offsets[EVAL_COLUMN_COUNT];
+    float values[EVAL_COLUMN_COUNT];
+    int fullColumns = 0;
+    for (int c = 0; c < EVAL_COLUMN_COUNT; c++)
+    {
+        bool full = inputs[c].count > 1;
+        offsets[c] = full ? static_cast<GLint>(fullColumns++ * batchPoints) : -1;
+        values[c] = (inputs[c].count == 1) ? inputs[c].data[0] : COLUMN_DEFAULTS[c];
+    }
+
+    BufferHelpers::EnsureBufferCapacity(g_inputsSSBO, static_cast<GLsizeiptr>(std::max(fullColumns, 1) * batchPoints * sizeof(float)));
+    BufferHelpers::EnsureBufferCapacity(g_resultsSSBO, static_cast<GLsizeiptr>(batchPoints * sizeof(float)), GL_DYNAMIC_READ);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    if (g_inputsSSBO == 0 || g_resultsSSBO == 0)
+    {
+        error = "Evaluation buffers unavailable";
+        return false;
+    }
+
+    glUseProgram(program);
+    GLint numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+    GLint numPointsLoc = glGetUniformLocation(program, "uNumPoints");
+    GLint offsetsLoc = glGetUniformLocation(program, "uColumnOffset");
+    GLint valuesLoc = glGetUniformLocation(program, "uColumnValue");
+    if (numObjectsLoc != -1) glUniform1i(numObjectsLoc, numObjects);
+    if (offsetsLoc != -1) glUniform1iv(offsetsLoc, EVAL_COLUMN_COUNT, offsets);
+    if (valuesLoc != -1) glUniform1fv(valuesLoc, EVAL_COLUMN_COUNT, values);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, EXPRESSION_EVAL_INPUTS_BINDING, g_inputsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, EXPRESSION_EVAL_RESULTS_BINDING, g_resultsSSBO);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    for (size_t first = 0; first < numPoints; first += batchPoints)
+    {
+        size_t count = std::min(batchPoints, numPoints - first);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_inputsSSBO);
+        for (int c = 0; c < EVAL_COLUMN_COUNT; c++)
+        {
+            if (offsets[c] < 0) continue;
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, static_cast<GLintptr>(offsets[c] * sizeof(float)),
+                            static_cast<GLsizeiptr>(count * sizeof(float)), inputs[c].data + first);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        if (numPointsLoc != -1) glUniform1i(numPointsLoc, static_cast<GLint>(count));
+        GLuint groups = static_cast<GLuint>((count + EXPRESSION_EVAL_WORK_GROUP_SIZE - 1) / EXPRESSION_EVAL_WORK_GROUP_SIZE);
+        glDispatchCompute(groups, 1, 1);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_resultsSSBO);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(count * sizeof(float)), results + first);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, EXPRESSION_EVAL_INPUTS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, EXPRESSION_EVAL_RESULTS_BINDING, 0);
+    glUseProgram(0);
+    return true;
+}
+
+// ============================================================================
+// Release buffers and programs
+// ============================================================================
+void ExpressionEval::Cleanup()
+{
+    DeletePrograms();
+    g_templateSource.clear();
+    if (g_inputsSSBO) glDeleteBuffers(1, &g_inputsSSBO);
+    if (g_resultsSSBO) glDeleteBuffers(1, &g_resultsSSBO);
+    g_inputsSSBO = 0;
+    g_resultsSSBO = 0;
+}
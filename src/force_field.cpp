@@ -0,0 +1,243 @@
+#include "force_field.h"
+#include "equation_codegen.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include "shader_utils.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+#include <algorithm>
+#include <cstddef>
+
+static const GLuint FORCE_FIELD_WORK_GROUP_SIZE = 256;
+static const int MAX_FIELD_SAMPLES = 1 << 20;
+
+// One arrow per sample - MUST MATCH force_field.comp
+struct ForceArrow
+{
+    glm::vec2 base;
+    glm::vec2 field;
+};
+
+// Grid
+static float g_bounds[4] = { -10.0f, 10.0f, -10.0f, 10.0f };  // xMin, xMax, yMin, yMax
+static int g_columns = 64, g_rows = 64;
+static float g_arrowScale = 0.1f;
+static bool g_sampled = false;  // The arrow buffer holds a sample of the current field
+
+// Buffers: the arrows are written as an SSBO and read back as instanced attributes
+static GLuint g_arrowBuffer = 0;
+static GLuint g_arrowVAO = 0;
+
+// Sampling program, compiled from the template for each field
+static std::string g_templateSource;
+static GLuint g_sampleProgram = 0;
+static GLint g_numObjectsLoc = -1, g_gridSizeLoc = -1, g_boundsLoc = -1;
+
+// Async shader loading of the arrow program
+static GLuint g_arrowProgram = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_projViewLoc = -1, g_scaleLoc = -1, g_maxLengthLoc = -1;
+
+// ============================================================================
+// Arrow buffer and program
+// ============================================================================
+bool ForceField::Init()
+{
+    if (g_arrowVAO == 0)
+    {
+        glGenVertexArrays(1, &g_arrowVAO);
+        if (!SetGrid(g_bounds[0], g_bounds[1], g_bounds[2], g_bounds[3], g_columns, g_rows)) return false;
+    }
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ForceField] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+
+    if (g_arrowProgram == 0)
+    {
+        g_loader.LoadGraphicsShaderAsync(
+            "force_arrow.vert",
+            "force_arrow.frag",
+            "",
+            [](GLuint program)
+            {
+                g_arrowProgram = program;
+                g_projViewLoc = glGetUniformLocation(program, "uProjView");
+                g_scaleLoc = glGetUniformLocation(program, "uScale");
+                g_maxLengthLoc = glGetUniformLocation(program, "uMaxLength");
+                g_ready = (g_projViewLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ForceField] force_arrow shaders FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+bool ForceField::SetGrid(float xMin, float xMax, float yMin, float yMax, int columns, int rows)
+{
+    if (!(xMax > xMin) || !(yMax > yMin) || columns < 1 || rows < 1) return false;
+    if (static_cast<long long>(columns) * rows > MAX_FIELD_SAMPLES) return false;
+
+    BufferHelpers::EnsureBufferCapacity(g_arrowBuffer, static_cast<GLsizeiptr>(columns) * rows * sizeof(ForceArrow));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // The buffer may have been replaced, so the attributes are pointed at it again
+    glBindVertexArray(g_arrowVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, g_arrowBuffer);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(ForceArrow), (void*)offsetof(ForceArrow, base));
+    glEnableVertexAttribArray(0);
+    glVertexAttribDivisor(0, 1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(ForceArrow), (void*)offsetof(ForceArrow, field));
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    g_bounds[0] = xMin;
+    g_bounds[1] = xMax;
+    g_bounds[2] = yMin;
+    g_bounds[3] = yMax;
+    g_columns = columns;
+    g_rows = rows;
+    g_sampled = false;
+    return true;
+}
+
+void ForceField::SetArrowScale(float scale)
+{
+    if (scale > 0.0f) g_arrowScale = scale;
+}
+
+// ============================================================================
+// Field expressions
+// ============================================================================
+bool ForceField::SetExpressions(const std::string& functions, std::string& error)
+{
+    if (g_templateSource.empty())
+    {
+        std::string hash;
+        if (!LoadShaderSource("force_field.comp", g_templateSource, hash))
+        {
+            error = "force_field.comp not found";
+            return false;
+        }
+    }
+
+    std::string block = std::string(EquationCodegen::BLOCK_BEGIN_MARKER) + "\n" + functions +
+                        EquationCodegen::BLOCK_END_MARKER;
+    std::string source = EquationCodegen::SpliceEquationBlock(g_templateSource, block);
+    if (source.empty())
+    {
+        error = "force_field.comp has no expression block";
+        return false;
+    }
+
+    GLuint program = CreateComputeProgram(source.c_str());
+    if (program == 0)
+    {
+        error = "Force field shader failed to compile for these expressions";
+        return false;
+    }
+
+    ClearExpressions();
+    g_sampleProgram = program;
+    g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+    g_gridSizeLoc = glGetUniformLocation(program, "uGridSize");
+    g_boundsLoc = glGetUniformLocation(program, "uBounds");
+    return true;
+}
+
+void ForceField::ClearExpressions()
+{
+    if (g_sampleProgram) glDeleteProgram(g_sampleProgram);
+    g_sampleProgram = 0;
+    g_sampled = false;
+}
+
+bool ForceField::IsActive()
+{
+    return g_sampleProgram != 0;
+}
+
+// ============================================================================
+// Sample, then draw from the same buffer
+// ============================================================================
+void ForceField::Evaluate(GLuint objectSSBO, int numObjects)
+{
+    if (g_sampleProgram == 0 || g_arrowBuffer == 0) return;
+
+    glUseProgram(g_sampleProgram);
+    if (g_numObjectsLoc != -1) glUniform1i(g_numObjectsLoc, numObjects);
+    glUniform2i(g_gridSizeLoc, g_columns, g_rows);
+    glUniform4fv(g_boundsLoc, 1, g_bounds);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, FORCE_FIELD_ARROWS_BINDING, g_arrowBuffer);
+
+    GLuint samples = static_cast<GLuint>(g_columns * g_rows);
+    glDispatchCompute((samples + FORCE_FIELD_WORK_GROUP_SIZE - 1) / FORCE_FIELD_WORK_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, FORCE_FIELD_ARROWS_BINDING, 0);
+    glUseProgram(0);
+    g_sampled = true;
+}
+
+void ForceField::Draw(const glm::mat4& projView)
+{
+    if (!g_ready || !g_sampled) return;
+
+    float cell = std::min((g_bounds[1] - g_bounds[0]) / g_columns, (g_bounds[3] - g_bounds[2]) / g_rows);
+
+    glUseProgram(g_arrowProgram);
+    glUniformMatrix4fv(g_projViewLoc, 1, GL_FALSE, glm::value_ptr(projView));
+    if (g_scaleLoc != -1) glUniform1f(g_scaleLoc, g_arrowScale);
+    if (g_maxLengthLoc != -1) glUniform1f(g_maxLengthLoc, 0.9f * cell);
+    glBindVertexArray(g_arrowVAO);
+    glDrawArraysInstanced(GL_LINES, 0, 6, g_columns * g_rows);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+// ============================================================================
+// Release the buffer and programs
+// ============================================================================
+void ForceField::Cleanup()
+{
+    ClearExpressions();
+    g_templateSource.clear();
+    if (g_arrowProgram) glDeleteProgram(g_arrowProgram);
+    g_arrowProgram = 0;
+    g_ready = false;
+
+    if (g_arrowBuffer) glDeleteBuffers(1, &g_arrowBuffer);
+    if (g_arrowVAO) glDeleteVertexArrays(1, &g_arrowVAO);
+    g_arrowBuffer = 0;
+    g_arrowVAO = 0;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ForceField::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool ForceField::IsReady()
+{
+    return g_ready;
+}
+
+std::string ForceField::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[force field] " + g_loader.GetStatusMessage();
+    return "Force field shaders ready";
+}
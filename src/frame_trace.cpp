@@ -0,0 +1,149 @@
+#include "frame_trace.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+// Chrome trace "complete" event; tid 0 is the GPU track
+struct TraceEvent
+{
+    std::string name;
+    double startUs;
+    double durationUs;
+    int tid;
+};
+
+// A zone opened on this thread, dropped if its capture has ended since
+struct OpenZone
+{
+    const char* name;
+    double startUs;
+    unsigned generation;
+};
+
+static std::mutex g_mutex;  // Guards g_events
+static std::vector<TraceEvent> g_events;
+static std::atomic<bool> g_active{ false };
+static std::atomic<unsigned> g_generation{ 0 };
+static std::atomic<int> g_nextTid{ 1 };
+static const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+static thread_local std::vector<OpenZone> t_openZones;
+static thread_local int t_tid = 0;
+
+static double NowUs()
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - g_epoch).count();
+}
+
+static void AddEvent(TraceEvent event)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_events.size() < static_cast<size_t>(FrameTrace::MAX_TRACE_EVENTS)) g_events.push_back(std::move(event));
+}
+
+// ============================================================================
+// Capture
+// ============================================================================
+bool FrameTrace::IsCompiledIn()
+{
+#ifdef STELLAR_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool FrameTrace::Start()
+{
+    if (!IsCompiledIn()) return false;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_events.clear();
+    }
+    g_generation++;
+    g_active = true;
+    return true;
+}
+
+void FrameTrace::Stop()
+{
+    g_active = false;
+}
+
+bool FrameTrace::IsActive()
+{
+    return g_active;
+}
+
+// ============================================================================
+// Zones
+// ============================================================================
+bool FrameTrace::BeginZone(const char* name)
+{
+    if (!g_active) return false;
+    if (t_tid == 0) t_tid = g_nextTid++;
+    t_openZones.push_back({ name, NowUs(), g_generation.load() });
+    return true;
+}
+
+void FrameTrace::EndZone()
+{
+    if (t_openZones.empty()) return;
+    OpenZone zone = t_openZones.back();
+    t_openZones.pop_back();
+    if (!g_active || zone.generation != g_generation) return;
+    AddEvent({ zone.name, zone.startUs, NowUs() - zone.startUs, t_tid });
+}
+
+void FrameTrace::RecordGpuZone(const std::string& name, GLuint64 gpuStart, GLuint64 gpuEnd)
+{
+    if (!g_active || gpuEnd < gpuStart) return;
+
+    // The GPU clock's "now" against the host's gives the offset between them; reading it does not
+    // wait for queued work to finish
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    double offsetUs = NowUs() - static_cast<double>(gpuNow) * 1e-3;
+    AddEvent({ name, static_cast<double>(gpuStart) * 1e-3 + offsetUs,
+               static_cast<double>(gpuEnd - gpuStart) * 1e-3, 0 });
+}
+
+// ============================================================================
+// Export
+// ============================================================================
+static void WriteJsonString(FILE* file, const std::string& text)
+{
+    fputc('"', file);
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\') fputc('\\', file);
+        if (static_cast<unsigned char>(c) >= 0x20) fputc(c, file);
+    }
+    fputc('"', file);
+}
+
+bool FrameTrace::WriteChromeTrace(const std::string& path)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}");
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        for (const TraceEvent& event : g_events)
+        {
+            fprintf(file, ",\n{\"name\":");
+            WriteJsonString(file, event.name);
+            fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    event.tid, event.startUs, event.durationUs);
+        }
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
@@ -60,4 +60,19 @@ namespace Framebuffer
     {
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
+    void Framebuffer::Resize(uint32_t width, uint32_t height)
+    {
+        if (width == 0 || height == 0 || (width == mWidth && height == mHeight))
+            return;
+        mWidth = width;
+        mHeight = height;
+
+        glBindTexture(GL_TEXTURE_2D, mTextureId);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, mWidth, mHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, mRenderbufferId);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, mWidth, mHeight);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "gl_debug.h"
+#include <glad/glad.h>
+#include <iostream>
+
+#ifndef NDEBUG
+static const char* SourceName(GLenum source)
+{
+    switch (source)
+    {
+    case GL_DEBUG_SOURCE_API: return "API";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+    case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+    case GL_DEBUG_SOURCE_APPLICATION: return "application";
+    default: return "other";
+    }
+}
+
+static void GLAD_API_PTR OnDebugMessage(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                        const GLchar* message, const void* userParam)
+{
+    (void)length; (void)userParam;
+    const char* kind = type == GL_DEBUG_TYPE_ERROR ? "error" : "message";
+    std::cerr << "[GL] " << SourceName(source) << " " << kind << " " << id
+              << (severity == GL_DEBUG_SEVERITY_HIGH ? " (high)" : "") << ": " << message << std::endl;
+}
+#endif
+
+bool GLDebug::WantsDebugContext()
+{
+#ifdef NDEBUG
+    return false;
+#else
+    return true;
+#endif
+}
+
+bool GLDebug::Install()
+{
+#ifdef NDEBUG
+    return false;
+#else
+    if (!GLAD_GL_VERSION_4_3 || !glDebugMessageCallback) return false;
+
+    // Asynchronous: the driver reports from its own thread rather than serializing every call
+    glEnable(GL_DEBUG_OUTPUT);
+    glDebugMessageCallback(OnDebugMessage, nullptr);
+
+    // Errors and high/medium severity only; performance notes and notifications stay quiet
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+    glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_ERROR, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_HIGH, 0, nullptr, GL_TRUE);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_MEDIUM, 0, nullptr, GL_TRUE);
+    return true;
+#endif
+}
@@ -0,0 +1,310 @@
+#include "gpu_primitives.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+static const GLuint PRIMITIVE_WORK_GROUP_SIZE = 256;  // MUST MATCH local_size_x in gpu_primitives.comp
+static const GLuint MAX_PRIMITIVE_GROUPS = 65535;     // Per dispatch; larger inputs take several
+static const GLuint RADIX_DIGITS = 16;                // 4-bit digits
+
+// Pass indices - MUST MATCH PASS_* in gpu_primitives.comp
+enum PrimitivePass
+{
+    PASS_SCAN_LOCAL = 0,
+    PASS_SCAN_ADD = 1,
+    PASS_RADIX_HISTOGRAM = 2,
+    PASS_RADIX_SCATTER = 3,
+    PASS_COMPACT_FLAGS = 4,
+    PASS_COMPACT_SCATTER = 5,
+    PASS_SEGMENTED_REDUCE = 6
+};
+
+// Scratch buffers, grown on demand
+static std::vector<GLuint> g_scanLevels;  // Block sums of each scan level
+static GLuint g_sortKeys = 0;             // Ping-pong halves of the radix sort
+static GLuint g_sortValues = 0;
+static GLuint g_histogram = 0;            // Digit counts per block [digit][block]
+static GLuint g_flagScan = 0;             // Compaction: 0/1 per element, then the output slots
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_passLoc = -1;
+static GLint g_countLoc = -1;
+static GLint g_firstBlockLoc = -1;
+static GLint g_numBlocksLoc = -1;
+static GLint g_shiftLoc = -1;
+static GLint g_hasValuesLoc = -1;
+static GLint g_reduceOpLoc = -1;
+
+static GLuint BlocksFor(GLuint count)
+{
+    return (count + PRIMITIVE_WORK_GROUP_SIZE - 1) / PRIMITIVE_WORK_GROUP_SIZE;
+}
+
+static void Bind(GLuint a, GLuint b, GLuint c = 0, GLuint d = 0, GLuint e = 0)
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PRIMITIVE_A_BINDING, a);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PRIMITIVE_B_BINDING, b);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PRIMITIVE_C_BINDING, c);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PRIMITIVE_D_BINDING, d);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PRIMITIVE_E_BINDING, e);
+}
+
+// One workgroup per block of 256 elements (per segment for the reduction), in chunks
+static void Dispatch(PrimitivePass pass, GLuint count, GLuint blocks)
+{
+    glUniform1i(g_passLoc, pass);
+    glUniform1ui(g_countLoc, count);
+    for (GLuint first = 0; first < blocks; first += MAX_PRIMITIVE_GROUPS)
+    {
+        glUniform1ui(g_firstBlockLoc, first);
+        glDispatchCompute(std::min(blocks - first, MAX_PRIMITIVE_GROUPS), 1, 1);
+    }
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// Copies a uint out of a buffer once the shader writes to it are visible to buffer copies
+static void CopyWord(GLuint source, GLintptr sourceOffset, GLuint destination, GLintptr destinationOffset)
+{
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, source);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffset, destinationOffset, sizeof(GLuint));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+static void CopyWords(GLuint source, GLuint destination, GLuint count)
+{
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, source);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(count) * sizeof(GLuint));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+// Scans blocks of buffer, then (recursively) their sums, then adds them back. Returns the
+// level whose single block sum is the total.
+static size_t ScanLevel(GLuint buffer, GLuint count, size_t level)
+{
+    GLuint blocks = BlocksFor(count);
+    if (g_scanLevels.size() <= level) g_scanLevels.resize(level + 1, 0);
+    BufferHelpers::EnsureBufferCapacity(g_scanLevels[level], static_cast<GLsizeiptr>(blocks) * sizeof(GLuint));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    GLuint sums = g_scanLevels[level];
+
+    Bind(buffer, sums);
+    Dispatch(PASS_SCAN_LOCAL, count, blocks);
+    if (blocks == 1) return level;
+
+    size_t top = ScanLevel(sums, blocks, level + 1);
+    Bind(buffer, sums);
+    Dispatch(PASS_SCAN_ADD, count, blocks);
+    return top;
+}
+
+static void Begin()
+{
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    glUseProgram(g_program);
+}
+
+static void End()
+{
+    // Outputs are read as SSBOs, buffer textures or indirect arguments afterwards
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT |
+                    GL_COMMAND_BARRIER_BIT);
+    Bind(0, 0);
+    glUseProgram(0);
+}
+
+// ============================================================================
+// Start loading the shader (scratch buffers are created on first use)
+// ============================================================================
+bool GpuPrimitives::Init()
+{
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "gpu_primitives.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_passLoc = glGetUniformLocation(program, "uPass");
+                g_countLoc = glGetUniformLocation(program, "uCount");
+                g_firstBlockLoc = glGetUniformLocation(program, "uFirstBlock");
+                g_numBlocksLoc = glGetUniformLocation(program, "uNumBlocks");
+                g_shiftLoc = glGetUniformLocation(program, "uShift");
+                g_hasValuesLoc = glGetUniformLocation(program, "uHasValues");
+                g_reduceOpLoc = glGetUniformLocation(program, "uReduceOp");
+                g_ready = (g_passLoc != -1 && g_countLoc != -1 && g_firstBlockLoc != -1 && g_numBlocksLoc != -1 &&
+                           g_shiftLoc != -1 && g_hasValuesLoc != -1 && g_reduceOpLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[GpuPrimitives] gpu_primitives.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+// ============================================================================
+// Exclusive scan: blocks -> block sums -> add, recursing while there is more than one block
+// ============================================================================
+void GpuPrimitives::ExclusiveScan(GLuint buffer, GLuint count, GLuint totalSSBO, GLintptr totalOffset)
+{
+    if (!g_ready || buffer == 0) return;
+    if (count == 0)
+    {
+        if (totalSSBO != 0)
+        {
+            GLuint zero = 0;
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, totalSSBO);
+            glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, totalOffset, sizeof(GLuint),
+                                 GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+        return;
+    }
+
+    Begin();
+    size_t top = ScanLevel(buffer, count, 0);
+    if (totalSSBO != 0) CopyWord(g_scanLevels[top], 0, totalSSBO, totalOffset);
+    End();
+}
+
+// ============================================================================
+// LSD radix sort: per 4-bit digit, block histograms -> scan (digit-major, so each block
+// knows where its keys of each digit start) -> stable scatter into the other half
+// ============================================================================
+void GpuPrimitives::RadixSort(GLuint keys, GLuint values, GLuint count, int keyBits)
+{
+    if (!g_ready || keys == 0 || count < 2) return;
+
+    int passes = std::max(1, std::min(8, (keyBits + 3) / 4));
+    GLuint blocks = BlocksFor(count);
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(count) * sizeof(GLuint);
+    BufferHelpers::EnsureBufferCapacity(g_sortKeys, bytes);
+    if (values != 0) BufferHelpers::EnsureBufferCapacity(g_sortValues, bytes);
+    BufferHelpers::EnsureBufferCapacity(g_histogram, static_cast<GLsizeiptr>(blocks) * RADIX_DIGITS * sizeof(GLuint));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    Begin();
+    GLuint sourceKeys = keys, destinationKeys = g_sortKeys;
+    GLuint sourceValues = values, destinationValues = values != 0 ? g_sortValues : 0;
+    for (int pass = 0; pass < passes; pass++)
+    {
+        glUniform1ui(g_numBlocksLoc, blocks);
+        glUniform1ui(g_shiftLoc, static_cast<GLuint>(pass * 4));
+        glUniform1i(g_hasValuesLoc, values != 0 ? 1 : 0);
+        Bind(sourceKeys, g_histogram);
+        Dispatch(PASS_RADIX_HISTOGRAM, count, blocks);
+
+        ScanLevel(g_histogram, blocks * RADIX_DIGITS, 0);
+
+        // The scan dispatched with other uniforms
+        glUniform1ui(g_numBlocksLoc, blocks);
+        glUniform1ui(g_shiftLoc, static_cast<GLuint>(pass * 4));
+        Bind(sourceKeys, g_histogram, destinationKeys, sourceValues, destinationValues);
+        Dispatch(PASS_RADIX_SCATTER, count, blocks);
+
+        std::swap(sourceKeys, destinationKeys);
+        std::swap(sourceValues, destinationValues);
+    }
+
+    // An odd number of passes leaves the result in the scratch half
+    if (sourceKeys != keys)
+    {
+        CopyWords(sourceKeys, keys, count);
+        if (values != 0) CopyWords(sourceValues, values, count);
+    }
+    End();
+}
+
+// ============================================================================
+// Compaction: flags -> 0/1 -> exclusive scan (output slots) -> scatter
+// ============================================================================
+void GpuPrimitives::Compact(GLuint flags, GLuint values, GLuint count, GLuint output, GLuint countSSBO, GLintptr countOffset)
+{
+    if (!g_ready || flags == 0 || output == 0) return;
+    if (count == 0)
+    {
+        ExclusiveScan(output, 0, countSSBO, countOffset);
+        return;
+    }
+
+    BufferHelpers::EnsureBufferCapacity(g_flagScan, static_cast<GLsizeiptr>(count) * sizeof(GLuint));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    Begin();
+    Bind(flags, 0, g_flagScan);
+    Dispatch(PASS_COMPACT_FLAGS, count, BlocksFor(count));
+
+    size_t top = ScanLevel(g_flagScan, count, 0);
+    if (countSSBO != 0) CopyWord(g_scanLevels[top], 0, countSSBO, countOffset);
+
+    glUniform1i(g_hasValuesLoc, values != 0 ? 1 : 0);
+    Bind(flags, 0, g_flagScan, values, output);
+    Dispatch(PASS_COMPACT_SCATTER, count, BlocksFor(count));
+    End();
+}
+
+// ============================================================================
+// Segmented reduction: one workgroup per segment
+// ============================================================================
+void GpuPrimitives::SegmentedReduce(GLuint values, GLuint offsets, GLuint numSegments, GLuint output, ReduceOp op)
+{
+    if (!g_ready || values == 0 || offsets == 0 || output == 0 || numSegments == 0) return;
+
+    Begin();
+    glUniform1i(g_reduceOpLoc, op);
+    Bind(values, offsets, output);
+    Dispatch(PASS_SEGMENTED_REDUCE, numSegments, numSegments);
+    End();
+}
+
+// ============================================================================
+// Release scratch buffers and the program
+// ============================================================================
+void GpuPrimitives::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    for (GLuint& buffer : g_scanLevels)
+        if (buffer) glDeleteBuffers(1, &buffer);
+    g_scanLevels.clear();
+    GLuint* buffers[] = { &g_sortKeys, &g_sortValues, &g_histogram, &g_flagScan };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void GpuPrimitives::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool GpuPrimitives::IsReady()
+{
+    return g_ready;
+}
+
+std::string GpuPrimitives::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[gpu primitives] " + g_loader.GetStatusMessage();
+    return "GPU primitives shader ready";
+}
@@ -0,0 +1,167 @@
+#include "gpu_profiler.h"
+#include "frame_trace.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <thread>
+
+// Frames a pass can have in flight before its oldest result must have landed
+static const int PROFILE_QUERY_RING = 4;
+
+// Last PROFILE_WINDOW samples of one name
+struct SampleWindow
+{
+    double samples[GpuProfiler::PROFILE_WINDOW] = { 0.0 };
+    int count = 0;
+    int next = 0;
+
+    void Add(double milliseconds)
+    {
+        samples[next] = milliseconds;
+        next = (next + 1) % GpuProfiler::PROFILE_WINDOW;
+        count = std::min(count + 1, GpuProfiler::PROFILE_WINDOW);
+    }
+
+    double Mean() const
+    {
+        double sum = 0.0;
+        for (int i = 0; i < count; i++) sum += samples[i];
+        return count > 0 ? sum / count : 0.0;
+    }
+};
+
+struct GpuPass
+{
+    std::thread::id owner;
+    GLuint queries[PROFILE_QUERY_RING][2] = { { 0 } };  // Start and end timestamps per slot
+    bool pending[PROFILE_QUERY_RING] = { false };
+    int slot = 0;
+    bool open = false;  // Begin wrote the start of `slot`
+    SampleWindow window;
+};
+
+static std::mutex g_mutex;  // Guards the maps; the GL side of a pass only runs on its owner
+static std::map<std::string, GpuPass> g_gpuPasses;
+static std::map<std::string, SampleWindow> g_cpuTimes;
+static bool g_enabled = true;
+
+// ============================================================================
+// Settings
+// ============================================================================
+void GpuProfiler::SetEnabled(bool enabled)
+{
+    g_enabled = enabled;
+}
+
+bool GpuProfiler::GetEnabled()
+{
+    return g_enabled;
+}
+
+// ============================================================================
+// GPU passes
+// ============================================================================
+void GpuProfiler::Begin(const char* pass)
+{
+    if (!g_enabled) return;
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    auto it = g_gpuPasses.find(pass);
+    if (it == g_gpuPasses.end())
+    {
+        it = g_gpuPasses.emplace(pass, GpuPass()).first;
+        it->second.owner = std::this_thread::get_id();
+        glGenQueries(PROFILE_QUERY_RING * 2, &it->second.queries[0][0]);
+    }
+    GpuPass& p = it->second;
+    if (p.owner != std::this_thread::get_id() || p.open) return;
+
+    // Collect what this slot held; if it is still in flight the call goes untimed
+    if (p.pending[p.slot])
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(p.queries[p.slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(p.queries[p.slot][0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(p.queries[p.slot][1], GL_QUERY_RESULT, &end);
+        p.pending[p.slot] = false;
+        if (end >= start) p.window.Add(static_cast<double>(end - start) * 1e-6);
+        FRAME_TRACE_GPU(it->first, start, end);
+    }
+
+    glQueryCounter(p.queries[p.slot][0], GL_TIMESTAMP);
+    p.open = true;
+}
+
+void GpuProfiler::End(const char* pass)
+{
+    if (!g_enabled) return;
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    auto it = g_gpuPasses.find(pass);
+    if (it == g_gpuPasses.end()) return;
+    GpuPass& p = it->second;
+    if (p.owner != std::this_thread::get_id() || !p.open) return;
+
+    glQueryCounter(p.queries[p.slot][1], GL_TIMESTAMP);
+    p.pending[p.slot] = true;
+    p.slot = (p.slot + 1) % PROFILE_QUERY_RING;
+    p.open = false;
+}
+
+// ============================================================================
+// CPU timings
+// ============================================================================
+void GpuProfiler::RecordCpu(const char* name, double milliseconds)
+{
+    if (!g_enabled) return;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_cpuTimes[name].Add(milliseconds);
+}
+
+// ============================================================================
+// Results
+// ============================================================================
+std::vector<GpuProfiler::PassStats> GpuProfiler::GetGpuStats()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    std::vector<PassStats> stats;
+    for (const auto& entry : g_gpuPasses)
+        if (entry.second.window.count > 0)
+            stats.push_back({ entry.first, entry.second.window.Mean(), entry.second.window.count });
+    return stats;
+}
+
+std::vector<GpuProfiler::PassStats> GpuProfiler::GetCpuStats()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    std::vector<PassStats> stats;
+    for (const auto& entry : g_cpuTimes)
+        stats.push_back({ entry.first, entry.second.Mean(), entry.second.count });
+    return stats;
+}
+
+void GpuProfiler::Reset()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    for (auto& entry : g_gpuPasses) entry.second.window = SampleWindow();
+    g_cpuTimes.clear();
+}
+
+void GpuProfiler::Cleanup()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    for (auto it = g_gpuPasses.begin(); it != g_gpuPasses.end();)
+    {
+        if (it->second.owner == std::this_thread::get_id())
+        {
+            glDeleteQueries(PROFILE_QUERY_RING * 2, &it->second.queries[0][0]);
+            it = g_gpuPasses.erase(it);
+        }
+        else
+            ++it;
+    }
+    g_cpuTimes.clear();
+}
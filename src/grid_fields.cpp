@@ -0,0 +1,683 @@
+#include "grid_fields.h"
+#include "equation_codegen.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include "lookup_tables.h"
+#include "shader_utils.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+static const int GRID_TILE = 16;  // MUST MATCH grid_field.comp
+static const long long MAX_GRID_NODES = 1 << 22;
+
+struct GridField
+{
+    std::string name;
+    std::string expression;
+    int lookupId = -1;
+    GLuint program = 0;
+};
+
+// Grid
+static int g_width = 0, g_height = 0;
+static glm::vec2 g_min = glm::vec2(0.0f), g_max = glm::vec2(0.0f);
+static GridFields::Boundary g_boundary = GridFields::GRID_CLAMP;
+static std::vector<GridField> g_fields;
+
+// Values of every field, and the new values of the field being stepped
+static GLuint g_valuesBuffer = 0;
+static GLuint g_nextBuffer = 0;
+
+// Step programs, compiled from the template for each expression
+static std::string g_templateSource;
+
+// Async shader loading of the display program
+static GLuint g_displayProgram = 0;
+static GLuint g_displayVAO = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_projViewLoc = -1, g_gridMinLoc = -1, g_gridMaxLoc = -1, g_gridSizeLoc = -1, g_fieldLoc = -1;
+static GLint g_valueMinLoc = -1, g_valueMaxLoc = -1, g_opacityLoc = -1;
+static int g_displayField = -1;
+static float g_valueMin = -1.0f, g_valueMax = 1.0f, g_opacity = 1.0f;
+
+static int FieldIndex(const std::vector<GridField>& fields, const std::string& name)
+{
+    for (size_t f = 0; f < fields.size(); f++)
+        if (fields[f].name == name) return static_cast<int>(f);
+    return -1;
+}
+
+// ============================================================================
+// Stencil expressions to GLSL
+// ============================================================================
+
+// Names an expression gives meaning to, so no field may take them
+static bool IsReservedName(const std::string& name)
+{
+    static const char* const reserved[] = {
+        "i", "j", "x", "y", "t", "dt", "hx", "hy", "k", "b", "g", "pi", "e", "lap", "dx", "dy",
+        "sin", "cos", "tan", "sinh", "cosh", "tanh", "asin", "acos", "atan", "atan2", "exp", "log", "sqrt",
+        "abs", "floor", "ceil", "sign", "step", "min", "max", "mod", "pow", "clamp"
+    };
+    for (const char* word : reserved)
+        if (name == word) return true;
+    return false;
+}
+
+// Recursive descent over + - * / ^, calls and field accesses, writing GLSL as it goes. Every
+// field read becomes tileValue(n, di, dj) of its place n in the list of tiled fields.
+class StencilTranslator
+{
+public:
+    StencilTranslator(const std::string& text, const std::vector<GridField>& fields)
+        : m_text(text), m_fields(fields) {}
+
+    std::string Translate()
+    {
+        Next();
+        std::string code = Expression();
+        if (m_kind != TOKEN_END) Fail("unexpected '" + m_token + "'");
+        return code;
+    }
+
+    std::vector<int> tileFields;  // Field indices in tile order
+    int halo = 0;
+
+private:
+    enum Kind { TOKEN_END, TOKEN_NUMBER, TOKEN_NAME, TOKEN_SYMBOL };
+
+    [[noreturn]] void Fail(const std::string& message)
+    {
+        throw std::runtime_error(message + " at position " + std::to_string(m_start));
+    }
+
+    void Next()
+    {
+        while (m_pos < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_pos]))) m_pos++;
+        m_start = m_pos;
+        if (m_pos >= m_text.size())
+        {
+            m_kind = TOKEN_END;
+            m_token.clear();
+            return;
+        }
+
+        char c = m_text[m_pos];
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.')
+        {
+            while (m_pos < m_text.size() && (std::isdigit(static_cast<unsigned char>(m_text[m_pos])) || m_text[m_pos] == '.')) m_pos++;
+            if (m_pos < m_text.size() && (m_text[m_pos] == 'e' || m_text[m_pos] == 'E'))
+            {
+                size_t exponent = m_pos + 1;
+                if (exponent < m_text.size() && (m_text[exponent] == '+' || m_text[exponent] == '-')) exponent++;
+                if (exponent < m_text.size() && std::isdigit(static_cast<unsigned char>(m_text[exponent])))
+                {
+                    m_pos = exponent;
+                    while (m_pos < m_text.size() && std::isdigit(static_cast<unsigned char>(m_text[m_pos]))) m_pos++;
+                }
+            }
+            m_token = m_text.substr(m_start, m_pos - m_start);
+            char* end = nullptr;
+            std::strtod(m_token.c_str(), &end);
+            if (end != m_token.c_str() + m_token.size()) Fail("malformed number '" + m_token + "'");
+            m_kind = TOKEN_NUMBER;
+        }
+        else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_')
+        {
+            while (m_pos < m_text.size() && (std::isalnum(static_cast<unsigned char>(m_text[m_pos])) || m_text[m_pos] == '_')) m_pos++;
+            m_token = m_text.substr(m_start, m_pos - m_start);
+            m_kind = TOKEN_NAME;
+        }
+        else if (std::string("+-*/^()[],").find(c) != std::string::npos)
+        {
+            m_token = std::string(1, c);
+            m_pos++;
+            m_kind = TOKEN_SYMBOL;
+        }
+        else Fail(std::string("unexpected character '") + c + "'");
+    }
+
+    bool Accept(const char* symbol)
+    {
+        if (m_kind != TOKEN_SYMBOL || m_token != symbol) return false;
+        Next();
+        return true;
+    }
+
+    void Expect(const char* symbol)
+    {
+        if (!Accept(symbol)) Fail(std::string("expected '") + symbol + "'");
+    }
+
+    std::string Expression()
+    {
+        std::string code = Term();
+        while (m_kind == TOKEN_SYMBOL && (m_token == "+" || m_token == "-"))
+        {
+            std::string op = m_token;
+            Next();
+            code = "(" + code + " " + op + " " + Term() + ")";
+        }
+        return code;
+    }
+
+    std::string Term()
+    {
+        std::string code = Unary();
+        while (m_kind == TOKEN_SYMBOL && (m_token == "*" || m_token == "/"))
+        {
+            std::string op = m_token;
+            Next();
+            code = "(" + code + " " + op + " " + Unary() + ")";
+        }
+        return code;
+    }
+
+    std::string Unary()
+    {
+        if (Accept("-")) return "(-" + Unary() + ")";
+        if (Accept("+")) return Unary();
+        return Power();
+    }
+
+    // Right associative, and above unary minus on its left: -u^2 is -(u^2)
+    std::string Power()
+    {
+        std::string base = Primary();
+        if (!Accept("^")) return base;
+        return "gridPow(" + base + ", " + Unary() + ")";
+    }
+
+    std::string Primary()
+    {
+        if (m_kind == TOKEN_NUMBER)
+        {
+            std::string number = m_token;
+            if (number.find_first_of(".eE") == std::string::npos) number += ".0";
+            if (number[0] == '.') number = "0" + number;
+            Next();
+            return number;
+        }
+        if (Accept("("))
+        {
+            std::string code = Expression();
+            Expect(")");
+            return code;
+        }
+        if (m_kind != TOKEN_NAME) Fail(m_kind == TOKEN_END ? "unexpected end" : "unexpected '" + m_token + "'");
+
+        std::string name = m_token;
+        Next();
+        int field = FieldIndex(m_fields, name);
+        if (field >= 0)
+        {
+            int di = 0, dj = 0;
+            if (Accept("["))
+            {
+                di = Offset("i");
+                Expect(",");
+                dj = Offset("j");
+                Expect("]");
+            }
+            return Sample(field, di, dj);
+        }
+        if (m_kind == TOKEN_SYMBOL && m_token == "(") return Call(name);
+        return Variable(name);
+    }
+
+    // i, i+n or i-n
+    int Offset(const char* index)
+    {
+        if (m_kind != TOKEN_NAME || m_token != index) Fail(std::string("expected '") + index + "'");
+        Next();
+        int sign = Accept("+") ? 1 : Accept("-") ? -1 : 0;
+        if (sign == 0) return 0;
+        if (m_kind != TOKEN_NUMBER || m_token.find_first_not_of("0123456789") != std::string::npos)
+            Fail("expected a whole number of nodes");
+        int offset = std::atoi(m_token.c_str());
+        if (offset > GridFields::MAX_STENCIL_OFFSET)
+            Fail("offsets reach at most " + std::to_string(GridFields::MAX_STENCIL_OFFSET) + " nodes");
+        Next();
+        return sign * offset;
+    }
+
+    std::string Sample(int field, int di, int dj)
+    {
+        auto it = std::find(tileFields.begin(), tileFields.end(), field);
+        int n = static_cast<int>(it - tileFields.begin());
+        if (it == tileFields.end()) tileFields.push_back(field);
+        halo = std::max(halo, std::max(std::abs(di), std::abs(dj)));
+        return "tileValue(" + std::to_string(n) + ", " + std::to_string(di) + ", " + std::to_string(dj) + ")";
+    }
+
+    // lap(u), dx(u) and dy(u) by central differences
+    std::string Derivative(const std::string& op)
+    {
+        if (m_kind != TOKEN_NAME || FieldIndex(m_fields, m_token) < 0) Fail(op + "() takes the name of a field");
+        int field = FieldIndex(m_fields, m_token);
+        Next();
+        Expect(")");
+
+        std::string centre = Sample(field, 0, 0);
+        if (op == "dx") return "((" + Sample(field, 1, 0) + " - " + Sample(field, -1, 0) + ") / (2.0 * uSpacing.x))";
+        if (op == "dy") return "((" + Sample(field, 0, 1) + " - " + Sample(field, 0, -1) + ") / (2.0 * uSpacing.y))";
+        return "((" + Sample(field, 1, 0) + " + " + Sample(field, -1, 0) + " - 2.0 * " + centre + ") / (uSpacing.x * uSpacing.x) + (" +
+               Sample(field, 0, 1) + " + " + Sample(field, 0, -1) + " - 2.0 * " + centre + ") / (uSpacing.y * uSpacing.y))";
+    }
+
+    std::string Call(const std::string& name)
+    {
+        Expect("(");
+        if (name == "lap" || name == "dx" || name == "dy") return Derivative(name);
+
+        struct Function { const char* name; const char* glsl; int arguments; };
+        static const Function functions[] = {
+            { "sin", "sin", 1 }, { "cos", "cos", 1 }, { "tan", "tan", 1 },
+            { "sinh", "sinh", 1 }, { "cosh", "cosh", 1 }, { "tanh", "tanh", 1 },
+            { "asin", "asin", 1 }, { "acos", "acos", 1 }, { "atan", "atan", 1 }, { "atan2", "atan", 2 },
+            { "exp", "safeExp", 1 }, { "log", "safeLog", 1 }, { "sqrt", "gridSqrt", 1 }, { "abs", "abs", 1 },
+            { "floor", "floor", 1 }, { "ceil", "ceil", 1 }, { "sign", "signFunc", 1 }, { "step", "stepFunc", 1 },
+            { "min", "min", 2 }, { "max", "max", 2 }, { "mod", "mod", 2 }, { "pow", "gridPow", 2 },
+            { "clamp", "clamp", 3 }
+        };
+        const Function* function = nullptr;
+        for (const Function& f : functions)
+            if (name == f.name) function = &f;
+        if (!function) Fail("unknown function '" + name + "'");
+
+        std::string code = std::string(function->glsl) + "(";
+        for (int a = 0; a < function->arguments; a++)
+        {
+            if (a > 0)
+            {
+                Expect(",");
+                code += ", ";
+            }
+            code += Expression();
+        }
+        Expect(")");
+        return code + ")";
+    }
+
+    std::string Variable(const std::string& name)
+    {
+        static const char* const variables[][2] = {
+            { "x", "x" }, { "y", "y" }, { "t", "uTime" }, { "dt", "uDt" },
+            { "hx", "uSpacing.x" }, { "hy", "uSpacing.y" }, { "k", "k" }, { "b", "b" }, { "g", "g" },
+            { "pi", "PI" }, { "e", "E" }
+        };
+        for (const auto& variable : variables)
+            if (name == variable[0]) return variable[1];
+        Fail("unknown name '" + name + "'");
+    }
+
+    std::string m_text;
+    const std::vector<GridField>& m_fields;
+    size_t m_pos = 0, m_start = 0;
+    Kind m_kind = TOKEN_END;
+    std::string m_token;
+};
+
+// Step program of field f, with fields naming everything its expression may read
+static GLuint CompileStepProgram(const std::vector<GridField>& fields, int f, std::string& error)
+{
+    if (g_templateSource.empty())
+    {
+        std::string hash;
+        if (!LoadShaderSource("grid_field.comp", g_templateSource, hash))
+        {
+            error = "grid_field.comp not found";
+            return 0;
+        }
+    }
+
+    StencilTranslator translator(fields[f].expression, fields);
+    std::string rate;
+    try
+    {
+        rate = translator.Translate();
+    }
+    catch (const std::exception& e)
+    {
+        error = "Field '" + fields[f].name + "': " + e.what();
+        return 0;
+    }
+    if (translator.tileFields.empty()) translator.tileFields.push_back(f);  // The tiles need a field
+
+    std::string count = std::to_string(translator.tileFields.size());
+    std::string list;
+    for (int field : translator.tileFields) list += (list.empty() ? "" : ", ") + std::to_string(field);
+    std::string block = std::string(EquationCodegen::BLOCK_BEGIN_MARKER) + "\n" +
+        "const int HALO = " + std::to_string(translator.halo) + ";\n" +
+        "const int NUM_TILE_FIELDS = " + count + ";\n" +
+        "const int TILE_FIELDS[" + count + "] = int[" + count + "](" + list + ");\n" +
+        "float tileValue(int n, int di, int dj);\n" +
+        "float stencilRate(float x, float y) {\n    return " + rate + ";\n}\n" +
+        EquationCodegen::BLOCK_END_MARKER;
+    std::string source = EquationCodegen::SpliceEquationBlock(g_templateSource, block);
+    if (source.empty())
+    {
+        error = "grid_field.comp has no stencil block";
+        return 0;
+    }
+
+    GLuint program = CreateComputeProgram(source.c_str());
+    if (program == 0) error = "Field '" + fields[f].name + "': the stencil shader failed to compile";
+    return program;
+}
+
+// ============================================================================
+// Display program
+// ============================================================================
+bool GridFields::Init()
+{
+    if (g_displayVAO == 0) glGenVertexArrays(1, &g_displayVAO);  // Core profiles draw with a VAO bound
+
+    if (g_displayProgram == 0)
+    {
+        g_loader.LoadGraphicsShaderAsync(
+            "grid_field.vert",
+            "grid_field.frag",
+            "",
+            [](GLuint program)
+            {
+                g_displayProgram = program;
+                g_projViewLoc = glGetUniformLocation(program, "uProjView");
+                g_gridMinLoc = glGetUniformLocation(program, "uGridMin");
+                g_gridMaxLoc = glGetUniformLocation(program, "uGridMax");
+                g_gridSizeLoc = glGetUniformLocation(program, "uGridSize");
+                g_fieldLoc = glGetUniformLocation(program, "uField");
+                g_valueMinLoc = glGetUniformLocation(program, "uValueMin");
+                g_valueMaxLoc = glGetUniformLocation(program, "uValueMax");
+                g_opacityLoc = glGetUniformLocation(program, "uOpacity");
+                g_ready = (g_projViewLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[GridFields] grid_field shaders FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+// ============================================================================
+// Grid and fields
+// ============================================================================
+bool GridFields::SetGrid(int width, int height, const glm::vec2& min, const glm::vec2& max, Boundary boundary,
+                         std::string& error)
+{
+    if (width < 2 || height < 2 || static_cast<long long>(width) * height > MAX_GRID_NODES)
+    {
+        error = "A grid needs 2 to " + std::to_string(MAX_GRID_NODES) + " nodes and at least 2 per side";
+        return false;
+    }
+    if (!(max.x > min.x) || !(max.y > min.y))
+    {
+        error = "The grid box needs a positive width and height";
+        return false;
+    }
+
+    Clear();
+    GLsizeiptr nodes = static_cast<GLsizeiptr>(width) * height;
+    BufferHelpers::EnsureBufferCapacity(g_valuesBuffer, nodes * MAX_GRID_FIELDS * sizeof(float));
+    BufferHelpers::EnsureBufferCapacity(g_nextBuffer, nodes * sizeof(float));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    g_width = width;
+    g_height = height;
+    g_min = min;
+    g_max = max;
+    g_boundary = boundary;
+    return true;
+}
+
+bool GridFields::SetField(const std::string& name, const std::vector<float>& values, const std::string& expression,
+                          int lookupId, std::string& error)
+{
+    if (g_width == 0)
+    {
+        error = "Set the grid before its fields";
+        return false;
+    }
+    bool identifier = !name.empty() && (std::isalpha(static_cast<unsigned char>(name[0])) || name[0] == '_');
+    for (char c : name) identifier = identifier && (std::isalnum(static_cast<unsigned char>(c)) || c == '_');
+    if (!identifier || IsReservedName(name))
+    {
+        error = "'" + name + "' cannot name a field: it has to be an identifier other than a variable or function";
+        return false;
+    }
+    size_t nodes = static_cast<size_t>(g_width) * g_height;
+    if (values.size() != nodes)
+    {
+        error = "Field '" + name + "' needs " + std::to_string(g_width) + " x " + std::to_string(g_height) + " values";
+        return false;
+    }
+    if (lookupId >= LookupTables::MAX_LOOKUP_FIELDS)
+    {
+        error = "Field ids are below " + std::to_string(LookupTables::MAX_LOOKUP_FIELDS);
+        return false;
+    }
+
+    std::vector<GridField> fields = g_fields;
+    int f = FieldIndex(fields, name);
+    if (f < 0)
+    {
+        if (static_cast<int>(fields.size()) >= MAX_GRID_FIELDS)
+        {
+            error = "A grid holds at most " + std::to_string(MAX_GRID_FIELDS) + " fields";
+            return false;
+        }
+        f = static_cast<int>(fields.size());
+        fields.push_back(GridField());
+        fields[f].name = name;
+    }
+    for (size_t other = 0; other < fields.size(); other++)
+    {
+        if (lookupId >= 0 && static_cast<int>(other) != f && fields[other].lookupId == lookupId)
+        {
+            error = "Field id " + std::to_string(lookupId) + " already shows '" + fields[other].name + "'";
+            return false;
+        }
+    }
+    fields[f].expression = expression;
+    fields[f].lookupId = lookupId;
+
+    // A new name can make the expressions of the others valid or change nothing, but every
+    // program is rebuilt so the set that runs always compiled together
+    std::vector<GLuint> programs;
+    for (size_t other = 0; other < fields.size(); other++)
+    {
+        GLuint program = CompileStepProgram(fields, static_cast<int>(other), error);
+        if (program == 0)
+        {
+            for (GLuint built : programs) glDeleteProgram(built);
+            return false;
+        }
+        programs.push_back(program);
+    }
+
+    int previousLookup = f < static_cast<int>(g_fields.size()) ? g_fields[f].lookupId : -1;
+    for (size_t other = 0; other < fields.size(); other++)
+    {
+        if (other < g_fields.size() && g_fields[other].program) glDeleteProgram(g_fields[other].program);
+        fields[other].program = programs[other];
+    }
+    g_fields = fields;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_valuesBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, static_cast<GLintptr>(f) * nodes * sizeof(float), nodes * sizeof(float), values.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    if (previousLookup >= 0 && previousLookup != lookupId) LookupTables::ClearField(previousLookup);
+    if (lookupId >= 0) LookupTables::SetField(lookupId, values, g_width, g_height, g_min, g_max);
+    return true;
+}
+
+void GridFields::Clear()
+{
+    for (GridField& field : g_fields)
+    {
+        if (field.program) glDeleteProgram(field.program);
+        if (field.lookupId >= 0) LookupTables::ClearField(field.lookupId);
+    }
+    g_fields.clear();
+    g_displayField = -1;
+    g_width = g_height = 0;
+}
+
+bool GridFields::IsActive()
+{
+    return !g_fields.empty();
+}
+
+glm::ivec2 GridFields::GetSize()
+{
+    return glm::ivec2(g_width, g_height);
+}
+
+// ============================================================================
+// Step every field in order
+// ============================================================================
+void GridFields::Step()
+{
+    if (g_fields.empty()) return;
+
+    GLsizeiptr nodes = static_cast<GLsizeiptr>(g_width) * g_height;
+    glm::vec2 spacing = (g_max - g_min) / glm::vec2(g_width - 1, g_height - 1);
+    GLuint groupsX = static_cast<GLuint>((g_width + GRID_TILE - 1) / GRID_TILE);
+    GLuint groupsY = static_cast<GLuint>((g_height + GRID_TILE - 1) / GRID_TILE);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GRID_FIELDS_VALUES_BINDING, g_valuesBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GRID_FIELDS_NEXT_BINDING, g_nextBuffer);
+    for (size_t f = 0; f < g_fields.size(); f++)
+    {
+        GLuint program = g_fields[f].program;
+        glUseProgram(program);
+        glUniform2i(glGetUniformLocation(program, "uGridSize"), g_width, g_height);
+        glUniform2fv(glGetUniformLocation(program, "uGridMin"), 1, glm::value_ptr(g_min));
+        glUniform2fv(glGetUniformLocation(program, "uSpacing"), 1, glm::value_ptr(spacing));
+        glUniform1i(glGetUniformLocation(program, "uBoundary"), static_cast<GLint>(g_boundary));
+        glUniform1i(glGetUniformLocation(program, "uField"), static_cast<GLint>(f));
+        glDispatchCompute(groupsX, groupsY, 1);
+
+        // The new values replace the old ones before the next field reads them
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBuffer(GL_COPY_READ_BUFFER, g_nextBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, g_valuesBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, static_cast<GLintptr>(f) * nodes * sizeof(float),
+                            nodes * sizeof(float));
+        if (g_fields[f].lookupId >= 0) LookupTables::CopyField(g_fields[f].lookupId, g_nextBuffer, g_width, g_height);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GRID_FIELDS_VALUES_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GRID_FIELDS_NEXT_BINDING, 0);
+    glUseProgram(0);
+}
+
+bool GridFields::GetValues(const std::string& name, std::vector<float>& values)
+{
+    int f = FieldIndex(g_fields, name);
+    if (f < 0) return false;
+    size_t nodes = static_cast<size_t>(g_width) * g_height;
+    values.resize(nodes);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_valuesBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, static_cast<GLintptr>(f) * nodes * sizeof(float), nodes * sizeof(float), values.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return true;
+}
+
+// ============================================================================
+// Colour-mapped display
+// ============================================================================
+bool GridFields::SetDisplay(const std::string& name, float valueMin, float valueMax, float opacity)
+{
+    if (name.empty())
+    {
+        g_displayField = -1;
+        return true;
+    }
+    int f = FieldIndex(g_fields, name);
+    if (f < 0 || !(valueMax > valueMin)) return false;
+    g_displayField = f;
+    g_valueMin = valueMin;
+    g_valueMax = valueMax;
+    g_opacity = std::min(std::max(opacity, 0.0f), 1.0f);
+    return true;
+}
+
+void GridFields::Draw(const glm::mat4& projView)
+{
+    if (!g_ready || g_displayField < 0 || g_displayField >= static_cast<int>(g_fields.size())) return;
+
+    glUseProgram(g_displayProgram);
+    glUniformMatrix4fv(g_projViewLoc, 1, GL_FALSE, glm::value_ptr(projView));
+    glUniform2fv(g_gridMinLoc, 1, glm::value_ptr(g_min));
+    glUniform2fv(g_gridMaxLoc, 1, glm::value_ptr(g_max));
+    glUniform2i(g_gridSizeLoc, g_width, g_height);
+    glUniform1i(g_fieldLoc, g_displayField);
+    glUniform1f(g_valueMinLoc, g_valueMin);
+    glUniform1f(g_valueMaxLoc, g_valueMax);
+    glUniform1f(g_opacityLoc, g_opacity);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GRID_FIELDS_VALUES_BINDING, g_valuesBuffer);
+
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    if (g_opacity < 1.0f)
+    {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+    glBindVertexArray(g_displayVAO);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    if (!blend) glDisable(GL_BLEND);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GRID_FIELDS_VALUES_BINDING, 0);
+    glUseProgram(0);
+}
+
+// ============================================================================
+// Release the buffers and programs
+// ============================================================================
+void GridFields::Cleanup()
+{
+    Clear();
+    g_templateSource.clear();
+    if (g_displayProgram) glDeleteProgram(g_displayProgram);
+    g_displayProgram = 0;
+    g_ready = false;
+
+    GLuint* buffers[] = { &g_valuesBuffer, &g_nextBuffer };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    if (g_displayVAO) glDeleteVertexArrays(1, &g_displayVAO);
+    g_displayVAO = 0;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void GridFields::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool GridFields::IsReady()
+{
+    return g_ready;
+}
+
+std::string GridFields::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[grid fields] " + g_loader.GetStatusMessage();
+    return "Grid field shaders ready";
+}
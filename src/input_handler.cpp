@@ -34,42 +34,8 @@ void InputHandler::MouseButtonCallback(GLFWwindow* window, int button, int actio
         if (action == GLFW_PRESS) {
             g_mouseIsDown = true;
 
-            std::vector<Object> currentCpuObjects;
-            Objects::FetchToCPU(Renderer::GetCurrentObjectBuffer(), currentCpuObjects);
-
-            g_draggedObjectIndex = -1;
-            float min_dist_sq = 1e9;
-
-            for (size_t i = 0; i < currentCpuObjects.size(); ++i) {
-                glm::vec2 object_pos = currentCpuObjects[i].position;
-                float dist_sq = glm::dot(object_pos - g_worldMousePos, 
-                                        object_pos - g_worldMousePos);
-
-                // Pick radius based on skin type
-                float pick_radius = 0.2f; // Default
-
-                if (currentCpuObjects[i].visualSkinType == SKIN_CIRCLE) {
-                    // visualData.x = radius
-                    pick_radius = currentCpuObjects[i].visualData.x * 1.2f;
-                } 
-                else if (currentCpuObjects[i].visualSkinType == SKIN_RECTANGLE) {
-                    // visualData: (width, height, rotation, alpha)
-                    float width = currentCpuObjects[i].visualData.x;
-                    float height = currentCpuObjects[i].visualData.y;
-                    pick_radius = glm::length(glm::vec2(width, height)) * 0.7f;
-                }
-                else if (currentCpuObjects[i].visualSkinType == SKIN_POLYGON) {
-                    // visualData.x = radius
-                    pick_radius = currentCpuObjects[i].visualData.x * 1.2f;
-                }
-
-                if (dist_sq < (pick_radius * pick_radius)) {
-                    if (dist_sq < min_dist_sq) {
-                        min_dist_sq = dist_sq;
-                        g_draggedObjectIndex = i;
-                    }
-                }
-            }
+            // Picked on the GPU; only the hit index comes back
+            g_draggedObjectIndex = Objects::PickObject(Renderer::GetCurrentObjectBuffer(), g_worldMousePos);
 
             if (g_draggedObjectIndex != -1) {
                 std::cout << "[Drag] Started dragging object " 
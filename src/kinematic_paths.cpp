@@ -0,0 +1,214 @@
+#include "kinematic_paths.h"
+#include "lookup_tables.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static const int PATH_ROW_FLOATS = 4;           // x slot, y slot, period, 1 = kinematic
+static const int SAMPLES_PER_KEY_INTERVAL = 4;  // Keyframe resampling, per shortest interval
+static const int MAX_KEYFRAME_SAMPLES = 4096;
+
+// Buffer, buffer texture and the host copy
+static GLuint g_pathsBuffer = 0;
+static GLuint g_pathsTexture = 0;
+static std::vector<float> g_rows;
+static int g_maxObjects = 0;
+static int g_count = 0;
+
+// Rows edited since the last upload, [g_dirtyBegin, g_dirtyEnd)
+static int g_dirtyBegin = 0;
+static int g_dirtyEnd = 0;
+
+static void MarkDirty(int index)
+{
+    if (g_dirtyBegin >= g_dirtyEnd)
+    {
+        g_dirtyBegin = index;
+        g_dirtyEnd = index + 1;
+        return;
+    }
+    g_dirtyBegin = std::min(g_dirtyBegin, index);
+    g_dirtyEnd = std::max(g_dirtyEnd, index + 1);
+}
+
+static float* Row(int index)
+{
+    return &g_rows[static_cast<size_t>(index) * PATH_ROW_FLOATS];
+}
+
+// ============================================================================
+// Initialize the buffer and its buffer texture
+// ============================================================================
+bool KinematicPaths::Init(int maxObjects)
+{
+    return Reserve(maxObjects);
+}
+
+bool KinematicPaths::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+    g_rows.resize(static_cast<size_t>(maxObjects) * PATH_ROW_FLOATS, 0.0f);
+
+    BufferHelpers::EnsureBufferCapacity(g_pathsBuffer,
+                                        static_cast<GLsizeiptr>(maxObjects) * PATH_ROW_FLOATS * sizeof(float),
+                                        GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // A grown buffer is a new buffer object, so the texture is re-attached
+    if (g_pathsTexture == 0) glGenTextures(1, &g_pathsTexture);
+    glActiveTexture(GL_TEXTURE0 + KINEMATIC_PATHS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_pathsTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, g_pathsBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[KinematicPaths] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Host edits
+// ============================================================================
+void KinematicPaths::Set(int index, int tableX, int tableY, float period)
+{
+    if (index < 0 || index >= g_maxObjects) return;
+    float* row = Row(index);
+    if (row[3] == 0.0f) g_count++;
+    row[0] = static_cast<float>(tableX);
+    row[1] = static_cast<float>(tableY);
+    row[2] = std::max(period, 0.0f);
+    row[3] = 1.0f;
+    MarkDirty(index);
+}
+
+bool KinematicPaths::IsKinematic(int index)
+{
+    return index >= 0 && index < g_maxObjects && Row(index)[3] != 0.0f;
+}
+
+bool KinematicPaths::Get(int index, int& tableX, int& tableY, float& period)
+{
+    if (!IsKinematic(index)) return false;
+    const float* row = Row(index);
+    tableX = static_cast<int>(row[0]);
+    tableY = static_cast<int>(row[1]);
+    period = row[2];
+    return true;
+}
+
+int KinematicPaths::GetCount()
+{
+    return g_count;
+}
+
+void KinematicPaths::Clear(int index)
+{
+    if (!IsKinematic(index)) return;
+    std::fill(Row(index), Row(index) + PATH_ROW_FLOATS, 0.0f);
+    g_count--;
+    MarkDirty(index);
+}
+
+void KinematicPaths::Move(int to, int from)
+{
+    if (to == from || to < 0 || from < 0 || to >= g_maxObjects || from >= g_maxObjects) return;
+    Clear(to);
+    if (!IsKinematic(from)) return;
+    std::copy(Row(from), Row(from) + PATH_ROW_FLOATS, Row(to));
+    g_count++;
+    MarkDirty(to);
+    Clear(from);
+}
+
+void KinematicPaths::Permute(const std::vector<int>& order)
+{
+    int count = std::min(static_cast<int>(order.size()), g_maxObjects);
+    if (count == 0 || g_count == 0) return;
+    std::vector<float> rows(g_rows.begin(), g_rows.begin() + static_cast<size_t>(count) * PATH_ROW_FLOATS);
+    for (int i = 0; i < count; i++)
+        std::copy_n(&rows[static_cast<size_t>(order[i]) * PATH_ROW_FLOATS], PATH_ROW_FLOATS, Row(i));
+    MarkDirty(0);
+    MarkDirty(count - 1);
+}
+
+// ============================================================================
+// Keyframes -> two evenly sampled tables
+// ============================================================================
+bool KinematicPaths::SetKeyframes(int tableX, int tableY, const std::vector<float>& times,
+                                  const std::vector<float>& xs, const std::vector<float>& ys)
+{
+    size_t keys = times.size();
+    if (keys < 2 || xs.size() != keys || ys.size() != keys) return false;
+    if (tableX < 0 || tableX >= LookupTables::MAX_LOOKUP_TABLES || tableY < 0 || tableY >= LookupTables::MAX_LOOKUP_TABLES)
+        return false;
+
+    float shortest = INFINITY;
+    for (size_t k = 1; k < keys; k++)
+    {
+        float interval = times[k] - times[k - 1];
+        if (!(interval > 0.0f)) return false;
+        shortest = std::min(shortest, interval);
+    }
+
+    float span = times.back() - times.front();
+    int samples = static_cast<int>(std::ceil(span / shortest * SAMPLES_PER_KEY_INTERVAL)) + 1;
+    samples = std::min(std::max(samples, 2), MAX_KEYFRAME_SAMPLES);
+
+    std::vector<float> sx(samples), sy(samples);
+    size_t k = 0;
+    for (int s = 0; s < samples; s++)
+    {
+        float t = times.front() + span * static_cast<float>(s) / static_cast<float>(samples - 1);
+        while (k + 2 < keys && t > times[k + 1]) k++;
+        float f = std::min(std::max((t - times[k]) / (times[k + 1] - times[k]), 0.0f), 1.0f);
+        sx[s] = xs[k] + (xs[k + 1] - xs[k]) * f;
+        sy[s] = ys[k] + (ys[k + 1] - ys[k]) * f;
+    }
+    return LookupTables::SetTable(tableX, sx, times.front(), times.back(), LookupTables::LOOKUP_LINEAR) &&
+           LookupTables::SetTable(tableY, sy, times.front(), times.back(), LookupTables::LOOKUP_LINEAR);
+}
+
+// ============================================================================
+// Upload the edited rows in one call and bind the texture
+// ============================================================================
+void KinematicPaths::Bind()
+{
+    if (g_pathsTexture == 0) return;
+
+    if (g_dirtyBegin < g_dirtyEnd)
+    {
+        GLintptr offset = static_cast<GLintptr>(g_dirtyBegin) * PATH_ROW_FLOATS * sizeof(float);
+        GLsizeiptr size = static_cast<GLsizeiptr>(g_dirtyEnd - g_dirtyBegin) * PATH_ROW_FLOATS * sizeof(float);
+        glBindBuffer(GL_TEXTURE_BUFFER, g_pathsBuffer);
+        glBufferSubData(GL_TEXTURE_BUFFER, offset, size, Row(g_dirtyBegin));
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        g_dirtyBegin = g_dirtyEnd = 0;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + KINEMATIC_PATHS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_pathsTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// ============================================================================
+// Release the buffer and texture
+// ============================================================================
+void KinematicPaths::Cleanup()
+{
+    if (g_pathsTexture) glDeleteTextures(1, &g_pathsTexture);
+    if (g_pathsBuffer) glDeleteBuffers(1, &g_pathsBuffer);
+    g_pathsTexture = 0;
+    g_pathsBuffer = 0;
+    g_rows.clear();
+    g_maxObjects = 0;
+    g_count = 0;
+    g_dirtyBegin = g_dirtyEnd = 0;
+}
@@ -0,0 +1,275 @@
+#include "long_range.h"
+#include "broadphase.h"
+#include "particle_mesh.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+// Solver passes - MUST MATCH long_range.comp
+enum LongRangePass
+{
+    TREE_PASS_CLEAR_BOUNDS = 0,
+    TREE_PASS_BOUNDS = 1,
+    TREE_PASS_MORTON = 2,
+    TREE_PASS_RADIX_HISTOGRAM = 3,
+    TREE_PASS_RADIX_SCAN = 4,
+    TREE_PASS_RADIX_SCATTER = 5,
+    TREE_PASS_BUILD = 6,
+    TREE_PASS_AGGREGATE = 7,
+    TREE_PASS_FORCES = 8
+};
+
+static const GLuint TREE_WORK_GROUP_SIZE = 256;
+static const int RADIX_BITS_PER_PASS = 4;
+static const int RADIX_DIGITS = 1 << RADIX_BITS_PER_PASS;
+static const GLsizeiptr TREE_NODE_SIZE = 64;  // sizeof(TreeNode) in long_range.comp
+
+// Buffers (the tree build uses the broadphase binding points)
+static GLuint g_accelSSBO = 0;            // FieldAccel (long-range and fluid vec4s) per object
+static GLuint g_nodesSSBO = 0;            // 2N-1 tree nodes
+static GLuint g_sortSSBO[2] = { 0, 0 };   // Radix sort ping-pong (morton code, object index)
+static GLuint g_radixHistogramSSBO = 0;   // Digit-major per-block histogram
+static GLuint g_sceneBoundsSSBO = 0;      // Scene AABB of object positions
+static int g_maxObjects = 0;
+
+// Solver parameters
+static float g_theta = 0.5f;
+static float g_gravityConstant = 1.0f;
+static float g_coulombConstant = 1.0f;
+static float g_softening = 0.01f;
+static LongRangeMethod g_method = LONG_RANGE_BARNES_HUT;
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_passLoc = -1;
+static GLint g_numObjectsLoc = -1;
+static GLint g_radixShiftLoc = -1;
+static GLint g_numBlocksLoc = -1;
+static GLint g_thetaLoc = -1;
+static GLint g_gravityConstantLoc = -1;
+static GLint g_coulombConstantLoc = -1;
+static GLint g_softeningLoc = -1;
+
+// Create an SSBO of the given size if it does not exist yet
+static void EnsureBuffer(GLuint& buffer, GLsizeiptr size)
+{
+    BufferHelpers::EnsureBufferCapacity(buffer, size);
+}
+
+static GLuint NumBlocks(GLuint numItems)
+{
+    return (std::max(numItems, 1u) + TREE_WORK_GROUP_SIZE - 1) / TREE_WORK_GROUP_SIZE;
+}
+
+// Run a single solver pass over the given number of items
+static void DispatchPass(int pass, GLuint numItems)
+{
+    glUniform1i(g_passLoc, pass);
+    glDispatchCompute(NumBlocks(numItems), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// ============================================================================
+// Initialize buffers and start loading the solver shader
+// ============================================================================
+bool LongRange::Init(int maxObjects)
+{
+    if (!Reserve(maxObjects)) return false;
+    ParticleMesh::Init();
+
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "long_range.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_passLoc = glGetUniformLocation(program, "uPass");
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_radixShiftLoc = glGetUniformLocation(program, "uRadixShift");
+                g_numBlocksLoc = glGetUniformLocation(program, "uNumBlocks");
+                g_thetaLoc = glGetUniformLocation(program, "uTheta");
+                g_gravityConstantLoc = glGetUniformLocation(program, "uGravityConstant");
+                g_coulombConstantLoc = glGetUniformLocation(program, "uCoulombConstant");
+                g_softeningLoc = glGetUniformLocation(program, "uSoftening");
+                g_ready = (g_passLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[LongRange] long_range.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+bool LongRange::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+    GLsizeiptr objects = static_cast<GLsizeiptr>(maxObjects);
+
+    // New space is zeroed, so equations read 0 until the first solve
+    EnsureBuffer(g_accelSSBO, objects * 2 * 4 * sizeof(float));
+    EnsureBuffer(g_nodesSSBO, std::max<GLsizeiptr>(2 * objects - 1, 1) * TREE_NODE_SIZE);
+    EnsureBuffer(g_sortSSBO[0], objects * 2 * sizeof(GLuint));
+    EnsureBuffer(g_sortSSBO[1], objects * 2 * sizeof(GLuint));
+    EnsureBuffer(g_radixHistogramSSBO, RADIX_DIGITS * NumBlocks(static_cast<GLuint>(maxObjects)) * sizeof(GLuint));
+    EnsureBuffer(g_sceneBoundsSSBO, 4 * sizeof(GLuint));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[LongRange] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Bounds -> Morton codes -> radix sort -> radix tree -> monopoles -> tree walk
+// ============================================================================
+bool LongRange::Compute(GLuint objectSSBO, int numObjects)
+{
+    if (!g_ready) return false;
+    if (numObjects <= 0 || numObjects > g_maxObjects) return false;
+
+    if (g_method == LONG_RANGE_PARTICLE_MESH &&
+        ParticleMesh::Compute(objectSSBO, g_accelSSBO, numObjects, g_gravityConstant, g_coulombConstant, g_softening))
+        return true;
+
+    GLuint objectCount = static_cast<GLuint>(numObjects);
+
+    glUseProgram(g_program);
+    if (g_numObjectsLoc != -1) glUniform1i(g_numObjectsLoc, numObjects);
+    if (g_numBlocksLoc != -1) glUniform1ui(g_numBlocksLoc, NumBlocks(objectCount));
+    if (g_thetaLoc != -1) glUniform1f(g_thetaLoc, g_theta);
+    if (g_gravityConstantLoc != -1) glUniform1f(g_gravityConstantLoc, g_gravityConstant);
+    if (g_coulombConstantLoc != -1) glUniform1f(g_coulombConstantLoc, g_coulombConstant);
+    if (g_softeningLoc != -1) glUniform1f(g_softeningLoc, g_softening);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_BVH_NODES_BINDING, g_nodesSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_RADIX_HISTOGRAM_BINDING, g_radixHistogramSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SCENE_BOUNDS_BINDING, g_sceneBoundsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_IN_BINDING, g_sortSSBO[0]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_OUT_BINDING, g_sortSSBO[1]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LONG_RANGE_ACCEL_BINDING, g_accelSSBO);
+
+    DispatchPass(TREE_PASS_CLEAR_BOUNDS, 1);
+    DispatchPass(TREE_PASS_BOUNDS, objectCount);
+    DispatchPass(TREE_PASS_MORTON, objectCount);
+
+    // LSD radix sort of 32-bit codes; an even pass count leaves the result in g_sortSSBO[0]
+    int src = 0;
+    for (int shift = 0; shift < 32; shift += RADIX_BITS_PER_PASS)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_IN_BINDING, g_sortSSBO[src]);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_OUT_BINDING, g_sortSSBO[1 - src]);
+        if (g_radixShiftLoc != -1) glUniform1ui(g_radixShiftLoc, static_cast<GLuint>(shift));
+
+        DispatchPass(TREE_PASS_RADIX_HISTOGRAM, objectCount);
+        DispatchPass(TREE_PASS_RADIX_SCAN, 1);
+        DispatchPass(TREE_PASS_RADIX_SCATTER, objectCount);
+        src = 1 - src;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_IN_BINDING, g_sortSSBO[src]);
+    DispatchPass(TREE_PASS_BUILD, objectCount);
+    DispatchPass(TREE_PASS_AGGREGATE, objectCount);
+    DispatchPass(TREE_PASS_FORCES, objectCount);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_BVH_NODES_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_IN_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_OUT_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_RADIX_HISTOGRAM_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SCENE_BOUNDS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LONG_RANGE_ACCEL_BINDING, 0);
+    glUseProgram(0);
+    return true;
+}
+
+void LongRange::Bind()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LONG_RANGE_ACCEL_BINDING, g_accelSSBO);
+}
+
+void LongRange::Unbind()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LONG_RANGE_ACCEL_BINDING, 0);
+}
+
+GLuint LongRange::GetFieldBuffer()
+{
+    return g_accelSSBO;
+}
+
+// ============================================================================
+// Solver parameters
+// ============================================================================
+void LongRange::SetParameters(float theta, float gravityConstant, float coulombConstant, float softening)
+{
+    g_theta = std::max(0.0f, theta);
+    g_gravityConstant = gravityConstant;
+    g_coulombConstant = coulombConstant;
+    g_softening = std::max(0.0f, softening);
+}
+
+float LongRange::GetTheta() { return g_theta; }
+float LongRange::GetGravityConstant() { return g_gravityConstant; }
+float LongRange::GetCoulombConstant() { return g_coulombConstant; }
+float LongRange::GetSoftening() { return g_softening; }
+void LongRange::SetMethod(LongRangeMethod method) { g_method = method; }
+LongRangeMethod LongRange::GetMethod() { return g_method; }
+
+// ============================================================================
+// Release buffers and the solver program
+// ============================================================================
+void LongRange::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+    ParticleMesh::Cleanup();
+
+    GLuint* buffers[] = { &g_accelSSBO, &g_nodesSSBO, &g_sortSSBO[0], &g_sortSSBO[1],
+                          &g_radixHistogramSSBO, &g_sceneBoundsSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_maxObjects = 0;
+
+    g_theta = 0.5f;
+    g_gravityConstant = 1.0f;
+    g_coulombConstant = 1.0f;
+    g_softening = 0.01f;
+    g_method = LONG_RANGE_BARNES_HUT;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void LongRange::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+    ParticleMesh::UpdateShaderLoadingStatus();
+}
+
+bool LongRange::IsReady()
+{
+    return g_ready;
+}
+
+std::string LongRange::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[long range] " + g_loader.GetStatusMessage();
+    return "Long-range solver shader ready";
+}
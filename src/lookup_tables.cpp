@@ -0,0 +1,255 @@
+#include "lookup_tables.h"
+#include "buffer_helpers.h"
+#include <algorithm>
+#include <cmath>
+
+static const int LOOKUP_SLOT_COUNT = LookupTables::MAX_LOOKUP_TABLES + LookupTables::MAX_LOOKUP_FIELDS;
+
+// One table or field; fields follow the tables in the header buffer
+struct LookupSlot
+{
+    std::vector<float> values;  // width * height, empty = unset
+    int width = 0;
+    int height = 0;
+    int mode = LookupTables::LOOKUP_LINEAR;
+    glm::vec2 min = glm::vec2(0.0f);
+    glm::vec2 scale = glm::vec2(0.0f);  // Samples per unit, (size - 1) / extent
+    int offset = 0;                     // First value in the data buffer
+    bool dirty = false;                 // Values to upload in place
+};
+
+static LookupSlot g_slots[LOOKUP_SLOT_COUNT];
+static bool g_layoutDirty = false;  // Sizes changed: repack and upload everything
+
+// Buffers and their buffer textures
+static GLuint g_dataBuffer = 0;
+static GLuint g_dataTexture = 0;
+static GLuint g_headersBuffer = 0;
+static GLuint g_headersTexture = 0;
+
+static void AttachTexture(GLuint& texture, GLenum format, GLuint buffer)
+{
+    if (texture == 0) glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+static void StoreSlot(int slot, const std::vector<float>& values, int width, int height, int mode,
+                      const glm::vec2& min, const glm::vec2& max)
+{
+    LookupSlot& s = g_slots[slot];
+    if (s.width != width || s.height != height) g_layoutDirty = true;
+    else s.dirty = true;
+    s.values = values;
+    s.width = width;
+    s.height = height;
+    s.mode = mode;
+    s.min = min;
+    s.scale = glm::vec2(width > 1 ? static_cast<float>(width - 1) / (max.x - min.x) : 0.0f,
+                        height > 1 ? static_cast<float>(height - 1) / (max.y - min.y) : 0.0f);
+}
+
+static void ClearSlot(int slot)
+{
+    if (g_slots[slot].values.empty()) return;
+    g_slots[slot] = LookupSlot();
+    g_layoutDirty = true;
+}
+
+// ============================================================================
+// Host edits
+// ============================================================================
+bool LookupTables::SetTable(int id, const std::vector<float>& values, float xMin, float xMax, Interpolation mode)
+{
+    if (id < 0 || id >= MAX_LOOKUP_TABLES || values.empty()) return false;
+    if (values.size() > 1 && !(xMax > xMin)) return false;
+    StoreSlot(id, values, static_cast<int>(values.size()), 1, mode, glm::vec2(xMin, 0.0f), glm::vec2(xMax, 0.0f));
+    return true;
+}
+
+bool LookupTables::SetField(int id, const std::vector<float>& values, int width, int height,
+                            const glm::vec2& min, const glm::vec2& max)
+{
+    if (id < 0 || id >= MAX_LOOKUP_FIELDS || width < 1 || height < 1) return false;
+    if (values.size() != static_cast<size_t>(width) * height) return false;
+    if ((width > 1 && !(max.x > min.x)) || (height > 1 && !(max.y > min.y))) return false;
+    StoreSlot(MAX_LOOKUP_TABLES + id, values, width, height, LOOKUP_LINEAR, min, max);
+    return true;
+}
+
+void LookupTables::ClearTable(int id)
+{
+    if (id >= 0 && id < MAX_LOOKUP_TABLES) ClearSlot(id);
+}
+
+void LookupTables::ClearField(int id)
+{
+    if (id >= 0 && id < MAX_LOOKUP_FIELDS) ClearSlot(MAX_LOOKUP_TABLES + id);
+}
+
+// ============================================================================
+// Host lookups (copy of math.comp)
+// ============================================================================
+static float SlotValue(const LookupSlot& s, int column, int row)
+{
+    column = std::min(std::max(column, 0), s.width - 1);
+    row = std::min(std::max(row, 0), s.height - 1);
+    return s.values[static_cast<size_t>(row) * s.width + column];
+}
+
+static int LookupSlotIndex(float id, int first, int count)
+{
+    float slot = std::floor(id + 0.5f);
+    if (!(slot >= 0.0f && slot < static_cast<float>(count))) return -1;
+    return first + static_cast<int>(slot);
+}
+
+float LookupTables::SampleTable(float id, float x)
+{
+    int slot = LookupSlotIndex(id, 0, MAX_LOOKUP_TABLES);
+    if (slot < 0 || g_slots[slot].values.empty()) return 0.0f;
+    const LookupSlot& s = g_slots[slot];
+
+    float u = std::min(std::max((x - s.min.x) * s.scale.x, 0.0f), static_cast<float>(s.width - 1));
+    if (std::isnan(u)) u = 0.0f;
+    int i = static_cast<int>(std::floor(u));
+    float f = u - static_cast<float>(i);
+    float p1 = SlotValue(s, i, 0), p2 = SlotValue(s, i + 1, 0);
+    if (s.mode != LOOKUP_CUBIC) return p1 + (p2 - p1) * f;
+
+    float p0 = SlotValue(s, i - 1, 0), p3 = SlotValue(s, i + 2, 0);
+    return 0.5f * (2.0f * p1 + (p2 - p0) * f + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * f * f +
+                   (3.0f * (p1 - p2) + p3 - p0) * f * f * f);
+}
+
+float LookupTables::SampleField(float id, float x, float y)
+{
+    int slot = LookupSlotIndex(id, MAX_LOOKUP_TABLES, MAX_LOOKUP_FIELDS);
+    if (slot < 0 || g_slots[slot].values.empty()) return 0.0f;
+    const LookupSlot& s = g_slots[slot];
+
+    float u = std::min(std::max((x - s.min.x) * s.scale.x, 0.0f), static_cast<float>(s.width - 1));
+    float v = std::min(std::max((y - s.min.y) * s.scale.y, 0.0f), static_cast<float>(s.height - 1));
+    if (std::isnan(u)) u = 0.0f;
+    if (std::isnan(v)) v = 0.0f;
+    int i = static_cast<int>(std::floor(u)), j = static_cast<int>(std::floor(v));
+    float fu = u - static_cast<float>(i), fv = v - static_cast<float>(j);
+    float bottom = SlotValue(s, i, j) + (SlotValue(s, i + 1, j) - SlotValue(s, i, j)) * fu;
+    float top = SlotValue(s, i, j + 1) + (SlotValue(s, i + 1, j + 1) - SlotValue(s, i, j + 1)) * fu;
+    return bottom + (top - bottom) * fv;
+}
+
+// ============================================================================
+// Upload pending edits and bind the textures
+// ============================================================================
+static void UploadHeaders()
+{
+    std::vector<glm::vec4> headers(static_cast<size_t>(LOOKUP_SLOT_COUNT) * 2, glm::vec4(0.0f));
+    for (int slot = 0; slot < LOOKUP_SLOT_COUNT; slot++)
+    {
+        const LookupSlot& s = g_slots[slot];
+        if (s.values.empty()) continue;
+        headers[2 * slot] = glm::vec4(static_cast<float>(s.offset), static_cast<float>(s.width),
+                                      static_cast<float>(s.height), static_cast<float>(s.mode));
+        headers[2 * slot + 1] = glm::vec4(s.min, s.scale);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, g_headersBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, headers.size() * sizeof(glm::vec4), headers.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+static void Upload()
+{
+    if (g_headersBuffer == 0)
+    {
+        BufferHelpers::EnsureBufferCapacity(g_headersBuffer, LOOKUP_SLOT_COUNT * 2 * sizeof(glm::vec4), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        AttachTexture(g_headersTexture, GL_RGBA32F, g_headersBuffer);
+        BufferHelpers::EnsureBufferCapacity(g_dataBuffer, sizeof(float), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        AttachTexture(g_dataTexture, GL_R32F, g_dataBuffer);
+        g_layoutDirty = true;  // Fresh headers read as unset slots
+    }
+
+    if (g_layoutDirty)
+    {
+        std::vector<float> data;
+        for (LookupSlot& s : g_slots)
+        {
+            s.offset = static_cast<int>(data.size());
+            s.dirty = false;
+            data.insert(data.end(), s.values.begin(), s.values.end());
+        }
+        if (data.empty()) data.push_back(0.0f);
+        glBindBuffer(GL_TEXTURE_BUFFER, g_dataBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, data.size() * sizeof(float), data.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        AttachTexture(g_dataTexture, GL_R32F, g_dataBuffer);  // Reallocated storage
+        UploadHeaders();
+        g_layoutDirty = false;
+    }
+    else
+    {
+        bool headersDirty = false;
+        glBindBuffer(GL_TEXTURE_BUFFER, g_dataBuffer);
+        for (LookupSlot& s : g_slots)
+        {
+            if (!s.dirty) continue;
+            glBufferSubData(GL_TEXTURE_BUFFER, static_cast<GLintptr>(s.offset) * sizeof(float),
+                            s.values.size() * sizeof(float), s.values.data());
+            s.dirty = false;
+            headersDirty = true;  // The range or interpolation may have changed too
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        if (headersDirty) UploadHeaders();
+    }
+}
+
+bool LookupTables::CopyField(int id, GLuint buffer, int width, int height)
+{
+    if (id < 0 || id >= MAX_LOOKUP_FIELDS) return false;
+    LookupSlot& s = g_slots[MAX_LOOKUP_TABLES + id];
+    if (s.values.empty() || s.width != width || s.height != height) return false;
+
+    Upload();  // The slot's offset is final once the buffer is packed
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, g_dataBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, static_cast<GLintptr>(s.offset) * sizeof(float),
+                        static_cast<GLsizeiptr>(width) * height * sizeof(float));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return true;
+}
+
+void LookupTables::Bind()
+{
+    Upload();
+
+    glActiveTexture(GL_TEXTURE0 + LOOKUP_HEADERS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_headersTexture);
+    glActiveTexture(GL_TEXTURE0 + LOOKUP_DATA_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_dataTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// ============================================================================
+// Release the buffers and textures
+// ============================================================================
+void LookupTables::Cleanup()
+{
+    GLuint* textures[] = { &g_dataTexture, &g_headersTexture };
+    for (GLuint* texture : textures)
+    {
+        if (*texture) glDeleteTextures(1, texture);
+        *texture = 0;
+    }
+    GLuint* buffers[] = { &g_dataBuffer, &g_headersBuffer };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    for (LookupSlot& s : g_slots) s = LookupSlot();
+    g_layoutDirty = false;
+}
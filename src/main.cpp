@@ -10,6 +10,7 @@
 #include <numeric>
 #include <algorithm>
 #include <sstream>
+#include <cstdlib>
 
 #include "imgui.h"
 #include "imgui_stdlib.h"
@@ -24,6 +25,7 @@
 #include "framebuffer.h"
 #include "parser.h"
 #include "debug_helpers.h"
+#include "gl_debug.h"
 #include "async_shader_loader.h"
 #include "globals.h"
 #include "camera.h"
@@ -31,6 +33,9 @@
 #include "input_handler.h"
 #include "ui_manager.h"
 #include "renderer.h"
+#include "simulation_thread.h"
+#include "gpu_profiler.h"
+#include "frame_trace.h"
 #include "imgui_styles.h"
 
 int main()
@@ -41,6 +46,7 @@ int main()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLDebug::WantsDebugContext() ? GLFW_TRUE : GLFW_FALSE);
 
     GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Classical Physics Simulator", nullptr, nullptr);
     if (!window)
@@ -102,6 +108,11 @@ int main()
         return -1;
     }
 
+    // STELLAR_TRACE=<file.json> captures the whole run in a tracing build and writes it on exit
+    const char* tracePath = std::getenv("STELLAR_TRACE");
+    if (tracePath && !FrameTrace::Start())
+        std::cerr << "[Trace] STELLAR_TRACE ignored: built without STELLAR_TRACING" << std::endl;
+
     double lastFrameTime = glfwGetTime();
     int frameCounter = 0;
 
@@ -119,12 +130,25 @@ int main()
 
     while (!glfwWindowShouldClose(window))
     {
+        FRAME_TRACE_ZONE("frame");
+        if (g_physics.threadedSimulation != SimulationThread::IsRunning())
+        {
+            if (g_physics.threadedSimulation)
+                g_physics.threadedSimulation = SimulationThread::Start(window);
+            else
+                SimulationThread::Stop();
+        }
+        SimulationThread::BeginFrame();
+
         // FIX 1: Clear the main OpenGL framebuffer FIRST
         glClearColor(0.1f, 0.1f, 0.12f, 1.0f);  // Dark background
         glClear(GL_COLOR_BUFFER_BIT);
 
         // In your main render loop, add:
-        Objects::UpdateShaderLoadingStatus();
+        {
+            FRAME_TRACE_ZONE("shader_loading");
+            Objects::UpdateShaderLoadingStatus();
+        }
 
         if (!Objects::IsComputeShaderReady())
         {
@@ -148,7 +172,8 @@ int main()
         float deltaTime = static_cast<float>(currentFrameTime - lastFrameTime);
         lastFrameTime = currentFrameTime;
 
-        if (!Renderer::IsSimulationPaused())
+        bool steppedHere = !SimulationThread::IsRunning();
+        if (steppedHere && !Renderer::IsSimulationPaused())
         {
             g_physics.globalTime += deltaTime;
         }
@@ -179,37 +204,54 @@ int main()
         }
 
         // Update physics
-        Renderer::UpdatePhysics(deltaTime, fakeDeltaTime);
+        if (steppedHere)
+        {
+            FRAME_TRACE_ZONE("physics");
+            Renderer::UpdatePhysics(deltaTime, fakeDeltaTime);
+        }
 
         // FIX 2: Render graphics BEFORE ImGui
-        Renderer::RenderFrame();
+        {
+            FRAME_TRACE_ZONE("render");
+            Renderer::RenderFrame();
+        }
 
         // Then render UI on top
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
+        {
+            FRAME_TRACE_ZONE("ui");
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
 
-        UIManager::RenderFileDialogs();
+            UIManager::RenderFileDialogs();
 
-        UIManager::RenderMainUI();
-        UIManager::RenderControlPanel();
-        UIManager::RenderSimulationView();
+            UIManager::RenderMainUI();
+            UIManager::RenderControlPanel();
+            UIManager::RenderSimulationView();
 
-        if (g_physics.showPhaseSpace)
-        {
-            UIManager::RenderPhaseSpaceView();
-        }
+            if (g_physics.showPhaseSpace)
+            {
+                UIManager::RenderPhaseSpaceView();
+            }
 
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            ImGui::Render();
+            GpuProfiler::Begin("imgui");
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            GpuProfiler::End("imgui");
+        }
 
-        if (!Renderer::IsSimulationPaused())
+        if (steppedHere && !Renderer::IsSimulationPaused())
         {
             Renderer::SwapBuffers();
         }
 
-        glfwSwapBuffers(window);
+        SimulationThread::EndFrame();
+        {
+            FRAME_TRACE_ZONE("swap");
+            glfwSwapBuffers(window);
+        }
         glfwPollEvents();
+        FRAME_TRACE_FRAME();
         frameCounter++;
 
         static int debugFrame = 0;
@@ -219,6 +261,7 @@ int main()
         }
         debugFrame++;
     }
+    SimulationThread::Stop();
     Renderer::Shutdown();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -227,6 +270,16 @@ int main()
     Objects::Cleanup();
     VectorField::Cleanup();
     Axis::Cleanup();
+    GpuProfiler::Cleanup();
+
+    if (FrameTrace::IsActive())
+    {
+        FrameTrace::Stop();
+        if (FrameTrace::WriteChromeTrace(tracePath))
+            std::cout << "[Trace] Written to " << tracePath << std::endl;
+        else
+            std::cerr << "[Trace] Could not write " << tracePath << std::endl;
+    }
 
     glfwTerminate();
     return 0;
@@ -0,0 +1,166 @@
+#include "metropolis.h"
+#include <algorithm>
+
+static const int MIN_CHAIN_CAPACITY = 1024;
+
+// One word per chain, then the histogram bins
+static GLuint g_statsBuffer = 0;
+static GLuint g_statsTexture = 0;  // GL_R32UI buffer texture over g_statsBuffer, bound as an image
+static int g_chainCapacity = 0;
+static int g_histogramWords = 0;
+
+static bool g_enabled = false;
+static bool g_clearPending = false;  // Stats are dropped before the next step
+static float g_stepSize = 0.1f;
+static glm::vec2 g_histogramMin(-1.0f);
+static glm::vec2 g_histogramMax(1.0f);
+static int g_binsX = 0;
+static int g_binsY = 0;
+static uint64_t g_proposals = 0;
+
+static void ReleaseBuffers()
+{
+    if (g_statsTexture) glDeleteTextures(1, &g_statsTexture);
+    if (g_statsBuffer) glDeleteBuffers(1, &g_statsBuffer);
+    g_statsTexture = 0;
+    g_statsBuffer = 0;
+    g_chainCapacity = 0;
+    g_histogramWords = 0;
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+void Metropolis::SetEnabled(bool enabled)
+{
+    if (enabled && !g_enabled) g_clearPending = true;
+    g_enabled = enabled;
+}
+
+bool Metropolis::IsEnabled()
+{
+    return g_enabled;
+}
+
+void Metropolis::SetStepSize(float stepSize)
+{
+    g_stepSize = std::max(stepSize, 0.0f);
+}
+
+float Metropolis::GetStepSize()
+{
+    return g_stepSize;
+}
+
+void Metropolis::SetHistogram(const glm::vec2& min, const glm::vec2& max, int binsX, int binsY)
+{
+    bool valid = binsX > 0 && binsY > 0 && max.x > min.x && max.y > min.y &&
+                 static_cast<int64_t>(binsX) * binsY <= METROPOLIS_MAX_HISTOGRAM_BINS;
+    g_histogramMin = min;
+    g_histogramMax = max;
+    g_binsX = valid ? binsX : 0;
+    g_binsY = valid ? binsY : 0;
+    g_clearPending = true;
+}
+
+void Metropolis::GetHistogram(glm::vec2& min, glm::vec2& max, int& binsX, int& binsY)
+{
+    min = g_histogramMin;
+    max = g_histogramMax;
+    binsX = g_binsX;
+    binsY = g_binsY;
+}
+
+void Metropolis::ClearStats()
+{
+    g_clearPending = true;
+}
+
+// ============================================================================
+// Per step
+// ============================================================================
+void Metropolis::Bind(int numChains)
+{
+    if (!g_enabled) return;
+    int histogramWords = g_binsX * g_binsY;
+    if (g_statsBuffer == 0 || numChains > g_chainCapacity || histogramWords != g_histogramWords)
+    {
+        int capacity = std::max(g_chainCapacity, MIN_CHAIN_CAPACITY);
+        while (capacity < numChains) capacity *= 2;
+        ReleaseBuffers();
+        glGenBuffers(1, &g_statsBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, g_statsBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(capacity + histogramWords) * sizeof(GLuint),
+                     nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glGenTextures(1, &g_statsTexture);
+        glBindTexture(GL_TEXTURE_BUFFER, g_statsTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, g_statsBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        g_chainCapacity = capacity;
+        g_histogramWords = histogramWords;
+        g_clearPending = true;
+    }
+    if (g_clearPending)
+    {
+        GLuint zero = 0;
+        glBindBuffer(GL_TEXTURE_BUFFER, g_statsBuffer);
+        glClearBufferData(GL_TEXTURE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        g_proposals = 0;
+        g_clearPending = false;
+    }
+    glBindImageTexture(METROPOLIS_STATS_IMAGE_UNIT, g_statsTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+}
+
+void Metropolis::Unbind()
+{
+    if (!g_enabled) return;
+    glBindImageTexture(METROPOLIS_STATS_IMAGE_UNIT, 0, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+}
+
+glm::ivec3 Metropolis::ShaderHistogram()
+{
+    return glm::ivec3(g_binsX, g_binsY, g_chainCapacity);
+}
+
+glm::vec4 Metropolis::ShaderHistogramBox()
+{
+    glm::vec2 size = g_histogramMax - g_histogramMin;
+    return glm::vec4(g_histogramMin, static_cast<float>(g_binsX) / size.x, static_cast<float>(g_binsY) / size.y);
+}
+
+void Metropolis::EndStep(int substeps)
+{
+    if (g_enabled) g_proposals += static_cast<uint64_t>(std::max(substeps, 0));
+}
+
+void Metropolis::Read(int numChains, Stats& stats)
+{
+    stats = Stats();
+    stats.proposals = g_clearPending ? 0 : g_proposals;
+    int chains = std::max(numChains, 0);
+    stats.accepted.assign(chains, 0u);
+    stats.histogram.assign(static_cast<size_t>(g_binsX) * g_binsY, 0u);
+    if (g_statsBuffer == 0 || g_clearPending) return;
+
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, g_statsBuffer);
+    int stored = std::min(chains, g_chainCapacity);
+    if (stored > 0) glGetBufferSubData(GL_COPY_READ_BUFFER, 0, stored * sizeof(GLuint), stats.accepted.data());
+    if (!stats.histogram.empty() && g_histogramWords == static_cast<int>(stats.histogram.size()))
+    {
+        glGetBufferSubData(GL_COPY_READ_BUFFER, static_cast<GLintptr>(g_chainCapacity) * sizeof(GLuint),
+                           stats.histogram.size() * sizeof(GLuint), stats.histogram.data());
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+// ============================================================================
+// Release the buffers
+// ============================================================================
+void Metropolis::Cleanup()
+{
+    ReleaseBuffers();
+    g_proposals = 0;
+}
@@ -0,0 +1,184 @@
+#include "nan_scan.h"
+#include "objects.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+
+static const GLuint NAN_SCAN_WORK_GROUP_SIZE = 256;
+
+// Buffers
+static GLuint g_resultSSBO = 0;      // Count, then NAN_SCAN_MAX_REPORTED indices
+static GLuint g_checkpointSSBO = 0;  // Last state that passed a scan
+static int g_checkpointObjects = -1; // Objects in the checkpoint, -1 = none
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_numObjectsLoc = -1;
+static GLint g_maxReportedLoc = -1;
+
+// ============================================================================
+// Allocate the result buffer and start loading the shader
+// ============================================================================
+bool NanScan::Init()
+{
+    if (g_resultSSBO == 0)
+    {
+        glGenBuffers(1, &g_resultSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_resultSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (1 + NAN_SCAN_MAX_REPORTED) * sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[NanScan] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "nan_scan.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_maxReportedLoc = glGetUniformLocation(program, "uMaxReported");
+                g_ready = (g_numObjectsLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[NanScan] nan_scan.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+// ============================================================================
+// Count and list the invalid objects
+// ============================================================================
+bool NanScan::Scan(GLuint objectSSBO, int numObjects, int& invalidCount, std::vector<int>& invalidIndices)
+{
+    invalidCount = 0;
+    invalidIndices.clear();
+    if (!g_ready || g_resultSSBO == 0) return false;
+    if (numObjects <= 0) return true;
+
+    GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_resultSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glUseProgram(g_program);
+    glUniform1i(g_numObjectsLoc, numObjects);
+    if (g_maxReportedLoc != -1) glUniform1i(g_maxReportedLoc, NAN_SCAN_MAX_REPORTED);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NAN_SCAN_RESULT_BINDING, g_resultSSBO);
+
+    GLuint groups = (static_cast<GLuint>(numObjects) + NAN_SCAN_WORK_GROUP_SIZE - 1) / NAN_SCAN_WORK_GROUP_SIZE;
+    glDispatchCompute(groups, 1, 1);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NAN_SCAN_RESULT_BINDING, 0);
+    glUseProgram(0);
+
+    // Read the count first; the index list is only fetched when there is something in it
+    GLuint count = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_resultSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &count);
+    if (count > 0)
+    {
+        GLuint reported = std::min(count, static_cast<GLuint>(NAN_SCAN_MAX_REPORTED));
+        std::vector<GLuint> indices(reported);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), reported * sizeof(GLuint), indices.data());
+        invalidIndices.assign(indices.begin(), indices.end());
+        std::sort(invalidIndices.begin(), invalidIndices.end());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    invalidCount = static_cast<int>(count);
+    return true;
+}
+
+// ============================================================================
+// Roll-back copy
+// ============================================================================
+void NanScan::SaveCheckpoint(GLuint objectSSBO, int numObjects)
+{
+    if (numObjects <= 0)
+    {
+        g_checkpointObjects = -1;
+        return;
+    }
+
+    GLsizeiptr size = static_cast<GLsizeiptr>(numObjects) * sizeof(Object);
+    BufferHelpers::EnsureBufferCapacity(g_checkpointSSBO, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, objectSSBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, g_checkpointSSBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    g_checkpointObjects = numObjects;
+}
+
+bool NanScan::RestoreCheckpoint(GLuint objectSSBO, int numObjects)
+{
+    if (g_checkpointObjects != numObjects || numObjects <= 0) return false;
+
+    GLsizeiptr size = static_cast<GLsizeiptr>(numObjects) * sizeof(Object);
+    glBindBuffer(GL_COPY_READ_BUFFER, g_checkpointSSBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, objectSSBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return true;
+}
+
+void NanScan::DropCheckpoint()
+{
+    g_checkpointObjects = -1;
+}
+
+// ============================================================================
+// Release buffers and the program
+// ============================================================================
+void NanScan::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    GLuint* buffers[] = { &g_resultSSBO, &g_checkpointSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_checkpointObjects = -1;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void NanScan::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool NanScan::IsReady()
+{
+    return g_ready;
+}
+
+std::string NanScan::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[nan scan] " + g_loader.GetStatusMessage();
+    return "NaN scan shader ready";
+}
@@ -0,0 +1,288 @@
+#include "object_aggregates.h"
+#include "object_reduction.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+
+// Group bits, buffer texture and the host copy
+static GLuint g_groupsBuffer = 0;
+static GLuint g_groupsTexture = 0;
+static std::vector<uint32_t> g_groupBits;
+static std::vector<std::string> g_groupNames;  // Bit k is group g_groupNames[k]
+static int g_maxObjects = 0;
+
+// Rows edited since the last upload, [g_dirtyBegin, g_dirtyEnd)
+static int g_dirtyBegin = 0;
+static int g_dirtyEnd = 0;
+
+// Aggregates by agg[] slot, and the values of the last step
+struct Aggregate
+{
+    bool active = false;
+    std::string group;       // "" = every object
+    std::string expression;  // Program key
+    std::string function;    // float aggregate<slot>(...)
+    int op = REDUCE_SUM;
+};
+static Aggregate g_aggregates[MAX_GROUP_AGGREGATES];
+static int g_count = 0;
+static GLuint g_valuesUBO = 0;  // MAX_GROUP_AGGREGATES floats = vec4 groupAggregates[4]
+
+static void MarkDirty(int index)
+{
+    if (g_dirtyBegin >= g_dirtyEnd)
+    {
+        g_dirtyBegin = index;
+        g_dirtyEnd = index + 1;
+        return;
+    }
+    g_dirtyBegin = std::min(g_dirtyBegin, index);
+    g_dirtyEnd = std::max(g_dirtyEnd, index + 1);
+}
+
+static int GroupBit(const std::string& name)
+{
+    for (size_t k = 0; k < g_groupNames.size(); k++)
+        if (g_groupNames[k] == name) return static_cast<int>(k);
+    return -1;
+}
+
+// ============================================================================
+// Initialize the group buffer, its buffer texture and the values block
+// ============================================================================
+bool ObjectAggregates::Init(int maxObjects)
+{
+    if (g_valuesUBO == 0)
+    {
+        const float zeros[MAX_GROUP_AGGREGATES] = {};
+        glGenBuffers(1, &g_valuesUBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, g_valuesUBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(zeros), zeros, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    return Reserve(maxObjects);
+}
+
+bool ObjectAggregates::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+    g_groupBits.resize(static_cast<size_t>(maxObjects), 0u);
+
+    BufferHelpers::EnsureBufferCapacity(g_groupsBuffer, static_cast<GLsizeiptr>(maxObjects) * sizeof(uint32_t),
+                                        GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    MarkDirty(0);
+    MarkDirty(maxObjects - 1);
+
+    // A grown buffer is a new buffer object, so the texture is re-attached
+    if (g_groupsTexture == 0) glGenTextures(1, &g_groupsTexture);
+    glActiveTexture(GL_TEXTURE0 + OBJECT_GROUPS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_groupsTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, g_groupsBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectAggregates] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Groups
+// ============================================================================
+bool ObjectAggregates::SetGroup(const std::string& name, const std::vector<int>& members)
+{
+    if (name.empty()) return false;
+    int bit = GroupBit(name);
+    if (bit < 0)
+    {
+        if (static_cast<int>(g_groupNames.size()) >= MAX_OBJECT_GROUPS) return false;
+        bit = static_cast<int>(g_groupNames.size());
+        g_groupNames.push_back(name);
+    }
+
+    uint32_t mask = 1u << bit;
+    for (int i = 0; i < g_maxObjects; i++)
+    {
+        if (!(g_groupBits[i] & mask)) continue;
+        g_groupBits[i] &= ~mask;
+        MarkDirty(i);
+    }
+    for (int index : members)
+    {
+        if (index < 0 || index >= g_maxObjects) continue;
+        g_groupBits[index] |= mask;
+        MarkDirty(index);
+    }
+    return true;
+}
+
+bool ObjectAggregates::HasGroup(const std::string& name)
+{
+    return GroupBit(name) >= 0;
+}
+
+std::vector<int> ObjectAggregates::GetGroup(const std::string& name, int numObjects)
+{
+    std::vector<int> members;
+    int bit = GroupBit(name);
+    if (bit < 0) return members;
+    int count = std::min(numObjects, g_maxObjects);
+    for (int i = 0; i < count; i++)
+        if (g_groupBits[i] & (1u << bit)) members.push_back(i);
+    return members;
+}
+
+void ObjectAggregates::Clear(int index)
+{
+    if (index < 0 || index >= g_maxObjects || g_groupBits[index] == 0u) return;
+    g_groupBits[index] = 0u;
+    MarkDirty(index);
+}
+
+void ObjectAggregates::Move(int to, int from)
+{
+    if (to == from || to < 0 || from < 0 || to >= g_maxObjects || from >= g_maxObjects) return;
+    if (g_groupBits[to] != g_groupBits[from])
+    {
+        g_groupBits[to] = g_groupBits[from];
+        MarkDirty(to);
+    }
+    Clear(from);
+}
+
+void ObjectAggregates::Permute(const std::vector<int>& order)
+{
+    int count = std::min(static_cast<int>(order.size()), g_maxObjects);
+    if (count == 0 || g_groupNames.empty()) return;
+    std::vector<uint32_t> bits(g_groupBits.begin(), g_groupBits.begin() + count);
+    for (int i = 0; i < count; i++) g_groupBits[i] = bits[order[i]];
+    MarkDirty(0);
+    MarkDirty(count - 1);
+}
+
+// ============================================================================
+// Aggregates
+// ============================================================================
+bool ObjectAggregates::Set(int slot, const std::string& group, const std::string& expression,
+                           const std::string& expressionFunction, int op)
+{
+    if (slot < 0 || slot >= MAX_GROUP_AGGREGATES) return false;
+    if (!group.empty() && GroupBit(group) < 0) return false;
+    Aggregate& aggregate = g_aggregates[slot];
+    if (!aggregate.active) g_count++;
+    aggregate.active = true;
+    aggregate.group = group;
+    aggregate.expression = expression;
+    aggregate.function = expressionFunction;
+    aggregate.op = op;
+    return true;
+}
+
+void ObjectAggregates::Remove(int slot)
+{
+    if (slot < 0 || slot >= MAX_GROUP_AGGREGATES || !g_aggregates[slot].active) return;
+    g_aggregates[slot] = Aggregate();
+    g_count--;
+
+    // A removed aggregate reads 0, as one never set does
+    const float zero = 0.0f;
+    glBindBuffer(GL_UNIFORM_BUFFER, g_valuesUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, slot * sizeof(float), sizeof(float), &zero);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+int ObjectAggregates::GetCount()
+{
+    return g_count;
+}
+
+float ObjectAggregates::Get(int slot)
+{
+    if (slot < 0 || slot >= MAX_GROUP_AGGREGATES || g_valuesUBO == 0) return 0.0f;
+    float value = 0.0f;
+    glBindBuffer(GL_UNIFORM_BUFFER, g_valuesUBO);
+    glGetBufferSubData(GL_UNIFORM_BUFFER, slot * sizeof(float), sizeof(float), &value);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    return value;
+}
+
+// ============================================================================
+// One reduction of every aggregate, from the state at the start of the step
+// ============================================================================
+void ObjectAggregates::Compute(GLuint objectSSBO, int numObjects)
+{
+    if (g_count == 0) return;
+
+    // Every aggregate's function, a dispatcher over them and the stub evaluateObject() calls
+    std::string functions = "#define AGGREGATE_COUNT " + std::to_string(g_count) + "\n";
+    std::string dispatch = "float aggregateExpression(int k, int i) {\n    Object obj = objects[i];\n";
+    std::string key = "aggregates:";
+    int ops[MAX_GROUP_AGGREGATES];
+    uint32_t groups[MAX_GROUP_AGGREGATES];
+    int slots[MAX_GROUP_AGGREGATES];
+    int count = 0;
+    for (int slot = 0; slot < MAX_GROUP_AGGREGATES; slot++)
+    {
+        const Aggregate& aggregate = g_aggregates[slot];
+        if (!aggregate.active) continue;
+        functions += aggregate.function;
+        dispatch += "    if (k == " + std::to_string(count) + ") return aggregate" + std::to_string(slot) +
+                    "(EXPRESSION_ARGS(obj, i));\n";
+        key += std::to_string(slot) + ":" + aggregate.expression + "\n";
+        int bit = GroupBit(aggregate.group);
+        ops[count] = aggregate.op;
+        groups[count] = bit < 0 ? 0u : 1u << bit;
+        slots[count] = slot;
+        count++;
+    }
+    functions += "float reduceExpression(float x, float y, float vx, float vy, float ax_prev, float ay_prev,\n"
+                 "                       float rotation, float angular_vel, vec4 color, float mass, float charge,\n"
+                 "                       int objectIndex) {\n    return 0.0;\n}\n";
+    functions += dispatch + "    return 0.0;\n}\n";
+
+    // Group bits edited since the last step
+    if (g_dirtyBegin < g_dirtyEnd)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, g_groupsBuffer);
+        glBufferSubData(GL_TEXTURE_BUFFER, static_cast<GLintptr>(g_dirtyBegin) * sizeof(uint32_t),
+                        static_cast<GLsizeiptr>(g_dirtyEnd - g_dirtyBegin) * sizeof(uint32_t), &g_groupBits[g_dirtyBegin]);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        g_dirtyBegin = g_dirtyEnd = 0;
+    }
+    glActiveTexture(GL_TEXTURE0 + OBJECT_GROUPS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_groupsTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    std::string error;
+    if (!ObjectReduction::ReduceAggregates(key, functions, count, ops, groups, slots, objectSSBO, numObjects,
+                                           g_valuesUBO, error))
+        std::cerr << "[ObjectAggregates] " << error << std::endl;
+}
+
+void ObjectAggregates::Bind()
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, GROUP_AGGREGATES_BINDING, g_valuesUBO);
+}
+
+// ============================================================================
+// Release buffers
+// ============================================================================
+void ObjectAggregates::Cleanup()
+{
+    if (g_groupsTexture) glDeleteTextures(1, &g_groupsTexture);
+    if (g_groupsBuffer) glDeleteBuffers(1, &g_groupsBuffer);
+    if (g_valuesUBO) glDeleteBuffers(1, &g_valuesUBO);
+    g_groupsTexture = g_groupsBuffer = g_valuesUBO = 0;
+    g_groupBits.clear();
+    g_groupNames.clear();
+    for (Aggregate& aggregate : g_aggregates) aggregate = Aggregate();
+    g_count = 0;
+    g_maxObjects = 0;
+    g_dirtyBegin = g_dirtyEnd = 0;
+}
@@ -0,0 +1,94 @@
+#include "object_bounds.h"
+#include "buffer_helpers.h"
+#include <iostream>
+
+static const GLsizeiptr ROW_SIZE = 4 * sizeof(float);
+
+// Buffer and the rgba32f buffer texture over it
+static GLuint g_boundsBuffer = 0;
+static GLuint g_boundsTexture = 0;
+static int g_maxObjects = 0;
+static unsigned long long g_revision = 0;  // Scene revision the bounds describe, 0 = none
+
+// ============================================================================
+// Initialize the buffer and its buffer texture
+// ============================================================================
+bool ObjectBounds::Init(int maxObjects)
+{
+    return Reserve(maxObjects);
+}
+
+bool ObjectBounds::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+    g_revision = 0;  // Rows past the old capacity were never stored
+
+    bool grown = BufferHelpers::EnsureBufferCapacity(g_boundsBuffer, static_cast<GLsizeiptr>(maxObjects) * ROW_SIZE);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // A grown buffer is a new buffer object, so the texture is re-attached
+    if (g_boundsTexture == 0) glGenTextures(1, &g_boundsTexture);
+    if (grown)
+    {
+        glBindTexture(GL_TEXTURE_BUFFER, g_boundsTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, g_boundsBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectBounds] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Binding
+// ============================================================================
+void ObjectBounds::BindForWrite()
+{
+    if (g_boundsTexture == 0) return;
+    glBindImageTexture(OBJECT_BOUNDS_IMAGE_UNIT, g_boundsTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+}
+
+void ObjectBounds::UnbindForWrite()
+{
+    glBindImageTexture(OBJECT_BOUNDS_IMAGE_UNIT, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);  // The readers sample what the stores left
+}
+
+void ObjectBounds::Bind()
+{
+    glActiveTexture(GL_TEXTURE0 + OBJECT_BOUNDS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_boundsTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// ============================================================================
+// Validity
+// ============================================================================
+void ObjectBounds::MarkCurrent(unsigned long long revision)
+{
+    g_revision = revision;
+}
+
+bool ObjectBounds::IsCurrent(unsigned long long revision)
+{
+    return g_boundsTexture != 0 && g_revision != 0 && g_revision == revision;
+}
+
+// ============================================================================
+// Release the buffer and texture
+// ============================================================================
+void ObjectBounds::Cleanup()
+{
+    if (g_boundsTexture) glDeleteTextures(1, &g_boundsTexture);
+    if (g_boundsBuffer) glDeleteBuffers(1, &g_boundsBuffer);
+    g_boundsTexture = 0;
+    g_boundsBuffer = 0;
+    g_maxObjects = 0;
+    g_revision = 0;
+}
@@ -0,0 +1,188 @@
+#include "object_checkpoint.h"
+#include "objects.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+
+static const GLuint CHECKPOINT_WORK_GROUP_SIZE = 256;
+
+// Buffers
+static GLuint g_baseSSBO = 0;
+static GLuint g_changedSSBO = 0;
+static int g_baseCount = -1;     // -1: no base yet
+static std::vector<GLuint> g_changedBits;
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_numObjectsLoc = -1;
+static GLint g_baseCountLoc = -1;
+
+// ============================================================================
+// Start loading the shader; buffers follow the object count at the first checkpoint
+// ============================================================================
+bool ObjectCheckpoint::Init()
+{
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "object_checkpoint.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_baseCountLoc = glGetUniformLocation(program, "uBaseCount");
+                g_ready = (g_numObjectsLoc != -1 && g_baseCountLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ObjectCheckpoint] object_checkpoint.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+// ============================================================================
+// Copy the current objects over the base
+// ============================================================================
+bool ObjectCheckpoint::SetBase(GLuint objectSSBO, int numObjects)
+{
+    g_baseCount = -1;
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(numObjects) * sizeof(Object);
+    BufferHelpers::EnsureBufferCapacity(g_baseSSBO, bytes > 0 ? bytes : sizeof(Object), GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectCheckpoint] Failed to allocate the base copy (GL error " << err << ")" << std::endl;
+        return false;
+    }
+
+    if (bytes > 0)
+    {
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBuffer(GL_COPY_READ_BUFFER, objectSSBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, g_baseSSBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    g_baseCount = numObjects;
+    return true;
+}
+
+bool ObjectCheckpoint::HasBase()
+{
+    return g_baseCount >= 0;
+}
+
+// ============================================================================
+// Diff against the base, read the bitmap, then only the runs of changed objects
+// ============================================================================
+bool ObjectCheckpoint::TakeDelta(GLuint objectSSBO, int numObjects, std::vector<int>& indices, std::vector<Object>& objects)
+{
+    indices.clear();
+    objects.clear();
+    if (g_baseCount < 0) return false;
+
+    if (!g_ready)
+    {
+        // No diff pass: every object counts as changed
+        for (int i = 0; i < numObjects; i++) indices.push_back(i);
+    }
+    else if (numObjects > 0)
+    {
+        GLuint words = (static_cast<GLuint>(numObjects) + 31) / 32;
+        BufferHelpers::EnsureBufferCapacity(g_changedSSBO, static_cast<GLsizeiptr>(words) * sizeof(GLuint), GL_STREAM_READ);
+        GLuint zero = 0;
+        glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, words * sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        glUseProgram(g_program);
+        glUniform1ui(g_numObjectsLoc, static_cast<GLuint>(numObjects));
+        glUniform1ui(g_baseCountLoc, static_cast<GLuint>(g_baseCount));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CHECKPOINT_BASE_BINDING, g_baseSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CHECKPOINT_CHANGED_BINDING, g_changedSSBO);
+
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+        glDispatchCompute((numObjects + CHECKPOINT_WORK_GROUP_SIZE - 1) / CHECKPOINT_WORK_GROUP_SIZE, 1, 1);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CHECKPOINT_BASE_BINDING, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CHECKPOINT_CHANGED_BINDING, 0);
+        glUseProgram(0);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        // One bit per object crosses the bus
+        g_changedBits.resize(words);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_changedSSBO);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, words * sizeof(GLuint), g_changedBits.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        for (GLuint w = 0; w < words; w++)
+            for (GLuint bits = g_changedBits[w]; bits; bits &= bits - 1)
+            {
+                int bit = 0;
+                while (!(bits & (1u << bit))) bit++;
+                indices.push_back(static_cast<int>(w * 32 + bit));
+            }
+    }
+
+    // Contiguous runs of changed objects, one copy each
+    objects.resize(indices.size());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectSSBO);
+    for (size_t i = 0; i < indices.size();)
+    {
+        size_t end = i + 1;
+        while (end < indices.size() && indices[end] == indices[end - 1] + 1) end++;
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, static_cast<GLintptr>(indices[i]) * sizeof(Object),
+                           (end - i) * sizeof(Object), &objects[i]);
+        i = end;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // The next delta is taken against this state
+    return SetBase(objectSSBO, numObjects);
+}
+
+// ============================================================================
+// Release buffers and the program
+// ============================================================================
+void ObjectCheckpoint::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    GLuint* buffers[] = { &g_baseSSBO, &g_changedSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_baseCount = -1;
+    g_changedBits.clear();
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ObjectCheckpoint::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool ObjectCheckpoint::IsReady()
+{
+    return g_ready;
+}
+
+std::string ObjectCheckpoint::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[object checkpoint] " + g_loader.GetStatusMessage();
+    return "Object checkpoint shader ready";
+}
@@ -0,0 +1,156 @@
+#include "object_culling.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+
+static const GLuint CULL_WORK_GROUP_SIZE = 256;
+
+// Buffers
+static GLuint g_commandBuffer = 0;  // One DrawArraysIndirectCommand
+static GLuint g_visibleSSBO = 0;    // Indices of the visible objects, in no particular order
+static int g_maxObjects = 0;
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_numObjectsLoc = -1;
+static GLint g_viewMinLoc = -1;
+static GLint g_viewMaxLoc = -1;
+static GLint g_objectBoundsLoc = -1;
+
+// ============================================================================
+// Allocate the buffers and start loading the shader
+// ============================================================================
+bool ObjectCulling::Init(int maxObjects)
+{
+    if (g_commandBuffer == 0)
+    {
+        glGenBuffers(1, &g_commandBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, g_commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawArraysIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    if (!Reserve(maxObjects)) return false;
+
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "object_cull.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_viewMinLoc = glGetUniformLocation(program, "uViewMin");
+                g_viewMaxLoc = glGetUniformLocation(program, "uViewMax");
+                g_objectBoundsLoc = glGetUniformLocation(program, "uObjectBounds");
+                g_ready = (g_numObjectsLoc != -1 && g_viewMinLoc != -1 && g_viewMaxLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ObjectCulling] object_cull.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+bool ObjectCulling::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+
+    BufferHelpers::EnsureBufferCapacity(g_visibleSSBO, static_cast<GLsizeiptr>(maxObjects) * sizeof(GLuint));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectCulling] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Visible objects -> list and indirect draw command
+// ============================================================================
+bool ObjectCulling::Cull(GLuint objectSSBO, int numObjects, float minX, float minY, float maxX, float maxY,
+                         bool objectBounds)
+{
+    if (!g_ready || g_commandBuffer == 0 || g_visibleSSBO == 0) return false;
+    if (numObjects > g_maxObjects) return false;
+
+    // The pass counts into instanceCount
+    DrawArraysIndirectCommand command = { 4, 0, 0, 0 };
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, g_commandBuffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(command), &command);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    if (numObjects <= 0) return true;
+
+    glUseProgram(g_program);
+    glUniform1i(g_numObjectsLoc, numObjects);
+    glUniform2f(g_viewMinLoc, minX, minY);
+    glUniform2f(g_viewMaxLoc, maxX, maxY);
+    if (g_objectBoundsLoc != -1) glUniform1i(g_objectBoundsLoc, objectBounds ? 1 : 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_COMMAND_BINDING, g_commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_VISIBLE_BINDING, g_visibleSSBO);
+
+    GLuint groups = (static_cast<GLuint>(numObjects) + CULL_WORK_GROUP_SIZE - 1) / CULL_WORK_GROUP_SIZE;
+    glDispatchCompute(groups, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_COMMAND_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_VISIBLE_BINDING, 0);
+    glUseProgram(0);
+    return true;
+}
+
+GLuint ObjectCulling::GetCommandBuffer()
+{
+    return g_commandBuffer;
+}
+
+GLuint ObjectCulling::GetVisibleBuffer()
+{
+    return g_visibleSSBO;
+}
+
+// ============================================================================
+// Release buffers and the program
+// ============================================================================
+void ObjectCulling::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    GLuint* buffers[] = { &g_commandBuffer, &g_visibleSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_maxObjects = 0;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ObjectCulling::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool ObjectCulling::IsReady()
+{
+    return g_ready;
+}
+
+std::string ObjectCulling::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[object culling] " + g_loader.GetStatusMessage();
+    return "Object culling shader ready";
+}
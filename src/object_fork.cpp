@@ -0,0 +1,155 @@
+#include "object_fork.h"
+#include "objects.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+
+static const GLuint FORK_WORK_GROUP_SIZE = 256;
+
+// Objects as the fork found them
+static GLuint g_sourceSSBO = 0;
+static int g_sourceCount = -1;  // -1: nothing saved
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_numObjectsLoc = -1;
+static GLint g_sourceCountLoc = -1;
+
+// ============================================================================
+// Start loading the shader; the saved copy follows the scene at the first fork
+// ============================================================================
+bool ObjectFork::Init()
+{
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "object_fork.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_sourceCountLoc = glGetUniformLocation(program, "uSourceCount");
+                g_ready = (g_numObjectsLoc != -1 && g_sourceCountLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ObjectFork] object_fork.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+// ============================================================================
+// Saved copy
+// ============================================================================
+bool ObjectFork::Save(GLuint objectSSBO, int numObjects)
+{
+    g_sourceCount = -1;
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(numObjects) * sizeof(Object);
+    BufferHelpers::EnsureBufferCapacity(g_sourceSSBO, bytes > 0 ? bytes : sizeof(Object), GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectFork] Failed to allocate the saved copy (GL error " << err << ")" << std::endl;
+        return false;
+    }
+
+    if (bytes > 0)
+    {
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBuffer(GL_COPY_READ_BUFFER, objectSSBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, g_sourceSSBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    g_sourceCount = numObjects;
+    return true;
+}
+
+int ObjectFork::GetSavedCount()
+{
+    return g_sourceCount;
+}
+
+// ============================================================================
+// One pass per target: object i = saved object i % count in world i / count
+// ============================================================================
+bool ObjectFork::Replicate(const GLuint* targets, int targetCount, int worlds)
+{
+    if (!g_ready || g_sourceCount <= 0 || worlds <= 0) return false;
+
+    GLuint numObjects = static_cast<GLuint>(g_sourceCount) * static_cast<GLuint>(worlds);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    glUseProgram(g_program);
+    glUniform1ui(g_numObjectsLoc, numObjects);
+    glUniform1ui(g_sourceCountLoc, static_cast<GLuint>(g_sourceCount));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, FORK_SOURCE_BINDING, g_sourceSSBO);
+    for (int b = 0; b < targetCount; b++)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, targets[b]);
+        glDispatchCompute((numObjects + FORK_WORK_GROUP_SIZE - 1) / FORK_WORK_GROUP_SIZE, 1, 1);
+    }
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, FORK_SOURCE_BINDING, 0);
+    glUseProgram(0);
+    return true;
+}
+
+bool ObjectFork::Restore(const GLuint* targets, int targetCount)
+{
+    if (g_sourceCount < 0) return false;
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(g_sourceCount) * sizeof(Object);
+    if (bytes > 0)
+    {
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);  // Shader writes to the rows being replaced
+        glBindBuffer(GL_COPY_READ_BUFFER, g_sourceSSBO);
+        for (int b = 0; b < targetCount; b++)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, targets[b]);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    g_sourceCount = -1;
+    return true;
+}
+
+// ============================================================================
+// Release the saved copy and the program
+// ============================================================================
+void ObjectFork::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    if (g_sourceSSBO) glDeleteBuffers(1, &g_sourceSSBO);
+    g_sourceSSBO = 0;
+    g_sourceCount = -1;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ObjectFork::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool ObjectFork::IsReady()
+{
+    return g_ready;
+}
+
+std::string ObjectFork::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[object fork] " + g_loader.GetStatusMessage();
+    return "Object fork shader ready";
+}
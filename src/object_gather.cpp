@@ -0,0 +1,180 @@
+#include "object_gather.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+
+static const GLuint GATHER_WORK_GROUP_SIZE = 256;
+
+// Field widths in floats, in bit order - MUST MATCH ObjectField
+static const int s_fieldWidths[] = { 2, 2, 1, 1, 1, 1, 2, 4, 1 };
+static const int FIELD_COUNT = sizeof(s_fieldWidths) / sizeof(s_fieldWidths[0]);
+
+// Buffers
+static GLuint g_indicesSSBO = 0;
+static GLuint g_outputSSBO = 0;
+static int g_maxObjects = 0;
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_countLoc = -1;
+static GLint g_fieldMaskLoc = -1;
+static GLint g_strideLoc = -1;
+static GLint g_outputOffsetLoc = -1;
+static GLint g_quantizationBoxLoc = -1;
+
+// ============================================================================
+// Initialize the staging buffers and start loading the shader
+// ============================================================================
+bool ObjectGather::Init(int maxObjects)
+{
+    if (!Reserve(maxObjects)) return false;
+
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "object_gather.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_countLoc = glGetUniformLocation(program, "uCount");
+                g_fieldMaskLoc = glGetUniformLocation(program, "uFieldMask");
+                g_strideLoc = glGetUniformLocation(program, "uStride");
+                g_outputOffsetLoc = glGetUniformLocation(program, "uOutputOffset");
+                g_quantizationBoxLoc = glGetUniformLocation(program, "uQuantizationBox");
+                g_ready = (g_countLoc != -1 && g_fieldMaskLoc != -1 && g_strideLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ObjectGather] object_gather.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+bool ObjectGather::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+
+    BufferHelpers::EnsureBufferCapacity(g_indicesSSBO, static_cast<GLsizeiptr>(maxObjects) * sizeof(GLuint), GL_STREAM_DRAW);
+    BufferHelpers::EnsureBufferCapacity(g_outputSSBO,
+                                        static_cast<GLsizeiptr>(maxObjects) * FloatsPerObject(OBJECT_FIELD_ALL) * sizeof(float),
+                                        GL_STREAM_READ);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectGather] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int ObjectGather::FloatsPerObject(unsigned int fieldMask)
+{
+    int floats = 0;
+    for (int i = 0; i < FIELD_COUNT; i++)
+        if (fieldMask & (1u << i)) floats += s_fieldWidths[i];
+    if (fieldMask & OBJECT_FIELD_QUANTIZED)
+    {
+        if (fieldMask & OBJECT_FIELD_POSITION) floats--;  // Two 16-bit fractions in one word
+        if (fieldMask & OBJECT_FIELD_VELOCITY) floats--;  // half2
+    }
+    return floats;
+}
+
+// ============================================================================
+// Listed objects -> selected fields, packed
+// ============================================================================
+bool ObjectGather::Gather(GLuint objectSSBO, const std::vector<int>& indices, unsigned int fieldMask, std::vector<float>& out)
+{
+    if (!g_ready || g_indicesSSBO == 0 || g_outputSSBO == 0) return false;
+    if (indices.size() > static_cast<size_t>(g_maxObjects)) return false;
+
+    GLuint count = static_cast<GLuint>(indices.size());
+    GLuint stride = static_cast<GLuint>(FloatsPerObject(fieldMask));
+    out.resize(static_cast<size_t>(count) * stride);
+    if (count == 0 || stride == 0) return true;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_indicesSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(GLuint), indices.data());
+
+    GatherToBuffer(objectSSBO, g_indicesSSBO, count, fieldMask, g_outputSSBO, 0);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    // Only the packed fields cross the bus
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_outputSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, out.size() * sizeof(float), out.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return true;
+}
+
+bool ObjectGather::GatherToBuffer(GLuint objectSSBO, GLuint indicesSSBO, GLuint count, unsigned int fieldMask,
+                                  GLuint outputSSBO, GLuint outputOffset, const GatherQuantization* quantization)
+{
+    if (!g_ready) return false;
+    if (count == 0 || FloatsPerObject(fieldMask) == 0) return true;
+    if ((fieldMask & OBJECT_FIELD_QUANTIZED) && (!quantization || g_quantizationBoxLoc == -1)) return false;
+
+    glUseProgram(g_program);
+    glUniform1ui(g_countLoc, count);
+    glUniform1ui(g_fieldMaskLoc, fieldMask);
+    glUniform1ui(g_strideLoc, static_cast<GLuint>(FloatsPerObject(fieldMask)));
+    if (g_outputOffsetLoc != -1) glUniform1ui(g_outputOffsetLoc, outputOffset);
+    if (quantization && g_quantizationBoxLoc != -1)
+        glUniform4f(g_quantizationBoxLoc, quantization->minX, quantization->minY, quantization->maxX, quantization->maxY);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GATHER_INDICES_BINDING, indicesSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GATHER_OUTPUT_BINDING, outputSSBO);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    glDispatchCompute((count + GATHER_WORK_GROUP_SIZE - 1) / GATHER_WORK_GROUP_SIZE, 1, 1);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GATHER_INDICES_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GATHER_OUTPUT_BINDING, 0);
+    glUseProgram(0);
+    return true;
+}
+
+// ============================================================================
+// Release buffers and the program
+// ============================================================================
+void ObjectGather::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    GLuint* buffers[] = { &g_indicesSSBO, &g_outputSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_maxObjects = 0;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ObjectGather::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool ObjectGather::IsReady()
+{
+    return g_ready;
+}
+
+std::string ObjectGather::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[object gather] " + g_loader.GetStatusMessage();
+    return "Object gather shader ready";
+}
@@ -0,0 +1,263 @@
+#include "object_handles.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+
+// Buffer, buffer texture and the host copies
+static GLuint g_tableBuffer = 0;
+static GLuint g_tableTexture = 0;
+static std::vector<int> g_slots;     // (index, handle) per slot; index -1 = free, handle = last one issued
+static std::vector<int> g_handles;   // Handle of each object index, -1 = none
+static std::vector<int> g_freeSlots; // Slots below g_slotEnd whose object was removed
+static int g_slotEnd = 0;            // Slots ever issued since the last reset
+static int g_maxObjects = 0;
+
+// Slots edited since the last upload, [g_dirtyBegin, g_dirtyEnd)
+static int g_dirtyBegin = 0;
+static int g_dirtyEnd = 0;
+
+static void MarkDirty(int begin, int end)
+{
+    if (begin >= end) return;
+    if (g_dirtyBegin >= g_dirtyEnd)
+    {
+        g_dirtyBegin = begin;
+        g_dirtyEnd = end;
+        return;
+    }
+    g_dirtyBegin = std::min(g_dirtyBegin, begin);
+    g_dirtyEnd = std::max(g_dirtyEnd, end);
+}
+
+static void SetSlot(int slot, int index, int handle)
+{
+    g_slots[2 * slot] = index;
+    g_slots[2 * slot + 1] = handle;
+    MarkDirty(slot, slot + 1);
+}
+
+// ============================================================================
+// Initialize the table and its buffer texture
+// ============================================================================
+bool ObjectHandles::Init(int maxObjects)
+{
+    return Reserve(maxObjects);
+}
+
+bool ObjectHandles::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    int oldMaxObjects = g_maxObjects;
+    g_maxObjects = maxObjects;
+    g_slots.resize(static_cast<size_t>(maxObjects) * 2, -1);
+    g_handles.resize(maxObjects, -1);
+
+    // The texture covers every slot, so the new ones are uploaded as free
+    BufferHelpers::EnsureBufferCapacity(g_tableBuffer, static_cast<GLsizeiptr>(maxObjects) * 2 * sizeof(int),
+                                        GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    MarkDirty(oldMaxObjects, maxObjects);
+
+    // A grown buffer is a new buffer object, so the texture is re-attached
+    if (g_tableTexture == 0) glGenTextures(1, &g_tableTexture);
+    glActiveTexture(GL_TEXTURE0 + OBJECT_HANDLES_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_tableTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32I, g_tableBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectHandles] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Host object list edits
+// ============================================================================
+void ObjectHandles::Reset(int numObjects)
+{
+    numObjects = std::min(numObjects, g_maxObjects);
+    std::fill(g_slots.begin(), g_slots.begin() + static_cast<size_t>(g_slotEnd) * 2, -1);
+    std::fill(g_handles.begin(), g_handles.end(), -1);
+    MarkDirty(0, std::max(g_slotEnd, numObjects));
+    g_freeSlots.clear();
+    g_slotEnd = 0;
+    for (int i = 0; i < numObjects; i++) Append(i);
+}
+
+int ObjectHandles::Append(int index)
+{
+    if (index < 0 || index >= g_maxObjects) return -1;
+    if (g_handles[index] >= 0) return g_handles[index];
+
+    int slot, generation = 0;
+    if (!g_freeSlots.empty())
+    {
+        slot = g_freeSlots.back();
+        g_freeSlots.pop_back();
+        int last = g_slots[2 * slot + 1];
+        if (last >= 0) generation = ((last >> OBJECT_HANDLE_SLOT_BITS) + 1) % OBJECT_HANDLE_GENERATIONS;
+    }
+    else
+    {
+        if (g_slotEnd >= g_maxObjects) return -1;
+        slot = g_slotEnd++;
+    }
+
+    int handle = (generation << OBJECT_HANDLE_SLOT_BITS) | slot;
+    SetSlot(slot, index, handle);
+    g_handles[index] = handle;
+    return handle;
+}
+
+void ObjectHandles::Release(int index)
+{
+    if (index < 0 || index >= g_maxObjects || g_handles[index] < 0) return;
+    int handle = g_handles[index];
+    int slot = handle & OBJECT_HANDLE_SLOT_MASK;
+    SetSlot(slot, -1, handle);
+    g_freeSlots.push_back(slot);
+    g_handles[index] = -1;
+}
+
+void ObjectHandles::Move(int to, int from)
+{
+    if (to == from || to < 0 || from < 0 || to >= g_maxObjects || from >= g_maxObjects) return;
+    int handle = g_handles[from];
+    g_handles[to] = handle;
+    g_handles[from] = -1;
+    if (handle >= 0) SetSlot(handle & OBJECT_HANDLE_SLOT_MASK, to, handle);
+}
+
+void ObjectHandles::Permute(const std::vector<int>& order)
+{
+    int count = std::min(static_cast<int>(order.size()), g_maxObjects);
+    std::vector<int> handles(g_handles.begin(), g_handles.begin() + count);
+    for (int i = 0; i < count; i++)
+    {
+        int handle = handles[order[i]];
+        g_handles[i] = handle;
+        if (handle >= 0) SetSlot(handle & OBJECT_HANDLE_SLOT_MASK, i, handle);
+    }
+}
+
+int ObjectHandles::HandleOf(int index)
+{
+    if (index < 0 || index >= g_maxObjects) return -1;
+    return g_handles[index];
+}
+
+int ObjectHandles::IndexOf(int handle)
+{
+    if (handle < 0) return -1;
+    int slot = handle & OBJECT_HANDLE_SLOT_MASK;
+    if (slot >= g_slotEnd || g_slots[2 * slot + 1] != handle) return -1;
+    return g_slots[2 * slot];
+}
+
+// ============================================================================
+// Snapshots
+// ============================================================================
+void ObjectHandles::GetHandles(int numObjects, std::vector<int>& handles)
+{
+    numObjects = std::max(0, std::min(numObjects, g_maxObjects));
+    handles.assign(g_handles.begin(), g_handles.begin() + numObjects);
+}
+
+bool ObjectHandles::Restore(const std::vector<int>& handles)
+{
+    int numObjects = static_cast<int>(handles.size());
+    if (numObjects > g_maxObjects) return false;
+
+    // Each slot at most once
+    int slotEnd = 0;
+    std::vector<int> slots;
+    slots.reserve(handles.size());
+    for (int handle : handles)
+    {
+        if (handle < 0) return false;
+        slots.push_back(handle & OBJECT_HANDLE_SLOT_MASK);
+        slotEnd = std::max(slotEnd, slots.back() + 1);
+    }
+    std::sort(slots.begin(), slots.end());
+    if (std::adjacent_find(slots.begin(), slots.end()) != slots.end()) return false;
+    if (!Reserve(slotEnd)) return false;
+
+    Reset(0);
+    for (int i = 0; i < numObjects; i++)
+    {
+        SetSlot(handles[i] & OBJECT_HANDLE_SLOT_MASK, i, handles[i]);
+        g_handles[i] = handles[i];
+    }
+    g_slotEnd = slotEnd;
+    for (int slot = slotEnd - 1; slot >= 0; slot--)
+        if (g_slots[2 * slot] < 0) g_freeSlots.push_back(slot);
+    MarkDirty(0, slotEnd);
+    return true;
+}
+
+std::vector<int> ObjectHandles::BuildSlotTable(const std::vector<int>& handles)
+{
+    std::vector<int> table;
+    bool identity = true;
+    int slotEnd = 0;
+    for (size_t i = 0; i < handles.size(); i++)
+    {
+        identity = identity && handles[i] == static_cast<int>(i);
+        if (handles[i] >= 0) slotEnd = std::max(slotEnd, (handles[i] & OBJECT_HANDLE_SLOT_MASK) + 1);
+    }
+    if (identity) return table;
+
+    table.assign(static_cast<size_t>(slotEnd) * 2, -1);
+    for (size_t i = 0; i < handles.size(); i++)
+    {
+        if (handles[i] < 0) continue;
+        int slot = handles[i] & OBJECT_HANDLE_SLOT_MASK;
+        table[2 * slot] = static_cast<int>(i);
+        table[2 * slot + 1] = handles[i];
+    }
+    return table;
+}
+
+// ============================================================================
+// Upload the edited slots in one call and bind the texture
+// ============================================================================
+void ObjectHandles::Bind()
+{
+    if (g_tableTexture == 0) return;
+
+    if (g_dirtyBegin < g_dirtyEnd)
+    {
+        GLintptr offset = static_cast<GLintptr>(g_dirtyBegin) * 2 * sizeof(int);
+        GLsizeiptr size = static_cast<GLsizeiptr>(g_dirtyEnd - g_dirtyBegin) * 2 * sizeof(int);
+        glBindBuffer(GL_TEXTURE_BUFFER, g_tableBuffer);
+        glBufferSubData(GL_TEXTURE_BUFFER, offset, size, g_slots.data() + static_cast<size_t>(g_dirtyBegin) * 2);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        g_dirtyBegin = g_dirtyEnd = 0;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + OBJECT_HANDLES_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_tableTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// ============================================================================
+// Release the buffer and texture
+// ============================================================================
+void ObjectHandles::Cleanup()
+{
+    if (g_tableTexture) glDeleteTextures(1, &g_tableTexture);
+    if (g_tableBuffer) glDeleteBuffers(1, &g_tableBuffer);
+    g_tableTexture = 0;
+    g_tableBuffer = 0;
+    g_slots.clear();
+    g_handles.clear();
+    g_freeSlots.clear();
+    g_slotEnd = 0;
+    g_maxObjects = 0;
+    g_dirtyBegin = g_dirtyEnd = 0;
+}
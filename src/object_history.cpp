@@ -0,0 +1,149 @@
+#include "object_history.h"
+#include "objects.h"
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+struct HistorySlot
+{
+    int numObjects = 0;
+    double time = 0.0;
+};
+
+static GLuint g_ringSSBO = 0;
+static std::vector<HistorySlot> g_slots;
+static int g_slotObjects = 0;  // Objects one slot holds
+static int g_newest = -1;      // Slot of the newest snapshot
+static int g_count = 0;
+
+static GLintptr SlotOffset(int slot)
+{
+    return static_cast<GLintptr>(slot) * g_slotObjects * sizeof(Object);
+}
+
+// Slot of the snapshot back steps older than the newest, -1 if not held
+static int SlotAt(int back)
+{
+    if (back < 0 || back >= g_count) return -1;
+    int capacity = static_cast<int>(g_slots.size());
+    return (g_newest - back + capacity) % capacity;
+}
+
+// ============================================================================
+// Ring size
+// ============================================================================
+void ObjectHistory::SetCapacity(int capacity)
+{
+    capacity = std::max(0, capacity);
+    if (capacity == static_cast<int>(g_slots.size())) return;
+    if (g_ringSSBO) glDeleteBuffers(1, &g_ringSSBO);
+    g_ringSSBO = 0;
+    g_slots.assign(static_cast<size_t>(capacity), HistorySlot());
+    g_slotObjects = 0;
+    Clear();
+}
+
+void ObjectHistory::Clear()
+{
+    g_newest = -1;
+    g_count = 0;
+}
+
+// ============================================================================
+// Snapshot into the next slot
+// ============================================================================
+bool ObjectHistory::Push(GLuint objectSSBO, int numObjects, double time)
+{
+    int capacity = static_cast<int>(g_slots.size());
+    if (capacity == 0 || numObjects <= 0) return false;
+
+    // (Re)allocate for the current object buffer; older snapshots do not fit the new layout
+    if (g_ringSSBO == 0 || numObjects > g_slotObjects)
+    {
+        if (g_ringSSBO) glDeleteBuffers(1, &g_ringSSBO);
+        g_slotObjects = numObjects;
+        glGenBuffers(1, &g_ringSSBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, g_ringSSBO);
+        glBufferData(GL_COPY_WRITE_BUFFER, SlotOffset(capacity), nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        Clear();
+
+        GLenum err = glGetError();
+        if (err != GL_NO_ERROR)
+        {
+            std::cerr << "[ObjectHistory] Failed to allocate " << capacity << " snapshots (GL error " << err << ")" << std::endl;
+            glDeleteBuffers(1, &g_ringSSBO);
+            g_ringSSBO = 0;
+            g_slotObjects = 0;
+            return false;
+        }
+    }
+
+    int slot = (g_newest + 1) % capacity;
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);  // The step that wrote the objects
+    glBindBuffer(GL_COPY_READ_BUFFER, objectSSBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, g_ringSSBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, SlotOffset(slot),
+                        static_cast<GLsizeiptr>(numObjects) * sizeof(Object));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    g_slots[slot].numObjects = numObjects;
+    g_slots[slot].time = time;
+    g_newest = slot;
+    g_count = std::min(g_count + 1, capacity);
+    return true;
+}
+
+int ObjectHistory::GetCount()
+{
+    return g_count;
+}
+
+int ObjectHistory::GetObjects(int back)
+{
+    int slot = SlotAt(back);
+    return slot < 0 ? -1 : g_slots[slot].numObjects;
+}
+
+double ObjectHistory::GetTime(int back)
+{
+    int slot = SlotAt(back);
+    return slot < 0 ? 0.0 : g_slots[slot].time;
+}
+
+// ============================================================================
+// Copy a snapshot back; it becomes the newest
+// ============================================================================
+bool ObjectHistory::Restore(int back, const GLuint* targets, int targetCount)
+{
+    int slot = SlotAt(back);
+    if (slot < 0) return false;
+
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(g_slots[slot].numObjects) * sizeof(Object);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);  // Shader writes to the rows being replaced
+    glBindBuffer(GL_COPY_READ_BUFFER, g_ringSSBO);
+    for (int b = 0; b < targetCount; b++)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, targets[b]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, SlotOffset(slot), 0, bytes);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    g_newest = slot;
+    g_count -= back;
+    return true;
+}
+
+// ============================================================================
+// Release the ring
+// ============================================================================
+void ObjectHistory::Cleanup()
+{
+    if (g_ringSSBO) glDeleteBuffers(1, &g_ringSSBO);
+    g_ringSSBO = 0;
+    g_slots.clear();
+    g_slotObjects = 0;
+    Clear();
+}
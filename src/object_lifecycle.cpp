@@ -0,0 +1,377 @@
+#include "object_lifecycle.h"
+#include "adaptive_timestep.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Lifecycle passes - MUST MATCH object_lifecycle.comp
+enum LifecyclePass
+{
+    LIFECYCLE_PASS_MARK = 0,
+    LIFECYCLE_PASS_PLAN = 1,
+    LIFECYCLE_PASS_GATHER = 2,
+    LIFECYCLE_PASS_MOVE = 3,
+    LIFECYCLE_PASS_SPAWN = 4,
+    LIFECYCLE_PASS_FINALIZE = 5
+};
+
+static const GLuint LIFECYCLE_WORK_GROUP_SIZE = 256;
+
+// Counters in object_lifecycle.comp
+struct LifecycleCounters
+{
+    GLuint count;        // Objects, host-managed ones included
+    GLuint deadCount;    // Spawned objects marked dead this step
+    GLuint newCount;     // count - deadCount
+    GLuint moveCount;    // Holes the last step refilled
+    GLuint holeCursor;
+    GLuint moverCursor;
+    GLuint _pad0;
+    GLuint _pad1;
+};
+
+static const GLsizeiptr LIFECYCLE_STATE_SIZE = 4 * sizeof(GLint);  // MUST MATCH LifecycleState
+
+// Buffers
+static GLuint g_countersSSBO = 0;
+static GLuint g_stateSSBO = 0;
+static GLuint g_emittersSSBO = 0;
+static GLuint g_movesSSBO = 0;
+static GLuint g_readbackSSBO = 0;  // Copy of the object count the host reads once its fence has passed
+static GLsync g_readbackFence = nullptr;
+static int g_maxObjects = 0;
+
+// Emitters (slot = emitter ID) and the fractional spawns they carry between steps
+static ParticleEmitter g_emitters[MAX_PARTICLE_EMITTERS];
+static float g_emitterRates[MAX_PARTICLE_EMITTERS];
+static float g_emitterCarry[MAX_PARTICLE_EMITTERS];
+static bool g_emitterUsed[MAX_PARTICLE_EMITTERS];
+static int g_emitterCount = 0;
+
+// Spawned objects live in [g_base, GPU count)
+static bool g_active = false;
+static int g_base = 0;
+static GLuint g_stepSeed = 0;
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_passLoc = -1;
+static GLint g_baseLoc = -1;
+static GLint g_capacityLoc = -1;
+static GLint g_spawnTotalLoc = -1;
+static GLint g_seedLoc = -1;
+static GLint g_dtLoc = -1;
+static GLint g_adaptiveTimestepLoc = -1;
+
+// Create an SSBO of the given size if it does not exist yet
+static void EnsureBuffer(GLuint& buffer, GLsizeiptr size)
+{
+    BufferHelpers::EnsureBufferCapacity(buffer, size);
+}
+
+static GLuint NumBlocks(GLuint numItems)
+{
+    return (std::max(numItems, 1u) + LIFECYCLE_WORK_GROUP_SIZE - 1) / LIFECYCLE_WORK_GROUP_SIZE;
+}
+
+// Run a single lifecycle pass over the given number of items
+static void DispatchPass(int pass, GLuint numItems)
+{
+    glUniform1i(g_passLoc, pass);
+    glDispatchCompute(NumBlocks(numItems), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// Forget a count copy still in flight (the host changed the count since)
+static void DropReadback()
+{
+    if (g_readbackFence) glDeleteSync(g_readbackFence);
+    g_readbackFence = nullptr;
+}
+
+static void WriteObjectCount(int count)
+{
+    LifecycleCounters counters = {};
+    counters.count = static_cast<GLuint>(count);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_countersSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(LifecycleCounters), &counters);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// ============================================================================
+// Initialize buffers and start loading the lifecycle shader
+// ============================================================================
+bool ObjectLifecycle::Init(int maxObjects)
+{
+    if (!Reserve(maxObjects)) return false;
+
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "object_lifecycle.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_passLoc = glGetUniformLocation(program, "uPass");
+                g_baseLoc = glGetUniformLocation(program, "uBase");
+                g_capacityLoc = glGetUniformLocation(program, "uCapacity");
+                g_spawnTotalLoc = glGetUniformLocation(program, "uSpawnTotal");
+                g_seedLoc = glGetUniformLocation(program, "uSeed");
+                g_dtLoc = glGetUniformLocation(program, "uDt");
+                g_adaptiveTimestepLoc = glGetUniformLocation(program, "uAdaptiveTimestep");
+                g_ready = (g_passLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ObjectLifecycle] object_lifecycle.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+bool ObjectLifecycle::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+    GLsizeiptr objects = static_cast<GLsizeiptr>(maxObjects);
+
+    EnsureBuffer(g_countersSSBO, sizeof(LifecycleCounters));
+    EnsureBuffer(g_stateSSBO, objects * LIFECYCLE_STATE_SIZE);
+    EnsureBuffer(g_emittersSSBO, MAX_PARTICLE_EMITTERS * sizeof(ParticleEmitter));
+    EnsureBuffer(g_movesSSBO, objects * 2 * sizeof(GLuint));
+    EnsureBuffer(g_readbackSSBO, sizeof(GLuint));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectLifecycle] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Emitters
+// ============================================================================
+int ObjectLifecycle::AddEmitter(const ParticleEmitter& emitter, float rate)
+{
+    for (int id = 0; id < MAX_PARTICLE_EMITTERS; id++)
+    {
+        if (g_emitterUsed[id]) continue;
+
+        // A reused slot's kill conditions also apply to what its previous emitter left alive
+        g_emitters[id] = emitter;
+        g_emitters[id].spawnOffset = 0;
+        g_emitters[id].spawnCount = 0;
+        g_emitterRates[id] = std::max(0.0f, rate);
+        g_emitterCarry[id] = 0.0f;
+        g_emitterUsed[id] = true;
+        g_emitterCount++;
+        return id;
+    }
+    return -1;
+}
+
+bool ObjectLifecycle::RemoveEmitter(int emitterID)
+{
+    if (emitterID < 0 || emitterID >= MAX_PARTICLE_EMITTERS || !g_emitterUsed[emitterID]) return false;
+    g_emitterUsed[emitterID] = false;  // Its objects keep its kill conditions until the slot is reused
+    g_emitterCount--;
+    return true;
+}
+
+void ObjectLifecycle::ClearEmitters()
+{
+    for (int id = 0; id < MAX_PARTICLE_EMITTERS; id++) g_emitterUsed[id] = false;
+    g_emitterCount = 0;
+}
+
+int ObjectLifecycle::GetEmitterCount()
+{
+    return g_emitterCount;
+}
+
+// ============================================================================
+// Mark -> compact -> spawn, all against the GPU count
+// ============================================================================
+bool ObjectLifecycle::Step(GLuint currentSSBO, GLuint otherSSBO, GLuint collisionPropsSSBO, int numObjects,
+                           float stepDt, bool adaptiveTimestep)
+{
+    if (!g_ready) return false;
+    if (!g_active && g_emitterCount == 0) return false;
+
+    // Spawned objects start after everything the host manages
+    if (!g_active)
+    {
+        g_base = numObjects;
+        WriteObjectCount(g_base);
+        g_active = true;
+    }
+
+    // Spawns this step, in emitter order
+    int spawnTotal = 0;
+    for (int id = 0; id < MAX_PARTICLE_EMITTERS; id++)
+    {
+        ParticleEmitter& emitter = g_emitters[id];
+        emitter.spawnOffset = spawnTotal;
+        emitter.spawnCount = 0;
+        if (!g_emitterUsed[id]) continue;
+
+        g_emitterCarry[id] += g_emitterRates[id] * std::max(0.0f, stepDt);
+        int spawns = static_cast<int>(std::floor(g_emitterCarry[id]));
+        g_emitterCarry[id] -= static_cast<float>(spawns);
+        emitter.spawnCount = std::min(spawns, g_maxObjects - g_base);
+        spawnTotal += emitter.spawnCount;
+    }
+    spawnTotal = std::min(spawnTotal, g_maxObjects - g_base);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_emittersSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(g_emitters), g_emitters);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLuint region = static_cast<GLuint>(g_maxObjects - g_base);
+
+    glUseProgram(g_program);
+    if (g_baseLoc != -1) glUniform1ui(g_baseLoc, static_cast<GLuint>(g_base));
+    if (g_capacityLoc != -1) glUniform1ui(g_capacityLoc, static_cast<GLuint>(g_maxObjects));
+    if (g_spawnTotalLoc != -1) glUniform1ui(g_spawnTotalLoc, static_cast<GLuint>(spawnTotal));
+    if (g_seedLoc != -1) glUniform1ui(g_seedLoc, g_stepSeed++);
+    if (g_dtLoc != -1) glUniform1f(g_dtLoc, stepDt);
+    if (g_adaptiveTimestepLoc != -1) glUniform1i(g_adaptiveTimestepLoc, adaptiveTimestep ? 1 : 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, currentSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, otherSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, collisionPropsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIFECYCLE_COUNTERS_BINDING, g_countersSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIFECYCLE_STATE_BINDING, g_stateSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIFECYCLE_EMITTERS_BINDING, g_emittersSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIFECYCLE_MOVES_BINDING, g_movesSSBO);
+    if (adaptiveTimestep) AdaptiveTimestep::Bind();
+
+    DispatchPass(LIFECYCLE_PASS_MARK, region);
+    DispatchPass(LIFECYCLE_PASS_PLAN, 1);
+    DispatchPass(LIFECYCLE_PASS_GATHER, region);
+    DispatchPass(LIFECYCLE_PASS_MOVE, region);
+    if (spawnTotal > 0) DispatchPass(LIFECYCLE_PASS_SPAWN, static_cast<GLuint>(spawnTotal));
+    DispatchPass(LIFECYCLE_PASS_FINALIZE, 1);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIFECYCLE_COUNTERS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIFECYCLE_STATE_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIFECYCLE_EMITTERS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIFECYCLE_MOVES_BINDING, 0);
+    if (adaptiveTimestep) AdaptiveTimestep::Unbind();
+    glUseProgram(0);
+
+    // One copy of the count in flight at a time; the host reads it once the fence has passed
+    if (!g_readbackFence)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, g_countersSSBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, g_readbackSSBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(GLuint));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        g_readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    return true;
+}
+
+bool ObjectLifecycle::PollObjectCount(int& numObjects)
+{
+    if (!g_readbackFence) return false;
+
+    GLenum status = glClientWaitSync(g_readbackFence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return false;
+    DropReadback();
+
+    GLuint count = 0;
+    glBindBuffer(GL_COPY_READ_BUFFER, g_readbackSSBO);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(GLuint), &count);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    numObjects = static_cast<int>(count);
+
+    // Everything spawned has died and nothing spawns any more
+    if (g_emitterCount == 0 && numObjects <= g_base) g_active = false;
+    return true;
+}
+
+bool ObjectLifecycle::IsActive()
+{
+    return g_active;
+}
+
+int ObjectLifecycle::GetBase()
+{
+    return g_base;
+}
+
+void ObjectLifecycle::KillObject(int index)
+{
+    if (!g_active || index < g_base || index >= g_maxObjects) return;
+
+    GLint dead = 1;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_stateSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, index * LIFECYCLE_STATE_SIZE + 2 * sizeof(GLint), sizeof(GLint), &dead);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ObjectLifecycle::DiscardSpawned()
+{
+    if (!g_active) return;
+    DropReadback();
+    WriteObjectCount(g_base);
+    g_active = false;
+}
+
+// ============================================================================
+// Release buffers and the lifecycle program
+// ============================================================================
+void ObjectLifecycle::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    DropReadback();
+    GLuint* buffers[] = { &g_countersSSBO, &g_stateSSBO, &g_emittersSSBO, &g_movesSSBO, &g_readbackSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_maxObjects = 0;
+
+    ClearEmitters();
+    g_active = false;
+    g_base = 0;
+    g_stepSeed = 0;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ObjectLifecycle::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool ObjectLifecycle::IsReady()
+{
+    return g_ready;
+}
+
+std::string ObjectLifecycle::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[object lifecycle] " + g_loader.GetStatusMessage();
+    return "Object lifecycle shader ready";
+}
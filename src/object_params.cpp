@@ -0,0 +1,153 @@
+#include "object_params.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+// Buffer, buffer texture and the host copy
+static GLuint g_paramsBuffer = 0;
+static GLuint g_paramsTexture = 0;
+static std::vector<float> g_values;  // OBJECT_PARAM_COUNT per object
+static int g_maxObjects = 0;
+
+// Rows edited since the last upload, [g_dirtyBegin, g_dirtyEnd)
+static int g_dirtyBegin = 0;
+static int g_dirtyEnd = 0;
+
+static void MarkDirty(int index)
+{
+    if (g_dirtyBegin >= g_dirtyEnd)
+    {
+        g_dirtyBegin = index;
+        g_dirtyEnd = index + 1;
+        return;
+    }
+    g_dirtyBegin = std::min(g_dirtyBegin, index);
+    g_dirtyEnd = std::max(g_dirtyEnd, index + 1);
+}
+
+// ============================================================================
+// Initialize the buffer and its buffer texture
+// ============================================================================
+bool ObjectParams::Init(int maxObjects)
+{
+    return Reserve(maxObjects);
+}
+
+bool ObjectParams::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+    g_values.resize(static_cast<size_t>(maxObjects) * OBJECT_PARAM_COUNT, 0.0f);
+
+    BufferHelpers::EnsureBufferCapacity(g_paramsBuffer,
+                                        static_cast<GLsizeiptr>(maxObjects) * OBJECT_PARAM_COUNT * sizeof(float),
+                                        GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // A grown buffer is a new buffer object, so the texture is re-attached
+    if (g_paramsTexture == 0) glGenTextures(1, &g_paramsTexture);
+    glActiveTexture(GL_TEXTURE0 + OBJECT_PARAMS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_paramsTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, g_paramsBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectParams] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Host edits
+// ============================================================================
+void ObjectParams::Set(int index, int first, const float* values, int count)
+{
+    if (index < 0 || index >= g_maxObjects || first < 0) return;
+    count = std::min(count, OBJECT_PARAM_COUNT - first);
+    if (count <= 0) return;
+
+    std::copy(values, values + count, g_values.begin() + static_cast<size_t>(index) * OBJECT_PARAM_COUNT + first);
+    MarkDirty(index);
+}
+
+void ObjectParams::Get(int index, float* out)
+{
+    if (index < 0 || index >= g_maxObjects)
+    {
+        std::fill(out, out + OBJECT_PARAM_COUNT, 0.0f);
+        return;
+    }
+    auto row = g_values.begin() + static_cast<size_t>(index) * OBJECT_PARAM_COUNT;
+    std::copy(row, row + OBJECT_PARAM_COUNT, out);
+}
+
+void ObjectParams::Clear(int index)
+{
+    if (index < 0 || index >= g_maxObjects) return;
+    auto row = g_values.begin() + static_cast<size_t>(index) * OBJECT_PARAM_COUNT;
+    if (std::all_of(row, row + OBJECT_PARAM_COUNT, [](float v) { return v == 0.0f; })) return;
+    std::fill(row, row + OBJECT_PARAM_COUNT, 0.0f);
+    MarkDirty(index);
+}
+
+void ObjectParams::Move(int to, int from)
+{
+    if (to == from || to < 0 || from < 0 || to >= g_maxObjects || from >= g_maxObjects) return;
+    float row[OBJECT_PARAM_COUNT];
+    Get(from, row);
+    Set(to, 0, row, OBJECT_PARAM_COUNT);
+    Clear(from);
+}
+
+void ObjectParams::Permute(const std::vector<int>& order)
+{
+    int count = std::min(static_cast<int>(order.size()), g_maxObjects);
+    if (count == 0) return;
+    std::vector<float> rows(g_values.begin(), g_values.begin() + static_cast<size_t>(count) * OBJECT_PARAM_COUNT);
+    for (int i = 0; i < count; i++)
+        std::copy_n(&rows[static_cast<size_t>(order[i]) * OBJECT_PARAM_COUNT], OBJECT_PARAM_COUNT,
+                    &g_values[static_cast<size_t>(i) * OBJECT_PARAM_COUNT]);
+    MarkDirty(0);
+    MarkDirty(count - 1);
+}
+
+// ============================================================================
+// Upload the edited rows in one call and bind the texture
+// ============================================================================
+void ObjectParams::Bind()
+{
+    if (g_paramsTexture == 0) return;
+
+    if (g_dirtyBegin < g_dirtyEnd)
+    {
+        GLintptr offset = static_cast<GLintptr>(g_dirtyBegin) * OBJECT_PARAM_COUNT * sizeof(float);
+        GLsizeiptr size = static_cast<GLsizeiptr>(g_dirtyEnd - g_dirtyBegin) * OBJECT_PARAM_COUNT * sizeof(float);
+        glBindBuffer(GL_TEXTURE_BUFFER, g_paramsBuffer);
+        glBufferSubData(GL_TEXTURE_BUFFER, offset, size, g_values.data() + static_cast<size_t>(g_dirtyBegin) * OBJECT_PARAM_COUNT);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        g_dirtyBegin = g_dirtyEnd = 0;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + OBJECT_PARAMS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_paramsTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// ============================================================================
+// Release the buffer and texture
+// ============================================================================
+void ObjectParams::Cleanup()
+{
+    if (g_paramsTexture) glDeleteTextures(1, &g_paramsTexture);
+    if (g_paramsBuffer) glDeleteBuffers(1, &g_paramsBuffer);
+    g_paramsTexture = 0;
+    g_paramsBuffer = 0;
+    g_values.clear();
+    g_maxObjects = 0;
+    g_dirtyBegin = g_dirtyEnd = 0;
+}
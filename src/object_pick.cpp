@@ -0,0 +1,142 @@
+#include "object_pick.h"
+#include "async_shader_loader.h"
+#include "common_definitions.h"
+#include <iostream>
+
+static const GLuint OBJECT_PICK_WORK_GROUP_SIZE = 256;
+
+// Buffers
+static GLuint g_resultSSBO = 0;  // Nearest squared distance bits, then the hit index
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_numObjectsLoc = -1;
+static GLint g_pointLoc = -1;
+static GLint g_passLoc = -1;
+
+// ============================================================================
+// Allocate the result buffer and start loading the shader
+// ============================================================================
+bool ObjectPick::Init()
+{
+    if (g_resultSSBO == 0)
+    {
+        glGenBuffers(1, &g_resultSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_resultSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectPick] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "object_pick.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_pointLoc = glGetUniformLocation(program, "uPoint");
+                g_passLoc = glGetUniformLocation(program, "uPass");
+                g_ready = (g_numObjectsLoc != -1 && g_pointLoc != -1 && g_passLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ObjectPick] object_pick.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+// ============================================================================
+// Nearest object under a point
+// ============================================================================
+bool ObjectPick::Pick(GLuint objectSSBO, int numObjects, const glm::vec2& worldPos, int& index)
+{
+    index = -1;
+    if (!g_ready || g_resultSSBO == 0) return false;
+    if (numObjects <= 0) return true;
+
+    const GLuint none[2] = { ~0u, ~0u };
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_resultSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(none), none);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glUseProgram(g_program);
+    glUniform1i(g_numObjectsLoc, numObjects);
+    glUniform2f(g_pointLoc, worldPos.x, worldPos.y);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_PICK_RESULT_BINDING, g_resultSSBO);
+
+    GLuint groups = (static_cast<GLuint>(numObjects) + OBJECT_PICK_WORK_GROUP_SIZE - 1) / OBJECT_PICK_WORK_GROUP_SIZE;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        glUniform1i(g_passLoc, pass);
+        glDispatchCompute(groups, 1, 1);
+        glMemoryBarrier(pass == 0 ? GL_SHADER_STORAGE_BARRIER_BIT : GL_BUFFER_UPDATE_BARRIER_BIT);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_PICK_RESULT_BINDING, 0);
+    glUseProgram(0);
+
+    GLuint result[2] = { ~0u, ~0u };
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_resultSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(result), result);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    if (result[1] != ~0u) index = static_cast<int>(result[1]);
+    return true;
+}
+
+float ObjectPick::PickRadius(int skinType, const glm::vec4& visualData)
+{
+    switch (skinType)
+    {
+    case SKIN_CIRCLE:    return visualData.x * 1.2f;                                     // visualData.x = radius
+    case SKIN_RECTANGLE: return glm::length(glm::vec2(visualData.x, visualData.y)) * 0.7f;  // (width, height, ...)
+    case SKIN_POLYGON:   return visualData.x * 1.2f;                                     // visualData.x = radius
+    default:             return 0.2f;
+    }
+}
+
+// ============================================================================
+// Release buffers and the program
+// ============================================================================
+void ObjectPick::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    if (g_resultSSBO) glDeleteBuffers(1, &g_resultSSBO);
+    g_resultSSBO = 0;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ObjectPick::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool ObjectPick::IsReady()
+{
+    return g_ready;
+}
+
+std::string ObjectPick::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[object pick] " + g_loader.GetStatusMessage();
+    return "Object pick shader ready";
+}
@@ -0,0 +1,423 @@
+#include "object_pipeline.h"
+#include "equation_codegen.h"
+#include "broadphase.h"
+#include "buffer_helpers.h"
+#include "embedded_shaders.h"
+#include "gpu_serializer.h"
+#include "parser.h"
+#include "shader_utils.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+static const GLuint PIPELINE_FIELDS_BINDING = 2;  // MUST MATCH object_pipeline.comp
+static const GLuint PIPELINE_WORK_GROUP_SIZE = 256;
+static const GLsizeiptr ROW_SIZE = PIPELINE_FIELD_COUNT * sizeof(float);
+
+struct PipelinePass
+{
+    GLuint program = 0;
+    float radius = 0.0f;  // Largest neighbour radius, 0 = no neighbour reductions
+    GLint numObjectsLoc = -1, gridTableSizeLoc = -1, cellSizeLoc = -1;
+};
+
+// Fields of every object, and the rgba32f buffer texture over them (two texels per object)
+static GLuint g_fieldsBuffer = 0;
+static GLuint g_fieldsTexture = 0;
+static int g_maxObjects = 0;
+
+// Passes in order, and the fld[] slots they write
+static std::vector<PipelinePass> g_passes;
+static unsigned g_writtenFields = 0;  // Bit per slot
+static std::string g_templateSource;
+
+static void DeletePasses(std::vector<PipelinePass>& passes)
+{
+    for (PipelinePass& pass : passes)
+        if (pass.program) glDeleteProgram(pass.program);
+    passes.clear();
+}
+
+static void ClearFields()
+{
+    if (g_fieldsBuffer == 0) return;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_fieldsBuffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32F, GL_RED, GL_FLOAT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// ============================================================================
+// Passes to GLSL
+// ============================================================================
+
+static std::string FloatLiteral(float value)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9e", value);
+    return buffer;
+}
+
+static int FieldSlotOf(SymbolId symbol)
+{
+    const std::string& name = symbolName(symbol);
+    if (name.compare(0, 4, "fld[") != 0) return -1;
+    return std::atoi(name.c_str() + 4);
+}
+
+// Throws for what a pass cannot evaluate: the rules of reduce(), neighbour reductions aside.
+// Own fields read from `own`, a neighbour's (in a body) from `earlier`, bits per slot.
+static void CheckTokens(const std::vector<Token>& tokens, unsigned own, unsigned earlier, bool body)
+{
+    for (const Token& token : tokens)
+    {
+        if (token.type == TOKEN_DERIVATIVE) throw std::runtime_error("D() is not supported in pipeline passes");
+        if (token.type == TOKEN_TABLE || token.type == TOKEN_FIELD)
+            throw std::runtime_error("table() and field() are not supported in pipeline passes");
+        if (token.type == TOKEN_PAIR_REF)
+        {
+            if (!body) throw std::runtime_error("pj." + symbolName(token.object_property) + " is only valid inside nsum() or nmean()");
+            int slot = FieldSlotOf(token.object_property);
+            if (slot >= 0 && !(earlier & (1u << slot)))
+                throw std::runtime_error("pj.fld[] reads a field no earlier pass writes");
+        }
+        if (token.type == TOKEN_PAIR_SUM)
+        {
+            if (!(token.pair_radius > 0.0f)) throw std::runtime_error("sum_j() is not supported in pipeline passes, use nsum()");
+            CheckTokens(token.pair_expr_tokens, earlier, earlier, true);
+        }
+        if (token.type == TOKEN_VARIABLE)
+        {
+            if (FieldSlotOf(token.variable) >= 0)
+            {
+                int slot = FieldSlotOf(token.variable);
+                if (!(own & (1u << slot)))
+                    throw std::runtime_error("fld[] reads a field no earlier pass or statement writes");
+                continue;
+            }
+            int varHash = hashVariableName(token.variable);
+            if ((varHash >= VariableHashes::VAR_HASH_RAND_0 && varHash <= VariableHashes::VAR_HASH_RANDN_7) ||
+                (varHash >= VariableHashes::VAR_HASH_STATE_0 && varHash <= VariableHashes::VAR_HASH_STATE_7) ||
+                (varHash >= VariableHashes::VAR_HASH_AGG_0 && varHash <= VariableHashes::VAR_HASH_AGG_15) ||
+                (varHash >= VariableHashes::VAR_HASH_GRAV_AX && varHash <= VariableHashes::VAR_HASH_COUL_AY) ||
+                (varHash >= VariableHashes::VAR_HASH_SPH_AX && varHash <= VariableHashes::VAR_HASH_SPH_P))
+                throw std::runtime_error("Pipeline passes cannot read rand()/randn(), s0..s7, agg[] or long-range and SPH accelerations");
+        }
+    }
+}
+
+static bool IsIdentifier(const std::string& name)
+{
+    if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) return false;
+    for (char c : name)
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') return false;
+    return true;
+}
+
+static std::string Trim(const std::string& text)
+{
+    size_t first = text.find_first_not_of(" \t\n\r");
+    if (first == std::string::npos) return "";
+    size_t last = text.find_last_not_of(" \t\n\r");
+    return text.substr(first, last - first + 1);
+}
+
+// The marker block of one pass; written gains the slots it stores. Throws on error.
+static std::string GeneratePass(const std::string& text, unsigned& written, float& radius)
+{
+    const unsigned earlier = written;
+    std::string bodies, statements, bodyDispatch, stores;
+    std::string radii, reductions;
+    int pairSlots = 0;
+    int statementCount = 0;
+    radius = 0.0f;
+
+    size_t begin = 0;
+    while (begin <= text.size())
+    {
+        size_t end = std::min(text.find(';', begin), text.size());
+        std::string statement = Trim(text.substr(begin, end - begin));
+        begin = end + 1;
+        if (statement.empty()) continue;
+
+        size_t equals = statement.find('=');
+        if (equals == std::string::npos) throw std::runtime_error("Expected 'name = expr': " + statement);
+        std::string name = Trim(statement.substr(0, equals));
+        std::string expression = Trim(statement.substr(equals + 1));
+        if (!IsIdentifier(name)) throw std::runtime_error("Invalid field name: " + name);
+        if (expression.empty()) throw std::runtime_error("Missing expression in: " + statement);
+
+        std::vector<Token> rpn;
+        {
+            ParserContext context;
+            rpn = infixToRPN(tokenizeExpression(expression, context));
+        }
+        if (rpn.empty()) throw std::runtime_error("Empty expression for field '" + name + "'");
+        CheckTokens(rpn, written, earlier, false);
+
+        // Parsed before the name is given a slot, so a field cannot read itself
+        int slot = pipelineFieldSlot(name);
+        if (slot < 0) throw std::runtime_error("At most " + std::to_string(MAX_PIPELINE_FIELDS) + " pipeline fields");
+        if (written & (1u << slot)) throw std::runtime_error("Field '" + name + "' is written twice");
+
+        // Bodies in the order the serializer numbers their slots
+        int pairSlot = pairSlots - 1;
+        for (const Token& token : rpn)
+        {
+            if (token.type != TOKEN_PAIR_SUM) continue;
+            pairSlot++;
+            if (pairSlot >= MAX_PAIR_SUMS_PER_EQUATION)
+                throw std::runtime_error("At most " + std::to_string(MAX_PAIR_SUMS_PER_EQUATION) + " nsum()/ncount()/nmean() terms per pass");
+            radii += (radii.empty() ? "" : ", ") + FloatLiteral(token.pair_radius);
+            reductions += (reductions.empty() ? "" : ", ") + std::to_string(static_cast<int>(token.pair_reduction));
+            radius = std::max(radius, token.pair_radius);
+            if (token.pair_reduction == PAIR_REDUCE_COUNT) continue;
+
+            std::vector<int> bodyTokens;
+            std::vector<float> bodyConstants;
+            std::unordered_map<float, int> bodyConstantMap;
+            serializeTokensToGPU(token.pair_expr_tokens, bodyTokens, bodyConstants, bodyConstantMap);
+            std::string function = "passPairBody" + std::to_string(pairSlot);
+            std::string code = EquationCodegen::GeneratePairBodyFunction(bodyTokens, bodyConstants, function);
+            if (code.empty()) throw std::runtime_error("A neighbour reduction of field '" + name + "' cannot be compiled to GLSL");
+            bodies += code;
+            bodyDispatch += "    if (slot == " + std::to_string(pairSlot) + ") return " + function + "(COMPONENT_ARGS, pj, pjIndex);\n";
+        }
+
+        std::vector<int> tokens;
+        std::vector<float> constants;
+        std::unordered_map<float, int> constantMap;
+        serializeTokensToGPU(rpn, tokens, constants, constantMap, &pairSlots);
+        std::string function = "passStatement" + std::to_string(statementCount++);
+        std::string code = EquationCodegen::GenerateExpressionFunction(tokens, constants, function);
+        if (code.empty()) throw std::runtime_error("Field '" + name + "' cannot be compiled to GLSL");
+        statements += code;
+        stores += "    pipelineFields[objectIndex * FIELD_COUNT + " + std::to_string(slot) + "] = sanitizeFloat(" +
+                  function + "(COMPONENT_ARGS));\n";
+        written |= 1u << slot;
+    }
+    if (statementCount == 0) throw std::runtime_error("A pass needs at least one 'name = expr' statement");
+
+    std::string size = std::to_string(std::max(pairSlots, 1));
+    if (pairSlots == 0)
+    {
+        radii = "0.0";
+        reductions = "PAIR_REDUCE_SUM";
+    }
+    return std::string(EquationCodegen::BLOCK_BEGIN_MARKER) + "\n" +
+        "const int PASS_PAIR_SUMS = " + std::to_string(pairSlots) + ";\n" +
+        "const float PASS_PAIR_RADIUS[" + size + "] = float[" + size + "](" + radii + ");\n" +
+        "const int PASS_PAIR_REDUCTION[" + size + "] = int[" + size + "](" + reductions + ");\n\n" +
+        bodies +
+        "float passPairBody(int slot, COMPONENT_PARAMS, Object pj, int pjIndex) {\n" + bodyDispatch + "    return 0.0;\n}\n\n" +
+        statements +
+        "void passStatements(COMPONENT_PARAMS) {\n" + stores + "}\n" +
+        EquationCodegen::BLOCK_END_MARKER;
+}
+
+static GLuint CompilePass(const std::string& block, std::string& error)
+{
+    if (g_templateSource.empty())
+    {
+        std::string hash;
+        if (!LoadShaderSource("object_pipeline.comp", g_templateSource, hash))
+        {
+            error = "object_pipeline.comp not found";
+            return 0;
+        }
+    }
+
+    std::string source = EquationCodegen::SpliceEquationBlock(g_templateSource, block);
+    if (source.empty())
+    {
+        error = "object_pipeline.comp has no pass block";
+        return 0;
+    }
+
+    GLuint program = CreateComputeProgram(source.c_str());
+    if (program == 0) error = "The pass shader failed to compile";
+    return program;
+}
+
+// ============================================================================
+// Initialize the field buffer and its buffer texture (programs follow Set)
+// ============================================================================
+bool ObjectPipeline::Init(int maxObjects)
+{
+    return Reserve(maxObjects);
+}
+
+bool ObjectPipeline::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+
+    bool grown = BufferHelpers::EnsureBufferCapacity(g_fieldsBuffer, static_cast<GLsizeiptr>(maxObjects) * ROW_SIZE);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // A grown buffer is a new buffer object, so the texture is re-attached
+    if (g_fieldsTexture == 0) glGenTextures(1, &g_fieldsTexture);
+    if (grown)
+    {
+        glBindTexture(GL_TEXTURE_BUFFER, g_fieldsTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, g_fieldsBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectPipeline] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Passes
+// ============================================================================
+bool ObjectPipeline::Set(const std::vector<std::string>& passes, std::string& error)
+{
+    if (passes.empty())
+    {
+        error = "A pipeline needs at least one pass";
+        return false;
+    }
+    if (passes.size() > static_cast<size_t>(MAX_PIPELINE_PASSES))
+    {
+        error = "At most " + std::to_string(MAX_PIPELINE_PASSES) + " pipeline passes";
+        return false;
+    }
+
+    std::vector<PipelinePass> compiled;
+    unsigned written = 0;
+    for (size_t p = 0; p < passes.size(); p++)
+    {
+        PipelinePass pass;
+        std::string block;
+        try
+        {
+            block = GeneratePass(passes[p], written, pass.radius);
+        }
+        catch (const std::exception& e)
+        {
+            error = "Pass " + std::to_string(p) + ": " + e.what();
+            DeletePasses(compiled);
+            return false;
+        }
+
+        pass.program = CompilePass(block, error);
+        if (pass.program == 0)
+        {
+            error = "Pass " + std::to_string(p) + ": " + error;
+            DeletePasses(compiled);
+            return false;
+        }
+        pass.numObjectsLoc = glGetUniformLocation(pass.program, "uNumObjects");
+        pass.gridTableSizeLoc = glGetUniformLocation(pass.program, "uGridTableSize");
+        pass.cellSizeLoc = glGetUniformLocation(pass.program, "uNeighbourCellSize");
+        compiled.push_back(pass);
+    }
+
+    DeletePasses(g_passes);
+    g_passes = std::move(compiled);
+    g_writtenFields = written;
+    ClearFields();  // Fields of the old pipeline mean nothing to the new one
+    return true;
+}
+
+void ObjectPipeline::Clear()
+{
+    DeletePasses(g_passes);
+    g_writtenFields = 0;
+    ClearFields();
+}
+
+bool ObjectPipeline::IsActive()
+{
+    return !g_passes.empty();
+}
+
+// ============================================================================
+// Every pass in order, each over every object
+// ============================================================================
+bool ObjectPipeline::Run(GLuint objectSSBO, GLuint collisionPropsSSBO, int numObjects)
+{
+    if (g_passes.empty() || g_fieldsBuffer == 0 || numObjects <= 0 || numObjects > g_maxObjects) return false;
+
+    GLuint groups = (static_cast<GLuint>(numObjects) + PIPELINE_WORK_GROUP_SIZE - 1) / PIPELINE_WORK_GROUP_SIZE;
+    float gridCellSize = 0.0f;  // Objects do not move between passes, so one grid serves every pass its size fits
+    for (const PipelinePass& pass : g_passes)
+    {
+        if (pass.radius > 0.0f && pass.radius != gridCellSize)
+        {
+            if (!Broadphase::BuildNeighbourGrid(objectSSBO, collisionPropsSSBO, numObjects, pass.radius, false, true))
+                return false;
+            gridCellSize = pass.radius;
+        }
+
+        glUseProgram(pass.program);
+        if (pass.numObjectsLoc != -1) glUniform1i(pass.numObjectsLoc, numObjects);
+        if (pass.gridTableSizeLoc != -1) glUniform1ui(pass.gridTableSizeLoc, Broadphase::GetGridTableSize());
+        if (pass.cellSizeLoc != -1) glUniform1f(pass.cellSizeLoc, pass.radius > 0.0f ? gridCellSize : 0.0f);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PIPELINE_FIELDS_BINDING, g_fieldsBuffer);
+        if (pass.radius > 0.0f) Broadphase::BindNeighbourGrid();
+
+        glDispatchCompute(groups, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+
+    Broadphase::UnbindNeighbourGrid();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PIPELINE_FIELDS_BINDING, 0);
+    glUseProgram(0);
+    return true;
+}
+
+void ObjectPipeline::Bind()
+{
+    glActiveTexture(GL_TEXTURE0 + OBJECT_PIPELINE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_fieldsTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// ============================================================================
+// Readback
+// ============================================================================
+bool ObjectPipeline::GetValues(const std::string& name, int numObjects, std::vector<float>& values)
+{
+    int slot = findPipelineFieldSlot(name);
+    if (slot < 0 || !(g_writtenFields & (1u << slot)) || g_fieldsBuffer == 0) return false;
+
+    numObjects = std::min(numObjects, g_maxObjects);
+    values.assign(std::max(numObjects, 0), 0.0f);
+    if (numObjects <= 0) return true;
+
+    std::vector<float> rows(static_cast<size_t>(numObjects) * PIPELINE_FIELD_COUNT);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_fieldsBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(numObjects) * ROW_SIZE, rows.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    for (int i = 0; i < numObjects; i++) values[i] = rows[static_cast<size_t>(i) * PIPELINE_FIELD_COUNT + slot];
+    return true;
+}
+
+// ============================================================================
+// Release the programs, buffer and texture
+// ============================================================================
+void ObjectPipeline::Cleanup()
+{
+    DeletePasses(g_passes);
+    g_writtenFields = 0;
+    if (g_fieldsTexture) glDeleteTextures(1, &g_fieldsTexture);
+    if (g_fieldsBuffer) glDeleteBuffers(1, &g_fieldsBuffer);
+    g_fieldsTexture = 0;
+    g_fieldsBuffer = 0;
+    g_maxObjects = 0;
+    g_templateSource.clear();
+}
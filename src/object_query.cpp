@@ -0,0 +1,204 @@
+#include "object_query.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+static const GLuint OBJECT_QUERY_WORK_GROUP_SIZE = 64;
+static const GLsizeiptr QUERY_RANGES_HEADER_SIZE = 4 * sizeof(GLuint);  // Hit total, padded to 16 bytes
+
+// Buffers
+static GLuint g_shapesSSBO = 0;  // One vec4 per query
+static GLuint g_rangesSSBO = 0;  // Hit total, then (offset, count) per query
+static GLuint g_hitsSSBO = 0;    // Object indices, each query's run at its offset
+static GLuint g_hitCapacity = 0;
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_numObjectsLoc = -1;
+static GLint g_numQueriesLoc = -1;
+static GLint g_shapeLoc = -1;
+static GLint g_cellSizeLoc = -1;
+static GLint g_gridTableSizeLoc = -1;
+static GLint g_hitCapacityLoc = -1;
+
+// ============================================================================
+// Start loading the shader; buffers are sized by the first query
+// ============================================================================
+bool ObjectQuery::Init()
+{
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "object_query.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_numQueriesLoc = glGetUniformLocation(program, "uNumQueries");
+                g_shapeLoc = glGetUniformLocation(program, "uShape");
+                g_cellSizeLoc = glGetUniformLocation(program, "uCellSize");
+                g_gridTableSizeLoc = glGetUniformLocation(program, "uGridTableSize");
+                g_hitCapacityLoc = glGetUniformLocation(program, "uHitCapacity");
+                g_ready = (g_numObjectsLoc != -1 && g_numQueriesLoc != -1 && g_shapeLoc != -1 &&
+                           g_cellSizeLoc != -1 && g_hitCapacityLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ObjectQuery] object_query.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+// ============================================================================
+// Shapes
+// ============================================================================
+float ObjectQuery::GridCellSize(QueryShape shape, const std::vector<glm::vec4>& shapes)
+{
+    float size = 0.0f;
+    for (const glm::vec4& q : shapes)
+    {
+        float extent = (shape == QUERY_RADIUS) ? q.z : std::max(q.z - q.x, q.w - q.y);
+        if (!std::isfinite(extent) || !std::isfinite(q.x) || !std::isfinite(q.y)) return 0.0f;
+        size = std::max(size, extent);
+    }
+    return size;
+}
+
+bool ObjectQuery::Contains(QueryShape shape, const glm::vec4& query, const glm::vec2& position)
+{
+    if (shape == QUERY_RADIUS)
+    {
+        glm::vec2 d = position - glm::vec2(query.x, query.y);
+        return query.z >= 0.0f && glm::dot(d, d) <= query.z * query.z;
+    }
+    return position.x >= query.x && position.y >= query.y && position.x <= query.z && position.y <= query.w;
+}
+
+// ============================================================================
+// Count, claim and write every query's hits in one dispatch
+// ============================================================================
+static void Dispatch(GLuint objectSSBO, int numObjects, int numQueries)
+{
+    const GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_rangesSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glUniform1i(g_numObjectsLoc, numObjects);
+    glUniform1ui(g_hitCapacityLoc, g_hitCapacity);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_QUERY_SHAPES_BINDING, g_shapesSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_QUERY_RANGES_BINDING, g_rangesSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_QUERY_HITS_BINDING, g_hitsSSBO);
+
+    GLuint groups = (static_cast<GLuint>(numQueries) + OBJECT_QUERY_WORK_GROUP_SIZE - 1) / OBJECT_QUERY_WORK_GROUP_SIZE;
+    glDispatchCompute(groups, 1, 1);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+bool ObjectQuery::Query(GLuint objectSSBO, int numObjects, QueryShape shape, const std::vector<glm::vec4>& shapes,
+                        float cellSize, GLuint gridTableSize, std::vector<std::vector<int>>& results)
+{
+    results.assign(shapes.size(), std::vector<int>());
+    if (!g_ready) return false;
+    if (shapes.empty() || numObjects <= 0) return true;
+
+    const int numQueries = static_cast<int>(shapes.size());
+    BufferHelpers::EnsureBufferCapacity(g_shapesSSBO, numQueries * sizeof(glm::vec4));
+    BufferHelpers::EnsureBufferCapacity(g_rangesSSBO, QUERY_RANGES_HEADER_SIZE + numQueries * 2 * sizeof(GLuint));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_shapesSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, numQueries * sizeof(glm::vec4), shapes.data());
+    if (g_hitCapacity == 0)
+    {
+        g_hitCapacity = static_cast<GLuint>(std::max(numQueries, 1024));
+        BufferHelpers::EnsureBufferCapacity(g_hitsSSBO, g_hitCapacity * sizeof(GLuint));
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glUseProgram(g_program);
+    glUniform1i(g_numQueriesLoc, numQueries);
+    glUniform1i(g_shapeLoc, static_cast<int>(shape));
+    glUniform1f(g_cellSizeLoc, gridTableSize > 0 ? cellSize : 0.0f);
+    if (g_gridTableSizeLoc != -1) glUniform1ui(g_gridTableSizeLoc, gridTableSize);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);  // The grid build before us
+    Dispatch(objectSSBO, numObjects, numQueries);
+
+    // Hits past the list are counted but not written; grow it to the total and run again
+    GLuint total = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_rangesSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(total), &total);
+    if (total > g_hitCapacity)
+    {
+        g_hitCapacity = total;
+        BufferHelpers::EnsureBufferCapacity(g_hitsSSBO, g_hitCapacity * sizeof(GLuint));
+        Dispatch(objectSSBO, numObjects, numQueries);
+    }
+
+    std::vector<GLuint> ranges(static_cast<size_t>(numQueries) * 2);
+    std::vector<GLuint> hits(total);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_rangesSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, QUERY_RANGES_HEADER_SIZE, ranges.size() * sizeof(GLuint), ranges.data());
+    if (total > 0)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_hitsSSBO);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, total * sizeof(GLuint), hits.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLuint bindings[] = { 0, OBJECT_QUERY_SHAPES_BINDING, OBJECT_QUERY_RANGES_BINDING, OBJECT_QUERY_HITS_BINDING };
+    for (GLuint binding : bindings) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+    glUseProgram(0);
+
+    // Grid order is not index order
+    for (int q = 0; q < numQueries; q++)
+    {
+        GLuint offset = ranges[2 * q], count = ranges[2 * q + 1];
+        if (offset > total || count > total - offset) continue;
+        results[q].assign(hits.begin() + offset, hits.begin() + offset + count);
+        std::sort(results[q].begin(), results[q].end());
+    }
+    return true;
+}
+
+// ============================================================================
+// Release buffers and the program
+// ============================================================================
+void ObjectQuery::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    GLuint* buffers[] = { &g_shapesSSBO, &g_rangesSSBO, &g_hitsSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_hitCapacity = 0;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ObjectQuery::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool ObjectQuery::IsReady()
+{
+    return g_ready;
+}
+
+std::string ObjectQuery::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[object query] " + g_loader.GetStatusMessage();
+    return "Object query shader ready";
+}
@@ -0,0 +1,234 @@
+#include "object_raycast.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+static const GLuint OBJECT_RAYCAST_WORK_GROUP_SIZE = 64;
+static const float RAY_EPSILON = 1e-6f;  // MUST MATCH EPSILON in object_raycast.comp
+static const float RAY_PI = 3.14159265359f;
+
+// Collision shape types - MUST MATCH CollisionShape in objects.h
+static const int SHAPE_CIRCLE = 1;
+static const int SHAPE_AABB = 2;
+static const int SHAPE_POLYGON = 3;
+
+// Buffers
+static GLuint g_raysSSBO = 0;  // One vec4 per ray
+static GLuint g_hitsSSBO = 0;  // One RayHit per ray
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_numObjectsLoc = -1;
+static GLint g_numRaysLoc = -1;
+static GLint g_maxDistanceLoc = -1;
+static GLint g_useBVHLoc = -1;
+
+// ============================================================================
+// Start loading the shader; buffers are sized by the first cast
+// ============================================================================
+bool ObjectRaycast::Init()
+{
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "object_raycast.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_numRaysLoc = glGetUniformLocation(program, "uNumRays");
+                g_maxDistanceLoc = glGetUniformLocation(program, "uMaxDistance");
+                g_useBVHLoc = glGetUniformLocation(program, "uUseBVH");
+                g_ready = (g_numObjectsLoc != -1 && g_numRaysLoc != -1 && g_maxDistanceLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ObjectRaycast] object_raycast.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+// ============================================================================
+// Shape intersection (host copy of object_raycast.comp)
+// ============================================================================
+static bool RayCircle(const glm::vec2& origin, const glm::vec2& dir, float tMax, const glm::vec2& center,
+                      float radius, float& t, glm::vec2& normal)
+{
+    glm::vec2 m = origin - center;
+    float b = glm::dot(m, dir);
+    float c = glm::dot(m, m) - radius * radius;
+    float disc = b * b - c;
+    if (c <= 0.0f || b > 0.0f || disc < 0.0f) return false;
+    t = -b - std::sqrt(disc);
+    if (t > tMax) return false;
+    normal = glm::normalize(origin + t * dir - center);
+    return true;
+}
+
+static bool RayAABB(const glm::vec2& origin, const glm::vec2& dir, float tMax, const glm::vec2& center,
+                    const glm::vec2& halfExt, float& t, glm::vec2& normal)
+{
+    glm::vec2 lo = center - halfExt, hi = center + halfExt;
+    if (origin.x > lo.x && origin.y > lo.y && origin.x < hi.x && origin.y < hi.y) return false;
+
+    float tEnter = 0.0f, tExit = tMax;
+    normal = glm::vec2(0.0f);
+    for (int axis = 0; axis < 2; axis++)
+    {
+        if (std::abs(dir[axis]) < RAY_EPSILON)
+        {
+            if (origin[axis] < lo[axis] || origin[axis] > hi[axis]) return false;
+            continue;
+        }
+        float t0 = (lo[axis] - origin[axis]) / dir[axis];
+        float t1 = (hi[axis] - origin[axis]) / dir[axis];
+        float side = -1.0f;
+        if (t0 > t1) { std::swap(t0, t1); side = 1.0f; }
+        if (t0 > tEnter)
+        {
+            tEnter = t0;
+            normal = glm::vec2(0.0f);
+            normal[axis] = side;
+        }
+        tExit = std::min(tExit, t1);
+        if (tEnter > tExit) return false;
+    }
+    if (normal == glm::vec2(0.0f)) return false;
+    t = tEnter;
+    return true;
+}
+
+static bool RayPolygon(const glm::vec2& origin, const glm::vec2& dir, float tMax, const glm::vec2& center,
+                       float radius, int sides, float rotation, float& t, glm::vec2& normal)
+{
+    if (sides < 3) return RayCircle(origin, dir, tMax, center, radius, t, normal);
+
+    float angleStep = 2.0f * RAY_PI / static_cast<float>(sides);
+    float tEnter = -1.0f, tExit = tMax;
+    normal = glm::vec2(0.0f);
+    for (int i = 0; i < sides; i++)
+    {
+        float angle = rotation + static_cast<float>(i) * angleStep;
+        glm::vec2 edge = glm::vec2(std::cos(angle + angleStep), std::sin(angle + angleStep)) -
+                         glm::vec2(std::cos(angle), std::sin(angle));
+        glm::vec2 outward = -glm::normalize(glm::vec2(-edge.y, edge.x));
+        glm::vec2 vertex = center + radius * glm::vec2(std::cos(angle), std::sin(angle));
+        float dist = glm::dot(origin - vertex, outward);
+        float denom = glm::dot(dir, outward);
+        if (std::abs(denom) < RAY_EPSILON)
+        {
+            if (dist > 0.0f) return false;
+            continue;
+        }
+        float tEdge = -dist / denom;
+        if (denom < 0.0f)
+        {
+            if (tEdge > tEnter) { tEnter = tEdge; normal = outward; }
+        }
+        else
+        {
+            tExit = std::min(tExit, tEdge);
+        }
+        if (tEnter > tExit) return false;
+    }
+    if (tEnter < 0.0f) return false;
+    t = tEnter;
+    return true;
+}
+
+bool ObjectRaycast::Intersect(const glm::vec2& origin, const glm::vec2& dir, float maxDistance, int shapeType,
+                              const glm::vec2& position, const glm::vec4& visualData, float& t, glm::vec2& normal)
+{
+    switch (shapeType)
+    {
+    case SHAPE_CIRCLE:  return RayCircle(origin, dir, maxDistance, position, visualData.x, t, normal);
+    case SHAPE_AABB:    return RayAABB(origin, dir, maxDistance, position, glm::vec2(visualData) * 0.5f, t, normal);
+    case SHAPE_POLYGON: return RayPolygon(origin, dir, maxDistance, position, visualData.x,
+                                          static_cast<int>(visualData.y), visualData.z, t, normal);
+    default:            return false;
+    }
+}
+
+// ============================================================================
+// Cast every ray in one dispatch
+// ============================================================================
+bool ObjectRaycast::Cast(GLuint objectSSBO, GLuint collisionPropsSSBO, int numObjects, const std::vector<glm::vec4>& rays,
+                         float maxDistance, bool useBVH, std::vector<RayHit>& hits)
+{
+    hits.assign(rays.size(), RayHit{ -1, maxDistance, glm::vec2(0.0f) });
+    if (!g_ready) return false;
+    if (rays.empty() || numObjects <= 0) return true;
+
+    const int numRays = static_cast<int>(rays.size());
+    BufferHelpers::EnsureBufferCapacity(g_raysSSBO, numRays * sizeof(glm::vec4));
+    BufferHelpers::EnsureBufferCapacity(g_hitsSSBO, numRays * sizeof(RayHit));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_raysSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, numRays * sizeof(glm::vec4), rays.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glUseProgram(g_program);
+    glUniform1i(g_numObjectsLoc, numObjects);
+    glUniform1i(g_numRaysLoc, numRays);
+    glUniform1f(g_maxDistanceLoc, maxDistance);
+    if (g_useBVHLoc != -1) glUniform1i(g_useBVHLoc, useBVH ? 1 : 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, collisionPropsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_RAYCAST_RAYS_BINDING, g_raysSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_RAYCAST_HITS_BINDING, g_hitsSSBO);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);  // The BVH build before us
+    GLuint groups = (static_cast<GLuint>(numRays) + OBJECT_RAYCAST_WORK_GROUP_SIZE - 1) / OBJECT_RAYCAST_WORK_GROUP_SIZE;
+    glDispatchCompute(groups, 1, 1);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_hitsSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, numRays * sizeof(RayHit), hits.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLuint bindings[] = { 0, 7, OBJECT_RAYCAST_RAYS_BINDING, OBJECT_RAYCAST_HITS_BINDING };
+    for (GLuint binding : bindings) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+    glUseProgram(0);
+    return true;
+}
+
+// ============================================================================
+// Release buffers and the program
+// ============================================================================
+void ObjectRaycast::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    GLuint* buffers[] = { &g_raysSSBO, &g_hitsSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ObjectRaycast::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool ObjectRaycast::IsReady()
+{
+    return g_ready;
+}
+
+std::string ObjectRaycast::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[object raycast] " + g_loader.GetStatusMessage();
+    return "Object raycast shader ready";
+}
@@ -0,0 +1,171 @@
+#include "object_recorder.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+
+// Buffers
+static GLuint g_indicesSSBO = 0;
+static GLuint g_ringSSBO = 0;
+
+// What is recorded
+static bool g_recording = false;
+static GLuint g_count = 0;
+static unsigned int g_fieldMask = 0;
+static GLuint g_stride = 0;            // Words per object
+static GatherQuantization g_quantization;
+static int g_everyNSteps = 1;
+static int g_capacity = 0;             // Frames in the ring
+static int g_maxIndex = -1;
+
+// Progress; frame f lives in slot f % g_capacity
+static long long g_steps = 0;           // Since Start()
+static int g_stepsSinceFrame = 0;
+static long long g_framesWritten = 0;
+static long long g_framesDownloaded = 0;  // Frames handed out or dropped
+static std::vector<int> g_frameSteps;     // Per slot, kept on the host
+static std::vector<float> g_frameTimes;
+
+static void DeleteBuffers()
+{
+    GLuint* buffers[] = { &g_indicesSSBO, &g_ringSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+}
+
+// ============================================================================
+// Allocate the ring and remember what goes into it
+// ============================================================================
+bool ObjectRecorder::Start(const std::vector<int>& indices, unsigned int fieldMask, int everyNSteps, int capacity,
+                           const GatherQuantization& quantization)
+{
+    Stop();
+
+    GLuint stride = static_cast<GLuint>(ObjectGather::FloatsPerObject(fieldMask));
+    if (indices.empty() || stride == 0 || everyNSteps < 1 || capacity < 1) return false;
+
+    GLsizeiptr frameBytes = static_cast<GLsizeiptr>(indices.size()) * stride * sizeof(uint32_t);
+    BufferHelpers::EnsureBufferCapacity(g_indicesSSBO, static_cast<GLsizeiptr>(indices.size()) * sizeof(GLuint), GL_STATIC_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, indices.size() * sizeof(GLuint), indices.data());
+    BufferHelpers::EnsureBufferCapacity(g_ringSSBO, frameBytes * capacity, GL_STREAM_READ);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectRecorder] Failed to allocate the ring buffer (GL error " << err << ")" << std::endl;
+        DeleteBuffers();
+        return false;
+    }
+
+    g_count = static_cast<GLuint>(indices.size());
+    g_fieldMask = fieldMask;
+    g_quantization = quantization;
+    g_stride = stride;
+    g_everyNSteps = everyNSteps;
+    g_capacity = capacity;
+    g_maxIndex = *std::max_element(indices.begin(), indices.end());
+    g_steps = 0;
+    g_stepsSinceFrame = 0;
+    g_framesWritten = 0;
+    g_framesDownloaded = 0;
+    g_frameSteps.assign(capacity, 0);
+    g_frameTimes.assign(capacity, 0.0f);
+    g_recording = true;
+    return true;
+}
+
+void ObjectRecorder::Stop()
+{
+    g_recording = false;
+    DeleteBuffers();
+    g_frameSteps.clear();
+    g_frameTimes.clear();
+}
+
+void ObjectRecorder::Cleanup()
+{
+    Stop();
+}
+
+bool ObjectRecorder::IsRecording()
+{
+    return g_recording;
+}
+
+// ============================================================================
+// Append a frame once every g_everyNSteps steps; the copy stays on the GPU
+// ============================================================================
+void ObjectRecorder::Capture(GLuint objectSSBO, int numObjects, int steps, float time)
+{
+    if (!g_recording) return;
+
+    g_steps += steps;
+    g_stepsSinceFrame += steps;
+    if (g_stepsSinceFrame < g_everyNSteps) return;
+    g_stepsSinceFrame %= g_everyNSteps;  // Fused substeps can cross several frames; the last state is all there is
+
+    if (g_maxIndex >= numObjects) return;
+
+    int slot = static_cast<int>(g_framesWritten % g_capacity);
+    GLuint offset = static_cast<GLuint>(slot) * g_count * g_stride;
+    if (!ObjectGather::GatherToBuffer(objectSSBO, g_indicesSSBO, g_count, g_fieldMask, g_ringSSBO, offset, &g_quantization)) return;
+
+    g_frameSteps[slot] = static_cast<int>(g_steps);
+    g_frameTimes[slot] = time;
+    g_framesWritten++;
+}
+
+int ObjectRecorder::PendingFrames()
+{
+    if (!g_recording) return 0;
+    return static_cast<int>(std::min<long long>(g_framesWritten - g_framesDownloaded, g_capacity));
+}
+
+// ============================================================================
+// Pending frames -> host, oldest first, in at most two copies (the ring may wrap)
+// ============================================================================
+bool ObjectRecorder::Download(RecordedFrames& out, int newest)
+{
+    if (!g_recording) return false;
+
+    long long pending = g_framesWritten - g_framesDownloaded;
+    int frames = static_cast<int>(std::min<long long>(pending, g_capacity));
+    if (newest > 0) frames = std::min(frames, newest);
+    long long first = g_framesWritten - frames;
+
+    out.frames = frames;
+    out.objects = static_cast<int>(g_count);
+    out.wordsPerObject = static_cast<int>(g_stride);
+    out.fieldMask = g_fieldMask;
+    out.quantization = g_quantization;
+    out.dropped = static_cast<int>(pending - frames);
+    out.words.resize(static_cast<size_t>(frames) * g_count * g_stride);
+    out.steps.resize(frames);
+    out.times.resize(frames);
+    g_framesDownloaded = g_framesWritten;
+    if (frames == 0) return true;
+
+    size_t frameWords = static_cast<size_t>(g_count) * g_stride;
+    int firstSlot = static_cast<int>(first % g_capacity);
+    int head = std::min(frames, g_capacity - firstSlot);  // Frames before the wrap
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_ringSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, firstSlot * frameWords * sizeof(uint32_t),
+                       head * frameWords * sizeof(uint32_t), out.words.data());
+    if (head < frames)
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, (frames - head) * frameWords * sizeof(uint32_t),
+                           out.words.data() + head * frameWords);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    for (int f = 0; f < frames; f++)
+    {
+        int slot = (firstSlot + f) % g_capacity;
+        out.steps[f] = g_frameSteps[slot];
+        out.times[f] = g_frameTimes[slot];
+    }
+    return true;
+}
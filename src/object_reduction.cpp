@@ -0,0 +1,356 @@
+#include "object_reduction.h"
+#include "equation_codegen.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include "shader_utils.h"
+#include "utils.h"
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+
+// Reduction passes - MUST MATCH object_reduction.comp
+enum ReductionPass
+{
+    REDUCTION_PASS_OBJECTS = 0,
+    REDUCTION_PASS_PARTIALS = 1,
+    REDUCTION_PASS_WORLDS = 2,
+    REDUCTION_PASS_HISTOGRAM = 3,
+    REDUCTION_PASS_AGGREGATE_OBJECTS = 4,
+    REDUCTION_PASS_AGGREGATE_PARTIALS = 5
+};
+
+static const GLuint REDUCTION_WORK_GROUP_SIZE = 256;
+static const int MAX_WORLD_GROUPS = 65535;  // Guaranteed GL_MAX_COMPUTE_WORK_GROUP_COUNT, per dispatch
+static const size_t MAX_CACHED_PROGRAMS = 32;  // Distinct expressions kept compiled
+static const GLuint MAX_HISTOGRAM_GROUPS = 1024;  // Histogram groups stride over the objects past this
+
+// Buffers
+static GLuint g_partialsSSBO = 0;
+static GLuint g_resultSSBO = 0;
+static GLuint g_histogramSSBO = 0;
+static int g_maxObjects = 0;
+
+// Shader template and one program per expression (0 = failed to compile)
+static std::string g_templateSource;
+static std::unordered_map<std::string, GLuint> g_programs;
+
+static GLuint NumBlocks(GLuint numItems)
+{
+    return (std::max(numItems, 1u) + REDUCTION_WORK_GROUP_SIZE - 1) / REDUCTION_WORK_GROUP_SIZE;
+}
+
+static void DeletePrograms()
+{
+    for (auto& entry : g_programs)
+        if (entry.second) glDeleteProgram(entry.second);
+    g_programs.clear();
+}
+
+// Program for an expression, compiled on first use
+static GLuint GetProgram(const std::string& key, const std::string& expressionFunction, std::string& error)
+{
+    auto it = g_programs.find(key);
+    if (it != g_programs.end())
+    {
+        if (it->second == 0) error = "Reduction shader failed to compile for this expression";
+        return it->second;
+    }
+
+    if (g_templateSource.empty())
+    {
+        std::string hash;
+        if (!LoadShaderSource("object_reduction.comp", g_templateSource, hash))
+        {
+            error = "object_reduction.comp not found";
+            return 0;
+        }
+    }
+
+    std::string block = std::string(EquationCodegen::BLOCK_BEGIN_MARKER) + "\n" + expressionFunction +
+                        EquationCodegen::BLOCK_END_MARKER;
+    std::string source = EquationCodegen::SpliceEquationBlock(g_templateSource, block);
+    if (source.empty())
+    {
+        error = "object_reduction.comp has no expression block";
+        return 0;
+    }
+
+    if (g_programs.size() >= MAX_CACHED_PROGRAMS) DeletePrograms();
+
+    GLuint program = CreateComputeProgram(source.c_str());
+    if (program == 0)
+    {
+        std::cerr << "[ObjectReduction] Failed to compile reduction for: " << key << std::endl;
+        error = "Reduction shader failed to compile for this expression";
+    }
+    g_programs[key] = program;
+    return program;
+}
+
+// ============================================================================
+// Initialize buffers (programs follow on the first query of each expression)
+// ============================================================================
+bool ObjectReduction::Init(int maxObjects)
+{
+    return Reserve(maxObjects);
+}
+
+bool ObjectReduction::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+
+    BufferHelpers::EnsureBufferCapacity(g_partialsSSBO, NumBlocks(static_cast<GLuint>(maxObjects)) * sizeof(float));
+    BufferHelpers::EnsureBufferCapacity(g_resultSSBO, sizeof(float), GL_DYNAMIC_READ);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectReduction] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Per-object expression -> group partials -> one value
+// ============================================================================
+bool ObjectReduction::Reduce(const std::string& key, const std::string& expressionFunction, ReductionOp op,
+                             GLuint objectSSBO, int numObjects, float& result, std::string& error)
+{
+    if (g_partialsSSBO == 0 || g_resultSSBO == 0)
+    {
+        error = "Reduction buffers unavailable";
+        return false;
+    }
+    if (numObjects <= 0 || numObjects > g_maxObjects)
+    {
+        error = "No objects to reduce";
+        return false;
+    }
+
+    GLuint program = GetProgram(key, expressionFunction, error);
+    if (program == 0) return false;
+
+    GLuint groups = NumBlocks(static_cast<GLuint>(numObjects));
+    int shaderOp = (op == REDUCE_MEAN) ? REDUCE_SUM : op;
+
+    glUseProgram(program);
+    GLint passLoc = glGetUniformLocation(program, "uPass");
+    GLint opLoc = glGetUniformLocation(program, "uOp");
+    GLint numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+    GLint numPartialsLoc = glGetUniformLocation(program, "uNumPartials");
+    if (opLoc != -1) glUniform1i(opLoc, shaderOp);
+    if (numObjectsLoc != -1) glUniform1i(numObjectsLoc, numObjects);
+    if (numPartialsLoc != -1) glUniform1ui(numPartialsLoc, groups);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REDUCTION_PARTIALS_BINDING, g_partialsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REDUCTION_RESULT_BINDING, g_resultSSBO);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    glUniform1i(passLoc, REDUCTION_PASS_OBJECTS);
+    glDispatchCompute(groups, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    glUniform1i(passLoc, REDUCTION_PASS_PARTIALS);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REDUCTION_PARTIALS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REDUCTION_RESULT_BINDING, 0);
+    glUseProgram(0);
+
+    // The only readback: one float
+    float value = 0.0f;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_resultSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(float), &value);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    result = (op == REDUCE_MEAN) ? value / static_cast<float>(numObjects) : value;
+    return true;
+}
+
+// ============================================================================
+// One value per ensemble world, each world reduced by one work group
+// ============================================================================
+bool ObjectReduction::ReduceWorlds(const std::string& key, const std::string& expressionFunction, ReductionOp op,
+                                   GLuint objectSSBO, int numObjects, int numWorlds, std::vector<float>& results,
+                                   std::string& error)
+{
+    if (g_partialsSSBO == 0 || g_resultSSBO == 0)
+    {
+        error = "Reduction buffers unavailable";
+        return false;
+    }
+    if (numObjects <= 0 || numObjects > g_maxObjects || numWorlds < 0)
+    {
+        error = "No objects to reduce";
+        return false;
+    }
+
+    GLuint program = GetProgram(key, expressionFunction, error);
+    if (program == 0) return false;
+
+    int resultCount = std::max(numWorlds, 1);
+    BufferHelpers::EnsureBufferCapacity(g_resultSSBO, resultCount * sizeof(float), GL_DYNAMIC_READ);
+
+    glUseProgram(program);
+    GLint passLoc = glGetUniformLocation(program, "uPass");
+    GLint opLoc = glGetUniformLocation(program, "uOp");
+    GLint numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+    GLint numWorldsLoc = glGetUniformLocation(program, "uNumWorlds");
+    GLint firstWorldLoc = glGetUniformLocation(program, "uFirstWorld");
+    GLint meanLoc = glGetUniformLocation(program, "uMean");
+    if (passLoc != -1) glUniform1i(passLoc, REDUCTION_PASS_WORLDS);
+    if (opLoc != -1) glUniform1i(opLoc, (op == REDUCE_MEAN) ? REDUCE_SUM : op);
+    if (numObjectsLoc != -1) glUniform1i(numObjectsLoc, numObjects);
+    if (numWorldsLoc != -1) glUniform1i(numWorldsLoc, numWorlds);
+    if (meanLoc != -1) glUniform1i(meanLoc, op == REDUCE_MEAN ? 1 : 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REDUCTION_RESULT_BINDING, g_resultSSBO);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    for (int first = 0; first < resultCount; first += MAX_WORLD_GROUPS)
+    {
+        if (firstWorldLoc != -1) glUniform1i(firstWorldLoc, first);
+        glDispatchCompute(static_cast<GLuint>(std::min(MAX_WORLD_GROUPS, resultCount - first)), 1, 1);
+    }
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REDUCTION_RESULT_BINDING, 0);
+    glUseProgram(0);
+
+    // One float per world
+    results.resize(resultCount);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_resultSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, resultCount * sizeof(float), results.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return true;
+}
+
+// ============================================================================
+// Bin counts: shared-memory atomics per work group, added to the global counts once per group
+// ============================================================================
+bool ObjectReduction::Histogram(const std::string& key, const std::string& expressionFunctions, GLuint objectSSBO,
+                                int numObjects, int binsX, int binsY, const float range[4],
+                                std::vector<uint32_t>& counts, std::string& error)
+{
+    if (numObjects < 0 || numObjects > g_maxObjects || binsX < 1 || binsY < 1)
+    {
+        error = "Invalid histogram";
+        return false;
+    }
+
+    size_t bins = static_cast<size_t>(binsX) * binsY;
+    counts.assign(bins, 0u);
+    if (numObjects == 0) return true;
+
+    GLuint program = GetProgram(key, expressionFunctions, error);
+    if (program == 0) return false;
+
+    BufferHelpers::EnsureBufferCapacity(g_histogramSSBO, static_cast<GLsizeiptr>(bins * sizeof(uint32_t)), GL_DYNAMIC_READ);
+    GLuint zero = 0;
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, static_cast<GLsizeiptr>(bins * sizeof(uint32_t)),
+                         GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    glUseProgram(program);
+    GLint passLoc = glGetUniformLocation(program, "uPass");
+    GLint numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+    GLint binsLoc = glGetUniformLocation(program, "uHistogramBins");
+    GLint rangeLoc = glGetUniformLocation(program, "uHistogramRange");
+    if (passLoc != -1) glUniform1i(passLoc, REDUCTION_PASS_HISTOGRAM);
+    if (numObjectsLoc != -1) glUniform1i(numObjectsLoc, numObjects);
+    if (binsLoc != -1) glUniform2i(binsLoc, binsX, binsY);
+    if (rangeLoc != -1) glUniform4f(rangeLoc, range[0], range[1], range[2], range[3]);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REDUCTION_RESULT_BINDING, g_histogramSSBO);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    glDispatchCompute(std::min(NumBlocks(static_cast<GLuint>(numObjects)), MAX_HISTOGRAM_GROUPS), 1, 1);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REDUCTION_RESULT_BINDING, 0);
+    glUseProgram(0);
+
+    // The only readback: the counts
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_histogramSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(bins * sizeof(uint32_t)), counts.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return true;
+}
+
+// ============================================================================
+// Group aggregates: (value, members) partials per work group and aggregate -> one group each
+// ============================================================================
+bool ObjectReduction::ReduceAggregates(const std::string& key, const std::string& expressionFunctions, int count,
+                                       const int* ops, const uint32_t* groups, const int* slots, GLuint objectSSBO,
+                                       int numObjects, GLuint resultBuffer, std::string& error)
+{
+    if (g_partialsSSBO == 0 || numObjects < 0 || numObjects > g_maxObjects || count < 1 || count > MAX_REDUCED_AGGREGATES)
+    {
+        error = "Invalid aggregates";
+        return false;
+    }
+
+    GLuint program = GetProgram(key, expressionFunctions, error);
+    if (program == 0) return false;
+
+    GLuint blocks = NumBlocks(static_cast<GLuint>(numObjects));
+    BufferHelpers::EnsureBufferCapacity(g_partialsSSBO, static_cast<GLsizeiptr>(blocks) * count * 2 * sizeof(float));
+
+    glUseProgram(program);
+    GLint passLoc = glGetUniformLocation(program, "uPass");
+    GLint numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+    GLint numPartialsLoc = glGetUniformLocation(program, "uNumPartials");
+    GLint countLoc = glGetUniformLocation(program, "uAggregateCount");
+    GLint opsLoc = glGetUniformLocation(program, "uAggregateOps");
+    GLint groupsLoc = glGetUniformLocation(program, "uAggregateGroups");
+    GLint slotsLoc = glGetUniformLocation(program, "uAggregateSlots");
+    if (numObjectsLoc != -1) glUniform1i(numObjectsLoc, numObjects);
+    if (numPartialsLoc != -1) glUniform1ui(numPartialsLoc, blocks);
+    if (countLoc != -1) glUniform1i(countLoc, count);
+    if (opsLoc != -1) glUniform1iv(opsLoc, count, ops);
+    if (groupsLoc != -1) glUniform1uiv(groupsLoc, count, groups);
+    if (slotsLoc != -1) glUniform1iv(slotsLoc, count, slots);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REDUCTION_PARTIALS_BINDING, g_partialsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REDUCTION_RESULT_BINDING, resultBuffer);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    glUniform1i(passLoc, REDUCTION_PASS_AGGREGATE_OBJECTS);
+    glDispatchCompute(blocks, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    glUniform1i(passLoc, REDUCTION_PASS_AGGREGATE_PARTIALS);
+    glDispatchCompute(static_cast<GLuint>(count), 1, 1);
+    glMemoryBarrier(GL_UNIFORM_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REDUCTION_PARTIALS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REDUCTION_RESULT_BINDING, 0);
+    glUseProgram(0);
+    return true;
+}
+
+// ============================================================================
+// Release buffers and programs
+// ============================================================================
+void ObjectReduction::Cleanup()
+{
+    DeletePrograms();
+    g_templateSource.clear();
+
+    GLuint* buffers[] = { &g_partialsSSBO, &g_resultSSBO, &g_histogramSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_maxObjects = 0;
+}
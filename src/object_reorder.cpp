@@ -0,0 +1,218 @@
+#include "object_reorder.h"
+#include "object_gather.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+static const GLuint REORDER_WORK_GROUP_SIZE = 256;
+static const GLuint MAX_REORDER_GROUPS = 65535;  // Per dispatch; larger buffers take several
+
+// Buffers
+static GLuint g_orderSSBO = 0;
+static GLuint g_scratchSSBO = 0;  // Copy of the buffer being permuted, grown on demand
+static int g_maxObjects = 0;
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_countLoc = -1;
+static GLint g_rowWordsLoc = -1;
+static GLint g_firstWordLoc = -1;
+
+// 16 bits of v spread to the even bits of a word
+static uint32_t SpreadBits(uint32_t v)
+{
+    v &= 0xFFFFu;
+    v = (v | (v << 8)) & 0x00FF00FFu;
+    v = (v | (v << 4)) & 0x0F0F0F0Fu;
+    v = (v | (v << 2)) & 0x33333333u;
+    v = (v | (v << 1)) & 0x55555555u;
+    return v;
+}
+
+// ============================================================================
+// Initialize the order buffer and start loading the shader
+// ============================================================================
+bool ObjectReorder::Init(int maxObjects)
+{
+    if (!Reserve(maxObjects)) return false;
+
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "object_reorder.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_countLoc = glGetUniformLocation(program, "uCount");
+                g_rowWordsLoc = glGetUniformLocation(program, "uRowWords");
+                g_firstWordLoc = glGetUniformLocation(program, "uFirstWord");
+                g_ready = (g_countLoc != -1 && g_rowWordsLoc != -1 && g_firstWordLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ObjectReorder] object_reorder.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+bool ObjectReorder::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+
+    BufferHelpers::EnsureBufferCapacity(g_orderSSBO, static_cast<GLsizeiptr>(maxObjects) * sizeof(GLuint), GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectReorder] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Positions -> Morton codes over their bounding box -> sorted order
+// ============================================================================
+bool ObjectReorder::BuildSpatialOrder(GLuint objectSSBO, int numObjects, std::vector<int>& order)
+{
+    if (!g_ready || numObjects < 2 || numObjects > g_maxObjects) return false;
+
+    std::vector<int> indices(numObjects);
+    for (int i = 0; i < numObjects; i++) indices[i] = i;
+    std::vector<float> positions;
+    if (!ObjectGather::Gather(objectSSBO, indices, OBJECT_FIELD_POSITION, positions)) return false;
+
+    float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+    for (int i = 0; i < numObjects; i++)
+    {
+        float x = positions[2 * i], y = positions[2 * i + 1];
+        if (!std::isfinite(x) || !std::isfinite(y)) continue;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+    }
+    if (minX > maxX) return false;  // Nothing finite to sort by
+
+    // One square cell size for both axes, so the curve does not stretch along the longer side
+    float extent = std::max(std::max(maxX - minX, maxY - minY), 1e-6f);
+    float scale = 65535.0f / extent;
+
+    // (code, index) pairs: equal codes keep their index order, invalid positions go last
+    std::vector<uint64_t> keys(numObjects);
+    for (int i = 0; i < numObjects; i++)
+    {
+        float x = positions[2 * i], y = positions[2 * i + 1];
+        uint64_t code = 0xFFFFFFFFull;
+        if (std::isfinite(x) && std::isfinite(y))
+        {
+            uint32_t cx = static_cast<uint32_t>(std::min((x - minX) * scale, 65535.0f));
+            uint32_t cy = static_cast<uint32_t>(std::min((y - minY) * scale, 65535.0f));
+            code = SpreadBits(cx) | (SpreadBits(cy) << 1);
+        }
+        keys[i] = (code << 32) | static_cast<uint32_t>(i);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    bool sorted = true;
+    for (int i = 0; i < numObjects && sorted; i++) sorted = static_cast<int>(keys[i] & 0xFFFFFFFFu) == i;
+    if (sorted) return false;
+
+    order.resize(numObjects);
+    for (int i = 0; i < numObjects; i++) order[i] = static_cast<int>(keys[i] & 0xFFFFFFFFu);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_orderSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, numObjects * sizeof(GLuint), order.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return true;
+}
+
+// ============================================================================
+// Gather the rows of a copy back into the buffer in the new order
+// ============================================================================
+void ObjectReorder::Permute(GLuint buffer, GLsizeiptr rowBytes, int count)
+{
+    if (!g_ready || buffer == 0 || count <= 0 || rowBytes <= 0) return;
+
+    GLsizeiptr bytes = rowBytes * count;
+    BufferHelpers::EnsureBufferCapacity(g_scratchSSBO, bytes);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);  // Shader writes of the rows being copied
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, g_scratchSSBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLuint rowWords = static_cast<GLuint>(rowBytes / sizeof(GLuint));
+    GLuint words = rowWords * static_cast<GLuint>(count);
+    glUseProgram(g_program);
+    glUniform1ui(g_countLoc, static_cast<GLuint>(count));
+    glUniform1ui(g_rowWordsLoc, rowWords);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, g_scratchSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REORDER_ORDER_BINDING, g_orderSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REORDER_DESTINATION_BINDING, buffer);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    const GLuint wordsPerDispatch = MAX_REORDER_GROUPS * REORDER_WORK_GROUP_SIZE;
+    for (GLuint first = 0; first < words; first += wordsPerDispatch)
+    {
+        GLuint chunk = std::min(words - first, wordsPerDispatch);
+        glUniform1ui(g_firstWordLoc, first);
+        glDispatchCompute((chunk + REORDER_WORK_GROUP_SIZE - 1) / REORDER_WORK_GROUP_SIZE, 1, 1);
+    }
+
+    // The buffer is read as an SSBO, a buffer texture, an image or vertex data afterwards
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT |
+                    GL_BUFFER_UPDATE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REORDER_ORDER_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REORDER_DESTINATION_BINDING, 0);
+    glUseProgram(0);
+}
+
+// ============================================================================
+// Release buffers and the program
+// ============================================================================
+void ObjectReorder::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    GLuint* buffers[] = { &g_orderSSBO, &g_scratchSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_maxObjects = 0;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ObjectReorder::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool ObjectReorder::IsReady()
+{
+    return g_ready && ObjectGather::IsReady();
+}
+
+std::string ObjectReorder::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[object reorder] " + g_loader.GetStatusMessage();
+    return "Object reorder shader ready";
+}
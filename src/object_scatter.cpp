@@ -0,0 +1,123 @@
+#include "object_scatter.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+
+static const GLuint SCATTER_WORK_GROUP_SIZE = 256;
+
+// Buffers
+static GLuint g_writesSSBO = 0;
+static int g_maxObjects = 0;
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_countLoc = -1;
+
+// ============================================================================
+// Initialize the staging buffer and start loading the shader
+// ============================================================================
+bool ObjectScatter::Init(int maxObjects)
+{
+    if (!Reserve(maxObjects)) return false;
+
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "object_scatter.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_countLoc = glGetUniformLocation(program, "uCount");
+                g_ready = (g_countLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ObjectScatter] object_scatter.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+bool ObjectScatter::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+
+    BufferHelpers::EnsureBufferCapacity(g_writesSSBO, static_cast<GLsizeiptr>(maxObjects) * sizeof(ObjectWrite), GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectScatter] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Queued writes -> both object buffers, one upload and one dispatch
+// ============================================================================
+bool ObjectScatter::Scatter(GLuint currentSSBO, GLuint otherSSBO, const std::vector<ObjectWrite>& writes)
+{
+    if (!g_ready || g_writesSSBO == 0) return false;
+    if (writes.size() > static_cast<size_t>(g_maxObjects)) return false;
+    if (writes.empty()) return true;
+
+    GLuint count = static_cast<GLuint>(writes.size());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_writesSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(ObjectWrite), writes.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glUseProgram(g_program);
+    glUniform1ui(g_countLoc, count);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, currentSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, otherSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCATTER_WRITES_BINDING, g_writesSSBO);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    glDispatchCompute((count + SCATTER_WORK_GROUP_SIZE - 1) / SCATTER_WORK_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCATTER_WRITES_BINDING, 0);
+    glUseProgram(0);
+    return true;
+}
+
+// ============================================================================
+// Release the buffer and the program
+// ============================================================================
+void ObjectScatter::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    if (g_writesSSBO) glDeleteBuffers(1, &g_writesSSBO);
+    g_writesSSBO = 0;
+    g_maxObjects = 0;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ObjectScatter::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool ObjectScatter::IsReady()
+{
+    return g_ready;
+}
+
+std::string ObjectScatter::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[object scatter] " + g_loader.GetStatusMessage();
+    return "Object scatter shader ready";
+}
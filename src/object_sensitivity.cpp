@@ -0,0 +1,176 @@
+#include "object_sensitivity.h"
+#include "buffer_helpers.h"
+#include "object_reorder.h"
+#include "objects.h"
+#include "gpu_serializer.h"
+#include <algorithm>
+#include <iostream>
+
+static const int ROW_TEXELS = MAX_SENSITIVITY_PARAMETERS * SENSITIVITY_TEXELS;
+static const GLsizeiptr ROW_SIZE = ROW_TEXELS * 4 * sizeof(float);
+
+// Buffer and the rgba32f buffer texture math.comp binds as an image
+static GLuint g_sensitivityBuffer = 0;
+static GLuint g_sensitivityTexture = 0;
+static int g_maxObjects = 0;
+static std::vector<int> g_parameters;
+
+// Host edits land after the steps already submitted have stored their rows
+static void WaitForShaderWrites()
+{
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+// ============================================================================
+// Initialize the buffer and its buffer texture
+// ============================================================================
+bool ObjectSensitivity::Init(int maxObjects)
+{
+    return Reserve(maxObjects);
+}
+
+bool ObjectSensitivity::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    if (g_sensitivityBuffer) WaitForShaderWrites();  // The rows are copied into the grown buffer
+    g_maxObjects = maxObjects;
+
+    // Zeroes the new rows: an object starts out independent of every parameter
+    bool grown = BufferHelpers::EnsureBufferCapacity(g_sensitivityBuffer, static_cast<GLsizeiptr>(maxObjects) * ROW_SIZE);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // A grown buffer is a new buffer object, so the texture is re-attached
+    if (g_sensitivityTexture == 0) glGenTextures(1, &g_sensitivityTexture);
+    if (grown)
+    {
+        glBindTexture(GL_TEXTURE_BUFFER, g_sensitivityTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, g_sensitivityBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectSensitivity] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Parameters
+// ============================================================================
+int ObjectSensitivity::ParameterHash(const std::string& name)
+{
+    using namespace VariableHashes;
+    auto it = s_variableHashMap.find(name);
+    if (it == s_variableHashMap.end()) return -1;
+
+    // Constants of a run: globals, per-world rows and per-object slots; state and random draws are not
+    int hash = it->second;
+    bool parameter = (hash >= VAR_HASH_PARAM_0 && hash <= VAR_HASH_PARAM_7) ||
+                     hash == VAR_HASH_K || hash == VAR_HASH_B_DAMP || hash == VAR_HASH_G_GRAV ||
+                     hash == VAR_HASH_COUPLING || hash == VAR_HASH_FREQ || hash == VAR_HASH_AMP ||
+                     hash == VAR_HASH_MASS || hash == VAR_HASH_CHARGE;
+    return parameter ? hash : -1;
+}
+
+void ObjectSensitivity::SetParameters(const std::vector<int>& varHashes)
+{
+    g_parameters.assign(varHashes.begin(), varHashes.begin() + std::min<size_t>(varHashes.size(), MAX_SENSITIVITY_PARAMETERS));
+}
+
+const std::vector<int>& ObjectSensitivity::GetParameters()
+{
+    return g_parameters;
+}
+
+int ObjectSensitivity::GetCount()
+{
+    return g_sensitivityTexture ? static_cast<int>(g_parameters.size()) : 0;
+}
+
+// ============================================================================
+// Host edits and reads
+// ============================================================================
+void ObjectSensitivity::Get(int count, std::vector<float>& out)
+{
+    int parameters = static_cast<int>(g_parameters.size());
+    count = std::max(0, std::min(count, g_maxObjects));
+    out.assign(static_cast<size_t>(count) * parameters * 4, 0.0f);
+    if (count == 0 || parameters == 0) return;
+
+    WaitForShaderWrites();
+    std::vector<float> rows(static_cast<size_t>(count) * ROW_TEXELS * 4);
+    glBindBuffer(GL_TEXTURE_BUFFER, g_sensitivityBuffer);
+    glGetBufferSubData(GL_TEXTURE_BUFFER, 0, count * ROW_SIZE, rows.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // Only the current tangent of each parameter, the RK4 texels are scratch
+    for (int i = 0; i < count; i++)
+        for (int k = 0; k < parameters; k++)
+            std::copy_n(&rows[(static_cast<size_t>(i) * ROW_TEXELS + k * SENSITIVITY_TEXELS) * 4], 4,
+                        &out[(static_cast<size_t>(i) * parameters + k) * 4]);
+}
+
+void ObjectSensitivity::Clear(int first, int count)
+{
+    first = std::max(first, 0);
+    count = std::min(count, g_maxObjects - first);
+    if (count <= 0) return;
+
+    WaitForShaderWrites();
+    float zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    glBindBuffer(GL_TEXTURE_BUFFER, g_sensitivityBuffer);
+    glClearBufferSubData(GL_TEXTURE_BUFFER, GL_RGBA32F, first * ROW_SIZE, count * ROW_SIZE, GL_RGBA, GL_FLOAT, zero);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ObjectSensitivity::Move(int to, int from)
+{
+    if (to == from || to < 0 || from < 0 || to >= g_maxObjects || from >= g_maxObjects) return;
+
+    WaitForShaderWrites();
+    glBindBuffer(GL_COPY_READ_BUFFER, g_sensitivityBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, g_sensitivityBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from * ROW_SIZE, to * ROW_SIZE, ROW_SIZE);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    Clear(from);
+}
+
+void ObjectSensitivity::Permute(int count)
+{
+    count = std::min(count, g_maxObjects);
+    if (count <= 0) return;
+    WaitForShaderWrites();
+    ObjectReorder::Permute(g_sensitivityBuffer, ROW_SIZE, count);
+}
+
+// ============================================================================
+// Per step
+// ============================================================================
+void ObjectSensitivity::Bind()
+{
+    if (g_sensitivityTexture == 0) return;
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);  // Rows the previous step stored
+    glBindImageTexture(SENSITIVITY_IMAGE_UNIT, g_sensitivityTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+}
+
+void ObjectSensitivity::Unbind()
+{
+    glBindImageTexture(SENSITIVITY_IMAGE_UNIT, 0, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+}
+
+// ============================================================================
+// Release the buffer and texture
+// ============================================================================
+void ObjectSensitivity::Cleanup()
+{
+    if (g_sensitivityTexture) glDeleteTextures(1, &g_sensitivityTexture);
+    if (g_sensitivityBuffer) glDeleteBuffers(1, &g_sensitivityBuffer);
+    g_sensitivityTexture = 0;
+    g_sensitivityBuffer = 0;
+    g_maxObjects = 0;
+    g_parameters.clear();
+}
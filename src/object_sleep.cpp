@@ -0,0 +1,286 @@
+#include "object_sleep.h"
+#include "dispatch_order.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+
+// Update passes - MUST MATCH object_sleep.comp
+enum SleepPass
+{
+    SLEEP_PASS_CLEAR = 0,
+    SLEEP_PASS_UPDATE = 1,
+    SLEEP_PASS_ARGS = 2
+};
+
+static const GLuint SLEEP_WORK_GROUP_SIZE = 256;
+static const GLsizeiptr ACTIVE_SET_HEADER_SIZE = 4 * sizeof(GLuint);  // Dispatch groups xyz, active count
+
+// Buffers
+static GLuint g_activeSetSSBO = 0;      // Indirect dispatch arguments, active count, awake object indices
+static GLuint g_sleepCountersSSBO = 0;  // Consecutive still steps per object
+static int g_maxObjects = 0;
+static int g_activeSetObjects = -1;     // Object count the active set was built for, -1 = none
+
+// Parameters
+static float g_velocityThreshold = 0.05f;
+static float g_accelerationThreshold = 0.5f;
+static int g_sleepSteps = 30;
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_passLoc = -1;
+static GLint g_numObjectsLoc = -1;
+static GLint g_velocityThresholdLoc = -1;
+static GLint g_accelerationThresholdLoc = -1;
+static GLint g_sleepStepsLoc = -1;
+static GLint g_stepDtLoc = -1;
+static GLint g_useDispatchOrderLoc = -1;
+static GLint g_copyToScratchLoc = -1;
+static GLint g_dispatchLocalSizeLoc = -1;
+
+// Create an SSBO of the given size if it does not exist yet
+static void EnsureBuffer(GLuint& buffer, GLsizeiptr size)
+{
+    BufferHelpers::EnsureBufferCapacity(buffer, size);
+}
+
+static GLuint NumBlocks(GLuint numItems)
+{
+    return (std::max(numItems, 1u) + SLEEP_WORK_GROUP_SIZE - 1) / SLEEP_WORK_GROUP_SIZE;
+}
+
+// Run a single update pass over the given number of items
+static void DispatchPass(int pass, GLuint numItems)
+{
+    glUniform1i(g_passLoc, pass);
+    glDispatchCompute(NumBlocks(numItems), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// ============================================================================
+// Initialize buffers and start loading the update shader
+// ============================================================================
+bool ObjectSleep::Init(int maxObjects)
+{
+    if (!Reserve(maxObjects)) return false;
+
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "object_sleep.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_passLoc = glGetUniformLocation(program, "uPass");
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_velocityThresholdLoc = glGetUniformLocation(program, "uVelocityThreshold");
+                g_accelerationThresholdLoc = glGetUniformLocation(program, "uAccelerationThreshold");
+                g_sleepStepsLoc = glGetUniformLocation(program, "uSleepSteps");
+                g_stepDtLoc = glGetUniformLocation(program, "uStepDt");
+                g_useDispatchOrderLoc = glGetUniformLocation(program, "uUseDispatchOrder");
+                g_copyToScratchLoc = glGetUniformLocation(program, "uCopyToScratch");
+                g_dispatchLocalSizeLoc = glGetUniformLocation(program, "uDispatchLocalSize");
+                g_ready = (g_passLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ObjectSleep] object_sleep.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+bool ObjectSleep::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+    GLsizeiptr objects = static_cast<GLsizeiptr>(maxObjects);
+
+    EnsureBuffer(g_activeSetSSBO, ACTIVE_SET_HEADER_SIZE + objects * sizeof(GLuint));
+    EnsureBuffer(g_sleepCountersSSBO, objects * sizeof(GLuint));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    WakeAll();
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectSleep] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Parameters
+// ============================================================================
+void ObjectSleep::SetParameters(float velocityThreshold, float accelerationThreshold, int steps)
+{
+    g_velocityThreshold = std::max(0.0f, velocityThreshold);
+    g_accelerationThreshold = std::max(0.0f, accelerationThreshold);
+    g_sleepSteps = std::max(1, steps);
+}
+
+float ObjectSleep::GetVelocityThreshold()
+{
+    return g_velocityThreshold;
+}
+
+float ObjectSleep::GetAccelerationThreshold()
+{
+    return g_accelerationThreshold;
+}
+
+int ObjectSleep::GetSleepSteps()
+{
+    return g_sleepSteps;
+}
+
+// ============================================================================
+// Wake everything
+// ============================================================================
+void ObjectSleep::WakeAll()
+{
+    g_activeSetObjects = -1;
+    if (g_sleepCountersSSBO == 0) return;
+
+    GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_sleepCountersSSBO);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ObjectSleep::Freeze(int first, int count)
+{
+    first = std::max(first, 0);
+    count = std::min(count, g_maxObjects - first);
+    if (g_sleepCountersSSBO == 0 || count <= 0) return;
+
+    // Past any uSleepSteps, and contacts only wake objects that a mover touches
+    GLuint frozen = 0xFFFFFFFFu;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_sleepCountersSSBO);
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, first * sizeof(GLuint), count * sizeof(GLuint),
+                         GL_RED_INTEGER, GL_UNSIGNED_INT, &frozen);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+bool ObjectSleep::HasActiveSet(int numObjects)
+{
+    return g_activeSetObjects == numObjects;
+}
+
+// ============================================================================
+// Still-step counters -> rest -> active set
+// ============================================================================
+bool ObjectSleep::Update(GLuint currentSSBO, GLuint previousSSBO, GLuint scratchSSBO, int numObjects,
+                         float stepDt, bool useDispatchOrder, int dispatchLocalSize)
+{
+    if (!g_ready) return false;
+    if (numObjects <= 0 || numObjects > g_maxObjects) return false;
+
+    GLuint objectCount = static_cast<GLuint>(numObjects);
+
+    glUseProgram(g_program);
+    if (g_numObjectsLoc != -1) glUniform1i(g_numObjectsLoc, numObjects);
+    if (g_velocityThresholdLoc != -1) glUniform1f(g_velocityThresholdLoc, g_velocityThreshold);
+    if (g_accelerationThresholdLoc != -1) glUniform1f(g_accelerationThresholdLoc, g_accelerationThreshold);
+    if (g_sleepStepsLoc != -1) glUniform1ui(g_sleepStepsLoc, static_cast<GLuint>(g_sleepSteps));
+    if (g_stepDtLoc != -1) glUniform1f(g_stepDtLoc, stepDt);
+    if (g_useDispatchOrderLoc != -1) glUniform1i(g_useDispatchOrderLoc, useDispatchOrder ? 1 : 0);
+    if (g_copyToScratchLoc != -1) glUniform1i(g_copyToScratchLoc, scratchSSBO != 0 ? 1 : 0);
+    if (g_dispatchLocalSizeLoc != -1) glUniform1ui(g_dispatchLocalSizeLoc, static_cast<GLuint>(std::max(1, dispatchLocalSize)));
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, currentSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, previousSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, scratchSSBO);
+    if (useDispatchOrder) DispatchOrder::Bind();
+    Bind();
+
+    DispatchPass(SLEEP_PASS_CLEAR, 1);
+    DispatchPass(SLEEP_PASS_UPDATE, objectCount);
+    DispatchPass(SLEEP_PASS_ARGS, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+    for (int i = 0; i < 3; i++) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, 0);
+    if (useDispatchOrder) DispatchOrder::Unbind();
+    Unbind();
+    glUseProgram(0);
+
+    g_activeSetObjects = numObjects;
+    return true;
+}
+
+void ObjectSleep::DispatchActive()
+{
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, g_activeSetSSBO);
+    glDispatchComputeIndirect(0);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+}
+
+void ObjectSleep::Bind()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ACTIVE_SET_BINDING, g_activeSetSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SLEEP_COUNTERS_BINDING, g_sleepCountersSSBO);
+}
+
+void ObjectSleep::Unbind()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ACTIVE_SET_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SLEEP_COUNTERS_BINDING, 0);
+}
+
+int ObjectSleep::GetActiveCount()
+{
+    if (g_activeSetObjects < 0 || g_activeSetSSBO == 0) return -1;
+
+    GLuint count = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_activeSetSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 3 * sizeof(GLuint), sizeof(GLuint), &count);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return static_cast<int>(count);
+}
+
+// ============================================================================
+// Release buffers and the update program
+// ============================================================================
+void ObjectSleep::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    GLuint* buffers[] = { &g_activeSetSSBO, &g_sleepCountersSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_maxObjects = 0;
+    g_activeSetObjects = -1;
+
+    g_velocityThreshold = 0.05f;
+    g_accelerationThreshold = 0.5f;
+    g_sleepSteps = 30;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ObjectSleep::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool ObjectSleep::IsReady()
+{
+    return g_ready;
+}
+
+std::string ObjectSleep::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[object sleep] " + g_loader.GetStatusMessage();
+    return "Object sleep shader ready";
+}
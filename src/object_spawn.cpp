@@ -0,0 +1,213 @@
+#include "object_spawn.h"
+#include "objects.h"
+#include "equation_codegen.h"
+#include "embedded_shaders.h"
+#include "gpu_serializer.h"
+#include "parser.h"
+#include "shader_utils.h"
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+static const GLuint SPAWN_OBJECTS_BINDING = 1;   // MUST MATCH object_spawn.comp
+static const GLuint SPAWN_TEMPLATE_BINDING = 2;
+static const GLuint SPAWN_WORK_GROUP_SIZE = 256;
+static const size_t MAX_CACHED_PROGRAMS = 16;  // Distinct expression pairs kept compiled
+
+struct SpawnProgram
+{
+    GLuint program = 0;  // 0 = failed to compile
+    GLint firstLoc = -1, countLoc = -1, distributionLoc = -1, centerLoc = -1;
+    GLint extentLoc = -1, columnsLoc = -1, seedLoc = -1;
+};
+
+// The template object, and one program per (position, velocity) expression pair
+static GLuint g_templateSSBO = 0;
+static std::string g_templateSource;
+static std::unordered_map<std::string, SpawnProgram> g_programs;
+
+static void DeletePrograms()
+{
+    for (auto& entry : g_programs)
+        if (entry.second.program) glDeleteProgram(entry.second.program);
+    g_programs.clear();
+}
+
+// ============================================================================
+// Expressions to GLSL
+// ============================================================================
+
+// Throws for what a spawn cannot evaluate: the object alone, its neighbours and the step
+// inputs do not exist yet. rand()/randn() are drawn per spawned object.
+static void CheckTokens(const std::vector<Token>& tokens)
+{
+    for (const Token& token : tokens)
+    {
+        if (token.type == TOKEN_PAIR_SUM || token.type == TOKEN_OBJECT_REF)
+            throw std::runtime_error("Spawn expressions cannot read other objects");
+        if (token.type == TOKEN_DERIVATIVE) throw std::runtime_error("D() is not supported in spawn expressions");
+        if (token.type == TOKEN_TABLE || token.type == TOKEN_FIELD)
+            throw std::runtime_error("table() and field() are not supported in spawn expressions");
+        if (token.type == TOKEN_VARIABLE)
+        {
+            int varHash = hashVariableName(token.variable);
+            if ((varHash >= VariableHashes::VAR_HASH_GRAV_AX && varHash <= VariableHashes::VAR_HASH_SPH_P) ||
+                (varHash >= VariableHashes::VAR_HASH_STATE_0 && varHash <= VariableHashes::VAR_HASH_FIELD_7))
+                throw std::runtime_error("Spawn expressions cannot read $0..$7, s0..s7, agg[], fld[] or long-range and SPH accelerations");
+        }
+    }
+}
+
+// "#define <define>" and the functions xName and yName of an "x_expr, y_expr" pair; empty for
+// no expression. Throws on error.
+static std::string GeneratePair(const std::string& text, const char* what, const char* define,
+                                const std::string& xName, const std::string& yName)
+{
+    if (text.empty()) return "";
+
+    std::vector<std::vector<Token>> components;
+    {
+        ParserContext context;
+        components = ParseExpressionList(text, context);
+    }
+    if (components.size() != 2 || components[0].empty() || components[1].empty())
+        throw std::runtime_error(std::string("The ") + what + " expression needs two components, 'x_expr, y_expr'");
+
+    std::string code = std::string("#define ") + define + "\n";
+    const std::string* names[] = { &xName, &yName };
+    for (int c = 0; c < 2; c++)
+    {
+        CheckTokens(components[c]);
+        std::vector<int> tokens;
+        std::vector<float> constants;
+        std::unordered_map<float, int> constantMap;
+        serializeTokensToGPU(components[c], tokens, constants, constantMap);
+        std::string function = EquationCodegen::GenerateExpressionFunction(tokens, constants, *names[c]);
+        if (function.empty()) throw std::runtime_error(std::string("The ") + what + " expression cannot be compiled to GLSL");
+        code += function;
+    }
+    return code;
+}
+
+// Program for the expressions of settings, compiled on first use
+static const SpawnProgram* GetProgram(const SpawnSettings& settings, std::string& error)
+{
+    std::string key = settings.positionExpression + "\n" + settings.velocityExpression;
+    auto it = g_programs.find(key);
+    if (it != g_programs.end())
+    {
+        if (it->second.program == 0) error = "The spawn shader failed to compile for these expressions";
+        return it->second.program ? &it->second : nullptr;
+    }
+
+    std::string block;
+    try
+    {
+        block = std::string(EquationCodegen::BLOCK_BEGIN_MARKER) + "\n" +
+                GeneratePair(settings.positionExpression, "position", "SPAWN_POSITION", "spawnX", "spawnY") +
+                GeneratePair(settings.velocityExpression, "velocity", "SPAWN_VELOCITY", "spawnVX", "spawnVY") +
+                EquationCodegen::BLOCK_END_MARKER;
+    }
+    catch (const std::exception& e)
+    {
+        error = std::string("Spawn expression failed: ") + e.what();
+        return nullptr;
+    }
+
+    if (g_templateSource.empty())
+    {
+        std::string hash;
+        if (!LoadShaderSource("object_spawn.comp", g_templateSource, hash))
+        {
+            error = "object_spawn.comp not found";
+            return nullptr;
+        }
+    }
+    std::string source = EquationCodegen::SpliceEquationBlock(g_templateSource, block);
+    if (source.empty())
+    {
+        error = "object_spawn.comp has no expression block";
+        return nullptr;
+    }
+
+    if (g_programs.size() >= MAX_CACHED_PROGRAMS) DeletePrograms();
+
+    SpawnProgram entry;
+    entry.program = CreateComputeProgram(source.c_str());
+    if (entry.program == 0)
+    {
+        std::cerr << "[ObjectSpawn] Failed to compile the spawn pass for: " << key << std::endl;
+        error = "The spawn shader failed to compile for these expressions";
+    }
+    else
+    {
+        entry.firstLoc = glGetUniformLocation(entry.program, "uFirst");
+        entry.countLoc = glGetUniformLocation(entry.program, "uCount");
+        entry.distributionLoc = glGetUniformLocation(entry.program, "uDistribution");
+        entry.centerLoc = glGetUniformLocation(entry.program, "uCenter");
+        entry.extentLoc = glGetUniformLocation(entry.program, "uExtent");
+        entry.columnsLoc = glGetUniformLocation(entry.program, "uColumns");
+        entry.seedLoc = glGetUniformLocation(entry.program, "uSeed");
+    }
+    SpawnProgram& stored = g_programs[key] = entry;
+    return stored.program ? &stored : nullptr;
+}
+
+// ============================================================================
+// One pass per target buffer
+// ============================================================================
+bool ObjectSpawn::Spawn(const GLuint* targets, int targetCount, int first, int count, const Object& templateObject,
+                        const SpawnSettings& settings, std::string& error)
+{
+    if (count <= 0) return true;
+    const SpawnProgram* pass = GetProgram(settings, error);
+    if (!pass) return false;
+
+    if (g_templateSSBO == 0) glGenBuffers(1, &g_templateSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_templateSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Object), &templateObject, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // As square a lattice as the count allows, unless the columns were given
+    int columns = settings.columns;
+    if (columns <= 0)
+    {
+        columns = 1;
+        while (columns * columns < count) columns++;
+    }
+
+    glUseProgram(pass->program);
+    glUniform1i(pass->firstLoc, first);
+    glUniform1i(pass->countLoc, count);
+    glUniform1i(pass->distributionLoc, static_cast<int>(settings.distribution));
+    glUniform2f(pass->centerLoc, settings.center[0], settings.center[1]);
+    glUniform1f(pass->extentLoc, settings.extent);
+    glUniform1i(pass->columnsLoc, columns);
+    glUniform1ui(pass->seedLoc, settings.seed);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPAWN_TEMPLATE_BINDING, g_templateSSBO);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    GLuint groups = (static_cast<GLuint>(count) + SPAWN_WORK_GROUP_SIZE - 1) / SPAWN_WORK_GROUP_SIZE;
+    for (int b = 0; b < targetCount; b++)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPAWN_OBJECTS_BINDING, targets[b]);
+        glDispatchCompute(groups, 1, 1);
+    }
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPAWN_OBJECTS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPAWN_TEMPLATE_BINDING, 0);
+    glUseProgram(0);
+    return true;
+}
+
+// ============================================================================
+// Release the template buffer and programs
+// ============================================================================
+void ObjectSpawn::Cleanup()
+{
+    DeletePrograms();
+    g_templateSource.clear();
+    if (g_templateSSBO) glDeleteBuffers(1, &g_templateSSBO);
+    g_templateSSBO = 0;
+}
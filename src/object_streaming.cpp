@@ -0,0 +1,142 @@
+#include "object_streaming.h"
+#include "objects.h"
+#include <iostream>
+#include <vector>
+
+struct StreamSlot
+{
+    GLuint buffer = 0;
+    Object* mapped = nullptr;     // Persistent mapping, or host.data() without buffer storage
+    std::vector<Object> host;
+    GLsync fence = nullptr;       // Behind the copy back into the slot
+};
+
+static StreamSlot g_slots[STREAM_SLOTS];
+static int g_slotObjects = 0;
+
+static void WaitForSlot(StreamSlot& slot)
+{
+    if (!slot.fence) return;
+    GLenum status;
+    do status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+    while (status == GL_TIMEOUT_EXPIRED);
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+}
+
+// ============================================================================
+// One mapped buffer per slot, read and written by both sides in turn
+// ============================================================================
+bool ObjectStreaming::Reserve(int chunkObjects)
+{
+    if (chunkObjects <= g_slotObjects) return true;
+    Cleanup();
+
+    const GLsizeiptr size = static_cast<GLsizeiptr>(chunkObjects) * sizeof(Object);
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    bool mapped = GLAD_GL_VERSION_4_4;
+    for (StreamSlot& slot : g_slots)
+    {
+        if (!mapped) break;
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+        slot.mapped = static_cast<Object*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+        mapped = slot.mapped != nullptr;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (!mapped)
+    {
+        std::cerr << "[ObjectStreaming] Persistent staging buffers unavailable, chunks are not overlapped" << std::endl;
+        for (StreamSlot& slot : g_slots)
+        {
+            if (slot.buffer) glDeleteBuffers(1, &slot.buffer);  // Deleting unmaps
+            slot = StreamSlot{};
+            slot.host.resize(static_cast<size_t>(chunkObjects));
+            slot.mapped = slot.host.data();
+        }
+    }
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectStreaming] Failed to allocate staging buffers (GL error " << err << ")" << std::endl;
+        Cleanup();
+        return false;
+    }
+    g_slotObjects = chunkObjects;
+    return true;
+}
+
+void ObjectStreaming::Cleanup()
+{
+    for (StreamSlot& slot : g_slots)
+    {
+        if (slot.fence) glDeleteSync(slot.fence);
+        if (slot.buffer) glDeleteBuffers(1, &slot.buffer);
+        slot = StreamSlot{};
+    }
+    g_slotObjects = 0;
+}
+
+// ============================================================================
+// A chunk's round trip: fill -> upload -> (steps) -> download -> finish
+// ============================================================================
+Object* ObjectStreaming::BeginFill(int slot)
+{
+    WaitForSlot(g_slots[slot]);
+    return g_slots[slot].mapped;
+}
+
+void ObjectStreaming::Upload(int slot, GLuint objectSSBO, int count)
+{
+    StreamSlot& s = g_slots[slot];
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(count) * sizeof(Object);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);  // The previous chunk's passes read the rows being replaced
+    if (s.buffer)
+    {
+        // Coherent mapping: the packed chunk is visible to copies queued after it was written
+        glBindBuffer(GL_COPY_READ_BUFFER, s.buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, objectSSBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    else
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bytes, s.mapped);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+}
+
+void ObjectStreaming::Download(int slot, GLuint objectSSBO, int count)
+{
+    StreamSlot& s = g_slots[slot];
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(count) * sizeof(Object);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);  // The steps' shader writes
+    if (s.buffer)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, objectSSBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, s.buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();  // Start the chunk while the host fills the next one
+    }
+    else
+    {
+        // The next chunk overwrites the object buffer, so this one is read now
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectSSBO);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bytes, s.mapped);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+}
+
+const Object* ObjectStreaming::Finish(int slot)
+{
+    WaitForSlot(g_slots[slot]);
+    return g_slots[slot].mapped;
+}
@@ -0,0 +1,164 @@
+#include "object_streams.h"
+#include "async_shader_loader.h"
+#include <glm/glm.hpp>
+#include <iostream>
+#include <algorithm>
+
+static const GLuint STREAMS_WORK_GROUP_SIZE = 256;
+
+// Buffers
+static GLuint g_streamsSSBO = 0;  // StreamCount() arrays of g_capacity 16-byte elements
+static int g_capacity = 0;
+static bool g_quantized = false;
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_numObjectsLoc = -1;
+static GLint g_quantizedLoc = -1;
+
+static int StreamCount()
+{
+    return g_quantized ? OBJECT_STREAM_QUANTIZED_COUNT : OBJECT_STREAM_COUNT;
+}
+
+// ============================================================================
+// Initialize the stream buffer and start loading the shader
+// ============================================================================
+bool ObjectStreams::Init(int maxObjects)
+{
+    if (!Reserve(maxObjects)) return false;
+
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "object_streams.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_quantizedLoc = glGetUniformLocation(program, "uQuantized");
+                g_ready = (g_numObjectsLoc != -1 && g_quantizedLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ObjectStreams] object_streams.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+// The shaders take the capacity from the buffer length, so a larger buffer is a new layout;
+// there is nothing to keep, Scatter rewrites every stream before it is read
+bool ObjectStreams::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_capacity) return true;
+    if (g_streamsSSBO) glDeleteBuffers(1, &g_streamsSSBO);
+
+    g_capacity = maxObjects;
+    glGenBuffers(1, &g_streamsSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_streamsSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(StreamCount()) * maxObjects * sizeof(glm::vec4),
+                 nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectStreams] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        g_capacity = 0;
+        return false;
+    }
+    return true;
+}
+
+void ObjectStreams::SetQuantized(bool quantized)
+{
+    if (quantized == g_quantized) return;
+    g_quantized = quantized;
+    if (g_streamsSSBO == 0) return;
+
+    // A new stream count is a new layout at the same capacity
+    int capacity = g_capacity;
+    g_capacity = 0;
+    Reserve(capacity);
+}
+
+bool ObjectStreams::IsQuantized()
+{
+    return g_quantized;
+}
+
+int ObjectStreams::ShaderMode()
+{
+    return g_quantized ? 2 : 1;
+}
+
+// ============================================================================
+// Object buffer -> streams
+// ============================================================================
+bool ObjectStreams::Scatter(GLuint objectSSBO, int numObjects)
+{
+    if (!g_ready || g_streamsSSBO == 0 || numObjects > g_capacity) return false;
+
+    glUseProgram(g_program);
+    glUniform1i(g_numObjectsLoc, numObjects);
+    glUniform1i(g_quantizedLoc, g_quantized ? 1 : 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_STREAMS_BINDING, g_streamsSSBO);
+
+    GLuint groups = (static_cast<GLuint>(std::max(numObjects, 1)) + STREAMS_WORK_GROUP_SIZE - 1) / STREAMS_WORK_GROUP_SIZE;
+    glDispatchCompute(groups, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_STREAMS_BINDING, 0);
+    glUseProgram(0);
+    return true;
+}
+
+void ObjectStreams::Bind()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_STREAMS_BINDING, g_streamsSSBO);
+}
+
+void ObjectStreams::Unbind()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_STREAMS_BINDING, 0);
+}
+
+// ============================================================================
+// Release the buffer and the program
+// ============================================================================
+void ObjectStreams::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    if (g_streamsSSBO) glDeleteBuffers(1, &g_streamsSSBO);
+    g_streamsSSBO = 0;
+    g_capacity = 0;
+    g_quantized = false;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ObjectStreams::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool ObjectStreams::IsReady()
+{
+    return g_ready;
+}
+
+std::string ObjectStreams::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[object streams] " + g_loader.GetStatusMessage();
+    return "Object stream shader ready";
+}
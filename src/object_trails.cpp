@@ -0,0 +1,229 @@
+#include "object_trails.h"
+#include "async_shader_loader.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <iostream>
+
+static const GLuint TRAIL_WORK_GROUP_SIZE = 256;
+
+// History: per tracked object `length` positions, slot g_head the newest
+static GLuint g_historySSBO = 0;
+static GLuint g_vao = 0;     // No attributes, trail.vert reads the history
+static int g_objects = 0;
+static int g_length = 0;
+static int g_head = -1;      // Slot the last Record() wrote
+static int g_filled = 0;     // Slots holding a recorded position
+
+// Async shader loading
+static GLuint g_recordProgram = 0;
+static GLuint g_drawProgram = 0;
+static AsyncShaderLoader g_recordLoader;
+static AsyncShaderLoader g_drawLoader;
+static bool g_recordReady = false;
+static bool g_drawReady = false;
+static GLint g_recordCountLoc = -1, g_recordLengthLoc = -1, g_recordHeadLoc = -1;
+static GLint g_drawProjViewLoc = -1, g_drawLengthLoc = -1, g_drawHeadLoc = -1, g_drawFilledLoc = -1;
+
+// ============================================================================
+// Start loading the shaders; the history is allocated by Configure()
+// ============================================================================
+bool ObjectTrails::Init()
+{
+    if (g_vao == 0) glGenVertexArrays(1, &g_vao);
+
+    if (g_recordProgram == 0)
+    {
+        g_recordLoader.LoadComputeShaderAsync(
+            "object_trail_record.comp",
+            [](GLuint program)
+            {
+                g_recordProgram = program;
+                g_recordCountLoc = glGetUniformLocation(program, "uCount");
+                g_recordLengthLoc = glGetUniformLocation(program, "uLength");
+                g_recordHeadLoc = glGetUniformLocation(program, "uHead");
+                g_recordReady = (g_recordCountLoc != -1 && g_recordLengthLoc != -1 && g_recordHeadLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ObjectTrails] object_trail_record.comp FAILED: " << error << std::endl;
+                g_recordReady = false;
+            });
+    }
+    if (g_drawProgram == 0)
+    {
+        g_drawLoader.LoadGraphicsShaderAsync(
+            "trail.vert",
+            "trail.frag",
+            "",
+            [](GLuint program)
+            {
+                g_drawProgram = program;
+                g_drawProjViewLoc = glGetUniformLocation(program, "uProjView");
+                g_drawLengthLoc = glGetUniformLocation(program, "uLength");
+                g_drawHeadLoc = glGetUniformLocation(program, "uHead");
+                g_drawFilledLoc = glGetUniformLocation(program, "uFilled");
+                g_drawReady = (g_drawProjViewLoc != -1 && g_drawLengthLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ObjectTrails] trail shaders FAILED: " << error << std::endl;
+                g_drawReady = false;
+            });
+    }
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectTrails] Failed to create the vertex array (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Tracked objects and trail length
+// ============================================================================
+bool ObjectTrails::Configure(int objects, int length)
+{
+    if (objects < 0 || length < 2 || length > TRAIL_MAX_LENGTH) return false;
+
+    GLsizeiptr size = static_cast<GLsizeiptr>(objects) * length * sizeof(glm::vec2);
+    if (objects == 0)
+    {
+        if (g_historySSBO) glDeleteBuffers(1, &g_historySSBO);
+        g_historySSBO = 0;
+    }
+    else if (objects != g_objects || length != g_length)
+    {
+        if (g_historySSBO == 0) glGenBuffers(1, &g_historySSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_historySSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        GLenum err = glGetError();
+        if (err != GL_NO_ERROR)
+        {
+            std::cerr << "[ObjectTrails] Failed to allocate " << objects << " trails of " << length
+                      << " positions (GL error " << err << ")" << std::endl;
+            glDeleteBuffers(1, &g_historySSBO);
+            g_historySSBO = 0;
+            g_objects = 0;
+            Reset();
+            return false;
+        }
+    }
+
+    g_objects = objects;
+    g_length = length;
+    Reset();
+    return true;
+}
+
+int ObjectTrails::GetObjects()
+{
+    return g_objects;
+}
+
+int ObjectTrails::GetLength()
+{
+    return g_length;
+}
+
+void ObjectTrails::Reset()
+{
+    g_head = -1;
+    g_filled = 0;
+}
+
+// ============================================================================
+// Newest positions -> the next ring slot
+// ============================================================================
+void ObjectTrails::Record(GLuint objectSSBO, int numObjects)
+{
+    int count = std::min(g_objects, numObjects);
+    if (!g_recordReady || g_historySSBO == 0 || count <= 0) return;
+
+    g_head = (g_head + 1) % g_length;
+    g_filled = std::min(g_filled + 1, g_length);
+
+    glUseProgram(g_recordProgram);
+    glUniform1i(g_recordCountLoc, count);
+    glUniform1i(g_recordLengthLoc, g_length);
+    glUniform1i(g_recordHeadLoc, g_head);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TRAIL_HISTORY_BINDING, g_historySSBO);
+
+    glDispatchCompute((static_cast<GLuint>(count) + TRAIL_WORK_GROUP_SIZE - 1) / TRAIL_WORK_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TRAIL_HISTORY_BINDING, 0);
+    glUseProgram(0);
+}
+
+// ============================================================================
+// One line strip per tracked object, oldest position first
+// ============================================================================
+void ObjectTrails::Draw(const glm::mat4& projView, GLuint objectSSBO, int numObjects)
+{
+    int count = std::min(g_objects, numObjects);
+    if (!g_drawReady || g_historySSBO == 0 || count <= 0 || g_filled < 2) return;
+
+    glUseProgram(g_drawProgram);
+    glUniformMatrix4fv(g_drawProjViewLoc, 1, GL_FALSE, glm::value_ptr(projView));
+    glUniform1i(g_drawLengthLoc, g_length);
+    if (g_drawHeadLoc != -1) glUniform1i(g_drawHeadLoc, g_head);
+    if (g_drawFilledLoc != -1) glUniform1i(g_drawFilledLoc, g_filled);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TRAIL_HISTORY_BINDING, g_historySSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TRAIL_OBJECTS_BINDING, objectSSBO);
+
+    glBindVertexArray(g_vao);
+    glDrawArraysInstanced(GL_LINE_STRIP, 0, g_filled, count);
+    glBindVertexArray(0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TRAIL_HISTORY_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TRAIL_OBJECTS_BINDING, 0);
+    glUseProgram(0);
+}
+
+// ============================================================================
+// Release buffers and programs
+// ============================================================================
+void ObjectTrails::Cleanup()
+{
+    if (g_recordProgram) glDeleteProgram(g_recordProgram);
+    if (g_drawProgram) glDeleteProgram(g_drawProgram);
+    g_recordProgram = 0;
+    g_drawProgram = 0;
+    g_recordReady = false;
+    g_drawReady = false;
+
+    if (g_historySSBO) glDeleteBuffers(1, &g_historySSBO);
+    if (g_vao) glDeleteVertexArrays(1, &g_vao);
+    g_historySSBO = 0;
+    g_vao = 0;
+    g_objects = 0;
+    g_length = 0;
+    Reset();
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ObjectTrails::UpdateShaderLoadingStatus()
+{
+    g_recordLoader.Update();
+    g_drawLoader.Update();
+}
+
+bool ObjectTrails::IsReady()
+{
+    return g_recordReady && g_drawReady;
+}
+
+std::string ObjectTrails::GetShaderLoadStatusMessage()
+{
+    if (!g_recordReady) return "[trails] " + g_recordLoader.GetStatusMessage();
+    if (!g_drawReady) return "[trails] " + g_drawLoader.GetStatusMessage();
+    return "Trail shaders ready";
+}
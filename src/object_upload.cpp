@@ -0,0 +1,168 @@
+#include "object_upload.h"
+#include <iostream>
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+static const int STAGING_CHUNKS = 4;                          // Chunks the thread can fill ahead of the copies
+static const GLsizeiptr CHUNK_BYTES = 8 << 20;                // Per chunk
+static const GLsizeiptr MIN_STAGED_BYTES = 2 * CHUNK_BYTES;   // Smaller uploads go through glBufferSubData
+
+// Ring, one buffer mapped once for all chunks
+static GLuint g_stagingBuffer = 0;
+static unsigned char* g_mapped = nullptr;
+static GLsync g_chunkFences[STAGING_CHUNKS] = {};  // Behind the copies out of each chunk
+static bool g_unavailable = false;                 // No GL 4.4 buffer storage or no mapping
+
+// Filling thread: the calling thread queues (chunk, source, size) and waits for the chunks in order
+struct FillJob
+{
+    int chunk;
+    const unsigned char* source;
+    size_t bytes;
+};
+static std::thread g_worker;
+static std::mutex g_mutex;
+static std::condition_variable g_jobReady;
+static std::condition_variable g_chunkFilled;
+static std::deque<FillJob> g_jobs;
+static bool g_filled[STAGING_CHUNKS] = {};
+static bool g_stop = false;
+
+static void Fill()
+{
+    std::unique_lock<std::mutex> lock(g_mutex);
+    for (;;)
+    {
+        g_jobReady.wait(lock, [] { return g_stop || !g_jobs.empty(); });
+        if (g_stop) return;
+        FillJob job = g_jobs.front();
+        g_jobs.pop_front();
+
+        // Coherent mapping: the writes are visible to copies queued after the calling thread sees them done
+        lock.unlock();
+        std::memcpy(g_mapped + job.chunk * CHUNK_BYTES, job.source, job.bytes);
+        lock.lock();
+        g_filled[job.chunk] = true;
+        g_chunkFilled.notify_all();
+    }
+}
+
+static bool InitRing()
+{
+    if (g_mapped) return true;
+    if (g_unavailable) return false;
+    if (!GLAD_GL_VERSION_4_4)
+    {
+        g_unavailable = true;
+        return false;
+    }
+
+    const GLsizeiptr size = STAGING_CHUNKS * CHUNK_BYTES;
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &g_stagingBuffer);
+    glBindBuffer(GL_COPY_READ_BUFFER, g_stagingBuffer);
+    glBufferStorage(GL_COPY_READ_BUFFER, size, nullptr, flags);
+    g_mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, size, flags));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    if (!g_mapped)
+    {
+        std::cerr << "[ObjectUpload] Persistent staging buffer unavailable, bulk uploads use glBufferSubData" << std::endl;
+        glDeleteBuffers(1, &g_stagingBuffer);
+        g_stagingBuffer = 0;
+        g_unavailable = true;
+        return false;
+    }
+
+    g_stop = false;
+    g_worker = std::thread(Fill);
+    return true;
+}
+
+// A chunk is refilled once the copies out of it have finished
+static void WaitForChunk(int chunk)
+{
+    GLsync& fence = g_chunkFences[chunk];
+    if (!fence) return;
+    GLenum status;
+    do status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+    while (status == GL_TIMEOUT_EXPIRED);
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+// ============================================================================
+// Chunks in order: the thread fills up to STAGING_CHUNKS ahead, this thread copies
+// ============================================================================
+bool ObjectUpload::Upload(const void* data, GLsizeiptr bytes, const GLuint* buffers, int bufferCount, GLintptr offset)
+{
+    if (bytes < MIN_STAGED_BYTES || !data || bufferCount <= 0 || !InitRing()) return false;
+
+    const unsigned char* source = static_cast<const unsigned char*>(data);
+    size_t chunks = static_cast<size_t>((bytes + CHUNK_BYTES - 1) / CHUNK_BYTES);
+    auto chunkBytes = [&](size_t k) { return static_cast<size_t>(std::min<GLsizeiptr>(CHUNK_BYTES, bytes - k * CHUNK_BYTES)); };
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);  // Shader writes to the rows being replaced
+    size_t queued = 0;
+    for (size_t copied = 0; copied < chunks; copied++)
+    {
+        while (queued < chunks && queued < copied + STAGING_CHUNKS)
+        {
+            int chunk = static_cast<int>(queued % STAGING_CHUNKS);
+            WaitForChunk(chunk);
+            {
+                std::lock_guard<std::mutex> lock(g_mutex);
+                g_filled[chunk] = false;
+                g_jobs.push_back({ chunk, source + queued * CHUNK_BYTES, chunkBytes(queued) });
+            }
+            g_jobReady.notify_one();
+            queued++;
+        }
+
+        int chunk = static_cast<int>(copied % STAGING_CHUNKS);
+        {
+            std::unique_lock<std::mutex> lock(g_mutex);
+            g_chunkFilled.wait(lock, [chunk] { return g_filled[chunk]; });
+        }
+
+        glBindBuffer(GL_COPY_READ_BUFFER, g_stagingBuffer);
+        for (int b = 0; b < bufferCount; b++)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[b]);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, chunk * CHUNK_BYTES,
+                                offset + static_cast<GLintptr>(copied * CHUNK_BYTES), static_cast<GLsizeiptr>(chunkBytes(copied)));
+        }
+        g_chunkFences[chunk] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glFlush();  // Start the copies while the caller goes on
+    return true;
+}
+
+// ============================================================================
+// Stop the thread and release the ring
+// ============================================================================
+void ObjectUpload::Cleanup()
+{
+    if (g_worker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            g_stop = true;
+            g_jobs.clear();
+        }
+        g_jobReady.notify_all();
+        g_worker.join();
+    }
+
+    for (int chunk = 0; chunk < STAGING_CHUNKS; chunk++) WaitForChunk(chunk);
+    if (g_stagingBuffer) glDeleteBuffers(1, &g_stagingBuffer);  // Deleting unmaps
+    g_stagingBuffer = 0;
+    g_mapped = nullptr;
+    g_unavailable = false;
+    for (bool& filled : g_filled) filled = false;
+}
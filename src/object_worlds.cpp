@@ -0,0 +1,132 @@
+#include "object_worlds.h"
+#include <algorithm>
+#include <iostream>
+
+static_assert(sizeof(ObjectWorlds::WorldParameters) == 32, "WorldParameters must be two RGBA32F texels");
+
+// World table and parameter rows, their buffer textures and the host copies
+static GLuint g_worldsBuffer = 0;
+static GLuint g_worldsTexture = 0;
+static GLuint g_paramsBuffer = 0;
+static GLuint g_paramsTexture = 0;
+static std::vector<ObjectWorlds::WorldRange> g_worlds;
+static std::vector<ObjectWorlds::WorldParameters> g_parameters;
+static int g_largestCount = 0;
+
+static void CreateBufferTexture(GLuint& buffer, GLuint& texture, GLenum format, GLsizeiptr size, int unit)
+{
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenTextures(1, &texture);
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+template<typename T>
+static void UploadTable(GLuint buffer, const std::vector<T>& rows)
+{
+    if (buffer == 0 || rows.empty()) return;
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, rows.size() * sizeof(T), rows.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+// ============================================================================
+// Create the buffers and their buffer textures (filled by Set, SetParameters)
+// ============================================================================
+bool ObjectWorlds::Init()
+{
+    if (g_worldsTexture != 0) return true;
+
+    CreateBufferTexture(g_worldsBuffer, g_worldsTexture, GL_RG32I, sizeof(WorldRange), OBJECT_WORLDS_TEXTURE_UNIT);
+    CreateBufferTexture(g_paramsBuffer, g_paramsTexture, GL_RGBA32F, sizeof(WorldParameters),
+                        OBJECT_WORLD_PARAMS_TEXTURE_UNIT);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ObjectWorlds] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Table edits. A table is written once per ensemble, so it is re-specified whole;
+// glBufferData gives the texture a new store, which it follows without re-attaching.
+// ============================================================================
+void ObjectWorlds::Set(const std::vector<WorldRange>& worlds)
+{
+    g_worlds = worlds;
+    g_parameters.clear();  // Rows belong to the worlds they were set for
+    g_largestCount = 0;
+    for (const WorldRange& world : g_worlds) g_largestCount = std::max(g_largestCount, world.count);
+    UploadTable(g_worldsBuffer, g_worlds);
+}
+
+void ObjectWorlds::Clear()
+{
+    g_worlds.clear();
+    g_parameters.clear();
+    g_largestCount = 0;
+}
+
+int ObjectWorlds::Count()
+{
+    return static_cast<int>(g_worlds.size());
+}
+
+int ObjectWorlds::LargestCount()
+{
+    return g_largestCount;
+}
+
+void ObjectWorlds::SetParameters(const std::vector<WorldParameters>& parameters)
+{
+    if (parameters.size() != g_worlds.size()) return;
+    g_parameters = parameters;
+    UploadTable(g_paramsBuffer, g_parameters);
+}
+
+bool ObjectWorlds::HasParameters()
+{
+    return !g_parameters.empty();
+}
+
+void ObjectWorlds::Bind()
+{
+    if (g_worldsTexture == 0) return;
+    glActiveTexture(GL_TEXTURE0 + OBJECT_WORLDS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_worldsTexture);
+    glActiveTexture(GL_TEXTURE0 + OBJECT_WORLD_PARAMS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_paramsTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// ============================================================================
+// Release the buffer and texture
+// ============================================================================
+void ObjectWorlds::Cleanup()
+{
+    GLuint* textures[] = { &g_worldsTexture, &g_paramsTexture };
+    for (GLuint* texture : textures)
+    {
+        if (*texture) glDeleteTextures(1, texture);
+        *texture = 0;
+    }
+    GLuint* buffers[] = { &g_worldsBuffer, &g_paramsBuffer };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_worlds.clear();
+    g_parameters.clear();
+    g_largestCount = 0;
+}
@@ -2,9 +2,61 @@
 #include "shader_utils.h"
 #include "utils.h"
 #include "debug_helpers.h"
+#include "gl_debug.h"
 #include "gpu_serializer.h"
 #include "constraints.h"
 #include "async_shader_loader.h"
+#include "equation_codegen.h"
+#include "dispatch_order.h"
+#include "adaptive_timestep.h"
+#include "long_range.h"
+#include "particle_mesh.h"
+#include "sph_fluid.h"
+#include "object_streams.h"
+#include "object_sleep.h"
+#include "xpbd_constraints.h"
+#include "spring_network.h"
+#include "contact_solver.h"
+#include "object_lifecycle.h"
+#include "object_scatter.h"
+#include "object_params.h"
+#include "state_registers.h"
+#include "object_sensitivity.h"
+#include "object_bounds.h"
+#include "object_reorder.h"
+#include "static_colliders.h"
+#include "kinematic_paths.h"
+#include "world_tiles.h"
+#include "object_aggregates.h"
+#include "scene_cache.h"
+#include "object_history.h"
+#include "object_fork.h"
+#include "workgroup_tuner.h"
+#include "gpu_primitives.h"
+#include "object_upload.h"
+#include "lookup_tables.h"
+#include "object_handles.h"
+#include "object_worlds.h"
+#include "nan_scan.h"
+#include "object_culling.h"
+#include "object_trails.h"
+#include "constraint_lines.h"
+#include "phase_space.h"
+#include "force_field.h"
+#include "sdf_colliders.h"
+#include "object_streaming.h"
+#include "grid_fields.h"
+#include "object_pipeline.h"
+#include "object_pick.h"
+#include "object_query.h"
+#include "metropolis.h"
+#include "object_raycast.h"
+#include "contact_events.h"
+#include "density_splat.h"
+#include "gpu_profiler.h"
+#include "frame_trace.h"
+#include "perf_counters.h"
+#include "buffer_helpers.h"
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <cstring>
@@ -12,59 +64,505 @@
 #include <unordered_map>
 #include <map>
 #include <atomic>
+#include <unordered_set>
+#include <climits>
+#include <cmath>
+#include <limits>
+#include <cstdint>
+#include <functional>
 
 // Static buffer IDs for double-buffered object data
 static GLuint g_objectSSBO[2] = { 0, 0 };
 static GLuint g_renderVAO[2] = { 0, 0 };
 static GLuint g_programCompute = 0;
-static GLuint g_programQuad = 0;
+static GLuint g_programQuad = 0;           // quad.geom expands one point per object
+static GLuint g_programQuadInstanced = 0;  // quad_instanced.vert, one instanced quad per object
+static GLuint g_quadInstancedVAO = 0;      // No attributes, the instanced path reads the object buffer
+static const GLuint QUAD_OBJECT_BINDING = 45;  // MUST MATCH quad_instanced.vert
+static const GLuint QUAD_PREVIOUS_BINDING = 51;  // MUST MATCH quad_instanced.vert
+static GLint g_quadVisibleListLoc = -1;
+static GLint g_quadBlendLoc = -1;
+static GLint g_quadTiledLoc = -1;
+// Render interpolation: the instanced draw blends from the buffer the last Update read
+static float g_interpolationFraction = 1.0f;  // Share of a step past the newest state, 1 = off
+static int g_interpolationOutput = -1;        // Buffer the last Update wrote
+static int g_interpolationSteps = 1;          // Steps between the two buffers
+static unsigned long long g_interpolationGeneration = 0;  // g_objectGeneration after that Update
+static bool g_viewCulling = true;  // Cull the instanced draw against the view (object_culling.h)
+static bool g_viewBoundsSet = false;
+static glm::vec2 g_viewMin(0.0f), g_viewMax(0.0f);  // World rectangle SetViewBounds() last saw
+static glm::mat4 g_viewProjView(1.0f);               // and the matrix it came from
+static bool g_densityRendering = false;  // Draw() splats points (density_splat.h)
+static bool g_constraintRendering = false;  // DrawConstraints() draws (constraint_lines.h)
+static int g_constraintLineRows = 0;       // Rows holding a constraint, and the longest of them, as of
+static int g_constraintLineMaxPerRow = 0;  // g_constraintLineRevision; the GPU only ever shrinks rows
+static unsigned long long g_constraintLineRevision = ~0ull;
 
 // Equation and constraint storage buffers
 static GLuint g_allTokensSSBO = 0;
 static GLuint g_allConstantsSSBO = 0;
+static GLuint g_allBytecodeSSBO = 0;
 static GLuint g_mappingsSSBO = 0;
-static GLuint g_initialPosSSBO = 0;
+static GLuint g_initialStateSSBO = 0;
 static GLuint g_constraintsSSBO = 0;
 static GLuint g_objectConstraintsSSBO = 0;
 
 // Collision system buffers
 static GLuint g_collisionPropsSSBO = 0;
 static GLuint g_contactBufferSSBO = 0;  // NEW: Contact persistence buffer
-static std::vector<CollisionProperties> g_collisionProperties(Objects::MAX_OBJECTS);
-static std::vector<std::vector<bool>> g_collisionMatrix(Objects::MAX_OBJECTS,
-    std::vector<bool>(Objects::MAX_OBJECTS, true));
+static std::vector<CollisionProperties> g_collisionProperties;  // One per slot of object capacity
+
+// Sparse per-pair exclusions (key = min << 32 | max), uploaded as an open-addressing table
+static GLuint g_collisionExclusionsSSBO = 0;
+static std::unordered_set<unsigned long long> g_collisionExclusions;
+static bool g_collisionExclusionsDirty = true;
+
+// Unit regular polygons for the SAT tests, built once - MUST MATCH POLYGON_TABLE_* in collide.comp
+static const GLuint POLYGON_TABLE_BINDING = 62;
+static const int POLYGON_TABLE_MAX_SIDES = 64;
+static GLuint g_polygonTableSSBO = 0;
 
 // NEW: Collision system parameters
 static bool g_enableWarmStart = false;
 static int g_maxContactIterations = 3;
 static bool g_useAnalyticalCollision = true;  // Use analytical elastic collisions
+static BroadphaseMode g_broadphaseMode = BROADPHASE_UNIFORM_GRID;
+static float g_neighbourSkin = 0.0f;         // Verlet skin the broadphase is reused within, 0 = rebuild every step
+static int g_smallWorldObjects = 64;         // Ensemble worlds this small collide within their range, no broadphase
+static bool g_broadphaseStale = true;        // Shapes or indices changed since the last collision build
+static bool g_broadphaseExcludesStatic = false;  // The last collision build left the static colliders out
 
 // Object count and data storage
 static int g_numObjects = 0;
+static int g_objectCapacity = 0;  // Objects every per-object buffer holds
+static int g_initialStateCount = -1;         // Objects in g_initialStateSSBO; -1 until the next step captures them
+static bool g_initialEquationsStale = false;  // Equations reassigned since the capture
 static std::vector<int> g_allTokens;
 static std::vector<float> g_allConstants;
+static std::vector<unsigned int> g_allBytecode;  // Register programs, referenced by EquationMapping::bytecodeOffset_*
 static std::vector<EquationMapping> g_equationMappings(Objects::MAX_EQUATIONS);
-static std::unordered_map<std::string, int> g_equationStringToID;
+static std::unordered_map<std::string, int> g_equationStringToID;   // Every key registered, aliases included
+static std::unordered_map<std::string, int> g_equationProgramToID;  // CanonicalEquationKey() of each slot
+
+// Free ranges of one equation storage buffer, coalesced on release; compacted once they outweigh the live data
+struct EquationSpace
+{
+    std::map<int, int> freeRanges;  // Offset -> length
+    int end = 0;                    // One past the last allocated element
+    int freed = 0;                  // Elements in freeRanges
+    int gpuCapacity = 0;            // Elements the GPU buffer holds
+};
+
+// Where one equation lives in the three storage buffers
+struct EquationAllocation
+{
+    int tokenOffset = 0, tokenCount = 0;
+    int constantOffset = 0, constantCount = 0;
+    int bytecodeOffset = -1, bytecodeCount = 0;
+    int stackDepth = 0;  // Deepest stack evaluateRPNComponent() reaches, see validateGPUSerializedEquation()
+};
+
+static const int EQUATION_STORAGE_MIN_ELEMENTS = 1024;
+static const int EQUATION_COMPACT_MIN_FREED = 4096;  // Holes smaller than this are not worth a compaction
+static EquationSpace g_tokenSpace;
+static EquationSpace g_constantSpace;
+static EquationSpace g_bytecodeSpace;
+
+// Token buffer as the GPU holds it (gpu_serializer.h): 16-bit entries plus a wide table
+static PackedTokenTable g_tokenPacking;
+static int g_tokenWideCapacity = 0;     // Wide slots the GPU buffer reserves
+static size_t g_tokenWideUploaded = 0;  // Wide slots already written
+static bool g_tokensUnpacked = false;   // The wide table overflowed: whole words until the next repack
+static std::vector<EquationAllocation> g_equationAllocations(Objects::MAX_EQUATIONS);
+static std::vector<std::string> g_equationKeys(Objects::MAX_EQUATIONS);  // Empty = free slot
+static std::vector<int> g_equationRefCounts(Objects::MAX_EQUATIONS, 0);  // Host objects running each equation
+static std::vector<int> g_objectEquationIDs;                              // Per object slot, -1 = none recorded, <= -2 a group
+static std::vector<int> g_groupEquations(Objects::MAX_EQUATION_GROUPS, -1);  // Per behaviour group, -1 = none
+static int g_equationRevision = 0;                                       // Bumped whenever a slot is filled, freed or moved
+static int g_invalidatedEquationRevision = 0;                            // Builds older than this run freed or moved slots
 
 // Constraint management
 static std::vector<Constraint> g_allConstraints;
-static std::vector<ObjectConstraints> g_objectConstraintMappings(Objects::MAX_OBJECTS);
+static std::vector<ObjectConstraints> g_objectConstraintMappings;
+static std::vector<std::vector<int>> g_constraintReferrers;  // Owners of the distance constraints to each object, one per constraint
+
+// Elements [begin, end) of a host array its GPU copy has not seen yet
+struct DirtyRange
+{
+    int begin = 0;
+    int end = INT_MAX;  // Everything, until the first upload
+
+    void Mark(int first, int last)
+    {
+        if (begin >= end)
+        {
+            begin = first;
+            end = last;
+            return;
+        }
+        begin = std::min(begin, first);
+        end = std::max(end, last);
+    }
+    void MarkAll() { begin = 0; end = INT_MAX; }
+    void Clear() { begin = 0; end = 0; }
+};
+
+// Constraint storage: removed constraints and relocation headroom stay behind as holes (type -1)
+// until they outnumber the live ones, so edits upload only the elements they touch
+static const int CONSTRAINT_STORAGE_MIN_ELEMENTS = 64;
+static int g_constraintsGpuCapacity = 0;
+static int g_liveConstraintCount = 0;  // Constraints some mapping covers
+// Breakable distance constraints are dropped by constraints.comp, which closes up the owner's
+// row in place and counts the breaks; the host arrays catch up only when they are next used
+static const GLuint CONSTRAINT_BREAKS_BINDING = 63;  // MUST MATCH constraints.comp
+static GLuint g_constraintBreaksSSBO = 0;
+static int g_breakableConstraints = 0;          // Added since the last catch-up, an upper bound
+static bool g_constraintMirrorStale = false;     // A constraint pass ran with breakable constraints
+static int g_constraintRowsTouched = 0;          // Rows those passes covered
+static DirtyRange g_constraintsDirty;
+static DirtyRange g_constraintMappingsDirty;
 
 // Default system parameters
 static int g_currentDefaultObjectType = SKIN_CIRCLE;
-static float g_currentSystemGravity = 9.81f;
-static float g_currentSystemDamping = 0.1f;
-static float g_currentSystemStiffness = 1.0f;
 
-// Memory mapping for direct CPU access
-static Object* g_mappedSSBO[2] = { nullptr, nullptr };
-static bool g_useMapBuffer = true;
+// Simulation parameters shared by every pass (std140 block at SIM_PARAMS_BINDING), uploaded when changed
+static SimParams g_simParams;
+static GLuint g_simParamsUBO = 0;
+static bool g_simParamsDirty = true;
+
+// Copy of allConstants in a uniform block, served by the constant cache, while every constant fits
+static GLuint g_constantsUBO = 0;
+static int g_constantBlockVec4s = 0;      // Block size math.comp is built with, from GL_MAX_UNIFORM_BLOCK_SIZE
+static bool g_constantBlockDirty = true;  // allConstants changed since the block was written
+static bool g_constantsInBlock = false;   // The block holds all of them
+
+// Host reads of the object buffers: after each step the produced state is copied into the next of
+// three persistently mapped, coherent buffers and fenced, so a read finds a copy the GPU has finished
+// instead of stalling the pipeline. Host writes stay glBufferSubData, which the driver queues.
+static const int READBACK_SLOTS = 3;
+static const int READBACK_IDLE_STEPS = 120;  // Steps without a host read before the copies stop
+struct ReadbackSlot
+{
+    GLuint buffer = 0;
+    const Object* mapped = nullptr;
+    GLsync fence = nullptr;             // Signals when the copy has landed
+    int sourceIndex = -1;               // Object buffer the copy was taken from
+    int numObjects = 0;
+    unsigned long long generation = 0;  // g_objectGeneration the copy shows
+};
+static ReadbackSlot g_readback[READBACK_SLOTS];
+static int g_readbackNext = 0;
+static bool g_readbackUnavailable = false;            // No GL 4.4 buffer storage, reads use glGetBufferSubData
+static int g_stepsSinceRead = READBACK_IDLE_STEPS;    // Copies start with the first host read
+static unsigned long long g_uncachedReadGeneration = 0;  // State the reads below were of
+static int g_uncachedReads = 0;                        // Host reads of it that found no copy
+static uint64_t g_readbackBytes = 0;                   // Object state copied toward the host, see GetReadbackBytes
+static unsigned long long g_objectGeneration = 1;     // Bumped by every step and every host write
+static unsigned long long g_sceneRevision = 0;        // Host edits of collision properties, constraints and object parameters
+
+// Host writes waiting for the next flush, one record per object; g_pendingWriteSlot maps an object
+// to its record (-1 = none), so repeated edits of an object cost nothing extra
+static std::vector<ObjectWrite> g_pendingWrites;
+static std::vector<int> g_pendingWriteSlot;
+static int g_currentObjectBuffer = 0;  // Object buffer holding the newest state; merged fields come from it
+
+// Asynchronous readbacks, each a copy of the live objects in its own staging buffer behind a fence
+struct AsyncReadback
+{
+    GLuint buffer = 0;
+    GLsizeiptr capacity = 0;
+    GLsync fence = nullptr;
+    int numObjects = 0;
+};
+static const size_t MAX_ASYNC_READBACKS = 64;                // Outstanding handles before BeginReadback fails
+static std::unordered_map<int, AsyncReadback> g_asyncReadbacks;
+static std::vector<AsyncReadback> g_freeAsyncReadbacks;      // Staging buffers of resolved handles, reused
+static int g_nextReadbackHandle = 1;                         // Never reset, so stale handles match nothing
 
 // Async shader loading
 static AsyncShaderLoader g_computeLoader;
 static AsyncShaderLoader g_quadLoader;
+static AsyncShaderLoader g_quadInstancedLoader;
 static bool g_computeShaderReady = false;
 static bool g_quadShaderReady = false;
+static bool g_quadInstancedReady = false;
+static bool g_instancedRendering = true;  // Draw with quad_instanced.vert once it has linked
+
+// Simulation pipeline passes that run after math.comp (equation evaluation + integration)
+// Uniform locations are looked up once, when the program has linked
+struct SimulationPass
+{
+    GLuint program = 0;
+    AsyncShaderLoader loader;
+    bool ready = false;
+    bool failed = false;  // Not requested again
+    GLint numObjectsLoc = -1;
+    std::vector<GLint> uniformLocs;  // Indexed like the name table passed to LoadSimulationPass
+};
+
+static SimulationPass g_constraintPass;  // constraints.comp
+static SimulationPass g_collisionPass;   // collide.comp (narrowphase + response)
+
+// Narrowphase shape buckets: a scene that mixes collision shapes runs collide.comp once per
+// shape over the objects of that shape, each dispatch a build with NARROWPHASE_SHAPE set, so a
+// warp runs one shape's tests instead of waiting on the polygon SAT of its neighbours
+static const int NARROWPHASE_SHAPES = 3;  // Circle, AABB, polygon; bucket 0 holds the rest
+static bool g_shapeBuckets = true;
+static SimulationPass g_collisionShapePasses[NARROWPHASE_SHAPES];  // Built the first time a mixed scene steps
+
+// Builds of constraints.comp and collide.comp at other work-group sizes (workgroup_tuner.h), indexed
+// like LOCAL_SIZE_CANDIDATES; the default size is the pass above. Collision bucket 0 is the generic
+// build, 1.. the shape builds.
+static SimulationPass g_sizedConstraintPasses[LOCAL_SIZE_CANDIDATE_COUNT];
+static SimulationPass g_sizedCollisionPasses[NARROWPHASE_SHAPES + 1][LOCAL_SIZE_CANDIDATE_COUNT];
+static GLuint g_shapeOrderSSBO = 0;
+static std::vector<GLuint> g_shapeOrder;        // Object indices by bucket
+static int g_shapeBucketStart[NARROWPHASE_SHAPES + 2] = {};
+static int g_shapeBucketObjects = -1;           // g_numObjects the buckets were built for, -1 = stale
+static bool g_shapeOrderUploaded = false;
+static const GLuint SHAPE_ORDER_BINDING = 2;    // MUST MATCH collide.comp
+
+// Per-dispatch uniforms of the pipeline passes - MUST MATCH the name tables below
+enum ConstraintUniform
+{
+    CONSTRAINT_SKIP_DISTANCE,
+    CONSTRAINT_PERF_COUNTERS,
+    CONSTRAINT_BREAKABLE,
+    CONSTRAINT_STATIC_COLLIDERS,
+    CONSTRAINT_KINEMATIC_OBJECTS,
+    CONSTRAINT_UNIFORM_COUNT
+};
+static const char* const s_constraintUniformNames[CONSTRAINT_UNIFORM_COUNT] = {
+    "uSkipDistance", "uPerfCounters", "uBreakable", "uStaticColliders", "uKinematicObjects"
+};
+
+enum CollisionUniform
+{
+    COLLIDE_BROADPHASE_MODE,
+    COLLIDE_GRID_TABLE_SIZE,
+    COLLIDE_OBJECT_STREAMS,
+    COLLIDE_USE_ACTIVE_SET,
+    COLLIDE_SLEEP_STEPS,
+    COLLIDE_WAKE_SPEED,
+    COLLIDE_CONTACT_SOLVER,
+    COLLIDE_CONTACT_CAPACITY,
+    COLLIDE_PERF_COUNTERS,
+    COLLIDE_CONTACT_EVENTS,
+    COLLIDE_ADAPTIVE_TIMESTEP,
+    COLLIDE_SHAPE_BUCKET,
+    COLLIDE_SHAPE_BUCKET_FIRST,
+    COLLIDE_SHAPE_BUCKET_COUNT,
+    COLLIDE_NEIGHBOUR_SKIN,
+    COLLIDE_STATIC_COLLIDERS,
+    COLLIDE_STATIC_GRID,
+    COLLIDE_STATIC_GRID_CELLS,
+    COLLIDE_KINEMATIC_OBJECTS,
+    COLLIDE_NUM_WORLDS,
+    COLLIDE_SMALL_WORLD_OBJECTS,
+    COLLIDE_UNIFORM_COUNT
+};
+static const char* const s_collisionUniformNames[COLLIDE_UNIFORM_COUNT] = {
+    "uBroadphaseMode", "uGridTableSize", "uObjectStreams", "uUseActiveSet",
+    "uSleepSteps", "uWakeSpeed", "uContactSolver", "uContactCapacity", "uPerfCounters",
+    "uContactEvents", "uAdaptiveTimestep", "uShapeBucket", "uShapeBucketFirst", "uShapeBucketCount",
+    "uNeighbourSkin", "uStaticColliders", "uStaticGrid", "uStaticGridCells",
+    "uKinematicObjects", "uNumWorlds", "uSmallWorldObjects"
+};
+
+// math.comp uniforms besides the SimParams block, re-queried when the active program changes
+enum ComputeUniform
+{
+    COMPUTE_NUM_OBJECTS,
+    COMPUTE_OBJECT_STREAMS,
+    COMPUTE_USE_ACTIVE_SET,
+    COMPUTE_PAIR_SUM_PASS,
+    COMPUTE_PAIR_TILES,
+    COMPUTE_NEIGHBOUR_CELL_SIZE,
+    COMPUTE_GRID_TABLE_SIZE,
+    COMPUTE_USE_DISPATCH_ORDER,
+    COMPUTE_SUBSTEPS,
+    COMPUTE_REGISTER_BYTECODE,
+    COMPUTE_INTEGRATOR,
+    COMPUTE_INTEGRATOR_STAGE,
+    COMPUTE_ADAPTIVE_TIMESTEP,
+    COMPUTE_NUM_WORLDS,
+    COMPUTE_WORLD_PARAMETERS,
+    COMPUTE_STEP_INDEX,
+    COMPUTE_FRAME_STEPS_LEFT,
+    COMPUTE_RANDOM_SEED,
+    COMPUTE_METROPOLIS,
+    COMPUTE_METROPOLIS_STEP_SIZE,
+    COMPUTE_METROPOLIS_HISTOGRAM_BOX,
+    COMPUTE_METROPOLIS_HISTOGRAM,
+    COMPUTE_PERF_COUNTERS,
+    COMPUTE_STATE_REGISTERS,
+    COMPUTE_SENSITIVITY_COUNT,
+    COMPUTE_SENSITIVITY_PARAMS,
+    COMPUTE_SHARED_OBJECT_REFS,
+    COMPUTE_STATIC_OBJECTS,
+    COMPUTE_KINEMATIC_OBJECTS,
+    COMPUTE_CONSTANTS_IN_BLOCK,
+    COMPUTE_PRELUDE_PASS,
+    COMPUTE_PRELUDE_COUNT,
+    COMPUTE_PIPELINE_FIELDS,
+    COMPUTE_UNIFORM_COUNT
+};
+static const char* const s_computeUniformNames[COMPUTE_UNIFORM_COUNT] = {
+    "uNumObjects", "uObjectStreams", "uUseActiveSet", "uPairSumPass", "uPairTiles",
+    "uNeighbourCellSize", "uGridTableSize", "uUseDispatchOrder", "uSubsteps",
+    "uUseRegisterBytecode", "uIntegrator", "uIntegratorStage", "uAdaptiveTimestep", "uNumWorlds",
+    "uWorldParameters", "uStepIndex", "uFrameStepsLeft", "uRandomSeed", "uMetropolis", "uMetropolisStepSize",
+    "uMetropolisHistogramBox", "uMetropolisHistogram", "uPerfCounters", "uStateRegisters",
+    "uSensitivityCount", "uSensitivityParams", "uSharedObjectRefs", "uStaticObjects",
+    "uKinematicObjects", "uConstantsInBlock", "uPreludePass", "uPreludeCount", "uPipelineFields"
+};
+static GLint g_computeUniformLocs[COMPUTE_UNIFORM_COUNT];
+static GLuint g_computeUniformProgram = 0;  // Program g_computeUniformLocs belong to, 0 = none
+
+// Specialized math.comp with the registered equations compiled in (equation compile mode)
+static bool g_equationCompileMode = false;
+static AsyncShaderLoader g_compiledEquationsLoader;
+static GLuint g_programCompiledEquations = 0;
+static GLuint g_pendingCompiledProgram = 0;     // Linked, swapped in at the end of the next Update
+static int g_compiledEquationRevision = -1;     // g_equationRevision baked into g_programCompiledEquations
+static int g_pendingEquationRevision = -1;      // Revision of the build currently in flight
+static int g_failedEquationRevision = -1;       // Revision whose build failed (not retried)
+
+// math.comp builds with interpreter features the registered equations never reach compiled out
+// (its HAS_* switches), keyed by the COMPUTE_FEATURE_* bits they keep
+enum ComputeFeature
+{
+    COMPUTE_FEATURE_COLOR = 1,        // HAS_COLOR_EQ
+    COMPUTE_FEATURE_DERIVATIVES = 2,  // HAS_DERIVATIVES
+    COMPUTE_FEATURE_COMPLEX = 4,      // HAS_COMPLEX
+    COMPUTE_FEATURE_SAFE_MATH = 8,    // SAFE_MATH, off in fast-math mode
+    COMPUTE_FEATURE_DEEP_STACK = 16,  // RPN_STACK_ENTRIES of MAX_GPU_STACK_ENTRIES, else SMALL_GPU_STACK_ENTRIES
+    COMPUTE_FEATURE_SENSITIVITIES = 32,  // HAS_SENSITIVITIES, while parameters are differentiated
+    COMPUTE_FEATURES_ALL = 63         // g_programCompute
+};
+static AsyncShaderLoader g_computeVariantLoader;
+static std::map<int, GLuint> g_computeVariants;
+static std::unordered_set<int> g_failedComputeVariants;
+static int g_computeFeatures = COMPUTE_FEATURES_ALL;  // Features the registered equations need
+static int g_computeFeaturesRevision = -1;            // g_equationRevision g_computeFeatures was taken at
+
+// Fast math: math.comp without its guards, checked by a NaN scan (nan_scan.h) every few steps
+static bool g_fastMath = false;
+static int g_nanScanInterval = 60;           // Steps between scans, 0 = never
+static bool g_nanRollback = false;           // Put back the last clean state when a scan finds NaN/Inf
+static int g_stepsSinceNanScan = 0;
+static int g_nanGuardedSteps = 0;            // Steps left on the guarded build after a roll back
+static int g_nanRollbackCount = 0;
+static int g_lastInvalidCount = 0;           // Objects the last scan found invalid
+static std::vector<int> g_lastInvalidIndices;
+static bool g_compiledEquationsFastMath = false;  // g_programCompiledEquations was built without guards
+static bool g_pendingCompiledFastMath = false;
+static int g_compiledLocalSize = DEFAULT_LOCAL_SIZE;  // Work-group size g_programCompiledEquations was built with
+static int g_pendingCompiledLocalSize = DEFAULT_LOCAL_SIZE;
+
+// Equation-coherent dispatch order for math.comp (0 = objects run in index order)
+static int g_dispatchReorderInterval = 0;
+static int g_stepsSinceReorder = 0;
+static int g_dispatchOrderObjects = -1;  // g_numObjects the order was built for, -1 = none
+
+// Spatial (Z-order) storage order of the object buffers themselves (0 = never re-sorted)
+static int g_storageReorderInterval = 0;
+static int g_stepsSinceStorageReorder = 0;
+
+// Set once a registered equation reads another object's state (p[i].x, sum_j(...))
+static bool g_equationsReadOtherObjects = false;
+static bool g_equationsShareObjectRefs = false;  // Some equation names p[i], math.comp stages them per workgroup
+
+// Neighbour reads (p[i], sum_j, nsum, collision candidates) go through the per-field object streams
+static bool g_structOfArraysStorage = false;
+
+// Sleeping objects (object_sleep.comp): passes dispatch only the awake ones
+static bool g_sleepEnabled = false;
+static int g_sleepConfig = 0;  // Pass layout the sleepers were rested for: 0 = off, 1 = no collisions, 2 = collisions
+
+// Distance constraints solved as an XPBD graph (xpbd_constraints.comp) instead of per object
+static bool g_xpbdConstraints = false;
+static bool g_xpbdGraphDirty = true;  // Constraints changed since the graph was last colored
+static int g_xpbdGraphObjects = -1;   // g_numObjects the graph was built for
+
+// Register bytecode of the components (compileRegisterBytecode), preferred over the RPN stream when enabled
+static const int EQUATION_BYTECODE_BINDING = 23;
+
+// Equation ID per behaviour group, read by math.comp, dispatch_order.comp and sph_fluid.comp
+static const int EQUATION_GROUPS_BINDING = 8;  // MUST MATCH those shaders
+static GLuint g_groupEquationsSSBO = 0;
+static bool g_registerBytecodeEnabled = true;
+
+// sum_j()/nsum()/ncount()/nmean() bodies per (equation, slot), evaluated by math.comp's pair pass
+// before integration: sum_j() through shared-memory tiles, the neighbour reductions through a grid
+static const int PAIR_SUM_EXPRESSIONS_BINDING = 21;
+static const int PAIR_SUMS_BINDING = 20;
+static GLuint g_pairSumExpressionsSSBO = 0;
+static GLuint g_pairSumsSSBO = 0;  // MAX_PAIR_SUMS_PER_EQUATION results per object
+static std::vector<PairSumExpression> g_pairSumExpressions(Objects::MAX_EQUATIONS * MAX_PAIR_SUMS_PER_EQUATION);
+static bool g_pairSumExpressionsDirty = true;
+static bool g_equationsUsePairSums = false;
+static bool g_equationsUseAllPairs = false;   // Some slot is a sum_j() (tiled all-pairs loop)
+static float g_maxNeighbourRadius = 0.0f;     // Neighbour grid cell size, 0 = no nsum/ncount/nmean
+
+// Hoisted subexpressions per (equation, prelude slot), evaluated once per world, step and stage
+// by math.comp's prelude pass; the used equations' slots are packed into g_preludeCount entries
+static const int PRELUDE_EXPRESSIONS_BINDING = 42;
+static const int PRELUDE_VALUES_BINDING = 43;
+static GLuint g_preludeExpressionsSSBO = 0;
+static GLuint g_preludeValuesSSBO = 0;
+static std::vector<PreludeExpression> g_preludeExpressions(Objects::MAX_EQUATIONS * MAX_PRELUDE_SLOTS);
+static bool g_preludeExpressionsDirty = false;
+static int g_preludeCount = 0;
+
+// Set once a registered equation reads grav_ax/grav_ay/coul_ax/coul_ay (Barnes-Hut solve each step)
+static bool g_equationsUseLongRange = false;
+
+// Set once a registered equation reads sph_ax/sph_ay/sph_rho/sph_p (SPH passes each stage)
+static bool g_equationsUseFluid = false;
+
+// Set once a registered equation calls rand()/randn(); g_randomSeed keys the draws
+static bool g_equationsUseRandom = false;
+static uint32_t g_randomSeed = 0;
+
+// Set once a registered equation reads s0..s7 or updates them (state register image each step)
+static bool g_equationsUseState = false;
+
+// Integrated state handed from math.comp to collide.comp (created on first collision step)
+static GLuint g_objectScratchSSBO = 0;
+
+// Integrator stages each make one math.comp pass when equations read other objects, so every
+// stage sees the whole system at that stage. Passes ping-pong between the two stage buffers
+// and hand the start-of-step state on through the scratch buffer. MUST MATCH math.comp.
+struct IntegratorScratch
+{
+    glm::vec4 base;        // Position, velocity at the start of the step
+    glm::vec4 rates;       // RK4 sums of the position and velocity derivatives
+    glm::vec4 angular;     // Rotation, angular velocity at the start of the step and their RK4 sums
+    glm::vec4 firstAccel;  // First stage acceleration (next step's ax_prev)
+    glm::vec4 firstColor;  // First stage colour
+};
+static const int INTEGRATOR_SCRATCH_BINDING = 24;
+static IntegratorMethod g_integrator = INTEGRATOR_SYMPLECTIC_EULER;
+static GLuint g_integratorStageSSBO[2] = { 0, 0 };
+
+// Step clock of the colour intervals (EquationMapping::colorInterval)
+static unsigned long long g_stepIndex = 0;  // Steps simulated so far
+static int g_frameStepsLeft = 0;            // Steps left before the next frame from the next Update(), 0 = unknown
+static GLuint g_integratorScratchSSBO = 0;
+
+// Adaptive global dt (timestep.comp picks the next dt after every step, math.comp reads it on the GPU)
+static bool g_adaptiveTimestep = false;
+
+// Cached number of objects the collision pass has to visit
+static int g_numCollidableObjects = 0;
+static int g_collidableCountObjects = -1;  // g_numObjects when the count was taken
+static bool g_collidableCountDirty = true;
+
+// Compute dispatch planning (refreshed when the compute program links)
+static GLint g_computeLocalSizeX = 16;
+static GLint g_maxWorkGroupCountX = 65535;
+static GLint g_maxWorkGroupCountY = 65535;
 
 // Helper function to safely delete buffers
 static void SafeDeleteBuffers(GLuint* buf, GLsizei n)
@@ -90,1318 +588,6742 @@ static void SafeDeleteVertexArrays(GLuint* arr, GLsizei n)
     for (GLsizei i = 0; i < n; ++i) arr[i] = 0;
 }
 
-// Clamp a value between min and max
-static float clamp(float value, float min, float max)
+// Read the linked work-group size and the device dispatch limits
+static void QueryComputeDispatchLimits(GLuint program)
 {
-    if (value < min) return min;
-    if (value > max) return max;
-    return value;
+    GLint localSize[3] = { 0, 0, 0 };
+    glGetProgramiv(program, GL_COMPUTE_WORK_GROUP_SIZE, localSize);
+    if (localSize[0] > 0) g_computeLocalSizeX = localSize[0];
+
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &g_maxWorkGroupCountX);
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 1, &g_maxWorkGroupCountY);
+    if (g_maxWorkGroupCountX < 1) g_maxWorkGroupCountX = 65535;
+    if (g_maxWorkGroupCountY < 1) g_maxWorkGroupCountY = 65535;
+
+    std::cout << "[Objects] Compute work group size: " << g_computeLocalSizeX
+        << ", max groups: " << g_maxWorkGroupCountX << " x " << g_maxWorkGroupCountY << std::endl;
 }
 
-// Create a default object with specified skin type
-static Object CreateDefaultObjectInternal(int skinType, int objectIndex, int equationID = 0)
+// Split a 1D item count into a work-group grid of localSize invocations; Y is only used once X hits the device limit
+static void PlanComputeDispatch(int numItems, GLint localSize, GLuint& groupsX, GLuint& groupsY)
 {
-    Object p;
-    p.mass = 1.0f;
-    p.charge = 0.0f;
-    p.visualSkinType = skinType;
-    p.collisionShapeType = COLLISION_NONE;
-    p.equationID = equationID;
-    p._pad1 = 0;
-
-    // Initialize with zeros - wrapper will set actual values
-    p.position = glm::vec2(0.0f, 0.0f);
-    p.velocity = glm::vec2(0.0f, 0.0f);
-    p.visualData = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
-    p.color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    GLuint totalGroups = static_cast<GLuint>((std::max(numItems, 1) + localSize - 1) / localSize);
+    GLuint maxX = static_cast<GLuint>(g_maxWorkGroupCountX);
 
-    // Set defaults based on skin type
-    switch (skinType)
+    groupsX = std::min(totalGroups, maxX);
+    groupsY = (totalGroups + groupsX - 1) / groupsX;
+    if (groupsY > static_cast<GLuint>(g_maxWorkGroupCountY))
     {
-    case SKIN_CIRCLE:
-        p.visualData = glm::vec4(0.3f, 0.0f, 0.0f, 0.0f);
-        p.color = glm::vec4(0.4f, 0.8f, 0.3f, 1.0f);
-        break;
-    case SKIN_RECTANGLE:
-        p.visualData = glm::vec4(0.5f, 0.3f, 0.0f, 0.0f);
-        p.color = glm::vec4(1.0f, 0.5f, 0.0f, 1.0f);
-        break;
-    case SKIN_POLYGON:
-        p.visualData = glm::vec4(0.3f, 6.0f, 0.0f, 0.0f);
-        p.color = glm::vec4(0.8f, 0.3f, 0.8f, 1.0f);
-        break;
+        std::cerr << "[Objects] Dispatch of " << numItems << " items exceeds device work group limits" << std::endl;
+        groupsY = static_cast<GLuint>(g_maxWorkGroupCountY);
     }
-
-    p.collisionData = glm::vec4(0.0f);
-    return p;
 }
 
-// Set up VAO to read from SSBO for rendering
-static void SetupRenderVAOFromSSBO(GLuint vaoID, GLuint ssboID)
+// Dispatch a per-object pass over all objects, or over the awake ones from the active set
+static void DispatchObjects(bool useActiveSet, GLuint groupsX, GLuint groupsY)
 {
-    glBindVertexArray(vaoID);
-    glBindBuffer(GL_ARRAY_BUFFER, ssboID);
-
-    // Position attribute
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Object),
-        (void*)offsetof(Object, position));
-    glEnableVertexAttribArray(0);
-
-    // Velocity attribute
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Object),
-        (void*)offsetof(Object, velocity));
-    glEnableVertexAttribArray(1);
+    if (useActiveSet) ObjectSleep::DispatchActive();
+    else glDispatchCompute(groupsX, groupsY, 1);
+}
 
-    // Mass attribute
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Object),
-        (void*)offsetof(Object, mass));
-    glEnableVertexAttribArray(2);
+static std::string InsertComputeDefines(const std::string& source, const std::string& defines);
 
-    // Charge attribute
-    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Object),
-        (void*)offsetof(Object, charge));
-    glEnableVertexAttribArray(3);
+// LOCAL_SIZE_X line of a build at another work-group size; none at the default size
+static std::string LocalSizeDefine(int localSize)
+{
+    return localSize == DEFAULT_LOCAL_SIZE ? std::string() : "#define LOCAL_SIZE_X " + std::to_string(localSize) + "\n";
+}
 
-    // Skin type attribute
-    glVertexAttribIPointer(4, 1, GL_INT, sizeof(Object),
-        (void*)offsetof(Object, visualSkinType));
-    glEnableVertexAttribArray(4);
+// Start the async load of a pipeline pass and cache its uniforms on completion. The loader only
+// calls back with a linked program, so the passes never re-validate it per dispatch.
+// defines, if not empty, go after the #version line of the source.
+static void LoadSimulationPass(SimulationPass& pass, const std::string& file,
+                               const char* const* uniformNames, int numUniforms,
+                               const std::string& defines = "")
+{
+    if (pass.program != 0 || pass.failed || pass.loader.IsLoading()) return;
 
-    // Visual data attribute
-    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(Object),
-        (void*)offsetof(Object, visualData));
-    glEnableVertexAttribArray(5);
+    SimulationPass* target = &pass;
+    auto onComplete = [target, uniformNames, numUniforms](GLuint program)
+    {
+        target->program = program;
+        target->numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+        target->uniformLocs.resize(numUniforms);
+        for (int i = 0; i < numUniforms; i++)
+            target->uniformLocs[i] = glGetUniformLocation(program, uniformNames[i]);
+        target->ready = true;
+    };
+    auto onError = [target, file](const std::string& error)
+    {
+        std::cerr << "\n[Objects] " << file << " FAILED: " << error << std::endl;
+        target->ready = false;
+        target->failed = true;
+    };
+    if (defines.empty())
+        pass.loader.LoadComputeShaderAsync(file, onComplete, onError);
+    else
+        pass.loader.LoadComputeShaderAsync(
+            file, [defines](const std::string& source) { return InsertComputeDefines(source, defines); }, onComplete, onError);
+}
 
-    // Color attribute
-    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Object),
-        (void*)offsetof(Object, color));
-    glEnableVertexAttribArray(6);
+static void ReleaseSimulationPass(SimulationPass& pass)
+{
+    if (pass.program) glDeleteProgram(pass.program);
+    pass.program = 0;
+    pass.ready = false;
+    pass.failed = false;
+    pass.uniformLocs.clear();
+}
 
-    // Equation ID attribute
-    glVertexAttribIPointer(7, 1, GL_INT, sizeof(Object),
-        (void*)offsetof(Object, equationID));
-    glEnableVertexAttribArray(7);
+// The build of a pass at localSize out of sized (indexed like LOCAL_SIZE_CANDIDATES), loaded on
+// first use; base until it has linked. usedLocalSize gets the size of the build returned.
+static const SimulationPass& SizedSimulationPass(const SimulationPass& base, SimulationPass* sized, TunedPass tuned,
+                                                 int localSize, const std::string& file, const char* const* uniformNames,
+                                                 int numUniforms, const std::string& defines, int& usedLocalSize)
+{
+    usedLocalSize = DEFAULT_LOCAL_SIZE;
+    const int* candidate = std::find(LOCAL_SIZE_CANDIDATES, LOCAL_SIZE_CANDIDATES + LOCAL_SIZE_CANDIDATE_COUNT, localSize);
+    if (localSize == DEFAULT_LOCAL_SIZE || candidate == LOCAL_SIZE_CANDIDATES + LOCAL_SIZE_CANDIDATE_COUNT) return base;
+
+    SimulationPass& pass = sized[candidate - LOCAL_SIZE_CANDIDATES];
+    LoadSimulationPass(pass, file, uniformNames, numUniforms, defines + LocalSizeDefine(localSize));
+    if (pass.failed) WorkgroupTuner::CandidateFailed(tuned, localSize);
+    if (!pass.ready) return base;
+    usedLocalSize = localSize;
+    return pass;
+}
 
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+// NARROWPHASE_SHAPE line of the collide.comp build of a shape bucket, none for bucket 0
+static std::string ShapeBucketDefine(int bucket)
+{
+    return bucket == 0 ? std::string() : "#define NARROWPHASE_SHAPE " + std::to_string(COLLISION_CIRCLE + bucket - 1) + "\n";
 }
 
-// Upload packed equation data to GPU
-static void UploadPackedEquationsToGPU()
+// Locations of the math.comp uniforms in the program about to run
+static const GLint* ComputeUniformLocations(GLuint program)
 {
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_allTokensSSBO);
-    if (!g_allTokens.empty())
-        glBufferData(GL_SHADER_STORAGE_BUFFER,
-            g_allTokens.size() * sizeof(int),
-            g_allTokens.data(),
-            GL_STATIC_DRAW);
-    else
+    if (g_computeUniformProgram != program)
     {
-        int dummy = 0;
-        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(int), &dummy, GL_STATIC_DRAW);
+        for (int i = 0; i < COMPUTE_UNIFORM_COUNT; i++)
+            g_computeUniformLocs[i] = glGetUniformLocation(program, s_computeUniformNames[i]);
+        g_computeUniformProgram = program;
     }
+    return g_computeUniformLocs;
+}
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_allConstantsSSBO);
-    if (!g_allConstants.empty())
-        glBufferData(GL_SHADER_STORAGE_BUFFER,
-            g_allConstants.size() * sizeof(float),
-            g_allConstants.data(),
-            GL_STATIC_DRAW);
-    else
+// Write the parameter block if anything changed since the last step
+static void UploadSimParams()
+{
+    if (g_simParamsUBO == 0)
     {
-        float dummy = 0.0f;
-        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(float), &dummy, GL_STATIC_DRAW);
+        glGenBuffers(1, &g_simParamsUBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, g_simParamsUBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(SimParams), nullptr, GL_DYNAMIC_DRAW);
+        g_simParamsDirty = true;
     }
-
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    if (g_simParamsDirty)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, g_simParamsUBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SimParams), &g_simParams);
+        bool periodic = g_simParams.boundaryMode == BOUNDARY_PERIODIC;
+        Broadphase::SetPeriodicBox(periodic ? g_simParams.worldMin.x : 0.0f, periodic ? g_simParams.worldMin.y : 0.0f,
+                                   periodic ? g_simParams.worldMax.x : 0.0f, periodic ? g_simParams.worldMax.y : 0.0f);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        g_simParamsDirty = false;
+    }
+    glBindBufferBase(GL_UNIFORM_BUFFER, SIM_PARAMS_BINDING, g_simParamsUBO);
 }
 
-// Upload constraint data to GPU
-static void UploadConstraintsToGPU()
+// Vec4s in math.comp's EquationConstants block on this device
+static int ConstantBlockVec4s()
 {
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_constraintsSSBO);
-    if (!g_allConstraints.empty())
-        glBufferData(GL_SHADER_STORAGE_BUFFER,
-            g_allConstraints.size() * sizeof(Constraint),
-            g_allConstraints.data(),
-            GL_DYNAMIC_DRAW);
-    else
+    if (g_constantBlockVec4s == 0)
     {
-        Constraint dummy = {};
-        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Constraint), &dummy, GL_DYNAMIC_DRAW);
+        GLint maxBytes = 0;
+        glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &maxBytes);
+        g_constantBlockVec4s = std::clamp(maxBytes / 16, 1024, MAX_CONSTANT_BLOCK_VEC4S);  // 16 KB is the GL minimum
     }
+    return g_constantBlockVec4s;
+}
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectConstraintsSSBO);
-    glBufferData(GL_SHADER_STORAGE_BUFFER,
-        Objects::MAX_OBJECTS * sizeof(ObjectConstraints),
-        g_objectConstraintMappings.data(),
-        GL_DYNAMIC_DRAW);
-
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+static std::string ConstantBlockDefine()
+{
+    return "#define CONSTANT_BLOCK_VEC4S " + std::to_string(ConstantBlockVec4s()) + "\n";
 }
 
-// Initialize contact buffer for warm starting
-static void InitializeContactBuffer()
+// Rewrite the constant block after the constants changed; large equation sets stay on the SSBO
+static void UploadConstantBlock()
 {
-    if (g_contactBufferSSBO == 0)
+    if (g_constantBlockDirty)
     {
-        glGenBuffers(1, &g_contactBufferSSBO);
+        g_constantBlockDirty = false;
+        int capacity = ConstantBlockVec4s() * 4;
+        g_constantsInBlock = g_constantSpace.end > 0 && g_constantSpace.end <= capacity;
+        if (g_constantsInBlock)
+        {
+            if (g_constantsUBO == 0)
+            {
+                glGenBuffers(1, &g_constantsUBO);
+                glBindBuffer(GL_UNIFORM_BUFFER, g_constantsUBO);
+                glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(capacity) * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+            }
+            glBindBuffer(GL_UNIFORM_BUFFER, g_constantsUBO);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, g_constantSpace.end * sizeof(float), g_allConstants.data());
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+    }
+    if (g_constantsInBlock) glBindBufferBase(GL_UNIFORM_BUFFER, EQUATION_CONSTANTS_BINDING, g_constantsUBO);
+}
 
-        // Allocate space for contacts (MAX_OBJECTS * MAX_CONTACTS_PER_OBJECT * sizeof(ContactPoint))
-        // Using 64 bytes per contact point as in GLSL
-        size_t contactBufferSize = Objects::MAX_OBJECTS * 4 * 64; // 4 contacts per object
+// ============================================================================
+// Readback ring (created on the first host read)
+// ============================================================================
+static bool InitReadbackRing()
+{
+    if (g_readbackUnavailable) return false;
+    if (g_readback[0].mapped) return true;
+    if (!GLAD_GL_VERSION_4_4)
+    {
+        g_readbackUnavailable = true;
+        return false;
+    }
 
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_contactBufferSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER,
-            contactBufferSize,
-            nullptr,  // Initialize with zeros
-            GL_DYNAMIC_COPY);
+    const GLsizeiptr size = static_cast<GLsizeiptr>(Objects::GetObjectCapacity()) * sizeof(Object);
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    for (ReadbackSlot& slot : g_readback)
+    {
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+        slot.mapped = static_cast<const Object*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+        if (!slot.mapped) g_readbackUnavailable = true;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
 
-        // Clear buffer to zeros
-        void* data = glMapBuffer(GL_SHADER_STORAGE_BUFFER, GL_WRITE_ONLY);
-        if (data)
+    if (g_readbackUnavailable)
+    {
+        std::cerr << "[Objects] Persistent readback buffers unavailable, reads wait on the GPU" << std::endl;
+        for (ReadbackSlot& slot : g_readback)
         {
-            memset(data, 0, contactBufferSize);
-            glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+            if (slot.buffer) glDeleteBuffers(1, &slot.buffer);  // Deleting unmaps
+            slot = ReadbackSlot{};
         }
+        return false;
+    }
+    return true;
+}
 
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+static void ReleaseReadbackRing()
+{
+    for (ReadbackSlot& slot : g_readback)
+    {
+        if (slot.fence) glDeleteSync(slot.fence);
+        if (slot.buffer) glDeleteBuffers(1, &slot.buffer);
+        slot = ReadbackSlot{};
     }
+    g_readbackNext = 0;
+    g_readbackUnavailable = false;
+    g_stepsSinceRead = READBACK_IDLE_STEPS;
+    g_objectGeneration++;
 }
 
-// Compact constraint array by removing invalid constraints
-void Objects::CompactConstraintArray()
+// Keep the state the objects start from on the GPU, so a reset is one copy per buffer
+static void CaptureInitialState(int sourceIndex)
 {
-    std::vector<Constraint> compacted;
-    std::unordered_map<int, int> oldToNewIndex;
+    g_initialStateCount = g_numObjects;
+    g_initialEquationsStale = false;
+    if (g_numObjects <= 0) return;
+
+    BufferHelpers::EnsureBufferCapacity(g_initialStateSSBO, static_cast<GLsizeiptr>(g_objectCapacity) * sizeof(Object));
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);  // The scatter of the host edits
+    glBindBuffer(GL_COPY_READ_BUFFER, g_objectSSBO[sourceIndex]);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, g_initialStateSSBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, g_numObjects * sizeof(Object));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
 
-    // Build new compacted array and mapping
-    int newIndex = 0;
-    for (int oldIndex = 0; oldIndex < static_cast<int>(g_allConstraints.size()); oldIndex++)
+// Copy the current state of an object buffer into the next slot
+static void CopyToReadbackSlot(int sourceIndex)
+{
+    // The slot's last copy is three copies old; the host only reads it inside ReadObjects
+    ReadbackSlot& slot = g_readback[g_readbackNext];
+    if (slot.fence) glDeleteSync(slot.fence);
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, g_objectSSBO[sourceIndex]);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, g_numObjects * sizeof(Object));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    g_readbackBytes += static_cast<uint64_t>(g_numObjects) * sizeof(Object);
+
+    // Coherent mapping: the copy is visible to the host once this fence has signalled
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.sourceIndex = sourceIndex;
+    slot.numObjects = g_numObjects;
+    slot.generation = g_objectGeneration;
+    g_readbackNext = (g_readbackNext + 1) % READBACK_SLOTS;
+}
+
+// Copy the state a step produced into the next slot, while the host keeps reading
+static void CaptureReadback(int sourceIndex)
+{
+    g_objectGeneration++;
+    if (g_stepsSinceRead >= READBACK_IDLE_STEPS || !g_readback[0].mapped || g_numObjects <= 0) return;
+    g_stepsSinceRead++;
+    CopyToReadbackSlot(sourceIndex);
+}
+
+// Copy of the current state of an object buffer covering [0, end), nullptr if there is none
+static const ReadbackSlot* CurrentReadback(int sourceIndex, int end)
+{
+    for (ReadbackSlot& slot : g_readback)
     {
-        if (g_allConstraints[oldIndex].type != -1)
-        {
-            oldToNewIndex[oldIndex] = newIndex;
-            compacted.push_back(g_allConstraints[oldIndex]);
-            newIndex++;
-        }
+        if (!slot.fence || slot.generation != g_objectGeneration || slot.sourceIndex != sourceIndex) continue;
+        if (end > slot.numObjects) return nullptr;
+
+        // Usually signalled already: the copy was queued when the step was
+        GLenum status;
+        do status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+        while (status == GL_TIMEOUT_EXPIRED);
+        return (status == GL_WAIT_FAILED) ? nullptr : &slot;
     }
+    return nullptr;
+}
 
-    // Update constraint offsets in object mappings
-    for (int i = 0; i < MAX_OBJECTS; i++)
+// CurrentReadback() for a host read. The second read of a state no step copied takes a copy
+// of it, so the reads after it (get_object over many objects in one frame) come from host
+// memory, and the steps after that copy their state as they would for whole-array reads.
+static const ReadbackSlot* HostReadback(int sourceIndex, int end)
+{
+    if (const ReadbackSlot* slot = CurrentReadback(sourceIndex, end)) return slot;
+    if (g_uncachedReadGeneration != g_objectGeneration)
     {
-        ObjectConstraints& mapping = g_objectConstraintMappings[i];
-        if (mapping.numConstraints > 0)
-        {
-            int oldOffset = mapping.constraintOffset;
-            auto it = oldToNewIndex.find(oldOffset);
-            if (it != oldToNewIndex.end())
-                mapping.constraintOffset = it->second;
-            else
-            {
-                // Invalidate mapping if offset not found
-                mapping.objectID = -1;
-                mapping.constraintOffset = 0;
-                mapping.numConstraints = 0;
-            }
-        }
+        g_uncachedReadGeneration = g_objectGeneration;
+        g_uncachedReads = 0;
     }
+    if (++g_uncachedReads < 2 || g_numObjects <= 0 || !InitReadbackRing()) return nullptr;
 
-    g_allConstraints = compacted;
+    g_stepsSinceRead = 0;
+    CopyToReadbackSlot(sourceIndex);
+    return CurrentReadback(sourceIndex, end);
 }
 
-// Add a constraint to an object
-void Objects::AddConstraint(int objectIndex, const Constraint& constraint)
+// Objects [first, first + count) of an object buffer, from the copy of its current state when there is one
+static void ReadObjects(int sourceIndex, int first, int count, Object* out)
 {
-    if (objectIndex < 0 || objectIndex >= g_numObjects)
+    if (const ReadbackSlot* slot = HostReadback(sourceIndex, first + count))
     {
-        std::cerr << "[Objects] Invalid object index: " << objectIndex << std::endl;
+        std::memcpy(out, slot->mapped + first, count * sizeof(Object));
         return;
     }
 
-    // Validate constraint type-specific parameters
-    if (constraint.type == CONSTRAINT_DISTANCE)
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[sourceIndex]);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, first * sizeof(Object), count * sizeof(Object), out);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    g_readbackBytes += static_cast<uint64_t>(count) * sizeof(Object);
+}
+
+// Copy the ObjectField bits of src into dst
+static void MergeObjectFields(Object& dst, const Object& src, unsigned int fieldMask)
+{
+    if (fieldMask & OBJECT_FIELD_POSITION) dst.position = src.position;
+    if (fieldMask & OBJECT_FIELD_VELOCITY) dst.velocity = src.velocity;
+    if (fieldMask & OBJECT_FIELD_MASS) dst.mass = src.mass;
+    if (fieldMask & OBJECT_FIELD_CHARGE) dst.charge = src.charge;
+    if (fieldMask & OBJECT_FIELD_ROTATION) dst.visualData.z = src.visualData.z;
+    if (fieldMask & OBJECT_FIELD_ANGULAR_VELOCITY) dst.visualData.w = src.visualData.w;
+    if (fieldMask & OBJECT_FIELD_SIZE) { dst.visualData.x = src.visualData.x; dst.visualData.y = src.visualData.y; }
+    if (fieldMask & OBJECT_FIELD_COLOR) dst.color = src.color;
+    if (fieldMask & OBJECT_FIELD_SKIN) dst.visualSkinType = src.visualSkinType;
+    if (fieldMask & OBJECT_WRITE_EQUATION) dst.equationID = src.equationID;
+}
+
+static void QueueObjectWrite(int index, unsigned int fieldMask, const Object& values)
+{
+    int& slot = g_pendingWriteSlot[index];
+    if (slot < 0)
     {
-        if (constraint.targetObjectID < 0 || constraint.targetObjectID >= g_numObjects)
+        slot = static_cast<int>(g_pendingWrites.size());
+        ObjectWrite write{};
+        write.index = static_cast<GLuint>(index);
+        write.fieldMask = fieldMask;
+        write.values = values;
+        g_pendingWrites.push_back(write);
+        return;
+    }
+
+    ObjectWrite& write = g_pendingWrites[slot];
+    if (fieldMask & OBJECT_WRITE_WHOLE) write.values = values;
+    else MergeObjectFields(write.values, values, fieldMask);
+    write.fieldMask |= fieldMask;
+}
+
+static void DiscardObjectWrites()
+{
+    for (const ObjectWrite& write : g_pendingWrites) g_pendingWriteSlot[write.index] = -1;
+    g_pendingWrites.clear();
+}
+
+// Without the scatter shader: resolve every record to a whole object on the host and upload each
+// run of consecutive indices with one glBufferSubData per buffer
+static void UploadObjectWrites()
+{
+    std::vector<std::pair<int, Object>> resolved;
+    resolved.reserve(g_pendingWrites.size());
+    for (const ObjectWrite& write : g_pendingWrites)
+    {
+        Object p = write.values;
+        if (!(write.fieldMask & OBJECT_WRITE_WHOLE))
         {
-            std::cerr << "[Objects] Distance constraint has invalid target: "
-                << constraint.targetObjectID << std::endl;
-            return;
+            ReadObjects(g_currentObjectBuffer, static_cast<int>(write.index), 1, &p);
+            MergeObjectFields(p, write.values, write.fieldMask);
         }
-        if (constraint.targetObjectID == objectIndex)
+        resolved.emplace_back(static_cast<int>(write.index), p);
+    }
+    std::sort(resolved.begin(), resolved.end(),
+              [](const std::pair<int, Object>& a, const std::pair<int, Object>& b) { return a.first < b.first; });
+
+    std::vector<Object> run;
+    for (size_t begin = 0; begin < resolved.size();)
+    {
+        size_t end = begin + 1;
+        while (end < resolved.size() && resolved[end].first == resolved[end - 1].first + 1) end++;
+
+        run.clear();
+        for (size_t i = begin; i < end; i++) run.push_back(resolved[i].second);
+        for (int i = 0; i < 2; i++)
         {
-            std::cerr << "[Objects] Cannot create distance constraint to self!" << std::endl;
-            return;
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[i]);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, resolved[begin].first * sizeof(Object),
+                            run.size() * sizeof(Object), run.data());
         }
+        begin = end;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
 
-        if (constraint.param1 <= 0.0f)  // rest_length must be positive
+// True when at least one active object has collisions enabled and a collision shape
+static bool HasCollidableObjects()
+{
+    if (g_collidableCountDirty || g_collidableCountObjects != g_numObjects)
+    {
+        g_numCollidableObjects = 0;
+        for (int i = 0; i < g_numObjects; i++)
         {
-            std::cerr << "[Objects] Distance constraint has invalid rest length: "
-                << constraint.param1 << std::endl;
-            return;
+            const CollisionProperties& props = g_collisionProperties[i];
+            if (props.enabled != 0 && props.shapeType != COLLISION_NONE)
+                g_numCollidableObjects++;
         }
+        g_collidableCountObjects = g_numObjects;
+        g_collidableCountDirty = false;
+        g_shapeBucketObjects = -1;  // Shapes or indices moved
+        g_broadphaseStale = true;
+        StaticColliders::Invalidate();
     }
-    else if (constraint.type == CONSTRAINT_BOUNDARY)
-    {
-        float minX = (constraint.param1 < constraint.param2) ? constraint.param1 : constraint.param2;
-        float maxX = (constraint.param1 > constraint.param2) ? constraint.param1 : constraint.param2;
-        float minY = (constraint.param3 < constraint.param4) ? constraint.param3 : constraint.param4;
-        float maxY = (constraint.param3 > constraint.param4) ? constraint.param3 : constraint.param4;
+    return g_numCollidableObjects > 0;
+}
 
-        if (maxX - minX < 0.01f || maxY - minY < 0.01f)
+// Group the objects by collision shape for the narrowphase; false when the scene holds fewer
+// than two shapes, as one dispatch is already coherent then. Call after HasCollidableObjects().
+static bool UpdateShapeBuckets()
+{
+    if (g_shapeBucketObjects != g_numObjects)
+    {
+        int counts[NARROWPHASE_SHAPES + 1] = {};
+        auto bucketOf = [](const CollisionProperties& props)
         {
-            std::cerr << "[Objects] Boundary constraint has invalid bounds!" << std::endl;
-            return;
-        }
+            bool collides = props.enabled != 0 && props.shapeType >= COLLISION_CIRCLE && props.shapeType <= COLLISION_POLYGON;
+            return collides ? props.shapeType : 0;
+        };
+        for (int i = 0; i < g_numObjects; i++) counts[bucketOf(g_collisionProperties[i])]++;
+
+        g_shapeBucketStart[0] = 0;
+        for (int b = 0; b <= NARROWPHASE_SHAPES; b++) g_shapeBucketStart[b + 1] = g_shapeBucketStart[b] + counts[b];
+
+        // Counting sort, so each bucket keeps index order
+        int next[NARROWPHASE_SHAPES + 1];
+        std::copy(g_shapeBucketStart, g_shapeBucketStart + NARROWPHASE_SHAPES + 1, next);
+        g_shapeOrder.resize(g_numObjects);
+        for (int i = 0; i < g_numObjects; i++) g_shapeOrder[next[bucketOf(g_collisionProperties[i])]++] = static_cast<GLuint>(i);
+
+        g_shapeBucketObjects = g_numObjects;
+        g_shapeOrderUploaded = false;
     }
 
-    ObjectConstraints& mapping = g_objectConstraintMappings[objectIndex];
+    int shapes = 0;
+    for (int b = 1; b <= NARROWPHASE_SHAPES; b++)
+        if (g_shapeBucketStart[b + 1] > g_shapeBucketStart[b]) shapes++;
+    return shapes > 1;
+}
 
-    // Add constraint to object's constraint list
-    if (mapping.numConstraints == 0)
+// True when the token stream contains an object reference, including inside derivative bodies
+static bool ReadsOtherObjects(const std::vector<int>& tokens)
+{
+    size_t i = 0;
+    while (i < tokens.size())
     {
-        mapping.objectID = objectIndex;
-        mapping.constraintOffset = static_cast<int>(g_allConstraints.size());
-        mapping.numConstraints = 1;
-        g_allConstraints.push_back(constraint);
+        int token = tokens[i++];
+        if (token == GPUTokens::TOKEN_OBJECT_REF || token == GPUTokens::TOKEN_PAIR_SUM) return true;
+        if (token == GPUTokens::TOKEN_NUMBER || token == GPUTokens::TOKEN_VARIABLE ||
+            token == GPUTokens::TOKEN_TEMP_STORE || token == GPUTokens::TOKEN_TEMP_LOAD ||
+            token == GPUTokens::TOKEN_BRANCH || token == GPUTokens::TOKEN_JUMP) i += 1;
+        else if (token == GPUTokens::TOKEN_PRELUDE) i += 2;
+        else if (token == GPUTokens::TOKEN_DERIVATIVE) i += 4;  // Header only; the body is scanned inline
     }
-    else
-    {
-        int nextSlot = mapping.constraintOffset + mapping.numConstraints;
-        bool canAppend = (nextSlot == static_cast<int>(g_allConstraints.size()));
+    return false;
+}
 
-        if (canAppend)
+// True when the token stream reads a variable in [firstHash, lastHash], including inside derivative and sum_j() bodies
+static bool ReadsVariableRange(const std::vector<int>& tokens, int firstHash, int lastHash)
+{
+    size_t i = 0;
+    while (i < tokens.size())
+    {
+        int token = tokens[i++];
+        if (token == GPUTokens::TOKEN_VARIABLE)
         {
-            g_allConstraints.push_back(constraint);
-            mapping.numConstraints++;
+            int varHash = (i < tokens.size()) ? tokens[i] : 0;
+            if (varHash >= firstHash && varHash <= lastHash) return true;
+            i += 1;
         }
-        else
-        {
-            // Need to relocate constraints to maintain contiguous storage
-            std::vector<Constraint> existingConstraints;
-            for (int i = 0; i < mapping.numConstraints; i++)
-                existingConstraints.push_back(g_allConstraints[mapping.constraintOffset + i]);
+        else if (token == GPUTokens::TOKEN_NUMBER || token == GPUTokens::TOKEN_PAIR_REF ||
+                 token == GPUTokens::TOKEN_TEMP_STORE || token == GPUTokens::TOKEN_TEMP_LOAD ||
+                 token == GPUTokens::TOKEN_BRANCH || token == GPUTokens::TOKEN_JUMP) i += 1;
+        else if (token == GPUTokens::TOKEN_OBJECT_REF || token == GPUTokens::TOKEN_PRELUDE) i += 2;
+        else if (token == GPUTokens::TOKEN_PAIR_SUM || token == GPUTokens::TOKEN_DERIVATIVE)
+            i += 4;  // Header only; the body is scanned inline
+    }
+    return false;
+}
 
-            // Mark old constraints for removal
-            for (int i = 0; i < mapping.numConstraints; i++)
-                g_allConstraints[mapping.constraintOffset + i].type = -1;
+// Barnes-Hut (or particle-mesh) accelerations
+static bool ReadsLongRangeAccel(const std::vector<int>& tokens)
+{
+    return ReadsVariableRange(tokens, VariableHashes::VAR_HASH_GRAV_AX, VariableHashes::VAR_HASH_COUL_AY);
+}
 
-            // Create new contiguous block
-            int newOffset = static_cast<int>(g_allConstraints.size());
-            for (const auto& c : existingConstraints)
-                g_allConstraints.push_back(c);
-            g_allConstraints.push_back(constraint);
+// SPH fluid accelerations, density or pressure; such an equation makes its objects fluid
+static bool ReadsFluidState(const std::vector<int>& tokens)
+{
+    return ReadsVariableRange(tokens, VariableHashes::VAR_HASH_SPH_AX, VariableHashes::VAR_HASH_SPH_P);
+}
 
-            mapping.constraintOffset = newOffset;
-            mapping.numConstraints = static_cast<int>(existingConstraints.size()) + 1;
-            CompactConstraintArray();
-        }
-    }
+// rand()/randn() call sites
+static bool ReadsRandom(const std::vector<int>& tokens)
+{
+    return ReadsVariableRange(tokens, VariableHashes::VAR_HASH_RAND_0, VariableHashes::VAR_HASH_RANDN_7);
+}
 
-    UploadConstraintsToGPU();
+// s0..s7 state registers
+static bool ReadsStateRegisters(const std::vector<int>& tokens)
+{
+    return ReadsVariableRange(tokens, VariableHashes::VAR_HASH_STATE_0, VariableHashes::VAR_HASH_STATE_7);
 }
 
-// Remove a constraint from an object
-void Objects::RemoveConstraint(int objectIndex, int constraintLocalIndex)
+// True when one of the "sK = expr" updates of the equation satisfies reads
+static bool AnyStateUpdate(const GPUSerializedEquation& gpu_eq, bool (*reads)(const std::vector<int>&))
 {
-    if (objectIndex < 0 || objectIndex >= g_numObjects) return;
+    for (const std::vector<int>& tokens : gpu_eq.tokenBuffer_state)
+        if (reads(tokens)) return true;
+    return false;
+}
 
-    ObjectConstraints& mapping = g_objectConstraintMappings[objectIndex];
-    if (constraintLocalIndex < 0 || constraintLocalIndex >= mapping.numConstraints) return;
+// Record the pair reduction bodies of one serialized component; tokenOffset is where it starts in g_allTokens
+static bool RegisterPairSums(int eqID, const std::vector<int>& tokens, const std::vector<float>& constants,
+                             int tokenOffset, int constantOffset)
+{
+    bool found = false;
+    size_t i = 0;
+    while (i < tokens.size())
+    {
+        int token = tokens[i++];
+        if (token == GPUTokens::TOKEN_NUMBER || token == GPUTokens::TOKEN_VARIABLE ||
+            token == GPUTokens::TOKEN_TEMP_STORE || token == GPUTokens::TOKEN_TEMP_LOAD ||
+            token == GPUTokens::TOKEN_BRANCH || token == GPUTokens::TOKEN_JUMP) i += 1;
+        else if (token == GPUTokens::TOKEN_OBJECT_REF || token == GPUTokens::TOKEN_PRELUDE) i += 2;
+        else if (token == GPUTokens::TOKEN_DERIVATIVE)
+            i += (i + 3 < tokens.size()) ? 4 + tokens[i + 3] : tokens.size();
+        else if (token == GPUTokens::TOKEN_PAIR_SUM && i + 3 < tokens.size())
+        {
+            int slot = tokens[i];
+            int reduction = tokens[i + 1];
+            int radiusIndex = tokens[i + 2];
+            int bodyCount = tokens[i + 3];
+            if (slot >= 0 && slot < MAX_PAIR_SUMS_PER_EQUATION)
+            {
+                PairSumExpression& expr = g_pairSumExpressions[eqID * MAX_PAIR_SUMS_PER_EQUATION + slot];
+                expr.tokenOffset = tokenOffset + static_cast<int>(i) + 4;
+                expr.tokenCount = bodyCount;
+                expr.constantOffset = constantOffset;
+                expr.reduction = reduction;
+                expr.radius = 0.0f;
+                expr.used = 1;
+                expr._pad0 = 0;
+                expr._pad1 = 0;
+
+                if (radiusIndex >= 0 && radiusIndex < static_cast<int>(constants.size()))
+                {
+                    expr.radius = constants[radiusIndex];
+                    g_maxNeighbourRadius = std::max(g_maxNeighbourRadius, expr.radius);
+                }
+                else
+                {
+                    g_equationsUseAllPairs = true;
+                }
+                found = true;
+            }
+            i += 4 + bodyCount;
+        }
+    }
+    return found;
+}
 
-    // Mark constraint as invalid and shift others
-    int globalIndex = mapping.constraintOffset + constraintLocalIndex;
-    g_allConstraints[globalIndex].type = -1;
+static void UploadPairSumExpressionsToGPU()
+{
+    if (g_pairSumExpressionsSSBO == 0) glGenBuffers(1, &g_pairSumExpressionsSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_pairSumExpressionsSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, g_pairSumExpressions.size() * sizeof(PairSumExpression),
+        g_pairSumExpressions.data(), GL_DYNAMIC_DRAW);
 
-    // Shift remaining constraints down
-    for (int i = constraintLocalIndex; i < mapping.numConstraints - 1; i++)
+    BufferHelpers::EnsureBufferCapacity(g_pairSumsSSBO,
+        static_cast<GLsizeiptr>(Objects::GetObjectCapacity()) * MAX_PAIR_SUMS_PER_EQUATION * sizeof(float));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    g_pairSumExpressionsDirty = false;
+}
+
+// Record the hoisted bodies of one serialized component. A slot hoisted by several components
+// holds the same expression, so the first one is kept.
+static bool RegisterPreludes(int eqID, const std::vector<int>& tokens, int tokenOffset, int constantOffset)
+{
+    bool found = false;
+    size_t i = 0;
+    while (i < tokens.size())
     {
-        int srcGlobal = mapping.constraintOffset + i + 1;
-        int dstGlobal = mapping.constraintOffset + i;
-        g_allConstraints[dstGlobal] = g_allConstraints[srcGlobal];
+        int token = tokens[i++];
+        if (token == GPUTokens::TOKEN_NUMBER || token == GPUTokens::TOKEN_VARIABLE ||
+            token == GPUTokens::TOKEN_TEMP_STORE || token == GPUTokens::TOKEN_TEMP_LOAD ||
+            token == GPUTokens::TOKEN_BRANCH || token == GPUTokens::TOKEN_JUMP) i += 1;
+        else if (token == GPUTokens::TOKEN_OBJECT_REF) i += 2;
+        else if (token == GPUTokens::TOKEN_PAIR_SUM || token == GPUTokens::TOKEN_DERIVATIVE)
+            i += (i + 3 < tokens.size()) ? 4 + tokens[i + 3] : tokens.size();  // Their passes run the bodies in place
+        else if (token == GPUTokens::TOKEN_PRELUDE && i + 1 < tokens.size())
+        {
+            int slot = tokens[i];
+            int bodyCount = tokens[i + 1];
+            if (slot >= 0 && slot < MAX_PRELUDE_SLOTS && !g_preludeExpressions[eqID * MAX_PRELUDE_SLOTS + slot].used)
+            {
+                PreludeExpression& expr = g_preludeExpressions[eqID * MAX_PRELUDE_SLOTS + slot];
+                expr.tokenOffset = tokenOffset + static_cast<int>(i) + 2;
+                expr.tokenCount = bodyCount;
+                expr.constantOffset = constantOffset;
+                expr.used = 1;
+                found = true;
+            }
+            i += 2;  // The body follows in place
+        }
     }
+    return found;
+}
 
-    // Mark last slot as invalid
-    g_allConstraints[mapping.constraintOffset + mapping.numConstraints - 1].type = -1;
-    mapping.numConstraints--;
-
-    // Clear mapping if no constraints remain
-    if (mapping.numConstraints == 0)
+// Pack every equation's slots up to its last used one and point its mapping at them
+static void UploadPreludeExpressionsToGPU()
+{
+    std::vector<PreludeExpression> packed;
+    bool mappingsChanged = false;
+    for (int id = 0; id < Objects::MAX_EQUATIONS; id++)
     {
-        mapping.objectID = -1;
-        mapping.constraintOffset = 0;
+        int slots = 0;
+        for (int slot = 0; slot < MAX_PRELUDE_SLOTS; slot++)
+            if (g_preludeExpressions[id * MAX_PRELUDE_SLOTS + slot].used) slots = slot + 1;
+
+        int offset = slots > 0 ? static_cast<int>(packed.size()) : -1;
+        packed.insert(packed.end(), g_preludeExpressions.begin() + id * MAX_PRELUDE_SLOTS,
+                      g_preludeExpressions.begin() + id * MAX_PRELUDE_SLOTS + slots);
+        if (g_equationMappings[id].preludeOffset != offset)
+        {
+            g_equationMappings[id].preludeOffset = offset;
+            mappingsChanged = true;
+        }
     }
+    g_preludeCount = static_cast<int>(packed.size());
 
-    CompactConstraintArray();
-    UploadConstraintsToGPU();
+    if (g_preludeCount > 0)
+    {
+        if (g_preludeExpressionsSSBO == 0) glGenBuffers(1, &g_preludeExpressionsSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_preludeExpressionsSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, packed.size() * sizeof(PreludeExpression), packed.data(), GL_DYNAMIC_DRAW);
+    }
+    if (mappingsChanged && g_mappingsSSBO)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_mappingsSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, Objects::MAX_EQUATIONS * sizeof(EquationMapping), g_equationMappings.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    g_preludeExpressionsDirty = false;
 }
 
-// Clear all constraints from an object
-void Objects::ClearConstraints(int objectIndex)
+// Features one serialized component reaches; pair reduction bodies are scanned like the rest
+static int ComponentComputeFeatures(int tokenOffset, int tokenCount)
 {
-    if (objectIndex < 0 || objectIndex >= g_numObjects) return;
+    int features = 0;
+    int end = std::min(tokenOffset + tokenCount, static_cast<int>(g_allTokens.size()));
+    int i = std::max(tokenOffset, 0);
+    while (i < end)
+    {
+        int token = g_allTokens[i++];
+        if (token == GPUTokens::TOKEN_VARIABLE)
+        {
+            if (i < end && g_allTokens[i] == VariableHashes::VAR_HASH_I) features |= COMPUTE_FEATURE_COMPLEX;
+            i += 1;
+        }
+        else if (token == GPUTokens::TOKEN_NUMBER || token == GPUTokens::TOKEN_TEMP_STORE ||
+                 token == GPUTokens::TOKEN_TEMP_LOAD || token == GPUTokens::TOKEN_BRANCH ||
+                 token == GPUTokens::TOKEN_JUMP) i += 1;
+        else if (token == GPUTokens::TOKEN_OBJECT_REF || token == GPUTokens::TOKEN_PRELUDE) i += 2;
+        else if (token == GPUTokens::TOKEN_PAIR_SUM) i += 4;
+        else if (token == GPUTokens::TOKEN_DERIVATIVE)
+        {
+            // Derivative results are complex, and the body is evaluated by the derivative evaluators
+            return COMPUTE_FEATURE_DERIVATIVES | COMPUTE_FEATURE_COMPLEX;
+        }
+        else if (token == GPUTokens::TOKEN_POW || token == GPUTokens::TOKEN_SIN || token == GPUTokens::TOKEN_COS ||
+                 token == GPUTokens::TOKEN_TAN || token == GPUTokens::TOKEN_SQRT || token == GPUTokens::TOKEN_LOG ||
+                 token == GPUTokens::TOKEN_EXP || token == GPUTokens::TOKEN_REAL || token == GPUTokens::TOKEN_IMAG ||
+                 token == GPUTokens::TOKEN_CONJ || token == GPUTokens::TOKEN_ARG)
+        {
+            // The serializer emits the *_R opcodes where operands are known real; these may go complex
+            features |= COMPUTE_FEATURE_COMPLEX;
+        }
+    }
+    return features;
+}
 
-    ObjectConstraints& mapping = g_objectConstraintMappings[objectIndex];
-    if (mapping.numConstraints == 0) return;
+// Features the registered equations need, recomputed once per change of the equation set
+static int EquationComputeFeatures()
+{
+    if (g_computeFeaturesRevision == g_equationRevision) return g_computeFeatures;
 
-    // Mark all constraints as invalid
-    for (int i = 0; i < mapping.numConstraints; i++)
+    int features = 0;
+    for (size_t id = 0; id < g_equationMappings.size() && id < g_equationKeys.size(); ++id)
     {
-        int globalIndex = mapping.constraintOffset + i;
-        if (globalIndex >= 0 && globalIndex < static_cast<int>(g_allConstraints.size()))
-            g_allConstraints[globalIndex].type = -1;
+        if (g_equationKeys[id].empty()) continue;
+        const EquationMapping& m = g_equationMappings[id];
+        if (m.tokenCount_r > 0 || m.tokenCount_g > 0 || m.tokenCount_b > 0 || m.tokenCount_a > 0)
+            features |= COMPUTE_FEATURE_COLOR;
+        if (g_equationAllocations[id].stackDepth > SMALL_GPU_STACK_ENTRIES) features |= COMPUTE_FEATURE_DEEP_STACK;
+
+        features |= ComponentComputeFeatures(m.tokenOffset_ax, m.tokenCount_ax);
+        features |= ComponentComputeFeatures(m.tokenOffset_ay, m.tokenCount_ay);
+        features |= ComponentComputeFeatures(m.tokenOffset_angular, m.tokenCount_angular);
+        features |= ComponentComputeFeatures(m.tokenOffset_r, m.tokenCount_r);
+        features |= ComponentComputeFeatures(m.tokenOffset_g, m.tokenCount_g);
+        features |= ComponentComputeFeatures(m.tokenOffset_b, m.tokenCount_b);
+        features |= ComponentComputeFeatures(m.tokenOffset_a, m.tokenCount_a);
+        if (m.tokenCount_state > 0)  // The updates follow their count header back to back
+            features |= ComponentComputeFeatures(m.tokenOffset_state + MAX_STATE_REGISTERS, m.tokenCount_state - MAX_STATE_REGISTERS);
     }
 
-    // Reset object's constraint mapping
-    mapping.objectID = -1;
-    mapping.constraintOffset = 0;
-    mapping.numConstraints = 0;
-
-    CompactConstraintArray();
-    UploadConstraintsToGPU();
+    g_computeFeatures = features;
+    g_computeFeaturesRevision = g_equationRevision;
+    return features;
 }
 
-// Clear all constraints from all objects
-void Objects::ClearAllConstraints()
+// Guards stay in unless fast math is on and no roll back is being stepped past
+static bool UseFastMath()
 {
-    for (int i = 0; i < MAX_OBJECTS; i++)
-        g_objectConstraintMappings[i] = ObjectConstraints();
-    g_allConstraints.clear();
-    UploadConstraintsToGPU();
+    return g_fastMath && g_nanGuardedSteps == 0;
 }
 
-// Get all constraints for an object
-std::vector<Constraint> Objects::GetConstraints(int objectIndex)
+static int RequiredComputeFeatures()
 {
-    std::vector<Constraint> result;
-    if (objectIndex < 0 || objectIndex >= g_numObjects) return result;
+    return EquationComputeFeatures() | (UseFastMath() ? 0 : COMPUTE_FEATURE_SAFE_MATH) |
+           (ObjectSensitivity::GetCount() > 0 ? COMPUTE_FEATURE_SENSITIVITIES : 0);
+}
 
-    const ObjectConstraints& mapping = g_objectConstraintMappings[objectIndex];
-    if (mapping.numConstraints == 0) return result;
+// #define lines switching off what features leaves out, and their place right after #version
+static std::string ComputeFeatureDefines(int features)
+{
+    std::string defines;
+    if (!(features & COMPUTE_FEATURE_COLOR)) defines += "#define HAS_COLOR_EQ 0\n";
+    if (!(features & COMPUTE_FEATURE_DERIVATIVES)) defines += "#define HAS_DERIVATIVES 0\n";
+    if (!(features & COMPUTE_FEATURE_COMPLEX)) defines += "#define HAS_COMPLEX 0\n";
+    if (!(features & COMPUTE_FEATURE_SAFE_MATH)) defines += "#define SAFE_MATH 0\n";
+    if (!(features & COMPUTE_FEATURE_SENSITIVITIES)) defines += "#define HAS_SENSITIVITIES 0\n";
+    if (!(features & COMPUTE_FEATURE_DEEP_STACK))
+        defines += "#define RPN_STACK_ENTRIES " + std::to_string(SMALL_GPU_STACK_ENTRIES) + "\n";
+    return defines + ConstantBlockDefine();  // Not a feature: the same on every build of a device
+}
 
-    // Copy constraints to result vector
-    for (int i = 0; i < mapping.numConstraints; i++)
-        result.push_back(g_allConstraints[mapping.constraintOffset + i]);
+// g_computeVariants key: the feature bits, with the work-group size above them unless it is the default
+static int ComputeVariantKey(int features, int localSize)
+{
+    return localSize == DEFAULT_LOCAL_SIZE ? features : features | (localSize << 8);
+}
 
+static std::string InsertComputeDefines(const std::string& source, const std::string& defines)
+{
+    if (defines.empty()) return source;
+    size_t version = source.find("#version");
+    if (version == std::string::npos) return std::string();
+    size_t lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos) return std::string();
+    std::string result = source;
+    result.insert(lineEnd + 1, defines);
     return result;
 }
 
-// Update an existing constraint
-void Objects::UpdateConstraint(int objectIndex, int constraintLocalIndex, const Constraint& newConstraint)
+// math.comp variant pass 1 runs with (the physics parameters come from the shared SimParams block),
+// at localSize if that build exists and at the default size otherwise; usedLocalSize gets the one
+// chosen. Until the variant for the current feature set is built, the full build runs. Tuning
+// times the interpreter, so the compiled equations wait for it to finish.
+static GLuint ActiveComputeProgram(int localSize = DEFAULT_LOCAL_SIZE, int* usedLocalSize = nullptr)
 {
-    if (objectIndex < 0 || objectIndex >= g_numObjects) return;
+    bool compiled = g_programCompiledEquations && !(g_compiledEquationsFastMath && !UseFastMath()) &&
+                    !WorkgroupTuner::IsTuning();
+    int features = RequiredComputeFeatures();
+    for (int size : { localSize, DEFAULT_LOCAL_SIZE })
+    {
+        if (usedLocalSize) *usedLocalSize = size;
+        if (compiled && g_compiledLocalSize == size) return g_programCompiledEquations;
+        if (features == COMPUTE_FEATURES_ALL && size == DEFAULT_LOCAL_SIZE) break;
 
-    ObjectConstraints& mapping = g_objectConstraintMappings[objectIndex];
-    if (constraintLocalIndex < 0 || constraintLocalIndex >= mapping.numConstraints) return;
+        auto it = g_computeVariants.find(ComputeVariantKey(features, size));
+        if (it != g_computeVariants.end()) return it->second;
+    }
+    return g_programCompute;
+}
 
-    // Validate updated constraint
-    if (newConstraint.type == CONSTRAINT_DISTANCE)
+// Build the math.comp variant of the current feature set unless it exists or is on its way: at the
+// size the tuner wants first, then at the default size it falls back to
+static void RequestComputeVariant()
+{
+    if (g_computeVariantLoader.IsLoading()) return;
+
+    int features = RequiredComputeFeatures();
+    for (int localSize : { WorkgroupTuner::GetLocalSize(TUNED_PASS_INTEGRATE), DEFAULT_LOCAL_SIZE })
     {
-        if (newConstraint.targetObjectID < 0 || newConstraint.targetObjectID >= g_numObjects)
-        {
-            std::cerr << "[Objects] Updated constraint has invalid target!" << std::endl;
-            return;
-        }
-        if (newConstraint.targetObjectID == objectIndex)
-        {
-            std::cerr << "[Objects] Cannot target self!" << std::endl;
-            return;
-        }
-    }
+        int key = ComputeVariantKey(features, localSize);
+        if (key == COMPUTE_FEATURES_ALL || g_computeVariants.count(key) || g_failedComputeVariants.count(key)) continue;
 
-    // Update constraint data
-    int globalIndex = mapping.constraintOffset + constraintLocalIndex;
-    g_allConstraints[globalIndex] = newConstraint;
-    UploadConstraintsToGPU();
+        // The defines change the source text, so the binary cache keeps variants apart
+        std::string defines = ComputeFeatureDefines(features) + LocalSizeDefine(localSize);
+        g_computeVariantLoader.LoadComputeShaderAsync(
+            "math.comp",
+            [defines](const std::string& source) { return InsertComputeDefines(source, defines); },
+            [key, features, localSize](GLuint program)
+            {
+                g_computeVariants[key] = program;
+                std::cout << "[Objects] math.comp variant ready (features 0x" << std::hex << features << std::dec
+                          << ", " << localSize << " threads)" << std::endl;
+            },
+            [key, localSize](const std::string& error)
+            {
+                std::cerr << "\n[Objects] math.comp variant FAILED, staying on the full build: " << error << std::endl;
+                g_failedComputeVariants.insert(key);
+                if (localSize != DEFAULT_LOCAL_SIZE) WorkgroupTuner::CandidateFailed(TUNED_PASS_INTEGRATE, localSize);
+            });
+        return;
+    }
 }
 
-// ============================================================================
-// NEW: COLLISION PARAMETER MANAGEMENT
-// ============================================================================
-
-void Objects::SetCollisionParameters(bool enableWarmStart, int maxContactIterations)
+// Fast math: scan the state a step produced every g_nanScanInterval steps. A roll back puts the
+// last clean state back and runs the guarded build for one interval, so the same steps do not
+// blow up again the same way.
+static void ScanFastMathState(GLuint objectSSBO, int steps)
 {
-    g_enableWarmStart = enableWarmStart;
-    g_maxContactIterations = clamp(maxContactIterations, 1, 20);
-
-    // Initialize contact buffer if warm starting is enabled
-    if (g_enableWarmStart && g_contactBufferSSBO == 0)
+    g_nanGuardedSteps = std::max(0, g_nanGuardedSteps - steps);
+    g_stepsSinceNanScan += steps;
+    if (g_nanScanInterval <= 0 || g_stepsSinceNanScan < g_nanScanInterval) return;
+    g_stepsSinceNanScan = 0;
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    int count = 0;
+    std::vector<int> indices;
+    if (!NanScan::Scan(objectSSBO, g_numObjects, count, indices)) return;
+
+    bool newlyInvalid = (g_lastInvalidCount == 0);
+    g_lastInvalidCount = count;
+    g_lastInvalidIndices = indices;
+    if (count == 0)
     {
-        InitializeContactBuffer();
+        if (g_nanRollback) NanScan::SaveCheckpoint(objectSSBO, g_numObjects);
+        return;
     }
 
-    // Set uniform values when compute shader is ready
-    if (g_programCompute && g_computeShaderReady)
+    bool rolledBack = g_nanRollback && NanScan::RestoreCheckpoint(objectSSBO, g_numObjects);
+    if (rolledBack)
+    {
+        g_nanRollbackCount++;
+        g_nanGuardedSteps = g_nanScanInterval;
+    }
+    if (newlyInvalid || rolledBack)
     {
-        glUseProgram(g_programCompute);
+        std::cerr << "[Objects] Fast math: " << count << " objects hold NaN/Inf (first " << indices.front() << ")"
+                  << (rolledBack ? ", rolled back to the last clean scan" : "") << std::endl;
+    }
+}
 
-        GLint enableWarmStartLoc = glGetUniformLocation(g_programCompute, "uEnableWarmStart");
-        if (enableWarmStartLoc != -1)
-            glUniform1i(enableWarmStartLoc, g_enableWarmStart ? 1 : 0);
+static void ReleaseComputeVariants()
+{
+    for (auto& variant : g_computeVariants) glDeleteProgram(variant.second);
+    g_computeVariants.clear();
+    g_failedComputeVariants.clear();
+    g_computeFeatures = COMPUTE_FEATURES_ALL;
+    g_computeFeaturesRevision = -1;
+    g_computeUniformProgram = 0;
+}
 
-        GLint maxContactIterationsLoc = glGetUniformLocation(g_programCompute, "uMaxContactIterations");
-        if (maxContactIterationsLoc != -1)
-            glUniform1i(maxContactIterationsLoc, g_maxContactIterations);
+static void ReleaseCompiledEquations()
+{
+    if (g_programCompiledEquations) glDeleteProgram(g_programCompiledEquations);
+    if (g_pendingCompiledProgram) glDeleteProgram(g_pendingCompiledProgram);
+    g_programCompiledEquations = 0;
+    g_pendingCompiledProgram = 0;
+    g_compiledEquationRevision = -1;
+    g_failedEquationRevision = -1;
+    g_computeUniformProgram = 0;
+}
 
-        glUseProgram(0);
-    }
+// Compiled programs bake in equation IDs and storage offsets; once a slot is freed or moved they
+// would run the wrong code, so the interpreter takes over until the next build
+static void InvalidateCompiledEquations()
+{
+    g_invalidatedEquationRevision = ++g_equationRevision;
+    if (g_programCompiledEquations) glDeleteProgram(g_programCompiledEquations);
+    if (g_pendingCompiledProgram) glDeleteProgram(g_pendingCompiledProgram);
+    g_programCompiledEquations = 0;
+    g_pendingCompiledProgram = 0;
+    g_compiledEquationRevision = -1;
+    g_computeUniformProgram = 0;
 }
 
-void Objects::GetCollisionParameters(bool& enableWarmStart, int& maxContactIterations)
+// Rebuild the specialized math.comp once the registered equation set or the tuned work-group size has changed
+static void RequestCompiledEquations()
 {
-    enableWarmStart = g_enableWarmStart;
-    maxContactIterations = g_maxContactIterations;
+    if (g_equationStringToID.empty() || g_compiledEquationsLoader.IsLoading() || g_pendingCompiledProgram != 0) return;
+    // Sleeping objects run at the default size, so that is the build such scenes can use
+    int localSize = g_sleepEnabled ? DEFAULT_LOCAL_SIZE : WorkgroupTuner::GetTunedSize(TUNED_PASS_INTEGRATE);
+    if ((g_equationRevision == g_compiledEquationRevision && localSize == g_compiledLocalSize) ||
+        g_equationRevision == g_failedEquationRevision)
+        return;
+
+    std::string block = EquationCodegen::GenerateEquationBlock(
+        g_allTokens, g_allConstants, g_equationMappings, static_cast<int>(g_equationMappings.size()));
+
+    g_pendingEquationRevision = g_equationRevision;
+    g_pendingCompiledFastMath = g_fastMath;
+    g_pendingCompiledLocalSize = localSize;
+    std::string defines = ComputeFeatureDefines(g_fastMath ? COMPUTE_FEATURES_ALL & ~COMPUTE_FEATURE_SAFE_MATH : COMPUTE_FEATURES_ALL) +
+                          LocalSizeDefine(localSize);
+    g_compiledEquationsLoader.LoadComputeShaderAsync(
+        "math.comp",
+        [block, defines](const std::string& source)
+        {
+            return InsertComputeDefines(EquationCodegen::SpliceEquationBlock(source, block), defines);
+        },
+        [](GLuint program)
+        {
+            // Compile mode may have been switched off, or a slot freed, while this build was in flight
+            if (!g_equationCompileMode || g_pendingEquationRevision < g_invalidatedEquationRevision)
+            {
+                glDeleteProgram(program);
+                return;
+            }
+            g_pendingCompiledProgram = program;
+        },
+        [](const std::string& error)
+        {
+            std::cerr << "\n[Objects] Compiled equations FAILED, staying on the interpreter: " << error << std::endl;
+            g_failedEquationRevision = g_pendingEquationRevision;
+        });
 }
 
-// ============================================================================
-// Initialize the objects system
-// ============================================================================
-bool Objects::Init(void* glfwWindow)
+// Make a finished build the active program; done after the step so every pass of a step runs one program
+static void SwapInCompiledEquations()
 {
-    // Check OpenGL state
-    GLenum err = glGetError();
-    if (err != GL_NO_ERROR) return false;
+    if (g_pendingCompiledProgram == 0) return;
 
-    // Test OpenGL buffer creation
-    GLuint testBuffer;
-    glGenBuffers(1, &testBuffer);
-    if (glGetError() != GL_NO_ERROR) return false;
-    glDeleteBuffers(1, &testBuffer);
+    if (g_programCompiledEquations) glDeleteProgram(g_programCompiledEquations);
+    g_computeUniformProgram = 0;
+    g_programCompiledEquations = g_pendingCompiledProgram;
+    g_compiledEquationsFastMath = g_pendingCompiledFastMath;
+    g_compiledLocalSize = g_pendingCompiledLocalSize;
+    g_pendingCompiledProgram = 0;
+    g_compiledEquationRevision = g_pendingEquationRevision;
 
-    // Initialize data structures
-    g_equationMappings.resize(MAX_EQUATIONS);
-    g_objectConstraintMappings.resize(MAX_OBJECTS);
+    std::cout << "[Objects] Compiled equations active (" << g_equationProgramToID.size() << " equations)" << std::endl;
+}
 
-    for (auto& mapping : g_equationMappings)
-        mapping = EquationMapping{};
+// Clamp a value between min and max
+static float clamp(float value, float min, float max)
+{
+    if (value < min) return min;
+    if (value > max) return max;
+    return value;
+}
 
-    for (auto& mapping : g_objectConstraintMappings)
-        mapping = ObjectConstraints{};
+// Create a default object with specified skin type
+static Object CreateDefaultObjectInternal(int skinType, int objectIndex, int equationID = 0)
+{
+    Object p;
+    p.mass = 1.0f;
+    p.charge = 0.0f;
+    p.visualSkinType = skinType;
+    p.collisionShapeType = COLLISION_NONE;
+    p.equationID = equationID;
+    p.worldID = 0;
 
-    // Create default equation
-    ParserContext context;
-    ParsedEquation defaultEq = ParseEquation("vx, vy, -k*x/mass, -k*y/mass, 0, 1, 0, 0, 1", context);
-    int defaultEqID = AddOrGetEquation("default_zero", defaultEq);
-    g_numObjects = 1;
+    // Initialize with zeros - wrapper will set actual values
+    p.position = glm::vec2(0.0f, 0.0f);
+    p.velocity = glm::vec2(0.0f, 0.0f);
+    p.visualData = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+    p.color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
 
-    // Create double-buffered SSBOs for objects
-    if (g_objectSSBO[0] == 0)
+    // Set defaults based on skin type
+    switch (skinType)
     {
-        while (glGetError() != GL_NO_ERROR);
-        glGenBuffers(2, g_objectSSBO);
-        err = glGetError();
-        if (err != GL_NO_ERROR) return false;
+    case SKIN_CIRCLE:
+        p.visualData = glm::vec4(0.3f, 0.0f, 0.0f, 0.0f);
+        p.color = glm::vec4(0.4f, 0.8f, 0.3f, 1.0f);
+        break;
+    case SKIN_RECTANGLE:
+        p.visualData = glm::vec4(0.5f, 0.3f, 0.0f, 0.0f);
+        p.color = glm::vec4(1.0f, 0.5f, 0.0f, 1.0f);
+        break;
+    case SKIN_POLYGON:
+        p.visualData = glm::vec4(0.3f, 6.0f, 0.0f, 0.0f);
+        p.color = glm::vec4(0.8f, 0.3f, 0.8f, 1.0f);
+        break;
+    }
 
-        // Allocate buffer memory
-        for (int i = 0; i < 2; i++)
-        {
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[i]);
-            glBufferData(GL_SHADER_STORAGE_BUFFER,
-                MAX_OBJECTS * sizeof(Object),
-                nullptr,
-                GL_DYNAMIC_COPY);
-            err = glGetError();
-            if (err != GL_NO_ERROR) return false;
+    p.collisionData = glm::vec4(0.0f);
+    return p;
+}
+
+// Set up VAO to read from SSBO for rendering
+static void SetupRenderVAOFromSSBO(GLuint vaoID, GLuint ssboID)
+{
+    glBindVertexArray(vaoID);
+    glBindBuffer(GL_ARRAY_BUFFER, ssboID);
+
+    // Position attribute
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Object),
+        (void*)offsetof(Object, position));
+    glEnableVertexAttribArray(0);
+
+    // Velocity attribute
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Object),
+        (void*)offsetof(Object, velocity));
+    glEnableVertexAttribArray(1);
+
+    // Mass attribute
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Object),
+        (void*)offsetof(Object, mass));
+    glEnableVertexAttribArray(2);
+
+    // Charge attribute
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Object),
+        (void*)offsetof(Object, charge));
+    glEnableVertexAttribArray(3);
+
+    // Skin type attribute
+    glVertexAttribIPointer(4, 1, GL_INT, sizeof(Object),
+        (void*)offsetof(Object, visualSkinType));
+    glEnableVertexAttribArray(4);
+
+    // Visual data attribute
+    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(Object),
+        (void*)offsetof(Object, visualData));
+    glEnableVertexAttribArray(5);
+
+    // Color attribute
+    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Object),
+        (void*)offsetof(Object, color));
+    glEnableVertexAttribArray(6);
+
+    // Equation ID attribute
+    glVertexAttribIPointer(7, 1, GL_INT, sizeof(Object),
+        (void*)offsetof(Object, equationID));
+    glEnableVertexAttribArray(7);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Frame pipelining: each step's result is also copied into the next of N display buffers, each
+// with its own VAO, behind a fence. Draw() takes the newest copy whose fence has signalled, so
+// drawing frame K-1 neither waits on nor races with the dispatches producing frame K, and a step
+// never writes a buffer a queued draw still reads.
+static const int MAX_FRAME_PIPELINE_DEPTH = 4;
+struct DisplaySlot
+{
+    GLuint buffer = 0;
+    GLuint vao = 0;
+    GLsync fence = nullptr;             // Signals when the copy has landed
+    int numObjects = 0;
+    unsigned long long generation = 0;  // g_objectGeneration the copy shows
+};
+static DisplaySlot g_display[MAX_FRAME_PIPELINE_DEPTH];
+static int g_framePipelineDepth = 0;  // 0 = draw the object buffers directly
+static int g_displayNext = 0;
+static int g_displayShown = -1;       // Slot of the last draw
+
+static void ReleaseDisplaySlots()
+{
+    for (DisplaySlot& slot : g_display)
+    {
+        if (slot.fence) glDeleteSync(slot.fence);
+        if (slot.buffer) glDeleteBuffers(1, &slot.buffer);
+        if (slot.vao) glDeleteVertexArrays(1, &slot.vao);
+        slot = DisplaySlot{};
+    }
+    g_displayNext = 0;
+    g_displayShown = -1;
+}
+
+static bool DisplaySlotReady(const DisplaySlot& slot)
+{
+    GLenum status = glClientWaitSync(slot.fence, 0, 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+// Copy an object buffer into the next display slot other than the one on screen
+static void PublishDisplayFrame(int sourceIndex)
+{
+    if (g_framePipelineDepth == 0 || g_numObjects <= 0) return;
+
+    if (g_displayNext == g_displayShown) g_displayNext = (g_displayNext + 1) % g_framePipelineDepth;
+    DisplaySlot& slot = g_display[g_displayNext];
+    if (slot.fence) glDeleteSync(slot.fence);
+    if (slot.vao == 0) glGenVertexArrays(1, &slot.vao);
+    if (BufferHelpers::EnsureBufferCapacity(slot.buffer, static_cast<GLsizeiptr>(g_objectCapacity) * sizeof(Object)))
+        SetupRenderVAOFromSSBO(slot.vao, slot.buffer);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, g_objectSSBO[sourceIndex]);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, g_numObjects * sizeof(Object));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.numObjects = g_numObjects;
+    slot.generation = g_objectGeneration;
+    g_displayNext = (g_displayNext + 1) % g_framePipelineDepth;
+}
+
+// Newest finished copy, else the one already on screen, else the newest queued; -1 if none
+static int PickDisplaySlot()
+{
+    int newestReady = -1, newest = -1;
+    for (int i = 0; i < g_framePipelineDepth; i++)
+    {
+        const DisplaySlot& slot = g_display[i];
+        if (!slot.fence) continue;
+        if (newest < 0 || slot.generation > g_display[newest].generation) newest = i;
+        if ((newestReady < 0 || slot.generation > g_display[newestReady].generation) && DisplaySlotReady(slot))
+            newestReady = i;
+    }
+    if (newestReady >= 0) return newestReady;
+    return (g_displayShown >= 0) ? g_displayShown : newest;
+}
+
+// Upload [offset, offset + count) of one equation storage buffer, first doubling it if the
+// allocated space has outgrown it (growth keeps the contents)
+template<typename T>
+static void UploadEquationRange(EquationSpace& space, GLuint& buffer, const std::vector<T>& data, int offset, int count)
+{
+    if (buffer == 0 || space.end > space.gpuCapacity)
+    {
+        space.gpuCapacity = std::max({ space.end, space.gpuCapacity * 2, EQUATION_STORAGE_MIN_ELEMENTS });
+        BufferHelpers::EnsureBufferCapacity(buffer, static_cast<GLsizeiptr>(space.gpuCapacity) * sizeof(T), GL_DYNAMIC_DRAW);
+    }
+    if (count > 0)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset * sizeof(T), count * sizeof(T), data.data() + offset);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// Words the token buffer needs for entryCapacity entries in its current layout
+static int TokenBufferWords(int entryCapacity)
+{
+    if (g_tokensUnpacked) return TOKEN_BUFFER_HEADER_WORDS + entryCapacity;
+    return TOKEN_BUFFER_HEADER_WORDS + g_tokenWideCapacity + (entryCapacity + 1) / 2;
+}
+
+// Packed words [firstWord, endWord) of the token area from the host copy; false when an entry
+// needs a wide slot that does not fit
+static bool PackTokenWords(int firstWord, int endWord, std::vector<uint32_t>& words)
+{
+    words.assign(endWord - firstWord, 0u);
+    int entries = static_cast<int>(g_allTokens.size());
+    for (int w = firstWord; w < endWord; w++)
+    {
+        for (int half = 0; half < 2; half++)
+        {
+            int entry = 2 * w + half;
+            uint16_t bits = 0;
+            if (entry < entries && !g_tokenPacking.encode(g_allTokens[entry], bits)) return false;
+            words[w - firstWord] |= static_cast<uint32_t>(bits) << (16 * half);
+        }
+    }
+    return true;
+}
+
+// Reallocate the token buffer and write all of it; falls back to whole words for good when
+// the live equations have more distinct large operands than an escape can name
+static void RewriteTokenBuffer()
+{
+    EquationSpace& space = g_tokenSpace;
+    std::vector<uint32_t> packed;
+    if (!g_tokensUnpacked && !PackTokenWords(0, (space.end + 1) / 2, packed))
+    {
+        std::cerr << "[Objects] More than " << TOKEN_PACK_MAX_WIDE << " distinct large token operands, tokens stay 32-bit" << std::endl;
+        g_tokensUnpacked = true;
+    }
+    if (!g_tokensUnpacked)
+        g_tokenWideCapacity = std::max(g_tokenWideCapacity, std::min(std::max<int>(256, 2 * static_cast<int>(g_tokenPacking.wide.size())), TOKEN_PACK_MAX_WIDE));
+
+    std::vector<uint32_t> words(TokenBufferWords(space.gpuCapacity), 0u);
+    words[1] = static_cast<uint32_t>(space.end);
+    if (g_tokensUnpacked)
+    {
+        std::copy(g_allTokens.begin(), g_allTokens.begin() + std::min<int>(space.end, static_cast<int>(g_allTokens.size())),
+                  words.begin() + TOKEN_BUFFER_HEADER_WORDS);
+    }
+    else
+    {
+        int tokenBase = TOKEN_BUFFER_HEADER_WORDS + g_tokenWideCapacity;
+        words[0] = static_cast<uint32_t>(tokenBase);
+        std::copy(g_tokenPacking.wide.begin(), g_tokenPacking.wide.end(), words.begin() + TOKEN_BUFFER_HEADER_WORDS);
+        std::copy(packed.begin(), packed.end(), words.begin() + tokenBase);
+        g_tokenWideUploaded = g_tokenPacking.wide.size();
+    }
+
+    if (g_allTokensSSBO == 0) glGenBuffers(1, &g_allTokensSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_allTokensSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(words.size()) * sizeof(uint32_t), words.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// Upload entries [offset, offset + count) of the token buffer: the words holding them, the wide
+// slots they added and the entry count. Growth of the buffer or of the wide table rewrites it.
+static void UploadTokenRange(int offset, int count)
+{
+    EquationSpace& space = g_tokenSpace;
+    bool rewrite = false;
+    if (g_allTokensSSBO == 0 || space.end > space.gpuCapacity)
+    {
+        space.gpuCapacity = std::max({ space.end, space.gpuCapacity * 2, EQUATION_STORAGE_MIN_ELEMENTS });
+        rewrite = true;
+    }
+
+    std::vector<uint32_t> words;
+    int firstWord = offset / 2, endWord = (offset + std::max(count, 0) + 1) / 2;
+    if (!rewrite && !g_tokensUnpacked && count > 0)
+        rewrite = !PackTokenWords(firstWord, endWord, words) ||
+                  static_cast<int>(g_tokenPacking.wide.size()) > g_tokenWideCapacity;
+    if (rewrite)
+    {
+        RewriteTokenBuffer();
+        return;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_allTokensSSBO);
+    if (count > 0 && g_tokensUnpacked)
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, (TOKEN_BUFFER_HEADER_WORDS + offset) * sizeof(uint32_t),
+                        count * sizeof(int), g_allTokens.data() + offset);
+    }
+    else if (count > 0)
+    {
+        if (g_tokenWideUploaded < g_tokenPacking.wide.size())
+        {
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, (TOKEN_BUFFER_HEADER_WORDS + g_tokenWideUploaded) * sizeof(uint32_t),
+                            (g_tokenPacking.wide.size() - g_tokenWideUploaded) * sizeof(int),
+                            g_tokenPacking.wide.data() + g_tokenWideUploaded);
+            g_tokenWideUploaded = g_tokenPacking.wide.size();
+        }
+        int tokenBase = TOKEN_BUFFER_HEADER_WORDS + g_tokenWideCapacity;
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, (tokenBase + firstWord) * sizeof(uint32_t),
+                        words.size() * sizeof(uint32_t), words.data());
+    }
+    uint32_t entryCount = static_cast<uint32_t>(space.end);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t), sizeof(uint32_t), &entryCount);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// Upload packed equation data to GPU
+static void UploadPackedEquationsToGPU()
+{
+    UploadTokenRange(0, g_tokenSpace.end);
+    UploadEquationRange(g_constantSpace, g_allConstantsSSBO, g_allConstants, 0, g_constantSpace.end);
+    g_constantBlockDirty = true;
+    UploadEquationRange(g_bytecodeSpace, g_allBytecodeSSBO, g_allBytecode, 0, g_bytecodeSpace.end);
+}
+
+// First free range that fits, else the end of the buffer
+template<typename T>
+static int AllocateEquationRange(EquationSpace& space, std::vector<T>& data, int count)
+{
+    if (count <= 0) return space.end;
+    for (auto it = space.freeRanges.begin(); it != space.freeRanges.end(); ++it)
+    {
+        if (it->second < count) continue;
+        int offset = it->first;
+        int remaining = it->second - count;
+        space.freeRanges.erase(it);
+        if (remaining > 0) space.freeRanges[offset + count] = remaining;
+        space.freed -= count;
+        return offset;
+    }
+
+    int offset = space.end;
+    space.end += count;
+    data.resize(space.end);
+    return offset;
+}
+
+template<typename T>
+static void ReleaseEquationRange(EquationSpace& space, std::vector<T>& data, int offset, int count)
+{
+    if (count <= 0) return;
+    auto next = space.freeRanges.lower_bound(offset);
+    if (next != space.freeRanges.begin())
+    {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset)
+        {
+            offset = prev->first;
+            count += prev->second;
+            space.freed -= prev->second;
+            space.freeRanges.erase(prev);
         }
-        g_useMapBuffer = false;
+    }
+    if (next != space.freeRanges.end() && offset + count == next->first)
+    {
+        count += next->second;
+        space.freed -= next->second;
+        space.freeRanges.erase(next);
+    }
+
+    // A hole at the end just shortens the buffer
+    if (offset + count == space.end)
+    {
+        space.end = offset;
+        data.resize(space.end);
+        return;
+    }
+    space.freeRanges[offset] = count;
+    space.freed += count;
+}
+
+static bool NeedsCompaction(const EquationSpace& space)
+{
+    return space.freed >= EQUATION_COMPACT_MIN_FREED && space.freed * 2 > space.end;
+}
+
+// One live range and where compaction packs it
+struct EquationMove
+{
+    int from;
+    int to;
+    int count;
+};
+
+// Copy the live ranges into a fresh buffer of the same capacity, on the GPU, and mirror that on the host
+template<typename T>
+static void CompactEquationSpace(EquationSpace& space, GLuint& buffer, std::vector<T>& data,
+                                 const std::vector<EquationMove>& moves, int packedEnd)
+{
+    if (space.gpuCapacity == 0) return;  // Never uploaded, so never allocated
+
+    std::vector<T> packedData(packedEnd);
+    GLuint packed = 0;
+    glGenBuffers(1, &packed);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, packed);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(space.gpuCapacity) * sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    for (const EquationMove& move : moves)
+    {
+        if (move.count <= 0) continue;
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+            move.from * sizeof(T), move.to * sizeof(T), move.count * sizeof(T));
+        std::copy(data.begin() + move.from, data.begin() + move.from + move.count, packedData.begin() + move.to);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+
+    buffer = packed;
+    data.swap(packedData);
+    space.freeRanges.clear();
+    space.freed = 0;
+    space.end = packedEnd;
+}
+
+// Tokens are compacted on the host and packed again from scratch, which also drops the wide
+// slots of released equations and retries packing after a fallback to whole words
+static void CompactTokenSpace(const std::vector<EquationMove>& moves, int packedEnd)
+{
+    if (g_tokenSpace.gpuCapacity == 0) return;
+
+    std::vector<int> packedData(packedEnd);
+    for (const EquationMove& move : moves)
+        if (move.count > 0)
+            std::copy(g_allTokens.begin() + move.from, g_allTokens.begin() + move.from + move.count, packedData.begin() + move.to);
+    g_allTokens.swap(packedData);
+    g_tokenSpace.freeRanges.clear();
+    g_tokenSpace.freed = 0;
+    g_tokenSpace.end = packedEnd;
+
+    g_tokenPacking.clear();
+    g_tokenWideCapacity = 0;
+    g_tokenWideUploaded = 0;
+    g_tokensUnpacked = false;
+    RewriteTokenBuffer();
+}
+
+// Shift every offset of one equation (mapping, register programs, pair reduction bodies)
+static void RebaseEquation(int eqID, int tokenDelta, int constantDelta, int bytecodeDelta)
+{
+    static int EquationMapping::* const tokenOffsets[] = {
+        &EquationMapping::tokenOffset_ax, &EquationMapping::tokenOffset_ay, &EquationMapping::tokenOffset_angular,
+        &EquationMapping::tokenOffset_r, &EquationMapping::tokenOffset_g, &EquationMapping::tokenOffset_b,
+        &EquationMapping::tokenOffset_a };
+    static int EquationMapping::* const constantOffsets[] = {
+        &EquationMapping::constantOffset_ax, &EquationMapping::constantOffset_ay, &EquationMapping::constantOffset_angular,
+        &EquationMapping::constantOffset_r, &EquationMapping::constantOffset_g, &EquationMapping::constantOffset_b,
+        &EquationMapping::constantOffset_a };
+    static int EquationMapping::* const bytecodeOffsets[] = {
+        &EquationMapping::bytecodeOffset_ax, &EquationMapping::bytecodeOffset_ay, &EquationMapping::bytecodeOffset_angular,
+        &EquationMapping::bytecodeOffset_r, &EquationMapping::bytecodeOffset_g, &EquationMapping::bytecodeOffset_b,
+        &EquationMapping::bytecodeOffset_a };
+
+    EquationMapping& mapping = g_equationMappings[eqID];
+    for (int c = 0; c < 7; c++)
+    {
+        mapping.*tokenOffsets[c] += tokenDelta;
+        mapping.*constantOffsets[c] += constantDelta;
+        if (mapping.*bytecodeOffsets[c] >= 0) mapping.*bytecodeOffsets[c] += bytecodeDelta;
+    }
+    mapping.tokenOffset_state += tokenDelta;
+    mapping.constantOffset_state += constantDelta;
+    mapping.tokenOffset_refs += tokenDelta;
+
+    for (int slot = 0; slot < MAX_PAIR_SUMS_PER_EQUATION; slot++)
+    {
+        PairSumExpression& expr = g_pairSumExpressions[eqID * MAX_PAIR_SUMS_PER_EQUATION + slot];
+        if (!expr.used) continue;
+        expr.tokenOffset += tokenDelta;
+        expr.constantOffset += constantDelta;
+        g_pairSumExpressionsDirty = true;
+    }
+    for (int slot = 0; slot < MAX_PRELUDE_SLOTS; slot++)
+    {
+        PreludeExpression& expr = g_preludeExpressions[eqID * MAX_PRELUDE_SLOTS + slot];
+        if (!expr.used) continue;
+        expr.tokenOffset += tokenDelta;
+        expr.constantOffset += constantDelta;
+        g_preludeExpressionsDirty = true;
+    }
+}
+
+// Pack the live equations to the front of the three storage buffers
+static void CompactEquationStorage()
+{
+    std::vector<EquationMove> tokenMoves, constantMoves, bytecodeMoves;
+    int tokenEnd = 0, constantEnd = 0, bytecodeEnd = 0;
+    for (int id = 0; id < Objects::MAX_EQUATIONS; id++)
+    {
+        if (g_equationKeys[id].empty()) continue;
+        EquationAllocation& alloc = g_equationAllocations[id];
+
+        tokenMoves.push_back({ alloc.tokenOffset, tokenEnd, alloc.tokenCount });
+        constantMoves.push_back({ alloc.constantOffset, constantEnd, alloc.constantCount });
+        int bytecodeTo = alloc.bytecodeCount > 0 ? bytecodeEnd : -1;
+        if (alloc.bytecodeCount > 0) bytecodeMoves.push_back({ alloc.bytecodeOffset, bytecodeEnd, alloc.bytecodeCount });
+
+        RebaseEquation(id, tokenEnd - alloc.tokenOffset, constantEnd - alloc.constantOffset,
+                       alloc.bytecodeCount > 0 ? bytecodeTo - alloc.bytecodeOffset : 0);
+        alloc.tokenOffset = tokenEnd;
+        alloc.constantOffset = constantEnd;
+        alloc.bytecodeOffset = bytecodeTo;
+        tokenEnd += alloc.tokenCount;
+        constantEnd += alloc.constantCount;
+        bytecodeEnd += alloc.bytecodeCount;
+    }
+
+    CompactTokenSpace(tokenMoves, tokenEnd);
+    CompactEquationSpace(g_constantSpace, g_allConstantsSSBO, g_allConstants, constantMoves, constantEnd);
+    g_constantBlockDirty = true;
+    CompactEquationSpace(g_bytecodeSpace, g_allBytecodeSSBO, g_allBytecode, bytecodeMoves, bytecodeEnd);
+
+    if (g_mappingsSSBO)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_mappingsSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, Objects::MAX_EQUATIONS * sizeof(EquationMapping), g_equationMappings.data());
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    InvalidateCompiledEquations();
+}
 
-        // Initialize with default object
-        Object defaultObject = CreateDefaultObjectInternal(SKIN_CIRCLE, 0, defaultEqID);
+static void UploadEquationMapping(int eqID)
+{
+    if (g_mappingsSSBO == 0) return;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_mappingsSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, eqID * sizeof(EquationMapping), sizeof(EquationMapping), &g_equationMappings[eqID]);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// Free the slots and storage of every equation no host object runs. Spawned objects copy their
+// template's equation ID without the host seeing it, so nothing is freed while emitters run.
+static void ReleaseUnreferencedEquations()
+{
+    if (ObjectLifecycle::IsActive()) return;
+
+    bool released = false;
+    for (int id = 1; id < Objects::MAX_EQUATIONS; id++)  // 0 is the default every new object starts with
+    {
+        if (g_equationKeys[id].empty() || g_equationRefCounts[id] > 0) continue;
+
+        const EquationAllocation& alloc = g_equationAllocations[id];
+        ReleaseEquationRange(g_tokenSpace, g_allTokens, alloc.tokenOffset, alloc.tokenCount);
+        ReleaseEquationRange(g_constantSpace, g_allConstants, alloc.constantOffset, alloc.constantCount);
+        ReleaseEquationRange(g_bytecodeSpace, g_allBytecode, alloc.bytecodeOffset, alloc.bytecodeCount);
+
+        for (int slot = 0; slot < MAX_PAIR_SUMS_PER_EQUATION; slot++)
+            g_pairSumExpressions[id * MAX_PAIR_SUMS_PER_EQUATION + slot] = PairSumExpression{};
+        g_pairSumExpressionsDirty = true;
+        for (int slot = 0; slot < MAX_PRELUDE_SLOTS; slot++)
+        {
+            PreludeExpression& expr = g_preludeExpressions[id * MAX_PRELUDE_SLOTS + slot];
+            if (expr.used) g_preludeExpressionsDirty = true;
+            expr = PreludeExpression{};
+        }
+
+        for (auto key = g_equationStringToID.begin(); key != g_equationStringToID.end();)
+            key = (key->second == id) ? g_equationStringToID.erase(key) : std::next(key);
+        for (auto program = g_equationProgramToID.begin(); program != g_equationProgramToID.end();)
+            program = (program->second == id) ? g_equationProgramToID.erase(program) : std::next(program);
+        g_equationKeys[id].clear();
+        g_equationAllocations[id] = EquationAllocation{};
+        g_equationMappings[id] = EquationMapping{};
+        UploadEquationMapping(id);
+        released = true;
+    }
+    if (!released) return;
+
+    InvalidateCompiledEquations();
+    if (NeedsCompaction(g_tokenSpace) || NeedsCompaction(g_constantSpace) || NeedsCompaction(g_bytecodeSpace))
+        CompactEquationStorage();
+}
+
+// Record which equation a host object runs; the count per equation decides when it can be freed
+static void SetObjectEquationRef(int index, int eqID)
+{
+    if (index < 0 || index >= static_cast<int>(g_objectEquationIDs.size())) return;
+    int& current = g_objectEquationIDs[index];
+    if (current == eqID) return;
+    if (index < g_initialStateCount) g_initialEquationsStale = true;
+    if (current >= 0 && current < Objects::MAX_EQUATIONS) g_equationRefCounts[current]--;
+    int group = -2 - eqID;  // A group member holds no reference; the group does
+    current = ((eqID >= 0 && eqID < Objects::MAX_EQUATIONS) || (group >= 0 && group < Objects::MAX_EQUATION_GROUPS)) ? eqID : -1;
+    if (current >= 0) g_equationRefCounts[current]++;
+}
+
+// Drop the equation references of every object slot from first on
+static void ClearObjectEquationRefs(int first)
+{
+    for (int i = std::max(first, 0); i < static_cast<int>(g_objectEquationIDs.size()); i++)
+        SetObjectEquationRef(i, -1);
+}
+
+static void MarkConstraintMappingsDirty(int begin, int end)
+{
+    g_constraintMappingsDirty.Mark(begin, end);
+}
+
+static void MarkConstraintsDirty(int begin, int end)
+{
+    g_constraintsDirty.Mark(begin, end);
+}
+
+// Everything goes up on the next upload (Init, Cleanup)
+static void MarkAllConstraintsDirty()
+{
+    g_constraintsDirty.MarkAll();
+    g_constraintMappingsDirty.MarkAll();
+}
+
+// Reverse index of distance constraints: target -> owners
+static void AddConstraintReferrer(const Constraint& c, int owner)
+{
+    if (c.type != CONSTRAINT_DISTANCE) return;
+    if (c.targetObjectID < 0 || c.targetObjectID >= static_cast<int>(g_constraintReferrers.size())) return;
+    g_constraintReferrers[c.targetObjectID].push_back(owner);
+}
+
+static void DropConstraintReferrer(const Constraint& c, int owner)
+{
+    if (c.type != CONSTRAINT_DISTANCE) return;
+    if (c.targetObjectID < 0 || c.targetObjectID >= static_cast<int>(g_constraintReferrers.size())) return;
+    std::vector<int>& owners = g_constraintReferrers[c.targetObjectID];
+    auto it = std::find(owners.begin(), owners.end(), owner);
+    if (it == owners.end()) return;
+    *it = owners.back();
+    owners.pop_back();
+}
+
+// Upload the dirty elements of a host array (bound buffer), then mark it clean
+template<typename T>
+static void UploadDirtyRange(DirtyRange& range, const std::vector<T>& data)
+{
+    int begin = std::max(range.begin, 0);
+    int end = std::min(range.end, static_cast<int>(data.size()));
+    if (begin < end)
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, begin * sizeof(T), (end - begin) * sizeof(T), data.data() + begin);
+    range.Clear();
+}
+
+// Upload the constraint edits since the last upload; both buffers only grow, and the stale
+// constraints past a shrunk array are referenced by no mapping
+static void UploadConstraintsToGPU()
+{
+    int count = static_cast<int>(g_allConstraints.size());
+    if (g_constraintsGpuCapacity == 0 || count > g_constraintsGpuCapacity)
+    {
+        g_constraintsGpuCapacity = std::max({ count, g_constraintsGpuCapacity * 2, CONSTRAINT_STORAGE_MIN_ELEMENTS });
+        BufferHelpers::EnsureBufferCapacity(g_constraintsSSBO,
+            static_cast<GLsizeiptr>(g_constraintsGpuCapacity) * sizeof(Constraint), GL_DYNAMIC_DRAW);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_constraintsSSBO);
+    UploadDirtyRange(g_constraintsDirty, g_allConstraints);
+
+    int mappingCount = static_cast<int>(g_objectConstraintMappings.size());
+    BufferHelpers::EnsureBufferCapacity(g_objectConstraintsSSBO,
+        static_cast<GLsizeiptr>(std::max(mappingCount, 1)) * sizeof(ObjectConstraints), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectConstraintsSSBO);
+    UploadDirtyRange(g_constraintMappingsDirty, g_objectConstraintMappings);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    g_xpbdGraphDirty = true;
+    g_sceneRevision++;
+}
+
+// Compact once removals and relocation headroom outnumber the live constraints
+static void CompactConstraintsIfSparse()
+{
+    int holes = static_cast<int>(g_allConstraints.size()) - g_liveConstraintCount;
+    if (holes > std::max(g_liveConstraintCount, CONSTRAINT_STORAGE_MIN_ELEMENTS))
+        Objects::CompactConstraintArray();
+}
+
+// Bring the host arrays up to date with the rows the GPU closed up. Rows only shrink in place,
+// so a row whose count dropped takes its surviving prefix from the GPU copy
+static void SyncConstraintMirror()
+{
+    if (!g_constraintMirrorStale) return;
+    g_constraintMirrorStale = false;
+    int rows = std::min(g_constraintRowsTouched, static_cast<int>(g_objectConstraintMappings.size()));
+    g_constraintRowsTouched = 0;
+    if (g_constraintBreaksSSBO == 0 || rows <= 0) return;
+
+    GLuint breaks = 0;
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_constraintBreaksSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(breaks), &breaks);
+    if (breaks == 0)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        return;
+    }
+    GLuint zero = 0;
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), &zero);
+
+    std::vector<ObjectConstraints> mappings(rows);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectConstraintsSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, rows * sizeof(ObjectConstraints), mappings.data());
+    std::vector<Constraint> constraints(g_allConstraints.size());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_constraintsSSBO);
+    if (!constraints.empty())
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, constraints.size() * sizeof(Constraint), constraints.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    for (int i = 0; i < rows; i++)
+    {
+        ObjectConstraints& mapping = g_objectConstraintMappings[i];
+        int kept = mappings[i].numConstraints;
+        if (kept >= mapping.numConstraints || kept < 0) continue;
+
+        int offset = mapping.constraintOffset;
+        for (int k = 0; k < mapping.numConstraints; k++)
+            DropConstraintReferrer(g_allConstraints[offset + k], i);
+        for (int k = 0; k < mapping.numConstraints; k++)
+        {
+            g_allConstraints[offset + k] = k < kept ? constraints[offset + k] : Constraint();
+            if (k < kept) AddConstraintReferrer(g_allConstraints[offset + k], i);
+            else g_allConstraints[offset + k].type = -1;
+        }
+        g_liveConstraintCount -= mapping.numConstraints - kept;
+        mapping.numConstraints = kept;
+        if (kept == 0)
+        {
+            mapping.objectID = -1;
+            mapping.constraintOffset = 0;
+            MarkConstraintMappingsDirty(i, i + 1);
+        }
+    }
+
+    // What is left breakable bounds the next catch-ups
+    g_breakableConstraints = 0;
+    for (const Constraint& c : g_allConstraints)
+        if (c.type == CONSTRAINT_DISTANCE && c.param2 > 0.0f) g_breakableConstraints++;
+    CompactConstraintsIfSparse();
+    UploadConstraintsToGPU();
+}
+
+// One XPBD edge per distance constraint of an active object, owner first
+static void RebuildXpbdGraph()
+{
+    SyncConstraintMirror();
+    std::vector<XpbdEdge> edges;
+    for (int i = 0; i < g_numObjects; i++)
+    {
+        const ObjectConstraints& mapping = g_objectConstraintMappings[i];
+        for (int k = 0; k < mapping.numConstraints; k++)
+        {
+            const Constraint& c = g_allConstraints[mapping.constraintOffset + k];
+            if (c.type != CONSTRAINT_DISTANCE || c.param2 > 0.0f) continue;  // Breakable ones stay per object
+            if (c.targetObjectID < 0 || c.targetObjectID >= g_numObjects || c.targetObjectID == i) continue;
+            edges.push_back({ i, c.targetObjectID, c.param1, 0.0f });
+        }
+    }
+    XpbdConstraints::SetEdges(edges);
+    g_xpbdGraphDirty = false;
+    g_xpbdGraphObjects = g_numObjects;
+}
+
+// Initialize contact buffer for warm starting
+static void InitializeContactBuffer()
+{
+    // Space for capacity * MAX_CONTACTS_PER_OBJECT contacts, 64 bytes per contact point as in GLSL;
+    // new space is zeroed by the helper
+    GLsizeiptr contactBufferSize = static_cast<GLsizeiptr>(Objects::GetObjectCapacity()) * 4 * 64; // 4 contacts per object
+    BufferHelpers::EnsureBufferCapacity(g_contactBufferSSBO, contactBufferSize);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// Default collision properties for a fresh object slot
+static CollisionProperties DefaultCollisionProperties()
+{
+    CollisionProperties prop;
+    prop.enabled = 1;  // Collisions enabled by default
+    prop.shapeType = COLLISION_NONE;
+    prop.restitution = 0.7f;  // Default bounciness
+    prop.friction = 0.3f;     // Default friction
+    prop.mass_factor = 1.0f;
+    prop.category = COLLISION_CATEGORY_DEFAULT;
+    prop.mask = COLLISION_MASK_ALL;
+    prop.continuous = 0;
+    return prop;
+}
+
+// Upload one object's collision properties
+static void UploadCollisionPropertiesToGPU(int objectIndex)
+{
+    g_collidableCountDirty = true;
+    g_sceneRevision++;
+    ObjectSleep::WakeAll();  // Sleepers rest against the old shapes
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_collisionPropsSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+        objectIndex * sizeof(CollisionProperties),
+        sizeof(CollisionProperties),
+        &g_collisionProperties[objectIndex]);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// Drop every GPU-spawned object before the host edits the object list; the ghosts the
+// lifecycle left behind also disabled the slots' collision properties, so restore them
+static void DiscardSpawnedObjects()
+{
+    if (!ObjectLifecycle::IsActive()) return;
+    ObjectLifecycle::DiscardSpawned();
+    g_numObjects = ObjectLifecycle::GetBase();
+    g_objectGeneration++;
+    ClearObjectEquationRefs(g_numObjects);
+    if (g_collisionPropsSSBO == 0 || static_cast<int>(g_collisionProperties.size()) <= g_numObjects) return;
+
+    g_collidableCountDirty = true;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_collisionPropsSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+        g_numObjects * sizeof(CollisionProperties),
+        (g_collisionProperties.size() - g_numObjects) * sizeof(CollisionProperties),
+        &g_collisionProperties[g_numObjects]);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+static unsigned long long CollisionPairKey(int a, int b)
+{
+    unsigned long long lo = static_cast<unsigned int>(std::min(a, b));
+    unsigned long long hi = static_cast<unsigned int>(std::max(a, b));
+    return (lo << 32) | hi;
+}
+
+// Hash of an ordered pair - MUST MATCH collisionPairHash() in math.comp
+static unsigned int CollisionPairHash(unsigned int lo, unsigned int hi)
+{
+    return (lo * 73856093u) ^ (hi * 19349663u);
+}
+
+// Rebuild the GPU exclusion table (header + linear-probing slots, empty slot = 0xFFFFFFFF)
+static void UploadCollisionExclusionsToGPU()
+{
+    const unsigned int EMPTY = 0xFFFFFFFFu;
+    unsigned int tableSize = 16;
+    while (tableSize < g_collisionExclusions.size() * 2) tableSize <<= 1;
+
+    std::vector<unsigned int> table(4 + tableSize * 2, EMPTY);
+    table[0] = tableSize;
+    table[1] = static_cast<unsigned int>(g_collisionExclusions.size());
+    table[2] = table[3] = 0;
+
+    for (unsigned long long key : g_collisionExclusions)
+    {
+        unsigned int lo = static_cast<unsigned int>(key >> 32);
+        unsigned int hi = static_cast<unsigned int>(key & 0xFFFFFFFFull);
+        unsigned int slot = CollisionPairHash(lo, hi) & (tableSize - 1);
+        while (table[4 + slot * 2] != EMPTY) slot = (slot + 1) & (tableSize - 1);
+        table[4 + slot * 2] = lo;
+        table[4 + slot * 2 + 1] = hi;
+    }
+
+    if (g_collisionExclusionsSSBO == 0) glGenBuffers(1, &g_collisionExclusionsSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_collisionExclusionsSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, table.size() * sizeof(unsigned int), table.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    g_collisionExclusionsDirty = false;
+}
+
+// Side count n starts at n(n-1)/2 - 3 and holds (vertex i, normal of edge i -> i+1) per side,
+// unrotated on the unit circle; the same values collide.comp used to derive with sin/cos per test
+static void UploadPolygonTable()
+{
+    std::vector<glm::vec4> table;
+    for (int sides = 3; sides <= POLYGON_TABLE_MAX_SIDES; sides++)
+    {
+        double angleStep = 2.0 * 3.14159265358979323846 / sides;
+        for (int i = 0; i < sides; i++)
+        {
+            glm::dvec2 vertex(std::cos(i * angleStep), std::sin(i * angleStep));
+            glm::dvec2 next(std::cos((i + 1) * angleStep), std::sin((i + 1) * angleStep));
+            glm::dvec2 normal = glm::normalize(glm::dvec2(vertex.y - next.y, next.x - vertex.x));
+            table.push_back(glm::vec4(glm::vec2(vertex), glm::vec2(normal)));
+        }
+    }
+
+    glGenBuffers(1, &g_polygonTableSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_polygonTableSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, table.size() * sizeof(glm::vec4), table.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// Keep pair exclusions valid after RemoveObjects: newIndex maps old indices to new ones, -1 = removed
+static void RemapCollisionExclusions(const std::vector<int>& newIndex)
+{
+    if (g_collisionExclusions.empty()) return;
+
+    std::unordered_set<unsigned long long> remapped;
+    for (unsigned long long key : g_collisionExclusions)
+    {
+        int a = static_cast<int>(key >> 32);
+        int b = static_cast<int>(key & 0xFFFFFFFFull);
+        if (a >= static_cast<int>(newIndex.size()) || b >= static_cast<int>(newIndex.size())) continue;
+        a = newIndex[a];
+        b = newIndex[b];
+        if (a < 0 || b < 0) continue;
+        remapped.insert(CollisionPairKey(a, b));
+    }
+    g_collisionExclusions.swap(remapped);
+    g_collisionExclusionsDirty = true;
+}
+
+// Invalidate an object's own constraints; the holes are compacted away by the caller
+static void ReleaseObjectConstraints(int objectIndex)
+{
+    ObjectConstraints& mapping = g_objectConstraintMappings[objectIndex];
+    for (int i = 0; i < mapping.numConstraints; i++)
+    {
+        int globalIndex = mapping.constraintOffset + i;
+        if (globalIndex >= 0 && globalIndex < static_cast<int>(g_allConstraints.size()))
+        {
+            DropConstraintReferrer(g_allConstraints[globalIndex], objectIndex);
+            g_allConstraints[globalIndex].type = -1;
+            g_liveConstraintCount--;
+        }
+    }
+
+    MarkConstraintMappingsDirty(objectIndex, objectIndex + 1);
+    mapping.objectID = -1;
+    mapping.constraintOffset = 0;
+    mapping.numConstraints = 0;
+}
+
+// Drop the distance constraints of owner aimed at target, keeping the rest at the front of its block
+static void DropConstraintsTo(int owner, int target)
+{
+    ObjectConstraints& mapping = g_objectConstraintMappings[owner];
+    int kept = 0;
+    for (int k = 0; k < mapping.numConstraints; k++)
+    {
+        const Constraint c = g_allConstraints[mapping.constraintOffset + k];
+        if (c.type == CONSTRAINT_DISTANCE && c.targetObjectID == target) continue;
+        g_allConstraints[mapping.constraintOffset + kept++] = c;
+    }
+    if (kept == mapping.numConstraints) return;
+
+    for (int k = kept; k < mapping.numConstraints; k++)
+        g_allConstraints[mapping.constraintOffset + k].type = -1;
+    MarkConstraintsDirty(mapping.constraintOffset, mapping.constraintOffset + mapping.numConstraints);
+    MarkConstraintMappingsDirty(owner, owner + 1);
+    g_liveConstraintCount -= mapping.numConstraints - kept;
+    mapping.numConstraints = kept;
+    if (kept == 0)
+    {
+        mapping.objectID = -1;
+        mapping.constraintOffset = 0;
+    }
+}
+
+// Constraints follow an object moved from one slot to another (its own, and those aimed at it)
+static void MoveObjectConstraints(int to, int from)
+{
+    ObjectConstraints& mapping = g_objectConstraintMappings[to];
+    mapping = g_objectConstraintMappings[from];
+    if (mapping.objectID == from) mapping.objectID = to;
+    g_objectConstraintMappings[from] = ObjectConstraints();
+    MarkConstraintMappingsDirty(std::min(to, from), std::max(to, from) + 1);
+
+    for (int k = 0; k < mapping.numConstraints; k++)
+    {
+        const Constraint& c = g_allConstraints[mapping.constraintOffset + k];
+        if (c.type != CONSTRAINT_DISTANCE || c.targetObjectID < 0 ||
+            c.targetObjectID >= static_cast<int>(g_constraintReferrers.size())) continue;
+        std::vector<int>& owners = g_constraintReferrers[c.targetObjectID];
+        auto it = std::find(owners.begin(), owners.end(), from);
+        if (it != owners.end()) *it = to;
+    }
+
+    for (int owner : g_constraintReferrers[from])
+    {
+        ObjectConstraints& ownerMapping = g_objectConstraintMappings[owner];
+        for (int k = 0; k < ownerMapping.numConstraints; k++)
+        {
+            Constraint& c = g_allConstraints[ownerMapping.constraintOffset + k];
+            if (c.type == CONSTRAINT_DISTANCE && c.targetObjectID == from)
+            {
+                c.targetObjectID = to;
+                MarkConstraintsDirty(ownerMapping.constraintOffset + k, ownerMapping.constraintOffset + k + 1);
+            }
+        }
+    }
+    g_constraintReferrers[to].swap(g_constraintReferrers[from]);
+    g_constraintReferrers[from].clear();
+}
+
+// Constraints follow every object of a storage permutation: order[new] = old, newIndex[old] = new
+static void PermuteObjectConstraints(const std::vector<int>& order, const std::vector<int>& newIndex)
+{
+    int count = static_cast<int>(order.size());
+    std::vector<ObjectConstraints> mappings(g_objectConstraintMappings.begin(), g_objectConstraintMappings.begin() + count);
+    std::vector<std::vector<int>> referrers(count);
+    for (int i = 0; i < count; i++)
+    {
+        ObjectConstraints& mapping = g_objectConstraintMappings[i];
+        mapping = mappings[order[i]];
+        if (mapping.objectID == order[i]) mapping.objectID = i;
+        referrers[i].swap(g_constraintReferrers[order[i]]);
+        for (int& owner : referrers[i])
+            if (owner >= 0 && owner < count) owner = newIndex[owner];
+    }
+    for (int i = 0; i < count; i++) g_constraintReferrers[i].swap(referrers[i]);
+
+    for (Constraint& c : g_allConstraints)
+        if (c.type == CONSTRAINT_DISTANCE && c.targetObjectID >= 0 && c.targetObjectID < count)
+            c.targetObjectID = newIndex[c.targetObjectID];
+    MarkAllConstraintsDirty();
+}
+
+// Compact constraint array by removing invalid constraints
+void Objects::CompactConstraintArray()
+{
+    SyncConstraintMirror();
+
+    // Old index -> new index of every live constraint, in place; -1 for a hole
+    int size = static_cast<int>(g_allConstraints.size());
+    std::vector<int> oldToNewIndex(size, -1);
+    int newIndex = 0;
+    int firstRemoved = size;
+    for (int oldIndex = 0; oldIndex < size; oldIndex++)
+    {
+        if (g_allConstraints[oldIndex].type != -1)
+        {
+            oldToNewIndex[oldIndex] = newIndex;
+            g_allConstraints[newIndex++] = g_allConstraints[oldIndex];
+        }
+        else
+            firstRemoved = std::min(firstRemoved, oldIndex);
+    }
+    g_liveConstraintCount = newIndex;
+    if (firstRemoved == size) return;  // Nothing moves
+    g_allConstraints.resize(newIndex);
+    MarkConstraintsDirty(firstRemoved, newIndex);
+
+    // Update constraint offsets in object mappings
+    for (int i = 0; i < static_cast<int>(g_objectConstraintMappings.size()); i++)
+    {
+        ObjectConstraints& mapping = g_objectConstraintMappings[i];
+        if (mapping.numConstraints > 0 && mapping.constraintOffset >= firstRemoved)
+        {
+            int newOffset = mapping.constraintOffset < size ? oldToNewIndex[mapping.constraintOffset] : -1;
+            if (newOffset >= 0)
+                mapping.constraintOffset = newOffset;
+            else
+            {
+                // Invalidate mapping if offset not found
+                mapping.objectID = -1;
+                mapping.constraintOffset = 0;
+                mapping.numConstraints = 0;
+            }
+            MarkConstraintMappingsDirty(i, i + 1);
+        }
+    }
+}
+
+// Check a constraint before it is attached to an object
+static bool ValidateConstraint(int objectIndex, const Constraint& constraint)
+{
+    if (objectIndex < 0 || objectIndex >= g_numObjects)
+    {
+        std::cerr << "[Objects] Invalid object index: " << objectIndex << std::endl;
+        return false;
+    }
+
+    // Validate constraint type-specific parameters
+    if (constraint.type == CONSTRAINT_DISTANCE)
+    {
+        if (constraint.targetObjectID < 0 || constraint.targetObjectID >= g_numObjects)
+        {
+            std::cerr << "[Objects] Distance constraint has invalid target: "
+                << constraint.targetObjectID << std::endl;
+            return false;
+        }
+        if (constraint.targetObjectID == objectIndex)
+        {
+            std::cerr << "[Objects] Cannot create distance constraint to self!" << std::endl;
+            return false;
+        }
+
+        if (constraint.param1 <= 0.0f)  // rest_length must be positive
+        {
+            std::cerr << "[Objects] Distance constraint has invalid rest length: "
+                << constraint.param1 << std::endl;
+            return false;
+        }
+    }
+    else if (constraint.type == CONSTRAINT_BOUNDARY)
+    {
+        float minX = (constraint.param1 < constraint.param2) ? constraint.param1 : constraint.param2;
+        float maxX = (constraint.param1 > constraint.param2) ? constraint.param1 : constraint.param2;
+        float minY = (constraint.param3 < constraint.param4) ? constraint.param3 : constraint.param4;
+        float maxY = (constraint.param3 > constraint.param4) ? constraint.param3 : constraint.param4;
+
+        if (maxX - minX < 0.01f || maxY - minY < 0.01f)
+        {
+            std::cerr << "[Objects] Boundary constraint has invalid bounds!" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Append constraints to an object's block. The block grows in place while the slots after it
+// are free; otherwise it moves to the end of the array with as much headroom as it holds, so
+// an object gaining constraints one at a time moves O(log n) times
+static void AppendObjectConstraints(int objectIndex, const Constraint* constraints, int count)
+{
+    ObjectConstraints& mapping = g_objectConstraintMappings[objectIndex];
+    if (mapping.numConstraints == 0)
+    {
+        mapping.objectID = objectIndex;
+        mapping.constraintOffset = static_cast<int>(g_allConstraints.size());
+    }
+
+    int offset = mapping.constraintOffset;
+    int num = mapping.numConstraints;
+    int size = static_cast<int>(g_allConstraints.size());
+    bool fitsInPlace = true;
+    for (int k = offset + num; k < std::min(offset + num + count, size) && fitsInPlace; k++)
+        fitsInPlace = g_allConstraints[k].type == -1;
+
+    if (!fitsInPlace)
+    {
+        int newOffset = size;
+        g_allConstraints.resize(size + 2 * (num + count));
+        for (int k = 0; k < num; k++)
+        {
+            g_allConstraints[newOffset + k] = g_allConstraints[offset + k];
+            g_allConstraints[offset + k].type = -1;
+        }
+        for (int k = newOffset + num; k < static_cast<int>(g_allConstraints.size()); k++)
+            g_allConstraints[k].type = -1;  // Headroom
+        MarkConstraintsDirty(offset, offset + num);
+        mapping.constraintOffset = offset = newOffset;
+    }
+    else if (offset + num + count > size)
+    {
+        g_allConstraints.resize(offset + num + count);
+    }
+
+    for (int k = 0; k < count; k++)
+    {
+        g_allConstraints[offset + num + k] = constraints[k];
+        AddConstraintReferrer(constraints[k], objectIndex);
+        if (constraints[k].type == CONSTRAINT_DISTANCE && constraints[k].param2 > 0.0f) g_breakableConstraints++;
+    }
+    mapping.numConstraints = num + count;
+    g_liveConstraintCount += count;
+    MarkConstraintsDirty(offset, offset + num + count);
+    MarkConstraintMappingsDirty(objectIndex, objectIndex + 1);
+}
+
+// Add a constraint to an object
+void Objects::AddConstraint(int objectIndex, const Constraint& constraint)
+{
+    SyncConstraintMirror();
+    if (!ValidateConstraint(objectIndex, constraint)) return;
+
+    AppendObjectConstraints(objectIndex, &constraint, 1);
+    CompactConstraintsIfSparse();
+    UploadConstraintsToGPU();
+}
+
+// Add many constraints: each owner's block moves at most once, and everything goes up in one upload
+void Objects::AddConstraints(const std::vector<std::pair<int, Constraint>>& constraints)
+{
+    SyncConstraintMirror();
+    std::vector<std::pair<int, Constraint>> valid;
+    valid.reserve(constraints.size());
+    for (const auto& entry : constraints)
+        if (ValidateConstraint(entry.first, entry.second)) valid.push_back(entry);
+    if (valid.empty()) return;
+
+    std::stable_sort(valid.begin(), valid.end(),
+        [](const std::pair<int, Constraint>& a, const std::pair<int, Constraint>& b) { return a.first < b.first; });
+
+    std::vector<Constraint> group;
+    for (size_t begin = 0; begin < valid.size();)
+    {
+        size_t end = begin;
+        group.clear();
+        for (; end < valid.size() && valid[end].first == valid[begin].first; end++)
+            group.push_back(valid[end].second);
+        AppendObjectConstraints(valid[begin].first, group.data(), static_cast<int>(group.size()));
+        begin = end;
+    }
+
+    CompactConstraintsIfSparse();
+    UploadConstraintsToGPU();
+}
+
+// Remove a constraint from an object
+void Objects::RemoveConstraint(int objectIndex, int constraintLocalIndex)
+{
+    SyncConstraintMirror();
+    if (objectIndex < 0 || objectIndex >= g_numObjects) return;
+
+    ObjectConstraints& mapping = g_objectConstraintMappings[objectIndex];
+    if (constraintLocalIndex < 0 || constraintLocalIndex >= mapping.numConstraints) return;
+
+    // Mark constraint as invalid and shift others
+    int globalIndex = mapping.constraintOffset + constraintLocalIndex;
+    DropConstraintReferrer(g_allConstraints[globalIndex], objectIndex);
+    g_allConstraints[globalIndex].type = -1;
+    MarkConstraintsDirty(globalIndex, mapping.constraintOffset + mapping.numConstraints);
+    MarkConstraintMappingsDirty(objectIndex, objectIndex + 1);
+    g_liveConstraintCount--;
+
+    // Shift remaining constraints down
+    for (int i = constraintLocalIndex; i < mapping.numConstraints - 1; i++)
+    {
+        int srcGlobal = mapping.constraintOffset + i + 1;
+        int dstGlobal = mapping.constraintOffset + i;
+        g_allConstraints[dstGlobal] = g_allConstraints[srcGlobal];
+    }
+
+    // Mark last slot as invalid
+    g_allConstraints[mapping.constraintOffset + mapping.numConstraints - 1].type = -1;
+    mapping.numConstraints--;
+
+    // Clear mapping if no constraints remain
+    if (mapping.numConstraints == 0)
+    {
+        mapping.objectID = -1;
+        mapping.constraintOffset = 0;
+    }
+
+    CompactConstraintsIfSparse();
+    UploadConstraintsToGPU();
+}
+
+// Clear all constraints from an object
+void Objects::ClearConstraints(int objectIndex)
+{
+    SyncConstraintMirror();
+    if (objectIndex < 0 || objectIndex >= g_numObjects) return;
+
+    if (g_objectConstraintMappings[objectIndex].numConstraints == 0) return;
+
+    ReleaseObjectConstraints(objectIndex);
+    CompactConstraintsIfSparse();
+    UploadConstraintsToGPU();
+}
+
+// Clear all constraints from all objects
+void Objects::ClearAllConstraints()
+{
+    for (ObjectConstraints& mapping : g_objectConstraintMappings)
+        mapping = ObjectConstraints();
+    for (std::vector<int>& owners : g_constraintReferrers)
+        owners.clear();
+    g_allConstraints.clear();
+    g_liveConstraintCount = 0;
+    g_breakableConstraints = 0;
+    g_constraintMirrorStale = false;
+    g_constraintRowsTouched = 0;
+    MarkConstraintMappingsDirty(0, static_cast<int>(g_objectConstraintMappings.size()));
+    UploadConstraintsToGPU();
+}
+
+// Get all constraints for an object
+std::vector<Constraint> Objects::GetConstraints(int objectIndex)
+{
+    SyncConstraintMirror();
+    std::vector<Constraint> result;
+    if (objectIndex < 0 || objectIndex >= g_numObjects) return result;
+
+    const ObjectConstraints& mapping = g_objectConstraintMappings[objectIndex];
+    if (mapping.numConstraints == 0) return result;
+
+    // Copy constraints to result vector
+    for (int i = 0; i < mapping.numConstraints; i++)
+        result.push_back(g_allConstraints[mapping.constraintOffset + i]);
+
+    return result;
+}
+
+std::vector<std::pair<int, Constraint>> Objects::GetAllConstraints()
+{
+    SyncConstraintMirror();
+    std::vector<std::pair<int, Constraint>> result;
+    result.reserve(g_liveConstraintCount);
+    for (int owner = 0; owner < g_numObjects; owner++)
+    {
+        const ObjectConstraints& mapping = g_objectConstraintMappings[owner];
+        for (int i = 0; i < mapping.numConstraints; i++)
+            result.emplace_back(owner, g_allConstraints[mapping.constraintOffset + i]);
+    }
+    return result;
+}
+
+// Update an existing constraint
+void Objects::UpdateConstraint(int objectIndex, int constraintLocalIndex, const Constraint& newConstraint)
+{
+    SyncConstraintMirror();
+    if (objectIndex < 0 || objectIndex >= g_numObjects) return;
+
+    ObjectConstraints& mapping = g_objectConstraintMappings[objectIndex];
+    if (constraintLocalIndex < 0 || constraintLocalIndex >= mapping.numConstraints) return;
+
+    // Validate updated constraint
+    if (newConstraint.type == CONSTRAINT_DISTANCE)
+    {
+        if (newConstraint.targetObjectID < 0 || newConstraint.targetObjectID >= g_numObjects)
+        {
+            std::cerr << "[Objects] Updated constraint has invalid target!" << std::endl;
+            return;
+        }
+        if (newConstraint.targetObjectID == objectIndex)
+        {
+            std::cerr << "[Objects] Cannot target self!" << std::endl;
+            return;
+        }
+    }
+
+    // Update constraint data
+    int globalIndex = mapping.constraintOffset + constraintLocalIndex;
+    DropConstraintReferrer(g_allConstraints[globalIndex], objectIndex);
+    AddConstraintReferrer(newConstraint, objectIndex);
+    g_allConstraints[globalIndex] = newConstraint;
+    if (newConstraint.type == CONSTRAINT_DISTANCE && newConstraint.param2 > 0.0f) g_breakableConstraints++;
+    MarkConstraintsDirty(globalIndex, globalIndex + 1);
+    UploadConstraintsToGPU();
+}
+
+// ============================================================================
+// NEW: COLLISION PARAMETER MANAGEMENT
+// ============================================================================
+
+void Objects::SetCollisionParameters(bool enableWarmStart, int maxContactIterations)
+{
+    g_enableWarmStart = enableWarmStart;
+    g_maxContactIterations = clamp(maxContactIterations, 1, 20);
+
+    // Initialize contact buffer if warm starting is enabled
+    if (g_enableWarmStart && g_contactBufferSSBO == 0)
+    {
+        InitializeContactBuffer();
+    }
+
+    // collide.comp reads both from the parameter block
+    SimParams params = g_simParams;
+    params.enableWarmStart = g_enableWarmStart ? 1 : 0;
+    params.maxContactIterations = g_maxContactIterations;
+    SetSimParams(params);
+}
+
+void Objects::GetCollisionParameters(bool& enableWarmStart, int& maxContactIterations)
+{
+    enableWarmStart = g_enableWarmStart;
+    maxContactIterations = g_maxContactIterations;
+}
+
+// Contact pairs the narrowphase emitted last step (-1 until the pair solver has run)
+int Objects::GetContactCount()
+{
+    return ContactSolver::GetContactCount();
+}
+
+// Select how collision candidates are found (falls back to all-pairs until the build shader is ready)
+void Objects::SetBroadphaseMode(BroadphaseMode mode)
+{
+    g_broadphaseMode = mode;
+}
+
+BroadphaseMode Objects::GetBroadphaseMode()
+{
+    return g_broadphaseMode;
+}
+
+void Objects::SetNarrowphaseBuckets(bool enabled)
+{
+    g_shapeBuckets = enabled;
+}
+
+bool Objects::GetNarrowphaseBuckets()
+{
+    return g_shapeBuckets;
+}
+
+// Skin margin of the collision broadphase (0 rebuilds it every step)
+void Objects::SetNeighbourSkin(float skin)
+{
+    g_neighbourSkin = std::max(0.0f, skin);
+}
+
+float Objects::GetNeighbourSkin()
+{
+    return g_neighbourSkin;
+}
+
+// Largest ensemble world whose objects collide by walking the world instead of the broadphase
+void Objects::SetSmallWorldObjects(int objects)
+{
+    g_smallWorldObjects = std::max(0, objects);
+}
+
+int Objects::GetSmallWorldObjects()
+{
+    return g_smallWorldObjects;
+}
+
+int Objects::GetBroadphaseRebuilds()
+{
+    return static_cast<int>(Broadphase::GetSkinRebuilds());
+}
+
+// Compile registered equations into specialized GLSL instead of interpreting their RPN
+void Objects::SetEquationCompileMode(bool enabled)
+{
+    g_equationCompileMode = enabled;
+    if (!enabled) ReleaseCompiledEquations();
+}
+
+bool Objects::GetEquationCompileMode()
+{
+    return g_equationCompileMode;
+}
+
+// Evaluate interpreted components from their register bytecode where they have one
+void Objects::SetRegisterBytecodeEnabled(bool enabled)
+{
+    g_registerBytecodeEnabled = enabled;
+}
+
+bool Objects::GetRegisterBytecodeEnabled()
+{
+    return g_registerBytecodeEnabled;
+}
+
+// math.comp without its NaN/Inf guards, scanned every scanInterval steps (0 = never) instead
+void Objects::SetFastMath(bool enabled, int scanInterval, bool rollback)
+{
+    if (enabled != g_fastMath) InvalidateCompiledEquations();  // Compiled equations bake the guards in
+    g_fastMath = enabled;
+    g_nanScanInterval = std::max(scanInterval, 0);
+    g_nanRollback = rollback;
+    g_stepsSinceNanScan = 0;
+    g_nanGuardedSteps = 0;
+    g_lastInvalidCount = 0;
+    g_lastInvalidIndices.clear();
+    NanScan::DropCheckpoint();
+}
+
+void Objects::GetFastMath(bool& enabled, int& scanInterval, bool& rollback)
+{
+    enabled = g_fastMath;
+    scanInterval = g_nanScanInterval;
+    rollback = g_nanRollback;
+}
+
+// Result of the last scan: all invalid objects counted, the first NAN_SCAN_MAX_REPORTED listed
+int Objects::GetInvalidObjects(std::vector<int>& indices)
+{
+    indices = g_lastInvalidIndices;
+    return g_lastInvalidCount;
+}
+
+int Objects::GetNanRollbackCount()
+{
+    return g_nanRollbackCount;
+}
+
+// Time integration scheme of math.comp
+void Objects::SetIntegrator(IntegratorMethod method)
+{
+    g_integrator = method;
+}
+
+IntegratorMethod Objects::GetIntegrator()
+{
+    return g_integrator;
+}
+
+// Let timestep.comp choose every step's dt within [minDt, maxDt]; starts from startDt at startTime
+void Objects::SetAdaptiveTimestep(bool enabled, float minDt, float maxDt, float courant, float startDt, float startTime)
+{
+    AdaptiveTimestep::SetParameters(minDt, maxDt, courant);
+    if (enabled && !g_adaptiveTimestep) AdaptiveTimestep::Reset(startDt, startTime);
+    g_adaptiveTimestep = enabled;
+}
+
+void Objects::GetAdaptiveTimestep(bool& enabled, float& minDt, float& maxDt, float& courant)
+{
+    enabled = g_adaptiveTimestep;
+    minDt = AdaptiveTimestep::GetMinDt();
+    maxDt = AdaptiveTimestep::GetMaxDt();
+    courant = AdaptiveTimestep::GetCourant();
+}
+
+// Enabled and the reduction shader has loaded (until then steps use the fixed dt)
+bool Objects::IsAdaptiveTimestepActive()
+{
+    return g_adaptiveTimestep && AdaptiveTimestep::IsReady();
+}
+
+void Objects::GetAdaptiveTimestepState(float& dt, float& time)
+{
+    AdaptiveTimestep::GetLatest(dt, time);
+}
+
+std::vector<float> Objects::GetTimestepHistory()
+{
+    return AdaptiveTimestep::GetHistory();
+}
+
+// Sort math.comp's dispatch by (equationID, spatial cell) every `steps` steps; 0 disables it
+void Objects::SetDispatchReorderInterval(int steps)
+{
+    g_dispatchReorderInterval = std::max(0, steps);
+    g_stepsSinceReorder = 0;
+    g_dispatchOrderObjects = -1;
+}
+
+int Objects::GetDispatchReorderInterval()
+{
+    return g_dispatchReorderInterval;
+}
+
+// Sort the object buffers into Z-order of position every `steps` steps; 0 disables it
+void Objects::SetStorageReorderInterval(int steps)
+{
+    g_storageReorderInterval = std::max(0, steps);
+    g_stepsSinceStorageReorder = 0;
+}
+
+int Objects::GetStorageReorderInterval()
+{
+    return g_storageReorderInterval;
+}
+
+// Time the work-group size candidates of each per-object pass over the next steps (workgroup_tuner.h)
+void Objects::StartWorkgroupTuning(bool force)
+{
+    WorkgroupTuner::Start(force);
+}
+
+bool Objects::IsWorkgroupTuning()
+{
+    return WorkgroupTuner::IsTuning();
+}
+
+void Objects::GetWorkgroupSizes(int& integrate, int& constraints, int& collide)
+{
+    integrate = WorkgroupTuner::GetTunedSize(TUNED_PASS_INTEGRATE);
+    constraints = WorkgroupTuner::GetTunedSize(TUNED_PASS_CONSTRAINTS);
+    collide = WorkgroupTuner::GetTunedSize(TUNED_PASS_COLLIDE);
+}
+
+// Barnes-Hut opening angle, force constants and softening behind grav_ax/coul_ax
+void Objects::SetLongRangeParameters(float theta, float gravityConstant, float coulombConstant, float softening)
+{
+    LongRange::SetParameters(theta, gravityConstant, coulombConstant, softening);
+}
+
+void Objects::GetLongRangeParameters(float& theta, float& gravityConstant, float& coulombConstant, float& softening)
+{
+    theta = LongRange::GetTheta();
+    gravityConstant = LongRange::GetGravityConstant();
+    coulombConstant = LongRange::GetCoulombConstant();
+    softening = LongRange::GetSoftening();
+}
+
+// Kernel radius and equation of state behind sph_ax/sph_ay/sph_rho/sph_p
+void Objects::SetFluidParameters(const SphParameters& params)
+{
+    SphFluid::SetParameters(params);
+    ObjectSleep::WakeAll();  // A resting fluid may not rest under its new parameters
+}
+
+SphParameters Objects::GetFluidParameters()
+{
+    return SphFluid::GetParameters();
+}
+
+// Tree or particle mesh behind the same variables; false for a mesh the solver cannot use
+bool Objects::SetLongRangeMethod(LongRangeMethod method, int meshSize, const glm::vec4& periodicBox)
+{
+    if (method == LONG_RANGE_PARTICLE_MESH && !ParticleMesh::SetMesh(meshSize, periodicBox)) return false;
+    LongRange::SetMethod(method);
+    return true;
+}
+
+void Objects::GetLongRangeMethod(LongRangeMethod& method, int& meshSize, glm::vec4& periodicBox)
+{
+    method = LongRange::GetMethod();
+    meshSize = ParticleMesh::GetMeshSize();
+    periodicBox = ParticleMesh::GetPeriodicBox();
+}
+
+// Read other objects from per-field streams scattered before each pass instead of the Object array
+void Objects::SetStructOfArraysStorage(bool enabled, bool quantized)
+{
+    g_structOfArraysStorage = enabled;
+    ObjectStreams::SetQuantized(enabled && quantized);
+}
+
+bool Objects::GetStructOfArraysStorage()
+{
+    return g_structOfArraysStorage;
+}
+
+bool Objects::GetStructOfArraysQuantized()
+{
+    return ObjectStreams::IsQuantized();
+}
+
+// Put objects to rest after `steps` steps below both thresholds; contacts with moving objects wake them
+void Objects::SetSleepParameters(bool enabled, float velocityThreshold, float accelerationThreshold, int steps)
+{
+    ObjectSleep::SetParameters(velocityThreshold, accelerationThreshold, steps);
+    g_sleepEnabled = enabled;
+}
+
+void Objects::GetSleepParameters(bool& enabled, float& velocityThreshold, float& accelerationThreshold, int& steps)
+{
+    enabled = g_sleepEnabled;
+    velocityThreshold = ObjectSleep::GetVelocityThreshold();
+    accelerationThreshold = ObjectSleep::GetAccelerationThreshold();
+    steps = ObjectSleep::GetSleepSteps();
+}
+
+// Objects the next step integrates (all of them until an active set has been built)
+int Objects::GetAwakeObjectCount()
+{
+    if (g_sleepConfig == 0 || !ObjectSleep::HasActiveSet(g_numObjects)) return g_numObjects;
+    int count = ObjectSleep::GetActiveCount();
+    return count < 0 ? g_numObjects : count;
+}
+
+void Objects::WakeAllObjects()
+{
+    ObjectSleep::WakeAll();
+}
+
+void Objects::FreezeObjects(int first, int count)
+{
+    count = std::min(count, g_numObjects - first);
+    if (first < 0 || count <= 0) return;
+    ObjectSleep::Freeze(first, count);
+}
+
+// Distance constraints as XPBD edges: `iterations` sweeps over the colored graph per step,
+// compliance in (distance / force) units, 0 = rigid
+void Objects::SetConstraintSolver(bool xpbd, int iterations, float compliance)
+{
+    XpbdConstraints::SetParameters(iterations, compliance);
+    if (xpbd && !g_xpbdConstraints) g_xpbdGraphDirty = true;
+    g_xpbdConstraints = xpbd;
+}
+
+void Objects::GetConstraintSolver(bool& xpbd, int& iterations, float& compliance)
+{
+    xpbd = g_xpbdConstraints;
+    iterations = XpbdConstraints::GetIterations();
+    compliance = XpbdConstraints::GetCompliance();
+}
+
+void Objects::GetConstraintGraph(int& edges, int& colors)
+{
+    edges = XpbdConstraints::GetEdgeCount();
+    colors = XpbdConstraints::GetColorCount();
+}
+
+// Replace the spring network in one upload (see SpringNetwork::SetSprings for the layout)
+void Objects::SetSprings(const std::vector<int>& endpoints, const std::vector<float>& stiffness,
+                         const std::vector<float>& damping, const std::vector<float>& restLength)
+{
+    SpringNetwork::SetSprings(g_numObjects, endpoints, stiffness, damping, restLength);
+    ObjectSleep::WakeAll();
+    g_sceneRevision++;
+}
+
+void Objects::ClearSprings()
+{
+    SpringNetwork::Clear();
+    ObjectSleep::WakeAll();
+    g_sceneRevision++;
+}
+
+int Objects::GetSpringCount()
+{
+    return SpringNetwork::GetSpringCount();
+}
+
+void Objects::SetSpringIntegration(bool implicit, int iterations, float tolerance)
+{
+    SpringNetwork::SetImplicit(implicit, iterations, tolerance);
+}
+
+void Objects::GetSpringIntegration(bool& implicit, int& iterations, float& tolerance)
+{
+    SpringNetwork::GetImplicit(implicit, iterations, tolerance);
+}
+
+// GPU-spawned copies of a host-managed object (the template keeps its own index)
+int Objects::AddParticleEmitter(int templateIndex, float rate, float offsetX, float offsetY, float velocityX, float velocityY,
+                                float positionSpread, float velocitySpread, float lifetime, int killFlags,
+                                float boundsMinX, float boundsMinY, float boundsMaxX, float boundsMaxY)
+{
+    int hostObjects = ObjectLifecycle::IsActive() ? ObjectLifecycle::GetBase() : g_numObjects;
+    if (templateIndex < 0 || templateIndex >= hostObjects) return -1;
+
+    ParticleEmitter emitter = {};
+    emitter.offset[0] = offsetX;
+    emitter.offset[1] = offsetY;
+    emitter.velocity[0] = velocityX;
+    emitter.velocity[1] = velocityY;
+    emitter.positionSpread = std::max(0.0f, positionSpread);
+    emitter.velocitySpread = std::max(0.0f, velocitySpread);
+    emitter.lifetime = lifetime;
+    emitter.templateObject = templateIndex;
+    emitter.killFlags = killFlags;
+    emitter.boundsMin[0] = boundsMinX;
+    emitter.boundsMin[1] = boundsMinY;
+    emitter.boundsMax[0] = boundsMaxX;
+    emitter.boundsMax[1] = boundsMaxY;
+    return ObjectLifecycle::AddEmitter(emitter, rate);
+}
+
+bool Objects::RemoveParticleEmitter(int emitterID)
+{
+    return ObjectLifecycle::RemoveEmitter(emitterID);
+}
+
+void Objects::ClearParticleEmitters()
+{
+    ObjectLifecycle::ClearEmitters();
+}
+
+int Objects::GetParticleEmitterCount()
+{
+    return ObjectLifecycle::GetEmitterCount();
+}
+
+// ============================================================================
+// Initialize the objects system
+// ============================================================================
+bool Objects::Init(void* glfwWindow)
+{
+    // Check OpenGL state
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) return false;
+
+    // Test OpenGL buffer creation
+    GLuint testBuffer;
+    glGenBuffers(1, &testBuffer);
+    if (glGetError() != GL_NO_ERROR) return false;
+    glDeleteBuffers(1, &testBuffer);
+
+    // From here on errors arrive through the debug callback (debug builds), never by polling
+    GLDebug::Install();
+
+    // Initialize data structures
+    g_equationMappings.resize(MAX_EQUATIONS);
+    if (g_objectCapacity == 0) g_objectCapacity = INITIAL_OBJECT_CAPACITY;
+    g_objectConstraintMappings.resize(g_objectCapacity);
+    g_constraintReferrers.resize(g_objectCapacity);
+    g_pendingWriteSlot.assign(g_objectCapacity, -1);
+    g_objectEquationIDs.assign(g_objectCapacity, -1);
+
+    for (auto& mapping : g_equationMappings)
+        mapping = EquationMapping{};
+
+    for (auto& mapping : g_objectConstraintMappings)
+        mapping = ObjectConstraints{};
+
+    // Create default equation
+    ParserContext context;
+    ParsedEquation defaultEq = ParseEquation("vx, vy, -k*x/mass, -k*y/mass, 0, 1, 0, 0, 1", context);
+    int defaultEqID = AddOrGetEquation("default_zero", defaultEq);
+    g_numObjects = 1;
+    SetObjectEquationRef(0, defaultEqID);
+
+    // Create double-buffered SSBOs for objects
+    if (g_objectSSBO[0] == 0)
+    {
+        while (glGetError() != GL_NO_ERROR);
+        glGenBuffers(2, g_objectSSBO);
+        err = glGetError();
+        if (err != GL_NO_ERROR) return false;
+
+        // Allocate buffer memory
+        for (int i = 0; i < 2; i++)
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[i]);
+            glBufferData(GL_SHADER_STORAGE_BUFFER,
+                g_objectCapacity * sizeof(Object),
+                nullptr,
+                GL_DYNAMIC_COPY);
+            err = glGetError();
+            if (err != GL_NO_ERROR) return false;
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        // Initialize with default object
+        Object defaultObject = CreateDefaultObjectInternal(SKIN_CIRCLE, 0, defaultEqID);
+        for (int i = 0; i < 2; i++)
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[i]);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Object), &defaultObject);
+            err = glGetError();
+            if (err != GL_NO_ERROR) return false;
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    // Create VAOs for rendering
+    if (g_renderVAO[0] == 0)
+    {
+        glGenVertexArrays(2, g_renderVAO);
+        GLenum err = glGetError();
+        if (err != GL_NO_ERROR) return false;
+
+        SetupRenderVAOFromSSBO(g_renderVAO[0], g_objectSSBO[0]);
+        SetupRenderVAOFromSSBO(g_renderVAO[1], g_objectSSBO[1]);
+    }
+    if (g_quadInstancedVAO == 0) glGenVertexArrays(1, &g_quadInstancedVAO);
+
+    // Create additional SSBOs
+    if (g_mappingsSSBO == 0) glGenBuffers(1, &g_mappingsSSBO);
+    if (g_groupEquationsSSBO == 0) glGenBuffers(1, &g_groupEquationsSSBO);
+    if (g_initialStateSSBO == 0) glGenBuffers(1, &g_initialStateSSBO);
+    if (g_constraintsSSBO == 0) glGenBuffers(1, &g_constraintsSSBO);
+    if (g_objectConstraintsSSBO == 0) glGenBuffers(1, &g_objectConstraintsSSBO);
+
+    // Initialize collision properties buffer
+    if (g_collisionPropsSSBO == 0)
+    {
+        glGenBuffers(1, &g_collisionPropsSSBO);
+
+        // Initialize collision properties with defaults
+        g_collisionProperties.assign(g_objectCapacity, DefaultCollisionProperties());
+        g_collidableCountDirty = true;
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_collisionPropsSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER,
+            g_objectCapacity * sizeof(CollisionProperties),
+            g_collisionProperties.data(),
+            GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    // Pair exclusion table (empty until EnableCollisionBetween disables a pair)
+    UploadCollisionExclusionsToGPU();
+
+    // Unit polygon vertices and edge normals, so the SAT tests only rotate them
+    if (g_polygonTableSSBO == 0) UploadPolygonTable();
+
+    // Initialize contact buffer (will be created when needed)
+    // g_contactBufferSSBO is initialized lazily when warm starting is enabled
+
+    err = glGetError();
+    if (err != GL_NO_ERROR) return false;
+
+    // Upload initial data to GPU
+    UploadPackedEquationsToGPU();
+    UploadConstraintsToGPU();
+
+    // Upload equation mappings
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_mappingsSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+        MAX_EQUATIONS * sizeof(EquationMapping),
+        g_equationMappings.data(),
+        GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_groupEquationsSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+        MAX_EQUATION_GROUPS * sizeof(int),
+        g_groupEquations.data(),
+        GL_DYNAMIC_DRAW);
+    err = glGetError();
+    if (err != GL_NO_ERROR) return false;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Broadphase buffers and build shader
+    if (!Broadphase::Init(g_objectCapacity))
+        std::cerr << "[Objects] Broadphase unavailable, using all-pairs collisions" << std::endl;
+
+    // Dispatch order table and sort shader (only used once a reorder interval is set)
+    if (!DispatchOrder::Init(g_objectCapacity))
+        std::cerr << "[Objects] Dispatch reordering unavailable, objects run in index order" << std::endl;
+
+    // Barnes-Hut tree and solver shader (only run once an equation reads grav_ax/coul_ax)
+    if (!LongRange::Init(g_objectCapacity))
+        std::cerr << "[Objects] Long-range solver unavailable, grav_ax/coul_ax read 0" << std::endl;
+
+    // SPH shader (only run once an equation reads sph_ax/sph_ay/sph_rho/sph_p)
+    if (!SphFluid::Init())
+        std::cerr << "[Objects] SPH fluid unavailable, sph_ax/sph_rho read 0" << std::endl;
+
+    // GPU-side step state and reduction shader (only used in adaptive timestep mode)
+    if (!AdaptiveTimestep::Init())
+        std::cerr << "[Objects] Adaptive timestep unavailable, steps keep the fixed dt" << std::endl;
+
+    // Per-field copies of the objects for neighbour reads (only used in structure-of-arrays mode)
+    if (!ObjectStreams::Init(g_objectCapacity))
+        std::cerr << "[Objects] Object streams unavailable, neighbours are read from the object array" << std::endl;
+
+    // Still-step counters and active set (only used once sleeping is enabled)
+    if (!ObjectSleep::Init(g_objectCapacity))
+        std::cerr << "[Objects] Object sleeping unavailable, every object stays awake" << std::endl;
+
+    // Graph-colored distance constraint solve (only used once XPBD constraints are enabled)
+    if (!XpbdConstraints::Init())
+        std::cerr << "[Objects] XPBD constraints unavailable, distance constraints use the per-object pass" << std::endl;
+
+    // CSR spring networks for soft bodies and cloth (buffers follow the first network)
+    if (!SpringNetwork::Init())
+        std::cerr << "[Objects] Spring networks unavailable, springs are ignored" << std::endl;
+
+    // Contact-pair buffer and iterative impulse solver (falls back to the per-object response until ready)
+    if (!ContactSolver::Init(g_objectCapacity))
+        std::cerr << "[Objects] Contact solver unavailable, collisions use the per-object response" << std::endl;
+
+    // Emitters and kill conditions, compacted on the GPU after every step
+    if (!ObjectLifecycle::Init(g_objectCapacity))
+        std::cerr << "[Objects] Object lifecycle unavailable, particle emitters do nothing" << std::endl;
+
+    // One-value reductions of per-object expressions (programs are compiled per expression on first use)
+    if (!ObjectReduction::Init(g_objectCapacity))
+        std::cerr << "[Objects] Object reductions unavailable, observables need a full readback" << std::endl;
+
+    // The same expressions over caller-given points
+    if (!ExpressionEval::Init())
+        std::cerr << "[Objects] Expression evaluation unavailable" << std::endl;
+
+    // Field-projected reads of listed objects
+    if (!ObjectGather::Init(g_objectCapacity))
+        std::cerr << "[Objects] Object gather unavailable, field reads copy whole objects" << std::endl;
+    if (!ObjectReorder::Init(g_objectCapacity))
+        std::cerr << "[Objects] Object reorder unavailable, storage stays in insertion order" << std::endl;
+    if (!StaticColliders::Init(g_objectCapacity))
+        std::cerr << "[Objects] Static colliders unavailable, static objects move like the rest" << std::endl;
+    if (!KinematicPaths::Init(g_objectCapacity))
+        std::cerr << "[Objects] Kinematic paths unavailable, kinematic objects follow their equations" << std::endl;
+    if (!ObjectAggregates::Init(g_objectCapacity))
+        std::cerr << "[Objects] Group aggregates unavailable, agg[] reads 0" << std::endl;
+    if (!ObjectPipeline::Init(g_objectCapacity))
+        std::cerr << "[Objects] Object pipeline unavailable, fld[] reads 0" << std::endl;
+
+    // Work-group sizes tuned on this device before
+    WorkgroupTuner::Init();
+
+    // Shared scan / sort / compaction / segmented reduction passes
+    if (!GpuPrimitives::Init())
+        std::cerr << "[Objects] GPU primitives unavailable" << std::endl;
+
+    // Changed-object bitmaps for delta checkpoints
+    if (!ObjectCheckpoint::Init())
+        std::cerr << "[Objects] Object checkpoint diff unavailable, deltas hold every object" << std::endl;
+
+    // Replication of a live scene into ensemble worlds
+    if (!ObjectFork::Init())
+        std::cerr << "[Objects] Object fork unavailable" << std::endl;
+
+    // NaN/Inf detection for fast math
+    if (!NanScan::Init())
+        std::cerr << "[Objects] NaN scan unavailable, fast math runs unchecked" << std::endl;
+
+    // View culling of the instanced draw
+    if (!ObjectCulling::Init(g_objectCapacity))
+        std::cerr << "[Objects] Object culling unavailable, every object is drawn" << std::endl;
+
+    // Position history rings for trails
+    if (!ObjectTrails::Init())
+        std::cerr << "[Objects] Trails unavailable" << std::endl;
+
+    // Constraint network lines
+    if (!ConstraintLines::Init())
+        std::cerr << "[Objects] Constraint lines unavailable" << std::endl;
+
+    // Density plot for the phase space view
+    if (!PhaseSpace::Init())
+        std::cerr << "[Objects] Phase space plot unavailable" << std::endl;
+
+    // Equation-driven force field arrows
+    if (!ForceField::Init())
+        std::cerr << "[Objects] Force field unavailable" << std::endl;
+
+    // Signed-distance environment colliders
+    if (!SdfColliders::Init())
+        std::cerr << "[Objects] SDF colliders unavailable" << std::endl;
+
+    // Stencil-stepped grid fields and their colour map
+    if (!GridFields::Init())
+        std::cerr << "[Objects] Grid fields unavailable" << std::endl;
+
+    // Point splats for scenes too large to draw as skins
+    if (!DensitySplat::Init())
+        std::cerr << "[Objects] Density rendering unavailable, objects are drawn as skins" << std::endl;
+
+    // Mouse picking without a whole-state fetch
+    if (!ObjectPick::Init())
+        std::cerr << "[Objects] GPU picking unavailable, picks fetch every object" << std::endl;
+
+    // Batched radius and box queries over the neighbour grid
+    if (!ObjectQuery::Init())
+        std::cerr << "[Objects] GPU spatial queries unavailable, queries fetch every object" << std::endl;
+    if (!ObjectRaycast::Init())
+        std::cerr << "[Objects] GPU raycasts unavailable, raycasts fetch every object" << std::endl;
+
+    // $0..$7 of every object, sampled by math.comp as a buffer texture
+    if (!ObjectParams::Init(g_objectCapacity))
+        std::cerr << "[Objects] Object parameters unavailable, $0..$7 read 0" << std::endl;
+
+    // s0..s7 of every object, read and written by math.comp as an image
+    if (!StateRegisters::Init(g_objectCapacity))
+        std::cerr << "[Objects] State registers unavailable, s0..s7 read 0" << std::endl;
+
+    // Parameter sensitivities of every object, read and written by math.comp as an image
+    if (!ObjectSensitivity::Init(g_objectCapacity))
+        std::cerr << "[Objects] Parameter sensitivities unavailable" << std::endl;
+
+    // Bounds math.comp stores for the broadphase builds and culling, sampled as a buffer texture
+    if (!ObjectBounds::Init(g_objectCapacity))
+        std::cerr << "[Objects] Object bounds unavailable, the passes work them out themselves" << std::endl;
+
+    // Stable handles p[i] names objects by, sampled as a buffer texture
+    if (!ObjectHandles::Init(g_objectCapacity))
+        std::cerr << "[Objects] Object handles unavailable, p[i] reads 0" << std::endl;
+    ObjectHandles::Reset(g_numObjects);
+
+    // Ensemble world table, sampled by math.comp as a buffer texture
+    if (!ObjectWorlds::Init())
+        std::cerr << "[Objects] Ensemble worlds unavailable, every object is in one world" << std::endl;
+
+    // Queued host writes, applied in one pass
+    if (!ObjectScatter::Init(g_objectCapacity))
+        std::cerr << "[Objects] Object scatter unavailable, queued writes upload per run of objects" << std::endl;
+
+    // Load compute shader asynchronously
+    if (g_programCompute == 0)
+    {
+        std::string defines = ConstantBlockDefine();
+        g_computeLoader.LoadComputeShaderAsync(
+            "math.comp",
+            [defines](const std::string& source) { return InsertComputeDefines(source, defines); },
+            [](GLuint program)
+            {
+                g_programCompute = program;
+                g_computeShaderReady = true;
+                QueryComputeDispatchLimits(program);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[Objects] Compute shader FAILED: " << error << std::endl;
+                g_computeShaderReady = false;
+            });
+    }
+
+    // Constraint and collision passes of the simulation pipeline
+    LoadSimulationPass(g_constraintPass, "constraints.comp", s_constraintUniformNames, CONSTRAINT_UNIFORM_COUNT);
+    LoadSimulationPass(g_collisionPass, "collide.comp", s_collisionUniformNames, COLLIDE_UNIFORM_COUNT);
+
+    // Load quad rendering shader asynchronously
+    if (g_programQuad == 0)
+    {
+        g_quadLoader.LoadGraphicsShaderAsync(
+            "quad.vert",
+            "quad.frag",
+            "quad.geom",
+            [](GLuint program)
+            {
+                g_programQuad = program;
+                g_quadShaderReady = true;
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[Objects] Quad shader FAILED: " << error << std::endl;
+                g_quadShaderReady = false;
+            });
+    }
+    if (g_programQuadInstanced == 0)
+    {
+        g_quadInstancedLoader.LoadGraphicsShaderAsync(
+            "quad_instanced.vert",
+            "quad_instanced.frag",
+            "",
+            [](GLuint program)
+            {
+                g_programQuadInstanced = program;
+                g_quadVisibleListLoc = glGetUniformLocation(program, "uVisibleList");
+                g_quadBlendLoc = glGetUniformLocation(program, "uBlend");
+                g_quadTiledLoc = glGetUniformLocation(program, "uTiled");
+                g_quadInstancedReady = true;
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[Objects] Instanced quad shader FAILED (drawing through quad.geom): " << error << std::endl;
+                g_quadInstancedReady = false;
+            });
+    }
+
+    return true;
+}
+
+// Equation evaluations per step - MUST MATCH integratorStageCount() in math.comp
+static int IntegratorStageCount(IntegratorMethod method)
+{
+    if (method == INTEGRATOR_VELOCITY_VERLET) return 2;
+    if (method == INTEGRATOR_YOSHIDA4 || method == INTEGRATOR_RK4) return 4;
+    return 1;
+}
+
+// Sort the host objects of the buffer in use into Z-order of their position, so the objects
+// a collision cell, a neighbour sum or a p[i] read touches sit in neighbouring rows. Every
+// per-object table moves with them; handles keep naming the same objects. False when the
+// shaders are not ready yet (retried on the next step); true when sorted or nothing to do.
+static bool ReorderObjectStorage()
+{
+    // World ranges and spring rows are laid out by index, and spawned objects are appended
+    // on the GPU behind the host ones - those scenes keep their order
+    int n = g_numObjects;
+    if (n < 2 || ObjectLifecycle::IsActive() || ObjectWorlds::Count() > 0 || SpringNetwork::GetSpringCount() > 0)
+        return true;
+    if (!ObjectReorder::IsReady()) return false;
+
+    Objects::FlushObjectWrites();  // Indices are about to move
+    SyncConstraintMirror();
+    std::vector<int> order;
+    if (!ObjectReorder::BuildSpatialOrder(g_objectSSBO[g_currentObjectBuffer], n, order)) return true;
+    std::vector<int> newIndex(n);
+    for (int i = 0; i < n; i++) newIndex[order[i]] = i;
+
+    for (int i = 0; i < 2; i++) ObjectReorder::Permute(g_objectSSBO[i], sizeof(Object), n);
+    if (g_initialStateCount == n) ObjectReorder::Permute(g_initialStateSSBO, sizeof(Object), n);
+    else g_initialStateCount = -1;
+    StateRegisters::Permute(n);
+    ObjectSensitivity::Permute(n);
+    ObjectParams::Permute(order);
+    ObjectHandles::Permute(order);
+    StaticColliders::Permute(order);
+    KinematicPaths::Permute(order);
+    ObjectAggregates::Permute(order);
+
+    std::vector<CollisionProperties> props(g_collisionProperties.begin(), g_collisionProperties.begin() + n);
+    std::vector<int> equationIDs(g_objectEquationIDs.begin(), g_objectEquationIDs.begin() + n);
+    for (int i = 0; i < n; i++)
+    {
+        g_collisionProperties[i] = props[order[i]];
+        g_objectEquationIDs[i] = equationIDs[order[i]];  // Same set of references, so the counts hold
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_collisionPropsSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, n * sizeof(CollisionProperties), g_collisionProperties.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    PermuteObjectConstraints(order, newIndex);
+    RemapCollisionExclusions(newIndex);
+    UploadConstraintsToGPU();
+
+    // Everything else that remembers indices starts over
+    ObjectSleep::WakeAll();
+    ContactSolver::ResetWarmStart();
+    ObjectTrails::Reset();
+    NanScan::DropCheckpoint();
+    g_collidableCountDirty = true;
+    g_dispatchOrderObjects = -1;
+    g_objectGeneration++;
+    return true;
+}
+
+// ============================================================================
+// Update object physics: [sum_j pairs] -> evaluate + integrate (per integrator stage) -> constraints -> broadphase -> collisions
+// Passes nobody needs this step are skipped entirely
+// ============================================================================
+int Objects::Update(int inputIndex, int outputIndex, int substeps)
+{
+    FRAME_TRACE_ZONE("Objects::Update");
+    UpdateShaderLoadingStatus();
+    if (g_equationCompileMode && g_computeShaderReady) RequestCompiledEquations();
+    if (g_computeShaderReady) RequestComputeVariant();
+
+    if (g_programCompute == 0 || !g_computeShaderReady) return 0;
+    if (!g_constraintPass.ready || !g_collisionPass.ready) return 0;
+
+    // Storage order first, so everything below sees the new indices
+    if (g_storageReorderInterval > 0 && ++g_stepsSinceStorageReorder >= g_storageReorderInterval)
+    {
+        g_currentObjectBuffer = inputIndex;
+        if (ReorderObjectStorage()) g_stepsSinceStorageReorder = 0;
+    }
+
+    // Every program here was link-checked by its loader before it was handed over
+    UploadSimParams();
+    UploadConstantBlock();
+    ObjectParams::Bind();
+    GridFields::Step();  // Before the lookups bind, so field() reads this step's values
+    LookupTables::Bind();
+    ObjectHandles::Bind();
+    ObjectWorlds::Bind();
+    PerfCounters::Bind();
+    GLint perfCounters = PerfCounters::IsEnabled() ? 1 : 0;
+    bool metropolis = Metropolis::IsEnabled();
+    Metropolis::Bind(g_numObjects);
+    if (g_equationsUseState) StateRegisters::Bind();
+    int sensitivityCount = ObjectSensitivity::GetCount();
+    if (sensitivityCount > 0) ObjectSensitivity::Bind();
+
+    // Host edits since the last step, all in one scatter
+    g_currentObjectBuffer = inputIndex;
+    FlushObjectWrites();
+    if (g_initialStateCount < 0) CaptureInitialState(inputIndex);
+
+    // Spawns and kills of earlier steps, once their count has reached the host
+    int lifecycleCount = 0;
+    if (ObjectLifecycle::PollObjectCount(lifecycleCount)) g_numObjects = lifecycleCount;
+    // Emitters only fill the capacity that exists, so keep it ahead of them
+    if (ObjectLifecycle::IsActive() && g_numObjects * 2 > g_objectCapacity && g_objectCapacity < MAX_OBJECTS)
+        ReserveObjects(std::min(g_numObjects * 2, MAX_OBJECTS));
+
+    // Fused substeps skip the passes between steps, so they are only valid for independent objects.
+    // An adaptive dt is re-chosen after every step, so it takes one step per call.
+    bool adaptiveTimestep = IsAdaptiveTimestepActive();
+    if (substeps < 1 || !CanFuseSubsteps() || adaptiveTimestep) substeps = 1;
+
+    // Plan the passes for this step
+    bool runConstraints = g_liveConstraintCount > 0;
+    bool runCollisions = HasCollidableObjects();
+
+    // Static colliders keep their state and sit in a grid of their own, rebuilt only when one of
+    // them changes. GPU-spawned objects shift the indices the mask is kept by, so emitters turn
+    // them into ordinary objects until they stop.
+    bool staticColliders = StaticColliders::GetCount() > 0 && !ObjectLifecycle::IsActive();
+    bool staticGrid = staticColliders && runCollisions &&
+                      StaticColliders::Update(g_objectSSBO[inputIndex], g_collisionProperties.data(), g_numObjects);
+    if (staticColliders) StaticColliders::Bind();
+    if (staticColliders != g_broadphaseExcludesStatic) g_broadphaseStale = true;
+    bool kinematicObjects = KinematicPaths::GetCount() > 0 && !ObjectLifecycle::IsActive();
+    if (kinematicObjects) KinematicPaths::Bind();
+
+    // Group aggregates from the state at the start of the step, before any equation reads agg[]
+    ObjectAggregates::Compute(g_objectSSBO[inputIndex], g_numObjects);
+    ObjectAggregates::Bind();
+
+    // Integration writes straight to the output unless the collision pass still has to read it
+    GLuint integratedSSBO = g_objectSSBO[outputIndex];
+    if (runCollisions)
+    {
+        if (g_objectScratchSSBO == 0)
+        {
+            glGenBuffers(1, &g_objectScratchSSBO);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectScratchSSBO);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, g_objectCapacity * sizeof(Object), nullptr, GL_DYNAMIC_COPY);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+        integratedSSBO = g_objectScratchSSBO;
+    }
+
+    // Behaviour groups resolve to their equations through the table until the integration ends
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, EQUATION_GROUPS_BINDING, g_groupEquationsSSBO);
+
+    // Re-sort the dispatch order every N steps, and immediately when the object count changed
+    bool useDispatchOrder = false;
+    if (g_dispatchReorderInterval > 0)
+    {
+        bool stale = g_dispatchOrderObjects != g_numObjects;
+        if (stale || ++g_stepsSinceReorder >= g_dispatchReorderInterval)
+        {
+            if (DispatchOrder::Build(g_objectSSBO[inputIndex], g_numObjects))
+            {
+                g_dispatchOrderObjects = g_numObjects;
+                g_stepsSinceReorder = 0;
+            }
+        }
+        useDispatchOrder = g_dispatchOrderObjects == g_numObjects;
+    }
+
+    // Multi-stage integrators run every stage inside one dispatch unless some object reads another
+    // object's state, or fields the pipeline computes from it; then each stage is its own pass over
+    // the whole system at that stage
+    int integratorStages = metropolis ? 1 : IntegratorStageCount(g_integrator);  // A chain proposes once per step
+    bool stagedIntegration = integratorStages > 1 && (g_equationsReadOtherObjects || ObjectPipeline::IsActive());
+    int integrationPasses = stagedIntegration ? integratorStages : 1;
+
+    // Sleeping objects: the passes run from the active set built after the previous step.
+    // Constraints, springs and staged integrators read every object between passes, so they keep all
+    // objects awake; turning collisions on or off changes the buffers sleepers rest in. The active
+    // set would go stale whenever the GPU moves spawned objects, so emitters keep everything awake,
+    // and a kinematic object that came to rest would stop following its path.
+    bool useSleep = g_sleepEnabled && !metropolis && !runConstraints && SpringNetwork::GetSpringCount() == 0 && !stagedIntegration &&
+                    !ObjectLifecycle::IsActive() && KinematicPaths::GetCount() == 0 && ObjectSleep::IsReady();
+    int sleepConfig = useSleep ? (runCollisions ? 2 : 1) : 0;
+    if (sleepConfig != g_sleepConfig)
+    {
+        ObjectSleep::WakeAll();
+        g_sleepConfig = sleepConfig;
+    }
+    bool useActiveSet = useSleep && ObjectSleep::HasActiveSet(g_numObjects);
+
+    // Work-group size of each per-object pass; the active set's dispatch arguments are planned
+    // for the default size, so steps that let objects sleep keep it
+    bool tunedSizes = !useSleep;
+    auto passLocalSize = [tunedSizes](TunedPass pass)
+    {
+        return tunedSizes ? WorkgroupTuner::GetLocalSize(pass) : DEFAULT_LOCAL_SIZE;
+    };
+    if (stagedIntegration && g_integratorScratchSSBO == 0)
+    {
+        glGenBuffers(2, g_integratorStageSSBO);
+        for (int i = 0; i < 2; i++)
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_integratorStageSSBO[i]);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, g_objectCapacity * sizeof(Object), nullptr, GL_DYNAMIC_COPY);
+        }
+        glGenBuffers(1, &g_integratorScratchSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_integratorScratchSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, g_objectCapacity * sizeof(IntegratorScratch), nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    int computeLocalSize = DEFAULT_LOCAL_SIZE;
+    GLuint computeProgram = ActiveComputeProgram(passLocalSize(TUNED_PASS_INTEGRATE), &computeLocalSize);
+    const GLint* computeLocs = ComputeUniformLocations(computeProgram);
+
+    // Dispatch one invocation per object using the program's work-group size
+    GLuint groupsX = 1, groupsY = 1;
+    PlanComputeDispatch(g_numObjects, computeLocalSize, groupsX, groupsY);
+
+    // Every integration pass stores the bounds of what it writes; sleepers keep theirs, which
+    // hold only while nothing changed since the step that stored them. GPU spawns are stored
+    // by no pass.
+    bool objectBounds = !ObjectLifecycle::IsActive() && (!useActiveSet || ObjectBounds::IsCurrent(GetSceneRevision()));
+    ObjectBounds::BindForWrite();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, g_collisionPropsSSBO);
+
+    GpuProfiler::Begin("integrate");
+    WorkgroupTuner::BeginPass(TUNED_PASS_INTEGRATE, computeLocalSize);
+    for (int stage = 0; stage < integrationPasses; stage++)
+    {
+        GLuint stageInput = (stage == 0) ? g_objectSSBO[inputIndex] : g_integratorStageSSBO[(stage - 1) % 2];
+        GLuint stageOutput = (stage == integrationPasses - 1) ? integratedSSBO : g_integratorStageSSBO[stage % 2];
+
+        // Barnes-Hut accelerations from the state being evaluated, read by math.comp as grav_ax/coul_ax
+        bool useLongRange = g_equationsUseLongRange && LongRange::Compute(stageInput, g_numObjects);
+
+        // SPH density, pressure and accelerations into the same buffer, read as sph_ax/sph_rho/...
+        bool useFluid = g_equationsUseFluid &&
+            SphFluid::Compute(stageInput, g_collisionPropsSSBO, LongRange::GetFieldBuffer(), g_numObjects);
+
+        // Pipeline fields of the state being evaluated, read as fld[name]; the passes build their own grids
+        bool usePipeline = ObjectPipeline::IsActive() && ObjectPipeline::Run(stageInput, g_collisionPropsSSBO, g_numObjects);
+
+        // Neighbour grid for nsum/ncount/nmean, one cell per largest radius so a query visits 3x3 cells
+        bool useNeighbourGrid = g_equationsUsePairSums && g_maxNeighbourRadius > 0.0f &&
+            Broadphase::BuildNeighbourGrid(stageInput, g_collisionPropsSSBO, g_numObjects, g_maxNeighbourRadius,
+                                           false, true);
+
+        // Fields of the state being evaluated as dense streams, for equations that read other objects
+        bool useObjectStreams = g_structOfArraysStorage && (g_equationsReadOtherObjects || g_equationsUsePairSums) &&
+            ObjectStreams::Scatter(stageInput, g_numObjects);
+
+        // ------------------------------------------------------------------------
+        // Pass 1: equation evaluation + integration (math.comp)
+        // ------------------------------------------------------------------------
+        glUseProgram(computeProgram);
+
+        GLint numObjectsLoc = computeLocs[COMPUTE_NUM_OBJECTS];
+        if (numObjectsLoc != -1) glUniform1i(numObjectsLoc, g_numObjects);
+        GLint perfCountersLoc = computeLocs[COMPUTE_PERF_COUNTERS];
+        if (perfCountersLoc != -1) glUniform1i(perfCountersLoc, perfCounters);
+
+        GLint numWorldsLoc = computeLocs[COMPUTE_NUM_WORLDS];
+        if (numWorldsLoc != -1) glUniform1i(numWorldsLoc, ObjectWorlds::Count());
+        GLint worldParametersLoc = computeLocs[COMPUTE_WORLD_PARAMETERS];
+        if (worldParametersLoc != -1) glUniform1i(worldParametersLoc, ObjectWorlds::HasParameters() ? 1 : 0);
+
+        GLint stepIndexLoc = computeLocs[COMPUTE_STEP_INDEX];
+        if (stepIndexLoc != -1) glUniform1i(stepIndexLoc, static_cast<GLint>(g_stepIndex % INT_MAX));
+        GLint frameStepsLeftLoc = computeLocs[COMPUTE_FRAME_STEPS_LEFT];
+        if (frameStepsLeftLoc != -1) glUniform1i(frameStepsLeftLoc, g_frameStepsLeft);
+        GLint randomSeedLoc = computeLocs[COMPUTE_RANDOM_SEED];
+        if (randomSeedLoc != -1) glUniform1ui(randomSeedLoc, g_randomSeed);
+        GLint stateRegistersLoc = computeLocs[COMPUTE_STATE_REGISTERS];
+        if (stateRegistersLoc != -1) glUniform1i(stateRegistersLoc, g_equationsUseState ? 1 : 0);
+        GLint sharedObjectRefsLoc = computeLocs[COMPUTE_SHARED_OBJECT_REFS];
+        if (sharedObjectRefsLoc != -1) glUniform1i(sharedObjectRefsLoc, g_equationsShareObjectRefs ? 1 : 0);
+        GLint staticObjectsLoc = computeLocs[COMPUTE_STATIC_OBJECTS];
+        if (staticObjectsLoc != -1) glUniform1i(staticObjectsLoc, staticColliders ? 1 : 0);
+        GLint kinematicObjectsLoc = computeLocs[COMPUTE_KINEMATIC_OBJECTS];
+        if (kinematicObjectsLoc != -1) glUniform1i(kinematicObjectsLoc, kinematicObjects ? 1 : 0);
+        GLint constantsInBlockLoc = computeLocs[COMPUTE_CONSTANTS_IN_BLOCK];
+        if (constantsInBlockLoc != -1) glUniform1i(constantsInBlockLoc, g_constantsInBlock ? 1 : 0);
+        GLint sensitivityCountLoc = computeLocs[COMPUTE_SENSITIVITY_COUNT];
+        if (sensitivityCountLoc != -1) glUniform1i(sensitivityCountLoc, metropolis ? 0 : sensitivityCount);
+        if (sensitivityCount > 0 && computeLocs[COMPUTE_SENSITIVITY_PARAMS] != -1)
+        {
+            GLint params[MAX_SENSITIVITY_PARAMETERS] = { -1, -1, -1, -1 };
+            const std::vector<int>& parameters = ObjectSensitivity::GetParameters();
+            std::copy(parameters.begin(), parameters.end(), params);
+            glUniform4iv(computeLocs[COMPUTE_SENSITIVITY_PARAMS], 1, params);
+        }
+        GLint metropolisLoc = computeLocs[COMPUTE_METROPOLIS];
+        if (metropolisLoc != -1) glUniform1i(metropolisLoc, metropolis ? 1 : 0);
+        if (metropolis)
+        {
+            glm::vec4 histogramBox = Metropolis::ShaderHistogramBox();
+            glm::ivec3 histogram = Metropolis::ShaderHistogram();
+            glUniform1f(computeLocs[COMPUTE_METROPOLIS_STEP_SIZE], Metropolis::GetStepSize());
+            glUniform4f(computeLocs[COMPUTE_METROPOLIS_HISTOGRAM_BOX], histogramBox.x, histogramBox.y, histogramBox.z, histogramBox.w);
+            glUniform3i(computeLocs[COMPUTE_METROPOLIS_HISTOGRAM], histogram.x, histogram.y, histogram.z);
+        }
+
+        GLint pipelineFieldsLoc = computeLocs[COMPUTE_PIPELINE_FIELDS];
+        if (pipelineFieldsLoc != -1) glUniform1i(pipelineFieldsLoc, usePipeline ? 1 : 0);
+        if (usePipeline) ObjectPipeline::Bind();
+
+        GLint objectStreamsLoc = computeLocs[COMPUTE_OBJECT_STREAMS];
+        if (objectStreamsLoc != -1) glUniform1i(objectStreamsLoc, useObjectStreams ? ObjectStreams::ShaderMode() : 0);
+        if (useObjectStreams) ObjectStreams::Bind();
+
+        GLint useActiveSetLoc = computeLocs[COMPUTE_USE_ACTIVE_SET];
+        if (useActiveSetLoc != -1) glUniform1i(useActiveSetLoc, useActiveSet ? 1 : 0);
+        if (useActiveSet) ObjectSleep::Bind();
+
+        // Pair reductions first: sum_j() against every other object staged through shared-memory
+        // tiles, nsum/ncount/nmean against the neighbour grid cells around each object
+        GLint pairSumPassLoc = computeLocs[COMPUTE_PAIR_SUM_PASS];
+        bool runPairSums = g_equationsUsePairSums && pairSumPassLoc != -1;
+        if (runPairSums)
+        {
+            if (g_pairSumExpressionsDirty) UploadPairSumExpressionsToGPU();
+            glUniform1i(pairSumPassLoc, 1);
+
+            GLint pairTilesLoc = computeLocs[COMPUTE_PAIR_TILES];
+            if (pairTilesLoc != -1) glUniform1i(pairTilesLoc, g_equationsUseAllPairs ? 1 : 0);
+            GLint neighbourCellSizeLoc = computeLocs[COMPUTE_NEIGHBOUR_CELL_SIZE];
+            if (neighbourCellSizeLoc != -1) glUniform1f(neighbourCellSizeLoc, useNeighbourGrid ? g_maxNeighbourRadius : 0.0f);
+            GLint gridTableSizeLoc = computeLocs[COMPUTE_GRID_TABLE_SIZE];
+            if (gridTableSizeLoc != -1) glUniform1ui(gridTableSizeLoc, Broadphase::GetGridTableSize());
+            if (useNeighbourGrid) Broadphase::BindNeighbourGrid();
+
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, stageInput);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, g_allTokensSSBO);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, g_allConstantsSSBO);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PAIR_SUMS_BINDING, g_pairSumsSSBO);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PAIR_SUM_EXPRESSIONS_BINDING, g_pairSumExpressionsSSBO);
+
+            DispatchObjects(useActiveSet, groupsX, groupsY);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            if (useNeighbourGrid) Broadphase::UnbindNeighbourGrid();
+        }
+        if (pairSumPassLoc != -1) glUniform1i(pairSumPassLoc, 0);
+
+        GLint useDispatchOrderLoc = computeLocs[COMPUTE_USE_DISPATCH_ORDER];
+        if (useDispatchOrderLoc != -1) glUniform1i(useDispatchOrderLoc, useDispatchOrder ? 1 : 0);
+        if (useDispatchOrder) DispatchOrder::Bind();
+        if (useLongRange || useFluid) LongRange::Bind();
+
+        GLint substepsLoc = computeLocs[COMPUTE_SUBSTEPS];
+        if (substepsLoc != -1) glUniform1i(substepsLoc, substeps);
+        GLint registerBytecodeLoc = computeLocs[COMPUTE_REGISTER_BYTECODE];
+        if (registerBytecodeLoc != -1) glUniform1i(registerBytecodeLoc, g_registerBytecodeEnabled ? 1 : 0);
+        GLint integratorLoc = computeLocs[COMPUTE_INTEGRATOR];
+        if (integratorLoc != -1) glUniform1i(integratorLoc, g_integrator);
+        GLint integratorStageLoc = computeLocs[COMPUTE_INTEGRATOR_STAGE];
+        if (integratorStageLoc != -1) glUniform1i(integratorStageLoc, stagedIntegration ? stage : -1);
+        GLint adaptiveTimestepLoc = computeLocs[COMPUTE_ADAPTIVE_TIMESTEP];
+        if (adaptiveTimestepLoc != -1) glUniform1i(adaptiveTimestepLoc, adaptiveTimestep ? 1 : 0);
+        if (adaptiveTimestep) AdaptiveTimestep::Bind();
+
+        // Hoisted subexpressions: one invocation per world, step, stage and prelude entry. Their
+        // values do not change between the passes of a staged step, so the first pass computes them.
+        if (g_preludeExpressionsDirty) UploadPreludeExpressionsToGPU();
+        GLint preludePassLoc = computeLocs[COMPUTE_PRELUDE_PASS];
+        GLint preludeCountLoc = computeLocs[COMPUTE_PRELUDE_COUNT];
+        bool runPrelude = g_preludeCount > 0 && preludePassLoc != -1 && preludeCountLoc != -1;
+        if (preludeCountLoc != -1) glUniform1i(preludeCountLoc, runPrelude ? g_preludeCount : 0);
+        if (runPrelude && stage == 0)
+        {
+            int worlds = (ObjectWorlds::HasParameters() && ObjectWorlds::Count() > 0) ? ObjectWorlds::Count() : 1;
+            int items = worlds * std::max(substeps, 1) * integratorStages * g_preludeCount;
+            BufferHelpers::EnsureBufferCapacity(g_preludeValuesSSBO, static_cast<GLsizeiptr>(items) * sizeof(float));
+
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, stageInput);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, g_allTokensSSBO);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, g_allConstantsSSBO);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, g_mappingsSSBO);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PRELUDE_EXPRESSIONS_BINDING, g_preludeExpressionsSSBO);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PRELUDE_VALUES_BINDING, g_preludeValuesSSBO);
+
+            GLuint preludeGroupsX, preludeGroupsY;
+            PlanComputeDispatch(items, computeLocalSize, preludeGroupsX, preludeGroupsY);
+            glUniform1i(preludePassLoc, 1);
+            glDispatchCompute(preludeGroupsX, preludeGroupsY, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            glUniform1i(preludePassLoc, 0);
+        }
+        if (runPrelude) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PRELUDE_VALUES_BINDING, g_preludeValuesSSBO);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, stageInput);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, stageOutput);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, g_allTokensSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, g_allConstantsSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, g_mappingsSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, EQUATION_BYTECODE_BINDING, g_allBytecodeSSBO);
+        if (stagedIntegration) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INTEGRATOR_SCRATCH_BINDING, g_integratorScratchSSBO);
+
+        DispatchObjects(useActiveSet, groupsX, groupsY);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        if (useDispatchOrder) DispatchOrder::Unbind();
+        if (useLongRange || useFluid) LongRange::Unbind();
+        if (runPairSums)
+        {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PAIR_SUMS_BINDING, 0);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PAIR_SUM_EXPRESSIONS_BINDING, 0);
+        }
+        if (stagedIntegration) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INTEGRATOR_SCRATCH_BINDING, 0);
+        if (runPrelude)
+        {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PRELUDE_EXPRESSIONS_BINDING, 0);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PRELUDE_VALUES_BINDING, 0);
+        }
+        if (adaptiveTimestep) AdaptiveTimestep::Unbind();
+        if (useObjectStreams) ObjectStreams::Unbind();
+        if (useActiveSet) ObjectSleep::Unbind();
+    }
+    WorkgroupTuner::EndPass(TUNED_PASS_INTEGRATE);
+    GpuProfiler::End("integrate");
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, EQUATION_GROUPS_BINDING, 0);
+    ObjectBounds::UnbindForWrite();
+    if (objectBounds) ObjectBounds::Bind();
+
+    // ------------------------------------------------------------------------
+    // Spring networks: impulses from the CSR springs on the integrated state (spring_network.comp)
+    // ------------------------------------------------------------------------
+    if (SpringNetwork::GetSpringCount() > 0)
+    {
+        GpuProfiler::Scope profile("springs");
+        float stepDt = adaptiveTimestep ? 0.0f : g_simParams.dt;
+        if (adaptiveTimestep) AdaptiveTimestep::Bind();
+        SpringNetwork::Apply(integratedSSBO, g_numObjects, stepDt * substeps, adaptiveTimestep);
+        if (adaptiveTimestep) AdaptiveTimestep::Unbind();
+    }
+
+    // ------------------------------------------------------------------------
+    // Pass 2: constraint solve, in place on the integrated state (constraints.comp)
+    // ------------------------------------------------------------------------
+    if (runConstraints)
+    {
+        GpuProfiler::Scope profile("constraints");
+
+        // Distance constraints first, as a Gauss-Seidel sweep over the colored graph; the
+        // per-object pass then handles the boundary and angle constraints on the corrected state
+        bool xpbdSolved = false;
+        if (g_xpbdConstraints && XpbdConstraints::IsReady())
+        {
+            if (g_xpbdGraphDirty || g_xpbdGraphObjects != g_numObjects) RebuildXpbdGraph();
+
+            float stepDt = adaptiveTimestep ? 0.0f : g_simParams.dt;
+            if (adaptiveTimestep) AdaptiveTimestep::Bind();
+            xpbdSolved = XpbdConstraints::Solve(integratedSSBO, g_numObjects, stepDt * substeps, adaptiveTimestep);
+            if (adaptiveTimestep) AdaptiveTimestep::Unbind();
+        }
+
+        int constraintLocalSize = DEFAULT_LOCAL_SIZE;
+        const SimulationPass& constraintPass =
+            SizedSimulationPass(g_constraintPass, g_sizedConstraintPasses, TUNED_PASS_CONSTRAINTS, passLocalSize(TUNED_PASS_CONSTRAINTS),
+                                "constraints.comp", s_constraintUniformNames, CONSTRAINT_UNIFORM_COUNT, "", constraintLocalSize);
+        glUseProgram(constraintPass.program);
+        if (constraintPass.numObjectsLoc != -1) glUniform1i(constraintPass.numObjectsLoc, g_numObjects);
+
+        GLint skipDistanceLoc = constraintPass.uniformLocs[CONSTRAINT_SKIP_DISTANCE];
+        if (skipDistanceLoc != -1) glUniform1i(skipDistanceLoc, xpbdSolved ? 1 : 0);
+        GLint constraintPerfLoc = constraintPass.uniformLocs[CONSTRAINT_PERF_COUNTERS];
+        if (constraintPerfLoc != -1) glUniform1i(constraintPerfLoc, perfCounters);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, g_constraintsSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, g_objectConstraintsSSBO);
+
+        // Breaking edits the rows on the GPU; the host arrays catch up when they are next used
+        bool breakable = g_breakableConstraints > 0;
+        if (breakable && g_constraintBreaksSSBO == 0)
+        {
+            GLuint zero = 0;
+            glGenBuffers(1, &g_constraintBreaksSSBO);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_constraintBreaksSSBO);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(zero), &zero, GL_DYNAMIC_COPY);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+        GLint breakableLoc = constraintPass.uniformLocs[CONSTRAINT_BREAKABLE];
+        if (breakableLoc != -1) glUniform1i(breakableLoc, breakable ? 1 : 0);
+        GLint constraintStaticLoc = constraintPass.uniformLocs[CONSTRAINT_STATIC_COLLIDERS];
+        if (constraintStaticLoc != -1) glUniform1i(constraintStaticLoc, staticColliders ? 1 : 0);
+        GLint constraintKinematicLoc = constraintPass.uniformLocs[CONSTRAINT_KINEMATIC_OBJECTS];
+        if (constraintKinematicLoc != -1) glUniform1i(constraintKinematicLoc, kinematicObjects ? 1 : 0);
+        if (breakable) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONSTRAINT_BREAKS_BINDING, g_constraintBreaksSSBO);
+
+        GLuint constraintGroupsX = 1, constraintGroupsY = 1;
+        PlanComputeDispatch(g_numObjects, constraintLocalSize, constraintGroupsX, constraintGroupsY);
+        WorkgroupTuner::BeginPass(TUNED_PASS_CONSTRAINTS, constraintLocalSize);
+        glDispatchCompute(constraintGroupsX, constraintGroupsY, 1);
+        WorkgroupTuner::EndPass(TUNED_PASS_CONSTRAINTS);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        if (breakable)
+        {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CONSTRAINT_BREAKS_BINDING, 0);
+            g_constraintMirrorStale = true;
+            g_constraintRowsTouched = std::max(g_constraintRowsTouched, g_numObjects);
+        }
+    }
+
+    // ------------------------------------------------------------------------
+    // Pass 3 + 4: broadphase build, then narrowphase/response + write-back (collide.comp)
+    // ------------------------------------------------------------------------
+    BroadphaseMode activeBroadphase = BROADPHASE_ALL_PAIRS;
+    if (runCollisions)
+    {
+        GpuProfiler::Scope profile("collisions");
+
+        // Small ensemble worlds walk their own objects, so a scene of only those builds nothing
+        int numWorlds = ObjectWorlds::Count();
+        bool allWorldsSmall = numWorlds > 0 && ObjectWorlds::LargestCount() <= g_smallWorldObjects;
+        if (g_broadphaseMode != BROADPHASE_ALL_PAIRS && !allWorldsSmall &&
+            Broadphase::BuildForCollision(g_broadphaseMode, integratedSSBO, g_collisionPropsSSBO, g_numObjects,
+                                          g_neighbourSkin, g_broadphaseStale, staticColliders, objectBounds))
+        {
+            activeBroadphase = g_broadphaseMode;
+            g_broadphaseStale = false;
+            g_broadphaseExcludesStatic = staticColliders;
+        }
+
+        // Candidates are read once per pair, from the streams of the integrated state when enabled
+        bool useObjectStreams = g_structOfArraysStorage && ObjectStreams::Scatter(integratedSSBO, g_numObjects);
+
+        // The narrowphase emits each touching pair once and the contact solver iterates over them
+        bool usePairSolver = ContactSolver::BeginStep(g_numObjects);
+
+        // One dispatch per collision shape once the specialised builds are ready; the active set
+        // and GPU-spawned objects (whose shapes the host does not know) take the single dispatch
+        bool useShapeBuckets = false;
+        if (g_shapeBuckets && !useActiveSet && !ObjectLifecycle::IsActive() && UpdateShapeBuckets())
+        {
+            useShapeBuckets = true;
+            for (int s = 0; s < NARROWPHASE_SHAPES; s++)
+            {
+                LoadSimulationPass(g_collisionShapePasses[s], "collide.comp", s_collisionUniformNames, COLLIDE_UNIFORM_COUNT,
+                                   ShapeBucketDefine(s + 1));
+                useShapeBuckets = useShapeBuckets && g_collisionShapePasses[s].ready;
+            }
+        }
+        if (useShapeBuckets && !g_shapeOrderUploaded)
+        {
+            BufferHelpers::EnsureBufferCapacity(g_shapeOrderSSBO, static_cast<GLsizeiptr>(g_objectCapacity) * sizeof(GLuint));
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, g_shapeOrder.size() * sizeof(GLuint), g_shapeOrder.data());
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            g_shapeOrderUploaded = true;
+        }
+        if (useShapeBuckets) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHAPE_ORDER_BINDING, g_shapeOrderSSBO);
+
+        if (useObjectStreams) ObjectStreams::Bind();
+        if (useSleep) ObjectSleep::Bind();
+        if (usePairSolver) ContactSolver::BindForCollision();
+        ContactEvents::Bind();
+        GLuint eventMask = ContactEvents::ShaderMask();
+        if (adaptiveTimestep) AdaptiveTimestep::Bind();
+
+        auto useCollisionPass = [&](const SimulationPass& pass)
+        {
+            const std::vector<GLint>& collideLocs = pass.uniformLocs;
+            glUseProgram(pass.program);
+            if (pass.numObjectsLoc != -1) glUniform1i(pass.numObjectsLoc, g_numObjects);
+
+            GLint broadphaseModeLoc = collideLocs[COLLIDE_BROADPHASE_MODE];
+            if (broadphaseModeLoc != -1) glUniform1i(broadphaseModeLoc, activeBroadphase);
+
+            GLint gridTableSizeLoc = collideLocs[COLLIDE_GRID_TABLE_SIZE];
+            if (gridTableSizeLoc != -1) glUniform1ui(gridTableSizeLoc, Broadphase::GetGridTableSize());
+
+            // Candidates are read from the streams when enabled
+            GLint objectStreamsLoc = collideLocs[COLLIDE_OBJECT_STREAMS];
+            if (objectStreamsLoc != -1) glUniform1i(objectStreamsLoc, useObjectStreams ? ObjectStreams::ShaderMode() : 0);
+
+            // Sleepers are skipped, and the moving objects that hit them reset their counters
+            GLint useActiveSetLoc = collideLocs[COLLIDE_USE_ACTIVE_SET];
+            if (useActiveSetLoc != -1) glUniform1i(useActiveSetLoc, useActiveSet ? 1 : 0);
+            GLint sleepStepsLoc = collideLocs[COLLIDE_SLEEP_STEPS];
+            if (sleepStepsLoc != -1) glUniform1ui(sleepStepsLoc, useSleep ? static_cast<GLuint>(ObjectSleep::GetSleepSteps()) : 0u);
+            GLint wakeSpeedLoc = collideLocs[COLLIDE_WAKE_SPEED];
+            if (wakeSpeedLoc != -1) glUniform1f(wakeSpeedLoc, ObjectSleep::GetVelocityThreshold());
+
+            GLint contactSolverLoc = collideLocs[COLLIDE_CONTACT_SOLVER];
+            if (contactSolverLoc != -1) glUniform1i(contactSolverLoc, usePairSolver ? 1 : 0);
+            GLint contactCapacityLoc = collideLocs[COLLIDE_CONTACT_CAPACITY];
+            if (contactCapacityLoc != -1) glUniform1ui(contactCapacityLoc, ContactSolver::GetCapacity());
+            GLint collidePerfLoc = collideLocs[COLLIDE_PERF_COUNTERS];
+            if (collidePerfLoc != -1) glUniform1i(collidePerfLoc, perfCounters);
+
+            // Touching pairs for the host event stream, from the solver when it resolves them
+            GLint contactEventsLoc = collideLocs[COLLIDE_CONTACT_EVENTS];
+            if (contactEventsLoc != -1) glUniform1ui(contactEventsLoc, usePairSolver ? 0u : eventMask);
+
+            // Swept tests take the step's motion as velocity * dt
+            GLint collideAdaptiveLoc = collideLocs[COLLIDE_ADAPTIVE_TIMESTEP];
+            if (collideAdaptiveLoc != -1) glUniform1i(collideAdaptiveLoc, adaptiveTimestep ? 1 : 0);
+
+            GLint shapeBucketLoc = collideLocs[COLLIDE_SHAPE_BUCKET];
+            if (shapeBucketLoc != -1) glUniform1i(shapeBucketLoc, useShapeBuckets ? 1 : 0);
+
+            // Verlet lists and the skin-inflated search, with the margin the structure was built with
+            GLint neighbourSkinLoc = collideLocs[COLLIDE_NEIGHBOUR_SKIN];
+            if (neighbourSkinLoc != -1)
+                glUniform1f(neighbourSkinLoc, activeBroadphase != BROADPHASE_ALL_PAIRS ? Broadphase::GetCollisionSkin() : 0.0f);
+
+            // Static colliders pass through, and the rest look them up in their grid
+            GLint staticCollidersLoc = collideLocs[COLLIDE_STATIC_COLLIDERS];
+            if (staticCollidersLoc != -1) glUniform1i(staticCollidersLoc, staticColliders ? 1 : 0);
+            glm::vec4 staticGridUniform = staticGrid ? StaticColliders::GetGridUniform() : glm::vec4(0.0f);
+            glm::ivec2 staticGridCells = staticGrid ? StaticColliders::GetGridCells() : glm::ivec2(0);
+            GLint staticGridLoc = collideLocs[COLLIDE_STATIC_GRID];
+            if (staticGridLoc != -1) glUniform4fv(staticGridLoc, 1, &staticGridUniform[0]);
+            GLint staticGridCellsLoc = collideLocs[COLLIDE_STATIC_GRID_CELLS];
+            if (staticGridCellsLoc != -1) glUniform2iv(staticGridCellsLoc, 1, &staticGridCells[0]);
+            GLint collideKinematicLoc = collideLocs[COLLIDE_KINEMATIC_OBJECTS];
+            if (collideKinematicLoc != -1) glUniform1i(collideKinematicLoc, kinematicObjects ? 1 : 0);
+            GLint numWorldsLoc = collideLocs[COLLIDE_NUM_WORLDS];
+            if (numWorldsLoc != -1) glUniform1i(numWorldsLoc, numWorlds);
+            GLint smallWorldLoc = collideLocs[COLLIDE_SMALL_WORLD_OBJECTS];
+            if (smallWorldLoc != -1) glUniform1i(smallWorldLoc, g_smallWorldObjects);
+        };
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, integratedSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, g_objectSSBO[outputIndex]);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, g_collisionPropsSSBO);
+
+        if (g_collisionExclusionsDirty) UploadCollisionExclusionsToGPU();
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 18, g_collisionExclusionsSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, POLYGON_TABLE_BINDING, g_polygonTableSSBO);
+
+        // NEW: Bind contact buffer if warm starting is enabled
+        if (g_enableWarmStart && !usePairSolver)
+        {
+            if (g_contactBufferSSBO == 0)
+            {
+                InitializeContactBuffer();
+            }
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, g_contactBufferSSBO);
+        }
+
+        if (activeBroadphase != BROADPHASE_ALL_PAIRS) Broadphase::BindForCollision(activeBroadphase);
+
+        // Builds of every bucket at the collide size first: the pass is only timed when all of them have it
+        int collideLocalSize = passLocalSize(TUNED_PASS_COLLIDE);
+        const SimulationPass* bucketPasses[NARROWPHASE_SHAPES + 1] = {};
+        int bucketLocalSizes[NARROWPHASE_SHAPES + 1] = {};
+        int timedLocalSize = collideLocalSize;
+        for (int bucket = 0; bucket <= (useShapeBuckets ? NARROWPHASE_SHAPES : 0); bucket++)
+        {
+            const SimulationPass& base = bucket == 0 ? g_collisionPass : g_collisionShapePasses[bucket - 1];
+            bucketPasses[bucket] = &SizedSimulationPass(base, g_sizedCollisionPasses[bucket], TUNED_PASS_COLLIDE, collideLocalSize,
+                                                        "collide.comp", s_collisionUniformNames, COLLIDE_UNIFORM_COUNT,
+                                                        ShapeBucketDefine(bucket), bucketLocalSizes[bucket]);
+            if (bucketLocalSizes[bucket] != collideLocalSize) timedLocalSize = 0;
+        }
+
+        WorkgroupTuner::BeginPass(TUNED_PASS_COLLIDE, timedLocalSize);
+        if (useShapeBuckets)
+        {
+            // Bucket 0 (no shape or collisions off) only passes its objects through
+            for (int bucket = 0; bucket <= NARROWPHASE_SHAPES; bucket++)
+            {
+                int first = g_shapeBucketStart[bucket];
+                int count = g_shapeBucketStart[bucket + 1] - first;
+                if (count == 0) continue;
+
+                const SimulationPass& pass = *bucketPasses[bucket];
+                useCollisionPass(pass);
+                if (pass.uniformLocs[COLLIDE_SHAPE_BUCKET_FIRST] != -1) glUniform1i(pass.uniformLocs[COLLIDE_SHAPE_BUCKET_FIRST], first);
+                if (pass.uniformLocs[COLLIDE_SHAPE_BUCKET_COUNT] != -1) glUniform1i(pass.uniformLocs[COLLIDE_SHAPE_BUCKET_COUNT], count);
+
+                GLuint bucketGroupsX = 1, bucketGroupsY = 1;
+                PlanComputeDispatch(count, bucketLocalSizes[bucket], bucketGroupsX, bucketGroupsY);
+                glDispatchCompute(bucketGroupsX, bucketGroupsY, 1);
+            }
+        }
+        else
+        {
+            useCollisionPass(*bucketPasses[0]);
+            GLuint collideGroupsX = 1, collideGroupsY = 1;
+            PlanComputeDispatch(g_numObjects, bucketLocalSizes[0], collideGroupsX, collideGroupsY);
+            DispatchObjects(useActiveSet, collideGroupsX, collideGroupsY);
+        }
+        WorkgroupTuner::EndPass(TUNED_PASS_COLLIDE);
+
+        if (usePairSolver)
+        {
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            ContactSolver::UnbindForCollision();
+            ContactSolver::Solve(g_objectSSBO[outputIndex], g_numObjects, g_maxContactIterations, g_enableWarmStart, useSleep,
+                                 eventMask, g_collisionPropsSSBO);
+        }
+
+        // The environment last, so nothing the narrowphase does pushes an object back into it
+        if (SdfColliders::IsActive())
+        {
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            SdfColliders::Resolve(g_objectSSBO[outputIndex], g_collisionPropsSSBO, g_numObjects, staticColliders, kinematicObjects);
+        }
+    }
+    // Pipelined frames are drawn from copies, so the step only has to be visible to the copy
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT |
+                    (g_framePipelineDepth ? GL_BUFFER_UPDATE_BARRIER_BIT : GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT));
+
+    // Clean up bindings
+    glUseProgram(0);
+    for (int i = 0; i < 9; i++) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 18, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, POLYGON_TABLE_BINDING, 0);
+    if (adaptiveTimestep) AdaptiveTimestep::Unbind();
+    ObjectStreams::Unbind();
+    ObjectSleep::Unbind();
+    PerfCounters::Unbind();
+    Metropolis::Unbind();
+    StateRegisters::Unbind();
+    ObjectSensitivity::Unbind();
+    ContactEvents::Unbind();
+    if (activeBroadphase != BROADPHASE_ALL_PAIRS) Broadphase::UnbindForCollision();
+    WorkgroupTuner::Update();
+
+    // Host-side dt of the step (lagged when adaptive; the shaders read the exact one)
+    float stepDt = g_simParams.dt, stepTime = g_simParams.time;
+    if (adaptiveTimestep) AdaptiveTimestep::GetLatest(stepDt, stepTime);
+
+    GpuProfiler::Begin("post_step");
+
+    // Kill, compact and spawn on the state this step produced
+    ObjectLifecycle::Step(g_objectSSBO[outputIndex], g_objectSSBO[inputIndex], g_collisionPropsSSBO, g_numObjects,
+                          stepDt * substeps, adaptiveTimestep);
+
+    // Count still steps against the state this step started from and compact the awake objects
+    if (useSleep)
+    {
+        ObjectSleep::Update(g_objectSSBO[outputIndex], g_objectSSBO[inputIndex], runCollisions ? g_objectScratchSSBO : 0,
+                            g_numObjects, stepDt * substeps, useDispatchOrder, g_computeLocalSizeX);
+    }
+
+    // dt of the next step from the state this one produced, left on the GPU for math.comp
+    if (adaptiveTimestep) AdaptiveTimestep::Estimate(g_objectSSBO[outputIndex], g_numObjects);
+
+    if (g_fastMath) ScanFastMathState(g_objectSSBO[outputIndex], substeps);
+    PerfCounters::EndStep();
+    ContactEvents::EndStep();
+    Metropolis::EndStep(substeps);
+
+    g_currentObjectBuffer = outputIndex;
+    CaptureReadback(outputIndex);
+    g_interpolationOutput = outputIndex;
+    g_interpolationSteps = substeps;
+    g_interpolationGeneration = g_objectGeneration;
+    PublishDisplayFrame(outputIndex);
+    ObjectTrails::Record(g_objectSSBO[outputIndex], g_numObjects);
+    ObjectRecorder::Capture(g_objectSSBO[outputIndex], g_numObjects, substeps, stepTime + stepDt * substeps);
+    GpuProfiler::End("post_step");
+    SwapInCompiledEquations();
+    if (objectBounds) ObjectBounds::MarkCurrent(GetSceneRevision());
+    g_stepIndex += substeps;
+    g_frameStepsLeft = std::max(g_frameStepsLeft - substeps, 0);
+    return substeps;
+}
+
+// ============================================================================
+// Several fixed steps can run inside one dispatch only when no object reads
+// another object's state between them
+// ============================================================================
+bool Objects::CanFuseSubsteps()
+{
+    return g_liveConstraintCount == 0 && SpringNetwork::GetSpringCount() == 0 && !HasCollidableObjects() &&
+           !g_equationsReadOtherObjects && ObjectAggregates::GetCount() == 0 &&  // Aggregates are reduced once per step
+           !GridFields::IsActive() &&  // Grid fields step once per step
+           !ObjectPipeline::IsActive();  // The passes run before every stage
+}
+
+// Everything a step would do is covered by cpu_backend.h
+bool Objects::CanStepOnCpu()
+{
+    if (g_equationsUseLongRange || g_equationsUseFluid || g_equationsUseRandom || g_equationsUseState || Metropolis::IsEnabled() || g_sleepEnabled || g_xpbdConstraints || g_adaptiveTimestep) return false;
+    if (ObjectWorlds::Count() > 0 || ObjectLifecycle::IsActive() || ObjectLifecycle::GetEmitterCount() > 0) return false;
+    if (SpringNetwork::GetSpringCount() > 0 || g_simParams.boundaryMode == BOUNDARY_PERIODIC) return false;
+    if (ObjectRecorder::IsRecording() || !g_collisionExclusions.empty()) return false;
+    if (g_breakableConstraints > 0) return false;  // Breaking runs in constraints.comp only
+    if (ObjectSensitivity::GetCount() > 0) return false;  // Tangents are integrated in math.comp only
+    if (StaticColliders::GetCount() > 0 || KinematicPaths::GetCount() > 0) return false;  // Skipped in math.comp only
+    if (SdfColliders::IsActive()) return false;  // Resolved in sdf_collide.comp only
+    if (ObjectAggregates::GetCount() > 0) return false;  // Reduced on the GPU
+    if (GridFields::IsActive()) return false;  // Stepped in grid_field.comp only
+    if (ObjectPipeline::IsActive()) return false;  // Passes run in object_pipeline.comp only
+    for (int id = 0; id < MAX_EQUATIONS; id++)  // The CPU backend evaluates colour and equations every step
+        if (!g_equationKeys[id].empty() && (g_equationMappings[id].colorInterval != 1 || g_equationMappings[id].stepInterval != 1)) return false;
+    for (int i = 0; i < g_numObjects; i++)
+    {
+        const CollisionProperties& props = g_collisionProperties[i];
+        if (props.enabled != 0 && (props.shapeType == COLLISION_POLYGON || props.continuous != 0)) return false;
+    }
+    return true;
+}
+
+unsigned long long Objects::GetSceneRevision()
+{
+    return g_objectGeneration + g_sceneRevision;
+}
+
+std::vector<std::string> Objects::GetEquationKeys()
+{
+    return g_equationKeys;
+}
+
+bool Objects::SetEquationColorInterval(int objectIndex, int interval)
+{
+    if (interval < 0 || GetEquationColorInterval(objectIndex) < 0) return false;
+    int eqID = ResolveEquationID(g_objectEquationIDs[objectIndex]);
+    if (g_equationMappings[eqID].colorInterval == interval) return true;
+
+    g_equationMappings[eqID].colorInterval = interval;
+    UploadEquationMapping(eqID);
+    return true;
+}
+
+int Objects::GetEquationColorInterval(int objectIndex)
+{
+    if (objectIndex < 0 || objectIndex >= g_numObjects || objectIndex >= static_cast<int>(g_objectEquationIDs.size()))
+        return -1;
+    int eqID = ResolveEquationID(g_objectEquationIDs[objectIndex]);
+    return eqID >= 0 ? g_equationMappings[eqID].colorInterval : -1;
+}
+
+bool Objects::SetEquationStepInterval(int objectIndex, int interval)
+{
+    if (interval < 1 || GetEquationStepInterval(objectIndex) < 0) return false;
+    int eqID = ResolveEquationID(g_objectEquationIDs[objectIndex]);
+    if (g_equationMappings[eqID].stepInterval == interval) return true;
+
+    g_equationMappings[eqID].stepInterval = interval;
+    UploadEquationMapping(eqID);
+    return true;
+}
+
+int Objects::GetEquationStepInterval(int objectIndex)
+{
+    if (objectIndex < 0 || objectIndex >= g_numObjects || objectIndex >= static_cast<int>(g_objectEquationIDs.size()))
+        return -1;
+    int eqID = ResolveEquationID(g_objectEquationIDs[objectIndex]);
+    return eqID >= 0 ? g_equationMappings[eqID].stepInterval : -1;
+}
+
+void Objects::SetFrameStepsLeft(int steps)
+{
+    g_frameStepsLeft = std::max(steps, 0);
+}
+
+// ============================================================================
+// Add or retrieve equation ID for a given equation string
+// ============================================================================
+
+// Storage touched by registrations whose upload was deferred, as [begin, end) per buffer
+struct PendingEquationUpload
+{
+    int tokenBegin = INT_MAX, tokenEnd = 0;
+    int constantBegin = INT_MAX, constantEnd = 0;
+    int bytecodeBegin = INT_MAX, bytecodeEnd = 0;
+    int firstMapping = INT_MAX, lastMapping = -1;
+};
+
+// Identity of what the GPU runs: the optimized, serialized components. Strings that differ
+// only in spelling ("-k*x", "-k * x", "-(k*x)") come out the same.
+static std::string CanonicalEquationKey(const GPUSerializedEquation& gpu_eq)
+{
+    std::string key;
+    auto append = [&key](const auto& buffer)
+    {
+        uint32_t count = static_cast<uint32_t>(buffer.size());
+        key.append(reinterpret_cast<const char*>(&count), sizeof(count));
+        key.append(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(buffer[0]));
+    };
+    for (const auto* tokens : { &gpu_eq.tokenBuffer_ax, &gpu_eq.tokenBuffer_ay, &gpu_eq.tokenBuffer_angular, &gpu_eq.tokenBuffer_r,
+                                &gpu_eq.tokenBuffer_g, &gpu_eq.tokenBuffer_b, &gpu_eq.tokenBuffer_a })
+        append(*tokens);
+    for (const auto* constants : { &gpu_eq.constantBuffer_ax, &gpu_eq.constantBuffer_ay, &gpu_eq.constantBuffer_angular,
+                                   &gpu_eq.constantBuffer_r, &gpu_eq.constantBuffer_g, &gpu_eq.constantBuffer_b,
+                                   &gpu_eq.constantBuffer_a })
+        append(*constants);
+    for (const std::vector<int>& tokens : gpu_eq.tokenBuffer_state)
+        append(tokens);
+    append(gpu_eq.constantBuffer_state);
+    return key;  // Bytecode is derived from the tokens
+}
+
+// Fill a free slot with a serialized equation, or alias the key to a slot running the same
+// program; uploads right away without pending, else only records the ranges for
+// FlushEquationUpload(). 0 (the default) if every slot is taken.
+static int RegisterSerializedEquation(const std::string& equationString, const GPUSerializedEquation& gpu_eq,
+                                      PendingEquationUpload* pending)
+{
+    std::string program = CanonicalEquationKey(gpu_eq);
+    auto same = g_equationProgramToID.find(program);
+    if (same != g_equationProgramToID.end())
+    {
+        g_equationStringToID[equationString] = same->second;
+        return same->second;
+    }
+
+    // The stack evaluator runs without bounds checks, so nothing reaches it unchecked
+    int stackDepth = 0;
+    std::string invalid = validateGPUSerializedEquation(gpu_eq, &stackDepth);
+    if (!invalid.empty())
+    {
+        std::cerr << "[Objects] ERROR: Rejected equation '" << equationString << "': " << invalid << std::endl;
+        return 0;
+    }
+
+    // Find available equation slot
+    int newID = -1;
+    for (int i = 0; i < Objects::MAX_EQUATIONS; i++)
+    {
+        if (g_equationKeys[i].empty())
+        {
+            newID = i;
+            break;
+        }
+    }
+
+    if (newID == -1)
+    {
+        std::cerr << "[Objects] ERROR: Max equations reached!" << std::endl;
+        return 0;
+    }
+
+    const std::vector<int>* tokenBuffers[] = {
+        &gpu_eq.tokenBuffer_ax, &gpu_eq.tokenBuffer_ay, &gpu_eq.tokenBuffer_angular, &gpu_eq.tokenBuffer_r,
+        &gpu_eq.tokenBuffer_g, &gpu_eq.tokenBuffer_b, &gpu_eq.tokenBuffer_a };
+    const std::vector<float>* constantBuffers[] = {
+        &gpu_eq.constantBuffer_ax, &gpu_eq.constantBuffer_ay, &gpu_eq.constantBuffer_angular, &gpu_eq.constantBuffer_r,
+        &gpu_eq.constantBuffer_g, &gpu_eq.constantBuffer_b, &gpu_eq.constantBuffer_a };
+    const std::vector<unsigned int>* bytecodeBuffers[] = {
+        &gpu_eq.bytecode_ax, &gpu_eq.bytecode_ay, &gpu_eq.bytecode_angular, &gpu_eq.bytecode_r,
+        &gpu_eq.bytecode_g, &gpu_eq.bytecode_b, &gpu_eq.bytecode_a };
+
+    // State updates: a token count per register, then the expressions back to back
+    std::vector<int> stateTokens;
+    if (gpu_eq.hasStateUpdates())
+    {
+        for (const std::vector<int>& tokens : gpu_eq.tokenBuffer_state)
+            stateTokens.push_back(static_cast<int>(tokens.size()));
+        for (const std::vector<int>& tokens : gpu_eq.tokenBuffer_state)
+            stateTokens.insert(stateTokens.end(), tokens.begin(), tokens.end());
+    }
+
+    // Objects the workgroups stage for the equation's p[i], after the state updates
+    std::vector<int> objectRefs = collectObjectRefs(gpu_eq);
+
+    // One contiguous range per storage buffer, reusing freed space where it fits
+    EquationAllocation alloc;
+    alloc.stackDepth = stackDepth;
+    for (int c = 0; c < 7; c++)
+    {
+        alloc.tokenCount += static_cast<int>(tokenBuffers[c]->size());
+        alloc.constantCount += static_cast<int>(constantBuffers[c]->size());
+        alloc.bytecodeCount += static_cast<int>(bytecodeBuffers[c]->size());
+    }
+    alloc.tokenCount += static_cast<int>(stateTokens.size() + objectRefs.size());
+    alloc.constantCount += static_cast<int>(gpu_eq.constantBuffer_state.size());
+    alloc.tokenOffset = AllocateEquationRange(g_tokenSpace, g_allTokens, alloc.tokenCount);
+    alloc.constantOffset = AllocateEquationRange(g_constantSpace, g_allConstants, alloc.constantCount);
+    if (alloc.bytecodeCount > 0) alloc.bytecodeOffset = AllocateEquationRange(g_bytecodeSpace, g_allBytecode, alloc.bytecodeCount);
+
+    // Calculate offsets for equation components
+    int currentTokenOffset = alloc.tokenOffset;
+    int currentConstantOffset = alloc.constantOffset;
+
+    // Register programs are laid out one after another in the equation's range, -1 where a component has none
+    int bytecodeCursor = alloc.bytecodeOffset;
+    auto appendBytecode = [&bytecodeCursor](const std::vector<unsigned int>& bytecode)
+    {
+        if (bytecode.empty()) return -1;
+        int offset = bytecodeCursor;
+        std::copy(bytecode.begin(), bytecode.end(), g_allBytecode.begin() + offset);
+        bytecodeCursor += static_cast<int>(bytecode.size());
+        return offset;
+    };
+
+    EquationMapping mapping;
+    mapping.tokenOffset_ax = currentTokenOffset;
+    mapping.tokenCount_ax = static_cast<int>(gpu_eq.tokenBuffer_ax.size());
+    mapping.constantOffset_ax = currentConstantOffset;
+    mapping.bytecodeOffset_ax = appendBytecode(gpu_eq.bytecode_ax);
+
+    mapping.tokenOffset_ay = currentTokenOffset + mapping.tokenCount_ax;
+    mapping.tokenCount_ay = static_cast<int>(gpu_eq.tokenBuffer_ay.size());
+    mapping.constantOffset_ay = currentConstantOffset + static_cast<int>(gpu_eq.constantBuffer_ax.size());
+    mapping.bytecodeOffset_ay = appendBytecode(gpu_eq.bytecode_ay);
+
+    mapping.tokenOffset_angular = mapping.tokenOffset_ay + mapping.tokenCount_ay;
+    mapping.tokenCount_angular = static_cast<int>(gpu_eq.tokenBuffer_angular.size());
+    mapping.constantOffset_angular = mapping.constantOffset_ay + static_cast<int>(gpu_eq.constantBuffer_ay.size());
+    mapping.bytecodeOffset_angular = appendBytecode(gpu_eq.bytecode_angular);
+
+    mapping.tokenOffset_r = mapping.tokenOffset_angular + mapping.tokenCount_angular;
+    mapping.tokenCount_r = static_cast<int>(gpu_eq.tokenBuffer_r.size());
+    mapping.constantOffset_r = mapping.constantOffset_angular + static_cast<int>(gpu_eq.constantBuffer_angular.size());
+    mapping.bytecodeOffset_r = appendBytecode(gpu_eq.bytecode_r);
+
+    mapping.tokenOffset_g = mapping.tokenOffset_r + mapping.tokenCount_r;
+    mapping.tokenCount_g = static_cast<int>(gpu_eq.tokenBuffer_g.size());
+    mapping.constantOffset_g = mapping.constantOffset_r + static_cast<int>(gpu_eq.constantBuffer_r.size());
+    mapping.bytecodeOffset_g = appendBytecode(gpu_eq.bytecode_g);
+
+    mapping.tokenOffset_b = mapping.tokenOffset_g + mapping.tokenCount_g;
+    mapping.tokenCount_b = static_cast<int>(gpu_eq.tokenBuffer_b.size());
+    mapping.constantOffset_b = mapping.constantOffset_g + static_cast<int>(gpu_eq.constantBuffer_g.size());
+    mapping.bytecodeOffset_b = appendBytecode(gpu_eq.bytecode_b);
+
+    mapping.tokenOffset_a = mapping.tokenOffset_b + mapping.tokenCount_b;
+    mapping.tokenCount_a = static_cast<int>(gpu_eq.tokenBuffer_a.size());
+    mapping.constantOffset_a = mapping.constantOffset_b + static_cast<int>(gpu_eq.constantBuffer_b.size());
+    mapping.bytecodeOffset_a = appendBytecode(gpu_eq.bytecode_a);
+
+    mapping.tokenOffset_state = mapping.tokenOffset_a + mapping.tokenCount_a;
+    mapping.tokenCount_state = static_cast<int>(stateTokens.size());
+    mapping.constantOffset_state = mapping.constantOffset_a + static_cast<int>(gpu_eq.constantBuffer_a.size());
+
+    mapping.tokenOffset_refs = mapping.tokenOffset_state + mapping.tokenCount_state;
+    mapping.tokenCount_refs = static_cast<int>(objectRefs.size());
+    if (!objectRefs.empty()) g_equationsShareObjectRefs = true;
+
+    // Store mapping
+    g_equationMappings[newID] = mapping;
+    if (ReadsOtherObjects(gpu_eq.tokenBuffer_ax) || ReadsOtherObjects(gpu_eq.tokenBuffer_ay) ||
+        ReadsOtherObjects(gpu_eq.tokenBuffer_angular) || ReadsOtherObjects(gpu_eq.tokenBuffer_r) ||
+        ReadsOtherObjects(gpu_eq.tokenBuffer_g) || ReadsOtherObjects(gpu_eq.tokenBuffer_b) ||
+        ReadsOtherObjects(gpu_eq.tokenBuffer_a) || AnyStateUpdate(gpu_eq, ReadsOtherObjects))
+        g_equationsReadOtherObjects = true;
+
+    if (ReadsLongRangeAccel(gpu_eq.tokenBuffer_ax) || ReadsLongRangeAccel(gpu_eq.tokenBuffer_ay) ||
+        ReadsLongRangeAccel(gpu_eq.tokenBuffer_angular) || ReadsLongRangeAccel(gpu_eq.tokenBuffer_r) ||
+        ReadsLongRangeAccel(gpu_eq.tokenBuffer_g) || ReadsLongRangeAccel(gpu_eq.tokenBuffer_b) ||
+        ReadsLongRangeAccel(gpu_eq.tokenBuffer_a) || AnyStateUpdate(gpu_eq, ReadsLongRangeAccel))
+    {
+        // The tree is only rebuilt once per step, so fused substeps would read stale forces
+        g_equationsUseLongRange = true;
+        g_equationsReadOtherObjects = true;
+    }
+
+    bool fluid = ReadsFluidState(gpu_eq.tokenBuffer_ax) || ReadsFluidState(gpu_eq.tokenBuffer_ay) ||
+                 ReadsFluidState(gpu_eq.tokenBuffer_angular) || ReadsFluidState(gpu_eq.tokenBuffer_r) ||
+                 ReadsFluidState(gpu_eq.tokenBuffer_g) || ReadsFluidState(gpu_eq.tokenBuffer_b) ||
+                 ReadsFluidState(gpu_eq.tokenBuffer_a) || AnyStateUpdate(gpu_eq, ReadsFluidState);
+    SphFluid::SetFluidEquation(newID, fluid);  // Slots are reused, so clear the flag too
+    if (fluid)
+    {
+        g_equationsUseFluid = true;
+        g_equationsReadOtherObjects = true;
+    }
+
+    if (ReadsRandom(gpu_eq.tokenBuffer_ax) || ReadsRandom(gpu_eq.tokenBuffer_ay) ||
+        ReadsRandom(gpu_eq.tokenBuffer_angular) || ReadsRandom(gpu_eq.tokenBuffer_r) ||
+        ReadsRandom(gpu_eq.tokenBuffer_g) || ReadsRandom(gpu_eq.tokenBuffer_b) ||
+        ReadsRandom(gpu_eq.tokenBuffer_a) || AnyStateUpdate(gpu_eq, ReadsRandom))
+        g_equationsUseRandom = true;  // The CPU backend has no generator
+
+    if (gpu_eq.hasStateUpdates() || ReadsStateRegisters(gpu_eq.tokenBuffer_ax) || ReadsStateRegisters(gpu_eq.tokenBuffer_ay) ||
+        ReadsStateRegisters(gpu_eq.tokenBuffer_angular) || ReadsStateRegisters(gpu_eq.tokenBuffer_r) ||
+        ReadsStateRegisters(gpu_eq.tokenBuffer_g) || ReadsStateRegisters(gpu_eq.tokenBuffer_b) ||
+        ReadsStateRegisters(gpu_eq.tokenBuffer_a))
+        g_equationsUseState = true;  // The registers live on the GPU only
+
+    // Non-short-circuit: every component has to record its pair reduction slots
+    bool usesPairSums = RegisterPairSums(newID, gpu_eq.tokenBuffer_ax, gpu_eq.constantBuffer_ax, mapping.tokenOffset_ax, mapping.constantOffset_ax);
+    usesPairSums |= RegisterPairSums(newID, gpu_eq.tokenBuffer_ay, gpu_eq.constantBuffer_ay, mapping.tokenOffset_ay, mapping.constantOffset_ay);
+    usesPairSums |= RegisterPairSums(newID, gpu_eq.tokenBuffer_angular, gpu_eq.constantBuffer_angular, mapping.tokenOffset_angular, mapping.constantOffset_angular);
+    usesPairSums |= RegisterPairSums(newID, gpu_eq.tokenBuffer_r, gpu_eq.constantBuffer_r, mapping.tokenOffset_r, mapping.constantOffset_r);
+    usesPairSums |= RegisterPairSums(newID, gpu_eq.tokenBuffer_g, gpu_eq.constantBuffer_g, mapping.tokenOffset_g, mapping.constantOffset_g);
+    usesPairSums |= RegisterPairSums(newID, gpu_eq.tokenBuffer_b, gpu_eq.constantBuffer_b, mapping.tokenOffset_b, mapping.constantOffset_b);
+    usesPairSums |= RegisterPairSums(newID, gpu_eq.tokenBuffer_a, gpu_eq.constantBuffer_a, mapping.tokenOffset_a, mapping.constantOffset_a);
+    if (usesPairSums)
+    {
+        g_equationsUsePairSums = true;
+        g_pairSumExpressionsDirty = true;
+    }
+    bool usesPreludes = RegisterPreludes(newID, gpu_eq.tokenBuffer_ax, mapping.tokenOffset_ax, mapping.constantOffset_ax);
+    usesPreludes |= RegisterPreludes(newID, gpu_eq.tokenBuffer_ay, mapping.tokenOffset_ay, mapping.constantOffset_ay);
+    usesPreludes |= RegisterPreludes(newID, gpu_eq.tokenBuffer_angular, mapping.tokenOffset_angular, mapping.constantOffset_angular);
+    usesPreludes |= RegisterPreludes(newID, gpu_eq.tokenBuffer_r, mapping.tokenOffset_r, mapping.constantOffset_r);
+    usesPreludes |= RegisterPreludes(newID, gpu_eq.tokenBuffer_g, mapping.tokenOffset_g, mapping.constantOffset_g);
+    usesPreludes |= RegisterPreludes(newID, gpu_eq.tokenBuffer_b, mapping.tokenOffset_b, mapping.constantOffset_b);
+    usesPreludes |= RegisterPreludes(newID, gpu_eq.tokenBuffer_a, mapping.tokenOffset_a, mapping.constantOffset_a);
+    if (usesPreludes) g_preludeExpressionsDirty = true;
+    g_equationStringToID[equationString] = newID;
+    g_equationProgramToID[program] = newID;
+    g_equationKeys[newID] = equationString;
+    g_equationAllocations[newID] = alloc;
+    g_equationRevision++;
+
+    // Tokens and constants of the components, in component order
+    int tokenCursor = alloc.tokenOffset;
+    int constantCursor = alloc.constantOffset;
+    for (int c = 0; c < 7; c++)
+    {
+        std::copy(tokenBuffers[c]->begin(), tokenBuffers[c]->end(), g_allTokens.begin() + tokenCursor);
+        std::copy(constantBuffers[c]->begin(), constantBuffers[c]->end(), g_allConstants.begin() + constantCursor);
+        tokenCursor += static_cast<int>(tokenBuffers[c]->size());
+        constantCursor += static_cast<int>(constantBuffers[c]->size());
+    }
+    std::copy(stateTokens.begin(), stateTokens.end(), g_allTokens.begin() + tokenCursor);
+    std::copy(objectRefs.begin(), objectRefs.end(), g_allTokens.begin() + tokenCursor + stateTokens.size());
+    std::copy(gpu_eq.constantBuffer_state.begin(), gpu_eq.constantBuffer_state.end(), g_allConstants.begin() + constantCursor);
+
+    if (pending)
+    {
+        auto extend = [](int& begin, int& end, int offset, int count)
+        {
+            if (count <= 0) return;
+            begin = std::min(begin, offset);
+            end = std::max(end, offset + count);
+        };
+        extend(pending->tokenBegin, pending->tokenEnd, alloc.tokenOffset, alloc.tokenCount);
+        extend(pending->constantBegin, pending->constantEnd, alloc.constantOffset, alloc.constantCount);
+        extend(pending->bytecodeBegin, pending->bytecodeEnd, alloc.bytecodeOffset, alloc.bytecodeCount);
+        pending->firstMapping = std::min(pending->firstMapping, newID);
+        pending->lastMapping = std::max(pending->lastMapping, newID);
+        return newID;
+    }
+
+    // Update GPU data: only the new ranges and the one mapping
+    UploadTokenRange(alloc.tokenOffset, alloc.tokenCount);
+    UploadEquationRange(g_constantSpace, g_allConstantsSSBO, g_allConstants, alloc.constantOffset, alloc.constantCount);
+    g_constantBlockDirty = true;
+    UploadEquationRange(g_bytecodeSpace, g_allBytecodeSSBO, g_allBytecode, alloc.bytecodeOffset, alloc.bytecodeCount);
+    UploadEquationMapping(newID);
+
+    return newID;
+}
+
+// One write per storage buffer covering every deferred registration (space between them
+// holds the CPU copy's current contents, so it is rewritten unchanged)
+static void FlushEquationUpload(const PendingEquationUpload& pending)
+{
+    if (pending.lastMapping < 0) return;
+
+    auto upload = [](EquationSpace& space, GLuint& buffer, const auto& data, int begin, int end)
+    {
+        // An empty range still grows the buffer to the space allocated
+        UploadEquationRange(space, buffer, data, end > begin ? begin : 0, std::max(end - begin, 0));
+    };
+    UploadTokenRange(pending.tokenEnd > pending.tokenBegin ? pending.tokenBegin : 0, std::max(pending.tokenEnd - pending.tokenBegin, 0));
+    upload(g_constantSpace, g_allConstantsSSBO, g_allConstants, pending.constantBegin, pending.constantEnd);
+    g_constantBlockDirty = true;
+    upload(g_bytecodeSpace, g_allBytecodeSSBO, g_allBytecode, pending.bytecodeBegin, pending.bytecodeEnd);
+
+    if (g_mappingsSSBO == 0) return;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_mappingsSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, pending.firstMapping * sizeof(EquationMapping),
+                    (pending.lastMapping - pending.firstMapping + 1) * sizeof(EquationMapping),
+                    &g_equationMappings[pending.firstMapping]);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+int Objects::AddOrGetEquation(const std::string& equationString, const ParsedEquation& eq)
+{
+    // Return existing ID if equation already registered
+    auto it = g_equationStringToID.find(equationString);
+    if (it != g_equationStringToID.end()) return it->second;
+
+    // Serialize equation for GPU
+    return AddOrGetEquation(equationString, serializeEquationForGPU(eq));
+}
+
+int Objects::AddOrGetEquation(const std::string& equationString, const GPUSerializedEquation& gpu_eq)
+{
+    auto it = g_equationStringToID.find(equationString);
+    if (it != g_equationStringToID.end()) return it->second;
+
+    // Slots and storage of equations no object runs any more are reused
+    ReleaseUnreferencedEquations();
+    return RegisterSerializedEquation(equationString, gpu_eq, nullptr);
+}
+
+bool Objects::HasEquation(const std::string& equationString)
+{
+    return g_equationStringToID.count(equationString) != 0;
+}
+
+std::vector<int> Objects::AddOrGetEquations(const std::vector<std::string>& equationStrings,
+                                            const std::vector<GPUSerializedEquation>& equations)
+{
+    if (equationStrings.size() != equations.size())
+        throw std::runtime_error("AddOrGetEquations: one serialized equation per string expected");
+
+    std::vector<int> ids(equationStrings.size(), -1);
+    bool anyNew = false;
+    for (const std::string& key : equationStrings) anyNew = anyNew || !g_equationStringToID.count(key);
+
+    // Released once up front: the new equations have no objects yet and must survive the batch
+    if (anyNew) ReleaseUnreferencedEquations();
+    PendingEquationUpload pending;
+    for (size_t i = 0; i < equationStrings.size(); i++)
+    {
+        auto it = g_equationStringToID.find(equationStrings[i]);
+        ids[i] = (it != g_equationStringToID.end()) ? it->second
+                                                    : RegisterSerializedEquation(equationStrings[i], equations[i], &pending);
+    }
+    FlushEquationUpload(pending);
+    return ids;
+}
+
+// ============================================================================
+// Set equation for an object
+// ============================================================================
+static void AssignEquation(int eqID, int objectIndex)
+{
+    ObjectSleep::WakeAll();  // Objects written from the CPU may no longer be at rest
+    Objects::FlushObjectWrites();  // A queued whole-object write carries the old equation ID
+
+    if (objectIndex >= 0 && objectIndex < g_numObjects)
+    {
+        SetObjectEquationRef(objectIndex, eqID);
+        for (int i = 0; i < 2; i++)
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[i]);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+                objectIndex * sizeof(Object) + offsetof(Object, equationID),
+                sizeof(int), &eqID);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        g_objectGeneration++;
+    }
+}
+
+// One equation for many objects: the IDs go out with the next scatter pass
+static void AssignEquation(int eqID, const std::vector<int>& objectIndices)
+{
+    ObjectSleep::WakeAll();
+
+    Object values{};
+    values.equationID = eqID;
+    for (int index : objectIndices)
+    {
+        if (index < 0 || index >= g_numObjects) continue;
+        SetObjectEquationRef(index, eqID);
+        QueueObjectWrite(index, OBJECT_WRITE_EQUATION, values);
+    }
+}
+
+void Objects::SetEquation(const std::string& equationString, const ParsedEquation& eq, int objectIndex)
+{
+    AssignEquation(AddOrGetEquation(equationString, eq), objectIndex);
+}
+
+void Objects::SetEquation(const std::string& equationString, const ParsedEquation& eq, const std::vector<int>& objectIndices)
+{
+    AssignEquation(AddOrGetEquation(equationString, eq), objectIndices);
+}
+
+void Objects::SetEquation(const std::string& equationString, const GPUSerializedEquation& eq, int objectIndex)
+{
+    AssignEquation(AddOrGetEquation(equationString, eq), objectIndex);
+}
+
+void Objects::SetEquation(const std::string& equationString, const GPUSerializedEquation& eq, const std::vector<int>& objectIndices)
+{
+    AssignEquation(AddOrGetEquation(equationString, eq), objectIndices);
+}
+
+// ============================================================================
+// Behaviour groups
+// ============================================================================
+bool Objects::SetEquationGroup(int group, const std::vector<int>& objectIndices)
+{
+    if (group < 0 || group >= MAX_EQUATION_GROUPS) return false;
+    AssignEquation(EquationGroupID(group), objectIndices);
+    return true;
+}
+
+// The group's one table entry, whatever its size; the group holds the equation's reference
+static void AssignGroupEquation(int group, int eqID)
+{
+    int& current = g_groupEquations[group];
+    if (current == eqID) return;
+    ObjectSleep::WakeAll();  // Members at rest may not be under the new equation
+
+    if (current >= 0) g_equationRefCounts[current]--;
+    current = eqID;
+    if (current >= 0) g_equationRefCounts[current]++;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_groupEquationsSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, group * sizeof(int), sizeof(int), &eqID);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    g_sceneRevision++;
+}
+
+bool Objects::SetGroupEquation(const std::string& equationString, const GPUSerializedEquation& eq, int group)
+{
+    if (group < 0 || group >= MAX_EQUATION_GROUPS) return false;
+    AssignGroupEquation(group, AddOrGetEquation(equationString, eq));
+    return true;
+}
+
+bool Objects::ClearGroupEquation(int group)
+{
+    if (group < 0 || group >= MAX_EQUATION_GROUPS) return false;
+    AssignGroupEquation(group, -1);
+    return true;
+}
+
+int Objects::GetGroupEquation(int group)
+{
+    return (group >= 0 && group < MAX_EQUATION_GROUPS) ? g_groupEquations[group] : -1;
+}
+
+int Objects::ResolveEquationID(int equationID)
+{
+    int group = -2 - equationID;
+    return (group >= 0 && group < MAX_EQUATION_GROUPS) ? g_groupEquations[group] : equationID;
+}
+
+// Many equations for many objects: objectIndices[k] runs equations[objectEquations[k]]
+void Objects::SetEquations(const std::vector<std::string>& equationStrings, const std::vector<GPUSerializedEquation>& equations,
+                           const std::vector<int>& objectIndices, const std::vector<int>& objectEquations)
+{
+    if (objectIndices.size() != objectEquations.size())
+        throw std::runtime_error("SetEquations: one equation per object index expected");
+
+    std::vector<int> ids = AddOrGetEquations(equationStrings, equations);
+    ObjectSleep::WakeAll();
+
+    Object values{};
+    for (size_t k = 0; k < objectIndices.size(); k++)
+    {
+        int index = objectIndices[k];
+        int e = objectEquations[k];
+        if (index < 0 || index >= g_numObjects || e < 0 || e >= static_cast<int>(ids.size())) continue;
+        values.equationID = ids[e];
+        SetObjectEquationRef(index, ids[e]);
+        QueueObjectWrite(index, OBJECT_WRITE_EQUATION, values);
+    }
+}
+
+// ============================================================================
+// Upload CPU data to GPU (compatibility function)
+// ============================================================================
+void Objects::UploadCpuDataToGpu()
+{
+    // NO-OP for compatibility
+}
+
+// ============================================================================
+// Fetch object data from GPU to CPU
+// ============================================================================
+void Objects::FetchToCPU(int sourceIndex, std::vector<Object>& out)
+{
+    out.resize(g_numObjects);
+    FetchToCPU(sourceIndex, out.data());
+}
+
+int Objects::FetchToCPU(int sourceIndex, Object* out)
+{
+    FRAME_TRACE_ZONE("Objects::FetchToCPU");
+    // Whole-array readers are what the per-step copies are for; ranged and field reads stay
+    // direct until they repeat on one state (HostReadback)
+    FlushObjectWrites();
+    g_stepsSinceRead = 0;
+    InitReadbackRing();
+
+    if (g_numObjects > 0) ReadObjects(sourceIndex, 0, g_numObjects, out);
+    return g_numObjects;
+}
+
+void Objects::FetchToCPU(int sourceIndex, int first, int count, std::vector<Object>& out)
+{
+    FRAME_TRACE_ZONE("Objects::FetchToCPU");
+    FlushObjectWrites();
+    first = std::max(first, 0);
+    count = std::max(std::min(count, g_numObjects - first), 0);
+    out.resize(count);
+    if (count > 0) ReadObjects(sourceIndex, first, count, out.data());
+}
+
+int Objects::PickObject(int sourceIndex, const glm::vec2& worldPos)
+{
+    FlushObjectWrites();
+    int index = -1;
+    if (ObjectPick::Pick(g_objectSSBO[sourceIndex], g_numObjects, worldPos, index)) return index;
+
+    // Same test as object_pick.comp: nearest centre within the pick radius, lowest index on a tie
+    std::vector<Object> objects;
+    FetchToCPU(sourceIndex, objects);
+    float minDistSq = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        glm::vec2 d = objects[i].position - worldPos;
+        float distSq = glm::dot(d, d);
+        float radius = ObjectPick::PickRadius(objects[i].visualSkinType, objects[i].visualData);
+        if (distSq < radius * radius && distSq < minDistSq)
+        {
+            minDistSq = distSq;
+            index = static_cast<int>(i);
+        }
+    }
+    return index;
+}
+
+void Objects::QueryObjects(int sourceIndex, ObjectQuery::QueryShape shape, const std::vector<glm::vec4>& shapes,
+                           std::vector<std::vector<int>>& results)
+{
+    FlushObjectWrites();
+    GLuint objectSSBO = g_objectSSBO[sourceIndex];
+
+    // Every step that reads the neighbour grid rebuilds it first, so a query may build its own
+    float cellSize = ObjectQuery::GridCellSize(shape, shapes);
+    bool useGrid = cellSize > 0.0f &&
+        Broadphase::BuildNeighbourGrid(objectSSBO, g_collisionPropsSSBO, g_numObjects, cellSize, true);
+    if (useGrid) Broadphase::BindNeighbourGrid();
+    bool queried = ObjectQuery::Query(objectSSBO, g_numObjects, shape, shapes, cellSize,
+                                      useGrid ? Broadphase::GetGridTableSize() : 0, results);
+    if (useGrid) Broadphase::UnbindNeighbourGrid();
+    if (queried) return;
+
+    std::vector<Object> objects;
+    FetchToCPU(sourceIndex, objects);
+    results.assign(shapes.size(), std::vector<int>());
+    for (size_t q = 0; q < shapes.size(); ++q)
+        for (size_t i = 0; i < objects.size(); ++i)
+            if (ObjectQuery::Contains(shape, shapes[q], objects[i].position)) results[q].push_back(static_cast<int>(i));
+}
+
+void Objects::RaycastObjects(int sourceIndex, const std::vector<glm::vec4>& rays, float maxDistance,
+                             std::vector<RayHit>& hits)
+{
+    FlushObjectWrites();
+    GLuint objectSSBO = g_objectSSBO[sourceIndex];
+
+    // The collision pass rebuilds its structure every step, so a cast may build the LBVH itself
+    bool objectBounds = sourceIndex == g_currentObjectBuffer && ObjectBounds::IsCurrent(GetSceneRevision());
+    if (objectBounds) ObjectBounds::Bind();
+    bool useBVH = Broadphase::IsReady(BROADPHASE_LBVH) &&
+        Broadphase::Build(BROADPHASE_LBVH, objectSSBO, g_collisionPropsSSBO, g_numObjects, objectBounds);
+    if (useBVH) Broadphase::BindForCollision(BROADPHASE_LBVH);
+    bool cast = ObjectRaycast::Cast(objectSSBO, g_collisionPropsSSBO, g_numObjects, rays, maxDistance, useBVH, hits);
+    if (useBVH) Broadphase::UnbindForCollision();
+    if (cast) return;
+
+    // Same tests as object_raycast.comp: nearest entry, lowest index on a tie
+    std::vector<Object> objects;
+    FetchToCPU(sourceIndex, objects);
+    for (size_t r = 0; r < rays.size(); ++r)
+    {
+        glm::vec2 origin(rays[r].x, rays[r].y), dir(rays[r].z, rays[r].w);
+        float len = glm::length(dir);
+        if (!(len >= 1e-6f) || !std::isfinite(len) || !std::isfinite(origin.x) || !std::isfinite(origin.y)) continue;
+        dir /= len;
+        RayHit& hit = hits[r];
+        for (size_t i = 0; i < objects.size() && i < g_collisionProperties.size(); ++i)
+        {
+            const CollisionProperties& props = g_collisionProperties[i];
+            if (props.enabled == 0 || props.shapeType == COLLISION_NONE) continue;
+            float t;
+            glm::vec2 normal;
+            if (ObjectRaycast::Intersect(origin, dir, hit.distance, props.shapeType, objects[i].position,
+                                         objects[i].visualData, t, normal) &&
+                (t < hit.distance || hit.index < 0))
+            {
+                hit.index = static_cast<int>(i);
+                hit.distance = t;
+                hit.normal = normal;
+            }
+        }
+    }
+}
+
+// Host packing of ObjectGather fields, for reads served from a readback copy
+static void PackObjectFields(const Object& p, unsigned int fieldMask, float*& out)
+{
+    if (fieldMask & OBJECT_FIELD_POSITION) { *out++ = p.position.x; *out++ = p.position.y; }
+    if (fieldMask & OBJECT_FIELD_VELOCITY) { *out++ = p.velocity.x; *out++ = p.velocity.y; }
+    if (fieldMask & OBJECT_FIELD_MASS) *out++ = p.mass;
+    if (fieldMask & OBJECT_FIELD_CHARGE) *out++ = p.charge;
+    if (fieldMask & OBJECT_FIELD_ROTATION) *out++ = p.visualData.z;
+    if (fieldMask & OBJECT_FIELD_ANGULAR_VELOCITY) *out++ = p.visualData.w;
+    if (fieldMask & OBJECT_FIELD_SIZE) { *out++ = p.visualData.x; *out++ = p.visualData.y; }
+    if (fieldMask & OBJECT_FIELD_COLOR) { *out++ = p.color.r; *out++ = p.color.g; *out++ = p.color.b; *out++ = p.color.a; }
+    if (fieldMask & OBJECT_FIELD_SKIN) *out++ = static_cast<float>(p.visualSkinType);
+}
+
+bool Objects::FetchFields(int sourceIndex, const std::vector<int>& indices, unsigned int fieldMask, std::vector<float>& out)
+{
+    for (int index : indices)
+        if (index < 0 || index >= g_numObjects) return false;
+    FlushObjectWrites();
+
+    // A copy of the current state is already on the host; otherwise gather on the GPU
+    const ReadbackSlot* slot = HostReadback(sourceIndex, g_numObjects);
+    if (!slot && ObjectGather::Gather(g_objectSSBO[sourceIndex], indices, fieldMask, out))
+    {
+        g_readbackBytes += out.size() * sizeof(float);
+        return true;
+    }
+
+    out.resize(indices.size() * ObjectGather::FloatsPerObject(fieldMask));
+    float* packed = out.data();
+    for (int index : indices)
+    {
+        Object p;
+        if (slot) p = slot->mapped[index];
+        else ReadObjects(sourceIndex, index, 1, &p);
+        PackObjectFields(p, fieldMask, packed);
+    }
+    return true;
+}
+
+// ============================================================================
+// Trajectory recording
+// ============================================================================
+bool Objects::StartRecording(const std::vector<int>& indices, unsigned int fieldMask, int everyNSteps, int capacity,
+                             const GatherQuantization& quantization)
+{
+    for (int index : indices)
+        if (index < 0 || index >= g_numObjects) return false;
+    return ObjectRecorder::Start(indices, fieldMask, everyNSteps, capacity, quantization);
+}
+
+void Objects::StopRecording()
+{
+    ObjectRecorder::Stop();
+}
+
+bool Objects::IsRecording()
+{
+    return ObjectRecorder::IsRecording();
+}
+
+bool Objects::DownloadRecording(RecordedFrames& out, int newest)
+{
+    if (!ObjectRecorder::Download(out, newest)) return false;
+    g_readbackBytes += out.words.size() * sizeof(uint32_t);
+    return true;
+}
+
+int Objects::GetPendingRecordedFrames()
+{
+    return ObjectRecorder::PendingFrames();
+}
+
+uint64_t Objects::GetReadbackBytes()
+{
+    return g_readbackBytes;
+}
+
+// ============================================================================
+// Delta checkpoints
+// ============================================================================
+bool Objects::SetCheckpointBase(int sourceIndex)
+{
+    FlushObjectWrites();
+    return ObjectCheckpoint::SetBase(g_objectSSBO[sourceIndex], g_numObjects);
+}
+
+bool Objects::TakeCheckpointDelta(int sourceIndex, std::vector<int>& indices, std::vector<Object>& objects)
+{
+    FlushObjectWrites();
+    return ObjectCheckpoint::TakeDelta(g_objectSSBO[sourceIndex], g_numObjects, indices, objects);
+}
+
+// Per-object state of the objects appended from first to the end: no constraints, parameters,
+// colliders, paths, groups, registers or sensitivities
+static void ResetAppendedObjects(int first)
+{
+    for (int i = first; i < g_numObjects; i++)
+    {
+        g_objectConstraintMappings[i] = ObjectConstraints();
+        ObjectParams::Clear(i);
+        StaticColliders::Clear(i);
+        KinematicPaths::Clear(i);
+        ObjectAggregates::Clear(i);
+    }
+    StateRegisters::Clear(first, g_numObjects - first);
+    ObjectSensitivity::Clear(first, g_numObjects - first);
+    MarkConstraintMappingsDirty(first, g_numObjects);
+}
+
+// ============================================================================
+// Scene cache
+// ============================================================================
+bool Objects::CacheObjects(const std::string& name, int sourceIndex)
+{
+    if (sourceIndex < 0 || sourceIndex > 1) return false;
+    FlushObjectWrites();
+    std::vector<int> equationIDs(g_objectEquationIDs.begin(),
+                                 g_objectEquationIDs.begin() + std::min<size_t>(g_numObjects, g_objectEquationIDs.size()));
+    for (int& id : equationIDs) id = ResolveEquationID(id);  // The cache keeps equations, not groups
+    return SceneCache::Store(name, g_objectSSBO[sourceIndex], g_numObjects, equationIDs);
+}
+
+// The bookkeeping of AddObjects, with the rows copied from the cache instead of uploaded
+int Objects::AddCachedObjects(const std::string& name)
+{
+    int count = SceneCache::GetObjectCount(name);
+    if (count < 0) return -1;
+    FlushObjectWrites();
+    DiscardSpawnedObjects();
+    int first = g_numObjects;
+    if (count == 0) return first;
+    if (first + count > MAX_OBJECTS || !ReserveObjects(first + count)) return -1;
+
+    ObjectSleep::WakeAll();
+    ContactSolver::ResetWarmStart();
+    if (!SceneCache::Restore(name, g_objectSSBO, 2, first)) return -1;
+    g_objectGeneration++;
+
+    for (int i = first; i < first + count; i++) ObjectHandles::Append(i);
+    g_numObjects = first + count;
+    g_initialStateCount = -1;
+    ResetAppendedObjects(first);
+    return first;
+}
+
+// ============================================================================
+// Non-blocking readback of the live objects of an object buffer
+// ============================================================================
+int Objects::BeginReadback(int sourceIndex)
+{
+    if (sourceIndex < 0 || sourceIndex > 1 || g_objectSSBO[sourceIndex] == 0) return -1;
+    if (g_asyncReadbacks.size() >= MAX_ASYNC_READBACKS) return -1;
+    FlushObjectWrites();
+
+    AsyncReadback readback;
+    if (!g_freeAsyncReadbacks.empty())
+    {
+        readback = g_freeAsyncReadbacks.back();
+        g_freeAsyncReadbacks.pop_back();
+    }
+    if (readback.fence) glDeleteSync(readback.fence);
+
+    GLsizeiptr size = std::max(g_numObjects, 1) * sizeof(Object);
+    if (readback.buffer == 0) glGenBuffers(1, &readback.buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, readback.buffer);
+    if (readback.capacity < size)
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_READ);
+        readback.capacity = size;
+    }
+
+    // Queued behind every step already submitted; steps submitted later do not wait for it
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, g_objectSSBO[sourceIndex]);
+    if (g_numObjects > 0)
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, g_numObjects * sizeof(Object));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.numObjects = g_numObjects;
+    glFlush();  // So the fence reaches the GPU even if nothing else is submitted before the poll
+
+    int handle = g_nextReadbackHandle++;
+    g_asyncReadbacks[handle] = readback;
+    return handle;
+}
+
+bool Objects::IsReadbackReady(int handle)
+{
+    auto it = g_asyncReadbacks.find(handle);
+    if (it == g_asyncReadbacks.end()) return false;
+    GLenum status = glClientWaitSync(it->second.fence, 0, 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+bool Objects::ResolveReadback(int handle, std::vector<Object>& out, bool wait)
+{
+    FRAME_TRACE_ZONE("Objects::ResolveReadback");
+    auto it = g_asyncReadbacks.find(handle);
+    if (it == g_asyncReadbacks.end()) return false;
+    AsyncReadback& readback = it->second;
+
+    GLenum status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (wait && status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+    if (status == GL_TIMEOUT_EXPIRED) return false;
+
+    // The copy has landed, so this read does not wait on the pipeline
+    out.resize(readback.numObjects);
+    if (readback.numObjects > 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, readback.buffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, readback.numObjects * sizeof(Object), out.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        g_readbackBytes += static_cast<uint64_t>(readback.numObjects) * sizeof(Object);
+    }
+
+    ReleaseReadback(handle);
+    return true;
+}
+
+// Drop a handle without reading it; the staging buffer goes back to the pool (no GL calls)
+void Objects::ReleaseReadback(int handle)
+{
+    auto it = g_asyncReadbacks.find(handle);
+    if (it == g_asyncReadbacks.end()) return;
+    g_freeAsyncReadbacks.push_back(it->second);
+    g_asyncReadbacks.erase(it);
+}
+
+static void ReleaseAsyncReadbacks()
+{
+    for (auto& entry : g_asyncReadbacks) g_freeAsyncReadbacks.push_back(entry.second);
+    g_asyncReadbacks.clear();
+    for (AsyncReadback& readback : g_freeAsyncReadbacks)
+    {
+        if (readback.fence) glDeleteSync(readback.fence);
+        if (readback.buffer) glDeleteBuffers(1, &readback.buffer);
+    }
+    g_freeAsyncReadbacks.clear();
+}
+
+// ============================================================================
+// Reduce a per-object expression to one value on the GPU; only the result is read back
+// ============================================================================
+
+// Pair sums, long-range accelerations, pipeline fields and unexpanded derivatives need passes a
+// reduction does not run; rand(), table(), field() and s0..s7 need math.comp's generator, lookup
+// textures and state image
+static bool UsesStepOnlyInputs(const std::vector<Token>& tokens)
+{
+    for (const Token& token : tokens)
+    {
+        if (token.type == TOKEN_PAIR_SUM || token.type == TOKEN_DERIVATIVE) return true;
+        if (token.type == TOKEN_TABLE || token.type == TOKEN_FIELD) return true;
+        if (token.type == TOKEN_VARIABLE)
+        {
+            int varHash = hashVariableName(token.variable);
+            if (varHash >= VariableHashes::VAR_HASH_RAND_0 && varHash <= VariableHashes::VAR_HASH_RANDN_7) return true;
+            if (varHash >= VariableHashes::VAR_HASH_STATE_0 && varHash <= VariableHashes::VAR_HASH_STATE_7) return true;
+            if (varHash >= VariableHashes::VAR_HASH_AGG_0 && varHash <= VariableHashes::VAR_HASH_AGG_15) return true;
+            if (varHash >= VariableHashes::VAR_HASH_FIELD_0 && varHash <= VariableHashes::VAR_HASH_FIELD_7) return true;
+            if (varHash >= VariableHashes::VAR_HASH_GRAV_AX && varHash <= VariableHashes::VAR_HASH_COUL_AY) return true;
+            if (varHash >= VariableHashes::VAR_HASH_SPH_AX && varHash <= VariableHashes::VAR_HASH_SPH_P) return true;
+        }
+    }
+    return false;
+}
+
+// GLSL function `name` computing a per-object expression; what names the users in errors
+static bool ExpressionToFunction(const std::string& expression, const std::string& name, const char* what,
+                                 std::string& function, std::string& error)
+{
+    std::vector<Token> rpn;
+    try
+    {
+        ParserContext context;
+        rpn = infixToRPN(tokenizeExpression(expression, context));
+    }
+    catch (const std::exception& e)
+    {
+        error = std::string("Expression parsing failed: ") + e.what();
+        return false;
+    }
+    if (rpn.empty())
+    {
+        error = "Empty expression";
+        return false;
+    }
+    if (UsesStepOnlyInputs(rpn))
+    {
+        error = std::string(what) + " cannot use sum_j/nsum/ncount/nmean, long-range accelerations, rand()/randn(), s0..s7, agg[], fld[], table()/field() or numerical derivatives";
+        return false;
+    }
+
+    std::vector<int> tokens;
+    std::vector<float> constants;
+    std::unordered_map<float, int> constantMap;
+    serializeTokensToGPU(rpn, tokens, constants, constantMap);
+
+    function = EquationCodegen::GenerateExpressionFunction(tokens, constants, name);
+    if (function.empty())
+    {
+        error = "Expression cannot be compiled to GLSL";
+        return false;
+    }
+    return true;
+}
+
+bool Objects::ReduceObjects(int sourceIndex, const std::string& expression, ReductionOp op, float& result, std::string& error)
+{
+    if (sourceIndex < 0 || sourceIndex > 1)
+    {
+        error = "Invalid buffer index";
+        return false;
+    }
+
+    std::string function;
+    if (!ExpressionToFunction(expression, "reduceExpression", "Reductions", function, error)) return false;
+
+    FlushObjectWrites();
+    UploadSimParams();
+    ObjectParams::Bind();
+    ObjectHandles::Bind();
+    return ObjectReduction::Reduce(expression, function, op, g_objectSSBO[sourceIndex], g_numObjects, result, error);
+}
+
+bool Objects::ReduceWorlds(int sourceIndex, const std::string& expression, ReductionOp op, std::vector<float>& results, std::string& error)
+{
+    if (sourceIndex < 0 || sourceIndex > 1)
+    {
+        error = "Invalid buffer index";
+        return false;
+    }
+
+    std::string function;
+    if (!ExpressionToFunction(expression, "reduceExpression", "Reductions", function, error)) return false;
+
+    FlushObjectWrites();
+    UploadSimParams();
+    ObjectParams::Bind();
+    ObjectWorlds::Bind();
+    return ObjectReduction::ReduceWorlds(expression, function, op, g_objectSSBO[sourceIndex], g_numObjects,
+                                         ObjectWorlds::Count(), results, error);
+}
+
+bool Objects::HistogramObjects(int sourceIndex, const std::string& expressionX, const std::string& expressionY,
+                               int binsX, int binsY, const float range[4], std::vector<uint32_t>& counts, std::string& error)
+{
+    if (sourceIndex < 0 || sourceIndex > 1)
+    {
+        error = "Invalid buffer index";
+        return false;
+    }
+
+    // A 1D histogram shares the program of reduce() over the same expression
+    std::string functions, key = expressionX;
+    if (!ExpressionToFunction(expressionX, "reduceExpression", "Histograms", functions, error)) return false;
+    if (binsY > 1)
+    {
+        std::string second;
+        if (!ExpressionToFunction(expressionY, "histogramY", "Histograms", second, error)) return false;
+        functions = "#define HISTOGRAM_2D\n" + functions + second;
+        key = "histogram2d:" + expressionX + "\n" + expressionY;
+    }
+
+    FlushObjectWrites();
+    UploadSimParams();
+    ObjectParams::Bind();
+    ObjectHandles::Bind();
+    return ObjectReduction::Histogram(key, functions, g_objectSSBO[sourceIndex], g_numObjects, binsX, binsY, range,
+                                      counts, error);
+}
+
+bool Objects::EvaluateExpression(int sourceIndex, const std::string& expression, const EvalInput inputs[EVAL_COLUMN_COUNT],
+                                 size_t numPoints, float* results, std::string& error)
+{
+    if (sourceIndex < 0 || sourceIndex > 1)
+    {
+        error = "Invalid buffer index";
+        return false;
+    }
+
+    std::string function;
+    if (!ExpressionToFunction(expression, "evalExpression", "Evaluations", function, error)) return false;
+
+    FlushObjectWrites();
+    UploadSimParams();
+    ObjectParams::Bind();
+    ObjectHandles::Bind();
+    return ExpressionEval::Evaluate(expression, function, inputs, numPoints, g_objectSSBO[sourceIndex], g_numObjects,
+                                    results, error);
+}
+
+// ============================================================================
+// Draw all objects
+// ============================================================================
+// Program Draw() uses; GetQuadProgram() hands it out so the camera uniforms land on it
+static GLuint ActiveQuadProgram()
+{
+    if (g_quadInstancedReady && WorldTiles::IsActive()) return g_programQuadInstanced;  // Tiles are drawn instanced only
+    if (g_instancedRendering && g_quadInstancedReady) return g_programQuadInstanced;
+    return g_quadShaderReady ? g_programQuad : 0;
+}
+
+void Objects::Draw(int sourceIndex)
+{
+    GLuint program = ActiveQuadProgram();
+    if (!program) return;
+    FlushObjectWrites();
+    GpuProfiler::Scope profile("draw");
+
+    GLuint vao = g_renderVAO[sourceIndex];
+    GLuint buffer = g_objectSSBO[sourceIndex];
+    int count = g_numObjects;
+    if (g_framePipelineDepth)
+    {
+        // Host edits since the last step reach the screen through a copy of their own
+        int newest = -1;
+        for (int i = 0; i < g_framePipelineDepth; i++)
+            if (g_display[i].fence && (newest < 0 || g_display[i].generation > g_display[newest].generation)) newest = i;
+        if (newest < 0 || g_display[newest].generation != g_objectGeneration)
+        {
+            glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+            PublishDisplayFrame(g_currentObjectBuffer);
+        }
+
+        g_displayShown = PickDisplaySlot();
+        if (g_displayShown >= 0)
+        {
+            vao = g_display[g_displayShown].vao;
+            buffer = g_display[g_displayShown].buffer;
+            count = std::min(count, g_display[g_displayShown].numObjects);
+        }
+        else
+            glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // One point per object, so no culling or interpolation; skins wait until the shaders load
+    bool tiled = program == g_programQuadInstanced && WorldTiles::IsActive();
+    if (g_densityRendering && g_viewBoundsSet && DensitySplat::IsReady() && !tiled)
+    {
+        DensitySplat::Draw(buffer, count, g_viewProjView);
+        return;
+    }
+
+    // Culling runs its own program, so it goes first
+    // The stored bounds are of the current buffer; display copies and interpolated sources test circles
+    bool objectBounds = buffer == g_objectSSBO[g_currentObjectBuffer] && ObjectBounds::IsCurrent(GetSceneRevision());
+    if (objectBounds) ObjectBounds::Bind();
+    bool culled = program == g_programQuadInstanced && g_viewCulling && g_viewBoundsSet &&
+                  ObjectCulling::Cull(buffer, count, g_viewMin.x, g_viewMin.y, g_viewMax.x, g_viewMax.y, objectBounds);
+
+    glUseProgram(program);
+    if (program == g_programQuadInstanced)
+    {
+        // Four strip vertices per object, sized and cut out in the shaders
+        glBindVertexArray(g_quadInstancedVAO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, QUAD_OBJECT_BINDING, buffer);
+        if (g_quadVisibleListLoc != -1) glUniform1i(g_quadVisibleListLoc, culled ? 1 : 0);
+
+        // The other buffer still holds the state the last step started from, unless a host
+        // write or a pipelined copy came in between
+        bool interpolate = g_interpolationFraction < 1.0f && !g_framePipelineDepth &&
+                           sourceIndex == g_interpolationOutput && g_interpolationGeneration == g_objectGeneration;
+        float blend = interpolate ? (g_interpolationSteps - 1 + g_interpolationFraction) / g_interpolationSteps : 1.0f;
+        if (g_quadBlendLoc != -1) glUniform1f(g_quadBlendLoc, blend);
+        if (interpolate) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, QUAD_PREVIOUS_BINDING, g_objectSSBO[1 - sourceIndex]);
+
+        // Every world into its cell in the same draw, clipped to the cell edges
+        if (g_quadTiledLoc != -1) glUniform1i(g_quadTiledLoc, tiled ? 1 : 0);
+        if (tiled)
+        {
+            WorldTiles::Bind();
+            for (int plane = 0; plane < 4; plane++) glEnable(GL_CLIP_DISTANCE0 + plane);
+        }
+        if (culled)
+        {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_VISIBLE_BINDING, ObjectCulling::GetVisibleBuffer());
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ObjectCulling::GetCommandBuffer());
+            glDrawArraysIndirect(GL_TRIANGLE_STRIP, nullptr);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_VISIBLE_BINDING, 0);
+        }
+        else
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, QUAD_OBJECT_BINDING, 0);
+        if (interpolate) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, QUAD_PREVIOUS_BINDING, 0);
+        if (tiled)
+        {
+            for (int plane = 0; plane < 4; plane++) glDisable(GL_CLIP_DISTANCE0 + plane);
+            WorldTiles::Unbind();
+        }
+    }
+    else
+    {
+        glBindVertexArray(vao);
+        glDrawArrays(GL_POINTS, 0, count);
+    }
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+void Objects::SetInstancedRendering(bool enabled)
+{
+    g_instancedRendering = enabled;
+}
+
+bool Objects::GetInstancedRendering()
+{
+    return g_instancedRendering;
+}
+
+void Objects::SetInterpolationFraction(float fraction)
+{
+    g_interpolationFraction = std::isfinite(fraction) ? std::clamp(fraction, 0.0f, 1.0f) : 1.0f;
+}
+
+float Objects::GetInterpolationFraction()
+{
+    return g_interpolationFraction;
+}
+
+void Objects::SetViewBounds(const glm::mat4& projView)
+{
+    // The corners of the screen, taken back to the z = 0 plane the objects are drawn in
+    glm::mat4 inverse = glm::inverse(projView);
+    glm::vec2 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+    for (int corner = 0; corner < 4; corner++)
+    {
+        glm::vec4 p = inverse * glm::vec4((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, 0.0f, 1.0f);
+        glm::vec2 world = glm::vec2(p) / p.w;
+        lo = glm::min(lo, world);
+        hi = glm::max(hi, world);
+    }
+    g_viewBoundsSet = std::isfinite(lo.x) && std::isfinite(lo.y) && std::isfinite(hi.x) && std::isfinite(hi.y);
+    g_viewMin = lo;
+    g_viewMax = hi;
+    g_viewProjView = projView;
+}
+
+void Objects::SetViewCulling(bool enabled)
+{
+    g_viewCulling = enabled;
+}
+
+bool Objects::GetViewCulling()
+{
+    return g_viewCulling;
+}
+
+void Objects::SetDensityRendering(bool enabled)
+{
+    g_densityRendering = enabled;
+}
+
+bool Objects::GetDensityRendering()
+{
+    return g_densityRendering;
+}
+
+void Objects::SetDensityExposure(float exposure)
+{
+    DensitySplat::SetExposure(exposure);
+}
+
+float Objects::GetDensityExposure()
+{
+    return DensitySplat::GetExposure();
+}
+
+bool Objects::SetTrails(int objects, int length)
+{
+    return ObjectTrails::Configure(objects, length);
+}
+
+void Objects::GetTrails(int& objects, int& length)
+{
+    objects = ObjectTrails::GetObjects();
+    length = ObjectTrails::GetLength();
+}
+
+void Objects::DrawTrails(const glm::mat4& projView, int sourceIndex)
+{
+    ObjectTrails::Draw(projView, g_objectSSBO[sourceIndex], g_numObjects);
+}
+
+void Objects::SetConstraintRendering(bool enabled)
+{
+    g_constraintRendering = enabled;
+}
+
+bool Objects::GetConstraintRendering()
+{
+    return g_constraintRendering;
+}
+
+void Objects::SetConstraintStrainScale(float scale)
+{
+    ConstraintLines::SetStrainScale(scale);
+}
+
+float Objects::GetConstraintStrainScale()
+{
+    return ConstraintLines::GetStrainScale();
+}
+
+void Objects::DrawConstraints(const glm::mat4& projView, int sourceIndex)
+{
+    if (!g_constraintRendering) return;
+    if (g_constraintLineRevision != g_sceneRevision)
+    {
+        // Row extents change only with uploads, so the scan runs once per constraint edit
+        g_constraintLineRevision = g_sceneRevision;
+        g_constraintLineRows = 0;
+        g_constraintLineMaxPerRow = 0;
+        int rows = std::min(g_numObjects, static_cast<int>(g_objectConstraintMappings.size()));
+        for (int i = 0; i < rows; i++)
+        {
+            int count = g_objectConstraintMappings[i].numConstraints;
+            if (count <= 0) continue;
+            g_constraintLineRows = i + 1;
+            g_constraintLineMaxPerRow = std::max(g_constraintLineMaxPerRow, count);
+        }
+    }
+    ConstraintLines::Draw(projView, g_objectSSBO[sourceIndex], g_constraintsSSBO, g_objectConstraintsSSBO,
+                          g_numObjects, g_constraintLineRows, g_constraintLineMaxPerRow);
+}
+
+void Objects::DrawPhaseSpace(int sourceIndex, int width, int height)
+{
+    PhaseSpace::Draw(g_objectSSBO[sourceIndex], g_numObjects, width, height);
+}
+
+bool Objects::SetForceField(const std::string& axExpression, const std::string& ayExpression, std::string& error)
+{
+    std::string fieldX, fieldY;
+    if (!ExpressionToFunction(axExpression, "fieldX", "Force fields", fieldX, error)) return false;
+    if (!ExpressionToFunction(ayExpression, "fieldY", "Force fields", fieldY, error)) return false;
+    return ForceField::SetExpressions(fieldX + fieldY, error);
+}
+
+void Objects::ClearForceField()
+{
+    ForceField::ClearExpressions();
+}
+
+bool Objects::SetForceFieldGrid(float xMin, float xMax, float yMin, float yMax, int columns, int rows, float arrowScale)
+{
+    if (!ForceField::SetGrid(xMin, xMax, yMin, yMax, columns, rows)) return false;
+    ForceField::SetArrowScale(arrowScale);
+    return true;
+}
+
+void Objects::DrawForceField(const glm::mat4& projView, int sourceIndex)
+{
+    if (!ForceField::IsActive()) return;
+    FlushObjectWrites();
+    UploadSimParams();
+    ObjectParams::Bind();
+    ObjectHandles::Bind();
+    ForceField::Evaluate(g_objectSSBO[sourceIndex], g_numObjects);
+    ForceField::Draw(projView);
+}
+
+void Objects::SetFramePipelineDepth(int depth)
+{
+    depth = (depth <= 1) ? 0 : std::min(depth, MAX_FRAME_PIPELINE_DEPTH);
+    if (depth == g_framePipelineDepth) return;
+    ReleaseDisplaySlots();
+    g_framePipelineDepth = depth;
+}
+
+int Objects::GetFramePipelineDepth()
+{
+    return g_framePipelineDepth;
+}
+
+// ============================================================================
+// Add a new object with default properties
+// ============================================================================
+void Objects::AddObject()
+{
+    FlushObjectWrites();
+    DiscardSpawnedObjects();
+    if (g_numObjects >= MAX_OBJECTS)
+    {
+        std::cerr << "[Objects::AddObject] Max objects reached!" << std::endl;
+        return;
+    }
+    if (!ReserveObjects(g_numObjects + 1)) return;
+    ObjectSleep::WakeAll();
+
+    // Create default object
+    Object newObject = CreateDefaultObjectInternal(
+        g_currentDefaultObjectType,
+        g_numObjects,
+        0);
+
+    // Store object data
+    for (int i = 0; i < 2; i++)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[i]);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+            g_numObjects * sizeof(Object),
+            sizeof(Object),
+            &newObject);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    g_objectGeneration++;
+
+    // Initialize empty constraint mapping
+    g_objectConstraintMappings[g_numObjects] = ObjectConstraints();
+    MarkConstraintMappingsDirty(g_numObjects, g_numObjects + 1);
+    SetObjectEquationRef(g_numObjects, newObject.equationID);
+    ObjectParams::Clear(g_numObjects);
+    StaticColliders::Clear(g_numObjects);
+    KinematicPaths::Clear(g_numObjects);
+    ObjectAggregates::Clear(g_numObjects);
+    StateRegisters::Clear(g_numObjects);
+    ObjectSensitivity::Clear(g_numObjects);
+    ObjectHandles::Append(g_numObjects);
+    g_numObjects++;
+    g_initialStateCount = -1;
+}
+
+// ============================================================================
+// Upload multiple objects at once
+// ============================================================================
+void Objects::UploadBulkObjects(const std::vector<Object>& objects, int startIndex)
+{
+    if (startIndex < 0 || startIndex + static_cast<int>(objects.size()) > MAX_OBJECTS)
+    {
+        std::cerr << "[Objects::UploadBulkObjects] Invalid range!" << std::endl;
+        return;
+    }
+    if (!ReserveObjects(startIndex + static_cast<int>(objects.size()))) return;
+    FlushObjectWrites();  // Older edits must not land on top of the new objects
+    DiscardSpawnedObjects();
+    ObjectSleep::WakeAll();
+    ContactSolver::ResetWarmStart();  // Impulses of the state being replaced
+
+    // Copy objects to GPU buffers; large scenes stream through the staging ring instead of
+    // stalling here on buffers the queued steps still use
+    GLintptr offset = static_cast<GLintptr>(startIndex) * sizeof(Object);
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(objects.size()) * sizeof(Object);
+    if (!ObjectUpload::Upload(objects.data(), bytes, g_objectSSBO, 2, offset))
+    {
         for (int i = 0; i < 2; i++)
         {
             glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[i]);
-            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Object), &defaultObject);
-            err = glGetError();
-            if (err != GL_NO_ERROR) return false;
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, bytes, objects.data());
         }
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     }
+    g_objectGeneration++;
+    for (size_t i = 0; i < objects.size(); i++)
+        SetObjectEquationRef(startIndex + static_cast<int>(i), objects[i].equationID);
 
-    // Create VAOs for rendering
-    if (g_renderVAO[0] == 0)
+    // Update object count; objects past the old end are new and get handles
+    for (int i = g_numObjects; i < startIndex + static_cast<int>(objects.size()); i++)
+        ObjectHandles::Append(i);
+    if (startIndex + static_cast<int>(objects.size()) > g_numObjects)
+        g_numObjects = startIndex + static_cast<int>(objects.size());
+    g_initialStateCount = -1;
+}
+
+// ============================================================================
+// Append objects with one upload per buffer
+// ============================================================================
+int Objects::AddObjects(const std::vector<Object>& objects)
+{
+    FlushObjectWrites();
+    DiscardSpawnedObjects();  // Appended after the host objects
+    int first = g_numObjects;
+    if (objects.empty()) return first;
+
+    UploadBulkObjects(objects, first);
+    if (g_numObjects != first + static_cast<int>(objects.size())) return -1;
+
+    ResetAppendedObjects(first);
+    return first;
+}
+
+// ============================================================================
+// Append objects generated on the GPU from a template
+// ============================================================================
+int Objects::SpawnObjects(int count, const Object& templateObject, const SpawnSettings& settings, std::string& error)
+{
+    FlushObjectWrites();
+    DiscardSpawnedObjects();
+    int first = g_numObjects;
+    if (count <= 0) return first;
+    if (first + count > MAX_OBJECTS)
     {
-        glGenVertexArrays(2, g_renderVAO);
-        GLenum err = glGetError();
-        if (err != GL_NO_ERROR) return false;
+        error = "Maximum object limit reached";
+        return -1;
+    }
+    if (!ReserveObjects(first + count))
+    {
+        error = "Failed to allocate object buffers";
+        return -1;
+    }
 
-        SetupRenderVAOFromSSBO(g_renderVAO[0], g_objectSSBO[0]);
-        SetupRenderVAOFromSSBO(g_renderVAO[1], g_objectSSBO[1]);
+    UploadSimParams();  // k, b, g and the drive the expressions may read
+    ObjectSleep::WakeAll();
+    ContactSolver::ResetWarmStart();
+    if (!ObjectSpawn::Spawn(g_objectSSBO, 2, first, count, templateObject, settings, error)) return -1;
+    g_objectGeneration++;
+
+    for (int i = first; i < first + count; i++)
+    {
+        SetObjectEquationRef(i, templateObject.equationID);
+        ObjectHandles::Append(i);
     }
+    g_numObjects = first + count;
+    g_initialStateCount = -1;
+    ResetAppendedObjects(first);
+    return first;
+}
 
-    // Create additional SSBOs
-    if (g_allTokensSSBO == 0) glGenBuffers(1, &g_allTokensSSBO);
-    if (g_allConstantsSSBO == 0) glGenBuffers(1, &g_allConstantsSSBO);
-    if (g_mappingsSSBO == 0) glGenBuffers(1, &g_mappingsSSBO);
-    if (g_initialPosSSBO == 0) glGenBuffers(1, &g_initialPosSSBO);
-    if (g_constraintsSSBO == 0) glGenBuffers(1, &g_constraintsSSBO);
-    if (g_objectConstraintsSSBO == 0) glGenBuffers(1, &g_objectConstraintsSSBO);
+// ============================================================================
+// Rollback history
+// ============================================================================
+void Objects::SetHistoryCapacity(int capacity)
+{
+    ObjectHistory::SetCapacity(capacity);
+}
 
-    // Initialize collision properties buffer
-    if (g_collisionPropsSSBO == 0)
+void Objects::ClearHistory()
+{
+    ObjectHistory::Clear();
+}
+
+// Host objects only: spawned ones are discarded by the rewind
+bool Objects::PushHistory(int sourceIndex, double time)
+{
+    if (sourceIndex < 0 || sourceIndex > 1) return false;
+    FlushObjectWrites();
+    int hostObjects = ObjectLifecycle::IsActive() ? ObjectLifecycle::GetBase() : g_numObjects;
+    return ObjectHistory::Push(g_objectSSBO[sourceIndex], hostObjects, time);
+}
+
+int Objects::GetHistoryCount()
+{
+    return ObjectHistory::GetCount();
+}
+
+double Objects::GetHistoryTime(int back)
+{
+    return ObjectHistory::GetTime(back);
+}
+
+bool Objects::RewindHistory(int back)
+{
+    FlushObjectWrites();  // Older edits must not land on top of the restored objects
+    DiscardSpawnedObjects();
+    if (ObjectHistory::GetObjects(back) != g_numObjects) return false;
+
+    ObjectSleep::WakeAll();
+    ContactSolver::ResetWarmStart();  // Impulses of the state being replaced
+    if (!ObjectHistory::Restore(back, g_objectSSBO, 2)) return false;
+    g_objectGeneration++;
+    return true;
+}
+
+// ============================================================================
+// Get direct pointer to object data (read-only)
+// ============================================================================
+const Object* Objects::GetObjectDataDirect(int sourceIndex)
+{
+    if (sourceIndex < 0 || sourceIndex > 1) return nullptr;
+    g_stepsSinceRead = 0;
+    if (!InitReadbackRing()) return nullptr;
+
+    // Newest finished copy; never waits, so it may be a few steps behind
+    const ReadbackSlot* newest = nullptr;
+    for (ReadbackSlot& slot : g_readback)
     {
-        glGenBuffers(1, &g_collisionPropsSSBO);
+        if (!slot.fence || slot.sourceIndex != sourceIndex) continue;
+        if (newest && slot.generation < newest->generation) continue;
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) newest = &slot;
+    }
+    return newest ? newest->mapped : nullptr;
+}
 
-        // Initialize collision properties with defaults
-        for (auto& prop : g_collisionProperties)
+// ============================================================================
+// Get direct pointer to object data (mutable)
+// The simulation buffers stay in GPU memory; write through UpdateObjectCPU instead
+// ============================================================================
+Object* Objects::GetObjectDataDirectMutable(int sourceIndex)
+{
+    (void)sourceIndex;
+    return nullptr;
+}
+
+// ============================================================================
+// Remove an object from the system (out-of-range index = the last host object)
+// ============================================================================
+void Objects::RemoveObject(int index)
+{
+    bool spawned = ObjectLifecycle::IsActive() && index >= ObjectLifecycle::GetBase();
+    if (!spawned)
+    {
+        int hostObjects = ObjectLifecycle::IsActive() ? ObjectLifecycle::GetBase() : g_numObjects;
+        if (index < 0 || index >= hostObjects) index = hostObjects - 1;
+        if (index < 0)
         {
-            prop.enabled = 1;  // Collisions enabled by default
-            prop.shapeType = COLLISION_NONE;
-            prop.restitution = 0.7f;  // Default bounciness
-            prop.friction = 0.3f;     // Default friction
-            prop.mass_factor = 1.0f;
-            prop._pad1 = prop._pad2 = prop._pad3 = 0;
+            std::cerr << "[Objects::RemoveObject] No objects to remove!" << std::endl;
+            return;
         }
-
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_collisionPropsSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER,
-            MAX_OBJECTS * sizeof(CollisionProperties),
-            g_collisionProperties.data(),
-            GL_DYNAMIC_DRAW);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     }
+    RemoveObjects({ index });
+}
 
-    // Initialize contact buffer (will be created when needed)
-    // g_contactBufferSSBO is initialized lazily when warm starting is enabled
+// ============================================================================
+// Remove several objects in one pass. Each removal swaps the last object into
+// the hole, in descending index order so the object moved is never one still
+// to be removed; constraints are found through the reverse index, compacted
+// once and uploaded as the ranges that changed.
+// ============================================================================
+void Objects::RemoveObjects(const std::vector<int>& indices)
+{
+    FlushObjectWrites();  // Indices are about to move
+    SyncConstraintMirror();
+
+    // Spawned objects are compacted away on the GPU
+    bool lifecycle = ObjectLifecycle::IsActive();
+    int hostObjects = lifecycle ? ObjectLifecycle::GetBase() : g_numObjects;
+    std::vector<int> removals;
+    for (int index : indices)
+    {
+        if (lifecycle && index >= hostObjects) ObjectLifecycle::KillObject(index);
+        else if (index >= 0 && index < hostObjects) removals.push_back(index);
+    }
+    if (removals.empty()) return;
+    DiscardSpawnedObjects();
 
-    err = glGetError();
-    if (err != GL_NO_ERROR) return false;
+    std::sort(removals.begin(), removals.end(), std::greater<int>());
+    removals.erase(std::unique(removals.begin(), removals.end()), removals.end());
 
-    // Upload initial data to GPU
-    UploadPackedEquationsToGPU();
-    UploadConstraintsToGPU();
+    ObjectWorlds::Clear();  // The worlds' object ranges no longer hold
+    SpringNetwork::Clear();  // Its rows are indexed by the old objects
+    ObjectSleep::WakeAll();
+    ContactSolver::ResetWarmStart();  // Stored pairs refer to the old indices
 
-    // Upload equation mappings
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_mappingsSSBO);
-    glBufferData(GL_SHADER_STORAGE_BUFFER,
-        MAX_EQUATIONS * sizeof(EquationMapping),
-        g_equationMappings.data(),
-        GL_DYNAMIC_DRAW);
-    err = glGetError();
-    if (err != GL_NO_ERROR) return false;
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    // Original index of the object in each slot, for the pair exclusions
+    std::vector<int> originalIndex;
+    if (!g_collisionExclusions.empty())
+    {
+        originalIndex.resize(g_numObjects);
+        for (int i = 0; i < g_numObjects; i++) originalIndex[i] = i;
+    }
+    std::vector<int> newIndex(originalIndex.size(), -1);
 
-    // Load compute shader asynchronously
-    if (g_programCompute == 0)
+    int oldNumObjects = g_numObjects;
+    for (int removeIdx : removals)
     {
-        g_computeLoader.LoadComputeShaderAsync(
-            "math.comp",
-            [](GLuint program)
+        ReleaseObjectConstraints(removeIdx);
+        ObjectHandles::Release(removeIdx);
+        std::vector<int> owners = g_constraintReferrers[removeIdx];
+        for (int owner : owners) DropConstraintsTo(owner, removeIdx);
+        g_constraintReferrers[removeIdx].clear();
+
+        int lastObjectIdx = g_numObjects - 1;
+        if (removeIdx != lastObjectIdx)
+        {
+            for (int i = 0; i < 2; i++)
             {
-                g_programCompute = program;
-                g_computeShaderReady = true;
+                glBindBuffer(GL_COPY_READ_BUFFER, g_objectSSBO[i]);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, g_objectSSBO[i]);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                    lastObjectIdx * sizeof(Object), removeIdx * sizeof(Object), sizeof(Object));
+            }
 
-                // Set initial collision parameters when shader is loaded
-                if (g_programCompute)
-                {
-                    glUseProgram(g_programCompute);
+            MoveObjectConstraints(removeIdx, lastObjectIdx);
+            g_collisionProperties[removeIdx] = g_collisionProperties[lastObjectIdx];
+            SetObjectEquationRef(removeIdx, g_objectEquationIDs[lastObjectIdx]);
+            ObjectParams::Move(removeIdx, lastObjectIdx);
+            StaticColliders::Move(removeIdx, lastObjectIdx);
+            KinematicPaths::Move(removeIdx, lastObjectIdx);
+            ObjectAggregates::Move(removeIdx, lastObjectIdx);
+            StateRegisters::Move(removeIdx, lastObjectIdx);
+            ObjectSensitivity::Move(removeIdx, lastObjectIdx);
+            ObjectHandles::Move(removeIdx, lastObjectIdx);
+            if (!originalIndex.empty()) originalIndex[removeIdx] = originalIndex[lastObjectIdx];
+        }
+        else
+        {
+            ObjectParams::Clear(removeIdx);
+            StaticColliders::Clear(removeIdx);
+            KinematicPaths::Clear(removeIdx);
+            ObjectAggregates::Clear(removeIdx);
+            StateRegisters::Clear(removeIdx);
+            ObjectSensitivity::Clear(removeIdx);
+        }
 
-                    GLint enableWarmStartLoc = glGetUniformLocation(g_programCompute, "uEnableWarmStart");
-                    if (enableWarmStartLoc != -1)
-                        glUniform1i(enableWarmStartLoc, g_enableWarmStart ? 1 : 0);
+        g_collisionProperties[lastObjectIdx] = DefaultCollisionProperties();
+        SetObjectEquationRef(lastObjectIdx, -1);
+        g_numObjects--;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    g_objectGeneration++;
+    g_initialStateCount = -1;
+    if (g_numObjects == 0) ObjectHandles::Reset(0);  // A scene built from scratch numbers p[i] from 0 again
+
+    // Every slot from the lowest removal up to the old end may have changed
+    int firstChanged = removals.back();
+    g_collidableCountDirty = true;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_collisionPropsSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+        firstChanged * sizeof(CollisionProperties),
+        (oldNumObjects - firstChanged) * sizeof(CollisionProperties),
+        &g_collisionProperties[firstChanged]);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-                    GLint maxContactIterationsLoc = glGetUniformLocation(g_programCompute, "uMaxContactIterations");
-                    if (maxContactIterationsLoc != -1)
-                        glUniform1i(maxContactIterationsLoc, g_maxContactIterations);
+    if (!originalIndex.empty())
+    {
+        for (int i = 0; i < g_numObjects; i++) newIndex[originalIndex[i]] = i;
+        RemapCollisionExclusions(newIndex);
+    }
 
-                    glUseProgram(0);
-                }
-            },
-            [](const std::string& error)
-            {
-                std::cerr << "\n[Objects] Compute shader FAILED: " << error << std::endl;
-                g_computeShaderReady = false;
-            });
+    CompactConstraintsIfSparse();
+    UploadConstraintsToGPU();
+}
+
+// ============================================================================
+// Reset all objects to initial conditions
+// ============================================================================
+void Objects::ResetToInitialConditions()
+{
+    DiscardSpawnedObjects();
+    if (g_initialStateCount != g_numObjects)
+    {
+        // Not stepped since the last add or remove: the current state is the initial one
+        FlushObjectWrites();
+        CaptureInitialState(g_currentObjectBuffer);
+    }
+    else
+    {
+        DiscardObjectWrites();  // Edits of the state being replaced
     }
+    g_currentObjectBuffer = 0;
+    ObjectSleep::WakeAll();
+    ContactSolver::ResetWarmStart();  // Impulses of the state being replaced
+    ObjectTrails::Reset();
+    if (g_numObjects <= 0) return;
+
+    // The snapshot goes back into both buffers without leaving the GPU
+    glBindBuffer(GL_COPY_READ_BUFFER, g_initialStateSSBO);
+    for (int j = 0; j < 2; j++)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, g_objectSSBO[j]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, g_numObjects * sizeof(Object));
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    g_objectGeneration++;
+    StaticColliders::Invalidate();  // Static colliders moved since the capture go back
 
-    // Load quad rendering shader asynchronously
-    if (g_programQuad == 0)
+    // Equations assigned since the capture stay assigned
+    if (g_initialEquationsStale)
     {
-        g_quadLoader.LoadGraphicsShaderAsync(
-            "quad.vert",
-            "quad.frag",
-            "quad.geom",
-            [](GLuint program)
-            {
-                g_programQuad = program;
-                g_quadShaderReady = true;
-            },
-            [](const std::string& error)
-            {
-                std::cerr << "\n[Objects] Quad shader FAILED: " << error << std::endl;
-                g_quadShaderReady = false;
-            });
+        Object values{};
+        for (int i = 0; i < g_numObjects; i++)
+        {
+            values.equationID = g_objectEquationIDs[i];
+            QueueObjectWrite(i, OBJECT_WRITE_EQUATION, values);
+        }
     }
+}
+
+// ============================================================================
+// Update a single object's data from CPU
+// ============================================================================
+void Objects::UpdateObjectCPU(int index, const Object& newData)
+{
+    ObjectSleep::WakeAll();
+    if (index < 0 || index >= g_numObjects) return;
+    QueueObjectWrite(index, OBJECT_WRITE_WHOLE, newData);
+    SetObjectEquationRef(index, newData.equationID);
+}
+
+void Objects::UpdateObjectFields(int index, unsigned int fieldMask, const Object& values)
+{
+    fieldMask &= OBJECT_FIELD_ALL;
+    if (fieldMask == 0) return;
+    ObjectSleep::WakeAll();
+    if (index >= 0 && index < g_numObjects) QueueObjectWrite(index, fieldMask, values);
+}
+
+// ============================================================================
+// Apply the queued host writes: one upload and one scatter dispatch for all of them
+// ============================================================================
+void Objects::FlushObjectWrites()
+{
+    if (g_pendingWrites.empty()) return;
+
+    // Objects removed or compacted away since their write was queued
+    g_pendingWrites.erase(std::remove_if(g_pendingWrites.begin(), g_pendingWrites.end(),
+                                         [](const ObjectWrite& write)
+                                         {
+                                             if (static_cast<int>(write.index) < g_numObjects) return false;
+                                             g_pendingWriteSlot[write.index] = -1;
+                                             return true;
+                                         }),
+                          g_pendingWrites.end());
+
+    // A static collider that moved or changed size is binned again
+    const unsigned int staticFields = OBJECT_FIELD_POSITION | OBJECT_FIELD_SIZE | OBJECT_WRITE_WHOLE;
+    for (const ObjectWrite& write : g_pendingWrites)
+        if ((write.fieldMask & staticFields) && StaticColliders::IsStatic(static_cast<int>(write.index))) StaticColliders::Invalidate();
+
+    if (!ObjectScatter::Scatter(g_objectSSBO[g_currentObjectBuffer], g_objectSSBO[1 - g_currentObjectBuffer], g_pendingWrites))
+        UploadObjectWrites();
+    DiscardObjectWrites();
+    g_objectGeneration++;
+}
 
+// ============================================================================
+// Set default object type for new objects
+// ============================================================================
+void Objects::SetDefaultObjectType(int type)
+{
+    g_currentDefaultObjectType = type;
+}
+
+// ============================================================================
+// Set global system parameters
+// ============================================================================
+void Objects::SetSystemParameters(float gravity, float damping, float stiffness)
+{
+    SimParams params = g_simParams;
+    params.gravity = gravity;
+    params.damping = damping;
+    params.stiffness = stiffness;
+    SetSimParams(params);
+}
+
+// ============================================================================
+// Parameter block of the simulation passes (written to the GPU before the next step, if changed)
+// ============================================================================
+void Objects::SetSimParams(const SimParams& params)
+{
+    if (std::memcmp(&params, &g_simParams, sizeof(SimParams)) == 0) return;
+    g_simParams = params;
+    g_simParamsDirty = true;
+}
+
+SimParams Objects::GetSimParams()
+{
+    return g_simParams;
+}
+
+bool Objects::SetWorldBounds(BoundaryMode mode, const glm::vec2& worldMin, const glm::vec2& worldMax)
+{
+    if (!(worldMax.x > worldMin.x && worldMax.y > worldMin.y)) return false;
+    SimParams params = g_simParams;
+    params.boundaryMode = mode;
+    params.worldMin = worldMin;
+    params.worldMax = worldMax;
+    SetSimParams(params);
     return true;
 }
 
+void Objects::GetWorldBounds(BoundaryMode& mode, glm::vec2& worldMin, glm::vec2& worldMax)
+{
+    mode = static_cast<BoundaryMode>(g_simParams.boundaryMode);
+    worldMin = g_simParams.worldMin;
+    worldMax = g_simParams.worldMax;
+}
+
+void Objects::SetRandomSeed(uint32_t seed)
+{
+    g_randomSeed = seed;
+}
+
+uint32_t Objects::GetRandomSeed()
+{
+    return g_randomSeed;
+}
+
 // ============================================================================
-// Update object physics using compute shader
+// Get quad rendering shader program ID
 // ============================================================================
-void Objects::Update(int inputIndex, int outputIndex)
+GLuint Objects::GetQuadProgram()
 {
-    UpdateShaderLoadingStatus();
+    return ActiveQuadProgram();
+}
 
-    if (g_programCompute == 0 || !g_computeShaderReady) return;
+// ============================================================================
+// Get compute shader program ID
+// ============================================================================
+GLuint Objects::GetComputeProgram()
+{
+    return ActiveComputeProgram();
+}
 
-    // Clear OpenGL errors
-    GLenum err;
-    while ((err = glGetError()) != GL_NO_ERROR);
+// ============================================================================
+// Get current number of objects
+// ============================================================================
+int Objects::GetNumObjects()
+{
+    return g_numObjects;
+}
 
-    // Validate compute shader program
-    GLint isProgram = glIsProgram(g_programCompute);
-    if (!isProgram) return;
+int Objects::GetObjectCapacity()
+{
+    return g_objectCapacity;
+}
 
-    GLint linkStatus;
-    glGetProgramiv(g_programCompute, GL_LINK_STATUS, &linkStatus);
-    if (!linkStatus) return;
+GLuint Objects::GetObjectBuffer(int sourceIndex)
+{
+    return g_objectSSBO[sourceIndex];
+}
 
-    // Bind compute shader program
-    glUseProgram(g_programCompute);
-    err = glGetError();
-    if (err != GL_NO_ERROR) return;
-
-    // Set uniforms
-    GLint equationModeLoc = glGetUniformLocation(g_programCompute, "uEquationMode");
-    if (equationModeLoc != -1) glUniform1i(equationModeLoc, 0);
-
-    GLint numObjectsLoc = glGetUniformLocation(g_programCompute, "uNumObjects");
-    if (numObjectsLoc != -1) glUniform1i(numObjectsLoc, g_numObjects);
-
-    // NEW: Set collision system parameters
-    GLint enableWarmStartLoc = glGetUniformLocation(g_programCompute, "uEnableWarmStart");
-    if (enableWarmStartLoc != -1) glUniform1i(enableWarmStartLoc, g_enableWarmStart ? 1 : 0);
-
-    GLint maxContactIterationsLoc = glGetUniformLocation(g_programCompute, "uMaxContactIterations");
-    if (maxContactIterationsLoc != -1) glUniform1i(maxContactIterationsLoc, g_maxContactIterations);
-
-    // Bind SSBOs for compute shader
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, g_objectSSBO[inputIndex]);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, g_objectSSBO[outputIndex]);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, g_allTokensSSBO);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, g_allConstantsSSBO);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, g_mappingsSSBO);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, g_constraintsSSBO);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, g_objectConstraintsSSBO);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, g_collisionPropsSSBO);
+void Objects::MarkObjectsWritten()
+{
+    g_objectGeneration++;
+    StaticColliders::Invalidate();
+}
 
-    // NEW: Bind contact buffer if warm starting is enabled
-    if (g_enableWarmStart)
-    {
-        if (g_contactBufferSSBO == 0)
-        {
-            InitializeContactBuffer();
-        }
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, g_contactBufferSSBO);
-    }
+// ============================================================================
+// Memory report
+// ============================================================================
+static size_t BufferBytes(GLuint buffer)
+{
+    if (buffer == 0) return 0;
+    GLint64 size = 0;
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    return static_cast<size_t>(size);
+}
 
-    // Dispatch compute shader
-    int workGroupSize = 64;
-    int numWorkGroups = (g_numObjects + workGroupSize - 1) / workGroupSize;
-    if (numWorkGroups < 1) numWorkGroups = 1;
-    if (numWorkGroups > 16) numWorkGroups = 16;
+// Live objects' share of a buffer sized by object capacity
+static size_t PerObjectUsed(size_t capacityBytes)
+{
+    if (g_objectCapacity <= 0) return 0;
+    return capacityBytes / static_cast<size_t>(g_objectCapacity) * static_cast<size_t>(g_numObjects);
+}
 
-    glDispatchCompute(numWorkGroups, 1, 1);
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+template <typename T>
+static Objects::MemoryEntry HostEntry(const char* name, const std::vector<T>& values)
+{
+    return { name, false, values.capacity() * sizeof(T), values.size() * sizeof(T) };
+}
 
-    // Clean up bindings
-    glUseProgram(0);
-    for (int i = 0; i < 8; i++) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, 0);
+void Objects::GetMemoryReport(std::vector<MemoryEntry>& entries)
+{
+    entries.clear();
+    auto gpu = [&entries](const char* name, GLuint buffer, bool perObject) {
+        size_t capacity = BufferBytes(buffer);
+        entries.push_back({ name, true, capacity, perObject ? PerObjectUsed(capacity) : capacity });
+    };
+    auto gpuUsed = [&entries](const char* name, GLuint buffer, size_t used) {
+        size_t capacity = BufferBytes(buffer);
+        entries.push_back({ name, true, capacity, std::min(used, capacity) });
+    };
+
+    gpu("objects[0]", g_objectSSBO[0], true);
+    gpu("objects[1]", g_objectSSBO[1], true);
+    gpu("object_scratch", g_objectScratchSSBO, true);
+    gpu("integrator_stage[0]", g_integratorStageSSBO[0], true);
+    gpu("integrator_stage[1]", g_integratorStageSSBO[1], true);
+    gpu("integrator_scratch", g_integratorScratchSSBO, true);
+    gpu("initial_state", g_initialStateSSBO, true);
+    gpu("collision_properties", g_collisionPropsSSBO, true);
+    gpu("contacts", g_contactBufferSSBO, true);
+    gpu("object_constraints", g_objectConstraintsSSBO, true);
+    gpu("pair_sums", g_pairSumsSSBO, true);
+    gpu("prelude_values", g_preludeValuesSSBO, true);
+    gpuUsed("tokens", g_allTokensSSBO, TokenBufferWords(g_tokenSpace.end) * sizeof(uint32_t));
+    gpuUsed("constants", g_allConstantsSSBO, g_allConstants.size() * sizeof(float));
+    gpuUsed("bytecode", g_allBytecodeSSBO, g_allBytecode.size() * sizeof(unsigned int));
+    gpuUsed("equation_mappings", g_mappingsSSBO, g_equationMappings.size() * sizeof(EquationMapping));
+    gpuUsed("equation_groups", g_groupEquationsSSBO, g_groupEquations.size() * sizeof(int));
+    gpuUsed("constraints", g_constraintsSSBO, g_allConstraints.size() * sizeof(Constraint));
+    gpu("collision_exclusions", g_collisionExclusionsSSBO, false);
+    gpu("polygon_table", g_polygonTableSSBO, false);
+    gpu("pair_sum_expressions", g_pairSumExpressionsSSBO, false);
+    gpu("prelude_expressions", g_preludeExpressionsSSBO, false);
+    gpu("sim_params", g_simParamsUBO, false);
+    gpu("equation_constants_block", g_constantsUBO, false);
+
+    size_t readbackBytes = 0, displayBytes = 0, asyncBytes = 0;
+    for (const ReadbackSlot& slot : g_readback) readbackBytes += BufferBytes(slot.buffer);
+    for (const DisplaySlot& slot : g_display) displayBytes += BufferBytes(slot.buffer);
+    for (const auto& entry : g_asyncReadbacks) asyncBytes += BufferBytes(entry.second.buffer);
+    size_t asyncUsed = asyncBytes;
+    for (const AsyncReadback& readback : g_freeAsyncReadbacks) asyncBytes += BufferBytes(readback.buffer);
+    entries.push_back({ "readback_copies", true, readbackBytes, readbackBytes });
+    entries.push_back({ "display_copies", true, displayBytes, displayBytes });
+    entries.push_back({ "async_readbacks", true, asyncBytes, asyncUsed });
+
+    entries.push_back(HostEntry("host.collision_properties", g_collisionProperties));
+    entries.push_back(HostEntry("host.tokens", g_allTokens));
+    entries.push_back(HostEntry("host.constants", g_allConstants));
+    entries.push_back(HostEntry("host.bytecode", g_allBytecode));
+    entries.push_back(HostEntry("host.equation_mappings", g_equationMappings));
+    entries.push_back(HostEntry("host.object_equation_ids", g_objectEquationIDs));
+    entries.push_back(HostEntry("host.constraints", g_allConstraints));
+    entries.push_back(HostEntry("host.object_constraints", g_objectConstraintMappings));
+    entries.push_back(HostEntry("host.pending_writes", g_pendingWrites));
+    entries.push_back(HostEntry("host.pending_write_slots", g_pendingWriteSlot));
+    entries.push_back(HostEntry("host.pair_sum_expressions", g_pairSumExpressions));
+    entries.push_back(HostEntry("host.prelude_expressions", g_preludeExpressions));
 }
 
 // ============================================================================
-// Add or retrieve equation ID for a given equation string
+// Grow every per-object buffer to hold at least count objects
+// Capacity doubles; existing contents move with glCopyBufferSubData
 // ============================================================================
-int Objects::AddOrGetEquation(const std::string& equationString, const ParsedEquation& eq)
+bool Objects::ReserveObjects(int count)
 {
-    // Return existing ID if equation already registered
-    auto it = g_equationStringToID.find(equationString);
-    if (it != g_equationStringToID.end()) return it->second;
-
-    // Serialize equation for GPU
-    ParserContext context;
-    GPUSerializedEquation gpu_eq = serializeEquationForGPU(eq);
+    if (count <= g_objectCapacity) return true;
+    if (count > MAX_OBJECTS || g_objectSSBO[0] == 0) return false;
+
+    int capacity = std::max(g_objectCapacity, INITIAL_OBJECT_CAPACITY);
+    while (capacity < count) capacity = std::min(capacity * 2, MAX_OBJECTS);
+    int oldCapacity = g_objectCapacity;
+
+    while (glGetError() != GL_NO_ERROR);
+    for (int i = 0; i < 2; i++)
+        BufferHelpers::EnsureBufferCapacity(g_objectSSBO[i], static_cast<GLsizeiptr>(capacity) * sizeof(Object));
+    SetupRenderVAOFromSSBO(g_renderVAO[0], g_objectSSBO[0]);
+    SetupRenderVAOFromSSBO(g_renderVAO[1], g_objectSSBO[1]);
+
+    // Step scratch holds nothing between steps; it is recreated at the new size on first use
+    SafeDeleteBuffers(&g_objectScratchSSBO, 1);
+    SafeDeleteBuffers(g_integratorStageSSBO, 2);
+    SafeDeleteBuffers(&g_integratorScratchSSBO, 1);
+
+    g_collisionProperties.resize(capacity, DefaultCollisionProperties());
+    BufferHelpers::EnsureBufferCapacity(g_collisionPropsSSBO,
+        static_cast<GLsizeiptr>(capacity) * sizeof(CollisionProperties), GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, oldCapacity * sizeof(CollisionProperties),
+        (capacity - oldCapacity) * sizeof(CollisionProperties), g_collisionProperties.data() + oldCapacity);
+    if (g_pairSumsSSBO)
+        BufferHelpers::EnsureBufferCapacity(g_pairSumsSSBO,
+            static_cast<GLsizeiptr>(capacity) * MAX_PAIR_SUMS_PER_EQUATION * sizeof(float));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-    // Find available equation slot
-    int newID = -1;
-    for (int i = 0; i < MAX_EQUATIONS; i++)
-    {
-        if (g_equationMappings[i].tokenCount_ax == 0 &&
-            g_equationMappings[i].tokenCount_ay == 0 &&
-            g_equationMappings[i].tokenCount_angular == 0)
-        {
-            newID = i;
-            break;
-        }
-    }
+    g_objectConstraintMappings.resize(capacity);
+    g_constraintReferrers.resize(capacity);
+    MarkConstraintMappingsDirty(oldCapacity, capacity);
+    g_pendingWriteSlot.resize(capacity, -1);
+    g_objectEquationIDs.resize(capacity, -1);
+    g_objectCapacity = capacity;
+    UploadConstraintsToGPU();
+    if (g_contactBufferSSBO) InitializeContactBuffer();
+
+    // Persistent copies are sized to the capacity; the ring is rebuilt on the next whole read
+    int stepsSinceRead = g_stepsSinceRead;
+    ReleaseReadbackRing();
+    g_stepsSinceRead = stepsSinceRead;
+
+    bool modulesGrown = Broadphase::Reserve(capacity) && DispatchOrder::Reserve(capacity) &&
+                        LongRange::Reserve(capacity) && ObjectStreams::Reserve(capacity) &&
+                        ObjectSleep::Reserve(capacity) && ContactSolver::Reserve(capacity) &&
+                        ObjectLifecycle::Reserve(capacity) && ObjectReduction::Reserve(capacity) &&
+                        ObjectGather::Reserve(capacity) && ObjectScatter::Reserve(capacity) &&
+                        ObjectParams::Reserve(capacity) && StateRegisters::Reserve(capacity) && ObjectHandles::Reserve(capacity) &&
+                        ObjectSensitivity::Reserve(capacity) && ObjectBounds::Reserve(capacity) && ObjectReorder::Reserve(capacity) &&
+                        StaticColliders::Reserve(capacity) && KinematicPaths::Reserve(capacity) &&
+                        ObjectAggregates::Reserve(capacity) && ObjectPipeline::Reserve(capacity) &&
+                        ObjectCulling::Reserve(capacity);
 
-    if (newID == -1)
+    GLenum err = glGetError();
+    if (!modulesGrown || err != GL_NO_ERROR)
     {
-        std::cerr << "[Objects] ERROR: Max equations reached!" << std::endl;
-        return 0;
+        std::cerr << "[Objects] Failed to grow object buffers to " << capacity << " (GL error " << err << ")" << std::endl;
+        return false;
     }
+    return true;
+}
 
-    // Calculate offsets for equation components
-    int currentTokenOffset = static_cast<int>(g_allTokens.size());
-    int currentConstantOffset = static_cast<int>(g_allConstants.size());
-
-    EquationMapping mapping;
-    mapping.tokenOffset_ax = currentTokenOffset;
-    mapping.tokenCount_ax = static_cast<int>(gpu_eq.tokenBuffer_ax.size());
-    mapping.constantOffset_ax = currentConstantOffset;
-    mapping._pad1 = 0;
-
-    mapping.tokenOffset_ay = currentTokenOffset + mapping.tokenCount_ax;
-    mapping.tokenCount_ay = static_cast<int>(gpu_eq.tokenBuffer_ay.size());
-    mapping.constantOffset_ay = currentConstantOffset + static_cast<int>(gpu_eq.constantBuffer_ax.size());
-    mapping._pad2 = 0;
-
-    mapping.tokenOffset_angular = mapping.tokenOffset_ay + mapping.tokenCount_ay;
-    mapping.tokenCount_angular = static_cast<int>(gpu_eq.tokenBuffer_angular.size());
-    mapping.constantOffset_angular = mapping.constantOffset_ay + static_cast<int>(gpu_eq.constantBuffer_ay.size());
-    mapping._pad3 = 0;
-
-    mapping.tokenOffset_r = mapping.tokenOffset_angular + mapping.tokenCount_angular;
-    mapping.tokenCount_r = static_cast<int>(gpu_eq.tokenBuffer_r.size());
-    mapping.constantOffset_r = mapping.constantOffset_angular + static_cast<int>(gpu_eq.constantBuffer_angular.size());
-    mapping._pad4 = 0;
-
-    mapping.tokenOffset_g = mapping.tokenOffset_r + mapping.tokenCount_r;
-    mapping.tokenCount_g = static_cast<int>(gpu_eq.tokenBuffer_g.size());
-    mapping.constantOffset_g = mapping.constantOffset_r + static_cast<int>(gpu_eq.constantBuffer_r.size());
-    mapping._pad5 = 0;
+// ============================================================================
+// Clean up all resources
+// ============================================================================
+void Objects::Cleanup()
+{
+    ReleaseReadbackRing();
+    ReleaseDisplaySlots();
+    ReleaseAsyncReadbacks();
 
-    mapping.tokenOffset_b = mapping.tokenOffset_g + mapping.tokenCount_g;
-    mapping.tokenCount_b = static_cast<int>(gpu_eq.tokenBuffer_b.size());
-    mapping.constantOffset_b = mapping.constantOffset_g + static_cast<int>(gpu_eq.constantBuffer_g.size());
-    mapping._pad6 = 0;
+    // Delete shader programs
+    glDeleteProgram(g_programCompute);
+    glDeleteProgram(g_programQuad);
+    glDeleteProgram(g_programQuadInstanced);
+    g_programCompute = 0;
+    g_programQuad = 0;
+    g_programQuadInstanced = 0;
+    g_computeUniformProgram = 0;
+    ReleaseSimulationPass(g_constraintPass);
+    ReleaseSimulationPass(g_collisionPass);
+    for (SimulationPass& pass : g_collisionShapePasses) ReleaseSimulationPass(pass);
+    for (SimulationPass& pass : g_sizedConstraintPasses) ReleaseSimulationPass(pass);
+    for (auto& bucket : g_sizedCollisionPasses)
+        for (SimulationPass& pass : bucket) ReleaseSimulationPass(pass);
+    g_compiledLocalSize = DEFAULT_LOCAL_SIZE;
+    SafeDeleteBuffers(&g_shapeOrderSSBO, 1);
+    g_shapeOrder.clear();
+    g_shapeBucketObjects = -1;
+    g_shapeOrderUploaded = false;
+    ReleaseCompiledEquations();
+    ReleaseComputeVariants();
+    g_equationCompileMode = false;
 
-    mapping.tokenOffset_a = mapping.tokenOffset_b + mapping.tokenCount_b;
-    mapping.tokenCount_a = static_cast<int>(gpu_eq.tokenBuffer_a.size());
-    mapping.constantOffset_a = mapping.constantOffset_b + static_cast<int>(gpu_eq.constantBuffer_b.size());
-    mapping._pad7 = 0;
+    g_computeShaderReady = false;
+    g_quadShaderReady = false;
+    g_quadInstancedReady = false;
 
-    // Store mapping
-    g_equationMappings[newID] = mapping;
-    g_equationStringToID[equationString] = newID;
+    // Delete all buffers and VAOs
+    SafeDeleteBuffers(g_objectSSBO, 2);
+    SafeDeleteBuffers(&g_objectScratchSSBO, 1);
+    SafeDeleteBuffers(g_integratorStageSSBO, 2);
+    SafeDeleteBuffers(&g_integratorScratchSSBO, 1);
+    SafeDeleteVertexArrays(g_renderVAO, 2);
+    SafeDeleteVertexArrays(&g_quadInstancedVAO, 1);
 
-    // Append tokens and constants
-    g_allTokens.insert(g_allTokens.end(), gpu_eq.tokenBuffer_ax.begin(), gpu_eq.tokenBuffer_ax.end());
-    g_allTokens.insert(g_allTokens.end(), gpu_eq.tokenBuffer_ay.begin(), gpu_eq.tokenBuffer_ay.end());
-    g_allTokens.insert(g_allTokens.end(), gpu_eq.tokenBuffer_angular.begin(), gpu_eq.tokenBuffer_angular.end());
-    g_allTokens.insert(g_allTokens.end(), gpu_eq.tokenBuffer_r.begin(), gpu_eq.tokenBuffer_r.end());
-    g_allTokens.insert(g_allTokens.end(), gpu_eq.tokenBuffer_g.begin(), gpu_eq.tokenBuffer_g.end());
-    g_allTokens.insert(g_allTokens.end(), gpu_eq.tokenBuffer_b.begin(), gpu_eq.tokenBuffer_b.end());
-    g_allTokens.insert(g_allTokens.end(), gpu_eq.tokenBuffer_a.begin(), gpu_eq.tokenBuffer_a.end());
-
-    g_allConstants.insert(g_allConstants.end(), gpu_eq.constantBuffer_ax.begin(), gpu_eq.constantBuffer_ax.end());
-    g_allConstants.insert(g_allConstants.end(), gpu_eq.constantBuffer_ay.begin(), gpu_eq.constantBuffer_ay.end());
-    g_allConstants.insert(g_allConstants.end(), gpu_eq.constantBuffer_angular.begin(), gpu_eq.constantBuffer_angular.end());
-    g_allConstants.insert(g_allConstants.end(), gpu_eq.constantBuffer_r.begin(), gpu_eq.constantBuffer_r.end());
-    g_allConstants.insert(g_allConstants.end(), gpu_eq.constantBuffer_g.begin(), gpu_eq.constantBuffer_g.end());
-    g_allConstants.insert(g_allConstants.end(), gpu_eq.constantBuffer_b.begin(), gpu_eq.constantBuffer_b.end());
-    g_allConstants.insert(g_allConstants.end(), gpu_eq.constantBuffer_a.begin(), gpu_eq.constantBuffer_a.end());
-
-    // Update GPU data
-    UploadPackedEquationsToGPU();
+    SafeDeleteBuffers(&g_allTokensSSBO, 1);
+    SafeDeleteBuffers(&g_allConstantsSSBO, 1);
+    SafeDeleteBuffers(&g_constantsUBO, 1);
+    g_constantBlockDirty = true;
+    g_constantsInBlock = false;
+    SafeDeleteBuffers(&g_allBytecodeSSBO, 1);
+    SafeDeleteBuffers(&g_mappingsSSBO, 1);
+    SafeDeleteBuffers(&g_groupEquationsSSBO, 1);
+    SafeDeleteBuffers(&g_initialStateSSBO, 1);
+    SafeDeleteBuffers(&g_constraintsSSBO, 1);
+    SafeDeleteBuffers(&g_objectConstraintsSSBO, 1);
+    SafeDeleteBuffers(&g_constraintBreaksSSBO, 1);
+    SafeDeleteBuffers(&g_collisionPropsSSBO, 1);
+    SafeDeleteBuffers(&g_collisionExclusionsSSBO, 1);
+    SafeDeleteBuffers(&g_polygonTableSSBO, 1);
+    SafeDeleteBuffers(&g_contactBufferSSBO, 1);  // NEW: Delete contact buffer
+    SafeDeleteBuffers(&g_pairSumExpressionsSSBO, 1);
+    SafeDeleteBuffers(&g_pairSumsSSBO, 1);
+    SafeDeleteBuffers(&g_preludeExpressionsSSBO, 1);
+    SafeDeleteBuffers(&g_preludeValuesSSBO, 1);
+    SafeDeleteBuffers(&g_simParamsUBO, 1);
+    Broadphase::Cleanup();
+    DispatchOrder::Cleanup();
+    LongRange::Cleanup();
+    SphFluid::Cleanup();
+    AdaptiveTimestep::Cleanup();
+    ObjectStreams::Cleanup();
+    ObjectSleep::Cleanup();
+    XpbdConstraints::Cleanup();
+    SpringNetwork::Cleanup();
+    ContactSolver::Cleanup();
+    ObjectLifecycle::Cleanup();
+    ObjectReduction::Cleanup();
+    ExpressionEval::Cleanup();
+    ObjectGather::Cleanup();
+    ObjectReorder::Cleanup();
+    WorkgroupTuner::Cleanup();
+    GpuPrimitives::Cleanup();
+    ObjectUpload::Cleanup();
+    ObjectRecorder::Cleanup();
+    ObjectCheckpoint::Cleanup();
+    SceneCache::Cleanup();
+    ObjectHistory::Cleanup();
+    ObjectFork::Cleanup();
+    ObjectSpawn::Cleanup();
+    NanScan::Cleanup();
+    ObjectCulling::Cleanup();
+    ObjectTrails::Cleanup();
+    ConstraintLines::Cleanup();
+    PhaseSpace::Cleanup();
+    ForceField::Cleanup();
+    SdfColliders::Cleanup();
+    GridFields::Cleanup();
+    ObjectPick::Cleanup();
+    ObjectQuery::Cleanup();
+    ObjectRaycast::Cleanup();
+    PerfCounters::Cleanup();
+    Metropolis::Cleanup();
+    ContactEvents::Cleanup();
+    DensitySplat::Cleanup();
+    ObjectScatter::Cleanup();
+    ObjectParams::Cleanup();
+    StaticColliders::Cleanup();
+    KinematicPaths::Cleanup();
+    WorldTiles::Cleanup();
+    ObjectAggregates::Cleanup();
+    ObjectPipeline::Cleanup();
+    StateRegisters::Cleanup();
+    ObjectSensitivity::Cleanup();
+    ObjectBounds::Cleanup();
+    LookupTables::Cleanup();
+    ObjectHandles::Cleanup();
+    ObjectWorlds::Cleanup();
+    DiscardObjectWrites();
+    g_currentObjectBuffer = 0;
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_mappingsSSBO);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
-        MAX_EQUATIONS * sizeof(EquationMapping),
-        g_equationMappings.data());
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    // Clear all data structures
+    g_numObjects = 0;
+    g_objectCapacity = 0;
+    g_initialStateCount = -1;
+    g_initialEquationsStale = false;
+    g_allTokens.clear();
+    g_allConstants.clear();
+    g_allBytecode.clear();
+    g_registerBytecodeEnabled = true;
+    g_fastMath = false;
+    g_nanScanInterval = 60;
+    g_nanRollback = false;
+    g_stepsSinceNanScan = 0;
+    g_nanGuardedSteps = 0;
+    g_nanRollbackCount = 0;
+    g_lastInvalidCount = 0;
+    g_lastInvalidIndices.clear();
+    g_integrator = INTEGRATOR_SYMPLECTIC_EULER;
+    g_stepIndex = 0;
+    g_frameStepsLeft = 0;
+    g_adaptiveTimestep = false;
+    g_equationMappings.clear();
+    g_equationStringToID.clear();
+    g_equationProgramToID.clear();
+    g_tokenSpace = EquationSpace{};
+    g_tokenPacking.clear();
+    g_tokenWideCapacity = 0;
+    g_tokenWideUploaded = 0;
+    g_tokensUnpacked = false;
+    g_constantSpace = EquationSpace{};
+    g_bytecodeSpace = EquationSpace{};
+    g_equationAllocations.assign(MAX_EQUATIONS, EquationAllocation{});
+    g_equationKeys.assign(MAX_EQUATIONS, std::string());
+    g_equationRefCounts.assign(MAX_EQUATIONS, 0);
+    g_objectEquationIDs.clear();
+    g_groupEquations.assign(MAX_EQUATION_GROUPS, -1);
+    g_equationRevision = 0;
+    g_invalidatedEquationRevision = 0;
+    g_equationsReadOtherObjects = false;
+    g_equationsShareObjectRefs = false;
+    g_structOfArraysStorage = false;
+    g_sleepEnabled = false;
+    g_sleepConfig = 0;
+    g_xpbdConstraints = false;
+    g_xpbdGraphDirty = true;
+    g_xpbdGraphObjects = -1;
+    g_pairSumExpressions.assign(MAX_EQUATIONS * MAX_PAIR_SUMS_PER_EQUATION, PairSumExpression{});
+    g_pairSumExpressionsDirty = true;
+    g_preludeExpressions.assign(MAX_EQUATIONS * MAX_PRELUDE_SLOTS, PreludeExpression{});
+    g_preludeExpressionsDirty = false;
+    g_preludeCount = 0;
+    g_equationsUsePairSums = false;
+    g_equationsUseAllPairs = false;
+    g_maxNeighbourRadius = 0.0f;
+    g_equationsUseLongRange = false;
+    g_equationsUseFluid = false;
+    g_equationsUseRandom = false;
+    g_equationsUseState = false;
+    g_allConstraints.clear();
+    g_objectConstraintMappings.clear();
+    g_constraintReferrers.clear();
+    g_liveConstraintCount = 0;
+    g_constraintsGpuCapacity = 0;
+    g_breakableConstraints = 0;
+    g_constraintMirrorStale = false;
+    g_constraintRowsTouched = 0;
+    MarkAllConstraintsDirty();
+    g_collisionProperties.clear();
+    g_collisionExclusions.clear();
+    g_collisionExclusionsDirty = true;
 
-    return newID;
+    // Reset collision and simulation parameters
+    g_enableWarmStart = false;
+    g_maxContactIterations = 3;
+    g_simParams = SimParams{};
+    g_simParamsDirty = true;
+    g_useAnalyticalCollision = true;
+    g_broadphaseMode = BROADPHASE_UNIFORM_GRID;
+    g_neighbourSkin = 0.0f;
+    g_smallWorldObjects = 64;
+    g_broadphaseStale = true;
+    g_shapeBuckets = true;
+    g_dispatchReorderInterval = 0;
+    g_stepsSinceReorder = 0;
+    g_dispatchOrderObjects = -1;
+    g_storageReorderInterval = 0;
+    g_stepsSinceStorageReorder = 0;
 }
 
 // ============================================================================
-// Set equation for an object
+// Update shader loading status
 // ============================================================================
-void Objects::SetEquation(const std::string& equationString, const ParsedEquation& eq, int objectIndex)
+void Objects::UpdateShaderLoadingStatus()
 {
-    int eqID = AddOrGetEquation(equationString, eq);
-
-    if (objectIndex >= 0 && objectIndex < g_numObjects)
-    {
-        if (g_useMapBuffer && g_mappedSSBO[0])
-        {
-            // Update via mapped memory
-            g_mappedSSBO[0][objectIndex].equationID = eqID;
-            g_mappedSSBO[1][objectIndex].equationID = eqID;
-        }
-        else
-        {
-            // Update via buffer subdata
-            for (int i = 0; i < 2; i++)
-            {
-                glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[i]);
-                glBufferSubData(GL_SHADER_STORAGE_BUFFER,
-                    objectIndex * sizeof(Object) + offsetof(Object, equationID),
-                    sizeof(int), &eqID);
-            }
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-        }
-    }
+    FRAME_TRACE_ZONE("Objects::UpdateShaderLoadingStatus");
+    g_computeLoader.Update();
+    g_compiledEquationsLoader.Update();
+    g_computeVariantLoader.Update();
+    g_constraintPass.loader.Update();
+    g_collisionPass.loader.Update();
+    for (SimulationPass& pass : g_collisionShapePasses) pass.loader.Update();
+    for (SimulationPass& pass : g_sizedConstraintPasses) pass.loader.Update();
+    for (auto& bucket : g_sizedCollisionPasses)
+        for (SimulationPass& pass : bucket) pass.loader.Update();
+    g_quadLoader.Update();
+    g_quadInstancedLoader.Update();
+    Broadphase::UpdateShaderLoadingStatus();
+    DispatchOrder::UpdateShaderLoadingStatus();
+    LongRange::UpdateShaderLoadingStatus();
+    SphFluid::UpdateShaderLoadingStatus();
+    AdaptiveTimestep::UpdateShaderLoadingStatus();
+    ObjectStreams::UpdateShaderLoadingStatus();
+    ObjectSleep::UpdateShaderLoadingStatus();
+    XpbdConstraints::UpdateShaderLoadingStatus();
+    SpringNetwork::UpdateShaderLoadingStatus();
+    ContactSolver::UpdateShaderLoadingStatus();
+    ObjectLifecycle::UpdateShaderLoadingStatus();
+    ObjectGather::UpdateShaderLoadingStatus();
+    ObjectReorder::UpdateShaderLoadingStatus();
+    GpuPrimitives::UpdateShaderLoadingStatus();
+    ObjectCheckpoint::UpdateShaderLoadingStatus();
+    ObjectFork::UpdateShaderLoadingStatus();
+    NanScan::UpdateShaderLoadingStatus();
+    ObjectCulling::UpdateShaderLoadingStatus();
+    ObjectTrails::UpdateShaderLoadingStatus();
+    ConstraintLines::UpdateShaderLoadingStatus();
+    PhaseSpace::UpdateShaderLoadingStatus();
+    ForceField::UpdateShaderLoadingStatus();
+    GridFields::UpdateShaderLoadingStatus();
+    ObjectPick::UpdateShaderLoadingStatus();
+    ObjectQuery::UpdateShaderLoadingStatus();
+    ObjectRaycast::UpdateShaderLoadingStatus();
+    DensitySplat::UpdateShaderLoadingStatus();
+    ObjectScatter::UpdateShaderLoadingStatus();
 }
 
 // ============================================================================
-// Upload CPU data to GPU (compatibility function)
+// Check if compute shader is ready
 // ============================================================================
-void Objects::UploadCpuDataToGpu()
+bool Objects::IsComputeShaderReady()
 {
-    // NO-OP for compatibility
+    return g_computeShaderReady && g_constraintPass.ready && g_collisionPass.ready;
 }
 
 // ============================================================================
-// Fetch object data from GPU to CPU
+// Check if quad shader is ready
 // ============================================================================
-void Objects::FetchToCPU(int sourceIndex, std::vector<Object>& out)
+bool Objects::IsQuadShaderReady()
 {
-    out.resize(g_numObjects);
-    if (g_useMapBuffer && g_mappedSSBO[sourceIndex])
-        std::memcpy(out.data(), g_mappedSSBO[sourceIndex], g_numObjects * sizeof(Object));
-    else
-    {
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[sourceIndex]);
-        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
-            g_numObjects * sizeof(Object),
-            out.data());
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-    }
+    return ActiveQuadProgram() != 0;
 }
 
 // ============================================================================
-// Draw all objects
+// Check if all shaders are ready
 // ============================================================================
-void Objects::Draw(int sourceIndex)
+bool Objects::AreAllShadersReady()
 {
-    if (!g_programQuad) return;
+    return IsComputeShaderReady() && g_quadShaderReady;
+}
 
-    glUseProgram(g_programQuad);
-    glBindVertexArray(g_renderVAO[sourceIndex]);
-    glDrawArrays(GL_POINTS, 0, g_numObjects);
-    glBindVertexArray(0);
-    glUseProgram(0);
+// ============================================================================
+// Get overall shader loading progress
+// ============================================================================
+float Objects::GetShaderLoadProgress()
+{
+    float computeProgress = g_computeShaderReady ? 1.0f : g_computeLoader.GetProgress();
+    float constraintProgress = g_constraintPass.ready ? 1.0f : g_constraintPass.loader.GetProgress();
+    float collisionProgress = g_collisionPass.ready ? 1.0f : g_collisionPass.loader.GetProgress();
+    float quadProgress = g_quadShaderReady ? 1.0f : g_quadLoader.GetProgress();
+    return (computeProgress + constraintProgress + collisionProgress + quadProgress) / 4.0f;
 }
 
 // ============================================================================
-// Add a new object with default properties
+// Get shader loading status message
 // ============================================================================
-void Objects::AddObject()
+std::string Objects::GetShaderLoadStatusMessage()
 {
-    if (g_numObjects >= MAX_OBJECTS)
-    {
-        std::cerr << "[Objects::AddObject] Max objects reached!" << std::endl;
-        return;
-    }
+    if (!g_computeShaderReady) return "[1/4] " + g_computeLoader.GetStatusMessage();
+    else if (!g_constraintPass.ready) return "[2/4] " + g_constraintPass.loader.GetStatusMessage();
+    else if (!g_collisionPass.ready) return "[3/4] " + g_collisionPass.loader.GetStatusMessage();
+    else if (!g_quadShaderReady) return "[4/4] " + g_quadLoader.GetStatusMessage();
+    else return "All shaders ready!";
+}
 
-    // Create default object
-    Object newObject = CreateDefaultObjectInternal(
-        g_currentDefaultObjectType,
-        g_numObjects,
-        0);
+// ============================================================================
+// PER-OBJECT EQUATION PARAMETERS
+// ============================================================================
 
-    // Store object data
-    if (g_useMapBuffer && g_mappedSSBO[0])
-    {
-        g_mappedSSBO[0][g_numObjects] = newObject;
-        g_mappedSSBO[1][g_numObjects] = newObject;
-    }
-    else
-    {
-        for (int i = 0; i < 2; i++)
-        {
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[i]);
-            glBufferSubData(GL_SHADER_STORAGE_BUFFER,
-                g_numObjects * sizeof(Object),
-                sizeof(Object),
-                &newObject);
-        }
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-    }
+void Objects::SetObjectParameters(int objectIndex, const float* values, int count, int first)
+{
+    if (objectIndex < 0 || objectIndex >= g_numObjects) return;
+    ObjectParams::Set(objectIndex, first, values, count);
+    g_sceneRevision++;
+    ObjectSleep::WakeAll();  // A resting object may not rest under its new parameters
+}
 
-    // Initialize empty constraint mapping
-    g_objectConstraintMappings[g_numObjects] = ObjectConstraints();
-    g_numObjects++;
+void Objects::GetObjectParameters(int objectIndex, float* out)
+{
+    ObjectParams::Get(objectIndex, out);
 }
 
 // ============================================================================
-// Upload multiple objects at once
+// STATIC COLLIDERS
 // ============================================================================
-void Objects::UploadBulkObjects(const std::vector<Object>& objects, int startIndex)
+
+void Objects::SetObjectStatic(int objectIndex, bool isStatic)
 {
-    if (startIndex < 0 || startIndex + static_cast<int>(objects.size()) > MAX_OBJECTS)
-    {
-        std::cerr << "[Objects::UploadBulkObjects] Invalid range!" << std::endl;
-        return;
-    }
+    if (objectIndex < 0 || objectIndex >= g_numObjects || StaticColliders::IsStatic(objectIndex) == isStatic) return;
+    if (isStatic) KinematicPaths::Clear(objectIndex);  // One or the other
+    StaticColliders::Set(objectIndex, isStatic);
+    g_broadphaseStale = true;  // The collision structure holds only the dynamic objects
+    g_sceneRevision++;
+    ObjectSleep::WakeAll();    // Objects resting on it, or on what it used to be
+}
 
-    // Copy objects to GPU buffers
-    if (g_useMapBuffer && g_mappedSSBO[0])
-    {
-        std::memcpy(&g_mappedSSBO[0][startIndex], objects.data(),
-            objects.size() * sizeof(Object));
-        std::memcpy(&g_mappedSSBO[1][startIndex], objects.data(),
-            objects.size() * sizeof(Object));
-    }
-    else
-    {
-        for (int i = 0; i < 2; i++)
-        {
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[i]);
-            glBufferSubData(GL_SHADER_STORAGE_BUFFER,
-                startIndex * sizeof(Object),
-                objects.size() * sizeof(Object),
-                objects.data());
-        }
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-    }
+bool Objects::IsObjectStatic(int objectIndex)
+{
+    return objectIndex >= 0 && objectIndex < g_numObjects && StaticColliders::IsStatic(objectIndex);
+}
 
-    // Update object count
-    if (startIndex + static_cast<int>(objects.size()) > g_numObjects)
-        g_numObjects = startIndex + static_cast<int>(objects.size());
+int Objects::GetStaticObjectCount()
+{
+    return StaticColliders::GetCount();
 }
 
 // ============================================================================
-// Get direct pointer to object data (read-only)
+// KINEMATIC OBJECTS
 // ============================================================================
-const Object* Objects::GetObjectDataDirect(int sourceIndex)
+
+void Objects::SetObjectKinematic(int objectIndex, int tableX, int tableY, float period)
 {
-    if (sourceIndex < 0 || sourceIndex > 1) return nullptr;
-    if (g_useMapBuffer && g_mappedSSBO[sourceIndex]) return g_mappedSSBO[sourceIndex];
-    return nullptr;
+    if (objectIndex < 0 || objectIndex >= g_numObjects) return;
+    if (StaticColliders::IsStatic(objectIndex)) SetObjectStatic(objectIndex, false);
+    KinematicPaths::Set(objectIndex, tableX, tableY, period);
+    g_sceneRevision++;
+    ObjectSleep::WakeAll();
 }
 
-// ============================================================================
-// Get direct pointer to object data (mutable)
-// ============================================================================
-Object* Objects::GetObjectDataDirectMutable(int sourceIndex)
+bool Objects::SetObjectKeyframes(int objectIndex, int tableX, int tableY, const std::vector<float>& times,
+                                 const std::vector<float>& xs, const std::vector<float>& ys, bool loop)
 {
-    if (sourceIndex < 0 || sourceIndex > 1) return nullptr;
-    if (g_useMapBuffer && g_mappedSSBO[sourceIndex]) return g_mappedSSBO[sourceIndex];
-    return nullptr;
+    if (objectIndex < 0 || objectIndex >= g_numObjects) return false;
+    if (!KinematicPaths::SetKeyframes(tableX, tableY, times, xs, ys)) return false;
+    SetObjectKinematic(objectIndex, tableX, tableY, loop ? times.back() : 0.0f);
+    return true;
+}
+
+void Objects::ClearObjectKinematic(int objectIndex)
+{
+    if (!KinematicPaths::IsKinematic(objectIndex)) return;
+    KinematicPaths::Clear(objectIndex);
+    g_sceneRevision++;
+}
+
+bool Objects::IsObjectKinematic(int objectIndex)
+{
+    return objectIndex >= 0 && objectIndex < g_numObjects && KinematicPaths::IsKinematic(objectIndex);
+}
+
+int Objects::GetKinematicObjectCount()
+{
+    return KinematicPaths::GetCount();
 }
 
 // ============================================================================
-// Remove an object from the system
+// SDF COLLIDERS
 // ============================================================================
-void Objects::RemoveObject(int index)
+
+bool Objects::SetSdfCollider(const std::string& expression, std::string& error)
 {
-    if (g_numObjects == 0)
-    {
-        std::cerr << "[Objects::RemoveObject] No objects to remove!" << std::endl;
-        return;
-    }
+    std::string function;
+    if (!ExpressionToFunction(expression, "sdfExpression", "SDF colliders", function, error)) return false;
+    if (!SdfColliders::SetExpression(function, error)) return false;
+    ObjectSleep::WakeAll();  // Sleepers may sit inside the new surface
+    return true;
+}
 
-    // Determine which index to remove
-    int removeIdx = (index >= 0 && index < g_numObjects) ? index : (g_numObjects - 1);
-    ClearConstraints(removeIdx);
+void Objects::ClearSdfCollider()
+{
+    SdfColliders::ClearExpression();
+    ObjectSleep::WakeAll();
+}
 
-    // Remove constraints that reference the removed object
-    for (int i = 0; i < g_numObjects; i++)
-    {
-        if (i == removeIdx) continue;
+bool Objects::SetSdfGrid(const std::vector<float>& distances, int columns, int rows,
+                         float xMin, float xMax, float yMin, float yMax)
+{
+    if (!SdfColliders::SetGrid(distances, columns, rows, xMin, xMax, yMin, yMax)) return false;
+    ObjectSleep::WakeAll();
+    return true;
+}
+
+void Objects::ClearSdfGrid()
+{
+    SdfColliders::ClearGrid();
+    ObjectSleep::WakeAll();
+}
+
+void Objects::SetSdfSurface(float restitution, float friction)
+{
+    SdfColliders::SetSurface(restitution, friction);
+}
+
+// ============================================================================
+// STREAMED PARTICLES
+// ============================================================================
 
-        ObjectConstraints& pc = g_objectConstraintMappings[i];
-        for (int j = pc.numConstraints - 1; j >= 0; j--)
-        {
-            int globalIdx = pc.constraintOffset + j;
-            Constraint& c = g_allConstraints[globalIdx];
-            if (c.type == CONSTRAINT_DISTANCE && c.targetObjectID == removeIdx)
-                RemoveConstraint(i, j);
-        }
-    }
+// Reasons a chunk could see another chunk, or a step would run differently per chunk
+static bool CanStream(std::string& error)
+{
+    if (g_numObjects > 0) error = "Streaming runs in the object buffers, so the scene must hold no objects";
+    else if (g_programCompute == 0 || !g_computeShaderReady || !g_constraintPass.ready || !g_collisionPass.ready)
+        error = "The simulation shaders are still loading";
+    else if (Objects::IsAdaptiveTimestepActive()) error = "Streaming needs a fixed timestep";
+    else if (g_sleepEnabled || Metropolis::IsEnabled()) error = "Streaming does not support sleeping or Metropolis moves";
+    else if (ObjectLifecycle::IsActive() || ObjectLifecycle::GetEmitterCount() > 0) error = "Streaming does not support emitters";
+    else if (ObjectRecorder::IsRecording() || ObjectTrails::GetObjects() > 0) error = "Recording and trails keep objects by slot, so they cannot stream";
+    else if (g_equationsUseState || ObjectSensitivity::GetCount() > 0) error = "State registers and sensitivities are kept by slot, so they cannot stream";
+    else if (ObjectWorlds::Count() > 0) error = "Streaming does not support ensemble worlds";
+    else if (!Objects::CanFuseSubsteps()) error = "Streamed particles must be independent: no constraints, springs, aggregates, grid fields, pipelines or equations reading other objects";
+    else return true;
+    return false;
+}
 
-    // If removing the last object, just decrement count
-    if (removeIdx == g_numObjects - 1)
+bool Objects::StepStreamed(const StreamedParticles& particles, int steps, int chunkObjects, std::string& error)
+{
+    if (steps <= 0 || particles.count == 0) return true;
+    if (!particles.x || !particles.y || !particles.vx || !particles.vy)
     {
-        g_objectConstraintMappings[removeIdx] = ObjectConstraints();
-        g_numObjects--;
-        UploadConstraintsToGPU();
-        return;
+        error = "Streaming needs x, y, vx and vy";
+        return false;
     }
+    if (!CanStream(error)) return false;
 
-    // Swap with last object and decrement count
-    int lastObjectIdx = g_numObjects - 1;
-
-    if (g_useMapBuffer && g_mappedSSBO[0])
+    int chunk = static_cast<int>(std::min<size_t>(particles.count, static_cast<size_t>(std::min(std::max(chunkObjects, 1), MAX_OBJECTS))));
+    if ((g_objectCapacity < chunk && !ReserveObjects(chunk)) || !ObjectStreaming::Reserve(chunk))
     {
-        g_mappedSSBO[0][removeIdx] = g_mappedSSBO[0][lastObjectIdx];
-        g_mappedSSBO[1][removeIdx] = g_mappedSSBO[1][lastObjectIdx];
+        error = "Could not allocate buffers for chunks of " + std::to_string(chunk) + " objects";
+        return false;
     }
-    else
-    {
-        Object lastObject;
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[0]);
-        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER,
-            lastObjectIdx * sizeof(Object),
-            sizeof(Object),
-            &lastObject);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-        for (int i = 0; i < 2; i++)
-        {
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[i]);
-            glBufferSubData(GL_SHADER_STORAGE_BUFFER,
-                removeIdx * sizeof(Object),
-                sizeof(Object),
-                &lastObject);
-        }
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-    }
+    // The slots the chunks run in collide with nothing, whatever objects held them before
+    for (int i = 0; i < chunk; i++)
+        g_collisionProperties[i] = CollisionProperties{ 0, COLLISION_NONE, 0.0f, 0.0f, 1.0f, COLLISION_CATEGORY_DEFAULT, COLLISION_MASK_ALL, 0 };
+    g_collidableCountDirty = true;
+    if (g_initialStateCount < 0) CaptureInitialState(g_currentObjectBuffer);  // The empty scene, not a chunk
+
+    // Every chunk starts from the same clock and step count; storage reordering would permute them
+    const SimParams params = g_simParams;
+    const unsigned long long stepIndex = g_stepIndex;
+    const uint32_t randomSeed = g_randomSeed;
+    const int reorderInterval = g_storageReorderInterval;
+    g_storageReorderInterval = 0;
 
-    // Update constraint mappings
-    g_objectConstraintMappings[removeIdx] = g_objectConstraintMappings[lastObjectIdx];
-    if (g_objectConstraintMappings[removeIdx].objectID == lastObjectIdx)
-        g_objectConstraintMappings[removeIdx].objectID = removeIdx;
+    Object prototype = CreateDefaultObjectInternal(SKIN_CIRCLE, 0, particles.equationID);
+    size_t numChunks = (particles.count + chunk - 1) / chunk;
+    auto chunkCount = [&](size_t k) { return static_cast<int>(std::min<size_t>(chunk, particles.count - k * chunk)); };
 
-    // Update constraint references to the moved object
-    for (int i = 0; i < g_numObjects - 1; i++)
+    auto pack = [&](size_t k, Object* out)
     {
-        ObjectConstraints& pc = g_objectConstraintMappings[i];
-        for (int j = 0; j < pc.numConstraints; j++)
+        size_t first = k * chunk;
+        int count = chunkCount(k);
+        for (int j = 0; j < count; j++)
         {
-            int globalIdx = pc.constraintOffset + j;
-            Constraint& c = g_allConstraints[globalIdx];
-            if (c.type == CONSTRAINT_DISTANCE && c.targetObjectID == lastObjectIdx)
-                c.targetObjectID = removeIdx;
+            size_t i = first + j;
+            Object& o = out[j];
+            o = prototype;
+            o.position = glm::vec2(particles.x[i], particles.y[i]);
+            o.velocity = glm::vec2(particles.vx[i], particles.vy[i]);
+            o.mass = particles.mass ? particles.mass[i] : particles.massValue;
+            o.charge = particles.charge ? particles.charge[i] : particles.chargeValue;
+            if (particles.ax) o.collisionData.x = particles.ax[i];
+            if (particles.ay) o.collisionData.y = particles.ay[i];
         }
-    }
-
-    // Clear last slot and decrement count
-    g_objectConstraintMappings[lastObjectIdx] = ObjectConstraints();
-    g_numObjects--;
-    UploadConstraintsToGPU();
-}
-
-// ============================================================================
-// Reset all objects to initial conditions
-// ============================================================================
-void Objects::ResetToInitialConditions()
-{
-    for (int i = 0; i < g_numObjects; i++)
+    };
+    auto unpack = [&](size_t k, const Object* in)
     {
-        // Preserve equation ID
-        int preservedEqID = 0;
-        if (g_useMapBuffer && g_mappedSSBO[0])
-            preservedEqID = g_mappedSSBO[0][i].equationID;
-        else
+        size_t first = k * chunk;
+        int count = chunkCount(k);
+        for (int j = 0; j < count; j++)
         {
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[0]);
-            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER,
-                i * sizeof(Object) + offsetof(Object, equationID),
-                sizeof(int),
-                &preservedEqID);
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            size_t i = first + j;
+            const Object& o = in[j];
+            particles.x[i] = o.position.x;
+            particles.y[i] = o.position.y;
+            particles.vx[i] = o.velocity.x;
+            particles.vy[i] = o.velocity.y;
+            if (particles.ax) particles.ax[i] = o.collisionData.x;
+            if (particles.ay) particles.ay[i] = o.collisionData.y;
         }
+    };
 
-        // Create reset object with preserved equation ID
-        Object resetObject = CreateDefaultObjectInternal(
-            g_currentDefaultObjectType,
-            i,
-            preservedEqID);
-
-        // Update object data
-        if (g_useMapBuffer && g_mappedSSBO[0])
-        {
-            g_mappedSSBO[0][i] = resetObject;
-            g_mappedSSBO[1][i] = resetObject;
-        }
-        else
+    // Chunk k is packed while the GPU still steps k - 1 and k - 2, and read back STREAM_SLOTS chunks later
+    bool stepped = true;
+    for (size_t k = 0; k < numChunks && stepped; k++)
+    {
+        int slot = static_cast<int>(k % STREAM_SLOTS);
+        if (k >= STREAM_SLOTS) unpack(k - STREAM_SLOTS, ObjectStreaming::Finish(slot));
+        pack(k, ObjectStreaming::BeginFill(slot));
+
+        int count = chunkCount(k);
+        ObjectStreaming::Upload(slot, g_objectSSBO[0], count);
+        g_numObjects = count;
+        g_stepIndex = stepIndex;
+        g_simParams = params;
+        g_simParamsDirty = true;
+        if (g_equationsUseRandom) g_randomSeed = randomSeed + static_cast<uint32_t>(k) * 0x9E3779B9u;  // Own draws per chunk
+
+        // Independent objects fuse the steps into one dispatch; the loop only covers a shorter batch
+        int current = 0;
+        for (int left = steps; left > 0;)
         {
-            for (int j = 0; j < 2; j++)
+            int taken = Update(current, 1 - current, left);
+            if (taken <= 0)
             {
-                glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[j]);
-                glBufferSubData(GL_SHADER_STORAGE_BUFFER,
-                    i * sizeof(Object),
-                    sizeof(Object),
-                    &resetObject);
+                stepped = false;
+                break;
             }
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            current = 1 - current;
+            left -= taken;
+            g_simParams.time += taken * g_simParams.dt;
+            g_simParamsDirty = true;
         }
+        ObjectStreaming::Download(slot, g_objectSSBO[current], count);
     }
+    for (size_t k = numChunks > STREAM_SLOTS ? numChunks - STREAM_SLOTS : 0; k < numChunks && stepped; k++)
+        unpack(k, ObjectStreaming::Finish(static_cast<int>(k % STREAM_SLOTS)));
+
+    g_numObjects = 0;
+    g_collidableCountDirty = true;
+    g_stepIndex = stepIndex + static_cast<unsigned long long>(steps);
+    g_simParams = params;
+    g_simParamsDirty = true;
+    g_randomSeed = randomSeed;
+    g_storageReorderInterval = reorderInterval;
+    g_sceneRevision++;  // Bounds and caches of the last chunk describe no object
+    MarkObjectsWritten();
+
+    if (!stepped) error = "A chunk stopped stepping (the simulation shaders are not ready)";
+    return stepped;
 }
 
 // ============================================================================
-// Update a single object's data from CPU
+// GROUP AGGREGATES
 // ============================================================================
-void Objects::UpdateObjectCPU(int index, const Object& newData)
+
+bool Objects::SetObjectGroup(const std::string& name, const std::vector<int>& objectIndices)
+{
+    for (int index : objectIndices)
+        if (index < 0 || index >= g_numObjects) return false;
+    return ObjectAggregates::SetGroup(name, objectIndices);
+}
+
+std::vector<int> Objects::GetObjectGroup(const std::string& name)
+{
+    return ObjectAggregates::GetGroup(name, g_numObjects);
+}
+
+bool Objects::SetAggregate(const std::string& name, const std::string& expression, ReductionOp op,
+                           const std::string& group, std::string& error)
 {
-    if (index >= 0 && index < g_numObjects)
+    if (!group.empty() && !ObjectAggregates::HasGroup(group))
     {
-        if (g_useMapBuffer && g_mappedSSBO[0])
-        {
-            g_mappedSSBO[0][index] = newData;
-            g_mappedSSBO[1][index] = newData;
-        }
-        else
-        {
-            for (int i = 0; i < 2; i++)
-            {
-                glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[i]);
-                glBufferSubData(GL_SHADER_STORAGE_BUFFER,
-                    index * sizeof(Object),
-                    sizeof(Object),
-                    &newData);
-            }
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-        }
+        error = "No object group named " + group;
+        return false;
+    }
+    int slot = aggregateSlot(name);
+    if (slot < 0)
+    {
+        error = "At most " + std::to_string(MAX_AGGREGATE_NAMES) + " aggregate names";
+        return false;
     }
+
+    std::string function;
+    if (!ExpressionToFunction(expression, "aggregate" + std::to_string(slot), "Aggregates", function, error)) return false;
+    return ObjectAggregates::Set(slot, group, expression, function, op);
 }
 
-// ============================================================================
-// Set default object type for new objects
-// ============================================================================
-void Objects::SetDefaultObjectType(int type)
+void Objects::RemoveAggregate(const std::string& name)
 {
-    g_currentDefaultObjectType = type;
+    int slot = findAggregateSlot(name);
+    if (slot >= 0) ObjectAggregates::Remove(slot);
 }
 
-// ============================================================================
-// Set global system parameters
-// ============================================================================
-void Objects::SetSystemParameters(float gravity, float damping, float stiffness)
+bool Objects::GetAggregate(const std::string& name, float& value)
 {
-    g_currentSystemGravity = gravity;
-    g_currentSystemDamping = damping;
-    g_currentSystemStiffness = stiffness;
+    int slot = findAggregateSlot(name);
+    if (slot < 0) return false;
+    value = ObjectAggregates::Get(slot);
+    return true;
 }
 
-// ============================================================================
-// Get quad rendering shader program ID
-// ============================================================================
-GLuint Objects::GetQuadProgram()
+void Objects::SetStateRegisters(int objectIndex, const float* values, int count, int first)
 {
-    return g_programQuad;
+    if (objectIndex < 0 || objectIndex >= g_numObjects) return;
+    StateRegisters::Set(objectIndex, first, values, count);
+    g_sceneRevision++;
+    ObjectSleep::WakeAll();
 }
 
-// ============================================================================
-// Get compute shader program ID
-// ============================================================================
-GLuint Objects::GetComputeProgram()
+void Objects::GetStateRegisters(int objectIndex, float* out)
 {
-    return g_programCompute;
+    StateRegisters::Get(objectIndex, out);
 }
 
 // ============================================================================
-// Get current number of objects
+// PARAMETER SENSITIVITIES
 // ============================================================================
-int Objects::GetNumObjects()
+
+void Objects::SetSensitivityParameters(const std::vector<int>& varHashes)
 {
-    return g_numObjects;
+    ObjectSensitivity::SetParameters(varHashes);
+    ResetSensitivities();
 }
 
-// ============================================================================
-// Clean up all resources
-// ============================================================================
-void Objects::Cleanup()
+void Objects::ResetSensitivities()
 {
-    // Unmap buffers if mapped
-    if (g_useMapBuffer)
-    {
-        for (int i = 0; i < 2; i++)
-        {
-            if (g_mappedSSBO[i])
-            {
-                glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_objectSSBO[i]);
-                glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
-                g_mappedSSBO[i] = nullptr;
-            }
-        }
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-    }
+    ObjectSensitivity::Clear(0, g_objectCapacity);
+}
 
-    // Delete shader programs
-    glDeleteProgram(g_programCompute);
-    glDeleteProgram(g_programQuad);
-    g_programCompute = 0;
-    g_programQuad = 0;
+void Objects::GetSensitivities(std::vector<float>& out)
+{
+    ObjectSensitivity::Get(g_numObjects, out);
+}
 
-    g_computeShaderReady = false;
-    g_quadShaderReady = false;
+// ============================================================================
+// OBJECT HANDLES
+// ============================================================================
 
-    // Delete all buffers and VAOs
-    SafeDeleteBuffers(g_objectSSBO, 2);
-    SafeDeleteVertexArrays(g_renderVAO, 2);
+int Objects::GetObjectHandle(int objectIndex)
+{
+    if (objectIndex < 0 || objectIndex >= g_numObjects) return -1;
+    return ObjectHandles::HandleOf(objectIndex);
+}
 
-    SafeDeleteBuffers(&g_allTokensSSBO, 1);
-    SafeDeleteBuffers(&g_allConstantsSSBO, 1);
-    SafeDeleteBuffers(&g_mappingsSSBO, 1);
-    SafeDeleteBuffers(&g_initialPosSSBO, 1);
-    SafeDeleteBuffers(&g_constraintsSSBO, 1);
-    SafeDeleteBuffers(&g_objectConstraintsSSBO, 1);
-    SafeDeleteBuffers(&g_collisionPropsSSBO, 1);
-    SafeDeleteBuffers(&g_contactBufferSSBO, 1);  // NEW: Delete contact buffer
+int Objects::FindObjectByHandle(int handle)
+{
+    int index = ObjectHandles::IndexOf(handle);
+    return index < g_numObjects ? index : -1;
+}
 
-    // Clear all data structures
-    g_numObjects = 0;
-    g_allTokens.clear();
-    g_allConstants.clear();
-    g_equationMappings.clear();
-    g_equationStringToID.clear();
-    g_allConstraints.clear();
-    g_objectConstraintMappings.clear();
-    g_collisionProperties.clear();
-    g_collisionMatrix.clear();
+void Objects::GetObjectHandles(std::vector<int>& handles)
+{
+    int hostObjects = ObjectLifecycle::IsActive() ? ObjectLifecycle::GetBase() : g_numObjects;
+    ObjectHandles::GetHandles(hostObjects, handles);
+}
 
-    // Reset collision parameters
-    g_enableWarmStart = false;
-    g_maxContactIterations = 3;
-    g_useAnalyticalCollision = true;
+bool Objects::RestoreObjectHandles(const std::vector<int>& handles)
+{
+    DiscardSpawnedObjects();
+    if (static_cast<int>(handles.size()) != g_numObjects || !ObjectHandles::Restore(handles)) return false;
+    g_sceneRevision++;
+    return true;
 }
 
 // ============================================================================
-// Update shader loading status
+// ENSEMBLE WORLDS
 // ============================================================================
-void Objects::UpdateShaderLoadingStatus()
+
+bool Objects::SetObjectWorlds(const std::vector<ObjectWorlds::WorldRange>& worlds)
 {
-    g_computeLoader.Update();
-    g_quadLoader.Update();
+    for (const ObjectWorlds::WorldRange& world : worlds)
+    {
+        if (world.first < 0 || world.count < 0 || world.first + world.count > g_numObjects)
+        {
+            std::cerr << "[Objects] Ensemble world [" << world.first << ", " << world.first + world.count
+                      << ") is outside the " << g_numObjects << " objects" << std::endl;
+            return false;
+        }
+    }
+    ObjectWorlds::Set(worlds);
+    ObjectSleep::WakeAll();
+    return true;
 }
 
-// ============================================================================
-// Check if compute shader is ready
-// ============================================================================
-bool Objects::IsComputeShaderReady()
+bool Objects::SetObjectWorldParameters(const std::vector<ObjectWorlds::WorldParameters>& parameters)
 {
-    return g_computeShaderReady;
+    if (parameters.size() != static_cast<size_t>(ObjectWorlds::Count()))
+    {
+        std::cerr << "[Objects] " << parameters.size() << " parameter rows for "
+                  << ObjectWorlds::Count() << " ensemble worlds" << std::endl;
+        return false;
+    }
+    ObjectWorlds::SetParameters(parameters);
+    ObjectSleep::WakeAll();
+    return true;
 }
 
-// ============================================================================
-// Check if quad shader is ready
-// ============================================================================
-bool Objects::IsQuadShaderReady()
+int Objects::GetNumObjectWorlds()
 {
-    return g_quadShaderReady;
+    return ObjectWorlds::Count();
 }
 
 // ============================================================================
-// Check if all shaders are ready
+// Fork: world w holds objects [w * count, (w + 1) * count), copies of the scene
 // ============================================================================
-bool Objects::AreAllShadersReady()
+static int g_forkStash = -1;  // First state register row of the scene's saved registers, past every world
+
+bool Objects::ForkWorlds(int sourceIndex, int worlds)
 {
-    return g_computeShaderReady && g_quadShaderReady;
+    if (sourceIndex < 0 || sourceIndex > 1 || worlds < 1 || g_forkStash >= 0) return false;
+    if (ObjectWorlds::Count() > 0 || ObjectLifecycle::IsActive() || SpringNetwork::GetSpringCount() > 0) return false;
+    FlushObjectWrites();
+    SyncConstraintMirror();
+
+    int count = g_numObjects;
+    long long total = static_cast<long long>(count) * worlds;
+    if (count == 0 || total + count > MAX_OBJECTS || !ObjectFork::IsReady()) return false;
+    if (!ReserveObjects(static_cast<int>(total) + count)) return false;  // Room for the register stash
+    if (!ObjectFork::Save(g_objectSSBO[sourceIndex], count)) return false;
+    ObjectFork::Replicate(g_objectSSBO, 2, worlds);
+
+    std::vector<std::pair<int, Constraint>> constraints = GetAllConstraints();
+    std::vector<std::pair<int, Constraint>> copies;
+    copies.reserve(constraints.size() * static_cast<size_t>(worlds - 1));
+    float params[OBJECT_PARAM_COUNT];
+    for (int i = count; i < total; i++)
+    {
+        int from = i % count;
+        ObjectHandles::Append(i);
+        g_objectConstraintMappings[i] = ObjectConstraints();
+        g_collisionProperties[i] = g_collisionProperties[from];
+        SetObjectEquationRef(i, g_objectEquationIDs[from]);
+        ObjectParams::Get(from, params);
+        ObjectParams::Set(i, 0, params, OBJECT_PARAM_COUNT);
+        StaticColliders::Set(i, StaticColliders::IsStatic(from));
+        int tableX, tableY;
+        float period;
+        if (KinematicPaths::Get(from, tableX, tableY, period)) KinematicPaths::Set(i, tableX, tableY, period);
+        else KinematicPaths::Clear(i);
+        ObjectAggregates::Clear(i);
+    }
+    for (int w = 1; w < worlds; w++)
+    {
+        int offset = w * count;
+        for (const auto& entry : constraints)
+        {
+            Constraint constraint = entry.second;
+            if (constraint.targetObjectID >= 0) constraint.targetObjectID += offset;
+            copies.emplace_back(entry.first + offset, constraint);
+        }
+    }
+
+    // The scene's registers are kept past the worlds for EndFork
+    g_forkStash = static_cast<int>(total);
+    StateRegisters::Copy(g_forkStash, 0, count);
+    for (int w = 1; w < worlds; w++) StateRegisters::Copy(w * count, 0, count);
+    ObjectSensitivity::Clear(count, static_cast<int>(total) - count);
+
+    g_numObjects = static_cast<int>(total);
+    g_objectGeneration++;
+    g_initialStateCount = -1;
+    g_collidableCountDirty = true;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_collisionPropsSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, count * sizeof(CollisionProperties),
+                    (g_numObjects - count) * sizeof(CollisionProperties), &g_collisionProperties[count]);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    MarkConstraintMappingsDirty(count, g_numObjects);
+    if (!copies.empty()) AddConstraints(copies);
+
+    std::vector<ObjectWorlds::WorldRange> ranges;
+    for (int w = 0; w < worlds; w++) ranges.push_back({ w * count, count });
+    ObjectWorlds::Set(ranges);
+    ObjectSleep::WakeAll();
+    ContactSolver::ResetWarmStart();
+    g_sceneRevision++;
+    return true;
 }
 
-// ============================================================================
-// Get overall shader loading progress
-// ============================================================================
-float Objects::GetShaderLoadProgress()
+bool Objects::EndFork()
 {
-    float computeProgress = g_computeLoader.GetProgress();
-    float quadProgress = g_quadLoader.GetProgress();
-    return (computeProgress + quadProgress) / 2.0f;
+    int count = ObjectFork::GetSavedCount();
+    if (g_forkStash < 0 || count < 0) return false;
+    if (g_numObjects < count)
+    {
+        // Objects of the scene were removed during the fork; its saved state no longer fits
+        std::cerr << "[Objects] Fork ended with fewer objects than it started from, the rollout state is kept" << std::endl;
+        StateRegisters::Clear(g_forkStash, count);
+        g_forkStash = -1;
+        ObjectWorlds::Clear();
+        return false;
+    }
+
+    std::vector<int> copies;
+    for (int i = count; i < g_numObjects; i++) copies.push_back(i);
+    RemoveObjects(copies);
+    ObjectWorlds::Clear();
+
+    ObjectSleep::WakeAll();
+    ContactSolver::ResetWarmStart();  // Impulses of the rollout
+    ObjectFork::Restore(g_objectSSBO, 2);
+    StateRegisters::Copy(0, g_forkStash, count);
+    StateRegisters::Clear(g_forkStash, count);
+    g_forkStash = -1;
+    g_objectGeneration++;
+    g_initialStateCount = -1;
+    g_sceneRevision++;
+    return true;
 }
 
-// ============================================================================
-// Get shader loading status message
-// ============================================================================
-std::string Objects::GetShaderLoadStatusMessage()
+bool Objects::IsForked()
 {
-    if (!g_computeShaderReady) return "[1/2] " + g_computeLoader.GetStatusMessage();
-    else if (!g_quadShaderReady) return "[2/2] " + g_quadLoader.GetStatusMessage();
-    else return "All shaders ready!";
+    return g_forkStash >= 0;
+}
+
+bool Objects::EquationsUseLongRange()
+{
+    return g_equationsUseLongRange;
 }
 
 // ============================================================================
@@ -1415,12 +7337,7 @@ void Objects::SetCollisionEnabled(int objectIndex, bool enabled)
 
     g_collisionProperties[objectIndex].enabled = enabled ? 1 : 0;
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_collisionPropsSSBO);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER,
-        objectIndex * sizeof(CollisionProperties),
-        sizeof(CollisionProperties),
-        &g_collisionProperties[objectIndex]);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    UploadCollisionPropertiesToGPU(objectIndex);
 }
 
 // Set collision shape for an object
@@ -1430,12 +7347,7 @@ void Objects::SetCollisionShape(int objectIndex, CollisionShape shape)
 
     g_collisionProperties[objectIndex].shapeType = static_cast<int>(shape);
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_collisionPropsSSBO);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER,
-        objectIndex * sizeof(CollisionProperties),
-        sizeof(CollisionProperties),
-        &g_collisionProperties[objectIndex]);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    UploadCollisionPropertiesToGPU(objectIndex);
 }
 
 // Set collision material properties for an object
@@ -1446,12 +7358,7 @@ void Objects::SetCollisionProperties(int objectIndex, float restitution, float f
     g_collisionProperties[objectIndex].restitution = clamp(restitution, 0.0f, 1.0f);
     g_collisionProperties[objectIndex].friction = clamp(friction, 0.0f, 1.0f);
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_collisionPropsSSBO);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER,
-        objectIndex * sizeof(CollisionProperties),
-        sizeof(CollisionProperties),
-        &g_collisionProperties[objectIndex]);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    UploadCollisionPropertiesToGPU(objectIndex);
 }
 
 // Get collision properties for an object
@@ -1463,13 +7370,111 @@ CollisionProperties Objects::GetCollisionProperties(int objectIndex)
     return g_collisionProperties[objectIndex];
 }
 
+void Objects::SetCollisionProperties(int first, const std::vector<CollisionProperties>& properties)
+{
+    if (properties.empty() || first < 0 || first + static_cast<int>(properties.size()) > g_numObjects) return;
+
+    std::copy(properties.begin(), properties.end(), g_collisionProperties.begin() + first);
+    g_collidableCountDirty = true;
+    g_sceneRevision++;
+    ObjectSleep::WakeAll();
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_collisionPropsSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, first * sizeof(CollisionProperties),
+                    properties.size() * sizeof(CollisionProperties), properties.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
 // Enable or disable collisions between two specific objects
 void Objects::EnableCollisionBetween(int obj1, int obj2, bool enable)
 {
-    if (obj1 < 0 || obj1 >= MAX_OBJECTS || obj2 < 0 || obj2 >= MAX_OBJECTS) return;
+    if (obj1 < 0 || obj1 >= g_numObjects || obj2 < 0 || obj2 >= g_numObjects || obj1 == obj2) return;
+
+    unsigned long long key = CollisionPairKey(obj1, obj2);
+    bool changed = enable ? (g_collisionExclusions.erase(key) > 0)
+                          : g_collisionExclusions.insert(key).second;
+    if (changed)
+    {
+        g_collisionExclusionsDirty = true;
+        g_sceneRevision++;
+        ObjectSleep::WakeAll();
+    }
+}
+
+// Set the category bits an object belongs to and the categories it collides with
+void Objects::SetCollisionFilter(int objectIndex, unsigned int category, unsigned int mask)
+{
+    if (objectIndex < 0 || objectIndex >= g_numObjects) return;
+
+    g_collisionProperties[objectIndex].category = category;
+    g_collisionProperties[objectIndex].mask = mask;
+    UploadCollisionPropertiesToGPU(objectIndex);
+}
+
+// Swept collision tests for a fast object: pairs with it are also tested over the whole step
+void Objects::SetContinuousCollision(int objectIndex, bool enabled)
+{
+    if (objectIndex < 0 || objectIndex >= g_numObjects) return;
+
+    g_collisionProperties[objectIndex].continuous = enabled ? 1 : 0;
+    UploadCollisionPropertiesToGPU(objectIndex);
+}
+
+// Apply edit to the collision properties of every listed object, then upload them as one range
+template<typename Edit>
+static void EditCollisionProperties(const std::vector<int>& objectIndices, Edit edit)
+{
+    int lo = INT_MAX, hi = -1;
+    for (int index : objectIndices)
+    {
+        if (index < 0 || index >= g_numObjects) continue;
+        edit(g_collisionProperties[index]);
+        lo = std::min(lo, index);
+        hi = std::max(hi, index);
+    }
+    if (hi < lo) return;
+
+    g_collidableCountDirty = true;
+    g_sceneRevision++;
+    ObjectSleep::WakeAll();  // Sleepers rest against the old shapes
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_collisionPropsSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+        lo * sizeof(CollisionProperties),
+        (hi - lo + 1) * sizeof(CollisionProperties),
+        &g_collisionProperties[lo]);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void Objects::SetCollisionEnabled(const std::vector<int>& objectIndices, bool enabled)
+{
+    EditCollisionProperties(objectIndices, [&](CollisionProperties& props) { props.enabled = enabled ? 1 : 0; });
+}
+
+void Objects::SetCollisionShape(const std::vector<int>& objectIndices, CollisionShape shape)
+{
+    EditCollisionProperties(objectIndices, [&](CollisionProperties& props) { props.shapeType = static_cast<int>(shape); });
+}
+
+void Objects::SetCollisionProperties(const std::vector<int>& objectIndices, float restitution, float friction)
+{
+    EditCollisionProperties(objectIndices, [&](CollisionProperties& props)
+    {
+        props.restitution = clamp(restitution, 0.0f, 1.0f);
+        props.friction = clamp(friction, 0.0f, 1.0f);
+    });
+}
+
+void Objects::SetCollisionFilter(const std::vector<int>& objectIndices, unsigned int category, unsigned int mask)
+{
+    EditCollisionProperties(objectIndices, [&](CollisionProperties& props)
+    {
+        props.category = category;
+        props.mask = mask;
+    });
+}
 
-    g_collisionMatrix[obj1][obj2] = enable;
-    g_collisionMatrix[obj2][obj1] = enable;
+void Objects::SetContinuousCollision(const std::vector<int>& objectIndices, bool enabled)
+{
+    EditCollisionProperties(objectIndices, [&](CollisionProperties& props) { props.continuous = enabled ? 1 : 0; });
 }
 
 // Check if collisions are enabled for an object
@@ -1,4 +1,6 @@
 #include "parser.h"
+#include "equation_optimizer.h"
+#include "equation_derivative.h"
 #include <sstream>
 #include <cctype>
 #include <algorithm>
@@ -7,6 +9,125 @@
 #include <iostream>
 #include <set>
 #include <cmath>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <charconv>
+#include <deque>
+#include <mutex>
+
+// ============================================================================
+// SYMBOL TABLE
+// ============================================================================
+
+namespace
+{
+    struct SymbolTable {
+        std::mutex mutex;
+        std::deque<std::string> names;                       // Never moves, the keys below point into it
+        std::unordered_map<std::string_view, SymbolId> ids;
+    };
+
+    SymbolTable& symbolTable()
+    {
+        static SymbolTable table;
+        return table;
+    }
+}
+
+SymbolId internSymbol(std::string_view name)
+{
+    SymbolTable& table = symbolTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto it = table.ids.find(name);
+    if (it != table.ids.end()) return it->second;
+
+    SymbolId id = static_cast<SymbolId>(table.names.size());
+    table.names.emplace_back(name);
+    table.ids.emplace(table.names.back(), id);
+    return id;
+}
+
+SymbolId findSymbol(std::string_view name)
+{
+    SymbolTable& table = symbolTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto it = table.ids.find(name);
+    return it != table.ids.end() ? it->second : NO_SYMBOL;
+}
+
+namespace
+{
+    // Names that keep the slot they were first given: agg[] and fld[]
+    struct SlotNames {
+        std::mutex mutex;
+        std::vector<std::string> names;  // By slot
+    };
+
+    SlotNames& aggregateNames()
+    {
+        static SlotNames table;
+        return table;
+    }
+
+    SlotNames& pipelineFieldNames()
+    {
+        static SlotNames table;
+        return table;
+    }
+
+    int findSlotLocked(const SlotNames& table, std::string_view name)
+    {
+        for (size_t k = 0; k < table.names.size(); k++)
+            if (table.names[k] == name) return static_cast<int>(k);
+        return -1;
+    }
+
+    int assignSlot(SlotNames& table, std::string_view name, int maxSlots)
+    {
+        std::lock_guard<std::mutex> lock(table.mutex);
+        int slot = findSlotLocked(table, name);
+        if (slot >= 0 || table.names.size() >= static_cast<size_t>(maxSlots)) return slot;
+        table.names.emplace_back(name);
+        return static_cast<int>(table.names.size() - 1);
+    }
+
+    int findSlot(SlotNames& table, std::string_view name)
+    {
+        std::lock_guard<std::mutex> lock(table.mutex);
+        return findSlotLocked(table, name);
+    }
+}
+
+int aggregateSlot(std::string_view name)
+{
+    return assignSlot(aggregateNames(), name, MAX_AGGREGATE_NAMES);
+}
+
+int findAggregateSlot(std::string_view name)
+{
+    return findSlot(aggregateNames(), name);
+}
+
+int pipelineFieldSlot(std::string_view name)
+{
+    return assignSlot(pipelineFieldNames(), name, MAX_PIPELINE_FIELDS);
+}
+
+int findPipelineFieldSlot(std::string_view name)
+{
+    return findSlot(pipelineFieldNames(), name);
+}
+
+const std::string& symbolName(SymbolId id)
+{
+    static const std::string s_none;
+    if (id < 0) return s_none;
+
+    SymbolTable& table = symbolTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    return id < static_cast<int>(table.names.size()) ? table.names[id] : s_none;
+}
 
 // ============================================================================
 // PARSER CONTEXT IMPLEMENTATION
@@ -59,6 +180,26 @@ ParserContext::ParserContext()
     // Polar coordinates
     registerVariable("radius", DOMAIN_SPATIAL, true);
 
+    // Long-range accelerations from the Barnes-Hut solver (read-only, per object)
+    registerVariable("grav_ax", DOMAIN_SPATIAL, false);
+    registerVariable("grav_ay", DOMAIN_SPATIAL, false);
+    registerVariable("coul_ax", DOMAIN_SPATIAL, false);
+    registerVariable("coul_ay", DOMAIN_SPATIAL, false);
+
+    // SPH fluid accelerations, density and pressure (read-only, per fluid object)
+    registerVariable("sph_ax", DOMAIN_SPATIAL, false);
+    registerVariable("sph_ay", DOMAIN_SPATIAL, false);
+    registerVariable("sph_rho", DOMAIN_SCALAR, false);
+    registerVariable("sph_p", DOMAIN_SCALAR, false);
+
+    // Per-object parameters (constant within a step, set from the host per object)
+    for (int i = 0; i < 8; i++)
+        registerVariable("$" + std::to_string(i), DOMAIN_SCALAR, false);
+
+    // Per-object state registers (start-of-step values, updated by "sK = expr" statements)
+    for (int i = 0; i < MAX_STATE_REGISTERS; i++)
+        registerVariable("s" + std::to_string(i), DOMAIN_SCALAR, false);
+
     // FIXED: Register object types with ALL properties including color
     registerObjectType("p", {
         "x", "y", "vx", "vy", "ax", "ay", "mass", "charge",
@@ -68,31 +209,51 @@ ParserContext::ParserContext()
 }
 void ParserContext::registerVariable(const std::string &name, VariableDomain domain, bool differentiable)
 {
-    m_variables[name] = VariableDef(name, domain, differentiable);
+    SymbolId id = internSymbol(name);
+    m_variables[id] = VariableDef(id, domain, differentiable);
 }
 
 void ParserContext::registerObjectType(const std::string &type, const std::vector<std::string> &properties)
 {
-    m_objectTypes[type] = properties;
+    std::vector<SymbolId>& ids = m_objectTypes[internSymbol(type)];
+    ids.clear();
+    for (const auto &property : properties) ids.push_back(internSymbol(property));
 }
 
-bool ParserContext::isValidVariable(const std::string &name) const
+bool ParserContext::isValidVariable(SymbolId name) const
 {
     return m_variables.find(name) != m_variables.end();
 }
 
-bool ParserContext::isValidDerivativeWRT(const std::string &varName) const
+bool ParserContext::isValidDerivativeWRT(SymbolId varName) const
 {
     auto it = m_variables.find(varName);
     return it != m_variables.end() && it->second.differentiable;
 }
 
-ParserContext::VariableDomain ParserContext::getVariableDomain(const std::string &varName) const
+bool ParserContext::isValidObjectProperty(SymbolId type, SymbolId property) const
+{
+    auto it = m_objectTypes.find(type);
+    if (it == m_objectTypes.end()) return false;
+    return std::find(it->second.begin(), it->second.end(), property) != it->second.end();
+}
+
+ParserContext::VariableDomain ParserContext::getVariableDomain(SymbolId varName) const
 {
     auto it = m_variables.find(varName);
     return it != m_variables.end() ? it->second.domain : DOMAIN_SCALAR;
 }
 
+void ParserContext::registerBinding(SymbolId name)
+{
+    if (!isBinding(name)) m_bindings.push_back(name);
+}
+
+bool ParserContext::isBinding(SymbolId name) const
+{
+    return std::find(m_bindings.begin(), m_bindings.end(), name) != m_bindings.end();
+}
+
 // ============================================================================
 // OPERATOR PRECEDENCE AND ASSOCIATIVITY
 // ============================================================================
@@ -137,11 +298,17 @@ namespace
         {TOKEN_MAX, 2},
         {TOKEN_MOD, 2},
         {TOKEN_ATAN2, 2},
-        {TOKEN_CLAMP, 3}
+        {TOKEN_CLAMP, 3},
+        {TOKEN_TABLE, 2},
+        {TOKEN_FIELD, 3},
+        {TOKEN_IF, 3},
+        {TOKEN_VEC2, 2},
+        {TOKEN_LEN, 1},
+        {TOKEN_DOT, 2}
     };
 
-    // Built-in function mapping
-    const std::unordered_map<std::string, TokenType> s_functionMap = {
+    // Built-in function mapping (the keys are literals, so views of them stay valid)
+    const std::unordered_map<std::string_view, TokenType> s_functionMap = {
         {"sin", TOKEN_SIN}, 
         {"cos", TOKEN_COS}, 
         {"tan", TOKEN_TAN}, 
@@ -162,23 +329,397 @@ namespace
         {"conj", TOKEN_CONJ}, 
         {"arg", TOKEN_ARG}, 
         {"sign", TOKEN_SIGN}, 
-        {"step", TOKEN_STEP}
+        {"step", TOKEN_STEP},
+        {"table", TOKEN_TABLE},
+        {"field", TOKEN_FIELD},
+        {"if", TOKEN_IF}
     };
 
+    // Statement-form functions over vec2 values
+    const std::unordered_map<std::string_view, TokenType> s_vectorFunctionMap = {
+        {"vec2", TOKEN_VEC2},
+        {"len", TOKEN_LEN},
+        {"dot", TOKEN_DOT}
+    };
+
+    // rand()/randn() calls numbered so far in the equation ParseEquation() is parsing
+    thread_local int t_randomSites = 0;
+
+    Token randomSiteToken(bool normal)
+    {
+        if (t_randomSites >= MAX_RANDOM_SITES)
+            throw std::runtime_error("At most " + std::to_string(MAX_RANDOM_SITES) + " rand()/randn() calls per equation");
+        std::string name = std::string(normal ? "randn#" : "rand#") + std::to_string(t_randomSites++);
+        return Token(TOKEN_VARIABLE, internSymbol(name));
+    }
+
+    bool isRandomSite(const Token& token)
+    {
+        return token.type == TOKEN_VARIABLE && symbolName(token.variable).find('#') != std::string::npos;
+    }
+
+    bool isAggregate(const Token& token)
+    {
+        return token.type == TOKEN_VARIABLE && symbolName(token.variable).compare(0, 4, "agg[") == 0;
+    }
+
+    bool isStateRegister(const Token& token)
+    {
+        if (token.type != TOKEN_VARIABLE) return false;
+        const std::string& name = symbolName(token.variable);
+        return name.size() == 2 && name[0] == 's' && name[1] >= '0' && name[1] < '0' + MAX_STATE_REGISTERS;
+    }
+
     // Helper function to trim whitespace
-    std::string trim(const std::string& str) {
+    std::string_view trim(std::string_view str) {
         size_t first = str.find_first_not_of(" \t\n\r");
-        if (first == std::string::npos) return "";
+        if (first == std::string_view::npos) return {};
         size_t last = str.find_last_not_of(" \t\n\r");
         return str.substr(first, last - first + 1);
     }
+
+    // Number literal at the start of a lexeme, like std::stof but without building a string
+    bool parseNumber(std::string_view lexeme, float& value)
+    {
+        char buffer[64];
+        if (lexeme.empty() || lexeme.size() >= sizeof(buffer)) return false;
+        std::memcpy(buffer, lexeme.data(), lexeme.size());
+        buffer[lexeme.size()] = '\0';
+
+        char* end = nullptr;
+        errno = 0;
+        value = std::strtof(buffer, &end);
+        return end != buffer && errno != ERANGE;
+    }
+
+    // pj.property is only meaningful inside a pair reduction, and those cannot be differentiated
+    void rejectPairTokens(const std::vector<Token>& tokens, bool insideDerivative)
+    {
+        for (const auto& token : tokens)
+        {
+            if (token.type == TOKEN_PAIR_REF)
+                throw std::runtime_error("pj." + symbolName(token.object_property) + " is only valid inside sum_j(), nsum() or nmean()");
+            if (token.type == TOKEN_PAIR_SUM && insideDerivative)
+                throw std::runtime_error("sum_j(), nsum(), ncount() and nmean() cannot be used inside D()");
+            if (token.type == TOKEN_DERIVATIVE)
+                rejectPairTokens(token.derivative_expr_tokens, true);
+        }
+    }
+
+    // ------------------------------------------------------------------------
+    // Statement form: vec2 values are split into scalar x/y expressions
+    // ------------------------------------------------------------------------
+
+    // A scalar (parts[0]) or vec2 (parts[0], parts[1]) value, each part in RPN
+    struct TypedValue {
+        bool vector = false;
+        std::vector<Token> parts[2];
+    };
+
+    using BindingMap = std::unordered_map<SymbolId, TypedValue>;
+
+    void appendTokens(std::vector<Token>& out, const std::vector<Token>& tokens)
+    {
+        out.insert(out.end(), tokens.begin(), tokens.end());
+    }
+
+    TypedValue scalarValue(std::vector<Token> tokens)
+    {
+        TypedValue value;
+        value.parts[0] = std::move(tokens);
+        return value;
+    }
+
+    // a op b for each component; a and b are both scalars or both vec2
+    TypedValue componentwise(const TypedValue& a, const TypedValue& b, TokenType op)
+    {
+        TypedValue value;
+        value.vector = a.vector;
+        for (int k = 0; k < (a.vector ? 2 : 1); k++)
+        {
+            appendTokens(value.parts[k], a.parts[k]);
+            appendTokens(value.parts[k], b.parts[k]);
+            value.parts[k].push_back(Token(op));
+        }
+        return value;
+    }
+
+    // Scalar products of two vec2 parts: ax*bx + ay*by
+    std::vector<Token> dotProduct(const TypedValue& a, const TypedValue& b)
+    {
+        std::vector<Token> out;
+        for (int k = 0; k < 2; k++)
+        {
+            appendTokens(out, a.parts[k]);
+            appendTokens(out, b.parts[k]);
+            out.push_back(Token(TOKEN_MUL));
+        }
+        out.push_back(Token(TOKEN_ADD));
+        return out;
+    }
+
+    // Evaluate the types of an RPN expression, substituting bindings and expanding vec2 operations
+    TypedValue expandVectors(const std::vector<Token>& rpn, const BindingMap& bindings)
+    {
+        std::vector<TypedValue> stack;
+        auto pop = [&stack]()
+        {
+            if (stack.empty()) throw std::runtime_error("Malformed expression: missing operand");
+            TypedValue value = std::move(stack.back());
+            stack.pop_back();
+            return value;
+        };
+        auto requireScalar = [](const TypedValue& value, const char* what)
+        {
+            if (value.vector) throw std::runtime_error(std::string(what) + " takes scalars, got a vec2");
+        };
+
+        for (const auto& token : rpn)
+        {
+            switch (token.type)
+            {
+            case TOKEN_BINDING:
+            {
+                auto it = bindings.find(token.variable);
+                if (it == bindings.end()) throw std::runtime_error("Unknown binding: " + symbolName(token.variable));
+                if (token.object_index < 0)
+                {
+                    stack.push_back(it->second);
+                    break;
+                }
+                if (!it->second.vector)
+                    throw std::runtime_error(symbolName(token.variable) + " is a scalar and has no ." +
+                                             (token.object_index == 0 ? "x" : "y"));
+                stack.push_back(scalarValue(it->second.parts[token.object_index]));
+                break;
+            }
+            case TOKEN_DERIVATIVE:
+            {
+                TypedValue body = expandVectors(token.derivative_expr_tokens, bindings);
+                requireScalar(body, "D()");
+                Token derivative = token;
+                derivative.derivative_expr_tokens = std::move(body.parts[0]);
+                stack.push_back(scalarValue({ std::move(derivative) }));
+                break;
+            }
+            case TOKEN_ADD:
+            case TOKEN_SUB:
+            {
+                TypedValue b = pop(), a = pop();
+                if (a.vector != b.vector)
+                    throw std::runtime_error(std::string(token.type == TOKEN_ADD ? "Adding" : "Subtracting") +
+                                             " a scalar and a vec2");
+                stack.push_back(componentwise(a, b, token.type));
+                break;
+            }
+            case TOKEN_MUL:
+            case TOKEN_DIV:
+            {
+                TypedValue b = pop(), a = pop();
+                if (b.vector && (a.vector || token.type == TOKEN_DIV))
+                    throw std::runtime_error(token.type == TOKEN_MUL ? "vec2 * vec2 is ambiguous, use dot()"
+                                                                     : "Cannot divide by a vec2");
+                TypedValue value;
+                value.vector = a.vector || b.vector;
+                for (int k = 0; k < (value.vector ? 2 : 1); k++)
+                {
+                    appendTokens(value.parts[k], a.parts[a.vector ? k : 0]);
+                    appendTokens(value.parts[k], b.parts[b.vector ? k : 0]);
+                    value.parts[k].push_back(Token(token.type));
+                }
+                stack.push_back(std::move(value));
+                break;
+            }
+            case TOKEN_NEG:
+            {
+                TypedValue value = pop();
+                for (int k = 0; k < (value.vector ? 2 : 1); k++) value.parts[k].push_back(Token(TOKEN_NEG));
+                stack.push_back(std::move(value));
+                break;
+            }
+            case TOKEN_VEC2:
+            {
+                TypedValue y = pop(), x = pop();
+                requireScalar(x, "vec2()");
+                requireScalar(y, "vec2()");
+                TypedValue value;
+                value.vector = true;
+                value.parts[0] = std::move(x.parts[0]);
+                value.parts[1] = std::move(y.parts[0]);
+                stack.push_back(std::move(value));
+                break;
+            }
+            case TOKEN_LEN:
+            {
+                TypedValue v = pop();
+                if (!v.vector) throw std::runtime_error("len() takes a vec2");
+                std::vector<Token> out = dotProduct(v, v);
+                out.push_back(Token(TOKEN_SQRT));
+                stack.push_back(scalarValue(std::move(out)));
+                break;
+            }
+            case TOKEN_DOT:
+            {
+                TypedValue b = pop(), a = pop();
+                if (!a.vector || !b.vector) throw std::runtime_error("dot() takes two vec2 values");
+                stack.push_back(scalarValue(dotProduct(a, b)));
+                break;
+            }
+            case TOKEN_IF:
+            {
+                // Each component branches on its own copy of the condition; the optimizer shares it
+                TypedValue b = pop(), a = pop(), condition = pop();
+                requireScalar(condition, "The condition of if()");
+                if (a.vector != b.vector) throw std::runtime_error("if() branches must both be scalars or both vec2");
+                TypedValue value;
+                value.vector = a.vector;
+                for (int k = 0; k < (a.vector ? 2 : 1); k++)
+                {
+                    appendTokens(value.parts[k], condition.parts[0]);
+                    appendTokens(value.parts[k], a.parts[k]);
+                    appendTokens(value.parts[k], b.parts[k]);
+                    value.parts[k].push_back(Token(TOKEN_IF));
+                }
+                stack.push_back(std::move(value));
+                break;
+            }
+            default:
+            {
+                // Everything else is scalar: operands push themselves, functions and ^ consume scalars
+                auto arity = s_functionArity.find(token.type);
+                int count = token.type == TOKEN_POW ? 2 : (arity != s_functionArity.end() ? arity->second : 0);
+                if (static_cast<int>(stack.size()) < count)
+                    throw std::runtime_error("Malformed expression: missing operand");
+
+                std::vector<Token> out;
+                for (size_t k = stack.size() - count; k < stack.size(); k++)
+                {
+                    requireScalar(stack[k], token.type == TOKEN_POW ? "^" : "This function");
+                    appendTokens(out, stack[k].parts[0]);
+                }
+                stack.resize(stack.size() - count);
+                out.push_back(token);
+                stack.push_back(scalarValue(std::move(out)));
+                break;
+            }
+            }
+        }
+
+        if (stack.size() != 1) throw std::runtime_error("Malformed expression");
+        return std::move(stack.back());
+    }
+
+    bool isIdentifier(std::string_view name)
+    {
+        if (name.empty() || !(std::isalpha(static_cast<unsigned char>(name[0])) || name[0] == '_')) return false;
+        return std::all_of(name.begin(), name.end(), [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; });
+    }
+
+    // Names a let binding cannot take: functions and the words the tokenizer gives a meaning of their own
+    bool isReservedName(std::string_view name)
+    {
+        static const std::set<std::string_view> reserved = {
+            "let", "pos", "vel", "p", "pj", "D", "sum_j", "nsum", "ncount", "nmean", "rand", "randn"
+        };
+        return reserved.count(name) || s_functionMap.count(name) || s_vectorFunctionMap.count(name);
+    }
+
+    // Parse the statement form into the components of result
+    void parseStatements(std::string_view equation, const ParserContext& context, ParsedEquation& result)
+    {
+        ParserContext statementContext = context;
+        statementContext.setVectorsEnabled(true);
+        BindingMap bindings;
+
+        // Split on ';' and newlines outside parentheses
+        std::vector<std::string_view> statements;
+        size_t start = 0;
+        int depth = 0;
+        for (size_t pos = 0; pos <= equation.length(); pos++)
+        {
+            char c = pos < equation.length() ? equation[pos] : ';';
+            if (c == '(') depth++;
+            else if (c == ')') depth--;
+            else if ((c == ';' || c == '\n') && depth <= 0)
+            {
+                std::string_view statement = trim(equation.substr(start, pos - start));
+                if (!statement.empty()) statements.push_back(statement);
+                start = pos + 1;
+            }
+        }
+
+        struct Target { std::string name; std::vector<Token>* x; std::vector<Token>* y; bool state = false; };
+        std::vector<Target> targets = {
+            {"a", &result.tokens_ax, &result.tokens_ay},
+            {"ax", &result.tokens_ax, nullptr},
+            {"ay", &result.tokens_ay, nullptr},
+            {"angular", &result.tokens_angular, nullptr},
+            {"color.r", &result.tokens_r, nullptr},
+            {"color.g", &result.tokens_g, nullptr},
+            {"color.b", &result.tokens_b, nullptr},
+            {"color.a", &result.tokens_a, nullptr},
+            {"logp", &result.tokens_ax, nullptr},  // Log-density of a Metropolis chain (metropolis.h)
+        };
+        for (int k = 0; k < MAX_STATE_REGISTERS; k++)
+            targets.push_back({"s" + std::to_string(k), &result.tokens_state[k], nullptr, true});
+        std::set<const std::vector<Token>*> assigned;
+
+        for (std::string_view statement : statements)
+        {
+            size_t equals = statement.find('=');
+            if (equals == std::string_view::npos)
+                throw std::runtime_error("Expected 'target = expr' or 'let name = expr': " + std::string(statement));
+
+            std::string_view lhs = trim(statement.substr(0, equals));
+            std::string_view rhs = trim(statement.substr(equals + 1));
+            if (rhs.empty()) throw std::runtime_error("Missing expression in: " + std::string(statement));
+
+            bool isLet = lhs.size() > 3 && lhs.compare(0, 3, "let") == 0 && std::isspace(static_cast<unsigned char>(lhs[3]));
+            if (isLet)
+            {
+                std::string_view name = trim(lhs.substr(3));
+                if (!isIdentifier(name)) throw std::runtime_error("Invalid binding name: " + std::string(name));
+                if (isReservedName(name) || context.isValidVariable(findSymbol(name)))
+                    throw std::runtime_error("Cannot bind '" + std::string(name) + "', the name is already taken");
+
+                SymbolId id = internSymbol(name);
+                if (statementContext.isBinding(id)) throw std::runtime_error("'" + std::string(name) + "' is bound twice");
+
+                // Parsed before the name is registered, so a binding cannot refer to itself
+                bindings[id] = expandVectors(infixToRPN(tokenizeExpression(rhs, statementContext)), bindings);
+                statementContext.registerBinding(id);
+                continue;
+            }
+
+            const Target* target = nullptr;
+            for (const auto& candidate : targets)
+                if (lhs == candidate.name) target = &candidate;
+            if (!target) throw std::runtime_error("Unknown assignment target: " + std::string(lhs));
+
+            TypedValue value = expandVectors(infixToRPN(tokenizeExpression(rhs, statementContext)), bindings);
+            // Pair reductions are summed before integration, for the components only
+            if (target->state && std::any_of(value.parts[0].begin(), value.parts[0].end(),
+                                           [](const Token& token) { return token.type == TOKEN_PAIR_SUM; }))
+                throw std::runtime_error("sum_j/nsum/ncount/nmean are not supported in the update of " + target->name);
+            if (value.vector != (target->y != nullptr))
+                throw std::runtime_error(target->name + (value.vector ? " is a scalar, got a vec2" : " is a vec2, got a scalar"));
+
+            for (int k = 0; k < (value.vector ? 2 : 1); k++)
+            {
+                std::vector<Token>* component = k == 0 ? target->x : target->y;
+                if (!assigned.insert(component).second)
+                    throw std::runtime_error("A component is assigned twice (at '" + std::string(lhs) + "')");
+                *component = std::move(value.parts[k]);
+            }
+        }
+    }
 }
 
 // ============================================================================
 // DERIVATIVE PARSER
 // ============================================================================
 
-std::vector<Token> parseDerivativeCall(const std::string &expression, size_t start_pos, size_t &end_pos, const ParserContext &context)
+std::vector<Token> parseDerivativeCall(std::string_view expression, size_t start_pos, size_t &end_pos, const ParserContext &context)
 {
     if (start_pos + 1 >= expression.length() || expression.substr(start_pos, 2) != "D(")
     {
@@ -187,35 +728,24 @@ std::vector<Token> parseDerivativeCall(const std::string &expression, size_t sta
 
     size_t pos = start_pos + 2;
     int paren_depth = 1;
-    std::string expr_str;
-    std::string wrt_var;
     int order = 1;
 
-    // Parse the expression inside D(...)
+    // Find the end of the expression inside D(...)
     while (pos < expression.length() && paren_depth > 0)
     {
         char c = expression[pos];
         if (c == '(')
         {
             paren_depth++;
-            expr_str += c;
         }
         else if (c == ')')
         {
             paren_depth--;
-            if (paren_depth > 0)
-            {
-                expr_str += c;
-            }
         }
         else if (paren_depth == 1 && c == ',')
         {
             break; // Found separator between expression and variable
         }
-        else
-        {
-            expr_str += c;
-        }
         pos++;
     }
 
@@ -223,6 +753,7 @@ std::vector<Token> parseDerivativeCall(const std::string &expression, size_t sta
     {
         throw std::runtime_error("Unclosed derivative call");
     }
+    std::string_view expr_str = expression.substr(start_pos + 2, pos - start_pos - 2);
 
     // Parse the with-respect-to variable
     pos++; // Skip comma
@@ -234,15 +765,13 @@ std::vector<Token> parseDerivativeCall(const std::string &expression, size_t sta
     {
         pos++;
     }
-    wrt_var = expression.substr(var_start, pos - var_start);
-
-    // Trim whitespace
-    wrt_var = trim(wrt_var);
+    std::string_view wrt_var = trim(expression.substr(var_start, pos - var_start));
 
     // Validate the variable exists and is differentiable
-    if (!context.isValidDerivativeWRT(wrt_var))
+    SymbolId wrt = findSymbol(wrt_var);
+    if (!context.isValidDerivativeWRT(wrt))
     {
-        throw std::runtime_error("Cannot take derivative with respect to: " + wrt_var);
+        throw std::runtime_error("Cannot take derivative with respect to: " + std::string(wrt_var));
     }
 
     // Parse optional order
@@ -257,20 +786,12 @@ std::vector<Token> parseDerivativeCall(const std::string &expression, size_t sta
         {
             pos++;
         }
-        std::string order_str = expression.substr(order_start, pos - order_start);
-        order_str = trim(order_str);
+        std::string_view order_str = trim(expression.substr(order_start, pos - order_start));
 
-        try
+        auto parsed = std::from_chars(order_str.data(), order_str.data() + order_str.size(), order);
+        if (parsed.ec != std::errc() || parsed.ptr != order_str.data() + order_str.size() || order < 1 || order > 4)
         {
-            order = std::stoi(order_str);
-            if (order < 1 || order > 4)
-            {
-                throw std::runtime_error("Derivative order must be between 1 and 4");
-            }
-        }
-        catch (...)
-        {
-            throw std::runtime_error("Invalid derivative order: " + order_str);
+            throw std::runtime_error("Invalid derivative order: " + std::string(order_str));
         }
     }
 
@@ -282,67 +803,225 @@ std::vector<Token> parseDerivativeCall(const std::string &expression, size_t sta
     end_pos = pos;
 
     // Parse the expression to differentiate
-    auto expr_tokens = tokenizeExpression(expr_str, context);
-    auto rpn_expr = infixToRPN(expr_tokens);
-
-    // Create NUMERICAL derivative instruction token
+    // Create derivative instruction token; ExpandSymbolicDerivatives() settles the method
+    // the GPU actually gets
     Token deriv_token(TOKEN_DERIVATIVE);
-    deriv_token.derivative_wrt = wrt_var;
+    deriv_token.derivative_wrt = wrt;
     deriv_token.derivative_order = order;
-    deriv_token.derivative_method = DERIV_METHOD_NUMERICAL;
-    deriv_token.derivative_expr_tokens = rpn_expr;
+    deriv_token.derivative_method = context.getDerivativeMethod();
+    deriv_token.derivative_expr_tokens = infixToRPN(tokenizeExpression(expr_str, context));
 
     std::vector<Token> result;
-    result.push_back(deriv_token);
+    result.push_back(std::move(deriv_token));
 
     return result;
 }
 
+// ============================================================================
+// PAIR SUM PARSER
+// ============================================================================
+
+Token parsePairSumCall(std::string_view expression, size_t start_pos, size_t &end_pos, const ParserContext &context,
+                       const std::string &function)
+{
+    if (start_pos >= expression.length() || expression[start_pos] != '(')
+    {
+        throw std::runtime_error("Invalid pair sum syntax: expected '" + function + "('");
+    }
+
+    // Find the matching closing parenthesis and the first top-level comma
+    size_t pos = start_pos + 1;
+    size_t comma_pos = std::string_view::npos;
+    int paren_depth = 1;
+    while (pos < expression.length())
+    {
+        if (expression[pos] == '(') paren_depth++;
+        else if (expression[pos] == ')' && --paren_depth == 0) break;
+        else if (expression[pos] == ',' && paren_depth == 1 && comma_pos == std::string_view::npos) comma_pos = pos;
+        pos++;
+    }
+
+    if (pos >= expression.length())
+    {
+        throw std::runtime_error("Unclosed " + function + " call");
+    }
+    end_pos = pos;
+
+    Token pair_token(TOKEN_PAIR_SUM);
+    std::string_view expr_str = trim(expression.substr(start_pos + 1, pos - start_pos - 1));
+
+    // Neighbour reductions take a fixed radius first; it sizes the neighbour grid on the CPU
+    if (function != "sum_j")
+    {
+        bool takesExpr = function != "ncount";
+        std::string_view radius_str = expr_str;
+        expr_str = {};
+        if (comma_pos != std::string_view::npos)
+        {
+            radius_str = trim(expression.substr(start_pos + 1, comma_pos - start_pos - 1));
+            expr_str = trim(expression.substr(comma_pos + 1, pos - comma_pos - 1));
+            if (!takesExpr) throw std::runtime_error("ncount takes only a radius: ncount(radius)");
+        }
+        if (takesExpr && expr_str.empty())
+        {
+            throw std::runtime_error(function + " needs a radius and an expression: " + function + "(radius, expr)");
+        }
+
+        auto radius_tokens = tokenizeExpression(radius_str, context);
+        if (radius_tokens.size() != 1 || radius_tokens[0].type != TOKEN_NUMBER || !(radius_tokens[0].numeric_value > 0.0f))
+        {
+            throw std::runtime_error(function + " radius must be a positive number, got '" + std::string(radius_str) + "'");
+        }
+
+        pair_token.pair_radius = radius_tokens[0].numeric_value;
+        pair_token.pair_reduction = (function == "ncount") ? PAIR_REDUCE_COUNT
+                                  : (function == "nmean") ? PAIR_REDUCE_MEAN
+                                  : PAIR_REDUCE_SUM;
+        if (!takesExpr) return pair_token;
+    }
+    else if (expr_str.empty())
+    {
+        throw std::runtime_error("sum_j needs an expression");
+    }
+
+    // The body runs once per object pair in the pair pass, which evaluates real values only
+    static const SymbolId imaginary = internSymbol("i");
+    auto expr_tokens = infixToRPN(tokenizeExpression(expr_str, context));
+    for (const auto &token : expr_tokens)
+    {
+        if (token.type == TOKEN_PAIR_SUM) throw std::runtime_error(function + "() cannot be nested");
+        if (token.type == TOKEN_DERIVATIVE) throw std::runtime_error("D() is not supported inside " + function + "()");
+        if (token.type == TOKEN_OBJECT_REF)
+            throw std::runtime_error("p[i] references are not supported inside " + function + "(), use pj");
+        if (token.type == TOKEN_VARIABLE && token.variable == imaginary)
+            throw std::runtime_error("Complex values are not supported inside " + function + "()");
+        if (isRandomSite(token))
+            throw std::runtime_error("rand() and randn() are not supported inside " + function + "()");
+        if (token.type == TOKEN_TABLE || token.type == TOKEN_FIELD)
+            throw std::runtime_error("table() and field() are not supported inside " + function + "()");
+        if (isStateRegister(token))
+            throw std::runtime_error("State registers are not supported inside " + function + "()");
+        if (isAggregate(token))
+            throw std::runtime_error("agg[] is not supported inside " + function + "()");
+        if (token.type == TOKEN_BINDING || token.type == TOKEN_VEC2 || token.type == TOKEN_LEN || token.type == TOKEN_DOT)
+            throw std::runtime_error("let bindings and vec2 values are not supported inside " + function + "()");
+    }
+
+    pair_token.pair_expr_tokens = std::move(expr_tokens);
+    return pair_token;
+}
+
 // ============================================================================
 // TOKENIZER
 // ============================================================================
 
-std::vector<Token> tokenizeExpression(const std::string &expression, const ParserContext &context)
+std::vector<Token> tokenizeExpression(std::string_view expression, const ParserContext &context)
 {
+    static const SymbolId objectType = internSymbol("p");
+
     std::vector<Token> tokens;
-    std::string currentLexeme;
+    tokens.reserve(expression.length() / 2 + 1);
+
+    // vec2(x, y) in infix, for the vector names of the statement form
+    auto pushVec2 = [&tokens](Token x, Token y)
+    {
+        tokens.push_back(Token(TOKEN_VEC2));
+        tokens.push_back(Token(TOKEN_OPEN_PAREN));
+        tokens.push_back(std::move(x));
+        tokens.push_back(Token(TOKEN_COMMA));
+        tokens.push_back(std::move(y));
+        tokens.push_back(Token(TOKEN_CLOSE_PAREN));
+    };
+
+    // Lexemes are runs of the expression itself, so they are views rather than built strings
+    std::string_view currentLexeme;
+    auto extendLexeme = [&](size_t i)
+    {
+        currentLexeme = currentLexeme.empty() ? expression.substr(i, 1)
+                                              : std::string_view(currentLexeme.data(), currentLexeme.size() + 1);
+    };
 
     auto flushLexeme = [&]()
     {
         if (currentLexeme.empty())
             return;
 
+        std::string_view lexeme = currentLexeme;
+        currentLexeme = {};
+
         // Check if it's a function
-        auto funcIt = s_functionMap.find(currentLexeme);
+        auto funcIt = s_functionMap.find(lexeme);
         if (funcIt != s_functionMap.end())
         {
             tokens.push_back(Token(funcIt->second));
-            currentLexeme.clear();
             return;
         }
 
-        // Check if it's a known variable
-        if (context.isValidVariable(currentLexeme))
+        // Statement form: vec2 functions, pos/vel and let names (name, name.x, name.y)
+        if (context.vectorsEnabled())
         {
-            tokens.push_back(Token(TOKEN_VARIABLE, currentLexeme));
-            currentLexeme.clear();
+            auto vecIt = s_vectorFunctionMap.find(lexeme);
+            if (vecIt != s_vectorFunctionMap.end())
+            {
+                tokens.push_back(Token(vecIt->second));
+                return;
+            }
+            if (lexeme == "pos" || lexeme == "vel")
+            {
+                pushVec2(Token(TOKEN_VARIABLE, internSymbol(lexeme == "pos" ? "x" : "vx")),
+                         Token(TOKEN_VARIABLE, internSymbol(lexeme == "pos" ? "y" : "vy")));
+                return;
+            }
+
+            int component = -1;
+            std::string_view name = lexeme;
+            if (name.size() > 2 && (name.substr(name.size() - 2) == ".x" || name.substr(name.size() - 2) == ".y"))
+            {
+                component = name.back() == 'x' ? 0 : 1;
+                name.remove_suffix(2);
+            }
+            SymbolId binding = findSymbol(name);
+            if (context.isBinding(binding))
+            {
+                Token bindingToken(TOKEN_BINDING, binding);
+                bindingToken.object_index = component;
+                tokens.push_back(std::move(bindingToken));
+                return;
+            }
+        }
+
+        // Check if it's a pair reference (pj.x inside sum_j)
+        if (lexeme.compare(0, 3, "pj.") == 0)
+        {
+            SymbolId property = findSymbol(lexeme.substr(3));
+            if (!context.isValidObjectProperty(objectType, property))
+            {
+                throw std::runtime_error("Unknown pair property: " + std::string(lexeme));
+            }
+            Token pairToken(TOKEN_PAIR_REF);
+            pairToken.object_type = objectType;
+            pairToken.object_property = property;
+            tokens.push_back(std::move(pairToken));
             return;
         }
 
-        // Check if it's a number
-        try
+        // Check if it's a known variable; every one was interned when it was registered
+        SymbolId variable = findSymbol(lexeme);
+        if (context.isValidVariable(variable))
         {
-            float value = std::stof(currentLexeme);
-            tokens.push_back(Token(TOKEN_NUMBER, value));
-            currentLexeme.clear();
+            tokens.push_back(Token(TOKEN_VARIABLE, variable));
             return;
         }
-        catch (...)
+
+        // Check if it's a number
+        float value;
+        if (parseNumber(lexeme, value))
         {
-            // Not a number
+            tokens.push_back(Token(TOKEN_NUMBER, value));
+            return;
         }
 
-        throw std::runtime_error("Unknown token: " + currentLexeme);
+        throw std::runtime_error("Unknown token: " + std::string(lexeme));
     };
 
     for (size_t i = 0; i < expression.length(); ++i)
@@ -355,19 +1034,87 @@ std::vector<Token> tokenizeExpression(const std::string &expression, const Parse
             continue;
         }
 
+        // The identifier in agg[name] / fld[name] starting at i; i is left on the closing bracket
+        auto bracketName = [&](size_t& i, const char* form, const char* what)
+        {
+            size_t bracketEnd = expression.find(']', i + 4);
+            if (bracketEnd == std::string_view::npos)
+            {
+                throw std::runtime_error(std::string("Unclosed bracket in ") + form);
+            }
+
+            std::string_view name = trim(expression.substr(i + 4, bracketEnd - i - 4));
+            bool identifier = !name.empty() && !std::isdigit(static_cast<unsigned char>(name[0]));
+            for (char ch : name)
+                identifier = identifier && (std::isalnum(static_cast<unsigned char>(ch)) || ch == '_');
+            if (!identifier)
+            {
+                throw std::runtime_error(std::string("Invalid ") + what + " name: " + std::string(name));
+            }
+            i = bracketEnd;
+            return name;
+        };
+        bool wordStart = i == 0 || !(std::isalnum(static_cast<unsigned char>(expression[i - 1])) || expression[i - 1] == '_');
+
+        // Handle group aggregates (agg[name])
+        if (c == 'a' && expression.compare(i, 4, "agg[") == 0 && wordStart)
+        {
+            flushLexeme();
+
+            int slot = aggregateSlot(bracketName(i, "agg[]", "aggregate"));
+            if (slot < 0)
+            {
+                throw std::runtime_error("At most " + std::to_string(MAX_AGGREGATE_NAMES) + " aggregate names");
+            }
+            tokens.push_back(Token(TOKEN_VARIABLE, internSymbol("agg[" + std::to_string(slot) + "]")));
+            continue;
+        }
+
+        // Handle pipeline fields (fld[name], and pj.fld[name] of the neighbour inside nsum())
+        if (c == 'f' && expression.compare(i, 4, "fld[") == 0 && (wordStart || currentLexeme == "pj."))
+        {
+            bool pair = currentLexeme == "pj.";
+            if (pair) currentLexeme = {};
+            else flushLexeme();
+
+            int slot = pipelineFieldSlot(bracketName(i, "fld[]", "field"));
+            if (slot < 0)
+            {
+                throw std::runtime_error("At most " + std::to_string(MAX_PIPELINE_FIELDS) + " pipeline fields");
+            }
+            SymbolId field = internSymbol("fld[" + std::to_string(slot) + "]");
+            if (pair)
+            {
+                Token pairToken(TOKEN_PAIR_REF);
+                pairToken.object_type = objectType;
+                pairToken.object_property = field;
+                tokens.push_back(std::move(pairToken));
+            }
+            else
+            {
+                tokens.push_back(Token(TOKEN_VARIABLE, field));
+            }
+            continue;
+        }
+
         // Handle object references (p[0].x)
         if (c == 'p' && i + 1 < expression.length() && expression[i + 1] == '[')
         {
             flushLexeme();
 
             size_t bracketEnd = expression.find(']', i + 2);
-            if (bracketEnd == std::string::npos)
+            if (bracketEnd == std::string_view::npos)
             {
                 throw std::runtime_error("Unclosed bracket in object reference");
             }
 
-            std::string indexStr = expression.substr(i + 2, bracketEnd - i - 2);
-            int index = std::stoi(indexStr);
+            std::string_view indexStr = trim(expression.substr(i + 2, bracketEnd - i - 2));
+            int index = 0;
+            auto parsed = std::from_chars(indexStr.data(), indexStr.data() + indexStr.size(), index);
+            if (parsed.ec != std::errc() || parsed.ptr != indexStr.data() + indexStr.size())
+            {
+                throw std::runtime_error("Invalid object index: " + std::string(indexStr));
+            }
 
             if (bracketEnd + 1 >= expression.length() || expression[bracketEnd + 1] != '.')
             {
@@ -381,13 +1128,33 @@ std::vector<Token> tokenizeExpression(const std::string &expression, const Parse
                 propEnd++;
             }
 
-            std::string property = expression.substr(propStart, propEnd - propStart);
+            std::string_view propertyName = expression.substr(propStart, propEnd - propStart);
+            if (context.vectorsEnabled() && (propertyName == "pos" || propertyName == "vel"))
+            {
+                Token components[2];
+                for (int k = 0; k < 2; k++)
+                {
+                    components[k].type = TOKEN_OBJECT_REF;
+                    components[k].object_type = objectType;
+                    components[k].object_index = index;
+                    components[k].object_property = internSymbol(propertyName == "pos" ? (k ? "y" : "x") : (k ? "vy" : "vx"));
+                }
+                pushVec2(std::move(components[0]), std::move(components[1]));
+                i = propEnd - 1;
+                continue;
+            }
+
+            SymbolId property = findSymbol(propertyName);
+            if (!context.isValidObjectProperty(objectType, property))
+            {
+                throw std::runtime_error("Unknown object property: " + std::string(propertyName));
+            }
 
             Token objToken(TOKEN_OBJECT_REF);
-            objToken.object_type = "p";
+            objToken.object_type = objectType;
             objToken.object_index = index;
             objToken.object_property = property;
-            tokens.push_back(objToken);
+            tokens.push_back(std::move(objToken));
 
             i = propEnd - 1;
             continue;
@@ -399,7 +1166,7 @@ std::vector<Token> tokenizeExpression(const std::string &expression, const Parse
             // Make sure D is not part of a larger identifier
             if (i > 0 && (std::isalnum(expression[i - 1]) || expression[i - 1] == '_'))
             {
-                currentLexeme += c;
+                extendLexeme(i);
                 continue;
             }
 
@@ -424,10 +1191,12 @@ std::vector<Token> tokenizeExpression(const std::string &expression, const Parse
                     tokens.push_back(Token(TOKEN_OPEN_PAREN));
                     tokens.push_back(Token(TOKEN_NUMBER, 0.0f));
                     tokens.push_back(Token(TOKEN_SUB));  // SUB goes between 0 and D
-                    tokens.insert(tokens.end(), derivative_tokens.begin(), derivative_tokens.end());
+                    tokens.insert(tokens.end(), std::make_move_iterator(derivative_tokens.begin()),
+                                  std::make_move_iterator(derivative_tokens.end()));
                     tokens.push_back(Token(TOKEN_CLOSE_PAREN));
                 } else {
-                    tokens.insert(tokens.end(), derivative_tokens.begin(), derivative_tokens.end());
+                    tokens.insert(tokens.end(), std::make_move_iterator(derivative_tokens.begin()),
+                                  std::make_move_iterator(derivative_tokens.end()));
                 }
                 
                 i = end_pos;
@@ -439,6 +1208,38 @@ std::vector<Token> tokenizeExpression(const std::string &expression, const Parse
             }
         }
 
+        // Handle pair reductions sum_j(expr), nsum(radius, expr), ncount(radius), nmean(radius, expr)
+        if (c == '(' && (currentLexeme == "sum_j" || currentLexeme == "nsum" ||
+                         currentLexeme == "ncount" || currentLexeme == "nmean"))
+        {
+            std::string function(currentLexeme);
+            currentLexeme = {};
+            try
+            {
+                size_t end_pos;
+                tokens.push_back(parsePairSumCall(expression, i, end_pos, context, function));
+                i = end_pos;
+                continue;
+            }
+            catch (const std::exception &e)
+            {
+                throw std::runtime_error(std::string("Pair sum parsing failed: ") + e.what());
+            }
+        }
+
+        // rand() / randn(): each call reads its own stream of the generator
+        if (c == '(' && (currentLexeme == "rand" || currentLexeme == "randn"))
+        {
+            size_t close = expression.find_first_not_of(" \t\n\r", i + 1);
+            if (close == std::string_view::npos || expression[close] != ')')
+                throw std::runtime_error(std::string(currentLexeme) + "() takes no arguments");
+            bool normal = currentLexeme == "randn";
+            currentLexeme = {};
+            tokens.push_back(randomSiteToken(normal));
+            i = close;
+            continue;
+        }
+
         // Handle operators and punctuation
         if (c == '+' || c == '-' || c == '*' || c == '/' || c == '^' ||
             c == '(' || c == ')' || c == ',')
@@ -486,7 +1287,7 @@ std::vector<Token> tokenizeExpression(const std::string &expression, const Parse
         }
         else
         {
-            currentLexeme += c;
+            extendLexeme(i);
         }
     }
 
@@ -502,12 +1303,16 @@ std::vector<Token> infixToRPN(const std::vector<Token> &infixTokens)
 {
     std::vector<Token> output;
     std::vector<Token> stack;
+    output.reserve(infixTokens.size());
+    stack.reserve(infixTokens.size());
 
     for (const auto &token : infixTokens)
     {
         // Operands go directly to output
         if (token.type == TOKEN_NUMBER || token.type == TOKEN_VARIABLE ||
-            token.type == TOKEN_OBJECT_REF || token.type == TOKEN_DERIVATIVE)
+            token.type == TOKEN_OBJECT_REF || token.type == TOKEN_DERIVATIVE ||
+            token.type == TOKEN_PAIR_REF || token.type == TOKEN_PAIR_SUM ||
+            token.type == TOKEN_BINDING)
         {
             output.push_back(token);
         }
@@ -618,87 +1423,123 @@ std::vector<Token> infixToRPN(const std::vector<Token> &infixTokens)
 // MAIN PARSER FUNCTION (EXTENDED FOR ROTATION AND COLOR)
 // ============================================================================
 
-ParsedEquation ParseEquation(const std::string &equation_string, const ParserContext &context)
+// Top-level comma separated expressions, commas inside parentheses kept
+static std::vector<std::string_view> splitComponents(std::string_view equation)
 {
-    ParsedEquation result;
-
-    // Smart comma splitting that respects parentheses
-    std::vector<std::string> expressions;
-    std::string current;
+    std::vector<std::string_view> expressions;
+    size_t start = 0;
     int depth = 0;
-    
-    for (char c : equation_string) {
+
+    for (size_t pos = 0; pos < equation.length(); pos++) {
+        char c = equation[pos];
         if (c == '(') {
             depth++;
-            current += c;
         }
         else if (c == ')') {
             depth--;
-            current += c;
         }
         else if (c == ',' && depth == 0) {
             // Only split on commas at depth 0 (top-level commas between components)
-            expressions.push_back(trim(current));
-            current.clear();
-        }
-        else {
-            current += c;
+            expressions.push_back(trim(equation.substr(start, pos - start)));
+            start = pos + 1;
         }
     }
-    
+
     // Don't forget the last expression
-    if (!current.empty()) {
-        expressions.push_back(trim(current));
+    if (start < equation.length()) {
+        expressions.push_back(trim(equation.substr(start)));
     }
+    return expressions;
+}
 
-    // Parse AX expression (required)
-    if (expressions.size() > 0 && !expressions[0].empty())
-    {
-        auto tokens = tokenizeExpression(expressions[0], context);
-        result.tokens_ax = infixToRPN(tokens);
-    }
+ParsedEquation ParseEquation(const std::string &equation_string, const ParserContext &context)
+{
+    ParsedEquation result;
+    std::string_view equation(equation_string);
+    t_randomSites = 0;
 
-    // Parse AY expression (required)
-    if (expressions.size() > 1 && !expressions[1].empty())
+    // Statements ("let d = ...; a = ...") assign the components by name; otherwise they are
+    // comma separated in order
+    if (equation.find('=') != std::string_view::npos)
     {
-        auto tokens = tokenizeExpression(expressions[1], context);
-        result.tokens_ay = infixToRPN(tokens);
+        parseStatements(equation, context, result);
     }
-
-    // Parse Angular Acceleration (optional)
-    if (expressions.size() > 2 && !expressions[2].empty())
+    else
     {
-        auto tokens = tokenizeExpression(expressions[2], context);
-        result.tokens_angular = infixToRPN(tokens);
-    }
+        // Smart comma splitting that respects parentheses
+        std::vector<std::string_view> expressions = splitComponents(equation);
 
-    // Parse Color R (optional)
-    if (expressions.size() > 3 && !expressions[3].empty())
-    {
-        auto tokens = tokenizeExpression(expressions[3], context);
-        result.tokens_r = infixToRPN(tokens);
-    }
+        // Parse AX expression (required)
+        if (expressions.size() > 0 && !expressions[0].empty())
+        {
+            auto tokens = tokenizeExpression(expressions[0], context);
+            result.tokens_ax = infixToRPN(tokens);
+        }
 
-    // Parse Color G (optional)
-    if (expressions.size() > 4 && !expressions[4].empty())
-    {
-        auto tokens = tokenizeExpression(expressions[4], context);
-        result.tokens_g = infixToRPN(tokens);
-    }
+        // Parse AY expression (required)
+        if (expressions.size() > 1 && !expressions[1].empty())
+        {
+            auto tokens = tokenizeExpression(expressions[1], context);
+            result.tokens_ay = infixToRPN(tokens);
+        }
 
-    // Parse Color B (optional)
-    if (expressions.size() > 5 && !expressions[5].empty())
-    {
-        auto tokens = tokenizeExpression(expressions[5], context);
-        result.tokens_b = infixToRPN(tokens);
+        // Parse Angular Acceleration (optional)
+        if (expressions.size() > 2 && !expressions[2].empty())
+        {
+            auto tokens = tokenizeExpression(expressions[2], context);
+            result.tokens_angular = infixToRPN(tokens);
+        }
+
+        // Parse Color R (optional)
+        if (expressions.size() > 3 && !expressions[3].empty())
+        {
+            auto tokens = tokenizeExpression(expressions[3], context);
+            result.tokens_r = infixToRPN(tokens);
+        }
+
+        // Parse Color G (optional)
+        if (expressions.size() > 4 && !expressions[4].empty())
+        {
+            auto tokens = tokenizeExpression(expressions[4], context);
+            result.tokens_g = infixToRPN(tokens);
+        }
+
+        // Parse Color B (optional)
+        if (expressions.size() > 5 && !expressions[5].empty())
+        {
+            auto tokens = tokenizeExpression(expressions[5], context);
+            result.tokens_b = infixToRPN(tokens);
+        }
+
+        // Parse Color A (optional)
+        if (expressions.size() > 6 && !expressions[6].empty())
+        {
+            auto tokens = tokenizeExpression(expressions[6], context);
+            result.tokens_a = infixToRPN(tokens);
+        }
     }
 
-    // Parse Color A (optional)
-    if (expressions.size() > 6 && !expressions[6].empty())
+    FinalizeEquation(result);
+    return result;
+}
+
+void FinalizeEquation(ParsedEquation &result)
+{
+    result.constants.clear();
+
+    // pj is bound only inside sum_j()
+    for (const auto* tokens : { &result.tokens_ax, &result.tokens_ay, &result.tokens_angular,
+                                &result.tokens_r, &result.tokens_g, &result.tokens_b, &result.tokens_a })
     {
-        auto tokens = tokenizeExpression(expressions[6], context);
-        result.tokens_a = infixToRPN(tokens);
+        rejectPairTokens(*tokens, false);
     }
+    for (const auto& tokens : result.tokens_state) rejectPairTokens(tokens, false);
+
+    // D() becomes an ordinary expression, which the optimizer then folds and shares like the rest
+    ExpandSymbolicDerivatives(result);
+
+    // Fold constants and share common subexpressions before the constants are collected
+    OptimizeEquation(result);
 
     // Extract constants from all components
     auto extractConstants = [&result](const std::vector<Token>& tokens) {
@@ -716,6 +1557,18 @@ ParsedEquation ParseEquation(const std::string &equation_string, const ParserCon
     extractConstants(result.tokens_g);
     extractConstants(result.tokens_b);
     extractConstants(result.tokens_a);
+    for (const auto& tokens : result.tokens_state) extractConstants(tokens);
+}
 
-    return result;
+std::vector<std::vector<Token>> ParseExpressionList(const std::string &text, const ParserContext &context)
+{
+    t_randomSites = 0;
+    std::vector<std::vector<Token>> components;
+    for (std::string_view expression : splitComponents(text))
+    {
+        components.push_back(expression.empty() ? std::vector<Token>()
+                                                : infixToRPN(tokenizeExpression(expression, context)));
+        rejectPairTokens(components.back(), false);
+    }
+    return components;
 }
\ No newline at end of file
@@ -0,0 +1,232 @@
+#include "particle_mesh.h"
+#include "broadphase.h"
+#include "long_range.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+
+// Solver passes - MUST MATCH particle_mesh.comp
+enum ParticleMeshPass
+{
+    MESH_PASS_CLEAR = 0,
+    MESH_PASS_BOUNDS = 1,
+    MESH_PASS_DEPOSIT = 2,
+    MESH_PASS_LOAD = 3,
+    MESH_PASS_KERNEL = 4,
+    MESH_PASS_FFT = 5,
+    MESH_PASS_MULTIPLY = 6,
+    MESH_PASS_FORCES = 7
+};
+
+static const GLuint MESH_WORK_GROUP_SIZE = 256;
+static const int MIN_MESH_SIZE = 16;
+static const GLsizeiptr MESH_HEADER_SIZE = 8 * sizeof(GLuint);  // MeshHeader in particle_mesh.comp
+
+// Buffers (the mesh uses the long-range tree's binding points)
+static GLuint g_gridSSBO = 0;     // Complex (mass, charge) mesh, then its potentials
+static GLuint g_kernelSSBO = 0;   // Kernel spectrum
+static GLuint g_depositSSBO = 0;  // Fixed-point cloud-in-cell sums
+static GLuint g_headerSSBO = 0;   // Object bounds and largest |mass|, |charge|
+
+// Mesh settings
+static int g_meshSize = 256;
+static glm::vec4 g_periodicBox(0.0f);
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_passLoc = -1;
+static GLint g_numObjectsLoc = -1;
+static GLint g_meshSizeLoc = -1;
+static GLint g_fftSizeLoc = -1;
+static GLint g_periodicLoc = -1;
+static GLint g_boxLoc = -1;
+static GLint g_fftAxisLoc = -1;
+static GLint g_fftInverseLoc = -1;
+static GLint g_fftKernelLoc = -1;
+static GLint g_gravityConstantLoc = -1;
+static GLint g_coulombConstantLoc = -1;
+static GLint g_softeningLoc = -1;
+
+static GLuint NumBlocks(GLuint numItems)
+{
+    return (std::max(numItems, 1u) + MESH_WORK_GROUP_SIZE - 1) / MESH_WORK_GROUP_SIZE;
+}
+
+static void DispatchPass(int pass, GLuint numItems)
+{
+    glUniform1i(g_passLoc, pass);
+    glDispatchCompute(NumBlocks(numItems), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// 2D transform of the grid or the kernel: every row, then every column, one work group each
+static void DispatchFFT(bool kernel, bool inverse, int fftSize)
+{
+    glUniform1i(g_passLoc, MESH_PASS_FFT);
+    glUniform1i(g_fftKernelLoc, kernel ? 1 : 0);
+    glUniform1i(g_fftInverseLoc, inverse ? 1 : 0);
+    for (int axis = 0; axis < 2; axis++)
+    {
+        glUniform1i(g_fftAxisLoc, axis);
+        glDispatchCompute(static_cast<GLuint>(fftSize), 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+}
+
+static bool IsPowerOfTwo(int n)
+{
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+// ============================================================================
+// Start loading the solver shader; buffers are sized by the first solve
+// ============================================================================
+bool ParticleMesh::Init()
+{
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "particle_mesh.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_passLoc = glGetUniformLocation(program, "uPass");
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_meshSizeLoc = glGetUniformLocation(program, "uMeshSize");
+                g_fftSizeLoc = glGetUniformLocation(program, "uFFTSize");
+                g_periodicLoc = glGetUniformLocation(program, "uPeriodic");
+                g_boxLoc = glGetUniformLocation(program, "uBox");
+                g_fftAxisLoc = glGetUniformLocation(program, "uFFTAxis");
+                g_fftInverseLoc = glGetUniformLocation(program, "uFFTInverse");
+                g_fftKernelLoc = glGetUniformLocation(program, "uFFTKernel");
+                g_gravityConstantLoc = glGetUniformLocation(program, "uGravityConstant");
+                g_coulombConstantLoc = glGetUniformLocation(program, "uCoulombConstant");
+                g_softeningLoc = glGetUniformLocation(program, "uSoftening");
+                g_ready = (g_passLoc != -1 && g_fftSizeLoc != -1 && g_fftAxisLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[ParticleMesh] particle_mesh.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+// ============================================================================
+// Bounds -> deposit -> FFT convolution -> gradient interpolation
+// ============================================================================
+bool ParticleMesh::Compute(GLuint objectSSBO, GLuint accelSSBO, int numObjects,
+                           float gravityConstant, float coulombConstant, float softening)
+{
+    if (!g_ready) return false;
+    if (numObjects <= 0) return false;
+
+    const bool periodic = IsPeriodic();
+    const int fftSize = periodic ? g_meshSize : 2 * g_meshSize;
+    const GLuint cells = static_cast<GLuint>(fftSize * fftSize);
+    const GLuint objectCount = static_cast<GLuint>(numObjects);
+
+    BufferHelpers::EnsureBufferCapacity(g_gridSSBO, cells * 2 * sizeof(float));
+    BufferHelpers::EnsureBufferCapacity(g_kernelSSBO, cells * 2 * sizeof(float));
+    BufferHelpers::EnsureBufferCapacity(g_depositSSBO, cells * 2 * sizeof(GLint));
+    BufferHelpers::EnsureBufferCapacity(g_headerSSBO, MESH_HEADER_SIZE);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glUseProgram(g_program);
+    if (g_numObjectsLoc != -1) glUniform1i(g_numObjectsLoc, numObjects);
+    if (g_meshSizeLoc != -1) glUniform1i(g_meshSizeLoc, g_meshSize);
+    glUniform1i(g_fftSizeLoc, fftSize);
+    if (g_periodicLoc != -1) glUniform1i(g_periodicLoc, periodic ? 1 : 0);
+    if (g_boxLoc != -1) glUniform4f(g_boxLoc, g_periodicBox.x, g_periodicBox.y, g_periodicBox.z, g_periodicBox.w);
+    if (g_gravityConstantLoc != -1) glUniform1f(g_gravityConstantLoc, gravityConstant);
+    if (g_coulombConstantLoc != -1) glUniform1f(g_coulombConstantLoc, coulombConstant);
+    if (g_softeningLoc != -1) glUniform1f(g_softeningLoc, softening);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_IN_BINDING, g_gridSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SORT_OUT_BINDING, g_kernelSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_RADIX_HISTOGRAM_BINDING, g_depositSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BROADPHASE_SCENE_BOUNDS_BINDING, g_headerSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LONG_RANGE_ACCEL_BINDING, accelSSBO);
+
+    DispatchPass(MESH_PASS_CLEAR, cells);
+    DispatchPass(MESH_PASS_BOUNDS, objectCount);
+    DispatchPass(MESH_PASS_DEPOSIT, objectCount);
+    DispatchPass(MESH_PASS_LOAD, cells);
+
+    // The kernel follows the fitted cell size, so it is rebuilt with the mesh each step
+    DispatchPass(MESH_PASS_KERNEL, cells);
+    DispatchFFT(true, false, fftSize);
+    DispatchFFT(false, false, fftSize);
+    DispatchPass(MESH_PASS_MULTIPLY, cells);
+    DispatchFFT(false, true, fftSize);
+    DispatchPass(MESH_PASS_FORCES, objectCount);
+
+    GLuint bindings[] = { 0, BROADPHASE_SORT_IN_BINDING, BROADPHASE_SORT_OUT_BINDING, BROADPHASE_RADIX_HISTOGRAM_BINDING,
+                          BROADPHASE_SCENE_BOUNDS_BINDING, LONG_RANGE_ACCEL_BINDING };
+    for (GLuint binding : bindings) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+    glUseProgram(0);
+    return true;
+}
+
+// ============================================================================
+// Mesh settings
+// ============================================================================
+bool ParticleMesh::SetMesh(int meshSize, const glm::vec4& periodicBox)
+{
+    bool periodic = periodicBox.z > 0.0f || periodicBox.w > 0.0f;
+    if (periodic && !(periodicBox.z > 0.0f && periodicBox.w > 0.0f)) return false;
+    int maxSize = periodic ? PARTICLE_MESH_MAX_FFT_SIZE : PARTICLE_MESH_MAX_FFT_SIZE / 2;
+    if (!IsPowerOfTwo(meshSize) || meshSize < MIN_MESH_SIZE || meshSize > maxSize) return false;
+
+    g_meshSize = meshSize;
+    g_periodicBox = periodic ? periodicBox : glm::vec4(0.0f);
+    return true;
+}
+
+int ParticleMesh::GetMeshSize() { return g_meshSize; }
+glm::vec4 ParticleMesh::GetPeriodicBox() { return g_periodicBox; }
+bool ParticleMesh::IsPeriodic() { return g_periodicBox.z > 0.0f; }
+
+// ============================================================================
+// Release buffers and the solver program
+// ============================================================================
+void ParticleMesh::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    GLuint* buffers[] = { &g_gridSSBO, &g_kernelSSBO, &g_depositSSBO, &g_headerSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+
+    g_meshSize = 256;
+    g_periodicBox = glm::vec4(0.0f);
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void ParticleMesh::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool ParticleMesh::IsReady()
+{
+    return g_ready;
+}
+
+std::string ParticleMesh::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[particle mesh] " + g_loader.GetStatusMessage();
+    return "Particle-mesh solver shader ready";
+}
@@ -0,0 +1,153 @@
+#include "perf_counters.h"
+#include <algorithm>
+
+// Two words (low, high) per slot: the shaders carry into the high word when the low one wraps
+static const int PERF_SLOT_COUNT = PerfCounters::PERF_EQUATION_BASE + PerfCounters::PERF_MAX_EQUATION_IDS;
+static const GLsizeiptr PERF_BUFFER_SIZE = PERF_SLOT_COUNT * 2 * sizeof(GLuint);
+
+static GLuint g_countersSSBO = 0;
+static GLuint g_countersTexture = 0;  // GL_R32UI buffer texture over g_countersSSBO, bound as an image
+static GLuint g_stagingBuffer = 0;  // Last interval's copy, read once g_stagingFence has signalled
+static GLsync g_stagingFence = nullptr;
+static int g_stagingSteps = 0;      // Steps the copy covers
+
+static bool g_enabled = false;
+static bool g_clearPending = false; // Enabled since the last step; stale counts are dropped
+static int g_readInterval = PerfCounters::PERF_DEFAULT_READ_INTERVAL;
+static int g_stepsInInterval = 0;
+static PerfCounters::Counts g_latest;
+
+static void ClearCounters()
+{
+    GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_countersSSBO);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    g_stepsInInterval = 0;
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+void PerfCounters::SetEnabled(bool enabled)
+{
+    if (enabled && !g_enabled) g_clearPending = true;
+    g_enabled = enabled;
+}
+
+bool PerfCounters::IsEnabled()
+{
+    return g_enabled;
+}
+
+void PerfCounters::SetReadInterval(int steps)
+{
+    g_readInterval = std::max(steps, 1);
+}
+
+int PerfCounters::GetReadInterval()
+{
+    return g_readInterval;
+}
+
+// ============================================================================
+// Per step
+// ============================================================================
+void PerfCounters::Bind()
+{
+    if (!g_enabled) return;
+    if (g_countersSSBO == 0)
+    {
+        glGenBuffers(1, &g_countersSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_countersSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, PERF_BUFFER_SIZE, nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glGenTextures(1, &g_countersTexture);
+        glBindTexture(GL_TEXTURE_BUFFER, g_countersTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, g_countersSSBO);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glGenBuffers(1, &g_stagingBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, g_stagingBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, PERF_BUFFER_SIZE, nullptr, GL_STREAM_READ);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        g_clearPending = true;
+    }
+    if (g_clearPending)
+    {
+        if (g_stagingFence) glDeleteSync(g_stagingFence);
+        g_stagingFence = nullptr;
+        ClearCounters();
+        g_clearPending = false;
+    }
+    glBindImageTexture(PERF_COUNTERS_IMAGE_UNIT, g_countersTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+}
+
+void PerfCounters::Unbind()
+{
+    if (!g_enabled) return;
+    glBindImageTexture(PERF_COUNTERS_IMAGE_UNIT, 0, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+}
+
+void PerfCounters::EndStep()
+{
+    if (!g_enabled || g_countersSSBO == 0) return;
+
+    // Collect the copy of an earlier interval once it has landed
+    if (g_stagingFence && glClientWaitSync(g_stagingFence, 0, 0) != GL_TIMEOUT_EXPIRED)
+    {
+        std::vector<GLuint> words(PERF_SLOT_COUNT * 2);
+        glBindBuffer(GL_COPY_READ_BUFFER, g_stagingBuffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, PERF_BUFFER_SIZE, words.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glDeleteSync(g_stagingFence);
+        g_stagingFence = nullptr;
+
+        auto slot = [&words](int index) { return (static_cast<uint64_t>(words[2 * index + 1]) << 32) | words[2 * index]; };
+        Counts counts;
+        for (int i = 0; i < PERF_COUNTER_COUNT; i++) counts.totals[i] = slot(i);
+        int usedIDs = PERF_MAX_EQUATION_IDS;
+        while (usedIDs > 0 && slot(PERF_EQUATION_BASE + usedIDs - 1) == 0) usedIDs--;
+        for (int id = 0; id < usedIDs; id++) counts.perEquation.push_back(slot(PERF_EQUATION_BASE + id));
+        counts.steps = g_stagingSteps;
+        g_latest = counts;
+    }
+
+    // While a copy is in flight the interval runs on, so no step goes uncounted
+    if (++g_stepsInInterval < g_readInterval || g_stagingFence) return;
+
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, g_countersSSBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, g_stagingBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, PERF_BUFFER_SIZE);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    g_stagingFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();  // So the fence reaches the GPU even if nothing else is submitted before the poll
+    g_stagingSteps = g_stepsInInterval;
+    ClearCounters();
+}
+
+const PerfCounters::Counts& PerfCounters::GetLatest()
+{
+    return g_latest;
+}
+
+// ============================================================================
+// Release the buffers
+// ============================================================================
+void PerfCounters::Cleanup()
+{
+    if (g_stagingFence) glDeleteSync(g_stagingFence);
+    g_stagingFence = nullptr;
+
+    if (g_countersTexture) glDeleteTextures(1, &g_countersTexture);
+    g_countersTexture = 0;
+    GLuint* buffers[] = { &g_countersSSBO, &g_stagingBuffer };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_stepsInInterval = 0;
+    g_latest = Counts();
+}
@@ -0,0 +1,300 @@
+#include "phase_space.h"
+#include "async_shader_loader.h"
+#include <algorithm>
+#include <iostream>
+
+// Density target, recreated when the view changes size
+static GLuint g_densityTexture = 0;
+static GLuint g_densityFBO = 0;
+static GLuint g_vao = 0;  // No attributes, the shaders work from gl_VertexID
+static int g_width = 0, g_height = 0;
+
+// Plot settings
+static int g_q = PhaseSpace::PHASE_X;
+static int g_p = PhaseSpace::PHASE_VX;
+static float g_window[4] = { -3.0f, 3.0f, -3.0f, 3.0f };  // qMin, qMax, pMin, pMax
+static float g_decay = 0.95f;
+static float g_exposure = 4.0f;
+static bool g_clearPending = true;
+
+// Async shader loading: points into the density, fade, density onto the screen
+static GLuint g_pointsProgram = 0, g_fadeProgram = 0, g_densityProgram = 0;
+static AsyncShaderLoader g_pointsLoader, g_fadeLoader, g_densityLoader;
+static bool g_pointsReady = false, g_fadeReady = false, g_densityReady = false;
+static GLint g_qLoc = -1, g_pLoc = -1, g_windowLoc = -1;
+static GLint g_densityTextureLoc = -1, g_exposureLoc = -1;
+
+// ============================================================================
+// Start loading the shaders; the density target follows the view size
+// ============================================================================
+bool PhaseSpace::Init()
+{
+    if (g_vao == 0) glGenVertexArrays(1, &g_vao);
+
+    if (g_pointsProgram == 0)
+    {
+        g_pointsLoader.LoadGraphicsShaderAsync(
+            "phase_points.vert",
+            "phase_points.frag",
+            "",
+            [](GLuint program)
+            {
+                g_pointsProgram = program;
+                g_qLoc = glGetUniformLocation(program, "uQ");
+                g_pLoc = glGetUniformLocation(program, "uP");
+                g_windowLoc = glGetUniformLocation(program, "uWindow");
+                g_pointsReady = (g_qLoc != -1 && g_pLoc != -1 && g_windowLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[PhaseSpace] phase_points shaders FAILED: " << error << std::endl;
+                g_pointsReady = false;
+            });
+    }
+    if (g_fadeProgram == 0)
+    {
+        g_fadeLoader.LoadGraphicsShaderAsync(
+            "phase_quad.vert",
+            "phase_fade.frag",
+            "",
+            [](GLuint program)
+            {
+                g_fadeProgram = program;
+                g_fadeReady = true;
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[PhaseSpace] phase_fade shaders FAILED: " << error << std::endl;
+                g_fadeReady = false;
+            });
+    }
+    if (g_densityProgram == 0)
+    {
+        g_densityLoader.LoadGraphicsShaderAsync(
+            "phase_quad.vert",
+            "phase_density.frag",
+            "",
+            [](GLuint program)
+            {
+                g_densityProgram = program;
+                g_densityTextureLoc = glGetUniformLocation(program, "uDensity");
+                g_exposureLoc = glGetUniformLocation(program, "uExposure");
+                g_densityReady = (g_exposureLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[PhaseSpace] phase_density shaders FAILED: " << error << std::endl;
+                g_densityReady = false;
+            });
+    }
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[PhaseSpace] Failed to create the vertex array (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// R32F target of width x height; false if it cannot be made
+static bool EnsureDensityTarget(int width, int height)
+{
+    if (g_densityTexture != 0 && width == g_width && height == g_height) return true;
+
+    if (g_densityTexture == 0) glGenTextures(1, &g_densityTexture);
+    glBindTexture(GL_TEXTURE_2D, g_densityTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (g_densityFBO == 0) glGenFramebuffers(1, &g_densityFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, g_densityFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, g_densityTexture, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    g_width = width;
+    g_height = height;
+    g_clearPending = true;
+    if (!complete) std::cerr << "[PhaseSpace] Density framebuffer incomplete" << std::endl;
+    return complete;
+}
+
+// ============================================================================
+// Plot settings
+// ============================================================================
+bool PhaseSpace::SetVariables(int q, int p)
+{
+    if (q < 0 || q >= PHASE_VARIABLE_COUNT || p < 0 || p >= PHASE_VARIABLE_COUNT) return false;
+    if (q != g_q || p != g_p) g_clearPending = true;
+    g_q = q;
+    g_p = p;
+    return true;
+}
+
+void PhaseSpace::GetVariables(int& q, int& p)
+{
+    q = g_q;
+    p = g_p;
+}
+
+bool PhaseSpace::SetWindow(float qMin, float qMax, float pMin, float pMax)
+{
+    if (!(qMax > qMin) || !(pMax > pMin)) return false;
+    g_window[0] = qMin;
+    g_window[1] = qMax;
+    g_window[2] = pMin;
+    g_window[3] = pMax;
+    g_clearPending = true;
+    return true;
+}
+
+void PhaseSpace::GetWindow(float& qMin, float& qMax, float& pMin, float& pMax)
+{
+    qMin = g_window[0];
+    qMax = g_window[1];
+    pMin = g_window[2];
+    pMax = g_window[3];
+}
+
+void PhaseSpace::SetDecay(float keep)
+{
+    g_decay = std::clamp(keep, 0.0f, 1.0f);
+}
+
+float PhaseSpace::GetDecay()
+{
+    return g_decay;
+}
+
+void PhaseSpace::SetExposure(float exposure)
+{
+    if (exposure > 0.0f) g_exposure = exposure;
+}
+
+float PhaseSpace::GetExposure()
+{
+    return g_exposure;
+}
+
+void PhaseSpace::Clear()
+{
+    g_clearPending = true;
+}
+
+// ============================================================================
+// Fade, accumulate, display
+// ============================================================================
+void PhaseSpace::Draw(GLuint objectSSBO, int numObjects, int width, int height)
+{
+    if (!IsReady() || width <= 0 || height <= 0) return;
+
+    GLint target = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &target);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    bool haveTarget = EnsureDensityTarget(width, height);
+
+    if (haveTarget)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, g_densityFBO);
+        glViewport(0, 0, width, height);
+        glBindVertexArray(g_vao);
+        glEnable(GL_BLEND);
+
+        if (g_clearPending)
+        {
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            g_clearPending = false;
+        }
+        else
+        {
+            // density *= decay, as a blend of a zero source
+            glUseProgram(g_fadeProgram);
+            glBlendColor(g_decay, g_decay, g_decay, g_decay);
+            glBlendFunc(GL_ZERO, GL_CONSTANT_COLOR);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+
+        if (numObjects > 0)
+        {
+            glUseProgram(g_pointsProgram);
+            glUniform1i(g_qLoc, g_q);
+            glUniform1i(g_pLoc, g_p);
+            glUniform4fv(g_windowLoc, 1, g_window);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PHASE_OBJECTS_BINDING, objectSSBO);
+            glBlendFunc(GL_ONE, GL_ONE);
+            glDrawArrays(GL_POINTS, 0, numObjects);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PHASE_OBJECTS_BINDING, 0);
+        }
+    }
+
+    // Back into the caller's framebuffer, blended over what it cleared to
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(target));
+    glViewport(0, 0, width, height);
+    if (haveTarget)
+    {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glUseProgram(g_densityProgram);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, g_densityTexture);
+        if (g_densityTextureLoc != -1) glUniform1i(g_densityTextureLoc, 0);
+        glUniform1f(g_exposureLoc, g_exposure);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+    if (!blend) glDisable(GL_BLEND);
+}
+
+// ============================================================================
+// Release the target and programs
+// ============================================================================
+void PhaseSpace::Cleanup()
+{
+    GLuint* programs[] = { &g_pointsProgram, &g_fadeProgram, &g_densityProgram };
+    for (GLuint* program : programs)
+    {
+        if (*program) glDeleteProgram(*program);
+        *program = 0;
+    }
+    g_pointsReady = g_fadeReady = g_densityReady = false;
+
+    if (g_densityFBO) glDeleteFramebuffers(1, &g_densityFBO);
+    if (g_densityTexture) glDeleteTextures(1, &g_densityTexture);
+    if (g_vao) glDeleteVertexArrays(1, &g_vao);
+    g_densityFBO = 0;
+    g_densityTexture = 0;
+    g_vao = 0;
+    g_width = g_height = 0;
+    g_clearPending = true;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void PhaseSpace::UpdateShaderLoadingStatus()
+{
+    g_pointsLoader.Update();
+    g_fadeLoader.Update();
+    g_densityLoader.Update();
+}
+
+bool PhaseSpace::IsReady()
+{
+    return g_pointsReady && g_fadeReady && g_densityReady;
+}
+
+std::string PhaseSpace::GetShaderLoadStatusMessage()
+{
+    if (!g_pointsReady) return "[phase space] " + g_pointsLoader.GetStatusMessage();
+    if (!g_fadeReady) return "[phase space] " + g_fadeLoader.GetStatusMessage();
+    if (!g_densityReady) return "[phase space] " + g_densityLoader.GetStatusMessage();
+    return "Phase space shaders ready";
+}
@@ -2,11 +2,14 @@
 #include "renderer_internals.h"
 #include "globals.h"
 #include "objects.h"
+#include "object_trails.h"
 #include "vectorfield.h"
 #include "axis.h"
 #include "framebuffer.h"
+#include "resolution_scaler.h"
 #include "shader_utils.h"
 #include "utils.h"
+#include "embedded_shaders.h"
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
@@ -27,16 +30,24 @@ GLuint texPendulumBob = 0;
 int inputIndex = 0;
 int outputIndex = 1;
 
+// Embedded shader source, empty (and reported) when missing
+static std::string ShaderSource(const char* name) {
+    std::string source, hash;
+    if (!LoadShaderSource(name, source, hash))
+        std::cerr << "Shader not found: " << name << "\n";
+    return source;
+}
+
 bool Renderer::Initialize() {
     programField = CreateProgram(
-        ReadTextFile("shaders/vertexShader.vert").c_str(),
-        ReadTextFile("shaders/geoShader.geom").c_str(),
-        ReadTextFile("shaders/fragShader.frag").c_str());
+        ShaderSource("vertexShader.vert").c_str(),
+        ShaderSource("geoShader.geom").c_str(),
+        ShaderSource("fragShader.frag").c_str());
         
     programAxis = CreateProgram(
-        ReadTextFile("shaders/axis.vert").c_str(),
+        ShaderSource("axis.vert").c_str(),
         nullptr,
-        ReadTextFile("shaders/axis.frag").c_str());
+        ShaderSource("axis.frag").c_str());
 
     if (!programField || !programAxis) {
         std::cerr << "Failed to create shader programs\n";
@@ -45,6 +56,8 @@ bool Renderer::Initialize() {
 
     framebuffer = new Framebuffer::Framebuffer(SCR_WIDTH, SCR_HEIGHT);
     framebuffer2 = new Framebuffer::Framebuffer(SCR_WIDTH, SCR_HEIGHT);
+    if (!ResolutionScaler::Init())
+        std::cerr << "Dynamic resolution unavailable, the world view renders at full size\n";
 
     VectorField::Generate(20.0f, 0.1f);
     VectorField::CreateGL();
@@ -61,6 +74,7 @@ bool Renderer::Initialize() {
     Renderer::SetupTextures();
 
     Objects::SetDefaultObjectType(g_physics.defaultvisualSkinType);
+    Objects::SetTrails(TRAIL_DEFAULT_OBJECTS, TRAIL_DEFAULT_LENGTH);
     Objects::SetSystemParameters(g_physics.gravity, g_physics.damping, g_physics.stiffness);
 
     return true;
@@ -71,6 +85,7 @@ void Renderer::Shutdown() {
 
     delete framebuffer;
     delete framebuffer2;
+    ResolutionScaler::Cleanup();
 
     if (programField) glDeleteProgram(programField);
     if (programAxis) glDeleteProgram(programAxis);
@@ -2,6 +2,7 @@
 #include "renderer_internals.h"
 #include "globals.h"
 #include "axis.h"
+#include "objects.h"
 #include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -12,6 +13,8 @@ void Renderer::RenderPhaseSpace() {
     glClearColor(0.02f, 0.02f, 0.05f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
+    Objects::DrawPhaseSpace(inputIndex, (int)g_simulationViewportSize.x, (int)g_simulationViewportSize.y);
+
     glm::mat4 projectionPhase = glm::ortho(-3.0f, 3.0f, -3.0f, 3.0f, -1.0f, 1.0f);
 
     glUseProgram(programAxis);
@@ -6,30 +6,22 @@
 
 void Renderer::UpdatePhysics(float deltaTime, float fakeDeltaTime) {
     if (!g_physics.simulationPaused && Objects::IsComputeShaderReady()) {
-        // Get the compute program directly each time (don't rely on cached programUpdate)
-        GLuint computeProgram = Objects::GetComputeProgram();
-        
-        // Set all uniforms on the ACTUAL compute shader
-        glUseProgram(computeProgram);
-        
-        // Set all physics uniforms
-        glUniform1f(glGetUniformLocation(computeProgram, "uDt"), fakeDeltaTime);
-        glUniform1f(glGetUniformLocation(computeProgram, "uTime"), g_physics.globalTime);
-        glUniform1f(glGetUniformLocation(computeProgram, "k"), g_physics.stiffness);
-        glUniform1f(glGetUniformLocation(computeProgram, "b"), g_physics.damping);
-        glUniform1f(glGetUniformLocation(computeProgram, "g"), g_physics.gravity);
-        glUniform2f(glGetUniformLocation(computeProgram, "uGravityDir"), g_physics.gravityDir.x, g_physics.gravityDir.y);
-        glUniform1f(glGetUniformLocation(computeProgram, "uRestitution"), g_physics.restitution);
-        glUniform1f(glGetUniformLocation(computeProgram, "uCoupling"), g_physics.coupling);
-        glUniform2f(glGetUniformLocation(computeProgram, "uExternalForce"), g_physics.externalForce.x, g_physics.externalForce.y);
-        glUniform1f(glGetUniformLocation(computeProgram, "uDriveFreq"), g_physics.driveFreq);
-        glUniform1f(glGetUniformLocation(computeProgram, "uDriveAmp"), g_physics.driveAmp);
-        glUniform1i(glGetUniformLocation(computeProgram, "uEquationMode"), 0);
-        glUniform1i(glGetUniformLocation(computeProgram, "uNumObjects"), Objects::GetNumObjects());
+        // Physics parameters go to the shared parameter block; only changed values are re-uploaded
+        SimParams params = Objects::GetSimParams();
+        params.dt = fakeDeltaTime;
+        params.time = g_physics.globalTime;
+        params.stiffness = g_physics.stiffness;
+        params.damping = g_physics.damping;
+        params.gravity = g_physics.gravity;
+        params.gravityDir = g_physics.gravityDir;
+        params.restitution = g_physics.restitution;
+        params.coupling = g_physics.coupling;
+        params.externalForce = g_physics.externalForce;
+        params.driveFreq = g_physics.driveFreq;
+        params.driveAmp = g_physics.driveAmp;
+        params.equationMode = 0;
+        Objects::SetSimParams(params);
 
-        // Now call Objects::Update - it will use the same compute program
         Objects::Update(inputIndex, outputIndex);
-        
-        glUseProgram(0);
     }
 }
\ No newline at end of file
@@ -2,8 +2,11 @@
 #include "renderer_internals.h"
 #include "globals.h"
 #include "objects.h"
+#include "grid_fields.h"
 #include "axis.h"
 #include "text_renderer.h"
+#include "resolution_scaler.h"
+#include "world_tiles.h"
 #include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -16,7 +19,7 @@ void Renderer::RenderWorldView() {
     // Initialize systems once
     if (textRenderer == nullptr) {
         try {
-            textRenderer = new TextRenderer("C:/Users/user/jabariaiden-ProjStellar-main/bin/fonts/Roboto-VariableFont_wdth,wght.ttf", 24);
+            textRenderer = new TextRenderer(24);
             std::cout << "TextRenderer initialized successfully" << std::endl;
         } catch (...) {
             std::cerr << "Failed to initialize TextRenderer" << std::endl;
@@ -51,8 +54,14 @@ void Renderer::RenderWorldView() {
         std::cout << "Axis system initialized with Desmos-style settings" << std::endl;
     }
     
+    // Drawn at the render scale and stretched back to the viewport when the texture is shown
+    ResolutionScaler::BeginFrame();
+    float renderScale = ResolutionScaler::GetScale();
+    glm::vec2 renderSize = glm::max(glm::floor(g_simulationViewportSize * renderScale), glm::vec2(1.0f));
+    framebuffer->Resize((uint32_t)renderSize.x, (uint32_t)renderSize.y);
+
     framebuffer->Bind();
-    glViewport(0, 0, (int)g_simulationViewportSize.x, (int)g_simulationViewportSize.y);
+    glViewport(0, 0, (int)renderSize.x, (int)renderSize.y);
     glClearColor(0.05f, 0.05f, 0.08f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
     
@@ -62,13 +71,24 @@ void Renderer::RenderWorldView() {
     glEnable(GL_LINE_SMOOTH);
     glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
     
-    glm::mat4 projectionWorld = g_camera.GetProjectionMatrix(
-        g_simulationViewportSize.x, g_simulationViewportSize.y);
+    // A tiled ensemble shows the camera's view in every cell, so the projection is a cell's
+    bool tiled = WorldTiles::IsActive();
+    glm::vec2 viewSize = g_simulationViewportSize;
+    if (tiled) {
+        int cellWidth, cellHeight;
+        WorldTiles::GetCellSize((int)viewSize.x, (int)viewSize.y, cellWidth, cellHeight);
+        viewSize = glm::vec2((float)cellWidth, (float)cellHeight);
+    }
+    glm::mat4 projectionWorld = g_camera.GetProjectionMatrix(viewSize.x, viewSize.y);
     glm::mat4 viewWorld = glm::translate(glm::mat4(1.0f), 
         glm::vec3(-g_camera.position, 0.0f));
     glm::mat4 projView = projectionWorld * viewWorld;
     
-    // ----- Objects FIRST (behind grid) -----
+    // ----- Objects FIRST (behind grid), over the grid fields -----
+    if (!tiled) GridFields::Draw(projView);
+    if (g_physics.showTrails && !tiled) Objects::DrawTrails(projView, inputIndex);
+    if (!tiled) Objects::DrawConstraints(projView, inputIndex);
+    Objects::SetViewBounds(projView);
     GLuint objectProgram = Objects::GetQuadProgram();
     glUseProgram(objectProgram);
     GLint projLoc = glGetUniformLocation(objectProgram, "uProjection");
@@ -78,6 +98,15 @@ void Renderer::RenderWorldView() {
     if (viewLoc != -1)
         glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(viewWorld));
     Objects::Draw(inputIndex);
+    if (tiled) {
+        // Trails, the force field and the grid span the whole view, so cells show objects only
+        framebuffer->Unbind();
+        ResolutionScaler::EndFrame();
+        glViewport(0, 0, g_width, g_height);
+        glDisable(GL_LINE_SMOOTH);
+        return;
+    }
+    Objects::DrawForceField(projView, inputIndex);
     
     // ----- Axis / grid SECOND (on top of objects) -----
     Axis::Update(g_camera, g_simulationViewportSize.x, g_simulationViewportSize.y);
@@ -95,10 +124,11 @@ void Renderer::RenderWorldView() {
     // ----- Grid Labels LAST (on top of everything) -----
     if (textRenderer != nullptr) {
         Axis::DrawLabels(*textRenderer, g_camera, 
-                         g_simulationViewportSize.x, g_simulationViewportSize.y);
+                         renderSize.x, renderSize.y);
     }
     
     framebuffer->Unbind();
+    ResolutionScaler::EndFrame();
     glViewport(0, 0, g_width, g_height);
     
     // Reset OpenGL state if needed
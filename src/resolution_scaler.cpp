@@ -0,0 +1,152 @@
+#include "resolution_scaler.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Enough queries in flight that the oldest has landed by the time its slot comes round again
+static const int TIMER_QUERIES = 4;
+static const int ADJUST_INTERVAL = 8;     // Samples between scale changes, so each one shows up
+static const float SCALE_STEP = 1.0f / 32.0f;  // Scales are quantized so the target is rarely rebuilt
+
+static GLuint g_queries[TIMER_QUERIES] = { 0 };
+static bool g_pending[TIMER_QUERIES] = { false };
+static int g_slot = 0;
+static bool g_timing = false;  // BeginFrame started a query
+
+static bool g_enabled = false;
+static float g_budget = ResolutionScaler::DEFAULT_BUDGET_MS;
+static float g_minScale = ResolutionScaler::DEFAULT_MIN_SCALE;
+static float g_scale = 1.0f;
+static float g_passTime = 0.0f;
+static int g_samplesSinceAdjust = 0;
+
+// ============================================================================
+// Timer queries
+// ============================================================================
+bool ResolutionScaler::Init()
+{
+    if (g_queries[0] == 0) glGenQueries(TIMER_QUERIES, g_queries);
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[ResolutionScaler] Failed to create timer queries (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ResolutionScaler::Cleanup()
+{
+    if (g_queries[0]) glDeleteQueries(TIMER_QUERIES, g_queries);
+    std::fill(g_queries, g_queries + TIMER_QUERIES, 0u);
+    std::fill(g_pending, g_pending + TIMER_QUERIES, false);
+    g_timing = false;
+    g_scale = 1.0f;
+    g_passTime = 0.0f;
+    g_samplesSinceAdjust = 0;
+}
+
+// Fold a measurement into the smoothed time and move the scale if it has been long enough
+static void AddSample(float milliseconds)
+{
+    g_passTime = g_passTime > 0.0f ? g_passTime * 0.8f + milliseconds * 0.2f : milliseconds;
+    if (++g_samplesSinceAdjust < ADJUST_INTERVAL) return;
+
+    float scale = g_scale;
+    if (g_passTime > g_budget)
+    {
+        // Time follows the pixel count, which goes with the square of the scale
+        scale *= std::max(std::sqrt(g_budget / g_passTime), 0.85f);
+        scale = std::floor(scale / SCALE_STEP) * SCALE_STEP;
+    }
+    else if (g_passTime < g_budget * 0.7f)
+        scale += SCALE_STEP;
+    scale = std::clamp(scale, g_minScale, 1.0f);
+
+    if (scale != g_scale) g_samplesSinceAdjust = 0;
+    g_scale = scale;
+}
+
+void ResolutionScaler::BeginFrame()
+{
+    g_timing = false;
+    if (!g_enabled || g_queries[0] == 0) return;
+
+    // Collect the result this slot holds; a query still in flight keeps the slot and this frame
+    // goes untimed
+    if (g_pending[g_slot])
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(g_queries[g_slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(g_queries[g_slot], GL_QUERY_RESULT, &elapsed);
+        g_pending[g_slot] = false;
+        AddSample(static_cast<float>(elapsed) * 1e-6f);
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, g_queries[g_slot]);
+    g_timing = true;
+}
+
+void ResolutionScaler::EndFrame()
+{
+    if (!g_timing) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    g_pending[g_slot] = true;
+    g_slot = (g_slot + 1) % TIMER_QUERIES;
+    g_timing = false;
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+void ResolutionScaler::SetEnabled(bool enabled)
+{
+    g_enabled = enabled;
+    if (!enabled)
+    {
+        g_scale = 1.0f;
+        g_passTime = 0.0f;
+        g_samplesSinceAdjust = 0;
+    }
+}
+
+bool ResolutionScaler::GetEnabled()
+{
+    return g_enabled;
+}
+
+void ResolutionScaler::SetBudget(float milliseconds)
+{
+    if (milliseconds > 0.0f) g_budget = milliseconds;
+}
+
+float ResolutionScaler::GetBudget()
+{
+    return g_budget;
+}
+
+void ResolutionScaler::SetMinScale(float scale)
+{
+    if (!(scale > 0.0f)) return;
+    g_minScale = std::min(scale, 1.0f);
+    g_scale = std::max(g_scale, g_minScale);
+}
+
+float ResolutionScaler::GetMinScale()
+{
+    return g_minScale;
+}
+
+float ResolutionScaler::GetScale()
+{
+    return g_scale;
+}
+
+float ResolutionScaler::GetPassTime()
+{
+    return g_passTime;
+}
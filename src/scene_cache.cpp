@@ -0,0 +1,122 @@
+#include "scene_cache.h"
+#include "objects.h"
+#include <iostream>
+#include <map>
+
+struct CachedScene
+{
+    GLuint buffer = 0;
+    int numObjects = 0;
+    std::vector<int> equationIDs;  // Per object, -1 = none
+};
+
+static std::map<std::string, CachedScene> g_scenes;
+
+// ============================================================================
+// Store a scene's objects in a buffer of its own
+// ============================================================================
+bool SceneCache::Store(const std::string& name, GLuint objectSSBO, int numObjects, const std::vector<int>& equationIDs)
+{
+    CachedScene& scene = g_scenes[name];
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(numObjects) * sizeof(Object);
+
+    // A buffer of the exact size, so the cache never holds more than its scenes
+    if (scene.buffer == 0) glGenBuffers(1, &scene.buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, scene.buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, bytes > 0 ? bytes : sizeof(Object), nullptr, GL_STATIC_COPY);
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        std::cerr << "[SceneCache] Failed to allocate scene '" << name << "' (GL error " << err << ")" << std::endl;
+        Remove(name);
+        return false;
+    }
+
+    if (bytes > 0)
+    {
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBuffer(GL_COPY_READ_BUFFER, objectSSBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    scene.numObjects = numObjects;
+    scene.equationIDs = equationIDs;
+    scene.equationIDs.resize(static_cast<size_t>(numObjects), -1);
+    return true;
+}
+
+bool SceneCache::Has(const std::string& name)
+{
+    return g_scenes.count(name) != 0;
+}
+
+void SceneCache::Remove(const std::string& name)
+{
+    auto it = g_scenes.find(name);
+    if (it == g_scenes.end()) return;
+    if (it->second.buffer) glDeleteBuffers(1, &it->second.buffer);
+    g_scenes.erase(it);
+}
+
+std::vector<std::string> SceneCache::GetNames()
+{
+    std::vector<std::string> names;
+    for (const auto& entry : g_scenes) names.push_back(entry.first);
+    return names;
+}
+
+int SceneCache::GetObjectCount(const std::string& name)
+{
+    auto it = g_scenes.find(name);
+    return it == g_scenes.end() ? -1 : it->second.numObjects;
+}
+
+const std::vector<int>* SceneCache::GetEquationIDs(const std::string& name)
+{
+    auto it = g_scenes.find(name);
+    return it == g_scenes.end() ? nullptr : &it->second.equationIDs;
+}
+
+long long SceneCache::GetBytes()
+{
+    long long bytes = 0;
+    for (const auto& entry : g_scenes) bytes += static_cast<long long>(entry.second.numObjects) * sizeof(Object);
+    return bytes;
+}
+
+// ============================================================================
+// Copy a stored scene into the object buffers
+// ============================================================================
+bool SceneCache::Restore(const std::string& name, const GLuint* targets, int targetCount, int first)
+{
+    auto it = g_scenes.find(name);
+    if (it == g_scenes.end()) return false;
+    const CachedScene& scene = it->second;
+    if (scene.numObjects == 0) return true;
+
+    GLintptr offset = static_cast<GLintptr>(first) * sizeof(Object);
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(scene.numObjects) * sizeof(Object);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);  // Shader writes to the rows being replaced
+    glBindBuffer(GL_COPY_READ_BUFFER, scene.buffer);
+    for (int b = 0; b < targetCount; b++)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, targets[b]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, offset, bytes);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return true;
+}
+
+// ============================================================================
+// Release every stored scene
+// ============================================================================
+void SceneCache::Cleanup()
+{
+    for (auto& entry : g_scenes)
+        if (entry.second.buffer) glDeleteBuffers(1, &entry.second.buffer);
+    g_scenes.clear();
+}
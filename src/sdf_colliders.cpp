@@ -0,0 +1,228 @@
+#include "sdf_colliders.h"
+#include "equation_codegen.h"
+#include "embedded_shaders.h"
+#include "shader_utils.h"
+#include <algorithm>
+#include <iostream>
+
+static const GLuint SDF_COLLIDE_WORK_GROUP_SIZE = 256;
+static const float SDF_EXPRESSION_GRADIENT_STEP = 1e-3f;  // World units, without a grid to size it
+
+// Distance expression, or "" for the template's default (no surface anywhere)
+static std::string g_function;
+static bool g_hasExpression = false;
+
+// Sampled distances
+static GLuint g_gridTexture = 0;
+static int g_gridColumns = 0, g_gridRows = 0;
+static float g_gridBounds[4] = { 0.0f, 0.0f, 0.0f, 0.0f };  // xMin, xMax, yMin, yMax
+static bool g_hasGrid = false;
+
+static float g_restitution = 0.5f, g_friction = 0.3f;
+
+// Program, compiled from the template for each expression
+static std::string g_templateSource;
+static GLuint g_program = 0;
+static GLint g_numObjectsLoc = -1, g_useGridLoc = -1, g_gridBoundsLoc = -1, g_gradientStepLoc = -1, g_surfaceLoc = -1;
+static GLint g_staticCollidersLoc = -1, g_kinematicObjectsLoc = -1;
+
+// ============================================================================
+// Nothing is allocated until an environment is set
+// ============================================================================
+bool SdfColliders::Init()
+{
+    return true;
+}
+
+// Compile the template with function spliced in, or as it is for ""
+static bool BuildProgram(const std::string& function, std::string& error)
+{
+    if (g_templateSource.empty())
+    {
+        std::string hash;
+        if (!LoadShaderSource("sdf_collide.comp", g_templateSource, hash))
+        {
+            error = "sdf_collide.comp not found";
+            return false;
+        }
+    }
+
+    std::string source = g_templateSource;
+    if (!function.empty())
+    {
+        std::string block = std::string(EquationCodegen::BLOCK_BEGIN_MARKER) + "\n" + function +
+                            EquationCodegen::BLOCK_END_MARKER;
+        source = EquationCodegen::SpliceEquationBlock(g_templateSource, block);
+        if (source.empty())
+        {
+            error = "sdf_collide.comp has no expression block";
+            return false;
+        }
+    }
+
+    GLuint program = CreateComputeProgram(source.c_str());
+    if (program == 0)
+    {
+        error = "SDF collider shader failed to compile for this expression";
+        return false;
+    }
+
+    if (g_program) glDeleteProgram(g_program);
+    g_program = program;
+    g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+    g_useGridLoc = glGetUniformLocation(program, "uUseGrid");
+    g_gridBoundsLoc = glGetUniformLocation(program, "uGridBounds");
+    g_gradientStepLoc = glGetUniformLocation(program, "uGradientStep");
+    g_surfaceLoc = glGetUniformLocation(program, "uSurface");
+    g_staticCollidersLoc = glGetUniformLocation(program, "uStaticColliders");
+    g_kinematicObjectsLoc = glGetUniformLocation(program, "uKinematicObjects");
+    return true;
+}
+
+static void ReleaseProgram()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+}
+
+// ============================================================================
+// Environment
+// ============================================================================
+bool SdfColliders::SetExpression(const std::string& function, std::string& error)
+{
+    if (!BuildProgram(function, error)) return false;
+    g_function = function;
+    g_hasExpression = true;
+    return true;
+}
+
+void SdfColliders::ClearExpression()
+{
+    g_function.clear();
+    g_hasExpression = false;
+
+    // The grid alone runs on the template as it is
+    std::string error;
+    if (!g_hasGrid || !BuildProgram("", error)) ReleaseProgram();
+}
+
+bool SdfColliders::SetGrid(const std::vector<float>& distances, int columns, int rows,
+                           float xMin, float xMax, float yMin, float yMax)
+{
+    if (columns < 2 || rows < 2 || columns > MAX_SDF_GRID_SIZE || rows > MAX_SDF_GRID_SIZE) return false;
+    if (distances.size() != static_cast<size_t>(columns) * rows) return false;
+    if (!(xMax > xMin) || !(yMax > yMin)) return false;
+
+    if (g_program == 0)
+    {
+        std::string error;
+        if (!BuildProgram(g_function, error))
+        {
+            std::cerr << "[SdfColliders] " << error << std::endl;
+            return false;
+        }
+    }
+
+    if (g_gridTexture == 0)
+    {
+        glGenTextures(1, &g_gridTexture);
+        glBindTexture(GL_TEXTURE_2D, g_gridTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    else
+    {
+        glBindTexture(GL_TEXTURE_2D, g_gridTexture);
+    }
+
+    // Same-sized grids are updated in place
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (columns == g_gridColumns && rows == g_gridRows)
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, columns, rows, GL_RED, GL_FLOAT, distances.data());
+    else
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, columns, rows, 0, GL_RED, GL_FLOAT, distances.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    g_gridColumns = columns;
+    g_gridRows = rows;
+    g_gridBounds[0] = xMin;
+    g_gridBounds[1] = xMax;
+    g_gridBounds[2] = yMin;
+    g_gridBounds[3] = yMax;
+    g_hasGrid = true;
+    return true;
+}
+
+void SdfColliders::ClearGrid()
+{
+    g_hasGrid = false;
+    if (g_gridTexture) glDeleteTextures(1, &g_gridTexture);
+    g_gridTexture = 0;
+    g_gridColumns = g_gridRows = 0;
+    if (!g_hasExpression) ReleaseProgram();
+}
+
+void SdfColliders::SetSurface(float restitution, float friction)
+{
+    g_restitution = std::clamp(restitution, 0.0f, 1.0f);
+    g_friction = std::max(friction, 0.0f);
+}
+
+bool SdfColliders::IsActive()
+{
+    return g_program != 0 && (g_hasExpression || g_hasGrid);
+}
+
+// ============================================================================
+// One pass over the objects, after the narrowphase
+// ============================================================================
+void SdfColliders::Resolve(GLuint objectSSBO, GLuint collisionPropsSSBO, int numObjects, bool staticColliders, bool kinematicObjects)
+{
+    if (!IsActive() || numObjects <= 0) return;
+
+    // Half a cell resolves the bilinear slope of the grid; finer is only noise
+    float gradientStep = SDF_EXPRESSION_GRADIENT_STEP;
+    if (g_hasGrid)
+        gradientStep = 0.5f * std::min((g_gridBounds[1] - g_gridBounds[0]) / (g_gridColumns - 1),
+                                       (g_gridBounds[3] - g_gridBounds[2]) / (g_gridRows - 1));
+
+    glUseProgram(g_program);
+    glUniform1i(g_numObjectsLoc, numObjects);
+    if (g_useGridLoc != -1) glUniform1i(g_useGridLoc, g_hasGrid ? 1 : 0);
+    if (g_gridBoundsLoc != -1) glUniform4fv(g_gridBoundsLoc, 1, g_gridBounds);
+    if (g_gradientStepLoc != -1) glUniform1f(g_gradientStepLoc, gradientStep);
+    if (g_surfaceLoc != -1) glUniform2f(g_surfaceLoc, g_restitution, g_friction);
+    if (g_staticCollidersLoc != -1) glUniform1i(g_staticCollidersLoc, staticColliders ? 1 : 0);
+    if (g_kinematicObjectsLoc != -1) glUniform1i(g_kinematicObjectsLoc, kinematicObjects ? 1 : 0);
+    if (g_hasGrid)
+    {
+        glActiveTexture(GL_TEXTURE0 + SDF_GRID_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, g_gridTexture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, collisionPropsSSBO);
+
+    glDispatchCompute((static_cast<GLuint>(numObjects) + SDF_COLLIDE_WORK_GROUP_SIZE - 1) / SDF_COLLIDE_WORK_GROUP_SIZE, 1, 1);
+
+    if (g_hasGrid)
+    {
+        glActiveTexture(GL_TEXTURE0 + SDF_GRID_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+}
+
+// ============================================================================
+// Release the texture and program
+// ============================================================================
+void SdfColliders::Cleanup()
+{
+    ReleaseProgram();
+    g_templateSource.clear();
+    g_function.clear();
+    g_hasExpression = false;
+    ClearGrid();
+}
@@ -0,0 +1,150 @@
+#include "simulation_thread.h"
+#include "renderer.h"
+#include "globals.h"
+#include "objects.h"
+#include "gpu_profiler.h"
+#include "frame_trace.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+static GLFWwindow* s_context = nullptr;  // Hidden window sharing objects with the main one
+static std::thread s_worker;
+static std::mutex s_stateMutex;           // Guards the Objects state and the fences below
+static std::atomic<bool> s_stopRequested{ false };
+static std::atomic<bool> s_renderWaiting{ false };
+static GLsync s_stepFence = nullptr;      // After the last submitted step, worker-owned
+static GLsync s_renderFence = nullptr;    // After the last frame's draws, render-owned until the worker waits
+static std::atomic<int> s_stepsPerSecond{ 0 };
+
+bool SimulationThread::Start(GLFWwindow* mainWindow) {
+    if (s_worker.joinable()) return true;
+
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    s_context = glfwCreateWindow(1, 1, "Simulation", nullptr, mainWindow);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (!s_context) {
+        std::cerr << "[SimulationThread] Failed to create a shared context\n";
+        return false;
+    }
+
+    // The worker's first step must see everything the main context has issued so far
+    glFinish();
+    s_stopRequested = false;
+    s_stepsPerSecond = 0;
+    s_worker = std::thread(Run);
+    std::cout << "[SimulationThread] Started" << std::endl;
+    return true;
+}
+
+void SimulationThread::Stop() {
+    if (!s_worker.joinable()) return;
+
+    s_stopRequested = true;
+    s_worker.join();
+    glfwDestroyWindow(s_context);
+    s_context = nullptr;
+
+    // Fences are shared objects; the worker has finished, so the main context can wait and drop them
+    if (s_stepFence) {
+        glWaitSync(s_stepFence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(s_stepFence);
+        s_stepFence = nullptr;
+    }
+    if (s_renderFence) {
+        glDeleteSync(s_renderFence);
+        s_renderFence = nullptr;
+    }
+    s_stepsPerSecond = 0;
+    std::cout << "[SimulationThread] Stopped" << std::endl;
+}
+
+bool SimulationThread::IsRunning() {
+    return s_worker.joinable();
+}
+
+void SimulationThread::BeginFrame() {
+    if (!s_worker.joinable()) return;
+
+    s_renderWaiting = true;
+    s_stateMutex.lock();
+    s_renderWaiting = false;
+    if (s_stepFence) glWaitSync(s_stepFence, 0, GL_TIMEOUT_IGNORED);
+}
+
+void SimulationThread::EndFrame() {
+    if (!s_worker.joinable()) return;
+
+    if (s_renderFence) glDeleteSync(s_renderFence);
+    s_renderFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();  // The fence and any buffers the frame created must reach the server before the worker uses them
+    s_stateMutex.unlock();
+}
+
+float SimulationThread::GetStepsPerSecond() {
+    return static_cast<float>(s_stepsPerSecond.load());
+}
+
+void SimulationThread::Run() {
+    glfwMakeContextCurrent(s_context);
+
+    double lastStepTime = glfwGetTime();
+    double rateWindowStart = lastStepTime;
+    int stepsInWindow = 0;
+
+    while (!s_stopRequested) {
+        // The mutex is not fair; let a waiting frame in before taking it again
+        while (s_renderWaiting && !s_stopRequested) std::this_thread::yield();
+
+        GLsync submitted = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(s_stateMutex);
+            if (s_renderFence) {
+                glWaitSync(s_renderFence, 0, GL_TIMEOUT_IGNORED);
+                glDeleteSync(s_renderFence);
+                s_renderFence = nullptr;
+            }
+
+            double now = glfwGetTime();
+            float deltaTime = static_cast<float>(now - lastStepTime);
+            lastStepTime = now;
+
+            if (!Renderer::IsSimulationPaused() && Objects::IsComputeShaderReady()) {
+                FRAME_TRACE_ZONE("thread_step");
+                g_physics.globalTime += deltaTime;
+                Renderer::UpdatePhysics(deltaTime, deltaTime * PHYSICS_DT);
+                Renderer::SwapBuffers();
+
+                if (s_stepFence) glDeleteSync(s_stepFence);
+                s_stepFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                submitted = s_stepFence;
+                glFlush();
+                stepsInWindow++;
+            }
+        }
+
+        // One step in flight: wait for the GPU outside the lock so frames can run meanwhile.
+        // Only this thread deletes step fences, so the handle stays valid.
+        if (submitted) {
+            FRAME_TRACE_ZONE("thread_wait_gpu");
+            glClientWaitSync(submitted, 0, GL_TIMEOUT_IGNORED);
+        }
+        else
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        double now = glfwGetTime();
+        if (now - rateWindowStart >= 1.0) {
+            s_stepsPerSecond = static_cast<int>(stepsInWindow / (now - rateWindowStart));
+            rateWindowStart = now;
+            stepsInWindow = 0;
+        }
+    }
+
+    // This context's timer queries go with it
+    GpuProfiler::Cleanup();
+    glfwMakeContextCurrent(nullptr);
+}
@@ -0,0 +1,181 @@
+#include "sph_fluid.h"
+#include "broadphase.h"
+#include "long_range.h"
+#include "objects.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+// Passes - MUST MATCH sph_fluid.comp
+enum SphPass
+{
+    SPH_PASS_DENSITY = 0,
+    SPH_PASS_FORCES = 1
+};
+
+static const GLuint SPH_WORK_GROUP_SIZE = 256;
+
+// Fluid equation slots, uploaded when they change
+static std::vector<GLuint> g_fluidEquations(Objects::MAX_EQUATIONS, 0u);
+static bool g_fluidEquationsDirty = true;
+static GLuint g_fluidEquationsSSBO = 0;
+
+static SphParameters g_params;
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_passLoc = -1;
+static GLint g_numObjectsLoc = -1;
+static GLint g_gridTableSizeLoc = -1;
+static GLint g_radiusLoc = -1;
+static GLint g_restDensityLoc = -1;
+static GLint g_stiffnessLoc = -1;
+static GLint g_gammaLoc = -1;
+static GLint g_viscosityLoc = -1;
+
+// ============================================================================
+// Start loading the shader; the equation flags are uploaded by the first solve
+// ============================================================================
+bool SphFluid::Init()
+{
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "sph_fluid.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_passLoc = glGetUniformLocation(program, "uPass");
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_gridTableSizeLoc = glGetUniformLocation(program, "uGridTableSize");
+                g_radiusLoc = glGetUniformLocation(program, "uRadius");
+                g_restDensityLoc = glGetUniformLocation(program, "uRestDensity");
+                g_stiffnessLoc = glGetUniformLocation(program, "uStiffness");
+                g_gammaLoc = glGetUniformLocation(program, "uGamma");
+                g_viscosityLoc = glGetUniformLocation(program, "uViscosity");
+                g_ready = (g_passLoc != -1 && g_radiusLoc != -1 && g_gridTableSizeLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[SphFluid] sph_fluid.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+// ============================================================================
+// Fluid equations
+// ============================================================================
+void SphFluid::SetFluidEquation(int equationID, bool fluid)
+{
+    if (equationID < 0 || equationID >= static_cast<int>(g_fluidEquations.size())) return;
+    GLuint flag = fluid ? 1u : 0u;
+    if (g_fluidEquations[equationID] == flag) return;
+    g_fluidEquations[equationID] = flag;
+    g_fluidEquationsDirty = true;
+}
+
+void SphFluid::ClearFluidEquations()
+{
+    std::fill(g_fluidEquations.begin(), g_fluidEquations.end(), 0u);
+    g_fluidEquationsDirty = true;
+}
+
+// ============================================================================
+// Neighbour grid -> density and pressure -> accelerations
+// ============================================================================
+bool SphFluid::Compute(GLuint objectSSBO, GLuint collisionPropsSSBO, GLuint fieldSSBO, int numObjects)
+{
+    if (!g_ready || numObjects <= 0 || fieldSSBO == 0) return false;
+    if (!Broadphase::BuildNeighbourGrid(objectSSBO, collisionPropsSSBO, numObjects, g_params.radius)) return false;
+
+    if (g_fluidEquationsDirty)
+    {
+        BufferHelpers::EnsureBufferCapacity(g_fluidEquationsSSBO, g_fluidEquations.size() * sizeof(GLuint));
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_fluidEquationsSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, g_fluidEquations.size() * sizeof(GLuint), g_fluidEquations.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        g_fluidEquationsDirty = false;
+    }
+
+    glUseProgram(g_program);
+    if (g_numObjectsLoc != -1) glUniform1i(g_numObjectsLoc, numObjects);
+    glUniform1ui(g_gridTableSizeLoc, Broadphase::GetGridTableSize());
+    glUniform1f(g_radiusLoc, g_params.radius);
+    if (g_restDensityLoc != -1) glUniform1f(g_restDensityLoc, g_params.restDensity);
+    if (g_stiffnessLoc != -1) glUniform1f(g_stiffnessLoc, g_params.stiffness);
+    if (g_gammaLoc != -1) glUniform1f(g_gammaLoc, g_params.gamma);
+    if (g_viscosityLoc != -1) glUniform1f(g_viscosityLoc, g_params.viscosity);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LONG_RANGE_ACCEL_BINDING, fieldSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPH_FLUID_EQUATIONS_BINDING, g_fluidEquationsSSBO);
+    Broadphase::BindNeighbourGrid();
+
+    GLuint groups = (static_cast<GLuint>(numObjects) + SPH_WORK_GROUP_SIZE - 1) / SPH_WORK_GROUP_SIZE;
+    int passes[] = { SPH_PASS_DENSITY, SPH_PASS_FORCES };
+    for (int pass : passes)
+    {
+        glUniform1i(g_passLoc, pass);
+        glDispatchCompute(groups, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    Broadphase::UnbindNeighbourGrid();
+    GLuint bindings[] = { 0, LONG_RANGE_ACCEL_BINDING, SPH_FLUID_EQUATIONS_BINDING };
+    for (GLuint binding : bindings) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+    glUseProgram(0);
+    return true;
+}
+
+// ============================================================================
+// Parameters
+// ============================================================================
+void SphFluid::SetParameters(const SphParameters& params)
+{
+    g_params = params;
+}
+
+SphParameters SphFluid::GetParameters()
+{
+    return g_params;
+}
+
+// ============================================================================
+// Release the buffer and the program
+// ============================================================================
+void SphFluid::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    if (g_fluidEquationsSSBO) glDeleteBuffers(1, &g_fluidEquationsSSBO);
+    g_fluidEquationsSSBO = 0;
+    ClearFluidEquations();
+    g_params = SphParameters{};
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void SphFluid::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool SphFluid::IsReady()
+{
+    return g_ready;
+}
+
+std::string SphFluid::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[sph fluid] " + g_loader.GetStatusMessage();
+    return "SPH fluid shader ready";
+}
@@ -0,0 +1,272 @@
+#include "spring_network.h"
+#include "async_shader_loader.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+
+// Passes - MUST MATCH spring_network.comp
+enum SpringPass
+{
+    SPRING_PASS_SNAPSHOT = 0,
+    SPRING_PASS_REST_LENGTHS = 1,
+    SPRING_PASS_APPLY = 2,
+    SPRING_PASS_IMPLICIT_INIT = 3,
+    SPRING_PASS_IMPLICIT_START = 4,
+    SPRING_PASS_IMPLICIT_PRODUCT = 5,
+    SPRING_PASS_IMPLICIT_ALPHA = 6,
+    SPRING_PASS_IMPLICIT_UPDATE = 7,
+    SPRING_PASS_IMPLICIT_BETA = 8,
+    SPRING_PASS_IMPLICIT_DIRECTION = 9,
+    SPRING_PASS_IMPLICIT_APPLY = 10
+};
+
+// vec4 rows of the implicit solver after the snapshot, per object - MUST MATCH SOLVER_* in spring_network.comp
+static const int SPRING_SOLVER_ROWS = 3;
+
+static const GLuint SPRING_WORK_GROUP_SIZE = 256;
+
+// Buffers
+static GLuint g_offsetsSSBO = 0;   // Row starts, one per object plus the end
+static GLuint g_entriesSSBO = 0;   // Two SpringEntry per edge, grouped by row
+static GLuint g_snapshotSSBO = 0;  // (position, velocity) per object before the pass, then the solver's vectors
+
+// Network
+static int g_springCount = 0;
+static int g_numRows = 0;
+static bool g_restLengthsPending = false;  // Some rest length is still the current distance
+
+// Integration
+static bool g_implicit = false;
+static int g_iterations = 20;
+static float g_tolerance = 1e-4f;
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_passLoc = -1;
+static GLint g_numObjectsLoc = -1;
+static GLint g_numRowsLoc = -1;
+static GLint g_dtLoc = -1;
+static GLint g_adaptiveTimestepLoc = -1;
+static GLint g_numGroupsLoc = -1;
+static GLint g_toleranceLoc = -1;
+
+// Run a single pass over the objects
+static void DispatchPass(int pass, GLuint numObjects)
+{
+    glUniform1i(g_passLoc, pass);
+    glDispatchCompute((std::max(numObjects, 1u) + SPRING_WORK_GROUP_SIZE - 1) / SPRING_WORK_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// Run a pass that folds the per-group partial sums, in one work group
+static void DispatchSinglePass(int pass)
+{
+    glUniform1i(g_passLoc, pass);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// Per-edge value: its own, the single one for all, or the fallback
+static float EdgeValue(const std::vector<float>& values, size_t edge, float fallback)
+{
+    if (values.empty()) return fallback;
+    return values.size() == 1 ? values[0] : values[edge];
+}
+
+// ============================================================================
+// Start loading the shader (buffers follow the network)
+// ============================================================================
+bool SpringNetwork::Init()
+{
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "spring_network.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_passLoc = glGetUniformLocation(program, "uPass");
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_numRowsLoc = glGetUniformLocation(program, "uNumRows");
+                g_dtLoc = glGetUniformLocation(program, "uDt");
+                g_adaptiveTimestepLoc = glGetUniformLocation(program, "uAdaptiveTimestep");
+                g_numGroupsLoc = glGetUniformLocation(program, "uNumGroups");
+                g_toleranceLoc = glGetUniformLocation(program, "uTolerance");
+                g_ready = (g_passLoc != -1 && g_numRowsLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[SpringNetwork] spring_network.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+// ============================================================================
+// Edge list -> rows (counting sort, both directions) -> upload
+// ============================================================================
+void SpringNetwork::SetSprings(int numObjects, const std::vector<int>& endpoints, const std::vector<float>& stiffness,
+                               const std::vector<float>& damping, const std::vector<float>& restLength)
+{
+    size_t numEdges = endpoints.size() / 2;
+    std::vector<GLuint> offsets(static_cast<size_t>(numObjects) + 1, 0u);
+    for (size_t e = 0; e < numEdges; e++)
+    {
+        offsets[endpoints[2 * e] + 1]++;
+        offsets[endpoints[2 * e + 1] + 1]++;
+    }
+    for (int i = 0; i < numObjects; i++) offsets[i + 1] += offsets[i];
+
+    std::vector<SpringEntry> entries(2 * numEdges);
+    std::vector<GLuint> next(offsets.begin(), offsets.end() - 1);
+    bool restPending = false;
+    for (size_t e = 0; e < numEdges; e++)
+    {
+        int a = endpoints[2 * e], b = endpoints[2 * e + 1];
+        float rest = EdgeValue(restLength, e, -1.0f);
+        restPending |= rest < 0.0f;
+        float k = EdgeValue(stiffness, e, 0.0f), c = EdgeValue(damping, e, 0.0f);
+        entries[next[a]++] = SpringEntry{ b, rest, k, c };
+        entries[next[b]++] = SpringEntry{ a, rest, k, c };
+    }
+
+    g_springCount = static_cast<int>(numEdges);
+    g_numRows = numObjects;
+    g_restLengthsPending = restPending;
+    if (numEdges == 0) return;
+
+    BufferHelpers::EnsureBufferCapacity(g_offsetsSSBO, offsets.size() * sizeof(GLuint));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_offsetsSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, offsets.size() * sizeof(GLuint), offsets.data());
+    BufferHelpers::EnsureBufferCapacity(g_entriesSSBO, entries.size() * sizeof(SpringEntry));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_entriesSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, entries.size() * sizeof(SpringEntry), entries.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void SpringNetwork::Clear()
+{
+    g_springCount = 0;
+    g_numRows = 0;
+    g_restLengthsPending = false;
+}
+
+int SpringNetwork::GetSpringCount()
+{
+    return g_springCount;
+}
+
+void SpringNetwork::SetImplicit(bool enabled, int iterations, float tolerance)
+{
+    g_implicit = enabled;
+    g_iterations = std::max(1, iterations);
+    g_tolerance = std::max(0.0f, tolerance);
+}
+
+void SpringNetwork::GetImplicit(bool& enabled, int& iterations, float& tolerance)
+{
+    enabled = g_implicit;
+    iterations = g_iterations;
+    tolerance = g_tolerance;
+}
+
+// ============================================================================
+// Snapshot -> pending rest lengths -> impulses, or the backward Euler solve
+// ============================================================================
+bool SpringNetwork::Apply(GLuint objectSSBO, int numObjects, float dt, bool adaptiveTimestep)
+{
+    if (!g_ready || g_springCount == 0 || numObjects <= 0) return false;
+
+    // Implicit: the solver rows, one partial sum per work group and the scalars follow the snapshot
+    GLuint objects = static_cast<GLuint>(numObjects);
+    GLuint groups = (objects + SPRING_WORK_GROUP_SIZE - 1) / SPRING_WORK_GROUP_SIZE;
+    GLsizeiptr entries = g_implicit ? static_cast<GLsizeiptr>(numObjects) * (1 + SPRING_SOLVER_ROWS) + groups + 1
+                                    : static_cast<GLsizeiptr>(numObjects);
+    BufferHelpers::EnsureBufferCapacity(g_snapshotSSBO, entries * 4 * sizeof(float));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glUseProgram(g_program);
+    if (g_numObjectsLoc != -1) glUniform1i(g_numObjectsLoc, numObjects);
+    glUniform1i(g_numRowsLoc, std::min(g_numRows, numObjects));
+    if (g_dtLoc != -1) glUniform1f(g_dtLoc, dt);
+    if (g_adaptiveTimestepLoc != -1) glUniform1i(g_adaptiveTimestepLoc, adaptiveTimestep ? 1 : 0);
+    if (g_numGroupsLoc != -1) glUniform1i(g_numGroupsLoc, static_cast<GLint>(groups));
+    if (g_toleranceLoc != -1) glUniform1f(g_toleranceLoc, g_tolerance);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPRING_OFFSETS_BINDING, g_offsetsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPRING_ENTRIES_BINDING, g_entriesSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPRING_SNAPSHOT_BINDING, g_snapshotSSBO);
+
+    DispatchPass(SPRING_PASS_SNAPSHOT, objects);
+    if (g_restLengthsPending)
+    {
+        DispatchPass(SPRING_PASS_REST_LENGTHS, objects);
+        g_restLengthsPending = false;
+    }
+    if (!g_implicit)
+    {
+        DispatchPass(SPRING_PASS_APPLY, objects);
+    }
+    else
+    {
+        // A fixed number of iterations, so nothing is read back; converged ones do no work
+        DispatchPass(SPRING_PASS_IMPLICIT_INIT, objects);
+        DispatchSinglePass(SPRING_PASS_IMPLICIT_START);
+        for (int k = 0; k < g_iterations; k++)
+        {
+            DispatchPass(SPRING_PASS_IMPLICIT_PRODUCT, objects);
+            DispatchSinglePass(SPRING_PASS_IMPLICIT_ALPHA);
+            DispatchPass(SPRING_PASS_IMPLICIT_UPDATE, objects);
+            DispatchSinglePass(SPRING_PASS_IMPLICIT_BETA);
+            if (k + 1 < g_iterations) DispatchPass(SPRING_PASS_IMPLICIT_DIRECTION, objects);
+        }
+        DispatchPass(SPRING_PASS_IMPLICIT_APPLY, objects);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPRING_OFFSETS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPRING_ENTRIES_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPRING_SNAPSHOT_BINDING, 0);
+    glUseProgram(0);
+    return true;
+}
+
+// ============================================================================
+// Release buffers and the program
+// ============================================================================
+void SpringNetwork::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    GLuint* buffers[] = { &g_offsetsSSBO, &g_entriesSSBO, &g_snapshotSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    Clear();
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void SpringNetwork::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool SpringNetwork::IsReady()
+{
+    return g_ready;
+}
+
+std::string SpringNetwork::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[spring network] " + g_loader.GetStatusMessage();
+    return "Spring network shader ready";
+}
@@ -0,0 +1,153 @@
+#include "state_registers.h"
+#include "buffer_helpers.h"
+#include "object_reorder.h"
+#include <algorithm>
+#include <iostream>
+
+static const GLsizeiptr ROW_SIZE = STATE_REGISTER_COUNT * sizeof(float);
+
+// Buffer and the r32f buffer texture math.comp binds as an image
+static GLuint g_stateBuffer = 0;
+static GLuint g_stateTexture = 0;
+static int g_maxObjects = 0;
+
+// Host edits land after the steps already submitted have stored their rows
+static void WaitForShaderWrites()
+{
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+// ============================================================================
+// Initialize the buffer and its buffer texture
+// ============================================================================
+bool StateRegisters::Init(int maxObjects)
+{
+    return Reserve(maxObjects);
+}
+
+bool StateRegisters::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    if (g_stateBuffer) WaitForShaderWrites();  // The rows are copied into the grown buffer
+    g_maxObjects = maxObjects;
+
+    // Zeroes the new rows, so objects start with every register at 0
+    bool grown = BufferHelpers::EnsureBufferCapacity(g_stateBuffer, static_cast<GLsizeiptr>(maxObjects) * ROW_SIZE);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // A grown buffer is a new buffer object, so the texture is re-attached
+    if (g_stateTexture == 0) glGenTextures(1, &g_stateTexture);
+    if (grown)
+    {
+        glBindTexture(GL_TEXTURE_BUFFER, g_stateTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, g_stateBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[StateRegisters] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Host edits and reads
+// ============================================================================
+void StateRegisters::Set(int index, int first, const float* values, int count)
+{
+    if (index < 0 || index >= g_maxObjects || first < 0) return;
+    count = std::min(count, STATE_REGISTER_COUNT - first);
+    if (count <= 0) return;
+
+    WaitForShaderWrites();
+    glBindBuffer(GL_TEXTURE_BUFFER, g_stateBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, index * ROW_SIZE + first * sizeof(float), count * sizeof(float), values);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void StateRegisters::Get(int index, float* out)
+{
+    std::fill(out, out + STATE_REGISTER_COUNT, 0.0f);
+    if (index < 0 || index >= g_maxObjects) return;
+
+    WaitForShaderWrites();
+    glBindBuffer(GL_TEXTURE_BUFFER, g_stateBuffer);
+    glGetBufferSubData(GL_TEXTURE_BUFFER, index * ROW_SIZE, ROW_SIZE, out);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void StateRegisters::Clear(int first, int count)
+{
+    first = std::max(first, 0);
+    count = std::min(count, g_maxObjects - first);
+    if (count <= 0) return;
+
+    WaitForShaderWrites();
+    float zero = 0.0f;
+    glBindBuffer(GL_TEXTURE_BUFFER, g_stateBuffer);
+    glClearBufferSubData(GL_TEXTURE_BUFFER, GL_R32F, first * ROW_SIZE, count * ROW_SIZE, GL_RED, GL_FLOAT, &zero);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void StateRegisters::Move(int to, int from)
+{
+    if (to == from || to < 0 || from < 0 || to >= g_maxObjects || from >= g_maxObjects) return;
+
+    WaitForShaderWrites();
+    glBindBuffer(GL_COPY_READ_BUFFER, g_stateBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, g_stateBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from * ROW_SIZE, to * ROW_SIZE, ROW_SIZE);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    Clear(from);
+}
+
+void StateRegisters::Copy(int to, int from, int count)
+{
+    if (count <= 0 || to < 0 || from < 0 || to + count > g_maxObjects || from + count > g_maxObjects) return;
+
+    WaitForShaderWrites();
+    glBindBuffer(GL_COPY_READ_BUFFER, g_stateBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, g_stateBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from * ROW_SIZE, to * ROW_SIZE, count * ROW_SIZE);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void StateRegisters::Permute(int count)
+{
+    count = std::min(count, g_maxObjects);
+    if (count <= 0) return;
+    WaitForShaderWrites();
+    ObjectReorder::Permute(g_stateBuffer, ROW_SIZE, count);
+}
+
+// ============================================================================
+// Per step
+// ============================================================================
+void StateRegisters::Bind()
+{
+    if (g_stateTexture == 0) return;
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);  // Rows the previous step stored
+    glBindImageTexture(STATE_REGISTERS_IMAGE_UNIT, g_stateTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32F);
+}
+
+void StateRegisters::Unbind()
+{
+    glBindImageTexture(STATE_REGISTERS_IMAGE_UNIT, 0, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32F);
+}
+
+// ============================================================================
+// Release the buffer and texture
+// ============================================================================
+void StateRegisters::Cleanup()
+{
+    if (g_stateTexture) glDeleteTextures(1, &g_stateTexture);
+    if (g_stateBuffer) glDeleteBuffers(1, &g_stateBuffer);
+    g_stateTexture = 0;
+    g_stateBuffer = 0;
+    g_maxObjects = 0;
+}
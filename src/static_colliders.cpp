@@ -0,0 +1,294 @@
+#include "static_colliders.h"
+#include "object_gather.h"
+#include "objects.h"
+#include "buffer_helpers.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+static const size_t MAX_GRID_CELLS = 1u << 20;     // Cells beyond this grow the cell size instead
+static const size_t MAX_GRID_ENTRIES = 1u << 22;   // Same for (object, cell) entries
+
+// Mask: one bit per object, the host copy is authoritative
+static GLuint g_maskBuffer = 0;
+static GLuint g_maskTexture = 0;
+static std::vector<uint32_t> g_mask;
+static int g_maxObjects = 0;
+static int g_count = 0;
+static bool g_maskDirty = false;
+
+// Grid, rebuilt when invalidated
+static GLuint g_gridBuffer = 0;
+static GLuint g_gridTexture = 0;
+static bool g_gridDirty = true;
+static glm::vec4 g_gridUniform(0.0f);  // origin xy, cell size, entry offset
+static glm::ivec2 g_gridCells(0);
+
+static void AttachTexture(GLuint& texture, GLuint buffer, int unit)
+{
+    if (texture == 0) glGenTextures(1, &texture);
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// ============================================================================
+// Initialize the mask and an empty grid
+// ============================================================================
+bool StaticColliders::Init(int maxObjects)
+{
+    if (g_gridBuffer == 0)
+    {
+        BufferHelpers::EnsureBufferCapacity(g_gridBuffer, sizeof(GLuint), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        AttachTexture(g_gridTexture, g_gridBuffer, STATIC_GRID_TEXTURE_UNIT);
+    }
+    return Reserve(maxObjects);
+}
+
+bool StaticColliders::Reserve(int maxObjects)
+{
+    if (maxObjects <= g_maxObjects) return true;
+    g_maxObjects = maxObjects;
+    size_t words = (static_cast<size_t>(maxObjects) + 31) / 32;
+    g_mask.resize(words, 0u);
+
+    // A grown buffer is a new buffer object, so the texture is re-attached
+    BufferHelpers::EnsureBufferCapacity(g_maskBuffer, static_cast<GLsizeiptr>(words * sizeof(uint32_t)), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    AttachTexture(g_maskTexture, g_maskBuffer, STATIC_MASK_TEXTURE_UNIT);
+    g_maskDirty = true;
+
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR)
+    {
+        std::cerr << "[StaticColliders] Failed to allocate buffers (GL error " << err << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Host edits
+// ============================================================================
+void StaticColliders::Set(int index, bool isStatic)
+{
+    if (index < 0 || index >= g_maxObjects || IsStatic(index) == isStatic) return;
+    uint32_t bit = 1u << (index & 31);
+    if (isStatic) g_mask[index >> 5] |= bit;
+    else g_mask[index >> 5] &= ~bit;
+    g_count += isStatic ? 1 : -1;
+    g_maskDirty = true;
+    g_gridDirty = true;
+}
+
+bool StaticColliders::IsStatic(int index)
+{
+    if (index < 0 || index >= g_maxObjects) return false;
+    return (g_mask[index >> 5] & (1u << (index & 31))) != 0u;
+}
+
+int StaticColliders::GetCount()
+{
+    return g_count;
+}
+
+void StaticColliders::Clear(int index)
+{
+    Set(index, false);
+}
+
+void StaticColliders::Move(int to, int from)
+{
+    if (to == from || to < 0 || from < 0 || to >= g_maxObjects || from >= g_maxObjects) return;
+    bool isStatic = IsStatic(from);
+    Clear(from);
+    Set(to, isStatic);
+}
+
+void StaticColliders::Permute(const std::vector<int>& order)
+{
+    int count = std::min(static_cast<int>(order.size()), g_maxObjects);
+    if (count == 0 || g_count == 0) return;
+    std::vector<uint32_t> old(g_mask);
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t bit = 1u << (i & 31);
+        int from = order[i];
+        if (old[from >> 5] & (1u << (from & 31))) g_mask[i >> 5] |= bit;
+        else g_mask[i >> 5] &= ~bit;
+    }
+    g_maskDirty = true;
+    g_gridDirty = true;
+}
+
+void StaticColliders::Invalidate()
+{
+    g_gridDirty = true;
+}
+
+// ============================================================================
+// Bin the boxes of the static objects into a uniform grid
+// ============================================================================
+bool StaticColliders::Update(GLuint objectSSBO, const CollisionProperties* props, int numObjects)
+{
+    if (!g_gridDirty) return g_gridUniform.z > 0.0f;
+    if (!ObjectGather::IsReady()) return false;
+    g_gridDirty = false;
+    g_gridUniform = glm::vec4(0.0f);
+    g_gridCells = glm::ivec2(0);
+
+    std::vector<int> indices;
+    numObjects = std::min(numObjects, g_maxObjects);
+    for (int i = 0; i < numObjects && g_count > 0; i++)
+        if (IsStatic(i) && props[i].enabled != 0 && props[i].shapeType != COLLISION_NONE) indices.push_back(i);
+    if (indices.empty()) return false;
+
+    std::vector<float> fields;  // x, y, size x, size y
+    if (!ObjectGather::Gather(objectSSBO, indices, OBJECT_FIELD_POSITION | OBJECT_FIELD_SIZE, fields))
+    {
+        g_gridDirty = true;
+        return false;
+    }
+
+    // Boxes as collide.comp's collisionAABB builds them
+    struct Box { glm::vec2 lo, hi; int index; };
+    std::vector<Box> boxes;
+    std::vector<float> diameters;
+    glm::vec2 lo(INFINITY), hi(-INFINITY);
+    for (size_t n = 0; n < indices.size(); n++)
+    {
+        const float* f = &fields[4 * n];
+        glm::vec2 position(f[0], f[1]);
+        glm::vec2 halfExtent = props[indices[n]].shapeType == COLLISION_AABB
+            ? glm::abs(glm::vec2(f[2], f[3])) * 0.5f
+            : glm::vec2(std::fabs(f[2]));
+        if (!std::isfinite(position.x) || !std::isfinite(position.y) ||
+            !std::isfinite(halfExtent.x) || !std::isfinite(halfExtent.y)) continue;
+        boxes.push_back({ position - halfExtent, position + halfExtent, indices[n] });
+        diameters.push_back(2.0f * std::max(halfExtent.x, halfExtent.y));
+        lo = glm::min(lo, position - halfExtent);
+        hi = glm::max(hi, position + halfExtent);
+    }
+    if (boxes.empty()) return false;
+
+    // Cells about as wide as a typical static object, so most land in one to four cells;
+    // grown while the grid or the entry list would get too large
+    std::nth_element(diameters.begin(), diameters.begin() + diameters.size() / 2, diameters.end());
+    glm::vec2 extent = glm::max(hi - lo, glm::vec2(1e-6f));
+    float cellSize = std::max(diameters[diameters.size() / 2], std::max(extent.x, extent.y) * 1e-4f);
+    glm::ivec2 cells;
+    size_t entries = 0;
+    auto cellOf = [&](glm::vec2 v) {
+        return glm::clamp(glm::ivec2(glm::floor((v - lo) / cellSize)), glm::ivec2(0), cells - 1);
+    };
+    for (;;)
+    {
+        cells = glm::ivec2(glm::floor(extent / cellSize)) + 1;
+        entries = 0;
+        if (static_cast<size_t>(cells.x) * cells.y <= MAX_GRID_CELLS)
+        {
+            for (const Box& box : boxes)
+            {
+                glm::ivec2 span = cellOf(box.hi) - cellOf(box.lo) + 1;
+                entries += static_cast<size_t>(span.x) * span.y;
+            }
+            if (entries <= MAX_GRID_ENTRIES) break;
+        }
+        cellSize *= 2.0f;
+    }
+
+    // Counting sort into [offsets of cells + 1][entries]
+    size_t cellCount = static_cast<size_t>(cells.x) * cells.y;
+    std::vector<uint32_t> grid(cellCount + 1 + entries, 0u);
+    for (const Box& box : boxes)
+    {
+        glm::ivec2 a = cellOf(box.lo), b = cellOf(box.hi);
+        for (int y = a.y; y <= b.y; y++)
+            for (int x = a.x; x <= b.x; x++) grid[static_cast<size_t>(y) * cells.x + x + 1]++;
+    }
+    for (size_t c = 0; c < cellCount; c++) grid[c + 1] += grid[c];
+    std::vector<uint32_t> cursor(grid.begin(), grid.begin() + cellCount);
+    for (const Box& box : boxes)
+    {
+        glm::ivec2 a = cellOf(box.lo), b = cellOf(box.hi);
+        for (int y = a.y; y <= b.y; y++)
+            for (int x = a.x; x <= b.x; x++)
+                grid[cellCount + 1 + cursor[static_cast<size_t>(y) * cells.x + x]++] = static_cast<uint32_t>(box.index);
+    }
+
+    if (BufferHelpers::EnsureBufferCapacity(g_gridBuffer, static_cast<GLsizeiptr>(grid.size() * sizeof(uint32_t)), GL_DYNAMIC_DRAW))
+        AttachTexture(g_gridTexture, g_gridBuffer, STATIC_GRID_TEXTURE_UNIT);
+    glBindBuffer(GL_TEXTURE_BUFFER, g_gridBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, static_cast<GLsizeiptr>(grid.size() * sizeof(uint32_t)), grid.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    g_gridUniform = glm::vec4(lo, cellSize, static_cast<float>(cellCount + 1));
+    g_gridCells = cells;
+    std::cout << "[StaticColliders] " << boxes.size() << " static objects in a " << cells.x << "x" << cells.y
+              << " grid (" << entries << " entries)" << std::endl;
+    return true;
+}
+
+// ============================================================================
+// Upload the mask and bind both textures
+// ============================================================================
+void StaticColliders::Bind()
+{
+    if (g_maskTexture == 0) return;
+
+    if (g_maskDirty)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, g_maskBuffer);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, static_cast<GLsizeiptr>(g_mask.size() * sizeof(uint32_t)), g_mask.data());
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        g_maskDirty = false;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + STATIC_MASK_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_maskTexture);
+    glActiveTexture(GL_TEXTURE0 + STATIC_GRID_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_gridTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+glm::vec4 StaticColliders::GetGridUniform()
+{
+    return g_gridUniform;
+}
+
+glm::ivec2 StaticColliders::GetGridCells()
+{
+    return g_gridCells;
+}
+
+// ============================================================================
+// Release the buffers and textures
+// ============================================================================
+void StaticColliders::Cleanup()
+{
+    GLuint* textures[] = { &g_maskTexture, &g_gridTexture };
+    for (GLuint* texture : textures)
+    {
+        if (*texture) glDeleteTextures(1, texture);
+        *texture = 0;
+    }
+    GLuint* buffers[] = { &g_maskBuffer, &g_gridBuffer };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_mask.clear();
+    g_maxObjects = 0;
+    g_count = 0;
+    g_maskDirty = false;
+    g_gridDirty = true;
+    g_gridUniform = glm::vec4(0.0f);
+    g_gridCells = glm::ivec2(0);
+}
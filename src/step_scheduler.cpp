@@ -0,0 +1,123 @@
+#include "step_scheduler.h"
+#include <algorithm>
+#include <cmath>
+
+// Enough queries in flight that the oldest has landed by the time its slot comes round again
+static const int TIMER_QUERIES = 4;
+
+static GLuint g_queries[TIMER_QUERIES] = { 0 };
+static int g_steps[TIMER_QUERIES] = { 0 };  // Steps a query in flight covers, 0 = slot free
+static int g_slot = 0;
+static bool g_timing = false;  // BeginSteps started a query
+
+static float g_budget = 0.0f;
+static int g_maxSteps = StepScheduler::DEFAULT_MAX_STEPS;
+static float g_maxLag = 0.0f;
+static float g_stepTime = 0.0f;
+
+static void AddSample(double milliseconds, int steps)
+{
+    if (steps <= 0) return;
+    float perStep = static_cast<float>(milliseconds / steps);
+    g_stepTime = g_stepTime > 0.0f ? g_stepTime * 0.8f + perStep * 0.2f : perStep;
+}
+
+// ============================================================================
+// Timer queries
+// ============================================================================
+void StepScheduler::Cleanup()
+{
+    if (g_queries[0]) glDeleteQueries(TIMER_QUERIES, g_queries);
+    std::fill(g_queries, g_queries + TIMER_QUERIES, 0u);
+    std::fill(g_steps, g_steps + TIMER_QUERIES, 0);
+    g_slot = 0;
+    g_timing = false;
+    g_stepTime = 0.0f;
+}
+
+void StepScheduler::BeginSteps()
+{
+    g_timing = false;
+    if (g_queries[0] == 0) glGenQueries(TIMER_QUERIES, g_queries);
+
+    // Collect the result this slot holds; a query still in flight keeps the slot and these
+    // steps go untimed
+    if (g_steps[g_slot] > 0)
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(g_queries[g_slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(g_queries[g_slot], GL_QUERY_RESULT, &elapsed);
+        AddSample(static_cast<double>(elapsed) * 1e-6, g_steps[g_slot]);
+        g_steps[g_slot] = 0;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, g_queries[g_slot]);
+    g_timing = true;
+}
+
+void StepScheduler::EndSteps(int steps)
+{
+    if (!g_timing) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    g_timing = false;
+    if (steps <= 0) return;  // Nothing to time; the slot is reused by the next update
+    g_steps[g_slot] = steps;
+    g_slot = (g_slot + 1) % TIMER_QUERIES;
+}
+
+void StepScheduler::AddHostSample(double milliseconds, int steps)
+{
+    AddSample(milliseconds, steps);
+}
+
+// ============================================================================
+// Scheduling
+// ============================================================================
+int StepScheduler::StepsAllowed(int pending)
+{
+    int steps = std::min(pending, g_maxSteps);
+    if (steps <= 0 || g_budget <= 0.0f || g_stepTime <= 0.0f) return std::max(steps, 0);
+    int fit = static_cast<int>(std::floor(g_budget / g_stepTime));
+    return std::clamp(fit, 1, steps);
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+void StepScheduler::SetBudget(float milliseconds)
+{
+    g_budget = (milliseconds > 0.0f && std::isfinite(milliseconds)) ? milliseconds : 0.0f;
+}
+
+float StepScheduler::GetBudget()
+{
+    return g_budget;
+}
+
+void StepScheduler::SetMaxSteps(int steps)
+{
+    g_maxSteps = std::max(steps, 1);
+}
+
+int StepScheduler::GetMaxSteps()
+{
+    return g_maxSteps;
+}
+
+void StepScheduler::SetMaxLag(float seconds)
+{
+    g_maxLag = (seconds > 0.0f && std::isfinite(seconds)) ? seconds : 0.0f;
+}
+
+float StepScheduler::GetMaxLag()
+{
+    return g_maxLag;
+}
+
+float StepScheduler::GetStepTime()
+{
+    return g_stepTime;
+}
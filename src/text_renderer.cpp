@@ -1,4 +1,197 @@
 #include "text_renderer.h"
+#include "shader_utils.h"
+#include "embedded_shaders.h"
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
 
-// Empty implementation for Python module
-// All methods are inline in header
\ No newline at end of file
+// Built-in 5x7 font: one byte per row, the low 5 bits left to right
+static const int GLYPH_WIDTH = 5;
+static const int GLYPH_HEIGHT = 7;
+static const int GLYPH_ADVANCE = 6;   // Glyph plus a column of spacing
+static const int LINE_HEIGHT = 8;
+static const int ATLAS_PADDING = 1;   // Empty texels between cells so sampling never bleeds
+
+struct BitmapGlyph {
+    char c;
+    uint8_t rows[GLYPH_HEIGHT];
+};
+
+static const BitmapGlyph FONT[] = {
+    { '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+    { '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+    { '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+    { '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+    { '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+    { '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+    { '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+    { '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+    { '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+    { '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+    { '+', { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 } },
+    { '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+    { 'e', { 0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E } },
+};
+static const int FONT_GLYPHS = sizeof(FONT) / sizeof(FONT[0]);
+
+TextRenderer::TextRenderer(unsigned int fontSize) {
+    pixelSize = static_cast<float>(fontSize) / LINE_HEIGHT;
+    InitShaders();
+    BuildAtlas();
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+TextRenderer::~TextRenderer() {
+    if (VAO) glDeleteVertexArrays(1, &VAO);
+    if (VBO) glDeleteBuffers(1, &VBO);
+    if (atlasTexture) glDeleteTextures(1, &atlasTexture);
+    if (shaderProgram) glDeleteProgram(shaderProgram);
+}
+
+// ============================================================================
+// Atlas: every glyph in one row of padded cells of a single-channel texture
+// ============================================================================
+void TextRenderer::BuildAtlas() {
+    const int cellWidth = GLYPH_WIDTH + ATLAS_PADDING;
+    const int cellHeight = GLYPH_HEIGHT + 2 * ATLAS_PADDING;
+    const int atlasWidth = FONT_GLYPHS * cellWidth + ATLAS_PADDING;
+    const int atlasHeight = cellHeight;
+
+    std::vector<uint8_t> texels(atlasWidth * atlasHeight, 0);
+    for (int g = 0; g < FONT_GLYPHS; g++) {
+        int x0 = ATLAS_PADDING + g * cellWidth;
+        int y0 = ATLAS_PADDING;
+        for (int row = 0; row < GLYPH_HEIGHT; row++)
+            for (int col = 0; col < GLYPH_WIDTH; col++)
+                if (FONT[g].rows[row] & (1 << (GLYPH_WIDTH - 1 - col)))
+                    texels[(y0 + row) * atlasWidth + x0 + col] = 255;
+
+        Character ch;
+        ch.uvMin = glm::vec2(float(x0) / atlasWidth, float(y0) / atlasHeight);
+        ch.uvMax = glm::vec2(float(x0 + GLYPH_WIDTH) / atlasWidth, float(y0 + GLYPH_HEIGHT) / atlasHeight);
+        ch.size = glm::ivec2(GLYPH_WIDTH, GLYPH_HEIGHT);
+        ch.bearing = glm::ivec2(0, 0);
+        ch.advance = GLYPH_ADVANCE;
+        Characters[FONT[g].c] = ch;
+    }
+
+    glGenTextures(1, &atlasTexture);
+    glBindTexture(GL_TEXTURE_2D, atlasTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlasWidth, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void TextRenderer::InitShaders() {
+    std::string vert, frag, hash;
+    if (!LoadShaderSource("text.vert", vert, hash) || !LoadShaderSource("text.frag", frag, hash))
+        throw std::runtime_error("Text shaders not found");
+
+    shaderProgram = CreateProgram(vert.c_str(), nullptr, frag.c_str());
+    if (!shaderProgram)
+        throw std::runtime_error("Text shader program failed to link");
+
+    viewportLoc = glGetUniformLocation(shaderProgram, "uViewport");
+    atlasLoc = glGetUniformLocation(shaderProgram, "uAtlas");
+}
+
+// ============================================================================
+// Batching
+// ============================================================================
+void TextRenderer::AddText(const std::string& text, float x, float y,
+    float scale, glm::vec3 color, float alpha) {
+    float unit = pixelSize * scale;
+    glm::vec4 rgba(color, alpha);
+    float penX = x;
+    // Glyphs sit centred in the line height
+    float top = y + (LINE_HEIGHT - GLYPH_HEIGHT) * 0.5f * unit;
+
+    for (char c : text) {
+        auto it = Characters.find(c);
+        if (it == Characters.end()) {
+            penX += GLYPH_ADVANCE * unit;
+            continue;
+        }
+        const Character& ch = it->second;
+
+        float x0 = penX + ch.bearing.x * unit;
+        float y0 = top + ch.bearing.y * unit;
+        float x1 = x0 + ch.size.x * unit;
+        float y1 = y0 + ch.size.y * unit;
+
+        Vertex quad[6] = {
+            { { x0, y0 }, { ch.uvMin.x, ch.uvMin.y }, rgba },
+            { { x1, y0 }, { ch.uvMax.x, ch.uvMin.y }, rgba },
+            { { x1, y1 }, { ch.uvMax.x, ch.uvMax.y }, rgba },
+            { { x0, y0 }, { ch.uvMin.x, ch.uvMin.y }, rgba },
+            { { x1, y1 }, { ch.uvMax.x, ch.uvMax.y }, rgba },
+            { { x0, y1 }, { ch.uvMin.x, ch.uvMax.y }, rgba },
+        };
+        batch.insert(batch.end(), quad, quad + 6);
+        penX += ch.advance * unit;
+    }
+}
+
+void TextRenderer::Flush(float windowWidth, float windowHeight) {
+    if (batch.empty()) return;
+
+    // Grow the buffer to the largest batch seen; smaller batches only rewrite the front
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    if (batch.size() > capacity) {
+        capacity = batch.size();
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, batch.size() * sizeof(Vertex), batch.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glUseProgram(shaderProgram);
+    glUniform2f(viewportLoc, windowWidth, windowHeight);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, atlasTexture);
+    if (atlasLoc != -1) glUniform1i(atlasLoc, 0);
+
+    glBindVertexArray(VAO);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)batch.size());
+    glBindVertexArray(0);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+    if (!blend) glDisable(GL_BLEND);
+
+    batch.clear();
+}
+
+void TextRenderer::RenderText(const std::string& text, float x, float y,
+    float scale, glm::vec3 color, float alpha,
+    float windowWidth, float windowHeight) {
+    AddText(text, x, y, scale, color, alpha);
+    Flush(windowWidth, windowHeight);
+}
+
+glm::vec2 TextRenderer::MeasureText(const std::string& text, float scale) const {
+    float unit = pixelSize * scale;
+    float width = text.empty() ? 0.0f : (text.size() * GLYPH_ADVANCE - (GLYPH_ADVANCE - GLYPH_WIDTH)) * unit;
+    return glm::vec2(width, LINE_HEIGHT * unit);
+}
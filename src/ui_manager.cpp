@@ -1,16 +1,20 @@
 // ui_manager.cpp
 #include "ui_manager.h"
 #include "renderer.h"
+#include "simulation_thread.h"
 #include "globals.h"
 #include "objects.h"
 #include "physics_system.h"
 #include "parser.h"
 #include "debug_helpers.h"
 #include "gpu_serializer.h"
+#include "resolution_scaler.h"
+#include "phase_space.h"
 #include "imgui.h"
 #include "imgui_stdlib.h"
 #include "../lib/ImGuiFileDialog/ImGuiFileDialog.h"
 #include <vector>
+#include <numeric>
 #include <iostream>
 #include <map>
 #include <fstream>
@@ -48,6 +52,15 @@ static const char* CollisionTypeNames[] = {
     "Rectangle",
     "Polygon" };
 
+// Order of PhaseSpace::Variable
+static const char* PhaseVariableNames[] = {
+    "x",
+    "y",
+    "vx",
+    "vy",
+    "theta",
+    "omega" };
+
 // UI State
 static std::string userEquation = presetEquations[0];
 static bool equationUpdated = true;
@@ -64,6 +77,11 @@ static std::string saveTitle = "Untitled Project";
 static std::string saveAuthor = "";
 static std::string saveDescription = "";
 
+// Object snapshot shared by every panel in a frame. It is refreshed from a non-blocking readback
+// queued the frame before, so the list may trail the simulation by a frame or two.
+static std::vector<Object> objectSnapshot;
+static int objectSnapshotReadback = -1;
+
 // Constraints
 std::map<int, std::vector<ConstraintWidget>> UIManager::objectConstraintWidgets;
 
@@ -71,6 +89,20 @@ std::map<int, std::vector<ConstraintWidget>> UIManager::objectConstraintWidgets;
 // HELPER FUNCTIONS FOR FILE OPERATIONS
 // ============================================================================
 
+// Swap in the readback queued last frame once it is ready and queue the next one
+static void RefreshObjectSnapshot()
+{
+    if (objectSnapshotReadback != -1 && Objects::ResolveReadback(objectSnapshotReadback, objectSnapshot, false))
+        objectSnapshotReadback = -1;
+    if (objectSnapshotReadback == -1)
+        objectSnapshotReadback = Objects::BeginReadback(Renderer::GetCurrentObjectBuffer());
+
+    // Objects removed since the copy was queued must not stay selectable
+    int numObjects = Objects::GetNumObjects();
+    if ((int)objectSnapshot.size() > numObjects)
+        objectSnapshot.resize(numObjects);
+}
+
 // Helper to add a object from loaded data
 static void AddObjectFromLoadedData(const Object& objectData, int skinType)
 {
@@ -224,10 +256,9 @@ static bool LoadProject(const std::string& filepath)
 
         // Clear current simulation
         Objects::ResetToInitialConditions();
-        while (Objects::GetNumObjects() > 0)
-        {
-            Objects::RemoveObject(0);
-        }
+        std::vector<int> existing(Objects::GetNumObjects());
+        std::iota(existing.begin(), existing.end(), 0);
+        Objects::RemoveObjects(existing);
 
         // Clear UI state
         selectedObjectIndex = -1;
@@ -440,16 +471,14 @@ static bool LoadProject(const std::string& filepath)
         }
 
         // Initialize equations for loaded objects
-        std::vector<Object> objects;
-        Objects::FetchToCPU(Renderer::GetCurrentObjectBuffer(), objects);
-
-        for (size_t i = 0; i < objects.size(); ++i)
+        int numObjects = Objects::GetNumObjects();
+        for (int i = 0; i < numObjects; ++i)
         {
             objectEquations[i] = presetEquations[0];
             objectPresets[i] = 0;
         }
 
-        std::cout << "[UI] Successfully loaded " << objects.size()
+        std::cout << "[UI] Successfully loaded " << numObjects
             << " objects from " << filepath << std::endl;
 
         return true;
@@ -485,6 +514,8 @@ void UIManager::Initialize()
 
 void UIManager::RenderMainUI()
 {
+    RefreshObjectSnapshot();
+
     // Render menu bar
     if (ImGui::BeginMainMenuBar())
     {
@@ -494,10 +525,9 @@ void UIManager::RenderMainUI()
             {
                 // Reset simulation to empty state
                 Objects::ResetToInitialConditions();
-                while (Objects::GetNumObjects() > 0)
-                {
-                    Objects::RemoveObject(0);
-                }
+                std::vector<int> existing(Objects::GetNumObjects());
+                std::iota(existing.begin(), existing.end(), 0);
+                Objects::RemoveObjects(existing);
                 g_physics.globalTime = 0.0f;
                 g_camera.Reset();
 
@@ -711,6 +741,37 @@ void UIManager::RenderPhaseSpaceView()
         return;
 
     ImGui::Begin("Phase Space");
+
+    // Plot settings; the variables and the window clear the density when they change
+    int q, p;
+    PhaseSpace::GetVariables(q, p);
+    ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x * 0.3f);
+    bool variablesChanged = ImGui::Combo("q", &q, PhaseVariableNames, PhaseSpace::PHASE_VARIABLE_COUNT);
+    ImGui::SameLine();
+    variablesChanged |= ImGui::Combo("p", &p, PhaseVariableNames, PhaseSpace::PHASE_VARIABLE_COUNT);
+    if (variablesChanged)
+        PhaseSpace::SetVariables(q, p);
+    ImGui::SameLine();
+    if (ImGui::Button("Clear"))
+        PhaseSpace::Clear();
+
+    float window[4];
+    PhaseSpace::GetWindow(window[0], window[1], window[2], window[3]);
+    bool windowChanged = ImGui::DragFloat2("q range", &window[0], 0.05f);
+    ImGui::SameLine();
+    windowChanged |= ImGui::DragFloat2("p range", &window[2], 0.05f);
+    if (windowChanged)
+        PhaseSpace::SetWindow(window[0], window[1], window[2], window[3]);  // Ignored while empty
+
+    float decay = PhaseSpace::GetDecay();
+    if (ImGui::SliderFloat("Decay", &decay, 0.0f, 1.0f, "%.3f"))
+        PhaseSpace::SetDecay(decay);
+    ImGui::SameLine();
+    float exposure = PhaseSpace::GetExposure();
+    if (ImGui::SliderFloat("Exposure", &exposure, 0.1f, 64.0f, "%.1f", ImGuiSliderFlags_Logarithmic))
+        PhaseSpace::SetExposure(exposure);
+    ImGui::PopItemWidth();
+
     ImVec2 phaseSpaceSize = ImGui::GetContentRegionAvail();
     if (phaseSpaceSize.x <= 0)
         phaseSpaceSize.x = 640;
@@ -848,15 +909,17 @@ void UIManager::RenderObjectsTab()
     ImGui::Text("Scene Objects");
     ImGui::Spacing();
 
-    std::vector<Object> currentCpuObjects;
-    Objects::FetchToCPU(Renderer::GetCurrentObjectBuffer(), currentCpuObjects);
-
-    if (!currentCpuObjects.empty())
+    if (!objectSnapshot.empty())
     {
         ImGui::BeginChild("ObjectList", ImVec2(0, -40), true);
 
-        for (size_t i = 0; i < currentCpuObjects.size(); ++i)
+        // Only the rows in view are built
+        ImGuiListClipper clipper;
+        clipper.Begin((int)objectSnapshot.size());
+        while (clipper.Step())
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
         {
+            const Object& object = objectSnapshot[i];
             ImGui::PushID(i);
 
             bool isSelected = (selectedObjectIndex == (int)i);
@@ -869,11 +932,11 @@ void UIManager::RenderObjectsTab()
             }
 
             char label[64];
-            sprintf(label, "Object %zu", i);
+            sprintf(label, "Object %d", i);
 
             if (ImGui::Selectable(label, isSelected, 0, ImVec2(0, 0)))
             {
-                selectedObjectIndex = (int)i;
+                selectedObjectIndex = i;
             }
 
             if (isSelected)
@@ -883,17 +946,17 @@ void UIManager::RenderObjectsTab()
 
             // Show skin type icon
             const char* skinIcon = "●"; // Circle
-            if (currentCpuObjects[i].visualSkinType == SKIN_RECTANGLE)
+            if (object.visualSkinType == SKIN_RECTANGLE)
                 skinIcon = "■";
-            else if (currentCpuObjects[i].visualSkinType == SKIN_POLYGON)
+            else if (object.visualSkinType == SKIN_POLYGON)
                 skinIcon = "⬡";
 
-            ImGui::TextDisabled("%s %s", skinIcon, SkinTypeNames[currentCpuObjects[i].visualSkinType]);
+            ImGui::TextDisabled("%s %s", skinIcon, SkinTypeNames[object.visualSkinType]);
 
             ImGui::SameLine(ImGui::GetContentRegionAvail().x - 90);
             ImGui::TextDisabled("(%.1f, %.1f)",
-                currentCpuObjects[i].position.x,
-                currentCpuObjects[i].position.y);
+                object.position.x,
+                object.position.y);
 
             ImGui::PopID();
         }
@@ -931,10 +994,17 @@ void UIManager::RenderObjectsTab()
 
 void UIManager::RenderPropertiesTab()
 {
-    std::vector<Object> currentCpuObjects;
-    Objects::FetchToCPU(Renderer::GetCurrentObjectBuffer(), currentCpuObjects);
+    if (selectedObjectIndex == -1 || selectedObjectIndex >= Objects::GetNumObjects())
+    {
+        ImGui::Text("No object selected");
+        return;
+    }
 
-    if (selectedObjectIndex == -1 || (size_t)selectedObjectIndex >= currentCpuObjects.size())
+    // Edits write the whole object back, so the selected one is read fresh rather than from the
+    // snapshot; a single object is cheap to fetch
+    std::vector<Object> selectedObject;
+    Objects::FetchToCPU(Renderer::GetCurrentObjectBuffer(), selectedObjectIndex, 1, selectedObject);
+    if (selectedObject.empty())
     {
         ImGui::Text("No object selected");
         return;
@@ -951,7 +1021,7 @@ void UIManager::RenderPropertiesTab()
         lastSelectedObjectIndex = selectedObjectIndex;
     }
 
-    Object p_copy = currentCpuObjects[selectedObjectIndex];
+    Object p_copy = selectedObject[0];
 
     ImGui::Spacing();
     ImGui::Text("Editing Object %d", selectedObjectIndex);
@@ -1255,7 +1325,7 @@ void UIManager::RenderPropertiesTab()
     ImGui::Text("Motion Equation");
     ImGui::Spacing();
 
-    ImGui::TextDisabled("Equation ID: %d", currentCpuObjects[selectedObjectIndex].equationID);
+    ImGui::TextDisabled("Equation ID: %d", selectedObject[0].equationID);
     ImGui::Spacing();
 
     ImGui::Text("Preset");
@@ -1302,13 +1372,13 @@ void UIManager::RenderPropertiesTab()
 
             CheckGLError("After SetEquation");
 
-            Objects::FetchToCPU(Renderer::GetCurrentObjectBuffer(), currentCpuObjects);
+            Objects::FetchToCPU(Renderer::GetCurrentObjectBuffer(), selectedObjectIndex, 1, selectedObject);
 
-            if (selectedObjectIndex < (int)currentCpuObjects.size())
+            if (!selectedObject.empty())
             {
                 std::cout << "Equation applied! ID: "
-                    << currentCpuObjects[selectedObjectIndex].equationID << std::endl;
-                p_copy = currentCpuObjects[selectedObjectIndex];
+                    << selectedObject[0].equationID << std::endl;
+                p_copy = selectedObject[0];
             }
         }
         catch (std::exception& e)
@@ -1426,6 +1496,35 @@ void UIManager::RenderViewTab()
     ImGui::Spacing();
     ImGui::Checkbox("Show Trails", &g_physics.showTrails);
     ImGui::Checkbox("Show Phase Space", &g_physics.showPhaseSpace);
+    bool showConstraints = Objects::GetConstraintRendering();
+    if (ImGui::Checkbox("Show Constraints", &showConstraints))
+        Objects::SetConstraintRendering(showConstraints);
+    ImGui::Checkbox("Threaded Simulation", &g_physics.threadedSimulation);
+    bool pipelinedDraw = Objects::GetFramePipelineDepth() > 0;
+    if (ImGui::Checkbox("Pipelined Drawing", &pipelinedDraw))
+        Objects::SetFramePipelineDepth(pipelinedDraw ? 3 : 0);
+    bool instancedDraw = Objects::GetInstancedRendering();
+    if (ImGui::Checkbox("Instanced Drawing", &instancedDraw))
+        Objects::SetInstancedRendering(instancedDraw);
+    bool viewCulling = Objects::GetViewCulling();
+    if (ImGui::Checkbox("View Culling", &viewCulling))
+        Objects::SetViewCulling(viewCulling);
+    bool dynamicResolution = ResolutionScaler::GetEnabled();
+    if (ImGui::Checkbox("Dynamic Resolution", &dynamicResolution))
+        ResolutionScaler::SetEnabled(dynamicResolution);
+    if (dynamicResolution)
+    {
+        float budget = ResolutionScaler::GetBudget();
+        if (ImGui::SliderFloat("Frame Budget", &budget, 2.0f, 50.0f, "%.1f ms"))
+            ResolutionScaler::SetBudget(budget);
+        float minScale = ResolutionScaler::GetMinScale() * 100.0f;
+        if (ImGui::SliderFloat("Minimum Scale", &minScale, 10.0f, 100.0f, "%.0f%%"))
+            ResolutionScaler::SetMinScale(minScale / 100.0f);
+        ImGui::TextDisabled("Render scale: %.0f%% (%.1f ms)",
+            ResolutionScaler::GetScale() * 100.0f, ResolutionScaler::GetPassTime());
+    }
+    if (SimulationThread::IsRunning())
+        ImGui::TextDisabled("Steps/s: %.0f", SimulationThread::GetStepsPerSecond());
 
     ImGui::Spacing();
     ImGui::Separator();
@@ -1494,10 +1593,7 @@ void UIManager::RenderProjectTab()
     ImGui::Text("Statistics");
     ImGui::Spacing();
 
-    std::vector<Object> objects;
-    Objects::FetchToCPU(Renderer::GetCurrentObjectBuffer(), objects);
-
-    ImGui::Text("Objects: %d", (int)objects.size());
+    ImGui::Text("Objects: %d", Objects::GetNumObjects());
     ImGui::Text("Simulation Time: %.2fs", g_physics.globalTime);
 
     // File operations
@@ -0,0 +1,754 @@
+#include "vulkan_backend.h"
+#include "gpu_serializer.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#ifdef STELLAR_VULKAN
+#include <vulkan/vulkan.h>
+#include "vulkan_step_spirv.h"  // VULKAN_STEP_SPIRV: shaders/vulkan/step.comp, glslangValidator -V --vn
+#endif
+
+using CpuBackend::EquationSet;
+using CpuBackend::ObjectArrays;
+using CpuBackend::Scene;
+
+// Operand words after each token the step shader reads, -1 for the tokens it has no buffers for
+static int TokenOperands(int token)
+{
+    switch (token)
+    {
+    case GPUTokens::TOKEN_NUMBER:
+    case GPUTokens::TOKEN_VARIABLE:
+    case GPUTokens::TOKEN_TEMP_STORE:
+    case GPUTokens::TOKEN_TEMP_LOAD:
+    case GPUTokens::TOKEN_BRANCH:
+    case GPUTokens::TOKEN_JUMP: return 1;
+    case GPUTokens::TOKEN_OBJECT_REF:
+    case GPUTokens::TOKEN_PRELUDE: return 2;
+    case GPUTokens::TOKEN_DERIVATIVE:
+    case GPUTokens::TOKEN_PAIR_REF:
+    case GPUTokens::TOKEN_PAIR_SUM:
+    case GPUTokens::TOKEN_TABLE:
+    case GPUTokens::TOKEN_FIELD: return -1;
+    }
+    return 0;
+}
+
+bool VulkanBackend::CanStep(const Scene& scene, const EquationSet& equations, std::string& reason)
+{
+    if (equations.usesPairSums)
+    {
+        reason = "pair reductions (sum_j and friends)";
+        return false;
+    }
+    bool staged = scene.integrator != INTEGRATOR_SYMPLECTIC_EULER;
+    if (staged && equations.readsOtherObjects)
+    {
+        reason = "multi-stage integrators with equations that read other objects";
+        return false;
+    }
+    for (size_t i = 0; i < scene.collision.size(); i++)
+    {
+        if (scene.collision[i].enabled != 0 && scene.collision[i].shapeType != COLLISION_NONE)
+        {
+            reason = "collisions";
+            return false;
+        }
+    }
+    for (const std::vector<Constraint>& constraints : scene.constraints)
+    {
+        if (!constraints.empty())
+        {
+            reason = "constraints";
+            return false;
+        }
+    }
+
+    // Every component of every equation, operands skipped
+    const int numTokens = static_cast<int>(equations.tokens.size());
+    for (const EquationMapping& mapping : equations.mappings)
+    {
+        const int* fields = &mapping.tokenOffset_ax;
+        for (int c = 0; c < 7; c++)
+        {
+            int offset = fields[c * 4];
+            int end = std::min(numTokens, offset + fields[c * 4 + 1]);
+            for (int idx = std::max(offset, 0); idx < end; idx++)
+            {
+                int operands = TokenOperands(equations.tokens[idx]);
+                if (operands < 0)
+                {
+                    reason = "derivatives, pair reductions, lookup tables and fields";
+                    return false;
+                }
+                idx += operands;
+            }
+        }
+    }
+    return true;
+}
+
+#ifndef STELLAR_VULKAN
+bool VulkanBackend::Init(std::string& error)
+{
+    error = "The Vulkan backend needs a build with STELLAR_VULKAN";
+    return false;
+}
+
+void VulkanBackend::Cleanup() {}
+bool VulkanBackend::IsAvailable() { return false; }
+std::string VulkanBackend::GetDeviceName() { return ""; }
+bool VulkanBackend::HasComputeQueue() { return false; }
+
+bool VulkanBackend::Step(Scene& scene, const EquationSet& equations, int steps, std::string& error)
+{
+    (void)scene; (void)equations; (void)steps;
+    error = "The Vulkan backend needs a build with STELLAR_VULKAN";
+    return false;
+}
+#else
+
+// ============================================================================
+// DEVICE LAYOUT - MUST MATCH shaders/vulkan/step.comp
+// ============================================================================
+static const int VULKAN_LOCAL_SIZE = 64;
+static const int MAPPING_INTS = sizeof(EquationMapping) / sizeof(int);
+
+struct StepObject
+{
+    float motion[4];   // x, y, vx, vy
+    float spin[4];     // Previous ax, ay, rotation, angular velocity
+    float color[4];
+    float body[4];     // mass, charge, width, height
+    int equation[4];   // [0] = equation ID
+};
+static_assert(sizeof(StepObject) == 80, "StepObject must be 80 bytes!");
+
+struct StepConstants
+{
+    float dt, time, stiffness, damping;
+    float gravity, restitution, coupling, driveFreq;
+    float gravityDir[2], worldMin[2];
+    float worldMax[2];
+    float driveAmp;
+    int equationMode;
+    int boundaryMode, integrator, numObjects, numEquations;
+    int tokenCount, constantCount, paramCount, slotCount;
+};
+static_assert(sizeof(StepConstants) == 96, "StepConstants must be 96 bytes!");
+
+enum BufferSlot
+{
+    BUFFER_OBJECTS_A,  // Step k reads A and writes B when k is even, the other way round when odd
+    BUFFER_OBJECTS_B,
+    BUFFER_TOKENS,
+    BUFFER_CONSTANTS,
+    BUFFER_MAPPINGS,
+    BUFFER_PARAMS,
+    BUFFER_SLOTS,
+    BUFFER_COUNT
+};
+
+struct DeviceBuffer
+{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr;  // Staging buffers stay mapped
+};
+
+static bool g_initTried = false;
+static std::string g_initError;
+static VkInstance g_instance = VK_NULL_HANDLE;
+static VkPhysicalDevice g_physicalDevice = VK_NULL_HANDLE;
+static VkDevice g_device = VK_NULL_HANDLE;
+static VkQueue g_queue = VK_NULL_HANDLE;
+static uint32_t g_queueFamily = 0;
+static bool g_computeQueue = false;
+static std::string g_deviceName;
+static VkShaderModule g_shader = VK_NULL_HANDLE;
+static VkDescriptorSetLayout g_setLayout = VK_NULL_HANDLE;
+static VkPipelineLayout g_pipelineLayout = VK_NULL_HANDLE;
+static VkPipeline g_pipeline = VK_NULL_HANDLE;
+static VkDescriptorPool g_descriptorPool = VK_NULL_HANDLE;
+static VkDescriptorSet g_sets[2] = { VK_NULL_HANDLE, VK_NULL_HANDLE };  // g_sets[k % 2] for step k
+static VkCommandPool g_commandPool = VK_NULL_HANDLE;
+static VkCommandBuffer g_commands = VK_NULL_HANDLE;
+static VkSemaphore g_timeline = VK_NULL_HANDLE;
+static uint64_t g_timelineValue = 0;  // Signalled by the last submission
+static DeviceBuffer g_buffers[BUFFER_COUNT];
+static DeviceBuffer g_upload;    // Host-visible, everything a submission uploads
+static DeviceBuffer g_readback;  // Host-visible, the objects after the last step
+static bool g_descriptorsStale = true;
+
+static bool Fail(std::string& error, const std::string& what, VkResult result)
+{
+    error = "Vulkan backend: " + what + " failed (VkResult " + std::to_string(static_cast<int>(result)) + ")";
+    return false;
+}
+
+static bool FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties, uint32_t& index)
+{
+    VkPhysicalDeviceMemoryProperties memory;
+    vkGetPhysicalDeviceMemoryProperties(g_physicalDevice, &memory);
+    for (uint32_t i = 0; i < memory.memoryTypeCount; i++)
+    {
+        if ((typeBits & (1u << i)) && (memory.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void DestroyBuffer(DeviceBuffer& buffer)
+{
+    if (buffer.mapped) vkUnmapMemory(g_device, buffer.memory);
+    if (buffer.buffer) vkDestroyBuffer(g_device, buffer.buffer, nullptr);
+    if (buffer.memory) vkFreeMemory(g_device, buffer.memory, nullptr);
+    buffer = DeviceBuffer();
+}
+
+// Grows buffer to hold size bytes (powers of two from 256); contents are not kept
+static bool EnsureBuffer(DeviceBuffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage, bool hostVisible, std::string& error)
+{
+    if (buffer.buffer && buffer.size >= size) return true;
+    DestroyBuffer(buffer);
+    VkDeviceSize capacity = 256;
+    while (capacity < size) capacity <<= 1;
+
+    VkBufferCreateInfo info = {};
+
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    info.size = capacity;
+    info.usage = usage;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkResult result = vkCreateBuffer(g_device, &info, nullptr, &buffer.buffer);
+    if (result != VK_SUCCESS) return Fail(error, "vkCreateBuffer", result);
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(g_device, buffer.buffer, &requirements);
+    VkMemoryPropertyFlags properties = hostVisible ? (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+                                                   : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    VkMemoryAllocateInfo allocation = {};
+    allocation.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocation.allocationSize = requirements.size;
+    if (!FindMemoryType(requirements.memoryTypeBits, properties, allocation.memoryTypeIndex))
+    {
+        DestroyBuffer(buffer);
+        error = "Vulkan backend: no suitable memory type";
+        return false;
+    }
+    result = vkAllocateMemory(g_device, &allocation, nullptr, &buffer.memory);
+    if (result != VK_SUCCESS)
+    {
+        DestroyBuffer(buffer);
+        return Fail(error, "vkAllocateMemory", result);
+    }
+    vkBindBufferMemory(g_device, buffer.buffer, buffer.memory, 0);
+    if (hostVisible)
+    {
+        result = vkMapMemory(g_device, buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.mapped);
+        if (result != VK_SUCCESS)
+        {
+            DestroyBuffer(buffer);
+            return Fail(error, "vkMapMemory", result);
+        }
+    }
+    buffer.size = capacity;
+    if (!hostVisible) g_descriptorsStale = true;
+    return true;
+}
+
+static void WriteDescriptors()
+{
+    VkDescriptorBufferInfo infos[2][BUFFER_COUNT];
+    VkWriteDescriptorSet writes[2 * BUFFER_COUNT];
+    for (int s = 0; s < 2; s++)
+    {
+        for (int b = 0; b < BUFFER_COUNT; b++)
+        {
+            int slot = b;
+            if (b == BUFFER_OBJECTS_A) slot = (s == 0) ? BUFFER_OBJECTS_A : BUFFER_OBJECTS_B;
+            else if (b == BUFFER_OBJECTS_B) slot = (s == 0) ? BUFFER_OBJECTS_B : BUFFER_OBJECTS_A;
+            infos[s][b] = { g_buffers[slot].buffer, 0, VK_WHOLE_SIZE };
+
+            VkWriteDescriptorSet& write = writes[s * BUFFER_COUNT + b];
+            write = {};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = g_sets[s];
+            write.dstBinding = static_cast<uint32_t>(b);
+            write.descriptorCount = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            write.pBufferInfo = &infos[s][b];
+        }
+    }
+    vkUpdateDescriptorSets(g_device, 2 * BUFFER_COUNT, writes, 0, nullptr);
+    g_descriptorsStale = false;
+}
+
+// ============================================================================
+// Device selection and setup
+// ============================================================================
+
+// A compute queue family of device, preferring one without graphics; false if it has none
+static bool PickQueueFamily(VkPhysicalDevice device, uint32_t& family, bool& computeOnly)
+{
+    uint32_t count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> families(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, families.data());
+    bool found = false;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (!(families[i].queueFlags & VK_QUEUE_COMPUTE_BIT)) continue;
+        bool dedicated = !(families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT);
+        if (!found || (dedicated && !computeOnly))
+        {
+            family = i;
+            computeOnly = dedicated;
+            found = true;
+        }
+    }
+    return found;
+}
+
+static bool PickDevice(std::string& error)
+{
+    uint32_t count = 0;
+    vkEnumeratePhysicalDevices(g_instance, &count, nullptr);
+    std::vector<VkPhysicalDevice> devices(count);
+    vkEnumeratePhysicalDevices(g_instance, &count, devices.data());
+
+    int bestScore = -1;
+    for (VkPhysicalDevice device : devices)
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, &properties);
+        if (properties.apiVersion < VK_API_VERSION_1_2) continue;
+
+        VkPhysicalDeviceVulkan12Features features12 = {};
+
+        features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 features = {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &features12;
+        vkGetPhysicalDeviceFeatures2(device, &features);
+        if (!features12.timelineSemaphore) continue;
+
+        uint32_t family = 0;
+        bool computeOnly = false;
+        if (!PickQueueFamily(device, family, computeOnly)) continue;
+
+        int score = (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) ? 2
+                  : (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU) ? 1 : 0;
+        if (score <= bestScore) continue;
+        bestScore = score;
+        g_physicalDevice = device;
+        g_queueFamily = family;
+        g_computeQueue = computeOnly;
+        g_deviceName = properties.deviceName;
+    }
+    if (bestScore < 0)
+    {
+        error = "Vulkan backend: no device with Vulkan 1.2 timeline semaphores and a compute queue";
+        return false;
+    }
+    return true;
+}
+
+static bool CreatePipeline(std::string& error)
+{
+    VkShaderModuleCreateInfo moduleInfo = {};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = sizeof(VULKAN_STEP_SPIRV);
+    moduleInfo.pCode = VULKAN_STEP_SPIRV;
+    VkResult result = vkCreateShaderModule(g_device, &moduleInfo, nullptr, &g_shader);
+    if (result != VK_SUCCESS) return Fail(error, "vkCreateShaderModule", result);
+
+    VkDescriptorSetLayoutBinding bindings[BUFFER_COUNT];
+    for (int b = 0; b < BUFFER_COUNT; b++)
+    {
+        bindings[b] = {};
+        bindings[b].binding = static_cast<uint32_t>(b);
+        bindings[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[b].descriptorCount = 1;
+        bindings[b].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    VkDescriptorSetLayoutCreateInfo setInfo = {};
+    setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setInfo.bindingCount = BUFFER_COUNT;
+    setInfo.pBindings = bindings;
+    result = vkCreateDescriptorSetLayout(g_device, &setInfo, nullptr, &g_setLayout);
+    if (result != VK_SUCCESS) return Fail(error, "vkCreateDescriptorSetLayout", result);
+
+    VkPushConstantRange pushRange = { VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(StepConstants) };
+    VkPipelineLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &g_setLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushRange;
+    result = vkCreatePipelineLayout(g_device, &layoutInfo, nullptr, &g_pipelineLayout);
+    if (result != VK_SUCCESS) return Fail(error, "vkCreatePipelineLayout", result);
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = g_shader;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = g_pipelineLayout;
+    result = vkCreateComputePipelines(g_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &g_pipeline);
+    if (result != VK_SUCCESS) return Fail(error, "vkCreateComputePipelines", result);
+
+    VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * BUFFER_COUNT };
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 2;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    result = vkCreateDescriptorPool(g_device, &poolInfo, nullptr, &g_descriptorPool);
+    if (result != VK_SUCCESS) return Fail(error, "vkCreateDescriptorPool", result);
+
+    VkDescriptorSetLayout layouts[2] = { g_setLayout, g_setLayout };
+    VkDescriptorSetAllocateInfo setAllocation = {};
+    setAllocation.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setAllocation.descriptorPool = g_descriptorPool;
+    setAllocation.descriptorSetCount = 2;
+    setAllocation.pSetLayouts = layouts;
+    result = vkAllocateDescriptorSets(g_device, &setAllocation, g_sets);
+    if (result != VK_SUCCESS) return Fail(error, "vkAllocateDescriptorSets", result);
+    return true;
+}
+
+static bool CreateDevice(std::string& error)
+{
+    uint32_t apiVersion = VK_API_VERSION_1_0;
+    vkEnumerateInstanceVersion(&apiVersion);
+    if (apiVersion < VK_API_VERSION_1_2)
+    {
+        error = "Vulkan backend: the loader is older than Vulkan 1.2";
+        return false;
+    }
+
+    VkApplicationInfo app = {};
+
+    app.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app.pApplicationName = "stellar";
+    app.pEngineName = "stellar";
+    app.apiVersion = VK_API_VERSION_1_2;
+    VkInstanceCreateInfo instanceInfo = {};
+    instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instanceInfo.pApplicationInfo = &app;
+    VkResult result = vkCreateInstance(&instanceInfo, nullptr, &g_instance);
+    if (result != VK_SUCCESS) return Fail(error, "vkCreateInstance", result);
+    if (!PickDevice(error)) return false;
+
+    float priority = 1.0f;
+    VkDeviceQueueCreateInfo queueInfo = {};
+    queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueInfo.queueFamilyIndex = g_queueFamily;
+    queueInfo.queueCount = 1;
+    queueInfo.pQueuePriorities = &priority;
+    VkPhysicalDeviceVulkan12Features features12 = {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.timelineSemaphore = VK_TRUE;
+    VkDeviceCreateInfo deviceInfo = {};
+    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.pNext = &features12;
+    deviceInfo.queueCreateInfoCount = 1;
+    deviceInfo.pQueueCreateInfos = &queueInfo;
+    result = vkCreateDevice(g_physicalDevice, &deviceInfo, nullptr, &g_device);
+    if (result != VK_SUCCESS) return Fail(error, "vkCreateDevice", result);
+    vkGetDeviceQueue(g_device, g_queueFamily, 0, &g_queue);
+
+    if (!CreatePipeline(error)) return false;
+
+    VkCommandPoolCreateInfo poolInfo = {};
+
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = g_queueFamily;
+    result = vkCreateCommandPool(g_device, &poolInfo, nullptr, &g_commandPool);
+    if (result != VK_SUCCESS) return Fail(error, "vkCreateCommandPool", result);
+    VkCommandBufferAllocateInfo commandInfo = {};
+    commandInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandInfo.commandPool = g_commandPool;
+    commandInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandInfo.commandBufferCount = 1;
+    result = vkAllocateCommandBuffers(g_device, &commandInfo, &g_commands);
+    if (result != VK_SUCCESS) return Fail(error, "vkAllocateCommandBuffers", result);
+
+    VkSemaphoreTypeCreateInfo timelineInfo = {};
+
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &timelineInfo;
+    result = vkCreateSemaphore(g_device, &semaphoreInfo, nullptr, &g_timeline);
+    if (result != VK_SUCCESS) return Fail(error, "vkCreateSemaphore", result);
+    g_timelineValue = 0;
+    return true;
+}
+
+static void DestroyDevice()
+{
+    if (g_device)
+    {
+        vkDeviceWaitIdle(g_device);
+        for (DeviceBuffer& buffer : g_buffers) DestroyBuffer(buffer);
+        DestroyBuffer(g_upload);
+        DestroyBuffer(g_readback);
+        if (g_timeline) vkDestroySemaphore(g_device, g_timeline, nullptr);
+        if (g_commandPool) vkDestroyCommandPool(g_device, g_commandPool, nullptr);
+        if (g_descriptorPool) vkDestroyDescriptorPool(g_device, g_descriptorPool, nullptr);
+        if (g_pipeline) vkDestroyPipeline(g_device, g_pipeline, nullptr);
+        if (g_pipelineLayout) vkDestroyPipelineLayout(g_device, g_pipelineLayout, nullptr);
+        if (g_setLayout) vkDestroyDescriptorSetLayout(g_device, g_setLayout, nullptr);
+        if (g_shader) vkDestroyShaderModule(g_device, g_shader, nullptr);
+        vkDestroyDevice(g_device, nullptr);
+    }
+    if (g_instance) vkDestroyInstance(g_instance, nullptr);
+
+    g_instance = VK_NULL_HANDLE;
+    g_physicalDevice = VK_NULL_HANDLE;
+    g_device = VK_NULL_HANDLE;
+    g_queue = VK_NULL_HANDLE;
+    g_shader = VK_NULL_HANDLE;
+    g_setLayout = VK_NULL_HANDLE;
+    g_pipelineLayout = VK_NULL_HANDLE;
+    g_pipeline = VK_NULL_HANDLE;
+    g_descriptorPool = VK_NULL_HANDLE;
+    g_sets[0] = g_sets[1] = VK_NULL_HANDLE;
+    g_commandPool = VK_NULL_HANDLE;
+    g_commands = VK_NULL_HANDLE;
+    g_timeline = VK_NULL_HANDLE;
+    g_computeQueue = false;
+    g_deviceName.clear();
+    g_descriptorsStale = true;
+}
+
+bool VulkanBackend::Init(std::string& error)
+{
+    if (g_initTried)
+    {
+        error = g_initError;
+        return g_device != VK_NULL_HANDLE;
+    }
+    g_initTried = true;
+    if (!CreateDevice(g_initError))
+    {
+        DestroyDevice();
+        error = g_initError;
+        return false;
+    }
+    return true;
+}
+
+void VulkanBackend::Cleanup()
+{
+    DestroyDevice();
+    g_initTried = false;
+    g_initError.clear();
+}
+
+bool VulkanBackend::IsAvailable()
+{
+    return g_device != VK_NULL_HANDLE;
+}
+
+std::string VulkanBackend::GetDeviceName()
+{
+    return g_deviceName;
+}
+
+bool VulkanBackend::HasComputeQueue()
+{
+    return g_computeQueue;
+}
+
+// ============================================================================
+// Stepping
+// ============================================================================
+static void PackObjects(const ObjectArrays& s, std::vector<StepObject>& out)
+{
+    out.resize(s.Size());
+    for (size_t i = 0; i < s.Size(); i++)
+    {
+        StepObject& o = out[i];
+        o = StepObject{ { s.x[i], s.y[i], s.vx[i], s.vy[i] },
+                        { s.ax[i], s.ay[i], s.rotation[i], s.angularVelocity[i] },
+                        { s.r[i], s.g[i], s.b[i], s.a[i] },
+                        { s.mass[i], s.charge[i], s.width[i], s.height[i] },
+                        { s.equation[i], 0, 0, 0 } };
+    }
+}
+
+static void UnpackObjects(const StepObject* in, ObjectArrays& s)
+{
+    for (size_t i = 0; i < s.Size(); i++)
+    {
+        const StepObject& o = in[i];
+        s.x[i] = o.motion[0];
+        s.y[i] = o.motion[1];
+        s.vx[i] = o.motion[2];
+        s.vy[i] = o.motion[3];
+        s.ax[i] = o.spin[0];
+        s.ay[i] = o.spin[1];
+        s.rotation[i] = o.spin[2];
+        s.angularVelocity[i] = o.spin[3];
+        s.r[i] = o.color[0];
+        s.g[i] = o.color[1];
+        s.b[i] = o.color[2];
+        s.a[i] = o.color[3];
+        s.mass[i] = o.body[0];
+        s.charge[i] = o.body[1];
+    }
+}
+
+static void Barrier(VkPipelineStageFlags from, VkAccessFlags fromAccess, VkPipelineStageFlags to, VkAccessFlags toAccess)
+{
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = fromAccess;
+    barrier.dstAccessMask = toAccess;
+    vkCmdPipelineBarrier(g_commands, from, to, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+bool VulkanBackend::Step(Scene& scene, const EquationSet& equations, int steps, std::string& error)
+{
+    const size_t n = scene.state.Size();
+    if (n == 0 || steps <= 0) return true;
+    if (!Init(error)) return false;
+
+    std::vector<StepObject> objects;
+    PackObjects(scene.state, objects);
+    std::vector<int> mappings(equations.mappings.size() * MAPPING_INTS);
+    if (!mappings.empty()) std::memcpy(mappings.data(), equations.mappings.data(), mappings.size() * sizeof(int));
+
+    // The uploads back to back in the staging buffer, in BufferSlot order after the objects
+    struct Upload { BufferSlot slot; const void* data; VkDeviceSize bytes; };
+    const Upload uploads[] = {
+        { BUFFER_OBJECTS_A, objects.data(), objects.size() * sizeof(StepObject) },
+        { BUFFER_TOKENS, equations.tokens.data(), equations.tokens.size() * sizeof(int) },
+        { BUFFER_CONSTANTS, equations.constants.data(), equations.constants.size() * sizeof(float) },
+        { BUFFER_MAPPINGS, mappings.data(), mappings.size() * sizeof(int) },
+        { BUFFER_PARAMS, scene.objectParams.data(), scene.objectParams.size() * sizeof(float) },
+        { BUFFER_SLOTS, scene.handleSlots.data(), scene.handleSlots.size() * sizeof(int) },
+    };
+    VkDeviceSize uploadBytes = 0;
+    for (const Upload& upload : uploads) uploadBytes += (upload.bytes + 15) & ~VkDeviceSize(15);
+
+    const VkBufferUsageFlags storage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    const VkDeviceSize objectBytes = objects.size() * sizeof(StepObject);
+    if (!EnsureBuffer(g_buffers[BUFFER_OBJECTS_A], objectBytes, storage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, false, error) ||
+        !EnsureBuffer(g_buffers[BUFFER_OBJECTS_B], objectBytes, storage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, false, error))
+        return false;
+    for (const Upload& upload : uploads)
+    {
+        if (upload.slot != BUFFER_OBJECTS_A && !EnsureBuffer(g_buffers[upload.slot], upload.bytes, storage, false, error))
+            return false;
+    }
+    if (!EnsureBuffer(g_upload, uploadBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, true, error) ||
+        !EnsureBuffer(g_readback, objectBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT, true, error))
+        return false;
+    if (g_descriptorsStale) WriteDescriptors();
+
+    VkCommandBufferBeginInfo begin = {};
+
+    begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkResetCommandBuffer(g_commands, 0);
+    vkBeginCommandBuffer(g_commands, &begin);
+
+    VkDeviceSize offset = 0;
+    for (const Upload& upload : uploads)
+    {
+        if (upload.bytes == 0) continue;
+        std::memcpy(static_cast<char*>(g_upload.mapped) + offset, upload.data, upload.bytes);
+        VkBufferCopy copy = { offset, 0, upload.bytes };
+        vkCmdCopyBuffer(g_commands, g_upload.buffer, g_buffers[upload.slot].buffer, 1, &copy);
+        offset += (upload.bytes + 15) & ~VkDeviceSize(15);
+    }
+    Barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+    const SimParams& params = scene.params;
+    StepConstants constants = {};
+    constants.dt = params.dt;
+    constants.stiffness = params.stiffness;
+    constants.damping = params.damping;
+    constants.gravity = params.gravity;
+    constants.restitution = params.restitution;
+    constants.coupling = params.coupling;
+    constants.driveFreq = params.driveFreq;
+    constants.gravityDir[0] = params.gravityDir.x;
+    constants.gravityDir[1] = params.gravityDir.y;
+    constants.worldMin[0] = params.worldMin.x;
+    constants.worldMin[1] = params.worldMin.y;
+    constants.worldMax[0] = params.worldMax.x;
+    constants.worldMax[1] = params.worldMax.y;
+    constants.driveAmp = params.driveAmp;
+    constants.equationMode = params.equationMode;
+    constants.boundaryMode = params.boundaryMode;
+    constants.integrator = scene.integrator;
+    constants.numObjects = static_cast<int>(n);
+    constants.numEquations = static_cast<int>(equations.mappings.size());
+    constants.tokenCount = static_cast<int>(equations.tokens.size());
+    constants.constantCount = static_cast<int>(equations.constants.size());
+    constants.paramCount = static_cast<int>(scene.objectParams.size());
+    constants.slotCount = static_cast<int>(scene.handleSlots.size());
+
+    vkCmdBindPipeline(g_commands, VK_PIPELINE_BIND_POINT_COMPUTE, g_pipeline);
+    const uint32_t groups = static_cast<uint32_t>((n + VULKAN_LOCAL_SIZE - 1) / VULKAN_LOCAL_SIZE);
+    for (int k = 0; k < steps; k++)
+    {
+        if (k > 0) Barrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        constants.time = params.time + static_cast<float>(k) * params.dt;
+        vkCmdBindDescriptorSets(g_commands, VK_PIPELINE_BIND_POINT_COMPUTE, g_pipelineLayout, 0, 1, &g_sets[k % 2], 0, nullptr);
+        vkCmdPushConstants(g_commands, g_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(StepConstants), &constants);
+        vkCmdDispatch(g_commands, groups, 1, 1);
+    }
+
+    Barrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    VkBufferCopy readback = { 0, 0, objectBytes };
+    vkCmdCopyBuffer(g_commands, g_buffers[(steps % 2 == 1) ? BUFFER_OBJECTS_B : BUFFER_OBJECTS_A].buffer, g_readback.buffer, 1, &readback);
+    Barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+    vkEndCommandBuffer(g_commands);
+
+    // One submission for the whole batch; the host waits for its timeline value
+    const uint64_t signal = g_timelineValue + 1;
+    VkTimelineSemaphoreSubmitInfo timelineSubmit = {};
+    timelineSubmit.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineSubmit.signalSemaphoreValueCount = 1;
+    timelineSubmit.pSignalSemaphoreValues = &signal;
+    VkSubmitInfo submit = {};
+    submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit.pNext = &timelineSubmit;
+    submit.commandBufferCount = 1;
+    submit.pCommandBuffers = &g_commands;
+    submit.signalSemaphoreCount = 1;
+    submit.pSignalSemaphores = &g_timeline;
+    VkResult result = vkQueueSubmit(g_queue, 1, &submit, VK_NULL_HANDLE);
+    if (result != VK_SUCCESS) return Fail(error, "vkQueueSubmit", result);
+    g_timelineValue = signal;
+
+    VkSemaphoreWaitInfo wait = {};
+
+    wait.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    wait.semaphoreCount = 1;
+    wait.pSemaphores = &g_timeline;
+    wait.pValues = &signal;
+    result = vkWaitSemaphores(g_device, &wait, UINT64_MAX);
+    if (result != VK_SUCCESS) return Fail(error, "vkWaitSemaphores", result);
+
+    UnpackObjects(static_cast<const StepObject*>(g_readback.mapped), scene.state);
+    scene.params.time = params.time + static_cast<float>(steps - 1) * params.dt;
+    return true;
+}
+#endif
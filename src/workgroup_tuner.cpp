@@ -0,0 +1,303 @@
+#include "workgroup_tuner.h"
+#include "async_shader_loader.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const int WARMUP_SAMPLES = 2;     // First timings of a candidate are dropped (caches, clocks)
+static const int TUNE_SAMPLES = 8;       // Timings per candidate, compared by their median
+static const int IDLE_STEP_LIMIT = 120;  // Steps without the pass before it is left untuned
+static const int STALL_STEP_LIMIT = 1000;  // Steps the pass ran at another size (build loading) before a candidate is skipped
+static const int QUERY_RING = 8;         // Timings in flight per pass
+static const char* const CACHE_FILE = "workgroup_sizes.txt";
+static const char* const PASS_NAMES[TUNED_PASS_COUNT] = { "integrate", "constraints", "collide" };
+
+struct PassTuning
+{
+    int tunedSize = DEFAULT_LOCAL_SIZE;
+    int candidate = -1;  // Index into LOCAL_SIZE_CANDIDATES being timed, -1 = not tuning
+    std::vector<double> times[LOCAL_SIZE_CANDIDATE_COUNT];
+    int dropped[LOCAL_SIZE_CANDIDATE_COUNT] = {};
+    bool failed[LOCAL_SIZE_CANDIDATE_COUNT] = {};
+    int idleSteps = 0;
+    int stalledSteps = 0;
+    bool ran = false;    // BeginPass was called this step
+    bool timed = false;  // ... and issued a timing
+
+    // GL_TIMESTAMP pairs, in order of issue from ringHead
+    GLuint queries[QUERY_RING * 2] = {};
+    int tags[QUERY_RING] = {};  // Candidate each pair timed
+    int ringHead = 0;
+    int ringCount = 0;
+    bool open = false;
+};
+
+static PassTuning g_passes[TUNED_PASS_COUNT];
+static bool g_tuning = false;
+static bool g_stored = false;  // This device has sizes in the cache file
+
+// Vendor, renderer and driver version: a new driver may allocate registers differently
+static std::string DeviceKey()
+{
+    std::string key;
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+    {
+        const GLubyte* value = glGetString(name);
+        key += '\n';
+        if (value) key += reinterpret_cast<const char*>(value);
+    }
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(HashShaderText(key)));
+    return hex;
+}
+
+static std::string CachePath()
+{
+    std::string directory = GetProgramCacheDirectory();
+    return directory.empty() ? std::string() : (std::filesystem::path(directory) / CACHE_FILE).string();
+}
+
+// One line per device: key, then the size of each pass in TunedPass order
+static void StoreSizes()
+{
+    std::string path = CachePath();
+    if (path.empty()) return;
+
+    std::string key = DeviceKey();
+    std::vector<std::string> lines;
+    {
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line))
+            if (!line.empty() && line.compare(0, key.size() + 1, key + " ") != 0) lines.push_back(line);
+    }
+    std::ostringstream entry;
+    entry << key;
+    for (const PassTuning& pass : g_passes) entry << ' ' << pass.tunedSize;
+    lines.push_back(entry.str());
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    std::string staging = path + ".tmp";
+    {
+        std::ofstream out(staging, std::ios::trunc);
+        if (!out) return;
+        for (const std::string& line : lines) out << line << '\n';
+    }
+    std::filesystem::rename(staging, path, error);
+    g_stored = !error;
+}
+
+static bool IsCandidate(int size)
+{
+    return std::find(LOCAL_SIZE_CANDIDATES, LOCAL_SIZE_CANDIDATES + LOCAL_SIZE_CANDIDATE_COUNT, size) !=
+           LOCAL_SIZE_CANDIDATES + LOCAL_SIZE_CANDIDATE_COUNT;
+}
+
+static void LoadSizes()
+{
+    std::string path = CachePath();
+    if (path.empty()) return;
+
+    std::string key = DeviceKey();
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream fields(line);
+        std::string lineKey;
+        int sizes[TUNED_PASS_COUNT];
+        if (!(fields >> lineKey) || lineKey != key) continue;
+
+        bool valid = true;
+        for (int p = 0; p < TUNED_PASS_COUNT && valid; p++) valid = (fields >> sizes[p]) && IsCandidate(sizes[p]);
+        if (!valid) continue;
+        for (int p = 0; p < TUNED_PASS_COUNT; p++) g_passes[p].tunedSize = sizes[p];
+        g_stored = true;
+    }
+}
+
+static double Median(std::vector<double> times)
+{
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// Fastest candidate with a full set of timings; the current size when none has one
+static void FinishPass(TunedPass index)
+{
+    PassTuning& pass = g_passes[index];
+    pass.candidate = -1;
+
+    int best = -1;
+    double bestTime = 0.0;
+    for (int c = 0; c < LOCAL_SIZE_CANDIDATE_COUNT; c++)
+    {
+        if (pass.failed[c] || static_cast<int>(pass.times[c].size()) < TUNE_SAMPLES) continue;
+        double time = Median(pass.times[c]);
+        if (best < 0 || time < bestTime)
+        {
+            best = c;
+            bestTime = time;
+        }
+    }
+    if (best < 0)
+    {
+        std::cout << "[WorkgroupTuner] " << PASS_NAMES[index] << ": not timed, keeping " << pass.tunedSize << std::endl;
+        return;
+    }
+    pass.tunedSize = LOCAL_SIZE_CANDIDATES[best];
+    std::cout << "[WorkgroupTuner] " << PASS_NAMES[index] << ": " << pass.tunedSize << " threads ("
+              << bestTime << " ms)" << std::endl;
+}
+
+// ============================================================================
+// Lifetime
+// ============================================================================
+void WorkgroupTuner::Init()
+{
+    LoadSizes();
+}
+
+void WorkgroupTuner::Cleanup()
+{
+    for (PassTuning& pass : g_passes)
+    {
+        if (pass.queries[0]) glDeleteQueries(QUERY_RING * 2, pass.queries);
+        pass = PassTuning();
+    }
+    g_tuning = false;
+    g_stored = false;
+}
+
+// ============================================================================
+// Tuning
+// ============================================================================
+void WorkgroupTuner::Start(bool force)
+{
+    if (g_tuning || (g_stored && !force)) return;
+
+    for (PassTuning& pass : g_passes)
+    {
+        for (int c = 0; c < LOCAL_SIZE_CANDIDATE_COUNT; c++)
+        {
+            pass.times[c].clear();
+            pass.dropped[c] = 0;
+            pass.failed[c] = false;
+        }
+        if (pass.queries[0] == 0) glGenQueries(QUERY_RING * 2, pass.queries);
+        pass.candidate = 0;
+        pass.idleSteps = 0;
+        pass.stalledSteps = 0;
+    }
+    g_tuning = true;
+    std::cout << "[WorkgroupTuner] Timing " << LOCAL_SIZE_CANDIDATE_COUNT << " work-group sizes per pass" << std::endl;
+}
+
+bool WorkgroupTuner::IsTuning()
+{
+    return g_tuning;
+}
+
+int WorkgroupTuner::GetLocalSize(TunedPass pass)
+{
+    const PassTuning& tuning = g_passes[pass];
+    return tuning.candidate >= 0 ? LOCAL_SIZE_CANDIDATES[tuning.candidate] : tuning.tunedSize;
+}
+
+int WorkgroupTuner::GetTunedSize(TunedPass pass)
+{
+    return g_passes[pass].tunedSize;
+}
+
+void WorkgroupTuner::BeginPass(TunedPass index, int localSize)
+{
+    PassTuning& pass = g_passes[index];
+    if (pass.candidate < 0) return;
+    pass.ran = true;
+
+    // Steps that fell back to another build are not timed
+    if (localSize != LOCAL_SIZE_CANDIDATES[pass.candidate] || pass.ringCount == QUERY_RING) return;
+    int slot = (pass.ringHead + pass.ringCount) % QUERY_RING;
+    pass.tags[slot] = pass.candidate;
+    glQueryCounter(pass.queries[2 * slot], GL_TIMESTAMP);
+    pass.open = true;
+    pass.timed = true;
+}
+
+void WorkgroupTuner::EndPass(TunedPass index)
+{
+    PassTuning& pass = g_passes[index];
+    if (!pass.open) return;
+    int slot = (pass.ringHead + pass.ringCount) % QUERY_RING;
+    glQueryCounter(pass.queries[2 * slot + 1], GL_TIMESTAMP);
+    pass.ringCount++;
+    pass.open = false;
+}
+
+void WorkgroupTuner::CandidateFailed(TunedPass index, int localSize)
+{
+    PassTuning& pass = g_passes[index];
+    for (int c = 0; c < LOCAL_SIZE_CANDIDATE_COUNT; c++)
+        if (LOCAL_SIZE_CANDIDATES[c] == localSize) pass.failed[c] = true;
+}
+
+void WorkgroupTuner::Update()
+{
+    if (!g_tuning) return;
+
+    bool tuning = false;
+    for (int p = 0; p < TUNED_PASS_COUNT; p++)
+    {
+        PassTuning& pass = g_passes[p];
+        if (pass.candidate < 0) continue;
+
+        // Pairs land in the order they were issued
+        while (pass.ringCount > 0)
+        {
+            GLuint available = 0;
+            glGetQueryObjectuiv(pass.queries[2 * pass.ringHead + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) break;
+
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(pass.queries[2 * pass.ringHead], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(pass.queries[2 * pass.ringHead + 1], GL_QUERY_RESULT, &end);
+            int tag = pass.tags[pass.ringHead];
+            if (pass.dropped[tag] < WARMUP_SAMPLES) pass.dropped[tag]++;
+            else pass.times[tag].push_back(end > begin ? (end - begin) * 1e-6 : 0.0);
+            pass.ringHead = (pass.ringHead + 1) % QUERY_RING;
+            pass.ringCount--;
+        }
+
+        // A scene without constraints or collisions never runs those passes
+        pass.idleSteps = pass.ran ? 0 : pass.idleSteps + 1;
+        pass.stalledSteps = (!pass.ran || pass.timed) ? 0 : pass.stalledSteps + 1;
+        pass.ran = false;
+        pass.timed = false;
+        if (pass.idleSteps > IDLE_STEP_LIMIT)
+        {
+            FinishPass(static_cast<TunedPass>(p));
+            continue;
+        }
+        if (pass.stalledSteps > STALL_STEP_LIMIT)
+        {
+            pass.failed[pass.candidate] = true;
+            pass.stalledSteps = 0;
+        }
+
+        while (pass.candidate < LOCAL_SIZE_CANDIDATE_COUNT &&
+               (pass.failed[pass.candidate] || static_cast<int>(pass.times[pass.candidate].size()) >= TUNE_SAMPLES))
+            pass.candidate++;
+        if (pass.candidate == LOCAL_SIZE_CANDIDATE_COUNT) FinishPass(static_cast<TunedPass>(p));
+        else tuning = true;
+    }
+
+    if (tuning) return;
+    g_tuning = false;
+    StoreSizes();
+}
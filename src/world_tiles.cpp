@@ -0,0 +1,110 @@
+#include "world_tiles.h"
+#include "object_worlds.h"
+#include <algorithm>
+#include <cmath>
+
+static bool g_enabled = false;
+static std::vector<int> g_worlds;  // Empty = every world
+static int g_columns = 0;
+
+// Tiles of the last upload, and the world count they were built for (-1 = stale)
+static GLuint g_tilesSSBO = 0;
+static int g_uploadedWorlds = -1;
+
+static int ShownCount()
+{
+    int worlds = ObjectWorlds::Count();
+    if (g_worlds.empty()) return worlds;
+    return static_cast<int>(std::count_if(g_worlds.begin(), g_worlds.end(),
+                                          [worlds](int w) { return w >= 0 && w < worlds; }));
+}
+
+// ============================================================================
+// Layout
+// ============================================================================
+void WorldTiles::Set(const std::vector<int>& worlds, int columns)
+{
+    g_enabled = true;
+    g_worlds = worlds;
+    g_columns = std::max(columns, 0);
+    g_uploadedWorlds = -1;
+}
+
+void WorldTiles::Clear()
+{
+    g_enabled = false;
+    g_worlds.clear();
+    g_columns = 0;
+    g_uploadedWorlds = -1;
+}
+
+bool WorldTiles::IsActive()
+{
+    return g_enabled && ShownCount() > 0;
+}
+
+void WorldTiles::GetGrid(int& columns, int& rows)
+{
+    int shown = std::max(ShownCount(), 1);
+    columns = g_columns > 0 ? std::min(g_columns, shown) : static_cast<int>(std::ceil(std::sqrt(static_cast<float>(shown))));
+    rows = (shown + columns - 1) / columns;
+}
+
+void WorldTiles::GetCellSize(int width, int height, int& cellWidth, int& cellHeight)
+{
+    int columns, rows;
+    GetGrid(columns, rows);
+    cellWidth = std::max(width / columns, 1);
+    cellHeight = std::max(height / rows, 1);
+}
+
+// ============================================================================
+// One vec4 per world: (centre x, centre y, half width, half height) in clip space
+// ============================================================================
+void WorldTiles::Bind()
+{
+    int worlds = ObjectWorlds::Count();
+    if (g_tilesSSBO == 0) glGenBuffers(1, &g_tilesSSBO);
+    if (g_uploadedWorlds != worlds)
+    {
+        int columns, rows;
+        GetGrid(columns, rows);
+        std::vector<float> tiles(static_cast<size_t>(std::max(worlds, 1)) * 4, 0.0f);
+        int cell = 0;
+        auto place = [&](int world)
+        {
+            if (world < 0 || world >= worlds || tiles[world * 4 + 2] != 0.0f) return;
+            int column = cell % columns, row = cell / columns;
+            tiles[world * 4 + 0] = -1.0f + (2.0f * column + 1.0f) / columns;
+            tiles[world * 4 + 1] = 1.0f - (2.0f * row + 1.0f) / rows;
+            tiles[world * 4 + 2] = 1.0f / columns;
+            tiles[world * 4 + 3] = 1.0f / rows;
+            cell++;
+        };
+        if (g_worlds.empty())
+            for (int w = 0; w < worlds; w++) place(w);
+        else
+            for (int w : g_worlds) place(w);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_tilesSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, tiles.size() * sizeof(float), tiles.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        g_uploadedWorlds = worlds;
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, WORLD_TILES_BINDING, g_tilesSSBO);
+}
+
+void WorldTiles::Unbind()
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, WORLD_TILES_BINDING, 0);
+}
+
+// ============================================================================
+// Release the buffer
+// ============================================================================
+void WorldTiles::Cleanup()
+{
+    if (g_tilesSSBO) glDeleteBuffers(1, &g_tilesSSBO);
+    g_tilesSSBO = 0;
+    Clear();
+}
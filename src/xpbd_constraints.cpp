@@ -0,0 +1,261 @@
+#include "xpbd_constraints.h"
+#include "async_shader_loader.h"
+#include <iostream>
+#include <algorithm>
+
+// Solve passes - MUST MATCH xpbd_constraints.comp
+enum XpbdPass
+{
+    XPBD_PASS_BEGIN = 0,
+    XPBD_PASS_SOLVE = 1,
+    XPBD_PASS_VELOCITY = 2
+};
+
+static const GLuint XPBD_WORK_GROUP_SIZE = 64;
+
+// Buffers
+static GLuint g_edgesSSBO = 0;      // Edges sorted by color
+static GLuint g_lambdasSSBO = 0;    // Accumulated multiplier per edge, reset every step
+static GLuint g_predictedSSBO = 0;  // Positions before the solve, for the velocity update
+static int g_edgeCapacity = 0;
+static int g_lambdaCapacity = 0;
+static int g_predictedCapacity = 0;
+
+// Graph
+static int g_edgeCount = 0;
+static std::vector<int> g_colorOffsets;  // First edge of each color
+static std::vector<int> g_colorCounts;   // Edges of each color
+
+// Parameters
+static int g_iterations = 4;
+static float g_compliance = 0.0f;
+
+// Async shader loading
+static GLuint g_program = 0;
+static AsyncShaderLoader g_loader;
+static bool g_ready = false;
+static GLint g_passLoc = -1;
+static GLint g_numObjectsLoc = -1;
+static GLint g_numEdgesLoc = -1;
+static GLint g_colorOffsetLoc = -1;
+static GLint g_colorCountLoc = -1;
+static GLint g_complianceLoc = -1;
+static GLint g_dtLoc = -1;
+static GLint g_adaptiveTimestepLoc = -1;
+
+// (Re)allocate an SSBO that holds at least `count` elements
+static void EnsureCapacity(GLuint& buffer, int& capacity, int count, GLsizeiptr elementSize)
+{
+    if (buffer != 0 && count <= capacity) return;
+    if (buffer == 0) glGenBuffers(1, &buffer);
+    capacity = std::max(count, std::max(capacity * 2, 64));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * elementSize, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+static GLuint NumBlocks(GLuint numItems)
+{
+    return (std::max(numItems, 1u) + XPBD_WORK_GROUP_SIZE - 1) / XPBD_WORK_GROUP_SIZE;
+}
+
+// Run a single solve pass over the given number of items
+static void DispatchPass(int pass, GLuint numItems)
+{
+    glUniform1i(g_passLoc, pass);
+    glDispatchCompute(NumBlocks(numItems), 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// ============================================================================
+// Start loading the solve shader (buffers follow the graph)
+// ============================================================================
+bool XpbdConstraints::Init()
+{
+    if (g_program == 0)
+    {
+        g_loader.LoadComputeShaderAsync(
+            "xpbd_constraints.comp",
+            [](GLuint program)
+            {
+                g_program = program;
+                g_passLoc = glGetUniformLocation(program, "uPass");
+                g_numObjectsLoc = glGetUniformLocation(program, "uNumObjects");
+                g_numEdgesLoc = glGetUniformLocation(program, "uNumEdges");
+                g_colorOffsetLoc = glGetUniformLocation(program, "uColorOffset");
+                g_colorCountLoc = glGetUniformLocation(program, "uColorCount");
+                g_complianceLoc = glGetUniformLocation(program, "uCompliance");
+                g_dtLoc = glGetUniformLocation(program, "uDt");
+                g_adaptiveTimestepLoc = glGetUniformLocation(program, "uAdaptiveTimestep");
+                g_ready = (g_passLoc != -1);
+            },
+            [](const std::string& error)
+            {
+                std::cerr << "\n[XpbdConstraints] xpbd_constraints.comp FAILED: " << error << std::endl;
+                g_ready = false;
+            });
+    }
+    return true;
+}
+
+// ============================================================================
+// Greedy edge coloring -> edges grouped by color -> upload
+// ============================================================================
+void XpbdConstraints::SetEdges(const std::vector<XpbdEdge>& edges)
+{
+    int numObjects = 0;
+    for (const XpbdEdge& e : edges) numObjects = std::max(numObjects, std::max(e.objectA, e.objectB) + 1);
+
+    // Lowest color not used yet by an edge at either end; chains take two colors
+    std::vector<std::vector<bool>> usedColors(numObjects);
+    std::vector<int> colorOf(edges.size());
+    int numColors = 0;
+    for (size_t i = 0; i < edges.size(); i++)
+    {
+        std::vector<bool>& usedA = usedColors[edges[i].objectA];
+        std::vector<bool>& usedB = usedColors[edges[i].objectB];
+        int color = 0;
+        while ((color < static_cast<int>(usedA.size()) && usedA[color]) ||
+               (color < static_cast<int>(usedB.size()) && usedB[color]))
+            color++;
+
+        if (static_cast<int>(usedA.size()) <= color) usedA.resize(color + 1, false);
+        if (static_cast<int>(usedB.size()) <= color) usedB.resize(color + 1, false);
+        usedA[color] = true;
+        usedB[color] = true;
+        colorOf[i] = color;
+        numColors = std::max(numColors, color + 1);
+    }
+
+    g_colorCounts.assign(numColors, 0);
+    for (int color : colorOf) g_colorCounts[color]++;
+    g_colorOffsets.assign(numColors, 0);
+    for (int c = 1; c < numColors; c++) g_colorOffsets[c] = g_colorOffsets[c - 1] + g_colorCounts[c - 1];
+
+    std::vector<XpbdEdge> sorted(edges.size());
+    std::vector<int> next = g_colorOffsets;
+    for (size_t i = 0; i < edges.size(); i++) sorted[next[colorOf[i]]++] = edges[i];
+
+    g_edgeCount = static_cast<int>(edges.size());
+    if (g_edgeCount == 0) return;
+
+    EnsureCapacity(g_edgesSSBO, g_edgeCapacity, g_edgeCount, sizeof(XpbdEdge));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, g_edgesSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, g_edgeCount * sizeof(XpbdEdge), sorted.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    EnsureCapacity(g_lambdasSSBO, g_lambdaCapacity, g_edgeCount, sizeof(float));
+}
+
+int XpbdConstraints::GetEdgeCount()
+{
+    return g_edgeCount;
+}
+
+int XpbdConstraints::GetColorCount()
+{
+    return static_cast<int>(g_colorCounts.size());
+}
+
+// ============================================================================
+// Parameters
+// ============================================================================
+void XpbdConstraints::SetParameters(int iterations, float compliance)
+{
+    g_iterations = std::max(1, iterations);
+    g_compliance = std::max(0.0f, compliance);
+}
+
+int XpbdConstraints::GetIterations()
+{
+    return g_iterations;
+}
+
+float XpbdConstraints::GetCompliance()
+{
+    return g_compliance;
+}
+
+// ============================================================================
+// Snapshot -> iterations x colors -> velocity update
+// ============================================================================
+bool XpbdConstraints::Solve(GLuint objectSSBO, int numObjects, float dt, bool adaptiveTimestep)
+{
+    if (!g_ready || g_edgeCount == 0 || numObjects <= 0) return false;
+
+    EnsureCapacity(g_predictedSSBO, g_predictedCapacity, numObjects, 2 * sizeof(float));
+
+    glUseProgram(g_program);
+    if (g_numObjectsLoc != -1) glUniform1i(g_numObjectsLoc, numObjects);
+    if (g_numEdgesLoc != -1) glUniform1i(g_numEdgesLoc, g_edgeCount);
+    if (g_complianceLoc != -1) glUniform1f(g_complianceLoc, g_compliance);
+    if (g_dtLoc != -1) glUniform1f(g_dtLoc, dt);
+    if (g_adaptiveTimestepLoc != -1) glUniform1i(g_adaptiveTimestepLoc, adaptiveTimestep ? 1 : 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, objectSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, XPBD_EDGES_BINDING, g_edgesSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, XPBD_LAMBDAS_BINDING, g_lambdasSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, XPBD_PREDICTED_BINDING, g_predictedSSBO);
+
+    DispatchPass(XPBD_PASS_BEGIN, static_cast<GLuint>(std::max(numObjects, g_edgeCount)));
+    for (int iter = 0; iter < g_iterations; iter++)
+    {
+        for (size_t c = 0; c < g_colorCounts.size(); c++)
+        {
+            if (g_colorOffsetLoc != -1) glUniform1i(g_colorOffsetLoc, g_colorOffsets[c]);
+            if (g_colorCountLoc != -1) glUniform1i(g_colorCountLoc, g_colorCounts[c]);
+            DispatchPass(XPBD_PASS_SOLVE, static_cast<GLuint>(g_colorCounts[c]));
+        }
+    }
+    DispatchPass(XPBD_PASS_VELOCITY, static_cast<GLuint>(numObjects));
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, XPBD_EDGES_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, XPBD_LAMBDAS_BINDING, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, XPBD_PREDICTED_BINDING, 0);
+    glUseProgram(0);
+    return true;
+}
+
+// ============================================================================
+// Release buffers and the solve program
+// ============================================================================
+void XpbdConstraints::Cleanup()
+{
+    if (g_program) glDeleteProgram(g_program);
+    g_program = 0;
+    g_ready = false;
+
+    GLuint* buffers[] = { &g_edgesSSBO, &g_lambdasSSBO, &g_predictedSSBO };
+    for (GLuint* buffer : buffers)
+    {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    g_edgeCapacity = 0;
+    g_lambdaCapacity = 0;
+    g_predictedCapacity = 0;
+    g_edgeCount = 0;
+    g_colorOffsets.clear();
+    g_colorCounts.clear();
+
+    g_iterations = 4;
+    g_compliance = 0.0f;
+}
+
+// ============================================================================
+// Shader loading status
+// ============================================================================
+void XpbdConstraints::UpdateShaderLoadingStatus()
+{
+    g_loader.Update();
+}
+
+bool XpbdConstraints::IsReady()
+{
+    return g_ready;
+}
+
+std::string XpbdConstraints::GetShaderLoadStatusMessage()
+{
+    if (!g_ready) return "[xpbd constraints] " + g_loader.GetStatusMessage();
+    return "XPBD constraint shader ready";
+}
@@ -0,0 +1,502 @@
+// benchmark.cpp - native benchmarks of the simulation hot paths
+//
+// Runs headless (hidden GLFW window) and times each stage on its own, so a regression in
+// tests/test.py's frame time can be traced to the parser, the upload, the step or a readback.
+// GPU stages end with glFinish, so every number includes the wait for the GPU.
+//
+//   stellar_benchmark [output.json] [--max-objects N] [--quick]
+//
+// Results go to stdout as JSON, and to output.json when given.
+#include "objects.h"
+#include "parser.h"
+#include "gpu_serializer.h"
+#include "broadphase.h"
+#include "gpu_primitives.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double MillisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// ============================================================================
+// JSON output: one array of {name, params..., value fields} records
+// ============================================================================
+struct Result
+{
+    std::string name;
+    std::vector<std::pair<std::string, double>> fields;
+};
+
+static std::vector<Result> g_results;
+
+static void Record(const std::string& name, std::vector<std::pair<std::string, double>> fields)
+{
+    g_results.push_back({ name, std::move(fields) });
+    std::cerr << "[Benchmark] " << name;
+    for (const auto& field : g_results.back().fields) std::cerr << " " << field.first << "=" << field.second;
+    std::cerr << std::endl;
+}
+
+static std::string ResultsToJson()
+{
+    std::ostringstream json;
+    json.precision(6);
+    json << "{\n  \"results\": [\n";
+    for (size_t i = 0; i < g_results.size(); ++i)
+    {
+        json << "    { \"name\": \"" << g_results[i].name << "\"";
+        for (const auto& field : g_results[i].fields) json << ", \"" << field.first << "\": " << field.second;
+        json << " }" << (i + 1 < g_results.size() ? ",\n" : "\n");
+    }
+    json << "  ]\n}\n";
+    return json.str();
+}
+
+// ============================================================================
+// Scene helpers
+// ============================================================================
+static const char* SPRING_EQUATION = "-k*x/m - b*vx/m, -k*y/m - b*vy/m, 0, 1, 1, 1, 1";
+
+static void ClearScene()
+{
+    int count = Objects::GetNumObjects();
+    if (count == 0) return;
+    std::vector<int> all(count);
+    std::iota(all.begin(), all.end(), 0);
+    Objects::RemoveObjects(all);
+    glFinish();
+}
+
+// count circles on a square grid `spacing` apart, all on equation `equationID`
+static bool FillScene(int count, int equationID, float spacing, bool collide)
+{
+    ClearScene();
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count))));
+    std::vector<Object> objects(count);
+    for (int i = 0; i < count; ++i)
+    {
+        Object& object = objects[i];
+        std::memset(&object, 0, sizeof(Object));
+        object.position = glm::vec2((i % side - side * 0.5f) * spacing, (i / side - side * 0.5f) * spacing);
+        object.velocity = glm::vec2(std::sin(i * 0.37f), std::cos(i * 0.53f));
+        object.mass = 1.0f;
+        object.visualSkinType = SKIN_CIRCLE;
+        object.collisionShapeType = collide ? COLLISION_CIRCLE : COLLISION_NONE;
+        object.visualData = glm::vec4(spacing * 0.4f, 0.0f, 0.0f, 0.0f);
+        object.collisionData = glm::vec4(spacing * 0.4f, 0.0f, 0.0f, 0.0f);
+        object.color = glm::vec4(1.0f);
+        object.equationID = equationID;
+    }
+    if (Objects::AddObjects(objects) < 0) return false;
+
+    if (collide)
+    {
+        std::vector<int> indices(count);
+        std::iota(indices.begin(), indices.end(), 0);
+        Objects::SetCollisionShape(indices, COLLISION_CIRCLE);
+        Objects::SetCollisionEnabled(indices, true);
+    }
+    glFinish();
+    return Objects::GetNumObjects() == count;
+}
+
+// Mean milliseconds of `steps` steps after `warmup` untimed ones
+static double TimeSteps(int warmup, int steps)
+{
+    int input = 0;
+    for (int i = 0; i < warmup; ++i, input = 1 - input) Objects::Update(input, 1 - input);
+    glFinish();
+
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < steps; ++i, input = 1 - input) Objects::Update(input, 1 - input);
+    glFinish();
+    return MillisecondsSince(start) / steps;
+}
+
+// Compute, collision and constraint passes all link asynchronously; a step returns 0 until they have
+static bool WaitForShaders(double timeoutSeconds)
+{
+    Clock::time_point start = Clock::now();
+    while (MillisecondsSince(start) < timeoutSeconds * 1000.0)
+    {
+        Objects::UpdateShaderLoadingStatus();
+        if (Objects::IsComputeShaderReady() && Objects::Update(0, 1) > 0) return true;
+        glfwPollEvents();
+    }
+    return false;
+}
+
+static std::vector<int> ObjectCounts(int first, int last)
+{
+    std::vector<int> counts;
+    for (int n = first; n <= last; n *= 4) counts.push_back(n);
+    if (counts.empty() || counts.back() != last) counts.push_back(last);
+    return counts;
+}
+
+// ============================================================================
+// Benchmarks
+// ============================================================================
+static const std::vector<std::string>& ParserEquations()
+{
+    static const std::vector<std::string> equations = {
+        "-k*x/m, -k*y/m, 0, 1, 1, 1, 1",
+        SPRING_EQUATION,
+        "-k*x/m - g*uGravityDir.x + uExternalForce.x, -k*y/m - g*uGravityDir.y + uExternalForce.y, 0, 1, 1, 1, 1",
+        "let r = len(pos); a = -pos/(r*r*r + 0.01); color.r = len(vel)",
+        "sin(t)*cos(x) - 0.5*vx*abs(vy), cos(t)*sin(y) - 0.5*vy*abs(vx), 0.1*sin(t), 0.5 + 0.5*sin(x), 0.5, 1, 1" };
+    return equations;
+}
+
+static void BenchParseAndSerialize(int iterations)
+{
+    ParserContext context;
+    const std::vector<std::string>& equations = ParserEquations();
+
+    std::vector<ParsedEquation> parsed;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        ParsedEquation equation = ParseEquation(equations[i % equations.size()], context);
+        if (parsed.size() < equations.size()) parsed.push_back(equation);
+    }
+    double parseMs = MillisecondsSince(start);
+    Record("parse_equation", { { "iterations", iterations }, { "us_per_call", parseMs * 1000.0 / iterations },
+                               { "calls_per_second", iterations / (parseMs / 1000.0) } });
+
+    size_t tokens = 0;
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        GPUSerializedEquation serialized = serializeEquationForGPU(parsed[i % parsed.size()]);
+        tokens += serialized.tokenBuffer_ax.size() + serialized.tokenBuffer_ay.size();
+    }
+    double serializeMs = MillisecondsSince(start);
+    Record("serialize_equation", { { "iterations", iterations }, { "us_per_call", serializeMs * 1000.0 / iterations },
+                                   { "acceleration_tokens", static_cast<double>(tokens) / iterations } });
+}
+
+static void BenchEquationUpload(int equations)
+{
+    ParserContext context;
+
+    // A new constant makes each equation new to the cache, so every call uploads
+    std::vector<ParsedEquation> parsed;
+    std::vector<std::string> strings;
+    for (int i = 0; i < equations; ++i)
+    {
+        std::ostringstream equation;
+        equation << "-" << (1.0 + i * 0.001) << "*x/m, -k*y/m, 0, 1, 1, 1, 1";
+        strings.push_back(equation.str());
+        parsed.push_back(ParseEquation(strings.back(), context));
+    }
+
+    glFinish();
+    Clock::time_point start = Clock::now();
+    int uploaded = 0;
+    for (int i = 0; i < equations; ++i)
+        if (Objects::AddOrGetEquation(strings[i], parsed[i]) >= 0) uploaded++;
+    glFinish();
+    double uploadMs = MillisecondsSince(start);
+
+    start = Clock::now();
+    for (int i = 0; i < equations; ++i) Objects::AddOrGetEquation(strings[i], parsed[i]);
+    double cachedMs = MillisecondsSince(start);
+
+    Record("add_or_get_equation", { { "equations", uploaded }, { "us_per_upload", uploadMs * 1000.0 / std::max(uploaded, 1) },
+                                    { "us_per_cached_lookup", cachedMs * 1000.0 / equations } });
+}
+
+static void BenchDispatch(int equationID, int maxObjects, int steps)
+{
+    for (int count : ObjectCounts(1024, maxObjects))
+    {
+        if (!FillScene(count, equationID, 0.5f, false))
+        {
+            Record("dispatch", { { "objects", count }, { "failed", 1 } });
+            break;
+        }
+        double ms = TimeSteps(3, steps);
+        Record("dispatch", { { "objects", count }, { "ms_per_step", ms }, { "ns_per_object", ms * 1.0e6 / count } });
+    }
+}
+
+static void BenchCollisions(int equationID, int maxObjects, int steps)
+{
+    BroadphaseMode modes[] = { BROADPHASE_ALL_PAIRS, BROADPHASE_UNIFORM_GRID, BROADPHASE_LBVH };
+    const char* names[] = { "all_pairs", "uniform_grid", "lbvh" };
+    BroadphaseMode previous = Objects::GetBroadphaseMode();
+    for (int mode = 0; mode < 3; ++mode)
+    {
+        Objects::SetBroadphaseMode(modes[mode]);
+        // All pairs is quadratic; past 16K objects it only shows that it is
+        int limit = modes[mode] == BROADPHASE_ALL_PAIRS ? std::min(maxObjects, 16384) : maxObjects;
+        for (int count : ObjectCounts(256, limit))
+        {
+            if (!FillScene(count, equationID, 0.09f, true)) break;
+            double ms = TimeSteps(3, steps);
+            Record(std::string("collisions_") + names[mode], { { "objects", count }, { "ms_per_step", ms } });
+        }
+    }
+    Objects::SetBroadphaseMode(previous);
+}
+
+static void BenchReadback(int equationID, int maxObjects, int repeats)
+{
+    std::vector<Object> out;
+    for (int count : ObjectCounts(1024, maxObjects))
+    {
+        if (!FillScene(count, equationID, 0.5f, false)) break;
+        Objects::FetchToCPU(0, out);  // Creates the readback ring outside the timing
+
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < repeats; ++i) Objects::FetchToCPU(0, out);
+        double ms = MillisecondsSince(start) / repeats;
+        double megabytes = static_cast<double>(count) * sizeof(Object) / (1024.0 * 1024.0);
+        Record("fetch_to_cpu", { { "objects", count }, { "ms", ms }, { "mb_per_second", megabytes / (ms / 1000.0) } });
+    }
+}
+
+static void BenchRemoveObject(int equationID, int maxObjects, int removals)
+{
+    for (int count : ObjectCounts(1024, std::min(maxObjects, 1 << 20)))
+    {
+        if (!FillScene(count, equationID, 0.5f, false)) break;
+        int n = std::min(removals, count);
+
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < n; ++i) Objects::RemoveObject((i * 7919) % Objects::GetNumObjects());
+        glFinish();
+        double ms = MillisecondsSince(start);
+        Record("remove_object", { { "objects", count }, { "us_per_remove", ms * 1000.0 / n } });
+    }
+}
+
+// Scan, sort, compaction and segmented reduction on random data, each checked against a CPU
+// reference once at every size ("correct" = 1) before it is timed
+static GLuint UploadWords(const std::vector<GLuint>& words)
+{
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(words.size(), 1) * sizeof(GLuint), words.data(), GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return buffer;
+}
+
+static std::vector<GLuint> ReadWords(GLuint buffer, size_t count)
+{
+    std::vector<GLuint> words(count);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(GLuint), words.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return words;
+}
+
+static void ResetWords(GLuint buffer, const std::vector<GLuint>& words)
+{
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, words.size() * sizeof(GLuint), words.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+template <typename Run>
+static double TimePrimitive(int repeats, Run run)
+{
+    run();
+    glFinish();
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < repeats; ++i) run();
+    glFinish();
+    return MillisecondsSince(start) / repeats;
+}
+
+static void BenchPrimitives(int maxElements, int repeats)
+{
+    Clock::time_point wait = Clock::now();
+    while (!GpuPrimitives::IsReady() && MillisecondsSince(wait) < 30000.0) Objects::UpdateShaderLoadingStatus();
+    if (!GpuPrimitives::IsReady())
+    {
+        Record("primitives", { { "failed", 1 } });
+        return;
+    }
+
+    std::mt19937 random(1234);
+    for (int count : ObjectCounts(1024, maxElements))
+    {
+        size_t n = static_cast<size_t>(count);
+        std::vector<GLuint> small(n), keys(n), indices(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            small[i] = random() % 16;
+            keys[i] = random();
+            indices[i] = static_cast<GLuint>(i);
+        }
+        GLuint data = UploadWords(small);
+        GLuint values = UploadWords(indices);
+        GLuint output = UploadWords(std::vector<GLuint>(n, 0u));
+        GLuint total = UploadWords({ 0u });
+
+        // Scan
+        std::vector<GLuint> expected(n);
+        std::exclusive_scan(small.begin(), small.end(), expected.begin(), 0u);
+        GLuint expectedTotal = expected.back() + small.back();
+        GpuPrimitives::ExclusiveScan(data, count, total, 0);
+        bool correct = ReadWords(data, n) == expected && ReadWords(total, 1)[0] == expectedTotal;
+        double ms = TimePrimitive(repeats, [&] { GpuPrimitives::ExclusiveScan(data, count); });
+        Record("primitive_scan", { { "elements", count }, { "correct", correct }, { "ms", ms },
+                                   { "ns_per_element", ms * 1.0e6 / count } });
+
+        // Key-value sort, checked for stability through the carried indices
+        ResetWords(data, keys);
+        GpuPrimitives::RadixSort(data, values, count);
+        std::vector<GLuint> order(indices);
+        std::stable_sort(order.begin(), order.end(), [&](GLuint a, GLuint b) { return keys[a] < keys[b]; });
+        std::vector<GLuint> sortedKeys(n);
+        for (size_t i = 0; i < n; ++i) sortedKeys[i] = keys[order[i]];
+        correct = ReadWords(data, n) == sortedKeys && ReadWords(values, n) == order;
+        ms = TimePrimitive(repeats, [&] {
+            ResetWords(data, keys);
+            GpuPrimitives::RadixSort(data, values, count);
+        });
+        Record("primitive_radix_sort", { { "elements", count }, { "correct", correct }, { "ms", ms },
+                                         { "ns_per_element", ms * 1.0e6 / count } });
+
+        // Compaction of the indices whose small value is below 4 (about a quarter)
+        std::vector<GLuint> flags(n), kept;
+        for (size_t i = 0; i < n; ++i)
+        {
+            flags[i] = small[i] < 4 ? 1u : 0u;
+            if (flags[i]) kept.push_back(static_cast<GLuint>(i));
+        }
+        ResetWords(data, flags);
+        GpuPrimitives::Compact(data, 0, count, output, total, 0);
+        GLuint keptCount = ReadWords(total, 1)[0];
+        correct = keptCount == kept.size() && ReadWords(output, kept.size()) == kept;
+        ms = TimePrimitive(repeats, [&] { GpuPrimitives::Compact(data, 0, count, output, total, 0); });
+        Record("primitive_compact", { { "elements", count }, { "correct", correct }, { "ms", ms },
+                                      { "ns_per_element", ms * 1.0e6 / count } });
+
+        // Sums over segments of 0-63 elements
+        std::vector<GLuint> offsets(1, 0u), floats(n);
+        while (offsets.back() < n) offsets.push_back(std::min<GLuint>(offsets.back() + random() % 64, static_cast<GLuint>(n)));
+        for (size_t i = 0; i < n; ++i)
+        {
+            float value = static_cast<float>(small[i]) * 0.25f;  // Exact in float, so sums match in any order
+            std::memcpy(&floats[i], &value, sizeof(value));
+        }
+        GLuint segments = static_cast<GLuint>(offsets.size() - 1);
+        GLuint offsetBuffer = UploadWords(offsets);
+        ResetWords(data, floats);
+        GpuPrimitives::SegmentedReduce(data, offsetBuffer, segments, output, GpuPrimitives::REDUCE_SUM);
+        std::vector<GLuint> sums = ReadWords(output, segments);
+        correct = true;
+        for (GLuint s = 0; s < segments && correct; ++s)
+        {
+            float sum = 0.0f, result;
+            for (GLuint k = offsets[s]; k < offsets[s + 1]; ++k) sum += static_cast<float>(small[k]) * 0.25f;
+            std::memcpy(&result, &sums[s], sizeof(result));
+            correct = result == sum;
+        }
+        ms = TimePrimitive(repeats, [&] {
+            GpuPrimitives::SegmentedReduce(data, offsetBuffer, segments, output, GpuPrimitives::REDUCE_SUM);
+        });
+        Record("primitive_segmented_reduce", { { "elements", count }, { "segments", segments }, { "correct", correct },
+                                               { "ms", ms }, { "ns_per_element", ms * 1.0e6 / count } });
+
+        GLuint buffers[] = { data, values, output, total, offsetBuffer };
+        glDeleteBuffers(5, buffers);
+    }
+}
+
+// ============================================================================
+// Entry point
+// ============================================================================
+int main(int argc, char** argv)
+{
+    std::string outputPath;
+    int maxObjects = Objects::MAX_OBJECTS;
+    bool quick = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--max-objects") == 0 && i + 1 < argc)
+            maxObjects = std::clamp(std::atoi(argv[++i]), 1024, Objects::MAX_OBJECTS);
+        else if (std::strcmp(argv[i], "--quick") == 0)
+            quick = true;
+        else
+            outputPath = argv[i];
+    }
+    if (quick) maxObjects = std::min(maxObjects, 65536);
+
+    if (!glfwInit())
+    {
+        std::cerr << "Failed to initialize GLFW\n";
+        return 1;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "Benchmark", nullptr, nullptr);
+    if (!window)
+    {
+        std::cerr << "Failed to create a hidden GLFW window\n";
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    if (!gladLoaderLoadGL())
+    {
+        std::cerr << "Failed to initialize GLAD\n";
+        return 1;
+    }
+
+    if (!Objects::Init(window) || !WaitForShaders(120.0))
+    {
+        std::cerr << "Objects did not initialize\n";
+        return 1;
+    }
+
+    ParserContext context;
+    int springID = Objects::AddOrGetEquation(SPRING_EQUATION, ParseEquation(SPRING_EQUATION, context));
+    int steps = quick ? 5 : 20;
+
+    BenchParseAndSerialize(quick ? 2000 : 20000);
+    BenchEquationUpload(quick ? 16 : 64);
+    BenchDispatch(springID, maxObjects, steps);
+    BenchCollisions(springID, maxObjects, steps);
+    BenchReadback(springID, maxObjects, quick ? 3 : 10);
+    BenchRemoveObject(springID, maxObjects, quick ? 32 : 256);
+    BenchPrimitives(maxObjects, quick ? 3 : 10);
+
+    std::string json = ResultsToJson();
+    std::cout << json;
+    if (!outputPath.empty())
+    {
+        std::ofstream file(outputPath);
+        file << json;
+        if (!file) std::cerr << "Failed to write " << outputPath << "\n";
+    }
+
+    Objects::Cleanup();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,291 @@
+#!/usr/bin/env python3
+"""
+HYPERSTELLAR GPU PHYSICS ENGINE - SCALING BENCHMARK SCENES
+
+Standard scenes that load the parts of the engine test.py leaves idle,
+each at 1k, 10k and 100k objects:
+
+    granular        dense circles pulled together, every step full of contacts
+    nbody_sum_j     all-pairs gravity through sum_j() references (to 10k)
+    nbody_tree      Barnes-Hut gravity (grav_ax, grav_ay)
+    spring_network  square lattice of distance constraints
+    mixed_equations 64 distinct equations spread over the objects
+    mcmc            Metropolis walkers: GPU density, host accept/reject per frame
+
+Every update() advances exactly one step (dt equals the timestep), and the
+GPU backend is forced, so the numbers scale with the scene and are not
+hidden by the step cap or the CPU crossover. A frame is timed as update()
+plus its share of one readback at the end of the run, which waits for the GPU.
+
+Usage:
+    python scaling_benchmark.py                        # run, print, write results
+    python scaling_benchmark.py --write-baseline       # ... and store them as the baseline
+    python scaling_benchmark.py --baseline FILE --threshold 0.15
+                                                       # report scenes >15% slower, exit 1 if any
+"""
+
+import argparse
+import json
+import math
+import os
+import platform
+import sys
+import time
+
+import numpy as np
+import hyperstellar as hs
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+DEFAULT_RESULTS = os.path.join(HERE, "scaling_benchmark_results.json")
+DEFAULT_BASELINE = os.path.join(HERE, "scaling_baseline.json")
+
+SIZES = [1000, 10000, 100000]
+TIMESTEP = 1.0 / 120.0
+WARMUP_FRAMES = 5
+MEASURE_FRAMES = 30
+
+# sum_j is O(N^2); 100k objects would take minutes per step
+SUM_J_LIMIT = 10000
+
+# -----------------------------------------------------------------------------
+# 1. HELPERS
+# -----------------------------------------------------------------------------
+
+def new_simulation():
+    """Headless simulation with no objects, one step per update, GPU only"""
+    sim = hs.Simulation(headless=True, enable_grid=False)
+    sim.wait_until_ready()
+    sim.remove_objects(list(range(sim.object_count())))
+    sim.set_parameter("timestep", TIMESTEP)
+    sim.set_parameter("backend", "gpu")
+    return sim
+
+def grid_positions(count, spacing):
+    """count positions on a square grid centred on the origin"""
+    side = int(math.ceil(math.sqrt(count)))
+    i = np.arange(count)
+    x = (i % side - side * 0.5) * spacing
+    y = (i // side - side * 0.5) * spacing
+    return x.astype(np.float32), y.astype(np.float32), side
+
+def wait_for_gpu(sim):
+    """A reduction reads back one value, so it returns once every queued step has run"""
+    sim.reduce("x", "sum")
+
+def time_frames(sim, per_frame=None):
+    """Mean and p95 milliseconds per frame, plus the GPU pass breakdown"""
+    for _ in range(WARMUP_FRAMES):
+        sim.update(TIMESTEP)
+        if per_frame: per_frame()
+    wait_for_gpu(sim)
+    sim.set_profiling(True)
+
+    frame_times = []
+    start = time.perf_counter()
+    for _ in range(MEASURE_FRAMES):
+        frame_start = time.perf_counter()
+        sim.update(TIMESTEP)
+        if per_frame: per_frame()
+        frame_times.append((time.perf_counter() - frame_start) * 1000.0)
+    wait_for_gpu(sim)
+    total_ms = (time.perf_counter() - start) * 1000.0
+
+    # Submission times alone miss the GPU work still queued; the total includes it
+    return {
+        "ms_per_frame": total_ms / MEASURE_FRAMES,
+        "p95_submit_ms": sorted(frame_times)[int(0.95 * (len(frame_times) - 1))],
+        "gpu_passes_ms": sim.get_profile().get("gpu", {}),
+    }
+
+# -----------------------------------------------------------------------------
+# 2. SCENES
+# -----------------------------------------------------------------------------
+
+def scene_granular(sim, count):
+    """Circles just touching on a grid, pulled to the centre, all colliding"""
+    x, y, _ = grid_positions(count, 0.1)
+    first = sim.add_objects(x, y, skin=hs.SkinType.CIRCLE, size=0.05)
+    indices = list(range(first, first + count))
+    sim.batch_set_collision_enabled(indices, True)
+    sim.batch_set_equation(indices, "-0.5*x - 0.2*vx, -0.5*y - 0.2*vy, 0, 1, 1, 1, 1")
+    return None
+
+def scene_nbody_sum_j(sim, count):
+    x, y, _ = grid_positions(count, 0.5)
+    first = sim.add_objects(x, y, mass=1.0 / count, size=0.05)
+    sim.batch_set_equation(list(range(first, first + count)),
+        "sum_j(pj.mass*(pj.x-x)/((pj.x-x)^2+(pj.y-y)^2+0.01)^1.5), "
+        "sum_j(pj.mass*(pj.y-y)/((pj.x-x)^2+(pj.y-y)^2+0.01)^1.5), 0, 1, 1, 1, 1")
+    return None
+
+def scene_nbody_tree(sim, count):
+    x, y, _ = grid_positions(count, 0.5)
+    first = sim.add_objects(x, y, mass=1.0 / count, size=0.05)
+    sim.batch_set_equation(list(range(first, first + count)), "grav_ax, grav_ay, 0, 1, 1, 1, 1")
+    return None
+
+def scene_spring_network(sim, count):
+    """Square lattice, each object tied to its right and lower neighbour"""
+    spacing = 0.3
+    x, y, side = grid_positions(count, spacing)
+    first = sim.add_objects(x, y, size=0.05)
+    sim.batch_set_equation(list(range(first, first + count)), "0, -1 - 0.1*vy, 0, 1, 1, 1, 1")
+
+    owners, targets = [], []
+    for i in range(count):
+        if (i % side) + 1 < side and i + 1 < count:
+            owners.append(first + i); targets.append(first + i + 1)
+        if i + side < count:
+            owners.append(first + i); targets.append(first + i + side)
+    sim.add_distance_constraints(owners, targets, [spacing] * len(owners))
+    return None
+
+def scene_mixed_equations(sim, count):
+    """64 equations, neighbouring objects on different ones"""
+    x, y, _ = grid_positions(count, 0.5)
+    first = sim.add_objects(x, y, size=0.05)
+    equations = [f"-{1.0 + 0.05 * k:.2f}*x/mass - 0.1*vx, -{1.0 + 0.05 * k:.2f}*y/mass - 0.1*vy, "
+                 f"{0.01 * k:.2f}, 0.5 + 0.5*sin(t + {k}), 0.5, 1, 1" for k in range(64)]
+    sim.set_equations(list(range(first, first + count)), [equations[i % 64] for i in range(count)])
+    return None
+
+def scene_mcmc(sim, count):
+    """examples/mcmc.py at scale: the GPU evaluates the density in b, the host moves the walkers"""
+    rng = np.random.default_rng(1)
+    x = rng.normal(0.0, 1.0, count).astype(np.float32)
+    y = rng.normal(0.0, 1.0, count).astype(np.float32)
+    first = sim.add_objects(x, y, vx=0.0, vy=0.0, size=0.05)
+    ids = list(range(first, first + count))
+    sim.batch_set_equation(ids, "0, 0, 0, 0.3, 0.6, exp(-1*(x*x+y*y)*(1 + 0.5*sin(0.3*t))), 1")
+
+    # Accepted positions and their densities; the objects hold the proposals
+    state = {"x": x.astype(np.float64), "y": y.astype(np.float64), "p": np.full(count, 0.001)}
+
+    def step():
+        # b now holds the density at each proposal; accept, then propose again
+        states = sim.batch_get(ids)
+        probabilities = np.array([max(0.001, s.b) for s in states])
+        accept = rng.random(count) < probabilities / state["p"]
+        state["x"] = np.where(accept, [s.x for s in states], state["x"])
+        state["y"] = np.where(accept, [s.y for s in states], state["y"])
+        state["p"] = np.where(accept, probabilities, state["p"])
+        proposal_x = state["x"] + rng.normal(0.0, 0.5, count)
+        proposal_y = state["y"] + rng.normal(0.0, 0.5, count)
+
+        updates = []
+        for i, s in enumerate(states):
+            update = hs.BatchUpdateData()
+            update.index = ids[i]
+            update.x, update.y = float(proposal_x[i]), float(proposal_y[i])
+            update.vx, update.vy = 0.0, 0.0
+            update.mass, update.charge = 1.0, 0.0
+            update.rotation, update.angular_velocity = 0.0, 0.0
+            update.width, update.height = s.width, s.height
+            update.r, update.g, update.b, update.a = s.r, s.g, s.b, s.a
+            updates.append(update)
+        sim.batch_update(updates)
+
+    return step
+
+SCENES = [
+    ("granular", scene_granular, None),
+    ("nbody_sum_j", scene_nbody_sum_j, SUM_J_LIMIT),
+    ("nbody_tree", scene_nbody_tree, None),
+    ("spring_network", scene_spring_network, None),
+    ("mixed_equations", scene_mixed_equations, None),
+    ("mcmc", scene_mcmc, None),
+]
+
+# -----------------------------------------------------------------------------
+# 3. RUN AND COMPARE
+# -----------------------------------------------------------------------------
+
+def run(sizes, only):
+    results = {}
+    for name, build, limit in SCENES:
+        if only and name not in only: continue
+        for count in sizes:
+            key = f"{name}/{count}"
+            if limit and count > limit:
+                print(f"   {key}: skipped (limit {limit})")
+                continue
+
+            sim = new_simulation()
+            try:
+                setup_start = time.perf_counter()
+                per_frame = build(sim, count)
+                wait_for_gpu(sim)
+                setup_ms = (time.perf_counter() - setup_start) * 1000.0
+
+                result = time_frames(sim, per_frame)
+                result["setup_ms"] = setup_ms
+                result["objects"] = sim.object_count()
+                results[key] = result
+                print(f"   {key}: {result['ms_per_frame']:.2f} ms/frame (setup {setup_ms:.0f} ms)")
+            except Exception as e:
+                print(f"   {key}: FAILED - {e}")
+                results[key] = {"error": str(e)}
+            finally:
+                sim.cleanup()
+    return results
+
+def compare(results, baseline, threshold):
+    """Scenes slower than the baseline by more than threshold, as (key, baseline, now, change)"""
+    regressions = []
+    print(f"\nAgainst the baseline ({threshold:.0%} threshold):")
+    for key, result in sorted(results.items()):
+        before = baseline.get(key, {}).get("ms_per_frame")
+        now = result.get("ms_per_frame")
+        if before is None or now is None:
+            print(f"   {key}: no comparison")
+            continue
+        change = (now - before) / before if before > 0 else 0.0
+        flag = "REGRESSION" if change > threshold else ("faster" if change < -threshold else "ok")
+        print(f"   {key}: {before:.2f} -> {now:.2f} ms ({change:+.1%}) {flag}")
+        if change > threshold: regressions.append((key, before, now, change))
+    return regressions
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--sizes", type=int, nargs="+", default=SIZES)
+    parser.add_argument("--scenes", nargs="+", help="Run only these scenes")
+    parser.add_argument("--output", default=DEFAULT_RESULTS)
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE)
+    parser.add_argument("--threshold", type=float, default=0.15, help="Slowdown that counts as a regression")
+    parser.add_argument("--write-baseline", action="store_true", help="Store these results as the baseline")
+    args = parser.parse_args()
+
+    print("SCALING BENCHMARK")
+    results = run(args.sizes, args.scenes)
+
+    report = {
+        "machine": {"platform": platform.platform(), "python": platform.python_version()},
+        "timestep": TIMESTEP,
+        "frames": MEASURE_FRAMES,
+        "results": results,
+    }
+    with open(args.output, "w") as f:
+        json.dump(report, f, indent=2)
+    print(f"\nResults written to {args.output}")
+
+    if args.write_baseline:
+        with open(args.baseline, "w") as f:
+            json.dump(report, f, indent=2)
+        print(f"Baseline written to {args.baseline}")
+        return 0
+
+    if not os.path.exists(args.baseline):
+        print(f"No baseline at {args.baseline}; run with --write-baseline to create one")
+        return 0
+
+    with open(args.baseline) as f:
+        baseline = json.load(f).get("results", {})
+    regressions = compare(results, baseline, args.threshold)
+    if regressions:
+        print(f"\n{len(regressions)} scene(s) regressed")
+        return 1
+    print("\nNo regressions")
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -568,6 +568,75 @@ def test_gpu_utilization():
     
     return results
 
+def test_equation_divergence():
+    """Test dispatch reordering with many equations interleaved across objects"""
+    print("\n8. EQUATION DIVERGENCE (Dispatch Reordering):")
+    print("   (100k objects, equation i % N, reorder off vs every 30 steps)")
+    
+    object_count = 100000
+    equation_counts = [8, 16, 32, 64]
+    templates = [
+        "-{k}*x - 0.05*vx, -{k}*y - 0.05*vy, 0, 1, 1, 1, 1",
+        "{k}*sin(t + x), {k}*cos(t + y), 0, 1, 1, 1, 1",
+        "-{k}*x/(x*x + y*y + 0.1), -{k}*y/(x*x + y*y + 0.1), 0, 1, 1, 1, 1",
+        "{k}*sin(x)*cos(y) - 0.1*vx, {k}*cos(x)*sin(y) - 0.1*vy, 0, 1, 1, 1, 1"
+    ]
+    results = {}
+    
+    for eq_count in equation_counts:
+        print(f"\n   Testing {eq_count} equations:")
+        equations = [templates[i % len(templates)].format(k=0.1 + 0.01 * i) for i in range(eq_count)]
+        results[eq_count] = {}
+        
+        sim = hs.Simulation(headless=True, enable_grid=False)
+        wait_for_shaders(sim)
+        
+        try:
+            # Clear default object
+            clear_all_objects(sim)
+            
+            # Interleave equations so neighbouring objects never share one
+            for i in range(object_count):
+                obj_id = sim.add_object(
+                    x=np.random.uniform(-100, 100),
+                    y=np.random.uniform(-100, 100),
+                    mass=1.0
+                )
+                sim.set_equation(obj_id, equations[i % eq_count])
+            
+            for interval in [0, 30]:
+                sim.set_dispatch_reorder_interval(interval)
+                
+                # Warmup (includes the first sort)
+                for _ in range(5):
+                    sim.update(0.016)
+                
+                # Measure
+                frame_times = []
+                for _ in range(30):
+                    start = time.perf_counter()
+                    sim.update(0.016)
+                    frame_times.append((time.perf_counter() - start) * 1000)
+                
+                label = "reorder every 30" if interval else "index order"
+                print_speed_result(f"{eq_count} equations, {label}", frame_times)
+                
+                results[eq_count][interval] = {
+                    'frame_times': frame_times,
+                    'avg_ms': statistics.mean(frame_times),
+                    'fps': 1000 / statistics.mean(frame_times)
+                }
+            
+            speedup = results[eq_count][0]['avg_ms'] / results[eq_count][30]['avg_ms']
+            results[eq_count]['speedup'] = speedup
+            print(f"    Reordering speedup: {speedup:.2f}x")
+            
+        finally:
+            sim.cleanup()
+            gc.collect()
+    
+    return results
+
 # -----------------------------------------------------------------------------
 # 4. MAIN PERFORMANCE TEST
 # -----------------------------------------------------------------------------
@@ -627,6 +696,11 @@ def run_speed_benchmark():
         gpu_results = test_gpu_utilization()
         all_results['tests']['gpu_utilization'] = gpu_results
         
+        # 8. Equation divergence
+        print("\n" + "=" * 80)
+        divergence_results = test_equation_divergence()
+        all_results['tests']['equation_divergence'] = divergence_results
+        
         # Generate performance report
         generate_performance_report(all_results)
         
@@ -703,6 +777,13 @@ def generate_performance_report(results):
             fps = data.get('fps', 0)
             print(f"  {name:10} equations: {avg_ms:5.2f} ms ({fps:4.0f} FPS)")
     
+    # Equation divergence
+    divergence = results['tests'].get('equation_divergence', {})
+    if divergence:
+        print("\n🔀 DISPATCH REORDERING (100k objects):")
+        for eq_count in sorted(divergence.keys()):
+            print(f"  {eq_count:2d} equations: {divergence[eq_count].get('speedup', 1.0):.2f}x speedup")
+    
     # Recommendations
     print("\n" + "=" * 80)
     print("RECOMMENDATIONS")